@@ -7,10 +7,11 @@ LOCAL_ARM_MODE := arm
 LOCAL_SRC_FILES := \
     AndroidBufferUtilities.cpp \
     HalideFilters.cpp \
+    LockedHardwareBuffer.cpp \
     LockedSurface.cpp \
     YuvBufferT.cpp
 LOCAL_LDFLAGS := -L$(LOCAL_PATH)/../jni
-LOCAL_LDLIBS := -lm -llog -landroid -latomic
+LOCAL_LDLIBS := -lm -llog -landroid -latomic -ldl
 LOCAL_LDLIBS += $(LOCAL_PATH)/../bin/$(TARGET_ARCH_ABI)/deinterleave.a
 LOCAL_LDLIBS += $(LOCAL_PATH)/../bin/$(TARGET_ARCH_ABI)/edge_detect.a
 LOCAL_STATIC_LIBRARIES := android_native_app_glue
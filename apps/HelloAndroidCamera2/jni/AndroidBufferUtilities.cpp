@@ -4,6 +4,7 @@
 
 #include <android/log.h>
 
+#include "LockedHardwareBuffer.h"
 #include "LockedSurface.h"
 #include "YuvBufferT.h"
 
@@ -88,4 +89,33 @@ JNIEXPORT jboolean JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUti
     return true;
 }
 
+JNIEXPORT jlong JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_lockHardwareBuffer(
+    JNIEnv *env, jobject obj, jobject hardwareBuffer) {
+    return reinterpret_cast<jlong>(LockedHardwareBuffer::lock(env, hardwareBuffer));
+}
+
+JNIEXPORT jlong JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_allocNativeYuvBufferTFromHardwareBufferHandle(
+    JNIEnv *env, jobject obj, jlong lockedHardwareBufferHandle) {
+    if (lockedHardwareBufferHandle == 0L) {
+        return 0L;
+    }
+    LockedHardwareBuffer *lb = reinterpret_cast<LockedHardwareBuffer *>(lockedHardwareBufferHandle);
+    YuvBufferT tmp = lb->yuvView();
+    if (tmp.isNull()) {
+        return 0L;
+    }
+    YuvBufferT *yuvBufferT = new YuvBufferT(tmp);
+    return reinterpret_cast<jlong>(yuvBufferT);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_unlockHardwareBuffer(
+    JNIEnv *env, jobject obj, jlong lockedHardwareBufferHandle) {
+    if (lockedHardwareBufferHandle == 0L) {
+        return false;
+    }
+    LockedHardwareBuffer *lb = reinterpret_cast<LockedHardwareBuffer *>(lockedHardwareBufferHandle);
+    delete lb;
+    return true;
+}
+
 } // extern "C"
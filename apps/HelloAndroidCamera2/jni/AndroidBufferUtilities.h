@@ -24,6 +24,15 @@ JNIEXPORT jlong JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilit
 JNIEXPORT jboolean JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_unlockSurface(
     JNIEnv *env, jobject obj, jlong surfaceWrapperHandle);
 
+JNIEXPORT jlong JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_lockHardwareBuffer(
+    JNIEnv *env, jobject obj, jobject hardwareBuffer);
+
+JNIEXPORT jlong JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_allocNativeYuvBufferTFromHardwareBufferHandle(
+    JNIEnv *env, jobject obj, jlong hardwareBufferHandle);
+
+JNIEXPORT jboolean JNICALL Java_com_example_helloandroidcamera2_AndroidBufferUtilities_unlockHardwareBuffer(
+    JNIEnv *env, jobject obj, jlong hardwareBufferHandle);
+
 } // extern "C"
 
 #endif // ANDROID_BUFFER_UTILITIES_H
@@ -0,0 +1,116 @@
+#include "LockedHardwareBuffer.h"
+
+#include <dlfcn.h>
+
+// Defined in <android/hardware_buffer.h>.
+#define AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 0x23
+#define AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN 3ULL
+#define AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN (3ULL << 4)
+
+namespace {
+
+// Mirrors AHardwareBuffer_Desc from <android/hardware_buffer.h>.
+struct HardwareBufferDesc {
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t format;
+    uint64_t usage;
+    uint32_t stride;
+    uint32_t rfu0;
+    uint64_t rfu1;
+};
+
+struct HardwareBufferFunctions {
+    AHardwareBuffer *(*fromHardwareBuffer)(JNIEnv *, jobject);
+    void (*acquire)(AHardwareBuffer *);
+    void (*release)(AHardwareBuffer *);
+    void (*describe)(const AHardwareBuffer *, HardwareBufferDesc *);
+    int (*lockPlanes)(AHardwareBuffer *, uint64_t, int32_t, const void *, void *);
+    int (*unlock)(AHardwareBuffer *, int32_t *);
+
+    HardwareBufferFunctions() {
+        void *lib = dlopen("libandroid.so", RTLD_NOW);
+        if (lib == nullptr) {
+            return;
+        }
+        fromHardwareBuffer = (AHardwareBuffer *(*)(JNIEnv *, jobject))dlsym(lib, "AHardwareBuffer_fromHardwareBuffer");
+        acquire = (void (*)(AHardwareBuffer *))dlsym(lib, "AHardwareBuffer_acquire");
+        release = (void (*)(AHardwareBuffer *))dlsym(lib, "AHardwareBuffer_release");
+        describe = (void (*)(const AHardwareBuffer *, HardwareBufferDesc *))dlsym(lib, "AHardwareBuffer_describe");
+        lockPlanes = (int (*)(AHardwareBuffer *, uint64_t, int32_t, const void *, void *))dlsym(lib, "AHardwareBuffer_lockPlanes");
+        unlock = (int (*)(AHardwareBuffer *, int32_t *))dlsym(lib, "AHardwareBuffer_unlock");
+    }
+
+    bool available() const {
+        return fromHardwareBuffer && acquire && release && describe && lockPlanes && unlock;
+    }
+};
+
+const HardwareBufferFunctions &functions() {
+    static HardwareBufferFunctions f;
+    return f;
+}
+
+}  // namespace
+
+LockedHardwareBuffer *LockedHardwareBuffer::lock(JNIEnv *env, jobject hardwareBuffer) {
+    const HardwareBufferFunctions &f = functions();
+    if (!f.available()) {
+        return nullptr;
+    }
+    AHardwareBuffer *buffer = f.fromHardwareBuffer(env, hardwareBuffer);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+
+    LockedHardwareBuffer *output = new LockedHardwareBuffer;
+    output->buffer_ = buffer;
+    f.acquire(buffer);
+
+    HardwareBufferDesc desc;
+    f.describe(buffer, &desc);
+    output->width_ = desc.width;
+    output->height_ = desc.height;
+    output->format_ = desc.format;
+
+    // No fence: wait for any pending writes before returning.
+    if (int err = f.lockPlanes(buffer,
+                               AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN | AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN,
+                               -1, nullptr, &output->planes_)) {
+        f.release(buffer);
+        delete output;
+        output = nullptr;
+    }
+
+    return output;
+}
+
+LockedHardwareBuffer::~LockedHardwareBuffer() {
+    const HardwareBufferFunctions &f = functions();
+    f.unlock(buffer_, nullptr);
+    f.release(buffer_);
+    buffer_ = nullptr;
+}
+
+YuvBufferT LockedHardwareBuffer::yuvView() const {
+    if (format_ != AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420 || planes_.planeCount != 3) {
+        return YuvBufferT();
+    }
+    // Plane 0 is Y, then U (Cb), then V (Cr). The chroma planes may be
+    // interleaved, which YuvBufferT detects from the pointers and
+    // strides.
+    const Plane &y = planes_.planes[0];
+    const Plane &u = planes_.planes[1];
+    const Plane &v = planes_.planes[2];
+    return YuvBufferT(reinterpret_cast<uint8_t *>(y.data),
+        width_, height_,
+        y.pixelStride, y.rowStride,
+        reinterpret_cast<uint8_t *>(u.data),
+        width_ / 2, height_ / 2,
+        u.pixelStride, u.rowStride,
+        reinterpret_cast<uint8_t *>(v.data),
+        width_ / 2, height_ / 2,
+        v.pixelStride, v.rowStride
+    );
+}
@@ -0,0 +1,55 @@
+#ifndef LOCKED_HARDWARE_BUFFER_H
+#define LOCKED_HARDWARE_BUFFER_H
+
+#include <jni.h>
+#include <stdint.h>
+
+#include "YuvBufferT.h"
+
+struct AHardwareBuffer;
+
+// Wraps an RAII pattern around locking an AHardwareBuffer for CPU
+// access, such as the one behind a camera2 Image from an ImageReader
+// (Image.getHardwareBuffer()). The planes are used in place, so
+// Halide reads the camera frame with no copy.
+//
+// The AHardwareBuffer API is only available from API level 26, and
+// locking individual planes from API level 29, so the functions are
+// looked up when first used. lock() returns nullptr on older devices.
+class LockedHardwareBuffer {
+public:
+
+    // Lock the AHardwareBuffer behind a android.hardware.HardwareBuffer,
+    // returning a lock object, or nullptr if it failed.
+    static LockedHardwareBuffer *lock(JNIEnv *env, jobject hardwareBuffer);
+
+    ~LockedHardwareBuffer();
+
+    // If the buffer is YUV_420_888 (AHARDWAREBUFFER_FORMAT_Y8Cb8Cr8_420),
+    // returns a non-null YuvBufferT viewing its planes.
+    // Otherwise, output.isNull() will be true.
+    YuvBufferT yuvView() const;
+
+private:
+
+    LockedHardwareBuffer() = default;
+
+    // Mirrors AHardwareBuffer_Planes from <android/hardware_buffer.h>.
+    struct Plane {
+        void *data;
+        uint32_t pixelStride;
+        uint32_t rowStride;
+    };
+    struct Planes {
+        uint32_t planeCount;
+        Plane planes[4];
+    };
+
+    AHardwareBuffer *buffer_;
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t format_;
+    Planes planes_;
+};
+
+#endif // LOCKED_HARDWARE_BUFFER_H
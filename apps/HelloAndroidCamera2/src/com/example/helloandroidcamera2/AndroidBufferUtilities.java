@@ -56,4 +56,26 @@ public class AndroidBufferUtilities {
      * @return false if handle is 0L.
      */
     public static native boolean unlockSurface(long handle);
+
+    /**
+     * Lock the AHardwareBuffer behind an android.hardware.HardwareBuffer (such as
+     * Image.getHardwareBuffer()) for CPU access, returning a native handle. It needs to be
+     * unlocked with unlockHardwareBuffer(). Requires API level 29.
+     * @return The handle, or 0L if the buffer could not be locked.
+     */
+    public static native long lockHardwareBuffer(Object hardwareBuffer);
+
+    /**
+     * Obtain a native Halide YuvBufferT handle viewing the planes of a locked YUV_420_888
+     * hardware buffer, without copying them. It needs to be deallocated with
+     * freeNativeYuvBufferT(), before the hardware buffer is unlocked.
+     * @return The handle, or 0L if the buffer is not YUV_420_888.
+     */
+    public static native long allocNativeYuvBufferTFromHardwareBufferHandle(long hardwareBufferHandle);
+
+    /**
+     * Unlock a locked native hardware buffer handle.
+     * @return false if handle is 0L.
+     */
+    public static native boolean unlockHardwareBuffer(long handle);
 }
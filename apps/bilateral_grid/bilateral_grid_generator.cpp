@@ -93,17 +93,29 @@ public:
             // 2) Compute those histogram by iterating over lots of the input image
             // 3) Blur the set of histograms in z
             histogram.reorder(c, z, x, y).compute_at(blurz, x).gpu_threads(x, y);
-            histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
-
-            // Schedule the remaining blurs and the sampling at the end similarly.
-            blurx.compute_root().reorder(c, x, y, z)
-                .reorder_storage(c, x, y, z).vectorize(c)
-                .unroll(y, 2, TailStrategy::RoundUp)
-                .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
+            if (get_target().has_feature(Target::CUDA)) {
+                // With atomic adds into the shared-memory histograms,
+                // the pixels of each grid cell can be splatted in
+                // parallel too, using a thread per column of pixels
+                // instead of a thread per grid cell. Pixels in
+                // different columns of a cell can land in the same z
+                // bin, hence the atomics.
+                histogram.update().atomic().reorder(c, r.y, r.x, x, y).gpu_threads(r.x, x, y).unroll(c);
+            } else {
+                histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+            }
+
+            // Schedule the remaining blurs and the sampling at the end
+            // similarly. Each tile of blury computes the rows of blurx
+            // it needs in shared memory, instead of making a round
+            // trip through global memory for them.
             blury.compute_root().reorder(c, x, y, z)
                 .reorder_storage(c, x, y, z).vectorize(c)
                 .unroll(y, 2, TailStrategy::RoundUp)
                 .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
+            blurx.compute_at(blury, x).reorder(c, x, y, z)
+                .reorder_storage(c, x, y, z).vectorize(c)
+                .gpu_threads(x, y);
             bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
             interpolated.compute_at(bilateral_grid, xi).vectorize(c);
         } else {
@@ -207,6 +207,14 @@ public:
     // currently allow 8-bit computations
     GeneratorParam<Type> result_type{"result_type", UInt(8)};
 
+    // Stream the image through the pipeline a pair of scanlines at a
+    // time, like a hardware ISP, instead of processing strips in
+    // parallel. Every intermediate is a line buffer of a few rows, so
+    // the working set doesn't depend on the image height. The
+    // parallelism comes from running the early stages asynchronously,
+    // ahead of the later ones.
+    GeneratorParam<bool> line_buffered{"line_buffered", false};
+
     Input<Buffer<uint16_t>> input{"input", 2};
     Input<Buffer<float>> matrix_3200{"matrix_3200", 2};
     Input<Buffer<float>> matrix_7000{"matrix_7000", 2};
@@ -451,26 +459,34 @@ void CameraPipe::generate() {
         }
         processed.compute_root()
             .reorder(c, x, y)
-            .split(y, yi, yii, 2, TailStrategy::RoundUp)
-            .split(yi, yo, yi, strip_size / 2)
+            .split(y, yi, yii, 2, TailStrategy::RoundUp);
+        // The loop level the intermediates are stored at: once per
+        // strip, or once for the whole image when line buffered.
+        LoopLevel intermed_store_at;
+        if (line_buffered) {
+            intermed_store_at = LoopLevel::root();
+        } else {
+            processed.split(yi, yo, yi, strip_size / 2).parallel(yo);
+            intermed_store_at = LoopLevel(processed, yo);
+        }
+        processed
             .vectorize(x, 2*vec, TailStrategy::RoundUp)
-            .unroll(c)
-            .parallel(yo);
+            .unroll(c);
 
-        denoised.compute_at(processed, yi).store_at(processed, yo)
+        denoised.compute_at(processed, yi).store_at(intermed_store_at)
             .prefetch(input, y, 2)
             .fold_storage(y, 16)
             .tile(x, y, x, y, xi, yi, 2*vec, 2)
             .vectorize(xi)
             .unroll(yi);
 
-        deinterleaved.compute_at(processed, yi).store_at(processed, yo)
+        deinterleaved.compute_at(processed, yi).store_at(intermed_store_at)
             .fold_storage(y, 8)
             .reorder(c, x, y)
             .vectorize(x, 2*vec, TailStrategy::RoundUp)
             .unroll(c);
 
-        curved.compute_at(processed, yi).store_at(processed, yo)
+        curved.compute_at(processed, yi).store_at(intermed_store_at)
             .reorder(c, x, y)
             .tile(x, y, x, y, xi, yi, 2*vec, 2, TailStrategy::RoundUp)
             .vectorize(xi)
@@ -481,8 +497,19 @@ void CameraPipe::generate() {
             .vectorize(x)
             .unroll(c);
 
+        if (line_buffered) {
+            // Fold curved too, which is otherwise stored a strip at a
+            // time, and hot pixel suppression and deinterleaving run
+            // ahead on threads of their own. The folding semaphores
+            // keep them from overwriting rows still in use.
+            curved.fold_storage(y, 8);
+            denoised.async();
+            deinterleaved.async();
+            strip_size = 2;
+        }
+
         demosaiced->intermed_compute_at.set({processed, yi});
-        demosaiced->intermed_store_at.set({processed, yo});
+        demosaiced->intermed_store_at.set(intermed_store_at);
         demosaiced->output_compute_at.set({curved, x});
 
         if (get_target().features_any_of({Target::HVX_64, Target::HVX_128})) {
@@ -4,11 +4,15 @@
 #ifndef NO_AUTO_SCHEDULE
 #include "camera_pipe_auto_schedule.h"
 #endif
+#ifndef NO_LINE_BUFFERED
+#include "camera_pipe_line_buffered.h"
+#endif
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
 #include "halide_malloc_trace.h"
 
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -17,6 +21,53 @@
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
 
+namespace {
+
+// The bytes currently allocated by the pipeline, and the most there
+// have been at any one time.
+std::atomic<size_t> live_bytes, peak_bytes;
+
+void *footprint_malloc(void *user_context, size_t x) {
+    // Align to 128 bytes like the default allocator, with room before
+    // the start for the original pointer and the size.
+    void *orig = malloc(x + 2 * sizeof(void *) + 128);
+    if (orig == nullptr) {
+        return nullptr;
+    }
+    void *ptr = (void *)((((size_t)orig + 2 * sizeof(void *) + 127) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = x;
+    size_t live = (live_bytes += x);
+    size_t peak = peak_bytes.load();
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live)) {
+    }
+    return ptr;
+}
+
+void footprint_free(void *user_context, void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    live_bytes -= ((size_t *)ptr)[-2];
+    free(((void **)ptr)[-1]);
+}
+
+// Run f once and return the peak number of bytes it had allocated on
+// the heap. Small allocations placed on the stack aren't counted.
+template<typename F>
+size_t heap_footprint(F f) {
+    live_bytes = 0;
+    peak_bytes = 0;
+    halide_malloc_t old_malloc = halide_set_custom_malloc(footprint_malloc);
+    halide_free_t old_free = halide_set_custom_free(footprint_free);
+    f();
+    halide_set_custom_malloc(old_malloc);
+    halide_set_custom_free(old_free);
+    return peak_bytes;
+}
+
+}  // namespace
+
 int main(int argc, char **argv) {
     if (argc < 8) {
         printf("Usage: ./process raw.png color_temp gamma contrast sharpen timing_iterations output.png\n"
@@ -26,6 +77,8 @@ int main(int argc, char **argv) {
 
 #ifdef HL_MEMINFO
     halide_enable_malloc_trace();
+#elif defined(HL_MEMINFO_SUMMARY)
+    halide_enable_malloc_trace_summary();
 #endif
 
     fprintf(stderr, "input: %s\n", argv[1]);
@@ -66,12 +119,16 @@ int main(int argc, char **argv) {
 
     double best;
 
-    best = benchmark(timing_iterations, 1, [&]() {
+    auto manual = [&]() {
         camera_pipe(input, matrix_3200, matrix_7000,
                     color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
                     output);
-    });
+    };
+    best = benchmark(timing_iterations, 1, manual);
     fprintf(stderr, "Halide (manual):\t%gus\n", best * 1e6);
+#ifndef HL_MEMINFO
+    fprintf(stderr, "Halide (manual) heap footprint:\t%zu bytes\n", heap_footprint(manual));
+#endif
 
     #ifndef NO_AUTO_SCHEDULE
     best = benchmark(timing_iterations, 1, [&]() {
@@ -82,6 +139,19 @@ int main(int argc, char **argv) {
     fprintf(stderr, "Halide (auto):\t%gus\n", best * 1e6);
     #endif
 
+    #ifndef NO_LINE_BUFFERED
+    auto line_buffered = [&]() {
+        camera_pipe_line_buffered(input, matrix_3200, matrix_7000,
+                                  color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                                  output);
+    };
+    best = benchmark(timing_iterations, 1, line_buffered);
+    fprintf(stderr, "Halide (line buffered):\t%gus\n", best * 1e6);
+    #ifndef HL_MEMINFO
+    fprintf(stderr, "Halide (line buffered) heap footprint:\t%zu bytes\n", heap_footprint(line_buffered));
+    #endif
+    #endif
+
     fprintf(stderr, "output: %s\n", argv[7]);
     convert_and_save_image(output, argv[7]);
     fprintf(stderr, "        %d %d\n", output.width(), output.height());
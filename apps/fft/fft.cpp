@@ -1026,6 +1026,16 @@ vector<int> radix_factor(int N) {
         }
     }
 
+    // Factor the rest of N into small odd radices. Mixed radix sizes such as
+    // 240 or 1000 then only need small DFTs, which are unrolled.
+    static const int odd_radices[] = { 5, 3, 7 };
+    for (int r : odd_radices) {
+        while (N % r == 0) {
+            R.push_back(r);
+            N /= r;
+        }
+    }
+
     // If there are still factors left over, just include them as a radix.
     if (N != 1 || R.empty()) {
         R.push_back(N);
@@ -1057,3 +1067,242 @@ Func fft2d_c2r(ComplexFunc c,
                const Fft2dDesc& desc) {
     return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
 }
+
+namespace {
+
+// The number of sequences of a batch of 1D FFTs that are transformed together
+// in one group of SIMD vectors.
+int batch_vector_width(const Target& target, const Fft2dDesc& desc) {
+    if (desc.vector_width > 0) {
+        return desc.vector_width;
+    }
+    return target.natural_vector_size<float>();
+}
+
+// Compute the 1D DFTs of dimension 0 of x, where dimension 1 of x indexes a
+// batch of sequences. The DFTs are vectorized across groups of the batch, so
+// the result is returned transposed, i.e. indexed by batch, n.
+ComplexFunc fft1d_batch_T(ComplexFunc x,
+                          const vector<int>& R,
+                          int sign,
+                          Expr gain,
+                          int vector_width,
+                          const string& prefix,
+                          const Target& target,
+                          TwiddleFactorSet* twiddle_cache) {
+    int N = product(R);
+    Var n = x.args()[0];
+
+    ComplexFunc xT = transpose(x);
+    ComplexFunc dftT = fft_dim1(xT,
+                                R,
+                                sign,
+                                vector_width,  // extent of dim 0.
+                                gain,
+                                false,  // We parallelize the batch instead.
+                                prefix,
+                                target,
+                                twiddle_cache);
+
+    // Transpose each group of the batch with dense loads of the input.
+    xT.compute_at(dftT, group)
+        .vectorize(n, std::min(N, target.natural_vector_size<float>()));
+
+    return dftT;
+}
+
+// Schedule f, a batch of 1D transforms of the given extent indexed by n,
+// batch, to compute the transposed stages fT one group of the batch at a time.
+template <typename FuncType>
+void schedule_batch(FuncType f,
+                    const vector<Func>& fT,
+                    int extent,
+                    int vector_width,
+                    bool parallel,
+                    const Target& target) {
+    Var n(f.args()[0]), b(f.args()[1]);
+    Var bo(b.name() + "o"), bi(b.name() + "i");
+
+    f.bound(n, 0, extent)
+        .split(b, bo, bi, vector_width, TailStrategy::GuardWithIf)
+        .vectorize(n, std::min(extent, target.natural_vector_size<float>()));
+    if (parallel) {
+        f.parallel(bo);
+    }
+    for (Func i : fT) {
+        i.compute_at(f, bo);
+    }
+}
+
+}  // namespace
+
+ComplexFunc fft1d_c2c(ComplexFunc x, int N, int sign,
+                      const Target& target,
+                      const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "c2c1d_" : desc.name + "_";
+
+    // Cache of twiddle factors for this FFT.
+    TwiddleFactorSet twiddle_cache;
+
+    const int vector_width = batch_vector_width(target, desc);
+    ComplexFunc dftT = fft1d_batch_T(x, radix_factor(N), sign, desc.gain,
+                                     vector_width, prefix, target, &twiddle_cache);
+
+    // Schedule the input, if requested.
+    if (desc.schedule_input) {
+        x.compute_at(dftT, group);
+    }
+
+    ComplexFunc dft = transpose(dftT);
+    schedule_batch(dft, { dftT }, N, vector_width, desc.parallel, target);
+
+    return dft;
+}
+
+// The 1D real FFTs below use the same relationships as the 2D real FFTs above,
+// but zip the even and odd samples of each real sequence x of length N into
+// one complex sequence z_m = x_(2m) + j x_(2m+1) of length M = N/2, rather than
+// zipping pairs of sequences. If E and O are the DFTs of the even and odd
+// samples of x, (3) and (4) give them from Z = DFT[z]:
+//
+//   E_k = (Z_k + (Z_(M-k))*)/2
+//   O_k = -j (Z_k - (Z_(M-k))*)/2
+//
+// and splitting the DFT of x into its even and odd samples gives:
+//
+//   X_k = E_k + W^k O_k,    W = e^(-2*pi*j/N)
+//
+// for 0 <= k <= M, which is all of X that isn't redundant. Inverting these
+// gives the zipped sequence Z = E + j O from X for the inverse FFT:
+//
+//   E_k = (X_k + (X_(M-k))*)/2
+//   O_k = (X_k - (X_(M-k))*) W^-k/2
+//
+// Either way, a real FFT costs a complex FFT of half the length, and the batch
+// is free to be vectorized, because each sequence is zipped with itself.
+
+ComplexFunc fft1d_r2c(Func r, int N,
+                      const Target& target,
+                      const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "r2c1d_" : desc.name + "_";
+
+    vector<Var> args(r.args());
+    Var n(args[0]), b(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    // Cache of twiddle factors for this FFT.
+    TwiddleFactorSet twiddle_cache;
+
+    const int vector_width = batch_vector_width(target, desc);
+
+    ComplexFunc dftT(prefix + "dftT");
+    vector<Func> stages;
+    if (N % 2 != 0) {
+        // There are no even and odd halves to zip together, so compute the
+        // complex DFT, and keep the half of it that isn't redundant.
+        ComplexFunc c(prefix + "complex");
+        c(A({n, b}, args)) = ComplexExpr(r(A({n, b}, args)), 0.0f);
+        dftT = fft1d_batch_T(c, radix_factor(N), -1, desc.gain,
+                             vector_width, prefix, target, &twiddle_cache);
+        stages.push_back(dftT);
+    } else {
+        const int M = N / 2;
+
+        // Zip the even and odd samples of each sequence into one complex
+        // sequence. See the comment above this function for more background.
+        ComplexFunc zipped(prefix + "zipped");
+        zipped(A({n, b}, args)) =
+            ComplexExpr(r(A({2 * n, b}, args)), r(A({2 * n + 1, b}, args)));
+
+        ComplexFunc ZT = fft1d_batch_T(zipped, radix_factor(M), -1, 1.0f,
+                                       vector_width, prefix, target, &twiddle_cache);
+
+        // Unzip the DFTs of the even and odd samples, and combine them. Rather
+        // than divide E and O by 2 here, adjust the gain instead.
+        ComplexFunc W = twiddle_factors(N, 1.0f, -1, prefix, &twiddle_cache);
+        ComplexExpr Z = ZT(A({b, n % M}, args));
+        ComplexExpr conjsymZ = conj(ZT(A({b, (M - n) % M}, args)));
+        ComplexExpr E = Z + conjsymZ;
+        ComplexExpr O = -j * (Z - conjsymZ);
+        dftT(A({b, n}, args)) = (E + W(n) * O) * (desc.gain / 2);
+
+        dftT.vectorize(b, vector_width, TailStrategy::RoundUp);
+        stages.push_back(ZT);
+        stages.push_back(dftT);
+    }
+
+    // Schedule the input, if requested.
+    if (desc.schedule_input) {
+        r.compute_at(stages.front(), group);
+    }
+
+    ComplexFunc dft = transpose(dftT);
+    schedule_batch(dft, stages, N / 2 + 1, vector_width, desc.parallel, target);
+
+    return dft;
+}
+
+Func fft1d_c2r(ComplexFunc c, int N,
+               const Target& target,
+               const Fft2dDesc& desc) {
+    string prefix = desc.name.empty() ? "c2r1d_" : desc.name + "_";
+
+    vector<Var> args(c.args());
+    Var n(args[0]), b(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    // Cache of twiddle factors for this FFT.
+    TwiddleFactorSet twiddle_cache;
+
+    const int vector_width = batch_vector_width(target, desc);
+
+    ComplexFunc dftT;
+    Func unzippedT(prefix + "unzippedT");
+    if (N % 2 != 0) {
+        // Construct the whole DFT domain via conjugate symmetry, and compute
+        // the complex inverse DFT.
+        ComplexFunc c_full(prefix + "c_full");
+        c_full(A({n, b}, args)) =
+            select(n <= N / 2,
+                   c(A({n, b}, args)),
+                   conj(c(A({min(N - n, N / 2), b}, args))));
+        dftT = fft1d_batch_T(c_full, radix_factor(N), 1, desc.gain,
+                             vector_width, prefix, target, &twiddle_cache);
+
+        unzippedT(A({b, n}, args)) = re(dftT(A({b, n}, args)));
+    } else {
+        const int M = N / 2;
+
+        // Zip the DFTs of the even and odd samples into one complex DFT. See
+        // the comment above fft1d_r2c for more background.
+        ComplexFunc W = twiddle_factors(N, 1.0f, 1, prefix, &twiddle_cache);
+        ComplexFunc zipped(prefix + "zipped"); {
+            ComplexExpr X = c(A({n, b}, args));
+            ComplexExpr conjsymX = conj(c(A({M - n, b}, args)));
+            ComplexExpr E = X + conjsymX;
+            ComplexExpr O = (X - conjsymX) * W(n);
+            // The missing factor of 1/2 makes the inverse DFT of length M
+            // produce the unnormalized inverse DFT of length N.
+            zipped(A({n, b}, args)) = E + j * O;
+        }
+
+        dftT = fft1d_batch_T(zipped, radix_factor(M), 1, desc.gain,
+                             vector_width, prefix, target, &twiddle_cache);
+
+        // Extract the even and odd samples.
+        ComplexExpr z = dftT(A({b, n / 2}, args));
+        unzippedT(A({b, n}, args)) = select(n % 2 == 0, re(z), im(z));
+    }
+
+    // Schedule the input, if requested.
+    if (desc.schedule_input) {
+        c.compute_at(dftT, group);
+    }
+
+    Func unzipped = transpose(unzippedT);
+    schedule_batch(unzipped, { dftT }, N, vector_width, desc.parallel, target);
+
+    return unzipped;
+}
@@ -27,7 +27,8 @@ struct Fft2dDesc {
 
     // The following option indicates that the FFT should parallelize within a
     // single FFT. This only makes sense to use on large FFTs, and generally only
-    // if there is no outer loop around FFTs that can be parallelized.
+    // if there is no outer loop around FFTs that can be parallelized. For a
+    // batch of 1D FFTs, this parallelizes across groups of the batch instead.
     bool parallel = false;
 
     // This option will schedule the input to the FFT at the innermost location
@@ -66,4 +67,31 @@ Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target& target,
                        const Fft2dDesc& desc = Fft2dDesc());
 
+// Compute the N point 1D complex DFTs of dimension 0 of a complex valued
+// function x, where dimension 1 of x indexes a batch of sequences. Dimension 0
+// of x should be defined on at least [0, N). The DFTs are vectorized across
+// groups of the batch, so x should also be defined beyond the end of the batch
+// (e.g. with a boundary condition), up to the next multiple of the vector
+// width. N does not need to be a power of two; it is factored into mixed
+// radices, though sizes with large prime factors are slow. There is no
+// normalization.
+ComplexFunc fft1d_c2c(ComplexFunc x, int N, int sign,
+                      const Halide::Target& target,
+                      const Fft2dDesc& desc = Fft2dDesc());
+
+// Compute the N point 1D DFTs of dimension 0 of a batch of real valued
+// sequences r, as in fft1d_c2c. The transform domain has extent N / 2 + 1 due
+// to the conjugate symmetry of real DFTs. When N is even, this computes one
+// complex DFT of length N / 2 per sequence. There is no normalization.
+ComplexFunc fft1d_r2c(Halide::Func r, int N,
+                      const Halide::Target& target,
+                      const Fft2dDesc& desc = Fft2dDesc());
+
+// Compute the real valued N point 1D inverse DFTs of dimension 0 of a batch of
+// DFTs c, as in fft1d_c2c. Dimension 0 of c should be defined on at least
+// [0, N / 2]. There is no normalization.
+Halide::Func fft1d_c2r(ComplexFunc c, int N,
+                       const Halide::Target& target,
+                       const Fft2dDesc& desc = Fft2dDesc());
+
 #endif
@@ -10,11 +10,18 @@
 #include "fft_inverse_c2r.h"
 #include "fft_forward_c2c.h"
 #include "fft_inverse_c2c.h"
+#include "fft_forward_r2c_1d_240.h"
+#include "fft_inverse_c2r_1d_240.h"
 
 namespace {
 const float kPi = 3.14159265358979310000f;
 
 const int32_t kSize = 16;
+
+// The size and batch of the 1D tests. The size is mixed radix, and the batch
+// is not a multiple of any vector width.
+const int32_t kSize1d = 240;
+const int32_t kBatch1d = 13;
 }
 
 using Halide::Runtime::Buffer;
@@ -292,5 +299,65 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Batched 1D forward real to complex test.
+    {
+        std::cout << "Batched 1D forward real to complex test." << std::endl;
+
+        auto in = Buffer<float, 3>::make_interleaved(kSize1d, kBatch1d, 1);
+        in.for_each_value([](float &x) {
+            x = (float)rand() / (float)RAND_MAX - 0.5f;
+        });
+
+        auto out = Buffer<float, 3>::make_interleaved(kSize1d / 2 + 1, kBatch1d, 2);
+
+        int halide_result;
+        halide_result = fft_forward_r2c_1d_240(in, out);
+        if (halide_result != 0) {
+            std::cerr << "fft_forward_r2c_1d_240 failed returning " << halide_result << std::endl;
+            exit(1);
+        }
+
+        // Compare against a direct DFT of each sequence.
+        for (int b = 0; b < kBatch1d; b++) {
+            for (int k = 0; k <= kSize1d / 2; k++) {
+                double real_expected = 0;
+                double imaginary_expected = 0;
+                for (int n = 0; n < kSize1d; n++) {
+                    double angle = -2 * kPi * ((k * n) % kSize1d) / kSize1d;
+                    real_expected += in(n, b, 0) * cos(angle);
+                    imaginary_expected += in(n, b, 0) * sin(angle);
+                }
+                if (fabs(re(out, k, b) - real_expected) > .001 ||
+                    fabs(im(out, k, b) - imaginary_expected) > .001) {
+                    std::cerr << "fft_forward_r2c_1d_240 mismatch at (" << k << ", " << b << ") "
+                              << re(out, k, b) << " + " << im(out, k, b) << "j vs. "
+                              << real_expected << " + " << imaginary_expected << "j" << std::endl;
+                    exit(1);
+                }
+            }
+        }
+
+        // The inverse should recover the input, scaled by the size.
+        std::cout << "Batched 1D inverse complex to real test." << std::endl;
+
+        auto round_trip = Buffer<float, 3>::make_interleaved(kSize1d, kBatch1d, 1);
+        halide_result = fft_inverse_c2r_1d_240(out, round_trip);
+        if (halide_result != 0) {
+            std::cerr << "fft_inverse_c2r_1d_240 failed returning " << halide_result << std::endl;
+            exit(1);
+        }
+
+        for (int b = 0; b < kBatch1d; b++) {
+            for (int n = 0; n < kSize1d; n++) {
+                float sample = round_trip(n, b, 0) / kSize1d;
+                if (fabs(sample - in(n, b, 0)) > .001) {
+                    std::cerr << "fft_inverse_c2r_1d_240 mismatch at (" << n << ", " << b << ") "
+                              << sample << " vs. " << in(n, b, 0) << std::endl;
+                    exit(1);
+                }
+            }
+        }
+    }
+
     exit(0);
 }
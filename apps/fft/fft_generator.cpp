@@ -64,7 +64,8 @@ public:
 
     // Size of first dimension, required to be greater than zero.
     GeneratorParam<int32_t> size0{"size0", 1};
-    // Size of second dimension, may be zero for 1D FFT.
+    // Size of second dimension, may be zero for 1D FFT. A 1D FFT transforms
+    // a batch of sequences, indexed by dimension 1 of the input and output.
     GeneratorParam<int32_t> size1{"size1", 0};
     // TODO(zalman): Add support for 3D and maybe 4D FFTs
 
@@ -80,6 +81,9 @@ public:
     // Dim0: extent = size0, stride = 2
     // Dim1: extent = size1, stride = size0 * 2
     // Dim2: extent = 2, stride = 1 (real followed by imaginary components)
+    //
+    // For a 1D FFT, Dim1 instead has the extent of the batch. The transform
+    // domain of a real FFT has extent size0 / 2 + 1 in Dim0.
     Input<Buffer<float>>  input{"input", 3};
     Output<Buffer<float>> output{"output", 3};
 
@@ -90,6 +94,7 @@ public:
 
         desc.gain = gain;
         desc.vector_width = vector_width;
+        desc.parallel = parallel;
 
         // The logic below calls the specialized r2c or c2r version if
         // applicable to take advantage of better scheduling. It is
@@ -98,27 +103,50 @@ public:
 
         const int sign = (direction == FFTDirection::SamplesToFrequency) ? -1 : 1;
 
+        // The 1D FFTs are computed in groups of the batch, which read past
+        // the end of the batch when its extent isn't a multiple of the group
+        // size.
+        const bool batched = (size1 == 0);
+        Expr in_y = y;
+        if (batched) {
+            in_y = clamp(y, input.dim(1).min(), input.dim(1).max());
+        }
+
         if (input_number_type == FFTNumberType::Real) {
             if (direction == FFTDirection::SamplesToFrequency) {
                 // TODO: Not sure why this is necessary as ImageParam
                 // -> Func conversion should happen, It may not work
                 // with implicit dimension (use of _) logic in FFT.
                 Func in;
-                in(x, y) = input(x, y, 0);
+                in(x, y) = input(x, in_y, 0);
 
-                complex_result = fft2d_r2c(in, size0, size1, target, desc);
+                if (batched) {
+                    complex_result = fft1d_r2c(in, size0, target, desc);
+                } else {
+                    complex_result = fft2d_r2c(in, size0, size1, target, desc);
+                }
             } else {
                 ComplexFunc in;
-                in(x, y) = ComplexExpr(input(x, y, 0), 0);
+                in(x, y) = ComplexExpr(input(x, in_y, 0), 0);
 
-                complex_result = fft2d_c2c(in, size0, size1, sign, target, desc);
+                if (batched) {
+                    complex_result = fft1d_c2c(in, size0, sign, target, desc);
+                } else {
+                    complex_result = fft2d_c2c(in, size0, size1, sign, target, desc);
+                }
             }
         } else {
             ComplexFunc in;
-            in(x, y) = ComplexExpr(input(x, y, 0), input(x, y, 1));
+            in(x, y) = ComplexExpr(input(x, in_y, 0), input(x, in_y, 1));
             if (output_number_type == FFTNumberType::Real &&
                 direction == FFTDirection::FrequencyToSamples) {
-                real_result = fft2d_c2r(in, size0, size1, target, desc);
+                if (batched) {
+                    real_result = fft1d_c2r(in, size0, target, desc);
+                } else {
+                    real_result = fft2d_c2r(in, size0, size1, target, desc);
+                }
+            } else if (batched) {
+                complex_result = fft1d_c2c(in, size0, sign, target, desc);
             } else {
                 complex_result = fft2d_c2c(in, size0, size1, sign, target, desc);
             }
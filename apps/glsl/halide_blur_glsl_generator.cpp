@@ -7,8 +7,6 @@ public:
     Input<Buffer<uint8_t>>  input8{"input8", 3};
     Output<Buffer<uint8_t>> blur_filter{"blur_filter", 3};
     void generate() {
-        assert(get_target().has_feature(Target::OpenGL));
-
         Func blur_x("blur_x"), blur_y("blur_y");
         Var x("x"), y("y"), c("c");
 
@@ -20,7 +18,8 @@ public:
         blur_y(x, y, c) = (blur_x(x, y, c) + blur_x(x, y+1, c) + blur_x(x, y+2, c)) / 3;
         blur_filter(x, y, c) = cast<uint8_t>(blur_y(x, y, c) * 255.f);
 
-        // Schedule for GLSL
+        // Schedule for GLSL. On targets without OpenGL this runs
+        // vectorized on the CPU instead.
         input8.dim(2).set_bounds(0, 3);
         blur_filter.bound(c, 0, 3);
         blur_filter.glsl(x, y, c);
@@ -7,7 +7,6 @@ public:
     Input<Buffer<uint8_t>>  input8{"input8", 3};
     Output<Buffer<uint8_t>> out{"out", 3};
     void generate() {
-        assert(get_target().has_feature(Target::OpenGL));
         Var x("x"), y("y"), c("c");
 
         // The algorithm
@@ -29,7 +28,8 @@ public:
                                             c == 2, Cr(x,y),
                                             0.0f) * 255.f);
 
-        // Schedule for GLSL
+        // Schedule for GLSL. On targets without OpenGL this runs
+        // vectorized on the CPU instead.
         input8.dim(2).set_bounds(0, 3);
         out.bound(c, 0, 3);
         out.glsl(x, y, c);
@@ -59,6 +59,9 @@ int main(int argc, char **argv) {
         // pipeline, power it on once now. Also, set Hexagon performance to turbo.
         halide_hexagon_set_performance_mode(NULL, halide_hexagon_power_turbo);
         halide_hexagon_power_hvx_on(NULL);
+        // Run the iterations in a session, so they don't each pay
+        // for an RPC call.
+        halide_hexagon_start_session(NULL);
 #endif
 
         double time = Halide::Tools::benchmark(iterations, 10, [&]() {
@@ -72,6 +75,7 @@ int main(int argc, char **argv) {
 #ifdef HALIDE_RUNTIME_HEXAGON
         // We're done with HVX, power it off, and reset the performance mode
         // to default to save power.
+        halide_hexagon_end_session(NULL);
         halide_hexagon_power_hvx_off(NULL);
         halide_hexagon_set_performance_mode(NULL, halide_hexagon_power_default);
 #endif
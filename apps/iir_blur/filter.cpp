@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "iir_blur.h"
+#include "fir_blur.h"
+
+#include "halide_benchmark.h"
+#include "HalideBuffer.h"
+#include "halide_image_io.h"
+
+using namespace Halide::Runtime;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        printf("Usage: ./filter input.png output.png sigma timing_iterations\n"
+               "e.g. ./filter input.png output.png 16 10\n");
+        return 0;
+    }
+
+    Buffer<float> input = load_and_convert_image(argv[1]);
+    float sigma = (float) atof(argv[3]);
+    int timing_iterations = atoi(argv[4]);
+
+    Buffer<float> output(input.width(), input.height(), input.channels());
+    Buffer<float> fir_output(input.width(), input.height(), input.channels());
+
+    iir_blur(input, sigma, output);
+    fir_blur(input, sigma, fir_output);
+
+    // Timing code. Timing doesn't include copying the input data to
+    // the gpu or copying the output back.
+    double t_iir = benchmark(timing_iterations, 10, [&]() {
+        iir_blur(input, sigma, output);
+        output.device_sync();
+    });
+    printf("Recursive (IIR) time: %gms\n", t_iir * 1e3);
+
+    double t_fir = benchmark(timing_iterations, 10, [&]() {
+        fir_blur(input, sigma, fir_output);
+        fir_output.device_sync();
+    });
+    printf("Separable FIR time: %gms\n", t_fir * 1e3);
+
+    output.copy_to_host();
+    fir_output.copy_to_host();
+    float max_diff = 0.0f;
+    output.for_each_element([&](int x, int y, int c) {
+        max_diff = std::max(max_diff, std::abs(output(x, y, c) - fir_output(x, y, c)));
+    });
+    printf("Largest difference between the two: %g\n", max_diff);
+
+    convert_and_save_image(output, argv[2]);
+
+    return 0;
+}
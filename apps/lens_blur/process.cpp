@@ -31,19 +31,23 @@ int main(int argc, char **argv) {
               aperture_samples, output);
 
     // Timing code
+    BenchmarkConfig config;
+    config.min_samples = timing_iterations;
 
     // Manually-tuned version
-    double min_t_manual = benchmark(timing_iterations, 10, [&]() {
+    config.name = "lens_blur_manual";
+    double min_t_manual = benchmark([&]() {
         lens_blur(left_im, right_im, slices, focus_depth, blur_radius_scale,
                   aperture_samples, output);
-    });
+    }, config);
     printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
 
     // Auto-scheduled version
-    double min_t_auto = benchmark(timing_iterations, 10, [&]() {
+    config.name = "lens_blur_auto";
+    double min_t_auto = benchmark([&]() {
         lens_blur_auto_schedule(left_im, right_im, slices, focus_depth,
                                 blur_radius_scale, aperture_samples, output);
-    });
+    }, config);
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
     convert_and_save_image(output, argv[7]);
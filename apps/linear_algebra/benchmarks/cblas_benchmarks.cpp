@@ -27,6 +27,9 @@ extern "C" {
 #elif defined(USE_OPENBLAS)
 # define BLAS_NAME "OpenBLAS"
 # include <cblas.h>
+#elif defined(USE_MKL)
+# define BLAS_NAME "MKL"
+# include <mkl_cblas.h>
 #elif defined(USE_CBLAS)
 # define BLAS_NAME "CBlas"
 extern "C" {
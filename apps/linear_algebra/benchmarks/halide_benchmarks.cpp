@@ -8,17 +8,90 @@
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
 //    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    Sparse: spmv, spmm
+//    Batched: gemm_batched, gemm_looped
+//
+// The sparse benchmarks use a random size x size CSR matrix whose row
+// lengths follow a power law, averaging 16 nonzeros per row, so a few
+// rows are much longer than the rest. spmm multiplies it by a dense
+// matrix with 64 columns.
+//
+// The batched benchmarks multiply a batch of size x size matrices,
+// with enough of them to make up 4M elements per operand.
+// gemm_batched does it in one call with the batch interleaved, and
+// gemm_looped calls gemm once per matrix, for comparison.
 //
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <random>
 #include <string>
+#include <vector>
 #include "HalideBuffer.h"
 #include "halide_blas.h"
 #include "clock.h"
 #include "macros.h"
 
+#define SPMM_WIDTH 64
+
+#define SparseGFLOPS(nnz, width) 2.0 * nnz * width * 1e-3 / elapsed
+#define SparseBenchmark(benchmark, type, width, code)                   \
+    virtual void bench_##benchmark(int N) {                             \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        CSRMatrix A(random_csr(N));                                     \
+        Vector x(random_vector(N));                                     \
+        Vector y(random_vector(N));                                     \
+        Matrix B(random_dense(width, N));                               \
+        Matrix C(random_dense(width, N));                               \
+        (void) x;                                                       \
+        (void) y;                                                       \
+        (void) B;                                                       \
+        (void) C;                                                       \
+                                                                        \
+        time_it(code)                                                   \
+                                                                        \
+        std::cout << std::setw(8) << name                               \
+                  << std::setw(15) << type << #benchmark                \
+                  << std::setw(8) << std::to_string(N)                  \
+                  << std::setw(20) << std::to_string(elapsed)           \
+                  << std::setw(20) << SparseGFLOPS(A.nnz(), width)      \
+                  << std::endl;                                         \
+    }
+
+#define BATCHED_GEMM_ELEMENTS (1 << 22)
+
+#define BatchedGFLOPS(N, batch) 2.0 * N * N * N * batch * 1e-3 / elapsed
+#define BatchedBenchmark(benchmark, type, code)                         \
+    virtual void bench_##benchmark(int N) {                             \
+        Scalar alpha = random_scalar();                                 \
+        Scalar beta = random_scalar();                                  \
+        int batch = BATCHED_GEMM_ELEMENTS / (N * N);                    \
+        Matrix A(random_batch(N, batch));                               \
+        Matrix B(random_batch(N, batch));                               \
+        Matrix C(random_batch(N, batch));                               \
+        std::vector<Matrix> As, Bs, Cs;                                 \
+        Matrix A_planar(random_dense(N * N, batch));                    \
+        Matrix B_planar(random_dense(N * N, batch));                    \
+        Matrix C_planar(random_dense(N * N, batch));                    \
+        for (int n = 0; n < batch; n++) {                               \
+            As.push_back(slice_matrix(A_planar, N, n));                 \
+            Bs.push_back(slice_matrix(B_planar, N, n));                 \
+            Cs.push_back(slice_matrix(C_planar, N, n));                 \
+        }                                                               \
+                                                                        \
+        time_it(code)                                                   \
+                                                                        \
+        std::cout << std::setw(8) << name                               \
+                  << std::setw(15) << type << #benchmark                \
+                  << std::setw(8) << std::to_string(N)                  \
+                  << std::setw(20) << std::to_string(elapsed)           \
+                  << std::setw(20) << BatchedGFLOPS(N, batch)           \
+                  << std::endl;                                         \
+    }
+
 template<class T>
 struct BenchmarksBase {
     typedef T Scalar;
@@ -53,6 +126,60 @@ struct BenchmarksBase {
         return buff;
     }
 
+    Matrix random_dense(int width, int N) {
+        Matrix buff(width, N);
+        Scalar *A = (Scalar*)buff.data();
+        for (int i=0; i<width*N; ++i) {
+            A[i] = random_scalar();
+        }
+        return buff;
+    }
+
+    // A batch of N x N matrices, with the batch interleaved.
+    Matrix random_batch(int N, int batch) {
+        Matrix buff(batch, N, N);
+        Scalar *A = (Scalar*)buff.data();
+        for (int i=0; i<batch*N*N; ++i) {
+            A[i] = random_scalar();
+        }
+        return buff;
+    }
+
+    // The n'th N x N matrix of a batch stored one matrix per row.
+    Matrix slice_matrix(Matrix batch, int N, int n) {
+        halide_dimension_t shape[] = {{0, N, 1}, {0, N, N}};
+        return Matrix(&batch(0, n), 2, shape);
+    }
+
+    struct CSRMatrix {
+        Halide::Runtime::Buffer<int> row_ptr, col_idx;
+        Vector values;
+
+        int nnz() const { return values.width(); }
+    };
+
+    CSRMatrix random_csr(int N) {
+        std::uniform_real_distribution<double> uniform_dist(0.0, 1.0);
+        std::uniform_int_distribution<int> col_dist(0, N - 1);
+        CSRMatrix A;
+        A.row_ptr = Halide::Runtime::Buffer<int>(N + 1);
+        A.row_ptr(0) = 0;
+        for (int i = 0; i < N; i++) {
+            // A power law with exponent 4/3; the mean length is 16.
+            double u = std::max(uniform_dist(rand_eng), 1e-12);
+            int len = std::min(N, (int)(4 * std::pow(u, -0.75)));
+            A.row_ptr(i + 1) = A.row_ptr(i) + len;
+        }
+        int nnz = A.row_ptr(N);
+        A.col_idx = Halide::Runtime::Buffer<int>(nnz);
+        A.values = Vector(nnz);
+        for (int k = 0; k < nnz; k++) {
+            A.col_idx(k) = col_dist(rand_eng);
+            A.values(k) = random_scalar();
+        }
+        return A;
+    }
+
     BenchmarksBase(std::string n) : name(n) {}
 
     void run(std::string benchmark, int size) {
@@ -80,6 +207,14 @@ struct BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "spmv") {
+            bench_spmv(size);
+        } else if (benchmark == "spmm") {
+            bench_spmm(size);
+        } else if (benchmark == "gemm_batched") {
+            bench_gemm_batched(size);
+        } else if (benchmark == "gemm_looped") {
+            bench_gemm_looped(size);
         }
     }
 
@@ -95,6 +230,10 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) =0;
     virtual void bench_gemm_transB(int N) =0;
     virtual void bench_gemm_transAB(int N) =0;
+    virtual void bench_spmv(int N) =0;
+    virtual void bench_spmm(int N) =0;
+    virtual void bench_gemm_batched(int N) =0;
+    virtual void bench_gemm_looped(int N) =0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -130,6 +269,19 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
 
     L3Benchmark(gemm_transAB, "s", halide_sgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    SparseBenchmark(spmv, "s", 1, halide_sspmv(alpha, A.row_ptr.raw_buffer(), A.col_idx.raw_buffer(),
+                                                 A.values.raw_buffer(), x.raw_buffer(), beta, y.raw_buffer()))
+
+    SparseBenchmark(spmm, "s", SPMM_WIDTH, halide_sspmm(alpha, A.row_ptr.raw_buffer(), A.col_idx.raw_buffer(),
+                                                          A.values.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()))
+
+    BatchedBenchmark(gemm_batched, "s", halide_sgemm_batched(alpha, A.raw_buffer(), B.raw_buffer(),
+                                                               beta, C.raw_buffer()))
+
+    BatchedBenchmark(gemm_looped, "s", for (int n = 0; n < batch; n++) {
+            halide_sgemm(false, false, alpha, As[n].raw_buffer(), Bs[n].raw_buffer(), beta, Cs[n].raw_buffer());
+        })
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -165,6 +317,19 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
 
     L3Benchmark(gemm_transAB, "d", halide_dgemm(true, true, alpha, A.raw_buffer(),
                                                 B.raw_buffer(), beta, C.raw_buffer()))
+
+    SparseBenchmark(spmv, "d", 1, halide_dspmv(alpha, A.row_ptr.raw_buffer(), A.col_idx.raw_buffer(),
+                                                 A.values.raw_buffer(), x.raw_buffer(), beta, y.raw_buffer()))
+
+    SparseBenchmark(spmm, "d", SPMM_WIDTH, halide_dspmm(alpha, A.row_ptr.raw_buffer(), A.col_idx.raw_buffer(),
+                                                          A.values.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()))
+
+    BatchedBenchmark(gemm_batched, "d", halide_dgemm_batched(alpha, A.raw_buffer(), B.raw_buffer(),
+                                                               beta, C.raw_buffer()))
+
+    BatchedBenchmark(gemm_looped, "d", for (int n = 0; n < batch; n++) {
+            halide_dgemm(false, false, alpha, As[n].raw_buffer(), Bs[n].raw_buffer(), beta, Cs[n].raw_buffer());
+        })
 };
 
 int main(int argc, char* argv[]) {
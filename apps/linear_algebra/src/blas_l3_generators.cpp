@@ -66,14 +66,21 @@ class GEMMGenerator :
 
         A(i, j) = As(i % s, j, i / s);
 
+        Var k("k"), ko("ko"), ki("ki");
+        Func Bs("Bs");
         Btmp(i, j) = (*B_in)(i, j);
         if (transpose_B) {
             B(i, j) = Btmp(j, i);
         } else {
-            B(i, j) = Btmp(i, j);
+            // Swizzle B into panels of 4 columns, so that the 4
+            // values the inner loop broadcasts are adjacent in
+            // memory. The last panel is padded by repeating the last
+            // column; those values never reach the output.
+            Expr last_col = B_in->dim(1).extent() - 1;
+            Bs(ji, k, jo) = Btmp(k, min(jo*4 + ji, last_col));
+            B(i, j) = Bs(j % 4, i, j / 4);
         }
 
-        Var k("k");
         Func prod;
         // Express all the products we need to do a matrix multiply as a 3D Func.
         prod(k, i, j) = A(i, k) * B(k, j);
@@ -136,9 +143,14 @@ class GEMMGenerator :
                 .compute_at(B, i)
                 .vectorize(i)
                 .unroll(j);
+        } else {
+            Bs.compute_at(result_, t)
+                .bound_extent(ji, 4)
+                .split(k, ko, ki, vec, TailStrategy::GuardWithIf)
+                .reorder(ji, ki, ko, jo)
+                .unroll(ji).vectorize(ki);
         }
 
-
         AB.compute_at(result_, i)
             .bound_extent(j, 4).unroll(j)
             .bound_extent(i, s).vectorize(i)
@@ -158,7 +170,102 @@ class GEMMGenerator :
     }
 };
 
+// Generator class for gemm over a batch of many small, independent
+// matrices. The batch is stored interleaved: the innermost dimension
+// of every buffer indexes the matrix, so the same element of each
+// matrix in the batch is contiguous in memory. That lets us vectorize
+// across matrices rather than within one, which keeps the vector
+// lanes full however small the matrices are.
+template<class T>
+class BatchedGEMMGenerator :
+        public Generator<BatchedGEMMGenerator<T>> {
+  public:
+    typedef Generator<BatchedGEMMGenerator<T>> Base;
+    using Base::target;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+
+    // Standard ordering of parameters in GEMM functions.
+    Input<T>         a_ = {"a_", 1};
+    Input<Buffer<T>> A_ = {"A_", 3};
+    Input<Buffer<T>> B_ = {"B_", 3};
+    Input<T>         b_ = {"b_", 1};
+    Input<Buffer<T>> C_ = {"C_", 3};
+
+    Output<Buffer<T>> result_ = {"result", 3};
+
+    void generate() {
+        // Each matrix is column-major, as for GEMMGenerator, with the
+        // batch index in front: A_(n, i, k) is row i, column k of
+        // the n'th matrix.
+        const Expr batch_size = A_.dim(0).extent();
+        const Expr num_rows = A_.dim(1).extent();
+        const Expr sum_size = A_.dim(2).extent();
+        const Expr num_cols = B_.dim(2).extent();
+
+        const int vec = natural_vector_size(a_.type());
+
+        // The size of the register tile of accumulators.
+        const int tile_rows = 4, tile_cols = 2;
+
+        Var n("n"), i("i"), j("j"), k("k");
+        Var no("no"), ni("ni"), io("io"), ii("ii"), jo("jo"), ji("ji");
+
+        // The register tile may hang off the edge of the matrix, so
+        // clamp the rows of A and the columns of B it reads.
+        Func A("A"), B("B");
+        A(n, i, k) = A_(n, min(i, num_rows - 1), k);
+        B(n, k, j) = B_(n, k, min(j, num_cols - 1));
+
+        Func prod("prod");
+        RDom rv(0, sum_size);
+        prod(n, i, j) = cast<T>(0);
+        prod(n, i, j) += A(n, i, rv) * B(n, rv, j);
+
+        result_(n, i, j) = a_ * prod(n, i, j) + b_ * C_(n, i, j);
+
+        // Walk each matrix in small tiles. Within a tile, every A
+        // and B value loaded is used by several independent
+        // accumulators.
+        result_
+            .tile(i, j, io, jo, ii, ji, tile_rows, tile_cols, TailStrategy::GuardWithIf)
+            .reorder(ii, ji, io, jo, n)
+            .unroll(ii).unroll(ji);
+
+        // If there are at least a vector's worth of matrices, do one
+        // vector of them at a time, and parallelize over groups of
+        // those.
+        result_.specialize(batch_size >= vec)
+            .split(n, no, ni, vec)
+            .reorder(ni, ii, ji, io, jo, no)
+            .vectorize(ni)
+            .parallel(no, 8, TailStrategy::GuardWithIf);
+
+        prod.compute_at(result_, io)
+            .bound_extent(i, tile_rows).bound_extent(j, tile_cols)
+            .unroll(i).unroll(j);
+        prod.specialize(batch_size >= vec).vectorize(n, vec);
+        prod.update()
+            .reorder(n, i, j, rv)
+            .unroll(i).unroll(j);
+        prod.update().specialize(batch_size >= vec).vectorize(n, vec);
+
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_min(0);
+        B_.dim(0).set_bounds(0, batch_size).dim(1).set_bounds(0, sum_size).dim(2).set_min(0);
+        C_.dim(0).set_bounds(0, batch_size);
+        C_.dim(1).set_bounds(0, num_rows);
+        C_.dim(2).set_bounds(0, num_cols);
+        result_.dim(0).set_bounds(0, batch_size);
+        result_.dim(1).set_bounds(0, num_rows);
+        result_.dim(2).set_bounds(0, num_cols);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<double>, dgemm_batched)
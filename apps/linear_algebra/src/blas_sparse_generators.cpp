@@ -0,0 +1,203 @@
+#include <vector>
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+// Shared machinery for products of a sparse matrix in CSR form with a
+// dense operand. Row i of the matrix has its nonzeros at positions
+// [row_ptr(i), row_ptr(i + 1)) of col_idx and values.
+//
+// The rows are divided into tasks holding about the same number of
+// nonzeros, rather than the same number of rows, by binary searching
+// row_ptr for multiples of nnz / tasks. The loops over the rows of a
+// task and over the nonzeros of a row have data-dependent extents:
+// they're written as reduction domains over an upper bound, with
+// predicates that the loop trimming pass turns into the real bounds.
+template<class T, class Derived>
+class CSRGenerator : public Generator<Derived> {
+  public:
+    typedef Generator<Derived> Base;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+
+    GeneratorParam<bool> vectorize_ = {"vectorize", true};
+    GeneratorParam<bool> parallel_ = {"parallel", true};
+    GeneratorParam<int>  tasks_ = {"tasks", 64};
+
+    Input<T>             a_ = {"a", 1};
+    Input<Buffer<int>>   row_ptr_ = {"row_ptr", 1};
+    Input<Buffer<int>>   col_idx_ = {"col_idx", 1};
+    Input<Buffer<T>>     values_ = {"values", 1};
+
+  protected:
+    Expr rows() {
+        return row_ptr_.dim(0).extent() - 1;
+    }
+
+    Expr nnz() {
+        return values_.dim(0).extent();
+    }
+
+    // The first row of each task. Task t starts at the first row
+    // whose nonzeros begin at or after t * nnz / tasks, and the final
+    // entry is the number of rows.
+    Func task_rows() {
+        Var t("t");
+        Expr target = cast<int>(cast<int64_t>(nnz()) * t / tasks_);
+
+        Func search("row_search");
+        search(t) = Tuple(0, rows());
+        for (int step = 0; step < 32; step++) {
+            Expr lo = search(t)[0], hi = search(t)[1];
+            Expr mid = (lo + hi) / 2;
+            Expr go_right = row_ptr_(clamp(mid, 0, rows())) < target;
+            search(t) = Tuple(select(lo < hi && go_right, mid + 1, lo),
+                              select(lo < hi && !go_right, mid, hi));
+        }
+
+        Func task_rows("task_rows");
+        task_rows(t) = select(t >= tasks_, rows(), search(t)[0]);
+        task_rows.compute_root();
+        return task_rows;
+    }
+
+    // A reduction domain over the nonzeros of the matrix, with rt.x
+    // the task, rt.y the row within the task, and rt.z the nonzero
+    // within the row. row and k are the row and nonzero it refers to.
+    RDom csr_domain(Func task_rows, Expr &row, Expr &k) {
+        RDom r(0, tasks_, 0, rows(), 0, nnz(), "r");
+        Expr first_row = task_rows(r.x);
+        Expr num_rows = task_rows(r.x + 1) - first_row;
+        row = clamp(first_row + r.y, 0, rows() - 1);
+        Expr start = row_ptr_(row);
+        Expr len = row_ptr_(row + 1) - start;
+        k = clamp(start + r.z, 0, nnz() - 1);
+        r.where(r.y < num_rows);
+        r.where(r.z < len);
+        return r;
+    }
+
+    void constrain_csr() {
+        row_ptr_.dim(0).set_min(0);
+        col_idx_.dim(0).set_bounds(0, nnz());
+        values_.dim(0).set_min(0);
+    }
+};
+
+// Generator class for sparse matrix-vector products,
+// y = a * A * x + b * y for a CSR matrix A.
+template<class T>
+class SPMVGenerator : public CSRGenerator<T, SPMVGenerator<T>> {
+  public:
+    typedef CSRGenerator<T, SPMVGenerator<T>> Base;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+    using Base::vectorize_;
+    using Base::parallel_;
+    using Base::a_;
+    using Base::col_idx_;
+    using Base::values_;
+
+    Input<Buffer<T>> x_ = {"x", 1};
+    Input<T>         b_ = {"b", 1};
+    Input<Buffer<T>> y_ = {"y", 1};
+
+    Output<Buffer<T>> output_ = {"output", 1};
+
+    void generate() {
+        const int vec_size = vectorize_ ? natural_vector_size(type_of<T>()) : 1;
+        const Expr rows = this->rows();
+        const Expr cols = x_.dim(0).extent();
+
+        Var i("i"), ii("ii");
+        Func task_rows = this->task_rows();
+
+        Expr row, k;
+        RDom r = this->csr_domain(task_rows, row, k);
+
+        output_(i) = b_ * y_(i);
+        output_(row) += a_ * values_(k) * x_(clamp(col_idx_(k), 0, cols - 1));
+
+        output_.specialize(rows >= vec_size).vectorize(i, vec_size);
+        if (parallel_) {
+            // The tasks write disjoint ranges of rows.
+            output_.update().allow_race_conditions().parallel(r.x);
+        }
+
+        this->constrain_csr();
+        x_.dim(0).set_min(0);
+        y_.dim(0).set_bounds(0, rows);
+        output_.dim(0).set_bounds(0, rows);
+    }
+};
+
+// Generator class for products of a sparse matrix with a dense one,
+// C = a * A * B + b * C for a CSR matrix A. B and C are stored with
+// their columns innermost, so each nonzero of A scales a contiguous
+// row of B, and that work is vectorized.
+template<class T>
+class SPMMGenerator : public CSRGenerator<T, SPMMGenerator<T>> {
+  public:
+    typedef CSRGenerator<T, SPMMGenerator<T>> Base;
+    using Base::natural_vector_size;
+    template<typename T2> using Input = typename Base::template Input<T2>;
+    template<typename T2> using Output = typename Base::template Output<T2>;
+    using Base::vectorize_;
+    using Base::parallel_;
+    using Base::a_;
+    using Base::col_idx_;
+    using Base::values_;
+
+    Input<Buffer<T>> B_ = {"B", 2};
+    Input<T>         b_ = {"b", 1};
+    Input<Buffer<T>> C_ = {"C", 2};
+
+    Output<Buffer<T>> output_ = {"output", 2};
+
+    void generate() {
+        const int vec_size = vectorize_ ? natural_vector_size(type_of<T>()) : 1;
+        const Expr rows = this->rows();
+        const Expr width = B_.dim(0).extent();
+        const Expr cols = B_.dim(1).extent();
+
+        Var j("j"), i("i"), ji("ji");
+        Func task_rows = this->task_rows();
+
+        Expr row, k;
+        RDom r = this->csr_domain(task_rows, row, k);
+
+        output_(j, i) = b_ * C_(j, i);
+        output_(j, row) += a_ * values_(k) * B_(j, clamp(col_idx_(k), 0, cols - 1));
+
+        output_.specialize(width >= vec_size).vectorize(j, vec_size);
+        output_.update().reorder(j, r.z, r.y, r.x);
+        if (vectorize_) {
+            output_.update()
+                .specialize(width >= 4 * vec_size)
+                .split(j, j, ji, 4 * vec_size)
+                .reorder(ji, r.z, j, r.y, r.x)
+                .vectorize(ji, vec_size)
+                .unroll(ji);
+            output_.update().specialize(width >= vec_size).vectorize(j, vec_size);
+        }
+        if (parallel_) {
+            // The tasks write disjoint ranges of rows.
+            output_.update().allow_race_conditions().parallel(r.x);
+            output_.parallel(i, 8);
+        }
+
+        this->constrain_csr();
+        B_.dim(0).set_min(0).dim(1).set_min(0);
+        C_.dim(0).set_bounds(0, width).dim(1).set_bounds(0, rows);
+        output_.dim(0).set_bounds(0, width).dim(1).set_bounds(0, rows);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(SPMVGenerator<float>, sspmv)
+HALIDE_REGISTER_GENERATOR(SPMVGenerator<double>, dspmv)
+HALIDE_REGISTER_GENERATOR(SPMMGenerator<float>, sspmm)
+HALIDE_REGISTER_GENERATOR(SPMMGenerator<double>, dspmm)
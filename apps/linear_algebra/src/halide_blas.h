@@ -28,6 +28,12 @@
 #include "halide_dgemm_transB.h"
 #include "halide_sgemm_transAB.h"
 #include "halide_dgemm_transAB.h"
+#include "halide_sgemm_batched_impl.h"
+#include "halide_dgemm_batched_impl.h"
+#include "halide_sspmv_impl.h"
+#include "halide_dspmv_impl.h"
+#include "halide_sspmm_impl.h"
+#include "halide_dspmm_impl.h"
 
 inline int halide_scopy(halide_buffer_t *x, halide_buffer_t *y) {
     return halide_scopy_impl(0, x, nullptr, y);
@@ -103,6 +109,41 @@ inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A,
     return -1;
 }
 
+// Batched gemm, C = a * A * B + b * C for every matrix in a batch of
+// small ones. The buffers are three dimensional with the batch
+// interleaved: A(n, i, k) is row i, column k of the n'th matrix.
+inline int halide_sgemm_batched(float a, halide_buffer_t *A, halide_buffer_t *B, float b, halide_buffer_t *C) {
+    return halide_sgemm_batched_impl(a, A, B, b, C, C);
+}
+
+inline int halide_dgemm_batched(double a, halide_buffer_t *A, halide_buffer_t *B, double b, halide_buffer_t *C) {
+    return halide_dgemm_batched_impl(a, A, B, b, C, C);
+}
+
+// Sparse products with a CSR matrix A, given by its row_ptr, col_idx
+// and values arrays. spmv computes y = a * A * x + b * y, and spmm
+// computes C = a * A * B + b * C, where B and C are stored with their
+// columns innermost.
+inline int halide_sspmv(float a, halide_buffer_t *row_ptr, halide_buffer_t *col_idx, halide_buffer_t *values,
+                        halide_buffer_t *x, float b, halide_buffer_t *y) {
+    return halide_sspmv_impl(a, row_ptr, col_idx, values, x, b, y, y);
+}
+
+inline int halide_dspmv(double a, halide_buffer_t *row_ptr, halide_buffer_t *col_idx, halide_buffer_t *values,
+                        halide_buffer_t *x, double b, halide_buffer_t *y) {
+    return halide_dspmv_impl(a, row_ptr, col_idx, values, x, b, y, y);
+}
+
+inline int halide_sspmm(float a, halide_buffer_t *row_ptr, halide_buffer_t *col_idx, halide_buffer_t *values,
+                        halide_buffer_t *B, float b, halide_buffer_t *C) {
+    return halide_sspmm_impl(a, row_ptr, col_idx, values, B, b, C, C);
+}
+
+inline int halide_dspmm(double a, halide_buffer_t *row_ptr, halide_buffer_t *col_idx, halide_buffer_t *values,
+                        halide_buffer_t *B, double b, halide_buffer_t *C) {
+    return halide_dspmm_impl(a, row_ptr, col_idx, values, B, b, C, C);
+}
+
 enum HBLAS_ORDER {HblasRowMajor=101, HblasColMajor=102};
 enum HBLAS_TRANSPOSE {HblasNoTrans=111, HblasTrans=112, HblasConjTrans=113};
 enum HBLAS_UPLO {HblasUpper=121, HblasLower=122};
@@ -108,14 +108,25 @@ public:
             Var xi, yi;
             output.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
             for (int j = 0; j < J; j++) {
+                // Each level is a quarter of the size of the one above,
+                // so use smaller tiles on the coarse levels to keep
+                // enough blocks in flight.
                 int blockw = 16, blockh = 8;
                 if (j > 3) {
-                    blockw = 2;
-                    blockh = 2;
+                    blockw = 8;
+                    blockh = 8;
                 }
                 if (j > 0) {
                     inGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
                     gPyramid[j].compute_root().reorder(k, x, y).gpu_tile(x, y, xi, yi, blockw, blockh);
+                    // Each downsampled value reads a 4x4 window of the
+                    // level above, and neighboring values share most of
+                    // it, so stage the tile a block reads in shared
+                    // memory. For the first level this also computes
+                    // the inlined gray and remapped values once per
+                    // tile instead of once per tap.
+                    inGPyramid[j-1].in(inGPyramid[j]).compute_at(inGPyramid[j], x).gpu_threads(x, y);
+                    gPyramid[j-1].in(gPyramid[j]).compute_at(gPyramid[j], x).reorder(k, x, y).gpu_threads(x, y);
                 }
                 outGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
             }
@@ -31,18 +31,22 @@ int main(int argc, char **argv) {
     local_laplacian(input, levels, alpha/(levels-1), beta, output);
 
     // Timing code
+    BenchmarkConfig config;
+    config.min_samples = timing;
 
     // Manually-tuned version
-    double best_manual = benchmark(timing, 1, [&]() {
+    config.name = "local_laplacian_manual";
+    double best_manual = benchmark([&]() {
         local_laplacian(input, levels, alpha/(levels-1), beta, output);
-    });
+    }, config);
     printf("Manually-tuned time: %gms\n", best_manual * 1e3);
 
     #ifndef NO_AUTO_SCHEDULE
     // Auto-scheduled version
-    double best_auto = benchmark(timing, 1, [&]() {
+    config.name = "local_laplacian_auto";
+    double best_auto = benchmark([&]() {
         local_laplacian_auto_schedule(input, levels, alpha/(levels-1), beta, output);
-    });
+    }, config);
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
     #endif
 
@@ -132,6 +132,152 @@ public:
     }
 };
 
+// The same filter, but with the patch differences computed from a
+// summed-area table of each difference image instead of by blurring
+// it. Each search offset then costs a constant amount of work per
+// pixel, whatever the patch size.
+class NonLocalMeansIntegral : public Halide::Generator<NonLocalMeansIntegral> {
+public:
+    Input<Buffer<float>>  input{"input", 3};
+    Input<int>            patch_size{"patch_size"};
+    Input<int>            search_area{"search_area"};
+    Input<float>          sigma{"sigma"};
+
+    Output<Buffer<float>> non_local_means{"non_local_means", 3};
+
+    void generate() {
+        /* THE ALGORITHM */
+
+        Var x("x"), y("y"), c("c");
+
+        Expr inv_sigma_sq = -1.0f/(sigma*sigma*patch_size*patch_size);
+
+        // Add a boundary condition
+        Func clamped = BoundaryConditions::repeat_edge(input);
+
+        // Define the difference images, summed across color channels
+        Var dx("dx"), dy("dy");
+        Expr diff = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            diff += pow(clamped(x, y, i) - clamped(x + dx, y + dy, i), 2);
+        }
+        Func d("d");
+        d(x, y, dx, dy) = diff;
+
+        // The patch around (x, y) covers [x + lo, x + hi] x [y + lo, y + hi].
+        Expr lo = -(patch_size/2);
+        Expr hi = lo + patch_size - 1;
+
+        // The summed-area table of each difference image, over the
+        // output padded by the patch size so every patch of an output
+        // pixel falls inside it. The corners outside the scanned
+        // region wouldn't hold sums, so this must follow the output
+        // rather than the input, which may be smaller. The sums of
+        // small differences over a whole image lose too much precision
+        // in single-precision floats, so the table is kept in doubles.
+        Expr x_min = non_local_means.dim(0).min() + lo - 1;
+        Expr x_extent = non_local_means.dim(0).extent() + patch_size;
+        Expr y_min = non_local_means.dim(1).min() + lo - 1;
+        Expr y_extent = non_local_means.dim(1).extent() + patch_size;
+
+        Func integral("integral");
+        integral(x, y, dx, dy) = cast<double>(d(x, y, dx, dy));
+        RDom rx(x_min + 1, x_extent - 1);
+        integral(rx, y, dx, dy) += integral(rx - 1, y, dx, dy);
+        RDom ry(y_min + 1, y_extent - 1);
+        integral(x, ry, dx, dy) += integral(x, ry - 1, dx, dy);
+
+        // Find the patch differences from four corners of the table
+        Func blur_d("blur_d");
+        blur_d(x, y, dx, dy) =
+            cast<float>(integral(x + hi, y + hi, dx, dy) -
+                        integral(x + lo - 1, y + hi, dx, dy) -
+                        integral(x + hi, y + lo - 1, dx, dy) +
+                        integral(x + lo - 1, y + lo - 1, dx, dy));
+
+        // Compute the weights from the patch differences
+        Func w("w");
+        w(x, y, dx, dy) = fast_exp(blur_d(x, y, dx, dy)*inv_sigma_sq);
+
+        // Add an alpha channel
+        Func clamped_with_alpha("clamped_with_alpha");
+        clamped_with_alpha(x, y, c) = select(c == 0, clamped(x, y, 0),
+                                             c == 1, clamped(x, y, 1),
+                                             c == 2, clamped(x, y, 2),
+                                             1.0f);
+
+        // Define a reduction domain for the search area
+        RDom s_dom(-(search_area/2), search_area, -(search_area/2), search_area);
+
+        // Compute the sum of the pixels in the search area
+        Func non_local_means_sum("non_local_means_sum");
+        non_local_means_sum(x, y, c) += w(x, y, s_dom.x, s_dom.y) * clamped_with_alpha(x + s_dom.x, y + s_dom.y, c);
+
+        non_local_means(x, y, c) =
+            clamp(non_local_means_sum(x, y, c) / non_local_means_sum(x, y, 3), 0.0f, 1.0f);
+
+        /* THE SCHEDULE */
+
+        // Require 3 channels for output
+        non_local_means.dim(2).set_bounds(0, 3);
+
+        // Both schedules walk the search offsets in the outermost
+        // loop, and build the summed-area table for one offset at a
+        // time across the whole image.
+        Var xi("xi"), yi("yi"), xo("xo");
+
+        if (get_target().has_gpu_feature()) {
+            non_local_means.compute_root()
+                .reorder(c, x, y).unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            non_local_means_sum.compute_root()
+                .bound(c, 0, 4)
+                .reorder(c, x, y).unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            non_local_means_sum.update(0)
+                .reorder(c, x, y, s_dom.x, s_dom.y).unroll(c)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            integral.compute_at(non_local_means_sum, s_dom.x)
+                .gpu_tile(x, y, xi, yi, 16, 8);
+            // One thread per row for the scan along x, and one thread
+            // per column for the scan along y.
+            integral.update(0)
+                .gpu_tile(y, yi, 64);
+            integral.update(1)
+                .gpu_tile(x, xi, 64);
+        } else {
+            const int vec = natural_vector_size<float>();
+            const int dvec = natural_vector_size<double>();
+            non_local_means.compute_root()
+                .reorder(c, x, y).unroll(c)
+                .vectorize(x, vec)
+                .parallel(y, 8);
+            non_local_means_sum.compute_root()
+                .bound(c, 0, 4)
+                .reorder(c, x, y).unroll(c)
+                .vectorize(x, vec)
+                .parallel(y, 8);
+            non_local_means_sum.update(0)
+                .reorder(c, x, y, s_dom.x, s_dom.y).unroll(c)
+                .vectorize(x, vec)
+                .parallel(y, 8);
+            integral.compute_at(non_local_means_sum, s_dom.x)
+                .vectorize(x, dvec)
+                .parallel(y, 8);
+            // The scan along x is serial within a row, so parallelize
+            // across rows. The scan along y vectorizes across columns.
+            integral.update(0)
+                .parallel(y, 8);
+            integral.update(1)
+                .split(x, xo, xi, dvec * 16)
+                .reorder(xi, ry, xo)
+                .vectorize(xi, dvec)
+                .parallel(xo);
+        }
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(NonLocalMeans, nl_means)
+HALIDE_REGISTER_GENERATOR(NonLocalMeansIntegral, nl_means_integral)
@@ -3,6 +3,7 @@
 
 #include "nl_means.h"
 #include "nl_means_auto_schedule.h"
+#include "nl_means_integral.h"
 
 #include "halide_benchmark.h"
 #include "HalideBuffer.h"
@@ -28,22 +29,33 @@ int main(int argc, char **argv) {
     nl_means(input, patch_size, search_area, sigma, output);
 
     // Timing code
+    BenchmarkConfig config;
+    config.min_samples = timing_iterations;
 
     printf("Input size: %d by %d, patch size: %d, search area: %d, sigma: %f\n",
             input.width(), input.height(), patch_size, search_area, sigma);
 
     // Manually-tuned version
-    double min_t_manual = benchmark(timing_iterations, 1, [&]() {
+    config.name = "nl_means_manual";
+    double min_t_manual = benchmark([&]() {
         nl_means(input, patch_size, search_area, sigma, output);
-    });
+    }, config);
     printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
 
     // Auto-scheduled version
-    double min_t_auto = benchmark(timing_iterations, 1, [&]() {
+    config.name = "nl_means_auto";
+    double min_t_auto = benchmark([&]() {
         nl_means_auto_schedule(input, patch_size, search_area, sigma, output);
-    });
+    }, config);
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Summed-area table version, whose cost doesn't grow with the patch size
+    config.name = "nl_means_integral";
+    double min_t_integral = benchmark([&]() {
+        nl_means_integral(input, patch_size, search_area, sigma, output);
+    }, config);
+    printf("Summed-area table time: %gms\n", min_t_integral * 1e3);
+
     convert_and_save_image(output, argv[6]);
 
     return 0;
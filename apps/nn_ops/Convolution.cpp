@@ -10,6 +10,7 @@
 
 #include "common_reference.h"
 #include "Convolution.h"
+#include "Convolution_implicit_gemm.h"
 
 #include "HalideBuffer.h"
 
@@ -81,17 +82,21 @@ int main(int argc, char **argv) {
 
     Halide::Runtime::Buffer<uint8_t> output_tensor(nullptr,
                                                    output_depth, output_width, output_height, N);
+    Halide::Runtime::Buffer<uint8_t> implicit_gemm_output_tensor(nullptr,
+                                                                 output_depth, output_width, output_height, N);
 
 #ifdef HALIDE_RUNTIME_HEXAGON
     input_tensor.device_malloc(halide_hexagon_device_interface());
     filter_tensor.device_malloc(halide_hexagon_device_interface());
     bias_tensor.device_malloc(halide_hexagon_device_interface());
     output_tensor.device_malloc(halide_hexagon_device_interface());
+    implicit_gemm_output_tensor.device_malloc(halide_hexagon_device_interface());
 #else
     input_tensor.allocate();
     filter_tensor.allocate();
     bias_tensor.allocate();
     output_tensor.allocate();
+    implicit_gemm_output_tensor.allocate();
 #endif
 
     input_tensor.for_each_value([](uint8_t &x) {
@@ -127,6 +132,20 @@ int main(int argc, char **argv) {
 
     printf("Done, time: %g s\n", time);
 
+    printf("Running implicit GEMM pipeline...\n");
+    double implicit_gemm_time = Halide::Tools::benchmark([&]() {
+        int result = Convolution_implicit_gemm(input_tensor, filter_tensor, bias_tensor,
+                                               input_offset, filter_offset, input_depth,
+                                               stride, pad_width, pad_height, byte_zero,
+                                               output_multiplier, output_shift, output_offset,
+                                               output_min, output_max, implicit_gemm_output_tensor);
+        if (result != 0) {
+            printf("pipeline failed! %d\n", result);
+        }
+    });
+
+    printf("Done, time: %g s\n", implicit_gemm_time);
+
 #ifdef HALIDE_RUNTIME_HEXAGON
     // We're done with HVX, power it off, and reset the performance mode
     // to default to save power.
@@ -137,6 +156,7 @@ int main(int argc, char **argv) {
     // Copy the output back to the host. If the buffer is zero-copy (as
     // it should be on a real device), this will be a no-op.
     output_tensor.copy_to_host();
+    implicit_gemm_output_tensor.copy_to_host();
 
     // Validate that the algorithm did what we expect.
     output_tensor.for_each_element([&](int c, int x, int y, int b) {
@@ -169,6 +189,11 @@ int main(int argc, char **argv) {
             printf("Mismatch at %d %d: %d != %d\n", x, y, output, output_tensor(c, x, y, b));
             abort();
         }
+        if (output != implicit_gemm_output_tensor(c, x, y, b)) {
+            printf("Implicit GEMM mismatch at %d %d: %d != %d\n", x, y, output,
+                   implicit_gemm_output_tensor(c, x, y, b));
+            abort();
+        }
     });
 
     printf("Success!\n");
@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <memory.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <limits>
+
+#include "halide_benchmark.h"
+
+#include "AveragePool.h"
+#include "Convolution.h"
+#include "ConvolutionAveragePool.h"
+#include "ConvolutionMaxPool.h"
+#include "MaxPool.h"
+
+#include "HalideBuffer.h"
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        printf("Usage: %s C W H N [output_depth filter_size stride pad pool_size pool_stride output_min output_max]\n", argv[0]);
+        return 0;
+    }
+
+    int C = atoi(argv[1]);
+    int W = atoi(argv[2]);
+    int H = atoi(argv[3]);
+    int N = atoi(argv[4]);
+
+    printf("Benchmarking %dx%dx%dx%d\n", C, W, H, N);
+
+    // These parameters lead to reasonable values for testing in
+    // most cases (expected value of the input matrices is ~0,
+    // expected value of the product is ~0).
+    int output_depth = C;
+    int filter_size = 3;
+    int stride = 1;
+    int pad = 1;
+    int pool_size = 2;
+    int pool_stride = 2;
+    uint8_t output_min = 0;
+    uint8_t output_max = 255;
+
+    if (argc > 5) output_depth = atoi(argv[5]);
+    if (argc > 6) filter_size = atoi(argv[6]);
+    if (argc > 7) stride = atoi(argv[7]);
+    if (argc > 8) pad = atoi(argv[8]);
+    if (argc > 9) pool_size = atoi(argv[9]);
+    if (argc > 10) pool_stride = atoi(argv[10]);
+    if (argc > 11) output_min = atoi(argv[11]);
+    if (argc > 12) output_max = atoi(argv[12]);
+
+    int16_t input_offset = -128;
+    int16_t filter_offset = -128;
+    int input_depth = C;
+    uint8_t byte_zero = 0;
+    int output_multiplier = 1 << 30;
+    int output_shift = 8;
+    int output_offset = 128;
+    const int pool_pad = 0;
+
+    const int conv_width = (W + 2 * pad - filter_size) / stride + 1;
+    const int conv_height = (H + 2 * pad - filter_size) / stride + 1;
+    const int pool_width = (conv_width - pool_size) / pool_stride + 1;
+    const int pool_height = (conv_height - pool_size) / pool_stride + 1;
+
+    // Hexagon's device_malloc implementation will also set the host
+    // pointer if it is null, giving a zero copy buffer.
+    Halide::Runtime::Buffer<uint8_t> input_tensor(nullptr, C, W, H, N);
+    Halide::Runtime::Buffer<uint8_t> filter_tensor(nullptr,
+                                                   input_depth, filter_size, filter_size, output_depth);
+    Halide::Runtime::Buffer<int32_t> bias_tensor(nullptr, output_depth);
+    Halide::Runtime::Buffer<uint8_t> conv_tensor(nullptr,
+                                                 output_depth, conv_width, conv_height, N);
+    Halide::Runtime::Buffer<uint8_t> unfused_tensor(nullptr,
+                                                    output_depth, pool_width, pool_height, N);
+    Halide::Runtime::Buffer<uint8_t> output_tensor(nullptr,
+                                                   output_depth, pool_width, pool_height, N);
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    input_tensor.device_malloc(halide_hexagon_device_interface());
+    filter_tensor.device_malloc(halide_hexagon_device_interface());
+    bias_tensor.device_malloc(halide_hexagon_device_interface());
+    conv_tensor.device_malloc(halide_hexagon_device_interface());
+    unfused_tensor.device_malloc(halide_hexagon_device_interface());
+    output_tensor.device_malloc(halide_hexagon_device_interface());
+#else
+    input_tensor.allocate();
+    filter_tensor.allocate();
+    bias_tensor.allocate();
+    conv_tensor.allocate();
+    unfused_tensor.allocate();
+    output_tensor.allocate();
+#endif
+
+    input_tensor.for_each_value([](uint8_t &x) {
+        x = static_cast<uint8_t>(rand());
+    });
+
+    filter_tensor.for_each_value([](uint8_t &x) {
+        x = static_cast<uint8_t>(rand());
+    });
+
+    bias_tensor.for_each_value([](int32_t &x) {
+        x = static_cast<int32_t>(rand());
+    });
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // To avoid the cost of powering HVX on in each call of the
+    // pipeline, power it on once now. Also, set Hexagon performance to turbo.
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_turbo);
+    halide_hexagon_power_hvx_on(nullptr);
+#endif
+
+    auto convolution = [&]() {
+        return Convolution(input_tensor, filter_tensor, bias_tensor,
+                           input_offset, filter_offset, input_depth,
+                           stride, pad, pad, byte_zero,
+                           output_multiplier, output_shift, output_offset,
+                           output_min, output_max, conv_tensor);
+    };
+
+    for (bool average : { false, true }) {
+        const char *pool_name = average ? "AveragePool" : "MaxPool";
+
+        // Run the convolution and the pool as separate pipelines, with the
+        // convolution result in memory between them.
+        printf("Running Convolution + %s...\n", pool_name);
+        double unfused_time = Halide::Tools::benchmark([&]() {
+            int result = convolution();
+            if (result == 0) {
+                if (average) {
+                    result = AveragePool(conv_tensor, pool_stride, pool_pad, pool_pad,
+                                         pool_size, pool_size, output_min, output_max,
+                                         unfused_tensor);
+                } else {
+                    result = MaxPool(conv_tensor, pool_stride, pool_pad, pool_pad,
+                                     pool_size, pool_size, output_min, output_max,
+                                     unfused_tensor);
+                }
+            }
+            if (result != 0) {
+                printf("pipeline failed! %d\n", result);
+            }
+        });
+        printf("Done, time: %g s\n", unfused_time);
+
+        printf("Running fused Convolution%s...\n", pool_name);
+        double time = Halide::Tools::benchmark([&]() {
+            auto pipeline = average ? ConvolutionAveragePool : ConvolutionMaxPool;
+            int result = pipeline(input_tensor, filter_tensor, bias_tensor,
+                                  input_offset, filter_offset, input_depth,
+                                  stride, pad, pad, byte_zero,
+                                  output_multiplier, output_shift, output_offset,
+                                  output_min, output_max,
+                                  pool_stride, pool_pad, pool_pad, pool_size, pool_size,
+                                  output_tensor);
+            if (result != 0) {
+                printf("pipeline failed! %d\n", result);
+            }
+        });
+        printf("Done, time: %g s (%.2fx unfused)\n", time, unfused_time / time);
+
+        // Copy the outputs back to the host. If the buffers are zero-copy (as
+        // they should be on a real device), this will be a no-op.
+        unfused_tensor.copy_to_host();
+        output_tensor.copy_to_host();
+
+        // The Convolution, MaxPool and AveragePool tests validate the separate
+        // pipelines, so the fused one just needs to match them.
+        output_tensor.for_each_element([&](int c, int x, int y, int b) {
+            if (output_tensor(c, x, y, b) != unfused_tensor(c, x, y, b)) {
+                printf("Mismatch at %d %d %d %d: %d != %d\n", c, x, y, b,
+                       output_tensor(c, x, y, b), unfused_tensor(c, x, y, b));
+                abort();
+            }
+        });
+    }
+
+#ifdef HALIDE_RUNTIME_HEXAGON
+    // We're done with HVX, power it off, and reset the performance mode
+    // to default to save power.
+    halide_hexagon_power_hvx_off(nullptr);
+    halide_hexagon_set_performance_mode(nullptr, halide_hexagon_power_default);
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
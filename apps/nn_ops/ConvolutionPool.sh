@@ -0,0 +1,9 @@
+CONVOLUTION_POOL=$1
+# Columns are: C W H N output_depth, filter_size, stride, pad, pool_size,
+# pool_stride, output_min, output_max
+
+$CONVOLUTION_POOL 8 17 17 1 8 3 1 1 2 2
+$CONVOLUTION_POOL 8 17 17 1 16 3 1 1 3 2
+$CONVOLUTION_POOL 16 32 32 1 16 3 1 1 2 2 0 255
+$CONVOLUTION_POOL 16 32 32 1 32 3 2 1 2 2 0 128
+$CONVOLUTION_POOL 32 56 56 1 32 1 1 0 2 2
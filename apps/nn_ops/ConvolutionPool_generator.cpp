@@ -0,0 +1,214 @@
+// This generator fuses a convolution layer with the pooling layer that
+// consumes it, and schedules them for CPU and HVX.
+//
+// The pipeline implements the following operations:
+// (1) the operations of Convolution_generator.cpp, which end by clamping the
+//     8-bit result to [output_min, output_max]; that clamp is the activation
+//     (ReLU, ReLU6, ...) of the layer
+// (2) a max or average pool of the convolution result, as in
+//     MaxPool_generator.cpp and AveragePool_generator.cpp
+//
+// The convolution is computed for a few rows of the pooled output at a time,
+// so its result stays in cache instead of making a round trip through memory.
+// The result is the same as running the Convolution generator followed by
+// the MaxPool or AveragePool generator.
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Generator;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::u16_sat;
+using Halide::ConciseCasts::u8_sat;
+
+enum class PoolType {
+    Max,
+    Average,
+};
+
+class ConvolutionPool : public Generator<ConvolutionPool> {
+public:
+    GeneratorParam<PoolType> pool_type_{ "pool_type", PoolType::Max,
+                                         { { "max", PoolType::Max },
+                                           { "average", PoolType::Average } } };
+
+    // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
+    // input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // A 4D array of 8-bit filter coefficients indexed by filter_depth, filter_x,
+    // filter_y, filter_batch (aka. output_depth).
+    Input<Buffer<uint8_t>> filter_{"filter", 4};
+
+    // A 1D array of 32-bit biases. The bias should be added to the depth
+    // dimension of the output (i.e., # filter batches).
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // The parameters of the convolution, as in Convolution_generator.cpp.
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+    Input<int16_t> filter_offset_{ "filter_offset", 0, -255, 0 };
+    Input<int> input_depth_{ "input_depth" };
+    Input<int> stride_{ "stride" };
+    Input<int> pad_width_{ "pad_width" };
+    Input<int> pad_height_{ "pad_height" };
+    Input<uint8_t> byte_zero_{ "byte_zero" };
+    Input<int> output_multiplier_{ "output_multiplier" };
+    Input<int> output_shift_{ "output_shift" };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    // The parameters of the pool, as in MaxPool_generator.cpp. The pool reads
+    // the convolution result at [x * pool_stride, y * pool_stride].
+    Input<int> pool_stride_{ "pool_stride" };
+    Input<int> pool_pad_width_{ "pool_pad_width" };
+    Input<int> pool_pad_height_{ "pool_pad_height" };
+    Input<int> pool_width_{ "pool_width" };
+    Input<int> pool_height_{ "pool_height" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+
+        // For the input, add the offset and upcast to 16-bit.
+        Func input_with_offset("input_with_offset");
+        input_with_offset(depth, x, y, batch) =
+            i16(input_(depth, x, y, batch)) + input_offset_;
+
+        // Add a zero boundary condition to x and y dimensions of the input.
+        Func input_with_offset_bounded =
+            constant_exterior(input_with_offset, i16(byte_zero_),
+                              { { Expr(), Expr() },
+                                { 0, input_.dim(1).extent() },
+                                { 0, input_.dim(2).extent() },
+                                { Expr(), Expr() } });
+
+        // For the filter, add the offset and upcast to 16-bit.
+        Func filter_with_offset("filter_with_offset");
+        filter_with_offset(depth, x, y, batch) =
+            i16(filter_(depth, x, y, batch)) + filter_offset_;
+
+        // Shift the input spatially in [x, y] by -[pad_width, pad_height].
+        Func shifted_input_with_offset("shifted_input_with_offset");
+        shifted_input_with_offset(depth, x, y, batch) = input_with_offset_bounded(
+            depth, x - pad_width_, y - pad_height_, batch);
+
+        // Do the convolution in 32-bit.
+        Func convolved("convolved");
+        RDom filter_dom(0, input_depth_, 0, filter_.dim(1).extent(), 0,
+                        filter_.dim(2).extent());
+        convolved(depth, x, y, batch) +=
+            cast<int32_t>(filter_with_offset(filter_dom[0], filter_dom[1],
+                                             filter_dom[2], depth)) *
+            cast<int32_t>(shifted_input_with_offset(
+                filter_dom[0], x * stride_ + filter_dom[1],
+                y * stride_ + filter_dom[2], batch));
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                convolved(depth, x, y, batch) + bias_(depth), output_multiplier_,
+                output_shift_) +
+            output_offset_;
+
+        // Saturate, narrow and clamp the convolution result.
+        Func activation("activation");
+        activation(depth, x, y, batch) =
+            min(output_max_,
+                max(output_min_,
+                    u8_sat(u16_sat(scaled_plus_offset(depth, x, y, batch)))));
+
+        // The extent of the convolution result, which the pool is padded
+        // outside of.
+        Expr conv_width =
+            (input_.dim(1).extent() + 2 * pad_width_ - filter_.dim(1).extent()) / stride_ + 1;
+        Expr conv_height =
+            (input_.dim(2).extent() + 2 * pad_height_ - filter_.dim(2).extent()) / stride_ + 1;
+
+        // Zero is the identity of the max of 8-bit values, and adds nothing to
+        // the sum of the average, so it works as the padding for both pools.
+        Func activation_bounded =
+            constant_exterior(activation, cast<uint8_t>(0),
+                              { { Expr(), Expr() },
+                                { 0, conv_width },
+                                { 0, conv_height },
+                                { Expr(), Expr() } });
+
+        Func shifted_activation("shifted_activation");
+        shifted_activation(depth, x, y, batch) = activation_bounded(
+            depth, x - pool_pad_width_, y - pool_pad_height_, batch);
+
+        RDom pool_dom(0, pool_width_, 0, pool_height_);
+        Expr pool_value = cast<int32_t>(shifted_activation(
+            depth, x * pool_stride_ + pool_dom.x, y * pool_stride_ + pool_dom.y, batch));
+
+        Func pooled("pooled");
+        const PoolType pool_type = pool_type_;
+        if (pool_type == PoolType::Max) {
+            pooled(depth, x, y, batch) = maximum(pool_value);
+        } else {
+            // Average over the part of the window that is inside the
+            // convolution result, rounding to nearest.
+            Expr in_x_origin = x * pool_stride_ - pool_pad_width_;
+            Expr x_start = max(0, -in_x_origin);
+            Expr x_end = min(pool_width_, conv_width - in_x_origin);
+
+            Expr in_y_origin = y * pool_stride_ - pool_pad_height_;
+            Expr y_start = max(0, -in_y_origin);
+            Expr y_end = min(pool_height_, conv_height - in_y_origin);
+
+            Expr pool_count = (x_end - x_start) * (y_end - y_start);
+            pooled(depth, x, y, batch) = (sum(pool_value) + pool_count / 2) / pool_count;
+        }
+
+        output_(depth, x, y, batch) =
+            min(output_max_, max(output_min_, u8_sat(pooled(depth, x, y, batch))));
+
+        // The schedule.
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+
+        // Parallelize across strips of rows of the pooled output, and compute
+        // the rows of the convolution that each strip needs inside it. Strips
+        // overlap when the pool window is larger than its stride, so a few
+        // rows of the convolution are computed twice.
+        Var yo("yo"), yi("yi");
+        constexpr int kSplitFactor = 4;
+        output_.split(y, yo, yi, kSplitFactor, TailStrategy::GuardWithIf)
+            .parallel(yo);
+        activation.compute_at(output_, yo);
+
+        // We only perform vectorization when the depth >= vector size.
+        Expr can_vectorize_across_depth =
+            filter_.dim(3).extent() >= vector_size_u8;
+        output_.specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size_u8);
+        activation.specialize(can_vectorize_across_depth)
+            .vectorize(depth, vector_size_u8);
+
+        shifted_input_with_offset.compute_at(output_, batch);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(ConvolutionPool, ConvolutionPool)
@@ -16,6 +16,11 @@
 // Output dimension: {filter_batches, ceil((input_width + 2 * pad_width -
 // filter_width) / stride) + 1, ceil((input_height + 2 * pad_height -
 // filter_height) / stride) + 1, input_batches}
+//
+// With implicit_gemm=true, the CPU schedule treats the convolution as a
+// matrix multiply of the filter (output depth x filter taps) by columns of
+// input taps, as Im2col + MatrixMultiply would, but reads those columns
+// straight from the input instead of materializing them.
 
 #include "common.h"
 #include <Halide.h>
@@ -29,6 +34,9 @@ using Halide::ConciseCasts::u8_sat;
 
 class Convolution : public Generator<Convolution> {
 public:
+    // Use the implicit GEMM schedule on CPU targets.
+    GeneratorParam<bool> implicit_gemm_{ "implicit_gemm", false };
+
     // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
     // input_batch.
     Input<Buffer<uint8_t>> input_{"input", 4};
@@ -99,13 +107,22 @@ public:
         shifted_input_with_offset(depth, x, y, batch) = input_with_offset_bounded(
             depth, x - pad_width_, y - pad_height_, batch);
 
+        // The implicit GEMM schedule computes whole vectors of output depth at
+        // a time, so let it read past the last filter batch. The clamped
+        // values only reach lanes that are never stored.
+        Func filter_packed("filter_packed");
+        filter_packed(depth, x, y, batch) =
+            filter_with_offset(depth, x, y,
+                               clamp(batch, 0, filter_.dim(3).extent() - 1));
+        Func conv_filter = (bool)implicit_gemm_ ? filter_packed : filter_with_offset;
+
         // Do the convolution in 32-bit.
         Func convolved("convolved");
         RDom filter_dom(0, input_depth_, 0, filter_.dim(1).extent(), 0,
                         filter_.dim(2).extent());
         convolved(depth, x, y, batch) +=
-            cast<int32_t>(filter_with_offset(filter_dom[0], filter_dom[1],
-                                             filter_dom[2], depth)) *
+            cast<int32_t>(conv_filter(filter_dom[0], filter_dom[1],
+                                      filter_dom[2], depth)) *
             cast<int32_t>(shifted_input_with_offset(
                 filter_dom[0], x * stride_ + filter_dom[1],
                 y * stride_ + filter_dom[2], batch));
@@ -141,13 +158,48 @@ public:
         } else if (get_target().has_feature(Target::HVX_128)) {
             vector_size_u8 = 128;
         }
-        // We only perform vectorization when the depth >= vector size.
-        Expr can_vectorize_across_depth =
-            filter_.dim(3).extent() >= vector_size_u8;
-
-        output_.parallel(y)
-            .specialize(can_vectorize_across_depth)
-            .vectorize(depth, vector_size_u8);
+        if ((bool)implicit_gemm_ && !use_hexagon) {
+            // Each output tile is a block of vector_size_u8 output depths by
+            // tile_width columns, accumulated in registers over all the filter
+            // taps. Arm has twice as many vector registers as x86 to hold the
+            // accumulators.
+            const int tile_width = get_target().arch == Target::ARM ? 4 : 2;
+            Var depth_o("depth_o"), depth_i("depth_i"), xo("xo"), xi("xi");
+            output_.compute_root()
+                .split(depth, depth_o, depth_i, vector_size_u8,
+                       TailStrategy::GuardWithIf)
+                .split(x, xo, xi, tile_width, TailStrategy::GuardWithIf)
+                .reorder(depth_i, xi, depth_o, xo, y, batch)
+                .vectorize(depth_i)
+                .unroll(xi)
+                .parallel(y);
+
+            convolved.compute_at(output_, depth_o)
+                .bound_extent(depth, vector_size_u8)
+                .bound_extent(x, tile_width)
+                .vectorize(depth)
+                .unroll(x);
+            convolved.update()
+                .reorder(depth, x, filter_dom[0], filter_dom[1], filter_dom[2])
+                .vectorize(depth)
+                .unroll(x);
+
+            // Pack the filter with the output depth innermost, so the inner
+            // loop loads a dense vector of it for each input element it
+            // broadcasts.
+            filter_packed.compute_root()
+                .reorder_storage(batch, depth, x, y)
+                .reorder(batch, depth, x, y)
+                .vectorize(batch, vector_size_u8, TailStrategy::GuardWithIf);
+        } else {
+            // We only perform vectorization when the depth >= vector size.
+            Expr can_vectorize_across_depth =
+                filter_.dim(3).extent() >= vector_size_u8;
+
+            output_.parallel(y)
+                .specialize(can_vectorize_across_depth)
+                .vectorize(depth, vector_size_u8);
+        }
         shifted_input_with_offset.compute_at(output_, batch);
     }
 };
@@ -0,0 +1,10 @@
+WINOGRAD_CONVOLUTION=$1
+# Columns are: C W H N output_depth, input_offset, filter_offset, pad_width,
+# pad_height, byte_zero, output_multiplier, output_shift, output_offset,
+# output_min, output_max
+
+$WINOGRAD_CONVOLUTION 8 17 17 1 8 -128 -128 1 1 0
+$WINOGRAD_CONVOLUTION 8 17 17 1 16 -128 -128 1 1 0
+$WINOGRAD_CONVOLUTION 8 17 17 1 16 -128 -140 1 1 0
+$WINOGRAD_CONVOLUTION 12 17 17 1 16 -128 -140 0 0 0
+$WINOGRAD_CONVOLUTION 32 56 56 1 32 -128 -128 1 1 0
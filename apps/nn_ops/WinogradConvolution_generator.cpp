@@ -0,0 +1,287 @@
+// This generator implements 3x3, stride 1 convolution with the Winograd
+// F(2x2, 3x3) algorithm, and schedules for CPU.
+//
+// The pipeline implements the same operations as Convolution_generator.cpp:
+// (1) an input offset is added to the 8-bit input
+// (2) a filter offset is added to the 8-bit filter
+// (3) perform convolution
+// (4) convolution result is right-shifted and multiplied by a multiplier
+// (5) an output offset is added to the quantized convolution result
+// (6) the output is saturated and narrowed to 8-bit
+//
+// The output is computed in 2x2 tiles. Each 4x4 patch of the input and each
+// 3x3 filter are transformed so that the convolution of the patch becomes an
+// elementwise product, summed over the input depth. That takes 16
+// multiplies per tile per input channel, instead of the 36 of a direct
+// convolution. The filter transform is scaled by 2 in each dimension so that
+// all the transforms have integer coefficients, which makes the result exact:
+// it is 4 times the direct convolution, and is divided by 4 at the end.
+//
+// The transformed filter values fit in 12 bits, and the transformed input
+// in 11 bits, so the 32-bit sum can overflow for input depths of more than
+// about 900. The F(4x4, 3x3) variant isn't provided, because its transforms
+// have coefficients in sixths and twenty-fourths, and scaling those to
+// integers overflows 32 bits in a single product.
+//
+// Input dimension: {input_depth, input_width, input_height, input_batches}
+// Filter dimension: {filter_depth(=input_depth), 3, 3, filter_batches}
+// Output dimension: {filter_batches, input_width + 2 * pad_width - 2,
+// input_height + 2 * pad_height - 2, input_batches}
+
+#include "common.h"
+#include <Halide.h>
+
+using Halide::Expr;
+using Halide::Generator;
+using Halide::Var;
+using Halide::BoundaryConditions::constant_exterior;
+using Halide::ConciseCasts::i16;
+using Halide::ConciseCasts::i32;
+using Halide::ConciseCasts::u16_sat;
+using Halide::ConciseCasts::u8_sat;
+
+// The value of values[index], for an index in [0, values.size()). Once the
+// loop over index is unrolled, this simplifies to one of the values.
+Expr select_by_index(const Expr &index, const std::vector<Expr> &values) {
+    Expr result = values.back();
+    for (int i = (int)values.size() - 2; i >= 0; i--) {
+        result = select(index == i, values[i], result);
+    }
+    return result;
+}
+
+class WinogradConvolution : public Generator<WinogradConvolution> {
+public:
+    // Unsigned 8-bit input tensor, indexed by input_depth, input_x, input_y,
+    // input_batch.
+    Input<Buffer<uint8_t>> input_{"input", 4};
+
+    // A 4D array of 8-bit filter coefficients indexed by filter_depth, filter_x,
+    // filter_y, filter_batch (aka. output_depth). The filter must be 3x3.
+    Input<Buffer<uint8_t>> filter_{"filter", 4};
+
+    // A 1D array of 32-bit biases. The bias should be added to the depth
+    // dimension of the output (i.e., # filter batches).
+    Input<Buffer<int32_t>> bias_{"bias", 1};
+
+    // Offsets and multipliers for the input, filter, and output.
+    Input<int16_t> input_offset_{ "input_offset", 0, -255, 0 };
+    Input<int16_t> filter_offset_{ "filter_offset", 0, -255, 0 };
+
+    // For each x, y, batch, only the first input_depth_ elements can be non-zero.
+    // This value should be <= input_.dim(0).extent()
+    Input<int> input_depth_{ "input_depth" };
+
+    Input<int> pad_width_{ "pad_width" };
+    Input<int> pad_height_{ "pad_height" };
+    // byte_zero_ denotes the value padded at the input tensor boundary (in the x
+    // and y dimensions).
+    Input<uint8_t> byte_zero_{ "byte_zero" };
+
+    // Parameters for pointwise operations on the output.
+    Input<int> output_multiplier_{ "output_multiplier" };
+    Input<int> output_shift_{ "output_shift" };
+    Input<int> output_offset_{ "output_offset", 0, 0, 255 };
+    Input<uint8_t> output_min_{ "output_min" };
+    Input<uint8_t> output_max_{ "output_max" };
+
+    Output<Buffer<uint8_t>> output_{"output", 4};
+
+    void generate() {
+        // The algorithm.
+
+        // Some free variables, where x and y represent the spatial dimensions,
+        // tx and ty index the 2x2 output tiles, and u and v index the 4x4
+        // transformed tiles.
+        Var x("x"), y("y"), depth("depth"), batch("batch");
+        Var tx("tx"), ty("ty"), u("u"), v("v");
+
+        // For the input, add the offset and upcast to 16-bit.
+        Func input_with_offset("input_with_offset");
+        input_with_offset(depth, x, y, batch) =
+            i16(input_(depth, x, y, batch)) + input_offset_;
+
+        // Add a zero boundary condition to x and y dimensions of the input.
+        Func input_with_offset_bounded =
+            constant_exterior(input_with_offset, i16(byte_zero_),
+                              { { Expr(), Expr() },
+                                { 0, input_.dim(1).extent() },
+                                { 0, input_.dim(2).extent() },
+                                { Expr(), Expr() } });
+
+        // Shift the input spatially in [x, y] by -[pad_width, pad_height].
+        Func shifted_input_with_offset("shifted_input_with_offset");
+        shifted_input_with_offset(depth, x, y, batch) = input_with_offset_bounded(
+            depth, x - pad_width_, y - pad_height_, batch);
+
+        // Transform the 4x4 input patch of each tile by B^T d B, where
+        //   B^T = [1  0 -1  0]
+        //         [0  1  1  0]
+        //         [0 -1  1  0]
+        //         [0  1  0 -1]
+        // one dimension at a time.
+        auto input_transform = [](const std::vector<Expr> &d) {
+            return std::vector<Expr>{ d[0] - d[2], d[1] + d[2], d[2] - d[1], d[1] - d[3] };
+        };
+        std::vector<Expr> rows;
+        for (int i = 0; i < 4; i++) {
+            rows.push_back(shifted_input_with_offset(depth, tx * 2 + i, y, batch));
+        }
+        Func input_transformed_x("input_transformed_x");
+        input_transformed_x(depth, u, y, tx, batch) = select_by_index(u, input_transform(rows));
+
+        std::vector<Expr> cols;
+        for (int j = 0; j < 4; j++) {
+            cols.push_back(input_transformed_x(depth, u, ty * 2 + j, tx, batch));
+        }
+        Func input_transformed("input_transformed");
+        input_transformed(depth, u, v, tx, ty, batch) = select_by_index(v, input_transform(cols));
+
+        // For the filter, add the offset and upcast to 16-bit, and transform it
+        // by G' g G'^T, where G' = 2G is
+        //   G' = [2  0  0]
+        //        [1  1  1]
+        //        [1 -1  1]
+        //        [0  0  2]
+        filter_.dim(1).set_bounds(0, 3).dim(2).set_bounds(0, 3);
+        Func filter_with_offset("filter_with_offset");
+        filter_with_offset(depth, x, y, batch) =
+            i16(filter_(depth, x, y, batch)) + filter_offset_;
+
+        auto filter_transform = [](const std::vector<Expr> &g) {
+            return std::vector<Expr>{ g[0] * 2, g[0] + g[1] + g[2], g[0] - g[1] + g[2], g[2] * 2 };
+        };
+        std::vector<Expr> filter_rows;
+        for (int i = 0; i < 3; i++) {
+            filter_rows.push_back(filter_with_offset(depth, i, y, batch));
+        }
+        Func filter_transformed_x("filter_transformed_x");
+        filter_transformed_x(depth, u, y, batch) = select_by_index(u, filter_transform(filter_rows));
+
+        std::vector<Expr> filter_cols;
+        for (int j = 0; j < 3; j++) {
+            filter_cols.push_back(filter_transformed_x(depth, u, j, batch));
+        }
+        Func filter_transformed("filter_transformed");
+        filter_transformed(depth, u, v, batch) = select_by_index(v, filter_transform(filter_cols));
+
+        // Multiply the transformed tiles elementwise, and sum over the input
+        // depth. For each of the 16 (u, v), this is a matrix multiply of the
+        // filters by the tiles.
+        Func product("product");
+        RDom rc(0, input_depth_, "rc");
+        product(depth, u, v, tx, ty, batch) +=
+            i32(filter_transformed(rc, u, v, depth)) *
+            i32(input_transformed(rc, u, v, tx, ty, batch));
+
+        // Transform the product back to a 2x2 output tile by A^T m A, where
+        //   A^T = [1  1  1  0]
+        //         [0  1 -1 -1]
+        auto output_transform = [](const std::vector<Expr> &m) {
+            return std::vector<Expr>{ m[0] + m[1] + m[2], m[1] - m[2] - m[3] };
+        };
+        Var ox("ox"), oy("oy");
+        std::vector<Expr> products;
+        for (int i = 0; i < 4; i++) {
+            products.push_back(product(depth, i, v, tx, ty, batch));
+        }
+        Func output_transformed_x("output_transformed_x");
+        output_transformed_x(depth, ox, v, tx, ty, batch) = select_by_index(ox, output_transform(products));
+
+        std::vector<Expr> output_rows;
+        for (int j = 0; j < 4; j++) {
+            output_rows.push_back(output_transformed_x(depth, ox, j, tx, ty, batch));
+        }
+        Func output_transformed("output_transformed");
+        output_transformed(depth, ox, oy, tx, ty, batch) = select_by_index(oy, output_transform(output_rows));
+
+        // Undo the scaling of the filter transform. Tiles start at 0, so
+        // output_ requires its x and y min to be 0.
+        Func convolved("convolved");
+        convolved(depth, x, y, batch) =
+            output_transformed(depth, x % 2, y % 2, x / 2, y / 2, batch) / 4;
+
+        Func scaled_plus_offset("scaled_plus_offset");
+        scaled_plus_offset(depth, x, y, batch) =
+            multiply_quantized_multiplier(
+                convolved(depth, x, y, batch) + bias_(depth), output_multiplier_,
+                output_shift_) +
+            output_offset_;
+
+        // Saturate and narrow the output.
+        output_(depth, x, y, batch) =
+            min(output_max_,
+                max(output_min_,
+                    u8_sat(u16_sat(scaled_plus_offset(depth, x, y, batch)))));
+
+        // The schedule.
+        const bool use_hexagon =
+            get_target().features_any_of({ Target::HVX_64, Target::HVX_128 });
+
+        // Specifying .hexagon() on a Func will generate an RPC to run this stage
+        // on Hexagon. If Hexagon is the host (that is, the architecture is
+        // Hexagon), we have to omit the .hexagon() directive as we are already
+        // running on Hexagon.
+        if (use_hexagon && get_target().arch != Target::Hexagon) {
+            output_.hexagon();
+        }
+
+        int vector_size_u8 = get_target().natural_vector_size<uint8_t>();
+        if (get_target().has_feature(Target::HVX_64)) {
+            vector_size_u8 = 64;
+        } else if (get_target().has_feature(Target::HVX_128)) {
+            vector_size_u8 = 128;
+        }
+        const int vector_size_i16 = vector_size_u8 / 2;
+        const int vector_size_i32 = vector_size_u8 / 4;
+
+        // Compute the product for a row of tiles_per_block tiles at a time,
+        // unrolled across the tiles so each vector of the transformed filter
+        // is loaded once per block. Arm has twice as many vector registers as
+        // x86 to hold the accumulators.
+        const int tiles_per_block = get_target().arch == Target::ARM ? 8 : 4;
+
+        Var txo("txo"), txi("txi"), depth_o("depth_o"), depth_i("depth_i");
+        output_.compute_root()
+            .split(y, ty, oy, 2, TailStrategy::GuardWithIf)
+            .split(x, tx, ox, 2, TailStrategy::GuardWithIf)
+            .split(tx, txo, txi, tiles_per_block, TailStrategy::GuardWithIf)
+            .reorder(depth, ox, oy, txi, txo, ty, batch)
+            .unroll(ox)
+            .unroll(oy)
+            .parallel(ty)
+            .vectorize(depth, vector_size_u8, TailStrategy::GuardWithIf);
+
+        product.compute_at(output_, txo)
+            .bound_extent(u, 4)
+            .bound_extent(v, 4)
+            .bound_extent(tx, tiles_per_block)
+            .vectorize(depth, vector_size_i32, TailStrategy::GuardWithIf);
+        product.update()
+            .split(depth, depth_o, depth_i, vector_size_i32, TailStrategy::GuardWithIf)
+            .reorder(depth_i, tx, rc, depth_o, u, v)
+            .vectorize(depth_i)
+            .unroll(tx);
+
+        input_transformed.compute_at(output_, txo)
+            .reorder(depth, u, v, tx)
+            .vectorize(depth, vector_size_i16, TailStrategy::GuardWithIf)
+            .unroll(u)
+            .unroll(v);
+
+        // The filter transform is the same for every tile, so compute it once,
+        // with the output depth innermost to give the product dense vectors.
+        filter_transformed.compute_root()
+            .reorder_storage(batch, depth, u, v)
+            .reorder(batch, depth, u, v)
+            .vectorize(batch, vector_size_i16, TailStrategy::GuardWithIf)
+            .unroll(u)
+            .unroll(v);
+
+        shifted_input_with_offset.compute_at(output_, batch);
+
+        output_.dim(1).set_min(0).dim(2).set_min(0);
+    }
+};
+
+HALIDE_REGISTER_GENERATOR(WinogradConvolution, WinogradConvolution)
@@ -2,18 +2,13 @@
 
 using namespace Halide;
 
-Expr saturating_rounding_doubling_high_multiply(Expr a, Expr b) {
-    Type t = a.type();
-    Type wider = t.with_bits(t.bits() * 2);
-    Expr a_wide = cast(wider, a);
-    Expr b_wide = cast(wider, b);
-    Expr ab_wide = a_wide * b_wide;
-    Expr nudge = 1 << (t.bits() - 2);
-    Expr result = (ab_wide + nudge) >> (t.bits() - 1);
-    return cast(t, clamp(result, t.min(), t.max()));
-}
+namespace {
 
-Expr rounding_shift_right(Expr x, Expr shift) {
+// Correctly-rounded-to-nearest division by a power-of-two, with ties
+// rounded away from zero. Halide's rounding_shift_right rounds ties
+// up, which doesn't match the reference implementation for negative
+// values.
+Expr rounding_divide_by_power_of_two(Expr x, Expr shift) {
     // Shift must satisfy 0 <= shift <= 31
     Expr mask = ((1ll << shift) - 1);
     Expr remainder = x & mask;
@@ -21,6 +16,8 @@ Expr rounding_shift_right(Expr x, Expr shift) {
     return (x >> shift) + select(remainder > threshold, 1, 0);
 }
 
+}  // namespace
+
 Expr multiply_quantized_multiplier(Expr x, Expr q, Expr shift) {
-    return rounding_shift_right(saturating_rounding_doubling_high_multiply(x, q), shift);
+    return rounding_divide_by_power_of_two(saturating_rounding_doubling_high_multiply(x, q), shift);
 }
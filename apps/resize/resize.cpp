@@ -13,6 +13,10 @@
 #include "resize_cubic_float32_down.h"
 #include "resize_linear_float32_down.h"
 #include "resize_lanczos_float32_down.h"
+#include "resize_box_float32_pyramid.h"
+#include "resize_cubic_float32_pyramid.h"
+#include "resize_linear_float32_pyramid.h"
+#include "resize_lanczos_float32_pyramid.h"
 #include "resize_box_uint8_up.h"
 #include "resize_cubic_uint8_up.h"
 #include "resize_linear_uint8_up.h"
@@ -21,6 +25,10 @@
 #include "resize_cubic_uint8_down.h"
 #include "resize_linear_uint8_down.h"
 #include "resize_lanczos_uint8_down.h"
+#include "resize_box_uint8_pyramid.h"
+#include "resize_cubic_uint8_pyramid.h"
+#include "resize_linear_uint8_pyramid.h"
+#include "resize_lanczos_uint8_pyramid.h"
 #include "resize_box_uint16_up.h"
 #include "resize_cubic_uint16_up.h"
 #include "resize_linear_uint16_up.h"
@@ -29,6 +37,10 @@
 #include "resize_cubic_uint16_down.h"
 #include "resize_linear_uint16_down.h"
 #include "resize_lanczos_uint16_down.h"
+#include "resize_box_uint16_pyramid.h"
+#include "resize_cubic_uint16_pyramid.h"
+#include "resize_linear_uint16_pyramid.h"
+#include "resize_lanczos_uint16_pyramid.h"
 
 std::string infile, outfile, input_type, interpolation_type;
 float scale_factor = 1.0f;
@@ -80,7 +92,7 @@ int main(int argc, char **argv) {
     int out_width = in.width() * scale_factor;
     int out_height = in.height() * scale_factor;
 
-    decltype(&resize_box_float32_up) variants[3][2][4] =
+    decltype(&resize_box_float32_up) variants[3][3][4] =
     {
         {{&resize_box_float32_up,
           &resize_cubic_float32_up,
@@ -89,7 +101,11 @@ int main(int argc, char **argv) {
          {&resize_box_float32_down,
           &resize_cubic_float32_down,
           &resize_linear_float32_down,
-          &resize_lanczos_float32_down}},
+          &resize_lanczos_float32_down},
+         {&resize_box_float32_pyramid,
+          &resize_cubic_float32_pyramid,
+          &resize_linear_float32_pyramid,
+          &resize_lanczos_float32_pyramid}},
         {{&resize_box_uint8_up,
           &resize_cubic_uint8_up,
           &resize_linear_uint8_up,
@@ -97,7 +113,11 @@ int main(int argc, char **argv) {
          {&resize_box_uint8_down,
           &resize_cubic_uint8_down,
           &resize_linear_uint8_down,
-          &resize_lanczos_uint8_down}},
+          &resize_lanczos_uint8_down},
+         {&resize_box_uint8_pyramid,
+          &resize_cubic_uint8_pyramid,
+          &resize_linear_uint8_pyramid,
+          &resize_lanczos_uint8_pyramid}},
         {{&resize_box_uint16_up,
           &resize_cubic_uint16_up,
           &resize_linear_uint16_up,
@@ -105,7 +125,11 @@ int main(int argc, char **argv) {
          {&resize_box_uint16_down,
           &resize_cubic_uint16_down,
           &resize_linear_uint16_down,
-          &resize_lanczos_uint16_down}}
+          &resize_lanczos_uint16_down},
+         {&resize_box_uint16_pyramid,
+          &resize_cubic_uint16_pyramid,
+          &resize_linear_uint16_pyramid,
+          &resize_lanczos_uint16_pyramid}}
     };
 
     int interpolation_idx = 0;
@@ -122,7 +146,9 @@ int main(int argc, char **argv) {
         show_usage_and_exit();
     }
 
-    int upsample_idx = scale_factor > 1.0f ? 0 : 1;
+    // Large downsampling ratios use the variants that box filter the
+    // input first.
+    int upsample_idx = scale_factor > 1.0f ? 0 : scale_factor <= 0.25f ? 2 : 1;
 
     // Instead of just adapting to the actual type of the input, we'll
     // convert it to the requested type to make it easier to benchmark
@@ -66,6 +66,13 @@ public:
     // resample in x and in y).
     GeneratorParam<bool> upsample{"upsample", false};
 
+    // For large downsampling ratios, first box filter the input by
+    // the largest integer factor that leaves at least a 2x downsample
+    // to the interpolation kernel. This bounds the number of taps the
+    // kernel touches per output pixel, instead of widening it with
+    // the ratio. Ignored when upsampling.
+    GeneratorParam<bool> pyramid{"pyramid", false};
+
     Input<Buffer<>> input{"input", 3};
     Input<float> scale_factor{"scale_factor"};
     Output<Buffer<>> output{"output", 3};
@@ -74,32 +81,64 @@ public:
     Var x, y, c, k;
 
     // Intermediate Funcs
-    Func as_float, clamped, resized_x, resized_y,
+    Func as_float, as_int16, clamped, box_y, box, resized_x, resized_y,
         unnormalized_kernel_x, unnormalized_kernel_y,
         kernel_x, kernel_y,
         kernel_sum_x, kernel_sum_y;
 
+    // The 8-bit path resamples in fixed point. The kernel weights have
+    // kWeightBits fractional bits, and the result of the first resample
+    // is kept in 16 bits with kIntermediateBits fractional bits, so each
+    // pass is a sum of 16-bit x 16-bit products (pmaddwd on x86,
+    // vmlal.s16 on ARM).
+    static constexpr int kWeightBits = 14;
+    static constexpr int kIntermediateBits = 6;
+
     void generate() {
+        const bool use_pyramid = (bool)pyramid && !(bool)upsample;
+        const bool fixed_point = input.type() == UInt(8);
 
         clamped = BoundaryConditions::repeat_edge(input,
                  {{input.dim(0).min(), input.dim(0).extent()},
                   {input.dim(1).min(), input.dim(1).extent()}});
 
-        // Handle different types by just casting to float
-        as_float(x, y, c) = cast<float>(clamped(x, y, c));
+        // The image the interpolation kernel resamples, and its scale
+        // factor to the output.
+        Func source = clamped;
+        Expr scale = scale_factor;
+        if (use_pyramid) {
+            Expr factor = max(1, cast<int>(floor(0.5f / scale_factor)));
+            RDom rf(0, factor);
+            if (input.type().is_float()) {
+                box_y(x, y, c) = sum(clamped(x, y * factor + rf, c), "box_y");
+                box(x, y, c) = sum(box_y(x * factor + rf, y, c), "box") / cast<float>(factor * factor);
+            } else {
+                box_y(x, y, c) = sum(cast<uint32_t>(clamped(x, y * factor + rf, c)), "box_y");
+                Expr area = cast<uint32_t>(factor * factor);
+                box(x, y, c) = cast(input.type(),
+                                    (sum(box_y(x * factor + rf, y, c), "box") + area / 2) / area);
+            }
+            source = box;
+            scale = scale_factor * factor;
+        }
+
+        // Handle different types by just casting to float, or to
+        // int16 for the fixed point path.
+        as_float(x, y, c) = cast<float>(source(x, y, c));
+        as_int16(x, y, c) = cast<int16_t>(source(x, y, c));
 
         // For downscaling, widen the interpolation kernel to perform lowpass
         // filtering.
 
-        Expr kernel_scaling = upsample ? Expr(1.0f) : scale_factor;
+        Expr kernel_scaling = upsample ? Expr(1.0f) : scale;
 
         Expr kernel_radius = 0.5f * kernel_info[interpolation_type].taps / kernel_scaling;
 
         Expr kernel_taps = ceil(kernel_info[interpolation_type].taps / kernel_scaling);
 
         // source[xy] are the (non-integer) coordinates inside the source image
-        Expr sourcex = (x + 0.5f) / scale_factor - 0.5f;
-        Expr sourcey = (y + 0.5f) / scale_factor - 0.5f;
+        Expr sourcex = (x + 0.5f) / scale - 0.5f;
+        Expr sourcey = (y + 0.5f) / scale - 0.5f;
 
         // Initialize interpolation kernels. Since we allow an arbitrary
         // scaling factor, the filter coefficients are different for each x
@@ -116,8 +155,52 @@ public:
         kernel_sum_x(x) = sum(unnormalized_kernel_x(x, r), "kernel_sum_x");
         kernel_sum_y(y) = sum(unnormalized_kernel_y(y, r), "kernel_sum_y");
 
-        kernel_x(x, k) = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
-        kernel_y(y, k) = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
+        Expr weight_x = unnormalized_kernel_x(x, k) / kernel_sum_x(x);
+        Expr weight_y = unnormalized_kernel_y(y, k) / kernel_sum_y(y);
+
+        if (fixed_point) {
+            // Quantize the weights, and pad the kernels with a zero
+            // weight to an even number of taps, so the taps can be
+            // summed in pairs.
+            Expr tap_pairs = (cast<int>(kernel_taps) + 1) / 2;
+            kernel_x(x, k) = select(k < kernel_taps,
+                                    cast<int16_t>(round(weight_x * (1 << kWeightBits))), cast<int16_t>(0));
+            kernel_y(y, k) = select(k < kernel_taps,
+                                    cast<int16_t>(round(weight_y * (1 << kWeightBits))), cast<int16_t>(0));
+
+            RDom rp(0, tap_pairs);
+            Expr r0 = 2 * rp, r1 = 2 * rp + 1;
+            const int intermediate_shift = kWeightBits - kIntermediateBits;
+            const int output_shift = kWeightBits + kIntermediateBits;
+
+            Func resized;
+            if (upsample) {
+                Expr sum_x = sum(cast<int32_t>(kernel_x(x, r0)) * as_int16(r0 + beginx, y, c) +
+                                 cast<int32_t>(kernel_x(x, r1)) * as_int16(r1 + beginx, y, c), "resized_x");
+                resized_x(x, y, c) =
+                    saturating_cast<int16_t>((sum_x + (1 << (intermediate_shift - 1))) >> intermediate_shift);
+                resized_y(x, y, c) =
+                    sum(cast<int32_t>(kernel_y(y, r0)) * resized_x(x, r0 + beginy, c) +
+                        cast<int32_t>(kernel_y(y, r1)) * resized_x(x, r1 + beginy, c), "resized_y");
+                resized = resized_y;
+            } else {
+                Expr sum_y = sum(cast<int32_t>(kernel_y(y, r0)) * as_int16(x, r0 + beginy, c) +
+                                 cast<int32_t>(kernel_y(y, r1)) * as_int16(x, r1 + beginy, c), "resized_y");
+                resized_y(x, y, c) =
+                    saturating_cast<int16_t>((sum_y + (1 << (intermediate_shift - 1))) >> intermediate_shift);
+                resized_x(x, y, c) =
+                    sum(cast<int32_t>(kernel_x(x, r0)) * resized_y(r0 + beginx, y, c) +
+                        cast<int32_t>(kernel_x(x, r1)) * resized_y(r1 + beginx, y, c), "resized_x");
+                resized = resized_x;
+            }
+
+            output(x, y, c) = saturating_cast<uint8_t>(
+                (resized(x, y, c) + (1 << (output_shift - 1))) >> output_shift);
+            return;
+        }
+
+        kernel_x(x, k) = weight_x;
+        kernel_y(y, k) = weight_y;
 
         // Perform separable resizing. The resize in x vectorizes
         // poorly compared to the resize in y, so do it first if we're
@@ -142,6 +225,16 @@ public:
 
     void schedule() {
         Var xi, yi;
+        if ((bool)pyramid && !(bool)upsample) {
+            box
+                .compute_root()
+                .parallel(y)
+                .vectorize(x, 8);
+            box_y
+                .compute_at(box, y)
+                .vectorize(x, 8);
+        }
+
         unnormalized_kernel_x
             .compute_at(kernel_x, x)
             .vectorize(x);
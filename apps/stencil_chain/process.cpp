@@ -31,18 +31,22 @@ int main(int argc, char **argv) {
     stencil_chain(input, output);
 
     // Timing code
+    BenchmarkConfig config;
+    config.min_samples = timing;
 
     // Manually-tuned version
-    double best_manual = benchmark(timing, 1, [&]() {
+    config.name = "stencil_chain_manual";
+    double best_manual = benchmark([&]() {
         stencil_chain(input, output);
-    });
+    }, config);
     printf("Manually-tuned time: %gms\n", best_manual * 1e3);
 
     #ifndef NO_AUTO_SCHEDULE
     // Auto-scheduled version
-    double best_auto = benchmark(timing, 1, [&]() {
+    config.name = "stencil_chain_auto";
+    double best_auto = benchmark([&]() {
         stencil_chain_auto_schedule(input, output);
-    });
+    }, config);
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
     #endif
 
@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# $1 = baseline benchmark results
+# $2 = new benchmark results
+# $3 = fractional slowdown that counts as a regression [default = 0.1]
+#
+# Both files hold one line of JSON per benchmark, as written by
+# halide_benchmark.h when HL_BENCHMARK_JSON is set. Benchmarks are
+# matched by name and compared by their best time per iteration.
+# Exits with an error if any benchmark regressed.
+
+THRESHOLD=${3:-0.1}
+
+awk -v threshold="${THRESHOLD}" '
+function field(line, key,    s) {
+    if (!match(line, "\"" key "\": (\"[^\"]*\"|[^,}]*)")) {
+        return ""
+    }
+    s = substr(line, RSTART, RLENGTH)
+    sub(/^"[^"]*": /, "", s)
+    gsub(/"/, "", s)
+    return s
+}
+FNR == NR {
+    baseline[field($0, "name")] = field($0, "wall_time")
+    next
+}
+{
+    name = field($0, "name")
+    t = field($0, "wall_time")
+    seen[name] = 1
+    if (!(name in baseline)) {
+        printf("%-32s %12g s     (no baseline)\n", name, t)
+        next
+    }
+    change = t / baseline[name] - 1
+    status = ""
+    if (change > threshold) {
+        status = "  REGRESSION"
+        failed++
+    }
+    printf("%-32s %12g s %+7.1f%%%s\n", name, t, change * 100, status)
+}
+END {
+    for (name in baseline) {
+        if (!(name in seen)) {
+            printf("%-32s missing from results\n", name)
+        }
+    }
+    if (failed) {
+        printf("%d benchmark(s) regressed by more than %g%%\n", failed, threshold * 100)
+        exit 1
+    }
+}' "$1" "$2"
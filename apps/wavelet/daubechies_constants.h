@@ -6,4 +6,11 @@ const float D1 = 0.83651630373780772f;
 const float D2 = 0.22414386804201339f;
 const float D3 = -0.12940952255126034f;
 
+// The lifting steps that factor the same filter pair.
+const float P0 = 1.7320508075688772f;   // sqrt(3)
+const float U0 = 0.4330127018922193f;   // sqrt(3)/4
+const float U1 = -0.0669872981077807f;  // (sqrt(3) - 2)/4
+const float K0 = 0.5176380902050414f;   // (sqrt(3) - 1)/sqrt(2)
+const float K1 = 1.9318516525781364f;   // (sqrt(3) + 1)/sqrt(2)
+
 #endif  // DAUBECHIES_CONSTANTS_H_
@@ -0,0 +1,67 @@
+#include "Halide.h"
+
+#include "daubechies_constants.h"
+
+namespace {
+
+Halide::Var x("x"), y("y"), yo("yo"), yi("yi");
+
+// A multi-level Daubechies transform along x, computed in place with
+// the lifting scheme. At level j the samples still in play sit every
+// 2^j pixels: the even ones become the smooth coefficients and the odd
+// ones the details. So the output has the coefficients of every level
+// interleaved, in the same buffer as the input layout, with the final
+// smooth coefficients at the multiples of 2^levels.
+class lifting_daubechies_x : public Halide::Generator<lifting_daubechies_x> {
+public:
+    GeneratorParam<int> levels{"levels", 3, 1, 16};
+
+    Input<Buffer<float>> in_{"in" , 2};
+    Output<Buffer<float>> out_{"out" , 2};
+
+    void generate() {
+        Func buf("buf");
+        buf(x, y) = in_(x, y);
+
+        const int vec = natural_vector_size<float>();
+        Expr x0 = in_.dim(0).min();
+        Expr width = in_.dim(0).extent();
+
+        // Each update of buf reads only the samples of the other
+        // parity, so they may safely be vectorized.
+        int stage = 0;
+        auto vectorize_update = [&](const RDom &r) {
+            buf.update(stage++).allow_race_conditions().vectorize(r.x, vec);
+        };
+
+        for (int j = 0; j < levels; j++) {
+            const int stride = 1 << (j + 1);
+            Expr pairs = width / stride;
+            RDom r(0, pairs, "r" + std::to_string(j));
+            auto even = [&](Expr n) { return x0 + n * stride; };
+            auto odd = [&](Expr n) { return x0 + n * stride + stride / 2; };
+            Expr prev = max(r - 1, 0);
+            Expr next = min(r + 1, pairs - 1);
+
+            buf(even(r), y) += P0 * buf(odd(r), y);
+            vectorize_update(r);
+            buf(odd(r), y) -= U0 * buf(even(r), y) + U1 * buf(even(prev), y);
+            vectorize_update(r);
+            buf(even(r), y) = K0 * (buf(even(r), y) - buf(odd(next), y));
+            vectorize_update(r);
+            buf(odd(r), y) *= K1;
+            vectorize_update(r);
+        }
+
+        out_(x, y) = buf(x, y);
+
+        // Run every level on one row at a time, so the row stays in
+        // cache for the whole transform.
+        out_.split(y, yo, yi, 8).parallel(yo).vectorize(x, vec);
+        buf.compute_at(out_, yi).vectorize(x, vec);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(lifting_daubechies_x, lifting_daubechies_x)
@@ -1,9 +1,13 @@
+#include <algorithm>
+#include <cmath>
 #include <stdio.h>
 
 #include "haar_x.h"
 #include "inverse_haar_x.h"
 #include "daubechies_x.h"
 #include "inverse_daubechies_x.h"
+#include "lifting_daubechies_x.h"
+#include "inverse_lifting_daubechies_x.h"
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
@@ -49,6 +53,37 @@ void save_transformed(Buffer<T> t, const std::string& filename) {
     printf("Saved %s\n", filename.c_str());
 }
 
+// The lifting transforms leave the coefficients of each level
+// interleaved in place. Gather them into the usual layout, with the
+// smooth coefficients on the left and the details of each level to
+// their right, finest last.
+template<typename T>
+void save_lifted(Buffer<T> t, int levels, const std::string& filename) {
+    Buffer<T> rearranged(t.width(), t.height(), 1);
+    rearranged.fill(0.0f);
+    const float smooth_gain = std::sqrt((float)(1 << levels));
+    for (int y = 0; y < t.height(); y++) {
+        for (int x = 0; x < t.width(); x++) {
+            // The number of trailing zeros of x says which level a
+            // coefficient belongs to.
+            int tz = 0;
+            while (tz < levels && ((x >> tz) & 1) == 0) {
+                tz++;
+            }
+            if (tz == levels) {
+                rearranged(x >> levels, y, 0) = clamp(t(x, y) / smooth_gain, 0.0f, 1.0f);
+            } else {
+                int pos = (t.width() >> (tz + 1)) + (x >> (tz + 1));
+                if (pos < t.width()) {
+                    rearranged(pos, y, 0) = clamp(t(x, y)*4.f + 0.5f, 0.0f, 1.0f);
+                }
+            }
+        }
+    }
+    convert_and_save_image(rearranged, filename);
+    printf("Saved %s\n", filename.c_str());
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -73,6 +108,24 @@ int main(int argc, char **argv) {
     _assert(inverse_daubechies_x(transformed, inverse_transformed) == 0, "inverse_daubechies_x failed");
     save_untransformed(inverse_transformed, dirname + "/inverse_daubechies_x.png");
 
+    // The transform fuses three levels, matching the default value of
+    // the levels GeneratorParam.
+    const int levels = 3;
+    Buffer<float> lifted(input.width(), input.height());
+    Buffer<float> inverse_lifted(input.width(), input.height());
+
+    _assert(lifting_daubechies_x(input, lifted) == 0, "lifting_daubechies_x failed");
+    save_lifted(lifted, levels, dirname + "/lifting_daubechies_x.png");
+
+    _assert(inverse_lifting_daubechies_x(lifted, inverse_lifted) == 0, "inverse_lifting_daubechies_x failed");
+    save_untransformed(inverse_lifted, dirname + "/inverse_lifting_daubechies_x.png");
+
+    float max_error = 0;
+    inverse_lifted.for_each_element([&](int x, int y) {
+        max_error = std::max(max_error, std::abs(inverse_lifted(x, y) - input(x, y)));
+    });
+    _assert(max_error < 1e-4f, "inverse_lifting_daubechies_x doesn't reconstruct the input: error %f\n", max_error);
+
     printf("Done.\n");
     return 0;
 }
@@ -505,6 +505,23 @@ function(_halide_runtime_target_name HALIDE_TARGET OUTVAR)
         tsan
         asan
         check_unsafe_promises
+        batch
+        unchecked_entry
+        zero_copy
+        avx512_vnni
+        arm_dot_prod
+        arm_fp16
+        cuda_capability_70
+        arm_sve
+        minimize_memory
+        vulkan
+        cache_shape_checks
+        fast_float16_conversions
+        gpu_persistent_threads
+        concurrent_stages
+        avx512_256
+        power_arch_3_00
+        deterministic_reductions
       )
     # Synthesize a one-or-two-char abbreviation based on the feature's position
     # in the KNOWN_FEATURES list.
@@ -83,6 +83,32 @@ def test():
             for z in range(input_3d.shape[2]):
                 assert output_3d[x, y, z] == input_3d[x, y, z] + constant_i8
 
+    # Strided slices are used in place, and the batch entry point runs
+    # the pipeline once per argument set.
+    args = [
+        constant_u1,
+        constant_u8, constant_u16, constant_u32, constant_u64,
+        constant_i8, constant_i16, constant_i32, constant_i64,
+        constant_float, constant_double,
+        input_u8, input_u16, input_u32, input_u64,
+        input_i8, input_i16, input_i32, input_i64,
+        input_float, input_double, input_2d, input_3d,
+        output_u8, output_u16, output_u32, output_u64,
+        output_i8, output_i16, output_i32, output_i64,
+        output_float, output_double, output_2d, output_3d,
+    ]
+    # (Halide requires the innermost dimension to be dense by default.)
+    wide_3d = numpy.zeros((4, 2, 2), dtype=numpy.int8)
+    strided_args = list(args)
+    strided_args[-1] = wide_3d[::2]
+    strided_args[5] = constant_i8 + 1
+    addconstant.addconstant_batch([args, strided_args])
+    for x in range(input_3d.shape[0]):
+        for y in range(input_3d.shape[1]):
+            for z in range(input_3d.shape[2]):
+                assert wide_3d[2 * x, y, z] == input_3d[x, y, z] + constant_i8 + 1
+                assert wide_3d[2 * x + 1, y, z] == 0
+
 
 if __name__ == "__main__":
   test()
@@ -84,6 +84,32 @@ def test_buffer_to_ndarray():
     assert cropped_array_copied[0, 2] == 3
 
 
+def test_strided_ndarray_to_buffer():
+    a0 = np.arange(200 * 300, dtype=np.int64).reshape((200, 300))
+
+    # Slices of an ndarray are shared too, with their strides.
+    s0 = a0[10:50:2, ::3]
+    b0 = hl.Buffer(s0)
+    assert b0.type() == hl.Int(64)
+    assert b0.dim(0).extent() == 20
+    assert b0.dim(0).stride() == 600
+    assert b0.dim(1).extent() == 100
+    assert b0.dim(1).stride() == 3
+    assert b0[3, 4] == a0[16, 12]
+
+    b0[3, 4] = -1
+    assert a0[16, 12] == -1
+
+    # Strides that aren't a whole number of elements can't be wrapped.
+    packed = np.zeros(10, dtype=[('a', np.int32), ('b', np.int8)])['a']
+    try:
+        hl.Buffer(packed)
+    except ValueError:
+        pass
+    else:
+        assert False, "Expected a ValueError"
+
+
 def _assert_fn(e):
     assert e
 
@@ -121,6 +147,7 @@ def test_bufferinfo_sharing():
 if __name__ == "__main__":
     test_ndarray_to_buffer()
     test_buffer_to_ndarray()
+    test_strided_ndarray_to_buffer()
     test_for_each_element()
     test_fill_all_equal()
     test_bufferinfo_sharing()
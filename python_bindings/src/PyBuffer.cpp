@@ -107,30 +107,35 @@ std::string type_to_format_descriptor(const Type &type) {
     return std::string();
 }
 
-Type format_descriptor_to_type(const std::string &fd) {
-
-    #define HANDLE_BUFFER_TYPE(TYPE) \
-        if (fd == py::format_descriptor<TYPE>::format()) return type_of<TYPE>();
-
-    HANDLE_BUFFER_TYPE(bool)
-    HANDLE_BUFFER_TYPE(uint8_t)
-    HANDLE_BUFFER_TYPE(uint16_t)
-    HANDLE_BUFFER_TYPE(uint32_t)
-    HANDLE_BUFFER_TYPE(uint64_t)
-    HANDLE_BUFFER_TYPE(int8_t)
-    HANDLE_BUFFER_TYPE(int16_t)
-    HANDLE_BUFFER_TYPE(int32_t)
-    HANDLE_BUFFER_TYPE(int64_t)
-    HANDLE_BUFFER_TYPE(float)
-    HANDLE_BUFFER_TYPE(double)
-
-    #undef HANDLE_BUFFER_TYPE
+// Work out the element type of a buffer-protocol object. The format
+// characters for integers depend on the platform (e.g. NumPy reports
+// int64 as 'l' on Linux and 'q' on Windows), so go by the kind of
+// element and its size instead of the exact string.
+Type buffer_info_to_type(const py::buffer_info &info) {
+    std::string fd = info.format;
+    // Native or little-endian byte order and alignment are fine.
+    size_t start = 0;
+    while (start < fd.size() && (fd[start] == '@' || fd[start] == '=' || fd[start] == '<')) {
+        start++;
+    }
+    if (fd.size() == start + 1) {
+        const int bits = (int) info.itemsize * 8;
+        const char c = fd[start];
+        if (c == '?') {
+            return Bool();
+        } else if (c == 'b' || c == 'h' || c == 'i' || c == 'l' || c == 'q' || c == 'n') {
+            return Int(bits);
+        } else if (c == 'B' || c == 'H' || c == 'I' || c == 'L' || c == 'Q' || c == 'N') {
+            return UInt(bits);
+        } else if (c == 'e' || c == 'f' || c == 'd') {
+            return Float(bits);
+        }
+    }
 
-    throw py::value_error("Unsupported Buffer<> type.");
+    throw py::value_error("Unsupported Buffer<> type: " + fd);
     return Type();
 }
 
-
 py::object buffer_getitem_operator(Buffer<> &buf, const std::vector<int> &pos) {
     if ((size_t) pos.size() != (size_t) buf.dimensions()) {
         throw py::value_error("Incorrect number of dimensions.");
@@ -193,19 +198,28 @@ class PyBuffer : public Buffer<> {
     py::buffer_info info;
 
     static std::vector<halide_dimension_t> make_dim_vec(const py::buffer_info &info) {
-        const Type t = format_descriptor_to_type(info.format);
+        const Type t = buffer_info_to_type(info);
         std::vector<halide_dimension_t> dims;
         dims.reserve(info.ndim);
         for (int i = 0; i < info.ndim; i++) {
-            // TODO: check for ssize_t -> int32_t overflow
-            dims.push_back({0, (int32_t) info.shape[i], (int32_t) (info.strides[i] / t.bytes())});
+            // The Buffer<> points at the same memory, so the layout
+            // must be expressible in whole elements and 32-bit ints.
+            if (info.strides[i] % t.bytes() != 0) {
+                throw py::value_error("Buffer strides must be a multiple of the element size.");
+            }
+            const ssize_t extent = info.shape[i];
+            const ssize_t stride = info.strides[i] / t.bytes();
+            if (extent > INT32_MAX || stride > INT32_MAX || stride < INT32_MIN) {
+                throw py::value_error("Buffer is too large to wrap as a Buffer<>.");
+            }
+            dims.push_back({0, (int32_t) extent, (int32_t) stride});
         }
         return dims;
     }
 
     PyBuffer(py::buffer_info &&info, const std::string &name)
         : Buffer<>(
-            format_descriptor_to_type(info.format),
+            buffer_info_to_type(info),
             info.ptr,
             (int) info.ndim,
             make_dim_vec(info).data(),
@@ -268,7 +282,8 @@ void define_buffer(py::module &m) {
         })
 
         // This allows us to use any buffer-like python entity to create a Buffer<>
-        // (most notably, an ndarray)
+        // (most notably, an ndarray). The Buffer<> always shares the memory of the
+        // python object, whatever its strides, and keeps it alive.
         .def(py::init_alias<py::buffer, const std::string &>(), py::arg("buffer"), py::arg("name") = "")
         .def(py::init_alias<>())
         .def(py::init_alias<const Buffer<> &>())
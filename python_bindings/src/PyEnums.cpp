@@ -39,6 +39,7 @@ void define_enums(py::module &m) {
         .value("Stack", MemoryType::Stack)
         .value("Register", MemoryType::Register)
         .value("GPUShared", MemoryType::GPUShared)
+        .value("VTCM", MemoryType::VTCM)
     ;
 
     py::enum_<NameMangling>(m, "NameMangling")
@@ -53,6 +54,13 @@ void define_enums(py::module &m) {
         .value("NonFaulting", PrefetchBoundStrategy::NonFaulting)
     ;
 
+    py::enum_<PrefetchHint>(m, "PrefetchHint")
+        .value("L1", PrefetchHint::L1)
+        .value("L2", PrefetchHint::L2)
+        .value("L3", PrefetchHint::L3)
+        .value("NonTemporal", PrefetchHint::NonTemporal)
+    ;
+
     py::enum_<StmtOutputFormat>(m, "StmtOutputFormat")
         .value("Text", StmtOutputFormat::Text)
         .value("HTML", StmtOutputFormat::HTML);
@@ -61,6 +69,7 @@ void define_enums(py::module &m) {
         .value("RoundUp", TailStrategy::RoundUp)
         .value("GuardWithIf", TailStrategy::GuardWithIf)
         .value("ShiftInwards", TailStrategy::ShiftInwards)
+        .value("Predicate", TailStrategy::Predicate)
         .value("Auto", TailStrategy::Auto)
     ;
 
@@ -138,6 +147,23 @@ void define_enums(py::module &m) {
         .value("TSAN", Target::Feature::TSAN)
         .value("ASAN", Target::Feature::ASAN)
         .value("CheckUnsafePromises", Target::Feature::CheckUnsafePromises)
+        .value("Batch", Target::Feature::Batch)
+        .value("UncheckedEntry", Target::Feature::UncheckedEntry)
+        .value("ZeroCopy", Target::Feature::ZeroCopy)
+        .value("AVX512_VNNI", Target::Feature::AVX512_VNNI)
+        .value("ARMDotProd", Target::Feature::ARMDotProd)
+        .value("ARMFp16", Target::Feature::ARMFp16)
+        .value("CUDACapability70", Target::Feature::CUDACapability70)
+        .value("ARMSVE", Target::Feature::ARMSVE)
+        .value("MinimizeMemory", Target::Feature::MinimizeMemory)
+        .value("Vulkan", Target::Feature::Vulkan)
+        .value("CacheShapeChecks", Target::Feature::CacheShapeChecks)
+        .value("FastFloat16Conversions", Target::Feature::FastFloat16Conversions)
+        .value("GPUPersistentThreads", Target::Feature::GPUPersistentThreads)
+        .value("ConcurrentStages", Target::Feature::ConcurrentStages)
+        .value("AVX512_256", Target::Feature::AVX512_256)
+        .value("POWER_ARCH_3_00", Target::Feature::POWER_ARCH_3_00)
+        .value("DeterministicReductions", Target::Feature::DeterministicReductions)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
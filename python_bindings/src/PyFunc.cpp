@@ -46,6 +46,19 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Run a realize call with the GIL released, so that other Python
+// threads can run while the pipeline compiles and runs, and convert
+// the result to Python objects once the GIL is held again.
+template<typename RealizeFn>
+py::object realize_without_gil(RealizeFn realize) {
+    std::unique_ptr<Realization> r;
+    {
+        py::gil_scoped_release release;
+        r.reset(new Realization(realize()));
+    }
+    return realization_to_object(*r);
+}
+
 }  // namespace
 
 void define_func(py::module &m) {
@@ -83,36 +96,36 @@ void define_func(py::module &m) {
         .def(py::init([](const ImageParam &im) -> Func { return im; }))
 
         .def("realize", [](Func &f, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            f.realize(buffer, target);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            f.realize(buffer, target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(), py::call_guard<py::gil_scoped_release>())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Func &f, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            f.realize(Realization(buffers), t);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            f.realize(Realization(buffers), t, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(), py::call_guard<py::gil_scoped_release>())
 
         .def("realize", [](Func &f, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(sizes, target, param_map));
+            return realize_without_gil([&]() { return f.realize(sizes, target, param_map); });
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, target, param_map));
+            return realize_without_gil([&]() { return f.realize(x_size, target, param_map); });
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, target, param_map));
+            return realize_without_gil([&]() { return f.realize(x_size, y_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, target, param_map));
+            return realize_without_gil([&]() { return f.realize(x_size, y_size, z_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Func &f, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(f.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realize_without_gil([&]() { return f.realize(x_size, y_size, z_size, w_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("defined", &Func::defined)
@@ -149,7 +162,9 @@ void define_func(py::module &m) {
         .def("store_at", (Func &(Func::*)(LoopLevel)) &Func::store_at,
             py::arg("loop_level"))
 
-        .def("memoize", &Func::memoize)
+        .def("memoize", &Func::memoize, py::arg("budget") = 0)
+        .def("approximate_math", &Func::approximate_math, py::arg("max_ulps"))
+        .def("cpu_variants", &Func::cpu_variants, py::arg("variants"))
         .def("compute_inline", &Func::compute_inline)
         .def("compute_root", &Func::compute_root)
         .def("store_root", &Func::store_root)
@@ -167,6 +182,13 @@ void define_func(py::module &m) {
             (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) &Func::compile_to_bitcode,
             py::arg("filename"), py::arg("arguments"), py::arg("target") = get_target_from_environment())
 
+        .def("compile_to_serialized_pipeline",
+            (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) &Func::compile_to_serialized_pipeline,
+            py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_jit_target_from_environment())
+        .def("compile_to_serialized_pipeline",
+            (void (Func::*)(const std::string &, const std::vector<Argument> &, const Target &target)) &Func::compile_to_serialized_pipeline,
+            py::arg("filename"), py::arg("arguments"), py::arg("target") = get_jit_target_from_environment())
+
         .def("compile_to_llvm_assembly",
             (void (Func::*)(const std::string &, const std::vector<Argument> &, const std::string &, const Target &target)) &Func::compile_to_llvm_assembly,
             py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
@@ -213,7 +235,8 @@ void define_func(py::module &m) {
         .def("compile_to_module", &Func::compile_to_module,
             py::arg("arguments"), py::arg("fn_name") = "", py::arg("target") = get_target_from_environment())
 
-        .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment())
+        .def("compile_jit", &Func::compile_jit, py::arg("target") = get_jit_target_from_environment(),
+            py::call_guard<py::gil_scoped_release>())
 
         .def("has_update_definition", &Func::has_update_definition)
         .def("num_update_definitions", &Func::num_update_definitions)
@@ -237,6 +260,7 @@ void define_func(py::module &m) {
         .def("debug_to_file", &Func::debug_to_file)
 
         .def("is_extern", &Func::is_extern)
+        .def("extern_proxy", &Func::extern_proxy, py::arg("footprint"))
         .def("extern_function_name", &Func::extern_function_name)
 
         .def("define_extern", (void (Func::*)(const std::string &, const std::vector<ExternFuncArgument> &,
@@ -332,6 +356,9 @@ void define_func(py::module &m) {
         .def("align_storage", &Func::align_storage,
             py::arg("dim"), py::arg("alignment"))
 
+        .def("pad_storage", &Func::pad_storage,
+            py::arg("dim"), py::arg("padding"))
+
         .def("fold_storage", &Func::fold_storage,
             py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
 
@@ -19,6 +19,7 @@
 #include "PyParam.h"
 #include "PyPipeline.h"
 #include "PyRDom.h"
+#include "PySerializedPipeline.h"
 #include "PyTarget.h"
 #include "PyTuple.h"
 #include "PyType.h"
@@ -51,6 +52,7 @@ PYBIND11_MODULE(HALIDE_PYBIND_MODULE_NAME, m) {
     define_module(m);
     define_func(m);
     define_pipeline(m);
+    define_serialized_pipeline(m);
     define_inline_reductions(m);
     define_lambda(m);
     define_operators(m);
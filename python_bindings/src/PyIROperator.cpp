@@ -165,6 +165,7 @@ void define_operators(py::module &m) {
     m.def("random_float", (Expr (*)(Expr)) &random_float, py::arg("seed"));
     m.def("random_uint", (Expr (*)(Expr)) &random_uint, py::arg("seed"));
     m.def("random_int", (Expr (*)(Expr)) &random_int, py::arg("seed"));
+    m.def("random_uint", (Expr (*)(int, Expr)) &random_uint, py::arg("bits"), py::arg("seed") = Expr());
     m.def("undef", (Expr (*)(Type)) &undef);
     m.def("memoize_tag", [](Expr result, py::args cache_key_values) -> Expr {
         return Internal::memoize_tag_helper(result, args_to_vector<Expr>(cache_key_values));
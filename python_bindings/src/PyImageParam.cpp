@@ -33,6 +33,7 @@ void define_image_param(py::module &m) {
         .def("dim", (Dimension (OutputImageParam::*)(int)) &OutputImageParam::dim, py::arg("dimension"), py::keep_alive<0, 1>())
         .def("host_alignment", &OutputImageParam::host_alignment)
         .def("set_host_alignment", &OutputImageParam::set_host_alignment)
+        .def("set_static_shape", &OutputImageParam::set_static_shape, py::arg("extents"))
         .def("dimensions", &OutputImageParam::dimensions)
         .def("left", &OutputImageParam::left)
         .def("right", &OutputImageParam::right)
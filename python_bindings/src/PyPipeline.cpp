@@ -17,6 +17,19 @@ py::object realization_to_object(const Realization &r) {
     return to_python_tuple(r);
 }
 
+// Run a realize call with the GIL released, so that other Python
+// threads can run while the pipeline compiles and runs, and convert
+// the result to Python objects once the GIL is held again.
+template<typename RealizeFn>
+py::object realize_without_gil(RealizeFn realize) {
+    std::unique_ptr<Realization> r;
+    {
+        py::gil_scoped_release release;
+        r.reset(new Realization(realize()));
+    }
+    return realization_to_object(*r);
+}
+
 }  // namespace
 
 void define_pipeline(py::module &m) {
@@ -55,6 +68,8 @@ void define_pipeline(py::module &m) {
 
         .def("compile_to_bitcode", &Pipeline::compile_to_bitcode,
             py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
+        .def("compile_to_serialized_pipeline", &Pipeline::compile_to_serialized_pipeline,
+            py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_jit_target_from_environment())
         .def("compile_to_llvm_assembly", &Pipeline::compile_to_llvm_assembly,
             py::arg("filename"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
         .def("compile_to_object", &Pipeline::compile_to_object,
@@ -80,41 +95,41 @@ void define_pipeline(py::module &m) {
             py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment(), py::arg("linkage") = LinkageType::ExternalPlusMetadata)
 
         .def("compile_jit", [](Pipeline &p, const Target &target) -> void {
-            (void) p.compile_jit();
-        }, py::arg("target") = get_jit_target_from_environment())
+            (void) p.compile_jit(target);
+        }, py::arg("target") = get_jit_target_from_environment(), py::call_guard<py::gil_scoped_release>())
 
 
         .def("realize", [](Pipeline &p, Buffer<> buffer, const Target &target, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffer), target);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            p.realize(Realization(buffer), target, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(), py::call_guard<py::gil_scoped_release>())
 
         // This will actually allow a list-of-buffers as well as a tuple-of-buffers, but that's OK.
         .def("realize", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &t, const ParamMap &param_map) -> void {
-            p.realize(Realization(buffers), t);
-        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
+            p.realize(Realization(buffers), t, param_map);
+        }, py::arg("dst"), py::arg("target") = Target(), py::arg("param_map") = ParamMap(), py::call_guard<py::gil_scoped_release>())
 
         .def("realize", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(sizes, target, param_map));
+            return realize_without_gil([&]() { return p.realize(sizes, target, param_map); });
         }, py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, target, param_map));
+            return realize_without_gil([&]() { return p.realize(x_size, target, param_map); });
         }, py::arg("x_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, target, param_map));
+            return realize_without_gil([&]() { return p.realize(x_size, y_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, target, param_map));
+            return realize_without_gil([&]() { return p.realize(x_size, y_size, z_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         // TODO: deprecate in favor of std::vector<int32_t> size version?
         .def("realize", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const Target &target, const ParamMap &param_map) -> py::object {
-            return realization_to_object(p.realize(x_size, y_size, z_size, w_size, target, param_map));
+            return realize_without_gil([&]() { return p.realize(x_size, y_size, z_size, w_size, target, param_map); });
         }, py::arg("x_size"), py::arg("y_size"), py::arg("z_size"), py::arg("w_size"), py::arg("target") = Target(), py::arg("param_map") = ParamMap())
 
         .def("infer_input_bounds", [](Pipeline &p, int x_size, int y_size, int z_size, int w_size, const ParamMap &param_map) -> void {
@@ -109,12 +109,14 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
     .def("allow_race_conditions", &T::allow_race_conditions)
     .def("hexagon", &T::hexagon, py::arg("x") = Var::outermost())
 
-    .def("prefetch", (T &(T::*)(const Func &, VarOrRVar, Expr, PrefetchBoundStrategy)) &T::prefetch,
-        py::arg("func"), py::arg("var"), py::arg("offset") = 1, py::arg("strategy") = PrefetchBoundStrategy::GuardWithIf)
-    .def("prefetch", [](T &t, const ImageParam &image, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy) -> T & {
+    .def("prefetch", (T &(T::*)(const Func &, VarOrRVar, Expr, PrefetchBoundStrategy, PrefetchHint)) &T::prefetch,
+        py::arg("func"), py::arg("var"), py::arg("offset") = 1, py::arg("strategy") = PrefetchBoundStrategy::GuardWithIf,
+        py::arg("hint") = PrefetchHint::L1)
+    .def("prefetch", [](T &t, const ImageParam &image, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy, PrefetchHint hint) -> T & {
         // Templated function; specializing only on ImageParam for now
-        return t.prefetch(image, var, offset, strategy);
-    }, py::arg("image"), py::arg("var"), py::arg("offset") = 1, py::arg("strategy") = PrefetchBoundStrategy::GuardWithIf)
+        return t.prefetch(image, var, offset, strategy, hint);
+    }, py::arg("image"), py::arg("var"), py::arg("offset") = 1, py::arg("strategy") = PrefetchBoundStrategy::GuardWithIf,
+        py::arg("hint") = PrefetchHint::L1)
 
     .def("source_location", &T::source_location)
     ;
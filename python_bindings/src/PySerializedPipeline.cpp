@@ -0,0 +1,87 @@
+#include "PySerializedPipeline.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace Halide {
+namespace PythonBindings {
+
+namespace {
+
+template<typename T>
+const void *store_scalar(const py::handle &value, uint64_t *storage) {
+    T v = value.cast<T>();
+    memcpy(storage, &v, sizeof(T));
+    return storage;
+}
+
+const void *store_scalar(const Argument &arg, const py::handle &value, uint64_t *storage) {
+    const Type &t = arg.type;
+    if (t == Bool()) return store_scalar<bool>(value, storage);
+    if (t == Int(8)) return store_scalar<int8_t>(value, storage);
+    if (t == Int(16)) return store_scalar<int16_t>(value, storage);
+    if (t == Int(32)) return store_scalar<int32_t>(value, storage);
+    if (t == Int(64)) return store_scalar<int64_t>(value, storage);
+    if (t == UInt(8)) return store_scalar<uint8_t>(value, storage);
+    if (t == UInt(16)) return store_scalar<uint16_t>(value, storage);
+    if (t == UInt(32)) return store_scalar<uint32_t>(value, storage);
+    if (t == UInt(64)) return store_scalar<uint64_t>(value, storage);
+    if (t == Float(32)) return store_scalar<float>(value, storage);
+    if (t == Float(64)) return store_scalar<double>(value, storage);
+    throw py::value_error("Unsupported type for argument " + arg.name + " of a SerializedPipeline.");
+}
+
+// Pass the arguments of a Python call through to the pipeline,
+// converting each one to what the matching Argument expects.
+int run_serialized_pipeline(const SerializedPipeline &p, const py::args &args) {
+    const std::vector<Argument> &arguments = p.arguments();
+    if (args.size() != arguments.size()) {
+        throw py::value_error("SerializedPipeline " + p.name() + " takes " +
+                              std::to_string(arguments.size()) + " arguments, but " +
+                              std::to_string(args.size()) + " were passed.");
+    }
+    std::vector<Buffer<>> buffers;
+    std::vector<uint64_t> storage(args.size());
+    std::vector<const void *> argv;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (arguments[i].is_buffer()) {
+            buffers.push_back(args[i].cast<Buffer<>>());
+            argv.push_back(buffers.back().raw_buffer());
+        } else {
+            argv.push_back(store_scalar(arguments[i], args[i], &storage[i]));
+        }
+    }
+    py::gil_scoped_release release;
+    return p.run(argv);
+}
+
+}  // namespace
+
+void define_serialized_pipeline(py::module &m) {
+    auto serialized_pipeline_class = py::class_<SerializedPipeline>(m, "SerializedPipeline")
+        .def(py::init<>())
+        .def_static("load", &SerializedPipeline::load, py::arg("filename"))
+
+        .def("defined", &SerializedPipeline::defined)
+        .def("name", &SerializedPipeline::name)
+        .def("target", &SerializedPipeline::target)
+        .def("arguments", &SerializedPipeline::arguments)
+        .def("hash", &SerializedPipeline::hash)
+
+        .def("run", &run_serialized_pipeline)
+        .def("__call__", &run_serialized_pipeline)
+
+        .def("__repr__", [](const SerializedPipeline &p) -> std::string {
+            std::ostringstream o;
+            o << "<halide.SerializedPipeline";
+            if (p.defined()) {
+                o << " '" << p.name() << "'";
+            }
+            o << ">";
+            return o.str();
+        })
+    ;
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
@@ -1,4 +1,7 @@
+#include <sstream>
+
 #include "AddImageChecks.h"
+#include "IROperator.h"
 #include "IRVisitor.h"
 #include "Simplify.h"
 #include "Substitute.h"
@@ -94,6 +97,67 @@ public:
     }
 };
 
+// Find the variables a Stmt reads that it does not define itself.
+class FreeVariables : public IRVisitor {
+    using IRVisitor::visit;
+
+    Scope<> defined;
+
+    void visit(const LetStmt *op) {
+        op->value.accept(this);
+        ScopedBinding<> bind(defined, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Variable *op) {
+        if (!defined.contains(op->name)) {
+            vars.emplace(op->name, op);
+        }
+    }
+
+public:
+    map<string, Expr> vars;
+};
+
+// Skip the checks when the values they read match the last ones that
+// passed them, as recorded by the runtime.
+Stmt skip_checks_on_cached_shape(const Stmt &checks, Stmt s, const string &pipeline_name) {
+    FreeVariables free_vars;
+    checks.accept(&free_vars);
+    vector<Expr> signature;
+    for (const auto &v : free_vars.vars) {
+        Expr e = v.second;
+        if (e.type().is_float()) {
+            e = reinterpret(UInt(e.type().bits()), e);
+        } else if (e.type().is_handle()) {
+            e = reinterpret(UInt(64), e);
+        }
+        signature.push_back(cast<int64_t>(e));
+    }
+    if (signature.empty()) {
+        signature.push_back(make_zero(Int(64)));
+    }
+
+    // Identify the pipeline and the checks it was compiled with, so a
+    // signature is only ever compared against ones that passed the
+    // same checks.
+    std::ostringstream text;
+    text << pipeline_name << "\n" << checks;
+    uint64_t id = 14695981039346656037ULL;
+    for (char c : text.str()) {
+        id = (id ^ (uint8_t)c) * 1099511628211ULL;
+    }
+
+    string signature_name = pipeline_name + ".shape_signature";
+    Expr signature_var = Variable::make(type_of<int64_t *>(), signature_name);
+    vector<Expr> args = {make_const(UInt(64), id), signature_var, (int)signature.size()};
+    Expr hit = Call::make(Int(32), "halide_shape_cache_lookup", args, Call::Extern);
+    Stmt store = Evaluate::make(Call::make(Int(32), "halide_shape_cache_store", args, Call::Extern));
+    s = Block::make(IfThenElse::make(hit == 0, Block::make(checks, store)), s);
+    Expr make_signature = Call::make(type_of<int64_t *>(), Call::make_struct, signature, Call::Intrinsic);
+    return LetStmt::make(signature_name, make_signature, s);
+}
+
 Stmt add_image_checks(Stmt s,
                       const vector<Function> &outputs,
                       const Target &t,
@@ -586,15 +650,24 @@ Stmt add_image_checks(Stmt s,
             s = Block::make(asserts_host_alignment[i-1], s);
         }
     }
+
+    // With CacheShapeChecks, the checks below only read the scalar
+    // arguments and the shapes of the buffers, so they are gathered in
+    // a Stmt of their own that is skipped on calls with the same
+    // shapes as the last one that passed them.
+    const bool cache_checks = t.has_feature(Target::CacheShapeChecks);
+    Stmt checks = Evaluate::make(0);
+    Stmt &checked = cache_checks ? checks : s;
+
     // Inject the code that checks that no dimension math overflows
     if (!no_asserts) {
         for (size_t i = dims_no_overflow_asserts.size(); i > 0; i--) {
-            s = Block::make(dims_no_overflow_asserts[i-1], s);
+            checked = Block::make(dims_no_overflow_asserts[i-1], checked);
         }
 
         // Inject the code that defines the proposed sizes.
         for (size_t i = lets_overflow.size(); i > 0; i--) {
-            s = LetStmt::make(lets_overflow[i-1].first, lets_overflow[i-1].second, s);
+            checked = LetStmt::make(lets_overflow[i-1].first, lets_overflow[i-1].second, checked);
         }
     }
 
@@ -603,6 +676,9 @@ Stmt add_image_checks(Stmt s,
     // constrained versions during storage flattening and bounds
     // inference.
     s = substitute(replace_with_constrained, s);
+    if (cache_checks) {
+        checks = substitute(replace_with_constrained, checks);
+    }
 
     // Now we add a bunch of code to the top of the pipeline. This is
     // all in reverse order compared to execution, as we incrementally
@@ -612,21 +688,25 @@ Stmt add_image_checks(Stmt s,
     // need these regardless of how NoAsserts is set, because they are
     // what gets Halide to actually exploit the constraint.
     for (size_t i = asserts_constrained.size(); i > 0; i--) {
-        s = Block::make(asserts_constrained[i-1], s);
+        checked = Block::make(asserts_constrained[i-1], checked);
     }
 
     if (!no_asserts) {
         // Inject the code that checks for out-of-bounds access to the buffers.
         for (size_t i = asserts_required.size(); i > 0; i--) {
-            s = Block::make(asserts_required[i-1], s);
+            checked = Block::make(asserts_required[i-1], checked);
         }
 
         // Inject the code that checks that elem_sizes are ok.
         for (size_t i = asserts_elem_size.size(); i > 0; i--) {
-            s = Block::make(asserts_elem_size[i-1], s);
+            checked = Block::make(asserts_elem_size[i-1], checked);
         }
     }
 
+    if (cache_checks && !is_no_op(checks)) {
+        s = skip_checks_on_cached_shape(checks, s, outputs[0].name());
+    }
+
     // Inject the code that returns early for inference mode.
     if (!no_bounds_query) {
         s = IfThenElse::make(!maybe_return_condition, s);
@@ -124,12 +124,13 @@ class AllocationInference : public IRMutator2 {
 public:
     AllocationInference(const map<string, Function> &e, const FuncValueBounds &fb) :
         env(e), func_bounds(fb) {
-        // Figure out which buffers are touched by extern stages
+        // Figure out which buffers are touched by extern stages. This
+        // includes extern stages with a proxy Expr, which only stands
+        // in for the extern call during bounds inference.
         for (map<string, Function>::const_iterator iter = e.begin();
              iter != e.end(); ++iter) {
             Function f = iter->second;
-            if (f.has_extern_definition() &&
-                !f.extern_definition_proxy_expr().defined()) {
+            if (f.has_extern_definition()) {
                 touched_by_extern.insert(f.name());
                 for (size_t i = 0; i < f.extern_arguments().size(); i++) {
                     ExternFuncArgument arg = f.extern_arguments()[i];
@@ -47,7 +47,7 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
         } else if (is_one(split.factor)) {
             // The split factor trivially divides the old extent,
             // but we know nothing new about the outer dimension.
-        } else if (tail == TailStrategy::GuardWithIf) {
+        } else if (tail == TailStrategy::GuardWithIf || tail == TailStrategy::Predicate) {
             // It's an exact split but we failed to prove that the
             // extent divides the factor. Use predication.
 
@@ -64,8 +64,13 @@ vector<ApplySplitResult> apply_split(const Split &split, bool is_update, string
                 prefix + split.old_var, rebased_var + old_min, ApplySplitResult::Substitution));
 
             // Tell Halide to optimize for the case in which this
-            // condition is true by partitioning some outer loop.
-            Expr cond = likely(rebased_var < old_extent);
+            // condition is true by partitioning some outer loop. With
+            // Predicate, leave it to be vectorized into predicated
+            // loads and stores instead.
+            Expr cond = rebased_var < old_extent;
+            if (tail == TailStrategy::GuardWithIf) {
+                cond = likely(cond);
+            }
             result.push_back(ApplySplitResult(cond));
             result.push_back(ApplySplitResult(rebased_var_name, rebased, ApplySplitResult::LetStmt));
 
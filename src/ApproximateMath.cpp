@@ -0,0 +1,147 @@
+#include "ApproximateMath.h"
+#include "CSE.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The largest error, in ulps, of each approximation, with some margin
+// over what we've measured. The precise versions of sin and cos only
+// meet this for arguments of magnitude less than about 100.
+const float precise_ulps = 4.0f;
+const float fast_exp_ulps = 128.0f;
+const float fast_log_ulps = 64.0f;
+const float fast_trig_ulps = 64.0f;
+const float fast_tanh_ulps = 64.0f;
+
+// Evaluate a polynomial with Horner's method. The high order terms
+// come first.
+Expr horner(const Expr &x, const float *coeff, int n) {
+    Expr result = coeff[0];
+    for (int i = 1; i < n; i++) {
+        result = result * x + coeff[i];
+    }
+    return result;
+}
+
+// sin(x) if cos_offset is 0, cos(x) if it is 1.
+Expr approximate_sin_or_cos(const Expr &x_full, int cos_offset, bool fast) {
+    Type type = x_full.type();
+
+    // Reduce to r in [-pi/4, pi/4], with x = r + k * pi/2. pi/2 is
+    // split into three parts so the products with k are exact for
+    // moderate k.
+    Expr k_real = floor(x_full * 0.636619772367581343f + 0.5f);
+    Expr r = x_full - k_real * 1.5703125f;
+    r -= k_real * 4.837512969970703125e-4f;
+    r -= k_real * 7.54978995489188216e-8f;
+    Expr q = cast(Int(32, type.lanes()), k_real) + cos_offset;
+    Expr r2 = r * r;
+
+    // Minimax fits of sin(r) = r + r^3 * p(r^2) and
+    // cos(r) = q(r^2) on [-pi/4, pi/4] in relative error.
+    Expr s, c;
+    if (fast) {
+        const float sin_coeff[] = {0.008163281150176682f, -0.16663390335814163f};
+        const float cos_coeff[] = {-0.0013591852559003577f, 0.04165577694903912f,
+                                   -0.49999884743850714f, 1.0f};
+        s = r + r * r2 * horner(r2, sin_coeff, 2);
+        c = horner(r2, cos_coeff, 4);
+    } else {
+        const float sin_coeff[] = {-0.00019515282108051435f, 0.008332160751870533f,
+                                   -0.16666654609334408f};
+        const float cos_coeff[] = {2.4383561692256912e-05f, -0.0013886681584399667f,
+                                   0.0416666203550278f, -0.49999999694457653f, 1.0f};
+        s = r + r * r2 * horner(r2, sin_coeff, 3);
+        c = horner(r2, cos_coeff, 5);
+    }
+
+    // Odd quadrants use the other function, and the upper two
+    // quadrants flip the sign.
+    Expr result = select((q & 1) == 0, s, c);
+    result = select((q & 2) == 0, result, -result);
+    return common_subexpression_elimination(result);
+}
+
+Expr approximate_tanh(const Expr &x, bool fast) {
+    // Near zero, 1 - 2 / (e^2x + 1) loses all its precision to
+    // cancellation, so use a minimax fit of
+    // tanh(x) = x + x^3 * p(x^2) there instead.
+    Expr x2 = x * x;
+    Expr small;
+    if (fast) {
+        const float coeff[] = {-0.04051468822399992f, 0.1304827294387378f, -0.3331551121157836f};
+        small = x + x * x2 * horner(x2, coeff, 3);
+    } else {
+        const float coeff[] = {-0.005704989060478344f, 0.020639089047437893f,
+                               -0.053739715596455365f, 0.13331442203050944f,
+                               -0.33333281942073406f};
+        small = x + x * x2 * horner(x2, coeff, 5);
+    }
+
+    // tanh is 1 to within float precision by x = 10, so clamp the
+    // argument of the exp to keep it finite.
+    Expr ax = min(abs(x), 20.0f);
+    Expr e = fast ? fast_exp(ax * 2.0f) : halide_exp(ax * 2.0f);
+    Expr large = 1.0f - 2.0f / (e + 1.0f);
+    large = select(x < 0.0f, -large, large);
+
+    Expr result = select(abs(x) < 0.625f, small, large);
+    return common_subexpression_elimination(result);
+}
+
+class ApproximateMath : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const float max_ulps;
+
+    Expr visit(const Call *op) override {
+        Expr expr = IRMutator2::visit(op);
+        op = expr.as<Call>();
+        if (op == nullptr ||
+            op->call_type != Call::PureExtern ||
+            max_ulps < precise_ulps) {
+            return expr;
+        }
+
+        if (op->name == "exp_f32") {
+            internal_assert(op->args.size() == 1);
+            return max_ulps >= fast_exp_ulps ? fast_exp(op->args[0]) : halide_exp(op->args[0]);
+        } else if (op->name == "log_f32") {
+            internal_assert(op->args.size() == 1);
+            return max_ulps >= fast_log_ulps ? fast_log(op->args[0]) : halide_log(op->args[0]);
+        } else if (op->name == "sin_f32") {
+            internal_assert(op->args.size() == 1);
+            return approximate_sin_or_cos(op->args[0], 0, max_ulps >= fast_trig_ulps);
+        } else if (op->name == "cos_f32") {
+            internal_assert(op->args.size() == 1);
+            return approximate_sin_or_cos(op->args[0], 1, max_ulps >= fast_trig_ulps);
+        } else if (op->name == "tanh_f32") {
+            internal_assert(op->args.size() == 1);
+            return approximate_tanh(op->args[0], max_ulps >= fast_tanh_ulps);
+        }
+        return expr;
+    }
+
+public:
+    ApproximateMath(float max_ulps) : max_ulps(max_ulps) {}
+};
+
+}  // namespace
+
+void approximate_math(std::map<std::string, Function> &env) {
+    for (auto &iter : env) {
+        Function &func = iter.second;
+        float max_ulps = func.schedule().max_math_ulps();
+        if (max_ulps > 0.0f) {
+            ApproximateMath approximate(max_ulps);
+            func.mutate(&approximate);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,24 @@
+#ifndef HALIDE_APPROXIMATE_MATH_H
+#define HALIDE_APPROXIMATE_MATH_H
+
+/** \file
+ * Defines a lowering pass that replaces transcendental math with
+ * polynomial approximations in Funcs that allow it.
+ */
+
+#include <map>
+
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace the Float(32) exp, log, sin, cos and tanh calls in the
+ * definitions of each Func scheduled with Func::approximate_math with
+ * the cheapest polynomial approximation within its error bound. */
+void approximate_math(std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
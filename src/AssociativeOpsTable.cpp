@@ -1,6 +1,8 @@
 #include "AssociativeOpsTable.h"
 #include "IRPrinter.h"
 
+#include <mutex>
+
 namespace Halide {
 namespace Internal {
 
@@ -112,6 +114,9 @@ struct TableKey {
 };
 
 static map<TableKey, vector<AssociativePattern>> pattern_tables;
+// Guards pattern_tables, which is filled in lazily, possibly by
+// pipelines being lowered on several threads at once.
+static std::mutex pattern_tables_mutex;
 
 #define declare_vars(t, index)                  \
     Expr x##index = Variable::make(t, "x" + std::to_string(index)); \
@@ -276,6 +281,7 @@ const vector<AssociativePattern> &get_ops_table_helper(const vector<Type> &types
     TableKey gen_key(ValType::All, root, dim);
     TableKey key(convert_halide_types_to_val_types(types), root, dim);
 
+    std::lock_guard<std::mutex> lock(pattern_tables_mutex);
     const auto &table_it = pattern_tables.find(key);
     if (table_it == pattern_tables.end()) { // Populate the table if we haven't done so previously
         vector<AssociativePattern> &table = pattern_tables[key];
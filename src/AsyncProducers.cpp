@@ -0,0 +1,368 @@
+#include "AsyncProducers.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+Stmt release_semaphore(Expr sema, Expr count) {
+    return Evaluate::make(Call::make(Int(32), "halide_semaphore_release",
+                                     {std::move(sema), std::move(count)}, Call::Extern));
+}
+
+Stmt acquire_semaphore(Expr sema, Expr count) {
+    return Evaluate::make(Call::make(Int(32), "halide_semaphore_acquire",
+                                     {std::move(sema), std::move(count)}, Call::Extern));
+}
+
+// Find the names of all Funcs called, and all buffers referred to.
+class FindReferencedFuncs : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide) {
+            names.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (op->type.is_handle() && ends_with(op->name, ".buffer")) {
+            names.insert(op->name.substr(0, op->name.find('.')));
+        }
+    }
+
+public:
+    set<string> names;
+};
+
+// Strip out everything but the production of a func, and release a
+// semaphore after each production.
+class GenerateProducerBody : public IRMutator2 {
+    const string &func;
+    Expr sema;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->name == func) {
+            if (op->is_producer) {
+                return ProducerConsumer::make(op->name, true,
+                                              Block::make(op->body, release_semaphore(sema, 1)));
+            } else {
+                return Evaluate::make(0);
+            }
+        }
+
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            if (op->is_producer) {
+                // This Func is computed by the consumer side. Make a
+                // note of it so we can check the producer doesn't
+                // depend on it.
+                skipped.insert(op->name);
+            }
+            return body;
+        } else {
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+    }
+
+    Stmt visit(const Provide *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const AssertStmt *op) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const For *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else {
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+        if (is_no_op(body)) {
+            return body;
+        } else {
+            return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+        }
+    }
+
+    Stmt visit(const Block *op) override {
+        Stmt first = mutate(op->first);
+        Stmt rest = mutate(op->rest);
+        if (is_no_op(first)) {
+            return rest;
+        } else if (is_no_op(rest)) {
+            return first;
+        } else {
+            return Block::make(first, rest);
+        }
+    }
+
+public:
+    GenerateProducerBody(const string &f, Expr s) : func(f), sema(std::move(s)) {}
+
+    // The Funcs computed inside the loop nest that the producer side
+    // does not compute.
+    set<string> skipped;
+};
+
+// Replace the production of a func with a wait on the producer side.
+class GenerateConsumerBody : public IRMutator2 {
+    const string &func;
+    Expr sema;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->name == func && op->is_producer) {
+            return acquire_semaphore(sema, 1);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+public:
+    GenerateConsumerBody(const string &f, Expr s) : func(f), sema(std::move(s)) {}
+};
+
+// Find the produce nodes of a func and collect the Funcs and buffers they refer to.
+class FindProducerDependencies : public IRVisitor {
+    const string &func;
+
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->name == func && op->is_producer) {
+            op->body.accept(&refs);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    FindReferencedFuncs refs;
+    FindProducerDependencies(const string &f) : func(f) {}
+};
+
+class ForkAsyncProducers : public IRMutator2 {
+    const map<string, Function> &env;
+    bool in_device_loop = false;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        bool old_in_device_loop = in_device_loop;
+        if (op->device_api != DeviceAPI::Host &&
+            op->device_api != DeviceAPI::None) {
+            in_device_loop = true;
+        }
+        Stmt s = IRMutator2::visit(op);
+        in_device_loop = old_in_device_loop;
+        return s;
+    }
+
+    Stmt visit(const Realize *op) override {
+        Stmt body = mutate(op->body);
+
+        auto it = env.find(op->name);
+        if (it == env.end() || !it->second.schedule().async()) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+        }
+
+        realized.insert(op->name);
+
+        user_assert(!in_device_loop)
+            << "Func " << op->name << " is scheduled as async, but is computed inside a GPU kernel "
+            << "or offloaded loop. Async producers must be computed on the host.\n";
+
+        string sema_name = op->name + ".semaphore";
+        Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_name);
+
+        GenerateProducerBody producer_builder(op->name, sema);
+        Stmt producer = producer_builder.mutate(body);
+        Stmt consumer = GenerateConsumerBody(op->name, sema).mutate(body);
+
+        // The producer side doesn't compute anything but the async
+        // Func, so anything else computed within the loop nest must
+        // not be needed to produce it.
+        FindProducerDependencies deps(op->name);
+        body.accept(&deps);
+        for (const string &f : producer_builder.skipped) {
+            user_assert(!deps.refs.names.count(f))
+                << "Func " << op->name << " is scheduled as async, but depends on Func " << f
+                << ", which is computed between the store and compute levels of " << op->name
+                << ". Compute " << f << " inside " << op->name << ", or outside its storage.\n";
+        }
+
+        Expr sema_space = Call::make(type_of<halide_semaphore_t *>(), Call::make_struct,
+                                     {make_zero(UInt(64)), make_zero(UInt(64))}, Call::Intrinsic);
+        Expr init = Call::make(Int(32), "halide_semaphore_init", {sema, 0}, Call::Extern);
+
+        body = Fork::make(producer, consumer);
+        body = Block::make(Evaluate::make(init), body);
+        body = LetStmt::make(sema_name, sema_space, body);
+
+        return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+    }
+
+public:
+    ForkAsyncProducers(const map<string, Function> &e) : env(e) {}
+
+    set<string> realized;
+};
+
+// Run the productions of independent Funcs computed at root
+// concurrently. The root level of the pipeline is a chain of
+// realizations, each of which produces its Func and then consumes it
+// in the rest of the chain. Consecutive links of the chain that don't
+// depend on each other are gathered into a wave, and the productions
+// in each wave are run in parallel via Fork nodes.
+class ForkIndependentStages : public IRMutator2 {
+    using IRMutator2::visit;
+
+    int loop_depth = 0;
+
+    struct Wave {
+        vector<pair<string, Expr>> lets;
+        vector<const Realize *> realizations;
+        vector<Stmt> produces;
+        set<string> funcs;
+    };
+
+    static bool refers_to(const set<string> &refs, const set<string> &funcs) {
+        for (const string &f : refs) {
+            if (funcs.count(f)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Stmt visit(const For *op) override {
+        loop_depth++;
+        Stmt s = IRMutator2::visit(op);
+        loop_depth--;
+        return s;
+    }
+
+    Stmt visit(const Realize *op) override {
+        if (loop_depth > 0) {
+            return IRMutator2::visit(op);
+        }
+
+        // Flatten the chain of realizations (and the lets between
+        // them) into a sequence of waves.
+        vector<Wave> waves(1);
+        Stmt s = op;
+        while (true) {
+            if (const LetStmt *let = s.as<LetStmt>()) {
+                FindReferencedFuncs refs;
+                let->value.accept(&refs);
+                if (refers_to(refs.names, waves.back().funcs)) {
+                    waves.emplace_back();
+                }
+                waves.back().lets.push_back({let->name, let->value});
+                s = let->body;
+                continue;
+            }
+
+            const Realize *realize = s.as<Realize>();
+            const Block *block = realize ? realize->body.as<Block>() : nullptr;
+            const ProducerConsumer *consume = block ? block->rest.as<ProducerConsumer>() : nullptr;
+            if (!consume || consume->is_producer || consume->name != realize->name) {
+                break;
+            }
+
+            FindReferencedFuncs refs;
+            block->first.accept(&refs);
+            realize->condition.accept(&refs);
+            for (const Range &r : realize->bounds) {
+                r.min.accept(&refs);
+                r.extent.accept(&refs);
+            }
+            if (refers_to(refs.names, waves.back().funcs)) {
+                waves.emplace_back();
+            }
+            waves.back().realizations.push_back(realize);
+            waves.back().produces.push_back(block->first);
+            waves.back().funcs.insert(realize->name);
+            s = consume->body;
+        }
+
+        if (waves.back().realizations.empty() && waves.size() == 1) {
+            // Not a chain of realizations
+            return IRMutator2::visit(op);
+        }
+
+        // Rebuild the chain from the inside out.
+        Stmt result = mutate(s);
+        for (size_t i = waves.size(); i > 0; i--) {
+            const Wave &w = waves[i - 1];
+            for (size_t j = w.realizations.size(); j > 0; j--) {
+                result = ProducerConsumer::make_consume(w.realizations[j - 1]->name, result);
+            }
+            if (!w.produces.empty()) {
+                Stmt produce = w.produces.back();
+                for (size_t j = w.produces.size() - 1; j > 0; j--) {
+                    produce = Fork::make(w.produces[j - 1], produce);
+                }
+                result = Block::make(produce, result);
+            }
+            for (size_t j = w.realizations.size(); j > 0; j--) {
+                const Realize *r = w.realizations[j - 1];
+                result = Realize::make(r->name, r->types, r->memory_type, r->bounds, r->condition, result);
+            }
+            for (size_t j = w.lets.size(); j > 0; j--) {
+                result = LetStmt::make(w.lets[j - 1].first, w.lets[j - 1].second, result);
+            }
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+Stmt fork_independent_stages(Stmt s) {
+    return ForkIndependentStages().mutate(s);
+}
+
+Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    ForkAsyncProducers forker(env);
+    s = forker.mutate(s);
+
+    for (const auto &p : env) {
+        user_assert(!p.second.schedule().async() || forker.realized.count(p.first))
+            << "Func " << p.first << " is scheduled as async, but has no realization of its "
+            << "own. Outputs and inlined Funcs cannot be async.\n";
+    }
+
+    return s;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,36 @@
+#ifndef HALIDE_ASYNC_PRODUCERS_H
+#define HALIDE_ASYNC_PRODUCERS_H
+
+/** \file
+ * Defines the lowering pass that injects task parallelism for producers that are scheduled as async.
+ */
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Split the computation of each Func scheduled as async onto a
+ * thread of its own. The loop nest between the Func's store level
+ * and compute level is duplicated: one copy does only the
+ * production of the Func, and runs concurrently (via a Fork node)
+ * with the other copy, which does everything else. The consumer
+ * side waits on a semaphore wherever the producer would have been
+ * computed. */
+Stmt fork_async_producers(Stmt s, const std::map<std::string, Function> &env);
+
+/** Run the productions of Funcs computed at root concurrently
+ * whenever they don't depend on each other, like the levels of
+ * independent image pyramids. Each group of consecutive independent
+ * realizations at the root of the pipeline has its productions joined
+ * with Fork nodes, and the Funcs computed after the group wait for
+ * all of them to finish. */
+Stmt fork_independent_stages(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
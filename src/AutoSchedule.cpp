@@ -1,5 +1,12 @@
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <regex>
+#include <sstream>
+#include <thread>
 
 #include "AutoSchedule.h"
 #include "AutoScheduleUtils.h"
@@ -7,6 +14,7 @@
 #include "FindCalls.h"
 #include "Func.h"
 #include "IREquality.h"
+#include "IRVisitor.h"
 #include "Inline.h"
 #include "ParallelRVar.h"
 #include "RealizationOrder.h"
@@ -1053,6 +1061,9 @@ struct Partitioner {
     // Parameters of the machine model that is used for estimating the cost of each
     // group in the pipeline.
     const MachineParams &arch_params;
+    // The model used to turn the arithmetic and memory costs of a group into
+    // a single figure to compare groupings by.
+    const AutoSchedulerCostModel &cost_model;
     // Dependency analysis of the pipeline. This support queries on regions
     // accessed and computed for producing some regions of some functions.
     DependenceAnalysis &dep_analysis;
@@ -1064,6 +1075,7 @@ struct Partitioner {
 
     Partitioner(const map<string, Box> &_pipeline_bounds,
                 const MachineParams &_arch_params,
+                const AutoSchedulerCostModel &_cost_model,
                 const vector<Function> &_outputs,
                 DependenceAnalysis &_dep_analysis,
                 RegionCosts &_costs);
@@ -1185,6 +1197,50 @@ struct Partitioner {
                                      const set<string> &inlines,
                                      AutoSchedule &sched);
 
+    // Tile the output stage of group 'g' by the tile sizes of the group, and
+    // reorder the tile dimensions outside of the dimensions within a tile. The
+    // dimensions within a tile are appended to 'inner_dims' and the ones across
+    // tiles to 'outer_dims', both ordered from innermost to outermost.
+    void tile_group_output(const Group &g, Stage f_handle, Definition def,
+                           set<string> &rvars, map<string, Expr> &stg_estimates,
+                           vector<VarOrRVar> &inner_dims, vector<VarOrRVar> &outer_dims,
+                           AutoSchedule &sched);
+
+    // Same as \ref Partitioner::generate_cpu_schedule, but this generates
+    // schedules for GPU targets. The output stage of each group is tiled across
+    // GPU blocks and threads, and the other members of the group are computed
+    // per block in shared memory, or per warp in registers.
+    void generate_gpu_schedule(const Target &t, AutoSchedule &sched);
+
+    // Same as \ref Partitioner::generate_gpu_schedule, but this generates and
+    // applies schedules for a group of function stages.
+    void generate_group_gpu_schedule(const Group &g, const Target &t,
+                                     const map<FStage, DimBounds> &group_loop_bounds,
+                                     const map<string, Box> &group_storage_bounds,
+                                     const set<string> &inlines,
+                                     AutoSchedule &sched);
+
+    // Split GPU thread tiles off of up to two of the parallelizable dimensions
+    // in 'dims', which are ordered from innermost to outermost. Return the
+    // thread dimensions. The outer dimensions of the splits are added to
+    // 'thread_outers', keyed by the name of the dimension that was split.
+    vector<VarOrRVar> split_gpu_threads(
+        const Group &g, Stage f_handle, const string &func_name, int stage_num,
+        Definition def, bool is_group_output, const vector<VarOrRVar> &dims,
+        map<string, Expr> &estimates, map<string, VarOrRVar> &thread_outers,
+        AutoSchedule &sched);
+
+    // Mark 'threads' as GPU thread dimensions. If 'use_lanes' is set, the
+    // innermost one is mapped to the lanes of a warp instead.
+    void mark_gpu_threads(Stage f_handle, int stage_num,
+                          const vector<VarOrRVar> &threads, bool use_lanes,
+                          AutoSchedule &sched);
+
+    // Reorder the dimensions of 'f_handle' to 'ordering', if they aren't
+    // already in that order.
+    void reorder_gpu_dims(Stage f_handle, int stage_num, Definition def,
+                          const vector<VarOrRVar> &ordering, AutoSchedule &sched);
+
     // Split the dimension of stage 'f_handle' along 'v' into inner and outer
     // dimensions. Modify 'estimates' according to the split and append the split
     // schedule to 'sched'.
@@ -1304,11 +1360,12 @@ void Partitioner::disp_pipeline_costs() {
 // algorithm operates.
 Partitioner::Partitioner(const map<string, Box> &_pipeline_bounds,
                          const MachineParams &_arch_params,
+                         const AutoSchedulerCostModel &_cost_model,
                          const vector<Function> &_outputs,
                          DependenceAnalysis &_dep_analysis,
                          RegionCosts &_costs)
         : pipeline_bounds(_pipeline_bounds), arch_params(_arch_params),
-          dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
+          cost_model(_cost_model), dep_analysis(_dep_analysis), costs(_costs), outputs(_outputs) {
     // Place each stage of a function in its own group. Each stage is
     // a node in the pipeline graph.
     for (const auto &f : dep_analysis.env) {
@@ -1943,21 +2000,16 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
                                      tile_cost.second);
     }*/
 
-    // TODO: Use smooth step curve from Jon to better model cache behavior,
-    // where each step corresponds to different cache level.
-    //
-    // The current cost model drops off linearly. Larger memory footprint is
-    // penalized more than smaller memory footprint (since smaller one can fit
-    // more in the cache). The cost is clamped at 'balance', which is roughly at
-    // memory footprint equal to or larger than the last level cache size.
+    // The cost of each byte loaded depends on the footprint of the region
+    // it is loaded from, as given by the cost model. Larger memory footprint
+    // should be penalized more than smaller memory footprint (since smaller
+    // one can fit more in the cache).
 
     // If 'model_reuse' is set, the cost model should take into account memory
     // reuse within the tile, e.g. matrix multiply reuses inputs multiple times.
     // TODO: Implement a better reuse model.
     bool model_reuse = false;
 
-    // Linear dropoff
-    Expr load_slope = cast<float>(arch_params.balance) / arch_params.last_level_cache_size;
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure fuction \"" << f_load.first
@@ -2000,7 +2052,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
 
             if (model_reuse) {
                 Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                    cast<int64_t>(cost_model.load_cost(arch_params, initial_footprint));
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -2011,7 +2063,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = cast<int64_t>(cost_model.load_cost(arch_params, footprint));
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -2167,8 +2219,14 @@ Expr Partitioner::estimate_benefit(const GroupAnalysis &old_grouping,
     if (no_redundant_work && !can_prove(arith_benefit >= 0)) {
         return Expr();
     }
-    Expr mem_benefit = old_grouping.cost.memory - new_grouping.cost.memory;
-    return simplify(mem_benefit + arith_benefit);
+    Expr old_cost = cost_model.total_cost(arch_params, old_grouping.cost.arith,
+                                          old_grouping.cost.memory);
+    Expr new_cost = cost_model.total_cost(arch_params, new_grouping.cost.arith,
+                                          new_grouping.cost.memory);
+    if (!old_cost.defined() || !new_cost.defined()) {
+        return Expr();
+    }
+    return simplify(old_cost - new_cost);
 }
 
 Expr Partitioner::estimate_benefit(
@@ -2424,6 +2482,9 @@ pair<VarOrRVar, VarOrRVar> Partitioner::split_dim(
         case TailStrategy::ShiftInwards:
             oss << ", TailStrategy::ShiftInwards)";
             break;
+        case TailStrategy::Predicate:
+            oss << ", TailStrategy::Predicate)";
+            break;
         case TailStrategy::Auto:
             oss << ")";
             break;
@@ -2644,6 +2705,74 @@ public :
     }
 };
 
+void Partitioner::tile_group_output(const Group &g, Stage f_handle, Definition def,
+                                    set<string> &rvars, map<string, Expr> &stg_estimates,
+                                    vector<VarOrRVar> &inner_dims,
+                                    vector<VarOrRVar> &outer_dims,
+                                    AutoSchedule &sched) {
+    const vector<Dim> &dims = def.schedule().dims();
+    vector<string> dim_vars(dims.size() - 1);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        dim_vars[d] = get_base_name(dims[d].var);
+    }
+
+    // Apply tiling to output of the group
+    for (const auto &var : dim_vars) {
+        bool is_rvar = (rvars.find(var) != rvars.end());
+        VarOrRVar v(var, is_rvar);
+
+        const auto &iter = g.tile_sizes.find(var);
+        if ((iter != g.tile_sizes.end()) &&
+            get_element(stg_estimates, var).defined() &&
+            can_prove(get_element(stg_estimates, var) > iter->second)) {
+            const Expr &tile_size = iter->second;
+            if (can_prove(tile_size == 1)) {
+                outer_dims.push_back(v);
+            } else {
+                pair<VarOrRVar, VarOrRVar> tile_vars =
+                    split_dim(g, f_handle, g.output.stage_num, def, true, v,
+                              tile_size, "_i", "_o", stg_estimates, sched);
+
+                inner_dims.push_back(tile_vars.first);
+                outer_dims.push_back(tile_vars.second);
+
+                if (is_rvar) {
+                    rvars.erase(var);
+                    rvars.insert(tile_vars.first.name());
+                    rvars.insert(tile_vars.second.name());
+                }
+            }
+        } else {
+            inner_dims.push_back(v);
+        }
+    }
+
+    // Reorder the tile dimensions
+    if (!outer_dims.empty()) {
+
+        vector<VarOrRVar> ordering;
+        for (const auto &v : inner_dims) {
+            ordering.push_back(v);
+        }
+        for (const auto &v : outer_dims) {
+            ordering.push_back(v);
+        }
+
+        set<string> var_list;
+        string var_order = ordering[0].name();
+        for (size_t o = 1; o < ordering.size(); o++) {
+            var_order += ", " + ordering[o].name();
+            var_list.insert(ordering[o].name());
+        }
+
+        if (dims != ordering) {
+            f_handle.reorder(ordering);
+            sched.push_schedule(f_handle.name(), g.output.stage_num,
+                                "reorder(" + var_order + ")", var_list);
+        }
+    }
+}
+
 void Partitioner::generate_group_cpu_schedule(
         const Group &g, const Target &t,
         const map<FStage, DimBounds> &group_loop_bounds,
@@ -2710,66 +2839,8 @@ void Partitioner::generate_group_cpu_schedule(
         }
     }
 
-    vector<string> dim_vars(dims.size() - 1);
-    for (int d = 0; d < (int)dims.size() - 1; d++) {
-        dim_vars[d] = get_base_name(dims[d].var);
-    }
-
-    // Apply tiling to output of the group
-    for (const auto &var : dim_vars) {
-        bool is_rvar = (rvars.find(var) != rvars.end());
-        VarOrRVar v(var, is_rvar);
-
-        const auto &iter = g.tile_sizes.find(var);
-        if ((iter != g.tile_sizes.end()) &&
-            get_element(stg_estimates, var).defined() &&
-            can_prove(get_element(stg_estimates, var) > iter->second)) {
-            const Expr &tile_size = iter->second;
-            if (can_prove(tile_size == 1)) {
-                outer_dims.push_back(v);
-            } else {
-                pair<VarOrRVar, VarOrRVar> tile_vars =
-                    split_dim(g, f_handle, g.output.stage_num, def, true, v,
-                              tile_size, "_i", "_o", stg_estimates, sched);
-
-                inner_dims.push_back(tile_vars.first);
-                outer_dims.push_back(tile_vars.second);
-
-                if (is_rvar) {
-                    rvars.erase(var);
-                    rvars.insert(tile_vars.first.name());
-                    rvars.insert(tile_vars.second.name());
-                }
-            }
-        } else {
-            inner_dims.push_back(v);
-        }
-    }
-
-    // Reorder the tile dimensions
-    if (!outer_dims.empty()) {
-
-        vector<VarOrRVar> ordering;
-        for (const auto &v : inner_dims) {
-            ordering.push_back(v);
-        }
-        for (const auto &v : outer_dims) {
-            ordering.push_back(v);
-        }
-
-        set<string> var_list;
-        string var_order = ordering[0].name();
-        for (size_t o = 1; o < ordering.size(); o++) {
-            var_order += ", " + ordering[o].name();
-            var_list.insert(ordering[o].name());
-        }
-
-        if (dims != ordering) {
-            f_handle.reorder(ordering);
-            sched.push_schedule(f_handle.name(), g.output.stage_num,
-                                "reorder(" + var_order + ")", var_list);
-        }
-    }
+    tile_group_output(g, f_handle, def, rvars, stg_estimates, inner_dims,
+                      outer_dims, sched);
 
     vectorize_stage(g, f_handle, g.output.stage_num, def, g_out, true, t,
                     rvars, stg_estimates, sched);
@@ -2932,132 +3003,579 @@ void Partitioner::generate_cpu_schedule(const Target &t, AutoSchedule &sched) {
     }
 }
 
-Expr Partitioner::find_max_access_stride(const Scope<> &vars,
-                                         const string &func_acc,
-                                         const vector<Expr> &acc_exprs,
-                                         const Box &buffer_bounds) {
-    size_t num_storage_dims = 0;
-    Expr bytes_per_ele = make_zero(Int(64));
+vector<VarOrRVar> Partitioner::split_gpu_threads(
+        const Group &g, Stage f_handle, const string &func_name, int stage_num,
+        Definition def, bool is_group_output, const vector<VarOrRVar> &dims,
+        map<string, Expr> &estimates, map<string, VarOrRVar> &thread_outers,
+        AutoSchedule &sched) {
+    // 32 threads along the innermost dimension, so that a warp covers
+    // contiguous values, and 8 along the next, for 256 threads per block.
+    const int thread_extents[] = {32, 8};
 
-    // Get the number of dimensions of the allocated storage and the
-    // number of bytes required to store a single value of func_acc.
-    const auto &iter = dep_analysis.env.find(func_acc);
-    if (iter != dep_analysis.env.end()) {
-        const Function &f = iter->second;
-        for (const auto &e : f.values()) {
-            bytes_per_ele += e.type().bytes();
+    vector<VarOrRVar> threads;
+    for (const VarOrRVar &v : dims) {
+        if (threads.size() == 2) {
+            break;
         }
-        num_storage_dims = f.schedule().storage_dims().size();
-    } else {
-        bytes_per_ele = get_element(costs.inputs, func_acc).bytes();
-        num_storage_dims = buffer_bounds.size();
-    }
-
-    Expr curr_stride = bytes_per_ele;
-    Expr stride = make_zero(Int(64));
-
-    internal_assert(num_storage_dims <= acc_exprs.size());
-    for (size_t sdim = 0; sdim < num_storage_dims; sdim++) {
-        // Check if the access expression depends on any of the loop variables
-        // in 'vars'. Expressions that do not involve the variable have stride 0.
-        if (expr_uses_vars(acc_exprs[sdim], vars)) {
-           stride = max(stride, curr_stride);
+        if (v.is_rvar && !can_parallelize_rvar(v.name(), func_name, def)) {
+            continue;
         }
-
-        const Interval &dim_range = buffer_bounds[sdim];
-        Expr dim_extent = get_extent(dim_range);
-        if (!dim_extent.defined()) {
-            return Expr();
+        const auto &iter = estimates.find(v.name());
+        if ((iter == estimates.end()) || !iter->second.defined()) {
+            continue;
+        }
+        Expr extent = thread_extents[threads.size()];
+        if (can_prove(iter->second > extent)) {
+            pair<VarOrRVar, VarOrRVar> split_vars =
+                split_dim(g, f_handle, stage_num, def, is_group_output, v,
+                          extent, "_t", "_s", estimates, sched);
+            threads.push_back(split_vars.first);
+            thread_outers.emplace(v.name(), split_vars.second);
+        } else {
+            threads.push_back(v);
         }
-        curr_stride *= dim_extent;
     }
-
-    return simplify(stride);
+    return threads;
 }
 
-map<string, Expr>
-Partitioner::analyze_spatial_locality(const FStage &stg,
-                                      const map<string, Box> &allocation_bounds,
-                                      const set<string> &inlines) {
-    internal_assert(!stg.func.has_extern_definition());
-    // Handle inlining. When a function is inlined into another, the stride of
-    // the accesses should be computed on the expression post inlining.
-    // For example:
-    // f(x, y) = ...;
-    // g(x, y) = f(y, x); // transpose
-    // h(x, y) = g(y, x); // transpose
-    //
-    // If both g and f are inlined into h, then the resulting expression for h
-    // will look like:
-    // h(x, y) = f(x, y);
-    //
-    // Computing the stride of a loop over x in the function h will be incorrect
-    // if inlining is not taken into account.
-
-    // Get all the allocations accessed in the definition corresponding to 'stg'.
-    FindAllCalls find;
-    Definition def = get_stage_definition(stg.func, stg.stage_num);
-    // Perform inlining on the all the values and the args in the stage.
-    for (auto &val : def.values()) {
-        val = perform_inline(val, dep_analysis.env, inlines);
+void Partitioner::mark_gpu_threads(Stage f_handle, int stage_num,
+                                   const vector<VarOrRVar> &threads,
+                                   bool use_lanes, AutoSchedule &sched) {
+    vector<VarOrRVar> thread_vars = threads;
+    if (use_lanes && !thread_vars.empty()) {
+        f_handle.gpu_lanes(thread_vars[0]);
+        sched.push_schedule(f_handle.name(), stage_num,
+                            "gpu_lanes(" + thread_vars[0].name() + ")",
+                            {thread_vars[0].name()});
+        thread_vars.erase(thread_vars.begin());
     }
-    for (auto &arg : def.args()) {
-        arg = perform_inline(arg, dep_analysis.env, inlines);
+    if (thread_vars.empty()) {
+        return;
     }
-    def.accept(&find);
-
-    // Arguments on the left hand side might themselves involve accesses
-    // to allocations and thus need to be accounted for when computing the
-    // strides along each dimension.
-    vector<pair<string, vector<Expr>>> &call_args = find.call_args;
-    // Account for the spatial locality of the store. Add the access on the
-    // left hand side to call_args.
-    call_args.push_back(make_pair(stg.func.name(), def.args()));
-
-    // Map for holding the strides across each dimension
-    map<string, Expr> var_strides;
-    const vector<Dim> &dims = def.schedule().dims();
-
-    for (int d = 0; d < (int)dims.size() - 1; d++) {
-        // Get all the variables involving the dimension in the definition.
-        FindVarsUsingVar dep_vars(dims[d].var);
-        def.accept(&dep_vars);
 
-        // Accumulate the stride of each access to a loop dimension.
-        Expr total_stride = 0;
-        for (const pair<string, vector<Expr>> &call : call_args) {
-            Box call_alloc_reg;
-            const auto &iter = allocation_bounds.find(call.first);
-            if (iter != allocation_bounds.end()) {
-                call_alloc_reg = iter->second;
-            } else {
-                call_alloc_reg = get_element(pipeline_bounds, call.first);
-            }
-            Expr current_stride = find_max_access_stride(dep_vars.vars, call.first,
-                                                         call.second, call_alloc_reg);
-            if (!current_stride.defined()) {
-                return map<string, Expr>();
-            }
-            total_stride += current_stride;
-        }
-        var_strides.emplace(dims[d].var, simplify(total_stride));
+    set<string> var_list;
+    string var_names = thread_vars[0].name();
+    var_list.insert(thread_vars[0].name());
+    for (size_t i = 1; i < thread_vars.size(); i++) {
+        var_names += ", " + thread_vars[i].name();
+        var_list.insert(thread_vars[i].name());
     }
 
-    return var_strides;
+    if (thread_vars.size() == 1) {
+        f_handle.gpu_threads(thread_vars[0]);
+    } else {
+        internal_assert(thread_vars.size() == 2);
+        f_handle.gpu_threads(thread_vars[0], thread_vars[1]);
+    }
+    sched.push_schedule(f_handle.name(), stage_num,
+                        "gpu_threads(" + var_names + ")", var_list);
 }
 
-// Verify that function 'f' does not have partially specified schedules/bounds.
-// The current auto scheduler cannots handle such cases.
-void validate_no_partial_schedules(const Function &f) {
-    if (f.has_extern_definition()) {
+void Partitioner::reorder_gpu_dims(Stage f_handle, int stage_num, Definition def,
+                                   const vector<VarOrRVar> &ordering,
+                                   AutoSchedule &sched) {
+    const vector<Dim> &dims = def.schedule().dims();
+    internal_assert(ordering.size() + 1 == dims.size());
+    if (ordering.size() < 2 || dims == ordering) {
         return;
     }
 
-    // Verify no compute_root or bounds are specified
-    user_assert(f.schedule().compute_level().is_inlined())
-        << "AutoSchedule: cannot auto-schedule function \"" << f.name()
-        << "\" since it is scheduled to be computed at root\n";
-    user_assert(f.schedule().bounds().empty())
+    set<string> var_list;
+    string var_order = ordering[0].name();
+    var_list.insert(ordering[0].name());
+    for (size_t o = 1; o < ordering.size(); o++) {
+        var_order += ", " + ordering[o].name();
+        var_list.insert(ordering[o].name());
+    }
+
+    f_handle.reorder(ordering);
+    sched.push_schedule(f_handle.name(), stage_num,
+                        "reorder(" + var_order + ")", var_list);
+}
+
+void Partitioner::generate_group_gpu_schedule(
+        const Group &g, const Target &t,
+        const map<FStage, DimBounds> &group_loop_bounds,
+        const map<string, Box> &group_storage_bounds,
+        const set<string> &inlines,
+        AutoSchedule &sched) {
+    string out_f_name = g.output.func.name();
+    Function g_out = g.output.func;
+
+    debug(3) << "\n================\n";
+    debug(3) << "Scheduling group for GPU:\n";
+    debug(3) << "================\n";
+    debug(3) << g;
+
+    if (g.output.func.has_extern_definition()) {
+        internal_assert(g.members.size() == 1);
+        Func(g_out).compute_root();
+        sched.push_schedule(g_out.name(), g.output.stage_num, "compute_root()", {});
+        return;
+    }
+
+    // Warp shuffles need compute capability 3.0 or higher. Mapping the
+    // innermost thread dimension to warp lanes lets group members that
+    // are computed per warp live in registers.
+    bool can_use_lanes = t.has_feature(Target::CUDA) &&
+        (t.has_feature(Target::CUDACapability30) ||
+         t.has_feature(Target::CUDACapability32) ||
+         t.has_feature(Target::CUDACapability35) ||
+         t.has_feature(Target::CUDACapability50) ||
+         t.has_feature(Target::CUDACapability61) ||
+         t.has_feature(Target::CUDACapability70));
+
+    // The shared memory available to a block. Budget half of it, so that
+    // at least two blocks can be resident on a multiprocessor at once.
+    int64_t shared_mem_budget = (t.has_feature(Target::CUDA) ? 48 : 32) * 1024 / 2;
+
+    // Get the estimates for stage bounds
+    DimBounds stg_bounds = get_bounds(g.output);
+    map<string, Expr> stg_estimates = bounds_to_estimates(stg_bounds);
+
+    Stage f_handle = Stage(Func(g_out));
+
+    // Get a function handle for scheduling the stage
+    if (g.output.stage_num > 0) {
+        int stage_num = g.output.stage_num;
+        f_handle = Func(g_out).update(stage_num - 1);
+    } else {
+        Func(g_out).compute_root();
+        sched.push_schedule(f_handle.name(), g.output.stage_num, "compute_root()", {});
+    }
+
+    // Get the definition corresponding to the stage
+    Definition def = get_stage_definition(g_out, g.output.stage_num);
+    vector<Dim> &dims = def.schedule().dims();
+
+    // Keep track of the rvars
+    set<string> rvars;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        if (dims[d].is_rvar()) {
+            rvars.insert(get_base_name(dims[d].var));
+        }
+    }
+
+    // Reorder the dimensions for better spatial locality, so that the
+    // threads of a warp access contiguous memory.
+    if (dims.size() > 2) {
+        map<string, Expr> strides =
+            analyze_spatial_locality(g.output, group_storage_bounds, inlines);
+        if (!strides.empty()) {
+            reorder_dims(f_handle, g.output.stage_num, def, strides, sched);
+        }
+    }
+
+    // Each tile of the group is computed by one GPU block.
+    vector<VarOrRVar> outer_dims, inner_dims;
+    tile_group_output(g, f_handle, def, rvars, stg_estimates, inner_dims,
+                      outer_dims, sched);
+
+    set<string> tiled_dims;
+    for (const auto &v : outer_dims) {
+        const string &name = v.name();
+        if (ends_with(name, "_o")) {
+            tiled_dims.insert(name.substr(0, name.size() - 2) + "_i");
+        }
+    }
+
+    // Split thread tiles off of the innermost dimensions of the tile.
+    map<string, VarOrRVar> thread_outers;
+    vector<VarOrRVar> threads =
+        split_gpu_threads(g, f_handle, g_out.name(), g.output.stage_num, def, true, inner_dims,
+                          stg_estimates, thread_outers, sched);
+    set<string> thread_names;
+    for (const auto &v : threads) {
+        thread_names.insert(v.name());
+    }
+
+    // What remains of the dimensions within a tile is looped over by
+    // each thread. Dimensions that weren't tiled are spread across
+    // blocks instead, as are the dimensions across tiles. Blocks can
+    // only be three-dimensional, and dimensions which can't be
+    // parallelized have to stay outside the kernel.
+    vector<VarOrRVar> serial, blocks, host;
+    auto can_parallelize = [&](const VarOrRVar &v) {
+        return !v.is_rvar || can_parallelize_rvar(v.name(), g_out.name(), def);
+    };
+    for (const auto &v : inner_dims) {
+        bool is_tiled = tiled_dims.count(v.name());
+        const auto &iter = thread_outers.find(v.name());
+        if (iter != thread_outers.end()) {
+            if (is_tiled) {
+                serial.push_back(iter->second);
+            } else {
+                blocks.push_back(iter->second);
+            }
+        } else if (thread_names.count(v.name())) {
+            continue;
+        } else if (!is_tiled && can_parallelize(v)) {
+            blocks.push_back(v);
+        } else {
+            serial.push_back(v);
+        }
+    }
+    for (const auto &v : outer_dims) {
+        if (can_parallelize(v)) {
+            blocks.push_back(v);
+        } else {
+            host.push_back(v);
+        }
+    }
+    while (blocks.size() > 3) {
+        host.insert(host.begin(), blocks.back());
+        blocks.pop_back();
+    }
+
+    vector<VarOrRVar> ordering;
+    ordering.insert(ordering.end(), threads.begin(), threads.end());
+    ordering.insert(ordering.end(), serial.begin(), serial.end());
+    ordering.insert(ordering.end(), blocks.begin(), blocks.end());
+    ordering.insert(ordering.end(), host.begin(), host.end());
+    reorder_gpu_dims(f_handle, g.output.stage_num, def, ordering, sched);
+
+    // Only use warp lanes when there is a thread dimension outside of
+    // them to compute the register-resident group members at.
+    bool use_lanes = can_use_lanes && (threads.size() == 2) &&
+        can_prove(get_element(stg_estimates, threads[0].name()) == 32);
+    mark_gpu_threads(f_handle, g.output.stage_num, threads, use_lanes, sched);
+
+    if (blocks.empty()) {
+        f_handle.gpu_single_thread();
+        sched.push_schedule(f_handle.name(), g.output.stage_num, "gpu_single_thread()", {});
+    } else {
+        set<string> var_list;
+        string var_names = blocks[0].name();
+        var_list.insert(blocks[0].name());
+        for (size_t i = 1; i < blocks.size(); i++) {
+            var_names += ", " + blocks[i].name();
+            var_list.insert(blocks[i].name());
+        }
+        if (blocks.size() == 1) {
+            f_handle.gpu_blocks(blocks[0]);
+        } else if (blocks.size() == 2) {
+            f_handle.gpu_blocks(blocks[0], blocks[1]);
+        } else {
+            f_handle.gpu_blocks(blocks[0], blocks[1], blocks[2]);
+        }
+        sched.push_schedule(f_handle.name(), g.output.stage_num,
+                            "gpu_blocks(" + var_names + ")", var_list);
+    }
+
+    // Group members are computed per block, in shared memory, while they
+    // fit. Members that don't are computed per row of a warp in
+    // registers if the output uses warp lanes, and at the root
+    // otherwise.
+    int64_t shared_mem_used = 0;
+    auto compute_at_output = [&](Function f, const VarOrRVar &v) {
+        if (v.is_rvar) {
+            Func(f).compute_at(Func(g_out), v.rvar);
+        } else {
+            Func(f).compute_at(Func(g_out), v.var);
+        }
+    };
+    for (const FStage &mem : g.members) {
+        // Skip member stages that have been inlined or stage that is the
+        // output stage of the group
+        if ((g.inlined.find(mem.func.name()) != g.inlined.end()) ||
+            (mem.func.name() == g_out.name())) {
+            continue;
+        }
+
+        // Get the definition corresponding to the stage
+        Definition mem_def = get_stage_definition(mem.func, mem.stage_num);
+
+        // Get the estimates for the dimensions of the member stage
+        map<string, Expr> mem_estimates =
+            bounds_to_estimates(get_element(group_loop_bounds, mem));
+
+        // Get a function handle for scheduling the stage
+        Stage mem_handle = Stage(Func(mem.func));
+        string sanitized_g_out = get_sanitized_name(g_out.name());
+
+        if (mem.stage_num > 0) {
+            mem_handle = Func(mem.func).update(mem.stage_num - 1);
+        } else if (blocks.empty()) {
+            Func(mem.func).compute_root();
+            sched.push_schedule(mem_handle.name(), mem.stage_num, "compute_root()", {});
+        } else {
+            Expr footprint;
+            const auto &iter = group_storage_bounds.find(mem.func.name());
+            if (iter != group_storage_bounds.end()) {
+                footprint = costs.region_size(mem.func.name(), iter->second);
+            }
+            const int64_t *bytes = footprint.defined() ? as_const_int(simplify(footprint)) : nullptr;
+
+            if (bytes && (shared_mem_used + *bytes <= shared_mem_budget)) {
+                shared_mem_used += *bytes;
+                compute_at_output(mem.func, blocks[0]);
+                Func(mem.func).store_in(MemoryType::GPUShared);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "compute_at(" + sanitized_g_out + ", " + blocks[0].name() + ")",
+                                    {sanitized_g_out, blocks[0].name()});
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "store_in(MemoryType::GPUShared)", {});
+            } else if (use_lanes) {
+                compute_at_output(mem.func, threads[1]);
+                Func(mem.func).store_in(MemoryType::Register);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "compute_at(" + sanitized_g_out + ", " + threads[1].name() + ")",
+                                    {sanitized_g_out, threads[1].name()});
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "store_in(MemoryType::Register)", {});
+            } else {
+                user_warning << "\"" << mem.func.name() << "\" does not fit in GPU shared memory; "
+                             << "computing it at root\n";
+                Func(mem.func).compute_root();
+                sched.push_schedule(mem_handle.name(), mem.stage_num, "compute_root()", {});
+            }
+        }
+
+        // Reorder the dimensions for better spatial locality. If we only have
+        // one dimension (excluding __outermost), there is nothing to reorder.
+        vector<Dim> &mem_dims = mem_def.schedule().dims();
+        if (mem_dims.size() > 2) {
+            map<string, Expr> mem_strides =
+                analyze_spatial_locality(mem, group_storage_bounds, inlines);
+            if (!mem_strides.empty()) {
+                reorder_dims(mem_handle, mem.stage_num, mem_def, mem_strides, sched);
+            }
+        }
+
+        vector<VarOrRVar> mem_vars;
+        for (int d = 0; d < (int)mem_dims.size() - 1; d++) {
+            mem_vars.push_back(VarOrRVar(get_base_name(mem_dims[d].var), mem_dims[d].is_rvar()));
+        }
+
+        const FuncSchedule &mem_sched = mem.func.schedule();
+        if (mem_sched.memory_type() == MemoryType::Register) {
+            // Spread the innermost parallelizable dimension across the
+            // lanes of the warp.
+            for (const auto &v : mem_vars) {
+                if (v.is_rvar && !can_parallelize_rvar(v.name(), mem.func.name(), mem_def)) {
+                    continue;
+                }
+                VarOrRVar lane = v;
+                const Expr &est = get_element(mem_estimates, v.name());
+                if (est.defined() && can_prove(est > 32)) {
+                    lane = split_dim(g, mem_handle, mem.stage_num, mem_def, false, v,
+                                     32, "_l", "_s", mem_estimates, sched).first;
+                }
+                mem_handle.gpu_lanes(lane);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "gpu_lanes(" + lane.name() + ")", {lane.name()});
+                break;
+            }
+        } else if (mem_sched.memory_type() == MemoryType::GPUShared) {
+            // Members computed per block split their own thread tiles.
+            map<string, VarOrRVar> mem_thread_outers;
+            vector<VarOrRVar> mem_threads =
+                split_gpu_threads(g, mem_handle, mem.func.name(), mem.stage_num, mem_def, false, mem_vars,
+                                  mem_estimates, mem_thread_outers, sched);
+            set<string> mem_thread_names;
+            for (const auto &v : mem_threads) {
+                mem_thread_names.insert(v.name());
+            }
+            vector<VarOrRVar> mem_ordering = mem_threads;
+            for (const auto &v : mem_vars) {
+                const auto &iter = mem_thread_outers.find(v.name());
+                if (iter != mem_thread_outers.end()) {
+                    mem_ordering.push_back(iter->second);
+                } else if (!mem_thread_names.count(v.name())) {
+                    mem_ordering.push_back(v);
+                }
+            }
+            reorder_gpu_dims(mem_handle, mem.stage_num, mem_def, mem_ordering, sched);
+            mark_gpu_threads(mem_handle, mem.stage_num, mem_threads, false, sched);
+        } else {
+            // Members computed at the root are tiled across blocks and
+            // threads on their own.
+            map<string, VarOrRVar> mem_thread_outers;
+            vector<VarOrRVar> mem_threads =
+                split_gpu_threads(g, mem_handle, mem.func.name(), mem.stage_num, mem_def, false, mem_vars,
+                                  mem_estimates, mem_thread_outers, sched);
+            set<string> mem_thread_names;
+            for (const auto &v : mem_threads) {
+                mem_thread_names.insert(v.name());
+            }
+            vector<VarOrRVar> mem_ordering = mem_threads, mem_blocks, mem_rest;
+            for (const auto &v : mem_vars) {
+                const auto &iter = mem_thread_outers.find(v.name());
+                if (iter != mem_thread_outers.end()) {
+                    mem_blocks.push_back(iter->second);
+                } else if (!mem_thread_names.count(v.name())) {
+                    mem_rest.push_back(v);
+                }
+            }
+            mem_ordering.insert(mem_ordering.end(), mem_rest.begin(), mem_rest.end());
+            mem_ordering.insert(mem_ordering.end(), mem_blocks.begin(), mem_blocks.end());
+            reorder_gpu_dims(mem_handle, mem.stage_num, mem_def, mem_ordering, sched);
+            mark_gpu_threads(mem_handle, mem.stage_num, mem_threads, false, sched);
+            if (mem_blocks.empty()) {
+                mem_handle.gpu_single_thread();
+                sched.push_schedule(mem_handle.name(), mem.stage_num, "gpu_single_thread()", {});
+            } else if (mem_blocks.size() == 1) {
+                mem_handle.gpu_blocks(mem_blocks[0]);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "gpu_blocks(" + mem_blocks[0].name() + ")",
+                                    {mem_blocks[0].name()});
+            } else {
+                mem_handle.gpu_blocks(mem_blocks[0], mem_blocks[1]);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "gpu_blocks(" + mem_blocks[0].name() + ", " + mem_blocks[1].name() + ")",
+                                    {mem_blocks[0].name(), mem_blocks[1].name()});
+            }
+        }
+    }
+}
+
+void Partitioner::generate_gpu_schedule(const Target &t, AutoSchedule &sched) {
+    // Grab the group bounds early as they rely on the dimensions of the group
+    // outputs which will be altered by modifying schedules.
+    map<FStage, map<FStage, DimBounds>> loop_bounds = group_loop_bounds();
+    map<FStage, map<string, Box>> storage_bounds = group_storage_bounds();
+
+    set<string> inlines;
+    // Mark all functions that are inlined.
+    for (const pair<FStage, Group> &g : groups) {
+        for (const string &inline_func : g.second.inlined) {
+            inlines.insert(inline_func);
+        }
+    }
+
+    // Realize schedule for each group in the pipeline.
+    for (const auto &g : groups) {
+        generate_group_gpu_schedule(g.second, t, get_element(loop_bounds, g.first),
+                                    get_element(storage_bounds, g.first), inlines, sched);
+    }
+}
+
+Expr Partitioner::find_max_access_stride(const Scope<> &vars,
+                                         const string &func_acc,
+                                         const vector<Expr> &acc_exprs,
+                                         const Box &buffer_bounds) {
+    size_t num_storage_dims = 0;
+    Expr bytes_per_ele = make_zero(Int(64));
+
+    // Get the number of dimensions of the allocated storage and the
+    // number of bytes required to store a single value of func_acc.
+    const auto &iter = dep_analysis.env.find(func_acc);
+    if (iter != dep_analysis.env.end()) {
+        const Function &f = iter->second;
+        for (const auto &e : f.values()) {
+            bytes_per_ele += e.type().bytes();
+        }
+        num_storage_dims = f.schedule().storage_dims().size();
+    } else {
+        bytes_per_ele = get_element(costs.inputs, func_acc).bytes();
+        num_storage_dims = buffer_bounds.size();
+    }
+
+    Expr curr_stride = bytes_per_ele;
+    Expr stride = make_zero(Int(64));
+
+    internal_assert(num_storage_dims <= acc_exprs.size());
+    for (size_t sdim = 0; sdim < num_storage_dims; sdim++) {
+        // Check if the access expression depends on any of the loop variables
+        // in 'vars'. Expressions that do not involve the variable have stride 0.
+        if (expr_uses_vars(acc_exprs[sdim], vars)) {
+           stride = max(stride, curr_stride);
+        }
+
+        const Interval &dim_range = buffer_bounds[sdim];
+        Expr dim_extent = get_extent(dim_range);
+        if (!dim_extent.defined()) {
+            return Expr();
+        }
+        curr_stride *= dim_extent;
+    }
+
+    return simplify(stride);
+}
+
+map<string, Expr>
+Partitioner::analyze_spatial_locality(const FStage &stg,
+                                      const map<string, Box> &allocation_bounds,
+                                      const set<string> &inlines) {
+    internal_assert(!stg.func.has_extern_definition());
+    // Handle inlining. When a function is inlined into another, the stride of
+    // the accesses should be computed on the expression post inlining.
+    // For example:
+    // f(x, y) = ...;
+    // g(x, y) = f(y, x); // transpose
+    // h(x, y) = g(y, x); // transpose
+    //
+    // If both g and f are inlined into h, then the resulting expression for h
+    // will look like:
+    // h(x, y) = f(x, y);
+    //
+    // Computing the stride of a loop over x in the function h will be incorrect
+    // if inlining is not taken into account.
+
+    // Get all the allocations accessed in the definition corresponding to 'stg'.
+    FindAllCalls find;
+    Definition def = get_stage_definition(stg.func, stg.stage_num);
+    // Perform inlining on the all the values and the args in the stage.
+    for (auto &val : def.values()) {
+        val = perform_inline(val, dep_analysis.env, inlines);
+    }
+    for (auto &arg : def.args()) {
+        arg = perform_inline(arg, dep_analysis.env, inlines);
+    }
+    def.accept(&find);
+
+    // Arguments on the left hand side might themselves involve accesses
+    // to allocations and thus need to be accounted for when computing the
+    // strides along each dimension.
+    vector<pair<string, vector<Expr>>> &call_args = find.call_args;
+    // Account for the spatial locality of the store. Add the access on the
+    // left hand side to call_args.
+    call_args.push_back(make_pair(stg.func.name(), def.args()));
+
+    // Map for holding the strides across each dimension
+    map<string, Expr> var_strides;
+    const vector<Dim> &dims = def.schedule().dims();
+
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        // Get all the variables involving the dimension in the definition.
+        FindVarsUsingVar dep_vars(dims[d].var);
+        def.accept(&dep_vars);
+
+        // Accumulate the stride of each access to a loop dimension.
+        Expr total_stride = 0;
+        for (const pair<string, vector<Expr>> &call : call_args) {
+            Box call_alloc_reg;
+            const auto &iter = allocation_bounds.find(call.first);
+            if (iter != allocation_bounds.end()) {
+                call_alloc_reg = iter->second;
+            } else {
+                call_alloc_reg = get_element(pipeline_bounds, call.first);
+            }
+            Expr current_stride = find_max_access_stride(dep_vars.vars, call.first,
+                                                         call.second, call_alloc_reg);
+            if (!current_stride.defined()) {
+                return map<string, Expr>();
+            }
+            total_stride += current_stride;
+        }
+        var_strides.emplace(dims[d].var, simplify(total_stride));
+    }
+
+    return var_strides;
+}
+
+// Verify that function 'f' does not have partially specified schedules/bounds.
+// The current auto scheduler cannots handle such cases.
+void validate_no_partial_schedules(const Function &f) {
+    if (f.has_extern_definition()) {
+        return;
+    }
+
+    // Verify no compute_root or bounds are specified
+    user_assert(f.schedule().compute_level().is_inlined())
+        << "AutoSchedule: cannot auto-schedule function \"" << f.name()
+        << "\" since it is scheduled to be computed at root\n";
+    user_assert(f.schedule().bounds().empty())
         << "AutoSchedule: cannot auto-schedule function \"" << f.name()
         << "\" since it has partially specified bounds\n";
 
@@ -3145,11 +3663,21 @@ void validate_no_partial_schedules(const Function &f) {
     }
 }
 
+// Inline 'callee' into 'caller'. If 'inlines' is not null, note the inlining
+// there so that it can be replayed later.
+void record_inline(Function caller, Function callee, vector<pair<string, string>> *inlines) {
+    inline_function(caller, callee);
+    if (inlines) {
+        inlines->push_back({caller.name(), callee.name()});
+    }
+}
+
 // If the cost of computing a Func is about the same as calling the Func,
 // inline the Func. Return true of any of the Funcs is inlined.
 bool inline_all_trivial_functions(const vector<Function> &outputs,
                                   const vector<string> &order,
-                                  const map<string, Function> &env) {
+                                  const map<string, Function> &env,
+                                  vector<pair<string, string>> *inlines) {
     bool inlined = false;
     // The very last few functions in 'order' are the last to be realized in the
     // pipeline (the final producers) so there is no point in checking it.
@@ -3182,7 +3710,7 @@ bool inline_all_trivial_functions(const vector<Function> &outputs,
                 } else {
                     debug(5) << "Inline trivial function \"" << f1.name()
                              << "\" inside \"" << f2.name() << "\"\n";
-                    inline_function(f2, f1);
+                    record_inline(f2, f1, inlines);
                 }
             }
         }
@@ -3245,7 +3773,8 @@ string is_func_called_element_wise(const vector<string> &order, size_t index,
 // element-wise manner.
 bool inline_all_element_wise_functions(const vector<Function> &outputs,
                                        const vector<string> &order,
-                                       const map<string, Function> &env) {
+                                       const map<string, Function> &env,
+                                       vector<pair<string, string>> *inlines) {
     bool inlined = false;
     // The very last few functions in 'order' are the last to be realized in the
     // pipeline (the final producers) so there is no point in checking it.
@@ -3268,7 +3797,7 @@ bool inline_all_element_wise_functions(const vector<Function> &outputs,
             debug(4) << "Inline function \"" << order[i] << "\" since it is called only by "
                      << caller << " in element-wise manner\n";
             internal_assert(order[i] != caller);
-            inline_function(env.at(caller), get_element(env, order[i]));
+            record_inline(env.at(caller), get_element(env, order[i]), inlines);
         }
     }
     return inlined;
@@ -3314,7 +3843,8 @@ set<string> get_unbounded_functions(const map<string, Box> &pipeline_bounds,
 bool inline_unbounded(const vector<Function> &outputs,
                       const vector<string> &order,
                       const map<string, Function> &env,
-                      const set<string> &unbounded) {
+                      const set<string> &unbounded,
+                      vector<pair<string, string>> *inlines) {
     bool inlined = false;
     // The very last few functions in 'order' are the last to be realized in the
     // pipeline (the final producers) so there is no point in checking it.
@@ -3330,19 +3860,49 @@ bool inline_unbounded(const vector<Function> &outputs,
             Function f2 = env.at(order[j]);
             debug(5) << "Inline unbounded function \"" << f1.name()
                      << "\" inside \"" << f2.name() << "\"\n";
-            inline_function(f2, f1);
+            record_inline(f2, f1, inlines);
         }
     }
     return inlined;
 }
 
-}  // anonymous namespace
+// The decisions made by generate_schedules, from which the same schedules can
+// be reapplied to a structurally identical pipeline without searching again.
+struct ScheduleRecord {
+    // The functions inlined into other functions, as (caller, callee) pairs
+    // in the order they were inlined.
+    vector<pair<string, string>> inlines;
+
+    // The vars and rvars introduced by the schedules, and whether each is an
+    // rvar.
+    vector<pair<string, bool>> vars;
+
+    // The schedule directives applied to each function stage, in order.
+    struct Directive {
+        string func;
+        int stage;
+        string text;
+    };
+    vector<Directive> directives;
+
+    // The string representation of the schedules.
+    string source;
+};
 
 // Generate schedules for all functions in the pipeline required to compute the
 // outputs. This applies the schedules and returns a string representation of
-// the schedules. The target architecture is specified by 'target'.
+// the schedules. The target architecture is specified by 'target'. If 'record'
+// is not null, the decisions made are saved there.
 string generate_schedules(const vector<Function> &outputs, const Target &target,
-                          const MachineParams &arch_params) {
+                          const MachineParams &arch_params,
+                          const AutoSchedulerCostModel &cost_model,
+                          ScheduleRecord *record) {
+    user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
+                target.arch == Target::POWERPC || target.arch == Target::MIPS)
+        << "Automatic scheduling is currently supported only on these architectures.";
+
+    vector<pair<string, string>> *inlines = record ? &record->inlines : nullptr;
+
     // Make an environment map which is used throughout the auto scheduling process.
     map<string, Function> env;
     for (Function f : outputs) {
@@ -3378,7 +3938,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     // computing a Func is about the same as calling that Func, we should
     // just inline it).
     debug(2) << "Inlining all trivial functions...\n";
-    if (inline_all_trivial_functions(outputs, top_order, env)) {
+    if (inline_all_trivial_functions(outputs, top_order, env, inlines)) {
         // If any of the Funcs is inlined, we need to recompute 'env', since some
         // of the Funcs are no longer used and need to be removed from 'env'.
         //
@@ -3415,7 +3975,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     // functions: 'f2' and 'f3'. If 'f2' and 'f4' get inlined and 'f3' is only
     // used by 'f4', then 'f1' can now also be inlined.
     debug(2) << "Inlining all element-wise functions...\n";
-    while (inline_all_element_wise_functions(outputs, order, env)) {
+    while (inline_all_element_wise_functions(outputs, order, env, inlines)) {
         // We need to recompute 'env' for the same reason as with
         // inline_all_trivial_functions
         env.clear();
@@ -3456,7 +4016,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
         // Also, we need to recompute 'env' and re-initialize 'costs' and
         // 'dep_analysis'
         debug(2) << "Inlining all unbounded functions...\n";
-        internal_assert(inline_unbounded(outputs, order, env, unbounded));
+        internal_assert(inline_unbounded(outputs, order, env, unbounded, inlines));
 
         env.clear();
         for (Function f : outputs) {
@@ -3476,7 +4036,7 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     }
 
     debug(2) << "Initializing partitioner...\n";
-    Partitioner part(pipeline_bounds, arch_params, outputs, dep_analysis, costs);
+    Partitioner part(pipeline_bounds, arch_params, cost_model, outputs, dep_analysis, costs);
 
     // Compute and display reuse
     /* TODO: Use the reuse estimates to reorder loops
@@ -3526,7 +4086,11 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, top_order);
     debug(2) << "Generating CPU schedule...\n";
-    part.generate_cpu_schedule(target, sched);
+    if (target.has_gpu_feature()) {
+        part.generate_gpu_schedule(target, sched);
+    } else {
+        part.generate_cpu_schedule(target, sched);
+    }
 
     std::ostringstream oss;
     oss << "// Target: " << target.to_string() << "\n";
@@ -3538,15 +4102,537 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
     debug(3) << "\n\n*******************************\nSchedule:\n"
              << "*******************************\n" << sched_string << "\n\n";
 
+    if (record) {
+        for (const auto &v : sched.internal_vars) {
+            record->vars.push_back({v.first, v.second.is_rvar});
+        }
+        for (const auto &f : sched.func_schedules) {
+            for (const auto &stage : f.second) {
+                for (const string &text : stage.second) {
+                    record->directives.push_back({f.first, stage.first, text});
+                }
+            }
+        }
+        record->source = sched_string;
+    }
+
     // TODO: Unify both inlining and grouping for fast mem
-    // TODO: GPU scheduling
     // TODO: Hierarchical tiling
 
     return sched_string;
 }
 
+// Collect the parameters and buffers referenced by a pipeline, whose
+// estimates and shapes also feed into the auto-scheduler's choices.
+class CollectScheduleInputs : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+        if (op->image.defined()) {
+            buffers[op->image.name()] = op->image;
+        }
+    }
+public:
+    map<string, Parameter> params;
+    map<string, Buffer<>> buffers;
+};
+
+uint64_t fnv1a_64(const string &data, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (char c : data) {
+        h = (h ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Describe everything about a pipeline that the auto-scheduler's choices
+// depend on, and hash it into a key for the cache of schedules.
+string schedule_cache_key(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params) {
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+
+    std::ostringstream structure;
+    CollectScheduleInputs inputs;
+    auto describe = [&](const Expr &e) {
+        if (e.defined()) {
+            structure << e;
+            e.accept(&inputs);
+        }
+        structure << "\n";
+    };
+    auto describe_definition = [&](const Definition &def) {
+        for (const Expr &e : def.args()) {
+            describe(e);
+        }
+        structure << "=\n";
+        for (const Expr &e : def.values()) {
+            describe(e);
+        }
+        structure << "if\n";
+        describe(def.predicate());
+        for (const ReductionVariable &rv : def.schedule().rvars()) {
+            structure << "rvar " << rv.var << "\n";
+            describe(rv.min);
+            describe(rv.extent);
+        }
+    };
+
+    for (Function f : outputs) {
+        structure << "output " << f.name() << "\n";
+    }
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        structure << "func " << f.name() << "\n";
+        for (const string &arg : f.args()) {
+            structure << "arg " << arg << "\n";
+        }
+        for (const Type &t : f.output_types()) {
+            structure << "type " << t << "\n";
+        }
+        if (f.has_extern_definition()) {
+            structure << "extern " << f.extern_function_name() << "\n";
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    structure << "func arg " << Function(arg.func).name() << "\n";
+                } else if (arg.is_expr()) {
+                    describe(arg.expr);
+                } else if (arg.is_buffer()) {
+                    inputs.buffers[arg.buffer.name()] = arg.buffer;
+                } else if (arg.is_image_param()) {
+                    inputs.params[arg.image_param.name()] = arg.image_param;
+                }
+            }
+        } else {
+            describe_definition(f.definition());
+            for (const Definition &def : f.updates()) {
+                structure << "update\n";
+                describe_definition(def);
+            }
+        }
+        for (const Bound &b : f.schedule().estimates()) {
+            structure << "estimate " << b.var << "\n";
+            describe(b.min);
+            describe(b.extent);
+        }
+    }
+
+    for (const auto &iter : inputs.params) {
+        const Parameter &p = iter.second;
+        structure << "param " << p.name() << " " << p.type() << " " << p.dimensions() << "\n";
+        if (p.is_buffer()) {
+            for (int i = 0; i < p.dimensions(); i++) {
+                describe(p.min_constraint_estimate(i));
+                describe(p.extent_constraint_estimate(i));
+            }
+        } else {
+            describe(p.estimate());
+        }
+    }
+    for (const auto &iter : inputs.buffers) {
+        const Buffer<> &b = iter.second;
+        structure << "buffer " << b.name() << " " << b.type();
+        for (int i = 0; i < b.dimensions(); i++) {
+            structure << " " << b.dim(i).min() << " " << b.dim(i).extent();
+        }
+        structure << "\n";
+    }
+
+    structure << "target " << target.to_string() << "\n"
+              << "machine_params " << arch_params.to_string() << "\n"
+              << "llvm " << LLVM_VERSION << " " << __DATE__ << " " << __TIME__ << "\n";
+
+    string s = structure.str();
+    std::ostringstream key;
+    key << std::hex << std::setfill('0')
+        << std::setw(16) << fnv1a_64(s)
+        << std::setw(16) << fnv1a_64(s, 0x84222325cbf29ce4ULL);
+    return key.str();
+}
+
+const char *const schedule_cache_header = "halide autoschedule 1";
+
+// Write a schedule record as text, one decision per line.
+string serialize_schedule_record(const ScheduleRecord &record, const string &key) {
+    std::ostringstream out;
+    out << schedule_cache_header << "\n"
+        << "key " << key << "\n";
+    for (const auto &i : record.inlines) {
+        out << "inline " << i.first << " " << i.second << "\n";
+    }
+    for (const auto &v : record.vars) {
+        out << "var " << v.first << " " << (v.second ? 1 : 0) << "\n";
+    }
+    for (const auto &d : record.directives) {
+        out << "schedule " << d.func << " " << d.stage << " " << d.text << "\n";
+    }
+    out << "source\n" << record.source;
+    return out.str();
+}
+
+// Parse a schedule record written by serialize_schedule_record. Returns false
+// if the text is malformed or was written for a different key.
+bool parse_schedule_record(const string &text, const string &key, ScheduleRecord &record) {
+    std::istringstream in(text);
+    string line;
+    if (!std::getline(in, line) || line != schedule_cache_header ||
+        !std::getline(in, line) || line != "key " + key) {
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        string kind;
+        fields >> kind;
+        if (kind == "inline") {
+            string caller, callee;
+            if (!(fields >> caller >> callee)) {
+                return false;
+            }
+            record.inlines.push_back({caller, callee});
+        } else if (kind == "var") {
+            string name;
+            int is_rvar;
+            if (!(fields >> name >> is_rvar)) {
+                return false;
+            }
+            record.vars.push_back({name, is_rvar != 0});
+        } else if (kind == "schedule") {
+            ScheduleRecord::Directive d;
+            if (!(fields >> d.func >> d.stage) || d.stage < 0) {
+                return false;
+            }
+            std::getline(fields >> std::ws, d.text);
+            if (d.text.empty() || d.text.back() != ')' ||
+                d.text.find('(') == string::npos) {
+                return false;
+            }
+            record.directives.push_back(d);
+        } else if (kind == "source") {
+            std::stringstream rest;
+            rest << in.rdbuf();
+            record.source = rest.str();
+            return true;
+        } else {
+            return false;
+        }
+    }
+    // A record with no source was truncated.
+    return false;
+}
+
+// Reapply the decisions in a schedule record to the functions required to
+// compute 'outputs'.
+void apply_schedule_record(const vector<Function> &outputs, const ScheduleRecord &record) {
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+    for (auto &iter : env) {
+        iter.second.lock_loop_levels();
+    }
+
+    // Functions are referred to by their sanitized names in compute_at.
+    map<string, Function> sanitized;
+    for (const auto &iter : env) {
+        sanitized.emplace(get_sanitized_name(iter.first), iter.second);
+    }
+
+    auto find_func = [&](const map<string, Function> &m, const string &name) {
+        auto iter = m.find(name);
+        user_assert(iter != m.end())
+            << "Cached auto-schedule refers to unknown Func " << name << "\n";
+        return iter->second;
+    };
+
+    for (const auto &i : record.inlines) {
+        inline_function(find_func(env, i.first), find_func(env, i.second));
+    }
+
+    map<string, bool> is_rvar;
+    for (const auto &v : record.vars) {
+        is_rvar[v.first] = v.second;
+    }
+
+    for (const auto &d : record.directives) {
+        Func f(find_func(env, d.func));
+        user_assert(d.stage <= (int)f.function().updates().size())
+            << "Cached auto-schedule refers to unknown stage " << d.stage
+            << " of Func " << d.func << "\n";
+        Stage stage = (d.stage == 0) ? Stage(f) : f.update(d.stage - 1);
+
+        set<string> rvars;
+        if (d.stage > 0) {
+            for (const ReductionVariable &rv :
+                     f.function().update(d.stage - 1).schedule().rvars()) {
+                rvars.insert(rv.var);
+            }
+        }
+        auto var = [&](const string &name) {
+            auto iter = is_rvar.find(name);
+            if ((iter != is_rvar.end()) ? iter->second : rvars.count(name)) {
+                return VarOrRVar(RVar(name));
+            }
+            return VarOrRVar(Var(name));
+        };
+
+        size_t open = d.text.find('(');
+        string directive = d.text.substr(0, open);
+        string arg_list = d.text.substr(open + 1, d.text.size() - open - 2);
+        vector<string> args;
+        if (!arg_list.empty()) {
+            args = split_string(arg_list, ", ");
+        }
+
+        if (directive == "compute_root" && args.empty()) {
+            f.compute_root();
+        } else if (directive == "compute_at" && args.size() == 2) {
+            Func at(find_func(sanitized, args[0]));
+            VarOrRVar v = var(args[1]);
+            if (v.is_rvar) {
+                f.compute_at(at, v.rvar);
+            } else {
+                f.compute_at(at, v.var);
+            }
+        } else if (directive == "store_in" && args.size() == 1) {
+            if (args[0] == "MemoryType::GPUShared") {
+                f.store_in(MemoryType::GPUShared);
+            } else if (args[0] == "MemoryType::Register") {
+                f.store_in(MemoryType::Register);
+            } else if (args[0] == "MemoryType::Stack") {
+                f.store_in(MemoryType::Stack);
+            } else if (args[0] == "MemoryType::Heap") {
+                f.store_in(MemoryType::Heap);
+            } else if (args[0] == "MemoryType::VTCM") {
+                f.store_in(MemoryType::VTCM);
+            } else {
+                f.store_in(MemoryType::Auto);
+            }
+        } else if (directive == "split" && (args.size() == 4 || args.size() == 5)) {
+            TailStrategy tail = TailStrategy::Auto;
+            if (args.size() == 5) {
+                if (args[4] == "TailStrategy::RoundUp") {
+                    tail = TailStrategy::RoundUp;
+                } else if (args[4] == "TailStrategy::GuardWithIf") {
+                    tail = TailStrategy::GuardWithIf;
+                } else if (args[4] == "TailStrategy::ShiftInwards") {
+                    tail = TailStrategy::ShiftInwards;
+                } else if (args[4] == "TailStrategy::Predicate") {
+                    tail = TailStrategy::Predicate;
+                }
+            }
+            stage.split(var(args[0]), var(args[1]), var(args[2]),
+                        std::stoi(args[3]), tail);
+        } else if (directive == "reorder" && !args.empty()) {
+            vector<VarOrRVar> order;
+            for (const string &a : args) {
+                order.push_back(var(a));
+            }
+            stage.reorder(order);
+        } else if (directive == "vectorize" && args.size() == 1) {
+            stage.vectorize(var(args[0]));
+        } else if (directive == "parallel" && args.size() == 1) {
+            stage.parallel(var(args[0]));
+        } else if (directive == "gpu_lanes" && args.size() == 1) {
+            stage.gpu_lanes(var(args[0]));
+        } else if (directive == "gpu_single_thread" && args.empty()) {
+            stage.gpu_single_thread();
+        } else if (directive == "gpu_threads" && args.size() == 1) {
+            stage.gpu_threads(var(args[0]));
+        } else if (directive == "gpu_threads" && args.size() == 2) {
+            stage.gpu_threads(var(args[0]), var(args[1]));
+        } else if (directive == "gpu_threads" && args.size() == 3) {
+            stage.gpu_threads(var(args[0]), var(args[1]), var(args[2]));
+        } else if (directive == "gpu_blocks" && args.size() == 1) {
+            stage.gpu_blocks(var(args[0]));
+        } else if (directive == "gpu_blocks" && args.size() == 2) {
+            stage.gpu_blocks(var(args[0]), var(args[1]));
+        } else if (directive == "gpu_blocks" && args.size() == 3) {
+            stage.gpu_blocks(var(args[0]), var(args[1]), var(args[2]));
+        } else {
+            user_error << "Cached auto-schedule contains unknown directive "
+                       << d.text << " for Func " << d.func << "\n";
+        }
+    }
+}
+}  // anonymous namespace
+
+string generate_schedules(const vector<Function> &outputs, const Target &target,
+                          const MachineParams &arch_params,
+                          const AutoSchedulerCostModel &cost_model) {
+    return generate_schedules(outputs, target, arch_params, cost_model, nullptr);
+}
+
+string generate_schedules_cached(const vector<Function> &outputs, const Target &target,
+                                 const MachineParams &arch_params,
+                                 const string &cache_dir) {
+    string key = schedule_cache_key(outputs, target, arch_params);
+    string path = cache_dir + "/" + key + ".autoschedule";
+
+    {
+        std::ifstream f(path);
+        if (f.good()) {
+            std::stringstream contents;
+            contents << f.rdbuf();
+            ScheduleRecord record;
+            if (parse_schedule_record(contents.str(), key, record)) {
+                debug(1) << "Reusing auto-schedule cached in " << path << "\n";
+                apply_schedule_record(outputs, record);
+                return record.source;
+            }
+            user_warning << "Ignoring malformed auto-schedule cache file " << path << "\n";
+        }
+    }
+
+    ScheduleRecord record;
+    string source = generate_schedules(outputs, target, arch_params,
+                                       AutoSchedulerCostModel(), &record);
+
+    // Write to a temporary file and rename it into place, so that
+    // concurrent builds never see a partially-written file.
+    string tmp_path = path + ".tmp" + std::to_string((uint64_t)(uintptr_t)&record);
+    {
+        std::ofstream f(tmp_path);
+        f << serialize_schedule_record(record, key);
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        user_warning << "Unable to write auto-schedule cache file " << path << "\n";
+        std::remove(tmp_path.c_str());
+    }
+
+    return source;
+}
+
+namespace {
+
+// The fastest of a few runs of 'f', in seconds, to factor out noise.
+template<typename F>
+double best_time(int runs, F f) {
+    double best = 0;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        f();
+        auto end = std::chrono::high_resolution_clock::now();
+        double t = std::chrono::duration<double>(end - start).count();
+        if (i == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// The time per byte of repeatedly summing the first 'footprint' bytes
+// of 'data', touching 'total' bytes in all.
+double time_per_byte_loaded(const std::vector<uint64_t> &data, size_t footprint, size_t total) {
+    const size_t n = footprint / sizeof(uint64_t);
+    const size_t reps = std::max((size_t)1, total / footprint);
+    volatile uint64_t sink = 0;
+    double t = best_time(3, [&]() {
+        uint64_t a = 0, b = 0, c = 0, d = 0;
+        for (size_t r = 0; r < reps; r++) {
+            for (size_t i = 0; i < n; i += 4) {
+                a += data[i];
+                b += data[i + 1];
+                c += data[i + 2];
+                d += data[i + 3];
+            }
+        }
+        sink = a + b + c + d;
+    });
+    (void)sink;
+    return t / (double)(reps * footprint);
+}
+
+// The load cost of the default model, evaluated in floating point.
+double linear_load_cost(double footprint, double llc, double balance) {
+    return std::min(1 + footprint * balance / llc, balance);
+}
+
+}  // namespace
+
 }  // namespace Internal
 
+Expr AutoSchedulerCostModel::load_cost(const MachineParams &params, const Expr &footprint) const {
+    // TODO: Use smooth step curve from Jon to better model cache behavior,
+    // where each step corresponds to different cache level.
+    //
+    // The cost drops off linearly. The cost is clamped at 'balance', which is
+    // roughly at memory footprint equal to or larger than the last level
+    // cache size.
+    Expr load_slope = cast<float>(params.balance) / params.last_level_cache_size;
+    return min(1 + footprint * load_slope, params.balance);
+}
+
+Expr AutoSchedulerCostModel::total_cost(const MachineParams &params,
+                                        const Expr &arith, const Expr &memory) const {
+    return arith + memory;
+}
+
+MachineParams MachineParams::calibrate() {
+    // Working sets from 16KB to 64MB.
+    const size_t min_footprint = 16 * 1024;
+    const size_t max_footprint = 64 * 1024 * 1024;
+    std::vector<uint64_t> data(max_footprint / sizeof(uint64_t));
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+
+    std::vector<double> footprints, costs;
+    for (size_t f = min_footprint; f <= max_footprint; f *= 2) {
+        footprints.push_back((double)f);
+        costs.push_back(Internal::time_per_byte_loaded(data, f, max_footprint));
+    }
+
+    // The model takes loads from a small footprint to cost as much
+    // as an arithmetic operation, so normalize to those.
+    const double base_cost = costs[0];
+    for (double &c : costs) {
+        c /= base_cost;
+    }
+
+    // The balance is the cost of loads that miss every cache. Fit
+    // the last level cache size to where the linear ramp up to it
+    // best matches the measurements, comparing in log space so that
+    // the small footprints count as much as the large ones.
+    double balance = std::max(2.0, std::round(costs.back()));
+    double best_llc = footprints.back(), best_error = 0;
+    for (size_t i = 0; i < footprints.size(); i++) {
+        double error = 0;
+        for (size_t j = 0; j < footprints.size(); j++) {
+            double e = std::log(Internal::linear_load_cost(footprints[j], footprints[i], balance)) -
+                std::log(costs[j]);
+            error += e * e;
+        }
+        if (i == 0 || error < best_error) {
+            best_error = error;
+            best_llc = footprints[i];
+        }
+    }
+
+    int parallelism = (int)std::thread::hardware_concurrency();
+    if (parallelism <= 0) {
+        parallelism = generic().parallelism.as<Internal::IntImm>()->value;
+    }
+
+    Internal::debug(1) << "Calibrated machine params: parallelism " << parallelism
+                       << ", last level cache " << best_llc
+                       << " bytes, balance " << balance << "\n";
+
+    return MachineParams(parallelism, (int32_t)best_llc, (int32_t)balance);
+}
+
 MachineParams MachineParams::generic() {
     return MachineParams(16, 16 * 1024 * 1024, 40);
 }
@@ -33,6 +33,42 @@ struct MachineParams {
 
     /** Reconstruct a MachineParams from canonical string form. */
     explicit MachineParams(const std::string &s);
+
+    /** Measure the machine parameters of the host by running a few
+     * microbenchmarks. The parallelism is the number of hardware
+     * threads. The last level cache size and balance are fit to the
+     * measured cost of streaming loads over working sets of growing
+     * size, relative to loads from the smallest one, which the cost
+     * model treats as costing the same as an arithmetic operation.
+     * This takes around a second. The result can be stored per
+     * machine type with to_string() and passed back in, e.g. as the
+     * machine_params GeneratorParam. */
+    static MachineParams calibrate();
+};
+
+/** The model the auto-scheduler uses to compare groupings of
+ * Funcs. The auto-scheduler estimates, for each candidate grouping,
+ * the number of arithmetic operations done and the number of bytes
+ * loaded from each Func or input buffer along with the footprint of
+ * the region loaded from. The cost model turns those into a single
+ * cost. Subclass this to plug in a different model; the default
+ * implementation is the analytic model the auto-scheduler has always
+ * used. */
+class AutoSchedulerCostModel {
+public:
+    virtual ~AutoSchedulerCostModel() {}
+
+    /** The cost of loading a byte from a Func or buffer, given the
+     * size in bytes of the region being loaded from, relative to the
+     * cost of an arithmetic operation. The default grows linearly
+     * with the footprint from 1 and is clamped at the balance of the
+     * machine once the footprint reaches the last level cache size. */
+    virtual Expr load_cost(const MachineParams &params, const Expr &footprint) const;
+
+    /** Combine the arithmetic and memory costs of a grouping into the
+     * single figure that is minimized. The default is their sum. */
+    virtual Expr total_cost(const MachineParams &params,
+                            const Expr &arith, const Expr &memory) const;
 };
 
 namespace Internal {
@@ -41,10 +77,23 @@ namespace Internal {
  * have specializations or schedules as the current auto-scheduler does not take
  * into account user-defined schedules or specializations. This applies the
  * schedules and returns a string representation of the schedules. The target
- * architecture is specified by 'target'. */
+ * architecture is specified by 'target'. Groupings are compared using
+ * 'cost_model'. */
 std::string generate_schedules(const std::vector<Function> &outputs,
                                const Target &target,
-                               const MachineParams &arch_params);
+                               const MachineParams &arch_params,
+                               const AutoSchedulerCostModel &cost_model = AutoSchedulerCostModel());
+
+/** Like generate_schedules, but reuses the schedules generated by an earlier
+ * build of a structurally identical pipeline, if one was saved in
+ * 'cache_dir'. The cache is keyed by a hash of the algorithm, the estimates on
+ * its inputs and outputs, the target, the machine parameters and the version
+ * of Halide, so any change to these generates the schedules afresh. The
+ * result of a fresh search is saved in 'cache_dir' for next time. */
+std::string generate_schedules_cached(const std::vector<Function> &outputs,
+                                      const Target &target,
+                                      const MachineParams &arch_params,
+                                      const std::string &cache_dir);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -0,0 +1,57 @@
+#include "BatchWrapper.h"
+#include "Error.h"
+#include "LLVM_Headers.h"
+
+using namespace llvm;
+
+namespace Halide {
+namespace Internal {
+
+llvm::Function *define_batch_wrapper(llvm::Module *module,
+                                     llvm::Function *pipeline_argv_wrapper,
+                                     llvm::Function *unchecked_argv_wrapper,
+                                     llvm::Function *metadata_getter,
+                                     const std::string &name) {
+    LLVMContext &ctx = module->getContext();
+
+    llvm::Function *do_batch = module->getFunction("halide_do_batch");
+    internal_assert(do_batch) << "Did not find function 'halide_do_batch' in module.\n";
+
+    llvm::Type *i8_ty = llvm::Type::getInt8Ty(ctx);
+    llvm::Type *i32_ty = llvm::Type::getInt32Ty(ctx);
+    Value *user_context = ConstantPointerNull::get(i8_ty->getPointerTo());
+
+    llvm::Type *batch_arg_types[] = {
+        i32_ty,
+        i8_ty->getPointerTo()->getPointerTo()->getPointerTo(),
+    };
+    FunctionType *batch_ty = FunctionType::get(i32_ty, batch_arg_types, false);
+    llvm::Function *batch = llvm::Function::Create(batch_ty, llvm::GlobalValue::ExternalLinkage, name, module);
+    BasicBlock *entry = BasicBlock::Create(ctx, "entry", batch);
+
+    IRBuilder<> ir(ctx);
+    ir.SetInsertPoint(entry);
+
+    // Call the metadata_getter function to get the metadata pointer block.
+    llvm::CallInst *metadata_ptr = ir.CreateCall(metadata_getter);
+
+    llvm::Function::arg_iterator batch_args = batch->arg_begin();
+    Value *batch_size = iterator_to_pointer(batch_args++);
+    Value *argvs = iterator_to_pointer(batch_args++);
+
+    Value *do_batch_args[] = {
+        user_context,
+        metadata_ptr,
+        pipeline_argv_wrapper,
+        unchecked_argv_wrapper,
+        batch_size,
+        argvs,
+    };
+    llvm::CallInst *result = ir.CreateCall(do_batch, do_batch_args);
+    ir.CreateRet(result);
+
+    return batch;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,36 @@
+#ifndef HALIDE_BATCH_WRAPPER_H
+#define HALIDE_BATCH_WRAPPER_H
+
+/** \file
+ *
+ * Provides an output function to generate a batched entry point,
+ * which runs a pipeline on many sets of arguments in one call.
+ */
+
+#include <string>
+
+namespace llvm {
+class Module;
+class Function;
+}  // namespace llvm
+
+namespace Halide {
+namespace Internal {
+
+/** Add a batched entry point with the given name to the module. It
+ * has the signature int name(int batch_size, void ***argvs), and runs
+ * the pipeline on each of the argv arrays in argvs. The first is run
+ * through pipeline_argv_wrapper, and the rest in parallel through
+ * unchecked_argv_wrapper, a copy of the pipeline without assertions,
+ * whenever their arguments match the first. Returns the definition of
+ * the entry point. */
+llvm::Function *define_batch_wrapper(llvm::Module *module,
+                                     llvm::Function *pipeline_argv_wrapper,
+                                     llvm::Function *unchecked_argv_wrapper,
+                                     llvm::Function *metadata_getter,
+                                     const std::string &name);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
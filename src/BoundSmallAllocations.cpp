@@ -1,6 +1,9 @@
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
+#include "IROperator.h"
 #include "Simplify.h"
 
 namespace Halide {
@@ -79,5 +82,120 @@ Stmt bound_small_allocations(const Stmt &s) {
     return BoundSmallAllocations().mutate(s);
 }
 
+// Move the heap allocations of Funcs stored per worker out of the
+// innermost parallel loop that contains them.
+class HoistWorkerStorage : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const std::map<std::string, Function> &env;
+
+    // Bounds of the variables defined inside the parallel loop, in
+    // terms of the variables defined outside of it.
+    Scope<Interval> scope;
+    bool in_parallel_loop = false;
+
+    struct Pool {
+        std::string name;
+        Expr slot_bytes;
+    };
+    std::vector<Pool> pools;
+
+    bool stored_per_worker(const std::string &name) {
+        auto it = env.find(name);
+        if (it == env.end()) {
+            // Tuple-valued Funcs have one allocation per element.
+            size_t dot = name.rfind('.');
+            if (dot != std::string::npos) {
+                it = env.find(name.substr(0, dot));
+            }
+        }
+        return it != env.end() && it->second.schedule().store_per_worker();
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        if (!in_parallel_loop) {
+            return IRMutator2::visit(op);
+        }
+        ScopedBinding<Interval> bind(scope, op->name, bounds_of_expr_in_scope(op->value, scope));
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            // Device code doesn't heap allocate.
+            return op;
+        } else if (op->for_type == ForType::Parallel) {
+            // Allocations in here belong to this loop.
+            HoistWorkerStorage inner(env);
+            inner.in_parallel_loop = true;
+            ScopedBinding<Interval> bind(inner.scope, op->name,
+                                         Interval(op->min, op->min + op->extent - 1));
+            Stmt body = inner.mutate(op->body);
+            Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            for (const Pool &p : inner.pools) {
+                Expr create = Call::make(Handle(), "halide_scratch_pool_create", {p.slot_bytes}, Call::Extern);
+                stmt = Allocate::make(p.name, UInt(8), MemoryType::Heap, {}, const_true(), stmt,
+                                      create, "halide_scratch_pool_destroy");
+            }
+            return stmt;
+        } else if (in_parallel_loop) {
+            Interval min_bounds = bounds_of_expr_in_scope(op->min, scope);
+            Interval max_bounds = bounds_of_expr_in_scope(op->min + op->extent - 1, scope);
+            ScopedBinding<Interval> bind(scope, op->name, Interval::make_union(min_bounds, max_bounds));
+            return IRMutator2::visit(op);
+        } else {
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (!in_parallel_loop ||
+            op->new_expr.defined() ||
+            op->memory_type == MemoryType::Stack ||
+            op->memory_type == MemoryType::Register ||
+            !stored_per_worker(op->name)) {
+            return IRMutator2::visit(op);
+        }
+
+        // Leave alone allocations that codegen will put on the stack.
+        int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+        if (constant_size > 0 &&
+            op->memory_type != MemoryType::Heap &&
+            can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes())) {
+            return IRMutator2::visit(op);
+        }
+
+        Expr bytes = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            bytes *= cast<int64_t>(e);
+        }
+        Interval bounds = bounds_of_expr_in_scope(bytes, scope);
+        if (!bounds.has_upper_bound() || expr_uses_vars(bounds.max, scope)) {
+            user_warning << "Can't hoist the storage of " << op->name
+                         << " out of the enclosing parallel loop, because its size"
+                         << " can't be bounded outside of that loop.\n";
+            return IRMutator2::visit(op);
+        }
+
+        // Pad the blocks the same way heap allocations are padded.
+        Pool pool = {op->name + ".worker_pool", simplify(cast<uint64_t>(bounds.max + op->type.bytes()))};
+        pools.push_back(pool);
+
+        Expr acquire = Call::make(Handle(), "halide_scratch_pool_acquire",
+                                  {Variable::make(Handle(), pool.name)}, Call::Extern);
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents, op->condition,
+                              mutate(op->body), acquire, "halide_scratch_pool_release");
+    }
+
+public:
+    HoistWorkerStorage(const std::map<std::string, Function> &env) : env(env) {}
+};
+
+Stmt hoist_worker_storage(const Stmt &s, const std::map<std::string, Function> &env) {
+    return HoistWorkerStorage(env).mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
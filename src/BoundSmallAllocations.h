@@ -1,6 +1,10 @@
 #ifndef HALIDE_BOUND_SMALL_ALLOCATIONS
 #define HALIDE_BOUND_SMALL_ALLOCATIONS
 
+#include <map>
+#include <string>
+
+#include "Function.h"
 #include "IR.h"
 
 /** \file
@@ -19,6 +23,13 @@ namespace Internal {
  * calls for (provably) tiny allocations. */
 Stmt bound_small_allocations(const Stmt &s);
 
+/** Hoist the heap allocations of Funcs scheduled with
+ * Func::store_per_worker out of the innermost enclosing parallel
+ * loop. The size of each is bounded in terms of values defined
+ * outside of the loop, and the loop's tasks reuse blocks of that
+ * size from a pool created before the loop starts. */
+Stmt hoist_worker_storage(const Stmt &s, const std::map<std::string, Function> &env);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -44,7 +44,11 @@ namespace Halide {
  *  recommended for correctness and performance. Some of these are hard
  *  to get right. The versions here are both understood by bounds
  *  inference, and also judiciously use the 'likely' intrinsic to minimize
- *  runtime overhead.
+ *  runtime overhead. The likely tags mark the image, one dimension at a
+ *  time, so loop partitioning splits each loop over a consumer into
+ *  border loops and an interior loop over the range for which every
+ *  access lands in the image. In the interior loop the clamps and
+ *  selects are gone and loads from the source are dense vector loads.
  *
  */
 namespace BoundaryConditions {
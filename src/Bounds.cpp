@@ -207,13 +207,12 @@ private:
     void visit(const Variable *op) {
         if (const_bound) {
             bounds_of_type(op->type);
-            if (scope.contains(op->name)) {
-                const Interval &scope_interval = scope.get(op->name);
-                if (scope_interval.has_upper_bound() && is_const(scope_interval.max)) {
-                    interval.max = Interval::make_min(interval.max, scope_interval.max);
+            if (const Interval *scope_interval = scope.find(op->name)) {
+                if (scope_interval->has_upper_bound() && is_const(scope_interval->max)) {
+                    interval.max = Interval::make_min(interval.max, scope_interval->max);
                 }
-                if (scope_interval.has_lower_bound() && is_const(scope_interval.min)) {
-                    interval.min = Interval::make_max(interval.min, scope_interval.min);
+                if (scope_interval->has_lower_bound() && is_const(scope_interval->min)) {
+                    interval.min = Interval::make_max(interval.min, scope_interval->min);
                 }
             }
 
@@ -230,8 +229,8 @@ private:
                 }
             }
         } else {
-            if (scope.contains(op->name)) {
-                interval = scope.get(op->name);
+            if (const Interval *scope_interval = scope.find(op->name)) {
+                interval = *scope_interval;
             } else if (op->type.is_vector()) {
                 // Uh oh, we need to take the min/max lane of some unknown vector. Treat as unbounded.
                 bounds_of_type(op->type);
@@ -1242,8 +1241,8 @@ private:
     int innermost_depth = -1;
 
     void visit(const Variable *op) {
-        if (vars_depth.contains(op->name)) {
-            int depth = vars_depth.get(op->name);
+        if (const int *d = vars_depth.find(op->name)) {
+            int depth = *d;
             if (depth > innermost_depth) {
                 innermost_var = op->name;
                 innermost_depth = depth;
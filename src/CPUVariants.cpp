@@ -0,0 +1,167 @@
+#include <cstring>
+
+#include "CPUVariants.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+const char *const cpu_variant_marker = ".__cpu_variant.";
+
+// The features a CPU variant may add. All of these are only used by
+// the x86 code generator and the x86 initial modules.
+const Target::Feature x86_isa_features[] = {
+    Target::SSE41, Target::AVX, Target::AVX2, Target::FMA, Target::FMA4, Target::F16C,
+    Target::AVX512, Target::AVX512_KNL, Target::AVX512_Skylake, Target::AVX512_Cannonlake,
+    Target::AVX512_VNNI, Target::AVX512_256,
+};
+
+bool is_x86_isa_feature(Target::Feature f) {
+    for (Target::Feature isa : x86_isa_features) {
+        if (f == isa) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class InjectCPUVariants : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const map<string, Function> &env;
+    const Target &target;
+    bool in_device_loop = false;
+
+    // A call to halide_can_use_target_features that checks for the
+    // given features, mirroring the dispatch in compile_multitarget.
+    Expr can_use(const vector<Target::Feature> &features) {
+        const int words = (Target::FeatureEnd + 63) / 64;
+        vector<uint64_t> bits(words, 0);
+        for (Target::Feature f : features) {
+            bits[f >> 6] |= ((uint64_t)1) << (f & 63);
+        }
+        vector<Expr> struct_args;
+        for (uint64_t b : bits) {
+            struct_args.push_back(UIntImm::make(UInt(64), b));
+        }
+        Expr features_struct = Call::make(type_of<uint64_t *>(), Call::make_struct, struct_args, Call::Intrinsic);
+        return Call::make(Int(32), "halide_can_use_target_features",
+                          {words, features_struct}, Call::Extern) != 0;
+    }
+
+    Stmt make_variants(const string &name, Stmt body, const vector<vector<Target::Feature>> &variants) {
+        // The variants are tried in order, so build the chain from
+        // the back.
+        Target host = target.has_feature(Target::JIT) ? get_host_target() : Target();
+        Stmt result = body;
+        for (size_t i = variants.size(); i > 0; i--) {
+            const vector<Target::Feature> &features = variants[i - 1];
+            for (Target::Feature f : features) {
+                user_assert(is_x86_isa_feature(f))
+                    << "Func " << name << " has a CPU variant with feature " << f
+                    << ", which is not an x86 instruction set feature.\n";
+            }
+            Target variant = target;
+            variant.set_features(features);
+            if (variant == target) {
+                // The base code already uses all of these.
+                continue;
+            }
+            Stmt loop = For::make(name + cpu_variant_marker + variant.to_string(),
+                                  0, 1, ForType::Serial, DeviceAPI::None, body);
+            if (target.has_feature(Target::JIT)) {
+                // The code will run on this machine, so pick now.
+                if (host.features_all_of(features)) {
+                    result = loop;
+                }
+            } else {
+                result = IfThenElse::make(can_use(features), loop, result);
+            }
+        }
+        return result;
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host) {
+            return IRMutator2::visit(op);
+        }
+        ScopedValue<bool> old_in_device_loop(in_device_loop, true);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        Stmt body = mutate(op->body);
+        auto it = env.find(op->name);
+        if (op->is_producer && !in_device_loop && it != env.end() &&
+            !it->second.schedule().cpu_variants().empty()) {
+            body = make_variants(op->name, body, it->second.schedule().cpu_variants());
+        }
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+public:
+    InjectCPUVariants(const map<string, Function> &env, const Target &t)
+        : env(env), target(t) {}
+};
+
+class CPUVariantFeatures : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        string variant = cpu_variant_target(op->name);
+        if (!variant.empty()) {
+            Target v(variant);
+            for (Target::Feature f : x86_isa_features) {
+                if (v.has_feature(f)) {
+                    result.set_feature(f);
+                }
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    Target result;
+    CPUVariantFeatures(const Target &t) : result(t) {}
+};
+
+}  // namespace
+
+Stmt inject_cpu_variants(Stmt s, const map<string, Function> &env, const Target &t) {
+    if (t.arch != Target::X86) {
+        return s;
+    }
+    return InjectCPUVariants(env, t).mutate(s);
+}
+
+string cpu_variant_target(const string &loop_name) {
+    size_t pos = loop_name.find(cpu_variant_marker);
+    if (pos == string::npos) {
+        return string();
+    }
+    return loop_name.substr(pos + strlen(cpu_variant_marker));
+}
+
+Target with_cpu_variant_features(const Stmt &s, const Target &t) {
+    if (t.arch != Target::X86 || !s.defined()) {
+        return t;
+    }
+    CPUVariantFeatures f(t);
+    s.accept(&f);
+    return f.result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,40 @@
+#ifndef HALIDE_CPU_VARIANTS_H
+#define HALIDE_CPU_VARIANTS_H
+
+/** \file
+ * Defines the lowering pass that compiles the producers of Funcs
+ * scheduled with Func::cpu_variants for several instruction sets.
+ */
+
+#include <map>
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Wrap the produce node of each Func with cpu_variants in a chain of
+ * runtime checks of halide_can_use_target_features. Each check
+ * guards a copy of the body inside a single-iteration loop that
+ * names the target it should be compiled for, and the original body
+ * runs if none of them pass. When jitting, the best variant the host
+ * supports is picked at compile time instead. Has no effect on
+ * non-x86 targets. */
+Stmt inject_cpu_variants(Stmt s, const std::map<std::string, Function> &env, const Target &t);
+
+/** If the loop with the given name was made by inject_cpu_variants,
+ * return the target its body should be compiled for. Otherwise
+ * return an empty string. */
+std::string cpu_variant_target(const std::string &loop_name);
+
+/** Return t with the instruction-set features of every CPU variant in
+ * s added, so that the initial module has the helpers they need. */
+Target with_cpu_variant_features(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
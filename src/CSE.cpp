@@ -1,4 +1,5 @@
 #include <map>
+#include <set>
 
 #include "CSE.h"
 #include "IREquality.h"
@@ -85,6 +86,11 @@ public:
     struct Entry {
         Expr expr;
         int use_count;
+        // When numbering a run of statements, the first statement
+        // that uses this entry, and whether any other statement
+        // uses it too.
+        int stmt;
+        bool shared;
     };
     vector<Entry> entries;
 
@@ -101,8 +107,11 @@ public:
     GVN() : number(0), cache(8) {}
 
     Stmt mutate(const Stmt &s) override {
-        internal_error << "Can't call GVN on a Stmt: " << s << "\n";
-        return Stmt();
+        // Only statements without sub-statements can be numbered,
+        // one expression at a time.
+        internal_assert(s.as<Store>() || s.as<Provide>() || s.as<Evaluate>())
+            << "Can't call GVN on a Stmt: " << s << "\n";
+        return IRMutator2::mutate(s);
     }
 
     ExprWithCompareCache with_cache(Expr e) {
@@ -122,8 +131,8 @@ public:
 
         // If e is a var, check if it has been redirected to an existing numbering.
         if (const Variable *var = e.as<Variable>()) {
-            if (let_substitutions.contains(var->name)) {
-                number = let_substitutions.get(var->name);
+            if (const int *n = let_substitutions.find(var->name)) {
+                number = *n;
                 internal_assert(entries[number].expr.type() == e.type());
                 return entries[number].expr;
             }
@@ -153,7 +162,7 @@ public:
         }
 
         // Add it to the numbering.
-        Entry entry = {new_e, 0};
+        Entry entry = {new_e, 0, -1, false};
         number = (int)entries.size();
         numbering[with_cache(new_e)] = number;
         shallow_numbering[new_e] = number;
@@ -215,6 +224,10 @@ class ComputeUseCounts : public IRGraphVisitor {
     GVN &gvn;
     bool lift_all;
 public:
+    // The statement currently being counted, when counting uses
+    // across a run of statements.
+    int current_stmt = 0;
+
     ComputeUseCounts(GVN &g, bool l) : gvn(g), lift_all(l) {}
 
     using IRGraphVisitor::include;
@@ -235,6 +248,11 @@ public:
         if (iter != gvn.shallow_numbering.end()) {
             GVN::Entry &entry = gvn.entries[iter->second];
             entry.use_count++;
+            if (entry.stmt < 0) {
+                entry.stmt = current_stmt;
+            } else if (entry.stmt != current_stmt) {
+                entry.shared = true;
+            }
         }
 
         // Visit the children if we haven't been here before.
@@ -268,6 +286,7 @@ public:
 };
 
 class CSEEveryExprInStmt : public IRMutator2 {
+protected:
     bool lift_all;
 
 public:
@@ -280,6 +299,205 @@ public:
     CSEEveryExprInStmt(bool l) : lift_all(l) {}
 };
 
+/** Count the uses of each entry of a numbering within one statement,
+ * ignoring the entries in a given set and everything under them. */
+class CountUsesInStmt : public IRGraphVisitor {
+    const GVN &gvn;
+    bool lift_all;
+    const std::set<int> &ignored;
+public:
+    // Use counts by entry number.
+    map<int, int> counts;
+
+    CountUsesInStmt(const GVN &g, bool l, const std::set<int> &i) : gvn(g), lift_all(l), ignored(i) {}
+
+    using IRGraphVisitor::include;
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) override {
+        if (!should_extract(e, lift_all)) {
+            e.accept(this);
+            return;
+        }
+
+        auto iter = gvn.shallow_numbering.find(e);
+        if (iter != gvn.shallow_numbering.end()) {
+            if (ignored.count(iter->second)) {
+                return;
+            }
+            counts[iter->second]++;
+        }
+
+        IRGraphVisitor::include(e);
+    }
+};
+
+/** Check whether an expression might evaluate differently at
+ * different points in a straight-line sequence of statements,
+ * because it reads memory or has side-effects. Memoized per node, so
+ * checking every entry of a numbering is linear in its size. */
+class ReadsMemory : public IRGraphVisitor {
+    std::map<const IRNode *, bool> memo;
+    bool result = false;
+
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) override {
+        auto it = memo.find(e.get());
+        if (it != memo.end()) {
+            result = result || it->second;
+            return;
+        }
+        bool old_result = result;
+        result = false;
+        e.accept(this);
+        memo[e.get()] = result;
+        result = result || old_result;
+    }
+
+    void visit(const Load *op) override {
+        result = true;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure() ||
+            op->call_type == Call::Halide ||
+            op->call_type == Call::Image) {
+            result = true;
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+public:
+    bool check(const Expr &e) {
+        result = false;
+        include(e);
+        return result;
+    }
+};
+
+bool is_leaf_stmt(const Stmt &s) {
+    return s.as<Store>() || s.as<Provide>() || s.as<Evaluate>();
+}
+
+// Wrap a statement in LetStmts defining the given lets, rebuilding
+// their values in terms of the lets that enclose them.
+Stmt wrap_in_let_stmts(Stmt s, const vector<pair<string, Expr>> &lets, Replacer &replacer) {
+    for (size_t i = lets.size(); i > 0; i--) {
+        Expr value = lets[i-1].second;
+        replacer.replacements.erase(value);
+        value = replacer.mutate(value);
+        s = LetStmt::make(lets[i-1].first, value, s);
+    }
+    return s;
+}
+
+/** Number every expression in each run of consecutive leaf
+ * statements at once. Subexpressions used more than once within one
+ * statement become LetStmts around that statement. Subexpressions
+ * shared by several statements of the run become LetStmts around the
+ * whole run, provided they don't read memory, which the statements
+ * in between may write. */
+class CSEAcrossStmts : public CSEEveryExprInStmt {
+    using CSEEveryExprInStmt::visit;
+
+    Stmt cse_run(const vector<Stmt> &run) {
+        GVN gvn;
+        vector<Stmt> canonical;
+        for (const Stmt &s : run) {
+            canonical.push_back(gvn.mutate(s));
+        }
+
+        ComputeUseCounts count_uses(gvn, lift_all);
+        for (size_t i = 0; i < canonical.size(); i++) {
+            count_uses.current_stmt = (int)i;
+            count_uses.include(canonical[i]);
+        }
+
+        // Pick the subexpressions to lift out of the whole run.
+        ReadsMemory reads_memory;
+        vector<pair<string, Expr>> hoisted;
+        map<Expr, Expr, ExprCompare> hoisted_replacements;
+        std::set<int> hoisted_entries;
+        for (size_t i = 0; i < gvn.entries.size(); i++) {
+            const GVN::Entry &e = gvn.entries[i];
+            if (e.use_count > 1 && e.shared && !reads_memory.check(e.expr)) {
+                string name = unique_name('t');
+                hoisted.push_back({name, e.expr});
+                hoisted_replacements[e.expr] = Variable::make(e.expr.type(), name);
+                hoisted_entries.insert((int)i);
+            }
+        }
+
+        // Then the ones to lift out of each statement, counting
+        // uses within that statement only.
+        vector<Stmt> result;
+        for (const Stmt &s : canonical) {
+            CountUsesInStmt count_local_uses(gvn, lift_all, hoisted_entries);
+            count_local_uses.include(s);
+
+            vector<pair<string, Expr>> local;
+            map<Expr, Expr, ExprCompare> replacements = hoisted_replacements;
+            for (const auto &p : count_local_uses.counts) {
+                if (p.second > 1) {
+                    const Expr &e = gvn.entries[p.first].expr;
+                    string name = unique_name('t');
+                    local.push_back({name, e});
+                    replacements[e] = Variable::make(e.type(), name);
+                }
+            }
+
+            Replacer replacer(replacements);
+            result.push_back(wrap_in_let_stmts(replacer.mutate(s), local, replacer));
+        }
+
+        Replacer replacer(hoisted_replacements);
+        return wrap_in_let_stmts(Block::make(result), hoisted, replacer);
+    }
+
+    Stmt visit(const Block *op) override {
+        vector<Stmt> stmts, result, run;
+        Stmt s = op;
+        while (const Block *b = s.as<Block>()) {
+            stmts.push_back(b->first);
+            s = b->rest;
+        }
+        stmts.push_back(s);
+
+        for (const Stmt &stmt : stmts) {
+            if (is_leaf_stmt(stmt)) {
+                run.push_back(stmt);
+                continue;
+            }
+            if (!run.empty()) {
+                result.push_back(cse_run(run));
+                run.clear();
+            }
+            result.push_back(mutate(stmt));
+        }
+        if (!run.empty()) {
+            result.push_back(cse_run(run));
+        }
+        return Block::make(result);
+    }
+
+    Stmt visit(const Store *op) override {
+        return cse_run({op});
+    }
+
+    Stmt visit(const Provide *op) override {
+        return cse_run({op});
+    }
+
+    Stmt visit(const Evaluate *op) override {
+        return cse_run({op});
+    }
+
+public:
+    CSEAcrossStmts(bool l) : CSEEveryExprInStmt(l) {}
+};
+
 } // namespace
 
 Expr common_subexpression_elimination(const Expr &e_in, bool lift_all) {
@@ -339,6 +557,10 @@ Stmt common_subexpression_elimination(const Stmt &s, bool lift_all) {
     return CSEEveryExprInStmt(lift_all).mutate(s);
 }
 
+Stmt common_subexpression_elimination_across_stmts(const Stmt &s, bool lift_all) {
+    return CSEAcrossStmts(lift_all).mutate(s);
+}
+
 
 // Testing code.
 
@@ -370,6 +592,14 @@ class NormalizeVarNames : public IRMutator2 {
         return Let::make(new_name, value, body);
     }
 
+    Stmt visit(const LetStmt *let) override {
+        string new_name = "t" + std::to_string(counter++);
+        new_names[let->name] = new_name;
+        Expr value = mutate(let->value);
+        Stmt body = mutate(let->body);
+        return LetStmt::make(new_name, value, body);
+    }
+
 public:
     NormalizeVarNames() : counter(0) {}
 };
@@ -384,6 +614,16 @@ void check(Expr in, Expr correct) {
         << "\ninstead of:\n" << correct << "\n";
 }
 
+void check_across_stmts(Stmt in, Stmt correct) {
+    Stmt result = common_subexpression_elimination_across_stmts(in);
+    NormalizeVarNames n;
+    result = n.mutate(result);
+    internal_assert(equal(result, correct))
+        << "Incorrect CSE across statements:\n" << in
+        << "\nbecame:\n" << result
+        << "\ninstead of:\n" << correct << "\n";
+}
+
 // Construct a nested block of lets. Variables of the form "tn" refer
 // to expr n in the vector.
 Expr ssa_block(vector<Expr> exprs) {
@@ -532,6 +772,25 @@ void cse_test() {
         check(e, correct);
     }
 
+    {
+        // x*y is shared between the statements, so it's lifted out
+        // of all of them. The load is shared too, but a store in
+        // between could change it, so it's only lifted out of the
+        // statement that uses it twice.
+        Expr load = Load::make(Int(32), "a", y, Buffer<>(), Parameter(), const_true());
+        Stmt s = Block::make({Store::make("b", x*y + x, x, Parameter(), const_true()),
+                              Store::make("c", (x*y)*(x*y) + load, x, Parameter(), const_true()),
+                              Store::make("d", load*load, y, Parameter(), const_true())});
+
+        Stmt correct =
+            LetStmt::make("t0", x*y,
+                          Block::make({Store::make("b", t[0] + x, x, Parameter(), const_true()),
+                                       Store::make("c", t[0]*t[0] + load, x, Parameter(), const_true()),
+                                       LetStmt::make("t1", load,
+                                                     Store::make("d", t[1]*t[1], y, Parameter(), const_true()))}));
+        check_across_stmts(s, correct);
+    }
+
     debug(0) << "common_subexpression_elimination test passed\n";
 }
 
@@ -29,6 +29,15 @@ Expr common_subexpression_elimination(const Expr &, bool lift_all = false);
  * statement. Does not introduce let statements. */
 Stmt common_subexpression_elimination(const Stmt &, bool lift_all = false);
 
+/** Do common-subexpression-elimination jointly on all the
+ * expressions of each run of consecutive Store, Provide and Evaluate
+ * statements, with a single value numbering per run. Subexpressions
+ * repeated within a statement are lifted into let statements around
+ * it, and subexpressions that don't read memory and are shared
+ * between the statements of a run are lifted into let statements
+ * around the whole run. */
+Stmt common_subexpression_elimination_across_stmts(const Stmt &, bool lift_all = false);
+
 void cse_test();
 
 }  // namespace Internal
@@ -2,6 +2,7 @@
 #include <sstream>
 
 #include "CodeGen_ARM.h"
+#include "CodeGen_Internal.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
 #include "IREquality.h"
@@ -463,7 +464,76 @@ void CodeGen_ARM::visit(const Div *op) {
     CodeGen_Posix::visit(op);
 }
 
+bool CodeGen_ARM::codegen_dot_product(const Add *op) {
+#if LLVM_VERSION >= 60
+    const int lanes = op->type.lanes();
+    if (!target.has_feature(Target::ARMDotProd) ||
+        neon_intrinsics_disabled() ||
+        !(op->type.is_int() || op->type.is_uint()) ||
+        op->type.bits() != 32 || lanes % 2 != 0) {
+        return false;
+    }
+
+    // udot and sdot add four 8-bit products to each 32-bit lane. The
+    // operands are interleaved so that each 32-bit lane holds the
+    // values for its products.
+    const int factor = 4;
+    struct DotProduct {
+        Type narrow;
+        const char *intrin;
+    };
+    const DotProduct dot_products[] = {
+        {UInt(8, lanes), "udot"},
+        {Int(8, lanes), "sdot"},
+    };
+    for (const DotProduct &d : dot_products) {
+        vector<Expr> as, bs, products, rest;
+        find_widening_products(op, d.narrow, d.narrow, as, bs, products, rest);
+        int groups = (int)products.size() / factor;
+        if (groups == 0) {
+            continue;
+        }
+
+        // Everything else, including any leftover products, is the
+        // accumulator the dot products get added to.
+        for (size_t i = groups * factor; i < products.size(); i++) {
+            rest.push_back(products[i]);
+        }
+        Expr init = make_zero(op->type);
+        for (size_t i = 0; i < rest.size(); i++) {
+            init = (i == 0) ? rest[i] : init + rest[i];
+        }
+        Value *acc = codegen(init);
+
+        int intrin_lanes = (lanes % 4 == 0) ? 4 : 2;
+        string name = (target.bits == 32 ? "llvm.arm.neon." : "llvm.aarch64.neon.") + string(d.intrin) +
+            ".v" + std::to_string(intrin_lanes) + "i32.v" + std::to_string(intrin_lanes * factor) + "i8";
+        llvm::Type *result_t = VectorType::get(i32_t, intrin_lanes);
+        for (int g = 0; g < groups; g++) {
+            vector<Expr> group_a(as.begin() + g * factor, as.begin() + (g + 1) * factor);
+            vector<Expr> group_b(bs.begin() + g * factor, bs.begin() + (g + 1) * factor);
+            Value *a = codegen(Shuffle::make_interleave(group_a));
+            Value *b = codegen(Shuffle::make_interleave(group_b));
+            vector<Value *> results;
+            for (int i = 0; i < lanes; i += intrin_lanes) {
+                results.push_back(call_intrin(result_t, intrin_lanes, name,
+                                              {slice_vector(acc, i, intrin_lanes),
+                                               slice_vector(a, i * factor, intrin_lanes * factor),
+                                               slice_vector(b, i * factor, intrin_lanes * factor)}));
+            }
+            acc = concat_vectors(results);
+        }
+        value = acc;
+        return true;
+    }
+#endif
+    return false;
+}
+
 void CodeGen_ARM::visit(const Add *op) {
+    if (codegen_dot_product(op)) {
+        return;
+    }
     CodeGen_Posix::visit(op);
 }
 
@@ -485,7 +555,9 @@ void CodeGen_ARM::visit(const Sub *op) {
     // llvm will generate floating point negate instructions if we ask for (-0.0f)-x
     if (op->type.is_float() && is_zero(op->a)) {
         Constant *a;
-        if (op->type.bits() == 32) {
+        if (op->type.bits() == 16) {
+            a = ConstantFP::getNegativeZero(f16_t);
+        } else if (op->type.bits() == 32) {
             a = ConstantFP::getNegativeZero(f32_t);
         } else if (op->type.bits() == 64) {
             a = ConstantFP::getNegativeZero(f64_t);
@@ -663,6 +735,14 @@ void CodeGen_ARM::visit(const Store *op) {
         return;
     }
 
+    // Atomic update
+    if (const Call *c = op->value.as<Call>()) {
+        if (c->is_intrinsic(Call::atomic_update)) {
+            CodeGen_Posix::visit(op);
+            return;
+        }
+    }
+
     if (neon_intrinsics_disabled()) {
         CodeGen_Posix::visit(op);
         return;
@@ -694,9 +774,13 @@ void CodeGen_ARM::visit(const Store *op) {
         intrin_type = t;
         Type elt = t.element_of();
         int vec_bits = t.bits() * t.lanes();
+        // AArch64 also has interleaving stores of 64-bit elements.
+        bool wide_ok = target.bits == 64 &&
+            (elt == Float(64) || elt == Int(64) || elt == UInt(64));
         if (elt == Float(32) ||
             elt == Int(8) || elt == Int(16) || elt == Int(32) ||
-            elt == UInt(8) || elt == UInt(16) || elt == UInt(32)) {
+            elt == UInt(8) || elt == UInt(16) || elt == UInt(32) ||
+            wide_ok) {
             if (vec_bits % 128 == 0) {
                 type_ok_for_vst = true;
                 intrin_type = intrin_type.with_lanes(128 / t.bits());
@@ -990,6 +1074,25 @@ void CodeGen_ARM::visit(const Call *op) {
                 return;
             }
         }
+    } else if (op->is_intrinsic(Call::rounding_shift_right) &&
+               op->type.is_vector() && op->type.bits() <= 32 &&
+               !neon_intrinsics_disabled()) {
+        // A rounding shift left by a negative amount is a rounding
+        // shift right.
+        Type t = op->type;
+        int intrin_lanes = (t.bits() * t.lanes() == 64) ? t.lanes() : 128 / t.bits();
+        if ((t.bits() * t.lanes()) % 64 == 0) {
+            std::ostringstream suffix;
+            suffix << ".v" << intrin_lanes << "i" << t.bits();
+            string intrin;
+            if (target.bits == 32) {
+                intrin = (t.is_int() ? "llvm.arm.neon.vrshifts" : "llvm.arm.neon.vrshiftu") + suffix.str();
+            } else {
+                intrin = (t.is_int() ? "llvm.aarch64.neon.srshl" : "llvm.aarch64.neon.urshl") + suffix.str();
+            }
+            value = call_intrin(t, intrin_lanes, intrin, {op->args[0], -op->args[1]});
+            return;
+        }
     }
 
     CodeGen_Posix::visit(op);
@@ -1012,21 +1115,31 @@ string CodeGen_ARM::mcpu() const {
 }
 
 string CodeGen_ARM::mattrs() const {
+    string attrs;
     if (target.bits == 32) {
         if (target.has_feature(Target::ARMv7s)) {
-            return "+neon";
+            attrs = "+neon";
         } if (!target.has_feature(Target::NoNEON)) {
-            return "+neon";
+            attrs = "+neon";
         } else {
-            return "-neon";
+            attrs = "-neon";
         }
     } else {
         if (target.os == Target::IOS || target.os == Target::OSX) {
-            return "+reserve-x18";
-        } else {
-            return "";
+            attrs = "+reserve-x18";
         }
     }
+    if (target.has_feature(Target::ARMDotProd)) {
+        attrs += attrs.empty() ? "+dotprod" : ",+dotprod";
+    }
+    if (target.has_feature(Target::ARMFp16)) {
+        attrs += attrs.empty() ? "+fullfp16" : ",+fullfp16";
+    }
+    if (target.has_feature(Target::ARMSVE)) {
+        user_assert(target.bits == 64) << "arm_sve is only supported on 64-bit ARM\n";
+        attrs += attrs.empty() ? "+sve" : ",+sve";
+    }
+    return attrs;
 }
 
 bool CodeGen_ARM::use_soft_float_abi() const {
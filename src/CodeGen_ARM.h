@@ -26,6 +26,15 @@ protected:
     // @{
     void visit(const Cast *);
     void visit(const Add *);
+    // @}
+
+    /** Generate udot/sdot for a sum of widening 8-bit products, if
+     * the target supports them. Returns false if the sum doesn't
+     * match. */
+    bool codegen_dot_product(const Add *);
+
+    /** Nodes for which we want to emit specific neon intrinsics */
+    // @{
     void visit(const Sub *);
     void visit(const Div *);
     void visit(const Mul *);
@@ -2,11 +2,22 @@
 #include <limits>
 
 #include "CodeGen_C.h"
+#include "CodeGen_D3D12Compute_Dev.h"
+#include "CodeGen_GPU_Dev.h"
 #include "CodeGen_Internal.h"
+#include "CodeGen_Metal_Dev.h"
+#include "CodeGen_OpenCL_Dev.h"
+#include "CodeGen_OpenGLCompute_Dev.h"
+#include "CodeGen_PTX_Dev.h"
+#include "CodeGen_Vulkan_Dev.h"
 #include "Deinterleave.h"
+#include "DeviceArgument.h"
+#include "FixedPointMath.h"
 #include "IROperator.h"
 #include "Lerp.h"
+#include "ModulusRemainder.h"
 #include "Param.h"
+#include "PeakMemoryUsage.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Var.h"
@@ -31,6 +42,7 @@ extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenGLCompu
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenGL_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeQurt_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeD3D12Compute_h[];
+extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeVulkan_h[];
 
 namespace {
 
@@ -134,6 +146,14 @@ inline T halide_cpp_max(const T &a, const T &b) {return (a > b) ? a : b;}
 template<typename T>
 inline T halide_cpp_min(const T &a, const T &b) {return (a < b) ? a : b;}
 
+// The task function for a parallel loop, whose closure is a lambda
+// holding the loop body.
+template<typename Body>
+int halide_cpp_par_for_task(void *user_context, int idx, uint8_t *closure) {
+    (void) user_context;
+    return (*(Body *)closure)(idx);
+}
+
 template<typename A, typename B>
 const B &return_second(const A &a, const B &b) {
     (void) a;
@@ -167,6 +187,7 @@ class TypeInfoGatherer : public IRGraphVisitor {
 public:
     std::set<ForType> for_types_used;
     std::set<Type> vector_types_used;
+    std::set<DeviceAPI> gpu_device_apis_used;
 
     using IRGraphVisitor::include;
     using IRGraphVisitor::visit;
@@ -199,10 +220,50 @@ public:
 
     void visit(const For *op) {
         for_types_used.insert(op->for_type);
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            gpu_device_apis_used.insert(op->device_api);
+        }
         IRGraphVisitor::visit(op);
     }
 };
 
+bool is_c_identifier(const string &s) {
+    if (s.empty() || isdigit(s[0])) {
+        return false;
+    }
+    for (char c : s) {
+        if (!isalnum(c) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Make the device code generator for a GPU API that the C host code
+// can launch kernels on, or return nullptr if there is none.
+CodeGen_GPU_Dev *make_gpu_codegen(DeviceAPI device_api, const Target &target) {
+    switch (device_api) {
+    case DeviceAPI::CUDA:
+        return new CodeGen_PTX_Dev(target);
+    case DeviceAPI::OpenCL:
+        return new CodeGen_OpenCL_Dev(target);
+    case DeviceAPI::Metal:
+        return new CodeGen_Metal_Dev(target);
+    case DeviceAPI::OpenGLCompute:
+        return new CodeGen_OpenGLCompute_Dev(target);
+    case DeviceAPI::D3D12Compute:
+        return new CodeGen_D3D12Compute_Dev(target);
+    case DeviceAPI::Vulkan:
+        return new CodeGen_Vulkan_Dev(target);
+    default:
+        // GLSL kernels need the vertex buffer setup done by the llvm
+        // host codegen.
+        return nullptr;
+    }
+}
+
 CodeGen_C::CodeGen_C(ostream &s, Target t, OutputKind output_kind, const std::string &guard) :
     IRPrinter(s), id("$$ BAD ID $$"), target(t), output_kind(output_kind), extern_c_open(false) {
 
@@ -258,6 +319,10 @@ CodeGen_C::CodeGen_C(ostream &s, Target t, OutputKind output_kind, const std::st
 CodeGen_C::~CodeGen_C() {
     set_name_mangling_mode(NameMangling::Default);
 
+    for (auto &i : cgdev) {
+        delete i.second;
+    }
+
     if (is_header()) {
         if (!target.has_feature(Target::NoRuntime)) {
             stream << "\n"
@@ -310,6 +375,9 @@ CodeGen_C::~CodeGen_C() {
             if (target.has_feature(Target::D3D12Compute)) {
                 stream << halide_internal_runtime_header_HalideRuntimeD3D12Compute_h << '\n';
             }
+            if (target.has_feature(Target::Vulkan)) {
+                stream << halide_internal_runtime_header_HalideRuntimeVulkan_h << '\n';
+            }
         }
         stream << "#endif\n";
     }
@@ -320,6 +388,11 @@ string type_to_c_type(Type type, bool include_space, bool c_plus_plus = true) {
     bool needs_space = true;
     ostringstream oss;
 
+    if (type.is_bfloat()) {
+        // bfloat16 values only exist as their bits.
+        return type_to_c_type(type.with_code(Type::UInt), include_space, c_plus_plus);
+    }
+
     if (type.is_float()) {
         if (type.bits() == 32) {
             oss << "float";
@@ -434,6 +507,14 @@ void CodeGen_C::add_vector_typedefs(const std::set<Type> &vector_types) {
     #define __has_builtin(x) 0
 #endif
 
+// Used for vector loads and stores known to be aligned to the size of
+// the vector.
+#if __has_builtin(__builtin_assume_aligned) || __GNUC__
+    #define halide_cpp_assume_aligned(p, alignment) __builtin_assume_aligned((p), (alignment))
+#else
+    #define halide_cpp_assume_aligned(p, alignment) (p)
+#endif
+
 template <typename ElementType_, size_t Lanes_>
 class CppVector {
 public:
@@ -485,6 +566,14 @@ public:
         return r;
     }
 
+    static Vec aligned_load(const void *base, int32_t offset) {
+        Vec r(empty);
+        memcpy(&r.elements[0],
+               halide_cpp_assume_aligned((const ElementType*)base + offset, sizeof(r.elements)),
+               sizeof(r.elements));
+        return r;
+    }
+
     // gather
     static Vec load(const void *base, const CppVector<int32_t, Lanes> &offset) {
         Vec r(empty);
@@ -498,6 +587,11 @@ public:
         memcpy(((ElementType*)base + offset), &this->elements[0], sizeof(this->elements));
     }
 
+    void aligned_store(void *base, int32_t offset) const {
+        memcpy(halide_cpp_assume_aligned((ElementType*)base + offset, sizeof(this->elements)),
+               &this->elements[0], sizeof(this->elements));
+    }
+
     // scatter
     void store(void *base, const CppVector<int32_t, Lanes> &offset) const {
         for (size_t i = 0; i < Lanes; i++) {
@@ -882,6 +976,14 @@ public:
         return r;
     }
 
+    static Vec aligned_load(const void *base, int32_t offset) {
+        Vec r(empty);
+        memcpy(&r.native_vector,
+               halide_cpp_assume_aligned((const ElementType*)base + offset, sizeof(NativeVectorType)),
+               sizeof(NativeVectorType));
+        return r;
+    }
+
     // gather
     // TODO: could this be improved by taking advantage of native operator support?
     static Vec load(const void *base, const NativeVector<int32_t, Lanes> &offset) {
@@ -897,6 +999,11 @@ public:
         memcpy(((ElementType*)base + offset), &native_vector, sizeof(NativeVectorType));
     }
 
+    void aligned_store(void *base, int32_t offset) const {
+        memcpy(halide_cpp_assume_aligned((ElementType*)base + offset, sizeof(NativeVectorType)),
+               &native_vector, sizeof(NativeVectorType));
+    }
+
     // scatter
     // TODO: could this be improved by taking advantage of native operator support?
     void store(void *base, const NativeVector<int32_t, Lanes> &offset) const {
@@ -1295,6 +1402,16 @@ class ExternCallPrototypes : public IRGraphVisitor {
         }
     }
 
+    void visit(const For *op) {
+        if (CodeGen_GPU_Dev::is_gpu_var(op->name)) {
+            // The body is device code, compiled separately.
+            include(op->min);
+            include(op->extent);
+        } else {
+            IRGraphVisitor::visit(op);
+        }
+    }
+
     void emit_function_decl(ostream &stream, const Call *op, const std::string &name) const {
         // op->name (rather than the name arg) since we need the fully-qualified C++ name
         if (internal_linkage.count(op->name)) {
@@ -1436,6 +1553,23 @@ void CodeGen_C::compile(const Module &input) {
                           type_info.for_types_used.count(ForType::GPUThread) ||
                           type_info.for_types_used.count(ForType::GPULane));
 
+    // Compile the kernels for the GPU loops with the usual device
+    // code generators, and launch them through the device runtimes,
+    // as the llvm host codegen does.
+    if (!is_header()) {
+        for (DeviceAPI device_api : type_info.gpu_device_apis_used) {
+            CodeGen_GPU_Dev *gpu_codegen = make_gpu_codegen(device_api, target);
+            if (!gpu_codegen) {
+                for (auto &i : cgdev) {
+                    delete i.second;
+                }
+                cgdev.clear();
+                break;
+            }
+            cgdev[device_api] = gpu_codegen;
+        }
+    }
+
     // Forward-declare all the types we need; this needs to happen before
     // we emit function prototypes, since those may need the types.
     stream << "\n";
@@ -1483,6 +1617,23 @@ void CodeGen_C::compile(const Module &input) {
             set_name_mangling_mode(NameMangling::C);
             e.emit_c_declarations(stream);
         }
+
+        // The device runtime entry points for launching kernels.
+        if (!cgdev.empty()) {
+            set_name_mangling_mode(NameMangling::C);
+            for (const auto &i : cgdev) {
+                string api_name = i.second->api_unique_name();
+                stream << "int halide_" << api_name << "_initialize_kernels(void *user_context, void **state_ptr, "
+                       << "const char *src, int size);\n";
+                stream << "int halide_" << api_name << "_run(void *user_context, void *state_ptr, const char *entry_name, "
+                       << "int blocksX, int blocksY, int blocksZ, int threadsX, int threadsY, int threadsZ, "
+                       << "int shared_mem_bytes, "
+                       << (i.second->kernel_run_takes_types() ? "struct halide_type_t arg_types[], " : "size_t arg_sizes[], ")
+                       << "void *args[], int8_t arg_is_buffer[], int num_attributes, float *vertex_buffer, "
+                       << "int num_coords_dim0, int num_coords_dim1);\n";
+            }
+            stream << "\n";
+        }
     }
 
     for (const auto &b : input.buffers()) {
@@ -1529,6 +1680,37 @@ void CodeGen_C::compile(const LoweredFunc &f) {
         stream << "\n";
     }
 
+    // Declare the state of the kernels this function launches, and
+    // the functions that initialize it, which are defined after it
+    // once its kernels have been compiled.
+    function_name = simple_name;
+    function_device_apis.clear();
+    if (!is_header() && !cgdev.empty()) {
+        TypeInfoGatherer type_info;
+        f.body.accept(&type_info);
+        for (DeviceAPI device_api : type_info.gpu_device_apis_used) {
+            CodeGen_GPU_Dev *gpu_codegen = cgdev[device_api];
+            gpu_codegen->init_module();
+            function_device_apis.insert(device_api);
+            string api_name = gpu_codegen->api_unique_name();
+            stream << "static void *" << gpu_module_state_name(api_name) << " = nullptr;\n"
+                   << "static int " << gpu_initialize_kernels_name(api_name) << "(void *user_context);\n\n";
+        }
+    }
+
+    if (is_header() && f.linkage != LinkageType::Internal) {
+        // Tell the user how much memory the pipeline may need, in
+        // terms of its arguments.
+        PeakMemoryUsage usage = compute_peak_memory_usage(f.body);
+        stream << "// Upper bounds on the memory allocated by " << simple_name << ", in bytes:\n";
+        if (usage.heap_bytes.defined()) {
+            stream << "//   heap: " << usage.heap_bytes << "\n"
+                   << "//   stack: " << usage.stack_bytes << "\n";
+        } else {
+            stream << "//   unknown\n";
+        }
+    }
+
     // Emit the function prototype
     if (f.linkage == LinkageType::Internal) {
         // If the function isn't public, mark it static.
@@ -1554,7 +1736,7 @@ void CodeGen_C::compile(const LoweredFunc &f) {
         stream << ") HALIDE_FUNCTION_ATTRS {\n";
         indent += 1;
 
-        if (uses_gpu_for_loops) {
+        if (uses_gpu_for_loops && cgdev.empty()) {
             do_indent();
             stream << "halide_error("
                    << (have_user_context ? "__user_context_" : "nullptr")
@@ -1572,6 +1754,17 @@ void CodeGen_C::compile(const LoweredFunc &f) {
                        << ";\n";
             }
 
+            for (DeviceAPI device_api : function_device_apis) {
+                string api_name = cgdev[device_api]->api_unique_name();
+                string result = print_assignment(Int(32), gpu_initialize_kernels_name(api_name) + "(_ucon)");
+                do_indent();
+                stream << "if (" << result << ")\n";
+                open_scope();
+                do_indent();
+                stream << "return " << result << ";\n";
+                close_scope("");
+            }
+
             // Emit the body
             print(f.body);
 
@@ -1582,6 +1775,28 @@ void CodeGen_C::compile(const LoweredFunc &f) {
 
         indent -= 1;
         stream << "}\n";
+
+        // Now that the kernels are compiled, embed their source.
+        for (DeviceAPI device_api : function_device_apis) {
+            CodeGen_GPU_Dev *gpu_codegen = cgdev[device_api];
+            string api_name = gpu_codegen->api_unique_name();
+            std::vector<char> kernel_src = gpu_codegen->compile_to_src();
+            string src_name = "halide_" + simple_name + "_" + api_name + "_kernel_src";
+            stream << "\nstatic const uint8_t " << src_name << "[] = {\n";
+            for (size_t i = 0; i < kernel_src.size(); i++) {
+                stream << (i % 16 == 0 ? (i > 0 ? ",\n " : " ") : ", ") << (int)(uint8_t)kernel_src[i];
+            }
+            if (kernel_src.empty()) {
+                stream << " 0";
+            }
+            stream << "\n};\n\n"
+                   << "static int " << gpu_initialize_kernels_name(api_name) << "(void *user_context) {\n"
+                   << " return halide_" << api_name << "_initialize_kernels(user_context, &"
+                   << gpu_module_state_name(api_name) << ", (const char *)" << src_name << ", "
+                   << kernel_src.size() << ");\n"
+                   << "}\n";
+        }
+        function_device_apis.clear();
     }
 
     if (is_header() && f.linkage == LinkageType::ExternalPlusMetadata) {
@@ -1590,6 +1805,11 @@ void CodeGen_C::compile(const LoweredFunc &f) {
 
         // And also the metadata.
         stream << "const struct halide_filter_metadata_t *" << simple_name << "_metadata() HALIDE_FUNCTION_ATTRS;\n";
+
+        // And the batched version, for many sets of arguments at once.
+        if (target.has_feature(Target::Batch)) {
+            stream << "int " << simple_name << "_batch(int batch_size, void ***args) HALIDE_FUNCTION_ATTRS;\n";
+        }
     }
 
     if (!namespaces.empty()) {
@@ -1983,6 +2203,11 @@ void CodeGen_C::visit(const Call *op) {
         Type t = op->type.with_code(op->type.is_int() ? Type::UInt : op->type.code());
         Expr e = cast(t, select(a < b, b - a, a - b));
         rhs << print_expr(e);
+    } else if (op->is_intrinsic(Call::saturating_add) ||
+               op->is_intrinsic(Call::saturating_sub) ||
+               op->is_intrinsic(Call::rounding_shift_right) ||
+               op->is_intrinsic(Call::saturating_rounding_doubling_high_multiply)) {
+        rhs << print_expr(lower_fixed_point_intrinsic(op));
     } else if (op->is_intrinsic(Call::return_second)) {
         internal_assert(op->args.size() == 2);
         string arg0 = print_expr(op->args[0]);
@@ -2151,14 +2376,22 @@ void CodeGen_C::visit(const Call *op) {
         user_error << "Signed integer overflow occurred during constant-folding. Signed"
             " integer overflow for int32 and int64 is undefined behavior in"
             " Halide.\n";
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        user_error << "atomic() updates are not supported by this backend.\n";
+    } else if (op->is_intrinsic(Call::streaming_store)) {
+        // Only a hint; store normally.
+        internal_assert(op->args.size() == 1);
+        rhs << print_expr(op->args[0]);
     } else if (op->is_intrinsic(Call::prefetch)) {
-        user_assert((op->args.size() == 4) && is_one(op->args[2]))
+        user_assert((op->args.size() == 5) && is_one(op->args[3]))
             << "Only prefetch of 1 cache line is supported in C backend.\n";
         const Variable *base = op->args[0].as<Variable>();
         internal_assert(base && base->type.is_handle());
+        const int64_t *locality = as_const_int(op->args[2]);
+        internal_assert(locality);
         rhs << "__builtin_prefetch("
             << "((" << print_type(op->type) << " *)" << print_name(base->name)
-            << " + " << print_expr(op->args[1]) << "), 1)";
+            << " + " << print_expr(op->args[1]) << "), 1, " << *locality << ")";
     } else if (op->is_intrinsic(Call::indeterminate_expression)) {
         user_error << "Indeterminate expression occurred during constant-folding.\n";
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
@@ -2215,12 +2448,33 @@ string CodeGen_C::print_extern_call(const Call *op) {
     return rhs.str();
 }
 
+bool CodeGen_C::is_aligned_vector_access(const string &name, const Parameter &param,
+                                         Type t, const Expr &base) {
+    // Like the llvm codegen, only use aligned accesses for vectors
+    // whose size is a power of two, and where the base of the buffer
+    // and the offset into it are both known to be multiples of that
+    // size.
+    int vector_bytes = t.bytes() * t.lanes();
+    if (vector_bytes & (vector_bytes - 1)) {
+        return false;
+    }
+    int base_alignment = 0;
+    if (param.defined()) {
+        base_alignment = param.host_alignment();
+    } else if (allocations.contains(name)) {
+        base_alignment = allocations.get(name).alignment;
+    }
+    if (base_alignment % vector_bytes != 0) {
+        return false;
+    }
+    ModulusRemainder mod_rem = modulus_remainder(base);
+    return ((int64_t)mod_rem.modulus * t.bytes()) % vector_bytes == 0 &&
+        ((int64_t)mod_rem.remainder * t.bytes()) % vector_bytes == 0;
+}
+
 void CodeGen_C::visit(const Load *op) {
     user_assert(is_one(op->predicate)) << "Predicated load is not supported by C backend.\n";
 
-    // TODO: We could replicate the logic in the llvm codegen which decides whether
-    // the vector access can be aligned. Doing so would also require introducing
-    // aligned type equivalents for all the vector types.
     ostringstream rhs;
 
     Type t = op->type;
@@ -2231,7 +2485,8 @@ void CodeGen_C::visit(const Load *op) {
     if (dense_ramp_base.defined()) {
         internal_assert(t.is_vector());
         string id_ramp_base = print_expr(dense_ramp_base);
-        rhs << print_type(t) + "::load(" << name << ", " << id_ramp_base << ")";
+        const char *load = is_aligned_vector_access(op->name, op->param, t, dense_ramp_base) ? "::aligned_load(" : "::load(";
+        rhs << print_type(t) + load << name << ", " << id_ramp_base << ")";
     } else if (op->index.type().is_vector()) {
         // If index is a vector, gather vector elements.
         internal_assert(t.is_vector());
@@ -2258,17 +2513,14 @@ void CodeGen_C::visit(const Store *op) {
     string id_value = print_expr(op->value);
     string name = print_name(op->name);
 
-    // TODO: We could replicate the logic in the llvm codegen which decides whether
-    // the vector access can be aligned. Doing so would also require introducing
-    // aligned type equivalents for all the vector types.
-
     // If we're writing a contiguous ramp, just store the vector.
     Expr dense_ramp_base = strided_ramp_base(op->index, 1);
     if (dense_ramp_base.defined()) {
         internal_assert(op->value.type().is_vector());
         string id_ramp_base = print_expr(dense_ramp_base);
+        const char *store = is_aligned_vector_access(op->name, op->param, t, dense_ramp_base) ? ".aligned_store(" : ".store(";
         do_indent();
-        stream << id_value + ".store(" << name << ", " << id_ramp_base << ");\n";
+        stream << id_value + store << name << ", " << id_ramp_base << ");\n";
     } else if (op->index.type().is_vector()) {
         // If index is a vector, scatter vector elements.
         internal_assert(t.is_vector());
@@ -2342,6 +2594,12 @@ void CodeGen_C::visit(const LetStmt *op) {
                << " " << print_name(op->name)
                << " = " << id_value << ";\n";
     } else {
+        if (!cgdev.empty() && !is_c_identifier(id_value)) {
+            // GPU kernels take the vars they use as arguments, by
+            // name, so they must stay vars rather than becoming
+            // constants or expressions.
+            id_value = print_assignment(op->value.type(), id_value);
+        }
         Expr new_var = Variable::make(op->value.type(), id_value);
         body = substitute(op->name, new_var, body);
     }
@@ -2398,13 +2656,63 @@ void CodeGen_C::visit(const ProducerConsumer *op) {
     print_stmt(op->body);
 }
 
+void CodeGen_C::visit(const Fork *op) {
+    // The two sides of a fork may block on each other, so they must
+    // run concurrently.
+    do_indent();
+    stream << "#pragma omp parallel sections num_threads(2)\n";
+    open_scope();
+    do_indent();
+    stream << "#pragma omp section\n";
+    open_scope();
+    op->first.accept(this);
+    close_scope("");
+    do_indent();
+    stream << "#pragma omp section\n";
+    open_scope();
+    op->rest.accept(this);
+    close_scope("");
+    close_scope("fork");
+}
+
 void CodeGen_C::visit(const For *op) {
+    if (CodeGen_GPU_Dev::is_gpu_var(op->name) && cgdev.count(op->device_api)) {
+        emit_gpu_kernel_launch(op);
+        return;
+    }
+
     string id_min = print_expr(op->min);
     string id_extent = print_expr(op->extent);
 
     if (op->for_type == ForType::Parallel) {
+        // Run the body as a lambda through halide_do_par_for, so that
+        // parallel loops use the runtime's thread pool, or the one
+        // set with halide_set_custom_do_par_for, like the llvm
+        // backends do.
+        string loop_var = print_name(op->name);
+        string closure = "_par_for" + loop_var;
+        open_scope();
+        do_indent();
+        stream << "auto " << closure << " = [&](int " << loop_var << ") -> int\n";
+        open_scope();
+        op->body.accept(this);
+        do_indent();
+        stream << "return 0;\n";
+        cache.clear();
+        indent--;
         do_indent();
-        stream << "#pragma omp parallel for\n";
+        stream << "};\n";
+
+        string status = print_assignment(Int(32), "halide_do_par_for(_ucon, halide_cpp_par_for_task<decltype(" + closure + ")>, " +
+                                         id_min + ", " + id_extent + ", (uint8_t *)&" + closure + ")");
+        do_indent();
+        stream << "if (" << status << ")\n";
+        open_scope();
+        do_indent();
+        stream << "return " << status << ";\n";
+        close_scope("");
+        close_scope("par for " + loop_var);
+        return;
     } else {
         internal_assert(op->for_type == ForType::Serial)
             << "Can only emit serial or parallel for loops to C\n";
@@ -2428,6 +2736,106 @@ void CodeGen_C::visit(const For *op) {
 
 }
 
+string CodeGen_C::gpu_module_state_name(const string &api_unique_name) const {
+    return "module_state_" + function_name + "_" + api_unique_name;
+}
+
+string CodeGen_C::gpu_initialize_kernels_name(const string &api_unique_name) const {
+    return "halide_" + function_name + "_" + api_unique_name + "_initialize_kernels";
+}
+
+void CodeGen_C::emit_gpu_kernel_launch(const For *loop) {
+    debug(2) << "Kernel launch: " << loop->name << "\n";
+
+    ExtractBounds bounds;
+    loop->accept(&bounds);
+    // TODO: only three dimensions can be passed to the device
+    // runtimes. How should we handle blkid[3]?
+    internal_assert(is_one(bounds.num_threads[3]) && is_one(bounds.num_blocks[3]))
+        << bounds.num_threads[3] << ", " << bounds.num_blocks[3] << "\n";
+
+    string kernel_name = unique_name("kernel_" + loop->name);
+    for (size_t i = 0; i < kernel_name.size(); i++) {
+        if (!isalnum(kernel_name[i])) {
+            kernel_name[i] = '_';
+        }
+    }
+
+    // Compute a closure over the state passed into the kernel, in
+    // the same order as the llvm host codegen.
+    HostClosure c(loop->body, loop->name);
+    vector<DeviceArgument> closure_args = c.arguments();
+    std::sort(closure_args.begin(), closure_args.end(),
+              [](const DeviceArgument &a, const DeviceArgument &b) {
+                  if (a.is_buffer == b.is_buffer) {
+                      return a.type.bits() > b.type.bits();
+                  } else {
+                      return a.is_buffer < b.is_buffer;
+                  }
+              });
+
+    CodeGen_GPU_Dev *gpu_codegen = cgdev[loop->device_api];
+    gpu_codegen->add_kernel(loop, kernel_name, closure_args);
+    kernel_name = gpu_codegen->get_current_kernel_name();
+    string api_name = gpu_codegen->api_unique_name();
+
+    string launch_sizes;
+    for (int i = 0; i < 3; i++) {
+        launch_sizes += print_expr(bounds.num_blocks[i]) + ", ";
+    }
+    for (int i = 0; i < 3; i++) {
+        launch_sizes += print_expr(bounds.num_threads[i]) + ", ";
+    }
+    launch_sizes += print_expr(bounds.shared_mem_size);
+
+    open_scope();
+    // nullptr-terminated lists of the arguments, their sizes or
+    // types, and whether they are buffers.
+    string args_name = print_name(kernel_name + "_args");
+    string arg_sizes_name = print_name(kernel_name + "_arg_sizes");
+    string arg_is_buffer_name = print_name(kernel_name + "_arg_is_buffer");
+    bool runtime_run_takes_types = gpu_codegen->kernel_run_takes_types();
+    ostringstream args, arg_sizes, arg_is_buffer;
+    for (const DeviceArgument &arg : closure_args) {
+        if (arg.is_buffer) {
+            args << "(void *)" << print_name(arg.name + ".buffer") << ", ";
+        } else {
+            args << "(void *)&" << print_name(arg.name) << ", ";
+        }
+        if (runtime_run_takes_types) {
+            arg_sizes << "halide_type_t((halide_type_code_t)" << (int)arg.type.code() << ", "
+                      << arg.type.bits() << ", 1), ";
+        } else {
+            arg_sizes << (arg.is_buffer ? 8 : arg.type.bytes()) << ", ";
+        }
+        arg_is_buffer << (arg.is_buffer ? (arg.write ? 2 : 1) : 0) << ", ";
+    }
+    do_indent();
+    stream << "void *" << args_name << "[] = {" << args.str() << "nullptr};\n";
+    do_indent();
+    if (runtime_run_takes_types) {
+        stream << "struct halide_type_t " << arg_sizes_name << "[] = {"
+               << arg_sizes.str() << "halide_type_t((halide_type_code_t)0, 0, 0)};\n";
+    } else {
+        stream << "size_t " << arg_sizes_name << "[] = {" << arg_sizes.str() << "0};\n";
+    }
+    do_indent();
+    stream << "int8_t " << arg_is_buffer_name << "[] = {" << arg_is_buffer.str() << "0};\n";
+
+    string result = print_assignment(Int(32), "halide_" + api_name + "_run(_ucon, " +
+                                     gpu_module_state_name(api_name) + ", \"" + kernel_name + "\", " +
+                                     launch_sizes + ", " + arg_sizes_name + ", " + args_name + ", " +
+                                     arg_is_buffer_name + ", 0, nullptr, 0, 0)");
+    // The device runtime has already called halide_error.
+    do_indent();
+    stream << "if (" << result << ")\n";
+    open_scope();
+    do_indent();
+    stream << "return " << result << ";\n";
+    close_scope("");
+    close_scope("launch " + kernel_name);
+}
+
 void CodeGen_C::visit(const Ramp *op) {
     Type vector_type = op->type.with_lanes(op->lanes);
     string id_base = print_expr(op->base);
@@ -2467,7 +2875,7 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.type = op->type;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name);
-        stream << op_type << "*" << op_name << " = (" << print_expr(op->new_expr) << ");\n";
+        stream << op_type << "*" << op_name << " = (" << op_type << "*)(" << print_expr(op->new_expr) << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
@@ -2528,8 +2936,10 @@ void CodeGen_C::visit(const Allocate *op) {
             size_id = print_assignment(Int(64), print_expr(conditional_size));
         }
 
+        // Both stack arrays and halide_malloc are aligned to 32 bytes.
         Allocation alloc;
         alloc.type = op->type;
+        alloc.alignment = 32;
         allocations.push(op->name, alloc);
 
         do_indent();
@@ -2537,7 +2947,7 @@ void CodeGen_C::visit(const Allocate *op) {
 
         if (on_stack) {
             stream << op_name
-                   << "[" << size_id << "];\n";
+                   << "[" << size_id << "] HALIDE_ATTRIBUTE_ALIGN(32);\n";
         } else {
             stream << "*"
                    << op_name
@@ -2711,7 +3121,7 @@ int test1(struct halide_buffer_t *_buf_buffer, float _alpha, int32_t _beta, void
   }
   HalideFreeHelper _tmp_heap_free(_ucon, _tmp_heap, halide_free);
   {
-   int32_t _tmp_stack[127];
+   int32_t _tmp_stack[127] HALIDE_ATTRIBUTE_ALIGN(32);
    int32_t _4 = _beta + 1;
    int32_t _5;
    bool _6 = _4 < 1;
@@ -16,6 +16,8 @@ struct Argument;
 
 namespace Internal {
 
+struct CodeGen_GPU_Dev;
+
 /** This class emits C++ code equivalent to a halide Stmt. It's
  * mostly the same as an IRPrinter, but it's wrapped in a function
  * definition, and some things are handled differently to be valid
@@ -132,11 +134,19 @@ protected:
 
     struct Allocation {
         Type type;
+        // The known alignment of the start of the allocation in
+        // bytes, or zero if unknown.
+        int alignment = 0;
     };
 
     /** Track the types of allocations to avoid unnecessary casts. */
     Scope<Allocation> allocations;
 
+    /** Check if a dense vector access of type t starting at the
+     * given index into the named buffer can be aligned. */
+    bool is_aligned_vector_access(const std::string &name, const Parameter &param,
+                                  Type t, const Expr &base);
+
     /** Track which allocations actually went on the heap. */
     Scope<> heap_allocations;
 
@@ -149,6 +159,28 @@ protected:
     /** True if at least one gpu-based for loop is used. */
     bool uses_gpu_for_loops;
 
+    /** When emitting the host code of a pipeline with GPU stages,
+     * the device code generators that compile its kernels, one per
+     * GPU API used. Empty if a GPU API used has no C host support,
+     * in which case the functions just fail at runtime. */
+    std::map<DeviceAPI, CodeGen_GPU_Dev *> cgdev;
+
+    /** The name of the function being compiled, and the subset of
+     * cgdev that it launches kernels on. */
+    std::string function_name;
+    std::set<DeviceAPI> function_device_apis;
+
+    /** Emit the call to the device runtime that runs the kernel for
+     * a loop over GPU blocks, compiling the kernel along the way. */
+    void emit_gpu_kernel_launch(const For *loop);
+
+    /** Names, by GPU API, of the global state of the kernels of the
+     * current function and of the function that initializes it. */
+    // @{
+    std::string gpu_module_state_name(const std::string &api_unique_name) const;
+    std::string gpu_initialize_kernels_name(const std::string &api_unique_name) const;
+    // @}
+
     /** Track which handle types have been forward-declared already. */
     std::set<const halide_handle_cplusplus_type *> forward_declared;
 
@@ -198,6 +230,7 @@ protected:
     void visit(const Free *);
     void visit(const Realize *);
     void visit(const IfThenElse *);
+    void visit(const Fork *);
     void visit(const Evaluate *);
     void visit(const Shuffle *);
     void visit(const Prefetch *);
@@ -1,5 +1,7 @@
 #include "CodeGen_GPU_Dev.h"
 #include "Bounds.h"
+#include "ExprUsesVar.h"
+#include "IROperator.h"
 #include "IRVisitor.h"
 
 namespace Halide {
@@ -95,5 +97,56 @@ bool CodeGen_GPU_Dev::is_buffer_constant(Stmt kernel,
     return v.result;
 }
 
+ExtractBounds::ExtractBounds() : shared_mem_size(0), found_shared(false) {
+    for (int i = 0; i < 4; i++) {
+        num_threads[i] = num_blocks[i] = 1;
+    }
+}
+
+void ExtractBounds::visit(const For *op) {
+    if (CodeGen_GPU_Dev::is_gpu_var(op->name)) {
+        internal_assert(is_zero(op->min));
+    }
+
+    if (ends_with(op->name, ".__thread_id_x")) {
+        num_threads[0] = op->extent;
+    } else if (ends_with(op->name, ".__thread_id_y")) {
+        num_threads[1] = op->extent;
+    } else if (ends_with(op->name, ".__thread_id_z")) {
+        num_threads[2] = op->extent;
+    } else if (ends_with(op->name, ".__thread_id_w")) {
+        num_threads[3] = op->extent;
+    } else if (ends_with(op->name, ".__block_id_x")) {
+        num_blocks[0] = op->extent;
+    } else if (ends_with(op->name, ".__block_id_y")) {
+        num_blocks[1] = op->extent;
+    } else if (ends_with(op->name, ".__block_id_z")) {
+        num_blocks[2] = op->extent;
+    } else if (ends_with(op->name, ".__block_id_w")) {
+        num_blocks[3] = op->extent;
+    }
+
+    op->body.accept(this);
+}
+
+void ExtractBounds::visit(const LetStmt *op) {
+    if (expr_uses_var(shared_mem_size, op->name)) {
+        shared_mem_size = Let::make(op->name, op->value, shared_mem_size);
+    }
+    op->body.accept(this);
+}
+
+void ExtractBounds::visit(const Allocate *allocate) {
+    user_assert(!allocate->new_expr.defined()) << "Allocate node inside GPU kernel has custom new expression.\n" <<
+        "(Memoization is not supported inside GPU kernels at present.)\n";
+
+    if (allocate->name == "__shared") {
+        internal_assert(allocate->type == UInt(8) && allocate->extents.size() == 1);
+        shared_mem_size = allocate->extents[0];
+        found_shared = true;
+    }
+    allocate->body.accept(this);
+}
+
 }  // namespace Internal
 }  // namespace Halide
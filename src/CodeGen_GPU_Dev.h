@@ -7,6 +7,7 @@
 
 #include "DeviceArgument.h"
 #include "IR.h"
+#include "IRVisitor.h"
 
 namespace Halide {
 namespace Internal {
@@ -65,6 +66,30 @@ struct CodeGen_GPU_Dev {
     static bool is_buffer_constant(Stmt kernel, const std::string &buffer);
 };
 
+/** Sniff the contents of a kernel to extract the bounds of all the
+ * thread indices (so we know how many threads to launch), and the
+ * amount of shared memory to allocate. Used by the host code
+ * generators that launch kernels. */
+class ExtractBounds : public IRVisitor {
+public:
+
+    Expr num_threads[4];
+    Expr num_blocks[4];
+    Expr shared_mem_size;
+
+    ExtractBounds();
+
+private:
+
+    bool found_shared;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op);
+    void visit(const LetStmt *op);
+    void visit(const Allocate *allocate);
+};
+
 }  // namespace Internal
 }  // namespace Halide
 
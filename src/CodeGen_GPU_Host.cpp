@@ -8,6 +8,7 @@
 #include "CodeGen_OpenGL_Dev.h"
 #include "CodeGen_PTX_Dev.h"
 #include "CodeGen_D3D12Compute_Dev.h"
+#include "CodeGen_Vulkan_Dev.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
 #include "IROperator.h"
@@ -27,74 +28,6 @@ using std::vector;
 
 using namespace llvm;
 
-// Sniff the contents of a kernel to extracts the bounds of all the
-// thread indices (so we know how many threads to launch), and the
-// amount of shared memory to allocate.
-class ExtractBounds : public IRVisitor {
-public:
-
-    Expr num_threads[4];
-    Expr num_blocks[4];
-    Expr shared_mem_size;
-
-    ExtractBounds() : shared_mem_size(0), found_shared(false) {
-        for (int i = 0; i < 4; i++) {
-            num_threads[i] = num_blocks[i] = 1;
-        }
-    }
-
-private:
-
-    bool found_shared;
-
-    using IRVisitor::visit;
-
-    void visit(const For *op) {
-        if (CodeGen_GPU_Dev::is_gpu_var(op->name)) {
-            internal_assert(is_zero(op->min));
-        }
-
-        if (ends_with(op->name, ".__thread_id_x")) {
-            num_threads[0] = op->extent;
-        } else if (ends_with(op->name, ".__thread_id_y")) {
-            num_threads[1] = op->extent;
-        } else if (ends_with(op->name, ".__thread_id_z")) {
-            num_threads[2] = op->extent;
-        } else if (ends_with(op->name, ".__thread_id_w")) {
-            num_threads[3] = op->extent;
-        } else if (ends_with(op->name, ".__block_id_x")) {
-            num_blocks[0] = op->extent;
-        } else if (ends_with(op->name, ".__block_id_y")) {
-            num_blocks[1] = op->extent;
-        } else if (ends_with(op->name, ".__block_id_z")) {
-            num_blocks[2] = op->extent;
-        } else if (ends_with(op->name, ".__block_id_w")) {
-            num_blocks[3] = op->extent;
-        }
-
-        op->body.accept(this);
-    }
-
-    void visit(const LetStmt *op) {
-        if (expr_uses_var(shared_mem_size, op->name)) {
-            shared_mem_size = Let::make(op->name, op->value, shared_mem_size);
-        }
-        op->body.accept(this);
-    }
-
-    void visit(const Allocate *allocate) {
-        user_assert(!allocate->new_expr.defined()) << "Allocate node inside GPU kernel has custom new expression.\n" <<
-            "(Memoization is not supported inside GPU kernels at present.)\n";
-
-        if (allocate->name == "__shared") {
-            internal_assert(allocate->type == UInt(8) && allocate->extents.size() == 1);
-            shared_mem_size = allocate->extents[0];
-            found_shared = true;
-        }
-        allocate->body.accept(this);
-    }
-};
-
 template<typename CodeGen_CPU>
 CodeGen_GPU_Host<CodeGen_CPU>::CodeGen_GPU_Host(Target target) : CodeGen_CPU(target) {
     // For the default GPU, the order of preferences is: Metal,
@@ -125,6 +58,10 @@ CodeGen_GPU_Host<CodeGen_CPU>::CodeGen_GPU_Host(Target target) : CodeGen_CPU(tar
         debug(1) << "Constructing Direct3D 12 Compute device codegen\n";
         cgdev[DeviceAPI::D3D12Compute] = new CodeGen_D3D12Compute_Dev(target);
     }
+    if (target.has_feature(Target::Vulkan)) {
+        debug(1) << "Constructing Vulkan device codegen\n";
+        cgdev[DeviceAPI::Vulkan] = new CodeGen_Vulkan_Dev(target);
+    }
 
     if (cgdev.empty()) {
         internal_error << "Requested unknown GPU target: " << target.to_string() << "\n";
@@ -441,7 +378,11 @@ void CodeGen_GPU_Host<CodeGen_CPU>::visit(const For *loop) {
                                     i));
             }
 
-            builder->CreateStore(ConstantInt::get(i8_t, closure_args[i].is_buffer),
+            // Buffers the kernel writes to are flagged with 2, so
+            // runtimes can track which kernels a copy back to the
+            // host depends on.
+            int is_buffer = closure_args[i].is_buffer ? (closure_args[i].write ? 2 : 1) : 0;
+            builder->CreateStore(ConstantInt::get(i8_t, is_buffer),
                                  builder->CreateConstGEP2_32(
                                     gpu_arg_is_buffer_arr_type,
                                     gpu_arg_is_buffer_arr,
@@ -8,6 +8,7 @@
 #include "CodeGen_Internal.h"
 #include "Debug.h"
 #include "EliminateBoolVectors.h"
+#include "FixedPointMath.h"
 #include "HexagonOptimize.h"
 #include "IREquality.h"
 #include "IRMatch.h"
@@ -208,10 +209,29 @@ private:
             Stmt body = mutate(op->body);
             Stmt s;
             if (uses_hvx) {
-                body = acquire_hvx_context(body, target);
+                // There are fewer HVX contexts than hardware threads,
+                // so running a task per thread would leave some of
+                // them blocked in halide_qurt_hvx_lock, and the lock
+                // would be taken and released once per iteration. So
+                // instead we run one task per HVX context, each of
+                // which locks once and runs a contiguous slice of the
+                // loop. The remaining threads are left free for
+                // parallel work that doesn't use HVX.
                 body = substitute("uses_hvx", true, body);
-                Stmt new_for = For::make(op->name, op->min, op->extent,
-                                         op->for_type, op->device_api, body);
+                string task_name = op->name + ".hvx_task";
+                string num_tasks_name = op->name + ".hvx_tasks";
+                Expr task = Variable::make(Int(32), task_name);
+                Expr num_tasks = Variable::make(Int(32), num_tasks_name);
+                Expr hvx_mode = target.has_feature(Target::HVX_128) ? 128 : 64;
+                Expr units = Call::make(Int(32), "halide_qurt_hvx_get_units", {hvx_mode}, Call::Extern);
+                Expr slice_min = op->min + (op->extent * task) / num_tasks;
+                Expr slice_max = op->min + (op->extent * (task + 1)) / num_tasks;
+                Stmt slice = For::make(op->name, slice_min, slice_max - slice_min,
+                                       ForType::Serial, op->device_api, body);
+                slice = acquire_hvx_context(slice, target);
+                Stmt new_for = For::make(task_name, 0, num_tasks,
+                                         op->for_type, op->device_api, slice);
+                new_for = LetStmt::make(num_tasks_name, max(min(op->extent, units), 1), new_for);
                 Stmt prolog = IfThenElse::make(uses_hvx_var,
                                                call_halide_qurt_hvx_unlock());
                 Stmt epilog = IfThenElse::make(uses_hvx_var,
@@ -294,6 +314,37 @@ Stmt inject_hvx_lock_unlock(Stmt body, const Target &target) {
     return body;
 }
 
+// Check if a buffer is the source or destination of a vgather, or
+// the destination of a user DMA copy.
+class NeedsVTCM : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        vector<int> args;
+        if (op->is_intrinsic("gather")) {
+            args = {0, 2};
+        } else if (op->name == "halide_hexagon_user_dma_copy_2d") {
+            args = {0};
+        }
+        for (int i : args) {
+            const Variable *v = op->args[i].as<Variable>();
+            result = result || (v && v->name == buffer);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    const string &buffer;
+    bool result = false;
+    NeedsVTCM(const string &buffer) : buffer(buffer) {}
+};
+
+bool needs_vtcm(const Stmt &s, const string &buffer) {
+    NeedsVTCM v(buffer);
+    s.accept(&v);
+    return v.result;
+}
+
 }// namespace
 
 void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
@@ -309,6 +360,12 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     body = unpredicate_loads_stores(body);
     debug(2) << "Lowering after unpredicating loads/stores:\n" << body << "\n\n";
 
+    if (is_hvx_v65_or_later()) {
+        debug(1) << "Generating vgathers...\n";
+        body = vgather_generator(body, native_vector_bits() / 8);
+        debug(2) << "Lowering after generating vgathers:\n" << body << "\n\n";
+    }
+
     debug(1) << "Optimizing shuffles...\n";
     // vlut always indexes 64 bytes of the LUT at a time, even in 128 byte mode.
     const int lut_alignment = 64;
@@ -337,6 +394,11 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     body = simplify(body);
     debug(2) << "Lowering after forwarding stores:\n" << body << "\n\n";
 
+    // Expand the fixed-point intrinsics so the Hexagon instruction
+    // selection below can see their saturating patterns.
+    debug(1) << "Lowering fixed-point intrinsics...\n";
+    body = lower_fixed_point_intrinsics(body);
+
     // We can't deal with bool vectors, convert them to integer vectors.
     debug(1) << "Eliminating boolean vectors from Hexagon code...\n";
     body = eliminate_bool_vectors(body);
@@ -1789,6 +1851,32 @@ void CodeGen_Hexagon::visit(const Call *op) {
             << "see https://github.com/halide/Halide/issues/1582\n" << Expr(op) << "\n";
     }
 
+    if (op->is_intrinsic("gather")) {
+        internal_assert(op->args.size() == 5);
+        const Variable *dst = op->args[0].as<Variable>();
+        internal_assert(dst);
+        Type t = op->type;
+#if LLVM_VERSION >= 70
+        bool is_128B = target.has_feature(Halide::Target::HVX_128);
+        Intrinsic::ID id =
+            t.bits() == 16 ? IPICK(is_128B, Intrinsic::hexagon_V6_vgathermhw) : IPICK(is_128B, Intrinsic::hexagon_V6_vgathermw);
+        llvm::Function *fn = Intrinsic::getDeclaration(module.get(), id);
+        Value *src = builder->CreatePtrToInt(codegen(op->args[2]), i32_t);
+        Value *region = codegen(op->args[3]);
+        Value *offsets = codegen(op->args[4]);
+        // Gather a native vector at a time.
+        int lanes = native_vector_bits() / t.bits();
+        for (int i = 0; i < t.lanes(); i += lanes) {
+            Value *dst_ptr = codegen_buffer_pointer(dst->name, t.element_of(), simplify(op->args[1] + i));
+            call_intrin_cast(void_t, fn, {dst_ptr, src, region, slice_vector(offsets, i, lanes)});
+        }
+        value = UndefValue::get(llvm_type_of(t));
+#else
+        user_error << "llvm 7.0 or later is required for vgather.\n";
+#endif
+        return;
+    }
+
     if (starts_with(op->name, "halide.hexagon.")) {
         // Handle all of the intrinsics we generated in
         // hexagon_optimize.  I'm not sure why this is different than
@@ -1870,22 +1958,24 @@ void CodeGen_Hexagon::visit(const Call *op) {
     }
 
     if (op->is_intrinsic(Call::prefetch)) {
-        internal_assert((op->args.size() == 4) || (op->args.size() == 6))
+        internal_assert((op->args.size() == 5) || (op->args.size() == 7))
             << "Hexagon only supports 1D or 2D prefetch\n";
 
+        // The l2fetch instruction has no locality hint, so the
+        // locality in args[2] is ignored.
         vector<llvm::Value *> args;
         args.push_back(codegen_buffer_pointer(codegen(op->args[0]), op->type, op->args[1]));
 
-        Expr extent_0_bytes = op->args[2] * op->args[3] * op->type.bytes();
+        Expr extent_0_bytes = op->args[3] * op->args[4] * op->type.bytes();
         args.push_back(codegen(extent_0_bytes));
 
         llvm::Function *prefetch_fn = nullptr;
-        if (op->args.size() == 4) { // 1D prefetch: {base, offset, extent0, stride0}
+        if (op->args.size() == 5) { // 1D prefetch: {base, offset, locality, extent0, stride0}
             prefetch_fn = module->getFunction("_halide_prefetch");
-        } else { // 2D prefetch: {base, offset, extent0, stride0, extent1, stride1}
+        } else { // 2D prefetch: {base, offset, locality, extent0, stride0, extent1, stride1}
             prefetch_fn = module->getFunction("_halide_prefetch_2d");
-            args.push_back(codegen(op->args[4]));
-            Expr stride_1_bytes = op->args[5] * op->type.bytes();
+            args.push_back(codegen(op->args[5]));
+            Expr stride_1_bytes = op->args[6] * op->type.bytes();
             args.push_back(codegen(stride_1_bytes));
         }
         internal_assert(prefetch_fn);
@@ -1966,6 +2056,35 @@ void CodeGen_Hexagon::visit(const Select *op) {
     }
 }
 
+void CodeGen_Hexagon::visit(const Allocate *alloc) {
+    if (alloc->memory_type == MemoryType::VTCM && !alloc->new_expr.defined() &&
+        is_hvx_v65_or_later()) {
+        // VTCM comes from its own allocator, rather than
+        // halide_malloc. vgathers fault on anything else, and user
+        // DMA copies don't go through the data cache, but other
+        // buffers can go on the heap when VTCM runs out.
+        bool must_be_vtcm = needs_vtcm(alloc->body, alloc->name);
+        string malloc_fn = must_be_vtcm ? "halide_vtcm_malloc" : "halide_vtcm_malloc_or_heap";
+        string free_fn = must_be_vtcm ? "halide_vtcm_free" : "halide_vtcm_free_or_heap";
+
+        Expr size = alloc->type.bytes();
+        for (const Expr &e : alloc->extents) {
+            size *= e;
+        }
+        size += allocation_padding(alloc->type);
+        if (!is_one(alloc->condition)) {
+            size = select(alloc->condition, size, 0);
+        }
+        Expr new_expr = Call::make(Handle(), malloc_fn, {size}, Call::Extern);
+        Stmt new_alloc = Allocate::make(alloc->name, alloc->type, alloc->memory_type,
+                                        alloc->extents, alloc->condition, alloc->body,
+                                        new_expr, free_fn);
+        new_alloc.accept(this);
+    } else {
+        CodeGen_Posix::visit(alloc);
+    }
+}
+
 void CodeGen_Hexagon::visit(const GT *op) {
     if (op->type.is_vector()) {
         value = call_intrin(eliminated_bool_type(op->type, op->a.type()),
@@ -1,5 +1,6 @@
 #include "CodeGen_Internal.h"
 #include "CSE.h"
+#include "CodeGen_LLVM.h"
 #include "Debug.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -112,7 +113,10 @@ void unpack_closure(const Closure& closure,
 
 llvm::Type *llvm_type_of(LLVMContext *c, Halide::Type t) {
     if (t.lanes() == 1) {
-        if (t.is_float()) {
+        if (t.is_bfloat()) {
+            // bfloat16 values only exist as their bits.
+            return llvm::Type::getIntNTy(*c, t.bits());
+        } else if (t.is_float()) {
             switch (t.bits()) {
             case 16:
                 return llvm::Type::getHalfTy(*c);
@@ -158,6 +162,12 @@ bool function_takes_user_context(const std::string &name) {
         "halide_free",
         "halide_malloc",
         "halide_print",
+        "halide_scratch_pool_create",
+        "halide_scratch_pool_destroy",
+        "halide_scratch_pool_acquire",
+        "halide_scratch_pool_release",
+        "halide_set_thread_gpu_device",
+        "halide_set_thread_gpu_device_as_destructor",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
         "halide_profiler_pipeline_start",
@@ -170,13 +180,18 @@ bool function_takes_user_context(const std::string &name) {
         "halide_trace_helper",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
+        "halide_memoization_cache_store_with_budget",
         "halide_memoization_cache_release",
+        "halide_memoization_cache_release_device",
+        "halide_shape_cache_lookup",
+        "halide_shape_cache_store",
         "halide_cuda_run",
         "halide_opencl_run",
         "halide_opengl_run",
         "halide_openglcompute_run",
         "halide_metal_run",
         "halide_d3d12compute_run",
+        "halide_vulkan_run",
         "halide_msan_annotate_buffer_is_initialized_as_destructor",
         "halide_msan_annotate_buffer_is_initialized",
         "halide_msan_annotate_memory_is_initialized",
@@ -188,15 +203,22 @@ bool function_takes_user_context(const std::string &name) {
         "halide_hexagon_power_hvx_on_perf",
         "halide_hexagon_power_hvx_off",
         "halide_hexagon_power_hvx_off_as_destructor",
+        "halide_qurt_hvx_get_units",
         "halide_qurt_hvx_lock",
         "halide_qurt_hvx_unlock",
         "halide_qurt_hvx_unlock_as_destructor",
+        "halide_vtcm_malloc",
+        "halide_vtcm_free",
+        "halide_vtcm_malloc_or_heap",
+        "halide_vtcm_free_or_heap",
+        "halide_hexagon_user_dma_copy_2d",
         "halide_cuda_initialize_kernels",
         "halide_opencl_initialize_kernels",
         "halide_opengl_initialize_kernels",
         "halide_openglcompute_initialize_kernels",
         "halide_metal_initialize_kernels",
         "halide_d3d12compute_initialize_kernels",
+        "halide_vulkan_initialize_kernels",
         "halide_get_gpu_device",
         "halide_upgrade_buffer_t",
         "halide_downgrade_buffer_t",
@@ -359,6 +381,45 @@ Stmt unpredicate_loads_stores(Stmt s) {
     return UnpredicateLoadsStores().mutate(s);
 }
 
+namespace {
+
+void collect_sum_terms(Expr e, vector<Expr> &terms) {
+    if (const Add *add = e.as<Add>()) {
+        collect_sum_terms(add->a, terms);
+        collect_sum_terms(add->b, terms);
+    } else {
+        terms.push_back(e);
+    }
+}
+
+}  // namespace
+
+void find_widening_products(Expr sum, Type a, Type b,
+                            vector<Expr> &as, vector<Expr> &bs,
+                            vector<Expr> &products, vector<Expr> &rest) {
+    vector<Expr> terms;
+    collect_sum_terms(sum, terms);
+    for (Expr t : terms) {
+        const Mul *mul = t.as<Mul>();
+        Expr na, nb;
+        if (mul) {
+            na = lossless_cast(a, mul->a);
+            nb = lossless_cast(b, mul->b);
+            if (!na.defined() || !nb.defined()) {
+                na = lossless_cast(a, mul->b);
+                nb = lossless_cast(b, mul->a);
+            }
+        }
+        if (na.defined() && nb.defined()) {
+            as.push_back(na);
+            bs.push_back(nb);
+            products.push_back(t);
+        } else {
+            rest.push_back(t);
+        }
+    }
+}
+
 bool get_md_bool(llvm::Metadata *value, bool &result) {
     if (!value) {
         return false;
@@ -441,7 +502,7 @@ void clone_target_options(const llvm::Module &from, llvm::Module &to) {
 std::unique_ptr<llvm::TargetMachine> make_target_machine(const llvm::Module &module) {
     std::string error_string;
 
-    const llvm::Target *llvm_target = llvm::TargetRegistry::lookupTarget(module.getTargetTriple(), error_string);
+    const llvm::Target *llvm_target = CodeGen_LLVM::lookup_llvm_target(module.getTargetTriple(), error_string);
     if (!llvm_target) {
         std::cout << error_string << std::endl;
 #if LLVM_VERSION < 60
@@ -474,6 +535,13 @@ void set_function_attributes_for_target(llvm::Function *fn, Target t) {
     // Turn off approximate reciprocals for division. It's too
     // inaccurate even for us.
     fn->addFnAttr("reciprocal-estimates", "none");
+
+    if (t.arch == Target::X86 && t.has_feature(Target::AVX512_256)) {
+        // Make LLVM split any 512-bit vectors into 256-bit halves
+        // rather than use zmm registers.
+        fn->addFnAttr("prefer-vector-width", "256");
+        fn->addFnAttr("min-legal-vector-width", "0");
+    }
 }
 
 }  // namespace Internal
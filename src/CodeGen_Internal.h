@@ -79,6 +79,15 @@ Expr lower_euclidean_mod(Expr a, Expr b);
  * inside branches. */
 Stmt unpredicate_loads_stores(Stmt s);
 
+/** Split a sum into its terms, for matching dot product
+ * instructions. Each term that is a product of values that can be
+ * losslessly narrowed to types a and b (in either order) goes in
+ * products, with the narrowed operands in as and bs. The remaining
+ * terms go in rest. */
+void find_widening_products(Expr sum, Type a, Type b,
+                            std::vector<Expr> &as, std::vector<Expr> &bs,
+                            std::vector<Expr> &products, std::vector<Expr> &rest);
+
 /** Given an llvm::Module, set llvm:TargetOptions, cpu and attr information */
 void get_target_options(const llvm::Module &module, llvm::TargetOptions &options, std::string &mcpu, std::string &mattrs);
 
@@ -1,9 +1,13 @@
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <mutex>
 #include <sstream>
+#include <tuple>
 
+#include "BatchWrapper.h"
 #include "CPlusPlusMangle.h"
+#include "CPUVariants.h"
 #include "CSE.h"
 #include "CodeGen_ARM.h"
 #include "CodeGen_GPU_Host.h"
@@ -13,8 +17,11 @@
 #include "CodeGen_MIPS.h"
 #include "CodeGen_PowerPC.h"
 #include "CodeGen_X86.h"
+#include "CompileTrace.h"
 #include "Debug.h"
 #include "Deinterleave.h"
+#include "FixedPointMath.h"
+#include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "IntegerDivisionTable.h"
@@ -36,8 +43,9 @@
 
 namespace Halide {
 
-std::unique_ptr<llvm::Module> codegen_llvm(const Module &module, llvm::LLVMContext &context) {
+std::unique_ptr<llvm::Module> codegen_llvm(const Module &module, llvm::LLVMContext &context, bool optimize) {
     std::unique_ptr<Internal::CodeGen_LLVM> cg(Internal::CodeGen_LLVM::new_for_target(module.target(), context));
+    cg->set_optimize(optimize);
     return cg->compile(module);
 }
 
@@ -70,10 +78,14 @@ using std::vector;
 #include <llvm/Config/AsmPrinters.def>
 #undef LLVM_ASM_PRINTER
 
-#define InitializeTarget(target)              \
-        LLVMInitialize##target##Target();     \
-        LLVMInitialize##target##TargetInfo(); \
-        LLVMInitialize##target##TargetMC();   \
+// Expects a bool named register_with_llvm to be in scope: if it is
+// false, the target is only recorded as enabled.
+#define InitializeTarget(target)                  \
+        if (register_with_llvm) {                 \
+            LLVMInitialize##target##Target();     \
+            LLVMInitialize##target##TargetInfo(); \
+            LLVMInitialize##target##TargetMC();   \
+        }                                         \
         llvm_##target##_enabled = true;
 
 #define InitializeAsmParser(target)           \
@@ -149,6 +161,28 @@ llvm::GlobalValue::LinkageTypes llvm_linkage(LinkageType t) {
     }
 }
 
+// Replace the load of the location stored to by an atomic update
+// with a placeholder for the value currently in memory.
+class ReplaceAtomicLoad : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const Store *store;
+    Expr replacement;
+
+    Expr visit(const Load *op) override {
+        if (op->name == store->name && equal(op->index, store->index)) {
+            found = true;
+            return replacement;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    bool found = false;
+    ReplaceAtomicLoad(const Store *store, Expr replacement)
+        : store(store), replacement(replacement) {}
+};
+
 }
 
 CodeGen_LLVM::CodeGen_LLVM(Target t) :
@@ -259,7 +293,10 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
     min_f64(Float(64).min()),
     max_f64(Float(64).max()),
     destructor_block(nullptr),
-    strict_float(t.has_feature(Target::StrictFloat)) {
+    strict_float(t.has_feature(Target::StrictFloat)),
+    optimize(true),
+    emit_nontemporal_stores(false),
+    nontemporal_stores_emitted(0) {
     initialize_llvm();
 }
 
@@ -287,7 +324,8 @@ CodeGen_LLVM *CodeGen_LLVM::new_for_target(const Target &target,
                                 Target::OpenGL,
                                 Target::OpenGLCompute,
                                 Target::Metal,
-                                Target::D3D12Compute})) {
+                                Target::D3D12Compute,
+                                Target::Vulkan})) {
 #ifdef WITH_X86
         if (target.arch == Target::X86) {
             return make_codegen<CodeGen_GPU_Host<CodeGen_X86>>(target, context);
@@ -351,10 +389,32 @@ void CodeGen_LLVM::initialize_llvm() {
             cl::ParseCommandLineOptions((int)(c_arg_vec.size()), &c_arg_vec[0], "Halide compiler\n");
         }
 
+        // Registering every enabled target with llvm takes a
+        // noticeable part of the startup time of a process that jits,
+        // and most processes only ever generate code for the host. So
+        // only the native target is registered here; the others are
+        // just recorded as enabled, and are registered the first time
+        // lookup_llvm_target can't find a target.
         InitializeNativeTarget();
         InitializeNativeTargetAsmPrinter();
         InitializeNativeTargetAsmParser();
 
+        const bool register_with_llvm = false;
+        #define LLVM_TARGET(target)         \
+            Initialize##target##Target();
+        #include <llvm/Config/Targets.def>
+        #undef LLVM_TARGET
+
+        llvm_initialized = true;
+    }
+}
+
+void CodeGen_LLVM::initialize_all_llvm_targets() {
+    initialize_llvm();
+
+    static std::once_flag registered;
+    std::call_once(registered, []() {
+        const bool register_with_llvm = true;
         #define LLVM_TARGET(target)         \
             Initialize##target##Target();
         #include <llvm/Config/Targets.def>
@@ -369,9 +429,18 @@ void CodeGen_LLVM::initialize_llvm() {
             Initialize##target##AsmPrinter();
         #include <llvm/Config/AsmPrinters.def>
         #undef LLVM_ASM_PRINTER
+    });
+}
 
-        llvm_initialized = true;
+const llvm::Target *CodeGen_LLVM::lookup_llvm_target(const std::string &triple, std::string &error_string) {
+    initialize_llvm();
+    const llvm::Target *t = llvm::TargetRegistry::lookupTarget(triple, error_string);
+    if (!t) {
+        initialize_all_llvm_targets();
+        error_string.clear();
+        t = llvm::TargetRegistry::lookupTarget(triple, error_string);
     }
+    return t;
 }
 
 void CodeGen_LLVM::init_context() {
@@ -432,8 +501,15 @@ void CodeGen_LLVM::init_context() {
 void CodeGen_LLVM::init_module() {
     init_context();
 
-    // Start with a module containing the initial module for this target.
-    module = get_initial_module_for_target(target, context);
+    // Start with a module containing the initial module for this
+    // target, plus the helpers used by any CPU variants in the input.
+    Target initial_module_target = target;
+    if (input_module) {
+        for (const auto &f : input_module->functions()) {
+            initial_module_target = with_cpu_variant_features(f.body, initial_module_target);
+        }
+    }
+    module = get_initial_module_for_target(initial_module_target, context);
 }
 
 void CodeGen_LLVM::add_external_code(const Module &halide_module) {
@@ -465,6 +541,7 @@ struct MangledNames {
     string extern_name;
     string argv_name;
     string metadata_name;
+    string batch_name;
 };
 
 MangledNames get_mangled_names(const std::string &name,
@@ -478,6 +555,7 @@ MangledNames get_mangled_names(const std::string &name,
     names.extern_name = names.simple_name;
     names.argv_name = names.simple_name + "_argv";
     names.metadata_name = names.simple_name + "_metadata";
+    names.batch_name = names.simple_name + "_batch";
 
     if (linkage != LinkageType::Internal &&
         ((mangling == NameMangling::Default &&
@@ -498,6 +576,11 @@ MangledNames get_mangled_names(const std::string &name,
         Type void_star_star(Handle(1, &inner_type));
         names.argv_name = cplusplus_function_mangled_name(names.argv_name, namespaces, type_of<int>(), { ExternFuncArgument(make_zero(void_star_star)) }, target);
         names.metadata_name = cplusplus_function_mangled_name(names.metadata_name, namespaces, type_of<const struct halide_filter_metadata_t *>(), {}, target);
+        halide_handle_cplusplus_type batch_inner_type(halide_cplusplus_type_name(halide_cplusplus_type_name::Simple, "void"), {}, {},
+                                                      { halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer, halide_handle_cplusplus_type::Pointer } );
+        Type void_star_star_star(Handle(1, &batch_inner_type));
+        names.batch_name = cplusplus_function_mangled_name(names.batch_name, namespaces, type_of<int>(),
+                                                           { ExternFuncArgument(make_zero(Int(32))), ExternFuncArgument(make_zero(void_star_star_star)) }, target);
     }
     return names;
 }
@@ -509,6 +592,7 @@ MangledNames get_mangled_names(const LoweredFunc &f, const Target &target) {
 }  // namespace
 
 std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
+    CompileTraceEvent trace_event("Generating LLVM IR for " + input.name(), "codegen");
     input_module = &input;
 
     init_module();
@@ -555,33 +639,54 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     for (const auto &b : input.buffers()) {
         compile_buffer(b);
     }
+    std::map<std::string, llvm::Function *> compiled;
+    std::vector<std::tuple<std::string, MangledNames, llvm::Function *, llvm::Function *>> batched;
     for (const auto &f : input.functions()) {
         const auto names = get_mangled_names(f, get_target());
 
         compile_func(f, names.simple_name, names.extern_name);
+        compiled[f.name] = function;
 
         // If the Func is externally visible, also create the argv wrapper and metadata.
         // (useful for calling from JIT and other machine interfaces).
         if (f.linkage == LinkageType::ExternalPlusMetadata) {
-            llvm::Function *wrapper = add_argv_wrapper(names.argv_name);
+            llvm::Function *wrapper = add_argv_wrapper(function, names.argv_name);
             llvm::Function *metadata_getter = embed_metadata_getter(names.metadata_name,
                 names.simple_name, f.args, input.get_metadata_name_map());
 
             if (target.has_feature(Target::Matlab)) {
                 define_matlab_wrapper(module.get(), wrapper, metadata_getter);
             }
+            if (target.has_feature(Target::Batch) && !target.has_feature(Target::JIT)) {
+                batched.emplace_back(f.name, names, wrapper, metadata_getter);
+            }
         }
     }
 
+    // The batched entry points also need the unchecked copy of each
+    // pipeline, which may come after it in the module.
+    for (const auto &b : batched) {
+        const MangledNames &names = std::get<1>(b);
+        llvm::Function *unchecked = compiled[std::get<0>(b) + "_unchecked"];
+        internal_assert(unchecked) << "Did not find the unchecked copy of " << std::get<0>(b) << "\n";
+        llvm::Function *unchecked_wrapper = add_argv_wrapper(unchecked, names.simple_name + "_unchecked_argv");
+        unchecked_wrapper->setLinkage(llvm::GlobalValue::InternalLinkage);
+        define_batch_wrapper(module.get(), std::get<2>(b), unchecked_wrapper, std::get<3>(b), names.batch_name);
+    }
+
     debug(2) << module.get() << "\n";
 
     // Verify the module is ok
     internal_assert(!verifyModule(*module, &llvm::errs()));
     debug(2) << "Done generating llvm bitcode\n";
 
+    check_compiler_memory_limit("generating llvm ir for " + input.name());
+
     // Optimize
     CodeGen_LLVM::optimize_module();
 
+    check_compiler_memory_limit("optimizing llvm ir for " + input.name());
+
     input_module = nullptr;
 
     // Disown the module and return it.
@@ -904,7 +1009,7 @@ Constant* CodeGen_LLVM::embed_constant_expr(Expr e) {
 // Make a wrapper to call the function with an array of pointer
 // args. This is easier for the JIT to call than a function with an
 // unknown (at compile time) argument list.
-llvm::Function *CodeGen_LLVM::add_argv_wrapper(const std::string &name) {
+llvm::Function *CodeGen_LLVM::add_argv_wrapper(llvm::Function *fn, const std::string &name) {
     llvm::Type *args_t[] = {i8_t->getPointerTo()->getPointerTo()};
     llvm::FunctionType *func_t = llvm::FunctionType::get(i32_t, args_t, false);
     llvm::Function *wrapper = llvm::Function::Create(func_t, llvm::GlobalValue::ExternalLinkage, name, module.get());
@@ -914,7 +1019,7 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(const std::string &name) {
     llvm::Value *arg_array = iterator_to_pointer(wrapper->arg_begin());
 
     std::vector<llvm::Value *> wrapper_args;
-    for (llvm::Function::arg_iterator i = function->arg_begin(); i != function->arg_end(); i++) {
+    for (llvm::Function::arg_iterator i = fn->arg_begin(); i != fn->arg_end(); i++) {
         // Get the address of the nth argument
         llvm::Value *ptr = builder->CreateConstGEP1_32(arg_array, wrapper_args.size());
         ptr = builder->CreateLoad(ptr);
@@ -928,7 +1033,7 @@ llvm::Function *CodeGen_LLVM::add_argv_wrapper(const std::string &name) {
         }
     }
     debug(4) << "Creating call from wrapper to actual function\n";
-    llvm::CallInst *result = builder->CreateCall(function, wrapper_args);
+    llvm::CallInst *result = builder->CreateCall(fn, wrapper_args);
     // This call should never inline
     result->setIsNoInline();
     builder->CreateRet(result);
@@ -1020,8 +1125,15 @@ llvm::Type *CodeGen_LLVM::llvm_type_of(Type t) {
 }
 
 void CodeGen_LLVM::optimize_module() {
+    CompileTraceEvent trace_event("Optimizing LLVM module", "llvm");
     debug(3) << "Optimizing module\n";
 
+    if (compile_trace_enabled()) {
+        // Also get LLVM's report of the time taken by each of its
+        // passes. It's printed to stderr on exit.
+        llvm::TimePassesIsEnabled = true;
+    }
+
     if (debug::debug_level() >= 3) {
         #if LLVM_VERSION >= 50
         module->print(dbgs(), nullptr, false, true);
@@ -1057,14 +1169,20 @@ void CodeGen_LLVM::optimize_module() {
     function_pass_manager.add(createTargetTransformInfoWrapperPass(TM ? TM->getTargetIRAnalysis() : TargetIRAnalysis()));
 
     PassManagerBuilder b;
-    b.OptLevel = 3;
+    if (optimize) {
+        b.OptLevel = 3;
 #if LLVM_VERSION >= 50
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
 #else
-    b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
+        b.Inliner = createFunctionInliningPass(b.OptLevel, 0);
 #endif
-    b.LoopVectorize = true;
-    b.SLPVectorize = true;
+        b.LoopVectorize = true;
+        b.SLPVectorize = true;
+    } else {
+        // The runtime's always_inline helpers must still be inlined.
+        b.OptLevel = 0;
+        b.Inliner = createAlwaysInlinerLegacyPass();
+    }
 
 #if LLVM_VERSION >= 50
     if (TM) {
@@ -1776,6 +1894,25 @@ void CodeGen_LLVM::visit(const Load *op) {
             }
 
             value = shuffle_vectors(vec_a, vec_b, indices);
+        } else if (ramp && stride && stride->value >= 3 && stride->value <= 8 &&
+                   ramp->lanes >= stride->value) {
+            // Load stride vectors worth densely and then shuffle out
+            // every stride'th lane. The last vector is shifted down
+            // so that we never read past the last lane we need.
+            const int s = stride->value, lanes = ramp->lanes;
+            vector<Value *> vecs;
+            for (int c = 0; c < s; c++) {
+                int offset = c * lanes - (c == s - 1 ? s - 1 : 0);
+                Expr base = ramp->base + offset;
+                Expr dense = Ramp::make(base, make_one(base.type()), lanes);
+                vecs.push_back(codegen(Load::make(op->type, op->name, dense, op->image, op->param, op->predicate)));
+            }
+            vector<int> indices(lanes);
+            for (int i = 0; i < lanes; i++) {
+                int e = i * s;
+                indices[i] = e < (s - 1) * lanes ? e : e + s - 1;
+            }
+            value = shuffle_vectors(concat_vectors(vecs), indices);
         } else if (ramp && stride && stride->value == -1) {
             // Load the vector and then flip it in-place
             Expr flipped_base = ramp->base - ramp->lanes + 1;
@@ -1962,6 +2099,160 @@ void CodeGen_LLVM::scalarize(Expr e) {
     value = result;
 }
 
+void CodeGen_LLVM::codegen_atomic_store(const Store *op) {
+    const Call *call = op->value.as<Call>();
+    internal_assert(call && call->args.size() == 1);
+    Expr value = call->args[0];
+    Type t = value.type().element_of();
+    int lanes = value.type().lanes();
+    user_assert(t.is_int() || t.is_uint() || t.is_float())
+        << "Atomic updates of type " << t << " are not supported\n";
+
+    debug(4) << "Atomic store\n\t" << Stmt(op) << "\n";
+
+    string old_name = unique_name("atomic_old");
+    Expr old_var = Variable::make(t, old_name);
+    Expr old_vec = lanes > 1 ? Broadcast::make(old_var, lanes) : old_var;
+    ReplaceAtomicLoad replacer(op, old_vec);
+    Expr update = replacer.mutate(value);
+    internal_assert(replacer.found)
+        << "Atomic update does not load the value it replaces:\n" << Stmt(op) << "\n";
+
+    // If the update is a single binary op between the old value and
+    // something else, evaluate the other operand once outside of any
+    // retry loop, and use an atomicrmw instruction if there is one
+    // for this op and type.
+    Expr rhs;
+    std::function<Expr(Expr, Expr)> combine;
+    bool have_rmw = false;
+    AtomicRMWInst::BinOp rmw_op = AtomicRMWInst::Add;
+    auto match_operands = [&](Expr a, Expr b) {
+        if (equal(a, old_vec)) {
+            rhs = b;
+        } else if (equal(b, old_vec)) {
+            rhs = a;
+        }
+        return rhs.defined();
+    };
+    if (const Add *add = update.as<Add>()) {
+        if (match_operands(add->a, add->b)) {
+            combine = [](Expr a, Expr b) { return Add::make(a, b); };
+            have_rmw = !t.is_float();
+            rmw_op = AtomicRMWInst::Add;
+            #if LLVM_VERSION >= 90
+            have_rmw = true;
+            if (t.is_float()) {
+                rmw_op = AtomicRMWInst::FAdd;
+            }
+            #endif
+        }
+    } else if (const Min *mn = update.as<Min>()) {
+        if (match_operands(mn->a, mn->b)) {
+            combine = [](Expr a, Expr b) { return Min::make(a, b); };
+            have_rmw = !t.is_float();
+            rmw_op = t.is_int() ? AtomicRMWInst::Min : AtomicRMWInst::UMin;
+        }
+    } else if (const Max *mx = update.as<Max>()) {
+        if (match_operands(mx->a, mx->b)) {
+            combine = [](Expr a, Expr b) { return Max::make(a, b); };
+            have_rmw = !t.is_float();
+            rmw_op = t.is_int() ? AtomicRMWInst::Max : AtomicRMWInst::UMax;
+        }
+    } else if (const Call *c = update.as<Call>()) {
+        if (c->args.size() == 2 &&
+            (c->is_intrinsic(Call::bitwise_and) ||
+             c->is_intrinsic(Call::bitwise_or) ||
+             c->is_intrinsic(Call::bitwise_xor)) &&
+            match_operands(c->args[0], c->args[1])) {
+            string name = c->name;
+            combine = [=](Expr a, Expr b) {
+                return Call::make(a.type(), name, {a, b}, Call::PureIntrinsic);
+            };
+            have_rmw = true;
+            rmw_op = (c->is_intrinsic(Call::bitwise_and) ? AtomicRMWInst::And :
+                      c->is_intrinsic(Call::bitwise_or) ? AtomicRMWInst::Or :
+                      AtomicRMWInst::Xor);
+        }
+    }
+
+    Value *vindex = codegen(op->index);
+    Value *vpred = is_one(op->predicate) ? nullptr : codegen(op->predicate);
+    Value *vrhs = rhs.defined() ? codegen(rhs) : nullptr;
+    string rhs_name = unique_name("atomic_rhs");
+    Expr rhs_var = Variable::make(t, rhs_name);
+    llvm::Type *bits_type = llvm::Type::getIntNTy(*context, t.bits());
+
+    // Different lanes may hit the same location, so each one gets
+    // its own atomic operation.
+    for (int i = 0; i < lanes; i++) {
+        Constant *lane = ConstantInt::get(i32_t, i);
+        Value *idx = lanes > 1 ? builder->CreateExtractElement(vindex, lane) : vindex;
+
+        BasicBlock *after_bb = nullptr;
+        if (vpred) {
+            Value *p = op->predicate.type().is_vector() ? builder->CreateExtractElement(vpred, lane) : vpred;
+            if (p->getType() != i1_t) {
+                p = builder->CreateIsNotNull(p);
+            }
+            BasicBlock *true_bb = BasicBlock::Create(*context, "atomic_lane", function);
+            after_bb = BasicBlock::Create(*context, "atomic_lane_done", function);
+            builder->CreateCondBr(p, true_bb, after_bb);
+            builder->SetInsertPoint(true_bb);
+        }
+
+        Value *ptr = codegen_buffer_pointer(op->name, t, idx);
+        Value *rhs_i = nullptr;
+        if (vrhs) {
+            rhs_i = lanes > 1 ? builder->CreateExtractElement(vrhs, lane) : vrhs;
+        }
+
+        if (have_rmw) {
+            builder->CreateAtomicRMW(rmw_op, ptr, rhs_i, AtomicOrdering::Monotonic);
+        } else {
+            // Compare-and-swap loop. The comparison is done on the
+            // bits, so floats are reinterpreted as integers.
+            Expr new_value;
+            if (combine) {
+                new_value = combine(old_var, rhs_var);
+            } else {
+                new_value = lanes > 1 ? Shuffle::make_extract_element(update, i) : update;
+            }
+            Value *bits_ptr = builder->CreatePointerCast(ptr, bits_type->getPointerTo());
+            Value *initial = builder->CreateAlignedLoad(bits_ptr, t.bytes());
+            BasicBlock *pre_bb = builder->GetInsertBlock();
+            BasicBlock *loop_bb = BasicBlock::Create(*context, "atomic_cas_loop", function);
+            BasicBlock *done_bb = BasicBlock::Create(*context, "atomic_cas_done", function);
+            builder->CreateBr(loop_bb);
+
+            builder->SetInsertPoint(loop_bb);
+            PHINode *old_bits = builder->CreatePHI(bits_type, 2);
+            old_bits->addIncoming(initial, pre_bb);
+            Value *old_val = t.is_float() ? builder->CreateBitCast(old_bits, llvm_type_of(t)) : old_bits;
+            sym_push(old_name, old_val);
+            if (rhs_i) {
+                sym_push(rhs_name, rhs_i);
+            }
+            Value *new_val = codegen(new_value);
+            if (rhs_i) {
+                sym_pop(rhs_name);
+            }
+            sym_pop(old_name);
+            Value *new_bits = t.is_float() ? builder->CreateBitCast(new_val, bits_type) : new_val;
+            Value *result = builder->CreateAtomicCmpXchg(bits_ptr, old_bits, new_bits,
+                                                         AtomicOrdering::Monotonic,
+                                                         AtomicOrdering::Monotonic);
+            old_bits->addIncoming(builder->CreateExtractValue(result, {0}), builder->GetInsertBlock());
+            builder->CreateCondBr(builder->CreateExtractValue(result, {1}), done_bb, loop_bb);
+            builder->SetInsertPoint(done_bb);
+        }
+
+        if (after_bb) {
+            builder->CreateBr(after_bb);
+            builder->SetInsertPoint(after_bb);
+        }
+    }
+}
+
 void CodeGen_LLVM::codegen_predicated_vector_store(const Store *op) {
     const Ramp *ramp = op->index.as<Ramp>();
     if (ramp && is_one(ramp->stride)) { // Dense vector store
@@ -2303,6 +2594,13 @@ void CodeGen_LLVM::visit(const Call *op) {
                               Let::make(b_name, op->args[1],
                                         Select::make(a_var < b_var, b_var - a_var, a_var - b_var))));
         }
+    } else if (op->is_intrinsic(Call::saturating_add) ||
+               op->is_intrinsic(Call::saturating_sub) ||
+               op->is_intrinsic(Call::rounding_shift_right) ||
+               op->is_intrinsic(Call::saturating_rounding_doubling_high_multiply)) {
+        // The portable versions of these are written in the form the
+        // instruction selectors of the SIMD backends look for.
+        value = codegen(lower_fixed_point_intrinsic(op));
     } else if (op->is_intrinsic("div_round_to_zero")) {
         internal_assert(op->args.size() == 2);
         Value *a = codegen(op->args[0]);
@@ -2720,11 +3018,25 @@ void CodeGen_LLVM::visit(const Call *op) {
 
         llvm::CallInst *call = builder->CreateCall(base_fn->getFunctionType(), phi, call_args);
         value = call;
+    } else if (op->is_intrinsic(Call::streaming_store)) {
+        // A streaming store that isn't the value of a store anymore,
+        // or that a backend lowers itself. It's only a hint.
+        internal_assert(op->args.size() == 1);
+        value = codegen(op->args[0]);
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        user_error << "An atomic() update was transformed in a way that prevents"
+                   << " it from being performed atomically, e.g. by trace_stores()\n";
     } else if (op->is_intrinsic(Call::prefetch)) {
-        user_assert((op->args.size() == 4) && is_one(op->args[2]))
+        user_assert((op->args.size() == 5) && is_one(op->args[3]))
             << "Only prefetch of 1 cache line is supported.\n";
 
-        llvm::Function *prefetch_fn = module->getFunction("_halide_prefetch");
+        // The runtime has one prefetch function per temporal locality,
+        // since the locality must be a constant.
+        const int64_t *locality = as_const_int(op->args[2]);
+        internal_assert(locality && *locality >= 0 && *locality <= 3);
+        const char *prefetch_fns[] = {"_halide_prefetch_nta", "_halide_prefetch_l3",
+                                      "_halide_prefetch_l2", "_halide_prefetch"};
+        llvm::Function *prefetch_fn = module->getFunction(prefetch_fns[*locality]);
         internal_assert(prefetch_fn);
 
         vector<llvm::Value *> args;
@@ -3083,6 +3395,12 @@ void CodeGen_LLVM::visit(const ProducerConsumer *op) {
 }
 
 void CodeGen_LLVM::visit(const For *op) {
+    string variant = cpu_variant_target(op->name);
+    if (!variant.empty()) {
+        codegen_cpu_variant(op->name, Target(variant), op->body);
+        return;
+    }
+
     Value *min = codegen(op->min);
     Value *extent = codegen(op->extent);
 
@@ -3126,108 +3444,203 @@ void CodeGen_LLVM::visit(const For *op) {
         // Pop the loop variable from the scope
         sym_pop(op->name);
     } else if (op->for_type == ForType::Parallel) {
+        codegen_parallel_loop(op->name, min, extent, op->body, "halide_do_par_for");
+    } else {
+        internal_error << "Unknown type of For node. Only Serial and Parallel For nodes should survive down to codegen.\n";
+    }
+}
 
-        debug(3) << "Entering parallel for loop over " << op->name << "\n";
+void CodeGen_LLVM::codegen_parallel_loop(const string &name, Value *min, Value *extent,
+                                         const Stmt &body, const string &do_par_for_name) {
 
-        // Find every symbol that the body of this loop refers to
-        // and dump it into a closure
-        Closure closure(op->body, op->name);
+    debug(3) << "Entering parallel for loop over " << name << "\n";
 
-        // Allocate a closure
-        StructType *closure_t = build_closure_type(closure, buffer_t_type, context);
-        Value *ptr = create_alloca_at_entry(closure_t, 1);
+    // Find every symbol that the body of this loop refers to
+    // and dump it into a closure
+    Closure closure(body, name);
 
-        // Fill in the closure
-        pack_closure(closure_t, ptr, closure, symbol_table, buffer_t_type, builder);
+    // Allocate a closure
+    StructType *closure_t = build_closure_type(closure, buffer_t_type, context);
+    Value *ptr = create_alloca_at_entry(closure_t, 1);
 
-        // Make a new function that does one iteration of the body of the loop
-        llvm::Type *voidPointerType = (llvm::Type *)(i8_t->getPointerTo());
-        llvm::Type *args_t[] = {voidPointerType, i32_t, voidPointerType};
-        FunctionType *func_t = FunctionType::get(i32_t, args_t, false);
-        llvm::Function *containing_function = function;
-        function = llvm::Function::Create(func_t, llvm::Function::InternalLinkage,
-                                          "par_for_" + function->getName() + "_" + op->name, module.get());
-        #if LLVM_VERSION < 50
-        function->setDoesNotAlias(3);
-        #else
-        function->addParamAttr(2, Attribute::NoAlias);
-        #endif
-        set_function_attributes_for_target(function, target);
+    // Fill in the closure
+    pack_closure(closure_t, ptr, closure, symbol_table, buffer_t_type, builder);
 
-        // Make the initial basic block and jump the builder into the new function
-        IRBuilderBase::InsertPoint call_site = builder->saveIP();
-        BasicBlock *block = BasicBlock::Create(*context, "entry", function);
-        builder->SetInsertPoint(block);
+    // Make a new function that does one iteration of the body of the loop
+    llvm::Type *voidPointerType = (llvm::Type *)(i8_t->getPointerTo());
+    llvm::Type *args_t[] = {voidPointerType, i32_t, voidPointerType};
+    FunctionType *func_t = FunctionType::get(i32_t, args_t, false);
+    llvm::Function *containing_function = function;
+    function = llvm::Function::Create(func_t, llvm::Function::InternalLinkage,
+                                      "par_for_" + function->getName() + "_" + name, module.get());
+    #if LLVM_VERSION < 50
+    function->setDoesNotAlias(3);
+    #else
+    function->addParamAttr(2, Attribute::NoAlias);
+    #endif
+    set_function_attributes_for_target(function, target);
 
-        // Get the user context value before swapping out the symbol table.
-        Value *user_context = get_user_context();
+    // Make the initial basic block and jump the builder into the new function
+    IRBuilderBase::InsertPoint call_site = builder->saveIP();
+    BasicBlock *block = BasicBlock::Create(*context, "entry", function);
+    builder->SetInsertPoint(block);
 
-        // Save the destructor block
-        BasicBlock *parent_destructor_block = destructor_block;
-        destructor_block = nullptr;
+    // Get the user context value before swapping out the symbol table.
+    Value *user_context = get_user_context();
 
-        // Make a new scope to use
-        Scope<Value *> saved_symbol_table;
-        symbol_table.swap(saved_symbol_table);
+    // Save the destructor block
+    BasicBlock *parent_destructor_block = destructor_block;
+    destructor_block = nullptr;
 
-        // Get the function arguments
+    // Make a new scope to use
+    Scope<Value *> saved_symbol_table;
+    symbol_table.swap(saved_symbol_table);
 
-        // The user context is first argument of the function; it's
-        // important that we override the name to be "__user_context",
-        // since the LLVM function has a random auto-generated name for
-        // this argument.
-        llvm::Function::arg_iterator iter = function->arg_begin();
-        sym_push("__user_context", iterator_to_pointer(iter));
+    // Get the function arguments
 
-        // Next is the loop variable.
-        ++iter;
-        sym_push(op->name, iterator_to_pointer(iter));
+    // The user context is first argument of the function; it's
+    // important that we override the name to be "__user_context",
+    // since the LLVM function has a random auto-generated name for
+    // this argument.
+    llvm::Function::arg_iterator iter = function->arg_begin();
+    sym_push("__user_context", iterator_to_pointer(iter));
 
-        // The closure pointer is the third and last argument.
-        ++iter;
-        iter->setName("closure");
-        Value *closure_handle = builder->CreatePointerCast(iterator_to_pointer(iter),
-                                                           closure_t->getPointerTo());
-        // Load everything from the closure into the new scope
-        unpack_closure(closure, symbol_table, closure_t, closure_handle, builder);
+    // Next is the loop variable.
+    ++iter;
+    sym_push(name, iterator_to_pointer(iter));
 
-        // Generate the new function body
-        codegen(op->body);
+    // The closure pointer is the third and last argument.
+    ++iter;
+    iter->setName("closure");
+    Value *closure_handle = builder->CreatePointerCast(iterator_to_pointer(iter),
+                                                       closure_t->getPointerTo());
+    // Load everything from the closure into the new scope
+    unpack_closure(closure, symbol_table, closure_t, closure_handle, builder);
 
-        // Return success
-        return_with_error_code(ConstantInt::get(i32_t, 0));
+    // Generate the new function body
+    int nontemporal_stores_before = nontemporal_stores_emitted;
+    codegen(body);
 
-        // Move the builder back to the main function and call do_par_for
-        builder->restoreIP(call_site);
-        llvm::Function *do_par_for = module->getFunction("halide_do_par_for");
-        internal_assert(do_par_for) << "Could not find halide_do_par_for in initial module\n";
-        #if LLVM_VERSION < 50
-        do_par_for->setDoesNotAlias(5);
-        #else
-        do_par_for->addParamAttr(4, Attribute::NoAlias);
-        #endif
-        //do_par_for->setDoesNotCapture(5);
-        ptr = builder->CreatePointerCast(ptr, i8_t->getPointerTo());
-        Value *args[] = {user_context, function, min, extent, ptr};
-        debug(4) << "Creating call to do_par_for\n";
-        Value *result = builder->CreateCall(do_par_for, args);
+    // Non-temporal stores are weakly ordered, so make them visible
+    // before the task reports that it is done.
+    if (nontemporal_stores_emitted != nontemporal_stores_before) {
+        builder->CreateFence(AtomicOrdering::SequentiallyConsistent);
+    }
 
-        debug(3) << "Leaving parallel for loop over " << op->name << "\n";
+    // Return success
+    return_with_error_code(ConstantInt::get(i32_t, 0));
 
-        // Now restore the scope
-        symbol_table.swap(saved_symbol_table);
-        function = containing_function;
+    // Move the builder back to the main function and call do_par_for
+    builder->restoreIP(call_site);
+    llvm::Function *do_par_for = module->getFunction(do_par_for_name);
+    internal_assert(do_par_for) << "Could not find " << do_par_for_name << " in initial module\n";
+    #if LLVM_VERSION < 50
+    do_par_for->setDoesNotAlias(5);
+    #else
+    do_par_for->addParamAttr(4, Attribute::NoAlias);
+    #endif
+    //do_par_for->setDoesNotCapture(5);
+    ptr = builder->CreatePointerCast(ptr, i8_t->getPointerTo());
+    Value *args[] = {user_context, function, min, extent, ptr};
+    debug(4) << "Creating call to " << do_par_for_name << "\n";
+    Value *result = builder->CreateCall(do_par_for, args);
+
+    debug(3) << "Leaving parallel for loop over " << name << "\n";
+
+    // Now restore the scope
+    symbol_table.swap(saved_symbol_table);
+    function = containing_function;
+
+    // Restore the destructor block
+    destructor_block = parent_destructor_block;
+
+    // Check for success
+    Value *did_succeed = builder->CreateICmpEQ(result, ConstantInt::get(i32_t, 0));
+    create_assertion(did_succeed, Expr(), result);
+}
+
+void CodeGen_LLVM::codegen_cpu_variant(const string &name, const Target &variant, const Stmt &body) {
+    debug(3) << "Entering CPU variant " << name << "\n";
+
+    // Pack everything the body refers to into a closure, as for a
+    // parallel loop, so that the body can go in its own function with
+    // its own target attributes.
+    Closure closure(body, name);
+    StructType *closure_t = build_closure_type(closure, buffer_t_type, context);
+    Value *ptr = create_alloca_at_entry(closure_t, 1);
+    pack_closure(closure_t, ptr, closure, symbol_table, buffer_t_type, builder);
+
+    llvm::Type *voidPointerType = (llvm::Type *)(i8_t->getPointerTo());
+    llvm::Type *args_t[] = {voidPointerType, voidPointerType};
+    FunctionType *func_t = FunctionType::get(i32_t, args_t, false);
+    llvm::Function *containing_function = function;
+    function = llvm::Function::Create(func_t, llvm::Function::InternalLinkage,
+                                      "cpu_variant_" + function->getName() + "_" + name, module.get());
+    #if LLVM_VERSION < 50
+    function->setDoesNotAlias(2);
+    #else
+    function->addParamAttr(1, Attribute::NoAlias);
+    #endif
 
-        // Restore the destructor block
-        destructor_block = parent_destructor_block;
+    // Compile the body for the variant. The target-features
+    // attribute also stops LLVM from inlining it into the caller.
+    Target containing_target = target;
+    target = variant;
+    set_function_attributes_for_target(function, target);
+    function->addFnAttr("target-cpu", mcpu());
+    function->addFnAttr("target-features", mattrs());
 
-        // Check for success
-        Value *did_succeed = builder->CreateICmpEQ(result, ConstantInt::get(i32_t, 0));
-        create_assertion(did_succeed, Expr(), result);
+    IRBuilderBase::InsertPoint call_site = builder->saveIP();
+    BasicBlock *block = BasicBlock::Create(*context, "entry", function);
+    builder->SetInsertPoint(block);
 
-    } else {
-        internal_error << "Unknown type of For node. Only Serial and Parallel For nodes should survive down to codegen.\n";
-    }
+    Value *user_context = get_user_context();
+
+    BasicBlock *parent_destructor_block = destructor_block;
+    destructor_block = nullptr;
+
+    Scope<Value *> saved_symbol_table;
+    symbol_table.swap(saved_symbol_table);
+
+    llvm::Function::arg_iterator iter = function->arg_begin();
+    sym_push("__user_context", iterator_to_pointer(iter));
+    ++iter;
+    iter->setName("closure");
+    Value *closure_handle = builder->CreatePointerCast(iterator_to_pointer(iter),
+                                                       closure_t->getPointerTo());
+    unpack_closure(closure, symbol_table, closure_t, closure_handle, builder);
+
+    codegen(body);
+    return_with_error_code(ConstantInt::get(i32_t, 0));
+
+    // Call it from the containing function.
+    builder->restoreIP(call_site);
+    llvm::Function *variant_function = function;
+    ptr = builder->CreatePointerCast(ptr, i8_t->getPointerTo());
+    Value *args[] = {user_context, ptr};
+    Value *result = builder->CreateCall(variant_function, args);
+
+    debug(3) << "Leaving CPU variant " << name << "\n";
+
+    symbol_table.swap(saved_symbol_table);
+    function = containing_function;
+    target = containing_target;
+    destructor_block = parent_destructor_block;
+
+    Value *did_succeed = builder->CreateICmpEQ(result, ConstantInt::get(i32_t, 0));
+    create_assertion(did_succeed, Expr(), result);
+}
+
+void CodeGen_LLVM::visit(const Fork *op) {
+    // Run each side of the fork as one task of a parallel loop. The
+    // runtime guarantees all tasks launched via
+    // halide_do_parallel_tasks run concurrently, so the two sides may
+    // block on each other.
+    string name = unique_name("fork");
+    Expr task = Variable::make(Int(32), name);
+    Stmt body = IfThenElse::make(task == 0, op->first, op->rest);
+    codegen_parallel_loop(name, ConstantInt::get(i32_t, 0), ConstantInt::get(i32_t, 2),
+                          body, "halide_do_parallel_tasks");
 }
 
 void CodeGen_LLVM::visit(const Store *op) {
@@ -3239,6 +3652,20 @@ void CodeGen_LLVM::visit(const Store *op) {
         return;
     }
 
+    if (const Call *call = op->value.as<Call>()) {
+        if (call->is_intrinsic(Call::atomic_update)) {
+            codegen_atomic_store(op);
+            return;
+        } else if (call->is_intrinsic(Call::streaming_store)) {
+            internal_assert(call->args.size() == 1);
+            bool old_emit_nontemporal_stores = emit_nontemporal_stores;
+            emit_nontemporal_stores = true;
+            codegen(Store::make(op->name, call->args[0], op->index, op->param, op->predicate));
+            emit_nontemporal_stores = old_emit_nontemporal_stores;
+            return;
+        }
+    }
+
     // Predicated store
     if (!is_one(op->predicate)) {
         codegen_predicated_vector_store(op);
@@ -3297,6 +3724,11 @@ void CodeGen_LLVM::visit(const Store *op) {
                 Value *vec_ptr = builder->CreatePointerCast(elt_ptr, slice_val->getType()->getPointerTo());
                 StoreInst *store = builder->CreateAlignedStore(slice_val, vec_ptr, alignment);
                 add_tbaa_metadata(store, op->name, slice_index);
+                if (emit_nontemporal_stores && slice_lanes > 1) {
+                    llvm::Metadata *one = ConstantAsMetadata::get(ConstantInt::get(i32_t, 1));
+                    store->setMetadata(LLVMContext::MD_nontemporal, MDNode::get(*context, {one}));
+                    nontemporal_stores_emitted++;
+                }
             }
         } else if (ramp) {
             Type ptr_type = value_type.element_of();
@@ -28,6 +28,7 @@ class NamedMDNode;
 class DataLayout;
 class BasicBlock;
 class GlobalVariable;
+class Target;
 }  // namespace llvm
 
 #include <map>
@@ -61,15 +62,30 @@ public:
     /** Takes a halide Module and compiles it to an llvm Module. */
     virtual std::unique_ptr<llvm::Module> compile(const Module &module);
 
+    /** Set whether compile runs llvm's full optimization pipeline on
+     * the module (the default), or only what is needed for correct
+     * code, which compiles much faster but runs much slower. */
+    void set_optimize(bool o) { optimize = o; }
+
     /** The target we're generating code for */
     const Target &get_target() const { return target; }
 
     /** Tell the code generator which LLVM context to use. */
     void set_context(llvm::LLVMContext &context);
 
-    /** Initialize internal llvm state for the enabled targets. */
+    /** Initialize internal llvm state. Only the native target is
+     * registered with llvm; the other enabled targets are registered
+     * lazily, by initialize_all_llvm_targets. */
     static void initialize_llvm();
 
+    /** Register every enabled target with llvm. */
+    static void initialize_all_llvm_targets();
+
+    /** Look up the llvm target for a triple, registering the
+     * non-native targets first if needed. Returns nullptr and sets
+     * error_string if there is no such target. */
+    static const llvm::Target *lookup_llvm_target(const std::string &triple, std::string &error_string);
+
 protected:
     CodeGen_LLVM(Target t);
 
@@ -260,6 +276,17 @@ protected:
      * the destructor block. */
     void return_with_error_code(llvm::Value *error_code);
 
+    /** Generate code for a parallel loop by packing the body into a
+     * closure and calling the named runtime function (with the
+     * signature of halide_do_par_for) on it. */
+    void codegen_parallel_loop(const std::string &name, llvm::Value *min, llvm::Value *extent,
+                               const Stmt &body, const std::string &do_par_for_name);
+
+    /** Generate code for the body of a CPU variant made by
+     * inject_cpu_variants, by compiling it as a separate function
+     * for the given target and calling it. */
+    void codegen_cpu_variant(const std::string &name, const Target &variant, const Stmt &body);
+
     /** Put a string constant in the module as a global variable and return a pointer to it. */
     llvm::Constant *create_string_constant(const std::string &str);
 
@@ -343,6 +370,7 @@ protected:
     virtual void visit(const For *);
     virtual void visit(const Store *);
     virtual void visit(const Block *);
+    virtual void visit(const Fork *);
     virtual void visit(const IfThenElse *);
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
@@ -463,6 +491,15 @@ private:
     /** Turn off all unsafe math flags in scopes while this is set. */
     bool strict_float;
 
+    /** Whether optimize_module runs the full optimization pipeline. */
+    bool optimize;
+
+    /** Set while generating a store marked as a streaming store, so
+     * that dense vector stores get the nontemporal hint. The count of
+     * such stores tells parallel tasks whether they need a fence. */
+    bool emit_nontemporal_stores;
+    int nontemporal_stores_emitted;
+
     /** Embed an instance of halide_filter_metadata_t in the code, using
      * the given name (by convention, this should be ${FUNCTIONNAME}_metadata)
      * as extern "C" linkage. Note that the return value is a function-returning-
@@ -475,19 +512,27 @@ private:
     /** Embed a constant expression as a global variable. */
     llvm::Constant *embed_constant_expr(Expr e);
 
-    llvm::Function *add_argv_wrapper(const std::string &name);
+    /** Make a wrapper for fn that takes its arguments as an array of
+     * pointers, with the given name. */
+    llvm::Function *add_argv_wrapper(llvm::Function *fn, const std::string &name);
 
     llvm::Value *codegen_dense_vector_load(const Load *load, llvm::Value *vpred = nullptr);
 
     virtual void codegen_predicated_vector_load(const Load *op);
     virtual void codegen_predicated_vector_store(const Store *op);
+
+    /** Generate a store marked as an atomic update, one lane at a
+     * time, using atomicrmw where possible and a compare-and-swap
+     * loop otherwise. */
+    void codegen_atomic_store(const Store *op);
 };
 
 }  // namespace Internal
 
 /** Given a Halide module, generate an llvm::Module. */
 std::unique_ptr<llvm::Module> codegen_llvm(const Module &module,
-                                           llvm::LLVMContext &context);
+                                           llvm::LLVMContext &context,
+                                           bool optimize = true);
 
 }  // namespace Halide
 
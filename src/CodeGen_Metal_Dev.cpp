@@ -5,6 +5,7 @@
 #include "CodeGen_Metal_Dev.h"
 #include "Debug.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 
 namespace Halide {
 namespace Internal {
@@ -172,8 +173,9 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Mod *op) {
 void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const For *loop) {
     if (is_gpu_var(loop->name)) {
         internal_assert((loop->for_type == ForType::GPUBlock) ||
-                        (loop->for_type == ForType::GPUThread))
-            << "kernel loop must be either gpu block or gpu thread\n";
+                        (loop->for_type == ForType::GPUThread) ||
+                        (loop->for_type == ForType::GPULane))
+            << "kernel loop must be either gpu block, gpu thread, or gpu lane\n";
         internal_assert(is_zero(loop->min));
 
         do_indent();
@@ -448,6 +450,22 @@ struct BufferSize {
         return size < r.size;
     }
 };
+
+// Does a kernel need the index of its threads within their
+// SIMD-group, for the shuffles injected by lower_warp_shuffles?
+class UsesSIMDLaneId : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        if (op->name == "halide_simd_lane_id") {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+};
 }  // namespace
 
 void CodeGen_Metal_Dev::CodeGen_Metal_C::add_kernel(Stmt s,
@@ -530,6 +548,12 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::add_kernel(Stmt s,
     stream << "kernel void " << name << "(\n";
     stream << "uint3 tgroup_index [[ threadgroup_position_in_grid ]],\n"
            << "uint3 tid_in_tgroup [[ thread_position_in_threadgroup ]]";
+    UsesSIMDLaneId uses_simd_lane_id;
+    s.accept(&uses_simd_lane_id);
+    if (uses_simd_lane_id.result) {
+        // Only ask for it when needed, as it requires Metal 2.
+        stream << ",\nuint halide_simd_lane [[ thread_index_in_simdgroup ]]";
+    }
     size_t buffer_index = 0;
     if (any_scalar_args) {
         stream << ",\nconst device " << name << "_args *_scalar_args [[ buffer(0) ]]";
@@ -599,6 +623,7 @@ void CodeGen_Metal_Dev::init_module() {
                << "constexpr float neg_inf_f32() { return float_from_bits(0xff800000); }\n"
                << "constexpr float inf_f32() { return float_from_bits(0x7f800000); }\n"
                << "float fast_inverse_f32(float x) { return 1.0f / x; } \n"
+               << "#define halide_simd_lane_id() halide_simd_lane\n"
                << "#define sqrt_f32 sqrt \n"
                << "#define sin_f32 sin \n"
                << "#define cos_f32 cos \n"
@@ -7,6 +7,8 @@
 #include "EliminateBoolVectors.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "ModulusRemainder.h"
+#include "Substitute.h"
 
 namespace Halide {
 namespace Internal {
@@ -114,8 +116,9 @@ string simt_intrinsic(const string &name) {
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const For *loop) {
     if (is_gpu_var(loop->name)) {
         internal_assert((loop->for_type == ForType::GPUBlock) ||
-                        (loop->for_type == ForType::GPUThread))
-            << "kernel loop must be either gpu block or gpu thread\n";
+                        (loop->for_type == ForType::GPUThread) ||
+                        (loop->for_type == ForType::GPULane))
+            << "kernel loop must be either gpu block, gpu thread, or gpu lane\n";
         internal_assert(is_zero(loop->min));
 
         do_indent();
@@ -161,6 +164,43 @@ string CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::get_memory_space(const string &buf)
     return "__address_space_" + print_name(buf);
 }
 
+bool CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::is_aligned_local_access(const string &name, Type t, Expr base) {
+    // __shared is declared as a pointer to int16, so is aligned to 64
+    // bytes, and FuseGPUThreadLoops aligns each allocation within it
+    // to 16 bytes.
+    int lanes = t.lanes();
+    if (name != "__shared" ||
+        (lanes != 2 && lanes != 4 && lanes != 8 && lanes != 16) ||
+        t.bytes() * lanes > 16) {
+        return false;
+    }
+    ModulusRemainder mod_rem = modulus_remainder(base, alignment_info);
+    return (mod_rem.modulus % lanes) == 0 && (mod_rem.remainder % lanes) == 0;
+}
+
+void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const LetStmt *op) {
+    // Track the alignment of the lets, which CodeGen_C substitutes
+    // into the body by name, so that vector accesses to local memory
+    // can be proven aligned.
+    string id_value = print_expr(op->value);
+    Stmt body = op->body;
+    if (op->value.type().is_handle()) {
+        do_indent();
+        stream << print_type(op->value.type())
+               << " " << print_name(op->name)
+               << " = " << id_value << ";\n";
+        body.accept(this);
+    } else {
+        Expr new_var = Variable::make(op->value.type(), id_value);
+        body = substitute(op->name, new_var, body);
+        bool is_int32 = op->value.type() == Int(32);
+        ScopedBinding<ModulusRemainder>
+            bind(is_int32, alignment_info, id_value,
+                 is_int32 ? modulus_remainder(op->value, alignment_info) : ModulusRemainder());
+        body.accept(this);
+    }
+}
+
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Call *op) {
     if (op->is_intrinsic(Call::bool_to_mask)) {
         if (op->args[0].type().is_vector()) {
@@ -229,6 +269,17 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Load *op) {
         string id_ramp_base = print_expr(ramp_base);
 
         ostringstream rhs;
+        if (is_aligned_local_access(op->name, op->type, ramp_base)) {
+            // An aligned access to local memory can be a single
+            // vector load.
+            rhs << "((" << get_memory_space(op->name) << " "
+                << print_type(op->type) << " *)"
+                << print_name(op->name) << ")[(" << id_ramp_base
+                << ") / " << op->type.lanes() << "]";
+            print_assignment(op->type, rhs.str());
+            return;
+        }
+
         rhs << "vload" << op->type.lanes()
             << "(0, (" << get_memory_space(op->name) << " "
             << print_type(op->type.element_of()) << "*)"
@@ -297,6 +348,16 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Store *op) {
         internal_assert(op->value.type().is_vector());
         string id_ramp_base = print_expr(ramp_base);
 
+        if (is_aligned_local_access(op->name, t, ramp_base)) {
+            do_indent();
+            stream << "((" << get_memory_space(op->name) << " "
+                   << print_type(t) << " *)"
+                   << print_name(op->name) << ")[(" << id_ramp_base
+                   << ") / " << t.lanes() << "] = " << id_value << ";\n";
+            cache.clear();
+            return;
+        }
+
         do_indent();
         stream << "vstore" << t.lanes() << "("
                << id_value << ","
@@ -690,6 +751,17 @@ void CodeGen_OpenCL_Dev::init_module() {
     // __shared always has address space __local.
     src_stream << "#define __address_space___shared __local\n";
 
+    // Warp shuffles from gpu_lanes loops use whichever sub-group
+    // shuffle the device provides.
+    src_stream << "#if defined(cl_intel_subgroups)\n"
+               << "#pragma OPENCL EXTENSION cl_intel_subgroups : enable\n"
+               << "#define halide_sub_group_shuffle intel_sub_group_shuffle\n"
+               << "#elif defined(cl_khr_subgroup_shuffle)\n"
+               << "#pragma OPENCL EXTENSION cl_khr_subgroups : enable\n"
+               << "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable\n"
+               << "#define halide_sub_group_shuffle sub_group_shuffle\n"
+               << "#endif\n";
+
     if (target.has_feature(Target::CLDoubles)) {
         src_stream << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
                    << "bool is_nan_f64(double x) {return x != x; }\n"
@@ -9,6 +9,8 @@
 
 #include "CodeGen_C.h"
 #include "CodeGen_GPU_Dev.h"
+#include "ModulusRemainder.h"
+#include "Scope.h"
 #include "Target.h"
 
 namespace Halide {
@@ -58,7 +60,16 @@ protected:
 
         std::string get_memory_space(const std::string &);
 
+        /** Check whether a dense vector load or store of type t at
+         * base can be done directly on an aligned vector pointer. */
+        bool is_aligned_local_access(const std::string &name, Type t, Expr base);
+
+        /** The alignment of the lets in scope, by the name they are
+         * substituted in as. */
+        Scope<ModulusRemainder> alignment_info;
+
         void visit(const For *);
+        void visit(const LetStmt *op);
         void visit(const Ramp *op);
         void visit(const Broadcast *op);
         void visit(const Call *op);
@@ -81,6 +81,19 @@ void CodeGen_PTX_Dev::add_kernel(Stmt stmt,
         }
     }
 
+    // Mark the buffers the kernel never writes to as read-only. Along
+    // with noalias, this lets the NVPTX backend route their loads
+    // through the read-only data cache (ld.global.nc).
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].is_buffer && !args[i].write) {
+            #if LLVM_VERSION < 50
+            function->addAttribute(i+1, Attribute::ReadOnly);
+            #else
+            function->addParamAttr(i, Attribute::ReadOnly);
+            #endif
+        }
+    }
+
     // Get the alignment of the integer arguments
     for (size_t i = 0; i < args.size(); i++) {
         if (args[i].alignment.modulus) {
@@ -258,10 +271,13 @@ void CodeGen_PTX_Dev::visit(const Load *op) {
 
 void CodeGen_PTX_Dev::visit(const Store *op) {
 
-    // Do aligned 4-wide 32-bit stores as a single i128 store.
+    // Do aligned 4-wide 32-bit stores as a single i128 store. Atomic
+    // updates must stay as they are.
     const Ramp *r = op->index.as<Ramp>();
+    const Call *c = op->value.as<Call>();
+    bool is_atomic = c && c->is_intrinsic(Call::atomic_update);
     // TODO: lanes >= 4, not lanes == 4
-    if (is_one(op->predicate) && r && is_one(r->stride) && r->lanes == 4 && op->value.type().bits() == 32) {
+    if (!is_atomic && is_one(op->predicate) && r && is_one(r->stride) && r->lanes == 4 && op->value.type().bits() == 32) {
         ModulusRemainder align = modulus_remainder(r->base, alignment_info);
         if (align.modulus % 4 == 0 && align.remainder % 4 == 0) {
             Expr index = simplify(r->base / 4);
@@ -275,12 +291,98 @@ void CodeGen_PTX_Dev::visit(const Store *op) {
     CodeGen_LLVM::visit(op);
 }
 
+void CodeGen_PTX_Dev::visit(const Call *op) {
+    if (op->name == "halide_wmma_m16n16k16") {
+        // A 16x16x16 matrix multiply-accumulate on tensor cores,
+        // done by the whole warp. The loads in the args name the
+        // corner of each tile.
+        #if LLVM_VERSION >= 80
+        internal_assert(op->args.size() == 9);
+        llvm::Type *f16x2_t = VectorType::get(f16_t, 2);
+        bool c_is_f32 = op->type == Float(32);
+        string c_type = c_is_f32 ? "f32" : "f16";
+
+        auto declare = [&](const string &name, llvm::Type *ret, const vector<Value *> &args) {
+            llvm::Function *fn = module->getFunction(name);
+            if (!fn) {
+                vector<llvm::Type *> arg_types;
+                for (Value *v : args) {
+                    arg_types.push_back(v->getType());
+                }
+                FunctionType *func_t = FunctionType::get(ret, arg_types, false);
+                fn = llvm::Function::Create(func_t, llvm::Function::ExternalLinkage, name, module.get());
+            }
+            return fn;
+        };
+        // The address of a tile, and the suffix naming its address space.
+        auto tile = [&](const Expr &e, string &suffix) {
+            const Load *load = e.as<Load>();
+            internal_assert(load);
+            Value *ptr = codegen_buffer_pointer(load->name, load->type, load->index);
+            unsigned addr_space = ptr->getType()->getPointerAddressSpace();
+            suffix = ".p" + std::to_string(addr_space) + "i8";
+            return builder->CreatePointerCast(ptr, i8_t->getPointerTo(addr_space));
+        };
+        auto layout = [&](const Expr &e) {
+            const StringImm *s = e.as<StringImm>();
+            internal_assert(s);
+            return s->value;
+        };
+        // Load a fragment, and append its registers to args.
+        auto load_fragment = [&](const string &frag, const string &type, int regs,
+                                 llvm::Type *reg_t, int arg, vector<Value *> &args) {
+            string suffix;
+            Value *ptr = tile(op->args[arg], suffix);
+            Value *stride = codegen(op->args[arg + 1]);
+            string name = "llvm.nvvm.wmma.m16n16k16.load." + frag + "." +
+                layout(op->args[arg + 2]) + ".stride." + type + suffix;
+            llvm::Type *frag_t = StructType::get(*context, vector<llvm::Type *>(regs, reg_t));
+            Value *result = builder->CreateCall(declare(name, frag_t, {ptr, stride}), {ptr, stride});
+            for (int i = 0; i < regs; i++) {
+                args.push_back(builder->CreateExtractValue(result, {(unsigned)i}));
+            }
+        };
+
+        int c_regs = c_is_f32 ? 8 : 4;
+        llvm::Type *c_reg_t = c_is_f32 ? f32_t : f16x2_t;
+        vector<Value *> mma_args;
+        load_fragment("a", "f16", 8, f16x2_t, 3, mma_args);
+        load_fragment("b", "f16", 8, f16x2_t, 6, mma_args);
+        load_fragment("c", c_type, c_regs, c_reg_t, 0, mma_args);
+
+        string mma_name = "llvm.nvvm.wmma.m16n16k16.mma." + layout(op->args[5]) + "." +
+            layout(op->args[8]) + "." + c_type + "." + c_type;
+        llvm::Type *d_t = StructType::get(*context, vector<llvm::Type *>(c_regs, c_reg_t));
+        Value *d = builder->CreateCall(declare(mma_name, d_t, mma_args), mma_args);
+
+        string suffix;
+        vector<Value *> store_args = {tile(op->args[0], suffix)};
+        for (int i = 0; i < c_regs; i++) {
+            store_args.push_back(builder->CreateExtractValue(d, {(unsigned)i}));
+        }
+        store_args.push_back(codegen(op->args[1]));
+        string store_name = "llvm.nvvm.wmma.m16n16k16.store.d." + layout(op->args[2]) +
+            ".stride." + c_type + suffix;
+        builder->CreateCall(declare(store_name, void_t, store_args), store_args);
+
+        value = UndefValue::get(llvm_type_of(op->type));
+        #else
+        user_error << "tensor_core() requires LLVM 8 or later.\n";
+        #endif
+        return;
+    }
+
+    CodeGen_LLVM::visit(op);
+}
+
 string CodeGen_PTX_Dev::march() const {
     return "nvptx64";
 }
 
 string CodeGen_PTX_Dev::mcpu() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        return "sm_70";
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "sm_61";
     } else if (target.has_feature(Target::CUDACapability50)) {
         return "sm_50";
@@ -296,7 +398,10 @@ string CodeGen_PTX_Dev::mcpu() const {
 }
 
 string CodeGen_PTX_Dev::mattrs() const {
-    if (target.has_feature(Target::CUDACapability61)) {
+    if (target.has_feature(Target::CUDACapability70)) {
+        // Tensor core instructions need ptx isa 6.0.
+        return "+ptx60";
+    } else if (target.has_feature(Target::CUDACapability61)) {
         return "+ptx50";
     } else if (target.features_any_of({Target::CUDACapability32,
                                 Target::CUDACapability50})) {
@@ -329,7 +434,7 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
     // Allocate target machine
 
     std::string err_str;
-    const llvm::Target *target = TargetRegistry::lookupTarget(triple.str(), err_str);
+    const llvm::Target *target = CodeGen_LLVM::lookup_llvm_target(triple.str(), err_str);
     internal_assert(target) << err_str << "\n";
 
     TargetOptions options;
@@ -61,6 +61,7 @@ protected:
     void visit(const AssertStmt *);
     void visit(const Load *);
     void visit(const Store *);
+    void visit(const Call *);
     // @}
 
     std::string march() const;
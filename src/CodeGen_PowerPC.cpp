@@ -1,4 +1,5 @@
 #include "CodeGen_PowerPC.h"
+#include "CodeGen_Internal.h"
 #include "ConciseCasts.h"
 #include "IRMatch.h"
 #include "IROperator.h"
@@ -21,6 +22,15 @@ CodeGen_PowerPC::CodeGen_PowerPC(Target t) : CodeGen_Posix(t) {
     user_assert(llvm_PowerPC_enabled) << "llvm build not configured with PowerPC target enabled.\n";
 }
 
+bool CodeGen_PowerPC::has_vsx() const {
+    return target.has_feature(Target::VSX) || has_power_arch_2_07();
+}
+
+bool CodeGen_PowerPC::has_power_arch_2_07() const {
+    return target.has_feature(Target::POWER_ARCH_2_07) ||
+        target.has_feature(Target::POWER_ARCH_3_00);
+}
+
 const char* CodeGen_PowerPC::altivec_int_type_name(const Type& t) {
     if (t.is_int()) {
         switch (t.bits()) {
@@ -99,7 +109,7 @@ void CodeGen_PowerPC::visit(const Cast *op) {
     for (size_t i = 0; i < sizeof(patterns)/sizeof(patterns[0]); i++) {
         const Pattern &pattern = patterns[i];
 
-        if (!target.has_feature(Target::VSX) && pattern.needs_vsx) {
+        if (!has_vsx() && pattern.needs_vsx) {
             continue;
         }
 
@@ -128,8 +138,8 @@ void CodeGen_PowerPC::visit(const Min *op) {
         return;
     }
 
-    bool vsx = target.has_feature(Target::VSX);
-    bool arch_2_07 = target.has_feature(Target::POWER_ARCH_2_07);
+    bool vsx = has_vsx();
+    bool arch_2_07 = has_power_arch_2_07();
 
     const Type& element_type = op->type.element_of();
     const char* element_type_name = altivec_int_type_name(element_type);
@@ -154,8 +164,8 @@ void CodeGen_PowerPC::visit(const Max *op) {
         return;
     }
 
-    bool vsx = target.has_feature(Target::VSX);
-    bool arch_2_07 = target.has_feature(Target::POWER_ARCH_2_07);
+    bool vsx = has_vsx();
+    bool arch_2_07 = has_power_arch_2_07();
 
     const Type& element_type = op->type.element_of();
     const char* element_type_name = altivec_int_type_name(element_type);
@@ -174,13 +184,110 @@ void CodeGen_PowerPC::visit(const Max *op) {
     }
 }
 
+bool CodeGen_PowerPC::codegen_dot_product(const Add *op) {
+    const int lanes = op->type.lanes();
+    if (!(op->type.is_int() || op->type.is_uint()) ||
+        op->type.bits() != 32 || lanes % 4 != 0) {
+        return false;
+    }
+
+    // The multiply-sums add four 8-bit or two 16-bit products to each
+    // 32-bit lane of an accumulator. The operands are interleaved so
+    // that each 32-bit lane holds the values for its products.
+    struct DotProduct {
+        int factor;
+        Type a, b;
+        const char *intrin;
+    };
+    const DotProduct dot_products[] = {
+        {4, UInt(8, lanes), UInt(8, lanes), "llvm.ppc.altivec.vmsumubm"},
+        {4, Int(8, lanes), UInt(8, lanes), "llvm.ppc.altivec.vmsummbm"},
+        {2, Int(16, lanes), Int(16, lanes), "llvm.ppc.altivec.vmsumshm"},
+        {2, UInt(16, lanes), UInt(16, lanes), "llvm.ppc.altivec.vmsumuhm"},
+    };
+    for (const DotProduct &d : dot_products) {
+        vector<Expr> as, bs, products, rest;
+        find_widening_products(op, d.a, d.b, as, bs, products, rest);
+        int groups = (int)products.size() / d.factor;
+        if (groups == 0) {
+            continue;
+        }
+
+        // Everything else, including any leftover products, is the
+        // accumulator the multiply-sums get added to.
+        for (size_t i = groups * d.factor; i < products.size(); i++) {
+            rest.push_back(products[i]);
+        }
+        Expr init = make_zero(op->type);
+        for (size_t i = 0; i < rest.size(); i++) {
+            init = (i == 0) ? rest[i] : init + rest[i];
+        }
+        Value *acc = codegen(init);
+
+        llvm::Type *result_t = VectorType::get(i32_t, 4);
+        for (int g = 0; g < groups; g++) {
+            vector<Expr> group_a(as.begin() + g * d.factor, as.begin() + (g + 1) * d.factor);
+            vector<Expr> group_b(bs.begin() + g * d.factor, bs.begin() + (g + 1) * d.factor);
+            Value *a = codegen(Shuffle::make_interleave(group_a));
+            Value *b = codegen(Shuffle::make_interleave(group_b));
+            vector<Value *> results;
+            for (int i = 0; i < lanes; i += 4) {
+                results.push_back(call_intrin(result_t, 4, d.intrin,
+                                              {slice_vector(a, i * d.factor, 4 * d.factor),
+                                               slice_vector(b, i * d.factor, 4 * d.factor),
+                                               slice_vector(acc, i, 4)}));
+            }
+            acc = concat_vectors(results);
+        }
+        value = acc;
+        return true;
+    }
+    return false;
+}
+
+void CodeGen_PowerPC::visit(const Add *op) {
+    if (op->type.is_vector() && codegen_dot_product(op)) {
+        return;
+    }
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_PowerPC::visit(const Call *op) {
+#if LLVM_VERSION >= 60
+    if (op->is_intrinsic(Call::absd) && op->type.is_vector() &&
+        target.has_feature(Target::POWER_ARCH_3_00)) {
+        // POWER9 has unsigned absolute differences. Flipping the sign
+        // bits maps signed values to unsigned ones in the same order,
+        // so the differences of signed values can use them too.
+        Type t = op->args[0].type();
+        const char *element_type_name = altivec_int_type_name(t.element_of().with_code(Type::UInt));
+        if ((t.is_int() || t.is_uint()) && t.bits() <= 32 && element_type_name != nullptr) {
+            Expr a = op->args[0], b = op->args[1];
+            if (t.is_int()) {
+                Type u = t.with_code(Type::UInt);
+                Expr sign_bit = make_const(u, (uint64_t)1 << (t.bits() - 1));
+                a = reinterpret(u, a) ^ sign_bit;
+                b = reinterpret(u, b) ^ sign_bit;
+            }
+            value = call_intrin(op->type, 128 / t.bits(),
+                                std::string("llvm.ppc.altivec.vabsd") + element_type_name,
+                                {a, b});
+            return;
+        }
+    }
+#endif
+    CodeGen_Posix::visit(op);
+}
+
 string CodeGen_PowerPC::mcpu() const {
     if (target.bits == 32) {
         return "ppc32";
     } else {
-        if (target.has_feature(Target::POWER_ARCH_2_07))
+        if (target.has_feature(Target::POWER_ARCH_3_00))
+            return "pwr9";
+        else if (has_power_arch_2_07())
             return "pwr8";
-        else if (target.has_feature(Target::VSX))
+        else if (has_vsx())
             return "pwr7";
         else
             return "ppc64";
@@ -195,11 +302,11 @@ string CodeGen_PowerPC::mattrs() const {
     features += "+altivec";
     separator = ",";
 
-    enable = target.has_feature(Target::VSX) ? "+" : "-";
+    enable = has_vsx() ? "+" : "-";
     features += separator + enable + "vsx";
     separator = ",";
 
-    enable = target.has_feature(Target::POWER_ARCH_2_07) ? "+" : "-";
+    enable = has_power_arch_2_07() ? "+" : "-";
     features += separator + enable + "power8-altivec";
     separator = ",";
 
@@ -209,6 +316,12 @@ string CodeGen_PowerPC::mattrs() const {
     features += separator + enable + "direct-move";
     separator = ",";
 
+    // VSX 3.0 and the POWER9 AltiVec additions, which include the
+    // extended permutes LLVM uses for interleaving shuffles.
+    enable = target.has_feature(Target::POWER_ARCH_3_00) ? "+" : "-";
+    features += separator + enable + "power9-altivec";
+    features += separator + enable + "power9-vector";
+
     return features;
 }
 
@@ -33,11 +33,25 @@ protected:
     void visit(const Cast *);
     void visit(const Min *);
     void visit(const Max *);
+    void visit(const Add *);
+    void visit(const Call *);
     // @}
 
+    /** Generate a sum of widening multiplies, plus anything else, as
+     * multiply-sums. Returns false if the sum has no such multiplies
+     * to use them for. */
+    bool codegen_dot_product(const Add *);
+
     // Call an intrinsic as defined by a pattern. Dispatches to the
 private:
     static const char *altivec_int_type_name(const Type &);
+
+    /** Whether the target has VSX and POWER ISA 2.07, counting the
+     * ones implied by POWER ISA 3.00. */
+    // @{
+    bool has_vsx() const;
+    bool has_power_arch_2_07() const;
+    // @}
 };
 
 }  // namespace Internal
@@ -0,0 +1,1288 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "CodeGen_Internal.h"
+#include "CodeGen_Vulkan_Dev.h"
+#include "Debug.h"
+#include "FixedPointMath.h"
+#include "IROperator.h"
+#include "Lerp.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The subset of the SPIR-V 1.0 and GLSL.std.450 extended instruction
+// set enumerants used by the emitter.
+namespace SPIRV {
+
+enum Op : uint32_t {
+    OpExtInstImport = 11,
+    OpExtInst = 12,
+    OpMemoryModel = 14,
+    OpEntryPoint = 15,
+    OpExecutionMode = 16,
+    OpCapability = 17,
+    OpTypeVoid = 19,
+    OpTypeBool = 20,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpTypeFunction = 33,
+    OpConstantTrue = 41,
+    OpConstantFalse = 42,
+    OpConstant = 43,
+    OpSpecConstant = 50,
+    OpSpecConstantComposite = 51,
+    OpFunction = 54,
+    OpFunctionEnd = 56,
+    OpVariable = 59,
+    OpLoad = 61,
+    OpStore = 62,
+    OpAccessChain = 65,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpCompositeExtract = 81,
+    OpConvertFToU = 109,
+    OpConvertFToS = 110,
+    OpConvertSToF = 111,
+    OpConvertUToF = 112,
+    OpBitcast = 124,
+    OpIAdd = 128,
+    OpFAdd = 129,
+    OpISub = 130,
+    OpFSub = 131,
+    OpIMul = 132,
+    OpFMul = 133,
+    OpUDiv = 134,
+    OpSDiv = 135,
+    OpFDiv = 136,
+    OpUMod = 137,
+    OpSRem = 138,
+    OpFMod = 141,
+    OpIsNan = 156,
+    OpLogicalEqual = 164,
+    OpLogicalNotEqual = 165,
+    OpLogicalOr = 166,
+    OpLogicalAnd = 167,
+    OpLogicalNot = 168,
+    OpSelect = 169,
+    OpIEqual = 170,
+    OpINotEqual = 171,
+    OpUGreaterThan = 172,
+    OpSGreaterThan = 173,
+    OpUGreaterThanEqual = 174,
+    OpSGreaterThanEqual = 175,
+    OpULessThan = 176,
+    OpSLessThan = 177,
+    OpULessThanEqual = 178,
+    OpSLessThanEqual = 179,
+    OpFOrdEqual = 180,
+    OpFUnordNotEqual = 183,
+    OpFOrdLessThan = 184,
+    OpFOrdGreaterThan = 186,
+    OpFOrdLessThanEqual = 188,
+    OpFOrdGreaterThanEqual = 190,
+    OpShiftRightLogical = 194,
+    OpShiftRightArithmetic = 195,
+    OpShiftLeftLogical = 196,
+    OpBitwiseOr = 197,
+    OpBitwiseXor = 198,
+    OpBitwiseAnd = 199,
+    OpNot = 200,
+    OpBitCount = 205,
+    OpControlBarrier = 224,
+    OpAtomicAnd = 240,
+    OpAtomicOr = 241,
+    OpPhi = 245,
+    OpLoopMerge = 246,
+    OpSelectionMerge = 247,
+    OpLabel = 248,
+    OpBranch = 249,
+    OpBranchConditional = 250,
+    OpReturn = 253,
+};
+
+const uint32_t MagicNumber = 0x07230203;
+const uint32_t Version_1_0 = 0x00010000;
+
+const uint32_t CapabilityShader = 1;
+const uint32_t AddressingModelLogical = 0;
+const uint32_t MemoryModelGLSL450 = 1;
+const uint32_t ExecutionModelGLCompute = 5;
+const uint32_t ExecutionModeLocalSize = 17;
+
+const uint32_t StorageClassInput = 1;
+const uint32_t StorageClassUniform = 2;
+const uint32_t StorageClassWorkgroup = 4;
+const uint32_t StorageClassFunction = 7;
+
+const uint32_t DecorationSpecId = 1;
+const uint32_t DecorationBlock = 2;
+const uint32_t DecorationBufferBlock = 3;
+const uint32_t DecorationArrayStride = 6;
+const uint32_t DecorationBuiltIn = 11;
+const uint32_t DecorationBinding = 33;
+const uint32_t DecorationDescriptorSet = 34;
+const uint32_t DecorationOffset = 35;
+
+const uint32_t BuiltInWorkgroupSize = 25;
+const uint32_t BuiltInWorkgroupId = 26;
+const uint32_t BuiltInLocalInvocationId = 27;
+
+const uint32_t ScopeDevice = 1;
+const uint32_t ScopeWorkgroup = 2;
+const uint32_t MemorySemanticsAcquireRelease = 0x8;
+const uint32_t MemorySemanticsWorkgroupMemory = 0x100;
+
+// GLSL.std.450
+const uint32_t GLSLRoundEven = 2;
+const uint32_t GLSLTrunc = 3;
+const uint32_t GLSLFAbs = 4;
+const uint32_t GLSLSAbs = 5;
+const uint32_t GLSLFloor = 8;
+const uint32_t GLSLCeil = 9;
+const uint32_t GLSLSin = 13;
+const uint32_t GLSLCos = 14;
+const uint32_t GLSLTan = 15;
+const uint32_t GLSLAsin = 16;
+const uint32_t GLSLAcos = 17;
+const uint32_t GLSLAtan = 18;
+const uint32_t GLSLSinh = 19;
+const uint32_t GLSLCosh = 20;
+const uint32_t GLSLTanh = 21;
+const uint32_t GLSLAsinh = 22;
+const uint32_t GLSLAcosh = 23;
+const uint32_t GLSLAtanh = 24;
+const uint32_t GLSLAtan2 = 25;
+const uint32_t GLSLPow = 26;
+const uint32_t GLSLExp = 27;
+const uint32_t GLSLLog = 28;
+const uint32_t GLSLSqrt = 31;
+const uint32_t GLSLInverseSqrt = 32;
+const uint32_t GLSLFMin = 37;
+const uint32_t GLSLUMin = 38;
+const uint32_t GLSLSMin = 39;
+const uint32_t GLSLFMax = 40;
+const uint32_t GLSLUMax = 41;
+const uint32_t GLSLSMax = 42;
+const uint32_t GLSLFindILsb = 73;
+const uint32_t GLSLFindUMsb = 75;
+
+}  // namespace SPIRV
+
+using namespace SPIRV;
+
+// Halide's float math externs that map directly onto a GLSL.std.450
+// instruction.
+const std::map<string, uint32_t> &glsl_math_functions() {
+    static const std::map<string, uint32_t> functions = {
+        {"sqrt_f32", GLSLSqrt},
+        {"sin_f32", GLSLSin},
+        {"cos_f32", GLSLCos},
+        {"tan_f32", GLSLTan},
+        {"asin_f32", GLSLAsin},
+        {"acos_f32", GLSLAcos},
+        {"atan_f32", GLSLAtan},
+        {"atan2_f32", GLSLAtan2},
+        {"sinh_f32", GLSLSinh},
+        {"cosh_f32", GLSLCosh},
+        {"tanh_f32", GLSLTanh},
+        {"asinh_f32", GLSLAsinh},
+        {"acosh_f32", GLSLAcosh},
+        {"atanh_f32", GLSLAtanh},
+        {"pow_f32", GLSLPow},
+        {"exp_f32", GLSLExp},
+        {"log_f32", GLSLLog},
+        {"floor_f32", GLSLFloor},
+        {"ceil_f32", GLSLCeil},
+        // Halide rounds to nearest even.
+        {"round_f32", GLSLRoundEven},
+        {"trunc_f32", GLSLTrunc},
+        {"fast_inverse_sqrt_f32", GLSLInverseSqrt},
+    };
+    return functions;
+}
+
+// Returns the component of the workgroup or invocation id a gpu loop
+// variable corresponds to.
+int gpu_loop_dimension(const string &name) {
+    const char *suffixes[] = {"_id_x", "_id_y", "_id_z"};
+    for (int i = 0; i < 3; i++) {
+        if (ends_with(name, suffixes[i])) {
+            return i;
+        }
+    }
+    user_error << "Vulkan: gpu loop " << name << " has more than 3 dimensions, which is not supported.\n";
+    return -1;
+}
+
+uint32_t narrow_mask(int bits) {
+    return bits >= 32 ? 0xffffffffu : ((1u << bits) - 1);
+}
+
+class FindSharedAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) {
+        op->body.accept(this);
+        if (starts_with(op->name, "__shared_")) {
+            allocs.push_back(op);
+        }
+    }
+
+public:
+    vector<const Allocate *> allocs;
+};
+
+}  // namespace
+
+CodeGen_Vulkan_Dev::CodeGen_Vulkan_Dev(Target t)
+    : emitter(t) {
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::append_string(vector<uint32_t> &words, const string &str) {
+    // Nul-terminated, padded with zeros to a whole number of words.
+    size_t num_words = str.size() / 4 + 1;
+    size_t start = words.size();
+    words.resize(start + num_words, 0);
+    for (size_t i = 0; i < str.size(); i++) {
+        words[start + i / 4] |= (uint32_t)(uint8_t)str[i] << (8 * (i % 4));
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::append(vector<uint32_t> &section, uint32_t op,
+                                               const vector<uint32_t> &operands) {
+    uint32_t word_count = operands.size() + 1;
+    internal_assert(word_count < 0x10000) << "SPIR-V instruction too long\n";
+    section.push_back((word_count << 16) | op);
+    section.insert(section.end(), operands.begin(), operands.end());
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::emit(uint32_t op, uint32_t type, const vector<uint32_t> &operands) {
+    uint32_t result = make_id();
+    vector<uint32_t> words = {type, result};
+    words.insert(words.end(), operands.begin(), operands.end());
+    append(function_body, op, words);
+    return result;
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_void(uint32_t op, const vector<uint32_t> &operands) {
+    append(function_body, op, operands);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_ext(uint32_t inst, uint32_t type, const vector<uint32_t> &operands) {
+    vector<uint32_t> words = {glsl_ext, inst};
+    words.insert(words.end(), operands.begin(), operands.end());
+    return emit(OpExtInst, type, words);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_label(uint32_t label) {
+    append(function_body, OpLabel, {label});
+    current_label = label;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::declare_type(const string &key, uint32_t op,
+                                                         const vector<uint32_t> &operands) {
+    auto it = type_ids.find(key);
+    if (it != type_ids.end()) {
+        return it->second;
+    }
+    uint32_t result = make_id();
+    vector<uint32_t> words = {result};
+    words.insert(words.end(), operands.begin(), operands.end());
+    append(globals, op, words);
+    type_ids[key] = result;
+    return result;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::void_type() {
+    return declare_type("void", OpTypeVoid, {});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::bool_type() {
+    return declare_type("bool", OpTypeBool, {});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::int_type() {
+    return declare_type("int", OpTypeInt, {32, 1});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::uint_type() {
+    return declare_type("uint", OpTypeInt, {32, 0});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::float_type() {
+    return declare_type("float", OpTypeFloat, {32});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::uvec3_type() {
+    return declare_type("uvec3", OpTypeVector, {uint_type(), 3});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::pointer_type(uint32_t storage_class, uint32_t pointee) {
+    string key = "ptr<" + std::to_string(storage_class) + "," + std::to_string(pointee) + ">";
+    return declare_type(key, OpTypePointer, {storage_class, pointee});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::array_type(uint32_t element, uint32_t size) {
+    uint32_t length = const_uint(size);
+    string key = "array<" + std::to_string(element) + "," + std::to_string(size) + ">";
+    return declare_type(key, OpTypeArray, {element, length});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::storage_buffer_type() {
+    auto it = type_ids.find("storage_buffer");
+    if (it != type_ids.end()) {
+        return it->second;
+    }
+    // struct { uint data[]; }, laid out with 4-byte words.
+    uint32_t words = declare_type("uint[]", OpTypeRuntimeArray, {uint_type()});
+    append(annotations, OpDecorate, {words, DecorationArrayStride, 4});
+    uint32_t result = declare_type("storage_buffer", OpTypeStruct, {words});
+    append(annotations, OpDecorate, {result, DecorationBufferBlock});
+    append(annotations, OpMemberDecorate, {result, 0, DecorationOffset, 0});
+    return result;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::args_block_type(uint32_t members) {
+    string key = "args<" + std::to_string(members) + ">";
+    auto it = type_ids.find(key);
+    if (it != type_ids.end()) {
+        return it->second;
+    }
+    vector<uint32_t> member_types(members, uint_type());
+    uint32_t result = declare_type(key, OpTypeStruct, member_types);
+    append(annotations, OpDecorate, {result, DecorationBlock});
+    for (uint32_t i = 0; i < members; i++) {
+        append(annotations, OpMemberDecorate, {result, i, DecorationOffset, 4 * i});
+    }
+    return result;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::spirv_type(Type t) {
+    user_assert(t.is_scalar())
+        << "Vulkan: vector type " << t << " is not supported. Do not vectorize inside Vulkan kernels.\n";
+    if (t.is_bool()) {
+        return bool_type();
+    } else if (t.is_float()) {
+        user_assert(t.bits() == 32) << "Vulkan: can't represent a float with " << t.bits() << " bits.\n";
+        return float_type();
+    } else if (t.is_int() || t.is_uint()) {
+        // Narrower integers are computed in 32 bits, and normalized
+        // back into range after any operation that can overflow them.
+        user_assert(t.bits() <= 32) << "Vulkan: can't represent type " << t << ".\n";
+        return t.is_int() ? int_type() : uint_type();
+    }
+    user_error << "Vulkan: can't represent type " << t << ".\n";
+    return 0;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::storage_type(Type t) {
+    // Bools can't be stored in memory; keep them as 0 or 1 words.
+    return t.is_bool() ? uint_type() : spirv_type(t);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::constant(uint32_t type, uint32_t bits) {
+    std::pair<uint32_t, uint32_t> key(type, bits);
+    auto it = constant_ids.find(key);
+    if (it != constant_ids.end()) {
+        return it->second;
+    }
+    uint32_t result = make_id();
+    if (type == bool_type()) {
+        append(globals, bits ? OpConstantTrue : OpConstantFalse, {type, result});
+    } else {
+        append(globals, OpConstant, {type, result, bits});
+    }
+    constant_ids[key] = result;
+    return result;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::const_uint(uint32_t value) {
+    return constant(uint_type(), value);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::const_int(int32_t value) {
+    return constant(int_type(), (uint32_t)value);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::const_float(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return constant(float_type(), bits);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::const_bool(bool value) {
+    return constant(bool_type(), value ? 1 : 0);
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::const_of_type(Type t, int64_t value) {
+    if (t.is_bool()) {
+        return const_bool(value != 0);
+    } else if (t.is_float()) {
+        return const_float((float)value);
+    } else if (t.is_int()) {
+        return const_int((int32_t)value);
+    } else {
+        return const_uint((uint32_t)value);
+    }
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_expr(Expr e) {
+    e.accept(this);
+    return id;
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::normalize(uint32_t value, Type t) {
+    if (t.is_bool() || t.is_float() || t.bits() >= 32) {
+        return value;
+    }
+    if (t.is_uint()) {
+        return emit(OpBitwiseAnd, uint_type(), {value, const_uint(narrow_mask(t.bits()))});
+    } else {
+        // Sign-extend from the top bit of the narrow type.
+        uint32_t amount = const_uint(32 - t.bits());
+        uint32_t shifted = emit(OpShiftLeftLogical, int_type(), {value, amount});
+        return emit(OpShiftRightArithmetic, int_type(), {shifted, amount});
+    }
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::to_uint(uint32_t value, Type t) {
+    if (t.is_bool()) {
+        return emit(OpSelect, uint_type(), {value, const_uint(1), const_uint(0)});
+    } else if (t.is_uint()) {
+        return value;
+    } else {
+        return emit(OpBitcast, uint_type(), {value});
+    }
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::from_uint(uint32_t value, Type t) {
+    if (t.is_bool()) {
+        return emit(OpINotEqual, bool_type(), {value, const_uint(0)});
+    } else if (t.is_uint()) {
+        return value;
+    } else {
+        return emit(OpBitcast, spirv_type(t), {value});
+    }
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::convert(uint32_t value, Type from, Type to) {
+    if (from == to) {
+        return value;
+    }
+    if (to.is_bool()) {
+        if (from.is_float()) {
+            return emit(OpFUnordNotEqual, bool_type(), {value, const_float(0.0f)});
+        }
+        return emit(OpINotEqual, bool_type(), {value, const_of_type(from, 0)});
+    } else if (from.is_bool()) {
+        return emit(OpSelect, spirv_type(to), {value, const_of_type(to, 1), const_of_type(to, 0)});
+    } else if (from.is_float() && to.is_float()) {
+        // Only 32-bit floats are supported.
+        return value;
+    } else if (from.is_float()) {
+        uint32_t result = to.is_int() ?
+            emit(OpConvertFToS, int_type(), {value}) :
+            emit(OpConvertFToU, uint_type(), {value});
+        return normalize(result, to);
+    } else if (to.is_float()) {
+        return emit(from.is_int() ? OpConvertSToF : OpConvertUToF, float_type(), {value});
+    }
+
+    // Integer to integer. The value is already sign- or zero-extended
+    // to 32 bits according to its own type, which is exactly what a
+    // widening cast does.
+    uint32_t result = value;
+    if (from.is_int() != to.is_int()) {
+        result = emit(OpBitcast, spirv_type(to), {value});
+    }
+    if (to.bits() < 32 && (to.bits() < from.bits() || from.is_int() != to.is_int())) {
+        result = normalize(result, to);
+    }
+    return result;
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit_binop(Type t, Expr a, Expr b,
+                                                    uint32_t int_op, uint32_t uint_op, uint32_t float_op,
+                                                    bool needs_normalize) {
+    uint32_t va = emit_expr(a);
+    uint32_t vb = emit_expr(b);
+    uint32_t op = t.is_float() ? float_op : (t.is_int() ? int_op : uint_op);
+    id = emit(op, spirv_type(t), {va, vb});
+    if (needs_normalize) {
+        id = normalize(id, t);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit_cmp(Expr a, Expr b, uint32_t int_op, uint32_t uint_op,
+                                                  uint32_t float_op, uint32_t bool_op) {
+    Type t = a.type();
+    uint32_t va = emit_expr(a);
+    uint32_t vb = emit_expr(b);
+    uint32_t op = (t.is_bool() ? bool_op :
+                   t.is_float() ? float_op :
+                   t.is_int() ? int_op : uint_op);
+    internal_assert(op != 0) << "Vulkan: unsupported comparison of " << t << "\n";
+    id = emit(op, bool_type(), {va, vb});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit_minmax(Type t, Expr a, Expr b,
+                                                     uint32_t sop, uint32_t uop, uint32_t fop) {
+    uint32_t va = emit_expr(a);
+    uint32_t vb = emit_expr(b);
+    if (t.is_bool()) {
+        id = emit(sop == GLSLSMin ? OpLogicalAnd : OpLogicalOr, bool_type(), {va, vb});
+    } else {
+        uint32_t inst = t.is_float() ? fop : (t.is_int() ? sop : uop);
+        id = emit_ext(inst, spirv_type(t), {va, vb});
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const IntImm *op) {
+    user_assert(op->type.bits() <= 32) << "Vulkan: 64-bit integers are not supported.\n";
+    id = const_int((int32_t)op->value);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const UIntImm *op) {
+    user_assert(op->type.bits() <= 32) << "Vulkan: 64-bit integers are not supported.\n";
+    if (op->type.is_bool()) {
+        id = const_bool(op->value != 0);
+    } else {
+        id = const_uint((uint32_t)op->value);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const FloatImm *op) {
+    user_assert(op->type.bits() == 32) << "Vulkan: can't represent a float with " << op->type.bits() << " bits.\n";
+    id = const_float((float)op->value);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const StringImm *op) {
+    user_error << "Vulkan: strings are not supported inside kernels.\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Cast *op) {
+    id = convert(emit_expr(op->value), op->value.type(), op->type);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Variable *op) {
+    internal_assert(symbols.contains(op->name)) << "Vulkan: unbound variable " << op->name << "\n";
+    id = symbols.get(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Add *op) {
+    visit_binop(op->type, op->a, op->b, OpIAdd, OpIAdd, OpFAdd, true);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Sub *op) {
+    visit_binop(op->type, op->a, op->b, OpISub, OpISub, OpFSub, true);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Mul *op) {
+    visit_binop(op->type, op->a, op->b, OpIMul, OpIMul, OpFMul, true);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Div *op) {
+    int bits;
+    if (is_const_power_of_two_integer(op->b, &bits)) {
+        uint32_t a = emit_expr(op->a);
+        id = emit(op->type.is_int() ? OpShiftRightArithmetic : OpShiftRightLogical,
+                  spirv_type(op->type), {a, const_uint(bits)});
+    } else if (op->type.is_int()) {
+        lower_euclidean_div(op->a, op->b).accept(this);
+    } else {
+        visit_binop(op->type, op->a, op->b, OpSDiv, OpUDiv, OpFDiv, false);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Mod *op) {
+    int bits;
+    if (is_const_power_of_two_integer(op->b, &bits)) {
+        uint32_t a = emit_expr(op->a);
+        id = emit(OpBitwiseAnd, spirv_type(op->type), {a, const_of_type(op->type, (1 << bits) - 1)});
+    } else if (op->type.is_int()) {
+        lower_euclidean_mod(op->a, op->b).accept(this);
+    } else {
+        // OpFMod takes the sign of the divisor, which matches Halide's
+        // a - b * floor(a / b).
+        visit_binop(op->type, op->a, op->b, OpSRem, OpUMod, OpFMod, false);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Min *op) {
+    visit_minmax(op->type, op->a, op->b, GLSLSMin, GLSLUMin, GLSLFMin);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Max *op) {
+    visit_minmax(op->type, op->a, op->b, GLSLSMax, GLSLUMax, GLSLFMax);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const EQ *op) {
+    visit_cmp(op->a, op->b, OpIEqual, OpIEqual, OpFOrdEqual, OpLogicalEqual);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const NE *op) {
+    visit_cmp(op->a, op->b, OpINotEqual, OpINotEqual, OpFUnordNotEqual, OpLogicalNotEqual);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LT *op) {
+    visit_cmp(op->a, op->b, OpSLessThan, OpULessThan, OpFOrdLessThan, 0);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LE *op) {
+    visit_cmp(op->a, op->b, OpSLessThanEqual, OpULessThanEqual, OpFOrdLessThanEqual, 0);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const GT *op) {
+    visit_cmp(op->a, op->b, OpSGreaterThan, OpUGreaterThan, OpFOrdGreaterThan, 0);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const GE *op) {
+    visit_cmp(op->a, op->b, OpSGreaterThanEqual, OpUGreaterThanEqual, OpFOrdGreaterThanEqual, 0);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const And *op) {
+    uint32_t a = emit_expr(op->a);
+    uint32_t b = emit_expr(op->b);
+    id = emit(OpLogicalAnd, bool_type(), {a, b});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Or *op) {
+    uint32_t a = emit_expr(op->a);
+    uint32_t b = emit_expr(op->b);
+    id = emit(OpLogicalOr, bool_type(), {a, b});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Not *op) {
+    uint32_t a = emit_expr(op->a);
+    id = emit(OpLogicalNot, bool_type(), {a});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Select *op) {
+    uint32_t cond = emit_expr(op->condition);
+    uint32_t t = emit_expr(op->true_value);
+    uint32_t f = emit_expr(op->false_value);
+    id = emit(OpSelect, spirv_type(op->type), {cond, t, f});
+}
+
+uint32_t CodeGen_Vulkan_Dev::SPIRV_Emitter::element_pointer(const BufferInfo &info, uint32_t index, uint32_t *shift) {
+    *shift = 0;
+    if (info.storage_class != StorageClassUniform) {
+        return emit(OpAccessChain, pointer_type(info.storage_class, storage_type(info.type)),
+                    {info.variable, index});
+    }
+
+    // Storage buffers are arrays of words. Narrow elements are
+    // addressed by the word containing them and a bit offset.
+    uint32_t u_index = emit(OpBitcast, uint_type(), {index});
+    uint32_t word;
+    int bytes = info.type.bytes();
+    if (bytes == 4) {
+        word = emit(OpIAdd, uint_type(), {info.word_offset, u_index});
+    } else {
+        uint32_t scaled = emit(OpIMul, uint_type(), {u_index, const_uint(bytes)});
+        uint32_t byte = emit(OpIAdd, uint_type(), {info.byte_offset, scaled});
+        word = emit(OpShiftRightLogical, uint_type(), {byte, const_uint(2)});
+        uint32_t byte_in_word = emit(OpBitwiseAnd, uint_type(), {byte, const_uint(3)});
+        *shift = emit(OpShiftLeftLogical, uint_type(), {byte_in_word, const_uint(3)});
+    }
+    return emit(OpAccessChain, pointer_type(StorageClassUniform, uint_type()),
+                {info.variable, const_uint(0), word});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Load *op) {
+    user_assert(is_one(op->predicate)) << "Vulkan: predicated loads are not supported.\n";
+    user_assert(op->type.is_scalar()) << "Vulkan: vector loads are not supported.\n";
+    internal_assert(buffers.contains(op->name)) << "Vulkan: load from unknown buffer " << op->name << "\n";
+    const BufferInfo &info = buffers.get(op->name);
+
+    uint32_t index = emit_expr(op->index);
+    uint32_t shift;
+    uint32_t ptr = element_pointer(info, index, &shift);
+
+    if (info.storage_class != StorageClassUniform) {
+        uint32_t value = emit(OpLoad, storage_type(op->type), {ptr});
+        id = op->type.is_bool() ? from_uint(value, op->type) : value;
+    } else if (op->type.bytes() == 4) {
+        id = from_uint(emit(OpLoad, uint_type(), {ptr}), op->type);
+    } else {
+        uint32_t word = emit(OpLoad, uint_type(), {ptr});
+        uint32_t shifted = emit(OpShiftRightLogical, uint_type(), {word, shift});
+        uint32_t value = emit(OpBitwiseAnd, uint_type(), {shifted, const_uint(narrow_mask(op->type.bytes() * 8))});
+        if (op->type.is_int()) {
+            value = normalize(emit(OpBitcast, int_type(), {value}), op->type);
+        } else {
+            value = from_uint(value, op->type);
+        }
+        id = value;
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Store *op) {
+    user_assert(is_one(op->predicate)) << "Vulkan: predicated stores are not supported.\n";
+    Type t = op->value.type();
+    user_assert(t.is_scalar()) << "Vulkan: vector stores are not supported.\n";
+    internal_assert(buffers.contains(op->name)) << "Vulkan: store to unknown buffer " << op->name << "\n";
+    const BufferInfo &info = buffers.get(op->name);
+
+    if (const Call *c = op->value.as<Call>()) {
+        user_assert(!c->is_intrinsic(Call::atomic_update))
+            << "Vulkan: atomic() updates are not supported by this backend.\n";
+    }
+
+    uint32_t value = emit_expr(op->value);
+    uint32_t index = emit_expr(op->index);
+    uint32_t shift;
+    uint32_t ptr = element_pointer(info, index, &shift);
+
+    if (info.storage_class != StorageClassUniform) {
+        emit_void(OpStore, {ptr, t.is_bool() ? to_uint(value, t) : value});
+    } else if (t.bytes() == 4) {
+        emit_void(OpStore, {ptr, to_uint(value, t)});
+    } else {
+        // Other invocations may be writing the neighboring bytes of
+        // the same word, so replace the bytes atomically.
+        uint32_t mask = const_uint(narrow_mask(t.bytes() * 8));
+        uint32_t bits = emit(OpBitwiseAnd, uint_type(), {to_uint(value, t), mask});
+        bits = emit(OpShiftLeftLogical, uint_type(), {bits, shift});
+        uint32_t keep = emit(OpNot, uint_type(), {emit(OpShiftLeftLogical, uint_type(), {mask, shift})});
+        uint32_t scope = const_uint(ScopeDevice);
+        uint32_t semantics = const_uint(0);
+        emit(OpAtomicAnd, uint_type(), {ptr, scope, semantics, keep});
+        emit(OpAtomicOr, uint_type(), {ptr, scope, semantics, bits});
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Ramp *op) {
+    user_error << "Vulkan: vectors are not supported. Do not vectorize inside Vulkan kernels.\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Broadcast *op) {
+    user_error << "Vulkan: vectors are not supported. Do not vectorize inside Vulkan kernels.\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Shuffle *op) {
+    user_error << "Vulkan: vectors are not supported. Do not vectorize inside Vulkan kernels.\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Call *op) {
+    Type t = op->type;
+    if (op->name == "halide_gpu_thread_barrier") {
+        emit_void(OpControlBarrier, {const_uint(ScopeWorkgroup), const_uint(ScopeWorkgroup),
+                                     const_uint(MemorySemanticsAcquireRelease | MemorySemanticsWorkgroupMemory)});
+        id = const_int(0);
+    } else if (op->is_intrinsic(Call::likely) ||
+               op->is_intrinsic(Call::likely_if_innermost) ||
+               op->is_intrinsic(Call::strict_float) ||
+               op->is_intrinsic(Call::unsafe_promise_clamped)) {
+        op->args[0].accept(this);
+    } else if (op->is_intrinsic(Call::return_second)) {
+        op->args[0].accept(this);
+        op->args[1].accept(this);
+    } else if (op->is_intrinsic(Call::reinterpret)) {
+        Type from = op->args[0].type();
+        uint32_t value = emit_expr(op->args[0]);
+        if (from.is_float() || t.is_float()) {
+            id = from == t ? value : emit(OpBitcast, spirv_type(t), {value});
+        } else {
+            id = convert(value, from, t);
+        }
+    } else if (op->is_intrinsic(Call::bitwise_and) ||
+               op->is_intrinsic(Call::bitwise_or) ||
+               op->is_intrinsic(Call::bitwise_xor)) {
+        uint32_t a = emit_expr(op->args[0]);
+        uint32_t b = emit_expr(op->args[1]);
+        uint32_t opcode;
+        if (t.is_bool()) {
+            opcode = (op->is_intrinsic(Call::bitwise_and) ? OpLogicalAnd :
+                      op->is_intrinsic(Call::bitwise_or) ? OpLogicalOr : OpLogicalNotEqual);
+        } else {
+            opcode = (op->is_intrinsic(Call::bitwise_and) ? OpBitwiseAnd :
+                      op->is_intrinsic(Call::bitwise_or) ? OpBitwiseOr : OpBitwiseXor);
+        }
+        id = emit(opcode, spirv_type(t), {a, b});
+    } else if (op->is_intrinsic(Call::bitwise_not)) {
+        uint32_t a = emit_expr(op->args[0]);
+        id = t.is_bool() ? emit(OpLogicalNot, bool_type(), {a}) : normalize(emit(OpNot, spirv_type(t), {a}), t);
+    } else if (op->is_intrinsic(Call::shift_left)) {
+        uint32_t a = emit_expr(op->args[0]);
+        uint32_t b = emit_expr(op->args[1]);
+        id = normalize(emit(OpShiftLeftLogical, spirv_type(t), {a, b}), t);
+    } else if (op->is_intrinsic(Call::shift_right)) {
+        uint32_t a = emit_expr(op->args[0]);
+        uint32_t b = emit_expr(op->args[1]);
+        id = emit(t.is_int() ? OpShiftRightArithmetic : OpShiftRightLogical, spirv_type(t), {a, b});
+    } else if (op->is_intrinsic(Call::abs)) {
+        Type arg_t = op->args[0].type();
+        uint32_t a = emit_expr(op->args[0]);
+        if (arg_t.is_float()) {
+            id = emit_ext(GLSLFAbs, float_type(), {a});
+        } else if (arg_t.is_int()) {
+            id = convert(emit_ext(GLSLSAbs, int_type(), {a}), arg_t, t);
+        } else {
+            id = a;
+        }
+    } else if (op->is_intrinsic(Call::absd)) {
+        Type arg_t = op->args[0].type();
+        uint32_t a = emit_expr(op->args[0]);
+        uint32_t b = emit_expr(op->args[1]);
+        if (arg_t.is_float()) {
+            id = emit_ext(GLSLFAbs, float_type(), {emit(OpFSub, float_type(), {a, b})});
+        } else {
+            // The difference is computed in 32 bits so it can't
+            // overflow the narrow types, and wraps correctly for the
+            // 32-bit ones.
+            uint32_t ty = spirv_type(arg_t);
+            uint32_t less = emit(arg_t.is_int() ? OpSLessThan : OpULessThan, bool_type(), {a, b});
+            uint32_t ba = emit(OpISub, ty, {b, a});
+            uint32_t ab = emit(OpISub, ty, {a, b});
+            uint32_t diff = emit(OpSelect, ty, {less, ba, ab});
+            id = normalize(to_uint(diff, arg_t), t);
+        }
+    } else if (op->is_intrinsic(Call::div_round_to_zero)) {
+        visit_binop(t, op->args[0], op->args[1], OpSDiv, OpUDiv, OpFDiv, true);
+    } else if (op->is_intrinsic(Call::mod_round_to_zero)) {
+        visit_binop(t, op->args[0], op->args[1], OpSRem, OpUMod, OpFMod, true);
+    } else if (op->is_intrinsic(Call::lerp)) {
+        internal_assert(op->args.size() == 3);
+        lower_lerp(op->args[0], op->args[1], op->args[2]).accept(this);
+    } else if (op->is_intrinsic(Call::saturating_add) ||
+               op->is_intrinsic(Call::saturating_sub) ||
+               op->is_intrinsic(Call::rounding_shift_right) ||
+               op->is_intrinsic(Call::saturating_rounding_doubling_high_multiply)) {
+        lower_fixed_point_intrinsic(op).accept(this);
+    } else if (op->is_intrinsic(Call::popcount) ||
+               op->is_intrinsic(Call::count_leading_zeros) ||
+               op->is_intrinsic(Call::count_trailing_zeros)) {
+        Type arg_t = op->args[0].type();
+        int bits = arg_t.bits();
+        uint32_t a = to_uint(emit_expr(op->args[0]), arg_t);
+        a = normalize(a, UInt(bits));
+        uint32_t result;
+        if (op->is_intrinsic(Call::popcount)) {
+            result = emit(OpBitCount, int_type(), {a});
+        } else if (op->is_intrinsic(Call::count_leading_zeros)) {
+            // FindUMsb returns -1 for zero, so this yields bits.
+            uint32_t msb = emit_ext(GLSLFindUMsb, int_type(), {a});
+            result = emit(OpISub, int_type(), {const_int(bits - 1), msb});
+        } else {
+            uint32_t lsb = emit_ext(GLSLFindILsb, int_type(), {a});
+            uint32_t is_zero = emit(OpIEqual, bool_type(), {a, const_uint(0)});
+            result = emit(OpSelect, int_type(), {is_zero, const_int(bits), lsb});
+        }
+        id = convert(result, Int(32), t);
+    } else if (op->is_intrinsic(Call::if_then_else)) {
+        // Only evaluate the side that is taken, as it may contain
+        // loads that are out of bounds otherwise.
+        uint32_t cond = emit_expr(op->args[0]);
+        uint32_t then_label = make_id();
+        uint32_t else_label = make_id();
+        uint32_t merge_label = make_id();
+        emit_void(OpSelectionMerge, {merge_label, 0});
+        emit_void(OpBranchConditional, {cond, then_label, else_label});
+
+        emit_label(then_label);
+        uint32_t then_value = emit_expr(op->args[1]);
+        uint32_t then_end = current_label;
+        emit_void(OpBranch, {merge_label});
+
+        emit_label(else_label);
+        uint32_t else_value = (op->args.size() == 3) ? emit_expr(op->args[2]) : const_of_type(t, 0);
+        uint32_t else_end = current_label;
+        emit_void(OpBranch, {merge_label});
+
+        emit_label(merge_label);
+        id = emit(OpPhi, spirv_type(t), {then_value, then_end, else_value, else_end});
+    } else if (op->is_intrinsic(Call::atomic_update)) {
+        user_error << "Vulkan: atomic() updates are not supported by this backend.\n";
+    } else if (op->is_intrinsic(Call::streaming_store)) {
+        // Only a hint; store normally.
+        internal_assert(op->args.size() == 1);
+        id = emit_expr(op->args[0]);
+    } else if (op->is_intrinsic()) {
+        internal_error << "Vulkan: unhandled intrinsic " << op->name << "\n";
+    } else if (op->name == "is_nan_f32") {
+        id = emit(OpIsNan, bool_type(), {emit_expr(op->args[0])});
+    } else if (op->name == "fast_inverse_f32") {
+        id = emit(OpFDiv, float_type(), {const_float(1.0f), emit_expr(op->args[0])});
+    } else if (op->name == "inf_f32") {
+        id = const_float(std::numeric_limits<float>::infinity());
+    } else if (op->name == "neg_inf_f32") {
+        id = const_float(-std::numeric_limits<float>::infinity());
+    } else if (op->name == "nan_f32") {
+        id = const_float(std::numeric_limits<float>::quiet_NaN());
+    } else {
+        auto it = glsl_math_functions().find(op->name);
+        user_assert(it != glsl_math_functions().end())
+            << "Vulkan: calls to " << op->name << " are not supported inside kernels.\n";
+        vector<uint32_t> args;
+        for (Expr e : op->args) {
+            args.push_back(emit_expr(e));
+        }
+        id = emit_ext(it->second, spirv_type(t), args);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Let *op) {
+    uint32_t value = emit_expr(op->value);
+    symbols.push(op->name, value);
+    op->body.accept(this);
+    symbols.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LetStmt *op) {
+    uint32_t value = emit_expr(op->value);
+    symbols.push(op->name, value);
+    op->body.accept(this);
+    symbols.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const AssertStmt *op) {
+    // Assertions can't be reported from inside a kernel.
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const ProducerConsumer *op) {
+    op->body.accept(this);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const For *op) {
+    if (is_gpu_var(op->name)) {
+        internal_assert((op->for_type == ForType::GPUBlock) ||
+                        (op->for_type == ForType::GPUThread))
+            << "kernel loop must be either gpu block or gpu thread\n";
+        internal_assert(is_zero(op->min));
+
+        uint32_t ids = is_gpu_block_var(op->name) ? group_id : local_id;
+        uint32_t index = emit(OpCompositeExtract, uint_type(), {ids, (uint32_t)gpu_loop_dimension(op->name)});
+        symbols.push(op->name, emit(OpBitcast, int_type(), {index}));
+        op->body.accept(this);
+        symbols.pop(op->name);
+        return;
+    }
+
+    user_assert(op->for_type != ForType::Parallel) << "Cannot use parallel loops inside Vulkan kernels\n";
+    user_assert(op->for_type != ForType::Vectorized) << "Cannot vectorize loops inside Vulkan kernels\n";
+
+    uint32_t min = emit_expr(op->min);
+    uint32_t extent = emit_expr(op->extent);
+    uint32_t end = emit(OpIAdd, int_type(), {min, extent});
+    uint32_t preheader = current_label;
+
+    uint32_t header = make_id();
+    uint32_t body = make_id();
+    uint32_t continue_label = make_id();
+    uint32_t merge = make_id();
+    uint32_t next = make_id();
+
+    emit_void(OpBranch, {header});
+    emit_label(header);
+    uint32_t counter = emit(OpPhi, int_type(), {min, preheader, next, continue_label});
+    uint32_t cond = emit(OpSLessThan, bool_type(), {counter, end});
+    emit_void(OpLoopMerge, {merge, continue_label, 0});
+    emit_void(OpBranchConditional, {cond, body, merge});
+
+    emit_label(body);
+    symbols.push(op->name, counter);
+    op->body.accept(this);
+    symbols.pop(op->name);
+    emit_void(OpBranch, {continue_label});
+
+    emit_label(continue_label);
+    emit_void(OpIAdd, {int_type(), next, counter, const_int(1)});
+    emit_void(OpBranch, {header});
+
+    emit_label(merge);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Provide *op) {
+    internal_error << "Vulkan: Provide node should have been lowered\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Realize *op) {
+    internal_error << "Vulkan: Realize node should have been lowered\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Allocate *op) {
+    if (starts_with(op->name, "__shared_")) {
+        // Shared allocations were already declared at module scope.
+        op->body.accept(this);
+        return;
+    }
+
+    int32_t size = op->constant_allocation_size();
+    user_assert(size > 0) << "Vulkan: allocation " << op->name
+                          << " inside a kernel must have a constant size.\n";
+    uint32_t type = array_type(storage_type(op->type), size);
+    BufferInfo info;
+    info.variable = make_id();
+    info.storage_class = StorageClassFunction;
+    info.type = op->type;
+    info.byte_offset = info.word_offset = 0;
+    append(function_variables, OpVariable,
+           {pointer_type(StorageClassFunction, type), info.variable, StorageClassFunction});
+
+    buffers.push(op->name, info);
+    op->body.accept(this);
+    buffers.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Free *op) {
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Block *op) {
+    op->first.accept(this);
+    if (op->rest.defined()) {
+        op->rest.accept(this);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const IfThenElse *op) {
+    uint32_t cond = emit_expr(op->condition);
+    uint32_t then_label = make_id();
+    uint32_t merge_label = make_id();
+    uint32_t else_label = op->else_case.defined() ? make_id() : merge_label;
+
+    emit_void(OpSelectionMerge, {merge_label, 0});
+    emit_void(OpBranchConditional, {cond, then_label, else_label});
+
+    emit_label(then_label);
+    op->then_case.accept(this);
+    emit_void(OpBranch, {merge_label});
+
+    if (op->else_case.defined()) {
+        emit_label(else_label);
+        op->else_case.accept(this);
+        emit_void(OpBranch, {merge_label});
+    }
+
+    emit_label(merge_label);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Evaluate *op) {
+    if (is_const(op->value)) return;
+    op->value.accept(this);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Prefetch *op) {
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::init_module() {
+    entry_points.clear();
+    execution_modes.clear();
+    annotations.clear();
+    globals.clear();
+    functions.clear();
+    type_ids.clear();
+    constant_ids.clear();
+    next_id = 1;
+
+    glsl_ext = make_id();
+
+    // The ids of the invocation within its workgroup and of the
+    // workgroup, shared by all of the entry points.
+    local_id_var = make_id();
+    append(globals, OpVariable, {pointer_type(StorageClassInput, uvec3_type()), local_id_var, StorageClassInput});
+    append(annotations, OpDecorate, {local_id_var, DecorationBuiltIn, BuiltInLocalInvocationId});
+    group_id_var = make_id();
+    append(globals, OpVariable, {pointer_type(StorageClassInput, uvec3_type()), group_id_var, StorageClassInput});
+    append(annotations, OpDecorate, {group_id_var, DecorationBuiltIn, BuiltInWorkgroupId});
+
+    // The workgroup size is a specialization constant, so that one
+    // module can be specialized by the runtime into pipelines for
+    // any thread counts.
+    uint32_t size[3];
+    for (int i = 0; i < 3; i++) {
+        size[i] = make_id();
+        append(globals, OpSpecConstant, {uint_type(), size[i], 1});
+        append(annotations, OpDecorate, {size[i], DecorationSpecId, (uint32_t)i});
+    }
+    uint32_t workgroup_size = make_id();
+    append(globals, OpSpecConstantComposite, {uvec3_type(), workgroup_size, size[0], size[1], size[2]});
+    append(annotations, OpDecorate, {workgroup_size, DecorationBuiltIn, BuiltInWorkgroupSize});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::add_kernel(Stmt s,
+                                                   const string &name,
+                                                   const vector<DeviceArgument> &args) {
+    debug(2) << "Adding Vulkan kernel " << name << "\n";
+
+    function_variables.clear();
+    function_body.clear();
+
+    uint32_t function = make_id();
+    uint32_t entry = make_id();
+
+    vector<uint32_t> entry_point = {ExecutionModelGLCompute, function};
+    append_string(entry_point, name);
+    entry_point.push_back(local_id_var);
+    entry_point.push_back(group_id_var);
+    append(entry_points, OpEntryPoint, entry_point);
+    append(execution_modes, OpExecutionMode, {function, ExecutionModeLocalSize, 1, 1, 1});
+
+    // Binding 0 holds the scalar arguments, one word each, followed by
+    // the byte offset of each buffer within its binding. Bindings 1
+    // and up are the buffers, in argument order.
+    uint32_t num_scalars = 0, num_buffers = 0;
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            num_buffers++;
+        } else {
+            user_assert(arg.type.bits() <= 32)
+                << "Vulkan: kernel argument " << arg.name << " of type " << arg.type << " is not supported.\n";
+            num_scalars++;
+        }
+    }
+
+    uint32_t args_block = args_block_type(std::max(1u, num_scalars + num_buffers));
+    uint32_t args_var = make_id();
+    append(globals, OpVariable, {pointer_type(StorageClassUniform, args_block), args_var, StorageClassUniform});
+    append(annotations, OpDecorate, {args_var, DecorationDescriptorSet, 0});
+    append(annotations, OpDecorate, {args_var, DecorationBinding, 0});
+
+    local_id = emit(OpLoad, uvec3_type(), {local_id_var});
+    group_id = emit(OpLoad, uvec3_type(), {group_id_var});
+
+    uint32_t uniform_uint_ptr = pointer_type(StorageClassUniform, uint_type());
+    uint32_t scalar_index = 0, buffer_index = 0;
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            BufferInfo info;
+            info.variable = make_id();
+            info.storage_class = StorageClassUniform;
+            info.type = arg.type;
+            append(globals, OpVariable,
+                   {pointer_type(StorageClassUniform, storage_buffer_type()), info.variable, StorageClassUniform});
+            append(annotations, OpDecorate, {info.variable, DecorationDescriptorSet, 0});
+            append(annotations, OpDecorate, {info.variable, DecorationBinding, buffer_index + 1});
+
+            uint32_t offset_ptr = emit(OpAccessChain, uniform_uint_ptr,
+                                       {args_var, const_uint(num_scalars + buffer_index)});
+            info.byte_offset = emit(OpLoad, uint_type(), {offset_ptr});
+            info.word_offset = emit(OpShiftRightLogical, uint_type(), {info.byte_offset, const_uint(2)});
+            buffers.push(arg.name, info);
+            buffer_index++;
+        } else {
+            // The runtime copies the argument into the low bytes of a
+            // zeroed word, so narrow types need to be extended here.
+            uint32_t ptr = emit(OpAccessChain, uniform_uint_ptr, {args_var, const_uint(scalar_index)});
+            uint32_t value = emit(OpLoad, uint_type(), {ptr});
+            if (arg.type.is_int()) {
+                value = normalize(emit(OpBitcast, int_type(), {value}), arg.type);
+            } else {
+                value = from_uint(value, arg.type);
+            }
+            symbols.push(arg.name, value);
+            scalar_index++;
+        }
+    }
+
+    // Declare the shared allocations in the workgroup storage class.
+    FindSharedAllocations fsa;
+    s.accept(&fsa);
+    for (const Allocate *op : fsa.allocs) {
+        user_assert(op->extents.size() == 1 && is_const(op->extents[0]))
+            << "Vulkan: shared allocation " << op->name << " must have a constant size.\n";
+        int32_t size = op->constant_allocation_size();
+        uint32_t type = array_type(storage_type(op->type), size);
+        BufferInfo info;
+        info.variable = make_id();
+        info.storage_class = StorageClassWorkgroup;
+        info.type = op->type;
+        info.byte_offset = info.word_offset = 0;
+        append(globals, OpVariable,
+               {pointer_type(StorageClassWorkgroup, type), info.variable, StorageClassWorkgroup});
+        buffers.push(op->name, info);
+    }
+
+    s.accept(this);
+    emit_void(OpReturn, {});
+
+    for (const Allocate *op : fsa.allocs) {
+        buffers.pop(op->name);
+    }
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            buffers.pop(arg.name);
+        } else {
+            symbols.pop(arg.name);
+        }
+    }
+
+    uint32_t function_type = declare_type("void()", OpTypeFunction, {void_type()});
+    append(functions, OpFunction, {void_type(), function, 0, function_type});
+    append(functions, OpLabel, {entry});
+    functions.insert(functions.end(), function_variables.begin(), function_variables.end());
+    functions.insert(functions.end(), function_body.begin(), function_body.end());
+    append(functions, OpFunctionEnd, {});
+}
+
+vector<uint32_t> CodeGen_Vulkan_Dev::SPIRV_Emitter::assemble() const {
+    vector<uint32_t> module = {MagicNumber, Version_1_0, 0, next_id, 0};
+    vector<uint32_t> preamble;
+    append(preamble, OpCapability, {CapabilityShader});
+    vector<uint32_t> import = {glsl_ext};
+    append_string(import, "GLSL.std.450");
+    append(preamble, OpExtInstImport, import);
+    append(preamble, OpMemoryModel, {AddressingModelLogical, MemoryModelGLSL450});
+
+    const vector<uint32_t> *sections[] = {&preamble, &entry_points, &execution_modes,
+                                          &annotations, &globals, &functions};
+    for (const vector<uint32_t> *section : sections) {
+        module.insert(module.end(), section->begin(), section->end());
+    }
+    return module;
+}
+
+void CodeGen_Vulkan_Dev::add_kernel(Stmt s,
+                                    const string &name,
+                                    const vector<DeviceArgument> &args) {
+    debug(2) << "CodeGen_Vulkan_Dev::compile " << name << "\n";
+
+    cur_kernel_name = name;
+    emitter.add_kernel(s, name, args);
+}
+
+void CodeGen_Vulkan_Dev::init_module() {
+    cur_kernel_name = "";
+    emitter.init_module();
+}
+
+vector<char> CodeGen_Vulkan_Dev::compile_to_src() {
+    vector<uint32_t> words = emitter.assemble();
+    debug(1) << "SPIR-V module: " << words.size() << " words\n";
+    vector<char> buffer(words.size() * sizeof(uint32_t));
+    memcpy(buffer.data(), words.data(), buffer.size());
+    return buffer;
+}
+
+string CodeGen_Vulkan_Dev::get_current_kernel_name() {
+    return cur_kernel_name;
+}
+
+void CodeGen_Vulkan_Dev::dump() {
+    // The module is binary; print it as words for spirv-dis.
+    vector<uint32_t> words = emitter.assemble();
+    for (size_t i = 0; i < words.size(); i++) {
+        std::cerr << std::hex << "0x" << words[i] << std::dec << ((i % 8 == 7) ? ",\n" : ", ");
+    }
+    std::cerr << std::endl;
+}
+
+string CodeGen_Vulkan_Dev::print_gpu_name(const string &name) {
+    return name;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,193 @@
+#ifndef HALIDE_CODEGEN_VULKAN_DEV_H
+#define HALIDE_CODEGEN_VULKAN_DEV_H
+
+/** \file
+ * Defines the code-generator for producing SPIR-V binary modules for
+ * Vulkan compute.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CodeGen_GPU_Dev.h"
+#include "Scope.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+class CodeGen_Vulkan_Dev : public CodeGen_GPU_Dev {
+public:
+    CodeGen_Vulkan_Dev(Target target);
+
+    // CodeGen_GPU_Dev interface
+    void add_kernel(Stmt stmt,
+                    const std::string &name,
+                    const std::vector<DeviceArgument> &args);
+
+    void init_module();
+
+    std::vector<char> compile_to_src();
+
+    std::string get_current_kernel_name();
+
+    void dump();
+
+    virtual std::string print_gpu_name(const std::string &name);
+
+    std::string api_unique_name() { return "vulkan"; }
+
+protected:
+
+    /** Emits a single SPIR-V module holding one GLCompute entry point
+     * per kernel. Values are kept in SSA form; every Halide expression
+     * evaluates to a SPIR-V result id. */
+    class SPIRV_Emitter : public IRVisitor {
+    public:
+        SPIRV_Emitter(Target t) : target(t) {}
+
+        void init_module();
+        void add_kernel(Stmt stmt,
+                        const std::string &name,
+                        const std::vector<DeviceArgument> &args);
+        std::vector<uint32_t> assemble() const;
+
+    protected:
+        using IRVisitor::visit;
+        void visit(const IntImm *);
+        void visit(const UIntImm *);
+        void visit(const FloatImm *);
+        void visit(const StringImm *);
+        void visit(const Cast *);
+        void visit(const Variable *);
+        void visit(const Add *);
+        void visit(const Sub *);
+        void visit(const Mul *);
+        void visit(const Div *);
+        void visit(const Mod *);
+        void visit(const Min *);
+        void visit(const Max *);
+        void visit(const EQ *);
+        void visit(const NE *);
+        void visit(const LT *);
+        void visit(const LE *);
+        void visit(const GT *);
+        void visit(const GE *);
+        void visit(const And *);
+        void visit(const Or *);
+        void visit(const Not *);
+        void visit(const Select *);
+        void visit(const Load *);
+        void visit(const Ramp *);
+        void visit(const Broadcast *);
+        void visit(const Call *);
+        void visit(const Let *);
+        void visit(const Shuffle *);
+        void visit(const LetStmt *);
+        void visit(const AssertStmt *);
+        void visit(const ProducerConsumer *);
+        void visit(const For *);
+        void visit(const Store *);
+        void visit(const Provide *);
+        void visit(const Allocate *);
+        void visit(const Free *);
+        void visit(const Realize *);
+        void visit(const Block *);
+        void visit(const IfThenElse *);
+        void visit(const Evaluate *);
+        void visit(const Prefetch *);
+
+        /** How a buffer or allocation visible to the kernel is
+         * addressed. Kernel arguments are arrays of 32-bit words in a
+         * storage buffer; allocations are typed arrays. */
+        struct BufferInfo {
+            uint32_t variable;
+            uint32_t storage_class;
+            Type type;
+            // Offsets of the buffer within its binding, in bytes and
+            // in words. Only meaningful for storage buffers.
+            uint32_t byte_offset, word_offset;
+        };
+
+        Target target;
+
+        // The sections of the module, in the order the SPIR-V
+        // specification requires them.
+        std::vector<uint32_t> entry_points, execution_modes, annotations, globals;
+        std::vector<uint32_t> functions;
+
+        // The kernel being emitted. Function-local variables must be
+        // declared in the first block, so they are kept apart from
+        // the rest of the body.
+        std::vector<uint32_t> function_variables, function_body;
+        uint32_t current_label;
+
+        uint32_t next_id;
+        std::map<std::string, uint32_t> type_ids;
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> constant_ids;
+        uint32_t glsl_ext, local_id_var, group_id_var;
+        uint32_t local_id, group_id;
+
+        // The result id of the last expression visited.
+        uint32_t id;
+
+        Scope<uint32_t> symbols;
+        Scope<BufferInfo> buffers;
+
+        uint32_t make_id() { return next_id++; }
+
+        // Appenders for instructions, with or without a result.
+        static void append_string(std::vector<uint32_t> &words, const std::string &str);
+        static void append(std::vector<uint32_t> &section, uint32_t op,
+                    const std::vector<uint32_t> &operands);
+        uint32_t emit(uint32_t op, uint32_t type, const std::vector<uint32_t> &operands);
+        void emit_void(uint32_t op, const std::vector<uint32_t> &operands);
+        uint32_t emit_ext(uint32_t inst, uint32_t type, const std::vector<uint32_t> &operands);
+        void emit_label(uint32_t label);
+
+        // Deduplicated type and constant declarations.
+        uint32_t declare_type(const std::string &key, uint32_t op,
+                              const std::vector<uint32_t> &operands);
+        uint32_t void_type();
+        uint32_t bool_type();
+        uint32_t int_type();
+        uint32_t uint_type();
+        uint32_t float_type();
+        uint32_t uvec3_type();
+        uint32_t pointer_type(uint32_t storage_class, uint32_t pointee);
+        uint32_t array_type(uint32_t element, uint32_t size);
+        uint32_t storage_buffer_type();
+        uint32_t args_block_type(uint32_t members);
+        uint32_t spirv_type(Type t);
+        uint32_t storage_type(Type t);
+        uint32_t constant(uint32_t type, uint32_t bits);
+        uint32_t const_uint(uint32_t value);
+        uint32_t const_int(int32_t value);
+        uint32_t const_float(float value);
+        uint32_t const_bool(bool value);
+        uint32_t const_of_type(Type t, int64_t value);
+
+        // Expression helpers.
+        uint32_t emit_expr(Expr e);
+        uint32_t normalize(uint32_t value, Type t);
+        uint32_t to_uint(uint32_t value, Type t);
+        uint32_t from_uint(uint32_t value, Type t);
+        uint32_t convert(uint32_t value, Type from, Type to);
+        void visit_binop(Type t, Expr a, Expr b,
+                         uint32_t int_op, uint32_t uint_op, uint32_t float_op,
+                         bool needs_normalize);
+        void visit_cmp(Expr a, Expr b, uint32_t int_op, uint32_t uint_op,
+                       uint32_t float_op, uint32_t bool_op);
+        void visit_minmax(Type t, Expr a, Expr b, uint32_t sop, uint32_t uop, uint32_t fop);
+        uint32_t element_pointer(const BufferInfo &info, uint32_t index, uint32_t *shift);
+    };
+
+    std::string cur_kernel_name;
+    SPIRV_Emitter emitter;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
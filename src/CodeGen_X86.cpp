@@ -63,10 +63,79 @@ bool should_use_pmaddwd(Expr a, Expr b, vector<Expr> &result) {
 }
 
 
+bool CodeGen_X86::codegen_dot_product(const Add *op) {
+#if LLVM_VERSION >= 70
+    const int lanes = op->type.lanes();
+    if (!target.has_feature(Target::AVX512_VNNI) ||
+        op->type.element_of() != Int(32) || lanes % 4 != 0) {
+        return false;
+    }
+
+    // vpdpbusd adds four u8 x i8 products to each lane, and vpdpwssd
+    // adds two i16 x i16 products. The operands are interleaved so
+    // that each 32-bit lane holds the values for its products.
+    struct DotProduct {
+        int factor;
+        Type a, b;
+        const char *intrin;
+    };
+    const DotProduct dot_products[] = {
+        {4, UInt(8, lanes), Int(8, lanes), "vpdpbusd"},
+        {2, Int(16, lanes), Int(16, lanes), "vpdpwssd"},
+    };
+    for (const DotProduct &d : dot_products) {
+        vector<Expr> as, bs, products, rest;
+        find_widening_products(op, d.a, d.b, as, bs, products, rest);
+        int groups = (int)products.size() / d.factor;
+        if (groups == 0 ||
+            (d.factor == 2 && products.size() == 2 && rest.empty())) {
+            // A sum of just two products is better off with pmaddwd.
+            continue;
+        }
+
+        // Everything else, including any leftover products, is the
+        // accumulator the dot products get added to.
+        for (size_t i = groups * d.factor; i < products.size(); i++) {
+            rest.push_back(products[i]);
+        }
+        Expr init = make_zero(op->type);
+        for (size_t i = 0; i < rest.size(); i++) {
+            init = (i == 0) ? rest[i] : init + rest[i];
+        }
+        Value *acc = codegen(init);
+
+        int intrin_lanes = (lanes % 16 == 0) ? 16 : (lanes % 8 == 0) ? 8 : 4;
+        string name = "llvm.x86.avx512." + string(d.intrin) + "." + std::to_string(intrin_lanes * 32);
+        llvm::Type *slice_t = VectorType::get(i32_t, intrin_lanes);
+        for (int g = 0; g < groups; g++) {
+            vector<Expr> group_a(as.begin() + g * d.factor, as.begin() + (g + 1) * d.factor);
+            vector<Expr> group_b(bs.begin() + g * d.factor, bs.begin() + (g + 1) * d.factor);
+            Value *a = codegen(Shuffle::make_interleave(group_a));
+            Value *b = codegen(Shuffle::make_interleave(group_b));
+            vector<Value *> results;
+            for (int i = 0; i < lanes; i += intrin_lanes) {
+                Value *a_slice = slice_vector(a, i * d.factor, intrin_lanes * d.factor);
+                Value *b_slice = slice_vector(b, i * d.factor, intrin_lanes * d.factor);
+                results.push_back(call_intrin(slice_t, intrin_lanes, name,
+                                              {slice_vector(acc, i, intrin_lanes),
+                                               builder->CreateBitCast(a_slice, slice_t),
+                                               builder->CreateBitCast(b_slice, slice_t)}));
+            }
+            acc = concat_vectors(results);
+        }
+        value = acc;
+        return true;
+    }
+#endif
+    return false;
+}
+
 void CodeGen_X86::visit(const Add *op) {
     vector<Expr> matches;
     if (should_use_pmaddwd(op->a, op->b, matches)) {
         codegen(Call::make(op->type, "pmaddwd", matches, Call::Extern));
+    } else if (codegen_dot_product(op)) {
+        // value was set by codegen_dot_product
     } else {
         CodeGen_Posix::visit(op);
     }
@@ -199,6 +268,76 @@ void CodeGen_X86::visit(const Select *op) {
     }
 }
 
+bool CodeGen_X86::should_use_gather_scatter(Type t, bool scatter) const {
+    // There are only gathers and scatters of 32 and 64-bit elements.
+    if (t.is_handle() || (t.bits() != 32 && t.bits() != 64)) {
+        return false;
+    }
+
+    bool avx512 = (target.has_feature(Target::AVX512) ||
+                   target.has_feature(Target::AVX512_KNL) ||
+                   target.has_feature(Target::AVX512_Skylake) ||
+                   target.has_feature(Target::AVX512_Cannonlake) ||
+                   target.has_feature(Target::AVX512_VNNI));
+
+    if (avx512) {
+        // AVX-512 gathers and scatters beat extracting each index and
+        // inserting each value once there are at least four lanes.
+        return t.lanes() >= 4;
+    } else if (scatter) {
+        // Scatters are new in AVX-512.
+        return false;
+    } else if (target.has_feature(Target::AVX2)) {
+        // AVX2 gathers are slow enough that they only pay for
+        // themselves when they fill a whole ymm register of 32-bit
+        // values.
+        return t.bits() == 32 && t.lanes() >= 8;
+    } else {
+        return false;
+    }
+}
+
+void CodeGen_X86::visit(const Load *op) {
+    if (op->type.is_scalar() ||
+        op->index.as<Ramp>() ||
+        !should_use_gather_scatter(op->type, false)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    // A data-dependent load. Compute a vector of pointers, and use a
+    // masked gather, which llvm turns into vpgather/vgather on these
+    // targets.
+    Value *base = codegen_buffer_pointer(op->name, op->type.element_of(), ConstantInt::get(i32_t, 0));
+    Value *ptrs = builder->CreateInBoundsGEP(base, codegen(op->index));
+    Value *mask = is_one(op->predicate) ? nullptr : codegen(op->predicate);
+    Instruction *gather = builder->CreateMaskedGather(ptrs, op->type.bytes(), mask);
+    add_tbaa_metadata(gather, op->name, op->index);
+    value = gather;
+}
+
+void CodeGen_X86::visit(const Store *op) {
+    const Call *call = op->value.as<Call>();
+    if (op->value.type().is_scalar() ||
+        op->index.as<Ramp>() ||
+        op->index.as<Let>() ||
+        (call && call->is_intrinsic(Call::atomic_update)) ||
+        !should_use_gather_scatter(op->value.type(), true)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    // A data-dependent store. Lanes that store to the same address
+    // are written in order, so the last one wins, as it would if we
+    // stored them one at a time.
+    Value *val = codegen(op->value);
+    Value *base = codegen_buffer_pointer(op->name, op->value.type().element_of(), ConstantInt::get(i32_t, 0));
+    Value *ptrs = builder->CreateInBoundsGEP(base, codegen(op->index));
+    Value *mask = is_one(op->predicate) ? nullptr : codegen(op->predicate);
+    Instruction *scatter = builder->CreateMaskedScatter(val, ptrs, op->value.type().bytes(), mask);
+    add_tbaa_metadata(scatter, op->name, op->index);
+}
+
 void CodeGen_X86::visit(const Cast *op) {
 
     if (!op->type.is_vector()) {
@@ -398,7 +537,8 @@ Expr CodeGen_X86::mulhi_shr(Expr a, Expr b, int shr) {
 
 string CodeGen_X86::mcpu() const {
     if (target.has_feature(Target::AVX512_Cannonlake)) return "cannonlake";
-    if (target.has_feature(Target::AVX512_Skylake)) return "skylake-avx512";
+    if (target.has_feature(Target::AVX512_Skylake) ||
+        target.has_feature(Target::AVX512_VNNI)) return "skylake-avx512";
     if (target.has_feature(Target::AVX512_KNL)) return "knl";
     if (target.has_feature(Target::AVX2)) return "haswell";
     if (target.has_feature(Target::AVX)) return "corei7-avx";
@@ -426,19 +566,24 @@ string CodeGen_X86::mattrs() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_KNL) ||
         target.has_feature(Target::AVX512_Skylake) ||
-        target.has_feature(Target::AVX512_Cannonlake)) {
+        target.has_feature(Target::AVX512_Cannonlake) ||
+        target.has_feature(Target::AVX512_VNNI)) {
         features += separator + "+avx512f,+avx512cd";
         separator = ",";
         if (target.has_feature(Target::AVX512_KNL)) {
             features += ",+avx512pf,+avx512er";
         }
         if (target.has_feature(Target::AVX512_Skylake) ||
-            target.has_feature(Target::AVX512_Cannonlake)) {
+            target.has_feature(Target::AVX512_Cannonlake) ||
+            target.has_feature(Target::AVX512_VNNI)) {
             features += ",+avx512vl,+avx512bw,+avx512dq";
         }
         if (target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512ifma,+avx512vbmi";
         }
+        if (target.has_feature(Target::AVX512_VNNI)) {
+            features += ",+avx512vnni";
+        }
     }
     return features;
 }
@@ -451,8 +596,9 @@ int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
         target.has_feature(Target::AVX512_KNL) ||
-        target.has_feature(Target::AVX512_Cannonlake)) {
-        return 512;
+        target.has_feature(Target::AVX512_Cannonlake) ||
+        target.has_feature(Target::AVX512_VNNI)) {
+        return target.has_feature(Target::AVX512_256) ? 256 : 512;
     } else if (target.has_feature(Target::AVX) ||
                target.has_feature(Target::AVX2)) {
         return 256;
@@ -30,6 +30,16 @@ protected:
 
     Expr mulhi_shr(Expr a, Expr b, int shr);
 
+    /** Emit a sum of widening multiplies with the AVX512-VNNI dot
+     * product instructions. Returns false if the target doesn't have
+     * them or the sum doesn't fit. */
+    bool codegen_dot_product(const Add *);
+
+    /** Check if a gather (or scatter) of the given type is better done
+     * with the AVX2/AVX-512 gather and scatter instructions than
+     * one lane at a time. */
+    bool should_use_gather_scatter(Type t, bool scatter) const;
+
     using CodeGen_Posix::visit;
 
     /** Nodes for which we want to emit specific sse/avx intrinsics */
@@ -44,6 +54,8 @@ protected:
     void visit(const EQ *);
     void visit(const NE *);
     void visit(const Select *);
+    void visit(const Load *);
+    void visit(const Store *);
     // @}
 };
 
@@ -0,0 +1,215 @@
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include "CompileTrace.h"
+#include "Debug.h"
+#include "Error.h"
+#include "IRVisitor.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+typedef std::chrono::high_resolution_clock clock;
+
+struct TraceEvent {
+    string name, category;
+    double start_us, duration_us;
+    size_t thread;
+    int64_t ir_nodes;
+    CompilerMemoryUsage memory;
+};
+
+double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// All of the events recorded by this process. They are written out
+// when it exits.
+class CompileTrace {
+    std::mutex mutex;
+    vector<TraceEvent> events;
+    clock::time_point origin;
+
+    static string escape(const string &s) {
+        string result;
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            } else if (c == '\n') {
+                // Drop the newlines at the end of the lowering
+                // messages.
+            } else {
+                result += c;
+            }
+        }
+        return result;
+    }
+
+public:
+    const string file_name;
+
+    CompileTrace() : origin(clock::now()), file_name(get_env_variable("HL_COMPILE_TRACE")) {}
+
+    ~CompileTrace() {
+        if (file_name.empty()) {
+            return;
+        }
+        std::ofstream f(file_name);
+        if (!f.is_open()) {
+            debug(0) << "Could not open " << file_name << " to write the compile trace\n";
+            return;
+        }
+        f << "{\"traceEvents\": [\n";
+        for (size_t i = 0; i < events.size(); i++) {
+            const TraceEvent &e = events[i];
+            f << "  {\"name\": \"" << escape(e.name) << "\", "
+              << "\"cat\": \"" << escape(e.category) << "\", "
+              << "\"ph\": \"X\", "
+              << "\"ts\": " << e.start_us << ", "
+              << "\"dur\": " << e.duration_us << ", "
+              << "\"pid\": 0, "
+              << "\"tid\": " << e.thread << ", "
+              << "\"args\": {";
+            if (e.ir_nodes >= 0) {
+                f << "\"ir_nodes\": " << e.ir_nodes << ", ";
+            }
+            f << "\"resident_mb\": " << megabytes(e.memory.resident_bytes) << ", "
+              << "\"peak_mb\": " << megabytes(e.memory.peak_bytes) << "}";
+            f << "}" << (i + 1 < events.size() ? "," : "") << "\n";
+        }
+        f << "]}\n";
+    }
+
+    void record(const string &name, const string &category,
+                clock::time_point start, clock::time_point end, int64_t ir_nodes) {
+        TraceEvent e;
+        e.name = name;
+        e.category = category;
+        e.start_us = std::chrono::duration<double, std::micro>(start - origin).count();
+        e.duration_us = std::chrono::duration<double, std::micro>(end - start).count();
+        e.thread = std::hash<std::thread::id>()(std::this_thread::get_id()) % 1000000;
+        e.ir_nodes = ir_nodes;
+        e.memory = compiler_memory_usage();
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(e);
+    }
+};
+
+CompileTrace &compile_trace() {
+    static CompileTrace trace;
+    return trace;
+}
+
+class CountNodes : public IRGraphVisitor {
+    std::set<const IRNode *> seen;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            s.accept(this);
+        }
+    }
+
+public:
+    int64_t count(const Stmt &s) {
+        include(s);
+        return (int64_t)seen.size();
+    }
+};
+
+}  // namespace
+
+bool compile_trace_enabled() {
+    return !compile_trace().file_name.empty();
+}
+
+CompilerMemoryUsage compiler_memory_usage() {
+    CompilerMemoryUsage usage = {0, 0};
+#ifndef _WIN32
+    struct rusage r;
+    if (getrusage(RUSAGE_SELF, &r) == 0) {
+#ifdef __APPLE__
+        usage.peak_bytes = (uint64_t)r.ru_maxrss;
+#else
+        usage.peak_bytes = (uint64_t)r.ru_maxrss * 1024;
+#endif
+    }
+#endif
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    uint64_t total_pages = 0, resident_pages = 0;
+    if (statm >> total_pages >> resident_pages) {
+        usage.resident_bytes = resident_pages * (uint64_t)sysconf(_SC_PAGESIZE);
+    }
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) {
+        usage.resident_bytes = info.resident_size;
+    }
+#endif
+    return usage;
+}
+
+void check_compiler_memory_limit(const string &phase) {
+    static const uint64_t limit_mb = []() -> uint64_t {
+        string limit = get_env_variable("HL_COMPILER_MEMORY_LIMIT");
+        return limit.empty() ? 0 : std::strtoull(limit.c_str(), nullptr, 10);
+    }();
+    if (limit_mb == 0) {
+        return;
+    }
+    CompilerMemoryUsage usage = compiler_memory_usage();
+    user_assert(usage.resident_bytes <= limit_mb * 1024 * 1024)
+        << "The compiler is using " << (uint64_t)megabytes(usage.resident_bytes)
+        << " MB after " << phase << ", which exceeds HL_COMPILER_MEMORY_LIMIT="
+        << limit_mb << "\n";
+}
+
+int64_t count_ir_nodes(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    return CountNodes().count(s);
+}
+
+CompileTraceEvent::CompileTraceEvent(const string &n, const string &c) :
+    name(n), category(c), ir_nodes(-1) {
+    if (compile_trace_enabled()) {
+        start = clock::now();
+    }
+}
+
+CompileTraceEvent::~CompileTraceEvent() {
+    if (compile_trace_enabled()) {
+        compile_trace().record(name, category, start, clock::now(), ir_nodes);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,71 @@
+#ifndef HALIDE_COMPILE_TRACE_H
+#define HALIDE_COMPILE_TRACE_H
+
+/** \file
+ * Defines tools for recording where the time goes when compiling a
+ * pipeline. To turn them on, set the environment variable
+ * HL_COMPILE_TRACE to the name of a file. The wall-clock time of each
+ * lowering pass, and the number of IR nodes after it, is recorded
+ * along with the time spent generating, optimizing and emitting LLVM
+ * IR. The trace of every pipeline compiled by the process is written
+ * to the file on exit, in the Chrome trace event format, which can be
+ * viewed with chrome://tracing or Perfetto. This also turns on LLVM's
+ * per-pass timing report (the equivalent of -time-passes), which LLVM
+ * prints to stderr.
+ *
+ * Each event also records the resident memory of the process when it
+ * ends, and the most it had used by then, so the trace shows which
+ * phase of compilation drives the peak. Setting HL_COMPILER_MEMORY_LIMIT
+ * to a number of megabytes makes lowering stop with an error, naming
+ * the pass responsible, as soon as the resident memory exceeds it.
+ */
+
+#include <chrono>
+#include <string>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Whether HL_COMPILE_TRACE is set. */
+bool compile_trace_enabled();
+
+/** The resident memory of the process, and the most it has used so
+ * far, in bytes. Either is zero on platforms where it can't be
+ * measured. */
+struct CompilerMemoryUsage {
+    uint64_t resident_bytes, peak_bytes;
+};
+CompilerMemoryUsage compiler_memory_usage();
+
+/** If HL_COMPILER_MEMORY_LIMIT is set, throw a user error if the
+ * resident memory of the process exceeds that many megabytes. The
+ * phase is the name of the step of compilation that just finished. */
+void check_compiler_memory_limit(const std::string &phase);
+
+/** Count the distinct IR nodes in a statement. */
+int64_t count_ir_nodes(const Stmt &s);
+
+/** Records the time between its construction and destruction as an
+ * event in the compile trace, if it is enabled. */
+class CompileTraceEvent {
+    std::string name, category;
+    std::chrono::high_resolution_clock::time_point start;
+    int64_t ir_nodes;
+
+public:
+    CompileTraceEvent(const std::string &name, const std::string &category);
+    ~CompileTraceEvent();
+
+    CompileTraceEvent(const CompileTraceEvent &) = delete;
+    CompileTraceEvent &operator=(const CompileTraceEvent &) = delete;
+
+    /** Record the number of IR nodes in the result of this event. */
+    void set_ir_nodes(int64_t n) { ir_nodes = n; }
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -6,6 +6,8 @@
  */
 
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <stdlib.h>
 #include <string>
 
@@ -46,18 +48,32 @@ std::ostream &operator<<(std::ostream &, const LoweredFunc &);
  * tracing everything that occurs. The verbosity with which to print
  * is determined by the value of the environment variable
  * HL_DEBUG_CODEGEN
+ *
+ * The output of each statement is gathered up and written to stderr
+ * in one piece, so that statements from pipelines being compiled on
+ * different threads don't get interleaved.
  */
 
 class debug {
     const bool logging;
+    std::unique_ptr<std::ostringstream> buffer;
 
 public:
     debug(int verbosity) : logging(verbosity <= debug_level()) {}
 
+    ~debug() {
+        if (buffer) {
+            std::cerr << buffer->str();
+        }
+    }
+
     template<typename T>
     debug &operator<<(T&& x) {
         if (logging) {
-            std::cerr << std::forward<T>(x);
+            if (!buffer) {
+                buffer.reset(new std::ostringstream);
+            }
+            *buffer << std::forward<T>(x);
         }
         return *this;
     }
@@ -58,6 +58,8 @@ const halide_device_interface_t *get_device_interface_for_device_api(DeviceAPI d
         name = "opengl";
     } else if (d == DeviceAPI::D3D12Compute) {
         name = "d3d12compute";
+    } else if (d == DeviceAPI::Vulkan) {
+        name = "vulkan";
     } else {
         if (error_site) {
             user_error << "get_device_interface_for_device_api called from " << error_site <<
@@ -98,6 +100,8 @@ DeviceAPI get_default_device_api_for_target(const Target &target) {
         return DeviceAPI::GLSL;
     } else if (target.has_feature(Target::D3D12Compute)) {
         return DeviceAPI::D3D12Compute;
+    } else if (target.has_feature(Target::Vulkan)) {
+        return DeviceAPI::Vulkan;
     } else {
         return DeviceAPI::Host;
     }
@@ -132,6 +136,9 @@ Expr make_device_interface_call(DeviceAPI device_api) {
     case DeviceAPI::D3D12Compute:
         interface_name = "halide_d3d12compute_device_interface";
         break;
+    case DeviceAPI::Vulkan:
+        interface_name = "halide_vulkan_device_interface";
+        break;
     case DeviceAPI::Default_GPU:
         // Will be resolved later
         interface_name = "halide_default_device_interface";
@@ -0,0 +1,74 @@
+#include "DistributeGPUs.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+class DistributeGPULoops : public IRMutator2 {
+    const map<string, Expr> &num_devices;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        Stmt stmt = IRMutator2::visit(op);
+        auto it = num_devices.find(op->name);
+        if (it == num_devices.end()) {
+            return stmt;
+        }
+        op = stmt.as<For>();
+        internal_assert(op);
+
+        // Iterations go to the devices round-robin.
+        Expr loop_var = Variable::make(Int(32), op->name);
+        Expr device = (loop_var - op->min) % max(it->second, 1);
+        string previous_name = op->name + ".previous_gpu_device";
+        Expr previous = Variable::make(Int(32), previous_name);
+
+        // The destructor puts back whatever device the thread used
+        // before, offset by two so that -1 (none) is a valid object.
+        Expr restore = Call::make(Int(32), Call::register_destructor,
+                                  {Expr("halide_set_thread_gpu_device_as_destructor"),
+                                   reinterpret(Handle(), cast<uint64_t>(previous + 2))},
+                                  Call::Intrinsic);
+        Stmt body = Block::make(Evaluate::make(restore), op->body);
+        body = LetStmt::make(previous_name,
+                             Call::make(Int(32), "halide_set_thread_gpu_device", {device}, Call::Extern),
+                             body);
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+public:
+    DistributeGPULoops(const map<string, Expr> &n) : num_devices(n) {}
+};
+
+}  // namespace
+
+Stmt distribute_gpus(const Stmt &s, const map<string, Function> &env) {
+    map<string, Expr> num_devices;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        for (int stage = 0; stage <= (int)f.updates().size(); stage++) {
+            const Definition &def = (stage == 0) ? f.definition() : f.update(stage - 1);
+            if (!def.defined()) {
+                continue;
+            }
+            string prefix = f.name() + ".s" + std::to_string(stage) + ".";
+            for (const GPUDistribution &d : def.schedule().gpu_distributions()) {
+                num_devices[prefix + d.var] = d.num_devices;
+            }
+        }
+    }
+    if (num_devices.empty()) {
+        return s;
+    }
+    return DistributeGPULoops(num_devices).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,26 @@
+#ifndef HALIDE_DISTRIBUTE_GPUS_H
+#define HALIDE_DISTRIBUTE_GPUS_H
+
+/** \file
+ * Defines the lowering pass that spreads the iterations of loops
+ * scheduled with distribute_gpus over several GPU devices.
+ */
+
+#include <map>
+#include <string>
+
+#include "Function.h"
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make each iteration of the loops marked with
+ * Stage::distribute_gpus select its GPU device for the thread it
+ * runs on, and restore the previous selection when it finishes. */
+Stmt distribute_gpus(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -73,6 +73,13 @@ private:
         }
     }
 
+    void visit(const Fork *op) {
+        // The two sides of a fork run concurrently, so freeing after
+        // the last use on one side may be too soon for the other.
+        ScopedValue<bool> old_in_loop(in_loop, true);
+        IRVisitor::visit(op);
+    }
+
     void visit(const Block *block) {
         if (in_loop) {
             IRVisitor::visit(block);
@@ -0,0 +1,306 @@
+#include "EmulateFloat16Math.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+#include <cmath>
+
+namespace Halide {
+namespace Internal {
+
+Expr bfloat16_to_float32(Expr bits) {
+    const int lanes = bits.type().lanes();
+    internal_assert(bits.type() == UInt(16, lanes));
+    Expr wide = cast(UInt(32, lanes), std::move(bits)) << 16;
+    return reinterpret(Float(32, lanes), wide);
+}
+
+Expr float32_to_bfloat16(Expr f) {
+    const int lanes = f.type().lanes();
+    internal_assert(f.type() == Float(32, lanes));
+    Type u32 = UInt(32, lanes);
+    Expr bits = Variable::make(u32, unique_name("bf16_bits"));
+    // Add just under half of the discarded bits, plus one more if
+    // the result would otherwise be odd, to round to nearest with
+    // ties going to even.
+    Expr rounded = (bits + (make_const(u32, 0x7fff) + ((bits >> 16) & 1))) >> 16;
+    // Rounding the mantissa of a nan could carry into the exponent
+    // and make an infinity, so quiet it instead.
+    Expr nan = (bits & 0x7fffffff) > 0x7f800000;
+    Expr result = cast(UInt(16, lanes), select(nan, (bits >> 16) | 0x40, rounded));
+    return Let::make(bits.as<Variable>()->name, reinterpret(u32, std::move(f)), result);
+}
+
+Expr float16_to_float32(Expr bits) {
+    const int lanes = bits.type().lanes();
+    internal_assert(bits.type() == UInt(16, lanes));
+    Type u32 = UInt(32, lanes), f32 = Float(32, lanes);
+    Expr h = Variable::make(u32, unique_name("f16_bits"));
+    Expr magnitude = h & 0x7fff;
+    // Move the exponent and mantissa into place, then fix the
+    // exponent bias with a multiply, which also normalizes
+    // denormals.
+    Expr scaled = reinterpret(f32, magnitude << 13) * make_const(f32, std::ldexp(1.0, 112));
+    Expr scaled_bits = reinterpret(u32, scaled);
+    // Infinities and nans need all of the exponent bits set.
+    scaled_bits = select(magnitude >= 0x7c00, scaled_bits | 0x7f800000, scaled_bits);
+    Expr result = reinterpret(f32, scaled_bits | ((h & 0x8000) << 16));
+    return Let::make(h.as<Variable>()->name, cast(u32, std::move(bits)), result);
+}
+
+Expr float32_to_float16(Expr f, bool fast) {
+    const int lanes = f.type().lanes();
+    internal_assert(f.type() == Float(32, lanes));
+    Type u32 = UInt(32, lanes), f32 = Float(32, lanes);
+    Expr x = Variable::make(u32, unique_name("f32_bits"));
+    Expr a = Variable::make(u32, unique_name("f32_abs_bits"));
+
+    // Values too large for a half become infinity, or a quiet nan.
+    Expr overflow = select(a > 0x7f800000, make_const(u32, 0x7e00), make_const(u32, 0x7c00));
+    Expr too_large = a >= 0x47800000;
+    // Values too small to be normal halfs.
+    Expr too_small = a < 0x38800000;
+
+    Expr denormal, normal;
+    if (fast) {
+        denormal = make_const(u32, 0);
+        normal = (a - 0x38000000) >> 13;
+    } else {
+        // Adding 0.5 shifts the denormal mantissa to the bottom of
+        // the word, letting the float adder do the rounding.
+        denormal = reinterpret(u32, reinterpret(f32, a) + 0.5f) - 0x3f000000;
+        // Rebias the exponent, then add just under half of the
+        // discarded bits, plus one more if the result would
+        // otherwise be odd, to round to nearest with ties to even.
+        Expr odd = (a >> 13) & 1;
+        normal = ((a - 0x38000000) + (make_const(u32, 0xfff) + odd)) >> 13;
+    }
+
+    Expr result = select(too_large, overflow, select(too_small, denormal, normal));
+    result = cast(UInt(16, lanes), result | ((x >> 16) & 0x8000));
+    result = Let::make(a.as<Variable>()->name, x & 0x7fffffff, result);
+    return Let::make(x.as<Variable>()->name, reinterpret(u32, std::move(f)), result);
+}
+
+namespace {
+
+bool is_float16(const Type &t) {
+    return t.is_float() && !t.is_bfloat() && t.bits() == 16;
+}
+
+class EmulateFloat16Math : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // Whether Float(16) values on the host are stored as their bits
+    // and converted in software.
+    bool float16_as_bits;
+    // Whether the host can do arithmetic on Float(16) natively.
+    bool float16_native_math;
+    bool fast_conversions;
+    bool in_device_code = false;
+
+    // Whether values of this type are replaced with their bits.
+    bool emulated(const Type &t) const {
+        return t.is_bfloat() || (is_float16(t) && float16_as_bits && !in_device_code);
+    }
+
+    // Whether arithmetic on values of this type is done in float.
+    bool widened_math(const Type &t) const {
+        return emulated(t) || (is_float16(t) && !float16_native_math && !in_device_code);
+    }
+
+    Type storage_type(const Type &t) const {
+        return emulated(t) ? t.with_code(Type::UInt) : t;
+    }
+
+    // Convert a 16-bit float Expr to float.
+    Expr widen(const Expr &e) {
+        const Type &t = e.type();
+        Expr value = mutate(e);
+        if (t.is_bfloat()) {
+            return bfloat16_to_float32(value);
+        } else if (emulated(t)) {
+            return float16_to_float32(value);
+        } else {
+            return Cast::make(Float(32, t.lanes()), value);
+        }
+    }
+
+    // Convert a float Expr to a 16-bit float type.
+    Expr narrow(const Expr &f, const Type &t) {
+        if (t.is_bfloat()) {
+            return float32_to_bfloat16(f);
+        } else if (emulated(t)) {
+            return float32_to_float16(f, fast_conversions);
+        } else {
+            return Cast::make(t, f);
+        }
+    }
+
+    template<typename T>
+    Expr visit_arith(const T *op) {
+        if (!widened_math(op->type)) {
+            return IRMutator2::visit(op);
+        }
+        return narrow(T::make(widen(op->a), widen(op->b)), op->type);
+    }
+
+    template<typename T>
+    Expr visit_cmp(const T *op) {
+        if (!widened_math(op->a.type())) {
+            return IRMutator2::visit(op);
+        }
+        return T::make(widen(op->a), widen(op->b));
+    }
+
+    Expr visit(const Add *op) override { return visit_arith(op); }
+    Expr visit(const Sub *op) override { return visit_arith(op); }
+    Expr visit(const Mul *op) override { return visit_arith(op); }
+    Expr visit(const Div *op) override { return visit_arith(op); }
+    Expr visit(const Mod *op) override { return visit_arith(op); }
+    Expr visit(const Min *op) override { return visit_arith(op); }
+    Expr visit(const Max *op) override { return visit_arith(op); }
+    Expr visit(const EQ *op) override { return visit_cmp(op); }
+    Expr visit(const NE *op) override { return visit_cmp(op); }
+    Expr visit(const LT *op) override { return visit_cmp(op); }
+    Expr visit(const LE *op) override { return visit_cmp(op); }
+    Expr visit(const GT *op) override { return visit_cmp(op); }
+    Expr visit(const GE *op) override { return visit_cmp(op); }
+
+    Expr visit(const FloatImm *op) override {
+        if (op->type.is_bfloat()) {
+            return UIntImm::make(UInt(16), bfloat16_t(op->value).to_bits());
+        } else if (emulated(op->type)) {
+            return UIntImm::make(UInt(16), float16_t(op->value).to_bits());
+        } else {
+            return op;
+        }
+    }
+
+    Expr visit(const Cast *op) override {
+        const Type &from = op->value.type();
+        const Type &to = op->type;
+        const Type f32 = Float(32, to.lanes());
+        if (widened_math(from) && widened_math(to)) {
+            // e.g. bfloat16 <-> float16
+            return narrow(widen(op->value), to);
+        } else if (emulated(to)) {
+            Expr f = mutate(op->value);
+            if (f.type() != f32) {
+                f = Cast::make(f32, f);
+            }
+            return narrow(f, to);
+        } else if (emulated(from)) {
+            Expr f = widen(op->value);
+            return (to == f32) ? f : Cast::make(to, f);
+        } else {
+            // Either no 16-bit floats are involved, or the target
+            // converts them natively.
+            return IRMutator2::visit(op);
+        }
+    }
+
+    Expr visit(const Variable *op) override {
+        if (!emulated(op->type)) {
+            return op;
+        }
+        return Variable::make(storage_type(op->type), op->name, op->image, op->param, op->reduction_domain);
+    }
+
+    Expr visit(const Load *op) override {
+        if (!emulated(op->type)) {
+            return IRMutator2::visit(op);
+        }
+        return Load::make(storage_type(op->type), op->name, mutate(op->index),
+                          op->image, op->param, mutate(op->predicate));
+    }
+
+    Expr visit(const Call *op) override {
+        bool widened_args = false, emulated_args = false;
+        for (const Expr &a : op->args) {
+            widened_args = widened_args || widened_math(a.type());
+            emulated_args = emulated_args || emulated(a.type());
+        }
+
+        if (op->is_intrinsic(Call::reinterpret)) {
+            if (!emulated_args && !emulated(op->type)) {
+                return IRMutator2::visit(op);
+            }
+            // Reinterpreting to or from an emulated type is just a
+            // reinterpret of its bits.
+            Expr bits = mutate(op->args[0]);
+            Type to = storage_type(op->type);
+            return (bits.type() == to) ? bits : reinterpret(to, bits);
+        }
+
+        const std::string suffix = "_f16";
+        if (op->call_type == Call::PureExtern &&
+            ends_with(op->name, suffix) &&
+            (widened_args || widened_math(op->type))) {
+            // Call the float versions of the math library
+            // functions. The 16-bit versions assume IEEE halfs, and
+            // aren't in the runtime anyway.
+            std::vector<Expr> args;
+            for (const Expr &a : op->args) {
+                args.push_back(widened_math(a.type()) ? widen(a) : mutate(a));
+            }
+            std::string name = op->name.substr(0, op->name.size() - suffix.size()) + "_f32";
+            if (widened_math(op->type)) {
+                Expr f = Call::make(Float(32, op->type.lanes()), name, args, op->call_type);
+                return narrow(f, op->type);
+            } else {
+                return Call::make(op->type, name, args, op->call_type);
+            }
+        }
+
+        if (!emulated(op->type)) {
+            return IRMutator2::visit(op);
+        }
+
+        // Anything else (e.g. likely) just moves the bits around.
+        std::vector<Expr> args;
+        for (const Expr &a : op->args) {
+            args.push_back(mutate(a));
+        }
+        return Call::make(storage_type(op->type), op->name, args, op->call_type,
+                          op->func, op->value_index, op->image, op->param);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (!emulated(op->type)) {
+            return IRMutator2::visit(op);
+        }
+        std::vector<Expr> extents;
+        for (const Expr &e : op->extents) {
+            extents.push_back(mutate(e));
+        }
+        Expr new_expr = op->new_expr.defined() ? mutate(op->new_expr) : Expr();
+        return Allocate::make(op->name, storage_type(op->type), op->memory_type, extents,
+                              mutate(op->condition), mutate(op->body),
+                              new_expr, op->free_function);
+    }
+
+    Stmt visit(const For *op) override {
+        bool device_loop = (op->device_api != DeviceAPI::None &&
+                            op->device_api != DeviceAPI::Host);
+        ScopedValue<bool> old_in_device_code(in_device_code, in_device_code || device_loop);
+        return IRMutator2::visit(op);
+    }
+
+public:
+    EmulateFloat16Math(const Target &t) {
+        bool arm64 = t.arch == Target::ARM && t.bits == 64;
+        float16_native_math = arm64 && t.has_feature(Target::ARMFp16);
+        bool native_conversions = arm64 || (t.arch == Target::X86 && t.has_feature(Target::F16C));
+        float16_as_bits = !native_conversions;
+        fast_conversions = t.has_feature(Target::FastFloat16Conversions);
+    }
+};
+
+}  // namespace
+
+Stmt emulate_float16_math(const Stmt &s, const Target &t) {
+    return EmulateFloat16Math(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
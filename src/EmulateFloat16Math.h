@@ -0,0 +1,57 @@
+#ifndef HALIDE_EMULATE_FLOAT16_MATH_H
+#define HALIDE_EMULATE_FLOAT16_MATH_H
+
+/** \file
+ * Defines a lowering pass that moves 16-bit float math into float,
+ * and replaces 16-bit floats with their bits on targets that can't
+ * convert them natively.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Widen the bits of a bfloat16 value (a UInt(16) Expr) to the
+ * float with the same value. */
+Expr bfloat16_to_float32(Expr bits);
+
+/** Round a float to the nearest bfloat16 (ties to even), returning
+ * its bits as a UInt(16) Expr. Nans stay nans. */
+Expr float32_to_bfloat16(Expr f);
+
+/** Widen the bits of an IEEE half (a UInt(16) Expr) to the float
+ * with the same value, using integer and float32 ops only. */
+Expr float16_to_float32(Expr bits);
+
+/** Convert a float to an IEEE half using integer ops only, returning
+ * its bits as a UInt(16) Expr. Rounds to nearest with ties to even,
+ * unless fast is set, in which case it truncates and flushes
+ * denormals to zero. */
+Expr float32_to_float16(Expr f, bool fast = false);
+
+/** Rewrite the 16-bit float math in a Stmt for the given target:
+ *
+ * bfloat16 values are always replaced by UInt(16) values holding
+ * their bits. Loads, stores and data movement become operations on
+ * the bits, and all other operations are computed in float and
+ * rounded back.
+ *
+ * Float(16) arithmetic on the host is computed in float and rounded
+ * back, unless the target has native half arithmetic (ARMFp16 on
+ * 64-bit ARM). This gives the same results, and leaves conversions
+ * as the only half-precision operations. Targets with native
+ * conversions (x86 with F16C, 64-bit ARM) keep them as casts, which
+ * LLVM vectorizes to vcvtph2ps/vcvtps2ph and fcvtl/fcvtn. On all
+ * other targets Float(16) is treated like bfloat16: it is stored as
+ * bits, and converted with vectorizable integer ops instead of
+ * per-element library calls.
+ *
+ * Device code is left alone for Float(16). */
+Stmt emulate_float16_math(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -67,6 +67,7 @@ enum class IRNodeType {
     IfThenElse,
     Evaluate,
     Prefetch,
+    Fork,
 };
 
 /** The abstract base classes for a node in the Halide IR. */
@@ -80,6 +81,16 @@ struct IRNode {
     IRNode(IRNodeType t) : node_type(t) {}
     virtual ~IRNode() {}
 
+    /** IR nodes are small, and lowering creates and destroys a great
+     * many of them, so they come from per-thread pools of fixed-size
+     * blocks instead of the general-purpose heap. Set the environment
+     * variable HL_NO_IR_NODE_POOL to use the heap (e.g. when hunting
+     * for use-after-free bugs with a memory checker). */
+    // @{
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    // @}
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
@@ -248,7 +259,11 @@ struct FloatImm : public ExprNode<FloatImm> {
         node->type = t;
         switch (t.bits()) {
         case 16:
-            node->value = (double)((float16_t)value);
+            if (t.is_bfloat()) {
+                node->value = (double)((bfloat16_t)value);
+            } else {
+                node->value = (double)((float16_t)value);
+            }
             break;
         case 32:
             node->value = (float)value;
@@ -305,6 +320,7 @@ struct Expr : public Internal::IRHandle {
     explicit Expr(uint32_t x)  : IRHandle(Internal::UIntImm::make(UInt(32), x)) {}
     explicit Expr(uint64_t x)  : IRHandle(Internal::UIntImm::make(UInt(64), x)) {}
              Expr(float16_t x) : IRHandle(Internal::FloatImm::make(Float(16), (double)x)) {}
+             Expr(bfloat16_t x) : IRHandle(Internal::FloatImm::make(BFloat(16), (double)x)) {}
              Expr(float x)     : IRHandle(Internal::FloatImm::make(Float(32), x)) {}
     explicit Expr(double x)    : IRHandle(Internal::FloatImm::make(Float(64), x)) {}
     // @}
@@ -346,6 +362,7 @@ enum class DeviceAPI {
     Metal,
     Hexagon,
     D3D12Compute,
+    Vulkan,
 };
 
 /** An array containing all the device apis. Useful for iterating
@@ -359,7 +376,8 @@ const DeviceAPI all_device_apis[] = {DeviceAPI::None,
                                      DeviceAPI::OpenGLCompute,
                                      DeviceAPI::Metal,
                                      DeviceAPI::Hexagon,
-                                     DeviceAPI::D3D12Compute};
+                                     DeviceAPI::D3D12Compute,
+                                     DeviceAPI::Vulkan};
 
 /** An enum describing different address spaces to be used with Func::store_in. */
 enum class MemoryType {
@@ -386,6 +404,14 @@ enum class MemoryType {
      * "local" in OpenCL, and "threadgroup" in metal. Can be shared
      * across GPU threads within the same block. */
     GPUShared,
+
+    /** Vector Tightly Coupled Memory. HVX (Hexagon) local memory
+     * available on v65+. This memory has higher performance and lower
+     * power. Ideal for intermediate buffers. Necessary for vgather and
+     * vscatter operations on Hexagon. If there is not enough VTCM
+     * left, or on older Hexagon versions, allocations not used by a
+     * vgather go on the heap instead. */
+    VTCM,
 };
 
 namespace Internal {
@@ -0,0 +1,113 @@
+#include "FixedPointMath.h"
+#include "CSE.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+Expr lower_saturating_add(const Expr &a, const Expr &b) {
+    Type t = a.type();
+    if (t.bits() < 64) {
+        // Compute the sum in the wider type, where it can't overflow.
+        Type w = t.with_bits(t.bits() * 2);
+        return saturating_cast(t, cast(w, a) + cast(w, b));
+    }
+
+    if (t.is_uint()) {
+        Expr s = a + b;
+        return select(s < a, t.max(), s);
+    }
+
+    // Do the addition in the unsigned type, where overflow is
+    // well-defined. The sum overflowed if a and b have the same sign
+    // and the sum has the other one.
+    Type u = t.with_code(Type::UInt);
+    Expr s = reinterpret(t, reinterpret(u, a) + reinterpret(u, b));
+    Expr overflow = ((a ^ s) & (b ^ s)) < make_zero(t);
+    return select(overflow, select(a < make_zero(t), t.min(), t.max()), s);
+}
+
+Expr lower_saturating_sub(const Expr &a, const Expr &b) {
+    Type t = a.type();
+    if (t.bits() < 64) {
+        // Saturating subtracts always widen to a signed type.
+        Type w = Int(t.bits() * 2, t.lanes());
+        return saturating_cast(t, cast(w, a) - cast(w, b));
+    }
+
+    if (t.is_uint()) {
+        return select(a < b, make_zero(t), a - b);
+    }
+
+    // The difference overflowed if a and b have different signs and
+    // the difference doesn't have the sign of a.
+    Type u = t.with_code(Type::UInt);
+    Expr s = reinterpret(t, reinterpret(u, a) - reinterpret(u, b));
+    Expr overflow = ((a ^ b) & (a ^ s)) < make_zero(t);
+    return select(overflow, select(a < make_zero(t), t.min(), t.max()), s);
+}
+
+Expr lower_rounding_shift_right(const Expr &a, const Expr &b) {
+    // (a + (1 << (b - 1))) >> b without the intermediate overflow:
+    // add the last bit shifted out back in. Bit b - 1 of a is bit b of
+    // a << 1, which also handles b == 0 without a select.
+    Type t = a.type();
+    return (a >> b) + (((a << make_one(t)) >> b) & make_one(t));
+}
+
+Expr lower_saturating_rounding_doubling_high_multiply(const Expr &a, const Expr &b) {
+    // This is the vqrdmulh family of instructions: the high half of
+    // 2 * a * b, rounded to nearest. The only case that saturates is
+    // a == b == t.min().
+    Type t = a.type();
+    Type w = t.with_bits(t.bits() * 2);
+    Expr p = cast(w, a) * cast(w, b);
+    Expr round = make_const(w, (int64_t)1 << (t.bits() - 2));
+    Expr denom = make_const(w, (int64_t)1 << (t.bits() - 1));
+    return saturating_cast(t, (p + round) / denom);
+}
+
+class LowerFixedPointIntrinsics : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Call *op) override {
+        Expr lowered = lower_fixed_point_intrinsic(op);
+        if (lowered.defined()) {
+            return mutate(lowered);
+        }
+        return IRMutator2::visit(op);
+    }
+};
+
+}  // namespace
+
+Expr lower_fixed_point_intrinsic(const Call *op) {
+    Expr result;
+    if (op->is_intrinsic(Call::saturating_add)) {
+        internal_assert(op->args.size() == 2);
+        result = lower_saturating_add(op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::saturating_sub)) {
+        internal_assert(op->args.size() == 2);
+        result = lower_saturating_sub(op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::rounding_shift_right)) {
+        internal_assert(op->args.size() == 2);
+        result = lower_rounding_shift_right(op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::saturating_rounding_doubling_high_multiply)) {
+        internal_assert(op->args.size() == 2);
+        result = lower_saturating_rounding_doubling_high_multiply(op->args[0], op->args[1]);
+    } else {
+        return Expr();
+    }
+    // The expansions above use their arguments more than once.
+    return common_subexpression_elimination(result);
+}
+
+Stmt lower_fixed_point_intrinsics(const Stmt &s) {
+    return LowerFixedPointIntrinsics().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,31 @@
+#ifndef HALIDE_FIXED_POINT_MATH_H
+#define HALIDE_FIXED_POINT_MATH_H
+
+/** \file
+ * Defines methods for converting the fixed-point and saturating
+ * arithmetic intrinsics into portable Halide IR.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** If the call is one of saturating_add, saturating_sub,
+ * rounding_shift_right or saturating_rounding_doubling_high_multiply,
+ * build Halide IR that computes the same thing without the
+ * intrinsic. Otherwise return an undefined Expr. Used by codegen
+ * targets that don't have a native instruction. The result is written
+ * in the widen-compute-narrow form the instruction selectors of the
+ * SIMD backends recognize. */
+Expr lower_fixed_point_intrinsic(const Call *op);
+
+/** Replace all fixed-point intrinsics in a Stmt with their portable
+ * equivalents. Used by backends that pattern match on the IR before
+ * codegen. */
+Stmt lower_fixed_point_intrinsics(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -117,6 +117,58 @@ private:
 
 static_assert(sizeof(float16_t) == 2, "float16_t should occupy two bytes");
 
+/** Class that provides a type that implements brain floating point
+ *  (bfloat16) in software. A bfloat16 is the top half of an IEEE754
+ *  binary32: it has the same range as a float, with only 8 bits of
+ *  precision.
+ *
+ *  Like float16_t, this type maintains no state other than the raw
+ *  bits, so that it can be used as the element type of a buffer.
+ */
+struct bfloat16_t {
+
+    /** Construct from a float, double, or int using
+     * round-to-nearest-ties-to-even. */
+    // @{
+    explicit bfloat16_t(float value);
+    explicit bfloat16_t(double value);
+    explicit bfloat16_t(int value);
+    // @}
+
+    /** Construct a bfloat16_t with the bits initialised to 0. This
+     * represents positive zero. */
+    bfloat16_t();
+
+    /** Cast to float. This is exact. */
+    explicit operator float() const;
+    /** Cast to double. This is exact. */
+    explicit operator double() const;
+
+    bfloat16_t(const bfloat16_t&) = default;
+    bfloat16_t& operator=(const bfloat16_t&) = default;
+
+    /** Get a new bfloat16_t with the given raw bits. */
+    static bfloat16_t make_from_bits(uint16_t bits);
+
+    /** Return a new bfloat16_t with a negated sign bit*/
+    bfloat16_t operator-() const;
+
+    /** Properties */
+    // @{
+    bool is_nan() const;
+    bool is_infinity() const;
+    // @}
+
+    /** Returns the bits that represent this bfloat16_t. */
+    uint16_t to_bits() const;
+
+private:
+    // The raw bits.
+    uint16_t data;
+};
+
+static_assert(sizeof(bfloat16_t) == 2, "bfloat16_t should occupy two bytes");
+
 }  // namespace Halide
 
 template<>
@@ -124,4 +176,9 @@ HALIDE_ALWAYS_INLINE halide_type_t halide_type_of<Halide::float16_t>() {
     return halide_type_t(halide_type_float, 16);
 }
 
+template<>
+HALIDE_ALWAYS_INLINE halide_type_t halide_type_of<Halide::bfloat16_t>() {
+    return halide_type_t(halide_type_bfloat, 16);
+}
+
 #endif
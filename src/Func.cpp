@@ -173,6 +173,16 @@ void Func::define_extern(const std::string &function_name,
                        mangling, device_api, uses_old_buffer_t);
 }
 
+Func &Func::extern_proxy(Expr footprint) {
+    user_assert(is_extern())
+        << "Func " << name() << " is not an extern stage, so it can't have an extern_proxy.\n";
+    user_assert(footprint.defined())
+        << "Undefined Expr passed to extern_proxy of Func " << name() << "\n";
+    func.extern_definition_proxy_expr() = footprint;
+    invalidate_cache();
+    return *this;
+}
+
 /** Get the types of the buffers returned by an extern definition. */
 const std::vector<Type> &Func::output_types() const {
     return func.output_types();
@@ -272,7 +282,62 @@ bool var_name_match(string candidate, string var) {
     if (candidate == var) return true;
     return Internal::ends_with(candidate, "." + var);
 }
-}
+
+// Checks whether every point of an update definition over a
+// SparseRDom writes a distinct site and reads no other. The points of
+// the domain are distinct, so this holds if the left-hand side
+// includes all of their coordinates, and every call the definition
+// makes to the function itself is at the left-hand side.
+class WritesDistinctSites : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->reduction_domain.defined()) {
+            domain = op->reduction_domain;
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->call_type == Call::Halide && op->name == func) {
+            for (size_t i = 0; i < op->args.size() && i < args.size(); i++) {
+                if (!equal(op->args[i], args[i])) {
+                    self_reference_elsewhere = true;
+                }
+            }
+        }
+    }
+
+    const string &func;
+    const vector<Expr> &args;
+    ReductionDomain domain;
+    bool self_reference_elsewhere = false;
+
+public:
+    WritesDistinctSites(const string &f, const Definition &def) :
+        func(f), args(def.args()) {
+        def.accept(this);
+    }
+
+    bool result() const {
+        if (!domain.defined() ||
+            domain.distinct_coordinates().empty() ||
+            self_reference_elsewhere) {
+            return false;
+        }
+        for (const Expr &c : domain.distinct_coordinates()) {
+            bool found = false;
+            for (const Expr &a : args) {
+                found = found || equal(a, c);
+            }
+            if (!found) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+}  // namespace
 
 std::string Stage::name() const {
     std::string stage_name = (stage_index == 0) ?
@@ -294,13 +359,17 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
                 (t == ForType::Vectorized || t == ForType::Parallel ||
                  t == ForType::GPUBlock || t == ForType::GPUThread ||
                  t == ForType::GPULane)) {
-                user_assert(definition.schedule().allow_race_conditions())
+                user_assert(definition.schedule().allow_race_conditions() ||
+                            definition.schedule().atomic() ||
+                            WritesDistinctSites(function.name(), definition).result())
                     << "In schedule for " << name()
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
                     << " condition resulting in incorrect output."
-                    << " It is possible to override this error using"
-                    << " the allow_race_conditions() method. Use this"
+                    << " If the update is a commutative and associative"
+                    << " reduction, such as a histogram, the atomic() method"
+                    << " makes it safe. Otherwise it is possible to override"
+                    << " this error using the allow_race_conditions() method. Use this"
                     << " with great caution, and only when you are willing"
                     << " to accept non-deterministic output, or you can prove"
                     << " that any race conditions in this code do not change"
@@ -891,6 +960,158 @@ Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     return intm;
 }
 
+Func Stage::split_accumulators(RVar r, int k) {
+    user_assert(!definition.is_init())
+        << "split_accumulators() must be called on an update definition\n";
+    user_assert(k >= 2)
+        << "In schedule for " << name()
+        << ", split_accumulators() requires at least two accumulators\n";
+
+    // rfactor() checks this too, but give an error that names the
+    // directive the user actually called.
+    const auto &prover_result = prove_associativity(function.name(), definition.args(), definition.values());
+    user_assert(prover_result.associative())
+        << "Failed to call split_accumulators() on " << name()
+        << " since it can't prove associativity of the operator\n";
+
+    // Lift the inner part of r into a new pure dimension of the
+    // intermediate, so that consecutive iterations of the inner part
+    // update different accumulators.
+    RVar ro(r.name() + "_acc_outer"), ri(r.name() + "_acc_inner");
+    Var u(r.name() + "_acc");
+    split(r, ro, ri, k, TailStrategy::GuardWithIf);
+    Func intm = rfactor(ri, u);
+    intm.unroll(u);
+    intm.update(0).unroll(u);
+
+    // Place the accumulators as close to their use as possible, but
+    // outside of any vectorized loop. The dims list always ends with
+    // the pure outermost dim, so this always finds somewhere.
+    const vector<Dim> &dims = definition.schedule().dims();
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (dims[i].is_pure() && dims[i].for_type != ForType::Vectorized) {
+            intm.compute_at(LoopLevel(function, Var(dims[i].var), (int)stage_index));
+            break;
+        }
+    }
+    return intm;
+}
+
+Func Stage::register_tile(VarOrRVar x, VarOrRVar y, int xs, int ys) {
+    user_assert(!definition.is_init())
+        << "register_tile() must be called on an update definition\n";
+    user_assert(xs > 0 && ys > 0)
+        << "In schedule for " << name()
+        << ", register_tile() requires positive tile sizes\n";
+    for (const VarOrRVar &v : {x, y}) {
+        const auto &iter = std::find_if(dim_vars.begin(), dim_vars.end(),
+            [&v](const Var &dv) { return var_name_match(dv.name(), v.name()); });
+        user_assert(!v.is_rvar && iter != dim_vars.end())
+            << "In schedule for " << name()
+            << ", can't register_tile() over " << v.name()
+            << " since it is not a pure Var of " << function.name() << "\n";
+    }
+    const auto &prover_result = prove_associativity(function.name(), definition.args(), definition.values());
+    user_assert(prover_result.associative())
+        << "Failed to call register_tile() on " << name()
+        << " since it can't prove associativity of the operator\n";
+
+    // Lift the entire reduction into an intermediate. This stage then
+    // just merges one tile of it at a time.
+    Func intm = rfactor(vector<pair<RVar, Var>>());
+
+    // Walk the reduction outside of the tile, so the accumulators stay
+    // live across all of it.
+    Stage intm_update = intm.update(0);
+    vector<VarOrRVar> order = {x.var, y.var};
+    for (const Dim &d : intm.function().update(0).schedule().dims()) {
+        if (d.is_rvar()) {
+            order.push_back(RVar(d.var));
+        }
+    }
+    intm_update.reorder(order);
+    intm_update.vectorize(x.var, xs).unroll(y.var, ys);
+    intm.vectorize(x.var, xs).unroll(y.var, ys);
+
+    Var xo(x.name() + "_tile"), yo(y.name() + "_tile");
+    Var xi(x.name() + "_reg"), yi(y.name() + "_reg");
+    tile(x, y, xo, yo, xi, yi, xs, ys).vectorize(xi).unroll(yi);
+    intm.compute_at(LoopLevel(function, xo, (int)stage_index));
+    return intm;
+}
+
+Func Stage::deterministic_parallel(RVar r, int chunk_size) {
+    user_assert(!definition.is_init())
+        << "deterministic_parallel() must be called on an update definition\n";
+    user_assert(chunk_size > 0)
+        << "In schedule for " << name()
+        << ", deterministic_parallel() requires a positive chunk size\n";
+    const auto &prover_result = prove_associativity(function.name(), definition.args(), definition.values());
+    user_assert(prover_result.associative())
+        << "Failed to call deterministic_parallel() on " << name()
+        << " since it can't prove associativity of the operator\n";
+
+    // Reduce each chunk of r into its own partial result. The chunk
+    // boundaries only depend on chunk_size and the bounds of r, never
+    // on the number of threads.
+    RVar ro(r.name() + "_chunk"), ri(r.name() + "_in_chunk");
+    Var u(r.name() + "_partial");
+    split(r, ro, ri, chunk_size, TailStrategy::GuardWithIf);
+    Func intm = rfactor(ro, u);
+    intm.compute_root().update(0).parallel(u);
+
+    vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    const auto &iter = std::find_if(rvars.begin(), rvars.end(),
+        [&ro](const ReductionVariable &rv) { return var_name_match(rv.var, ro.name()); });
+    internal_assert(iter != rvars.end());
+    Expr first = iter->min, num_chunks = iter->extent;
+
+    // Combine the partial results in place. At level l, each partial
+    // whose index is a multiple of 2^(l+1) absorbs the one 2^l after
+    // it, so after ceil(log2(num_chunks)) levels the first partial
+    // holds the total. The order of operations is fixed by the
+    // indices alone.
+    Expr levels = select(num_chunks > 1, 32 - count_leading_zeros(num_chunks - 1), 0);
+    RDom t({{0, num_chunks}, {0, levels}}, intm.name() + "_tree");
+    Expr step = Expr(1) << t.y;
+    t.where(t.x % (2 * step) == 0 && t.x + step < num_chunks);
+
+    vector<Var> intm_args = intm.args();
+    vector<Expr> dst(intm_args.begin(), intm_args.end() - 1), src = dst;
+    dst.push_back(first + t.x);
+    src.push_back(first + min(t.x + step, num_chunks - 1));
+
+    const size_t n = prover_result.size();
+    map<string, Expr> replacements;
+    for (size_t i = 0; i < n; i++) {
+        if (!prover_result.xs[i].var.empty()) {
+            replacements.emplace(prover_result.xs[i].var, (n == 1) ? Expr(intm(dst)) : Expr(intm(dst)[i]));
+        }
+        if (!prover_result.ys[i].var.empty()) {
+            replacements.emplace(prover_result.ys[i].var, (n == 1) ? Expr(intm(src)) : Expr(intm(src)[i]));
+        }
+    }
+    vector<Expr> tree_values(n);
+    for (size_t i = 0; i < n; i++) {
+        tree_values[i] = substitute(replacements, prover_result.pattern.ops[i]);
+    }
+    intm(dst) = Tuple(tree_values);
+
+    // Each step combines two whole partial results, so put the pure
+    // dimensions innermost, where they can be vectorized.
+    if (intm_args.size() > 1) {
+        vector<VarOrRVar> order(intm_args.begin(), intm_args.end() - 1);
+        order.push_back(t.x);
+        order.push_back(t.y);
+        intm.update(1).reorder(order);
+    }
+
+    // This stage now only has to merge the first partial result.
+    iter->extent = 1;
+
+    return intm;
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, Expr factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << name() << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -1028,9 +1249,9 @@ void Stage::split(const string &old, const string &outer, const string &inner, E
     }
 
     if (exact) {
-        user_assert(tail == TailStrategy::GuardWithIf)
+        user_assert(tail == TailStrategy::GuardWithIf || tail == TailStrategy::Predicate)
             << "When splitting Var " << old_name
-            << " the tail strategy must be GuardWithIf or Auto. "
+            << " the tail strategy must be GuardWithIf, Predicate or Auto. "
             << "Anything else may change the meaning of the algorithm\n";
     }
 
@@ -1405,6 +1626,60 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+Stage &Stage::atomic() {
+    user_assert(!definition.is_init()) << "atomic() must be called on an update definition\n";
+
+    const vector<Expr> &values = definition.values();
+    user_assert(values.size() == 1)
+        << "In schedule for " << name()
+        << ", atomic() is not supported for Tuple-valued updates\n";
+
+    Type t = values[0].type();
+    user_assert(t.is_int() || t.is_uint() || t.is_float())
+        << "In schedule for " << name()
+        << ", atomic() is not supported for updates of type " << t << "\n";
+
+    // Atomic updates from different iterations may land in any order,
+    // so the operator must be both associative and commutative, and it
+    // must combine the old value with something else.
+    const auto &prover_result = prove_associativity(function.name(), definition.args(), values);
+    user_assert(prover_result.associative() && prover_result.commutative() &&
+                !prover_result.xs[0].var.empty())
+        << "In schedule for " << name()
+        << ", can't call atomic() since it can't prove that the update is"
+        << " a commutative and associative operation on the previous value\n";
+
+    definition.schedule().atomic() = true;
+    return *this;
+}
+
+Stage &Stage::tensor_core(VarOrRVar x, VarOrRVar y, VarOrRVar k) {
+    user_assert(!definition.is_init()) << "tensor_core() must be called on an update definition\n";
+    user_assert(definition.values().size() == 1)
+        << "In schedule for " << name()
+        << ", tensor_core() is not supported for Tuple-valued updates\n";
+
+    // Record the qualified names of the loops, which may have come
+    // from splits.
+    TensorCoreLoops loops;
+    string *names[] = {&loops.x, &loops.y, &loops.k};
+    const VarOrRVar *vars[] = {&x, &y, &k};
+    for (int i = 0; i < 3; i++) {
+        for (const Dim &dim : definition.schedule().dims()) {
+            if (var_name_match(dim.var, vars[i]->name())) {
+                *names[i] = dim.var;
+                break;
+            }
+        }
+        user_assert(!names[i]->empty())
+            << "In schedule for " << name()
+            << ", could not find dimension " << vars[i]->name()
+            << " to use for tensor_core()\n";
+    }
+    definition.schedule().tensor_cores().push_back(loops);
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1437,6 +1712,23 @@ Stage &Stage::parallel(VarOrRVar var, Expr factor, TailStrategy tail) {
     return *this;
 }
 
+Stage &Stage::distribute_gpus(VarOrRVar var, Expr num_devices) {
+    user_assert(num_devices.defined() && (num_devices.type().is_int() || num_devices.type().is_uint()))
+        << "In schedule for " << name()
+        << ", the number of devices to distribute over must be an integer\n";
+    parallel(var);
+    // Record the qualified name of the loop, which may have come from
+    // a split.
+    for (const Dim &dim : definition.schedule().dims()) {
+        if (var_name_match(dim.var, var.name())) {
+            GPUDistribution d = {dim.var, cast<int>(num_devices)};
+            definition.schedule().gpu_distributions().push_back(d);
+            break;
+        }
+    }
+    return *this;
+}
+
 Stage &Stage::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     if (var.is_rvar) {
         RVar tmp;
@@ -1717,14 +2009,16 @@ Stage &Stage::hexagon(VarOrRVar x) {
     return *this;
 }
 
-Stage &Stage::prefetch(const Func &f, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy) {
-    PrefetchDirective prefetch = {f.name(), var.name(), offset, strategy, Parameter()};
+Stage &Stage::prefetch(const Func &f, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy,
+                       PrefetchHint hint) {
+    PrefetchDirective prefetch = {f.name(), var.name(), offset, strategy, Parameter(), hint};
     definition.schedule().prefetches().push_back(prefetch);
     return *this;
 }
 
-Stage &Stage::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy) {
-    PrefetchDirective prefetch = {param.name(), var.name(), offset, strategy, param};
+Stage &Stage::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy,
+                       PrefetchHint hint) {
+    PrefetchDirective prefetch = {param.name(), var.name(), offset, strategy, param, hint};
     definition.schedule().prefetches().push_back(prefetch);
     return *this;
 }
@@ -1980,9 +2274,93 @@ Func &Func::allow_race_conditions() {
     return *this;
 }
 
-Func &Func::memoize() {
+Func &Func::memoize(int64_t budget) {
     invalidate_cache();
+    user_assert(budget >= 0)
+        << "Func " << name() << " cannot be memoized with a negative budget.\n";
     func.schedule().memoized() = true;
+    func.schedule().memoize_budget() = budget;
+    return *this;
+}
+
+Func &Func::approximate_math(float max_ulps) {
+    invalidate_cache();
+    user_assert(max_ulps >= 0.0f)
+        << "Func " << name() << " cannot have a negative math precision.\n";
+    func.schedule().max_math_ulps() = max_ulps;
+    return *this;
+}
+
+Func &Func::cpu_variants(const std::vector<std::vector<Target::Feature>> &variants) {
+    invalidate_cache();
+    func.schedule().cpu_variants() = variants;
+    return *this;
+}
+
+Func &Func::async() {
+    invalidate_cache();
+    func.schedule().async() = true;
+    return *this;
+}
+
+Func &Func::store_per_worker() {
+    invalidate_cache();
+    func.schedule().store_per_worker() = true;
+    return *this;
+}
+
+Func &Func::ring_buffer(Expr extent) {
+    invalidate_cache();
+    user_assert(extent.type().is_int() || extent.type().is_uint())
+        << "The extent of the ring buffer of " << name() << " must be an integer\n";
+    user_assert(!is_const(extent) || can_prove(extent > 0))
+        << "The extent of the ring buffer of " << name() << " must be positive\n";
+    func.schedule().ring_buffer() = cast<int>(extent);
+    return *this;
+}
+
+Func &Func::slide_in_tasks(Expr task_size) {
+    invalidate_cache();
+    user_assert(task_size.type().is_int() || task_size.type().is_uint())
+        << "The task size for sliding " << name() << " must be an integer\n";
+    user_assert(!is_const(task_size) || can_prove(task_size > 0))
+        << "The task size for sliding " << name() << " must be positive\n";
+    func.schedule().slide_task_size() = cast<int>(task_size);
+    return *this;
+}
+
+Func &Func::store_in_place_of(Func producer) {
+    invalidate_cache();
+    user_assert(producer.defined())
+        << "Can't store " << name() << " in place of an undefined Func\n";
+    user_assert(producer.name() != name())
+        << "Can't store " << name() << " in place of itself\n";
+    func.schedule().in_place_of() = producer.name();
+    return *this;
+}
+
+Func &Func::store_interleaved() {
+    invalidate_cache();
+    user_assert(defined() && outputs() > 1)
+        << "Can't store " << name() << " interleaved, because it isn't Tuple-valued\n";
+    for (const Type &t : output_types()) {
+        user_assert(t == output_types()[0])
+            << "Can't store " << name() << " interleaved, because its Tuple elements"
+            << " have different types\n";
+    }
+    func.schedule().store_interleaved() = true;
+    return *this;
+}
+
+Func &Func::store_streaming() {
+    invalidate_cache();
+    func.schedule().store_streaming() = true;
+    return *this;
+}
+
+Func &Func::hexagon_dma() {
+    invalidate_cache();
+    func.schedule().hexagon_dma() = true;
     return *this;
 }
 
@@ -2002,14 +2380,71 @@ void Func::specialize_fail(const std::string &message) {
     (void) Stage(func, func.definition(), 0, args()).specialize_fail(message);
 }
 
+Func &Func::specialize_shapes(const std::vector<std::vector<int>> &shapes, int vector_width) {
+    OutputImageParam out = output_buffers()[0];
+
+    // Ask for a dense innermost dimension if it isn't already required.
+    Expr dense = const_true();
+    bool stride_constrained = out.parameter().stride_constraint(0).defined();
+    if (!stride_constrained) {
+        dense = (out.dim(0).stride() == 1);
+    }
+
+    for (const std::vector<int> &shape : shapes) {
+        user_assert(!shape.empty() && (int)shape.size() <= dimensions())
+            << "In specialize_shapes for Func " << name() << ": each shape must give the extents of "
+            << "between one and " << dimensions() << " dimensions.\n";
+        Expr cond = dense;
+        for (size_t i = 0; i < shape.size(); i++) {
+            cond = cond && (out.dim((int)i).extent() == shape[i]);
+        }
+        specialize(simplify(cond));
+    }
+    if (vector_width > 1) {
+        specialize(simplify(dense && (out.dim(0).extent() % vector_width == 0)));
+    }
+    if (!stride_constrained) {
+        specialize(dense);
+    }
+    return *this;
+}
+
 Func &Func::serial(VarOrRVar var) {
     invalidate_cache();
     Stage(func, func.definition(), 0, args()).serial(var);
     return *this;
 }
 
+namespace {
+void add_extern_tile(Function func, VarOrRVar var, Expr size, TailStrategy tail) {
+    user_assert(!var.is_rvar)
+        << "In schedule for " << func.name()
+        << ", can't parallelize RVar " << var.name()
+        << " of an extern stage.\n";
+    const std::vector<std::string> &args = func.args();
+    user_assert(std::find(args.begin(), args.end(), var.name()) != args.end())
+        << "In schedule for " << func.name()
+        << ", can't parallelize " << var.name()
+        << " because it is not a dimension of the extern stage.\n";
+    user_assert(tail == TailStrategy::Auto || tail == TailStrategy::GuardWithIf)
+        << "In schedule for " << func.name()
+        << ", the tiles of an extern stage can only use TailStrategy::GuardWithIf "
+        << "(the last tile is cropped to the required region).\n";
+    for (const ExternTile &t : func.schedule().extern_tiles()) {
+        user_assert(t.var != var.name())
+            << "In schedule for " << func.name()
+            << ", " << var.name() << " has already been parallelized.\n";
+    }
+    func.schedule().extern_tiles().push_back({var.name(), size, ForType::Parallel});
+}
+}  // namespace
+
 Func &Func::parallel(VarOrRVar var) {
     invalidate_cache();
+    if (is_extern()) {
+        add_extern_tile(func, var, 1, TailStrategy::Auto);
+        return *this;
+    }
     Stage(func, func.definition(), 0, args()).parallel(var);
     return *this;
 }
@@ -2028,10 +2463,20 @@ Func &Func::unroll(VarOrRVar var) {
 
 Func &Func::parallel(VarOrRVar var, Expr factor, TailStrategy tail) {
     invalidate_cache();
+    if (is_extern()) {
+        add_extern_tile(func, var, factor, tail);
+        return *this;
+    }
     Stage(func, func.definition(), 0, args()).parallel(var, factor, tail);
     return *this;
 }
 
+Func &Func::distribute_gpus(VarOrRVar var, Expr num_devices) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0, args()).distribute_gpus(var, num_devices);
+    return *this;
+}
+
 Func &Func::vectorize(VarOrRVar var, Expr factor, TailStrategy tail) {
     invalidate_cache();
     Stage(func, func.definition(), 0, args()).vectorize(var, factor, tail);
@@ -2295,15 +2740,17 @@ Func &Func::hexagon(VarOrRVar x) {
     return *this;
 }
 
-Func &Func::prefetch(const Func &f, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy) {
+Func &Func::prefetch(const Func &f, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy,
+                     PrefetchHint hint) {
     invalidate_cache();
-    Stage(func, func.definition(), 0, args()).prefetch(f, var, offset, strategy);
+    Stage(func, func.definition(), 0, args()).prefetch(f, var, offset, strategy, hint);
     return *this;
 }
 
-Func &Func::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy) {
+Func &Func::prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset, PrefetchBoundStrategy strategy,
+                     PrefetchHint hint) {
     invalidate_cache();
-    Stage(func, func.definition(), 0, args()).prefetch(param, var, offset, strategy);
+    Stage(func, func.definition(), 0, args()).prefetch(param, var, offset, strategy, hint);
     return *this;
 }
 
@@ -2361,6 +2808,21 @@ Func &Func::align_storage(Var dim, Expr alignment) {
     return *this;
 }
 
+Func &Func::pad_storage(Var dim, Expr padding) {
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    for (size_t i = 0; i < dims.size(); i++) {
+        if (var_name_match(dims[i].var, dim.name())) {
+            dims[i].padding = padding;
+            return *this;
+        }
+    }
+    user_error << "Could not find variable " << dim.name()
+               << " to pad the storage of.\n";
+    return *this;
+}
+
 Func &Func::fold_storage(Var dim, Expr factor, bool fold_forward) {
     invalidate_cache();
 
@@ -2950,6 +3412,16 @@ void Func::compile_to_bitcode(const string &filename, const vector<Argument> &ar
     pipeline().compile_to_bitcode(filename, args, "", target);
 }
 
+void Func::compile_to_serialized_pipeline(const string &filename, const vector<Argument> &args,
+                                          const string &fn_name, const Target &target) {
+    pipeline().compile_to_serialized_pipeline(filename, args, fn_name, target);
+}
+
+void Func::compile_to_serialized_pipeline(const string &filename, const vector<Argument> &args,
+                                          const Target &target) {
+    pipeline().compile_to_serialized_pipeline(filename, args, "", target);
+}
+
 void Func::compile_to_llvm_assembly(const string &filename, const vector<Argument> &args, const string &fn_name,
                                     const Target &target) {
     pipeline().compile_to_llvm_assembly(filename, args, fn_name, target);
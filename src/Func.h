@@ -180,6 +180,73 @@ public:
     Func rfactor(RVar r, Var v);
     // @}
 
+    /** Split an associative update into k independent accumulators
+     * to break the loop-carried dependency through the reduction
+     * variable r. The RVar is split by k, the inner part is lifted to
+     * a new pure dimension of an intermediate Func with rfactor(), and
+     * that dimension is unrolled. Each iteration of the outer part of
+     * r then updates k separate partial results whose latencies
+     * overlap, instead of a single one. The partial results are
+     * combined by this stage at the end. For example:
+     \code
+     f() = 0.0f;
+     f() += a(r) * b(r);
+     f.update().split_accumulators(r, 4);
+     \endcode
+     * computes f as a sum of four partial dot products. The
+     * intermediate is computed at the innermost non-vectorized pure
+     * Var of this stage (the outermost loop for scalar reductions), and is
+     * returned for further scheduling. Like rfactor(), this throws an
+     * error if the update can't be proven associative. The result is
+     * only bitwise-identical to the serial order for operators that
+     * are exactly associative (e.g. integer addition, min, max). */
+    Func split_accumulators(RVar r, int k);
+
+    /** Compute an associative update in register-sized tiles of xs by
+     * ys values of the pure Vars x and y. The whole reduction is lifted
+     * into an intermediate Func (as rfactor() with no preserved RVars
+     * would), which is computed once per tile of this stage. Its loop
+     * nest puts the reduction outside the tile, vectorizes x by xs and
+     * fully unrolls y by ys, so the tile of accumulators is a small
+     * constant-sized allocation that LLVM keeps in registers across the
+     * whole reduction, and each operand that doesn't depend on x is
+     * loaded once per row of the tile and broadcast. This is the usual
+     * shape of a GEMM micro-kernel:
+     \code
+     c(x, y) = 0.0f;
+     c(x, y) += a(x, r) * b(r, y);
+     c.update().register_tile(x, y, 8, 4);
+     \endcode
+     * The tile must fit in the target's register file (here 4 vectors
+     * of 8 floats), or LLVM will spill it. The intermediate is
+     * returned for further scheduling. */
+    Func register_tile(VarOrRVar x, VarOrRVar y, int xs, int ys);
+
+    /** Parallelize an associative update over the RVar r so that its
+     * result is the same on every run, whatever the number of threads
+     * and however they are scheduled. r is split into chunks of
+     * chunk_size iterations, counted from its minimum, and each chunk
+     * is reduced into its own partial result by a parallel task, as
+     * with rfactor(). The partial results are then combined in a fixed
+     * pairwise tree: chunk 0 with chunk 1, chunk 2 with chunk 3, and so
+     * on, then pairs of those, until one total remains, which this
+     * stage merges into the Func. For example:
+     \code
+     hist(x) = 0.0f;
+     hist(clamp(im(r.x, r.y), 0, 255)) += weight(r.x, r.y);
+     hist.update().deterministic_parallel(r.y, 16);
+     \endcode
+     * computes the histogram with one task per 16 rows. Unlike atomic()
+     * with a floating-point add, where rounding depends on the order
+     * threads reach each bin, this gives bitwise-identical results
+     * every time. It may differ in the last bits from the serial order.
+     * r must be the outermost RVar if the operator isn't commutative.
+     * The intermediate is computed at root and returned for further
+     * scheduling. Its first update computes the partial results and
+     * is parallel over them. Its second update does the tree
+     * combination. */
+    Func deterministic_parallel(RVar r, int chunk_size = 1024);
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -340,6 +407,7 @@ public:
     Stage &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
     Stage &vectorize(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
     Stage &unroll(VarOrRVar var, Expr factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &distribute_gpus(VarOrRVar var, Expr num_devices);
     Stage &tile(VarOrRVar x, VarOrRVar y,
                 VarOrRVar xo, VarOrRVar yo,
                 VarOrRVar xi, VarOrRVar yi, Expr
@@ -416,15 +484,56 @@ public:
 
     Stage &allow_race_conditions();
 
+    /** Perform this update with atomic read-modify-write operations
+     * on the value being updated, so that it may be parallelized or
+     * vectorized over RVars even when different iterations update the
+     * same site (e.g. a histogram). The update must be a single
+     * commutative and associative operation between the value being
+     * updated and something that does not depend on it, such as
+     * f(g(r)) += 1 or f(x) = max(f(x), g(r)). Uses native atomic
+     * instructions where the target has them, and a compare-and-swap
+     * loop otherwise. Call this before parallelizing or vectorizing
+     * the RVars. Not supported by the C backend or the C-like GPU
+     * backends (OpenCL, Metal, D3D12, GLSL). */
+    Stage &atomic();
+
+    /** Compute the matrix multiply-accumulate formed by the three
+     * innermost loops of this update with CUDA tensor cores (wmma). x
+     * and y index the columns and rows of the Func, and k is the
+     * reduction over the products. Each loop must have extent 16,
+     * e.g. because they come from splits by 16, and the update must
+     * have the form f(x, y) += A(k, y) * B(x, k), where A and B are
+     * Float(16) and f is Float(16) or Float(32) (with the products
+     * cast to float). The 16x16x16 block is done by one warp, so
+     * schedule the loops outside of it over gpu blocks and threads as
+     * usual, e.g.:
+     *
+     \code
+     prod.update()
+         .tile(x, y, xi, yi, 16, 16).split(r.x, ro, ri, 16)
+         .reorder(xi, yi, ri, ro, x, y)
+         .gpu_blocks(x, y).tensor_core(xi, yi, ri);
+     \endcode
+     *
+     * f and the inputs must live in global or shared memory, rather
+     * than registers, with 32-byte aligned tiles and row strides that
+     * are a multiple of 8 elements. Either row- or column-major
+     * layouts work for each of them. Requires a target with
+     * cuda_capability_70 and LLVM 8 or later. */
+    Stage &tensor_core(VarOrRVar x, VarOrRVar y, VarOrRVar k);
+
     Stage &hexagon(VarOrRVar x = Var::outermost());
     Stage &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
-                           PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
+                           PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                           PrefetchHint hint = PrefetchHint::L1);
     Stage &prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset = 1,
-                           PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
+                           PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                           PrefetchHint hint = PrefetchHint::L1);
     template<typename T>
     Stage &prefetch(const T &image, VarOrRVar var, Expr offset = 1,
-                    PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf) {
-        return prefetch(image.parameter(), var, offset, strategy);
+                    PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                    PrefetchHint hint = PrefetchHint::L1) {
+        return prefetch(image.parameter(), var, offset, strategy, hint);
     }
     // @}
 
@@ -820,6 +929,19 @@ public:
                             const Target &target = get_target_from_environment());
     // @}
 
+    /** Compile this function to a serialized pipeline file, with the
+     * given filename (which should probably end in .hlpipe), type
+     * signature, and function name (which defaults to the same name
+     * as this halide function). See
+     * Pipeline::compile_to_serialized_pipeline. */
+    //@{
+    void compile_to_serialized_pipeline(const std::string &filename, const std::vector<Argument> &,
+                                        const std::string &fn_name,
+                                        const Target &target = get_jit_target_from_environment());
+    void compile_to_serialized_pipeline(const std::string &filename, const std::vector<Argument> &,
+                                        const Target &target = get_jit_target_from_environment());
+    // @}
+
     /** Statically compile this function to llvm assembly, with the
      * given filename (which should probably end in .ll), type
      * signature, and C function name (which defaults to the same name
@@ -1087,7 +1209,12 @@ public:
      * 5, uint32_t = 6, int32_t = 7, uint64_t = 8, int64_t = 9. The
      * data follows the header, as a densely packed array of the given
      * size and the given type. If given the extension .tmp, this file
-     * format can be natively read by the program ImageStack. */
+     * format can be natively read by the program ImageStack.
+     *
+     * If the environment variable HL_DEBUG_TO_FILE_ASYNC is set to 1
+     * when the pipeline runs, the file is written on a background
+     * thread from a copy of the data, so that the pipeline's timing
+     * is disturbed less. */
     void debug_to_file(const std::string &filename);
 
     /** The name of this function, either given during construction,
@@ -1233,6 +1360,22 @@ public:
                        bool uses_old_buffer_t = false);
     // @}
 
+    /** Describe which values of its inputs an extern stage reads with
+     * an Expr over the Func's pure arguments (see Func::args). The
+     * Expr must touch at least every value the extern stage reads,
+     * e.g.:
+     \code
+     Var x, y;
+     Func blurred;
+     blurred.define_extern("my_blur", {input}, Float(32), {x, y});
+     blurred.extern_proxy(input(x - 1, y) + input(x + 1, y));
+     \endcode
+     * Bounds inference then computes the regions of the inputs from
+     * this Expr, instead of first calling the extern stage in
+     * bounds-query mode, so the extern is called only once per
+     * realization. */
+    Func &extern_proxy(Expr footprint);
+
     /** Get the types of the outputs of this Func. */
     const std::vector<Type> &output_types() const;
 
@@ -1456,9 +1599,41 @@ public:
      * task_size. After this call, var refers to the outer dimension of
      * the split. The inner dimension has a new anonymous name. If you
      * wish to mutate it, or schedule with respect to it, do the split
-     * manually. */
+     * manually.
+     *
+     * Both forms of parallel also apply to extern Funcs. The extern
+     * function is then called once per task, from a parallel loop,
+     * with its output buffer cropped to that task's slice of the
+     * dimension (the last slice is cropped to the required region).
+     * Its input buffers still cover the region required by the whole
+     * output. The call without a task_size uses tasks of size one. */
     Func &parallel(VarOrRVar var, Expr task_size, TailStrategy tail = TailStrategy::Auto);
 
+    /** Mark a dimension to be traversed in parallel, with iteration i
+     * (counting from the loop's min) running on GPU device i %
+     * num_devices. The GPU work done inside each iteration, including
+     * the copies of its inputs, uses that device. This lets a single
+     * realize() use every GPU on a machine, e.g.:
+     *
+     \code
+     f.split(y, yo, yi, 64).distribute_gpus(yo, 4).gpu_tile(x, yi, xo, yio, xi, yii, 16, 16);
+     \endcode
+     *
+     * Each device needs its own copy of the region of the inputs that
+     * its iterations read, including any halo. Compute producers (or
+     * wrappers of inputs, via \ref Func::in) inside the distributed
+     * loop to have that copied to each device:
+     *
+     \code
+     input.in().compute_at(f, yo);
+     \endcode
+     *
+     * Buffers shared across iterations are still readable from every
+     * device where peer access is available. Per-device contexts are
+     * only kept by the CUDA runtime; other GPU runtimes use a single
+     * device. */
+    Func &distribute_gpus(VarOrRVar var, Expr num_devices);
+
     /** Mark a dimension to be computed all-at-once as a single
      * vector. The dimension should have constant extent -
      * e.g. because it is the inner dimension following a split by a
@@ -1769,6 +1944,31 @@ public:
      */
     void specialize_fail(const std::string &message);
 
+    /** Specialize this Func, which must be an output of the pipeline,
+     * for a list of common output shapes. Each entry of shapes gives
+     * concrete extents for the leading dimensions of the output, so
+     * the loops over them have constant bounds and can be fully
+     * unrolled with no tail handling. If vector_width is greater than
+     * one, a further version is compiled for outputs whose innermost
+     * extent is a multiple of it. If the stride of the innermost
+     * dimension of the output is not already constrained, every
+     * version also requires it to be one, and a last version is
+     * compiled for just that case. The schedule of each version is
+     * the schedule of this Func at the time of the call, and the
+     * general code is run for any other shape. The conditions are
+     * tested in order at the start of the pipeline, e.g.:
+     \code
+     f.vectorize(x, 8).specialize_shapes({{16, 16}, {64, 64}}, 8);
+     \endcode
+     * is equivalent to:
+     \code
+     f.specialize(f.output_buffer().width() == 16 && f.output_buffer().height() == 16);
+     f.specialize(f.output_buffer().width() == 64 && f.output_buffer().height() == 64);
+     f.specialize(f.output_buffer().width() % 8 == 0);
+     \endcode
+     */
+    Func &specialize_shapes(const std::vector<std::vector<int>> &shapes, int vector_width = 0);
+
     /** Tell Halide that the following dimensions correspond to GPU
      * thread indices. This is useful if you compute a producer
      * function within the block indices of a consumer function, and
@@ -1862,7 +2062,15 @@ public:
      * (since GLSL/RS implicitly vectorizes the color channel). */
     Func &shader(Var x, Var y, Var c, DeviceAPI device_api);
 
-    /** Schedule for execution as GLSL kernel. */
+    /** Schedule for execution as GLSL kernel. When compiling for a
+     * target without the OpenGL feature, the stage instead runs on
+     * the CPU, parallel over y, vectorized over x and unrolled over
+     * c, so the same schedule can be compiled for GL-less targets
+     * too. A multitarget library such as host-opengl,host then
+     * contains both; note that halide_can_use_target_features only
+     * checks CPU features by default, so an application that wants
+     * the CPU variant on machines without GL should install a
+     * check with halide_set_custom_can_use_target_features. */
     Func &glsl(Var x, Var y, Var c);
 
     /** Schedule for execution on Hexagon. When a loop is marked with
@@ -1898,16 +2106,33 @@ public:
      *   for x = ...
      *     prefetch(&f[x + 2, y], 1, 16);
      *     g(x, y) = 2 * f(x, y)
+     *
+     * If the offset is an undefined Expr, it is chosen from a rough
+     * estimate of the cost of one iteration of 'var', so that the
+     * prefetch is issued about one cache miss latency ahead of use.
+     *
+     * If the prefetched buffer is accessed at data-dependent sites
+     * within the loop, e.g. g(x) = f(idx(x)), the prefetch instead
+     * computes the sites that will be accessed by iteration var +
+     * offset, by loading the indices ahead of time, and prefetches
+     * each of them. This requires the indices to be available for the
+     * whole loop, i.e. not computed within it.
+     *
+     * The hint specifies which level of the cache the data should be
+     * brought into. Targets without such hints ignore it.
      */
     // @{
     Func &prefetch(const Func &f, VarOrRVar var, Expr offset = 1,
-                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
+                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                   PrefetchHint hint = PrefetchHint::L1);
     Func &prefetch(const Internal::Parameter &param, VarOrRVar var, Expr offset = 1,
-                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf);
+                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                   PrefetchHint hint = PrefetchHint::L1);
     template<typename T>
     Func &prefetch(const T &image, VarOrRVar var, Expr offset = 1,
-                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf) {
-        return prefetch(image.parameter(), var, offset, strategy);
+                   PrefetchBoundStrategy strategy = PrefetchBoundStrategy::GuardWithIf,
+                   PrefetchHint hint = PrefetchHint::L1) {
+        return prefetch(image.parameter(), var, offset, strategy, hint);
     }
     // @}
 
@@ -1949,6 +2174,28 @@ public:
      * aligned to multiples of 16, use foo.align_storage(x, 16). */
     Func &align_storage(Var dim, Expr alignment);
 
+    /** Add some unused elements to the end of the storage extent of a
+     * particular dimension of realizations of this function, after
+     * any alignment from \ref Func::align_storage. The strides of
+     * the dimensions stored outside of dim grow to match. This is
+     * mostly useful for Funcs stored in GPU shared memory: if the
+     * threads of a warp read a column of a Func whose rows are a
+     * multiple of 128 bytes long, all the reads fall in the same memory
+     * bank and are serialized. For example, with
+     *
+     \code
+     f.compute_at(g, x).store_in(MemoryType::GPUShared).pad_storage(x, 1);
+     \endcode
+     *
+     * the rows of f are one element longer than they need to be, so
+     * that each element of a column is in a different bank. Halide
+     * adds this padding automatically to the innermost storage
+     * dimension of shared memory allocations it sees being accessed
+     * by column with constant power-of-two rows, unless padding is
+     * specified for that dimension with this directive. A padding of
+     * zero turns the automatic padding off. */
+    Func &pad_storage(Var dim, Expr padding);
+
     /** Store realizations of this function in a circular buffer of a
      * given extent. This is more efficient when the extent of the
      * circular buffer is a power of 2. If the fold factor is too
@@ -2109,9 +2356,240 @@ public:
 
     /** Use the halide_memoization_cache_... interface to store a
      *  computed version of this function across invocations of the
-     *  Func.
+     *  Func. If budget is positive, the cached results of this Func
+     *  are limited to that many bytes, so that a large, rarely reused
+     *  Func doesn't evict the results of small, frequently reused
+     *  ones; the least recently used of its results are evicted
+     *  first.
+     */
+    Func &memoize(int64_t budget = 0);
+
+    /** Let the exp, log, sin, cos and tanh calls (and so things built
+     * from them, like sigmoids) in this Func's definitions use cleanly
+     * vectorizable polynomial approximations accurate to within
+     * max_ulps units in the last place, instead of the exact
+     * versions. The cheapest approximation that meets the bound is
+     * chosen for each function, and functions with no such
+     * approximation are left alone. sin and cos are only this
+     * accurate for arguments of magnitude less than about 100. Zero,
+     * the default, keeps everything exact. Only Float(32) math is
+     * affected. For example:
+     *
+     \code
+     Func f, g;
+     Var x;
+     f(x) = exp(-x * x / 512.0f);
+     g(x) = tanh(f(x));
+     f.approximate_math(128);
+     g.approximate_math(4);
+     \endcode
+     *
+     * Here f uses a low-degree polynomial for exp, while g uses a
+     * polynomial tanh accurate to a few ulps.
+     */
+    Func &approximate_math(float max_ulps);
+
+    /** Also compile the code that produces this Func for each of the
+     * given sets of x86 instruction set features, and pick one of
+     * them at runtime based on what the CPU supports. The variants
+     * are tried in order, so list the best first; if the CPU
+     * supports none of them, the code compiled for the pipeline's
+     * target runs. The rest of the pipeline is compiled once, so
+     * this costs much less code size than compile_multitarget when
+     * only a few Funcs are worth specializing. For example:
+     *
+     \code
+     f.vectorize(x, 16).cpu_variants({{Target::AVX512_Skylake},
+                                      {Target::AVX2, Target::FMA},
+                                      {Target::SSE41}});
+     \endcode
+     *
+     * The check for CPU features is cached by the runtime, so it is
+     * only done once. When jitting, the variant is picked at compile
+     * time for the host. Has no effect on other architectures or on
+     * Funcs computed on a device. Note that the vector widths in
+     * the schedule are shared by all the variants.
+     */
+    Func &cpu_variants(const std::vector<std::vector<Target::Feature>> &variants);
+
+    /** Produce this Func asynchronously in a separate
+     * thread. Consumers will be run by the calling thread, and will
+     * wait on semaphores for each region of this Func they need to
+     * be produced before reading it. If the storage of this Func is
+     * folded (see \ref Func::fold_storage), the producer will also
+     * wait for the consumer to finish with old values before
+     * overwriting them. This lets a producer and consumer in a
+     * tiled or scanline pipeline run concurrently:
+     *
+     \code
+     Func f, g;
+     Var x, y;
+     f(x, y) = x + y;
+     g(x, y) = f(x, y) + f(x, y+1);
+     f.compute_at(g, y).store_root().async();
+     \endcode
+     *
+     * Here rows of f are computed by one thread and consumed by the
+     * calling thread as they become available. The Func must be
+     * scheduled compute_at some loop level (it may not be inlined),
+     * and may not be an output of the pipeline.
+     */
+    Func &async();
+
+    /** When this Func is stored inside a parallel loop, allocate its
+     * storage once outside of that loop, with enough room for one
+     * copy per task running at the same time, and let each task of
+     * the loop reuse one of those copies. This replaces a heap
+     * allocation per loop iteration with one per worker thread per
+     * run of the loop. For example:
+     *
+     \code
+     Func f, g;
+     Var x, y;
+     f(x, y) = x + y;
+     g(x, y) = f(x, y) + f(x, y+1);
+     f.compute_at(g, y).store_per_worker();
+     g.parallel(y);
+     \endcode
+     *
+     * The size of f's allocation must be bounded by expressions that
+     * don't depend on the parallel loop or anything inside it;
+     * otherwise a warning is printed and f is allocated per
+     * iteration as usual. Allocations that fit on the stack are not
+     * affected.
+     */
+    Func &store_per_worker();
+
+    /** Store this Func in a ring buffer of the given number of tiles,
+     * where a tile is the region computed in one iteration of the
+     * loops between its store and compute levels. Each iteration
+     * uses the next tile in the ring. Unlike \ref Func::fold_storage,
+     * this doesn't depend on the producer's footprint moving
+     * monotonically, so it works for any access pattern, but values
+     * computed in one iteration are not reused by the next. For
+     * example:
+     *
+     \code
+     Func f, g;
+     Var x, y;
+     f(x, y) = x + y;
+     g(x, y) = f(x, y) + f(x, y+1);
+     f.store_root().compute_at(g, y).ring_buffer(2).async();
+     \endcode
+     *
+     * If the Func is also async, the producer may run up to extent
+     * iterations ahead of its consumer, waiting whenever every tile
+     * of the ring is still in use. The Func must be stored outside of
+     * its compute level, and all its uses must be within the loops
+     * over which it is ring buffered, which must be serial.
+     */
+    Func &ring_buffer(Expr extent);
+
+    /** Let this Func slide along parallel loops between its store and
+     * compute levels, which it otherwise only does along serial
+     * loops. Each parallel loop is split into tasks of task_size
+     * iterations. Each task computes the Func's whole footprint on
+     * its first iteration, and slides along the rest of them. For
+     * example:
+     *
+     \code
+     Func f, g;
+     Var x, y;
+     f(x, y) = x + y;
+     g(x, y) = f(x, y) + f(x, y+1);
+     f.store_root().compute_at(g, y).slide_in_tasks(16);
+     g.parallel(y);
+     \endcode
+     *
+     * has the parallelism of splitting y by 16, parallelizing the
+     * outer loop, and storing f at it, while only computing each row
+     * of f once per task. Rows at the edges of the tasks are computed
+     * by both tasks next to them. The storage isn't folded.
+     */
+    Func &slide_in_tasks(Expr task_size);
+
+    /** Store this Func in the storage of one of its producers, instead
+     * of allocating storage of its own. The producer must only be
+     * used by this Func's pure definition, at the same coordinates
+     * the pure definition computes, so each value of the producer is
+     * dead once the value of this Func that replaces it is
+     * computed. This suits chains of elementwise stages, such as
+     * activation functions:
+     *
+     \code
+     Func conv, relu, out;
+     Var x, y;
+     relu(x, y) = max(conv(x, y), 0.0f);
+     out(x, y) = relu(x, y) * 2.0f;
+     conv.compute_root();
+     relu.compute_root().store_in_place_of(conv);
+     \endcode
+     *
+     * Both Funcs must be stored and computed at the same loop level,
+     * have one value of the same size, and be stored with the same
+     * dimension order. Neither may be folded, ring buffered or async,
+     * and this Func can't be an output. Its splits can't use
+     * TailStrategy::ShiftInwards, which recomputes values after the
+     * producer's values there are overwritten, so vectorize it with
+     * TailStrategy::GuardWithIf instead. Funcs that are used on a
+     * device keep their own storage.
+     */
+    Func &store_in_place_of(Func producer);
+
+    /** Store the elements of this Tuple-valued Func interleaved in a
+     * single buffer, as an array of structures, instead of in one
+     * buffer per element. This suits consumers that read every
+     * element at scattered locations, such as complex numbers in an
+     * FFT, or index and value pairs, which then touch half as many
+     * cache lines for a pair. Vectorized stores of all the elements
+     * are combined into one interleaving store, and vectorized loads
+     * are deinterleaved. All the elements must have the same type,
+     * and the Func can't be an output, which is always stored one
+     * buffer per element:
+     *
+     \code
+     Func spectrum;
+     spectrum(x, y) = Tuple(re, im);
+     spectrum.compute_root().store_interleaved().vectorize(x, 8);
+     \endcode
+     */
+    Func &store_interleaved();
+
+    /** Write this Func with non-temporal (streaming) stores, which
+     * bypass the cache instead of first reading every line they write
+     * into it. This suits large outputs that are written once and not
+     * read again soon, such as the final stage of a pipeline over a
+     * big image: it saves the read-for-ownership traffic, and keeps
+     * the inputs in cache. It is a pessimization for Funcs that are
+     * consumed while still in cache. Only dense vector stores on CPU
+     * targets are affected, so the Func should be vectorized. Each
+     * parallel task ends with a fence, so the values are visible to
+     * other threads once the parallel loop is over. */
+    Func &store_streaming();
+
+    /** Copy this Func into its storage with the Hexagon user DMA
+     * engine, rather than with vector loads and stores. The Func must
+     * be a copy of an input buffer, stored in VTCM, and computed
+     * inside a Hexagon offloaded loop. Combined with \ref
+     * Func::ring_buffer and \ref Func::async, the next tile is copied
+     * while the current one is consumed:
+     *
+     \code
+     ImageParam in(UInt(8), 2);
+     Func f;
+     Var x, y, yo, yi;
+     f(x, y) = in(x, y - 1) + in(x, y) + in(x, y + 1);
+     f.hexagon().split(y, yo, yi, 16);
+     in.in().compute_at(f, yo).store_root().store_in(MemoryType::VTCM)
+         .ring_buffer(2).async().hexagon_dma();
+     \endcode
+     *
+     * The innermost dimension of the copy must be dense in both the
+     * input and the Func's storage. On targets without the user DMA
+     * engine (before hvx_v66), and outside of Hexagon offloaded
+     * loops, the copy is done as usual.
      */
-    Func &memoize();
+    Func &hexagon_dma();
 
 
     /** Allocate storage for this function within f's loop over
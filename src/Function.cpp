@@ -983,21 +983,25 @@ const Call *Function::is_wrapper() const {
 
 namespace {
 
-// Replace all calls to functions listed in 'substitutions' with their wrappers.
-class SubstituteCalls : public IRMutator2 {
+// Replace all calls to functions listed in 'substitutions' with their
+// wrappers. This works on the graph of IR nodes, so a subexpression
+// that appears several times, in one definition or in the definitions
+// of several Functions mutated by the same object, is only rebuilt
+// once and stays shared.
+class SubstituteCalls : public IRGraphMutator2 {
     using IRMutator2::visit;
 
-    map<FunctionPtr, FunctionPtr> substitutions;
+    const map<FunctionPtr, FunctionPtr> &substitutions;
 
     Expr visit(const Call *c) override {
         Expr expr = IRMutator2::visit(c);
         c = expr.as<Call>();
         internal_assert(c);
 
-        if ((c->call_type == Call::Halide) &&
-            c->func.defined() &&
-            substitutions.count(c->func)) {
-            FunctionPtr subs = substitutions[c->func];
+        auto it = (c->call_type == Call::Halide && c->func.defined()) ?
+            substitutions.find(c->func) : substitutions.end();
+        if (it != substitutions.end()) {
+            FunctionPtr subs = it->second;
             internal_assert(subs.defined()) << "Function not in environment: " << subs->name << "\n";
             debug(4) << "...Replace call to Func \"" << c->name << "\" with "
                      << "\"" << subs->name << "\"\n";
@@ -1057,9 +1061,14 @@ pair<vector<Function>, map<string, Function>> deep_copy(
     }
 
     // Need to substitute-in all old Function references in all Exprs referenced
-    // within the Function with the deep-copy versions
+    // within the Function with the deep-copy versions. Use one mutator
+    // for all of them, so that subexpressions shared between the
+    // definitions of different Functions (common in machine-generated
+    // pipelines) are shared in the copies too, rather than duplicated
+    // once per Function.
+    SubstituteCalls subs_calls(copied_map);
     for (auto &iter : copied_map) {
-        Function(iter.second).substitute_calls(copied_map);
+        Function(iter.second).mutate(&subs_calls);
     }
 
     // Populate the env with the deep-copy version
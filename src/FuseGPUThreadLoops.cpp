@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cmath>
+#include <set>
 
 #include "Bounds.h"
 #include "CSE.h"
@@ -375,7 +376,7 @@ class ExtractSharedAllocations : public IRMutator2 {
             Expr predicate = mutate(op->predicate);
             Expr index = mutate(op->index);
             shared[op->name].max = barrier_stage;
-            if (device_api == DeviceAPI::OpenGLCompute) {
+            if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
                 return Load::make(op->type, shared_mem_name + "_" + op->name,
                                   index, op->image, op->param, predicate);
             } else {
@@ -395,7 +396,7 @@ class ExtractSharedAllocations : public IRMutator2 {
             Expr predicate = mutate(op->predicate);
             Expr index = mutate(op->index);
             Expr value = mutate(op->value);
-            if (device_api == DeviceAPI::OpenGLCompute) {
+            if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
                 return Store::make(shared_mem_name + "_" + op->name, value, index,
                                    op->param, predicate);
             } else {
@@ -537,7 +538,7 @@ class ExtractSharedAllocations : public IRMutator2 {
 public:
     Stmt rewrap(Stmt s) {
 
-        if (device_api == DeviceAPI::OpenGLCompute) {
+        if (device_api == DeviceAPI::OpenGLCompute || device_api == DeviceAPI::Vulkan) {
 
             // Individual shared allocations.
             for (SharedAllocation alloc : allocations) {
@@ -588,6 +589,12 @@ public:
                 if (i > 0) {
                     offset = Variable::make(Int(32), "group_" + std::to_string(i-1) + ".shared_offset");
                     int new_elem_size = mem_allocs[i].max_type_bytes;
+                    if (device_api == DeviceAPI::OpenCL) {
+                        // Align each group to 16 bytes, so that
+                        // CodeGen_OpenCL_Dev can use aligned vector
+                        // loads and stores.
+                        new_elem_size = std::max(new_elem_size, 16);
+                    }
                     offset += (((mem_allocs[i-1].max_size_bytes + new_elem_size - 1)/new_elem_size)*new_elem_size);
                 }
                 s = LetStmt::make("group_" + std::to_string(i) + ".shared_offset", simplify(offset), s);
@@ -743,6 +750,170 @@ public:
     bool has_thread_loop = false;
 };
 
+// Compute the change in an index expression when the given thread
+// variable increases by one. Variables bound in the scope have the
+// given stride, and all other variables are assumed not to vary across
+// threads. Returns an undefined Expr if the stride is not a simple
+// function of the thread index.
+Expr thread_stride(const Expr &e, const string &var, const Scope<Expr> &strides) {
+    if (const Variable *v = e.as<Variable>()) {
+        if (v->name == var) {
+            return 1;
+        } else if (strides.contains(v->name)) {
+            return strides.get(v->name);
+        } else {
+            return 0;
+        }
+    } else if (const Add *add = e.as<Add>()) {
+        Expr a = thread_stride(add->a, var, strides);
+        Expr b = thread_stride(add->b, var, strides);
+        return (a.defined() && b.defined()) ? simplify(a + b) : Expr();
+    } else if (const Sub *sub = e.as<Sub>()) {
+        Expr a = thread_stride(sub->a, var, strides);
+        Expr b = thread_stride(sub->b, var, strides);
+        return (a.defined() && b.defined()) ? simplify(a - b) : Expr();
+    } else if (const Mul *mul = e.as<Mul>()) {
+        Expr a = thread_stride(mul->a, var, strides);
+        Expr b = thread_stride(mul->b, var, strides);
+        if (a.defined() && is_zero(b)) {
+            return simplify(a * mul->b);
+        } else if (b.defined() && is_zero(a)) {
+            return simplify(mul->a * b);
+        } else {
+            return Expr();
+        }
+    } else if (e.as<Min>() || e.as<Max>()) {
+        // Clamps to a thread-invariant bound don't change the stride
+        // of the unclamped indices.
+        Expr ea = e.as<Min>() ? e.as<Min>()->a : e.as<Max>()->a;
+        Expr eb = e.as<Min>() ? e.as<Min>()->b : e.as<Max>()->b;
+        Expr a = thread_stride(ea, var, strides);
+        Expr b = thread_stride(eb, var, strides);
+        if (!a.defined() || !b.defined()) {
+            return Expr();
+        } else if (is_zero(b) || can_prove(a == b)) {
+            return a;
+        } else if (is_zero(a)) {
+            return b;
+        } else {
+            return Expr();
+        }
+    } else if (const Cast *cast = e.as<Cast>()) {
+        if ((cast->type.is_int() || cast->type.is_uint()) &&
+            (cast->value.type().is_int() || cast->value.type().is_uint())) {
+            return thread_stride(cast->value, var, strides);
+        }
+    } else if (const Ramp *ramp = e.as<Ramp>()) {
+        return thread_stride(ramp->base, var, strides);
+    } else if (const Broadcast *broadcast = e.as<Broadcast>()) {
+        return thread_stride(broadcast->value, var, strides);
+    }
+
+    if (expr_uses_var(e, var) || expr_uses_vars(e, strides)) {
+        return Expr();
+    } else {
+        return 0;
+    }
+}
+
+// Estimate how many memory transactions each warp-wide access to
+// global memory in a fused kernel requires, assuming 128-byte cache
+// lines and warps made of 32 consecutive values of the innermost
+// thread index. Warns about accesses that are coalesced along the
+// second thread dimension instead of the first, which is usually a
+// sign that the gpu thread variables are in the wrong order.
+class MeasureCoalescing : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string kernel_name;
+    const string thread_x = "." + thread_names[0];
+    const string thread_y = "." + thread_names[1];
+    Scope<Expr> x_strides, y_strides;
+    Scope<> allocations;
+    std::set<string> warned;
+
+    void visit(const Allocate *op) {
+        ScopedBinding<> bind(allocations, op->name);
+        IRVisitor::visit(op);
+    }
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        Expr sx = thread_stride(op->value, thread_x, x_strides);
+        Expr sy = thread_stride(op->value, thread_y, y_strides);
+        ScopedBinding<Expr> bind_x(!is_zero(sx), x_strides, op->name, sx);
+        ScopedBinding<Expr> bind_y(!is_zero(sy), y_strides, op->name, sy);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) {
+        visit_let(op);
+    }
+
+    void record_access(const string &name, Type t, const Expr &index) {
+        if (allocations.contains(name)) {
+            // Shared or register memory
+            return;
+        }
+
+        const double line_size = 128;
+        double bytes_per_thread = t.bytes() * t.lanes();
+        double ideal = std::ceil(32 * bytes_per_thread / line_size);
+        double worst = 32 * std::ceil(bytes_per_thread / line_size);
+
+        Expr sx = thread_stride(index, thread_x, x_strides);
+        const int64_t *stride = sx.defined() ? as_const_int(sx) : nullptr;
+        double estimate = worst;
+        if (stride) {
+            double span = (31 * std::abs(*stride) + t.lanes()) * t.bytes();
+            estimate = std::min(worst, std::ceil(span / line_size));
+        }
+
+        debug(2) << "Access to " << name << " in kernel " << kernel_name
+                 << " has thread stride " << sx << ": " << estimate
+                 << " transactions per request\n";
+
+        accesses++;
+        transactions += estimate;
+        ideal_transactions += ideal;
+
+        Expr sy = thread_stride(index, thread_y, y_strides);
+        const int64_t *y_stride = sy.defined() ? as_const_int(sy) : nullptr;
+        if (stride && y_stride &&
+            std::abs(*stride) > t.lanes() &&
+            std::abs(*y_stride) == t.lanes() &&
+            !warned.count(name)) {
+            warned.insert(name);
+            user_warning << "Accesses to " << name << " in the GPU kernel " << kernel_name
+                         << " are not coalesced: consecutive values of the innermost gpu thread"
+                         << " variable touch elements " << *stride << " apart, but consecutive"
+                         << " values of the next gpu thread variable touch adjacent elements."
+                         << " Consider reordering the gpu thread variables.\n";
+        }
+    }
+
+    void visit(const Load *op) {
+        IRVisitor::visit(op);
+        record_access(op->name, op->type, op->index);
+    }
+
+    void visit(const Store *op) {
+        IRVisitor::visit(op);
+        record_access(op->name, op->value.type(), op->index);
+    }
+
+public:
+    int accesses = 0;
+    double transactions = 0, ideal_transactions = 0;
+
+    MeasureCoalescing(const string &k) : kernel_name(k) {}
+};
+
 class FuseGPUThreadLoopsSingleKernel : public IRMutator2 {
     using IRMutator2::visit;
     const ExtractBlockSize &block_size;
@@ -806,6 +977,18 @@ class FuseGPUThreadLoopsSingleKernel : public IRMutator2 {
             body = shared_mem.rewrap(body);
             debug(3) << "Add back in shared allocations:\n" << body << "\n\n";
 
+            if (block_size.dimensions()) {
+                MeasureCoalescing coalescing(op->name);
+                body.accept(&coalescing);
+                if (coalescing.accesses) {
+                    debug(1) << "Kernel " << op->name << " makes " << coalescing.accesses
+                             << " global memory accesses, averaging an estimated "
+                             << coalescing.transactions / coalescing.accesses
+                             << " transactions per warp-wide request (ideal: "
+                             << coalescing.ideal_transactions / coalescing.accesses << ")\n";
+                }
+            }
+
             if (body.same_as(op->body)) {
                 return op;
             } else {
@@ -869,7 +1052,8 @@ class ZeroGPULoopMins : public IRMutator2 {
         in_non_glsl_gpu = (in_non_glsl_gpu && op->device_api == DeviceAPI::None) ||
           (op->device_api == DeviceAPI::CUDA) || (op->device_api == DeviceAPI::OpenCL) ||
           (op->device_api == DeviceAPI::Metal) ||
-          (op->device_api == DeviceAPI::D3D12Compute);
+          (op->device_api == DeviceAPI::D3D12Compute) ||
+          (op->device_api == DeviceAPI::Vulkan);
 
         Stmt stmt = IRMutator2::visit(op);
         if (CodeGen_GPU_Dev::is_gpu_var(op->name) && !is_zero(op->min)) {
@@ -929,6 +1113,105 @@ Stmt zero_gpu_loop_mins(Stmt s) {
     return ZeroGPULoopMins().mutate(s);
 }
 
+namespace {
+
+class HasGPUThreadLoop : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+        result = result || CodeGen_GPU_Dev::is_gpu_thread_var(op->name);
+        IRVisitor::visit(op);
+    }
+public:
+    bool result = false;
+};
+
+// The most blocks a persistent kernel is launched with. This is about
+// the number of blocks that can be resident at once on a large GPU.
+const int max_persistent_blocks = 1024;
+
+// Flatten the loops over gpu blocks of each kernel into a single loop
+// over at most max_persistent_blocks blocks, each of which then
+// iterates over a strided subset of the original blocks.
+class MakeGPUBlocksPersistent : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        if (!CodeGen_GPU_Dev::is_gpu_block_var(op->name) ||
+            op->device_api == DeviceAPI::GLSL) {
+            return IRMutator2::visit(op);
+        }
+
+        // Gather the nest of loops over blocks, outermost first.
+        vector<const For *> loops;
+        Stmt body = op;
+        while (const For *loop = body.as<For>()) {
+            if (!CodeGen_GPU_Dev::is_gpu_block_var(loop->name)) {
+                break;
+            }
+            loops.push_back(loop);
+            body = loop->body;
+        }
+
+        Expr total = 1;
+        for (const For *loop : loops) {
+            total *= loop->extent;
+        }
+        total = simplify(total);
+        const int64_t *const_total = as_const_int(total);
+        if (const_total && *const_total <= max_persistent_blocks) {
+            // Every block can be resident at once already.
+            return op;
+        }
+
+        Expr num_blocks = simplify(min(total, max_persistent_blocks));
+        const For *innermost = loops.back();
+        string block_name = innermost->name;
+        string work_name = block_name + ".work_item";
+        Expr block = Variable::make(Int(32), block_name);
+        Expr work_item = block + Variable::make(Int(32), work_name) * num_blocks;
+
+        // Recover the original block indices from the flattened work
+        // item index. The innermost block loop varies fastest.
+        map<string, Expr> replacements;
+        Expr stride = 1;
+        for (size_t i = loops.size(); i > 0; i--) {
+            const For *loop = loops[i - 1];
+            Expr idx = work_item;
+            if (!is_one(stride)) {
+                idx = idx / stride;
+            }
+            if (i > 1) {
+                idx = idx % loop->extent;
+            }
+            replacements[loop->name] = simplify(loop->min + idx);
+            stride = simplify(stride * loop->extent);
+        }
+        body = substitute(replacements, body);
+
+        HasGPUThreadLoop has_threads;
+        body.accept(&has_threads);
+        if (has_threads.result) {
+            // Don't let threads reuse shared memory for the next work
+            // item while others may still be using it for this one.
+            Stmt barrier =
+                Evaluate::make(Call::make(Int(32), "halide_gpu_thread_barrier",
+                                          vector<Expr>(), Call::Extern));
+            body = Block::make(body, barrier);
+        }
+
+        Expr num_work_items = (total - block + num_blocks - 1) / num_blocks;
+        body = For::make(work_name, 0, num_work_items, ForType::Serial, DeviceAPI::None, body);
+        return For::make(block_name, 0, num_blocks, innermost->for_type, innermost->device_api, body);
+    }
+};
+
+}  // namespace
+
+Stmt make_gpu_blocks_persistent(Stmt s) {
+    return MakeGPUBlocksPersistent().mutate(s);
+}
+
 Stmt fuse_gpu_thread_loops(Stmt s) {
     ValidateGPULoopNesting validate;
     s.accept(&validate);
@@ -22,6 +22,12 @@ Stmt zero_gpu_loop_mins(Stmt s);
  * array. */
 Stmt fuse_gpu_thread_loops(Stmt s);
 
+/** Launch each GPU kernel with a bounded number of blocks, each of
+ * which loops over the work of several of the original blocks, as if
+ * the blocks were persistent threads pulling work from a queue. Must
+ * be run after fuse_gpu_thread_loops. */
+Stmt make_gpu_blocks_persistent(Stmt s);
+
 }  // namespace Internal
 }  // namespace Halide
 
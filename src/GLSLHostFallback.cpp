@@ -0,0 +1,88 @@
+#include "GLSLHostFallback.h"
+#include "Func.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+void reschedule_stage(Function f, Definition def, size_t stage_index, int vector_size) {
+    vector<Dim> &dims = def.schedule().dims();
+
+    // Func::glsl leaves the channel loop vectorized innermost, and
+    // the loops over x and y as GLSL blocks outside of it.
+    string x, y, c;
+    bool all_pure = true;
+    for (Dim &d : dims) {
+        if (d.device_api != DeviceAPI::GLSL) {
+            if (x.empty() && d.for_type == ForType::Vectorized) {
+                c = d.var;
+            }
+            continue;
+        }
+        all_pure = all_pure && d.is_pure() && !d.is_rvar();
+        if (x.empty()) {
+            x = d.var;
+        } else if (y.empty()) {
+            y = d.var;
+        }
+        d.device_api = DeviceAPI::None;
+        d.for_type = ForType::Serial;
+    }
+    if (x.empty()) {
+        return;
+    }
+    debug(2) << "Rescheduling GLSL stage " << stage_index << " of " << f.name()
+             << " for the host\n";
+    if (!all_pure) {
+        // Leave anything unusual serial.
+        return;
+    }
+
+    Stage s(f, def, stage_index, f.args());
+    if (!c.empty()) {
+        s.unroll(Var(c));
+    }
+    if (!y.empty()) {
+        s.parallel(Var(y));
+    }
+    if (vector_size > 1) {
+        Var xi(unique_name(x + "_vi"));
+        s.split(Var(x), Var(x), xi, vector_size, TailStrategy::GuardWithIf).vectorize(xi);
+    }
+}
+
+}  // namespace
+
+void glsl_host_fallback(map<string, Function> &env, const Target &t) {
+    if (t.has_feature(Target::OpenGL)) {
+        return;
+    }
+    for (auto &iter : env) {
+        Function f = iter.second;
+        if (f.has_extern_definition()) {
+            continue;
+        }
+        // Lowering up to this point is shared between targets that
+        // differ only in their instruction set (see lower()), so the
+        // vector width can't depend on it. 32 bytes is one vector on
+        // AVX2, and two on SSE and NEON.
+        int max_bytes = 1;
+        for (const Type &type : f.output_types()) {
+            max_bytes = std::max(max_bytes, type.bytes());
+        }
+        const int vector_size = 32 / max_bytes;
+        reschedule_stage(f, f.definition(), 0, vector_size);
+        for (size_t i = 0; i < f.updates().size(); i++) {
+            reschedule_stage(f, f.update(i), i + 1, vector_size);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
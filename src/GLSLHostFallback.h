@@ -0,0 +1,29 @@
+#ifndef HALIDE_GLSL_HOST_FALLBACK_H
+#define HALIDE_GLSL_HOST_FALLBACK_H
+
+/** \file
+ * Defines a lowering pass that reschedules GLSL stages to run on the
+ * CPU when compiling for a target without OpenGL.
+ */
+
+#include <map>
+
+#include "Function.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** If the target does not have the OpenGL feature, replace the GLSL
+ * schedule of each stage scheduled with Func::glsl with a vectorized
+ * CPU schedule derived from it: the loop over y becomes parallel,
+ * the loop over x is vectorized 32 bytes wide, and the loop over the
+ * color channel is unrolled. This lets
+ * one algorithm and schedule be compiled for both GL and GL-less
+ * targets, e.g. as the variants of a multitarget library. */
+void glsl_host_fallback(std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,8 +1,12 @@
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <set>
+#include <sstream>
 
+#include "AutoSchedule.h"
 #include "Generator.h"
+#include "Lower.h"
 #include "Outputs.h"
 #include "Simplify.h"
 
@@ -120,6 +124,9 @@ Outputs compute_outputs(const Target &target,
     if (options.emit_schedule) {
         output_files.schedule_name = base_path + get_extension(".schedule", options);
     }
+    if (options.emit_serialized_pipeline) {
+        output_files.serialized_pipeline_name = base_path + get_extension(".hlpipe", options);
+    }
     return output_files;
 }
 
@@ -155,6 +162,51 @@ Func make_param_func(const Parameter &p, const std::string &name) {
     return f;
 }
 
+// Read a profile of argument values written by RunGen's
+// --record_shapes flag, one line per call, e.g.:
+//   input=[1920,1080,3] output=[1920,1080,3] sigma=1.5
+// and return the most common shapes of each buffer, most common first.
+std::map<std::string, std::vector<std::vector<int>>> read_shape_profile(const std::string &path,
+                                                                        size_t max_shapes) {
+    std::ifstream f(path);
+    user_assert(f.is_open()) << "Unable to open shape profile " << path << "\n";
+
+    // The number of times each shape was seen, and the line on which
+    // it was first seen, to break ties.
+    std::map<std::string, std::map<std::vector<int>, std::pair<int, int>>> counts;
+    std::string line;
+    for (int line_number = 0; std::getline(f, line); line_number++) {
+        std::istringstream tokens(line);
+        std::string token;
+        while (tokens >> token) {
+            std::vector<std::string> v = split_string(token, "=");
+            if (v.size() != 2 || v[1].size() < 2 || v[1].front() != '[' || v[1].back() != ']') {
+                // Scalar arguments are recorded too, but not used yet.
+                continue;
+            }
+            std::vector<int> shape;
+            for (const std::string &e : split_string(v[1].substr(1, v[1].size() - 2), ",")) {
+                shape.push_back(std::atoi(e.c_str()));
+            }
+            auto it = counts[v[0]].emplace(shape, std::make_pair(0, line_number)).first;
+            it->second.first++;
+        }
+    }
+
+    std::map<std::string, std::vector<std::vector<int>>> result;
+    for (const auto &c : counts) {
+        std::vector<std::pair<std::pair<int, int>, std::vector<int>>> by_count;
+        for (const auto &s : c.second) {
+            by_count.push_back({{-s.second.first, s.second.second}, s.first});
+        }
+        std::sort(by_count.begin(), by_count.end());
+        for (size_t i = 0; i < by_count.size() && i < max_shapes; i++) {
+            result[c.first].push_back(by_count[i].second);
+        }
+    }
+    return result;
+}
+
 }  // namespace
 
 std::vector<Type> parse_halide_type_list(const std::string &types) {
@@ -687,7 +739,8 @@ void StubEmitter::emit() {
 
 GeneratorStub::GeneratorStub(const GeneratorContext &context,
                              GeneratorFactory generator_factory)
-    : generator(generator_factory(context)) {}
+    : generator(generator_factory(context)),
+      top_level(dynamic_cast<const GeneratorBase *>(&context) == nullptr) {}
 
 GeneratorStub::GeneratorStub(const GeneratorContext &context,
                              GeneratorFactory generator_factory,
@@ -706,6 +759,9 @@ std::vector<std::vector<Func>> GeneratorStub::generate(const GeneratorParamsMap
     generator->set_generator_param_values(generator_params);
     generator->set_inputs_vector(inputs);
     Pipeline p = generator->build_pipeline();
+    if (top_level && generator->get_auto_schedule()) {
+        auto_schedule_result = generator->auto_schedule_pipeline(p);
+    }
 
     std::vector<std::vector<Func>> v;
     GeneratorBase::ParamInfo &pi = generator->param_info();
@@ -755,7 +811,8 @@ const std::map<std::string, Type> &get_halide_type_enum_map() {
         {"uint16", UInt(16)},
         {"uint32", UInt(32)},
         {"float32", Float(32)},
-        {"float64", Float(64)}
+        {"float64", Float(64)},
+        {"bfloat16", BFloat(16)}
     };
     return halide_type_enum_map;
 }
@@ -766,6 +823,7 @@ std::string halide_type_to_c_source(const Type &t) {
         { halide_type_uint, "UInt" },
         { halide_type_float, "Float" },
         { halide_type_handle, "Handle" },
+        { halide_type_bfloat, "BFloat" },
     };
     std::ostringstream oss;
     oss << "Halide::" << m.at(t.code()) << "(" << t.bits() << + ")";
@@ -793,12 +851,17 @@ std::string halide_type_to_c_type(const Type &t) {
 }
 
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
-    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] "
+    const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] [-n FILE_BASE_NAME] [-s AUTO_SCHEDULE_CACHE_DIR] [-p SHAPE_PROFILE] "
                           "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
                           "  -e  A comma separated list of files to emit. Accepted values are "
-                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule]. If omitted, default value is [static_library, h].\n"
+                          "[assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, serialized_pipeline]. If omitted, default value is [static_library, h]. "
+                          "serialized_pipeline requires a target with the jit and user_context features.\n"
                           "  -x  A comma separated list of file extension pairs to substitute during file naming, "
-                          "in the form [.old=.new[,.old2=.new2]]\n";
+                          "in the form [.old=.new[,.old2=.new2]]\n"
+                          "  -s  A directory in which to save the schedules chosen when auto_schedule=true, "
+                          "and from which to reuse them on later builds of an unchanged pipeline.\n"
+                          "  -p  A profile of argument values recorded by RunGen's --record_shapes flag. Each output "
+                          "is specialized for the shapes it was most often called with.\n";
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -806,6 +869,8 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                                                       { "-e", "" },
                                                       { "-n", "" },
                                                       { "-x", "" },
+                                                      { "-s", "" },
+                                                      { "-p", "" },
                                                       { "-r", "" }};
     GeneratorParamsMap generator_args;
 
@@ -915,9 +980,11 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
                 emit_options.emit_cpp_stub = true;
             } else if (opt == "schedule") {
                 emit_options.emit_schedule = true;
+            } else if (opt == "serialized_pipeline") {
+                emit_options.emit_serialized_pipeline = true;
             } else if (!opt.empty()) {
                 cerr << "Unrecognized emit option: " << opt
-                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub], ignoring.\n";
+                     << " not one of [assembly, bitcode, cpp, h, html, o, static_library, stmt, cpp_stub, schedule, serialized_pipeline], ignoring.\n";
             }
         }
     }
@@ -965,13 +1032,23 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         // Don't bother with this if we're just emitting a cpp_stub.
         if (!stub_only) {
             Outputs output_files = compute_outputs(targets[0], base_path, emit_options);
-            auto module_producer = [&generator_name, &generator_args]
+            const std::string auto_schedule_cache_dir = flags_info["-s"];
+            const std::string shape_profile = flags_info["-p"];
+            // The generator is rebuilt for each target, but if the
+            // Funcs it builds don't depend on the target's instruction
+            // set, the first half of lowering can be shared.
+            auto lowering_prefix_cache = std::make_shared<LoweringPrefixCache>();
+            auto module_producer = [&generator_name, &generator_args, &auto_schedule_cache_dir, &shape_profile,
+                                    &lowering_prefix_cache]
                 (const std::string &name, const Target &target) -> Module {
                     auto sub_generator_args = generator_args;
                     sub_generator_args.erase("target");
                     // Must re-create each time since each instance will have a different Target.
                     auto gen = GeneratorRegistry::create(generator_name, GeneratorContext(target));
                     gen->set_generator_param_values(sub_generator_args);
+                    gen->set_auto_schedule_cache_dir(auto_schedule_cache_dir);
+                    gen->set_shape_profile(shape_profile);
+                    gen->set_lowering_prefix_cache(lowering_prefix_cache);
                     return gen->build_module(name);
                 };
             if (targets.size() > 1 || !emit_options.substitutions.empty()) {
@@ -1401,12 +1478,61 @@ Pipeline GeneratorBase::get_pipeline() {
     return pipeline;
 }
 
+std::string GeneratorBase::auto_schedule_pipeline(Pipeline pipeline) {
+    if (auto_schedule_cache_dir.empty()) {
+        return pipeline.auto_schedule(get_target(), get_machine_params());
+    }
+    std::vector<Internal::Function> outputs;
+    for (Func f : pipeline.outputs()) {
+        outputs.push_back(f.function());
+    }
+    return Internal::generate_schedules_cached(outputs, get_target(), get_machine_params(),
+                                               auto_schedule_cache_dir);
+}
+
 Module GeneratorBase::build_module(const std::string &function_name,
                                    const LinkageType linkage_type) {
     std::string auto_schedule_result;
     Pipeline pipeline = build_pipeline();
     if (get_auto_schedule()) {
-        auto_schedule_result = pipeline.auto_schedule(get_target(), get_machine_params());
+        auto_schedule_result = auto_schedule_pipeline(pipeline);
+    }
+
+    if (!shape_profile.empty()) {
+        // Specialize each output for the shapes it was most often
+        // called with. This comes after any auto-scheduling, so the
+        // specializations get the same schedule as the general case.
+        const size_t max_shapes = 4;
+        auto shapes = read_shape_profile(shape_profile, max_shapes);
+        std::map<std::string, Func> outputs_by_name;
+        if (param_info().filter_outputs.empty()) {
+            for (Func f : pipeline.outputs()) {
+                outputs_by_name[f.name()] = f;
+            }
+        } else {
+            for (auto *output : param_info().filter_outputs) {
+                for (size_t i = 0; i < output->funcs().size(); ++i) {
+                    outputs_by_name[output->array_name(i)] = output->funcs()[i];
+                }
+            }
+        }
+        for (auto &o : outputs_by_name) {
+            auto it = shapes.find(o.first);
+            if (it == shapes.end()) {
+                continue;
+            }
+            Func f = o.second;
+            std::vector<std::vector<int>> hot;
+            for (const auto &s : it->second) {
+                if (!s.empty() && (int)s.size() <= f.dimensions()) {
+                    hot.push_back(s);
+                }
+            }
+            if (hot.empty()) {
+                continue;
+            }
+            f.specialize_shapes(hot, get_target().natural_vector_size(f.output_types()[0]));
+        }
     }
 
     // Special-case here: for certain legacy Generators, building the pipeline
@@ -1429,7 +1555,16 @@ Module GeneratorBase::build_module(const std::string &function_name,
         }
     }
 
+    if (lowering_prefix_cache) {
+        pipeline.set_lowering_prefix_cache(lowering_prefix_cache);
+    }
     Module result = pipeline.compile_to_module(filter_arguments, function_name, target, linkage_type);
+    // The generator is rebuilt for each target, so nothing else the
+    // Pipeline cached while lowering will be used again. Drop it
+    // before code generation rather than holding it until the
+    // generator is destroyed. A shared lowering prefix cache is kept
+    // alive by whoever set it.
+    pipeline.invalidate_cache();
     std::shared_ptr<ExternsMap> externs_map = get_externs_map();
     for (const auto &map_entry : *externs_map) {
         result.append(map_entry.second);
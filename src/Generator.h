@@ -1506,6 +1506,15 @@ public:
         return *this;
     }
 
+    /** Promise that this input always has the given constant extents,
+     * zero mins and dense strides. See
+     * OutputImageParam::set_static_shape. (Not forwarded with the
+     * other methods below so that it can take a braced list.) */
+    GeneratorInput_Buffer<T> &set_static_shape(const std::vector<int> &extents) {
+        this->template as<ImageParam>().set_static_shape(extents);
+        return *this;
+    }
+
     Func in() {
         return Func(*this).in();
     }
@@ -1928,6 +1937,7 @@ public:
     HALIDE_FORWARD_METHOD(Func, shader)
     HALIDE_FORWARD_METHOD(Func, specialize)
     HALIDE_FORWARD_METHOD(Func, specialize_fail)
+    HALIDE_FORWARD_METHOD(Func, specialize_shapes)
     HALIDE_FORWARD_METHOD(Func, split)
     HALIDE_FORWARD_METHOD(Func, store_at)
     HALIDE_FORWARD_METHOD(Func, store_root)
@@ -2190,6 +2200,14 @@ public:
         return this->funcs_.at(0).output_buffer();
     }
 
+    /** Promise that this output always has the given constant
+     * extents, zero mins and dense strides. See
+     * OutputImageParam::set_static_shape. */
+    GeneratorOutput_Buffer<T> &set_static_shape(const std::vector<int> &extents) {
+        this->template as<OutputImageParam>().set_static_shape(extents);
+        return *this;
+    }
+
     /** Forward methods to the OutputImageParam. */
     // @{
     HALIDE_FORWARD_METHOD(OutputImageParam, dim)
@@ -2633,6 +2651,7 @@ public:
         bool emit_static_library{true};
         bool emit_cpp_stub{false};
         bool emit_schedule{false};
+        bool emit_serialized_pipeline{false};
 
         // This is an optional map used to replace the default extensions generated for
         // a file: if an key matches an output extension, emit those files with the
@@ -2662,6 +2681,30 @@ public:
 
     void emit_cpp_stub(const std::string &stub_file_path);
 
+    /** If auto_schedule is true, save the schedules generated by
+     * build_module() in this directory, and reuse them instead of
+     * running the auto-scheduler again when a later build has the same
+     * algorithm, estimates, target and machine_params. */
+    void set_auto_schedule_cache_dir(const std::string &dir) {
+        auto_schedule_cache_dir = dir;
+    }
+
+    /** Specialize the outputs built by build_module() for the shapes
+     * they were most often called with, according to a profile
+     * recorded by RunGen's --record_shapes flag. See
+     * Func::specialize_shapes. */
+    void set_shape_profile(const std::string &path) {
+        shape_profile = path;
+    }
+
+    /** Share the first half of lowering done by build_module() with
+     * other Generators using the same cache, e.g. the ones GenGen
+     * makes for each target of a multitarget build. See
+     * Pipeline::set_lowering_prefix_cache. */
+    void set_lowering_prefix_cache(std::shared_ptr<Internal::LoweringPrefixCache> cache) {
+        lowering_prefix_cache = std::move(cache);
+    }
+
     // Call build() and produce a Module for the result.
     // If function_name is empty, generator_name() will be used for the function.
     Module build_module(const std::string &function_name = "",
@@ -2807,6 +2850,9 @@ private:
 
     bool inputs_set{false};
     std::string generator_registered_name, generator_stub_name;
+    std::string auto_schedule_cache_dir;
+    std::shared_ptr<Internal::LoweringPrefixCache> lowering_prefix_cache;
+    std::string shape_profile;
     Pipeline pipeline;
 
     // Return our ParamInfo (lazy-initing as needed).
@@ -2818,6 +2864,11 @@ private:
 
     void build_params(bool force = false);
 
+    // Run the auto-scheduler over the given pipeline, reusing a cached
+    // schedule if an auto_schedule_cache_dir was set. Returns the
+    // schedule source.
+    std::string auto_schedule_pipeline(Pipeline pipeline);
+
     // Provide private, unimplemented, wrong-result-type methods here
     // so that Generators don't attempt to call the global methods
     // of the same name by accident: use the get_target() method instead.
@@ -3206,6 +3257,20 @@ public:
                          GeneratorFactory generator_factory,
                          const GeneratorParamsMap &generator_params,
                          const std::vector<std::vector<Internal::StubInput>> &inputs);
+    // Build the stub's sub-pipeline by calling the Generator's generate()
+    // and schedule() methods, so the stub's outputs carry the schedule
+    // (and the Output estimates) the Generator gives them.
+    //
+    // If the stub was created with a top-level GeneratorContext with
+    // auto_schedule set, the sub-pipeline is also auto-scheduled here,
+    // using the estimates on its Inputs and Outputs. The outputs are
+    // then computed at root by default, but may be scheduled
+    // compute_at() a consumer instead; the loop nests of the stages the
+    // auto-scheduler placed inside them move with them. A stub created
+    // from within a Generator is never auto-scheduled separately: if
+    // the enclosing Generator is auto-scheduled, the whole composed
+    // pipeline is scheduled at once, so stages can be fused across the
+    // stub boundary.
     std::vector<std::vector<Func>> generate(const GeneratorParamsMap &generator_params,
                          const std::vector<std::vector<Internal::StubInput>> &inputs);
 
@@ -3259,7 +3324,19 @@ public:
     };
     Names get_names() const;
 
+    /** The schedule source chosen for this stub's sub-pipeline, if it
+     * was auto-scheduled (see generate()); empty otherwise. */
+    const std::string &get_auto_schedule() const {
+        return auto_schedule_result;
+    }
+
     std::shared_ptr<GeneratorBase> generator;
+
+private:
+    // True if the stub was created from a top-level GeneratorContext,
+    // rather than from within an enclosing Generator.
+    bool top_level;
+    std::string auto_schedule_result;
 };
 
 }  // namespace Internal
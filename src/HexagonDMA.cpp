@@ -0,0 +1,153 @@
+#include "HexagonDMA.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+class InjectHexagonDMA : public IRMutator2 {
+    const map<string, Function> &env;
+    bool in_hexagon = false;
+    string producing;
+
+    using IRMutator2::visit;
+
+    bool is_dma_func(const string &name) {
+        auto it = env.find(name);
+        return it != env.end() && it->second.schedule().hexagon_dma();
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (!op->is_producer || !in_hexagon || !is_dma_func(op->name)) {
+            return IRMutator2::visit(op);
+        }
+        user_assert(env.at(op->name).schedule().memory_type() == MemoryType::VTCM)
+            << "Func " << op->name << " is scheduled with hexagon_dma(), "
+            << "so it must be stored in MemoryType::VTCM\n";
+        string old_producing = producing;
+        producing = op->name;
+        Stmt body = mutate(op->body);
+        producing = old_producing;
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+    // The change in an index when a loop variable goes up by one.
+    Expr stride_of(const Expr &index, const string &var) {
+        Expr v = Variable::make(Int(32), var);
+        return simplify(substitute(var, v + 1, index) - index);
+    }
+
+    // Try to replace a nest of one or two loops that copies an input
+    // buffer into the Func being produced with a DMA copy.
+    Stmt make_dma_copy(const For *op) {
+        vector<const For *> loops;
+        vector<std::pair<string, Expr>> lets;
+        Stmt body = op;
+        while (true) {
+            if (const For *f = body.as<For>()) {
+                if (f->for_type == ForType::Parallel || loops.size() == 2) {
+                    return Stmt();
+                }
+                loops.push_back(f);
+                body = f->body;
+            } else if (const LetStmt *let = body.as<LetStmt>()) {
+                lets.emplace_back(let->name, let->value);
+                body = let->body;
+            } else {
+                break;
+            }
+        }
+
+        const Store *store = body.as<Store>();
+        const Load *load = store ? store->value.as<Load>() : nullptr;
+        user_assert(store && load && store->name == producing &&
+                    is_one(store->predicate) && is_one(load->predicate) &&
+                    (load->image.defined() || load->param.defined()))
+            << "Func " << producing << " is scheduled with hexagon_dma(), "
+            << "but it is not a copy of an input buffer\n";
+
+        auto substitute_lets = [&](Expr e) {
+            for (auto i = lets.rbegin(); i != lets.rend(); i++) {
+                e = substitute(i->first, i->second, e);
+            }
+            return e;
+        };
+        Expr dst = substitute_lets(store->index);
+        Expr src = substitute_lets(load->index);
+
+        // The innermost loop must be dense in both buffers, and the
+        // outer one (if any) must have a constant stride.
+        const For *inner = loops.back();
+        const For *outer = loops.size() == 2 ? loops[0] : nullptr;
+        user_assert(is_one(stride_of(dst, inner->name)) && is_one(stride_of(src, inner->name)))
+            << "Func " << producing << " is scheduled with hexagon_dma(), "
+            << "but its innermost dimension is not dense\n";
+        Expr dst_stride = 0, src_stride = 0, height = 1;
+        if (outer) {
+            dst_stride = stride_of(dst, outer->name);
+            src_stride = stride_of(src, outer->name);
+            for (const For *f : loops) {
+                user_assert(!expr_uses_var(dst_stride, f->name) && !expr_uses_var(src_stride, f->name))
+                    << "Func " << producing << " is scheduled with hexagon_dma(), "
+                    << "but its rows are not a constant distance apart\n";
+            }
+            height = outer->extent;
+        }
+
+        // The offsets of the first element copied.
+        for (const For *f : loops) {
+            Expr min = substitute_lets(f->min);
+            dst = substitute(f->name, min, dst);
+            src = substitute(f->name, min, src);
+        }
+
+        int bytes = load->type.bytes();
+        Expr dma = Call::make(Int(32), "halide_hexagon_user_dma_copy_2d",
+                              {Variable::make(Handle(), store->name), simplify(dst * bytes),
+                               Variable::make(Handle(), load->name), simplify(src * bytes),
+                               substitute_lets(inner->extent) * bytes, height,
+                               dst_stride * bytes, src_stride * bytes},
+                              Call::Extern);
+        string result_name = unique_name("dma_result");
+        Expr result = Variable::make(Int(32), result_name);
+        return LetStmt::make(result_name, dma, AssertStmt::make(result == 0, result));
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api == DeviceAPI::Hexagon) {
+            bool old_in_hexagon = in_hexagon;
+            in_hexagon = true;
+            Stmt s = IRMutator2::visit(op);
+            in_hexagon = old_in_hexagon;
+            return s;
+        }
+        if (!producing.empty()) {
+            Stmt copy = make_dma_copy(op);
+            if (copy.defined()) {
+                return copy;
+            }
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    InjectHexagonDMA(const map<string, Function> &env) : env(env) {}
+};
+
+}  // namespace
+
+Stmt inject_hexagon_dma(const Stmt &s, const map<string, Function> &env) {
+    return InjectHexagonDMA(env).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,28 @@
+#ifndef HALIDE_HEXAGON_DMA_H
+#define HALIDE_HEXAGON_DMA_H
+
+/** \file
+ * Defines the lowering pass that does copies scheduled with
+ * Func::hexagon_dma with the Hexagon user DMA engine.
+ */
+
+#include <map>
+#include <string>
+
+#include "Function.h"
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace the loops that produce each Func scheduled with
+ * Func::hexagon_dma inside a Hexagon offloaded loop with a call to
+ * the runtime that does the copy with the user DMA engine, which is
+ * available on v66 and later. Must run
+ * after storage flattening, and before vectorization. */
+Stmt inject_hexagon_dma(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
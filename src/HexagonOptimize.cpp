@@ -1754,6 +1754,64 @@ public:
     OptimizeShuffles(int lut_alignment) : lut_alignment(lut_alignment) {}
 };
 
+// Replace stores to VTCM of data-dependent loads from VTCM with the
+// vgather instructions available on v65 and later.
+class VgatherGenerator : public IRMutator2 {
+    int native_vector_bytes;
+    Scope<const Allocate *> vtcm_allocations;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type != MemoryType::VTCM) {
+            return IRMutator2::visit(op);
+        }
+        vtcm_allocations.push(op->name, op);
+        Stmt s = IRMutator2::visit(op);
+        vtcm_allocations.pop(op->name);
+        return s;
+    }
+
+    Stmt visit(const Store *op) override {
+        const Load *load = op->value.as<Load>();
+        const Ramp *ramp = op->index.as<Ramp>();
+        // vgather reads from and writes to VTCM, and stores whole
+        // vectors. Predicated vgathers are not supported yet.
+        if (!load || !ramp || !is_one(ramp->stride) || load->index.as<Ramp>() ||
+            !is_one(op->predicate) || !is_one(load->predicate) ||
+            !vtcm_allocations.contains(op->name) ||
+            !vtcm_allocations.contains(load->name)) {
+            return IRMutator2::visit(op);
+        }
+
+        // There are only gathers of 16 and 32-bit elements.
+        Type t = load->type;
+        if ((t.bits() != 16 && t.bits() != 32) ||
+            t.lanes() % (native_vector_bytes / t.bytes()) != 0) {
+            return IRMutator2::visit(op);
+        }
+
+        // vgather takes the offsets in bytes, and the size of the
+        // region they may be in, less one.
+        const Allocate *src = vtcm_allocations.get(load->name);
+        Expr src_size = src->type.bytes();
+        for (const Expr &e : src->extents) {
+            src_size *= e;
+        }
+        Expr offsets = cast(Int(32, t.lanes()), load->index) * t.bytes();
+
+        Expr gather = Call::make(t, "gather",
+                                 {Variable::make(Handle(), op->name), ramp->base,
+                                  Variable::make(Handle(), load->name),
+                                  simplify(src_size - 1), offsets},
+                                 Call::Intrinsic);
+        return Evaluate::make(gather);
+    }
+
+public:
+    VgatherGenerator(int native_vector_bytes) : native_vector_bytes(native_vector_bytes) {}
+};
+
 // Attempt to generate vtmpy instructions. This requires that all lets
 // be substituted prior to running, and so must be an IRGraphMutator2.
 class VtmpyGenerator : public IRGraphMutator2 {
@@ -2009,6 +2067,10 @@ Stmt optimize_hexagon_shuffles(Stmt s, int lut_alignment) {
     return OptimizeShuffles(lut_alignment).mutate(s);
 }
 
+Stmt vgather_generator(Stmt s, int native_vector_bytes) {
+    return VgatherGenerator(native_vector_bytes).mutate(s);
+}
+
 Stmt vtmpy_generator(Stmt s) {
     // Generate vtmpy instruction if possible
     s = substitute_in_all_lets(s);
@@ -15,6 +15,10 @@ namespace Internal {
  * calls. */
 Stmt optimize_hexagon_shuffles(Stmt s, int lut_alignment);
 
+/** Replace stores to VTCM of data-dependent loads from VTCM with
+ * vgather calls. Requires HVX v65 or later. */
+Stmt vgather_generator(Stmt s, int native_vector_bytes);
+
 /** Generate vtmpy instruction if possible */
 Stmt vtmpy_generator(Stmt s);
 
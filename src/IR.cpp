@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include "IR.h"
 #include "IRMutator.h"
 #include "IRPrinter.h"
@@ -6,6 +8,133 @@
 namespace Halide {
 namespace Internal {
 
+namespace {
+
+// Pooled IR node blocks are a multiple of this size, up to
+// kNodeAlignment * kNumSizeClasses bytes. Larger nodes use the heap.
+const size_t kNodeAlignment = 16;
+const size_t kNumSizeClasses = 16;
+const size_t kChunkBytes = 64 * 1024;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// Free blocks given back by threads that have exited, kept as whole
+// lists per size class, and every chunk ever allocated. The pools
+// never shrink, so the chunks stay reachable.
+struct SharedPool {
+    std::mutex lock;
+    std::vector<void *> chunks;
+    std::vector<FreeBlock *> lists[kNumSizeClasses];
+};
+
+// Made on first use, so that IR built during static initialization of
+// another translation unit can use it, and never destroyed, so that
+// threads exiting during shutdown can still give their lists back.
+SharedPool &shared_pool() {
+    static SharedPool *pool = new SharedPool;
+    return *pool;
+}
+
+// Each thread allocates from, and frees to, its own lists, so no
+// locking is needed on the fast path. A node freed on a different
+// thread than the one that made it joins the freeing thread's list.
+// When the thread exits its lists go to the shared pool for reuse.
+struct LocalFreeLists {
+    FreeBlock *lists[kNumSizeClasses] = {};
+    // Set once this thread's thread_local destructors have run. Any
+    // nodes freed after that go straight back to the shared pool.
+    bool exited = false;
+
+    void give_back(size_t c) {
+        if (lists[c]) {
+            SharedPool &pool = shared_pool();
+            std::lock_guard<std::mutex> lock(pool.lock);
+            pool.lists[c].push_back(lists[c]);
+            lists[c] = nullptr;
+        }
+    }
+
+    ~LocalFreeLists() {
+        for (size_t c = 0; c < kNumSizeClasses; c++) {
+            give_back(c);
+        }
+        exited = true;
+    }
+};
+
+thread_local LocalFreeLists free_lists;
+
+bool use_node_pool() {
+    static const bool use_pool = get_env_variable("HL_NO_IR_NODE_POOL").empty();
+    return use_pool;
+}
+
+size_t size_class(size_t size) {
+    return (size + kNodeAlignment - 1) / kNodeAlignment - 1;
+}
+
+void refill(size_t c) {
+    SharedPool &pool = shared_pool();
+    {
+        // Reuse a list left behind by an exited thread if there is one.
+        std::lock_guard<std::mutex> lock(pool.lock);
+        if (!pool.lists[c].empty()) {
+            free_lists.lists[c] = pool.lists[c].back();
+            pool.lists[c].pop_back();
+            return;
+        }
+    }
+    const size_t block = (c + 1) * kNodeAlignment;
+    char *chunk = (char *)::operator new(kChunkBytes);
+    {
+        std::lock_guard<std::mutex> lock(pool.lock);
+        pool.chunks.push_back(chunk);
+    }
+    FreeBlock *head = nullptr;
+    for (size_t offset = 0; offset + block <= kChunkBytes; offset += block) {
+        FreeBlock *b = (FreeBlock *)(chunk + offset);
+        b->next = head;
+        head = b;
+    }
+    free_lists.lists[c] = head;
+}
+
+}  // namespace
+
+void *IRNode::operator new(size_t size) {
+    size_t c = size_class(size);
+    if (c >= kNumSizeClasses || !use_node_pool()) {
+        return ::operator new(size);
+    }
+    LocalFreeLists &local = free_lists;
+    if (!local.lists[c]) {
+        refill(c);
+    }
+    FreeBlock *b = local.lists[c];
+    local.lists[c] = b->next;
+    if (local.exited) {
+        local.give_back(c);
+    }
+    return b;
+}
+
+void IRNode::operator delete(void *ptr, size_t size) {
+    size_t c = size_class(size);
+    if (c >= kNumSizeClasses || !use_node_pool()) {
+        ::operator delete(ptr);
+        return;
+    }
+    LocalFreeLists &local = free_lists;
+    FreeBlock *b = (FreeBlock *)ptr;
+    b->next = local.lists[c];
+    local.lists[c] = b;
+    if (local.exited) {
+        local.give_back(c);
+    }
+}
+
 Expr Cast::make(Type t, Expr v) {
     internal_assert(v.defined()) << "Cast of undefined\n";
     internal_assert(t.lanes() == v.type().lanes()) << "Cast may not change vector widths\n";
@@ -517,6 +646,16 @@ Stmt Block::make(const std::vector<Stmt> &stmts) {
     return result;
 }
 
+Stmt Fork::make(Stmt first, Stmt rest) {
+    internal_assert(first.defined()) << "Fork of undefined\n";
+    internal_assert(rest.defined()) << "Fork of undefined\n";
+
+    Fork *node = new Fork;
+    node->first = std::move(first);
+    node->rest = std::move(rest);
+    return node;
+}
+
 Stmt IfThenElse::make(Expr condition, Stmt then_case, Stmt else_case) {
     internal_assert(condition.defined() && then_case.defined()) << "IfThenElse of undefined\n";
     // else_case may be null.
@@ -550,8 +689,8 @@ Expr Call::make(Type type, const std::string &name, const std::vector<Expr> &arg
                 FunctionPtr func, int value_index,
                 Buffer<> image, Parameter param) {
     if (name == Call::prefetch && call_type == Call::Intrinsic) {
-        internal_assert(args.size() % 2 == 0)
-            << "Number of args to a prefetch call should be even: {base, offset, extent0, stride0, extent1, stride1, ...}\n";
+        internal_assert(args.size() % 2 == 1)
+            << "Number of args to a prefetch call should be odd: {base, offset, locality, extent0, stride0, extent1, stride1, ...}\n";
     }
     for (size_t i = 0; i < args.size(); i++) {
         internal_assert(args[i].defined()) << "Call of " << name << " with argument " << i << " undefined.\n";
@@ -787,6 +926,7 @@ template<> void StmtNode<Block>::accept(IRVisitor *v) const { v->visit((const Bl
 template<> void StmtNode<IfThenElse>::accept(IRVisitor *v) const { v->visit((const IfThenElse *)this); }
 template<> void StmtNode<Evaluate>::accept(IRVisitor *v) const { v->visit((const Evaluate *)this); }
 template<> void StmtNode<Prefetch>::accept(IRVisitor *v) const { v->visit((const Prefetch *)this); }
+template<> void StmtNode<Fork>::accept(IRVisitor *v) const { v->visit((const Fork *)this); }
 
 template<> Expr ExprNode<IntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const IntImm *)this); }
 template<> Expr ExprNode<UIntImm>::mutate_expr(IRMutator2 *v) const { return v->visit((const UIntImm *)this); }
@@ -831,6 +971,7 @@ template<> Stmt StmtNode<Block>::mutate_stmt(IRMutator2 *v) const { return v->vi
 template<> Stmt StmtNode<IfThenElse>::mutate_stmt(IRMutator2 *v) const { return v->visit((const IfThenElse *)this); }
 template<> Stmt StmtNode<Evaluate>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Evaluate *)this); }
 template<> Stmt StmtNode<Prefetch>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Prefetch *)this); }
+template<> Stmt StmtNode<Fork>::mutate_stmt(IRMutator2 *v) const { return v->visit((const Fork *)this); }
 
 
 Call::ConstString Call::debug_to_file = "debug_to_file";
@@ -843,6 +984,10 @@ Call::ConstString Call::shift_left = "shift_left";
 Call::ConstString Call::shift_right = "shift_right";
 Call::ConstString Call::abs = "abs";
 Call::ConstString Call::absd = "absd";
+Call::ConstString Call::saturating_add = "saturating_add";
+Call::ConstString Call::saturating_sub = "saturating_sub";
+Call::ConstString Call::rounding_shift_right = "rounding_shift_right";
+Call::ConstString Call::saturating_rounding_doubling_high_multiply = "saturating_rounding_doubling_high_multiply";
 Call::ConstString Call::lerp = "lerp";
 Call::ConstString Call::random = "random";
 Call::ConstString Call::popcount = "popcount";
@@ -879,6 +1024,8 @@ Call::ConstString Call::strict_float = "strict_float";
 Call::ConstString Call::quiet_div = "quiet_div";
 Call::ConstString Call::quiet_mod = "quiet_mod";
 Call::ConstString Call::unsafe_promise_clamped = "unsafe_promise_clamped";
+Call::ConstString Call::atomic_update = "atomic_update";
+Call::ConstString Call::streaming_store = "streaming_store";
 
 Call::ConstString Call::buffer_get_dimensions = "_halide_buffer_get_dimensions";
 Call::ConstString Call::buffer_get_min = "_halide_buffer_get_min";
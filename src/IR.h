@@ -429,6 +429,19 @@ struct Block : public StmtNode<Block> {
     static const IRNodeType _node_type = IRNodeType::Block;
 };
 
+/** Run two statements concurrently. 'first' and 'rest' may block on
+ * semaphores released by each other, so they must each get their
+ * own thread. Execution continues once both have completed. Used to
+ * run async producers alongside their consumers (see
+ * Func::async). */
+struct Fork : public StmtNode<Fork> {
+    Stmt first, rest;
+
+    static Stmt make(Stmt first, Stmt rest);
+
+    static const IRNodeType _node_type = IRNodeType::Fork;
+};
+
 /** An if-then-else block. 'else' may be undefined. */
 struct IfThenElse : public StmtNode<IfThenElse> {
     Expr condition;
@@ -484,6 +497,10 @@ struct Call : public ExprNode<Call> {
         shift_right,
         abs,
         absd,
+        saturating_add,
+        saturating_sub,
+        rounding_shift_right,
+        saturating_rounding_doubling_high_multiply,
         rewrite_buffer,
         random,
         lerp,
@@ -520,7 +537,9 @@ struct Call : public ExprNode<Call> {
         strict_float,
         quiet_div,
         quiet_mod,
-        unsafe_promise_clamped;
+        unsafe_promise_clamped,
+        atomic_update,
+        streaming_store;
 
     // We also declare some symbolic names for some of the runtime
     // functions that we want to construct Call nodes to here to avoid
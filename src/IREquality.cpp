@@ -86,6 +86,7 @@ private:
     void visit(const Free *);
     void visit(const Realize *);
     void visit(const Block *);
+    void visit(const Fork *);
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
     void visit(const Shuffle *);
@@ -479,6 +480,13 @@ void IRComparer::visit(const Block *op) {
     compare_stmt(s->rest, op->rest);
 }
 
+void IRComparer::visit(const Fork *op) {
+    const Fork *s = stmt.as<Fork>();
+
+    compare_stmt(s->first, op->first);
+    compare_stmt(s->rest, op->rest);
+}
+
 void IRComparer::visit(const Free *op) {
     const Free *s = stmt.as<Free>();
 
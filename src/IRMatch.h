@@ -170,6 +170,7 @@ Expr make_const_expr(halide_scalar_value_t val, halide_type_t ty) {
     case halide_type_uint:
         e = UIntImm::make(scalar_type, val.u.u64);
         break;
+    case halide_type_bfloat:
     case halide_type_float:
         e = FloatImm::make(scalar_type, val.u.f64);
         break;
@@ -529,6 +530,7 @@ struct Const {
         case halide_type_uint:
             val.u.u64 = (uint64_t)v;
             break;
+        case halide_type_bfloat:
         case halide_type_float:
             val.u.f64 = (double)v;
             break;
@@ -633,6 +635,7 @@ struct BinOp {
         case halide_type_uint:
             val.u.u64 = constant_fold_bin_op<Op>(ty, val_a.u.u64, val_b.u.u64);
             break;
+        case halide_type_bfloat:
         case halide_type_float:
             val.u.f64 = constant_fold_bin_op<Op>(ty, val_a.u.f64, val_b.u.f64);
             break;
@@ -725,6 +728,7 @@ struct CmpOp {
         case halide_type_uint:
             val.u.u64 = constant_fold_cmp_op<Op>(val_a.u.u64, val_b.u.u64);
             break;
+        case halide_type_bfloat:
         case halide_type_float:
             val.u.u64 = constant_fold_cmp_op<Op>(val_a.u.f64, val_b.u.f64);
             break;
@@ -1425,7 +1429,7 @@ struct NotOp {
         a.make_folded_const(val, ty, state);
         val.u.u64 = ~val.u.u64;
         val.u.u64 &= 1;
-        ty.lanes |= ((int)ty.code == (int)halide_type_float) ? MatcherState::indeterminate_expression : 0;
+        ty.lanes |= ((int)ty.code == (int)halide_type_float || (int)ty.code == (int)halide_type_bfloat) ? MatcherState::indeterminate_expression : 0;
     }
 };
 
@@ -1697,6 +1701,7 @@ struct NegateOp {
         case halide_type_uint:
             val.u.u64 = ((-val.u.u64) << dead_bits) >> dead_bits;
             break;
+        case halide_type_bfloat:
         case halide_type_float:
             val.u.f64 = -val.u.f64;
             break;
@@ -2053,6 +2058,7 @@ void fuzz_test_rule(Before &&before, After &&after, Predicate &&pred,
                     exprs[i] = make_const(wildcard_type, val);
                 }
                 break;
+            case halide_type_bfloat:
             case halide_type_float:
                 {
                     // Use a very narrow range of precise floats, so
@@ -2091,6 +2097,7 @@ void fuzz_test_rule(Before &&before, After &&after, Predicate &&pred,
             ok &= (constant_fold_bin_op<Add>(output_type, val_before.u.i64, 0) ==
                    constant_fold_bin_op<Add>(output_type, val_after.u.i64, 0));
             break;
+        case halide_type_bfloat:
         case halide_type_float:
             {
                 double error = std::abs(val_before.u.f64 - val_after.u.f64);
@@ -323,6 +323,17 @@ void IRMutator::visit(const Block *op) {
     }
 }
 
+void IRMutator::visit(const Fork *op) {
+    Stmt first = mutate(op->first);
+    Stmt rest = mutate(op->rest);
+    if (first.same_as(op->first) &&
+        rest.same_as(op->rest)) {
+        stmt = op;
+    } else {
+        stmt = Fork::make(std::move(first), std::move(rest));
+    }
+}
+
 void IRMutator::visit(const IfThenElse *op) {
     Expr condition = mutate(op->condition);
     Stmt then_case = mutate(op->then_case);
@@ -650,6 +661,16 @@ Stmt IRMutator2::visit(const Block *op) {
     return Block::make(std::move(first), std::move(rest));
 }
 
+Stmt IRMutator2::visit(const Fork *op) {
+    Stmt first = mutate(op->first);
+    Stmt rest = mutate(op->rest);
+    if (first.same_as(op->first) &&
+        rest.same_as(op->rest)) {
+        return op;
+    }
+    return Fork::make(std::move(first), std::move(rest));
+}
+
 Stmt IRMutator2::visit(const IfThenElse *op) {
     Expr condition = mutate(op->condition);
     Stmt then_case = mutate(op->then_case);
@@ -90,6 +90,7 @@ protected:
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const Fork *);
 };
 
 
@@ -164,6 +165,7 @@ protected:
     virtual Stmt visit(const IfThenElse *);
     virtual Stmt visit(const Evaluate *);
     virtual Stmt visit(const Prefetch *);
+    virtual Stmt visit(const Fork *);
 };
 
 /** A mutator that caches and reapplies previously-done mutations, so
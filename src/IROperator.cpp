@@ -451,6 +451,12 @@ void match_types(Expr &a, Expr &b) {
         a = cast(tb, std::move(a));
     } else if (ta.is_float() && !tb.is_float()) {
         b = cast(ta, std::move(b));
+    } else if (ta.is_float() && tb.is_float() && ta.bits() == tb.bits()) {
+        // Neither of bfloat16 and float16 can represent the other.
+        // bfloat16(a) * float16(b) -> float32(a) * float32(b)
+        internal_assert(ta.bits() == 16);
+        a = cast(Float(32, ta.lanes()), std::move(a));
+        b = cast(Float(32, tb.lanes()), std::move(b));
     } else if (ta.is_float() && tb.is_float()) {
         // float(a) * float(b) -> float(max(a, b))
         if (ta.bits() > tb.bits()) b = cast(ta, std::move(b));
@@ -905,6 +911,53 @@ Expr memoize_tag_helper(Expr result, const std::vector<Expr> &cache_key_values)
 
 }  // namespace Internal
 
+Expr saturating_add(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "saturating_add of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    user_assert((t.is_int() || t.is_uint()) && !t.is_bool())
+        << "saturating_add of non-integer type " << t << "\n";
+    return Internal::Call::make(t, Internal::Call::saturating_add,
+                                {std::move(a), std::move(b)}, Internal::Call::PureIntrinsic);
+}
+
+Expr saturating_sub(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "saturating_sub of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    user_assert((t.is_int() || t.is_uint()) && !t.is_bool())
+        << "saturating_sub of non-integer type " << t << "\n";
+    return Internal::Call::make(t, Internal::Call::saturating_sub,
+                                {std::move(a), std::move(b)}, Internal::Call::PureIntrinsic);
+}
+
+Expr rounding_shift_right(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined()) << "rounding_shift_right of undefined Expr\n";
+    user_assert((a.type().is_int() || a.type().is_uint()) && !a.type().is_bool())
+        << "rounding_shift_right of non-integer type " << a.type() << "\n";
+    user_assert(b.type().is_int() || b.type().is_uint())
+        << "rounding_shift_right by a non-integer amount of type " << b.type() << "\n";
+    if (a.type().is_scalar() && b.type().is_vector()) {
+        a = Internal::Broadcast::make(a, b.type().lanes());
+    }
+    Type t = a.type();
+    b = cast(t, std::move(b));
+    return Internal::Call::make(t, Internal::Call::rounding_shift_right,
+                                {std::move(a), std::move(b)}, Internal::Call::PureIntrinsic);
+}
+
+Expr saturating_rounding_doubling_high_multiply(Expr a, Expr b) {
+    user_assert(a.defined() && b.defined())
+        << "saturating_rounding_doubling_high_multiply of undefined Expr\n";
+    Internal::match_types(a, b);
+    Type t = a.type();
+    user_assert(t.is_int() && t.bits() <= 32)
+        << "saturating_rounding_doubling_high_multiply requires signed integers "
+        << "of at most 32 bits, not " << t << "\n";
+    return Internal::Call::make(t, Internal::Call::saturating_rounding_doubling_high_multiply,
+                                {std::move(a), std::move(b)}, Internal::Call::PureIntrinsic);
+}
+
 Expr saturating_cast(Type t, Expr e) {
     // For float to float, guarantee infinities are always pinned to range.
     if (t.is_float() && e.type().is_float()) {
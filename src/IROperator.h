@@ -924,6 +924,29 @@ inline Expr absd(Expr a, Expr b) {
                                 Internal::Call::PureIntrinsic);
 }
 
+/** Add two integers, clamping the result to the range of their type
+ * instead of wrapping around. Vectorizes to a single instruction on
+ * most SIMD targets. */
+Expr saturating_add(Expr a, Expr b);
+
+/** Subtract two integers, clamping the result to the range of their
+ * type instead of wrapping around. Vectorizes to a single instruction
+ * on most SIMD targets. */
+Expr saturating_sub(Expr a, Expr b);
+
+/** Shift an integer right by some number of bits, rounding to the
+ * nearest integer, with ties rounded up. Equivalent to (a + (1 << (b
+ * - 1))) >> b, except that the addition can't overflow. b is converted
+ * to the type of a, and must be in [0, the number of bits in a). */
+Expr rounding_shift_right(Expr a, Expr b);
+
+/** Compute the high half of 2 * a * b, rounded to nearest, saturating
+ * the single case (a == b == the smallest value of the type) that
+ * overflows. This is the basic multiply of Q-format fixed-point
+ * arithmetic (e.g. vqrdmulh on ARM). a and b must be signed integers
+ * of 8, 16, or 32 bits. */
+Expr saturating_rounding_doubling_high_multiply(Expr a, Expr b);
+
 /** Returns an expression similar to the ternary operator in C, except
  * that it always evaluates all arguments. If the first argument is
  * true, then return the second, else return the third. Typically
@@ -1729,6 +1752,13 @@ inline Expr mod_round_to_zero(Expr x, Expr y) {
  * the function it is used in. They are, however, shared across tuple
  * elements.
  *
+ * The values come from the Philox-2x32-10 counter-based generator
+ * (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"),
+ * which passes the BigCrush battery of statistical tests. The first
+ * two pure variables form the counter, and everything else is hashed
+ * into the key, which is usually loop invariant. Each round processes
+ * a whole vector of counters at once.
+ *
  * This function vectorizes cleanly.
  */
 inline Expr random_float(Expr seed = Expr()) {
@@ -1771,6 +1801,22 @@ inline Expr random_uint(Expr seed = Expr()) {
                                 args, Internal::Call::PureIntrinsic);
 }
 
+/** Return a random variable representing a uniformly distributed
+ * unsigned integer with the given number of bits, which must be 8, 16,
+ * 32 or 64. The result has type UInt(bits). Narrower results are
+ * cheaper to convert than masking or shifting a 32-bit result. To
+ * pass a seed to the 32-bit version above, pass an Expr rather than
+ * an int. See \ref random_float. Vectorizes cleanly. */
+inline Expr random_uint(int bits, Expr seed = Expr()) {
+    user_assert(bits == 8 || bits == 16 || bits == 32 || bits == 64)
+        << "random_uint takes a number of bits of 8, 16, 32 or 64, but got " << bits << "\n";
+    // Random ints get odd IDs
+    Expr r = random_uint(std::move(seed));
+    const Internal::Call *c = r.as<Internal::Call>();
+    return Internal::Call::make(UInt(bits), Internal::Call::random,
+                                c->args, Internal::Call::PureIntrinsic);
+}
+
 /** Return a random variable representing a uniformly distributed
  * 32-bit integer. See \ref random_float. Vectorizes cleanly. */
 inline Expr random_int(Expr seed = Expr()) {
@@ -27,6 +27,9 @@ ostream &operator<<(ostream &out, const Type &type) {
     case Type::Float:
         out << "float";
         break;
+    case Type::BFloat:
+        out << "bfloat";
+        break;
     case Type::Handle:
         if (type.handle_type) {
             out << "(" << type.handle_type->inner_name.name << " *)";
@@ -100,6 +103,9 @@ ostream &operator<<(ostream &out, const DeviceAPI &api) {
     case DeviceAPI::D3D12Compute:
         out << "<D3D12Compute>";
         break;
+    case DeviceAPI::Vulkan:
+        out << "<Vulkan>";
+        break;
     }
     return out;
 }
@@ -121,6 +127,9 @@ std::ostream &operator<<(std::ostream &out, const MemoryType &t) {
     case MemoryType::GPUShared:
         out << "GPUShared";
         break;
+    case MemoryType::VTCM:
+        out << "VTCM";
+        break;
     }
     return out;
 }
@@ -751,6 +760,29 @@ void IRPrinter::visit(const Block *op) {
     if (op->rest.defined()) print(op->rest);
 }
 
+void IRPrinter::visit(const Fork *op) {
+    vector<Stmt> stmts;
+    stmts.push_back(op->first);
+    Stmt rest = op->rest;
+    while (const Fork *f = rest.as<Fork>()) {
+        stmts.push_back(f->first);
+        rest = f->rest;
+    }
+    stmts.push_back(rest);
+
+    do_indent();
+    stream << "fork ";
+    for (Stmt s : stmts) {
+        stream << "{\n";
+        indent += 2;
+        print(s);
+        indent -= 2;
+        do_indent();
+        stream << "} ";
+    }
+    stream << "\n";
+}
+
 void IRPrinter::visit(const IfThenElse *op) {
     do_indent();
     while (1) {
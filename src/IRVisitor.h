@@ -70,6 +70,7 @@ protected:
     virtual void visit(const Evaluate *);
     virtual void visit(const Shuffle *);
     virtual void visit(const Prefetch *);
+    virtual void visit(const Fork *);
 };
 
 /** A base class for algorithms that walk recursively over the IR
@@ -136,6 +137,7 @@ protected:
     void visit(const Evaluate *) override;
     void visit(const Shuffle *) override;
     void visit(const Prefetch *) override;
+    void visit(const Fork *) override;
     // @}
 };
 
@@ -226,6 +228,7 @@ private:
         case IRNodeType::IfThenElse:
         case IRNodeType::Evaluate:
         case IRNodeType::Prefetch:
+        case IRNodeType::Fork:
             internal_error << "Unreachable";
         }
         return ExprRet {};
@@ -292,6 +295,8 @@ private:
             return ((T *)this)->visit((const Evaluate *)node, std::forward<Args>(args)...);
         case IRNodeType::Prefetch:
             return ((T *)this)->visit((const Prefetch *)node, std::forward<Args>(args)...);
+        case IRNodeType::Fork:
+            return ((T *)this)->visit((const Fork *)node, std::forward<Args>(args)...);
         }
         return StmtRet {};
     }
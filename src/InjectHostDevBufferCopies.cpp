@@ -527,12 +527,32 @@ class InjectBufferCopies : public IRMutator2 {
 
         Stmt body = mutate(op->body);
 
-        InjectBufferCopiesForSingleBuffer injector(op->name, false);
-        body = injector.mutate(body);
-
         string buffer_name = op->name + ".buffer";
         Expr buffer = Variable::make(Handle(), buffer_name);
 
+        if (op->free_function == "halide_memoization_cache_release") {
+            // A memoized allocation. Its host allocation comes from
+            // the cache, and any device allocation made while
+            // computing it is kept in the cache along with it, so a
+            // cache hit comes back with the result already on the
+            // device. Whether it was a hit is only known at runtime,
+            // so treat the state of the buffer as unknown, and leave
+            // freeing the device allocation to the cache.
+            InjectBufferCopiesForSingleBuffer injector(op->name, true);
+            body = injector.mutate(body);
+
+            if (injector.last_use.defined()) {
+                Stmt device_release = call_extern_and_assert("halide_memoization_cache_release_device", {buffer});
+                body = FreeAfterLastUse(injector.last_use, device_release).mutate(body);
+            }
+
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                  op->condition, body, op->new_expr, op->free_function);
+        }
+
+        InjectBufferCopiesForSingleBuffer injector(op->name, false);
+        body = injector.mutate(body);
+
         // Device what type of allocation to make.
 
         if (touched_on_host && finder.devices_touched.size() == 2) {
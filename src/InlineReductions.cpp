@@ -1,10 +1,12 @@
 #include "InlineReductions.h"
+#include "Associativity.h"
 #include "CSE.h"
 #include "Debug.h"
 #include "Func.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Scope.h"
+#include "Substitute.h"
 
 namespace Halide {
 
@@ -101,13 +103,51 @@ private:
         return expr;
     }
 };
+
+void schedule_inline_reduction(Func f, const RDom &r, ReductionStrategy strategy) {
+    if (strategy == ReductionStrategy::Serial) {
+        return;
+    }
+
+    // The number of iterations of a one-dimensional domain given to
+    // each parallel task, and the number of partial results each task
+    // accumulates in a vector.
+    const int chunk_size = 1024;
+    const int vector_width = 8;
+
+    RVar outer = r[r.dimensions() - 1], inner = r[0];
+    if (r.dimensions() == 1) {
+        RVar ro, ri;
+        f.update().split(r.x, ro, ri, chunk_size);
+        outer = ro;
+        inner = ri;
+    }
+
+    Var u, w;
+    Func intm = f.update().rfactor(outer, u);
+    intm.compute_root().update().parallel(u);
+
+    RVar rio, rii;
+    Func intm_vec = intm.update().split(inner, rio, rii, vector_width).rfactor(rii, w);
+    intm_vec.compute_at(intm, u).vectorize(w, vector_width);
+    intm_vec.update().vectorize(w, vector_width);
+}
+
 }  // namespace Internal
 
 Expr sum(Expr e, const std::string &name) {
-    return sum(RDom(), e, name);
+    return sum(RDom(), e, ReductionStrategy::Serial, name);
 }
 
 Expr sum(RDom r, Expr e, const std::string &name) {
+    return sum(r, e, ReductionStrategy::Serial, name);
+}
+
+Expr sum(Expr e, ReductionStrategy strategy, const std::string &name) {
+    return sum(RDom(), e, strategy, name);
+}
+
+Expr sum(RDom r, Expr e, ReductionStrategy strategy, const std::string &name) {
     Internal::FindFreeVars v(r, name);
     e = v.mutate(common_subexpression_elimination(e));
 
@@ -115,14 +155,23 @@ Expr sum(RDom r, Expr e, const std::string &name) {
 
     Func f(name);
     f(v.free_vars) += e;
+    Internal::schedule_inline_reduction(f, v.rdom, strategy);
     return f(v.call_args);
 }
 
 Expr product(Expr e, const std::string &name) {
-    return product(RDom(), e, name);
+    return product(RDom(), e, ReductionStrategy::Serial, name);
 }
 
 Expr product(RDom r, Expr e, const std::string &name) {
+    return product(r, e, ReductionStrategy::Serial, name);
+}
+
+Expr product(Expr e, ReductionStrategy strategy, const std::string &name) {
+    return product(RDom(), e, strategy, name);
+}
+
+Expr product(RDom r, Expr e, ReductionStrategy strategy, const std::string &name) {
     Internal::FindFreeVars v(r, name);
     e = v.mutate(common_subexpression_elimination(e));
 
@@ -130,14 +179,23 @@ Expr product(RDom r, Expr e, const std::string &name) {
 
     Func f(name);
     f(v.free_vars) *= e;
+    Internal::schedule_inline_reduction(f, v.rdom, strategy);
     return f(v.call_args);
 }
 
 Expr maximum(Expr e, const std::string &name) {
-    return maximum(RDom(), e, name);
+    return maximum(RDom(), e, ReductionStrategy::Serial, name);
 }
 
 Expr maximum(RDom r, Expr e, const std::string &name) {
+    return maximum(r, e, ReductionStrategy::Serial, name);
+}
+
+Expr maximum(Expr e, ReductionStrategy strategy, const std::string &name) {
+    return maximum(RDom(), e, strategy, name);
+}
+
+Expr maximum(RDom r, Expr e, ReductionStrategy strategy, const std::string &name) {
     Internal::FindFreeVars v(r, name);
     e = v.mutate(common_subexpression_elimination(e));
 
@@ -146,14 +204,23 @@ Expr maximum(RDom r, Expr e, const std::string &name) {
     Func f(name);
     f(v.free_vars) = e.type().min();
     f(v.free_vars) = max(f(v.free_vars), e);
+    Internal::schedule_inline_reduction(f, v.rdom, strategy);
     return f(v.call_args);
 }
 
 Expr minimum(Expr e, const std::string &name) {
-    return minimum(RDom(), e, name);
+    return minimum(RDom(), e, ReductionStrategy::Serial, name);
 }
 
 Expr minimum(RDom r, Expr e, const std::string &name) {
+    return minimum(r, e, ReductionStrategy::Serial, name);
+}
+
+Expr minimum(Expr e, ReductionStrategy strategy, const std::string &name) {
+    return minimum(RDom(), e, strategy, name);
+}
+
+Expr minimum(RDom r, Expr e, ReductionStrategy strategy, const std::string &name) {
     Internal::FindFreeVars v(r, name);
     e = v.mutate(common_subexpression_elimination(e));
 
@@ -162,6 +229,7 @@ Expr minimum(RDom r, Expr e, const std::string &name) {
     Func f(name);
     f(v.free_vars) = e.type().max();
     f(v.free_vars) = min(f(v.free_vars), e);
+    Internal::schedule_inline_reduction(f, v.rdom, strategy);
     return f(v.call_args);
 }
 
@@ -222,4 +290,72 @@ Tuple argmin(RDom r, Expr e, const std::string &name) {
     return f(v.call_args);
 }
 
+Func prefix_sum(RDom r, Expr e, const std::string &name) {
+    return scan(r, e, [](Expr a, Expr b) { return a + b; }, name);
+}
+
+Func scan(RDom r, Expr e, std::function<Expr(Expr, Expr)> op, const std::string &name) {
+    user_assert(r.defined() && r.dimensions() == 1)
+        << "Scan \"" << name << "\" requires a one-dimensional reduction domain\n";
+    user_assert(is_one(r.domain().predicate()))
+        << "Scan \"" << name << "\" requires a reduction domain without a predicate\n";
+
+    Internal::FindFreeVars v(r, name);
+    e = v.mutate(common_subexpression_elimination(e));
+
+    // Check the operator is associative, by asking whether the
+    // recurrence acc(x) = op(acc(x), e) could be rfactored.
+    Var x;
+    {
+        string acc = Internal::unique_name(name + "_acc");
+        Expr self = Internal::Call::make(e.type(), acc, {x}, Internal::Call::Halide);
+        user_assert(Internal::prove_associativity(acc, {x}, {op(self, e)}).associative())
+            << "Scan \"" << name << "\" can't prove associativity of its operator\n";
+    }
+
+    const int block_size = 1024;
+    Expr start = r.x.min(), extent = r.x.extent();
+
+    Var i, b;
+    vector<Var> local_args = {i, b}, block_args = {b}, result_args = {x};
+    for (const Var &fv : v.free_vars) {
+        local_args.push_back(fv);
+        block_args.push_back(fv);
+        result_args.push_back(fv);
+    }
+    auto args = [&](vector<Expr> a) {
+        a.insert(a.end(), v.free_vars.begin(), v.free_vars.end());
+        return a;
+    };
+
+    // Scan each block. The tail of the last block repeats the last
+    // element of the domain, which only perturbs its block total, and
+    // that total is never used.
+    Func local(name + "_local");
+    Expr j = clamp(b * block_size + i, 0, extent - 1);
+    local(local_args) = substitute(r.x.name(), start + j, e);
+    RDom ri(1, block_size - 1);
+    local(args({ri, b})) = op(local(args({ri - 1, b})), local(args({ri, b})));
+
+    // Scan the block totals.
+    Func blocks(name + "_blocks");
+    Expr num_blocks = (extent + block_size - 1) / block_size;
+    blocks(block_args) = local(args({block_size - 1, b}));
+    RDom rb(1, num_blocks - 1);
+    blocks(args({rb})) = op(blocks(args({rb - 1})), blocks(args({rb})));
+
+    Func result(name);
+    Expr k = clamp(x - start, 0, extent - 1);
+    Expr block = k / block_size;
+    Expr in_block = local(args({k % block_size, block}));
+    result(result_args) = select(block == 0, in_block,
+                                 op(blocks(args({max(block - 1, 0)})), in_block));
+
+    local.compute_root().parallel(b);
+    local.update().parallel(b);
+    blocks.compute_root();
+
+    return result;
+}
+
 }  // namespace Halide
@@ -1,15 +1,20 @@
 #ifndef HALIDE_INLINE_REDUCTIONS_H
 #define HALIDE_INLINE_REDUCTIONS_H
 
+#include <functional>
+
 #include "IR.h"
 #include "RDom.h"
 #include "Tuple.h"
 
 /** \file
- * Defines some inline reductions: sum, product, minimum, maximum.
+ * Defines some inline reductions: sum, product, minimum, maximum, and
+ * the scans prefix_sum and scan.
  */
 namespace Halide {
 
+class Func;
+
 /** An inline reduction. This is suitable for convolution-type
  * operations - the reduction will be computed in the innermost loop
  * that it is used in. The argument may contain free or implicit
@@ -55,6 +60,45 @@ Expr maximum(RDom, Expr, const std::string &s = "maximum");
 Expr minimum(RDom, Expr, const std::string &s = "minimum");
 // @}
 
+/** How the anonymous function behind an inline reduction is
+ * scheduled. */
+enum class ReductionStrategy {
+    /** Reduce serially, innermost within the consumer. This is what
+     * the variants above do. */
+    Serial,
+
+    /** Split the reduction with rfactor into partial reductions over
+     * slices of the outermost reduction variable (or chunks of it, for
+     * a one-dimensional domain), computed at root in parallel. Each
+     * partial reduction accumulates a vector of results across the
+     * innermost reduction variable. The partial results are then
+     * combined serially. Useful for large reductions such as
+     * whole-image statistics. Floating-point results may differ in the
+     * last bits from the serial order, but the slices and the order
+     * they are combined in are fixed, so they don't change from run to
+     * run or with the number of threads. */
+    Parallel
+};
+
+/** Variants of the inline reductions that take a \ref
+ * ReductionStrategy. For example, this sums a large image using all
+ * cores:
+ \code
+ RDom r(input);
+ Expr total = sum(r, input(r.x, r.y), ReductionStrategy::Parallel);
+ \endcode
+ */
+// @{
+Expr sum(Expr, ReductionStrategy, const std::string &s = "sum");
+Expr product(Expr, ReductionStrategy, const std::string &s = "product");
+Expr maximum(Expr, ReductionStrategy, const std::string &s = "maximum");
+Expr minimum(Expr, ReductionStrategy, const std::string &s = "minimum");
+Expr sum(RDom, Expr, ReductionStrategy, const std::string &s = "sum");
+Expr product(RDom, Expr, ReductionStrategy, const std::string &s = "product");
+Expr maximum(RDom, Expr, ReductionStrategy, const std::string &s = "maximum");
+Expr minimum(RDom, Expr, ReductionStrategy, const std::string &s = "minimum");
+// @}
+
 /** Returns an Expr or Tuple representing the coordinates of the point
  * in the RDom which minimizes or maximizes the expression. The
  * expression must refer to some RDom. Also returns the extreme value
@@ -66,6 +110,33 @@ Tuple argmax(RDom, Expr, const std::string &s = "argmax");
 Tuple argmin(RDom, Expr, const std::string &s = "argmin");
 // @}
 
+/** Returns a Func computing an inclusive scan of the expression over
+ * a one-dimensional reduction domain. The first argument of the Func
+ * is the position in the domain, and the remaining arguments are the
+ * free variables of the expression, in the order they first appear in
+ * it. The Func is only meaningful over the extent of the domain. The
+ * operator must be associative, which is checked with the same
+ * analysis as rfactor, but need not be commutative. For example, the
+ * running sum of each row of an image:
+ \code
+ RDom r(0, input.width());
+ Var y;
+ Func running = prefix_sum(r, input(r, y));
+ // running(x, y) = input(0, y) + input(1, y) + ... + input(x, y)
+ \endcode
+ *
+ * The scan is computed in two passes over blocks of 1024 elements.
+ * The first pass scans each block independently, in parallel across
+ * blocks. The second pass scans the block totals serially, and the
+ * returned Func adds the total of all preceding blocks to each
+ * element. The intermediate Funcs are computed at root. The
+ * expression must not refer to the Func being defined, and the
+ * reduction domain must not have a predicate. */
+// @{
+Func prefix_sum(RDom, Expr, const std::string &s = "prefix_sum");
+Func scan(RDom, Expr, std::function<Expr(Expr, Expr)> op, const std::string &s = "scan");
+// @}
+
 }  // namespace Halide
 
 #endif
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <stdio.h>
 
@@ -2188,6 +2189,9 @@ private:
 
 namespace {
 DebugSections *debug_sections = nullptr;
+// Guards the registry of heap objects, which Funcs and Params being
+// made on different threads may update at the same time.
+std::mutex heap_objects_mutex;
 }
 
 bool dump_stack_frame() {
@@ -2204,6 +2208,7 @@ std::string get_variable_name(const void *var, const std::string &expected_type)
     std::string name = debug_sections->get_stack_variable_name(var, expected_type);
     if (name.empty()) {
         // Maybe it's a member of a heap object.
+        std::lock_guard<std::mutex> lock(heap_objects_mutex);
         name = debug_sections->get_heap_member_name(var, expected_type);
     }
     if (name.empty()) {
@@ -2224,12 +2229,14 @@ void register_heap_object(const void *obj, size_t size, const void *helper) {
     if (!debug_sections) return;
     if (!debug_sections->working) return;
     if (!helper) return;
+    std::lock_guard<std::mutex> lock(heap_objects_mutex);
     debug_sections->register_heap_object(obj, size, helper);
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
     if (!debug_sections) return;
     if (!debug_sections->working) return;
+    std::lock_guard<std::mutex> lock(heap_objects_mutex);
     debug_sections->deregister_heap_object(obj, size);
 }
 
@@ -20,9 +20,14 @@ class RefCount {
     std::atomic<int> count;
 public:
     RefCount() : count(0) {}
-    int increment() {return ++count;} // Increment and return new value
-    int decrement() {return --count;} // Decrement and return new value
+    // Taking a new reference only requires that there already is one,
+    // so it needs no ordering with other memory operations. Dropping
+    // one must be ordered before the destruction that the last drop
+    // triggers.
+    int increment() {return count.fetch_add(1, std::memory_order_relaxed) + 1;} // Increment and return new value
+    int decrement() {return count.fetch_sub(1, std::memory_order_acq_rel) - 1;} // Decrement and return new value
     bool is_zero() const {return count == 0;}
+    int get() const {return count;} // Return the current value
 };
 
 /**
@@ -0,0 +1,279 @@
+#include "InvariantDivision.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Does an expression have the same value everywhere in a loop, given
+// the variables that vary within it?
+class IsInvariant : public IRVisitor {
+    const Scope<> &varying;
+
+    using IRVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (varying.contains(op->name)) {
+            result = false;
+        }
+    }
+
+    void visit(const Load *op) override {
+        result = false;
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            result = false;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = true;
+    IsInvariant(const Scope<> &v) : varying(v) {}
+};
+
+bool is_invariant(Expr e, const Scope<> &varying) {
+    IsInvariant check(varying);
+    e.accept(&check);
+    return check.result;
+}
+
+// The magic numbers for dividing by a divisor d, following the
+// branch-free unsigned scheme of libdivide (and Granlund and
+// Montgomery). For an N-bit unsigned numerator n:
+//   l = ceil(log2(d))
+//   m = 2^N * (2^l - d) / d + 1
+//   t = (n * m) >> N
+//   n / d = (t + ((n - t) >> min(l, 1))) >> max(l - 1, 0)
+// Signed division divides the magnitudes, and fixes up the signs
+// to round the way Halide does.
+struct DivisorMagic {
+    Expr divisor;
+    Expr multiplier, shift1, shift2, sign;
+};
+
+class StrengthReduceInvariantDivision : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // Whether we're inside a loop we can lift the magic numbers out
+    // of, the variables that vary within the innermost one, and the
+    // magic numbers to compute just outside of it.
+    bool in_loop = false;
+    Scope<> varying;
+    vector<DivisorMagic> magics;
+    vector<std::pair<string, Expr>> lets;
+
+    // The scalar divisor of a division we can strength-reduce, or an
+    // undefined Expr.
+    Expr invariant_divisor(Expr b) {
+        Type t = b.type();
+        if (!in_loop ||
+            !(t.is_int() || t.is_uint()) ||
+            !(t.bits() == 8 || t.bits() == 16 || t.bits() == 32)) {
+            return Expr();
+        }
+        if (const Broadcast *broadcast = b.as<Broadcast>()) {
+            b = broadcast->value;
+        } else if (t.is_vector()) {
+            return Expr();
+        }
+        if (is_const(b) || !is_invariant(b, varying)) {
+            return Expr();
+        }
+        return b;
+    }
+
+    const DivisorMagic &get_magic(Expr d) {
+        for (const DivisorMagic &m : magics) {
+            if (equal(m.divisor, d)) {
+                return m;
+            }
+        }
+
+        Type t = d.type();
+        int bits = t.bits();
+        Type u = t.with_code(Type::UInt);
+        Type wide = u.with_bits(bits * 2);
+        string name = unique_name("divisor");
+
+        // Division by zero is undefined, but the loop might not run
+        // at all, so don't divide by zero computing the magic
+        // numbers.
+        Expr ud = t.is_int() ? abs(d) : d;
+        ud = select(ud == make_zero(u), make_one(u), ud);
+        Expr ud_var = Variable::make(u, name + ".abs");
+        lets.push_back({name + ".abs", ud});
+
+        Expr l = make_const(u, bits) - count_leading_zeros(ud_var - make_one(u));
+        Expr l_var = Variable::make(u, name + ".log2");
+        lets.push_back({name + ".log2", l});
+
+        Expr m = (cast(wide, 1) << cast(wide, l_var)) - cast(wide, ud_var);
+        m = cast(u, (m << make_const(wide, bits)) / cast(wide, ud_var) + make_one(wide));
+        Expr shift1 = min(l_var, make_one(u));
+        Expr shift2 = l_var - shift1;
+
+        DivisorMagic magic;
+        magic.divisor = d;
+        lets.push_back({name + ".multiplier", m});
+        magic.multiplier = Variable::make(u, name + ".multiplier");
+        lets.push_back({name + ".shift1", shift1});
+        magic.shift1 = Variable::make(u, name + ".shift1");
+        lets.push_back({name + ".shift2", shift2});
+        magic.shift2 = Variable::make(u, name + ".shift2");
+        if (t.is_int()) {
+            // All ones if the divisor is negative.
+            lets.push_back({name + ".sign", d >> make_const(t, bits - 1)});
+            magic.sign = Variable::make(t, name + ".sign");
+        }
+        magics.push_back(magic);
+        return magics.back();
+    }
+
+    Expr divide(Expr a, const DivisorMagic &magic) {
+        Type t = a.type();
+        int bits = t.bits();
+        Type u = t.with_code(Type::UInt);
+        Type wide = u.with_bits(bits * 2);
+        int lanes = t.lanes();
+        auto broadcast = [&](Expr e) {
+            return lanes > 1 ? Broadcast::make(e, lanes) : e;
+        };
+
+        // Make an all-ones mask if the numerator is negative, and
+        // use it to flip the bits of the numerator, so that rounding
+        // the magnitude down rounds towards negative infinity.
+        Expr num_sign;
+        Expr num = a;
+        if (t.is_int()) {
+            num_sign = a >> make_const(t, bits - 1);
+            num = reinterpret(u, a ^ num_sign);
+        }
+
+        Expr hi = cast(u, (cast(wide, num) * cast(wide, broadcast(magic.multiplier))) >>
+                              make_const(wide, bits));
+        Expr q = (hi + ((num - hi) >> broadcast(magic.shift1))) >> broadcast(magic.shift2);
+
+        if (t.is_int()) {
+            // Flip the bits back, then negate if the divisor is
+            // negative.
+            q = reinterpret(t, q) ^ num_sign;
+            Expr sign = broadcast(magic.sign);
+            q = (q ^ sign) - sign;
+        }
+        return q;
+    }
+
+    Expr visit(const Div *op) override {
+        Expr a = mutate(op->a);
+        Expr b = mutate(op->b);
+        Expr d = invariant_divisor(b);
+        if (d.defined()) {
+            return divide(a, get_magic(d));
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Div::make(a, b);
+        }
+    }
+
+    Expr visit(const Mod *op) override {
+        Expr a = mutate(op->a);
+        Expr b = mutate(op->b);
+        Expr d = invariant_divisor(b);
+        if (d.defined()) {
+            // The quotient rounds such that this is in [0, |b|).
+            return a - divide(a, get_magic(d)) * b;
+        } else if (a.same_as(op->a) && b.same_as(op->b)) {
+            return op;
+        } else {
+            return Mod::make(a, b);
+        }
+    }
+
+    template<typename LetOrLetStmt, typename T>
+    T visit_let(const LetOrLetStmt *op) {
+        // Lets inside the loop aren't in scope outside of it, so
+        // treat them as varying even if their values don't.
+        Expr value = mutate(op->value);
+        if (in_loop) {
+            varying.push(op->name);
+        }
+        T body = mutate(op->body);
+        if (in_loop) {
+            varying.pop(op->name);
+        }
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let<Let, Expr>(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let<LetStmt, Stmt>(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave device code to the device backends.
+            return op;
+        }
+
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+
+        bool old_in_loop = in_loop;
+        Scope<> old_varying;
+        old_varying.swap(varying);
+        vector<DivisorMagic> old_magics;
+        old_magics.swap(magics);
+        vector<std::pair<string, Expr>> old_lets;
+        old_lets.swap(lets);
+
+        in_loop = true;
+        varying.push(op->name);
+        Stmt body = mutate(op->body);
+        varying.pop(op->name);
+
+        Stmt s;
+        if (min.same_as(op->min) && extent.same_as(op->extent) && body.same_as(op->body)) {
+            s = op;
+        } else {
+            s = For::make(op->name, min, extent, op->for_type, op->device_api, body);
+        }
+        for (size_t i = lets.size(); i > 0; i--) {
+            s = LetStmt::make(lets[i - 1].first, lets[i - 1].second, s);
+        }
+
+        in_loop = old_in_loop;
+        varying.swap(old_varying);
+        magics.swap(old_magics);
+        lets.swap(old_lets);
+        return s;
+    }
+};
+
+}  // namespace
+
+Stmt strength_reduce_invariant_division(Stmt s) {
+    return StrengthReduceInvariantDivision().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,24 @@
+#ifndef HALIDE_INVARIANT_DIVISION_H
+#define HALIDE_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines the lowering pass that replaces division by loop-invariant
+ * runtime values with multiplies and shifts.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace integer division and modulus by divisors that are not
+ * constant, but don't change across the innermost loop containing
+ * them, with a multiply-high and shifts by magic numbers computed
+ * just outside that loop. Constant divisors are already handled by
+ * codegen, and loops that run on a device are left alone. */
+Stmt strength_reduce_invariant_division(Stmt s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
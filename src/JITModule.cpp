@@ -1,13 +1,16 @@
+#include <functional>
 #include <string>
 #include <stdint.h>
 #include <mutex>
 #include <set>
+#include <sstream>
 
 #ifndef _WIN32
 #include <sys/mman.h>
 #endif
 
 #include "CodeGen_Internal.h"
+#include "CompileTrace.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
@@ -167,6 +170,80 @@ JITModule::Symbol compile_and_get_function(ExecutionEngine &ee, const string &na
     return symbol;
 }
 
+// Saves the object code of jit-compiled modules to the directory named
+// by HL_JIT_CACHE_DIR, and hands it back to MCJIT instead of running
+// codegen when a module with the same key is compiled again. Only
+// modules whose identifier was set from a cache key take part.
+class JITObjectCache : public llvm::ObjectCache {
+    std::string dir;
+
+    bool path_for(const llvm::Module *m, std::string &path) const {
+        const std::string &id = m->getModuleIdentifier();
+        if (id.compare(0, prefix.size(), prefix) != 0) {
+            return false;
+        }
+        path = dir + "/" + id.substr(prefix.size()) + ".o";
+        return true;
+    }
+
+    JITObjectCache(const std::string &dir) : dir(dir) {
+        llvm::sys::fs::create_directories(dir);
+    }
+
+public:
+    static const std::string prefix;
+
+    // Returns nullptr if the on-disk cache is not enabled.
+    static JITObjectCache *get() {
+        static std::string dir = get_env_variable("HL_JIT_CACHE_DIR");
+        if (dir.empty()) {
+            return nullptr;
+        }
+        static JITObjectCache cache(dir);
+        return &cache;
+    }
+
+    void notifyObjectCompiled(const llvm::Module *m, llvm::MemoryBufferRef obj) override {
+        std::string path;
+        if (!path_for(m, path)) {
+            return;
+        }
+        // Write to a temporary file and rename it into place, so that
+        // other processes sharing the directory never see a partially
+        // written object.
+        int fd;
+        llvm::SmallString<128> tmp_path;
+        if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmp_path)) {
+            debug(1) << "Could not create a temporary file to cache " << path << "\n";
+            return;
+        }
+        {
+            llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+            out << obj.getBuffer();
+        }
+        if (llvm::sys::fs::rename(tmp_path, path)) {
+            llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+        debug(2) << "Saved jit object to " << path << "\n";
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *m) override {
+        std::string path;
+        if (!path_for(m, path)) {
+            return nullptr;
+        }
+        auto buf = llvm::MemoryBuffer::getFile(path);
+        if (!buf) {
+            return nullptr;
+        }
+        debug(2) << "Loaded cached jit object from " << path << "\n";
+        return std::move(*buf);
+    }
+};
+
+const std::string JITObjectCache::prefix = "halide_jit_cache_";
+
 // Expand LLVM's search for symbols to include code contained in a set of JITModule.
 // TODO: Does this need to be conditionalized to llvm 3.6?
 class HalideJITMemoryManager : public SectionMemoryManager {
@@ -240,18 +317,44 @@ JITModule::JITModule() {
 }
 
 JITModule::JITModule(const Module &m, const LoweredFunc &fn,
-                     const std::vector<JITModule> &dependencies) {
+                     const std::vector<JITModule> &dependencies,
+                     const std::string &object_cache_key,
+                     bool optimize) {
     jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context));
+    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, jit_module->context, optimize));
+    if (!object_cache_key.empty()) {
+        llvm_module->setModuleIdentifier(JITObjectCache::prefix + object_cache_key);
+    }
     std::vector<JITModule> deps_with_runtime = dependencies;
     std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
     deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime,
+                   std::vector<std::string>(), optimize);
+}
+
+JITModule::JITModule(const std::string &bitcode, const std::string &function_name, const Target &target,
+                     const std::vector<JITModule> &dependencies,
+                     const std::string &object_cache_key) {
+    jit_module = new JITModuleContents();
+    llvm::MemoryBufferRef buffer_ref(llvm::StringRef(bitcode.data(), bitcode.size()), function_name);
+    auto parsed = llvm::expectedToErrorOr(llvm::parseBitcodeFile(buffer_ref, jit_module->context));
+    user_assert(parsed) << "Could not parse the llvm bitcode of " << function_name
+                        << ": " << parsed.getError().message() << "\n";
+    std::unique_ptr<llvm::Module> llvm_module(std::move(*parsed));
+    if (!object_cache_key.empty()) {
+        llvm_module->setModuleIdentifier(JITObjectCache::prefix + object_cache_key);
+    }
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), target);
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+    compile_module(std::move(llvm_module), function_name, target, deps_with_runtime);
 }
 
 void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
                                const std::vector<JITModule> &dependencies,
-                               const std::vector<std::string> &requested_exports) {
+                               const std::vector<std::string> &requested_exports,
+                               bool optimize) {
+    CompileTraceEvent trace_event("JIT compiling " + function_name, "llvm");
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -276,7 +379,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     HalideJITMemoryManager *memory_manager = new HalideJITMemoryManager(dependencies);
     engine_builder.setMCJITMemoryManager(std::unique_ptr<RTDyldMemoryManager>(memory_manager));
 
-    engine_builder.setOptLevel(CodeGenOpt::Aggressive);
+    engine_builder.setOptLevel(optimize ? CodeGenOpt::Aggressive : CodeGenOpt::None);
     if (!mcpu.empty()) {
         engine_builder.setMCPU(mcpu);
     }
@@ -297,6 +400,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     if (!ee) std::cerr << error_string << "\n";
     internal_assert(ee) << "Couldn't create execution engine\n";
 
+    if (JITObjectCache *object_cache = JITObjectCache::get()) {
+        ee->setObjectCache(object_cache);
+    }
+
     // Do any target-specific initialization
     std::vector<llvm::JITEventListener *> listeners;
 
@@ -454,6 +561,32 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_set_device_size(int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_device_size");
+    if (f != exports().end()) {
+        return (reinterpret_bits<void (*)(int64_t)>(f->second.address))(size);
+    }
+}
+
+void JITModule::memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_shards");
+    if (f != exports().end()) {
+        int result = (reinterpret_bits<int (*)(int32_t, int32_t)>(f->second.address))(num_shards, buckets_per_shard);
+        internal_assert(result == 0) << "halide_memoization_cache_set_shards failed\n";
+    }
+}
+
+void JITModule::memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const {
+    *stats = halide_memoization_cache_stats_t();
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(halide_memoization_cache_stats_t *)>(f->second.address))(stats);
+    }
+}
+
 bool JITModule::compiled() const {
   return jit_module->execution_engine != nullptr;
 }
@@ -464,6 +597,9 @@ JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
 int64_t default_cache_size;
+int64_t default_device_cache_size;
+int32_t default_cache_shards;
+int32_t default_cache_buckets_per_shard;
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -617,6 +753,7 @@ enum RuntimeKind {
     OpenGLCompute,
     Hexagon,
     D3D12Compute,
+    Vulkan,
     OpenCLDebug,
     MetalDebug,
     CUDADebug,
@@ -624,6 +761,9 @@ enum RuntimeKind {
     OpenGLComputeDebug,
     HexagonDebug,
     D3D12ComputeDebug,
+    VulkanDebug,
+    OpenCLZeroCopy,
+    MetalZeroCopy,
     MaxRuntimeKind
 };
 
@@ -661,6 +801,8 @@ JITModule &make_module(llvm::Module *for_module, Target target,
         one_gpu.set_feature(Target::OpenGL, false);
         one_gpu.set_feature(Target::OpenGLCompute, false);
         one_gpu.set_feature(Target::D3D12Compute, false);
+        one_gpu.set_feature(Target::Vulkan, false);
+        one_gpu.set_feature(Target::ZeroCopy, false);
         string module_name;
         switch (runtime_kind) {
         case OpenCLDebug:
@@ -672,6 +814,11 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             one_gpu.set_feature(Target::OpenCL);
             module_name += "opencl";
             break;
+        case OpenCLZeroCopy:
+            one_gpu.set_feature(Target::OpenCL);
+            one_gpu.set_feature(Target::ZeroCopy);
+            module_name = "zero_copy_opencl";
+            break;
         case MetalDebug:
             one_gpu.set_feature(Target::Debug);
             one_gpu.set_feature(Target::Metal);
@@ -683,6 +830,12 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             module_name += "metal";
             load_metal();
             break;
+        case MetalZeroCopy:
+            one_gpu.set_feature(Target::Metal);
+            one_gpu.set_feature(Target::ZeroCopy);
+            module_name = "zero_copy_metal";
+            load_metal();
+            break;
         case CUDADebug:
             one_gpu.set_feature(Target::Debug);
             one_gpu.set_feature(Target::CUDA);
@@ -735,6 +888,15 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 internal_error << "JIT support for Direct3D 12 is only implemented on Windows 10 and above.\n";
             #endif
             break;
+        case VulkanDebug:
+            one_gpu.set_feature(Target::Debug);
+            one_gpu.set_feature(Target::Vulkan);
+            module_name = "debug_vulkan";
+            break;
+        case Vulkan:
+            one_gpu.set_feature(Target::Vulkan);
+            module_name += "vulkan";
+            break;
         default:
             module_name = "shared runtime";
             break;
@@ -747,6 +909,17 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             clone_target_options(*for_module, *module);
         }
         module->setModuleIdentifier(module_name);
+        if (JITObjectCache::get()) {
+            // The shared runtimes don't vary with the pipelines using
+            // them, so their object code can be kept on disk and
+            // reused by later runs. It depends only on the runtime
+            // kind, the target, and the build of the compiler.
+            string build = "llvm " + std::to_string(LLVM_VERSION) + " " + __DATE__ + " " + __TIME__;
+            std::ostringstream key;
+            key << "runtime_" << one_gpu.to_string() << "_" << runtime_kind << "_"
+                << std::hex << std::hash<string>()(build);
+            module->setModuleIdentifier(JITObjectCache::prefix + key.str());
+        }
 
         std::set<std::string> halide_exports_unique;
 
@@ -800,6 +973,14 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 runtime.memoization_cache_set_size(default_cache_size);
             }
 
+            if (default_device_cache_size != 0) {
+                runtime.memoization_cache_set_device_size(default_device_cache_size);
+            }
+
+            if (default_cache_shards != 0 || default_cache_buckets_per_shard != 0) {
+                runtime.memoization_cache_set_shards(default_cache_shards, default_cache_buckets_per_shard);
+            }
+
             runtime.jit_module->name = "MainShared";
         } else {
             runtime.jit_module->name = "GPU";
@@ -827,7 +1008,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
  * counted, but a global keeps one ref alive until shutdown or when
  * JITSharedRuntime::release_all is called. If
  * JITSharedRuntime::release_all is called, the global state is reset
- * and any newly compiled Funcs will get a new runtime. */
+ * and any newly compiled Funcs will get a new runtime. If
+ * HL_JIT_CACHE_DIR is set, the object code of the shared runtimes is
+ * kept there too, so later processes skip compiling them. */
 std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Target &target, bool create) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
@@ -841,14 +1024,17 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
     // Add all requested GPU modules, each only depending on the main shared runtime.
     std::vector<JITModule> gpu_modules;
     if (target.has_feature(Target::OpenCL)) {
-        auto kind = target.has_feature(Target::Debug) ? OpenCLDebug : OpenCL;
+        // The JIT keeps no debug zero-copy runtime; debug takes precedence.
+        auto kind = target.has_feature(Target::Debug) ? OpenCLDebug :
+                    target.has_feature(Target::ZeroCopy) ? OpenCLZeroCopy : OpenCL;
         JITModule m = make_module(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
         }
     }
     if (target.has_feature(Target::Metal)) {
-        auto kind = target.has_feature(Target::Debug) ? MetalDebug : Metal;
+        auto kind = target.has_feature(Target::Debug) ? MetalDebug :
+                    target.has_feature(Target::ZeroCopy) ? MetalZeroCopy : Metal;
         JITModule m = make_module(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
@@ -889,6 +1075,13 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
             result.push_back(m);
         }
     }
+    if (target.has_feature(Target::Vulkan)) {
+        auto kind = target.has_feature(Target::Debug) ? VulkanDebug : Vulkan;
+        JITModule m = make_module(for_module, target, kind, result, create);
+        if (m.compiled()) {
+            result.push_back(m);
+        }
+    }
 
     return result;
 }
@@ -905,6 +1098,19 @@ void JITSharedRuntime::init_jit_user_context(JITUserContext &jit_user_context,
     merge_handlers(jit_user_context.handlers, handlers);
 }
 
+void JITSharedRuntime::release_unused() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    // Go in reverse order, so that the GPU runtimes release their
+    // references to the main one before it is considered.
+    for (int i = MaxRuntimeKind; i > 0; i--) {
+        JITModule &runtime = shared_runtimes((RuntimeKind)(i - 1));
+        if (runtime.compiled() && runtime.jit_module->ref_count.get() == 1) {
+            runtime = JITModule();
+        }
+    }
+}
+
 void JITSharedRuntime::release_all() {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
@@ -930,5 +1136,33 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_set_device_size(int64_t size) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    if (size != default_device_cache_size) {
+        default_device_cache_size = size;
+        shared_runtimes(MainShared).memoization_cache_set_device_size(size);
+    }
+}
+
+void JITSharedRuntime::memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    if (num_shards != default_cache_shards ||
+        buckets_per_shard != default_cache_buckets_per_shard) {
+        default_cache_shards = num_shards;
+        default_cache_buckets_per_shard = buckets_per_shard;
+        shared_runtimes(MainShared).memoization_cache_set_shards(num_shards, buckets_per_shard);
+    }
+}
+
+halide_memoization_cache_stats_t JITSharedRuntime::memoization_cache_get_stats() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    halide_memoization_cache_stats_t stats;
+    shared_runtimes(MainShared).memoization_cache_get_stats(&stats);
+    return stats;
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -41,8 +41,25 @@ struct JITModule {
     };
 
     JITModule();
+    /** Compile a Halide Module. If object_cache_key is non-empty and
+     * the environment variable HL_JIT_CACHE_DIR names a directory,
+     * the object code is saved there under that key, and later
+     * compilations with the same key load it instead of running LLVM
+     * code generation again. The caller is responsible for making
+     * the key unique to everything the object code depends on. If
+     * optimize is false, llvm does only the optimization needed for
+     * correct code, which compiles quickly but runs slowly. */
     JITModule(const Module &m, const LoweredFunc &fn,
-                     const std::vector<JITModule> &dependencies = std::vector<JITModule>());
+                     const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
+                     const std::string &object_cache_key = std::string(),
+                     bool optimize = true);
+    /** Compile llvm bitcode produced by compiling a Module for a
+     * target with the jit feature, e.g. the bitcode held by a
+     * SerializedPipeline. function_name names the entrypoint, and
+     * object_cache_key is as above. */
+    JITModule(const std::string &bitcode, const std::string &function_name, const Target &target,
+              const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
+              const std::string &object_cache_key = std::string());
     /** The exports map of a JITModule contains all symbols which are
      * available to other JITModules which depend on this one. For
      * runtime modules, this is all of the symbols exported from the
@@ -107,14 +124,19 @@ struct JITModule {
     Symbol find_symbol_by_name(const std::string &) const;
 
     /** Take an llvm module and compile it. The requested exports will
-        be available via the exports method. */
+        be available via the exports method. If optimize is false,
+        machine code is generated at the lowest optimization level. */
     void compile_module(std::unique_ptr<llvm::Module> mod,
                         const std::string &function_name, const Target &target,
                         const std::vector<JITModule> &dependencies = std::vector<JITModule>(),
-                        const std::vector<std::string> &requested_exports = std::vector<std::string>());
+                        const std::vector<std::string> &requested_exports = std::vector<std::string>(),
+                        bool optimize = true);
 
     /** Encapsulate device (GPU) and buffer interactions. */
     void memoization_cache_set_size(int64_t size) const;
+    void memoization_cache_set_device_size(int64_t size) const;
+    void memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard) const;
+    void memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const;
 
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
@@ -153,6 +175,34 @@ public:
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Set the maximum number of bytes of device memory used by
+     * memoization caching. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_memoization_cache_set_device_size() instead.
+     */
+    static void memoization_cache_set_device_size(int64_t size);
+
+    /** Set the number of shards and the initial number of buckets per
+     * shard used by memoization caching. This flushes the cache. If
+     * you are compiling statically, you should include HalideRuntime.h
+     * and call halide_memoization_cache_set_shards() instead.
+     */
+    static void memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard);
+
+    /** Get the hit, miss and eviction counts and the current size of
+     * the memoization cache. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_memoization_cache_get_stats() instead.
+     */
+    static halide_memoization_cache_stats_t memoization_cache_get_stats();
+
+    /** Release the shared runtimes that no compiled pipeline or
+     * live device allocation uses any more, e.g. the GPU runtime once
+     * the last GPU pipeline is gone. Pipelines compiled later get
+     * new ones. Releasing the main runtime also flushes the
+     * memoization cache. */
+    static void release_unused();
+
     static void release_all();
 };
 
@@ -2,6 +2,7 @@
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
 #include "CodeGen_LLVM.h"
+#include "CompileTrace.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
 
@@ -340,6 +341,7 @@ std::unique_ptr<llvm::Module> clone_module(const llvm::Module &module_in) {
 }  // namespace
 
 void emit_file(const llvm::Module &module_in, Internal::LLVMOStream& out, llvm::TargetMachine::CodeGenFileType file_type) {
+    Internal::CompileTraceEvent trace_event("Compiling LLVM module to native code", "llvm");
     Internal::debug(1) << "emit_file.Compiling to native code...\n";
     Internal::debug(2) << "Target triple: " << module_in.getTargetTriple() << "\n";
 
@@ -387,8 +389,9 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream& out, llvm::
     pass_manager.run(*module);
 }
 
-std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
-    return codegen_llvm(module, context);
+std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context,
+                                                            bool optimize) {
+    return codegen_llvm(module, context, optimize);
 }
 
 void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream& out) {
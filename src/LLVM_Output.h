@@ -28,7 +28,8 @@ typedef llvm::raw_pwrite_stream LLVMOStream;
 }
 
 /** Generate an LLVM module. */
-std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context);
+std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context,
+                                                            bool optimize = true);
 
 /** Construct an llvm output stream for writing to files. */
 std::unique_ptr<llvm::raw_fd_ostream> make_raw_fd_ostream(const std::string &filename);
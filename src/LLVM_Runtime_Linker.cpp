@@ -1,5 +1,12 @@
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
+#include "Util.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
 
 namespace Halide {
 
@@ -73,6 +80,7 @@ DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
 DECLARE_CPP_INITMOD(android_opengl_context)
 DECLARE_CPP_INITMOD(android_tempfile)
+DECLARE_CPP_INITMOD(batch)
 DECLARE_CPP_INITMOD(buffer_t)
 DECLARE_CPP_INITMOD(cache)
 DECLARE_CPP_INITMOD(can_use_target)
@@ -94,7 +102,9 @@ DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_huge_pages)
 DECLARE_CPP_INITMOD(linux_opengl_context)
+DECLARE_CPP_INITMOD(linux_profiler)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(matlab)
 DECLARE_CPP_INITMOD(metadata)
@@ -105,6 +115,7 @@ DECLARE_CPP_INITMOD(msan)
 DECLARE_CPP_INITMOD(msan_stubs)
 DECLARE_CPP_INITMOD(old_buffer_t)
 DECLARE_CPP_INITMOD(opencl)
+DECLARE_CPP_INITMOD(opencl_zero_copy)
 DECLARE_CPP_INITMOD(opengl)
 DECLARE_CPP_INITMOD(openglcompute)
 DECLARE_CPP_INITMOD(osx_clock)
@@ -112,6 +123,8 @@ DECLARE_CPP_INITMOD(osx_get_symbol)
 DECLARE_CPP_INITMOD(osx_host_cpu_count)
 DECLARE_CPP_INITMOD(osx_opengl_context)
 DECLARE_CPP_INITMOD(osx_yield)
+DECLARE_CPP_INITMOD(paged_input)
+DECLARE_CPP_INITMOD(pool_allocator)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
@@ -126,19 +139,29 @@ DECLARE_CPP_INITMOD(profiler)
 DECLARE_CPP_INITMOD(profiler_inlined)
 DECLARE_CPP_INITMOD(qurt_allocator)
 DECLARE_CPP_INITMOD(qurt_hvx)
+DECLARE_CPP_INITMOD(qurt_hvx_dma)
+DECLARE_CPP_INITMOD(qurt_hvx_vtcm)
 DECLARE_CPP_INITMOD(qurt_init_fini)
 DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(scratch_pool)
+DECLARE_CPP_INITMOD(shape_cache)
 DECLARE_CPP_INITMOD(ssp)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(tracing)
+#ifdef WITH_VULKAN
+DECLARE_CPP_INITMOD(vulkan)
+#else
+DECLARE_NO_INITMOD(vulkan)
+#endif  // WITH_VULKAN
 DECLARE_CPP_INITMOD(windows_clock)
 DECLARE_CPP_INITMOD(windows_cuda)
 DECLARE_CPP_INITMOD(windows_get_symbol)
 DECLARE_CPP_INITMOD(windows_io)
 DECLARE_CPP_INITMOD(windows_opencl)
+DECLARE_CPP_INITMOD(windows_opencl_zero_copy)
 DECLARE_CPP_INITMOD(windows_profiler)
 DECLARE_CPP_INITMOD(windows_tempfile)
 DECLARE_CPP_INITMOD(windows_threads)
@@ -154,6 +177,7 @@ DECLARE_LL_INITMOD(ptx_dev)
 // Various conditional initmods follow (both LL and CPP).
 #ifdef WITH_METAL
 DECLARE_CPP_INITMOD(metal)
+DECLARE_CPP_INITMOD(metal_zero_copy)
 #ifdef WITH_ARM
 DECLARE_CPP_INITMOD(metal_objc_arm)
 #else
@@ -166,6 +190,7 @@ DECLARE_NO_INITMOD(metal_objc_x86)
 #endif
 #else
 DECLARE_NO_INITMOD(metal)
+DECLARE_NO_INITMOD(metal_zero_copy)
 DECLARE_NO_INITMOD(metal_objc_arm)
 DECLARE_NO_INITMOD(metal_objc_x86)
 #endif  // WITH_METAL
@@ -599,8 +624,10 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
+namespace {
+
 /** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+std::unique_ptr<llvm::Module> make_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -638,6 +665,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             // OS-dependent modules
             if (t.os == Target::Linux) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 if (t.arch == Target::X86) {
@@ -672,6 +700,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_osx_get_symbol(c, bits_64, debug));
             } else if (t.os == Target::Android) {
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_huge_pages(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 if (t.arch == Target::ARM) {
@@ -773,8 +802,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 // TODO: Support this module in the Hexagon backend,
                 // currently generates assert at src/HexagonOffload.cpp:279
                 modules.push_back(get_initmod_cache(c, bits_64, debug));
+                modules.push_back(get_initmod_paged_input(c, bits_64, debug));
             }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
+            modules.push_back(get_initmod_pool_allocator(c, bits_64, debug));
+            modules.push_back(get_initmod_scratch_pool(c, bits_64, debug));
+            modules.push_back(get_initmod_shape_cache(c, bits_64, debug));
 
             if (t.arch == Target::Hexagon ||
                 t.has_feature(Target::HVX_64) ||
@@ -811,6 +844,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 t.os != Target::QuRT) {
                 if (t.os == Target::Windows) {
                     modules.push_back(get_initmod_windows_profiler(c, bits_64, debug));
+                } else if (t.os == Target::Linux && t.arch == Target::X86) {
+                    // Can read hardware performance counters.
+                    modules.push_back(get_initmod_linux_profiler(c, bits_64, debug));
                 } else {
                     modules.push_back(get_initmod_profiler(c, bits_64, debug));
                 }
@@ -847,6 +883,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
             if (t.arch == Target::Hexagon) {
                 modules.push_back(get_initmod_qurt_hvx(c, bits_64, debug));
+                if (t.has_feature(Target::HVX_v65) || t.has_feature(Target::HVX_v66)) {
+                    modules.push_back(get_initmod_qurt_hvx_vtcm(c, bits_64, debug));
+                }
+                if (t.has_feature(Target::HVX_v66)) {
+                    modules.push_back(get_initmod_qurt_hvx_dma(c, bits_64, debug));
+                }
                 if (t.has_feature(Target::HVX_64)) {
                     modules.push_back(get_initmod_hvx_64_ll(c));
                 } else if (t.has_feature(Target::HVX_128)) {
@@ -910,10 +952,19 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
         }
         if (t.has_feature(Target::OpenCL)) {
+            bool zero_copy = t.has_feature(Target::ZeroCopy);
             if (t.os == Target::Windows) {
-                modules.push_back(get_initmod_windows_opencl(c, bits_64, debug));
+                if (zero_copy) {
+                    modules.push_back(get_initmod_windows_opencl_zero_copy(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_windows_opencl(c, bits_64, debug));
+                }
             } else {
-                modules.push_back(get_initmod_opencl(c, bits_64, debug));
+                if (zero_copy) {
+                    modules.push_back(get_initmod_opencl_zero_copy(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_opencl(c, bits_64, debug));
+                }
             }
         }
         if (t.has_feature(Target::OpenGL)) {
@@ -943,7 +994,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
 
         }
         if (t.has_feature(Target::Metal)) {
-            modules.push_back(get_initmod_metal(c, bits_64, debug));
+            if (t.has_feature(Target::ZeroCopy)) {
+                modules.push_back(get_initmod_metal_zero_copy(c, bits_64, debug));
+            } else {
+                modules.push_back(get_initmod_metal(c, bits_64, debug));
+            }
             if (t.arch == Target::ARM) {
                 modules.push_back(get_initmod_metal_objc_arm(c, bits_64, debug));
             } else if (t.arch == Target::X86) {
@@ -958,6 +1013,9 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_d3d12_abi_patch_64_ll(c));
             modules.push_back(get_initmod_d3d12compute(c, bits_64, debug));
         }
+        if (t.has_feature(Target::Vulkan)) {
+            modules.push_back(get_initmod_vulkan(c, bits_64, debug));
+        }
         if (t.arch != Target::Hexagon && t.features_any_of({Target::HVX_64, Target::HVX_128})) {
             modules.push_back(get_initmod_module_jit_ref_count(c, bits_64, debug));
             modules.push_back(get_initmod_hexagon_host(c, bits_64, debug));
@@ -968,6 +1026,10 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
         modules.push_back(get_initmod_matlab(c, bits_64, debug));
     }
 
+    if (module_type == ModuleAOT && t.has_feature(Target::Batch)) {
+        modules.push_back(get_initmod_batch(c, bits_64, debug));
+    }
+
     if (module_type == ModuleAOTNoRuntime ||
         module_type == ModuleJITInlined ||
         t.os == Target::NoOS) {
@@ -989,6 +1051,111 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+// Parsing and linking the runtime bitcode is a large part of the
+// time it takes to jit-compile a small pipeline. The linked runtime
+// depends only on the target and the kind of module requested, so we
+// keep its bitcode around, in memory and (if HL_JIT_CACHE_DIR is set)
+// on disk next to the cached jit objects, and parse just that one
+// module the next time it is asked for.
+class RuntimeBitcodeCache {
+    std::mutex mutex;
+    std::map<string, string> bitcode;
+    string dir;
+
+    string path_for(const string &key) const {
+        return dir + "/halide_runtime_" + key + ".bc";
+    }
+
+public:
+    RuntimeBitcodeCache() : dir(get_env_variable("HL_JIT_CACHE_DIR")) {}
+
+    static RuntimeBitcodeCache &get() {
+        static RuntimeBitcodeCache cache;
+        return cache;
+    }
+
+    bool lookup(const string &key, string &result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = bitcode.find(key);
+        if (it != bitcode.end()) {
+            result = it->second;
+            return true;
+        }
+        if (dir.empty()) {
+            return false;
+        }
+        auto buf = llvm::MemoryBuffer::getFile(path_for(key));
+        if (!buf) {
+            return false;
+        }
+        result = (*buf)->getBuffer().str();
+        bitcode[key] = result;
+        debug(2) << "Loaded cached runtime bitcode from " << path_for(key) << "\n";
+        return true;
+    }
+
+    void insert(const string &key, const llvm::Module &module) {
+        string result;
+        {
+            llvm::raw_string_ostream out(result);
+#if LLVM_VERSION >= 70
+            WriteBitcodeToFile(module, out);
+#else
+            WriteBitcodeToFile(&module, out);
+#endif
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        bitcode[key] = result;
+        if (dir.empty()) {
+            return;
+        }
+        // Write to a temporary file and rename it into place, so that
+        // other processes sharing the directory never see a partially
+        // written file.
+        llvm::sys::fs::create_directories(dir);
+        int fd;
+        llvm::SmallString<128> tmp_path;
+        string path = path_for(key);
+        if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmp_path)) {
+            debug(1) << "Could not create a temporary file to cache " << path << "\n";
+            return;
+        }
+        {
+            llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+            out << result;
+        }
+        if (llvm::sys::fs::rename(tmp_path, path)) {
+            llvm::sys::fs::remove(tmp_path);
+        }
+    }
+};
+
+}  // namespace
+
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    // Only the jit pays for building the runtime at every process
+    // start, so only it uses the cache.
+    if (!t.has_feature(Target::JIT)) {
+        return make_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+    }
+
+    // The key also covers the build of the compiler, which determines
+    // the contents of the runtime bitcode.
+    string build = "llvm " + std::to_string(LLVM_VERSION) + " " + __DATE__ + " " + __TIME__;
+    std::ostringstream key;
+    key << t.to_string() << "_" << for_shared_jit_runtime << just_gpu << "_"
+        << std::hex << std::hash<string>()(build);
+
+    RuntimeBitcodeCache &cache = RuntimeBitcodeCache::get();
+    string bitcode;
+    if (cache.lookup(key.str(), bitcode)) {
+        return parse_bitcode_file(bitcode, c, "halide_runtime");
+    }
+    std::unique_ptr<llvm::Module> module = make_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+    cache.insert(key.str(), *module);
+    return module;
+}
+
 #ifdef WITH_PTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
@@ -1060,6 +1227,166 @@ void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
     }
 }
 
+namespace {
+
+// Tracks the functions and global variables reachable from a set of
+// roots, through calls, address-taking and variable initializers.
+class RuntimeReachability {
+    std::set<const llvm::Constant *> visited_constants;
+    vector<const llvm::GlobalValue *> pending;
+
+    void visit_value(const llvm::Value *v) {
+        if (const llvm::GlobalValue *g = llvm::dyn_cast<llvm::GlobalValue>(v)) {
+            mark(g);
+        } else if (const llvm::Constant *c = llvm::dyn_cast<llvm::Constant>(v)) {
+            if (visited_constants.insert(c).second) {
+                for (const llvm::Use &op : c->operands()) {
+                    visit_value(op.get());
+                }
+            }
+        }
+    }
+
+public:
+    std::set<const llvm::GlobalValue *> reachable;
+
+    void mark(const llvm::GlobalValue *g) {
+        if (reachable.insert(g).second) {
+            pending.push_back(g);
+        }
+    }
+
+    void propagate() {
+        while (!pending.empty()) {
+            const llvm::GlobalValue *g = pending.back();
+            pending.pop_back();
+            if (const llvm::Function *f = llvm::dyn_cast<llvm::Function>(g)) {
+                for (const llvm::BasicBlock &b : *f) {
+                    for (const llvm::Instruction &i : b) {
+                        for (const llvm::Use &op : i.operands()) {
+                            visit_value(op.get());
+                        }
+                    }
+                }
+            } else if (const llvm::GlobalVariable *v = llvm::dyn_cast<llvm::GlobalVariable>(g)) {
+                if (v->hasInitializer()) {
+                    visit_value(v->getInitializer());
+                }
+            } else if (const llvm::GlobalAlias *a = llvm::dyn_cast<llvm::GlobalAlias>(g)) {
+                visit_value(a->getAliasee());
+            }
+        }
+    }
+};
+
+// The functions named by llvm.global_ctors or llvm.global_dtors.
+vector<llvm::Function *> get_structors(llvm::Module &module, const char *name) {
+    vector<llvm::Function *> result;
+    llvm::GlobalVariable *gv = module.getNamedGlobal(name);
+    if (!gv || !gv->hasInitializer()) {
+        return result;
+    }
+    if (const llvm::ConstantArray *init = llvm::dyn_cast<llvm::ConstantArray>(gv->getInitializer())) {
+        for (const llvm::Use &entry : init->operands()) {
+            const llvm::ConstantStruct *s = llvm::cast<llvm::ConstantStruct>(entry.get());
+            if (llvm::Function *f = llvm::dyn_cast<llvm::Function>(s->getOperand(1)->stripPointerCasts())) {
+                result.push_back(f);
+            }
+        }
+    }
+    return result;
+}
+
+// Drop the entries of llvm.global_ctors or llvm.global_dtors that
+// name a function not in keep.
+void prune_structors(llvm::Module &module, const char *name,
+                     const std::set<const llvm::GlobalValue *> &keep) {
+    llvm::GlobalVariable *gv = module.getNamedGlobal(name);
+    if (!gv || !gv->hasInitializer()) {
+        return;
+    }
+    const llvm::ConstantArray *init = llvm::dyn_cast<llvm::ConstantArray>(gv->getInitializer());
+    if (!init) {
+        return;
+    }
+    vector<llvm::Constant *> entries;
+    for (const llvm::Use &entry : init->operands()) {
+        llvm::ConstantStruct *s = llvm::cast<llvm::ConstantStruct>(entry.get());
+        const llvm::Function *f = llvm::dyn_cast<llvm::Function>(s->getOperand(1)->stripPointerCasts());
+        if (!f || keep.count(f)) {
+            entries.push_back(s);
+        }
+    }
+    if (entries.size() == init->getNumOperands()) {
+        return;
+    }
+    llvm::ArrayType *type = llvm::ArrayType::get(init->getType()->getElementType(), entries.size());
+    llvm::GlobalVariable *pruned =
+        new llvm::GlobalVariable(module, type, false, gv->getLinkage(),
+                                 llvm::ConstantArray::get(type, entries), "");
+    pruned->takeName(gv);
+    gv->eraseFromParent();
+}
+
+}  // namespace
+
+void strip_runtime(llvm::Module &module, const std::set<std::string> &entry_points) {
+    RuntimeReachability r;
+    for (const string &name : entry_points) {
+        if (const llvm::GlobalValue *g = module.getNamedValue(name)) {
+            r.mark(g);
+        }
+    }
+    r.propagate();
+
+    // A static constructor or destructor is needed if it touches a
+    // variable the entry points also touch, e.g. the destructor that
+    // shuts down the thread pool is needed if anything uses the thread
+    // pool. Keeping one can make more state reachable, so iterate.
+    vector<llvm::Function *> structors = get_structors(module, "llvm.global_ctors");
+    vector<llvm::Function *> dtors = get_structors(module, "llvm.global_dtors");
+    structors.insert(structors.end(), dtors.begin(), dtors.end());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (llvm::Function *f : structors) {
+            if (r.reachable.count(f)) {
+                continue;
+            }
+            RuntimeReachability uses;
+            uses.mark(f);
+            uses.propagate();
+            for (const llvm::GlobalValue *g : uses.reachable) {
+                const llvm::GlobalVariable *v = llvm::dyn_cast<llvm::GlobalVariable>(g);
+                if (v && !v->isConstant() && r.reachable.count(v)) {
+                    r.mark(f);
+                    r.propagate();
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    prune_structors(module, "llvm.global_ctors", r.reachable);
+    prune_structors(module, "llvm.global_dtors", r.reachable);
+
+    // Everything else can go.
+    for (llvm::Function &f : module) {
+        if (!f.isDeclaration() && !r.reachable.count(&f)) {
+            f.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+    for (llvm::GlobalVariable &v : module.globals()) {
+        if (!v.isDeclaration() && !r.reachable.count(&v) &&
+            !v.getName().startswith("llvm.")) {
+            v.setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+    llvm::legacy::PassManager pm;
+    pm.add(llvm::createGlobalDCEPass());
+    pm.run(module);
+}
+
 }  // namespace Internal
 
 }  // namespace Halide
@@ -7,6 +7,7 @@
 
 #include "Target.h"
 #include <memory>
+#include <set>
 
 namespace llvm {
 class Module;
@@ -30,6 +31,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target, llvm::LL
 void add_bitcode_to_module(llvm::LLVMContext *context, llvm::Module &module,
                            const std::vector<uint8_t> &bitcode, const std::string &name);
 
+/** Remove everything from a runtime module that can't be reached from
+ * the given entry points. Static constructors and destructors are kept
+ * only if they touch state that is reachable from the entry points. */
+void strip_runtime(llvm::Module &module, const std::set<std::string> &entry_points);
+
 }  // namespace Internal
 }  // namespace Halide
 
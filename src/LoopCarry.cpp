@@ -105,6 +105,19 @@ public:
     vector<const Load *> result;
 };
 
+/** Find the names of all the buffers stored to. */
+class FindStores : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Store *op) override {
+        result.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    set<string> result;
+};
+
 /** A helper for block_to_vector below. */
 void block_to_vector(Stmt s, vector<Stmt> &v) {
     const Block *b = s.as<Block>();
@@ -244,6 +257,137 @@ class LoopCarryOverLoop : public IRMutator2 {
         return Block::make(result);
     }
 
+    // Check if it's safe to reuse a load on a later loop
+    // iteration. The buffer must not change while the loop runs.
+    bool safe_to_carry(const Load *load, const set<string> &stored) {
+        return ((load->image.defined() ||
+                 load->param.defined() ||
+                 in_consume.contains(load->name)) &&
+                !stored.count(load->name));
+    }
+
+    /** Dense vector loads from a single buffer that all move forwards
+     * by one vector per loop iteration, and that are less than a
+     * vector apart, overlap with the same loads on the next
+     * iteration, but never exactly match one of them, so they can't
+     * be carried as they are. Instead, keep a sliding window of the
+     * frontmost of these vectors on this iteration and the last,
+     * and make the others by shuffling it. Then only one vector
+     * needs to be loaded per iteration. Returns the rewritten stmt,
+     * and adds the number of vectors kept in registers to
+     * carried. */
+    Stmt slide_vector_loads(Stmt graph_stmt, const set<string> &stored, int &carried) {
+        FindLoads find_loads;
+        graph_stmt.accept(&find_loads);
+
+        // Group the loads into windows, by their offset from the
+        // first load seen of each.
+        struct Window {
+            vector<pair<const Load *, int>> loads;
+            int min_offset = 0, max_offset = 0;
+        };
+        vector<Window> windows;
+        for (const Load *load : find_loads.result) {
+            const Ramp *ramp = load->index.as<Ramp>();
+            const int lanes = load->type.lanes();
+            if (!ramp || !is_one(ramp->stride) || lanes < 2 ||
+                !is_one(load->predicate) || !safe_to_carry(load, stored)) {
+                continue;
+            }
+            Expr step = is_linear(ramp->base, linear);
+            if (!step.defined() || !is_const(simplify(step), lanes)) {
+                continue;
+            }
+
+            bool represented = false;
+            for (Window &w : windows) {
+                const Load *first = w.loads[0].first;
+                if (first->name != load->name || first->type != load->type) {
+                    continue;
+                }
+                Expr delta = ramp->base - first->index.as<Ramp>()->base;
+                delta = simplify(common_subexpression_elimination(delta));
+                const int64_t *offset = as_const_int(delta);
+                if (offset && std::abs(*offset) < lanes) {
+                    w.loads.push_back({load, (int)*offset});
+                    w.min_offset = std::min(w.min_offset, (int)*offset);
+                    w.max_offset = std::max(w.max_offset, (int)*offset);
+                    represented = true;
+                    break;
+                }
+            }
+            if (!represented) {
+                windows.emplace_back();
+                windows.back().loads.push_back({load, 0});
+            }
+        }
+
+        for (const Window &w : windows) {
+            const Load *first = w.loads[0].first;
+            const int lanes = first->type.lanes();
+            const int span = w.max_offset - w.min_offset;
+            if (span == 0 || span >= lanes ||
+                carried + 2 > max_carried_values) {
+                continue;
+            }
+            carried += 2;
+
+            const Load *front = nullptr, *back = nullptr;
+            for (const auto &l : w.loads) {
+                if (l.second == w.max_offset) {
+                    front = l.first;
+                }
+                if (l.second == w.min_offset) {
+                    back = l.first;
+                }
+            }
+
+            debug(3) << "Found sliding window of " << w.loads.size()
+                     << " vector loads with leading edge: " << Expr(front) << "\n";
+
+            // The scratch buffer holds the frontmost vector from the
+            // last iteration, followed by the one from this iteration.
+            string scratch = unique_name('c');
+            Type t = first->type;
+            Expr window = Load::make(t.with_lanes(2 * lanes), scratch, Ramp::make(0, 1, 2 * lanes),
+                                     Buffer<>(), Parameter(), const_true(2 * lanes));
+            for (const auto &l : w.loads) {
+                Expr slice = Shuffle::make_slice(window, lanes - (w.max_offset - l.second), 1, lanes);
+                graph_stmt = graph_substitute(l.first, slice, graph_stmt);
+            }
+
+            Stmt load_front = Store::make(scratch, front, Ramp::make(lanes, 1, lanes),
+                                          Parameter(), const_true(lanes));
+            Expr last_front = Load::make(t, scratch, Ramp::make(lanes, 1, lanes),
+                                         Buffer<>(), Parameter(), const_true(lanes));
+            Stmt shift = Store::make(scratch, last_front, Ramp::make(0, 1, lanes),
+                                     Parameter(), const_true(lanes));
+            graph_stmt = Block::make({load_front, graph_stmt, shift});
+
+            // On the first iteration, the part of the last iteration's
+            // front vector that gets used is the start of the rearmost
+            // load. The rest of it goes unused. Don't load it, because
+            // it may be out of bounds.
+            vector<int> indices(lanes);
+            for (int i = 0; i < lanes; i++) {
+                indices[i] = std::max(0, i - (lanes - span));
+            }
+            Expr initial_value = common_subexpression_elimination(Shuffle::make({back}, indices));
+            Stmt initial_stores = Store::make(scratch, initial_value, Ramp::make(0, 1, lanes),
+                                              Parameter(), const_true(lanes));
+            for (size_t i = containing_lets.size(); i > 0; i--) {
+                auto l = containing_lets[i-1];
+                if (stmt_uses_var(initial_stores, l.first)) {
+                    initial_stores = LetStmt::make(l.first, l.second, initial_stores);
+                }
+            }
+
+            allocs.push_back({scratch, t.element_of(), 2 * lanes, initial_stores});
+        }
+
+        return graph_stmt;
+    }
+
     Stmt lift_carried_values_out_of_stmt(const Stmt &orig_stmt) {
         debug(4) << "About to lift carried values out of stmt: " << orig_stmt << "\n";
 
@@ -252,6 +396,16 @@ class LoopCarryOverLoop : public IRMutator2 {
         // exponential runtime.
         Stmt graph_stmt = substitute_in_all_lets(orig_stmt);
 
+        FindStores find_stores;
+        graph_stmt.accept(&find_stores);
+
+        // Turn overlapping vector loads into sliding windows first,
+        // which count towards the limit on carried values.
+        int carried = 0;
+        size_t old_allocs = allocs.size();
+        graph_stmt = slide_vector_loads(graph_stmt, find_stores.result, carried);
+        const bool slid = allocs.size() > old_allocs;
+
         // Find all the loads in these stmts.
         FindLoads find_loads;
         graph_stmt.accept(&find_loads);
@@ -261,11 +415,7 @@ class LoopCarryOverLoop : public IRMutator2 {
         // Group equal loads
         vector<vector<const Load *>> loads;
         for (const Load *load : find_loads.result) {
-            // Check if it's safe to lift out.
-            bool safe = (load->image.defined() ||
-                         load->param.defined() ||
-                         in_consume.contains(load->name));
-            if (!safe) continue;
+            if (!safe_to_carry(load, find_stores.result)) continue;
 
             bool represented = false;
             for (vector<const Load *> &v : loads) {
@@ -308,7 +458,7 @@ class LoopCarryOverLoop : public IRMutator2 {
             }
         }
 
-        if (chains.empty()) {
+        if (chains.empty() && !slid) {
             return orig_stmt;
         }
 
@@ -356,7 +506,7 @@ class LoopCarryOverLoop : public IRMutator2 {
         // spray stack spills everywhere. This is ugly, because we're
         // relying on a heuristic.
         vector<vector<int>> trimmed;
-        size_t sz = 0;
+        size_t sz = carried;
         for (const vector<int> &c : chains) {
             if (sz + c.size() > (size_t)max_carried_values) {
                 if (sz < (size_t)max_carried_values - 1) {
@@ -370,6 +520,11 @@ class LoopCarryOverLoop : public IRMutator2 {
         }
         chains.swap(trimmed);
 
+        if (chains.empty()) {
+            // The sliding windows used up all the registers.
+            return common_subexpression_elimination(graph_stmt);
+        }
+
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
 
@@ -506,6 +661,11 @@ class LoopCarry : public IRMutator2 {
     int max_carried_values;
     Scope<> in_consume;
 
+    // If set, only carry values over loops inside GPU kernels that
+    // can keep the scratch buffers in registers.
+    bool only_in_gpu_kernels;
+    bool in_gpu_kernel = false;
+
     Stmt visit(const ProducerConsumer *op) override {
         if (op->is_producer) {
             return IRMutator2::visit(op);
@@ -517,6 +677,20 @@ class LoopCarry : public IRMutator2 {
     }
 
     Stmt visit(const For *op) override {
+        if (only_in_gpu_kernels && !in_gpu_kernel) {
+            if (op->for_type == ForType::GPUBlock &&
+                (op->device_api == DeviceAPI::CUDA ||
+                 op->device_api == DeviceAPI::OpenCL ||
+                 op->device_api == DeviceAPI::Metal ||
+                 op->device_api == DeviceAPI::D3D12Compute ||
+                 op->device_api == DeviceAPI::Vulkan)) {
+                in_gpu_kernel = true;
+                Stmt stmt = IRMutator2::visit(op);
+                in_gpu_kernel = false;
+                return stmt;
+            }
+            return IRMutator2::visit(op);
+        }
         if (op->for_type == ForType::Serial && !is_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
@@ -543,13 +717,19 @@ class LoopCarry : public IRMutator2 {
     }
 
 public:
-    LoopCarry(int max_carried_values) : max_carried_values(max_carried_values) {}
+    LoopCarry(int max_carried_values, bool only_in_gpu_kernels)
+        : max_carried_values(max_carried_values), only_in_gpu_kernels(only_in_gpu_kernels) {}
 };
 
 }  // namespace
 
 Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+    s = LoopCarry(max_carried_values, false).mutate(s);
+    return s;
+}
+
+Stmt loop_carry_in_gpu_kernels(Stmt s, int max_carried_values) {
+    s = LoopCarry(max_carried_values, true).mutate(s);
     return s;
 }
 
@@ -11,9 +11,16 @@ namespace Internal {
  * predicated, the predicates need to match. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
  * and how many memory issue slots there are. Currently only intended
- * for Hexagon. */
+ * for Hexagon. Dense vector loads that overlap with the next
+ * iteration's loads without matching them are kept in a sliding
+ * window, so only the leading vector is loaded each iteration. */
 Stmt loop_carry(Stmt, int max_carried_values = 8);
 
+/** Do loop_carry on the serial loops inside GPU kernels only. Each
+ * GPU thread keeps its carried values in registers, which saves
+ * reloading the neighbors of a stencil from global memory. */
+Stmt loop_carry_in_gpu_kernels(Stmt, int max_carried_values = 8);
+
 }  // namespace Internal
 }  // namespace Halide
 
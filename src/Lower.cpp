@@ -1,5 +1,8 @@
 #include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <sstream>
 
@@ -8,21 +11,30 @@
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
+#include "ApproximateMath.h"
+#include "Associativity.h"
+#include "AsyncProducers.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
+#include "CPUVariants.h"
 #include "CSE.h"
 #include "CanonicalizeGPUVars.h"
+#include "CompileTrace.h"
 #include "Debug.h"
 #include "DebugArguments.h"
 #include "DebugToFile.h"
 #include "Deinterleave.h"
+#include "DistributeGPUs.h"
 #include "EarlyFree.h"
+#include "EmulateFloat16Math.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
+#include "GLSLHostFallback.h"
+#include "HexagonDMA.h"
 #include "HexagonOffload.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -31,10 +43,12 @@
 #include "InjectHostDevBufferCopies.h"
 #include "InjectOpenGLIntrinsics.h"
 #include "Inline.h"
+#include "InvariantDivision.h"
 #include "LICM.h"
 #include "LoopCarry.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "NarrowArithmetic.h"
 #include "PartitionLoops.h"
 #include "PurifyIndexMath.h"
 #include "Prefetch.h"
@@ -46,6 +60,7 @@
 #include "RemoveUndef.h"
 #include "ScheduleFunctions.h"
 #include "SelectGPUAPI.h"
+#include "ShareAllocations.h"
 #include "Simplify.h"
 #include "SimplifySpecializations.h"
 #include "SkipStages.h"
@@ -53,8 +68,10 @@
 #include "SplitTuples.h"
 #include "StorageFlattening.h"
 #include "StorageFolding.h"
+#include "StorageLayout.h"
 #include "StrictifyFloat.h"
 #include "Substitute.h"
+#include "TensorCores.h"
 #include "Tracing.h"
 #include "TrimNoOps.h"
 #include "UnifyDuplicateLets.h"
@@ -76,9 +93,379 @@ using std::set;
 using std::string;
 using std::vector;
 
+namespace {
+
+// Logs the start of each lowering pass, and the wall-clock time it
+// took and the memory in use afterwards, at debug level 1. Also
+// records each pass in the compile trace, if it is enabled, and
+// enforces HL_COMPILER_MEMORY_LIMIT.
+class PassTimer {
+    typedef std::chrono::high_resolution_clock clock;
+    const Stmt &s;
+    clock::time_point lowering_start, pass_start;
+    std::unique_ptr<CompileTraceEvent> event;
+    string pass_name;
+    bool in_pass;
+
+    static double ms_since(clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(clock::now() - t).count();
+    }
+
+    void end_pass() {
+        if (in_pass) {
+            if (debug::debug_level() >= 1) {
+                CompilerMemoryUsage memory = compiler_memory_usage();
+                debug(1) << "    (" << ms_since(pass_start) << " ms, "
+                         << (memory.resident_bytes >> 20) << " MB resident, "
+                         << (memory.peak_bytes >> 20) << " MB peak)\n";
+            }
+            if (compile_trace_enabled()) {
+                event->set_ir_nodes(count_ir_nodes(s));
+            }
+            event.reset();
+            in_pass = false;
+            check_compiler_memory_limit("lowering pass \"" + pass_name + "\"");
+        }
+    }
+
+public:
+    PassTimer(const Stmt &s) : s(s), lowering_start(clock::now()), pass_start(lowering_start), in_pass(false) {}
+
+    void start(const string &msg) {
+        end_pass();
+        debug(1) << msg;
+        pass_start = clock::now();
+        event.reset(new CompileTraceEvent(msg, "lowering"));
+        pass_name = msg.substr(0, msg.find_first_of(".\n"));
+        in_pass = true;
+    }
+
+    void finish(const SimplifyCache &cache) {
+        end_pass();
+        debug(1) << "Lowering took " << ms_since(lowering_start) << " ms. "
+                 << "Simplifier cache hits: " << cache.num_hits()
+                 << " of " << cache.num_lookups() << " lookups\n";
+    }
+};
+
+// The target with the features that don't affect the first half of
+// lowering removed.
+Target lowering_prefix_target(const Target &t) {
+    // These features are only used by the code generators.
+    static const Target::Feature isa_features[] = {
+        Target::SSE41, Target::AVX, Target::AVX2, Target::FMA, Target::FMA4, Target::F16C,
+        Target::AVX512, Target::AVX512_KNL, Target::AVX512_Skylake, Target::AVX512_Cannonlake,
+        Target::AVX512_VNNI, Target::AVX512_256, Target::ARMv7s, Target::NoNEON, Target::ARMDotProd, Target::ARMFp16,
+        Target::ARMSVE, Target::VSX, Target::POWER_ARCH_2_07, Target::POWER_ARCH_3_00,
+    };
+    Target result = t;
+    for (Target::Feature f : isa_features) {
+        result = result.without_feature(f);
+    }
+    return result;
+}
+
+// The parameters and embedded buffers used by some IR.
+class FindLoweringInputs : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+        if (op->image.defined()) {
+            buffers[op->image.name()] = op->image;
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            params[op->param.name()] = op->param;
+        }
+        if (op->image.defined()) {
+            buffers[op->image.name()] = op->image;
+        }
+    }
+
+public:
+    map<string, Parameter> params;
+    map<string, Buffer<>> buffers;
+};
+
+uint64_t fnv1a_64(const char *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Describe everything the first half of lowering reads besides the
+// initial loop nest s, and hash it along with s into a key for a
+// LoweringPrefixCache. The initial loop nest holds the algorithm and
+// the loop structure the schedule asks for. The rest is the parts of
+// each Func's schedule the later passes look up in the environment,
+// the constraints on the parameters, the contents of the buffers, and
+// the target less its instruction set features. Two Pipelines built
+// separately from the same source get the same key.
+string lowering_prefix_key(const Stmt &s, const vector<Function> &outputs,
+                           const map<string, Function> &env,
+                           const string &pipeline_name, const Target &t) {
+    std::ostringstream d;
+    FindLoweringInputs inputs;
+    s.accept(&inputs);
+    auto describe = [&](const Expr &e) {
+        if (e.defined()) {
+            d << e;
+            e.accept(&inputs);
+        }
+        d << "\n";
+    };
+
+    d << "pipeline " << pipeline_name << "\n"
+      << "target " << lowering_prefix_target(t) << "\n";
+    for (const Function &f : outputs) {
+        d << "output " << f.name() << "\n";
+    }
+    for (const auto &iter : env) {
+        const Function &f = iter.second;
+        const FuncSchedule &sched = f.schedule();
+        d << "func " << f.name() << "\n";
+        for (const string &arg : f.args()) {
+            d << "arg " << arg << "\n";
+        }
+        for (const Type &type : f.output_types()) {
+            d << "type " << type << "\n";
+        }
+        d << "store " << sched.store_level() << "\n"
+          << "compute " << sched.compute_level() << "\n"
+          << "memoized " << sched.memoized() << " " << sched.memoize_budget() << "\n"
+          << "async " << sched.async() << "\n"
+          << "store_per_worker " << sched.store_per_worker() << "\n"
+          << "hexagon_dma " << sched.hexagon_dma() << "\n"
+          << "in_place_of " << sched.in_place_of() << "\n"
+          << "store_interleaved " << sched.store_interleaved() << "\n"
+          << "store_streaming " << sched.store_streaming() << "\n"
+          << "memory_type " << sched.memory_type() << "\n";
+        d << "ring_buffer ";
+        describe(sched.ring_buffer());
+        d << "slide_task_size ";
+        describe(sched.slide_task_size());
+        for (const StorageDim &dim : sched.storage_dims()) {
+            d << "storage " << dim.var << " " << dim.fold_forward << "\n";
+            describe(dim.alignment);
+            describe(dim.fold_factor);
+            describe(dim.padding);
+        }
+        for (const Bound &b : sched.bounds()) {
+            d << "bound " << b.var << "\n";
+            describe(b.min);
+            describe(b.extent);
+            describe(b.modulus);
+            describe(b.remainder);
+        }
+        for (const Bound &b : sched.estimates()) {
+            d << "estimate " << b.var << "\n";
+            describe(b.min);
+            describe(b.extent);
+        }
+        for (const ExternTile &tile : sched.extern_tiles()) {
+            d << "extern_tile " << tile.var << " " << tile.for_type << "\n";
+            describe(tile.size);
+        }
+        for (const auto &variant : sched.cpu_variants()) {
+            d << "cpu_variant";
+            for (Target::Feature feature : variant) {
+                d << " " << (int)feature;
+            }
+            d << "\n";
+        }
+        if (f.has_extern_definition()) {
+            d << "extern " << f.extern_function_name() << " "
+              << f.extern_function_device_api() << " "
+              << f.extern_definition_name_mangling() << " "
+              << f.extern_definition_uses_old_buffer_t() << "\n";
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    d << "func arg " << Function(arg.func).name() << "\n";
+                } else if (arg.is_expr()) {
+                    describe(arg.expr);
+                } else if (arg.is_buffer()) {
+                    d << "buffer arg " << arg.buffer.name() << "\n";
+                    inputs.buffers[arg.buffer.name()] = arg.buffer;
+                } else if (arg.is_image_param()) {
+                    d << "param arg " << arg.image_param.name() << "\n";
+                    inputs.params[arg.image_param.name()] = arg.image_param;
+                }
+            }
+        }
+        d << "debug_file " << f.debug_file() << "\n"
+          << "tracing " << f.is_tracing_loads() << f.is_tracing_stores()
+          << f.is_tracing_realizations() << "\n";
+        for (const string &tag : f.get_trace_tags()) {
+            d << "trace_tag " << tag << "\n";
+        }
+        for (const Parameter &p : f.output_buffers()) {
+            inputs.params[p.name()] = p;
+        }
+        const vector<Definition> &updates = f.updates();
+        for (size_t i = 0; i <= updates.size(); i++) {
+            const StageSchedule &stage = (i == 0 ? f.definition() : updates[i - 1]).schedule();
+            d << "stage " << i << " " << stage.allow_race_conditions() << " " << stage.atomic() << "\n";
+            for (const PrefetchDirective &p : stage.prefetches()) {
+                d << "prefetch " << p.name << " " << p.var << " "
+                  << (int)p.strategy << " " << (int)p.hint << "\n";
+                describe(p.offset);
+                if (p.param.defined()) {
+                    inputs.params[p.param.name()] = p.param;
+                }
+            }
+            for (const TensorCoreLoops &loops : stage.tensor_cores()) {
+                d << "tensor_core " << loops.x << " " << loops.y << " " << loops.k << "\n";
+            }
+        }
+    }
+
+    for (const auto &iter : inputs.params) {
+        const Parameter &p = iter.second;
+        d << "param " << p.name() << " " << p.type() << " " << p.dimensions() << "\n";
+        if (p.is_buffer()) {
+            d << "host_alignment " << p.host_alignment() << "\n";
+            for (int i = 0; i < p.dimensions(); i++) {
+                describe(p.min_constraint(i));
+                describe(p.extent_constraint(i));
+                describe(p.stride_constraint(i));
+                describe(p.min_constraint_estimate(i));
+                describe(p.extent_constraint_estimate(i));
+            }
+        } else {
+            describe(p.min_value());
+            describe(p.max_value());
+            describe(p.estimate());
+        }
+    }
+    uint64_t contents_hash = 0xcbf29ce484222325ULL;
+    for (const auto &iter : inputs.buffers) {
+        const Buffer<> &b = iter.second;
+        d << "buffer " << b.name() << " " << b.type();
+        for (int i = 0; i < b.dimensions(); i++) {
+            d << " " << b.dim(i).min() << " " << b.dim(i).extent() << " " << b.dim(i).stride();
+        }
+        d << "\n";
+        const halide_buffer_t *raw = b.raw_buffer();
+        if (raw->host) {
+            contents_hash = fnv1a_64((const char *)raw->begin(), raw->end() - raw->begin(), contents_hash);
+        }
+    }
+    d << "contents " << contents_hash << "\n"
+      << "stmt\n" << s;
+
+    string text = d.str();
+    std::ostringstream key;
+    key << std::hex << std::setfill('0')
+        << std::setw(16) << fnv1a_64(text.data(), text.size())
+        << std::setw(16) << fnv1a_64(text.data(), text.size(), 0x84222325cbf29ce4ULL)
+        << "-" << text.size();
+    return key.str();
+}
+
+// Abandons a reserved LoweringPrefixCache key unless the Stmt for it
+// was added, so that a failure to lower doesn't leave other threads
+// waiting for it.
+class PrefixReservation {
+    LoweringPrefixCache *cache;
+    string key;
+
+public:
+    PrefixReservation(LoweringPrefixCache *cache, const string &key) : cache(cache), key(key) {}
+
+    void fulfill(const Stmt &s) {
+        if (cache) {
+            cache->insert(key, s, snapshot_unique_name_counters());
+            cache = nullptr;
+        }
+    }
+
+    ~PrefixReservation() {
+        if (cache) {
+            cache->abandon(key);
+        }
+    }
+};
+
+// With the deterministic_reductions feature, a floating-point update
+// done with atomics in a loop over its reduction domain that runs in
+// parallel is an error. The order the threads reach the atomic
+// operations, and so how the result is rounded, changes from run to
+// run. Min and max don't round, so they are still allowed.
+void check_deterministic_reduction(const Function &f, const Definition &def, size_t stage) {
+    if (def.schedule().atomic() && def.values().size() == 1 && def.values()[0].type().is_float()) {
+        const AssociativeOp op = prove_associativity(f.name(), def.args(), def.values());
+        bool exact = op.associative() && (op.pattern.ops[0].as<Min>() || op.pattern.ops[0].as<Max>());
+        for (const Dim &d : def.schedule().dims()) {
+            user_assert(exact || !d.is_rvar() || !d.is_parallel())
+                << "Update " << stage << " of Func " << f.name()
+                << " is a floating-point reduction done with atomics in a parallel loop over "
+                << d.var << ", so its result depends on how the threads are scheduled. "
+                << "This isn't allowed with the deterministic_reductions target feature. "
+                << "Use Stage::deterministic_parallel() to parallelize it reproducibly.\n";
+        }
+    }
+    for (const Specialization &s : def.specializations()) {
+        check_deterministic_reduction(f, s.definition, stage);
+    }
+}
+
+}  // namespace
+
+bool LoweringPrefixCache::find_or_reserve(const string &key, Stmt &s, UniqueNameCounters &counters) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            entries[key];
+            return false;
+        }
+        if (it->second.ready) {
+            s = it->second.s;
+            counters = it->second.counters;
+            num_hits++;
+            return true;
+        }
+        cond.wait(lock);
+    }
+}
+
+void LoweringPrefixCache::insert(const string &key, const Stmt &s, const UniqueNameCounters &counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[key];
+    entry.ready = true;
+    entry.s = s;
+    entry.counters = counters;
+    cond.notify_all();
+}
+
+void LoweringPrefixCache::abandon(const string &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(key);
+    cond.notify_all();
+}
+
+int LoweringPrefixCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_hits;
+}
+
 Module lower(const vector<Function> &output_funcs, const string &pipeline_name, const Target &t,
              const vector<Argument> &args, const LinkageType linkage_type,
-             const vector<IRMutator2 *> &custom_passes) {
+             const vector<IRMutator2 *> &custom_passes,
+             LoweringPrefixCache *prefix_cache) {
+    // Many passes simplify the same unchanged subexpressions, so
+    // share the results between them.
+    SimplifyCache simplify_cache;
+    Stmt s;
+    PassTimer timer(s);
+
     std::vector<std::string> namespaces;
     std::string simple_pipeline_name = extract_namespaces(pipeline_name, namespaces);
 
@@ -94,6 +481,10 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     vector<Function> outputs;
     std::tie(outputs, env) = deep_copy(output_funcs, env);
 
+    // Before strictify_float wraps everything, so that the
+    // approximations are strict too if they need to be.
+    approximate_math(env);
+
     bool any_strict_float = strictify_float(env, t);
     result_module.set_any_strict_float(any_strict_float);
 
@@ -102,6 +493,9 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
         Func(f).compute_root().store_root();
     }
 
+    // Run GLSL stages on the CPU if the target doesn't have OpenGL.
+    glsl_host_fallback(env, t);
+
     // Finalize all the LoopLevels
     for (auto &iter : env) {
         iter.second.lock_loop_levels();
@@ -110,247 +504,363 @@ Module lower(const vector<Function> &output_funcs, const string &pipeline_name,
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
+    // Transpose the storage of Funcs walked along an outer dimension
+    // by vectorized consumers
+    choose_storage_layouts(env, outputs);
+
     // Compute a realization order and determine group of functions which loops
     // are to be fused together
     vector<string> order;
     vector<vector<string>> fused_groups;
-    std::tie(order, fused_groups) = realization_order(outputs, env);
+    std::tie(order, fused_groups) = realization_order(outputs, env, t.has_feature(Target::MinimizeMemory));
 
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
 
-    debug(1) << "Creating initial loop nests...\n";
+    if (t.has_feature(Target::DeterministicReductions)) {
+        for (const auto &iter : env) {
+            const vector<Definition> &updates = iter.second.updates();
+            for (size_t i = 0; i < updates.size(); i++) {
+                check_deterministic_reduction(iter.second, updates[i], i);
+            }
+        }
+    }
+
+    timer.start("Creating initial loop nests...\n");
     bool any_memoized = false;
-    Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
+    s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
-    debug(1) << "Canonicalizing GPU var names...\n";
-    s = canonicalize_gpu_vars(s);
-    debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
-
-    if (any_memoized) {
-        debug(1) << "Injecting memoization...\n";
-        s = inject_memoization(s, env, pipeline_name, outputs);
-        debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
-    } else {
-        debug(1) << "Skipping injecting memoization...\n";
-    }
-
-    debug(1) << "Injecting tracing...\n";
-    s = inject_tracing(s, pipeline_name, env, outputs, t);
-    debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
-
-    debug(1) << "Adding checks for parameters\n";
-    s = add_parameter_checks(s, t);
-    debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
-
-    // Compute the maximum and minimum possible value of each
-    // function. Used in later bounds inference passes.
-    debug(1) << "Computing bounds of each function's value\n";
-    FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
-
-    // The checks will be in terms of the symbols defined by bounds
-    // inference.
-    debug(1) << "Adding checks for images\n";
-    s = add_image_checks(s, outputs, t, order, env, func_bounds);
-    debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
-
-    // This pass injects nested definitions of variable names, so we
-    // can't simplify statements from here until we fix them up. (We
-    // can still simplify Exprs).
-    debug(1) << "Performing computation bounds inference...\n";
-    s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
-    debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
-
-    debug(1) << "Performing sliding window optimization...\n";
-    s = sliding_window(s, env);
-    debug(2) << "Lowering after sliding window:\n" << s << '\n';
-
-    debug(1) << "Performing allocation bounds inference...\n";
-    s = allocation_bounds_inference(s, env, func_bounds);
-    debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
-
-    debug(1) << "Removing code that depends on undef values...\n";
-    s = remove_undef(s);
-    debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
-
-    // This uniquifies the variable names, so we're good to simplify
-    // after this point. This lets later passes assume syntactic
-    // equivalence means semantic equivalence.
-    debug(1) << "Uniquifying variable names...\n";
-    s = uniquify_variable_names(s);
-    debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
-
-    debug(1) << "Simplifying...\n";
-    s = simplify(s, false); // Storage folding needs .loop_max symbols
-    debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
-
-    debug(1) << "Performing storage folding optimization...\n";
-    s = storage_folding(s, env);
-    debug(2) << "Lowering after storage folding:\n" << s << '\n';
-
-    debug(1) << "Injecting debug_to_file calls...\n";
-    s = debug_to_file(s, outputs, env);
-    debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
-
-    debug(1) << "Injecting prefetches...\n";
-    s = inject_prefetch(s, env);
-    debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
-
-    debug(1) << "Dynamically skipping stages...\n";
-    s = skip_stages(s, order);
-    debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
-
-    debug(1) << "Destructuring tuple-valued realizations...\n";
-    s = split_tuples(s, env);
-    debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
-
-    debug(1) << "Performing storage flattening...\n";
-    s = storage_flattening(s, outputs, env, t);
-    debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
-
-    debug(1) << "Unpacking buffer arguments...\n";
-    s = unpack_buffers(s);
-    debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
-
-    if (any_memoized) {
-        debug(1) << "Rewriting memoized allocations...\n";
-        s = rewrite_memoized_allocations(s, env);
-        debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
+    // The rest of the first half of lowering doesn't depend on the
+    // instruction set features of the target, so it may have been done
+    // already for another target, or for an identical pipeline built
+    // separately.
+    string prefix_key;
+    Stmt cached_prefix;
+    UniqueNameCounters cached_counters;
+    bool reuse_prefix = false;
+    if (prefix_cache) {
+        prefix_key = lowering_prefix_key(s, outputs, env, pipeline_name, t);
+        reuse_prefix = prefix_cache->find_or_reserve(prefix_key, cached_prefix, cached_counters);
+    }
+    PrefixReservation reservation(reuse_prefix ? nullptr : prefix_cache, prefix_key);
+    if (reuse_prefix) {
+        timer.start("Reusing lowering through storage flattening...\n");
+        s = cached_prefix;
+        // The names made by the passes skipped are in s, so names made
+        // from here on must not clash with them.
+        advance_unique_name_counters(cached_counters);
     } else {
-        debug(1) << "Skipping rewriting memoized allocations...\n";
+        if (t.has_feature(Target::CUDA)) {
+            timer.start("Wrapping tensor core loops in warps...\n");
+            s = wrap_tensor_core_loops(s, env, t);
+            debug(2) << "Lowering after wrapping tensor core loops in warps:\n" << s << '\n';
+        }
+
+        timer.start("Canonicalizing GPU var names...\n");
+        s = canonicalize_gpu_vars(s);
+        debug(2) << "Lowering after canonicalizing GPU var names:\n" << s << '\n';
+
+        if (any_memoized) {
+            timer.start("Injecting memoization...\n");
+            s = inject_memoization(s, env, pipeline_name, outputs);
+            debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
+        } else {
+            timer.start("Skipping injecting memoization...\n");
+        }
+
+        timer.start("Injecting tracing...\n");
+        s = inject_tracing(s, pipeline_name, env, outputs, t);
+        debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
+
+        timer.start("Adding checks for parameters\n");
+        s = add_parameter_checks(s, t);
+        debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
+
+        // Compute the maximum and minimum possible value of each
+        // function. Used in later bounds inference passes.
+        timer.start("Computing bounds of each function's value\n");
+        FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
+
+        // The checks will be in terms of the symbols defined by bounds
+        // inference.
+        timer.start("Adding checks for images\n");
+        s = add_image_checks(s, outputs, t, order, env, func_bounds);
+        debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
+
+        // This pass injects nested definitions of variable names, so we
+        // can't simplify statements from here until we fix them up. (We
+        // can still simplify Exprs).
+        timer.start("Performing computation bounds inference...\n");
+        s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
+        debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
+
+        timer.start("Performing sliding window optimization...\n");
+        s = sliding_window(s, env);
+        debug(2) << "Lowering after sliding window:\n" << s << '\n';
+
+        timer.start("Performing allocation bounds inference...\n");
+        s = allocation_bounds_inference(s, env, func_bounds);
+        debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
+
+        timer.start("Removing code that depends on undef values...\n");
+        s = remove_undef(s);
+        debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
+
+        // This uniquifies the variable names, so we're good to simplify
+        // after this point. This lets later passes assume syntactic
+        // equivalence means semantic equivalence.
+        timer.start("Uniquifying variable names...\n");
+        s = uniquify_variable_names(s);
+        debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
+
+        timer.start("Simplifying...\n");
+        s = simplify(s, false); // Storage folding needs .loop_max symbols
+        debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
+
+        timer.start("Performing storage folding optimization...\n");
+        s = storage_folding(s, env);
+        debug(2) << "Lowering after storage folding:\n" << s << '\n';
+
+        timer.start("Injecting debug_to_file calls...\n");
+        s = debug_to_file(s, outputs, env);
+        debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
+
+        timer.start("Injecting prefetches...\n");
+        s = inject_prefetch(s, env);
+        debug(2) << "Lowering after injecting prefetches:\n" << s << "\n\n";
+
+        timer.start("Dynamically skipping stages...\n");
+        s = skip_stages(s, order);
+        debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
+
+        timer.start("Forking asynchronous producers...\n");
+        s = fork_async_producers(s, env);
+        debug(2) << "Lowering after forking asynchronous producers:\n" << s << "\n\n";
+
+        if (t.has_feature(Target::ConcurrentStages)) {
+            timer.start("Forking independent stages...\n");
+            s = fork_independent_stages(s);
+            debug(2) << "Lowering after forking independent stages:\n" << s << "\n\n";
+        }
+
+        timer.start("Destructuring tuple-valued realizations...\n");
+        s = split_tuples(s, env);
+        debug(2) << "Lowering after destructuring tuple-valued realizations:\n" << s << "\n\n";
+
+        timer.start("Performing storage flattening...\n");
+        s = storage_flattening(s, outputs, env, t);
+        debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
+
+        timer.start("Unpacking buffer arguments...\n");
+        s = unpack_buffers(s);
+        debug(2) << "Lowering after unpacking buffer arguments...\n" << s << "\n\n";
+
+        if (any_memoized) {
+            timer.start("Rewriting memoized allocations...\n");
+            s = rewrite_memoized_allocations(s, env);
+            debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
+        } else {
+            timer.start("Skipping rewriting memoized allocations...\n");
+        }
+
+        reservation.fulfill(s);
     }
 
+    // Little of what was simplified before storage flattening is
+    // seen again after it, and the cache would keep the
+    // multi-dimensional IR alive for the rest of lowering.
+    simplify_cache.clear();
+
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute) ||
         t.has_feature(Target::OpenGL) ||
         (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128})))) {
-        debug(1) << "Selecting a GPU API for GPU loops...\n";
+        timer.start("Selecting a GPU API for GPU loops...\n");
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
 
-        debug(1) << "Injecting host <-> dev buffer copies...\n";
+        timer.start("Injecting host <-> dev buffer copies...\n");
         s = inject_host_dev_buffer_copies(s, t);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
 
-        debug(1) << "Selecting a GPU API for extern stages...\n";
+        timer.start("Selecting a GPU API for extern stages...\n");
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API for extern stages:\n" << s << "\n\n";
+
+        timer.start("Distributing loops across GPU devices...\n");
+        s = distribute_gpus(s, env);
+        debug(2) << "Lowering after distributing loops across GPU devices:\n" << s << "\n\n";
+    }
+
+    if (t.has_feature(Target::CUDA)) {
+        timer.start("Injecting tensor core instructions...\n");
+        s = inject_tensor_cores(s, env);
+        debug(2) << "Lowering after injecting tensor core instructions:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::OpenGL)) {
-        debug(1) << "Injecting OpenGL texture intrinsics...\n";
+        timer.start("Injecting OpenGL texture intrinsics...\n");
         s = inject_opengl_intrinsics(s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
     }
 
-    debug(1) << "Simplifying...\n";
+    if (t.has_feature(Target::HVX_v66)) {
+        timer.start("Injecting Hexagon user DMA copies...\n");
+        s = inject_hexagon_dma(s, env);
+        debug(2) << "Lowering after injecting Hexagon user DMA copies:\n" << s << "\n\n";
+    }
+
+    timer.start("Simplifying...\n");
     s = simplify(s);
     s = unify_duplicate_lets(s);
     s = remove_trivial_for_loops(s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
 
-    debug(1) << "Reduce prefetch dimension...\n";
+    timer.start("Reduce prefetch dimension...\n");
     s = reduce_prefetch_dimension(s, t);
     debug(2) << "Lowering after reduce prefetch dimension:\n" << s << "\n";
 
-    debug(1) << "Unrolling...\n";
+    timer.start("Unrolling...\n");
     s = unroll_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
 
-    debug(1) << "Vectorizing...\n";
+    timer.start("Narrowing arithmetic in vectorized loops...\n");
+    s = narrow_arithmetic(s);
+    debug(2) << "Lowering after narrowing arithmetic:\n" << s << "\n\n";
+
+    timer.start("Vectorizing...\n");
     s = vectorize_loops(s, t);
     s = simplify(s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
-        debug(1) << "Injecting per-block gpu synchronization...\n";
+        timer.start("Injecting per-block gpu synchronization...\n");
         s = fuse_gpu_thread_loops(s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
+
+        if (t.has_feature(Target::GPUPersistentThreads)) {
+            timer.start("Making gpu blocks persistent...\n");
+            s = make_gpu_blocks_persistent(s);
+            debug(2) << "Lowering after making gpu blocks persistent:\n" << s << "\n\n";
+        }
     }
 
-    debug(1) << "Detecting vector interleavings...\n";
+    timer.start("Detecting vector interleavings...\n");
     s = rewrite_interleavings(s);
     s = simplify(s);
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
 
-    debug(1) << "Partitioning loops to simplify boundary conditions...\n";
+    timer.start("Partitioning loops to simplify boundary conditions...\n");
     s = partition_loops(s);
     s = simplify(s);
     debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
 
-    debug(1) << "Trimming loops to the region over which they do something...\n";
+    timer.start("Trimming loops to the region over which they do something...\n");
     s = trim_no_ops(s);
     debug(2) << "Lowering after loop trimming:\n" << s << "\n\n";
 
-    debug(1) << "Injecting early frees...\n";
+    timer.start("Strength-reducing division by loop invariants...\n");
+    s = strength_reduce_invariant_division(s);
+    debug(2) << "Lowering after strength-reducing division by loop invariants:\n" << s << "\n\n";
+
+    timer.start("Injecting early frees...\n");
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
+    if (t.has_feature(Target::MinimizeMemory)) {
+        timer.start("Sharing allocations with disjoint lifetimes...\n");
+        s = share_allocations(s);
+        debug(2) << "Lowering after sharing allocations:\n" << s << "\n\n";
+        debug(1) << "Peak heap memory of " << pipeline_name << ": "
+                 << peak_heap_memory(s) << " bytes\n";
+    }
+
     if (t.has_feature(Target::Profile)) {
-        debug(1) << "Injecting profiling...\n";
+        timer.start("Injecting profiling...\n");
         s = inject_profiling(s, pipeline_name);
         debug(2) << "Lowering after injecting profiling:\n" << s << "\n\n";
     }
 
     if (t.has_feature(Target::FuzzFloatStores)) {
-        debug(1) << "Fuzzing floating point stores...\n";
+        timer.start("Fuzzing floating point stores...\n");
         s = fuzz_float_stores(s);
         debug(2) << "Lowering after fuzzing floating point stores:\n" << s << "\n\n";
     }
 
-    debug(1) << "Bounding small allocations...\n";
+    timer.start("Bounding small allocations...\n");
     s = bound_small_allocations(s);
     debug(2) << "Lowering after bounding small allocations:\n" << s << "\n\n";
 
-    if (t.has_feature(Target::CUDA)) {
-        debug(1) << "Injecting warp shuffles...\n";
+    timer.start("Hoisting per-worker storage out of parallel loops...\n");
+    s = hoist_worker_storage(s, env);
+    debug(2) << "Lowering after hoisting per-worker storage:\n" << s << "\n\n";
+
+    if (t.has_feature(Target::CUDA) || t.has_feature(Target::OpenCL) ||
+        t.has_feature(Target::Metal)) {
+        timer.start("Injecting warp shuffles...\n");
         s = lower_warp_shuffles(s);
         debug(2) << "Lowering after injecting warp shuffles:\n" << s << "\n\n";
     }
 
-    debug(1) << "Simplifying...\n";
-    s = common_subexpression_elimination(s);
+    timer.start("Simplifying...\n");
+    s = common_subexpression_elimination_across_stmts(s);
 
     if (t.has_feature(Target::OpenGL)) {
-        debug(1) << "Detecting varying attributes...\n";
+        timer.start("Detecting varying attributes...\n");
         s = find_linear_expressions(s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
 
-        debug(1) << "Moving varying attribute expressions out of the shader...\n";
+        timer.start("Moving varying attribute expressions out of the shader...\n");
         s = setup_gpu_vertex_buffer(s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
     }
 
-    debug(1) << "Lowering unsafe promises...\n";
+    if (t.has_gpu_feature()) {
+        timer.start("Carrying values across loop iterations in GPU kernels...\n");
+        s = loop_carry_in_gpu_kernels(s);
+        debug(2) << "Lowering after carrying values in GPU kernels:\n" << s << "\n\n";
+    }
+
+    timer.start("Lowering unsafe promises...\n");
     s = lower_unsafe_promises(s, t);
     debug(2) << "Lowering after lowering unsafe promises:\n" << s << "\n\n";
 
+    timer.start("Emulating float16 math...\n");
+    s = emulate_float16_math(s, t);
+    debug(2) << "Lowering after emulating float16 math:\n" << s << "\n\n";
+
+    timer.start("Performing final simplification...\n");
     s = remove_dead_allocations(s);
     s = remove_trivial_for_loops(s);
     s = simplify(s);
     s = loop_invariant_code_motion(s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
 
+    s = inject_cpu_variants(s, env, t);
+    debug(2) << "Lowering after injecting CPU variants:\n" << s << "\n\n";
+
     if (t.arch != Target::Hexagon && (t.features_any_of({Target::HVX_64, Target::HVX_128}))) {
-        debug(1) << "Splitting off Hexagon offload...\n";
+        timer.start("Splitting off Hexagon offload...\n");
         s = inject_hexagon_rpc(s, t, result_module);
         debug(2) << "Lowering after splitting off Hexagon offload:\n" << s << '\n';
     } else {
-        debug(1) << "Skipping Hexagon offload...\n";
+        timer.start("Skipping Hexagon offload...\n");
     }
 
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
-            debug(1) << "Running custom lowering pass " << i << "...\n";
+            timer.start("Running custom lowering pass " + std::to_string(i) + "...\n");
             s = custom_passes[i]->mutate(s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
         }
     }
 
+    timer.finish(simplify_cache);
+
     vector<Argument> public_args = args;
     for (const auto &out : outputs) {
         for (Parameter buf : out.output_buffers()) {
@@ -7,28 +7,74 @@
  * Halide function using its schedule.
  */
 
+#include <condition_variable>
 #include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
 
 #include "Argument.h"
 #include "IR.h"
 #include "Module.h"
 #include "Target.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
 
 class IRMutator2;
 
+/** The Stmts produced by the first half of lowering (through storage
+ * flattening), keyed on a description of everything that first half
+ * reads: the initial loop nest, the parts of the Funcs' schedules that
+ * the passes look up, the parameters and buffers used, and the target
+ * without its instruction set features. Because of that, it can be
+ * shared by Pipelines built separately from the same source, such as
+ * the per-target Generators of one multitarget GenGen invocation, and
+ * by targets that only differ in instruction set. It may be used from
+ * several threads at once. */
+class LoweringPrefixCache {
+public:
+    /** If the Stmt for a key is known, return true and set s and the
+     * unique name counters it was made with. If another thread is
+     * making it, wait for it to finish first. Otherwise return false,
+     * and the caller must then call insert or abandon for the key. */
+    bool find_or_reserve(const std::string &key, Stmt &s, UniqueNameCounters &counters);
+
+    /** Add the Stmt for a key previously reserved. */
+    void insert(const std::string &key, const Stmt &s, const UniqueNameCounters &counters);
+
+    /** Give up on a key previously reserved, e.g. because lowering
+     * failed. Anyone waiting for it makes it themselves. */
+    void abandon(const std::string &key);
+
+    /** The number of calls to find_or_reserve that found a Stmt. */
+    int hits() const;
+
+private:
+    struct Entry {
+        bool ready = false;
+        Stmt s;
+        UniqueNameCounters counters;
+    };
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::map<std::string, Entry> entries;
+    int num_hits = 0;
+};
+
 /** Given a vector of scheduled halide functions, create a Module that
  * evaluates it. Automatically pulls in all the functions f depends
  * on. Some stages of lowering may be target-specific. The Module may
  * contain submodules for computation offloaded to another execution
  * engine or API as well as buffers that are used in the passed in
  * Stmt. Multiple LoweredFuncs are added to support legacy buffer_t
- * calling convention. */
+ * calling convention. If a prefix cache is given, the first half of
+ * lowering is taken from it if possible, and added to it otherwise. */
 Module lower(const std::vector<Function> &output_funcs, const std::string &pipeline_name, const Target &t,
                     const std::vector<Argument> &args, const LinkageType linkage_type,
-                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>());
+                    const std::vector<IRMutator2 *> &custom_passes = std::vector<IRMutator2 *>(),
+                    LoweringPrefixCache *prefix_cache = nullptr);
 
 /** Given a halide function with a schedule, create a statement that
  * evaluates it. Automatically pulls in all the functions f depends
@@ -1,6 +1,7 @@
 #include "LowerWarpShuffles.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
+#include "IRVisitor.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -34,6 +35,21 @@
 // intrinsics. Finally, warp shuffles must be hoisted outside of
 // conditionals, because they return undefined values if either the
 // source or destination lanes are inactive.
+//
+// Associative reductions over a warp-level value that are computed by
+// a single lane (e.g. the final stage of an rfactor with the factored
+// dimension marked as gpu_lanes) would otherwise be a serial loop of
+// warp_size shuffles executed by lane zero. They are instead rewritten
+// as a butterfly tree of log2(warp_size) xor shuffles, after which
+// every lane holds the full result, and lane zero stores it.
+//
+// OpenCL kernels use sub-group shuffles instead, and Metal kernels
+// use SIMD-group shuffles. Several Halide warps may share one
+// sub-group, so the shuffle index is offset to the calling warp's
+// first lane within its sub-group. This requires the sub-group size
+// to be a multiple of the warp size, which holds for any gpu_lanes
+// loop of up to 32 lanes on Apple GPUs (32), AMD GPUs (64), and the
+// Intel devices that provide OpenCL sub-group shuffles (8, 16 or 32).
 
 namespace Halide {
 namespace Internal {
@@ -83,6 +99,47 @@ Expr reduce_expr(Expr e, Expr modulus, const Scope<Interval> &bounds) {
 }
 
 
+/** Check if an Expr loads from the given buffer. */
+class LoadsFromBuffer : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        if (op->name == buffer) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    string buffer;
+public:
+    bool result = false;
+    LoadsFromBuffer(const string &b) : buffer(b) {}
+};
+
+bool loads_from_buffer(Expr e, const string &buf) {
+    LoadsFromBuffer l(buf);
+    e.accept(&l);
+    return l.result;
+}
+
+// Rebuild an associative reduction operator of the given type.
+Expr make_reduction_op(IRNodeType op_type, Expr a, Expr b) {
+    switch (op_type) {
+    case IRNodeType::Add:
+        return Add::make(a, b);
+    case IRNodeType::Mul:
+        return Mul::make(a, b);
+    case IRNodeType::Min:
+        return Min::make(a, b);
+    case IRNodeType::Max:
+        return Max::make(a, b);
+    default:
+        internal_error << "Not an associative reduction operator\n";
+        return Expr();
+    }
+}
+
 // Substitute the gpu loop variables inwards to make future passes simpler
 class SubstituteInLaneVar : public IRMutator2 {
     using IRMutator2::visit;
@@ -341,12 +398,25 @@ public:
     }
 };
 
+// The name of the OpenCL sub-group shuffle, which CodeGen_OpenCL_Dev
+// defines to whichever of the Intel or Khronos extensions is
+// available.
+const string opencl_sub_group_shuffle = "halide_sub_group_shuffle";
+
+// The Metal SIMD-group shuffle, and the index of the calling thread
+// within its SIMD-group, which CodeGen_Metal_Dev defines to a
+// kernel argument.
+const string metal_simd_shuffle = "simd_shuffle";
+const string metal_simd_lane_id = "halide_simd_lane_id";
+
 // Move allocations outside the loop over lanes into the loop over
 // lanes (using the striping described above), and rewrites
-// stores/loads to them as cuda register shuffle intrinsics.
+// stores/loads to them as cuda register shuffle intrinsics, or
+// OpenCL sub-group or Metal SIMD-group shuffles.
 class LowerWarpShuffles : public IRMutator2 {
     using IRMutator2::visit;
 
+    DeviceAPI device_api;
     Expr warp_size, this_lane;
     string this_lane_name;
     bool may_use_warp_shuffle;
@@ -369,7 +439,7 @@ class LowerWarpShuffles : public IRMutator2 {
             if (op->for_type == ForType::GPULane) {
                 const int64_t *loop_size = as_const_int(op->extent);
                 user_assert(loop_size && *loop_size <= 32)
-                    << "CUDA gpu lanes loop must have constant extent of at most 32: " << op->extent << "\n";
+                    << "gpu lanes loop must have constant extent of at most 32: " << op->extent << "\n";
 
                 // Select a warp size - the smallest power of two that contains the loop size
                 int64_t ws = 1;
@@ -458,6 +528,12 @@ class LowerWarpShuffles : public IRMutator2 {
         // lane < limit_val when portions parts of the kernel to
         // certain threads, so we just need to match that pattern.
         const LT *lt = op->condition.as<LT>();
+        if (lt && equal(lt->a, this_lane) && is_one(lt->b) && !op->else_case.defined()) {
+            Stmt reduction = lower_lane_reduction(op->then_case);
+            if (reduction.defined()) {
+                return reduction;
+            }
+        }
         if (lt && equal(lt->a, this_lane) && is_const(lt->b)) {
             Expr condition = mutate(op->condition);
             internal_assert(bounds.contains(this_lane_name));
@@ -500,6 +576,154 @@ class LowerWarpShuffles : public IRMutator2 {
         }
     }
 
+    // Code run only by lane zero of the form:
+    //
+    // for (u, 0, warp_size) f[idx] = op(f[idx], g(u))
+    //
+    // where op is associative and commutative and idx does not depend
+    // on u, can instead evaluate g on every lane and combine the
+    // values with a butterfly tree of shuffles. Returns an undefined
+    // Stmt if the pattern doesn't match.
+    Stmt lower_lane_reduction(Stmt s) {
+        if (!may_use_warp_shuffle) {
+            return Stmt();
+        }
+
+        vector<pair<string, Expr>> lets;
+        while (const LetStmt *let = s.as<LetStmt>()) {
+            lets.push_back({let->name, let->value});
+            s = let->body;
+        }
+
+        const For *loop = s.as<For>();
+        if (!loop ||
+            !(loop->for_type == ForType::Serial || loop->for_type == ForType::Unrolled) ||
+            !is_zero(loop->min)) {
+            return Stmt();
+        }
+        const int64_t *extent = as_const_int(loop->extent);
+        const int64_t *ws = as_const_int(warp_size);
+        if (!extent || !ws || *extent != *ws || *ws == 1) {
+            return Stmt();
+        }
+
+        const Store *store = loop->body.as<Store>();
+        if (!store ||
+            store->value.type().is_vector() ||
+            store->value.type().bits() > 32 ||
+            !is_one(store->predicate) ||
+            expr_uses_var(store->index, loop->name)) {
+            return Stmt();
+        }
+
+        Expr a, b;
+        if (const Add *add = store->value.as<Add>()) {
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = store->value.as<Mul>()) {
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *min = store->value.as<Min>()) {
+            a = min->a;
+            b = min->b;
+        } else if (const Max *max = store->value.as<Max>()) {
+            a = max->a;
+            b = max->b;
+        } else {
+            return Stmt();
+        }
+        IRNodeType op_type = store->value.node_type();
+
+        auto is_self_load = [&](const Expr &e) {
+            const Load *load = e.as<Load>();
+            return load && load->name == store->name && equal(load->index, store->index);
+        };
+
+        Expr self, value;
+        if (is_self_load(a)) {
+            self = a;
+            value = b;
+        } else if (is_self_load(b)) {
+            self = b;
+            value = a;
+        } else {
+            return Stmt();
+        }
+        if (!expr_uses_var(value, loop->name) ||
+            loads_from_buffer(value, store->name)) {
+            return Stmt();
+        }
+
+        // Everything here was only run by lane zero, so the lane
+        // variable can be replaced with zero, freeing it up to
+        // distribute the loop iterations across the warp.
+        Expr zero = make_zero(Int(32));
+        value = substitute(this_lane_name, zero, value);
+        value = substitute(loop->name, this_lane, value);
+
+        vector<pair<string, Expr>> stages;
+        string name = unique_name('t');
+        stages.push_back({name, value});
+        Expr partial = Variable::make(value.type(), name);
+        for (int mask = (int)(*ws / 2); mask > 0; mask /= 2) {
+            Expr other = butterfly_shuffle(partial, mask);
+            name = unique_name('t');
+            stages.push_back({name, make_reduction_op(op_type, partial, other)});
+            partial = Variable::make(value.type(), name);
+        }
+
+        Expr result = (self.same_as(a) ?
+                       make_reduction_op(op_type, self, partial) :
+                       make_reduction_op(op_type, partial, self));
+        Stmt stmt = Store::make(store->name, result, store->index, store->param, store->predicate);
+        stmt = substitute(this_lane_name, zero, stmt);
+        stmt = IfThenElse::make(this_lane < 1, stmt, Stmt());
+        while (!stages.empty()) {
+            stmt = LetStmt::make(stages.back().first, stages.back().second, stmt);
+            stages.pop_back();
+        }
+        while (!lets.empty()) {
+            stmt = LetStmt::make(lets.back().first, substitute(this_lane_name, zero, lets.back().second), stmt);
+            lets.pop_back();
+        }
+
+        debug(3) << "Lowered reduction over " << loop->name << " to butterfly shuffles:\n" << stmt << "\n";
+        return mutate(stmt);
+    }
+
+    // Get the value of an expression from the lane whose index
+    // differs from ours by the given xor mask.
+    Expr butterfly_shuffle(Expr value, int mask) {
+        Type type = value.type();
+        Type shuffle_type = type;
+        if (type.bits() < 32) {
+            shuffle_type = UInt(32);
+            value = cast(shuffle_type, reinterpret(type.with_code(Type::UInt), value));
+        }
+
+        Expr shuffled;
+        if (device_api == DeviceAPI::OpenCL || device_api == DeviceAPI::Metal) {
+            bool is_opencl = device_api == DeviceAPI::OpenCL;
+            Expr sub_group_lane = Call::make(UInt(32), is_opencl ? "get_sub_group_local_id" : metal_simd_lane_id,
+                                             {}, Call::PureExtern);
+            Expr warp_base = sub_group_lane & make_const(UInt(32), ~(*as_const_int(warp_size) - 1));
+            Expr src_lane = warp_base | (cast(UInt(32), this_lane) ^ make_const(UInt(32), mask));
+            shuffled = Call::make(shuffle_type, is_opencl ? opencl_sub_group_shuffle : metal_simd_shuffle,
+                                  {value, src_lane}, Call::PureExtern);
+        } else {
+            string intrin_suffix = shuffle_type.is_float() ? ".f32" : ".i32";
+            // Same mask format as the idx variant below.
+            Expr clamp = simplify(((31 & ~(warp_size - 1)) << 8) | 31);
+            shuffled = Call::make(shuffle_type, "llvm.nvvm.shfl.bfly" + intrin_suffix,
+                                  {value, mask, clamp}, Call::PureExtern);
+        }
+
+        if (shuffled.type() != type) {
+            shuffled = reinterpret(type, cast(type.with_code(Type::UInt), shuffled));
+        }
+        return shuffled;
+    }
+
     Expr make_warp_load(Type type, string name, Expr idx, Expr lane) {
         // idx: The index of the value within the local allocation
         // lane: Which thread's value we want. If it's our own, we can just use a load.
@@ -548,6 +772,22 @@ class LowerWarpShuffles : public IRMutator2 {
 
         internal_assert(may_use_warp_shuffle) << name << ", " << idx << ", " << lane << "\n";
 
+        if (device_api == DeviceAPI::OpenCL || device_api == DeviceAPI::Metal) {
+            // Sub-group shuffles do a general gather, so there's no
+            // need to pattern match the cases below.
+            bool is_opencl = device_api == DeviceAPI::OpenCL;
+            Expr sub_group_lane = Call::make(UInt(32), is_opencl ? "get_sub_group_local_id" : metal_simd_lane_id,
+                                             {}, Call::PureExtern);
+            Expr warp_base = sub_group_lane & make_const(UInt(32), ~(*as_const_int(warp_size) - 1));
+            Expr src_lane = warp_base | cast(UInt(32), scalar_lane);
+            Expr shuffled = Call::make(shuffle_type, is_opencl ? opencl_sub_group_shuffle : metal_simd_shuffle,
+                                       {base_val, src_lane}, Call::PureExtern);
+            if (shuffled.type() != type) {
+                shuffled = reinterpret(type, cast(type.with_code(Type::UInt), shuffled));
+            }
+            return shuffled;
+        }
+
         string intrin_suffix;
         if (shuffle_type.is_float()) {
             intrin_suffix = ".f32";
@@ -598,8 +838,9 @@ class LowerWarpShuffles : public IRMutator2 {
             shuffled = Call::make(shuffle_type, "llvm.nvvm.shfl.idx" + intrin_suffix,
                                 {base_val, lane, mask}, Call::PureExtern);
         }
-        // TODO: There are other forms, like butterfly and clamp, that
-        // don't need to use the general gather
+        // TODO: There are other forms, like clamp, that don't need to
+        // use the general gather. Butterflies are only generated
+        // directly, by lower_lane_reduction.
 
         if (shuffled.type() != type) {
             user_assert(shuffled.type().bits() > type.bits());
@@ -637,7 +878,7 @@ class LowerWarpShuffles : public IRMutator2 {
     }
 
 public:
-    LowerWarpShuffles() {}
+    LowerWarpShuffles(DeviceAPI device_api) : device_api(device_api) {}
 };
 
 class HoistWarpShufflesFromSingleIfStmt : public IRMutator2 {
@@ -649,7 +890,9 @@ class HoistWarpShufflesFromSingleIfStmt : public IRMutator2 {
     Expr visit(const Call *op) override {
         // If it was written outside this if clause but read inside of
         // it, we need to hoist it.
-        if (starts_with(op->name, "llvm.nvvm.shfl.") &&
+        if ((starts_with(op->name, "llvm.nvvm.shfl.") ||
+             op->name == opencl_sub_group_shuffle ||
+             op->name == metal_simd_shuffle) &&
             !expr_uses_vars(op, stored_to)) {
             string name = unique_name('t');
             lifted_lets.push_back({name, op});
@@ -789,9 +1032,11 @@ class LowerWarpShufflesInEachKernel : public IRMutator2 {
     using IRMutator2::visit;
 
     Stmt visit(const For *op) override {
-        if (op->device_api == DeviceAPI::CUDA && has_lane_loop(op)) {
+        if ((op->device_api == DeviceAPI::CUDA ||
+             op->device_api == DeviceAPI::OpenCL ||
+             op->device_api == DeviceAPI::Metal) && has_lane_loop(op)) {
             Stmt s = op;
-            s = LowerWarpShuffles().mutate(s);
+            s = LowerWarpShuffles(op->device_api).mutate(s);
             s = HoistWarpShuffles().mutate(s);
             return simplify(s);
         } else {
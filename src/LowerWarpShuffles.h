@@ -2,8 +2,9 @@
 #define HALIDE_LOWER_WARP_SHUFFLES_H
 
 /** \file
- * Defines the lowering pass that injects CUDA warp shuffle
- * instructions to access storage outside of a GPULane loop.
+ * Defines the lowering pass that injects CUDA warp shuffle, OpenCL
+ * sub-group shuffle, and Metal SIMD-group shuffle instructions to
+ * access storage outside of a GPULane loop.
  */
 
 #include "IR.h"
@@ -12,7 +13,8 @@ namespace Halide {
 namespace Internal {
 
 /** Rewrite access to things stored outside the loop over GPU lanes to
- * use nvidia's warp shuffle instructions. */
+ * use nvidia's warp shuffle instructions, or OpenCL sub-group or
+ * Metal SIMD-group shuffles. */
 Stmt lower_warp_shuffles(Stmt s);
 
 }  // namespace Internal
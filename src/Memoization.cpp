@@ -206,6 +206,13 @@ public:
     // for the target function. Make sure it takes 4 bytes in cache key.
     Expr key_size() { return cast<int32_t>(key_size_expr); };
 
+    // A string identifying the filter and function. Its address is
+    // also used to identify the function's budget in the cache.
+    Expr function_id() {
+        return StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
+                               std::to_string(function_name.size()) + ":" + function_name);
+    }
+
     // Code to fill in the Allocation named key_name with the byte of
     // the key. The Allocation is guaranteed to be 1d, of type uint8_t
     // and of the size returned from key_size
@@ -217,9 +224,7 @@ public:
         // function. Assume this will be unique due to CSE. This can
         // break with loading and unloading of code, though the name
         // mechanism can also break in those conditions.
-        writes.push_back(Store::make(key_name,
-                                     StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
-                                                     std::to_string(function_name.size()) + ":" + function_name),
+        writes.push_back(Store::make(key_name, function_id(),
                                      (index / Handle().bytes()), Parameter(), const_true()));
         size_t alignment = Handle().bytes();
         index += Handle().bytes();
@@ -278,9 +283,12 @@ public:
         return Call::make(Int(32), "halide_memoization_cache_lookup", args, Call::Extern);
     }
 
-    // Returns a statement which will store the result of a computation under this key
+    // Returns a statement which will store the result of a
+    // computation under this key, along with the time since
+    // start_time_name was set, and the budget of the function.
     Stmt store_computation(std::string key_allocation_name, std::string computed_bounds_name,
-                           int32_t tuple_count, std::string storage_base_name) {
+                           int32_t tuple_count, std::string storage_base_name,
+                           std::string start_time_name, int64_t budget) {
         std::vector<Expr> args;
         args.push_back(Variable::make(type_of<uint8_t *>(), key_allocation_name));
         args.push_back(key_size());
@@ -295,9 +303,13 @@ public:
             }
         }
         args.push_back(Call::make(type_of<halide_buffer_t **>(), Call::make_struct, buffers, Call::Intrinsic));
+        args.push_back(function_id());
+        args.push_back(make_const(Int(64), budget));
+        Expr now = Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern);
+        args.push_back(now - Variable::make(Int(64), start_time_name));
 
         // This is actually a void call. How to indicate that? Look at Extern_ stuff.
-        return Evaluate::make(Call::make(Int(32), "halide_memoization_cache_store", args, Call::Extern));
+        return Evaluate::make(Call::make(Int(32), "halide_memoization_cache_store_with_budget", args, Call::Extern));
     }
 };
 
@@ -353,10 +365,16 @@ private:
             std::string cache_result_name = op->name + ".cache_result";
             std::string cache_miss_name = op->name + ".cache_miss";
             std::string computed_bounds_name = op->name + ".computed_bounds.buffer";
+            std::string start_time_name = op->name + ".cache_start_time";
 
+            // Time the computation on a miss, so that the cache can
+            // prefer to keep results that are expensive to recompute.
+            Stmt timed_body = LetStmt::make(start_time_name,
+                                            Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern),
+                                            mutated_body);
             Stmt cache_miss_marker = LetStmt::make(cache_miss_name,
                                                    Cast::make(Bool(), Variable::make(Int(32), cache_result_name)),
-                                                   mutated_body);
+                                                   timed_body);
             Stmt cache_lookup_check = Block::make(AssertStmt::make(NE::make(Variable::make(Int(32), cache_result_name), -1),
                                                                    Call::make(Int(32), "halide_error_out_of_memory", { }, Call::Extern)),
                                                   cache_miss_marker);
@@ -413,9 +431,12 @@ private:
 
                 std::string cache_key_name = op->name + ".cache_key";
                 std::string computed_bounds_name = op->name + ".computed_bounds.buffer";
+                std::string start_time_name = op->name + ".cache_start_time";
 
                 Stmt cache_store_back =
-                    IfThenElse::make(cache_miss, key_info.store_computation(cache_key_name, computed_bounds_name, f.outputs(), op->name));
+                    IfThenElse::make(cache_miss, key_info.store_computation(cache_key_name, computed_bounds_name,
+                                                                            f.outputs(), op->name, start_time_name,
+                                                                            f.schedule().memoize_budget()));
 
                 Stmt mutated_body = Block::make(cache_store_back, body);
                 return ProducerConsumer::make(op->name, op->is_producer, mutated_body);
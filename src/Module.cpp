@@ -1,11 +1,16 @@
 #include "Module.h"
 
 #include <array>
+#include <atomic>
 #include <fstream>
+#include <functional>
+#include <set>
 #include <future>
+#include <thread>
 
 #include "CodeGen_C.h"
 #include "CodeGen_Internal.h"
+#include "CodeGen_LLVM.h"
 #include "Debug.h"
 #include "HexagonOffload.h"
 #include "IROperator.h"
@@ -14,6 +19,7 @@
 #include "LLVM_Runtime_Linker.h"
 #include "Outputs.h"
 #include "PythonExtensionGen.h"
+#include "SerializedPipeline.h"
 #include "StmtToHtml.h"
 #include "WrapExternStages.h"
 
@@ -105,9 +111,72 @@ Outputs add_suffixes(const Outputs &in, const std::string &suffix) {
     if (!in.stmt_name.empty()) out.stmt_name = add_suffix(in.stmt_name, suffix);
     if (!in.stmt_html_name.empty()) out.stmt_html_name = add_suffix(in.stmt_html_name, suffix);
     if (!in.schedule_name.empty()) out.schedule_name = add_suffix(in.schedule_name, suffix);
+    if (!in.serialized_pipeline_name.empty()) out.serialized_pipeline_name = add_suffix(in.serialized_pipeline_name, suffix);
     return out;
 }
 
+// Run a set of independent compilation jobs, using up to one thread
+// per core. Each Module::compile makes its own LLVMContext, so the
+// jobs share no LLVM state. If any job throws, the first exception
+// is rethrown here once all of them have stopped.
+void compile_in_parallel(const std::vector<std::function<void()>> &jobs) {
+    size_t num_threads = std::min((size_t)std::max(1u, std::thread::hardware_concurrency()), jobs.size());
+    if (num_threads <= 1) {
+        for (const auto &job : jobs) {
+            job();
+        }
+        return;
+    }
+
+    // Make sure the one-time LLVM setup happens before any of the
+    // threads start.
+    CodeGen_LLVM::initialize_llvm();
+
+    std::atomic<size_t> next_job(0);
+    std::vector<std::future<void>> workers;
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.push_back(std::async(std::launch::async, [&]() {
+            for (size_t j = next_job++; j < jobs.size(); j = next_job++) {
+                jobs[j]();
+            }
+        }));
+    }
+    for (auto &w : workers) {
+        w.wait();
+    }
+    for (auto &w : workers) {
+        w.get();
+    }
+}
+
+// Write the object and static library outputs for an llvm module.
+void compile_llvm_module_to_object_outputs(llvm::Module &llvm_module, const Outputs &output_files,
+                                           const Target &target) {
+    if (!output_files.object_name.empty()) {
+        debug(1) << "Module.compile(): object_name " << output_files.object_name << "\n";
+        auto out = make_raw_fd_ostream(output_files.object_name);
+        compile_llvm_module_to_object(llvm_module, *out);
+    }
+    if (!output_files.static_library_name.empty()) {
+        // To simplify the code, we always create a temporary object output
+        // here, even if output_files.object_name was also set: in practice,
+        // no real-world code ever sets both object_name and static_library_name
+        // at the same time, so there is no meaningful performance advantage
+        // to be had.
+        TemporaryObjectFileDir temp_dir;
+        {
+            std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, "", target);
+            debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
+            auto out = make_raw_fd_ostream(object_name);
+            compile_llvm_module_to_object(llvm_module, *out);
+            out->flush();  // create_static_library() is happier if we do this
+        }
+        debug(1) << "Module.compile(): static_library_name " << output_files.static_library_name << "\n";
+        Target base_target(target.os, target.arch, target.bits);
+        create_static_library(temp_dir.files(), base_target, output_files.static_library_name);
+    }
+}
+
 }  // namespace
 
 struct ModuleContents {
@@ -350,7 +419,12 @@ void Module::compile(const Outputs &output_files_arg) const {
     }
     if (!output_files.stmt_html_name.empty()) {
         debug(1) << "Module.compile(): stmt_html_name " << output_files.stmt_html_name << "\n";
-        Internal::print_to_html(output_files.stmt_html_name, *this);
+        std::string profile = Internal::get_env_variable("HL_HTML_PROFILE");
+        if (profile.empty()) {
+            Internal::print_to_html(output_files.stmt_html_name, *this);
+        } else {
+            Internal::print_to_html(output_files.stmt_html_name, *this, profile);
+        }
         output_files.stmt_html_name.clear();
     }
 
@@ -365,33 +439,11 @@ void Module::compile(const Outputs &output_files_arg) const {
 
     if (!output_files.object_name.empty() || !output_files.assembly_name.empty() ||
         !output_files.bitcode_name.empty() || !output_files.llvm_assembly_name.empty() ||
-        !output_files.static_library_name.empty()) {
+        !output_files.static_library_name.empty() || !output_files.serialized_pipeline_name.empty()) {
         llvm::LLVMContext context;
         std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
 
-        if (!output_files.object_name.empty()) {
-            debug(1) << "Module.compile(): object_name " << output_files.object_name << "\n";
-            auto out = make_raw_fd_ostream(output_files.object_name);
-            compile_llvm_module_to_object(*llvm_module, *out);
-        }
-        if (!output_files.static_library_name.empty()) {
-            // To simplify the code, we always create a temporary object output
-            // here, even if output_files.object_name was also set: in practice,
-            // no real-world code ever sets both object_name and static_library_name
-            // at the same time, so there is no meaningful performance advantage
-            // to be had.
-            TemporaryObjectFileDir temp_dir;
-            {
-                std::string object_name = temp_dir.add_temp_object_file(output_files.static_library_name, "", target());
-                debug(1) << "Module.compile(): temporary object_name " << object_name << "\n";
-                auto out = make_raw_fd_ostream(object_name);
-                compile_llvm_module_to_object(*llvm_module, *out);
-                out->flush();  // create_static_library() is happier if we do this
-            }
-            debug(1) << "Module.compile(): static_library_name " << output_files.static_library_name << "\n";
-            Target base_target(target().os, target().arch, target().bits);
-            create_static_library(temp_dir.files(), base_target, output_files.static_library_name);
-        }
+        Internal::compile_llvm_module_to_object_outputs(*llvm_module, output_files, target());
         if (!output_files.assembly_name.empty()) {
             debug(1) << "Module.compile(): assembly_name " << output_files.assembly_name << "\n";
             auto out = make_raw_fd_ostream(output_files.assembly_name);
@@ -407,6 +459,10 @@ void Module::compile(const Outputs &output_files_arg) const {
             auto out = make_raw_fd_ostream(output_files.llvm_assembly_name);
             compile_llvm_module_to_llvm_assembly(*llvm_module, *out);
         }
+        if (!output_files.serialized_pipeline_name.empty()) {
+            debug(1) << "Module.compile(): serialized_pipeline_name " << output_files.serialized_pipeline_name << "\n";
+            Internal::compile_llvm_module_to_serialized_pipeline(*this, *llvm_module, output_files.serialized_pipeline_name);
+        }
     }
     if (!output_files.c_header_name.empty()) {
         debug(1) << "Module.compile(): c_header_name " << output_files.c_header_name << "\n";
@@ -460,10 +516,140 @@ Outputs compile_standalone_runtime(const Outputs &output_files, Target t) {
     return actual_outputs;
 }
 
+Outputs compile_minimal_runtime(const Outputs &output_files, Target t,
+                                const std::vector<Module> &modules,
+                                const std::vector<std::string> &extra_entry_points,
+                                RuntimeFootprint *footprint) {
+    // Find the runtime symbols the modules refer to.
+    std::set<std::string> entry_points(extra_entry_points.begin(), extra_entry_points.end());
+    for (const Module &m : modules) {
+        user_assert(m.target().has_feature(Target::NoRuntime))
+            << "compile_minimal_runtime requires modules compiled with Target::NoRuntime, "
+            << "but module " << m.name() << " has target " << m.target().to_string() << "\n";
+        llvm::LLVMContext context;
+        std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m.resolve_submodules(), context));
+        for (const llvm::Function &f : *llvm_module) {
+            if (f.isDeclaration() && !f.isIntrinsic()) {
+                entry_points.insert(f.getName().str());
+            }
+        }
+        for (const llvm::GlobalVariable &v : llvm_module->globals()) {
+            if (v.isDeclaration()) {
+                entry_points.insert(v.getName().str());
+            }
+        }
+    }
+
+    Module empty("standalone_runtime", t.without_feature(Target::NoRuntime).without_feature(Target::JIT));
+    llvm::LLVMContext context;
+    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(empty, context));
+
+    auto count = [&](int *functions, int *instructions) {
+        *functions = *instructions = 0;
+        for (const llvm::Function &f : *llvm_module) {
+            if (!f.isDeclaration()) {
+                (*functions)++;
+                *instructions += (int)f.getInstructionCount();
+            }
+        }
+    };
+    RuntimeFootprint result;
+    count(&result.full_functions, &result.full_instructions);
+    Internal::strip_runtime(*llvm_module, entry_points);
+    count(&result.functions, &result.instructions);
+    for (const std::string &e : entry_points) {
+        const llvm::GlobalValue *g = llvm_module->getNamedValue(e);
+        if (g && !g->isDeclaration()) {
+            result.entry_points.push_back(e);
+        }
+    }
+    debug(1) << "compile_minimal_runtime: kept " << result.functions << " of "
+             << result.full_functions << " functions and " << result.instructions << " of "
+             << result.full_instructions << " instructions\n";
+    if (footprint) {
+        *footprint = result;
+    }
+
+    Outputs actual_outputs = Outputs().object(output_files.object_name).static_library(output_files.static_library_name);
+    Internal::compile_llvm_module_to_object_outputs(*llvm_module, actual_outputs, empty.target());
+    return actual_outputs;
+}
+
 void compile_standalone_runtime(const std::string &object_filename, Target t) {
     compile_standalone_runtime(Outputs().object(object_filename), t);
 }
 
+namespace Internal {
+
+Target get_multitarget_runtime_target(const std::vector<Target> &targets) {
+    internal_assert(!targets.empty());
+    const Target &base_target = targets.back();
+
+    // For safety, the runtime must be built only with features common to all
+    // of the targets; given an unusual ordering like
+    //
+    //     x86-64-linux,x86-64-sse41
+    //
+    // we should still always be *correct*: this ordering would never select sse41
+    // (since x86-64-linux would be selected first due to ordering), but could
+    // crash on non-sse41 machines (if we generated a runtime with sse41 instructions
+    // included). So we'll keep track of the common features as we walk thru the targets.
+
+    // Using something like std::bitset would be arguably cleaner here, but we need an
+    // array-of-uint64 for calls to halide_can_use_target_features() anyway,
+    // so we'll just build and maintain in that form to avoid extra conversion.
+    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+    uint64_t runtime_features[kFeaturesWordCount];
+    for (int i = 0; i < kFeaturesWordCount; ++i) {
+        runtime_features[i] = (uint64_t)-1LL;
+    }
+
+    for (const Target &target : targets) {
+        for (int i = 0; i < Target::FeatureEnd; ++i) {
+            if (!target.has_feature((Target::Feature) i)) {
+                runtime_features[i >> 6] &= ~(((uint64_t) 1) << (i & 63));
+            }
+        }
+    }
+
+    // Start with a bare Target, set only the features we know are common to all.
+    Target runtime_target(base_target.os, base_target.arch, base_target.bits);
+    for (int i = 0; i < Target::FeatureEnd; ++i) {
+        // We never want NoRuntime set here.
+        if (i == Target::NoRuntime) {
+            continue;
+        }
+        const int word = i >> 6;
+        const int bit = i & 63;
+        if (runtime_features[word] & (((uint64_t) 1) << bit)) {
+            runtime_target.set_feature((Target::Feature) i);
+        }
+    }
+    // The device API runtime modules don't depend on the
+    // instruction set, so include those needed by any of the
+    // targets, e.g. host-opengl,host needs the OpenGL runtime for
+    // its first variant.
+    static const std::array<Target::Feature, 7> device_api_features = {{
+        Target::CUDA,
+        Target::D3D12Compute,
+        Target::Metal,
+        Target::OpenCL,
+        Target::OpenGL,
+        Target::OpenGLCompute,
+        Target::Vulkan,
+    }};
+    for (const Target &target : targets) {
+        for (auto f : device_api_features) {
+            if (target.has_feature(f)) {
+                runtime_target.set_feature(f);
+            }
+        }
+    }
+    return runtime_target;
+}
+
+}  // namespace Internal
+
 void compile_multitarget(const std::string &fn_name,
                          const Outputs &output_files,
                          const std::vector<Target> &targets,
@@ -486,6 +672,11 @@ void compile_multitarget(const std::string &fn_name,
     // JIT makes no sense.
     user_assert(!base_target.has_feature(Target::JIT)) << "JIT not allowed for compile_multitarget.\n";
 
+    // The wrapper doesn't dispatch batched or unchecked entry points.
+    user_assert(targets.size() == 1 ||
+                !base_target.features_any_of({Target::Batch, Target::UncheckedEntry}))
+        << "The batch and unchecked_entry target features are not supported for compile_multitarget with more than one target.\n";
+
     // If only one target, don't bother with the runtime feature detection wrapping.
     const bool needs_wrapper = (targets.size() > 1);
     if (targets.size() == 1) {
@@ -494,25 +685,19 @@ void compile_multitarget(const std::string &fn_name,
         return;
     }
 
-    // For safety, the runtime must be built only with features common to all
-    // of the targets; given an unusual ordering like
-    //
-    //     x86-64-linux,x86-64-sse41
-    //
-    // we should still always be *correct*: this ordering would never select sse41
-    // (since x86-64-linux would be selected first due to ordering), but could
-    // crash on non-sse41 machines (if we generated a runtime with sse41 instructions
-    // included). So we'll keep track of the common features as we walk thru the targets.
-
-    // Using something like std::bitset would be arguably cleaner here, but we need an
-    // array-of-uint64 for calls to halide_can_use_target_features() anyway,
-    // so we'll just build and maintain in that form to avoid extra conversion.
     constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
-    uint64_t runtime_features[kFeaturesWordCount] = {(uint64_t)-1LL};
 
     TemporaryObjectFileDir temp_dir;
+    // The sub-modules are each produced, lowered and compiled on their
+    // own thread, alongside the runtime. Each of these jobs draws its
+    // unique names from its own copy of the counters, so the names in
+    // a sub-module don't depend on how the jobs happened to be
+    // scheduled. The wrapper needs the arguments of the base target's
+    // module, so it is compiled once they are all done.
+    std::vector<std::function<void()>> compile_jobs;
     std::vector<Expr> wrapper_args;
     std::vector<LoweredArgument> base_target_args;
+    const UniqueNameCounters unique_name_start = snapshot_unique_name_counters();
     for (const Target &target : targets) {
         // arch-bits-os must be identical across all targets.
         if (target.os != base_target.os ||
@@ -521,15 +706,18 @@ void compile_multitarget(const std::string &fn_name,
             user_error << "All Targets must have matching arch-bits-os for compile_multitarget.\n";
         }
         // Some features must match across all targets.
-        static const std::array<Target::Feature, 8> must_match_features = {{
+        static const std::array<Target::Feature, 11> must_match_features = {{
             Target::ASAN,
+            Target::Batch,
             Target::CPlusPlusMangling,
             Target::JIT,
             Target::Matlab,
             Target::MSAN,
             Target::NoRuntime,
             Target::TSAN,
+            Target::UncheckedEntry,
             Target::UserContext,
+            Target::ZeroCopy,
         }};
         for (auto f : must_match_features) {
             if (target.has_feature(f) != base_target.has_feature(f)) {
@@ -555,16 +743,22 @@ void compile_multitarget(const std::string &fn_name,
             sub_fn_target = sub_fn_target.without_feature(Target::Matlab);
         }
 
-        Module sub_module = module_producer(sub_fn_name, sub_fn_target);
-        // Re-assign every time -- should be the same across all targets anyway,
-        // but base_target is always the last one we encounter.
-        base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
         Outputs sub_out = add_suffixes(output_files, suffix);
         internal_assert(sub_out.object_name.empty());
         sub_out.object_name = temp_dir.add_temp_object_file(output_files.static_library_name, suffix, target);
         debug(1) << "compile_multitarget: compile_sub_target " << sub_out.object_name << "\n";
-        sub_module.compile(sub_out);
+        // The arguments should be the same across all targets anyway,
+        // but base_target is always the last one.
+        const bool is_base_target = (&target == &targets.back());
+        compile_jobs.push_back([&module_producer, &unique_name_start, &base_target_args,
+                                sub_fn_name, sub_fn_target, sub_out, is_base_target]() {
+            ScopedUniqueNameCounters counters(unique_name_start);
+            Module sub_module = module_producer(sub_fn_name, sub_fn_target);
+            if (is_base_target) {
+                base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
+            }
+            sub_module.compile(sub_out);
+        });
 
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
@@ -586,10 +780,6 @@ void compile_multitarget(const std::string &fn_name,
             can_use = IntImm::make(Int(32), 1);
         }
 
-        for (int i = 0; i < kFeaturesWordCount; ++i) {
-            runtime_features[i] &= cur_target_features[i];
-        }
-
         wrapper_args.push_back(can_use != 0);
         wrapper_args.push_back(sub_fn_name);
     }
@@ -597,25 +787,17 @@ void compile_multitarget(const std::string &fn_name,
     // If we haven't specified "no runtime", build a runtime with the base target
     // and add that to the result.
     if (!base_target.has_feature(Target::NoRuntime)) {
-        // Start with a bare Target, set only the features we know are common to all.
-        Target runtime_target(base_target.os, base_target.arch, base_target.bits);
-        for (int i = 0; i < Target::FeatureEnd; ++i) {
-            // We never want NoRuntime set here.
-            if (i == Target::NoRuntime) {
-                continue;
-            }
-            const int word = i >> 6;
-            const int bit = i & 63;
-            if (runtime_features[word] & (((uint64_t) 1) << bit)) {
-                runtime_target.set_feature((Target::Feature) i);
-            }
-        }
+        Target runtime_target = Internal::get_multitarget_runtime_target(targets);
         Outputs runtime_out = Outputs().object(
             temp_dir.add_temp_object_file(output_files.static_library_name, "_runtime", runtime_target));
         debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.static_library_name << "\n";
-        compile_standalone_runtime(runtime_out, runtime_target);
+        compile_jobs.push_back([runtime_out, runtime_target]() {
+            compile_standalone_runtime(runtime_out, runtime_target);
+        });
     }
 
+    compile_in_parallel(compile_jobs);
+
     if (needs_wrapper) {
         Expr indirect_result = Call::make(Int(32), Call::call_cached_indirect_function, wrapper_args, Call::Intrinsic);
         std::string private_result_name = unique_name(fn_name + "_result");
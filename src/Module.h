@@ -164,6 +164,30 @@ void compile_standalone_runtime(const std::string &object_filename, Target t);
  */
 Outputs compile_standalone_runtime(const Outputs &output_files, Target t);
 
+/** The size of a runtime built by compile_minimal_runtime. */
+struct RuntimeFootprint {
+    /** The runtime symbols that the modules and the application use. */
+    std::vector<std::string> entry_points;
+
+    /** The number of functions and llvm instructions in the minimal
+     * runtime, and in the full runtime for the same target. */
+    int functions = 0, full_functions = 0;
+    int instructions = 0, full_instructions = 0;
+};
+
+/** Create an object and/or static library file containing only the
+ * parts of the Halide runtime for a given target that a set of
+ * modules, compiled with Target::NoRuntime, can reach. The runtime
+ * functions the application calls itself (such as
+ * halide_set_error_handler) must be listed in extra_entry_points, as
+ * they are otherwise stripped. If footprint is non-null, it is filled
+ * in with the entry points found and the size of the result. The
+ * modules and the runtime must be built for compatible targets. */
+Outputs compile_minimal_runtime(const Outputs &output_files, Target t,
+                                const std::vector<Module> &modules,
+                                const std::vector<std::string> &extra_entry_points = std::vector<std::string>(),
+                                RuntimeFootprint *footprint = nullptr);
+
 typedef std::function<Module(const std::string &, const Target &)> ModuleProducer;
 
 void compile_multitarget(const std::string &fn_name,
@@ -172,6 +196,15 @@ void compile_multitarget(const std::string &fn_name,
                          ModuleProducer module_producer,
                          const std::map<std::string, std::string> &suffixes = {});
 
+namespace Internal {
+
+/** The target compile_multitarget builds the shared runtime for: the
+ * os, arch and bits of the targets, the features common to all of
+ * them, and the device APIs any of them use. */
+Target get_multitarget_runtime_target(const std::vector<Target> &targets);
+
+}  // namespace Internal
+
 }  // namespace Halide
 
 #endif
@@ -0,0 +1,169 @@
+#include "NarrowArithmetic.h"
+#include "Bounds.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+bool is_integer(Type t) {
+    return (t.is_int() || t.is_uint()) && t.bits() > 1;
+}
+
+bool const_int64(const Expr &e, int64_t *result) {
+    if (const int64_t *i = as_const_int(e)) {
+        *result = *i;
+        return true;
+    } else if (const uint64_t *u = as_const_uint(e)) {
+        if (*u > (uint64_t)INT64_MAX) {
+            return false;
+        }
+        *result = (int64_t)*u;
+        return true;
+    }
+    return false;
+}
+
+// Whether an interval is within the range of the given type.
+bool fits_in(const Interval &b, Type t) {
+    int64_t min, max;
+    if (!b.is_bounded() ||
+        !const_int64(b.min, &min) ||
+        !const_int64(b.max, &max)) {
+        return false;
+    }
+    int64_t type_min = t.is_uint() ? 0 : -((int64_t)1 << (t.bits() - 1));
+    int64_t type_max = t.is_uint() ? ((int64_t)1 << t.bits()) - 1 : ((int64_t)1 << (t.bits() - 1)) - 1;
+    return min >= type_min && max <= type_max;
+}
+
+class NarrowArithmetic : public IRMutator2 {
+    using IRMutator2::visit;
+
+    // The bounds of the enclosing loop variables and lets.
+    Scope<Interval> bounds;
+
+    // The variables that vary across the lanes of an enclosing
+    // vectorized loop.
+    Scope<> varying;
+
+    int in_vector_loop = 0;
+
+    // Rewrite an expression to compute in the narrower type t, or
+    // return an undefined Expr if some value in it might not fit.
+    Expr narrow(const Expr &e, Type t) {
+        if (!fits_in(find_constant_bounds(e, bounds), t)) {
+            return Expr();
+        }
+
+        if (e.type() == t) {
+            return e;
+        } else if (const Cast *c = e.as<Cast>()) {
+            if (is_integer(c->value.type())) {
+                // The value fits in both types, so casting directly
+                // to the narrow one gives the same result.
+                return c->value.type() == t ? c->value : Cast::make(t, c->value);
+            }
+        } else if (is_const(e)) {
+            return cast(t, e);
+        }
+
+#define NARROW_BINARY_OP(T)                       \
+        if (const T *op = e.as<T>()) {            \
+            Expr a = narrow(op->a, t);            \
+            Expr b = a.defined() ? narrow(op->b, t) : Expr(); \
+            return b.defined() ? T::make(a, b) : Expr(); \
+        }
+
+        NARROW_BINARY_OP(Add)
+        NARROW_BINARY_OP(Sub)
+        NARROW_BINARY_OP(Mul)
+        NARROW_BINARY_OP(Div)
+        NARROW_BINARY_OP(Mod)
+        NARROW_BINARY_OP(Min)
+        NARROW_BINARY_OP(Max)
+
+#undef NARROW_BINARY_OP
+
+        if (const Select *op = e.as<Select>()) {
+            Expr true_value = narrow(op->true_value, t);
+            Expr false_value = true_value.defined() ? narrow(op->false_value, t) : Expr();
+            if (false_value.defined()) {
+                return Select::make(op->condition, true_value, false_value);
+            }
+            return Expr();
+        }
+
+        // Other values are only worth casting down if they're the
+        // same in every lane, or are already no wider.
+        if (e.type().bits() <= t.bits() || !expr_uses_vars(e, varying)) {
+            return Cast::make(t, e);
+        }
+        return Expr();
+    }
+
+    Expr visit(const Cast *op) override {
+        Expr value = mutate(op->value);
+        Type wide = value.type();
+        if (!in_vector_loop ||
+            !is_integer(op->type) || !is_integer(wide) ||
+            wide.bits() < 32 || op->type.bits() >= wide.bits()) {
+            return value.same_as(op->value) ? op : Cast::make(op->type, value);
+        }
+
+        for (int bits = 8; bits < wide.bits(); bits *= 2) {
+            for (Type t : {UInt(bits, wide.lanes()), Int(bits, wide.lanes())}) {
+                Expr narrowed = narrow(value, t);
+                if (narrowed.defined()) {
+                    return narrowed.type() == op->type ? narrowed : Cast::make(op->type, narrowed);
+                }
+            }
+        }
+        return value.same_as(op->value) ? op : Cast::make(op->type, value);
+    }
+
+    template<typename LetOrLetStmt>
+    auto visit_let(const LetOrLetStmt *op) -> decltype(op->body) {
+        Expr value = mutate(op->value);
+        ScopedBinding<Interval> bind(bounds, op->name, find_constant_bounds(value, bounds));
+        ScopedBinding<> bind_varying(expr_uses_vars(value, varying), varying, op->name);
+        auto body = mutate(op->body);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const For *op) override {
+        Interval b = Interval::make_union(find_constant_bounds(op->min, bounds),
+                                          find_constant_bounds(op->min + op->extent - 1, bounds));
+        ScopedBinding<Interval> bind(bounds, op->name, b);
+        bool vectorized = op->for_type == ForType::Vectorized;
+        ScopedBinding<> bind_varying(vectorized, varying, op->name);
+        in_vector_loop += vectorized;
+        Stmt stmt = IRMutator2::visit(op);
+        in_vector_loop -= vectorized;
+        return stmt;
+    }
+};
+
+}  // namespace
+
+Stmt narrow_arithmetic(const Stmt &s) {
+    return NarrowArithmetic().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
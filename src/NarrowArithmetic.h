@@ -0,0 +1,26 @@
+#ifndef HALIDE_NARROW_ARITHMETIC_H
+#define HALIDE_NARROW_ARITHMETIC_H
+
+/** \file
+ * Defines the lowering pass that does integer arithmetic in vectorized
+ * loops in the narrowest type that can hold its values.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** In vectorized loops, find integer expressions of 32 or more bits
+ * that are cast to a narrower type, and use bounds analysis to do
+ * their arithmetic in an 8 or 16-bit type instead, if every
+ * intermediate value provably fits. The implicit widening of Halide's
+ * arithmetic means many 8-bit pipelines compute in 32 bits, and
+ * narrower vectors fit more lanes in each register. Should be done
+ * before vectorization. */
+Stmt narrow_arithmetic(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -38,6 +38,20 @@ OutputImageParam &OutputImageParam::set_host_alignment(int bytes) {
     return *this;
 }
 
+OutputImageParam &OutputImageParam::set_static_shape(const std::vector<int> &extents) {
+    user_assert((int)extents.size() == dimensions())
+        << "set_static_shape for " << name() << " was given " << extents.size()
+        << " extents, but it has " << dimensions() << " dimensions\n";
+    int stride = 1;
+    for (int i = 0; i < dimensions(); i++) {
+        user_assert(extents[i] > 0)
+            << "set_static_shape for " << name() << " was given a non-positive extent\n";
+        dim(i).set_bounds(0, extents[i]).set_stride(stride);
+        stride *= extents[i];
+    }
+    return *this;
+}
+
 int OutputImageParam::dimensions() const {
     return param.dimensions();
 }
@@ -68,6 +68,17 @@ public:
     /** Set the expected alignment of the host pointer in bytes. */
     OutputImageParam &set_host_alignment(int);
 
+    /** Promise that the buffer always has the given constant extents,
+     * a min of zero in every dimension, and dense strides with
+     * dimension 0 innermost. This is checked at runtime like any
+     * other constraint, but the constants are then used in place of
+     * the buffer's shape, so all of the index math involving it
+     * folds away. Useful for tiny fixed-size inputs such as filter
+     * kernels and color matrices; see
+     * Halide::Runtime::StaticShapeBuffer for a matching caller-side
+     * type. */
+    OutputImageParam &set_static_shape(const std::vector<int> &extents);
+
     /** Get the dimensionality of this image parameter */
     int dimensions() const;
 
@@ -58,6 +58,11 @@ struct Outputs {
      * output is desired. */
     std::string schedule_name;
 
+    /** The name of the emitted serialized pipeline file, which can be
+     * loaded and run with SerializedPipeline::load. Empty if no
+     * serialized pipeline is desired. */
+    std::string serialized_pipeline_name;
+
     /** Make a new Outputs struct that emits everything this one does
      * and also an object file with the given name. */
     Outputs object(const std::string &object_name) const {
@@ -145,6 +150,14 @@ struct Outputs {
         updated.schedule_name = schedule_name;
         return updated;
     }
+
+    /** Make a new Outputs struct that emits everything this one does
+     * and also a serialized pipeline file with the given name. */
+    Outputs serialized_pipeline(const std::string &serialized_pipeline_name) const {
+        Outputs updated = *this;
+        updated.serialized_pipeline_name = serialized_pipeline_name;
+        return updated;
+    }
 };
 
 }  // namespace Halide
@@ -0,0 +1,31 @@
+#include "PagedInput.h"
+#include "Param.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+Func paged_input(const string &name, Type t, const vector<int> &page_extents) {
+    const int dims = (int)page_extents.size();
+    user_assert(dims >= 1 && dims <= 4)
+        << "Paged input " << name << " has " << dims
+        << " dimensions, but must have between one and four.\n";
+
+    vector<ExternFuncArgument> args;
+    args.push_back(user_context_value());
+    args.push_back(Expr(name));
+    for (int i = 0; i < 4; i++) {
+        int extent = i < dims ? page_extents[i] : 1;
+        user_assert(extent > 0)
+            << "Paged input " << name << " has a page extent of " << extent
+            << " in dimension " << i << ", but page extents must be positive.\n";
+        args.push_back(extent);
+    }
+
+    Func f(name);
+    f.define_extern("halide_paged_input", args, t, dims, NameMangling::C);
+    return f;
+}
+
+}  // namespace Halide
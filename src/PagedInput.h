@@ -0,0 +1,34 @@
+#ifndef HALIDE_PAGED_INPUT_H
+#define HALIDE_PAGED_INPUT_H
+
+/** \file
+ * Defines paged_input, for pipeline inputs too large to hold in
+ * memory. */
+
+#include <string>
+#include <vector>
+
+#include "Func.h"
+
+namespace Halide {
+
+/** Make a Func of the given type, with one dimension per entry of
+ * page_extents, that can be used in place of an ImageParam for an
+ * input that is never resident in memory as a whole, such as a
+ * terabyte-scale image on disk. When a consumer needs some region of
+ * it, the region is covered with pages of page_extents (aligned to
+ * multiples of them), and any page not already in the memoization
+ * cache is filled in by the callback set with
+ * halide_set_page_provider, called with the name given here. Pages
+ * are evicted least recently used first, so the memory used is
+ * bounded by halide_memoization_cache_set_size.
+ *
+ * The returned Func is an extern stage, so it is computed once, at
+ * the root, unless it is scheduled otherwise; to stream over the
+ * input, compute it at some tile of its consumer. Up to four
+ * dimensions are supported. */
+Func paged_input(const std::string &name, Type t, const std::vector<int> &page_extents);
+
+}  // namespace Halide
+
+#endif
@@ -110,7 +110,11 @@ Expr Parameter::scalar_expr() const {
     const Type t = type();
     if (t.is_float()) {
         switch (t.bits()) {
-        case 16: return Expr(scalar<float16_t>());
+        case 16:
+            if (t.is_bfloat()) {
+                return Expr(scalar<bfloat16_t>());
+            }
+            return Expr(scalar<float16_t>());
         case 32: return Expr(scalar<float>());
         case 64: return Expr(scalar<double>());
         }
@@ -0,0 +1,198 @@
+#include <map>
+
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "PeakMemoryUsage.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+namespace {
+
+// The bytes currently live and the most that have been live at
+// once, for one kind of memory.
+struct Usage {
+    Expr current = make_zero(Int(64));
+    Expr peak = make_zero(Int(64));
+
+    void allocate(const Expr &size) {
+        current = simplify(current + size);
+        peak = simplify(max(peak, current));
+    }
+
+    void release(const Expr &size) {
+        current = simplify(current - size);
+    }
+};
+
+class ComputePeakMemoryUsage : public IRVisitor {
+    using IRVisitor::visit;
+
+    Scope<Interval> scope;
+
+    // The sizes of the live allocations, and whether they are on the
+    // heap.
+    map<string, std::pair<Expr, bool>> live;
+
+    // Find an upper bound for an expression in terms of the values
+    // defined outside of the pipeline, or mark the result unbounded.
+    Expr upper_bound(const Expr &e) {
+        Interval b = bounds_of_expr_in_scope(e, scope);
+        if (!b.has_upper_bound()) {
+            unbounded = true;
+            return make_zero(Int(64));
+        }
+        return simplify(b.max);
+    }
+
+    void visit(const LetStmt *op) override {
+        // The fields of the buffer arguments are left as free
+        // variables, so that the result is in terms of them.
+        const Call *c = op->value.as<Call>();
+        if (c && starts_with(c->name, "_halide_buffer_get_")) {
+            op->body.accept(this);
+            return;
+        }
+        Interval b = bounds_of_expr_in_scope(op->value, scope);
+        ScopedBinding<Interval> bind(scope, op->name, b);
+        op->body.accept(this);
+    }
+
+    void visit(const Allocate *op) override {
+        if (op->new_expr.defined() ||
+            (op->memory_type != MemoryType::Auto &&
+             op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Stack &&
+             op->memory_type != MemoryType::Register)) {
+            // Not allocated by Halide on the host
+            op->body.accept(this);
+            return;
+        }
+
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        size = upper_bound(size);
+
+        // Mirror the choice made by CodeGen_Posix::create_allocation.
+        bool on_heap;
+        const int64_t *const_size = as_const_int(size);
+        if (op->memory_type == MemoryType::Heap) {
+            on_heap = true;
+        } else if (op->memory_type == MemoryType::Stack ||
+                   op->memory_type == MemoryType::Register) {
+            on_heap = false;
+        } else {
+            on_heap = !(const_size && *const_size > 0 &&
+                        can_allocation_fit_on_stack(*const_size));
+        }
+
+        Usage &u = on_heap ? heap : stack;
+        u.allocate(size);
+        live[op->name] = {size, on_heap};
+        op->body.accept(this);
+        auto it = live.find(op->name);
+        if (it != live.end()) {
+            // Never explicitly freed, so it dies at the end of its scope.
+            u.release(size);
+            live.erase(it);
+        }
+    }
+
+    void visit(const Free *op) override {
+        auto it = live.find(op->name);
+        if (it != live.end()) {
+            (it->second.second ? heap : stack).release(it->second.first);
+            live.erase(it);
+        }
+    }
+
+    // Visit a Stmt and return how much it raises the peak above the
+    // usage on entry.
+    std::pair<Expr, Expr> growth_in(const Stmt &s) {
+        Usage old_heap = heap, old_stack = stack;
+        heap.peak = heap.current;
+        stack.peak = stack.current;
+        s.accept(this);
+        std::pair<Expr, Expr> growth = {simplify(heap.peak - old_heap.current),
+                                        simplify(stack.peak - old_stack.current)};
+        heap = old_heap;
+        stack = old_stack;
+        return growth;
+    }
+
+    void add_growth(const std::pair<Expr, Expr> &growth) {
+        heap.peak = simplify(max(heap.peak, heap.current + growth.first));
+        stack.peak = simplify(max(stack.peak, stack.current + growth.second));
+    }
+
+    void visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // A device kernel
+            return;
+        }
+
+        Interval min_bounds = bounds_of_expr_in_scope(op->min, scope);
+        Interval max_bounds = bounds_of_expr_in_scope(op->min + op->extent - 1, scope);
+        Interval b = Interval::make_union(min_bounds, max_bounds);
+        std::pair<Expr, Expr> growth;
+        {
+            ScopedBinding<Interval> bind(scope, op->name, b);
+            growth = growth_in(op->body);
+        }
+        if (op->is_parallel()) {
+            // Every iteration may be running at once.
+            Expr extent = upper_bound(cast<int64_t>(op->extent));
+            growth.first = simplify(growth.first * extent);
+            growth.second = simplify(growth.second * extent);
+        }
+        add_growth(growth);
+    }
+
+    void visit(const Fork *op) override {
+        // Both sides run at the same time.
+        std::pair<Expr, Expr> first = growth_in(op->first);
+        std::pair<Expr, Expr> rest = growth_in(op->rest);
+        add_growth({simplify(first.first + rest.first),
+                    simplify(first.second + rest.second)});
+    }
+
+    void visit(const IfThenElse *op) override {
+        std::pair<Expr, Expr> then_growth = growth_in(op->then_case);
+        if (op->else_case.defined()) {
+            std::pair<Expr, Expr> else_growth = growth_in(op->else_case);
+            then_growth.first = simplify(max(then_growth.first, else_growth.first));
+            then_growth.second = simplify(max(then_growth.second, else_growth.second));
+        }
+        add_growth(then_growth);
+    }
+
+public:
+    Usage heap, stack;
+    bool unbounded = false;
+};
+
+}  // namespace
+
+PeakMemoryUsage compute_peak_memory_usage(const Stmt &s) {
+    ComputePeakMemoryUsage c;
+    s.accept(&c);
+    PeakMemoryUsage result;
+    if (!c.unbounded) {
+        result.heap_bytes = c.heap.peak;
+        result.stack_bytes = c.stack.peak;
+    }
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
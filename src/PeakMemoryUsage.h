@@ -0,0 +1,35 @@
+#ifndef HALIDE_PEAK_MEMORY_USAGE_H
+#define HALIDE_PEAK_MEMORY_USAGE_H
+
+/** \file
+ * Defines an analysis that bounds the memory a lowered pipeline
+ * allocates while it runs.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Upper bounds on the number of bytes a pipeline has allocated at
+ * any one time, split by where the allocations live. Each is an
+ * expression in the pipeline's scalar parameters and the fields of
+ * its buffer arguments (e.g. "output.extent.0"), or undefined if no
+ * bound could be found (e.g. if an allocation's size depends on the
+ * contents of an input). */
+struct PeakMemoryUsage {
+    Expr heap_bytes;
+    Expr stack_bytes;
+};
+
+/** Walk a fully lowered Stmt and bound the peak heap and stack
+ * usage of its host allocations. Allocations made inside the body
+ * of a parallel loop are counted once per iteration, as they may
+ * all be live at once. Allocations on a device (or in a device
+ * kernel) are not counted. */
+PeakMemoryUsage compute_peak_memory_usage(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
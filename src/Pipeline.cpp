@@ -1,9 +1,20 @@
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include "Argument.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "IRPrinter.h"
 #include "IRVisitor.h"
+#include "ImageParam.h"
 #include "InferArguments.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
@@ -42,14 +53,320 @@ Outputs static_library_outputs(const string &filename_prefix, const Target &targ
     return outputs;
 }
 
+bool is_assertions(const Stmt &s) {
+    if (const Block *block = s.as<Block>()) {
+        return is_assertions(block->first) && is_assertions(block->rest);
+    }
+    return s.as<AssertStmt>() != nullptr;
+}
+
+// Keep only the prelude of a lowered pipeline: the lets and
+// assertions that check its arguments, up to the first statement that
+// does any work.
+Stmt checks_only(const Stmt &s) {
+    if (const LetStmt *let = s.as<LetStmt>()) {
+        return LetStmt::make(let->name, let->value, checks_only(let->body));
+    } else if (s.as<AssertStmt>()) {
+        return s;
+    } else if (const Block *block = s.as<Block>()) {
+        if (is_assertions(block->first)) {
+            return Block::make(block->first, checks_only(block->rest));
+        }
+    }
+    return Evaluate::make(0);
+}
+
+bool is_identifier_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+// Rename every identifier that looks like something returned by
+// unique_name to a canonical numbering in order of first
+// appearance. Two pipelines built the same way get different unique
+// names, but print identically after this.
+string canonicalize_unique_names(const string &text) {
+    std::map<string, string> renamed;
+    string result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size()) {
+        if (!is_identifier_char(text[i])) {
+            result += text[i++];
+            continue;
+        }
+        size_t j = i;
+        while (j < text.size() && is_identifier_char(text[j])) {
+            j++;
+        }
+        string token = text.substr(i, j - i);
+        i = j;
+
+        // unique_name(char) produces a char followed by digits, and
+        // unique_name(string) produces a string, a '$', and digits.
+        size_t dollar = token.find('$');
+        size_t digits_start;
+        if (dollar == string::npos) {
+            digits_start = 1;
+            if (isdigit((unsigned char)token[0])) {
+                result += token;
+                continue;
+            }
+        } else {
+            digits_start = dollar + 1;
+            if (dollar == 0 || token.find('$', digits_start) != string::npos) {
+                result += token;
+                continue;
+            }
+        }
+        bool all_digits = digits_start < token.size();
+        for (size_t k = digits_start; k < token.size(); k++) {
+            all_digits &= isdigit((unsigned char)token[k]) != 0;
+        }
+        if (!all_digits) {
+            result += token;
+            continue;
+        }
+
+        auto it = renamed.find(token);
+        if (it == renamed.end()) {
+            // '\x01' never appears in printed IR, so the new names
+            // can't collide with anything that wasn't renamed. The
+            // prefix of a unique_name(string) may itself contain a
+            // unique name, so it is dropped entirely.
+            string canonical = (dollar == string::npos ? token.substr(0, 1) : string()) +
+                '\x01' + std::to_string(renamed.size());
+            it = renamed.emplace(token, canonical).first;
+        }
+        result += it->second;
+    }
+    return result;
+}
+
+// Extern calls are resolved by name, so their names must be part of
+// the cache key verbatim, even when they happen to look like
+// something unique_name would make.
+class CollectExternNames : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Extern ||
+            op->call_type == Call::ExternCPlusPlus) {
+            names.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+public:
+    std::set<string> names;
+};
+
+uint64_t fnv1a_64(const char *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Describe everything about a jit compilation that the generated code
+// depends on, other than the addresses of jit externs (which differ
+// between runs of a program, and so can't be part of the key used
+// for objects cached on disk).
+string jit_structure_key(const Module &module, const Target &target,
+                         const vector<Argument> &args,
+                         const std::map<std::string, JITExtern> &externs) {
+    std::ostringstream structure;
+    structure << module;
+    for (const Argument &arg : args) {
+        structure << "arg " << arg.name << " " << (int)arg.kind << " "
+                  << arg.type << " " << (int)arg.dimensions << "\n";
+    }
+    string key = canonicalize_unique_names(structure.str());
+
+    std::ostringstream rest;
+    rest << "target " << target.to_string() << "\n";
+    for (const Buffer<> &b : module.buffers()) {
+        // The contents of embedded buffers are baked into the code.
+        const halide_buffer_t *raw = b.raw_buffer();
+        uint64_t h = fnv1a_64((const char *)raw->dim, raw->dimensions * sizeof(halide_dimension_t));
+        if (raw->host) {
+            h = fnv1a_64((const char *)b.begin(), b.size_in_bytes(), h);
+        }
+        rest << "buffer " << b.type() << " " << h << "\n";
+    }
+    CollectExternNames extern_names;
+    for (const auto &f : module.functions()) {
+        f.body.accept(&extern_names);
+    }
+    for (const string &n : extern_names.names) {
+        rest << "extern call " << n << "\n";
+    }
+    for (const auto &e : externs) {
+        const ExternSignature &sig = e.second.extern_c_function().signature();
+        rest << "jit extern " << e.first << " ";
+        if (sig.is_void_return()) {
+            rest << "void";
+        } else {
+            rest << sig.ret_type();
+        }
+        for (const Type &t : sig.arg_types()) {
+            rest << " " << t;
+        }
+        rest << "\n";
+    }
+    return key + rest.str();
+}
+
+// A process-wide cache of jit-compiled pipelines, keyed by the
+// canonicalized lowered module. Repeatedly constructing the same
+// pipeline, as happens when a Func is defined inside a function that
+// is called many times, can then skip codegen entirely. The number of
+// modules kept alive is set by HL_JIT_CACHE_SIZE (default 64, zero
+// disables the cache).
+class JITModuleCache {
+    std::mutex mutex;
+    typedef std::list<std::pair<string, JITModule>> EntryList;
+    // Most recently used first.
+    EntryList entries;
+    std::map<string, EntryList::iterator> index;
+    size_t capacity;
+
+public:
+    JITModuleCache() {
+        string size = get_env_variable("HL_JIT_CACHE_SIZE");
+        capacity = size.empty() ? 64 : (size_t)std::max(0, atoi(size.c_str()));
+    }
+
+    bool enabled() const {
+        return capacity > 0;
+    }
+
+    bool lookup(const string &key, JITModule &result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        result = it->second->second;
+        return true;
+    }
+
+    void insert(const string &key, const JITModule &m) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (index.count(key)) {
+            return;
+        }
+        entries.emplace_front(key, m);
+        index[key] = entries.begin();
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+JITModuleCache &jit_module_cache() {
+    static JITModuleCache cache;
+    return cache;
+}
+
+// With HL_JIT_TIERED set to a nonzero value, compile_jit first
+// compiles a pipeline with almost no llvm optimization, so that it can
+// be run sooner, and compiles the optimized version in the
+// background. The pipeline switches to the optimized version on the
+// first compile_jit (e.g. realize) after it is ready.
+bool tiered_jit_enabled() {
+    static bool enabled = atoi(get_env_variable("HL_JIT_TIERED").c_str()) != 0;
+    return enabled;
+}
+
+// The optimized module of a tiered compile, once it is ready.
+struct PendingJITModule {
+    std::mutex mutex;
+    JITModule module;
+    // Set once module has been filled in, so that callers can check
+    // for it without taking the mutex.
+    std::atomic<bool> ready{false};
+};
+
+// Runs the background compiles of tiered jit compilation one at a
+// time, on a thread started by the first one. Compiles that haven't
+// started when the process exits are dropped.
+class BackgroundJITCompiler {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::thread thread;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeup.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+public:
+    void add(std::function<void()> job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            thread = std::thread([this]() { run(); });
+        }
+        jobs.push_back(std::move(job));
+        wakeup.notify_one();
+    }
+
+    ~BackgroundJITCompiler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
+
+BackgroundJITCompiler &background_jit_compiler() {
+    static BackgroundJITCompiler compiler;
+    return compiler;
+}
+
 }  // namespace
 
+namespace Internal {
+
+// Everything a call into a jit-compiled pipeline reads. It is made by
+// compile_jit and never modified afterwards, so any number of threads
+// can realize the pipeline at once without locking.
+struct JITCallState {
+    JITModule jit_module;
+    Target target;
+    vector<InferredArgument> inferred_args;
+    std::shared_ptr<PendingJITModule> pending_jit_module;
+};
+
+}  // namespace Internal
+
 struct PipelineContents {
     mutable RefCount ref_count;
 
     // Cached lowered stmt
     Module module;
 
+    // Cached first half of lowering, for each target it has been
+    // lowered for. Made when first needed, and may be shared with
+    // other Pipelines.
+    std::shared_ptr<LoweringPrefixCache> lowering_prefixes;
+
     // Name of the generated function
     string name;
 
@@ -57,11 +374,36 @@ struct PipelineContents {
     JITModule jit_module;
     Target jit_target;
 
+    // If jit_module came from the first tier of a tiered compile, the
+    // optimized version being compiled in the background.
+    std::shared_ptr<PendingJITModule> pending_jit_module;
+
+    // A snapshot of the above for realize to use, replaced with
+    // std::atomic_store whenever they change. Null if the pipeline
+    // has not been jit-compiled.
+    std::shared_ptr<const JITCallState> jit_call_state;
+
+    // Serializes compile_jit, which updates all of the above.
+    std::mutex jit_mutex;
+
+    /** Publish the current jit-compiled state to realize. */
+    void publish_jit_call_state() {
+        std::shared_ptr<JITCallState> state = std::make_shared<JITCallState>();
+        state->jit_module = jit_module;
+        state->target = jit_target;
+        state->inferred_args = inferred_args;
+        state->pending_jit_module = pending_jit_module;
+        std::atomic_store(&jit_call_state, std::shared_ptr<const JITCallState>(std::move(state)));
+    }
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_module = JITModule();
         jit_target = Target();
+        pending_jit_module.reset();
+        std::atomic_store(&jit_call_state, std::shared_ptr<const JITCallState>());
+        lowering_prefixes.reset();
         inferred_args.clear();
     }
 
@@ -152,10 +494,12 @@ vector<Func> Pipeline::outputs() const {
 }
 
 string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params) {
-    user_assert(target.arch == Target::X86 || target.arch == Target::ARM ||
-                target.arch == Target::POWERPC || target.arch == Target::MIPS)
-        << "Automatic scheduling is currently supported only on these architectures.";
-    return generate_schedules(contents->outputs, target, arch_params);
+    return auto_schedule(target, arch_params, AutoSchedulerCostModel());
+}
+
+string Pipeline::auto_schedule(const Target &target, const MachineParams &arch_params,
+                               const AutoSchedulerCostModel &cost_model) {
+    return generate_schedules(contents->outputs, target, arch_params, cost_model);
 }
 
 Func Pipeline::get_func(size_t index) {
@@ -190,6 +534,15 @@ void Pipeline::compile_to_bitcode(const string &filename,
     m.compile(Outputs().bitcode(output_name(filename, m, ".bc")));
 }
 
+void Pipeline::compile_to_serialized_pipeline(const string &filename,
+                                              const vector<Argument> &args,
+                                              const string &fn_name,
+                                              const Target &target) {
+    Target t = target.with_feature(Target::JIT).with_feature(Target::UserContext);
+    Module m = compile_to_module(args, fn_name, t);
+    m.compile(Outputs().serialized_pipeline(output_name(filename, m, ".hlpipe")));
+}
+
 void Pipeline::compile_to_llvm_assembly(const string &filename,
                                         const vector<Argument> &args,
                                         const string &fn_name,
@@ -391,7 +744,44 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
             custom_passes.push_back(p.pass);
         }
 
-        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes);
+        if (!contents->lowering_prefixes) {
+            contents->lowering_prefixes = std::make_shared<LoweringPrefixCache>();
+        }
+        contents->module = lower(contents->outputs, new_fn_name, target, lowering_args, linkage_type, custom_passes,
+                                 contents->lowering_prefixes.get());
+
+        // A batched entry point runs the pipeline once with all of
+        // its checks, and then runs the rest of the batch through a
+        // copy compiled without them. The unchecked_entry feature
+        // exports that copy as <name>_unchecked, along with
+        // <name>_validate, which runs only the checks.
+        const bool batch = target.has_feature(Target::Batch);
+        const bool unchecked_entry = target.has_feature(Target::UncheckedEntry);
+        if ((batch || unchecked_entry) &&
+            !target.has_feature(Target::JIT) &&
+            linkage_type == LinkageType::ExternalPlusMetadata) {
+            user_assert(!target.features_any_of({Target::HVX_64, Target::HVX_128}))
+                << "The batch and unchecked_entry target features are not supported with Hexagon offloading.\n";
+            user_assert(!batch || !target.has_gpu_feature())
+                << "The batch target feature is only supported for pipelines that run on the host.\n";
+            Target unchecked_target = target.with_feature(Target::NoAsserts).with_feature(Target::NoBoundsQuery);
+            Module unchecked = lower(contents->outputs, new_fn_name + "_unchecked", unchecked_target, lowering_args,
+                                     unchecked_entry ? LinkageType::External : LinkageType::Internal, custom_passes);
+            for (const auto &f : unchecked.functions()) {
+                contents->module.append(f);
+            }
+
+            if (unchecked_entry) {
+                // Profiling wraps the whole pipeline, prelude included,
+                // so leave it out of the validation function.
+                Target validate_target = target.with_feature(Target::NoBoundsQuery).without_feature(Target::Profile);
+                Module validate = lower(contents->outputs, new_fn_name + "_validate", validate_target,
+                                        lowering_args, LinkageType::External, custom_passes);
+                for (const auto &f : validate.functions()) {
+                    contents->module.append(LoweredFunc(f.name, f.args, checks_only(f.body), f.linkage, f.name_mangling));
+                }
+            }
+        }
     }
 
     return contents->module;
@@ -418,11 +808,26 @@ void *Pipeline::compile_jit(const Target &target_arg) {
 
     debug(2) << "jit-compiling for: " << target_arg << "\n";
 
+    std::lock_guard<std::mutex> jit_lock(contents->jit_mutex);
+
     // If we're re-jitting for the same target, we can just keep the
     // old jit module.
     if (contents->jit_target == target &&
         contents->jit_module.compiled()) {
         debug(2) << "Reusing old jit module compiled for :\n" << contents->jit_target << "\n";
+        if (contents->pending_jit_module) {
+            JITModule optimized;
+            {
+                std::lock_guard<std::mutex> lock(contents->pending_jit_module->mutex);
+                optimized = contents->pending_jit_module->module;
+            }
+            if (optimized.compiled()) {
+                debug(2) << "Switching to the optimized jit module\n";
+                contents->jit_module = optimized;
+                contents->pending_jit_module.reset();
+                contents->publish_jit_call_state();
+            }
+        }
         return contents->jit_module.main_function();
     }
     // Clear all cached info in case there is an error.
@@ -450,9 +855,64 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     auto f = module.get_function_by_name(name);
 
     std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
+    std::vector<JITModule> externs_jit_module = make_externs_jit_module(target_arg, lowered_externs);
+
+    // Look for an identical pipeline that has already been
+    // compiled. Pipelines used as jit externs have been compiled by
+    // now, so all the externs are plain function addresses.
+    string structure_key = jit_structure_key(module, target, args, lowered_externs);
+    std::ostringstream memory_key;
+    memory_key << structure_key;
+    for (const auto &e : lowered_externs) {
+        memory_key << "jit extern address " << e.first << " " << e.second.extern_c_function().address() << "\n";
+    }
 
-    // Compile to jit module
-    JITModule jit_module(module, f, make_externs_jit_module(target_arg, lowered_externs));
+    // The name of the entrypoint is baked into the object code, so it
+    // must be part of the key for objects cached on disk. So must the
+    // version of the compiler that produced them.
+    string disk_key = structure_key + "entrypoint " + name + "\n" +
+        "llvm " + std::to_string(LLVM_VERSION) + " " + __DATE__ + " " + __TIME__ + "\n";
+    std::ostringstream object_cache_key;
+    object_cache_key << std::hex
+                     << fnv1a_64(disk_key.data(), disk_key.size())
+                     << fnv1a_64(disk_key.data(), disk_key.size(), 0x84222325cbf29ce4ULL);
+
+    JITModuleCache &cache = jit_module_cache();
+    JITModule jit_module;
+    if (cache.enabled() && cache.lookup(memory_key.str(), jit_module)) {
+        debug(2) << "Reusing cached jit module for " << name << "\n";
+    } else if (tiered_jit_enabled()) {
+        jit_module = JITModule(module, f, externs_jit_module, "", false);
+
+        // The optimized module replaces the quick one in the cache
+        // and in this pipeline once it is ready. If the pipeline is
+        // recompiled or destroyed first, it is dropped.
+        std::shared_ptr<PendingJITModule> pending = std::make_shared<PendingJITModule>();
+        contents->pending_jit_module = pending;
+        std::weak_ptr<PendingJITModule> weak_pending = pending;
+        string cache_key = memory_key.str();
+        string disk_cache_key = object_cache_key.str();
+        background_jit_compiler().add([=, &cache]() {
+            if (weak_pending.expired()) {
+                return;
+            }
+            JITModule optimized(module, f, externs_jit_module, disk_cache_key);
+            if (cache.enabled()) {
+                cache.insert(cache_key, optimized);
+            }
+            if (std::shared_ptr<PendingJITModule> p = weak_pending.lock()) {
+                std::lock_guard<std::mutex> lock(p->mutex);
+                p->module = optimized;
+                p->ready = true;
+            }
+        });
+    } else {
+        // Compile to jit module
+        jit_module = JITModule(module, f, externs_jit_module, object_cache_key.str());
+        if (cache.enabled()) {
+            cache.insert(memory_key.str(), jit_module);
+        }
+    }
 
     // Dump bitcode to a file if the environment variable
     // HL_GENBITCODE is defined to a nonzero value.
@@ -467,6 +927,7 @@ void *Pipeline::compile_jit(const Target &target_arg) {
     }
 
     contents->jit_module = jit_module;
+    contents->publish_jit_call_state();
 
     return jit_module.main_function();
 }
@@ -676,6 +1137,26 @@ struct JITFuncCallContext {
         }
     }
 
+    // Report and reset the profiler stats if the call was profiled,
+    // then finalize.
+    void finish_call(const JITCallState &state, int exit_status) {
+        if (state.target.has_feature(Target::Profile)) {
+            JITModule::Symbol report_sym =
+                state.jit_module.find_symbol_by_name("halide_profiler_report");
+            JITModule::Symbol reset_sym =
+                state.jit_module.find_symbol_by_name("halide_profiler_reset");
+            if (report_sym.address && reset_sym.address) {
+                void *uc = &jit_context;
+                void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
+                report_fn_ptr(uc);
+
+                void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
+                reset_fn_ptr();
+            }
+        }
+        finalize(exit_status);
+    }
+
     void finalize(int exit_status) {
         report_if_error(exit_status);
     }
@@ -687,7 +1168,13 @@ struct Pipeline::JITCallArgs {
     size_t size{0};
     const void **store;
 
-    JITCallArgs(size_t size) : size(size) {
+    // The compiled pipeline these are the arguments for. Holding on
+    // to it keeps it alive for the duration of the call, even if
+    // another thread recompiles the pipeline.
+    std::shared_ptr<const JITCallState> state;
+
+    JITCallArgs(std::shared_ptr<const JITCallState> state, size_t num_outputs) :
+        size(state->inferred_args.size() + num_outputs), state(std::move(state)) {
         if (size > (sizeof(fixed_store) / sizeof(fixed_store[0]))) {
             // TODO(zalman): Call new[]?
             store = (const void **)malloc(sizeof(void *) * size);
@@ -717,14 +1204,14 @@ void Pipeline::prepare_jit_call_arguments(RealizationArg &outputs, const Target
                                           bool is_bounds_inference, JITCallArgs &args_result) {
     user_assert(defined()) << "Can't realize an undefined Pipeline\n";
 
-    JITModule &compiled_module = contents->jit_module;
+    const JITModule &compiled_module = args_result.state->jit_module;
     internal_assert(compiled_module.argv_function());
 
     const bool no_param_map = &param_map == &ParamMap::empty_map();
 
     // Come up with the void * arguments to pass to the argv function
     size_t arg_index = 0;
-    for (const InferredArgument &arg : contents->inferred_args) {
+    for (const InferredArgument &arg : args_result.state->inferred_args) {
         if (arg.param.defined()) {
             if (arg.param.same_as(contents->user_context_arg.param)) {
                 args_result.store[arg_index++] = user_context;
@@ -827,12 +1314,41 @@ Pipeline::make_externs_jit_module(const Target &target,
     return result;
 }
 
+std::shared_ptr<const JITCallState> Pipeline::jit_call_state(const Target &t) {
+    // Once the pipeline has been compiled, calls only read this
+    // snapshot of the compiled state, so they can be made from many
+    // threads at once.
+    std::shared_ptr<const JITCallState> state = std::atomic_load(&contents->jit_call_state);
+
+    Target target = t;
+    // If target is unspecified...
+    if (target.os == Target::OSUnknown) {
+        // If we've already jit-compiled for a specific target, use that.
+        if (state) {
+            target = state->target;
+        } else {
+            // Otherwise get the target from the environment
+            target = get_jit_target_from_environment();
+        }
+    }
+
+    // If the pipeline is already compiled for this target, skip
+    // compile_jit and its lock, unless the optimized module of a
+    // tiered compile is ready to be swapped in.
+    Target jit_target = target.with_feature(Target::JIT).with_feature(Target::UserContext);
+    if (!state || state->target != jit_target ||
+        (state->pending_jit_module && state->pending_jit_module->ready)) {
+        compile_jit(target);
+        state = std::atomic_load(&contents->jit_call_state);
+    }
+    return state;
+}
+
 void Pipeline::realize(RealizationArg outputs, const Target &t,
                        const ParamMap &param_map) {
-    Target target = t;
     user_assert(defined()) << "Can't realize an undefined Pipeline\n";
 
-    debug(2) << "Realizing Pipeline for " << target << "\n";
+    debug(2) << "Realizing Pipeline for " << t << "\n";
 
     if (outputs.r) {
         for (size_t i = 0; i < outputs.r->size(); i++) {
@@ -852,17 +1368,6 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
             << "The Buffers passed to realize must all be allocated\n";
     }
 
-    // If target is unspecified...
-    if (target.os == Target::OSUnknown) {
-        // If we've already jit-compiled for a specific target, use that.
-        if (contents->jit_module.compiled()) {
-            target = contents->jit_target;
-        } else {
-            // Otherwise get the target from the environment
-            target = get_jit_target_from_environment();
-        }
-    }
-
     // We need to make a context for calling the jitted function to
     // carry the the set of custom handlers. Here's how handlers get
     // called when running jitted code:
@@ -886,13 +1391,14 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // member of the JITFuncCallContext which we will declare now:
 
     // Ensure the module is compiled.
-    compile_jit(target);
+    std::shared_ptr<const JITCallState> state = jit_call_state(t);
+    const Target &target = state->target;
 
     // This has to happen after a runtime has been compiled in compile_jit.
     JITFuncCallContext jit_context(jit_handlers());
     void *user_context_storage = &jit_context.jit_context;
 
-    JITCallArgs args(contents->inferred_args.size() + outputs.size());
+    JITCallArgs args(state, outputs.size());
     prepare_jit_call_arguments(outputs, target, param_map,
                                &user_context_storage, false, args);
 
@@ -935,39 +1441,25 @@ void Pipeline::realize(RealizationArg outputs, const Target &t,
     // exception.
 
     debug(2) << "Calling jitted function\n";
-    int exit_status = contents->jit_module.argv_function()(args.store);
+    int exit_status = state->jit_module.argv_function()(args.store);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
-    // If we're profiling, report runtimes and reset profiler stats.
-    if (target.has_feature(Target::Profile)) {
-        JITModule::Symbol report_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_report");
-        JITModule::Symbol reset_sym =
-            contents->jit_module.find_symbol_by_name("halide_profiler_reset");
-        if (report_sym.address && reset_sym.address) {
-            void *uc = &jit_context.jit_context;
-            void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
-            report_fn_ptr(uc);
-
-            void (*reset_fn_ptr)() = (void (*)())(reset_sym.address);
-            reset_fn_ptr();
-        }
-    }
-
-    jit_context.finalize(exit_status);
+    jit_context.finish_call(*state, exit_status);
 }
 
 void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_map) {
     Target target = get_jit_target_from_environment();
 
     compile_jit(target);
+    std::shared_ptr<const JITCallState> state = std::atomic_load(&contents->jit_call_state);
+    const vector<InferredArgument> &inferred_args = state->inferred_args;
 
     // This has to happen after a runtime has been compiled in compile_jit.
     JITFuncCallContext jit_context(jit_handlers());
     void *user_context_storage = &jit_context.jit_context;
 
-    size_t args_size = contents->inferred_args.size() + outputs.size();
-    JITCallArgs args(args_size);
+    JITCallArgs args(state, outputs.size());
+    size_t args_size = args.size;
     prepare_jit_call_arguments(outputs, target, param_map,
                                &user_context_storage, true, args);
 
@@ -981,10 +1473,10 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
     vector<TrackedBuffer> tracked_buffers(args_size);
 
     vector<size_t> query_indices;
-    for (size_t i = 0; i < contents->inferred_args.size(); i++) {
+    for (size_t i = 0; i < inferred_args.size(); i++) {
         if (args.store[i] == nullptr) {
             query_indices.push_back(i);
-            InferredArgument ia = contents->inferred_args[i];
+            InferredArgument ia = inferred_args[i];
             internal_assert(ia.param.defined() && ia.param.is_buffer());
             // Make some empty Buffers of the right dimensionality
             vector<int> initial_shape(ia.param.dimensions(), 0);
@@ -1010,7 +1502,7 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
         }
 
         Internal::debug(2) << "Calling jitted function\n";
-        int exit_status = contents->jit_module.argv_function()(args.store);
+        int exit_status = state->jit_module.argv_function()(args.store);
         jit_context.report_if_error(exit_status);
         Internal::debug(2) << "Back from jitted function\n";
         bool changed = false;
@@ -1041,7 +1533,7 @@ void Pipeline::infer_input_bounds(RealizationArg outputs, const ParamMap &param_
 
     // Now allocate the resulting buffers
     for (size_t i : query_indices) {
-        InferredArgument ia = contents->inferred_args[i];
+        InferredArgument ia = inferred_args[i];
         Buffer<> *buf_out_param = nullptr;
         Parameter &p = param_map.map(ia.param, buf_out_param);
 
@@ -1081,12 +1573,131 @@ void Pipeline::infer_input_bounds(int x_size, int y_size, int z_size, int w_size
     infer_input_bounds(r, param_map);
 }
 
+struct PreparedPipeline::Contents {
+    std::shared_ptr<const JITCallState> state;
+    JITHandlers handlers;
+
+    // The argv for the compiled function: the inferred arguments,
+    // then the outputs.
+    vector<const void *> args;
+
+    // The values the slots of scalar arguments point to, and the
+    // buffers bound to buffer arguments, by argument index.
+    vector<halide_scalar_value_t> scalars;
+    vector<Buffer<>> buffers;
+
+    std::map<Parameter, size_t> slots;
+    size_t user_context_slot = 0;
+    size_t num_outputs = 0;
+
+    size_t slot(const Parameter &p) const {
+        auto iter = slots.find(p);
+        user_assert(iter != slots.end())
+            << "Parameter " << p.name() << " is not an argument to the prepared pipeline.\n";
+        return iter->second;
+    }
+};
+
+PreparedPipeline Pipeline::prepare(const Target &target) {
+    user_assert(defined()) << "Can't prepare an undefined Pipeline\n";
+
+    PreparedPipeline result;
+    result.contents = std::make_shared<PreparedPipeline::Contents>();
+    PreparedPipeline::Contents &c = *result.contents;
+    c.state = jit_call_state(target);
+    c.handlers = jit_handlers();
+    for (const Function &out : contents->outputs) {
+        c.num_outputs += out.output_types().size();
+    }
+
+    const vector<InferredArgument> &inferred_args = c.state->inferred_args;
+    c.args.resize(inferred_args.size() + c.num_outputs, nullptr);
+    c.scalars.resize(inferred_args.size());
+    c.buffers.resize(inferred_args.size());
+    for (size_t i = 0; i < inferred_args.size(); i++) {
+        const InferredArgument &arg = inferred_args[i];
+        if (!arg.param.defined()) {
+            // An Image embedded in the pipeline
+            c.buffers[i] = arg.buffer;
+            c.args[i] = c.buffers[i].raw_buffer();
+            continue;
+        }
+        c.slots[arg.param] = i;
+        if (arg.param.same_as(contents->user_context_arg.param)) {
+            c.user_context_slot = i;
+        } else if (arg.param.is_buffer()) {
+            c.buffers[i] = arg.param.buffer();
+            c.args[i] = c.buffers[i].defined() ? c.buffers[i].raw_buffer() : nullptr;
+        } else {
+            memcpy(&c.scalars[i], arg.param.scalar_address(), arg.param.type().bytes());
+            c.args[i] = &c.scalars[i];
+        }
+    }
+    return result;
+}
+
+void PreparedPipeline::set_scalar(const Parameter &p, Type t, const void *value) {
+    user_assert(defined()) << "Can't set an argument of an undefined PreparedPipeline\n";
+    size_t i = contents->slot(p);
+    user_assert(p.type() == t)
+        << "Can't set Param " << p.name() << " of type " << p.type()
+        << " to a value of type " << t << "\n";
+    memcpy(&contents->scalars[i], value, t.bytes());
+}
+
+PreparedPipeline &PreparedPipeline::set(const ImageParam &p, const Buffer<> &buf) {
+    user_assert(defined()) << "Can't set an argument of an undefined PreparedPipeline\n";
+    user_assert(buf.defined())
+        << "Can't bind an undefined Buffer to ImageParam " << p.name() << "\n";
+    user_assert(buf.type() == p.type() && buf.dimensions() == p.dimensions())
+        << "Can't bind a " << buf.dimensions() << "-dimensional Buffer of type " << buf.type()
+        << " to ImageParam " << p.name() << ", which is " << p.dimensions()
+        << "-dimensional with type " << p.type() << "\n";
+    size_t i = contents->slot(p.parameter());
+    contents->buffers[i] = buf;
+    contents->args[i] = contents->buffers[i].raw_buffer();
+    return *this;
+}
+
+void PreparedPipeline::realize(Pipeline::RealizationArg outputs) {
+    user_assert(defined()) << "Can't realize an undefined PreparedPipeline\n";
+    user_assert(outputs.size() == contents->num_outputs)
+        << "PreparedPipeline::realize was passed " << outputs.size()
+        << " output buffers, but the pipeline has " << contents->num_outputs << "\n";
+
+    // Per call, just fill in the user context and the outputs.
+    JITFuncCallContext jit_context(contents->handlers);
+    void *user_context_storage = &jit_context.jit_context;
+    contents->args[contents->user_context_slot] = &user_context_storage;
+
+    size_t arg_index = contents->state->inferred_args.size();
+    if (outputs.r) {
+        for (size_t i = 0; i < outputs.r->size(); i++) {
+            contents->args[arg_index++] = (*outputs.r)[i].raw_buffer();
+        }
+    } else if (outputs.buf) {
+        contents->args[arg_index++] = outputs.buf;
+    } else {
+        for (const Buffer<> &buffer : *outputs.buffer_list) {
+            contents->args[arg_index++] = buffer.raw_buffer();
+        }
+    }
+
+    int exit_status = contents->state->jit_module.argv_function()(contents->args.data());
+    jit_context.finish_call(*contents->state, exit_status);
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
     }
 }
 
+void Pipeline::set_lowering_prefix_cache(std::shared_ptr<LoweringPrefixCache> cache) {
+    user_assert(defined()) << "Can't set the lowering prefix cache of an undefined Pipeline.\n";
+    contents->lowering_prefixes = std::move(cache);
+}
+
 JITExtern::JITExtern(Pipeline pipeline)
     : pipeline_(pipeline) {
 }
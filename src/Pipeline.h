@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <memory>
 #include <vector>
 
 #include "AutoSchedule.h"
@@ -24,9 +25,12 @@ struct Argument;
 class Func;
 struct Outputs;
 struct PipelineContents;
+class PreparedPipeline;
 
 namespace Internal {
 class IRMutator2;
+class LoweringPrefixCache;
+struct JITCallState;
 }  // namespace Internal
 
 /**
@@ -101,6 +105,10 @@ public:
     static std::vector<Internal::JITModule> make_externs_jit_module(const Target &target,
                                                                     std::map<std::string, JITExtern> &externs_in_out);
 
+    // Get the compiled state to call the pipeline with for the given
+    // target, compiling it first if needed.
+    std::shared_ptr<const Internal::JITCallState> jit_call_state(const Target &target);
+
 public:
     /** Make an undefined Pipeline object. */
     Pipeline();
@@ -116,10 +124,18 @@ public:
     /** Get the Funcs this pipeline outputs. */
     std::vector<Func> outputs() const;
 
-    /** Generate a schedule for the pipeline. */
+    /** Generate a schedule for the pipeline. If the target has a GPU
+     * feature, the pipeline is scheduled to run on the GPU: the output
+     * of each group of Funcs is tiled across GPU blocks and threads,
+     * and the other Funcs in the group are computed per block in
+     * shared memory, or per warp in registers where the target
+     * supports warp shuffles. */
     //@{
     std::string auto_schedule(const Target &target,
                               const MachineParams &arch_params = MachineParams::generic());
+    std::string auto_schedule(const Target &target,
+                              const MachineParams &arch_params,
+                              const AutoSchedulerCostModel &cost_model);
     //@}
 
     /** Return handle to the index-th Func within the pipeline based on the
@@ -144,6 +160,19 @@ public:
                             const std::string &fn_name,
                             const Target &target = get_target_from_environment());
 
+    /** Compile a pipeline to a serialized pipeline file, with the
+     * given filename (which should probably end in .hlpipe), type
+     * signature, and function name. The file can be loaded and run
+     * later with SerializedPipeline::load, by a program that has no
+     * code describing this pipeline. The target should be one the
+     * machines that load it can run; the jit and user_context
+     * features are added to it. If you're compiling a pipeline with a
+     * single output Func, see also Func::compile_to_serialized_pipeline. */
+    void compile_to_serialized_pipeline(const std::string &filename,
+                                        const std::vector<Argument> &args,
+                                        const std::string &fn_name,
+                                        const Target &target = get_jit_target_from_environment());
+
     /** Statically compile a pipeline to llvm assembly, with the given
      * filename (which should probably end in .ll), type signature,
      * and C function name. If you're compiling a pipeline with a
@@ -209,7 +238,9 @@ public:
 
     /** Write out the loop nests specified by the schedule for this
      * Pipeline's Funcs. Helpful for understanding what a schedule is
-     * doing. */
+     * doing. If the outputs have estimates (see Func::estimate), each
+     * loop is also annotated with an estimate of the arithmetic, the
+     * memory traffic, and the working set of one run of it. */
     void print_loop_nest();
 
     /** Compile to object file and header pair, with the given
@@ -430,6 +461,14 @@ public:
                             const ParamMap &param_map = ParamMap::empty_map());
     // @}
 
+    /** JIT-compile the pipeline if needed, and return an object that
+     * calls it with a slot for each argument, initialized to the
+     * values currently bound to the Params and ImageParams. When the
+     * same pipeline is called many times, this avoids the work
+     * realize does on each call to look up the value of every
+     * argument. See PreparedPipeline. */
+    PreparedPipeline prepare(const Target &target = Target());
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -448,11 +487,70 @@ public:
      * been rescheduled. */
     void invalidate_cache();
 
+    /** Take the first half of lowering from, and add it to, the given
+     * cache instead of one private to this Pipeline, so that it can be
+     * reused by other Pipelines built from the same source. Lasts
+     * until the next invalidate_cache(). */
+    void set_lowering_prefix_cache(std::shared_ptr<Internal::LoweringPrefixCache> cache);
+
 private:
 
     std::string generate_function_name() const;
 };
 
+/** A jit-compiled Pipeline with its arguments laid out ahead of time,
+ * made by Pipeline::prepare. Argument values set on it stay bound
+ * until they are set again, so a call only writes the output buffers
+ * into place and calls the compiled code:
+ \code
+ PreparedPipeline prepared = pipeline.prepare();
+ for (Request &r : requests) {
+     prepared.set(gain, r.gain).set(input, r.input);
+     prepared.realize(r.output);
+ }
+ \endcode
+ *
+ * It keeps the code compiled at the time of the call to prepare, so
+ * it is unaffected by later changes to the Pipeline, and uses the
+ * custom handlers (error handler, allocator, etc.) set at that time.
+ * Copies of a PreparedPipeline share their argument values, so don't
+ * use one from several threads at once; call prepare again to get a
+ * separate one per thread. */
+class PreparedPipeline {
+    struct Contents;
+    std::shared_ptr<Contents> contents;
+
+    friend class Pipeline;
+
+    void set_scalar(const Internal::Parameter &p, Type t, const void *value);
+
+public:
+    /** Make an undefined PreparedPipeline. */
+    PreparedPipeline() = default;
+
+    /** Check if this object was made by Pipeline::prepare. */
+    bool defined() const {
+        return contents != nullptr;
+    }
+
+    /** Set the value of a scalar Param for subsequent calls. */
+    template<typename T>
+    PreparedPipeline &set(const Param<T> &p, T value) {
+        set_scalar(p.parameter(), type_of<T>(), &value);
+        return *this;
+    }
+
+    /** Bind a buffer to an ImageParam for subsequent calls. The
+     * buffer is kept alive until another one is bound. */
+    PreparedPipeline &set(const ImageParam &p, const Buffer<> &buf);
+
+    /** Run the pipeline into existing allocated buffers, with the
+     * currently set argument values. As with Pipeline::realize, the
+     * outputs should contain one Buffer per tuple component per
+     * output Func, and are not copied back from the GPU. */
+    void realize(Pipeline::RealizationArg outputs);
+};
+
 struct ExternSignature {
 private:
     Type ret_type_;       // Only meaningful if is_void_return is false; must be default value otherwise
@@ -8,6 +8,7 @@
 #include "Prefetch.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Substitute.h"
 #include "Util.h"
 
 namespace Halide {
@@ -60,6 +61,129 @@ public:
     }
 };
 
+// Roughly estimate the number of instructions executed by one
+// iteration of a loop body, by counting the arithmetic, memory and
+// call nodes in it, scaled by the extents of any inner loops.
+class EstimateIterationCost : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Add *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Sub *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Mul *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Div *op) override { cost += 4; IRVisitor::visit(op); }
+    void visit(const Mod *op) override { cost += 4; IRVisitor::visit(op); }
+    void visit(const Min *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Max *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Select *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Call *op) override { cost++; IRVisitor::visit(op); }
+    void visit(const Provide *op) override { cost++; IRVisitor::visit(op); }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        int64_t outer_cost = cost;
+        cost = 0;
+        op->body.accept(this);
+        // Assume a short loop if we can't tell its extent.
+        const int64_t *extent = as_const_int(op->extent);
+        cost = outer_cost + cost * (extent ? std::max<int64_t>(*extent, 1) : 8);
+    }
+
+public:
+    int64_t cost = 0;
+};
+
+// The number of iterations ahead to prefetch when no offset is
+// specified: enough iterations of the loop body to cover the
+// latency of a cache miss to memory, measured in instructions.
+Expr estimate_prefetch_distance(const Stmt &body) {
+    const int64_t miss_latency = 256;
+    const int64_t max_distance = 32;
+    EstimateIterationCost estimator;
+    body.accept(&estimator);
+    int64_t cost = std::max<int64_t>(estimator.cost, 1);
+    int64_t distance = std::min((miss_latency + cost - 1) / cost, max_distance);
+    debug(4) << "Estimated prefetch distance " << distance
+             << " for a loop body of cost " << cost << "\n";
+    return (int)distance;
+}
+
+class ContainsBufferAccess : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide || op->call_type == Call::Image) {
+            names.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> names;
+};
+
+// Find the accesses to a buffer in the body of a loop, with any lets
+// inside the body substituted in. Note whether any of them is at a
+// data-dependent site, and which sites don't depend on inner loops
+// or on anything else computed within an iteration.
+class FindPrefetchSites : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &name;
+    map<string, Expr> lets;
+    Scope<> inner_vars;
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        lets[op->name] = substitute(lets, op->value);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override { visit_let(op); }
+    void visit(const LetStmt *op) override { visit_let(op); }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        inner_vars.push(op->name);
+        op->body.accept(this);
+        inner_vars.pop(op->name);
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->name != name ||
+            (op->call_type != Call::Halide && op->call_type != Call::Image)) {
+            return;
+        }
+        vector<Expr> site;
+        ContainsBufferAccess accesses;
+        bool fixed = true;
+        for (const Expr &arg : op->args) {
+            Expr a = substitute(lets, arg);
+            a.accept(&accesses);
+            fixed = fixed && !expr_uses_vars(a, inner_vars);
+            site.push_back(a);
+        }
+        if (!accesses.names.empty()) {
+            data_dependent = true;
+        }
+        if (fixed) {
+            sites.push_back(site);
+            site_accesses.insert(accesses.names.begin(), accesses.names.end());
+        }
+    }
+
+public:
+    FindPrefetchSites(const string &n) : name(n) {}
+
+    bool data_dependent = false;
+    vector<vector<Expr>> sites;
+    // The buffers read to compute the sites.
+    set<string> site_accesses;
+};
+
 class InjectPrefetch : public IRMutator2 {
 public:
     InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers)
@@ -69,6 +193,7 @@ private:
     const map<string, Function> &env;
     const map<string, Box> &external_buffers;
     Scope<Box> buffer_bounds;
+    Scope<Interval> loop_bounds;
 
 private:
     using IRMutator2::visit;
@@ -99,15 +224,85 @@ private:
         return IRMutator2::visit(op);
     }
 
+    Stmt visit(const For *op) override {
+        ScopedBinding<Interval> bind(loop_bounds, op->name,
+                                     Interval(op->min, op->min + op->extent - 1));
+        return IRMutator2::visit(op);
+    }
+
+    // Whether a buffer can be read anywhere within the loop that
+    // contains the Prefetch being injected.
+    bool available(const string &name) {
+        return buffer_bounds.contains(name) ||
+            external_buffers.find(name) != external_buffers.end();
+    }
+
+    // Find the boxes to prefetch for the next iterations of the loop
+    // containing a Prefetch, as boxes_touched() would. If any access
+    // to the buffer is data-dependent, boxes_touched() can't bound it
+    // better than the whole buffer. In that case, compute the sites
+    // accessed one prefetch distance ahead instead, and prefetch one
+    // element at each. The returned guard then makes sure the indices
+    // are only loaded on iterations that exist.
+    vector<Box> find_prefetch_boxes(const PrefetchDirective &p, Expr fetch_at, const Stmt &body,
+                                    Expr *guard) {
+        FindPrefetchSites finder(p.name);
+        body.accept(&finder);
+
+        vector<Box> result;
+        if (!finder.data_dependent) {
+            map<string, Box> boxes_rw = boxes_touched(LetStmt::make(p.var, fetch_at, body));
+            const auto &b = boxes_rw.find(p.name);
+            if (b != boxes_rw.end()) {
+                result.push_back(b->second);
+            }
+            return result;
+        }
+
+        bool sites_available = loop_bounds.contains(p.var);
+        for (const string &n : finder.site_accesses) {
+            sites_available = sites_available && (n != p.name) && available(n);
+        }
+        if (!sites_available) {
+            user_warning << "Not prefetching " << p.name << " within loop nest of "
+                         << p.var << ", since its data-dependent accesses can't be"
+                         << " computed ahead of time.\n";
+            return result;
+        }
+
+        *guard = fetch_at <= loop_bounds.get(p.var).max;
+        for (const vector<Expr> &site : finder.sites) {
+            Box box;
+            for (const Expr &e : site) {
+                Expr ahead = simplify(substitute(p.var, fetch_at, e));
+                box.push_back(Interval(ahead, ahead));
+            }
+            result.push_back(box);
+        }
+        return result;
+    }
+
     Stmt visit(const Prefetch *op) override {
         Stmt body = mutate(op->body);
 
-        const PrefetchDirective &p = op->prefetch;
+        PrefetchDirective p = op->prefetch;
+        if (!p.offset.defined()) {
+            p.offset = estimate_prefetch_distance(body);
+        }
         Expr loop_var = Variable::make(Int(32), p.var);
 
         // Add loop variable + prefetch offset to interval scope for box computation
         Expr fetch_at = loop_var + p.offset;
-        map<string, Box> boxes_rw = boxes_touched(LetStmt::make(p.var, fetch_at, body));
+        Expr guard;
+        vector<Box> boxes = find_prefetch_boxes(p, fetch_at, body, &guard);
+
+        // The bounds of a data-dependent site contain loads, which must
+        // not be evaluated as part of the condition before the guard,
+        // so clamp the sites instead of checking them.
+        PrefetchBoundStrategy strategy = p.strategy;
+        if (guard.defined() && strategy == PrefetchBoundStrategy::GuardWithIf) {
+            strategy = PrefetchBoundStrategy::Clamp;
+        }
 
         // TODO(psuriana): Only prefetch the newly accessed data. We
         // should subtract the box accessed during previous iteration
@@ -116,16 +311,16 @@ private:
         // TODO(psuriana): Add a new PrefetchBoundStrategy::ShiftInwards
         // that shifts the base address of the prefetched box so that
         // the box is completely within the bounds.
-        const auto &b = boxes_rw.find(p.name);
-        if (b != boxes_rw.end()) {
-            Box prefetch_box = b->second;
+        Stmt result = body;
+        for (size_t k = boxes.size(); k > 0; k--) {
+            Box prefetch_box = boxes[k - 1];
             // Only prefetch the region that is in bounds.
-            Box bounds = get_buffer_bounds(b->first, b->second.size());
+            Box bounds = get_buffer_bounds(p.name, prefetch_box.size());
             internal_assert(prefetch_box.size() == bounds.size());
 
-            if (p.strategy == PrefetchBoundStrategy::Clamp) {
+            if (strategy == PrefetchBoundStrategy::Clamp) {
                 prefetch_box = box_intersection(prefetch_box, bounds);
-            } else if (p.strategy == PrefetchBoundStrategy::GuardWithIf) {
+            } else if (strategy == PrefetchBoundStrategy::GuardWithIf) {
                 Expr predicate = prefetch_box.used.defined() ? prefetch_box.used : const_true();
                 for (size_t i = 0; i < bounds.size(); ++i) {
                     predicate = predicate && (prefetch_box[i].min >= bounds[i].min) &&
@@ -133,7 +328,7 @@ private:
                 }
                 prefetch_box.used = simplify(predicate);
             } else {
-                internal_assert(p.strategy == PrefetchBoundStrategy::NonFaulting);
+                internal_assert(strategy == PrefetchBoundStrategy::NonFaulting);
                 // Assume the prefetch won't fault when accessing region
                 // outside the bounds.
             }
@@ -144,16 +339,19 @@ private:
                 Expr extent = prefetch_box[i].max - prefetch_box[i].min + 1;
                 new_bounds.push_back(Range(simplify(prefetch_box[i].min), simplify(extent)));
             }
-            Expr condition = op->condition;
+            Expr condition = guard.defined() ? simplify(op->condition && guard) : op->condition;
             if (prefetch_box.maybe_unused()) {
                 condition = simplify(prefetch_box.used && condition);
             }
             internal_assert(!new_bounds.empty());
-            return Prefetch::make(op->name, op->types, new_bounds, op->prefetch, condition, std::move(body));
+            result = Prefetch::make(op->name, op->types, new_bounds, p, condition, std::move(result));
+        }
+        if (!boxes.empty()) {
+            return result;
         }
 
         if (!body.same_as(op->body)) {
-            return Prefetch::make(op->name, op->types, op->bounds, op->prefetch, op->condition, std::move(body));
+            return Prefetch::make(op->name, op->types, op->bounds, p, op->condition, std::move(body));
         } else if (op->bounds.empty()) {
             // Remove the Prefetch IR since it is prefetching an empty region
             user_warning << "Removing prefetch of " << p.name
@@ -238,7 +436,7 @@ class ReducePrefetchDimension : public IRMutator2 {
         // the dimensions with larger strides and keep the smaller ones in
         // the prefetch call.
 
-        size_t max_arg_size = 2 + 2 * max_dim; // Prefetch: {base, offset, extent0, stride0, extent1, stride1, ...}
+        size_t max_arg_size = 3 + 2 * max_dim; // Prefetch: {base, offset, locality, extent0, stride0, extent1, stride1, ...}
         if (call && call->is_intrinsic(Call::prefetch) && (call->args.size() > max_arg_size)) {
             const Variable *base = call->args[0].as<Variable>();
             internal_assert(base && base->type.is_handle());
@@ -247,7 +445,7 @@ class ReducePrefetchDimension : public IRMutator2 {
             Expr new_offset = call->args[1];
             for (size_t i = max_arg_size; i < call->args.size(); i += 2) {
                 Expr stride = call->args[i+1];
-                string index_name = "prefetch_reduce_" + base->name + "." + std::to_string((i-1)/2);
+                string index_name = "prefetch_reduce_" + base->name + "." + std::to_string((i-3)/2);
                 index_names.push_back(index_name);
                 new_offset += Variable::make(Int(32), index_name) * stride;
             }
@@ -259,7 +457,7 @@ class ReducePrefetchDimension : public IRMutator2 {
 
             stmt = Evaluate::make(Call::make(call->type, Call::prefetch, args, Call::Intrinsic));
             for (size_t i = 0; i < index_names.size(); ++i) {
-                stmt = For::make(index_names[i], 0, call->args[(i+max_dim)*2 + 2],
+                stmt = For::make(index_names[i], 0, call->args[(i+max_dim)*2 + 3],
                                  ForType::Serial, DeviceAPI::None, stmt);
             }
             debug(5) << "\nReduce prefetch to " << max_dim << " dim:\n"
@@ -295,12 +493,12 @@ class SplitPrefetch : public IRMutator2 {
             vector<string> index_names;
             vector<Expr> extents;
             Expr new_offset = call->args[1];
-            for (size_t i = 2; i < call->args.size(); i += 2) {
+            for (size_t i = 3; i < call->args.size(); i += 2) {
                 Expr extent = call->args[i];
                 Expr stride = call->args[i+1];
                 Expr stride_bytes = stride * elem_size;
 
-                string index_name = "prefetch_split_" + base->name + "." + std::to_string((i-1)/2);
+                string index_name = "prefetch_split_" + base->name + "." + std::to_string((i-3)/2);
                 index_names.push_back(index_name);
 
                 Expr is_negative_stride = (stride < 0);
@@ -320,7 +518,7 @@ class SplitPrefetch : public IRMutator2 {
                 extents.push_back(outer_extent);
             }
 
-            vector<Expr> args = {base, new_offset, Expr(1), simplify(max_byte_size / elem_size)};
+            vector<Expr> args = {base, new_offset, call->args[2], Expr(1), simplify(max_byte_size / elem_size)};
             stmt = Evaluate::make(Call::make(call->type, Call::prefetch, args, Call::Intrinsic));
             for (size_t i = 0; i < index_names.size(); ++i) {
                 stmt = For::make(index_names[i], 0, extents[i],
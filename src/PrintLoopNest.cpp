@@ -1,33 +1,276 @@
 #include "PrintLoopNest.h"
+#include "AllocationBoundsInference.h"
+#include "AutoScheduleUtils.h"
+#include "Bounds.h"
+#include "BoundsInference.h"
 #include "FindCalls.h"
 #include "Func.h"
 #include "Function.h"
+#include "IRMutator.h"
 #include "IRPrinter.h"
 #include "RealizationOrder.h"
+#include "RegionCosts.h"
 #include "ScheduleFunctions.h"
 #include "Simplify.h"
 #include "SimplifySpecializations.h"
 #include "Target.h"
+#include "UniquifyVariableNames.h"
 #include "WrapCalls.h"
 
+#include <algorithm>
+#include <cctype>
 #include <tuple>
 
 namespace Halide {
 namespace Internal {
 
 using std::map;
+using std::set;
 using std::string;
 using std::vector;
 
+namespace {
+
+// The estimated cost of one complete run of a loop.
+struct LoopCost {
+    // Arithmetic ops, as counted by RegionCosts.
+    Expr ops;
+    // Bytes loaded and stored.
+    Expr loaded, stored;
+    // Bytes of storage allocated inside one iteration of the loop.
+    Expr working_set;
+};
+
+// Replace the min and extent of each output buffer with the
+// estimates given on the output Func.
+class SubstituteOutputEstimates : public IRMutator2 {
+    map<string, Expr> estimates;
+
+    using IRMutator2::visit;
+
+    Expr visit(const Variable *op) override {
+        auto it = estimates.find(op->name);
+        return it == estimates.end() ? op : it->second;
+    }
+
+public:
+    SubstituteOutputEstimates(const vector<Function> &outputs) {
+        for (const Function &out : outputs) {
+            string buffer_name = out.name();
+            if (out.outputs() > 1) {
+                buffer_name += ".0";
+            }
+            for (int d = 0; d < out.dimensions(); d++) {
+                // If there are duplicates, use the most recent estimate.
+                for (const Bound &b : out.schedule().estimates()) {
+                    if (b.var == out.args()[d]) {
+                        estimates[buffer_name + ".min." + std::to_string(d)] = b.min;
+                        estimates[buffer_name + ".extent." + std::to_string(d)] = b.extent;
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Add up the RegionCosts estimates of every Provide inside each loop,
+// multiplied out by the loop extents.
+class EstimateLoopCosts : public IRVisitor {
+    RegionCosts costs;
+    set<string> inlines;
+    map<std::pair<string, int>, Cost> stage_costs;
+    // The costs of the part of the Stmt visited so far.
+    LoopCost current;
+    // The stage number of the innermost enclosing loop of each Func.
+    map<string, vector<int>> stages;
+
+    using IRVisitor::visit;
+
+    static Expr add(const Expr &a, const Expr &b) {
+        if (!a.defined() || !b.defined()) return Expr();
+        return simplify(a + b);
+    }
+
+    // The Func and stage a loop belongs to. Loops are named
+    // func.s<stage>.var...
+    static std::pair<string, int> stage_of_loop(const string &name) {
+        vector<string> parts = split_string(name, ".");
+        string func = parts[0];
+        for (size_t i = 1; i < parts.size(); i++) {
+            const string &p = parts[i];
+            if (p.size() > 1 && p[0] == 's' &&
+                std::all_of(p.begin() + 1, p.end(), ::isdigit)) {
+                return {func, std::atoi(p.c_str() + 1)};
+            }
+            func += "." + p;
+        }
+        return {"", -1};
+    }
+
+    void visit(const For *op) override {
+        LoopCost outer = current;
+        current = LoopCost{make_zero(Int(64)), make_zero(Int(64)), make_zero(Int(64)), make_zero(Int(64))};
+
+        string func;
+        int stage;
+        std::tie(func, stage) = stage_of_loop(op->name);
+        if (stage >= 0) {
+            stages[func].push_back(stage);
+        }
+        op->body.accept(this);
+        if (stage >= 0) {
+            stages[func].pop_back();
+        }
+
+        Expr extent = cast<int64_t>(op->extent);
+        LoopCost &c = result[op->name];
+        Expr ops = current.ops.defined() ? simplify(current.ops * extent) : Expr();
+        Expr loaded = current.loaded.defined() ? simplify(current.loaded * extent) : Expr();
+        Expr stored = current.stored.defined() ? simplify(current.stored * extent) : Expr();
+        // The same loop may appear more than once, e.g. in
+        // specializations. Report the largest.
+        if (!c.ops.defined() || (is_const(ops) && can_prove(ops > c.ops))) {
+            c = LoopCost{ops, loaded, stored, current.working_set};
+        }
+        current = LoopCost{add(outer.ops, ops), add(outer.loaded, loaded),
+                           add(outer.stored, stored), outer.working_set};
+    }
+
+    void visit(const Provide *op) override {
+        int stage = 0;
+        auto it = stages.find(op->name);
+        if (it != stages.end() && !it->second.empty()) {
+            stage = it->second.back();
+        }
+        auto key = std::make_pair(op->name, stage);
+        auto c = stage_costs.find(key);
+        if (c == stage_costs.end()) {
+            auto f = costs.env.find(op->name);
+            Cost cost;
+            if (f != costs.env.end()) {
+                cost = costs.get_func_stage_cost(f->second, stage, inlines);
+                cost.simplify();
+            }
+            c = stage_costs.emplace(key, cost).first;
+        }
+        int stored = 0;
+        for (const Expr &v : op->values) {
+            stored += v.type().bytes();
+        }
+        if (c->second.defined()) {
+            // RegionCosts counts the store as part of the memory cost.
+            current.ops = add(current.ops, cast<int64_t>(c->second.arith));
+            current.loaded = add(current.loaded, cast<int64_t>(c->second.memory) - stored);
+        } else {
+            current.ops = current.loaded = Expr();
+        }
+        current.stored = add(current.stored, make_const(Int(64), stored));
+    }
+
+    void visit(const Realize *op) override {
+        Expr size = make_const(Int(64), 0);
+        for (Type t : op->types) {
+            size += t.bytes();
+        }
+        for (const Range &r : op->bounds) {
+            size *= cast<int64_t>(r.extent);
+        }
+        current.working_set = add(current.working_set, size);
+        op->body.accept(this);
+    }
+
+public:
+    map<string, LoopCost> result;
+
+    EstimateLoopCosts(const map<string, Function> &env) : costs(env) {
+        for (const auto &f : env) {
+            if (f.second.schedule().compute_level().is_inlined()) {
+                inlines.insert(f.first);
+            }
+        }
+    }
+};
+
+bool has_estimates(const vector<Function> &outputs) {
+    for (const Function &out : outputs) {
+        for (const string &arg : out.args()) {
+            bool found = false;
+            for (const Bound &b : out.schedule().estimates()) {
+                found |= (b.var == arg && b.min.defined() && b.extent.defined());
+            }
+            if (!found) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Run bounds inference on the scheduled Stmt with the estimates given
+// on the outputs and inputs, and then estimate the cost of each loop.
+map<string, LoopCost> estimate_loop_costs(Stmt s,
+                                          const vector<Function> &outputs,
+                                          const vector<string> &order,
+                                          const vector<vector<string>> &fused_groups,
+                                          const map<string, Function> &env,
+                                          const Target &target) {
+    FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
+    s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, target);
+    s = allocation_bounds_inference(s, env, func_bounds);
+    s = uniquify_variable_names(s);
+    s = SubstituteOutputEstimates(outputs).mutate(s);
+    s = subsitute_var_estimates(s);
+
+    EstimateLoopCosts estimate(env);
+    s.accept(&estimate);
+    return estimate.result;
+}
+
+}  // namespace
+
 class PrintLoopNest : public IRVisitor {
 public:
-    PrintLoopNest(std::ostream &output, const map<string, Function> &e) :
-        out(output), env(e), indent(0) {}
+    PrintLoopNest(std::ostream &output, const map<string, Function> &e,
+                  const map<string, LoopCost> &c) :
+        out(output), env(e), costs(c), indent(0) {}
 private:
     std::ostream &out;
     const map<string, Function> &env;
+    const map<string, LoopCost> &costs;
     int indent;
 
+    void print_bytes(const Expr &e) {
+        const int64_t *b = as_const_int(e);
+        if (!b) {
+            out << "?";
+        } else if (*b >= (1 << 20)) {
+            out << (*b >> 20) << "MB";
+        } else if (*b >= (1 << 10)) {
+            out << (*b >> 10) << "KB";
+        } else {
+            out << *b << "B";
+        }
+    }
+
+    void print_cost(const string &loop) {
+        auto it = costs.find(loop);
+        if (it == costs.end()) return;
+        const LoopCost &c = it->second;
+        const int64_t *ops = as_const_int(c.ops);
+        out << "  // ops: ";
+        if (ops) {
+            out << *ops;
+        } else {
+            out << "?";
+        }
+        out << ", loaded: ";
+        print_bytes(c.loaded);
+        out << ", stored: ";
+        print_bytes(c.stored);
+        out << ", working set: ";
+        print_bytes(c.working_set);
+    }
+
     Scope<Expr> constants;
 
     using IRVisitor::visit;
@@ -100,7 +343,9 @@ private:
 
         out << op->device_api;
 
-        out << ":\n";
+        out << ":";
+        print_cost(op->name);
+        out << "\n";
         indent += 2;
         op->body.accept(this);
         indent -= 2;
@@ -198,9 +443,16 @@ string print_loop_nest(const vector<Function> &output_funcs) {
     // Schedule the functions.
     Stmt s = schedule_functions(outputs, fused_groups, env, target, any_memoized);
 
+    // If the outputs carry estimates, annotate each loop with an
+    // estimate of its cost.
+    map<string, LoopCost> costs;
+    if (has_estimates(outputs)) {
+        costs = estimate_loop_costs(s, outputs, order, fused_groups, env, target);
+    }
+
     // Now convert that to pseudocode
     std::ostringstream sstr;
-    PrintLoopNest pln(sstr, env);
+    PrintLoopNest pln(sstr, env, costs);
     s.accept(&pln);
     return sstr.str();
 }
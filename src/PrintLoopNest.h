@@ -16,7 +16,10 @@ class Function;
 
 /** Emit some simple pseudocode that shows the structure of the loop
  * nest specified by this pipeline's schedule, and the schedules of
- * the functions it uses. */
+ * the functions it uses. If every output has estimates on all of its
+ * dimensions, each loop is annotated with the arithmetic ops, bytes
+ * loaded and stored, and storage allocated per iteration that the
+ * auto-scheduler's cost model estimates for one full run of it. */
 std::string print_loop_nest(const std::vector<Function> &output_funcs);
 
 }  // namespace Internal
@@ -230,6 +230,24 @@ private:
             Evaluate::make(Call::make(Int(32), "halide_profiler_decr_active_threads",
                                       {state}, Call::Extern));
 
+        // Each task of a parallel loop on the host also claims a
+        // slot recording which func it is working on, so that the
+        // profiler can attribute time to each thread separately.
+        bool track_tasks = (op->is_parallel() &&
+                            (op->device_api == DeviceAPI::None ||
+                             op->device_api == DeviceAPI::Host));
+        Expr token = Variable::make(Int(32), "profiler_token");
+
+        if (track_tasks) {
+            string slot_name = unique_name("profiler_task_slot");
+            Expr slot = Variable::make(Int(32), slot_name);
+            Expr enter_task = Call::make(Int(32), "halide_profiler_enter_task",
+                                         {state, token, stack.back()}, Call::Extern);
+            Stmt leave_task = Evaluate::make(Call::make(Int(32), "halide_profiler_leave_task",
+                                                        {state, slot}, Call::Extern));
+            body = LetStmt::make(slot_name, enter_task, Block::make(body, leave_task));
+        }
+
         if (update_active_threads) {
             body = Block::make({incr_active_threads, body, decr_active_threads});
         }
@@ -260,6 +278,16 @@ private:
 
         Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
 
+        if (track_tasks) {
+            Stmt enter_loop =
+                Evaluate::make(Call::make(Int(32), "halide_profiler_enter_parallel_loop",
+                                          {state}, Call::Extern));
+            Stmt leave_loop =
+                Evaluate::make(Call::make(Int(32), "halide_profiler_leave_parallel_loop",
+                                          {state}, Call::Extern));
+            stmt = Block::make({enter_loop, stmt, leave_loop});
+        }
+
         if (update_active_threads) {
             stmt = Block::make({decr_active_threads, stmt, incr_active_threads});
         }
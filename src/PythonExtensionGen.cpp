@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -75,50 +76,79 @@ static bool can_convert(const LoweredArgument* arg) {
   return true;
 }
 
-std::pair<string, string> print_type(const LoweredArgument* arg) {
+// The C type to hold a converted argument in.
+static string c_type(const LoweredArgument* arg) {
     // Excluded by can_convert() above:
     assert(!arg->type.is_vector());
 
     if (arg->type.is_handle()) {
         /* Handles can be any pointer. However, from Python, all you can pass to
          * a function is a PyObject*, so we can restrict to that. */
-        return std::make_pair("O", "PyObject*");
+        return "PyObject*";
     } else if (arg->is_buffer()) {
-        return std::make_pair("O", "PyObject*");
+        return "halide_buffer_t";
     } else if (arg->type.is_float() && arg->type.bits() == 32) {
-        return std::make_pair("f", "float");
+        return "float";
     } else if (arg->type.is_float() && arg->type.bits() == 64) {
-        return std::make_pair("d", "double");
+        return "double";
     } else if (arg->type.bits() == 1) {
-        // "b" expects an unsigned char, so we assume that bool == uint8.
-        return std::make_pair("b", "bool");
+        return "bool";
     } else if (arg->type.is_int() && arg->type.bits() == 64) {
-        return std::make_pair("L", "long long");
+        return "long long";
     } else if (arg->type.is_uint() && arg->type.bits() == 64) {
-        return std::make_pair("K", "unsigned long long");
+        return "unsigned long long";
     } else if (arg->type.is_int()) {
-        return std::make_pair("i", "int");
-    } else if (arg->type.is_uint()) {
-        return std::make_pair("I", "unsigned int");
+        return "int";
     } else {
-        return std::make_pair("E", "unknown type");
+        return "unsigned int";
     }
 }
 
-void PythonExtensionGen::convert_buffer(string name, const LoweredArgument* arg) {
+void PythonExtensionGen::convert_scalar(string name, int index, const LoweredArgument* arg) {
+    const string py_arg = "py_args[" + std::to_string(index) + "]";
+    const Type &t = arg->type;
+    if (t.is_handle()) {
+        dest << "    arg_" << name << " = " << py_arg << ";\n";
+        return;
+    }
+    dest << "    {\n";
+    if (t.bits() == 1) {
+        dest << "        int v = PyObject_IsTrue(" << py_arg << ");\n";
+        dest << "        if (v < 0) {\n";
+    } else if (t.is_float()) {
+        dest << "        double v;\n";
+        dest << "        if (_convert_py_float(" << py_arg << ", &v, \"" << name << "\") < 0) {\n";
+    } else if (t.is_int()) {
+        const string min = t.bits() == 64 ? "LLONG_MIN" : std::to_string(t.min().as<IntImm>()->value) + "LL";
+        const string max = t.bits() == 64 ? "LLONG_MAX" : std::to_string(t.max().as<IntImm>()->value) + "LL";
+        dest << "        long long v;\n";
+        dest << "        if (_convert_py_int(" << py_arg << ", " << min << ", " << max
+             << ", &v, \"" << name << "\") < 0) {\n";
+    } else {
+        const string max = t.bits() == 64 ? "ULLONG_MAX" : std::to_string(t.max().as<UIntImm>()->value) + "ULL";
+        dest << "        unsigned long long v;\n";
+        dest << "        if (_convert_py_uint(" << py_arg << ", " << max << ", &v, \"" << name << "\") < 0) {\n";
+    }
+    dest << "            goto release;\n";
+    dest << "        }\n";
+    dest << "        arg_" << name << " = (" << c_type(arg) << ")v;\n";
+    dest << "    }\n";
+}
+
+void PythonExtensionGen::convert_buffer(const string &basename, string name, int index, const LoweredArgument* arg) {
     assert(arg->is_buffer());
     assert(arg->dimensions);
-    dest << "    halide_buffer_t buffer_" << name << ";\n";
-    dest << "    halide_dimension_t dimensions_" << name << "[" << (int)arg->dimensions << "];\n";
     dest << "    if (_convert_py_buffer_to_halide(";
-    dest << /*pyobj*/ "py_" << name << ", ";
+    dest << /*pyobj*/ "py_args[" << index << "], ";
     dest << /*dimensions*/ (int)arg->dimensions << ", ";
     dest << /*flags*/ (arg->is_output() ? "PyBUF_WRITABLE" : "0") << ", ";
     dest << /*dim*/ "dimensions_" << name << ", ";
-    dest << /*out*/ "&buffer_" << name << ", ";
+    dest << /*type*/ "&_type_" << basename << "_" << name << ", ";
+    dest << /*out*/ "&arg_" << name << ", ";
+    dest << /*buf*/ "&view_" << name << ", ";
     dest << /*name*/ "\"" << name << "\"";
     dest << ") < 0) {\n";
-    dest << "        return NULL;\n";
+    dest << "        goto release;\n";
     dest << "    }\n";
 }
 
@@ -141,6 +171,13 @@ void PythonExtensionGen::compile(const Module &module) {
 #    define HALIDE_PYTHON_EXPORT __attribute__((visibility("default")))
 #endif
 
+/* Python 3.7 and up can pass the arguments without packing them into a tuple. */
+#if PY_VERSION_HEX >= 0x03070000
+#    define HALIDE_PYTHON_CALL_FLAGS (METH_FASTCALL|METH_KEYWORDS)
+#else
+#    define HALIDE_PYTHON_CALL_FLAGS (METH_VARARGS|METH_KEYWORDS)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -148,16 +185,18 @@ extern "C" {
 static __attribute__((unused)) int _convert_py_buffer_to_halide(
         PyObject* pyobj, int dimensions, int flags,
         halide_dimension_t* dim,  // array of size `dimensions`
-        halide_buffer_t* out, const char* name) {
-    Py_buffer buf;
+        const struct halide_type_t* type,  // the type the pipeline expects
+        halide_buffer_t* out, Py_buffer* buf, const char* name) {
+    /* The halide_buffer_t points into the memory of the Python object,
+     * which must stay valid until the caller releases buf. */
     int ret = PyObject_GetBuffer(
-      pyobj, &buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | PyBUF_ANY_CONTIGUOUS | flags);
+      pyobj, buf, PyBUF_FORMAT | PyBUF_STRIDED_RO | flags);
     if (ret < 0) {
       return ret;
     }
-    if (dimensions && buf.ndim != dimensions) {
+    if (dimensions && buf->ndim != dimensions) {
       PyErr_Format(PyExc_ValueError, "Invalid argument %s: Expected %d dimensions, got %d",
-                   name, dimensions, buf.ndim);
+                   name, dimensions, buf->ndim);
       return -1;
     }
     /* We'll get a buffer that's either:
@@ -167,45 +206,65 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
      * needs. It can can be achieved in numpy by passing order='F' during array
      * creation. However, if we do get a C_CONTIGUOUS buffer, flip the dimensions
      * (transpose) so we can process it without having to reallocate.
+     * Other strided buffers (e.g. slices of an array) are used in place too,
+     * and are flipped if their strides shrink from first to last dimension,
+     * as a slice of a C_CONTIGUOUS array's do.
      */
     int i, j, j_step;
-    if (PyBuffer_IsContiguous(&buf, 'F')) {
+    int contiguous = 1;
+    if (PyBuffer_IsContiguous(buf, 'F')) {
       j = 0;
       j_step = 1;
-    } else if (PyBuffer_IsContiguous(&buf, 'C')) {
-      j = buf.ndim - 1;
+    } else if (PyBuffer_IsContiguous(buf, 'C')) {
+      j = buf->ndim - 1;
       j_step = -1;
     } else {
-      /* Python checks all dimensions and strides, so this typically indicates
-       * a bug in the array's buffer protocol. */
-      PyErr_Format(PyExc_ValueError, "Invalid buffer: neither C nor Fortran contiguous");
-      return -1;
+      Py_ssize_t first = buf->strides[0], last = buf->strides[buf->ndim - 1];
+      contiguous = 0;
+      if ((first < 0 ? -first : first) >= (last < 0 ? -last : last)) {
+        j = buf->ndim - 1;
+        j_step = -1;
+      } else {
+        j = 0;
+        j_step = 1;
+      }
     }
-    for (i = 0; i < buf.ndim; ++i, j += j_step) {
-        dim[i].min = 0;
-        dim[i].stride = (int)(buf.strides[j] / buf.itemsize); // strides is in bytes
-        dim[i].extent = (int)buf.shape[j];
-        dim[i].flags = 0;
-        if (buf.suboffsets && buf.suboffsets[i] >= 0) {
+    for (i = 0; i < buf->ndim; ++i, j += j_step) {
+        if (buf->suboffsets && buf->suboffsets[j] >= 0) {
             // Halide doesn't support arrays of pointers. But we should never see this
             // anyway, since we specified PyBUF_STRIDED.
             PyErr_Format(PyExc_ValueError, "Invalid buffer: suboffsets not supported");
             return -1;
         }
+        if (buf->strides[j] % buf->itemsize != 0) {
+            PyErr_Format(PyExc_ValueError, "Invalid argument %s: strides must be a multiple of the element size", name);
+            return -1;
+        }
+        if (buf->shape[j] > INT_MAX ||
+            buf->strides[j] / buf->itemsize > INT_MAX ||
+            buf->strides[j] / buf->itemsize < INT_MIN) {
+            PyErr_Format(PyExc_ValueError, "Invalid argument %s: too large for a halide_buffer_t", name);
+            return -1;
+        }
+        dim[i].min = 0;
+        dim[i].stride = (int)(buf->strides[j] / buf->itemsize); // strides is in bytes
+        dim[i].extent = (int)buf->shape[j];
+        dim[i].flags = 0;
     }
-    if (dim[buf.ndim - 1].extent * dim[buf.ndim - 1].stride * buf.itemsize != buf.len) {
+    if (contiguous && buf->ndim > 0 &&
+        dim[buf->ndim - 1].extent * dim[buf->ndim - 1].stride * buf->itemsize != buf->len) {
         PyErr_Format(PyExc_ValueError, "Invalid buffer: length %ld, but computed length %ld",
-                     buf.len, buf.shape[0] * buf.strides[0]);
+                     buf->len, buf->shape[0] * buf->strides[0]);
         return -1;
     }
     memset(out, 0, sizeof(*out));
-    if (!buf.format) {
+    if (!buf->format) {
         out->type.code = halide_type_uint;
         out->type.bits = 8;
     } else {
         /* Convert struct type code. See
          * https://docs.python.org/2/library/struct.html#module-struct */
-        char* p = buf.format;
+        char* p = buf->format;
         while (strchr("@<>!=", *p)) {
             p++;  // ignore little/bit endian (and alignment)
         }
@@ -221,20 +280,126 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
         }
         const char* type_codes = "bB?hHiIlLqQfd";  // integers and floats
         if (strchr(type_codes, *p)) {
-            out->type.bits = buf.itemsize * 8;
+            out->type.bits = buf->itemsize * 8;
         } else {
             // We don't handle 's' and 'p' (char[]) and 'P' (void*)
-            PyErr_Format(PyExc_ValueError, "Invalid data type for %s: %s", name, buf.format);
+            PyErr_Format(PyExc_ValueError, "Invalid data type for %s: %s", name, buf->format);
             return -1;
         }
     }
     out->type.lanes = 1;
-    out->dimensions = buf.ndim;
+    if (out->type.code != type->code || out->type.bits != type->bits) {
+        PyErr_Format(PyExc_ValueError, "Invalid argument %s: expected elements of type code %d with %d bits, got %s",
+                     name, (int)type->code, (int)type->bits, buf->format ? buf->format : "B");
+        return -1;
+    }
+    out->dimensions = buf->ndim;
     out->dim = dim;
-    out->host = (uint8_t*)buf.buf;
+    out->host = (uint8_t*)buf->buf;
+    return 0;
+}
+
+/* The scalar arguments are converted directly, rather than through
+ * PyArg_ParseTupleAndKeywords, which is slow next to a small pipeline. */
+static __attribute__((unused)) int _convert_py_int(
+        PyObject* obj, long long min, long long max, long long* out, const char* name) {
+    long long v;
+    if (PyFloat_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "Invalid argument %s: expected an integer", name);
+        return -1;
+    }
+    v = PyLong_AsLongLong(obj);
+    if (v == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (v < min || v > max) {
+        PyErr_Format(PyExc_OverflowError, "Invalid argument %s: %lld is out of range", name, v);
+        return -1;
+    }
+    *out = v;
     return 0;
 }
 
+static __attribute__((unused)) int _convert_py_uint(
+        PyObject* obj, unsigned long long max, unsigned long long* out, const char* name) {
+    PyObject* index;
+    unsigned long long v;
+    if (PyFloat_Check(obj)) {
+        PyErr_Format(PyExc_TypeError, "Invalid argument %s: expected an integer", name);
+        return -1;
+    }
+#if PY_MAJOR_VERSION >= 3
+    index = PyNumber_Index(obj);
+#else
+    index = PyNumber_Long(obj);
+#endif
+    if (!index) {
+        return -1;
+    }
+    v = PyLong_AsUnsignedLongLong(index);
+    Py_DECREF(index);
+    if (v == (unsigned long long)-1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (v > max) {
+        PyErr_Format(PyExc_OverflowError, "Invalid argument %s: %llu is out of range", name, v);
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static __attribute__((unused)) int _convert_py_float(
+        PyObject* obj, double* out, const char* name) {
+    double v = PyFloat_AsDouble(obj);
+    if (v == -1.0 && PyErr_Occurred()) {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+#if PY_VERSION_HEX >= 0x03070000
+/* Gather the arguments of a METH_FASTCALL call in the order of kwlist. */
+static __attribute__((unused)) int _gather_py_args(
+        PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames,
+        const char** kwlist, int num_args, PyObject** out) {
+    Py_ssize_t i, num_kwargs = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    int j;
+    if (nargs > num_args) {
+        PyErr_Format(PyExc_TypeError, "Expected at most %d arguments, got %d", num_args, (int)nargs);
+        return -1;
+    }
+    for (j = 0; j < num_args; j++) {
+        out[j] = j < nargs ? args[j] : NULL;
+    }
+    for (i = 0; i < num_kwargs; i++) {
+        PyObject* key = PyTuple_GET_ITEM(kwnames, i);
+        for (j = 0; j < num_args; j++) {
+            if (PyUnicode_CompareWithASCIIString(key, kwlist[j]) == 0) {
+                break;
+            }
+        }
+        if (j == num_args) {
+            PyErr_Format(PyExc_TypeError, "Unexpected keyword argument '%U'", key);
+            return -1;
+        }
+        if (out[j]) {
+            PyErr_Format(PyExc_TypeError, "Argument '%s' given more than once", kwlist[j]);
+            return -1;
+        }
+        out[j] = args[nargs + i];
+    }
+    for (j = 0; j < num_args; j++) {
+        if (!out[j]) {
+            PyErr_Format(PyExc_TypeError, "Missing argument '%s'", kwlist[j]);
+            return -1;
+        }
+    }
+    return 0;
+}
+#endif
+
 )INLINE_CODE";
 
     for (auto &f : module.functions()) {
@@ -250,8 +415,10 @@ static __attribute__((unused)) int _convert_py_buffer_to_halide(
          * twice, once with new and once with old buffers. Ignore the latter. */
         if (!has_legacy_buffers(f)) {
             const string basename = remove_namespaces(f.name);
-            dest << "    {\"" << basename << "\", (PyCFunction)_f_" << basename
-                 << ", METH_VARARGS|METH_KEYWORDS, NULL},\n";
+            dest << "    {\"" << basename << "\", (PyCFunction)(void (*)(void))_f_" << basename
+                 << ", HALIDE_PYTHON_CALL_FLAGS, NULL},\n";
+            dest << "    {\"" << basename << "_batch\", (PyCFunction)_f_" << basename << "_batch"
+                 << ", METH_O, NULL},\n";
         }
     }
     dest << "    {0, 0, 0, NULL},  // sentinel\n";
@@ -288,70 +455,160 @@ HALIDE_PYTHON_EXPORT void init)INLINE_CODE";
 void PythonExtensionGen::compile(const LoweredFunc &f) {
     const std::vector<LoweredArgument> &args = f.args;
     const string basename = remove_namespaces(f.name);
+    const int num_args = (int)args.size();
+    // C doesn't allow arrays of size zero.
+    const int array_size = std::max(num_args, 1);
     std::vector<string> arg_names(args.size());
-    dest << "// " << f.name << "\n";
-    dest << "static PyObject* _f_" << basename << "(PyObject* module, PyObject* args, PyObject* kwargs) {\n";
+    bool convertible = true;
     for (size_t i = 0; i < args.size(); i++) {
         arg_names[i] = sanitize_name(args[i].name);
-        if (!can_convert(&args[i])) {
-            /* Some arguments can't be converted to Python yet. In those
-             * cases, just add a dummy function that always throws an
-             * Exception. */
-            // TODO: Add support for handles and vectors.
-            dest << "    PyErr_Format(PyExc_NotImplementedError, "
-                 << "\"Can't convert argument " << args[i].name << " from Python\");\n";
-            dest << "    return NULL;\n";
-            dest << "}";
-            return;
-        }
+        convertible = convertible && can_convert(&args[i]);
     }
-    dest << "    static const char* kwlist[] = {";
+
+    dest << "// " << f.name << "\n";
+    dest << "static const char* _kwlist_" << basename << "[] = {";
     for (size_t i = 0; i < args.size(); i++) {
         dest << "\"" << arg_names[i] << "\", ";
     }
     dest << "NULL};\n";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << "    " << print_type(&args[i]).second << " py_" << arg_names[i] << ";\n";
-    }
-    dest << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << print_type(&args[i]).first;
-    }
-    dest << "\", (char**)kwlist";
-    for (size_t i = 0; i < args.size(); i++) {
-        dest << ", ";
-        dest << "&py_" << arg_names[i];
-    }
-    dest << ")) {\n";
-    dest << "        return NULL;\n";
-    dest << "    }\n";
-    for (size_t i = 0; i < args.size(); i++) {
+
+    // The descriptors of the buffer arguments that don't depend on
+    // the call are made once, here.
+    for (size_t i = 0; convertible && i < args.size(); i++) {
         if (args[i].is_buffer()) {
-            convert_buffer(arg_names[i], &args[i]);
-        } else {
-            // Python already converted this.
+            dest << "static const struct halide_type_t _type_" << basename << "_" << arg_names[i]
+                 << " = {(halide_type_code_t)" << (int)args[i].type.code()
+                 << ", " << args[i].type.bits() << ", 1};\n";
         }
     }
-    dest << "    int result = " << f.name << "(";
-    for (size_t i = 0; i < args.size(); i++) {
-        if (i > 0) {
-            dest << ", ";
+
+    // Run the pipeline on one set of arguments, in the order of the
+    // keyword list.
+    dest << "static PyObject* _run_" << basename << "(PyObject* const* py_args) {\n";
+    if (!convertible) {
+        /* Some arguments can't be converted to Python yet. In those
+         * cases, just add a dummy function that always throws an
+         * Exception. */
+        // TODO: Add support for handles and vectors.
+        for (size_t i = 0; i < args.size(); i++) {
+            if (!can_convert(&args[i])) {
+                dest << "    PyErr_Format(PyExc_NotImplementedError, "
+                     << "\"Can't convert argument " << args[i].name << " from Python\");\n";
+                break;
+            }
         }
-        if (args[i].is_buffer()) {
-            dest << "&buffer_" << arg_names[i];
-        } else {
-            dest << "py_" << arg_names[i];
+        dest << "    return NULL;\n";
+        dest << "}\n";
+    } else {
+        // Everything that is cleaned up at the end is declared before
+        // the first jump there.
+        dest << "    PyObject* ret = NULL;\n";
+        dest << "    int result;\n";
+        for (size_t i = 0; i < args.size(); i++) {
+            dest << "    " << c_type(&args[i]) << " arg_" << arg_names[i] << ";\n";
+            if (args[i].is_buffer()) {
+                dest << "    Py_buffer view_" << arg_names[i] << " = {0};\n";
+                dest << "    halide_dimension_t dimensions_" << arg_names[i] << "[" << (int)args[i].dimensions << "];\n";
+            }
         }
-    }
-    dest << ");";
-    dest << R"INLINE_CODE(
+        for (size_t i = 0; i < args.size(); i++) {
+            if (args[i].is_buffer()) {
+                convert_buffer(basename, arg_names[i], (int)i, &args[i]);
+            } else {
+                convert_scalar(arg_names[i], (int)i, &args[i]);
+            }
+        }
+        // Let other Python threads run while the pipeline does. It must
+        // not call back into Python, which holds for the default runtime
+        // handlers.
+        dest << "    Py_BEGIN_ALLOW_THREADS\n";
+        dest << "    result = " << f.name << "(";
+        for (size_t i = 0; i < args.size(); i++) {
+            if (i > 0) {
+                dest << ", ";
+            }
+            dest << (args[i].is_buffer() ? "&arg_" : "arg_") << arg_names[i];
+        }
+        dest << ");\n";
+        dest << "    Py_END_ALLOW_THREADS";
+        dest << R"INLINE_CODE(
     if (result != 0) {
         /* In the optimal case, we'd be generating an exception declared
          * in python_bindings/src, but since we're self-contained,
          * we don't have access to that API. */
         PyErr_Format(PyExc_ValueError, "Halide error %d", result);
+        goto release;
+    }
+    Py_INCREF(Py_True);
+    ret = Py_True;
+release:
+)INLINE_CODE";
+        for (size_t i = 0; i < args.size(); i++) {
+            if (args[i].is_buffer()) {
+                dest << "    PyBuffer_Release(&view_" << arg_names[i] << ");\n";
+            }
+        }
+        dest << "    return ret;\n";
+        dest << "}\n";
+    }
+
+    // The entry point. Calls with all the arguments given by position,
+    // the usual case, skip the keyword handling.
+    dest << "#if PY_VERSION_HEX >= 0x03070000\n";
+    dest << "static PyObject* _f_" << basename << "(PyObject* module, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {\n";
+    dest << "    PyObject* py_args[" << array_size << "];\n";
+    dest << "    if (kwnames == NULL && nargs == " << num_args << ") {\n";
+    dest << "        return _run_" << basename << "(args);\n";
+    dest << "    }\n";
+    dest << "    if (_gather_py_args(args, nargs, kwnames, _kwlist_" << basename << ", " << num_args << ", py_args) < 0) {\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    return _run_" << basename << "(py_args);\n";
+    dest << "}\n";
+    dest << "#else\n";
+    dest << "static PyObject* _f_" << basename << "(PyObject* module, PyObject* args, PyObject* kwargs) {\n";
+    dest << "    PyObject* py_args[" << array_size << "];\n";
+    dest << "    if (kwargs == NULL && PyTuple_GET_SIZE(args) == " << num_args << ") {\n";
+    dest << "        return _run_" << basename << "(&PyTuple_GET_ITEM(args, 0));\n";
+    dest << "    }\n";
+    dest << "    if (!PyArg_ParseTupleAndKeywords(args, kwargs, \"" << string(args.size(), 'O')
+         << "\", (char**)_kwlist_" << basename;
+    for (size_t i = 0; i < args.size(); i++) {
+        dest << ", &py_args[" << i << "]";
+    }
+    dest << ")) {\n";
+    dest << "        return NULL;\n";
+    dest << "    }\n";
+    dest << "    return _run_" << basename << "(py_args);\n";
+    dest << "}\n";
+    dest << "#endif\n";
+
+    // Run the pipeline on each of a sequence of argument sets, with
+    // the arguments of each given by position.
+    dest << "static PyObject* _f_" << basename << "_batch(PyObject* module, PyObject* arg_sets) {\n";
+    dest << R"INLINE_CODE(    Py_ssize_t i, n;
+    PyObject* sets = PySequence_Fast(arg_sets, "Expected a sequence of argument sets");
+    if (!sets) {
         return NULL;
     }
+    n = PySequence_Fast_GET_SIZE(sets);
+    for (i = 0; i < n; i++) {
+        PyObject* result = NULL;
+        PyObject* set = PySequence_Fast(PySequence_Fast_GET_ITEM(sets, i), "Expected a sequence of arguments");
+        if (set && PySequence_Fast_GET_SIZE(set) != )INLINE_CODE" << num_args << R"INLINE_CODE() {
+            PyErr_Format(PyExc_TypeError, "Argument set %d has %d arguments instead of )INLINE_CODE" << num_args << R"INLINE_CODE(",
+                         (int)i, (int)PySequence_Fast_GET_SIZE(set));
+        } else if (set) {
+            result = _run_)INLINE_CODE" << basename << R"INLINE_CODE((PySequence_Fast_ITEMS(set));
+        }
+        Py_XDECREF(set);
+        if (!result) {
+            Py_DECREF(sets);
+            return NULL;
+        }
+        Py_DECREF(result);
+    }
+    Py_DECREF(sets);
     Py_INCREF(Py_True);
     return Py_True;
 )INLINE_CODE";
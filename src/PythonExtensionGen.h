@@ -19,7 +19,8 @@ public:
     void compile(const Module &module);
     void compile(const LoweredFunc &f);
 private:
-    void convert_buffer(std::string name, const LoweredArgument* arg);
+    void convert_buffer(const std::string &basename, std::string name, int index, const LoweredArgument* arg);
+    void convert_scalar(std::string name, int index, const LoweredArgument* arg);
     std::ostream &dest;
     std::string header_name;
     Target target;
@@ -175,6 +175,32 @@ RDom::RDom(const OutputImageParam &p) {
     init_vars(name);
 }
 
+SparseRDom::SparseRDom(const Buffer<> &b, std::string name) :
+    RDom({{b.dim(0).min(), b.dim(0).extent()}}, name) {
+    user_assert(b.dimensions() == 2 && b.type() == Int(32))
+        << "The coordinate list of a SparseRDom must be a two-dimensional buffer of int32\n";
+    for (int d = 0; d < b.dim(1).extent(); d++) {
+        coords.push_back(b(x, b.dim(1).min() + d));
+    }
+    domain().set_distinct_coordinates(coords);
+}
+
+SparseRDom::SparseRDom(const ImageParam &p, int num_coords, std::string name) :
+    RDom({{p.dim(0).min(), p.dim(0).extent()}}, name) {
+    user_assert(p.dimensions() == 2 && p.type() == Int(32))
+        << "The coordinate list of a SparseRDom must be a two-dimensional ImageParam of int32\n";
+    for (int d = 0; d < num_coords; d++) {
+        coords.push_back(p(x, p.dim(1).min() + d));
+    }
+    domain().set_distinct_coordinates(coords);
+}
+
+Expr SparseRDom::coordinate(int d) const {
+    user_assert(d >= 0 && d < coordinates())
+        << "SparseRDom coordinate index out of bounds: " << d << "\n";
+    return coords[d];
+}
+
 int RDom::dimensions() const {
     return (int)dom.domain().size();
 }
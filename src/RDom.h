@@ -316,6 +316,52 @@ public:
     // @}
 };
 
+/** A one-dimensional reduction domain over a compacted list of the
+ * active points of a sparse set, such as the nonzero entries of a
+ * feature map. The list is a two-dimensional int32 Buffer or
+ * ImageParam in which coords(k, d) is coordinate d of the k'th
+ * point. The reduction variable iterates over k, and \ref coordinate
+ * gives the coordinates of the current point. An update definition
+ * over a SparseRDom only visits the active points, instead of testing
+ * a predicate at every point of a dense box:
+ *
+ \code
+ ImageParam active(Int(32), 2);
+ SparseRDom r(active, 2);
+ Expr ax = r.coordinate(0), ay = r.coordinate(1);
+ f(x, y) = 0.0f;
+ f(ax, ay) = expensive(ax, ay);
+ f.update().parallel(r, 64);
+ \endcode
+ *
+ * The points in the list must be distinct. An update definition that
+ * stores to all of the coordinates, and only reads itself at the site
+ * it stores to, then writes a different site at every point, so its
+ * reduction variable may be parallelized or vectorized without
+ * allow_race_conditions(). Other sparse formats can be converted to
+ * this one before the pipeline runs: a CSR matrix by listing the
+ * column and row of each nonzero, and a bitmask by compacting the
+ * coordinates of its set bits. */
+class SparseRDom : public RDom {
+    std::vector<Expr> coords;
+
+public:
+    /** Construct a sparse reduction domain over a list of
+     * coordinates. The number of coordinates per point is the extent
+     * of the second dimension of the list. */
+    SparseRDom(const Buffer<> &coords, std::string name = "");
+
+    /** Construct a sparse reduction domain over a list of
+     * coordinates with the given number of coordinates per point. */
+    SparseRDom(const ImageParam &coords, int num_coords, std::string name = "");
+
+    /** The number of coordinates of each point. */
+    int coordinates() const {return (int)coords.size();}
+
+    /** The d'th coordinate of the current point. */
+    Expr coordinate(int d) const;
+};
+
 /** Emit an RVar in a human-readable form */
 std::ostream &operator<<(std::ostream &stream, RVar);
 
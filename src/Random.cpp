@@ -60,34 +60,108 @@ Expr rng32(Expr x) {
 
     return (((C2 * x) + C1) * x) + C0;
 }
-}
 
-Expr random_int(const vector<Expr> &e) {
-    internal_assert(e.size());
-    internal_assert(e[0].type() == Int(32) || e[0].type() == UInt(32));
-    // Permute the first term
-    Expr result = rng32(cast(UInt(32), e[0]));
-    for (size_t i = 1; i < e.size(); i++) {
-        internal_assert(e[i].type() == Int(32) || e[i].type() == UInt(32));
+// The multiplier and key increment of Philox-2x32.
+#define PHILOX_M 0xD256D193u
+#define PHILOX_W 0x9E3779B9u
+#define PHILOX_ROUNDS 10
+
+// Combine the terms that make up the key into a single 32-bit
+// word. These are usually loop invariants (the identity of the call,
+// the Func, and the seed), so this is normally lifted out of the loops.
+Expr combine_key(const vector<Expr> &terms) {
+    internal_assert(terms.size());
+    Expr result = rng32(cast(UInt(32), terms[0]));
+    for (size_t i = 1; i < terms.size(); i++) {
+        internal_assert(terms[i].type() == Int(32) || terms[i].type() == UInt(32));
         // Add in the next term and permute again
         string name = unique_name('R');
         // If it's a const, save the simplifier some work
         const uint64_t *ir = as_const_uint(result);
-        const uint64_t *ie = as_const_uint(e[i]);
+        const uint64_t *ie = as_const_uint(terms[i]);
         if (ir && ie) {
             result = rng32(make_const(UInt(32), (*ir) + (*ie)));
         } else {
-            result = Let::make(name, result + cast<uint32_t>(e[i]),
+            result = Let::make(name, result + cast<uint32_t>(terms[i]),
                                rng32(Variable::make(UInt(32), name)));
         }
     }
     return result;
 }
 
-Expr random_float(const vector<Expr> &e) {
-    Expr result = random_int(e);
+// Philox-2x32-10, from Salmon et al., "Parallel Random Numbers: As
+// Easy as 1, 2, 3" (SC 2011). It's a counter-based generator: a keyed
+// bijection of a 64-bit counter, and each of its rounds is a
+// 32x32->64 bit multiply and two xors that vectorize across
+// lanes. Ten rounds is the default of the authors' Random123
+// library, which leaves a safety margin over the round counts they
+// found to pass the BigCrush battery of TestU01. Returns the two
+// output words, wrapped in the lets the rounds need, via the callback.
+template<typename F>
+Expr philox2x32(Expr c0, Expr c1, Expr key, F make_result) {
+    vector<std::pair<string, Expr>> lets;
+    string key_name = unique_name('k');
+    lets.push_back({key_name, key});
+    Expr k = Variable::make(UInt(32), key_name);
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        string name = unique_name('p');
+        lets.push_back({name, cast(UInt(64), c0) * make_const(UInt(64), PHILOX_M)});
+        Expr p = Variable::make(UInt(64), name);
+        Expr round_key = r == 0 ? k : k + make_const(UInt(32), (uint32_t)(r * PHILOX_W));
+        Expr hi = cast(UInt(32), p >> 32);
+        Expr lo = cast(UInt(32), p);
+        c0 = hi ^ round_key ^ c1;
+        c1 = lo;
+        if (r < PHILOX_ROUNDS - 1) {
+            // Name the second word too, so that it isn't
+            // substituted into the expression for the first.
+            string c1_name = unique_name('c');
+            lets.push_back({c1_name, c1});
+            c1 = Variable::make(UInt(32), c1_name);
+        }
+    }
+    Expr result = make_result(c0, c1);
+    for (size_t i = lets.size(); i > 0; i--) {
+        result = Let::make(lets[i - 1].first, lets[i - 1].second, result);
+    }
+    return result;
+}
+
+Expr counter_word(const vector<Expr> &counter, size_t i) {
+    if (i < counter.size()) {
+        internal_assert(counter[i].type() == Int(32) || counter[i].type() == UInt(32));
+        return cast(UInt(32), counter[i]);
+    }
+    return make_zero(UInt(32));
+}
+
+// Any terms of the counter past the first two are folded into the key.
+Expr make_key(vector<Expr> key, const vector<Expr> &counter) {
+    for (size_t i = 2; i < counter.size(); i++) {
+        key.push_back(counter[i]);
+    }
+    return combine_key(key);
+}
+
+}  // namespace
+
+Expr random_uint(int bits, const vector<Expr> &key, const vector<Expr> &counter) {
+    internal_assert(bits == 8 || bits == 16 || bits == 32 || bits == 64);
+    return philox2x32(counter_word(counter, 0), counter_word(counter, 1), make_key(key, counter),
+                      [=](Expr w0, Expr w1) -> Expr {
+                          if (bits == 64) {
+                              return (cast(UInt(64), w0) << 32) | cast(UInt(64), w1);
+                          } else {
+                              // Use the high bits, which depend on more of the product.
+                              return cast(UInt(bits), w0 >> (32 - bits));
+                          }
+                      });
+}
+
+Expr random_float(const vector<Expr> &key, const vector<Expr> &counter) {
+    Expr result = random_uint(32, key, counter);
     // Set the exponent to one, and fill the mantissa with 23 random bits.
-    result = (127 << 23) | (cast<uint32_t>(result) >> 9);
+    result = (127 << 23) | (result >> 9);
     // The clamp is purely for the benefit of bounds inference.
     return clamp(reinterpret(Float(32), result) - 1.0f, 0.0f, 1.0f);
 }
@@ -97,16 +171,20 @@ class LowerRandom : public IRMutator2 {
 
     Expr visit(const Call *op) override {
         if (op->is_intrinsic(Call::random)) {
-            vector<Expr> args = op->args;
-            args.insert(args.end(), extra_args.begin(), extra_args.end());
+            // The seed and the identity of the call and the Func make
+            // up the key, and the free vars the counter.
+            vector<Expr> key = op->args;
+            key.push_back(tag);
             if (op->type == Float(32)) {
-                return random_float(args);
+                return random_float(key, counter);
             } else if (op->type == Int(32)) {
-                return cast<int32_t>(random_int(args));
-            } else if (op->type == UInt(32)) {
-                return random_int(args);
+                return cast<int32_t>(random_uint(32, key, counter));
+            } else if (op->type.is_uint() &&
+                       (op->type.bits() == 8 || op->type.bits() == 16 ||
+                        op->type.bits() == 32 || op->type.bits() == 64)) {
+                return random_uint(op->type.bits(), key, counter);
             } else {
-                internal_error << "The intrinsic random() returns an Int(32), UInt(32) or a Float(32).\n";
+                internal_error << "The intrinsic random() returns an Int(32), a UInt of 8, 16, 32 or 64 bits, or a Float(32).\n";
                 return Expr();
             }
         } else {
@@ -114,14 +192,14 @@ class LowerRandom : public IRMutator2 {
         }
     }
 
-    vector<Expr> extra_args;
+    int tag;
+    vector<Expr> counter;
 
 public:
-    LowerRandom(const vector<string> &free_vars, int tag) {
-        extra_args.push_back(tag);
+    LowerRandom(const vector<string> &free_vars, int tag) : tag(tag) {
         for (size_t i = 0; i < free_vars.size(); i++) {
             internal_assert(!free_vars[i].empty());
-            extra_args.push_back(Variable::make(Int(32), free_vars[i]));
+            counter.push_back(Variable::make(Int(32), free_vars[i]));
         }
     }
 };
@@ -11,14 +11,18 @@
 namespace Halide {
 namespace Internal {
 
-/** Return a random floating-point number between zero and one that
- * varies deterministically based on the input expressions. */
-Expr random_float(const std::vector<Expr> &);
-
-/** Return a random unsigned integer between zero and 2^32-1 that
- * varies deterministically based on the input expressions (which must
- * be integers or unsigned integers). */
-Expr random_int(const std::vector<Expr> &);
+/** Return a random unsigned integer with the given number of bits (8,
+ * 16, 32 or 64) that varies deterministically based on the input
+ * expressions, which must be 32-bit integers or unsigned integers. The
+ * generator is Philox-2x32-10: the first two counter terms are the
+ * 64-bit counter it permutes, and the key terms (along with any
+ * further counter terms) are hashed into its key. It's a bijection of
+ * the counter for a given key, so distinct counters never collide. */
+Expr random_uint(int bits, const std::vector<Expr> &key, const std::vector<Expr> &counter);
+
+/** Return a random floating-point number between zero and one made
+ * from the 23 high bits of random_uint(32, key, counter). */
+Expr random_float(const std::vector<Expr> &key, const std::vector<Expr> &counter);
 
 /** Convert calls to random() to IR generated by random_float and
  * random_int. Tags all calls with the variables in free_vars, and the
@@ -190,10 +190,89 @@ void check_no_cyclic_compute_with(const map<string, vector<FusedPair>> &fused_pa
     }
 }
 
+// Reorder the fused groups, keeping the producers of each group ahead
+// of it, to keep as few Funcs alive at once as possible. This is a
+// greedy list schedule: of the groups whose producers have all been
+// realized, pick the one that lets the most Funcs die (because it's
+// their last consumer), less the Funcs it makes alive. Ties go to the
+// group that is first in the depth-first order, so pipelines where
+// there's no choice to be made are left alone.
+void minimize_live_funcs(vector<vector<string>> &group_order,
+                         vector<string> &group_names,
+                         const map<string, vector<string>> &graph,
+                         const map<string, string> &group_name) {
+    const size_t n = group_order.size();
+    map<string, size_t> index;
+    for (size_t i = 0; i < n; i++) {
+        index[group_names[i]] = i;
+    }
+
+    vector<set<size_t>> producers(n), consumers(n);
+    for (size_t i = 0; i < n; i++) {
+        for (const string &callee : graph.at(group_names[i])) {
+            auto iter = index.find(group_name.at(callee));
+            if (iter != index.end() && iter->second != i) {
+                producers[i].insert(iter->second);
+                consumers[iter->second].insert(i);
+            }
+        }
+    }
+
+    vector<size_t> waiting_on(n), remaining_consumers(n);
+    for (size_t i = 0; i < n; i++) {
+        waiting_on[i] = producers[i].size();
+        remaining_consumers[i] = consumers[i].size();
+    }
+
+    vector<bool> done(n, false);
+    vector<size_t> schedule;
+    while (schedule.size() < n) {
+        int best = -1, best_score = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (done[i] || waiting_on[i] > 0) {
+                continue;
+            }
+            int score = 0;
+            for (size_t p : producers[i]) {
+                if (remaining_consumers[p] == 1) {
+                    score += (int)group_order[p].size();
+                }
+            }
+            if (!consumers[i].empty()) {
+                score -= (int)group_order[i].size();
+            }
+            if (best < 0 || score > best_score) {
+                best = (int)i;
+                best_score = score;
+            }
+        }
+        internal_assert(best >= 0) << "Stuck in a loop computing a realization order.\n";
+
+        done[best] = true;
+        schedule.push_back(best);
+        for (size_t p : producers[best]) {
+            remaining_consumers[p]--;
+        }
+        for (size_t c : consumers[best]) {
+            waiting_on[c]--;
+        }
+    }
+
+    vector<vector<string>> new_group_order;
+    vector<string> new_group_names;
+    for (size_t i : schedule) {
+        new_group_order.push_back(group_order[i]);
+        new_group_names.push_back(group_names[i]);
+    }
+    group_order.swap(new_group_order);
+    group_names.swap(new_group_names);
+}
+
 } // anonymous namespace
 
 pair<vector<string>, vector<vector<string>>> realization_order(
-        const vector<Function> &outputs, map<string, Function> &env) {
+        const vector<Function> &outputs, map<string, Function> &env,
+        bool minimize_memory) {
 
     // Populate the fused_pairs list of each function definition (i.e. list of
     // all function definitions that are to be computed with that function).
@@ -286,10 +365,12 @@ pair<vector<string>, vector<vector<string>>> realization_order(
 
     // Collect the realization order of the fused groups.
     vector<vector<string>> group_order;
+    vector<string> group_names;
     for (const auto &fn : temp) {
         const auto &iter = fused_groups.find(fn);
         if (iter != fused_groups.end()) {
             group_order.push_back(iter->second);
+            group_names.push_back(fn);
         }
     }
     // Sort the functions within a fused group based on the compute_with
@@ -305,6 +386,10 @@ pair<vector<string>, vector<vector<string>>> realization_order(
         );
     }
 
+    if (minimize_memory) {
+        minimize_live_funcs(group_order, group_names, graph, group_name);
+    }
+
     // Collect the realization order of all functions within the pipeline.
     vector<string> order;
     for (const auto &group : group_order) {
@@ -26,10 +26,13 @@ class Function;
  * are sorted based on realization order. There should not be any dependencies
  * among functions within a fused group. This pass will also populate the
  * 'fused_pairs' list in the function's schedule. Return a pair of
- * the realization order and the fused groups in that order.
+ * the realization order and the fused groups in that order. If
+ * minimize_memory is set, independent stages are reordered to keep
+ * as few Funcs alive at once as possible.
  */
 std::pair<std::vector<std::string>, std::vector<std::vector<std::string>>> realization_order(
-    const std::vector<Function> &outputs, std::map<std::string, Function> &env);
+    const std::vector<Function> &outputs, std::map<std::string, Function> &env,
+    bool minimize_memory = false);
 
 /** Given a bunch of functions that call each other, determine a
  * topological order which stays constant regardless of the schedule.
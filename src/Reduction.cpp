@@ -93,6 +93,7 @@ struct ReductionDomainContents {
     mutable RefCount ref_count;
     std::vector<ReductionVariable> domain;
     Expr predicate;
+    std::vector<Expr> distinct_coordinates;
     bool frozen;
 
     ReductionDomainContents() : predicate(const_true()), frozen(false) {
@@ -146,6 +147,7 @@ ReductionDomain ReductionDomain::deep_copy() const {
     }
     ReductionDomain copy(contents->domain);
     copy.contents->predicate = contents->predicate;
+    copy.contents->distinct_coordinates = contents->distinct_coordinates;
     copy.contents->frozen = contents->frozen;
     return copy;
 }
@@ -191,6 +193,18 @@ Expr ReductionDomain::predicate() const {
     return contents->predicate;
 }
 
+void ReductionDomain::set_distinct_coordinates(const std::vector<Expr> &coords) {
+    // As with the predicate, drop the references back to the RDom.
+    contents->distinct_coordinates.clear();
+    for (const Expr &c : coords) {
+        contents->distinct_coordinates.push_back(DropSelfReferences(c, *this).mutate(c));
+    }
+}
+
+const std::vector<Expr> &ReductionDomain::distinct_coordinates() const {
+    return contents->distinct_coordinates;
+}
+
 std::vector<Expr> ReductionDomain::split_predicate() const {
     std::vector<Expr> predicates;
     split_into_ands(contents->predicate, predicates);
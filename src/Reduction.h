@@ -92,6 +92,15 @@ public:
      * predicates. */
     bool frozen() const;
 
+    /** Record that the points of this domain are distinct when
+     * projected onto the given coordinates, which are expressions in
+     * its reduction variables. See \ref SparseRDom. */
+    void set_distinct_coordinates(const std::vector<Expr> &coords);
+
+    /** The coordinates set by set_distinct_coordinates, or an empty
+     * vector. */
+    const std::vector<Expr> &distinct_coordinates() const;
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * ReductionDomain. */
     void accept(IRVisitor *) const;
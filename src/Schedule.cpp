@@ -211,13 +211,26 @@ struct FuncScheduleContents {
     std::vector<StorageDim> storage_dims;
     std::vector<Bound> bounds;
     std::vector<Bound> estimates;
+    std::vector<ExternTile> extern_tiles;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     bool memoized;
+    int64_t memoize_budget;
+    bool async;
+    bool store_per_worker;
+    bool hexagon_dma;
+    Expr ring_buffer;
+    Expr slide_task_size;
+    std::string in_place_of;
+    bool store_interleaved;
+    bool store_streaming;
+    float max_math_ulps;
     MemoryType memory_type;
+    std::vector<std::vector<Target::Feature>> cpu_variants;
 
     FuncScheduleContents() :
         store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
-        memoized(false), memory_type(MemoryType::Auto) {};
+        memoized(false), memoize_budget(0), async(false), store_per_worker(false), hexagon_dma(false),
+        store_interleaved(false), store_streaming(false), max_math_ulps(0.0f), memory_type(MemoryType::Auto) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the FuncScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -249,6 +262,15 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        for (ExternTile &t : extern_tiles) {
+            t.size = mutator->mutate(t.size);
+        }
+        if (ring_buffer.defined()) {
+            ring_buffer = mutator->mutate(ring_buffer);
+        }
+        if (slide_task_size.defined()) {
+            slide_task_size = mutator->mutate(slide_task_size);
+        }
     }
 };
 
@@ -272,13 +294,16 @@ struct StageScheduleContents {
     std::vector<Split> splits;
     std::vector<Dim> dims;
     std::vector<PrefetchDirective> prefetches;
+    std::vector<GPUDistribution> gpu_distributions;
+    std::vector<TensorCoreLoops> tensor_cores;
     FuseLoopLevel fuse_level;
     std::vector<FusedPair> fused_pairs;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
 
     StageScheduleContents() : fuse_level(FuseLoopLevel()), touched(false),
-                              allow_race_conditions(false) {};
+                              allow_race_conditions(false), atomic(false) {};
 
     // Pass an IRMutator2 through to all Exprs referenced in the StageScheduleContents
     void mutate(IRMutator2 *mutator) {
@@ -300,6 +325,11 @@ struct StageScheduleContents {
                 p.offset = mutator->mutate(p.offset);
             }
         }
+        for (GPUDistribution &d : gpu_distributions) {
+            if (d.num_devices.defined()) {
+                d.num_devices = mutator->mutate(d.num_devices);
+            }
+        }
     }
 };
 
@@ -326,8 +356,20 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->storage_dims = contents->storage_dims;
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
+    copy.contents->extern_tiles = contents->extern_tiles;
     copy.contents->memoized = contents->memoized;
+    copy.contents->memoize_budget = contents->memoize_budget;
+    copy.contents->async = contents->async;
+    copy.contents->store_per_worker = contents->store_per_worker;
+    copy.contents->hexagon_dma = contents->hexagon_dma;
+    copy.contents->ring_buffer = contents->ring_buffer;
+    copy.contents->slide_task_size = contents->slide_task_size;
+    copy.contents->in_place_of = contents->in_place_of;
+    copy.contents->store_interleaved = contents->store_interleaved;
+    copy.contents->store_streaming = contents->store_streaming;
+    copy.contents->max_math_ulps = contents->max_math_ulps;
     copy.contents->memory_type = contents->memory_type;
+    copy.contents->cpu_variants = contents->cpu_variants;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -347,6 +389,86 @@ bool FuncSchedule::memoized() const {
     return contents->memoized;
 }
 
+int64_t &FuncSchedule::memoize_budget() {
+    return contents->memoize_budget;
+}
+
+int64_t FuncSchedule::memoize_budget() const {
+    return contents->memoize_budget;
+}
+
+bool &FuncSchedule::async() {
+    return contents->async;
+}
+
+bool FuncSchedule::async() const {
+    return contents->async;
+}
+
+bool &FuncSchedule::store_per_worker() {
+    return contents->store_per_worker;
+}
+
+bool FuncSchedule::store_per_worker() const {
+    return contents->store_per_worker;
+}
+
+bool &FuncSchedule::hexagon_dma() {
+    return contents->hexagon_dma;
+}
+
+bool FuncSchedule::hexagon_dma() const {
+    return contents->hexagon_dma;
+}
+
+Expr &FuncSchedule::ring_buffer() {
+    return contents->ring_buffer;
+}
+
+Expr FuncSchedule::ring_buffer() const {
+    return contents->ring_buffer;
+}
+
+Expr &FuncSchedule::slide_task_size() {
+    return contents->slide_task_size;
+}
+
+Expr FuncSchedule::slide_task_size() const {
+    return contents->slide_task_size;
+}
+
+std::string &FuncSchedule::in_place_of() {
+    return contents->in_place_of;
+}
+
+const std::string &FuncSchedule::in_place_of() const {
+    return contents->in_place_of;
+}
+
+bool &FuncSchedule::store_interleaved() {
+    return contents->store_interleaved;
+}
+
+bool FuncSchedule::store_interleaved() const {
+    return contents->store_interleaved;
+}
+
+bool &FuncSchedule::store_streaming() {
+    return contents->store_streaming;
+}
+
+bool FuncSchedule::store_streaming() const {
+    return contents->store_streaming;
+}
+
+float &FuncSchedule::max_math_ulps() {
+    return contents->max_math_ulps;
+}
+
+float FuncSchedule::max_math_ulps() const {
+    return contents->max_math_ulps;
+}
+
 MemoryType FuncSchedule::memory_type() const {
     return contents->memory_type;
 }
@@ -355,6 +477,14 @@ MemoryType &FuncSchedule::memory_type() {
     return contents->memory_type;
 }
 
+const std::vector<std::vector<Target::Feature>> &FuncSchedule::cpu_variants() const {
+    return contents->cpu_variants;
+}
+
+std::vector<std::vector<Target::Feature>> &FuncSchedule::cpu_variants() {
+    return contents->cpu_variants;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -371,6 +501,14 @@ const std::vector<Bound> &FuncSchedule::bounds() const {
     return contents->bounds;
 }
 
+std::vector<ExternTile> &FuncSchedule::extern_tiles() {
+    return contents->extern_tiles;
+}
+
+const std::vector<ExternTile> &FuncSchedule::extern_tiles() const {
+    return contents->extern_tiles;
+}
+
 std::vector<Bound> &FuncSchedule::estimates() {
     return contents->estimates;
 }
@@ -445,6 +583,15 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
             b.remainder.accept(visitor);
         }
     }
+    for (const ExternTile &t : extern_tiles()) {
+        t.size.accept(visitor);
+    }
+    if (ring_buffer().defined()) {
+        ring_buffer().accept(visitor);
+    }
+    if (slide_task_size().defined()) {
+        slide_task_size().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator2 *mutator) {
@@ -463,10 +610,13 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->splits = contents->splits;
     copy.contents->dims = contents->dims;
     copy.contents->prefetches = contents->prefetches;
+    copy.contents->gpu_distributions = contents->gpu_distributions;
+    copy.contents->tensor_cores = contents->tensor_cores;
     copy.contents->fuse_level = contents->fuse_level;
     copy.contents->fused_pairs = contents->fused_pairs;
     copy.contents->touched = contents->touched;
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
+    copy.contents->atomic = contents->atomic;
     return copy;
 }
 
@@ -510,6 +660,22 @@ const std::vector<PrefetchDirective> &StageSchedule::prefetches() const {
     return contents->prefetches;
 }
 
+std::vector<GPUDistribution> &StageSchedule::gpu_distributions() {
+    return contents->gpu_distributions;
+}
+
+const std::vector<GPUDistribution> &StageSchedule::gpu_distributions() const {
+    return contents->gpu_distributions;
+}
+
+std::vector<TensorCoreLoops> &StageSchedule::tensor_cores() {
+    return contents->tensor_cores;
+}
+
+const std::vector<TensorCoreLoops> &StageSchedule::tensor_cores() const {
+    return contents->tensor_cores;
+}
+
 FuseLoopLevel &StageSchedule::fuse_level() {
     return contents->fuse_level;
 }
@@ -534,6 +700,14 @@ bool StageSchedule::allow_race_conditions() const {
     return contents->allow_race_conditions;
 }
 
+bool &StageSchedule::atomic() {
+    return contents->atomic;
+}
+
+bool StageSchedule::atomic() const {
+    return contents->atomic;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
@@ -553,6 +727,11 @@ void StageSchedule::accept(IRVisitor *visitor) const {
             p.offset.accept(visitor);
         }
     }
+    for (const GPUDistribution &d : gpu_distributions()) {
+        if (d.num_devices.defined()) {
+            d.num_devices.accept(visitor);
+        }
+    }
 }
 
 void StageSchedule::mutate(IRMutator2 *mutator) {
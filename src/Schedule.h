@@ -8,6 +8,7 @@
 #include "Expr.h"
 #include "FunctionPtr.h"
 #include "Parameter.h"
+#include "Target.h"
 
 #include <map>
 
@@ -40,7 +41,8 @@ enum class TailStrategy {
      * redundant re-evaluation; does not constrain input our
      * output sizes. Cons: increases code size due to separate
      * tail-case handling; vectorization will scalarize in the tail
-     * case to handle the if statement. */
+     * case to handle the if statement, unless the target has
+     * predicated vector loads and stores (e.g. arm_sve). */
     GuardWithIf,
 
     /** Prevent evaluation beyond the original extent by shifting
@@ -61,6 +63,18 @@ enum class TailStrategy {
      * instead of a multiple of the split factor as with RoundUp. */
     ShiftInwards,
 
+    /** Like GuardWithIf, but the if statement is not treated as a
+     * boundary condition, so no separate tail case is generated.
+     * Instead, a vectorized inner loop turns it into predicated
+     * (masked) loads and stores, and the tail is just the last vector
+     * iteration with some lanes turned off. Always legal. Pros: no
+     * epilogue, so smaller code and no slow scalar tail on odd
+     * widths. Cons: every iteration pays for the predication, so
+     * this is best on targets with mask registers (AVX-512, HVX,
+     * SVE). Where the loads and stores can't be predicated, the loop
+     * is scalarized, as for the tail case of GuardWithIf. */
+    Predicate,
+
     /** For pure definitions use ShiftInwards. For pure vars in
      * update definitions use RoundUp. For RVars in update
      * definitions use GuardWithIf. */
@@ -104,6 +118,25 @@ enum class PrefetchBoundStrategy {
     NonFaulting
 };
 
+/** Which level of the cache hierarchy a prefetch should bring data
+ * into. Lower levels are larger and slower, so they suit prefetches
+ * issued further ahead. */
+enum class PrefetchHint {
+    /** Bring the data into all levels of the cache. */
+    L1,
+
+    /** Bring the data into the second-level cache and outwards. */
+    L2,
+
+    /** Bring the data into the last-level cache only. */
+    L3,
+
+    /** Bring the data close to the processor while polluting the
+     * caches as little as possible, for data that will only be used
+     * once. */
+    NonTemporal
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -305,11 +338,24 @@ struct Bound {
     Expr min, extent, modulus, remainder;
 };
 
+/** A tiling of one dimension of an extern stage. The extern function
+ * is called once per tile, from a loop of the given type, with its
+ * output cropped to the tile. See \ref Func::parallel */
+struct ExternTile {
+    std::string var;
+    Expr size;
+    ForType for_type;
+};
+
 struct StorageDim {
     std::string var;
     Expr alignment;
     Expr fold_factor;
     bool fold_forward;
+    /** Extra elements added to the storage extent of this dimension,
+     * after alignment. Undefined means the compiler may add some to
+     * avoid GPU shared memory bank conflicts. See \ref Func::pad_storage */
+    Expr padding;
 };
 
 /** This represents two stages with fused loop nests from outermost to a specific
@@ -358,6 +404,21 @@ struct PrefetchDirective {
     PrefetchBoundStrategy strategy;
     // If it's a prefetch load from an image parameter, this points to that.
     Parameter param;
+    PrefetchHint hint;
+};
+
+/** A loop whose iterations are spread round-robin over several GPU
+ * devices. See \ref Stage::distribute_gpus */
+struct GPUDistribution {
+    std::string var;
+    Expr num_devices;
+};
+
+/** The three innermost loops of a stage that form a 16x16x16
+ * matrix multiply-accumulate to be done on tensor cores. See \ref
+ * Stage::tensor_core */
+struct TensorCoreLoops {
+    std::string x, y, k;
 };
 
 struct FuncScheduleContents;
@@ -393,6 +454,82 @@ public:
     bool memoized() const;
     // @}
 
+    /** The most bytes of the memoization cache that results of this
+     * Func may take up, or zero if there is no limit other than the
+     * size of the whole cache. See \ref Func::memoize */
+    // @{
+    int64_t &memoize_budget();
+    int64_t memoize_budget() const;
+    // @}
+
+    /** This flag is set to true if the Func should be computed
+     * asynchronously, on a thread of its own. See \ref Func::async */
+    // @{
+    bool &async();
+    bool async() const;
+    // @}
+
+    /** This flag is set to true if allocations of this Func inside a
+     * parallel loop should be hoisted out of it and reused by the
+     * loop's tasks. See \ref Func::store_per_worker */
+    // @{
+    bool &store_per_worker();
+    bool store_per_worker() const;
+    // @}
+
+    /** This flag is set to true if the Func is a copy that should be
+     * done by the Hexagon user DMA engine. See \ref Func::hexagon_dma */
+    // @{
+    bool &hexagon_dma();
+    bool hexagon_dma() const;
+    // @}
+
+    /** The number of tiles in the ring buffer holding this Func's
+     * storage, or undefined if it isn't ring buffered. See
+     * \ref Func::ring_buffer */
+    // @{
+    Expr &ring_buffer();
+    Expr ring_buffer() const;
+    // @}
+
+    /** The number of iterations in each task of a parallel loop this
+     * Func slides along, or undefined if it only slides along serial
+     * loops. See \ref Func::slide_in_tasks */
+    // @{
+    Expr &slide_task_size();
+    Expr slide_task_size() const;
+    // @}
+
+    /** The name of the Func whose storage this Func reuses, or empty
+     * if it has its own. See \ref Func::store_in_place_of */
+    // @{
+    std::string &in_place_of();
+    const std::string &in_place_of() const;
+    // @}
+
+    /** This flag is set to true if the elements of this Tuple-valued
+     * Func are stored interleaved in one buffer. See
+     * \ref Func::store_interleaved */
+    // @{
+    bool &store_interleaved();
+    bool store_interleaved() const;
+    // @}
+
+    /** This flag is set to true if vector stores to this Func should
+     * bypass the cache. See \ref Func::store_streaming */
+    // @{
+    bool &store_streaming();
+    bool store_streaming() const;
+    // @}
+
+    /** The error, in units in the last place, that the transcendental
+     * math in this Func's definitions may have, or zero if it should
+     * be exact. See \ref Func::approximate_math */
+    // @{
+    float &max_math_ulps();
+    float max_math_ulps() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -408,6 +545,14 @@ public:
     MemoryType &memory_type();
     // @}
 
+    /** The instruction set features to compile extra copies of this
+     * Func's producer for, in the order they should be tried. See
+     * \ref Func::cpu_variants */
+    // @{
+    const std::vector<std::vector<Target::Feature>> &cpu_variants() const;
+    std::vector<std::vector<Target::Feature>> &cpu_variants();
+    // @}
+
     /** You may explicitly bound some of the dimensions of a function,
      * or constrain them to lie on multiples of a given factor. See
      * \ref Func::bound and \ref Func::align_bounds */
@@ -423,6 +568,12 @@ public:
     std::vector<Bound> &estimates();
     // @}
 
+    /** The tiles an extern stage is called over, innermost first. */
+    // @{
+    const std::vector<ExternTile> &extern_tiles() const;
+    std::vector<ExternTile> &extern_tiles();
+    // @}
+
     /** Mark calls of a function by 'f' to be replaced with its identity
      * wrapper or clone during the lowering stage. If the string 'f' is empty,
      * it means replace all calls to the function by all other functions
@@ -514,6 +665,20 @@ public:
     std::vector<PrefetchDirective> &prefetches();
     // @}
 
+    /** The loops of this stage whose iterations are spread over
+     * several GPU devices. See \ref Stage::distribute_gpus */
+    // @{
+    const std::vector<GPUDistribution> &gpu_distributions() const;
+    std::vector<GPUDistribution> &gpu_distributions();
+    // @}
+
+    /** The loop nests of this stage that are lowered to tensor core
+     * instructions. See \ref Stage::tensor_core */
+    // @{
+    const std::vector<TensorCoreLoops> &tensor_cores() const;
+    std::vector<TensorCoreLoops> &tensor_cores();
+    // @}
+
     /** Innermost loop level of fused loop nest for this function stage.
      * Fusion runs from outermost to this loop level. The stages being fused
      * should not have producer/consumer relationship. See \ref Func::compute_with
@@ -538,6 +703,13 @@ public:
     bool &allow_race_conditions();
     // @}
 
+    /** Should the update be performed with atomic read-modify-write
+     * operations on the stored value? See \ref Stage::atomic */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
@@ -2,6 +2,7 @@
 #include "ApplySplit.h"
 #include "CodeGen_GPU_Dev.h"
 #include "ExprUsesVar.h"
+#include "FindCalls.h"
 #include "Func.h"
 #include "IREquality.h"
 #include "IRMutator.h"
@@ -86,8 +87,23 @@ Stmt build_provide_loop_nest_helper(string func_name,
     // We'll build it from inside out, starting from a store node,
     // then wrapping it in for loops.
 
-    // Make the (multi-dimensional multi-valued) store node.
-    Stmt stmt = Provide::make(func_name, values, site);
+    // Make the (multi-dimensional multi-valued) store node. Atomic
+    // and streaming stores get their value wrapped in a marker for
+    // codegen.
+    Stmt stmt;
+    if (stage_s.atomic()) {
+        internal_assert(values.size() == 1);
+        Expr value = Call::make(values[0].type(), Call::atomic_update, {values[0]}, Call::Intrinsic);
+        stmt = Provide::make(func_name, {value}, site);
+    } else if (func_s.store_streaming()) {
+        vector<Expr> marked(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            marked[i] = Call::make(values[i].type(), Call::streaming_store, {values[i]}, Call::Intrinsic);
+        }
+        stmt = Provide::make(func_name, marked, site);
+    } else {
+        stmt = Provide::make(func_name, values, site);
+    }
 
     // A map of the dimensions for which we know the extent is a
     // multiple of some Expr. This can happen due to a bound, or
@@ -502,7 +518,8 @@ Stmt build_produce(const map<string, Function> &env, Function f, const Target &t
         // it's the output to the pipeline then it will similarly be
         // in the symbol table.
         vector<pair<Expr, Expr>> cropped_buffers;
-        if (f.schedule().store_level() == f.schedule().compute_level()) {
+        const vector<ExternTile> &tiles = f.schedule().extern_tiles();
+        if (f.schedule().store_level() == f.schedule().compute_level() && tiles.empty()) {
             for (int j = 0; j < f.outputs(); j++) {
                 string buf_name = f.name();
                 if (f.outputs() > 1) {
@@ -516,8 +533,9 @@ Stmt build_produce(const map<string, Function> &env, Function f, const Target &t
                 buffers_to_annotate.push_back({buffer, f.dimensions()});
             }
         } else {
-            // Store level doesn't match compute level. Make an output
-            // buffer just for this subregion.
+            // Store level doesn't match compute level, or the stage
+            // is called once per tile. Make an output buffer just for
+            // this subregion.
             string stage_name = f.name() + ".s0.";
             const vector<string> f_args = f.args();
             for (int j = 0; j < f.outputs(); j++) {
@@ -651,6 +669,23 @@ Stmt build_produce(const map<string, Function> &env, Function f, const Target &t
             check = Block::make(annotate, check);
         }
 
+        // Call the extern stage once per tile, innermost tile first,
+        // with the output crop restricted to the tile. The last tile
+        // is clamped to the required region.
+        for (const ExternTile &tile : tiles) {
+            string var = f.name() + ".s0." + tile.var;
+            Expr min = Variable::make(Int(32), var + ".min");
+            Expr max = Variable::make(Int(32), var + ".max");
+            string tile_name = var + ".tile";
+            Expr tile_var = Variable::make(Int(32), tile_name);
+            Expr tile_min = min + tile_var * tile.size;
+            Expr tile_max = Min::make(tile_min + tile.size - 1, max);
+            map<string, Expr> replacements = {{var + ".min", tile_min}, {var + ".max", tile_max}};
+            check = substitute(replacements, check);
+            Expr num_tiles = (max - min + tile.size) / tile.size;
+            check = For::make(tile_name, 0, num_tiles, tile.for_type, DeviceAPI::None, check);
+        }
+
         // Add the dummy outermost loop.
         string outermost = f.name() + ".s0." + Var::outermost().name();
         check = For::make(outermost, 0, 1, ForType::Serial, DeviceAPI::None, check);
@@ -1836,6 +1871,116 @@ public:
     PrintUsesOfFunc(string f, std::ostream &s) : func(f), stream(s) {}
 };
 
+// Find calls to a Func, and whether any of them are at coordinates
+// other than the pure args of the definition making them.
+class FindPointwiseCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &func;
+    const vector<string> &args;
+
+    void visit(const Call *op) override {
+        if (op->name == func) {
+            bool pointwise = op->args.size() == args.size();
+            for (size_t i = 0; pointwise && i < args.size(); i++) {
+                const Variable *v = op->args[i].as<Variable>();
+                pointwise = v && v->name == args[i];
+            }
+            found = true;
+            non_pointwise = non_pointwise || !pointwise;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool found = false, non_pointwise = false;
+
+    FindPointwiseCalls(const string &func, const vector<string> &args) : func(func), args(args) {}
+};
+
+// Check that a Func can be stored in place of its producer.
+void validate_in_place_schedule(Function f, bool is_output, const map<string, Function> &env) {
+    const string &name = f.schedule().in_place_of();
+    auto iter = env.find(name);
+    user_assert(iter != env.end() && find_direct_calls(f).count(name))
+        << "Func " << f.name() << " can't be stored in place of " << name
+        << " because it doesn't call it.\n";
+    const Function &producer = iter->second;
+
+    user_assert(!is_output)
+        << "Func " << f.name() << " is an output, so it can't be stored in place of "
+        << name << ".\n";
+
+    for (const auto &p : env) {
+        if (p.first != f.name() && find_direct_calls(p.second).count(name)) {
+            user_error << "Func " << f.name() << " can't be stored in place of " << name
+                       << " because " << p.first << " also uses " << name << ".\n";
+        }
+    }
+
+    user_assert(!f.has_extern_definition() && !producer.has_extern_definition() &&
+                f.outputs() == 1 && producer.outputs() == 1 &&
+                f.output_types()[0].bytes() == producer.output_types()[0].bytes() &&
+                f.dimensions() == producer.dimensions())
+        << "Func " << f.name() << " can't be stored in place of " << name
+        << " because they don't both have a single value of the same size with the"
+        << " same number of dimensions.\n";
+
+    vector<Definition> definitions = {f.definition()};
+    for (const Specialization &s : f.definition().specializations()) {
+        definitions.push_back(s.definition);
+    }
+    for (const Definition &def : definitions) {
+        FindPointwiseCalls finder(name, f.args());
+        for (const Expr &e : def.values()) {
+            e.accept(&finder);
+        }
+        user_assert(!finder.non_pointwise)
+            << "Func " << f.name() << " can't be stored in place of " << name
+            << " because it uses " << name << " at coordinates other than the ones it computes.\n";
+        for (const Split &split : def.schedule().splits()) {
+            // Recomputing a value would read a value of the producer
+            // that has already been overwritten.
+            user_assert(split.tail != TailStrategy::ShiftInwards)
+                << "Func " << f.name() << " can't be stored in place of " << name
+                << " because splitting " << split.old_var << " with TailStrategy::ShiftInwards"
+                << " recomputes some values. Use TailStrategy::GuardWithIf instead.\n";
+        }
+    }
+    for (const Definition &def : f.updates()) {
+        FindPointwiseCalls finder(name, f.args());
+        def.accept(&finder);
+        user_assert(!finder.found)
+            << "Func " << f.name() << " can't be stored in place of " << name
+            << " because an update definition of " << f.name() << " uses it.\n";
+    }
+
+    const FuncSchedule &s = f.schedule(), &ps = producer.schedule();
+    user_assert(s.store_level() == s.compute_level() &&
+                ps.store_level() == ps.compute_level() &&
+                s.store_level() == ps.store_level() &&
+                !s.store_level().is_inlined())
+        << "Func " << f.name() << " can't be stored in place of " << name
+        << " because they aren't both stored and computed at the same loop level.\n";
+
+    user_assert(!s.async() && !ps.async() &&
+                !s.ring_buffer().defined() && !ps.ring_buffer().defined())
+        << "Func " << f.name() << " can't be stored in place of " << name
+        << " because one of them is async or ring buffered.\n";
+
+    for (size_t i = 0; i < s.storage_dims().size(); i++) {
+        const StorageDim &d = s.storage_dims()[i], &pd = ps.storage_dims()[i];
+        int index = std::find(f.args().begin(), f.args().end(), d.var) - f.args().begin();
+        int producer_index = std::find(producer.args().begin(), producer.args().end(), pd.var) - producer.args().begin();
+        user_assert(index == producer_index)
+            << "Func " << f.name() << " can't be stored in place of " << name
+            << " because they are stored with different dimension orders.\n";
+        user_assert(!d.fold_factor.defined() && !pd.fold_factor.defined())
+            << "Func " << f.name() << " can't be stored in place of " << name
+            << " because one of them is folded.\n";
+    }
+}
+
 // Check a schedule is legal, throwing an error if it is not. Returns
 // whether or not a realization of the Func should be injected. Unused
 // intermediate Funcs that somehow made it into the Func DAG can be
@@ -1961,6 +2106,10 @@ bool validate_schedule(Function f, Stmt s, const Target &target, bool is_output,
         }
     }
 
+    if (!f.schedule().in_place_of().empty()) {
+        validate_in_place_schedule(f, is_output, env);
+    }
+
     LoopLevel store_at = f.schedule().store_level();
     LoopLevel compute_at = f.schedule().compute_level();
 
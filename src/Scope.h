@@ -131,6 +131,20 @@ public:
         return iter->second.top();
     }
 
+    /** Return a pointer to the value referred to by a name, or
+     * nullptr if the name is not in scope. This hashes the name
+     * once, and copies nothing, so it is cheaper than a call to
+     * contains() followed by a call to get(). */
+    template<typename T2 = T,
+             typename = typename std::enable_if<!std::is_same<T2, void>::value>::type>
+    const T2 *find(const std::string &name) const {
+        typename std::unordered_map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
+        if (iter == table.end() || iter->second.empty()) {
+            return containing_scope ? containing_scope->find(name) : nullptr;
+        }
+        return &iter->second.top_ref();
+    }
+
     /** Return a reference to an entry. Does not consider the containing scope. */
     template<typename T2 = T,
              typename = typename std::enable_if<!std::is_same<T2, void>::value>::type>
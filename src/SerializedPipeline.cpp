@@ -0,0 +1,314 @@
+#include "SerializedPipeline.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "Debug.h"
+#include "Error.h"
+#include "LLVM_Headers.h"
+#include "LLVM_Output.h"
+#include "Module.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace Internal {
+
+struct SerializedPipelineContents {
+    mutable RefCount ref_count;
+
+    string name;
+    Target target;
+
+    // The arguments of the entrypoint, as passed to run.
+    vector<Argument> args;
+
+    // The number of arguments of the entrypoint, and the position of
+    // the user context among them (or -1), which run fills in.
+    size_t num_lowered_args = 0;
+    int user_context_index = -1;
+
+    uint64_t hash = 0;
+    JITModule module;
+};
+
+template<>
+RefCount &ref_count<SerializedPipelineContents>(const SerializedPipelineContents *p) {
+    return p->ref_count;
+}
+
+template<>
+void destroy<SerializedPipelineContents>(const SerializedPipelineContents *p) {
+    delete p;
+}
+
+namespace {
+
+// The file starts with this magic string, then a version number that
+// changes whenever the layout below does. The rest is the llvm version
+// and target the pipeline was compiled with, the name of the
+// entrypoint, its arguments, and finally the llvm bitcode. Integers
+// are stored little-endian, and strings as a length followed by their
+// bytes.
+const char serialized_pipeline_magic[8] = {'H', 'L', 'P', 'I', 'P', 'E', '\0', '\0'};
+const uint32_t serialized_pipeline_version = 1;
+
+const char *user_context_arg_name = "__user_context";
+
+// The instruction sets a pipeline compiled for x86 may use.
+const Target::Feature x86_isa_features[] = {
+    Target::SSE41, Target::AVX, Target::AVX2, Target::FMA, Target::FMA4, Target::F16C,
+    Target::AVX512, Target::AVX512_KNL, Target::AVX512_Skylake, Target::AVX512_Cannonlake,
+    Target::AVX512_VNNI,
+};
+
+uint64_t fnv1a_64(const char *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+class Writer {
+    std::ostringstream out;
+
+public:
+    void write_uint(uint64_t x, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out.put((char)((x >> (8 * i)) & 0xff));
+        }
+    }
+
+    void write_string(const string &s) {
+        write_uint(s.size(), 8);
+        out.write(s.data(), s.size());
+    }
+
+    void write_bytes(const char *data, size_t size) {
+        out.write(data, size);
+    }
+
+    string str() const {
+        return out.str();
+    }
+};
+
+class Reader {
+    const string &data;
+    const string &filename;
+    size_t pos = 0;
+
+    void check(size_t size) {
+        user_assert(size <= data.size() - pos)
+            << "Serialized pipeline " << filename << " is truncated or corrupt\n";
+    }
+
+public:
+    Reader(const string &data, const string &filename) : data(data), filename(filename) {}
+
+    uint64_t read_uint(int bytes) {
+        check(bytes);
+        uint64_t x = 0;
+        for (int i = 0; i < bytes; i++) {
+            x |= (uint64_t)(uint8_t)data[pos++] << (8 * i);
+        }
+        return x;
+    }
+
+    string read_string() {
+        uint64_t size = read_uint(8);
+        check(size);
+        string s = data.substr(pos, size);
+        pos += size;
+        return s;
+    }
+
+    bool at_end() const {
+        return pos == data.size();
+    }
+};
+
+void check_target_runs_on_host(const Target &t, const string &filename) {
+    Target host = get_host_target();
+    user_assert(t.arch == host.arch && t.bits == host.bits && t.os == host.os)
+        << "Serialized pipeline " << filename << " was compiled for " << t
+        << ", which can't run on this machine (" << host << ")\n";
+    if (t.arch == Target::X86) {
+        for (Target::Feature f : x86_isa_features) {
+            user_assert(!t.has_feature(f) || host.has_feature(f))
+                << "Serialized pipeline " << filename << " was compiled for " << t
+                << ", which uses instructions this machine (" << host << ") lacks\n";
+        }
+    }
+}
+
+}  // namespace
+
+void compile_llvm_module_to_serialized_pipeline(const Module &module, llvm::Module &llvm_module,
+                                                const string &filename) {
+    const Target &t = module.target();
+    user_assert(t.has_feature(Target::JIT) && t.has_feature(Target::UserContext))
+        << "Module " << module.name() << " can't be serialized, because serialized pipelines "
+        << "must be compiled for a target with the jit and user_context features.\n";
+
+    // The entrypoint is the function with an argv wrapper.
+    const LoweredFunc *entrypoint = nullptr;
+    for (const LoweredFunc &f : module.functions()) {
+        if (f.linkage == LinkageType::ExternalPlusMetadata) {
+            user_assert(!entrypoint)
+                << "Module " << module.name() << " can't be serialized, because it has more than one entrypoint.\n";
+            entrypoint = &f;
+        }
+    }
+    user_assert(entrypoint)
+        << "Module " << module.name() << " can't be serialized, because it has no entrypoint with argument metadata.\n";
+
+    llvm::SmallVector<char, 16> bitcode;
+    llvm::raw_svector_ostream bitcode_stream(bitcode);
+    compile_llvm_module_to_llvm_bitcode(llvm_module, bitcode_stream);
+
+    Writer w;
+    w.write_bytes(serialized_pipeline_magic, sizeof(serialized_pipeline_magic));
+    w.write_uint(serialized_pipeline_version, 4);
+    w.write_uint(LLVM_VERSION, 4);
+    w.write_string(t.to_string());
+    w.write_string(entrypoint->name);
+    w.write_uint(entrypoint->args.size(), 4);
+    for (const LoweredArgument &arg : entrypoint->args) {
+        w.write_string(arg.name);
+        w.write_uint(arg.kind, 1);
+        w.write_uint(arg.dimensions, 1);
+        w.write_uint(arg.type.code(), 1);
+        w.write_uint(arg.type.bits(), 1);
+        w.write_uint(arg.type.lanes(), 2);
+    }
+    w.write_string(string(bitcode.data(), bitcode.size()));
+
+    std::ofstream file(filename, std::ios::binary);
+    string contents = w.str();
+    file.write(contents.data(), contents.size());
+    user_assert(file.good()) << "Could not write serialized pipeline " << filename << "\n";
+}
+
+}  // namespace Internal
+
+using namespace Halide::Internal;
+
+SerializedPipeline SerializedPipeline::load(const string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    user_assert(file.good()) << "Could not open serialized pipeline " << filename << "\n";
+    std::ostringstream buf;
+    buf << file.rdbuf();
+    string data = buf.str();
+
+    Reader r(data, filename);
+    string magic(sizeof(serialized_pipeline_magic), '\0');
+    for (char &c : magic) {
+        c = (char)r.read_uint(1);
+    }
+    user_assert(magic == string(serialized_pipeline_magic, sizeof(serialized_pipeline_magic)))
+        << filename << " is not a serialized pipeline\n";
+    uint32_t version = (uint32_t)r.read_uint(4);
+    user_assert(version == serialized_pipeline_version)
+        << "Serialized pipeline " << filename << " has format version " << version
+        << ", but this version of Halide reads version " << serialized_pipeline_version << "\n";
+    uint32_t llvm_version = (uint32_t)r.read_uint(4);
+    user_assert(llvm_version <= LLVM_VERSION)
+        << "Serialized pipeline " << filename << " was compiled with llvm " << llvm_version
+        << ", which is newer than the llvm " << LLVM_VERSION << " this version of Halide uses\n";
+
+    SerializedPipeline p;
+    p.contents = new SerializedPipelineContents;
+    SerializedPipelineContents &c = *p.contents;
+
+    string target_string = r.read_string();
+    user_assert(Target::validate_target_string(target_string))
+        << "Serialized pipeline " << filename << " has an unknown target " << target_string << "\n";
+    c.target = Target(target_string);
+    check_target_runs_on_host(c.target, filename);
+
+    c.name = r.read_string();
+    c.num_lowered_args = (size_t)r.read_uint(4);
+    for (size_t i = 0; i < c.num_lowered_args; i++) {
+        string name = r.read_string();
+        Argument::Kind kind = (Argument::Kind)r.read_uint(1);
+        int dimensions = (int)r.read_uint(1);
+        halide_type_code_t code = (halide_type_code_t)r.read_uint(1);
+        int bits = (int)r.read_uint(1);
+        int lanes = (int)r.read_uint(2);
+        user_assert(kind == Argument::InputScalar || kind == Argument::InputBuffer || kind == Argument::OutputBuffer)
+            << "Serialized pipeline " << filename << " is truncated or corrupt\n";
+        if (name == user_context_arg_name) {
+            c.user_context_index = (int)i;
+        } else {
+            c.args.push_back(Argument(name, kind, Type(code, bits, lanes), dimensions));
+        }
+    }
+    string bitcode = r.read_string();
+    user_assert(r.at_end()) << "Serialized pipeline " << filename << " is truncated or corrupt\n";
+
+    // The object code depends on the whole file and on the llvm
+    // that compiles it.
+    c.hash = fnv1a_64(data.data(), data.size());
+    std::ostringstream object_cache_key;
+    string compiler = "llvm " + std::to_string(LLVM_VERSION) + " " + __DATE__ + " " + __TIME__;
+    object_cache_key << "serialized_" << std::hex << c.hash
+                     << fnv1a_64(compiler.data(), compiler.size(), c.hash);
+
+    debug(1) << "Loading serialized pipeline " << c.name << " from " << filename
+             << " for " << c.target << "\n";
+    c.module = JITModule(bitcode, c.name, c.target, vector<JITModule>(), object_cache_key.str());
+    return p;
+}
+
+bool SerializedPipeline::defined() const {
+    return contents.defined();
+}
+
+const string &SerializedPipeline::name() const {
+    user_assert(defined()) << "SerializedPipeline is undefined\n";
+    return contents->name;
+}
+
+const Target &SerializedPipeline::target() const {
+    user_assert(defined()) << "SerializedPipeline is undefined\n";
+    return contents->target;
+}
+
+const vector<Argument> &SerializedPipeline::arguments() const {
+    user_assert(defined()) << "SerializedPipeline is undefined\n";
+    return contents->args;
+}
+
+uint64_t SerializedPipeline::hash() const {
+    user_assert(defined()) << "SerializedPipeline is undefined\n";
+    return contents->hash;
+}
+
+int SerializedPipeline::run(const vector<const void *> &args, void *user_context) const {
+    user_assert(defined()) << "SerializedPipeline is undefined\n";
+    user_assert(args.size() == contents->args.size())
+        << "SerializedPipeline " << contents->name << " takes " << contents->args.size()
+        << " arguments, but " << args.size() << " were passed\n";
+
+    // The jit runtime reaches the handlers through the user context.
+    JITUserContext jit_context;
+    JITSharedRuntime::init_jit_user_context(jit_context, user_context, JITHandlers());
+    void *user_context_storage = &jit_context;
+
+    vector<const void *> argv;
+    argv.reserve(contents->num_lowered_args);
+    size_t next_arg = 0;
+    for (size_t i = 0; i < contents->num_lowered_args; i++) {
+        if ((int)i == contents->user_context_index) {
+            argv.push_back(&user_context_storage);
+        } else {
+            argv.push_back(args[next_arg++]);
+        }
+    }
+    return contents->module.argv_function()(argv.data());
+}
+
+}  // namespace Halide
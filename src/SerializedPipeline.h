@@ -0,0 +1,152 @@
+#ifndef HALIDE_SERIALIZED_PIPELINE_H
+#define HALIDE_SERIALIZED_PIPELINE_H
+
+/** \file
+ *
+ * Defines SerializedPipeline, a compiled pipeline that is loaded from
+ * a file at runtime and jit-compiled, so that new pipelines can be
+ * deployed without rebuilding the application that runs them.
+ */
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Argument.h"
+#include "Buffer.h"
+#include "IntrusivePtr.h"
+#include "JITModule.h"
+#include "Target.h"
+
+namespace llvm {
+class Module;
+}
+
+namespace Halide {
+
+class Module;
+
+namespace Internal {
+
+struct SerializedPipelineContents;
+
+/** Write the entrypoint of a Module, already compiled to the llvm
+ * module given, to a serialized pipeline file. Used by Module::compile
+ * for Outputs::serialized_pipeline. */
+void compile_llvm_module_to_serialized_pipeline(const Module &module, llvm::Module &llvm_module,
+                                                const std::string &filename);
+
+}  // namespace Internal
+
+/** A pipeline written to a file by Pipeline::compile_to_serialized_pipeline
+ * (or by a Generator with "-e serialized_pipeline"), and loaded back
+ * in with SerializedPipeline::load. The file holds the llvm bitcode
+ * of the fully lowered pipeline along with its argument list, so
+ * loading it needs no C++ code describing the algorithm or schedule:
+ * it only runs llvm code generation for the target the pipeline was
+ * compiled for.
+ *
+ * If the environment variable HL_JIT_CACHE_DIR names a directory,
+ * the generated object code is cached there under a hash of the file,
+ * so later loads of the same pipeline skip code generation entirely.
+ *
+ * Pipelines that call extern stages find them among the symbols of
+ * the running process when they are loaded. */
+class SerializedPipeline {
+    Internal::IntrusivePtr<Internal::SerializedPipelineContents> contents;
+
+    template<typename T>
+    static const void *bind_arg(const Argument &arg, uint64_t *storage, const T &value) {
+        static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value,
+                      "Arguments to a SerializedPipeline must be scalars or buffers");
+        user_assert(arg.kind == Argument::InputScalar)
+            << "Argument " << arg.name << " of a SerializedPipeline is a buffer, but a scalar was passed\n";
+        user_assert(arg.type == type_of<T>() || (arg.type.is_handle() && std::is_pointer<T>::value))
+            << "Argument " << arg.name << " of a SerializedPipeline has type " << arg.type
+            << ", but a " << type_of<T>() << " was passed\n";
+        memcpy(storage, &value, sizeof(T));
+        return storage;
+    }
+
+    static const void *bind_arg(const Argument &arg, uint64_t *, const halide_buffer_t *buf) {
+        user_assert(arg.is_buffer())
+            << "Argument " << arg.name << " of a SerializedPipeline is a scalar, but a buffer was passed\n";
+        return buf;
+    }
+
+    static const void *bind_arg(const Argument &arg, uint64_t *storage, halide_buffer_t *buf) {
+        return bind_arg(arg, storage, (const halide_buffer_t *)buf);
+    }
+
+    template<typename T>
+    static const void *bind_arg(const Argument &arg, uint64_t *storage, const Buffer<T> &buf) {
+        return bind_arg(arg, storage, const_cast<Buffer<T> &>(buf).raw_buffer());
+    }
+
+    template<typename T, int D>
+    static const void *bind_arg(const Argument &arg, uint64_t *storage, const Runtime::Buffer<T, D> &buf) {
+        return bind_arg(arg, storage, const_cast<Runtime::Buffer<T, D> &>(buf).raw_buffer());
+    }
+
+    void bind_args(std::vector<const void *> &, uint64_t *, size_t) const {}
+
+    template<typename First, typename... Rest>
+    void bind_args(std::vector<const void *> &args, uint64_t *storage, size_t i,
+                   const First &first, const Rest &... rest) const {
+        args.push_back(bind_arg(arguments()[i], storage + i, first));
+        bind_args(args, storage, i + 1, rest...);
+    }
+
+public:
+    SerializedPipeline() = default;
+
+    /** Load a serialized pipeline from a file and jit-compile it. The
+     * pipeline must have been compiled for a target this machine can
+     * run. */
+    static SerializedPipeline load(const std::string &filename);
+
+    /** Check if this SerializedPipeline has been loaded. */
+    bool defined() const;
+
+    /** The name of the pipeline's entrypoint. */
+    const std::string &name() const;
+
+    /** The target the pipeline was compiled for. */
+    const Target &target() const;
+
+    /** The arguments of the pipeline, in the order they must be
+     * passed to run, followed by its outputs. */
+    const std::vector<Argument> &arguments() const;
+
+    /** A hash of the serialized file. Two pipelines with the same hash
+     * run the same code. */
+    uint64_t hash() const;
+
+    /** Run the pipeline. There is one entry in args for each of
+     * arguments(): a halide_buffer_t * for each buffer, and a pointer
+     * to the value for each scalar. Returns the error code from the
+     * pipeline, which is zero on success. Errors from the pipeline
+     * are reported through the default jit handlers, which can be
+     * replaced with JITSharedRuntime::set_default_handlers. */
+    int run(const std::vector<const void *> &args, void *user_context = nullptr) const;
+
+    /** Run the pipeline with its arguments and outputs given in order.
+     * Buffers may be passed as Buffer, Runtime::Buffer or
+     * halide_buffer_t *, and scalars must have exactly the type of
+     * the corresponding argument. */
+    template<typename... Args>
+    int operator()(const Args &... args) const {
+        user_assert(sizeof...(args) == arguments().size())
+            << "SerializedPipeline " << name() << " takes " << arguments().size()
+            << " arguments, but " << sizeof...(args) << " were passed\n";
+        std::vector<uint64_t> storage(sizeof...(args));
+        std::vector<const void *> argv;
+        bind_args(argv, storage.data(), 0, args...);
+        return run(argv);
+    }
+};
+
+}  // namespace Halide
+
+#endif
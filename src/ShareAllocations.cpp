@@ -0,0 +1,311 @@
+#include <map>
+
+#include "CodeGen_Internal.h"
+#include "Debug.h"
+#include "ExprUsesVar.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "ShareAllocations.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool is_device_loop(const For *op) {
+    return (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane ||
+            (op->device_api != DeviceAPI::None &&
+             op->device_api != DeviceAPI::Host));
+}
+
+// Whether codegen will get this allocation from halide_malloc. Freed
+// stack allocations are already reused by codegen.
+bool is_heap_allocation(const Allocate *op) {
+    if (op->new_expr.defined() ||
+        (op->memory_type != MemoryType::Heap &&
+         op->memory_type != MemoryType::Auto)) {
+        return false;
+    }
+    int32_t constant_size = Allocate::constant_allocation_size(op->extents, op->name);
+    return (op->memory_type == MemoryType::Heap ||
+            constant_size == 0 ||
+            !can_allocation_fit_on_stack((int64_t)constant_size * op->type.bytes()));
+}
+
+bool is_shareable(const Allocate *op) {
+    return is_heap_allocation(op) && is_one(op->condition) && !op->extents.empty();
+}
+
+Expr allocation_bytes(const Allocate *op) {
+    Expr bytes = make_const(Int(64), op->type.bytes());
+    for (const Expr &e : op->extents) {
+        bytes *= cast<int64_t>(e);
+    }
+    return bytes;
+}
+
+void flatten_blocks(const Stmt &s, vector<Stmt> &stmts) {
+    if (const Block *b = s.as<Block>()) {
+        flatten_blocks(b->first, stmts);
+        flatten_blocks(b->rest, stmts);
+    } else if (s.defined()) {
+        stmts.push_back(s);
+    }
+}
+
+// Find the first shareable allocation that starts in a statement,
+// without looking inside loops or conditionals. The lets that
+// enclose it are returned, outermost first.
+const Allocate *next_allocation(const Stmt &s, vector<const LetStmt *> &lets) {
+    if (const Block *b = s.as<Block>()) {
+        const Allocate *a = next_allocation(b->first, lets);
+        return a ? a : next_allocation(b->rest, lets);
+    } else if (const ProducerConsumer *pc = s.as<ProducerConsumer>()) {
+        return next_allocation(pc->body, lets);
+    } else if (const LetStmt *let = s.as<LetStmt>()) {
+        lets.push_back(let);
+        const Allocate *a = next_allocation(let->body, lets);
+        if (!a) {
+            lets.pop_back();
+        }
+        return a;
+    } else if (const Allocate *a = s.as<Allocate>()) {
+        return is_shareable(a) ? a : next_allocation(a->body, lets);
+    } else {
+        return nullptr;
+    }
+}
+
+// Free some memory along with an allocation that uses it.
+class FreeWith : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const string &name, &host;
+
+    Stmt visit(const Free *op) override {
+        if (op->name == name) {
+            found = true;
+            return Block::make(op, Free::make(host));
+        }
+        return op;
+    }
+
+public:
+    bool found = false;
+
+    FreeWith(const string &name, const string &host) : name(name), host(host) {}
+};
+
+// Make an allocation use the memory of a freed one, and move the free
+// of that memory to where the allocation is freed.
+class UseFreedMemory : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const Allocate *target;
+    const string &host;
+
+    Stmt visit(const Allocate *op) override {
+        if (op != target) {
+            return IRMutator2::visit(op);
+        }
+        FreeWith free_with(op->name, host);
+        Stmt body = free_with.mutate(op->body);
+        Stmt stmt = Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                   op->condition, body, Variable::make(Handle(), host),
+                                   "halide_device_host_nop_free");
+        if (!free_with.found) {
+            stmt = Block::make(stmt, Free::make(host));
+        }
+        return stmt;
+    }
+
+public:
+    UseFreedMemory(const Allocate *target, const string &host) : target(target), host(host) {}
+};
+
+// Look for a heap allocation that starts after the given allocation
+// is freed, and make it use the same memory.
+class ReuseFreedMemory : public IRMutator2 {
+    using IRMutator2::visit;
+
+    const Allocate *alloc;
+    Scope<> defined;
+
+    Stmt visit(const For *op) override {
+        // The free is never inside a loop.
+        return op;
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        return op;
+    }
+
+    Stmt visit(const Fork *op) override {
+        return op;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<> bind(defined, op->name);
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Block *op) override {
+        if (bytes.defined()) {
+            return op;
+        }
+
+        vector<Stmt> stmts;
+        flatten_blocks(op, stmts);
+
+        size_t free_index = 0;
+        while (free_index < stmts.size()) {
+            const Free *f = stmts[free_index].as<Free>();
+            if (f && f->name == alloc->name) {
+                break;
+            }
+            free_index++;
+        }
+
+        if (free_index == stmts.size()) {
+            return IRMutator2::visit(op);
+        }
+
+        vector<const LetStmt *> lets;
+        const Allocate *next = nullptr;
+        for (size_t i = free_index + 1; i < stmts.size() && !next; i++) {
+            next = next_allocation(stmts[i], lets);
+        }
+        if (!next) {
+            return op;
+        }
+
+        // The allocation is grown to fit the later one when it is
+        // allocated, so the size of the later one must be known
+        // there.
+        Expr next_bytes = allocation_bytes(next);
+        for (size_t i = lets.size(); i > 0; i--) {
+            next_bytes = substitute(lets[i - 1]->name, lets[i - 1]->value, next_bytes);
+        }
+        if (expr_uses_vars(next_bytes, defined)) {
+            return op;
+        }
+
+        bytes = next_bytes;
+        UseFreedMemory use(next, alloc->name);
+        vector<Stmt> result(stmts.begin(), stmts.begin() + free_index);
+        for (size_t i = free_index + 1; i < stmts.size(); i++) {
+            result.push_back(use.mutate(stmts[i]));
+        }
+        return Block::make(result);
+    }
+
+public:
+    // The size of the allocation that now uses this memory.
+    Expr bytes;
+
+    ReuseFreedMemory(const Allocate *alloc) : alloc(alloc) {}
+};
+
+class ShareAllocations : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        if (is_device_loop(op)) {
+            return op;
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        // Allocations inside this one pick their memory first, so that
+        // their sizes are final by the time this one is grown to fit
+        // one of them.
+        Stmt body = mutate(op->body);
+        if (!is_shareable(op)) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                                  op->condition, body, op->new_expr, op->free_function);
+        }
+
+        ReuseFreedMemory reuse(op);
+        body = reuse.mutate(body);
+        vector<Expr> extents = op->extents;
+        if (reuse.bytes.defined()) {
+            debug(3) << "Sharing the memory of " << op->name << " with a later allocation\n";
+            Expr elem_bytes = make_const(Int(64), op->type.bytes());
+            Expr elems = simplify(max(allocation_bytes(op) / elem_bytes,
+                                      (reuse.bytes + elem_bytes - 1) / elem_bytes));
+            extents = {simplify(cast<int32_t>(elems))};
+        }
+        return Allocate::make(op->name, op->type, op->memory_type, extents,
+                              op->condition, body, op->new_expr, op->free_function);
+    }
+};
+
+class ComputePeakHeapMemory : public IRVisitor {
+    using IRVisitor::visit;
+
+    map<string, Expr> live;
+    Expr current = make_zero(Int(64));
+
+    void visit(const For *op) override {
+        if (!is_device_loop(op)) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Allocate *op) override {
+        if (!is_heap_allocation(op)) {
+            IRVisitor::visit(op);
+            return;
+        }
+        Expr bytes = allocation_bytes(op);
+        live[op->name] = bytes;
+        current = simplify(current + bytes);
+        peak = simplify(max(peak, current));
+        op->body.accept(this);
+        auto iter = live.find(op->name);
+        if (iter != live.end()) {
+            current = simplify(current - bytes);
+            live.erase(iter);
+        }
+    }
+
+    void visit(const Free *op) override {
+        auto iter = live.find(op->name);
+        if (iter != live.end()) {
+            current = simplify(current - iter->second);
+            live.erase(iter);
+        }
+    }
+
+public:
+    Expr peak = make_zero(Int(64));
+};
+
+}  // namespace
+
+Stmt share_allocations(const Stmt &s) {
+    return ShareAllocations().mutate(s);
+}
+
+Expr peak_heap_memory(const Stmt &s) {
+    ComputePeakHeapMemory peak;
+    s.accept(&peak);
+    return peak.peak;
+}
+
+}  // namespace Internal
+}  // namespace Halide
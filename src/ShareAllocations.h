@@ -0,0 +1,28 @@
+#ifndef HALIDE_SHARE_ALLOCATIONS_H
+#define HALIDE_SHARE_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that lets heap allocations with disjoint
+ * lifetimes share memory.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Take a statement with early frees injected, and find heap
+ * allocations that begin after another heap allocation is freed. The
+ * later allocation reuses the memory of the earlier one, which is
+ * grown to fit both, and freed after the later one instead. */
+Stmt share_allocations(const Stmt &s);
+
+/** Compute the peak number of bytes of heap memory that a statement
+ * holds at once, as an expression. Allocations that reuse the memory
+ * of another one aren't counted. */
+Expr peak_heap_memory(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
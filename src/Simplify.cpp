@@ -144,8 +144,8 @@ void Simplify::ScopedFact::learn_false(const Expr &fact) {
 
 void Simplify::ScopedFact::learn_upper_bound(const Variable *v, int64_t val) {
     ConstBounds b;
-    if (simplify->bounds_info.contains(v->name)) {
-        b = simplify->bounds_info.get(v->name);
+    if (const ConstBounds *old = simplify->bounds_info.find(v->name)) {
+        b = *old;
     }
     if (b.max_defined && b.max < val) return;
     b.max_defined = true;
@@ -156,8 +156,8 @@ void Simplify::ScopedFact::learn_upper_bound(const Variable *v, int64_t val) {
 
 void Simplify::ScopedFact::learn_lower_bound(const Variable *v, int64_t val) {
     ConstBounds b;
-    if (simplify->bounds_info.contains(v->name)) {
-        b = simplify->bounds_info.get(v->name);
+    if (const ConstBounds *old = simplify->bounds_info.find(v->name)) {
+        b = *old;
     }
     if (b.min_defined && b.min > val) return;
     b.min_defined = true;
@@ -232,10 +232,49 @@ Simplify::ScopedFact::~ScopedFact() {
     }
 }
 
+namespace {
+
+// The innermost live SimplifyCache on this thread.
+thread_local SimplifyCache *current_simplify_cache = nullptr;
+
+// Don't let the cache grow without bound on very large pipelines.
+const size_t max_simplify_cache_size = 1 << 18;
+
+}  // namespace
+
+SimplifyCache::SimplifyCache() :
+    enclosing(current_simplify_cache), lookups(0), hits(0) {
+    current_simplify_cache = this;
+}
+
+SimplifyCache::~SimplifyCache() {
+    internal_assert(current_simplify_cache == this)
+        << "SimplifyCache destroyed out of order\n";
+    current_simplify_cache = enclosing;
+}
+
 Expr simplify(Expr e, bool remove_dead_lets,
               const Scope<Interval> &bounds,
               const Scope<ModulusRemainder> &alignment) {
-    return Simplify(remove_dead_lets, &bounds, &alignment).mutate(e, nullptr);
+    SimplifyCache *c = current_simplify_cache;
+    if (!c || !e.defined() || !remove_dead_lets ||
+        &bounds != &Scope<Interval>::empty_scope() ||
+        &alignment != &Scope<ModulusRemainder>::empty_scope()) {
+        return Simplify(remove_dead_lets, &bounds, &alignment).mutate(e, nullptr);
+    }
+
+    c->lookups++;
+    auto it = c->cache.find(e.get());
+    if (it != c->cache.end()) {
+        c->hits++;
+        return it->second.second;
+    }
+    Expr result = Simplify(remove_dead_lets, &bounds, &alignment).mutate(e, nullptr);
+    if (c->cache.size() >= max_simplify_cache_size) {
+        c->cache.clear();
+    }
+    c->cache.emplace(e.get(), std::make_pair(e, result));
+    return result;
 }
 
 Stmt simplify(Stmt s, bool remove_dead_lets,
@@ -5,6 +5,9 @@
  * Methods for simplifying halide statements and expressions
  */
 
+#include <map>
+#include <utility>
+
 #include "IR.h"
 #include "Bounds.h"
 #include "ModulusRemainder.h"
@@ -27,6 +30,41 @@ Expr simplify(Expr, bool remove_dead_lets = true,
               const Scope<ModulusRemainder> &alignment = Scope<ModulusRemainder>::empty_scope());
 // @}
 
+/** While an object of this type is alive, calls to simplify(Expr) on
+ * the same thread with no bounds or alignment information are
+ * memoized. IR nodes are immutable, and mutators return the same node
+ * for any part of the IR they don't change, so the cache is keyed on
+ * the identity of the Expr being simplified. This means expressions
+ * that survive several lowering passes are only simplified once. The
+ * cache holds a reference to each Expr it has seen, so a key can't be
+ * reused by a different node while the cache is alive. Caches nest;
+ * only the innermost one is used. */
+class SimplifyCache {
+    SimplifyCache *enclosing;
+    std::map<const IRNode *, std::pair<Expr, Expr>> cache;
+    int64_t lookups, hits;
+
+    friend Expr simplify(Expr, bool, const Scope<Interval> &, const Scope<ModulusRemainder> &);
+
+public:
+    SimplifyCache();
+    ~SimplifyCache();
+
+    SimplifyCache(const SimplifyCache &) = delete;
+    SimplifyCache &operator=(const SimplifyCache &) = delete;
+
+    /** The number of calls to simplify that looked in this cache,
+     * and the number of them that found their result there. */
+    // @{
+    int64_t num_lookups() const { return lookups; }
+    int64_t num_hits() const { return hits; }
+    // @}
+
+    /** Drop the memoized results, along with the references they hold
+     * to IR that may otherwise be dead. */
+    void clear() { cache.clear(); }
+};
+
 /** Attempt to statically prove an expression is true using the simplifier. */
 bool can_prove(Expr e, const Scope<Interval> &bounds = Scope<Interval>::empty_scope());
 
@@ -36,7 +36,12 @@ Expr Simplify::visit(const Add *op, ConstBounds *bounds) {
             return rewrite.result;
         }
 
-        if (EVAL_IN_LAMBDA
+        if (is_pattern_leaf(a) && is_pattern_leaf(b)) {
+            // Only the first rule below can match.
+            if (rewrite(x + x, x * 2)) {
+                return mutate(std::move(rewrite.result), bounds);
+            }
+        } else if (EVAL_IN_LAMBDA
             (rewrite(x + x, x * 2) ||
              rewrite(ramp(x, y) + ramp(z, w), ramp(x + z, y + w, lanes)) ||
              rewrite(ramp(x, y) + broadcast(z), ramp(x + z, y, lanes)) ||
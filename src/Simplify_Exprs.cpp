@@ -40,13 +40,12 @@ Expr Simplify::visit(const Broadcast *op, ConstBounds *bounds) {
 }
 
 Expr Simplify::visit(const Variable *op, ConstBounds *bounds) {
-    if (bounds_info.contains(op->name)) {
-        const ConstBounds &b = bounds_info.get(op->name);
+    if (const ConstBounds *b = bounds_info.find(op->name)) {
         if (bounds) {
-            *bounds = b;
+            *bounds = *b;
         }
-        if (b.min_defined && b.max_defined && b.min == b.max) {
-            return make_const(op->type, b.min);
+        if (b->min_defined && b->max_defined && b->min == b->max) {
+            return make_const(op->type, b->min);
         }
     }
 
@@ -161,6 +161,26 @@ public:
         return false;
     }
 
+    // True for nodes that no IRMatcher pattern looks inside: only
+    // the wildcards and constant wildcards can match them. When both
+    // operands of a binary op are leaves, the long rule chains in the
+    // visit methods can be cut down to the few rules that don't
+    // require a particular operand node type, before paying for a
+    // failed match attempt against every rule.
+    HALIDE_ALWAYS_INLINE
+    bool is_pattern_leaf(const Expr &e) {
+        switch (e.node_type()) {
+        case IRNodeType::IntImm:
+        case IRNodeType::UIntImm:
+        case IRNodeType::FloatImm:
+        case IRNodeType::Variable:
+        case IRNodeType::Load:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     std::set<Expr, IRDeepCompare> truths, falsehoods;
 
     struct ScopedFact {
@@ -243,6 +263,7 @@ public:
     Stmt visit(const Evaluate *op);
     Stmt visit(const ProducerConsumer *op);
     Stmt visit(const Block *op);
+    Stmt visit(const Fork *op);
     Stmt visit(const Realize *op);
     Stmt visit(const Prefetch *op);
     Stmt visit(const Free *op);
@@ -321,6 +321,22 @@ Stmt Simplify::visit(const Block *op) {
     }
 }
 
+Stmt Simplify::visit(const Fork *op) {
+    Stmt first = mutate(op->first);
+    Stmt rest = mutate(op->rest);
+
+    if (is_no_op(first)) {
+        return rest;
+    } else if (is_no_op(rest)) {
+        return first;
+    } else if (first.same_as(op->first) &&
+               rest.same_as(op->rest)) {
+        return op;
+    } else {
+        return Fork::make(first, rest);
+    }
+}
+
 Stmt Simplify::visit(const Realize *op) {
     Region new_bounds;
     bool bounds_changed;
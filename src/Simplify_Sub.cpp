@@ -32,7 +32,13 @@ Expr Simplify::visit(const Sub *op, ConstBounds *bounds) {
             return rewrite.result;
         }
 
-        if (EVAL_IN_LAMBDA
+        if (is_pattern_leaf(a) && is_pattern_leaf(b)) {
+            // Only the first two rules below can match.
+            if ((!op->type.is_uint() && rewrite(x - c0, x + fold(-c0), !overflows(-c0))) ||
+                rewrite(x - x, 0)) {
+                return mutate(std::move(rewrite.result), bounds);
+            }
+        } else if (EVAL_IN_LAMBDA
             ((!op->type.is_uint() && rewrite(x - c0, x + fold(-c0), !overflows(-c0))) ||
              rewrite(x - x, 0) || // We want to remutate this just to get better bounds
              rewrite(ramp(x, y) - ramp(z, w), ramp(x - z, y - w, lanes)) ||
@@ -347,6 +347,27 @@ class SlidingWindowOnFunction : public IRMutator2 {
         if (op->for_type == ForType::Serial ||
             op->for_type == ForType::Unrolled) {
             new_body = SlidingWindowOnFunctionAndLoop(func, op->name, op->min).mutate(new_body);
+        } else if (op->for_type == ForType::Parallel &&
+                   func.schedule().slide_task_size().defined()) {
+            // Split the loop into tasks, and slide along the
+            // iterations within each one. Each task starts by
+            // computing the whole footprint.
+            Expr task_size = func.schedule().slide_task_size();
+            string task_name = op->name + ".task";
+            string task_min_name = op->name + ".task_min";
+            Expr task_min = Variable::make(Int(32), task_min_name);
+            Stmt slid = SlidingWindowOnFunctionAndLoop(func, op->name, task_min).mutate(new_body);
+            if (!slid.same_as(new_body)) {
+                debug(3) << "Sliding " << func.name() << " within tasks of "
+                         << task_size << " iterations of " << op->name << "\n";
+                Expr task = Variable::make(Int(32), task_name);
+                Expr task_extent = min(task_size, op->min + op->extent - task_min);
+                Stmt s = For::make(op->name, task_min, task_extent,
+                                   ForType::Serial, op->device_api, slid);
+                s = LetStmt::make(task_min_name, op->min + task * task_size, s);
+                Expr num_tasks = (op->extent + task_size - 1) / task_size;
+                return For::make(task_name, 0, num_tasks, ForType::Parallel, op->device_api, s);
+            }
         }
 
         if (new_body.same_as(op->body)) {
@@ -377,9 +398,12 @@ class SlidingWindow : public IRMutator2 {
         }
 
         // If the Function in question has the same compute_at level
-        // as its store_at level, skip it.
+        // as its store_at level, skip it. Ring buffered Funcs don't
+        // keep values from one iteration to the next, so skip those
+        // too.
         const FuncSchedule &sched = iter->second.schedule();
-        if (sched.compute_level() == sched.store_level()) {
+        if (sched.compute_level() == sched.store_level() ||
+            sched.ring_buffer().defined()) {
             return IRMutator2::visit(op);
         }
 
@@ -0,0 +1,195 @@
+#include "Sort.h"
+#include "ExprUsesVar.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Each value being sorted, as one Expr per Tuple element. Element
+// zero is the key.
+typedef vector<Expr> Element;
+
+Element element_of(FuncRef ref, int outputs) {
+    if (outputs == 1) {
+        return {Expr(ref)};
+    }
+    Element e;
+    for (int i = 0; i < outputs; i++) {
+        e.push_back(ref[i]);
+    }
+    return e;
+}
+
+// One half of a compare-exchange. The lower position keeps the smaller
+// key and the upper one the larger. On equal keys neither moves, so
+// the values carried along are permuted consistently.
+Element compare_exchange(const Element &self, const Element &other, Expr is_lower) {
+    if (self.size() == 1) {
+        return {select(is_lower, min(self[0], other[0]), max(self[0], other[0]))};
+    }
+    Expr take_other = select(is_lower, other[0] < self[0], self[0] < other[0]);
+    Element result;
+    for (size_t i = 0; i < self.size(); i++) {
+        result.push_back(select(take_other, other[i], self[i]));
+    }
+    return result;
+}
+
+Element compare_exchange(const Element &self, const Element &other, bool is_lower) {
+    if (self.size() == 1) {
+        return {is_lower ? min(self[0], other[0]) : max(self[0], other[0])};
+    }
+    Expr take_other = is_lower ? other[0] < self[0] : self[0] < other[0];
+    Element result;
+    for (size_t i = 0; i < self.size(); i++) {
+        result.push_back(select(take_other, other[i], self[i]));
+    }
+    return result;
+}
+
+// The passes of a bitonic network that sorts in ascending order
+// without direction flags. Each is a chunk size, and whether the pass
+// compares mirrored positions within chunks of twice that size
+// instead of positions one chunk apart.
+vector<std::pair<int, bool>> bitonic_passes(int n) {
+    vector<std::pair<int, bool>> passes;
+    for (int pass_size = 1; pass_size < n; pass_size <<= 1) {
+        for (int chunk_size = pass_size; chunk_size > 0; chunk_size >>= 1) {
+            passes.push_back({chunk_size, chunk_size == pass_size && pass_size > 1});
+        }
+    }
+    return passes;
+}
+
+}  // namespace
+
+Func sort(Func input, int size, DeviceAPI device, const string &name) {
+    user_assert(input.defined())
+        << "Can't sort undefined Func " << input.name() << "\n";
+    user_assert(size > 0)
+        << "Can't sort Func " << input.name() << " over a size of " << size << "\n";
+
+    int n = 1;
+    while (n < size) {
+        n *= 2;
+    }
+
+    const int outputs = input.outputs();
+    const Type key_type = input.output_types()[0];
+    vector<Var> args = input.args();
+    Var x = args[0];
+    vector<Expr> rest(args.begin() + 1, args.end());
+    auto at = [&](Func f, Expr i) {
+        vector<Expr> a = {i};
+        a.insert(a.end(), rest.begin(), rest.end());
+        return element_of(f(a), outputs);
+    };
+
+    // Read element i, padding past the end with the largest key.
+    auto read = [&](Expr i) {
+        Element e = at(input, n == size ? i : min(i, size - 1));
+        if (n != size) {
+            e[0] = select(i < size, e[0], key_type.max());
+        }
+        return e;
+    };
+
+    Func result(name);
+    auto define = [&](Func f, const Element &e) {
+        if (outputs == 1) {
+            f(args) = e[0];
+        } else {
+            f(args) = Tuple(e);
+        }
+    };
+
+    if (n <= 16) {
+        // Run the network on Exprs. Every intermediate value is bound
+        // to a Let, so the expression stays linear in the number of
+        // compare-exchanges.
+        vector<Element> values(n);
+        for (int i = 0; i < n; i++) {
+            values[i] = read(i);
+        }
+        vector<std::pair<string, Expr>> lets;
+        for (const auto &pass : bitonic_passes(n)) {
+            int chunk = pass.first;
+            int mask = pass.second ? 2 * chunk - 1 : chunk;
+            vector<Element> next(n);
+            for (int i = 0; i < n; i++) {
+                next[i] = compare_exchange(values[i], values[i ^ mask], (i & chunk) == 0);
+                for (Expr &v : next[i]) {
+                    string var = Internal::unique_name('t');
+                    lets.push_back({var, v});
+                    v = Internal::Variable::make(v.type(), var);
+                }
+            }
+            values.swap(next);
+        }
+
+        // Select the element for the requested position.
+        Element e = values[n - 1];
+        for (int i = n - 2; i >= 0; i--) {
+            for (int k = 0; k < outputs; k++) {
+                e[k] = select(x == i, values[i][k], e[k]);
+            }
+        }
+        for (Expr &v : e) {
+            for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+                if (Internal::expr_uses_var(v, it->first)) {
+                    v = Internal::Let::make(it->first, it->second, v);
+                }
+            }
+        }
+        define(result, e);
+        return result;
+    }
+
+    Func padded(name + "_padded");
+    define(padded, read(x));
+
+    Func prev = padded;
+    for (const auto &pass : bitonic_passes(n)) {
+        int chunk = pass.first;
+        Expr chunk_start = (x / (2 * chunk)) * (2 * chunk);
+        Expr chunk_middle = chunk_start + chunk;
+        Expr partner;
+        if (pass.second) {
+            partner = 2 * chunk_middle - x - 1;
+        } else {
+            partner = chunk_start + (x - chunk_start + chunk) % (2 * chunk);
+        }
+        // The clamp helps out bounds inference
+        partner = clamp(partner, chunk_start, chunk_start + 2 * chunk - 1);
+
+        Func next(name + "_pass");
+        define(next, compare_exchange(at(prev, x), at(prev, partner), x < chunk_middle));
+
+        next.compute_root().bound(x, 0, n);
+        Var xo, xi;
+        if (device != DeviceAPI::Host) {
+            next.gpu_tile(x, xo, xi, std::min(n, 64), TailStrategy::Auto, device);
+            if (!rest.empty()) {
+                next.gpu_blocks(args.back(), device);
+            }
+        } else {
+            if (!rest.empty()) {
+                next.parallel(args.back());
+            } else if (n >= 8192) {
+                next.split(x, xo, x, 1024).parallel(xo);
+            }
+            next.vectorize(x, 8);
+        }
+        prev = next;
+    }
+
+    define(result, at(prev, x));
+    return result;
+}
+
+}  // namespace Halide
@@ -0,0 +1,47 @@
+#ifndef HALIDE_SORT_H
+#define HALIDE_SORT_H
+
+/** \file
+ * Defines a library-level sort of a Func along its first dimension.
+ */
+
+#include <string>
+
+#include "Func.h"
+
+namespace Halide {
+
+/** Returns a Func holding the values of the input sorted in ascending
+ * order along its first dimension, over the range [0, size). The
+ * remaining dimensions are independent: each row, column, or pixel
+ * neighborhood is sorted separately. If the input is Tuple-valued,
+ * the first element is the key and the other elements are carried
+ * along with it, so this also sorts key-value pairs. The sort is not
+ * stable.
+ *
+ * The sort is a bitonic sorting network over the size rounded up to a
+ * power of two, padded with the largest value of the key type. For
+ * sizes up to 16 the network is built as a single expression, with
+ * no intermediate Funcs, so it vectorizes across the other
+ * dimensions when the result is scheduled to. For example, a 3x3
+ * median filter:
+ \code
+ Func window, sorted, median;
+ window(i, x, y) = input(x + i % 3 - 1, y + i / 3 - 1);
+ sorted = sort(window, 9);
+ median(x, y) = sorted(4, x, y);
+ median.vectorize(x, 8);
+ \endcode
+ *
+ * For larger sizes each pass of the network is a separate Func
+ * computed at root. The passes are vectorized along the sorted
+ * dimension and parallelized across the outermost remaining one, or
+ * across chunks of the sorted dimension when there are no other
+ * dimensions. If device is a GPU API, each pass instead runs as a GPU
+ * kernel, tiled along the sorted dimension. */
+Func sort(Func input, int size, DeviceAPI device = DeviceAPI::Host,
+          const std::string &name = "sort");
+
+}  // namespace Halide
+
+#endif
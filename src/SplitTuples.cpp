@@ -56,9 +56,33 @@ class SplitTuples : public IRMutator2 {
 
     map<string, set<int>> func_value_indices;
 
+    // The name of the buffer holding the given element of a Tuple
+    // Func, and the coordinates of the element in it. Interleaved
+    // Funcs have a single buffer with the element index as an extra
+    // innermost dimension.
+    string element_name(const string &name, int idx) const {
+        return name + "." + std::to_string(interleaved.contains(name) ? 0 : idx);
+    }
+
+    vector<Expr> element_args(const string &name, int idx, vector<Expr> args) const {
+        if (interleaved.contains(name)) {
+            args.insert(args.begin(), idx);
+        }
+        return args;
+    }
+
     Stmt visit(const Realize *op) override {
         ScopedBinding<int> bind(realizations, op->name, 0);
-        if (op->types.size() > 1) {
+        auto it = env.find(op->name);
+        if (op->types.size() > 1 &&
+            it != env.end() &&
+            it->second.schedule().store_interleaved()) {
+            ScopedBinding<> bind_interleaved(interleaved, op->name);
+            Stmt body = mutate(op->body);
+            Region bounds = op->bounds;
+            bounds.insert(bounds.begin(), Range(0, (int)op->types.size()));
+            return Realize::make(op->name + ".0", {op->types[0]}, op->memory_type, bounds, op->condition, body);
+        } else if (op->types.size() > 1) {
             // Make a nested set of realize nodes for each tuple element
             Stmt body = mutate(op->body);
             for (int i = (int)op->types.size() - 1; i >= 0; i--) {
@@ -91,6 +115,13 @@ class SplitTuples : public IRMutator2 {
             const auto &indices = func_value_indices.find(op->name);
             internal_assert(indices != func_value_indices.end());
 
+            if (interleaved.contains(op->name)) {
+                // Prefetch the elements used, which are adjacent.
+                int lo = *indices->second.begin(), hi = *indices->second.rbegin();
+                Region bounds = op->bounds;
+                bounds.insert(bounds.begin(), Range(lo, hi - lo + 1));
+                return Prefetch::make(op->name + ".0", {op->types[0]}, bounds, op->prefetch, op->condition, body);
+            }
             for (const auto &idx : indices->second) {
                 internal_assert(idx < (int)op->types.size());
                 body = Prefetch::make(op->name + "." + std::to_string(idx), {op->types[(idx)]}, op->bounds, op->prefetch, op->condition, body);
@@ -107,13 +138,14 @@ class SplitTuples : public IRMutator2 {
             internal_assert(it != env.end());
             Function f = it->second;
             string name = op->name;
-            if (f.outputs() > 1) {
-                name += "." + std::to_string(op->value_index);
-            }
             vector<Expr> args;
             for (Expr e : op->args) {
                 args.push_back(mutate(e));
             }
+            if (f.outputs() > 1) {
+                name = element_name(op->name, op->value_index);
+                args = element_args(op->name, op->value_index, args);
+            }
             // It's safe to hook up the pointer to the function
             // unconditionally. This expr never gets held by a
             // Function, so there can't be a cycle. We do this even
@@ -166,14 +198,14 @@ class SplitTuples : public IRMutator2 {
         vector<pair<string, Expr>> lets;
 
         for (size_t i = 0; i < op->values.size(); i++) {
-            string name = op->name + "." + std::to_string(i);
-            string var_name = name + ".value";
+            string var_name = op->name + "." + std::to_string(i) + ".value";
             Expr val = mutate(op->values[i]);
             if (!is_undef(val) && atomic) {
                 lets.push_back({ var_name, val });
                 val = Variable::make(val.type(), var_name);
             }
-            provides.push_back(Provide::make(name, {val}, args));
+            provides.push_back(Provide::make(element_name(op->name, i), {val},
+                                             element_args(op->name, i, args)));
         }
 
         Stmt result = Block::make(provides);
@@ -189,6 +221,7 @@ class SplitTuples : public IRMutator2 {
 
     const map<string, Function> &env;
     Scope<int> realizations;
+    Scope<> interleaved;
 
 public:
 
@@ -4,8 +4,12 @@
 #include "Scope.h"
 
 #include <iterator>
+#include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <regex>
+#include <set>
 #include <sstream>
 #include <stdio.h>
 
@@ -22,6 +26,161 @@ std::string to_string(T value) {
     return os.str() ;
 }
 
+// Measured times read from a profile.
+struct ProfileData {
+    // Time per Func, from a Halide profiler report.
+    std::map<string, double> func_time;
+    // Time per symbol, from a perf report. Parallel loop bodies are
+    // symbols of their own, named after the loop.
+    std::map<string, double> symbol_time;
+    // The units the times are in.
+    string units;
+    double total = 0;
+};
+
+ProfileData parse_profile(const string &filename) {
+    std::ifstream f(filename.c_str());
+    user_assert(f.good()) << "Could not open profile " << filename << "\n";
+    std::stringstream contents;
+    contents << f.rdbuf();
+    string text = contents.str();
+
+    ProfileData profile;
+    std::smatch match;
+    if (text.find("\"pipelines\"") != string::npos) {
+        // halide_profiler_report_json. Only the per-Func entries carry
+        // an active_threads field right after the time.
+        profile.units = "ms";
+        std::regex entry("\\{\"name\": \"([^\"]*)\", \"time_ns\": ([0-9]+), \"active_threads\"");
+        for (std::sregex_iterator it(text.begin(), text.end(), entry), end; it != end; ++it) {
+            profile.func_time[(*it)[1]] += std::stod((*it)[2]) / 1000000.0;
+        }
+    } else {
+        // halide_profiler_report prints a line per Func like
+        // "  f:  1.23ms  (45%) ...". perf prints a line per symbol
+        // like "  45.67%  app  app  [.] par_for_f_f.s0.y".
+        std::regex func_line("^  ([^ ].*?):\\s+([0-9.eE+-]+)ms\\s+\\(.*");
+        std::regex perf_line("^\\s*([0-9.]+)%.*\\[.\\]\\s+(\\S+).*");
+        std::istringstream lines(text);
+        string line;
+        while (std::getline(lines, line)) {
+            if (std::regex_match(line, match, func_line)) {
+                profile.units = "ms";
+                profile.func_time[match[1]] += std::stod(match[2]);
+            } else if (std::regex_match(line, match, perf_line)) {
+                profile.units = "%";
+                profile.symbol_time[match[2]] += std::stod(match[1]);
+            }
+        }
+    }
+    for (const auto &t : profile.func_time) {
+        profile.total += t.second;
+    }
+    for (const auto &t : profile.symbol_time) {
+        profile.total += t.second;
+    }
+    user_assert(profile.total > 0) << "Found no timings in profile " << filename << "\n";
+    return profile;
+}
+
+// The Func a loop belongs to. Loops are named func.s<stage>.var...
+string loop_owner(const string &loop) {
+    for (size_t i = loop.find(".s"); i != string::npos; i = loop.find(".s", i + 1)) {
+        size_t j = i + 2;
+        while (j < loop.size() && isdigit(loop[j])) j++;
+        if (j > i + 2 && j < loop.size() && loop[j] == '.') {
+            return loop.substr(0, i);
+        }
+    }
+    return "";
+}
+
+class CollectLoopNames : public IRVisitor {
+    using IRVisitor::visit;
+    void visit(const For *op) {
+        names.insert(op->name);
+        IRVisitor::visit(op);
+    }
+public:
+    std::set<string> names;
+};
+
+// Work out the time spent in each loop and produce node, including
+// everything nested inside it.
+class ComputeProfileTimes : public IRVisitor {
+    const ProfileData &profile;
+    // Time attributed to the loops themselves, from perf symbols.
+    std::map<string, double> loop_time;
+    // Time found so far in the subtree being visited.
+    double current = 0;
+
+    double func_time(const string &name) {
+        auto it = profile.func_time.find(name);
+        return it == profile.func_time.end() ? 0 : it->second;
+    }
+
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) {
+        double outer = current;
+        current = 0;
+        IRVisitor::visit(op);
+        if (op->is_producer) {
+            current += func_time(op->name);
+        }
+        times[op] = current;
+        current += outer;
+    }
+
+    void visit(const For *op) {
+        double outer = current;
+        current = 0;
+        IRVisitor::visit(op);
+        auto it = loop_time.find(op->name);
+        if (it != loop_time.end()) {
+            current += it->second;
+        }
+        // The profiler doesn't break a Func's time down by loop, so
+        // each loop of a Func is shown with all of it.
+        times[op] = current + func_time(loop_owner(op->name));
+        current += outer;
+    }
+
+public:
+    std::map<const IRNode *, double> times;
+
+    ComputeProfileTimes(const ProfileData &p, const std::set<string> &loops) : profile(p) {
+        // Attribute each symbol to the longest loop name it contains.
+        for (const auto &sym : profile.symbol_time) {
+            const string *best = nullptr;
+            for (const string &l : loops) {
+                if (sym.first.find(l) != string::npos &&
+                    (!best || l.size() > best->size())) {
+                    best = &l;
+                }
+            }
+            if (best) {
+                loop_time[*best] += sym.second;
+            }
+        }
+    }
+};
+
+// The widest vector stored or loaded in a Stmt.
+class MaxVectorWidth : public IRVisitor {
+    using IRVisitor::visit;
+    void visit(const Load *op) {
+        width = std::max(width, op->type.lanes());
+        IRVisitor::visit(op);
+    }
+    void visit(const Store *op) {
+        width = std::max(width, op->value.type().lanes());
+        IRVisitor::visit(op);
+    }
+public:
+    int width = 1;
+};
+
 class StmtToHtml : public IRVisitor {
 
     static const std::string css, js;
@@ -32,6 +191,39 @@ class StmtToHtml : public IRVisitor {
 private:
     std::ofstream stream;
 
+    // The profile to color the loop nest with, if any.
+    const ProfileData *profile;
+    std::map<const IRNode *, double> profile_times;
+    // The total trip count of the enclosing loop, or -1 if it isn't
+    // a constant.
+    int64_t trip_count;
+
+    string profile_annotation(const IRNode *op, int64_t trips = 0, int width = 1) {
+        if (!profile) return "";
+        auto it = profile_times.find(op);
+        double t = it == profile_times.end() ? 0 : it->second;
+        double fraction = t / profile->total;
+        std::stringstream s;
+        s << std::setprecision(3);
+        s << " <span class='Profile' style='background-color: rgba(255, 64, 0, "
+          << 0.05 + 0.8 * fraction << ");'>";
+        if (profile->units == "%") {
+            s << t << "%";
+        } else {
+            s << t << profile->units << " (" << (int)(100 * fraction) << "%)";
+        }
+        if (trips > 0) {
+            s << " trips: " << trips;
+        } else if (trips < 0) {
+            s << " trips: ?";
+        }
+        if (width > 1) {
+            s << " vector width: " << width;
+        }
+        s << "</span>";
+        return s.str();
+    }
+
     int unique_id() { return ++id_count; }
 
     // All spans and divs will have an id of the form "x-y", where x
@@ -334,6 +526,9 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();;
+        if (op->is_producer) {
+            stream << profile_annotation(op);
+        }
         stream << open_div(op->is_producer ? "ProduceBody Indent" : "ConsumeBody Indent", produce_id);
         print(op->body);
         stream << close_div();
@@ -371,10 +566,23 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        int64_t outer_trip_count = trip_count;
+        if (profile) {
+            const int64_t *extent = as_const_int(op->extent);
+            if (extent && trip_count >= 0) {
+                trip_count *= *extent;
+            } else {
+                trip_count = -1;
+            }
+            MaxVectorWidth width;
+            op->body.accept(&width);
+            stream << profile_annotation(op, trip_count, width.width);
+        }
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
         stream << matched("}");
+        trip_count = outer_trip_count;
 
         stream << close_div();
         scope.pop(op->name);
@@ -521,6 +729,27 @@ private:
         visit_block_stmt(op->rest);
         stream << close_div();
     }
+    void visit(const Fork *op) {
+        stream << open_div("Fork");
+        int id = unique_id();
+        stream << open_expand_button(id);
+        stream << open_span("Matched");
+        stream << keyword("fork") << " ";
+        stream << close_expand_button();
+        stream << matched("{");
+        stream << close_span();
+        stream << open_div("ForkBody Indent", id);
+        print(op->first);
+        stream << close_div();
+        stream << matched("}");
+        stream << " ";
+        stream << matched("{");
+        stream << open_div("ForkBody Indent", unique_id());
+        print(op->rest);
+        stream << close_div();
+        stream << matched("}");
+        stream << close_div();
+    }
     void visit(const IfThenElse *op) {
         stream << open_div("IfThenElse");
         int id = unique_id();
@@ -672,7 +901,20 @@ public:
         scope.pop(m.name());
     }
 
-    StmtToHtml(string filename) : id_count(0), context_stack(1, 0) {
+    StmtToHtml(string filename, const ProfileData *profile = nullptr, const Module *m = nullptr) :
+        id_count(0), profile(profile), trip_count(1), context_stack(1, 0) {
+        if (profile) {
+            CollectLoopNames loops;
+            for (const auto &f : m->functions()) {
+                f.body.accept(&loops);
+            }
+            ComputeProfileTimes times(*profile, loops.names);
+            for (const auto &f : m->functions()) {
+                f.body.accept(&times);
+            }
+            profile_times = std::move(times.times);
+        }
+
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -713,6 +955,7 @@ span.IntImm { color: #099; }\n \
 span.FloatImm { color: #099; }\n \
 b.Highlight { font-weight: bold; background-color: #DDD; }\n \
 span.Highlight { font-weight: bold; background-color: #FF0; }\n \
+span.Profile { color: #333; font-style: italic; padding: 0px 4px; }\n \
 ";
 
 const std::string StmtToHtml::js = "\n \
@@ -743,5 +986,11 @@ void print_to_html(string filename, const Module &m) {
     sth.print(m);
 }
 
+void print_to_html(string filename, const Module &m, const string &profile_filename) {
+    ProfileData profile = parse_profile(profile_filename);
+    StmtToHtml sth(filename, &profile, &m);
+    sth.print(m);
+}
+
 }
 }
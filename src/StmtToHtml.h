@@ -18,6 +18,14 @@ void print_to_html(std::string filename, Stmt s);
 /** Dump an HTML-formatted print of a Module to filename. */
 void print_to_html(std::string filename, const Module &m);
 
+/** Dump an HTML-formatted print of a Module to filename, with each
+ * loop and produce node colored by the time measured in it. The
+ * profile file holds the output of the Halide profiler (either
+ * halide_profiler_report or halide_profiler_report_json), or of "perf
+ * report --stdio --no-children". Loops are also annotated with their
+ * trip counts and vector widths. */
+void print_to_html(std::string filename, const Module &m, const std::string &profile_filename);
+
 }  // namespace Internal
 }  // namespace Halide
 
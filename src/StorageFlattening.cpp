@@ -1,11 +1,13 @@
 #include "StorageFlattening.h"
 
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "FuseGPUThreadLoops.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Parameter.h"
 #include "Scope.h"
+#include "Simplify.h"
 
 #include <sstream>
 
@@ -21,6 +23,137 @@ using std::set;
 
 namespace {
 
+// The temporal locality argument of a prefetch call, from 3 (keep in
+// all levels of the cache) down to 0 (no temporal locality).
+int prefetch_locality(PrefetchHint hint) {
+    switch (hint) {
+    case PrefetchHint::L1:
+        return 3;
+    case PrefetchHint::L2:
+        return 2;
+    case PrefetchHint::L3:
+        return 1;
+    case PrefetchHint::NonTemporal:
+        return 0;
+    }
+    return 3;
+}
+
+class UsesDevice : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->device_api != DeviceAPI::Host &&
+            op->device_api != DeviceAPI::None) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+bool uses_device(const Stmt &s) {
+    UsesDevice uses;
+    s.accept(&uses);
+    return uses.result;
+}
+
+// Detects accesses to a Func in which adjacent GPU threads in x touch
+// the same element of one dimension of its storage and different
+// elements of others, i.e. threads of a warp walk down a column.
+class AccessedByColumn : public IRVisitor {
+    const string &func;
+    int innermost;
+    Scope<> thread_x_vars;
+
+    using IRVisitor::visit;
+
+    void check(const vector<Expr> &args) {
+        if ((int)args.size() <= innermost ||
+            expr_uses_vars(args[innermost], thread_x_vars)) {
+            return;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            if ((int)i != innermost && expr_uses_vars(args[i], thread_x_vars)) {
+                result = true;
+            }
+        }
+    }
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->name == func) {
+            check(op->args);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Provide *op) override {
+        if (op->name == func) {
+            check(op->args);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        if (op->for_type == ForType::GPUThread && ends_with(op->name, ".__thread_id_x")) {
+            ScopedBinding<> bind(thread_x_vars, op->name);
+            op->body.accept(this);
+        } else {
+            op->body.accept(this);
+        }
+    }
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        ScopedBinding<> bind(expr_uses_vars(op->value, thread_x_vars), thread_x_vars, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+public:
+    bool result = false;
+    AccessedByColumn(const string &func, int innermost)
+        : func(func), innermost(innermost) {}
+};
+
+bool accessed_by_column(const Stmt &s, const string &func, int innermost) {
+    AccessedByColumn v(func, innermost);
+    s.accept(&v);
+    return v.result;
+}
+
+// Shared memory is split into 32 banks of 4-byte words. When the
+// threads of a warp read down a column of storage whose rows are an
+// even number of words long, several of them land in the same bank
+// and the reads are serialized. Padding each row by a word makes the
+// row length odd, which spreads a column across all the banks. Returns
+// the padding to use, in elements, for rows of the given extent.
+Expr bank_conflict_padding(Type t, const Expr &extent) {
+    int bytes = t.bytes();
+    Expr padding;
+    if (bytes <= 4) {
+        padding = select((extent * bytes) % 8 == 0, 4 / bytes, 0);
+    } else if (bytes == 8) {
+        padding = select(extent % 2 == 0, 1, 0);
+    } else {
+        return Expr();
+    }
+    return simplify(padding);
+}
+
 class FlattenDimensions : public IRMutator2 {
 public:
     FlattenDimensions(const map<string, pair<Function, int>> &e,
@@ -30,6 +163,12 @@ public:
         for (auto &f : o) {
             outputs.insert(f.name());
         }
+        for (const auto &p : env) {
+            const string &producer = p.second.first.schedule().in_place_of();
+            if (!producer.empty()) {
+                in_place_producers.insert(producer);
+            }
+        }
     }
 private:
     const map<string, pair<Function, int>> &env;
@@ -37,6 +176,13 @@ private:
     const Target &target;
     Scope<> realizations, shader_scope_realizations;
     bool in_shader = false;
+    bool in_gpu_block = false, in_gpu_thread = false;
+
+    // The Funcs that other Funcs are stored in place of, and the ones
+    // of those being realized that aren't used on a device, so their
+    // host storage can be shared.
+    set<string> in_place_producers;
+    Scope<> host_only_producers;
 
     Expr make_shape_var(string name, string field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
@@ -103,6 +249,22 @@ private:
     using IRMutator2::visit;
 
     Stmt visit(const Realize *op) override {
+        string in_place_of;
+        {
+            auto iter = env.find(op->name);
+            if (iter != env.end()) {
+                in_place_of = iter->second.first.schedule().in_place_of();
+            }
+        }
+        bool in_place = !in_place_of.empty() && host_only_producers.contains(in_place_of);
+        if (!in_place_of.empty() && !in_place) {
+            user_warning << "Func " << op->name << " can't be stored in place of "
+                         << in_place_of << " because one of them is used on a device.\n";
+        }
+
+        bool host_only = in_place_producers.count(op->name) && !uses_device(op->body);
+        ScopedBinding<> bind_host_only(host_only, host_only_producers, op->name);
+
         realizations.push(op->name);
 
         if (in_shader) {
@@ -137,19 +299,55 @@ private:
             Function f = iter->second.first;
             const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
             const vector<string> &args = f.args();
+            // The Tuple elements of an interleaved Func are an extra
+            // innermost dimension.
+            int first = 0;
+            if (f.outputs() > 1 && f.schedule().store_interleaved()) {
+                storage_permutation.push_back(0);
+                allocation_extents[0] = extents[0];
+                first = 1;
+            }
             for (size_t i = 0; i < storage_dims.size(); i++) {
                 for (size_t j = 0; j < args.size(); j++) {
                     if (args[j] == storage_dims[i].var) {
-                        storage_permutation.push_back((int)j);
+                        int k = first + (int)j;
+                        storage_permutation.push_back(k);
                         Expr alignment = storage_dims[i].alignment;
                         if (alignment.defined()) {
-                            allocation_extents[j] = ((extents[j] + alignment - 1)/alignment)*alignment;
+                            allocation_extents[k] = ((extents[k] + alignment - 1)/alignment)*alignment;
                         } else {
-                            allocation_extents[j] = extents[j];
+                            allocation_extents[k] = extents[k];
+                        }
+                        Expr padding = storage_dims[i].padding;
+                        if (padding.defined()) {
+                            allocation_extents[k] += padding;
                         }
                     }
                 }
-                internal_assert(storage_permutation.size() == i+1);
+                internal_assert((int)storage_permutation.size() == first + (int)i + 1);
+            }
+            if (f.schedule().ring_buffer().defined()) {
+                // The ring of tiles is an extra outermost dimension.
+                int ring_dim = first + (int)storage_dims.size();
+                internal_assert(ring_dim + 1 == (int)extents.size());
+                storage_permutation.push_back(ring_dim);
+                allocation_extents[ring_dim] = extents[ring_dim];
+            }
+
+            // Pad the rows of shared memory allocations that are read
+            // by column, unless the schedule says how to pad them.
+            bool shared = (op->memory_type == MemoryType::GPUShared ||
+                           (op->memory_type == MemoryType::Auto && in_gpu_block && !in_gpu_thread));
+            if (shared && first == 0 && storage_dims.size() > 1 &&
+                !storage_dims[0].padding.defined()) {
+                int k = storage_permutation[0];
+                Expr padding = bank_conflict_padding(op->types[0], allocation_extents[k]);
+                if (padding.defined() && !is_zero(padding) &&
+                    accessed_by_column(op->body, op->name, k)) {
+                    debug(3) << "Padding the rows of " << op->name
+                             << " to avoid shared memory bank conflicts\n";
+                    allocation_extents[k] += padding;
+                }
             }
         }
 
@@ -186,6 +384,35 @@ private:
         }
         stmt = LetStmt::make(op->name + ".buffer", builder.build(), stmt);
 
+        if (in_place) {
+            // Use the layout of the producer, which covers the region
+            // of this Func, and its host storage.
+            Expr span = 1;
+            Expr fits = const_true();
+            for (int i = 0; i < dims; i++) {
+                string d = std::to_string(i);
+                Expr producer_min = Variable::make(Int(32), in_place_of + ".min." + d);
+                Expr producer_extent = Variable::make(Int(32), in_place_of + ".extent." + d);
+                Expr producer_stride = Variable::make(Int(32), in_place_of + ".stride." + d);
+                span += (producer_extent - 1) * producer_stride;
+                fits = fits && (producer_min <= op->bounds[i].min &&
+                                op->bounds[i].min + extents[i] <= producer_min + producer_extent);
+            }
+            stmt = Allocate::make(op->name, op->types[0], op->memory_type, {span}, condition, stmt,
+                                  Variable::make(Handle(), in_place_of), "halide_device_host_nop_free");
+            for (int i = dims; i > 0; i--) {
+                string d = std::to_string(i - 1);
+                stmt = LetStmt::make(stride_name[i-1], Variable::make(Int(32), in_place_of + ".stride." + d), stmt);
+                stmt = LetStmt::make(min_name[i-1], Variable::make(Int(32), in_place_of + ".min." + d), stmt);
+                stmt = LetStmt::make(extent_name[i-1], Variable::make(Int(32), in_place_of + ".extent." + d), stmt);
+            }
+            Expr error = Call::make(Int(32), "halide_error_requirement_failed",
+                                    {op->name + " fits in " + in_place_of,
+                                     "The region of " + op->name + " is outside the storage it shares with " + in_place_of},
+                                    Call::Extern);
+            return Block::make(AssertStmt::make(fits, error), stmt);
+        }
+
         // Make the allocation node
         stmt = Allocate::make(op->name, op->types[0], op->memory_type, allocation_extents, condition, stmt);
 
@@ -315,7 +542,8 @@ private:
 
         Expr base_offset = mutate(flatten_args(op->name, prefetch_min, Buffer<>(), op->prefetch.param));
         Expr base_address = Variable::make(Handle(), op->name);
-        vector<Expr> args = {base_address, base_offset};
+        Expr locality = prefetch_locality(op->prefetch.hint);
+        vector<Expr> args = {base_address, base_offset, locality};
 
         auto iter = env.find(op->name);
         if (iter != env.end()) {
@@ -364,6 +592,8 @@ private:
             op->device_api == DeviceAPI::GLSL) {
             in_shader = true;
         }
+        ScopedValue<bool> old_in_gpu_block(in_gpu_block, in_gpu_block || op->for_type == ForType::GPUBlock);
+        ScopedValue<bool> old_in_gpu_thread(in_gpu_thread, in_gpu_thread || op->for_type == ForType::GPUThread);
         Stmt stmt = IRMutator2::visit(op);
         in_shader = old_in_shader;
         return stmt;
@@ -51,6 +51,63 @@ int count_producers(Stmt in, const std::string &name) {
     return counter.count;
 }
 
+// Check whether the produce and consume nodes for a func occur once
+// per iteration of the loop containing them, i.e. not inside any
+// inner loops.
+class ProducerConsumerNotInInnerLoop : public IRVisitor {
+    const std::string &name;
+    bool in_loop = false;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+        bool old_in_loop = in_loop;
+        in_loop = true;
+        IRVisitor::visit(op);
+        in_loop = old_in_loop;
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name == name && in_loop) {
+            result = false;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = true;
+    ProducerConsumerNotInInnerLoop(const std::string &name) : name(name) {}
+};
+
+// For async funcs, make the producer wait for enough free space in
+// the fold before producing, and make the consumer release the space
+// it is done with after consuming.
+class InjectFoldingSemaphore : public IRMutator2 {
+    const std::string &func;
+    Expr sema, to_acquire, to_release;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->name != func) {
+            return IRMutator2::visit(op);
+        }
+        Stmt body;
+        if (op->is_producer) {
+            Expr acquire = Call::make(Int(32), "halide_semaphore_acquire", {sema, to_acquire}, Call::Extern);
+            body = Block::make(Evaluate::make(acquire), op->body);
+        } else {
+            Expr release = Call::make(Int(32), "halide_semaphore_release", {sema, to_release}, Call::Extern);
+            body = Block::make(op->body, Evaluate::make(release));
+        }
+        return ProducerConsumer::make(op->name, op->is_producer, body);
+    }
+
+public:
+    InjectFoldingSemaphore(const std::string &func, Expr sema, Expr to_acquire, Expr to_release) :
+        func(func), sema(sema), to_acquire(to_acquire), to_release(to_release) {}
+};
+
 // Fold the storage of a function in a particular dimension by a particular factor
 class FoldStorageOfFunction : public IRMutator {
     string func;
@@ -326,6 +383,21 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
         Box required = box_required(body, func.name());
         Box box = box_union(provided, required);
 
+        // If each iteration produces everything it uses, nothing is
+        // carried from one iteration to the next, so the storage can
+        // be folded by anything at least as large as the footprint of
+        // one iteration, even if the footprint doesn't move
+        // monotonically (e.g. a consumer that accesses a symmetric
+        // neighborhood of a point that moves back and forth). Async
+        // producers run ahead into later iterations, so they don't
+        // count. Neither do Funcs produced or consumed by extern
+        // stages, because we can't see which parts of the buffer they
+        // touch.
+        const bool self_contained = (!func.schedule().async() &&
+                                     !func.has_extern_definition() &&
+                                     !stmt_uses_var(body, func.name() + ".buffer") &&
+                                     box_contains(provided, required));
+
         string dynamic_footprint;
 
         Scope<Interval> bounds;
@@ -384,10 +456,37 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                  is_monotonic(max_steady, op->name) == Monotonic::Decreasing &&
                  can_prove(max_steady <= max_initial, bounds));
 
-            if (explicit_factor.defined()) {
+            // Otherwise, fold anyway if nothing is carried across
+            // iterations, and the footprint moves with the loop.
+            const bool fold_without_monotonic =
+                (!min_monotonic_increasing && !max_monotonic_decreasing &&
+                 self_contained &&
+                 (explicit_factor.defined() || !explicit_only) &&
+                 (expr_uses_var(min, op->name) || expr_uses_var(max, op->name)));
+
+            if (explicit_factor.defined() && fold_without_monotonic) {
+                if (!can_prove(extent <= explicit_factor, bounds)) {
+                    // Only the extent of each iteration's footprint
+                    // needs checking.
+                    Expr iteration_extent = simplify(max - min + 1);
+                    Expr fold_too_small_error =
+                        Call::make(Int(32), "halide_error_fold_factor_too_small",
+                                   {func.name(), storage_dim.var, explicit_factor, op->name, iteration_extent},
+                                   Call::Extern);
+                    body = Block::make(AssertStmt::make(iteration_extent <= explicit_factor, fold_too_small_error), body);
+                }
+            } else if (explicit_factor.defined()) {
                 bool can_skip_dynamic_checks =
                     ((min_monotonic_increasing || max_monotonic_decreasing) &&
                      can_prove(extent <= explicit_factor, bounds));
+                if (!can_skip_dynamic_checks && func.schedule().async()) {
+                    // The footprint would be tracked on the producer
+                    // side of the fork and checked on the consumer
+                    // side, which may be running behind.
+                    user_error << "Can't fold the storage of async Func " << func.name()
+                               << " over loop " << op->name << " by " << explicit_factor
+                               << ", because the fold factor can't be proven to be large enough.\n";
+                }
                 if (!can_skip_dynamic_checks) {
                     // If we didn't find a monotonic dimension, or
                     // couldn't prove the extent was small enough, and we
@@ -414,7 +513,7 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
 
             // The min or max has to be monotonic with the loop
             // variable, and should depend on the loop variable.
-            if (min_monotonic_increasing || max_monotonic_decreasing) {
+            if (min_monotonic_increasing || max_monotonic_decreasing || fold_without_monotonic) {
                 Expr factor;
                 if (explicit_factor.defined()) {
                     // We were either able to prove monotonicity
@@ -451,6 +550,22 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     }
                 }
 
+                if (factor.defined() && func.schedule().async()) {
+                    ProducerConsumerNotInInnerLoop check(func.name());
+                    body.accept(&check);
+                    if (!check.result) {
+                        // We'd need to count the inner loop
+                        // iterations to know how much to release
+                        // and acquire.
+                        debug(3) << "Not folding async func because its production or consumption "
+                                 << "is inside a loop nested within " << op->name << "\n";
+                        factor = Expr();
+                        user_assert(!explicit_factor.defined())
+                            << "Can't fold the storage of async Func " << func.name()
+                            << " over loop " << op->name << " because it is not computed at that loop level.\n";
+                    }
+                }
+
                 if (factor.defined()) {
                     debug(3) << "Proceeding with factor " << factor << "\n";
 
@@ -458,6 +573,34 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     dims_folded.push_back(fold);
                     body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, dynamic_footprint).mutate(body);
 
+                    if (func.schedule().async()) {
+                        // The producer may run ahead of the consumer,
+                        // so it must wait until the consumer is done
+                        // with the part of the fold it's about to
+                        // overwrite. The semaphore counts the free
+                        // slots in the fold.
+                        string sema_name = func.name() + "." + op->name + ".folding_semaphore";
+                        Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_name);
+                        Expr prev_var = loop_var - 1;
+                        Expr next_var = loop_var + 1;
+                        Expr to_acquire, to_release;
+                        if (min_monotonic_increasing) {
+                            to_acquire = select(loop_var > op->min,
+                                                max - substitute(op->name, prev_var, max),
+                                                max - min + 1);
+                            to_release = substitute(op->name, next_var, min) - min;
+                        } else {
+                            to_acquire = select(loop_var > op->min,
+                                                substitute(op->name, prev_var, min) - min,
+                                                max - min + 1);
+                            to_release = max - substitute(op->name, next_var, max);
+                        }
+                        to_acquire = simplify(common_subexpression_elimination(to_acquire));
+                        to_release = simplify(common_subexpression_elimination(to_release));
+                        body = InjectFoldingSemaphore(func.name(), sema, to_acquire, to_release).mutate(body);
+                        semaphores.push_back({sema_name, factor});
+                    }
+
                     Expr next_var = Variable::make(Int(32), op->name) + 1;
                     Expr next_min = substitute(op->name, next_var, min);
                     if (can_prove(max < next_min)) {
@@ -514,10 +657,205 @@ public:
     };
     vector<Fold> dims_folded;
 
+    // Semaphores counting the free space in each fold of an async
+    // func, and their initial values.
+    vector<std::pair<string, Expr>> semaphores;
+
     AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
         : func(f), explicit_only(explicit_only) {}
 };
 
+// Rewrite the accesses to a ring buffered function within one
+// iteration of the loops over which it is ring buffered, to be
+// relative to the tile used by this iteration.
+class RingBufferAccesses : public IRMutator2 {
+    const string &func;
+    const vector<Expr> &tile_min;
+    Expr tile_index;
+
+    using IRMutator2::visit;
+
+    vector<Expr> tile_args(const vector<Expr> &args) {
+        internal_assert(args.size() == tile_min.size());
+        vector<Expr> new_args(args.size());
+        for (size_t i = 0; i < args.size(); i++) {
+            new_args[i] = mutate(args[i]) - tile_min[i];
+        }
+        new_args.push_back(tile_index);
+        return new_args;
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->name == func && op->call_type == Call::Halide) {
+            return Call::make(op->type, op->name, tile_args(op->args), op->call_type,
+                              op->func, op->value_index, op->image, op->param);
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const Provide *op) override {
+        if (op->name == func) {
+            vector<Expr> values(op->values.size());
+            for (size_t i = 0; i < values.size(); i++) {
+                values[i] = mutate(op->values[i]);
+            }
+            return Provide::make(op->name, values, tile_args(op->args));
+        }
+        return IRMutator2::visit(op);
+    }
+
+    Expr visit(const Variable *op) override {
+        user_assert(!(op->type.is_handle() &&
+                      starts_with(op->name, func + ".") &&
+                      ends_with(op->name, ".buffer")))
+            << "Can't ring buffer the storage of " << func
+            << ", because it is passed to an extern stage.\n";
+        return op;
+    }
+
+public:
+    RingBufferAccesses(const string &func, const vector<Expr> &tile_min, Expr tile_index)
+        : func(func), tile_min(tile_min), tile_index(tile_index) {}
+};
+
+// Store a function in a ring buffer of tiles, where each iteration of
+// the loops between its realization and its production uses the next
+// tile.
+class RingBufferFunction : public IRMutator2 {
+    Function func;
+    Expr num_tiles;
+
+    // The loops between the realization and the production, outermost
+    // first, and the bounds of everything defined within them.
+    vector<const For *> loops;
+    Scope<Interval> scope;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<Interval> bind(scope, op->name, bounds_of_expr_in_scope(op->value, scope));
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        user_assert(op->name != func.name())
+            << "Can't ring buffer the storage of " << func.name()
+            << ", because it is stored at the same loop level as it is computed."
+            << " Store it further out with store_at or store_root.\n";
+        return IRMutator2::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        user_assert(op->name != func.name() || op->call_type != Call::Halide)
+            << "Can't ring buffer the storage of " << func.name()
+            << ", because it is used outside of the loops over which it is computed.\n";
+        return IRMutator2::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (count_producers(op->body, func.name()) == 0) {
+            return IRMutator2::visit(op);
+        }
+
+        user_assert(op->for_type == ForType::Serial || op->for_type == ForType::Unrolled)
+            << "Can't ring buffer the storage of " << func.name()
+            << " over loop " << op->name << ", because it is not serial.\n";
+        user_assert(!expr_uses_vars(op->extent, scope))
+            << "Can't ring buffer the storage of " << func.name()
+            << " over loop " << op->name << ", because its extent depends on an enclosing loop.\n";
+
+        loops.push_back(op);
+        Interval loop_bounds(op->min, simplify(op->min + op->extent - 1));
+        ScopedBinding<Interval> bind(scope, op->name, loop_bounds);
+
+        Stmt body;
+        ProducerConsumerNotInInnerLoop check(func.name());
+        op->body.accept(&check);
+        if (check.result) {
+            body = ring_buffer_iteration(op->body);
+        } else {
+            body = mutate(op->body);
+        }
+        loops.pop_back();
+
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt ring_buffer_iteration(Stmt body) {
+        const string &name = func.name();
+
+        // The tile for this iteration.
+        Expr index = 0;
+        for (const For *loop : loops) {
+            index = index * loop->extent + (Variable::make(Int(32), loop->name) - loop->min);
+        }
+        index = simplify(index % num_tiles);
+        string index_name = name + ".ring_index";
+        Expr index_var = Variable::make(Int(32), index_name);
+
+        // The region used by this iteration, and a bound on the size
+        // of it that doesn't depend on the iteration.
+        Box box = box_union(box_provided(body, name), box_required(body, name));
+        internal_assert((int)box.size() == func.dimensions());
+        vector<Expr> tile_min(box.size());
+        vector<std::pair<string, Expr>> min_lets;
+        for (size_t i = 0; i < box.size(); i++) {
+            user_assert(box[i].is_bounded())
+                << "Can't ring buffer the storage of " << name
+                << ", because the region of it used in one iteration is unbounded.\n";
+            Expr extent = simplify(box[i].max - box[i].min + 1);
+            Interval extent_bounds = bounds_of_expr_in_scope(extent, scope);
+            Expr max_extent;
+            if (extent_bounds.has_upper_bound()) {
+                max_extent = simplify(extent_bounds.max);
+            }
+            user_assert(max_extent.defined() && !expr_uses_vars(max_extent, scope))
+                << "Can't ring buffer the storage of " << name
+                << ", because the size of the region of it used in one iteration can't be bounded.\n"
+                << "Size in dimension " << i << ": " << extent << "\n";
+            if (tile_extents.size() < box.size()) {
+                tile_extents.push_back(max_extent);
+            } else {
+                // It's computed in more than one place, e.g. in
+                // different specializations.
+                tile_extents[i] = simplify(max(tile_extents[i], max_extent));
+            }
+
+            string min_name = name + ".ring_min." + std::to_string(i);
+            tile_min[i] = Variable::make(Int(32), min_name);
+            min_lets.push_back({min_name, simplify(box[i].min)});
+        }
+
+        body = RingBufferAccesses(name, tile_min, index_var).mutate(body);
+
+        if (func.schedule().async()) {
+            // The producer may run ahead of the consumer, so it must
+            // wait for the consumer to finish with a tile before
+            // overwriting it.
+            string sema_name = name + ".ring_semaphore";
+            Expr sema = Variable::make(type_of<halide_semaphore_t *>(), sema_name);
+            body = InjectFoldingSemaphore(name, sema, 1, 1).mutate(body);
+            if (semaphores.empty()) {
+                semaphores.push_back({sema_name, num_tiles});
+            }
+        }
+
+        for (size_t i = min_lets.size(); i > 0; i--) {
+            body = LetStmt::make(min_lets[i - 1].first, min_lets[i - 1].second, body);
+        }
+        return LetStmt::make(index_name, index, body);
+    }
+
+public:
+    // The largest size of one tile in each dimension.
+    vector<Expr> tile_extents;
+
+    // Semaphores counting the free tiles, and their initial values.
+    vector<std::pair<string, Expr>> semaphores;
+
+    RingBufferFunction(Function f) : func(f), num_tiles(f.schedule().ring_buffer()) {}
+};
+
 // Look for opportunities for storage folding in a statement
 class StorageFolding : public IRMutator {
     const map<string, Function> &env;
@@ -532,6 +870,11 @@ class StorageFolding : public IRMutator {
         auto func_it = env.find(op->name);
         Function func = func_it != env.end() ? func_it->second : Function();
 
+        if (func_it != env.end() && func.schedule().ring_buffer().defined()) {
+            ring_buffer(op, func, body);
+            return;
+        }
+
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
@@ -556,9 +899,46 @@ class StorageFolding : public IRMutator {
             }
 
             stmt = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
+            stmt = define_semaphores(stmt, folder.semaphores);
         }
     }
 
+    // Define the semaphores outside the realization, so that both
+    // sides of the fork made for an async producer share them.
+    Stmt define_semaphores(Stmt s, const vector<std::pair<string, Expr>> &semaphores) {
+        for (const auto &sema : semaphores) {
+            Expr sema_var = Variable::make(type_of<halide_semaphore_t *>(), sema.first);
+            Expr sema_space = Call::make(type_of<halide_semaphore_t *>(), Call::make_struct,
+                                         {make_zero(UInt(64)), make_zero(UInt(64))}, Call::Intrinsic);
+            Expr init = Call::make(Int(32), "halide_semaphore_init", {sema_var, sema.second}, Call::Extern);
+            s = Block::make(Evaluate::make(init), s);
+            s = LetStmt::make(sema.first, sema_space, s);
+        }
+        return s;
+    }
+
+    void ring_buffer(const Realize *op, const Function &func, Stmt body) {
+        user_assert(!func.has_extern_definition())
+            << "Can't ring buffer the storage of extern Func " << func.name() << "\n";
+
+        RingBufferFunction ringer(func);
+        body = ringer.mutate(body);
+        user_assert(!ringer.tile_extents.empty() || func.dimensions() == 0)
+            << "Can't ring buffer the storage of " << func.name()
+            << ", because it is not computed inside any loop within its storage.\n";
+
+        // Each tile is the largest region used by one iteration, and
+        // the ring is an extra outermost dimension.
+        Region bounds;
+        for (const Expr &e : ringer.tile_extents) {
+            bounds.push_back(Range(0, e));
+        }
+        bounds.push_back(Range(0, func.schedule().ring_buffer()));
+
+        stmt = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
+        stmt = define_semaphores(stmt, ringer.semaphores);
+    }
+
 public:
     StorageFolding(const map<string, Function> &env) : env(env) {}
 };
@@ -0,0 +1,158 @@
+#include "StorageLayout.h"
+#include "Debug.h"
+#include "ExprUsesVar.h"
+#include "IRVisitor.h"
+
+#include <set>
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The dimensions of a definition's vectorized loops, traced back
+// through splits and renames to the variables of the definition.
+vector<string> vectorized_vars(const Definition &def) {
+    vector<string> result;
+    const vector<Split> &splits = def.schedule().splits();
+    for (const Dim &d : def.schedule().dims()) {
+        if (d.for_type != ForType::Vectorized) {
+            continue;
+        }
+        string var = d.var;
+        bool traced = true;
+        for (auto it = splits.rbegin(); it != splits.rend(); it++) {
+            if (it->is_fuse()) {
+                if (var == it->old_var) {
+                    traced = false;
+                }
+            } else if (var == it->inner || var == it->outer) {
+                if (it->is_split() && var == it->outer) {
+                    // Only the inner var of a split walks memory
+                    // contiguously.
+                    traced = false;
+                }
+                var = it->old_var;
+            }
+        }
+        if (traced) {
+            result.push_back(var);
+        }
+    }
+    return result;
+}
+
+// Records, for each Func called, which of its arguments depend on a
+// given variable. An index of -1 means a call has several.
+class FindWalkedDims : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->call_type != Call::Halide) {
+            return;
+        }
+        int dim = -2;
+        for (size_t i = 0; i < op->args.size(); i++) {
+            if (expr_uses_var(op->args[i], var)) {
+                dim = (dim == -2) ? (int)i : -1;
+            }
+        }
+        if (dim != -2) {
+            walked[op->name].insert(dim);
+        }
+    }
+
+    const string &var;
+
+public:
+    map<string, set<int>> walked;
+
+    FindWalkedDims(const string &v) : var(v) {}
+};
+
+}  // namespace
+
+void choose_storage_layouts(const map<string, Function> &env,
+                            const vector<Function> &outputs) {
+    // The dimensions along which each Func is walked by vectorized
+    // loops, including its own.
+    map<string, set<int>> walked;
+    set<string> excluded;
+    for (const Function &f : outputs) {
+        excluded.insert(f.name());
+    }
+
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (f.has_extern_definition()) {
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    excluded.insert(Function(arg.func).name());
+                }
+            }
+            continue;
+        }
+        if (!f.schedule().in_place_of().empty()) {
+            excluded.insert(f.name());
+            excluded.insert(f.schedule().in_place_of());
+        }
+
+        vector<const Definition *> defs = {&f.definition()};
+        for (const Definition &u : f.updates()) {
+            defs.push_back(&u);
+        }
+        for (const Definition *def : defs) {
+            for (const string &v : vectorized_vars(*def)) {
+                // The store of the definition itself.
+                for (size_t i = 0; i < def->args().size(); i++) {
+                    if (expr_uses_var(def->args()[i], v)) {
+                        walked[f.name()].insert((int)i);
+                    }
+                }
+                FindWalkedDims finder(v);
+                for (const Expr &e : def->values()) {
+                    e.accept(&finder);
+                }
+                for (const auto &w : finder.walked) {
+                    walked[w.first].insert(w.second.begin(), w.second.end());
+                }
+            }
+        }
+    }
+
+    for (const auto &p : walked) {
+        auto it = env.find(p.first);
+        if (it == env.end() || excluded.count(p.first) ||
+            p.second.size() != 1 || *p.second.begin() <= 0) {
+            continue;
+        }
+        Function f = it->second;
+        if (f.schedule().compute_level().is_inlined()) {
+            continue;
+        }
+        vector<StorageDim> &dims = f.schedule().storage_dims();
+        bool default_order = true;
+        for (size_t i = 0; i < dims.size(); i++) {
+            default_order = default_order && dims[i].var == f.args()[i];
+        }
+        if (!default_order) {
+            continue;
+        }
+
+        int d = *p.second.begin();
+        debug(1) << "Storing " << f.name() << " with dimension "
+                 << dims[d].var << " innermost, to suit its vectorized consumers\n";
+        StorageDim inner = dims[d];
+        dims.erase(dims.begin() + d);
+        dims.insert(dims.begin(), inner);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
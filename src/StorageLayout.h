@@ -0,0 +1,32 @@
+#ifndef HALIDE_STORAGE_LAYOUT_H
+#define HALIDE_STORAGE_LAYOUT_H
+
+/** \file
+ * Defines the pass that picks transposed storage layouts for Funcs
+ * whose vectorized consumers walk them along an outer dimension.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** For each Func that is not an output, has the default storage
+ * order, and whose vectorized consumers all walk it along the same
+ * dimension other than the innermost one, make that dimension
+ * innermost in storage, as if the Func had been reorder_storage'd.
+ * The loads in those consumers then become dense vector loads instead
+ * of strided ones. Funcs that are vectorized along their innermost
+ * dimension themselves, or are accessed by extern stages, or share
+ * storage with another Func, are left alone. */
+void choose_storage_layouts(const std::map<std::string, Function> &env,
+                            const std::vector<Function> &outputs);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -84,6 +84,7 @@ Target calculate_host_target() {
     bool have_altivec = (hwcap & PPC_FEATURE_HAS_ALTIVEC) != 0;
     bool have_vsx     = (hwcap & PPC_FEATURE_HAS_VSX) != 0;
     bool arch_2_07    = (hwcap2 & PPC_FEATURE2_ARCH_2_07) != 0;
+    bool arch_3_00    = (hwcap2 & PPC_FEATURE2_ARCH_3_00) != 0;
 
     user_assert(have_altivec)
         << "The POWERPC backend assumes at least AltiVec support. This machine does not appear to have AltiVec.\n";
@@ -91,6 +92,7 @@ Target calculate_host_target() {
     std::vector<Target::Feature> initial_features;
     if (have_vsx)     initial_features.push_back(Target::VSX);
     if (arch_2_07)    initial_features.push_back(Target::POWER_ARCH_2_07);
+    if (arch_3_00)    initial_features.push_back(Target::POWER_ARCH_3_00);
 #else
     Target::Arch arch = Target::X86;
 
@@ -135,6 +137,7 @@ Target calculate_host_target() {
         const uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         const uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma; // Assume ifma => vbmi
+        const uint32_t avx512vnni = 1U << 11; // In ecx
         if ((info2[1] & avx2) == avx2) {
             initial_features.push_back(Target::AVX2);
         }
@@ -149,6 +152,10 @@ Target calculate_host_target() {
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
                 initial_features.push_back(Target::AVX512_Cannonlake);
             }
+            if ((info2[1] & avx512_skylake) == avx512_skylake &&
+                (info2[2] & avx512vnni) == avx512vnni) {
+                initial_features.push_back(Target::AVX512_VNNI);
+            }
         }
     }
 #ifdef _WIN32
@@ -196,8 +203,10 @@ Target::Feature calculate_host_cuda_capability(Target t) {
         return Target::CUDACapability35;
     } else if (ver < 61) {
         return Target::CUDACapability50;
-    } else {
+    } else if (ver < 70) {
         return Target::CUDACapability61;
+    } else {
+        return Target::CUDACapability70;
     }
 }
 
@@ -300,6 +309,23 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"tsan", Target::TSAN},
     {"asan", Target::ASAN},
     {"check_unsafe_promises", Target::CheckUnsafePromises},
+    {"batch", Target::Batch},
+    {"unchecked_entry", Target::UncheckedEntry},
+    {"zero_copy", Target::ZeroCopy},
+    {"avx512_vnni", Target::AVX512_VNNI},
+    {"arm_dot_prod", Target::ARMDotProd},
+    {"arm_fp16", Target::ARMFp16},
+    {"cuda_capability_70", Target::CUDACapability70},
+    {"arm_sve", Target::ARMSVE},
+    {"minimize_memory", Target::MinimizeMemory},
+    {"vulkan", Target::Vulkan},
+    {"cache_shape_checks", Target::CacheShapeChecks},
+    {"fast_float16_conversions", Target::FastFloat16Conversions},
+    {"gpu_persistent_threads", Target::GPUPersistentThreads},
+    {"concurrent_stages", Target::ConcurrentStages},
+    {"avx512_256", Target::AVX512_256},
+    {"power_arch_3_00", Target::POWER_ARCH_3_00},
+    {"deterministic_reductions", Target::DeterministicReductions},
     // NOTE: When adding features to this map, be sure to update
     // PyEnums.cpp and halide.cmake as well.
 };
@@ -411,7 +437,8 @@ bool merge_string(Target &t, const std::string &target) {
         !t.has_feature(Target::CUDACapability32) &&
         !t.has_feature(Target::CUDACapability35) &&
         !t.has_feature(Target::CUDACapability50) &&
-        !t.has_feature(Target::CUDACapability61)) {
+        !t.has_feature(Target::CUDACapability61) &&
+        !t.has_feature(Target::CUDACapability70)) {
         // Detect host cuda capability
         t.set_feature(get_host_cuda_capability(t));
     }
@@ -572,6 +599,9 @@ bool Target::supported() const {
 #endif
 #if !defined(WITH_D3D12)
     bad |= has_feature(Target::D3D12Compute);
+#endif
+#if !defined(WITH_VULKAN)
+    bad |= has_feature(Target::Vulkan);
 #endif
     return !bad;
 }
@@ -625,7 +655,8 @@ Target Target::without_feature(Feature f) const {
 }
 
 bool Target::has_gpu_feature() const {
-    return has_feature(CUDA) || has_feature(OpenCL) || has_feature(Metal) || has_feature(D3D12Compute);
+    return (has_feature(CUDA) || has_feature(OpenCL) || has_feature(Metal) ||
+            has_feature(D3D12Compute) || has_feature(Vulkan));
 }
 
 bool Target::supports_type(const Type &t) const {
@@ -633,9 +664,10 @@ bool Target::supports_type(const Type &t) const {
         if (t.is_float()) {
             return !has_feature(Metal) &&
                    !has_feature(D3D12Compute) &&
+                   !has_feature(Vulkan) &&
                    (!has_feature(Target::OpenCL) || has_feature(Target::CLDoubles));
         } else {
-            return !has_feature(Metal) && !has_feature(D3D12Compute);
+            return !has_feature(Metal) && !has_feature(D3D12Compute) && !has_feature(Vulkan);
         }
     }
     return true;
@@ -664,6 +696,10 @@ bool Target::supports_type(const Type &t, DeviceAPI device) const {
         // Shader Model 5.x can optionally support double-precision; 64-bit int
         // types are not supported.
         return t.bits() < 64;
+    } else if (device == DeviceAPI::Vulkan) {
+        // Kernels are restricted to the types every Vulkan 1.0
+        // device supports.
+        return t.bits() < 64;
     }
 
     return true;
@@ -688,6 +724,7 @@ Target::Feature target_feature_for_device_api(DeviceAPI api) {
     case DeviceAPI::Metal:         return Target::Metal;
     case DeviceAPI::Hexagon:       return Target::HVX_128;
     case DeviceAPI::D3D12Compute:  return Target::D3D12Compute;
+    case DeviceAPI::Vulkan:        return Target::Vulkan;
     default:                       return Target::FeatureEnd;
     }
 }
@@ -715,14 +752,24 @@ int Target::natural_vector_size(const Halide::Type &t) const {
             return 1;
         }
     } else if (arch == Target::X86) {
-        if (is_integer && (has_feature(Halide::Target::AVX512_Skylake) ||
-                           has_feature(Halide::Target::AVX512_Cannonlake))) {
+        if (has_feature(Halide::Target::AVX512_256) &&
+            (has_feature(Halide::Target::AVX512) ||
+             has_feature(Halide::Target::AVX512_KNL) ||
+             has_feature(Halide::Target::AVX512_Skylake) ||
+             has_feature(Halide::Target::AVX512_Cannonlake) ||
+             has_feature(Halide::Target::AVX512_VNNI))) {
+            // AVX-512 instructions on ymm registers only.
+            return 32 / data_size;
+        } else if (is_integer && (has_feature(Halide::Target::AVX512_Skylake) ||
+                           has_feature(Halide::Target::AVX512_Cannonlake) ||
+                           has_feature(Halide::Target::AVX512_VNNI))) {
             // AVX512BW exists on Skylake and Cannonlake
             return 64 / data_size;
         } else if (t.is_float() && (has_feature(Halide::Target::AVX512) ||
                                     has_feature(Halide::Target::AVX512_KNL) ||
                                     has_feature(Halide::Target::AVX512_Skylake) ||
-                                    has_feature(Halide::Target::AVX512_Cannonlake))) {
+                                    has_feature(Halide::Target::AVX512_Cannonlake) ||
+                                    has_feature(Halide::Target::AVX512_VNNI))) {
             // AVX512F is on all AVX512 architectures
             return 64 / data_size;
         } else if (has_feature(Halide::Target::AVX2)) {
@@ -99,6 +99,23 @@ struct Target {
         TSAN = halide_target_feature_tsan,
         ASAN = halide_target_feature_asan,
         CheckUnsafePromises = halide_target_feature_check_unsafe_promises,
+        Batch = halide_target_feature_batch,
+        UncheckedEntry = halide_target_feature_unchecked_entry,
+        ZeroCopy = halide_target_feature_zero_copy,
+        AVX512_VNNI = halide_target_feature_avx512_vnni,
+        ARMDotProd = halide_target_feature_arm_dot_prod,
+        ARMFp16 = halide_target_feature_arm_fp16,
+        CUDACapability70 = halide_target_feature_cuda_capability70,
+        ARMSVE = halide_target_feature_arm_sve,
+        MinimizeMemory = halide_target_feature_minimize_memory,
+        Vulkan = halide_target_feature_vulkan,
+        CacheShapeChecks = halide_target_feature_cache_shape_checks,
+        FastFloat16Conversions = halide_target_feature_fast_float16_conversions,
+        GPUPersistentThreads = halide_target_feature_gpu_persistent_threads,
+        ConcurrentStages = halide_target_feature_concurrent_stages,
+        AVX512_256 = halide_target_feature_avx512_256,
+        POWER_ARCH_3_00 = halide_target_feature_power_arch_3_00,
+        DeterministicReductions = halide_target_feature_deterministic_reductions,
         FeatureEnd = halide_target_feature_end
     };
     Target() : os(OSUnknown), arch(ArchUnknown), bits(0) {}
@@ -151,7 +168,7 @@ struct Target {
 
     /** Is a fully feature GPU compute runtime enabled? I.e. is
      * Func::gpu_tile and similar going to work? Currently includes
-     * CUDA, OpenCL, Metal and D3D12Compute. We do not include OpenGL,
+     * CUDA, OpenCL, Metal, D3D12Compute and Vulkan. We do not include OpenGL,
      * because it is not capable of gpgpu, and is not scheduled via
      * Func::gpu_tile.
      * TODO: Should OpenGLCompute be included here? */
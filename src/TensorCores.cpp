@@ -0,0 +1,240 @@
+#include "TensorCores.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The fully-qualified names of the loops of each tensor core nest,
+// keyed by the name of every loop in it.
+map<string, TensorCoreLoops> find_tensor_core_loops(const map<string, Function> &env) {
+    map<string, TensorCoreLoops> loops;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        for (int stage = 1; stage <= (int)f.updates().size(); stage++) {
+            string prefix = f.name() + ".s" + std::to_string(stage) + ".";
+            for (const TensorCoreLoops &l : f.update(stage - 1).schedule().tensor_cores()) {
+                TensorCoreLoops q = {prefix + l.x, prefix + l.y, prefix + l.k};
+                loops[q.x] = q;
+                loops[q.y] = q;
+                loops[q.k] = q;
+            }
+        }
+    }
+    return loops;
+}
+
+class WrapTensorCoreLoops : public IRMutator2 {
+    const map<string, TensorCoreLoops> &loops;
+
+    using IRMutator2::visit;
+
+    Stmt visit(const For *op) override {
+        auto it = loops.find(op->name);
+        if (it == loops.end()) {
+            return IRMutator2::visit(op);
+        }
+        // This is the outermost loop of the nest. The wmma
+        // instructions are done by a whole warp, so run the nest over
+        // the 32 lanes of one.
+        vector<string> v = split_string(op->name, ".");
+        string lane = v[0] + "." + v[1] + ".__tensor_core_lane";
+        return For::make(lane, 0, 32, ForType::GPULane, DeviceAPI::Default_GPU, op);
+    }
+
+public:
+    WrapTensorCoreLoops(const map<string, TensorCoreLoops> &l) : loops(l) {}
+};
+
+// Get the Float(16) load that is an operand of the products, with
+// any cast to the accumulator type removed.
+Expr strip_cast_of_f16_load(const Expr &e) {
+    Expr l = e;
+    if (const Cast *c = l.as<Cast>()) {
+        l = c->value;
+    }
+    const Load *load = l.as<Load>();
+    if (load && load->type == Float(16)) {
+        return l;
+    }
+    return Expr();
+}
+
+class InjectTensorCores : public IRMutator2 {
+    const map<string, TensorCoreLoops> &loops;
+
+    using IRMutator2::visit;
+
+    // The layout and leading dimension of a matrix whose elements
+    // are at the given index, with the given loop variables over its
+    // rows and cols.
+    void matrix_layout(const string &stage, const Expr &index,
+                       const string &row, const string &col,
+                       const vector<string> &vars,
+                       Expr &layout, Expr &stride) {
+        Expr d_row = simplify(substitute(row, Variable::make(Int(32), row) + 1, index) - index);
+        Expr d_col = simplify(substitute(col, Variable::make(Int(32), col) + 1, index) - index);
+        for (const string &v : vars) {
+            user_assert(!expr_uses_var(d_row, v) && !expr_uses_var(d_col, v))
+                << "In tensor_core() for " << stage
+                << ", the matrix accessed at " << index << " does not have a constant stride\n";
+        }
+        if (is_one(d_col)) {
+            layout = StringImm::make("row");
+            stride = d_row;
+        } else if (is_one(d_row)) {
+            layout = StringImm::make("col");
+            stride = d_col;
+        } else {
+            user_error << "In tensor_core() for " << stage
+                       << ", the matrix accessed at " << index << " is neither row- nor column-major\n";
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        auto it = loops.find(op->name);
+        if (it == loops.end()) {
+            return IRMutator2::visit(op);
+        }
+        const TensorCoreLoops &l = it->second;
+        const string stage = split_string(op->name, ".")[0];
+
+        // Peel off the loops of the nest, and any lets between them.
+        map<string, const For *> found;
+        vector<std::pair<string, Expr>> lets;
+        Stmt body = op;
+        while (true) {
+            if (const For *f = body.as<For>()) {
+                user_assert(loops.count(f->name) && !found.count(f->name))
+                    << "In tensor_core() for " << stage
+                    << ", the loops " << l.x << ", " << l.y << " and " << l.k
+                    << " must be the three innermost loops\n";
+                user_assert(f->for_type == ForType::Serial || f->for_type == ForType::Unrolled)
+                    << "In tensor_core() for " << stage
+                    << ", loop " << f->name << " must not be parallel, vectorized or over gpu threads\n";
+                user_assert(is_const(simplify(f->extent), 16))
+                    << "In tensor_core() for " << stage
+                    << ", loop " << f->name << " must have an extent of 16, not " << f->extent << "\n";
+                found[f->name] = f;
+                body = f->body;
+            } else if (const LetStmt *let = body.as<LetStmt>()) {
+                lets.emplace_back(let->name, let->value);
+                body = let->body;
+            } else {
+                break;
+            }
+        }
+        user_assert(found.size() == 3)
+            << "In tensor_core() for " << stage
+            << ", the loops " << l.x << ", " << l.y << " and " << l.k
+            << " must be the three innermost loops\n";
+
+        const Store *store = body.as<Store>();
+        user_assert(store && is_one(store->predicate))
+            << "In tensor_core() for " << stage
+            << ", the body of the loops must be a single unconditional update. "
+            << "Make sure the extents are multiples of 16.\n";
+
+        auto substitute_lets = [&](Expr e) {
+            for (auto i = lets.rbegin(); i != lets.rend(); i++) {
+                e = substitute(i->first, i->second, e);
+            }
+            return e;
+        };
+        Expr value = substitute_lets(store->value);
+        Expr index = substitute_lets(store->index);
+
+        // Match c + a * b, in any order.
+        Type c_type = store->value.type();
+        user_assert(c_type == Float(32) || c_type == Float(16))
+            << "In tensor_core() for " << stage
+            << ", the accumulator must be Float(16) or Float(32), not " << c_type << "\n";
+        Expr c, a, b;
+        if (const Add *add = value.as<Add>()) {
+            Expr terms[] = {add->a, add->b};
+            for (int i = 0; i < 2; i++) {
+                const Load *load = terms[i].as<Load>();
+                const Mul *mul = terms[1 - i].as<Mul>();
+                if (load && mul && load->name == store->name && equal(load->index, index)) {
+                    c = terms[i];
+                    a = strip_cast_of_f16_load(mul->a);
+                    b = strip_cast_of_f16_load(mul->b);
+                }
+            }
+        }
+        user_assert(c.defined() && a.defined() && b.defined())
+            << "In tensor_core() for " << stage
+            << ", the update must be of the form f(x, y) += A(k, y) * B(x, k), "
+            << "where A and B are Float(16)\n";
+
+        // A's rows are y, and B's columns are x.
+        if (expr_uses_var(a, l.x)) {
+            std::swap(a, b);
+        }
+        user_assert(!expr_uses_var(a, l.x) && !expr_uses_var(b, l.y))
+            << "In tensor_core() for " << stage
+            << ", the update must be of the form f(x, y) += A(k, y) * B(x, k)\n";
+
+        const vector<string> vars = {l.x, l.y, l.k};
+        Expr c_layout, c_stride, a_layout, a_stride, b_layout, b_stride;
+        matrix_layout(stage, index, l.y, l.x, vars, c_layout, c_stride);
+        matrix_layout(stage, a.as<Load>()->index, l.y, l.k, vars, a_layout, a_stride);
+        matrix_layout(stage, b.as<Load>()->index, l.k, l.x, vars, b_layout, b_stride);
+
+        // The corner of each tile, at the start of every loop.
+        auto at_corner = [&](const Expr &e) {
+            const Load *load = e.as<Load>();
+            Expr idx = load->index;
+            for (const auto &f : found) {
+                idx = substitute(f.first, substitute_lets(f.second->min), idx);
+            }
+            return Load::make(load->type, load->name, simplify(idx),
+                              load->image, load->param, const_true());
+        };
+
+        // The loads are only there to name the tiles. The whole warp
+        // loads, multiplies, and stores them in one go.
+        Expr wmma = Call::make(c_type, "halide_wmma_m16n16k16",
+                               {at_corner(c), c_stride, c_layout,
+                                at_corner(a), a_stride, a_layout,
+                                at_corner(b), b_stride, b_layout},
+                               Call::Extern);
+        return Evaluate::make(wmma);
+    }
+
+public:
+    InjectTensorCores(const map<string, TensorCoreLoops> &l) : loops(l) {}
+};
+
+}  // namespace
+
+Stmt wrap_tensor_core_loops(const Stmt &s, const map<string, Function> &env, const Target &t) {
+    map<string, TensorCoreLoops> loops = find_tensor_core_loops(env);
+    if (loops.empty()) {
+        return s;
+    }
+    user_assert(t.has_feature(Target::CUDA) && t.has_feature(Target::CUDACapability70))
+        << "tensor_core() requires a target with cuda and cuda_capability_70\n";
+    return WrapTensorCoreLoops(loops).mutate(s);
+}
+
+Stmt inject_tensor_cores(const Stmt &s, const map<string, Function> &env) {
+    map<string, TensorCoreLoops> loops = find_tensor_core_loops(env);
+    if (loops.empty()) {
+        return s;
+    }
+    return InjectTensorCores(loops).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
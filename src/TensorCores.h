@@ -0,0 +1,33 @@
+#ifndef HALIDE_TENSOR_CORES_H
+#define HALIDE_TENSOR_CORES_H
+
+/** \file
+ * Defines the lowering passes that map loop nests scheduled with
+ * Stage::tensor_core onto CUDA tensor core (wmma) instructions.
+ */
+
+#include <map>
+#include <string>
+
+#include "Function.h"
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Wrap each loop nest marked with Stage::tensor_core in a loop over
+ * the 32 lanes of a warp, as the wmma instructions are done by a
+ * whole warp together. Must run before the GPU loop variables are
+ * canonicalized. */
+Stmt wrap_tensor_core_loops(const Stmt &s, const std::map<std::string, Function> &env, const Target &t);
+
+/** Replace each loop nest marked with Stage::tensor_core with a call
+ * to the wmma intrinsic that does the whole 16x16x16 matrix
+ * multiply-accumulate. Must run after storage flattening. */
+Stmt inject_tensor_cores(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
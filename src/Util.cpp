@@ -107,12 +107,68 @@ const int num_unique_name_counters = (1 << 14);
 // the correct behavior.
 std::atomic<int> unique_name_counters[num_unique_name_counters] = {};
 
+// The counters to use instead, if the current thread has a
+// ScopedUniqueNameCounters alive.
+thread_local UniqueNameCounters *local_unique_name_counters = nullptr;
+
 int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
+    if (local_unique_name_counters) {
+        return (*local_unique_name_counters)[h]++;
+    }
     return unique_name_counters[h]++;
 }
 }  // namespace
 
+UniqueNameCounters snapshot_unique_name_counters() {
+    if (local_unique_name_counters) {
+        return *local_unique_name_counters;
+    }
+    UniqueNameCounters result(num_unique_name_counters);
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        result[i] = unique_name_counters[i];
+    }
+    return result;
+}
+
+void advance_unique_name_counters(const UniqueNameCounters &counters) {
+    internal_assert((int)counters.size() == num_unique_name_counters);
+    if (local_unique_name_counters) {
+        for (int i = 0; i < num_unique_name_counters; i++) {
+            (*local_unique_name_counters)[i] = std::max((*local_unique_name_counters)[i], counters[i]);
+        }
+        return;
+    }
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        int c = unique_name_counters[i];
+        while (c < counters[i] &&
+               !unique_name_counters[i].compare_exchange_weak(c, counters[i])) {
+        }
+    }
+}
+
+ScopedUniqueNameCounters::ScopedUniqueNameCounters(const UniqueNameCounters &start) :
+    counters(start), old_counters(local_unique_name_counters) {
+    internal_assert((int)counters.size() == num_unique_name_counters);
+    local_unique_name_counters = &counters;
+}
+
+ScopedUniqueNameCounters::~ScopedUniqueNameCounters() {
+    local_unique_name_counters = old_counters;
+    if (old_counters) {
+        for (int i = 0; i < num_unique_name_counters; i++) {
+            (*old_counters)[i] = std::max((*old_counters)[i], counters[i]);
+        }
+        return;
+    }
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        int c = unique_name_counters[i];
+        while (c < counters[i] &&
+               !unique_name_counters[i].compare_exchange_weak(c, counters[i])) {
+        }
+    }
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
@@ -135,6 +135,38 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** The state of all of the counters used by unique_name. */
+typedef std::vector<int> UniqueNameCounters;
+
+/** Get a copy of the current state of the counters used by
+ * unique_name on this thread. */
+UniqueNameCounters snapshot_unique_name_counters();
+
+/** Advance the counters used by unique_name on this thread so that
+ * none is behind the given snapshot, so IR made while the counters
+ * had those values can be mixed with names made from now on. */
+void advance_unique_name_counters(const UniqueNameCounters &counters);
+
+/** While one of these is alive, calls to unique_name on the thread
+ * that made it count from a private copy of the given snapshot rather
+ * than from the process-wide counters. Several jobs can then run on
+ * separate threads and each produce the same names they would have
+ * produced had they run alone, no matter how they are scheduled. The
+ * names are only unique within each job, so the jobs must not share
+ * any IR. When it is destroyed, the process-wide counters are
+ * advanced past every name it handed out. */
+class ScopedUniqueNameCounters {
+    UniqueNameCounters counters;
+    UniqueNameCounters *old_counters;
+
+public:
+    ScopedUniqueNameCounters(const UniqueNameCounters &start);
+    ~ScopedUniqueNameCounters();
+
+    ScopedUniqueNameCounters(const ScopedUniqueNameCounters &) = delete;
+    ScopedUniqueNameCounters &operator=(const ScopedUniqueNameCounters &) = delete;
+};
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
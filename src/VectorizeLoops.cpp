@@ -249,9 +249,24 @@ class PredicateLoadStore : public IRMutator2 {
                 << "We are inside a hexagon loop, but the target doesn't have hexagon's features\n";
             return true;
         } else if (target.arch == Target::X86) {
+            if (target.features_any_of({Target::AVX512_Skylake,
+                                        Target::AVX512_Cannonlake,
+                                        Target::AVX512_VNNI})) {
+                // AVX512BW and VL have masked moves for every lane
+                // size and vector width.
+                return true;
+            } else if (target.features_any_of({Target::AVX512,
+                                               Target::AVX512_KNL})) {
+                if (bit_size == 64) {
+                    return lanes >= 2;
+                }
+            }
             // Should only attempt to predicate store/load if the lane size is
             // no less than 4
             return (bit_size == 32) && (lanes >= 4);
+        } else if (target.arch == Target::ARM && target.has_feature(Target::ARMSVE)) {
+            // SVE has predicated loads and stores for every lane size.
+            return true;
         }
         // For other architecture, do not predicate vector load/store
         return false;
@@ -23,6 +23,15 @@
 #define HALIDE_ALLOCA __builtin_alloca
 #endif
 
+/** The default number of dimensions whose shape a Buffer stores
+ * inside the class itself. Buffers with more dimensions than this
+ * keep their shape on the heap, so copying, cropping or slicing them
+ * allocates. Define this before including HalideBuffer.h to change
+ * it for code that routinely uses higher-dimensional buffers. */
+#ifndef HALIDE_RUNTIME_BUFFER_DEFAULT_DIMENSIONS
+#define HALIDE_RUNTIME_BUFFER_DEFAULT_DIMENSIONS 4
+#endif
+
 // gcc 5.1 has a false positive warning on this code
 #if __GNUC__ == 5 && __GNUC_MINOR__ == 1
 #pragma GCC diagnostic ignored "-Warray-bounds"
@@ -66,6 +75,22 @@ struct AllocationHeader {
     AllocationHeader(void (*deallocate_fn)(void *)) : deallocate_fn(deallocate_fn), ref_count(1) {}
 };
 
+/** An AllocationHeader for host memory that was allocated by some other
+ * means and handed to a Buffer with Buffer::adopt_host_memory. */
+struct ExternalAllocationHeader : AllocationHeader {
+    void (*release_fn)(void *);
+    void *context;
+
+    ExternalAllocationHeader(void (*release_fn)(void *), void *context) :
+        AllocationHeader(release), release_fn(release_fn), context(context) {}
+
+    static void release(void *p) {
+        ExternalAllocationHeader *header = (ExternalAllocationHeader *)p;
+        header->release_fn(header->context);
+        free(header);
+    }
+};
+
 /** This indicates how to deallocate the device for a Halide::Runtime::Buffer. */
 enum struct BufferDeviceOwnership : int {
     Allocated,     ///> halide_device_free will be called when device ref count goes to zero
@@ -97,14 +122,18 @@ struct DeviceRefCount {
  * space inside the class itself. Set it to the maximum dimensionality
  * you expect this buffer to be. If the actual dimensionality exceeds
  * this, heap storage is allocated to track the shape of the buffer. D
- * defaults to 4, which should cover nearly all usage.
+ * defaults to HALIDE_RUNTIME_BUFFER_DEFAULT_DIMENSIONS (normally 4),
+ * which should cover nearly all usage. Crops, slices and other views
+ * of a host-only Buffer within that limit do not allocate, but they
+ * do touch the reference count of the allocation. For hot loops that
+ * make many short-lived views, see BufferView below.
  *
  * The class optionally allocates and owns memory for the image using
  * a shared pointer allocated with the provided allocator. If they are
  * null, malloc and free are used.  Any device-side allocation is
  * considered as owned if and only if the host-side allocation is
  * owned. */
-template<typename T = void, int D = 4>
+template<typename T = void, int D = HALIDE_RUNTIME_BUFFER_DEFAULT_DIMENSIONS>
 class Buffer {
     /** The underlying buffer_t */
     halide_buffer_t buf = {0};
@@ -818,6 +847,17 @@ public:
         decref();
     }
 
+    /** Take ownership of the host memory this buffer points to, which
+     * was allocated by some other means (e.g. mapped from a file). It is
+     * shared by copies of this Buffer like memory the Buffer allocated
+     * itself, and when the last reference is dropped, release_fn is
+     * called with the given context. */
+    void adopt_host_memory(void (*release_fn)(void *), void *context) {
+        assert(buf.host && !owns_host_memory() && "Can only adopt unowned host memory");
+        void *alloc_storage = malloc(sizeof(ExternalAllocationHeader));
+        alloc = new (alloc_storage) ExternalAllocationHeader(release_fn, context);
+    }
+
     /** Drop reference to any owned device memory, possibly freeing it
      * if this buffer held the last reference to it. Asserts that
      * device_dirty is false. */
@@ -1169,9 +1209,178 @@ public:
      * sprite onto a framebuffer, you'll want to translate the sprite
      * to the correct location first like so: \code
      * framebuffer.copy_from(sprite.translated({x, y})); \endcode
+     *
+     * The dimensions are traversed in the order of the strides of
+     * this Buffer, dense runs are copied with memcpy, and copies that
+     * change which dimension is innermost (e.g. planar to
+     * interleaved) are done in tiles.
     */
     template<typename T2, int D2>
     void copy_from(const Buffer<T2, D2> &other) {
+        copy_from_impl(other, false, nullptr);
+    }
+
+    /** Like copy_from, but splits large copies into tasks that run in
+     * parallel with halide_do_par_for, so this requires the Halide
+     * runtime. The user_context is passed to halide_do_par_for. */
+    template<typename T2, int D2>
+    void parallel_copy_from(const Buffer<T2, D2> &other, void *user_context = nullptr) {
+        copy_from_impl(other, true, user_context);
+    }
+
+private:
+    /** Helper functions for copy_from. */
+    // @{
+    struct copy_dim {
+        int extent;
+        int64_t src_stride, dst_stride;
+    };
+
+    // The size of the tiles of copies that transpose.
+    static constexpr int copy_tile_size = 32;
+
+    template<typename MemType>
+    static void copy_values(const MemType *src, MemType *dst, const copy_dim *dims, int d) {
+        if (d == 0) {
+            *dst = *src;
+        } else if (d == 1) {
+            const copy_dim &dim = dims[0];
+            if (dim.src_stride == 1 && dim.dst_stride == 1) {
+                memcpy(dst, src, dim.extent * sizeof(MemType));
+            } else {
+                for (int i = 0; i < dim.extent; i++) {
+                    dst[i * dim.dst_stride] = src[i * dim.src_stride];
+                }
+            }
+        } else if (d == 2 && dims[0].dst_stride == 1 && dims[1].src_stride == 1) {
+            // A transpose. Copy it in tiles, so each tile is read and
+            // written while it is in cache.
+            const copy_dim &x = dims[0], &y = dims[1];
+            for (int y0 = 0; y0 < y.extent; y0 += copy_tile_size) {
+                int y1 = std::min(y0 + copy_tile_size, y.extent);
+                for (int x0 = 0; x0 < x.extent; x0 += copy_tile_size) {
+                    int x1 = std::min(x0 + copy_tile_size, x.extent);
+                    for (int j = y0; j < y1; j++) {
+                        for (int i = x0; i < x1; i++) {
+                            dst[i + j * y.dst_stride] = src[i * x.src_stride + j];
+                        }
+                    }
+                }
+            }
+        } else {
+            const copy_dim &outer = dims[d - 1];
+            for (int i = 0; i < outer.extent; i++) {
+                copy_values(src + i * outer.src_stride, dst + i * outer.dst_stride, dims, d - 1);
+            }
+        }
+    }
+
+    template<typename MemType>
+    struct copy_task {
+        const MemType *src;
+        MemType *dst;
+        copy_dim *dims;
+        int d, rows_per_task;
+    };
+
+    // Copy some of the outermost dimension.
+    template<typename MemType>
+    static int copy_values_task(void *user_context, int task, uint8_t *closure) {
+        const copy_task<MemType> *t = (const copy_task<MemType> *)closure;
+        copy_dim *dims = (copy_dim *)HALIDE_ALLOCA(t->d * sizeof(copy_dim));
+        for (int i = 0; i < t->d; i++) {
+            dims[i] = t->dims[i];
+        }
+        copy_dim &outer = dims[t->d - 1];
+        int first = task * t->rows_per_task;
+        outer.extent = std::min(t->rows_per_task, outer.extent - first);
+        copy_values(t->src + first * outer.src_stride, t->dst + first * outer.dst_stride, dims, t->d);
+        return 0;
+    }
+
+    template<typename MemType>
+    static void copy_region(const MemType *src, MemType *dst, copy_dim *dims, int d,
+                            bool parallel, void *user_context) {
+        // Traverse the dimensions in the order of the destination's
+        // strides, and fuse the ones that are dense in both buffers.
+        int n = 0;
+        for (int i = 0; i < d; i++) {
+            if (dims[i].extent > 1) {
+                dims[n++] = dims[i];
+            }
+        }
+        d = n;
+        for (int i = 1; i < d; i++) {
+            for (int j = i; j > 0 && dims[j].dst_stride < dims[j - 1].dst_stride; j--) {
+                std::swap(dims[j], dims[j - 1]);
+            }
+        }
+        for (int i = 1; i < d; i++) {
+            if (dims[i - 1].src_stride * dims[i - 1].extent == dims[i].src_stride &&
+                dims[i - 1].dst_stride * dims[i - 1].extent == dims[i].dst_stride) {
+                dims[i - 1].extent *= dims[i].extent;
+                for (int j = i; j < d - 1; j++) {
+                    dims[j] = dims[j + 1];
+                }
+                i--;
+                d--;
+            }
+        }
+
+        // If the source is dense along some other dimension than the
+        // destination, put that dimension next to the innermost one,
+        // so the two are copied in tiles.
+        if (d > 2 && dims[0].dst_stride == 1 && dims[0].src_stride != 1) {
+            for (int i = 2; i < d; i++) {
+                if (dims[i].src_stride == 1) {
+                    copy_dim inner = dims[i];
+                    for (int j = i; j > 1; j--) {
+                        dims[j] = dims[j - 1];
+                    }
+                    dims[1] = inner;
+                    break;
+                }
+            }
+        }
+
+        // Split the outermost dimension into tasks of about a
+        // megabyte.
+        int64_t bytes = sizeof(MemType);
+        for (int i = 0; i < d; i++) {
+            bytes *= dims[i].extent;
+        }
+        const int64_t task_bytes = 1 << 20;
+        if (!parallel || d == 0 || bytes < 2 * task_bytes) {
+            copy_values(src, dst, dims, d);
+            return;
+        }
+        int rows = dims[d - 1].extent;
+        int64_t row_bytes = bytes / rows;
+        int rows_per_task = (int)std::max((int64_t)1, std::min((int64_t)rows, task_bytes / std::max((int64_t)1, row_bytes)));
+        if (d == 2 && dims[0].dst_stride == 1 && dims[1].src_stride == 1) {
+            // Keep the tiles whole.
+            rows_per_task = ((rows_per_task + copy_tile_size - 1) / copy_tile_size) * copy_tile_size;
+        }
+        copy_task<MemType> task = {src, dst, dims, d, rows_per_task};
+        int tasks = (rows + rows_per_task - 1) / rows_per_task;
+        halide_do_par_for(user_context, copy_values_task<MemType>, 0, tasks, (uint8_t *)&task);
+    }
+
+    template<typename MemType, typename T2, int D2>
+    static void copy_typed(Buffer<T2, D2> &dst, const Buffer<const T2, D2> &src,
+                           bool parallel, void *user_context) {
+        copy_dim *dims = (copy_dim *)HALIDE_ALLOCA(std::max(1, dst.dimensions()) * sizeof(copy_dim));
+        for (int i = 0; i < dst.dimensions(); i++) {
+            dims[i].extent = dst.dim(i).extent();
+            dims[i].src_stride = src.dim(i).stride();
+            dims[i].dst_stride = dst.dim(i).stride();
+        }
+        copy_region((const MemType *)src.data(), (MemType *)dst.data(), dims, dst.dimensions(),
+                    parallel, user_context);
+    }
+
+    template<typename T2, int D2>
+    void copy_from_impl(const Buffer<T2, D2> &other, bool parallel, void *user_context) {
         static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!other.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
@@ -1194,34 +1403,24 @@ public:
         }
 
         // If T is void, we need to do runtime dispatch to an
-        // appropriately-typed lambda. We're copying, so we only care
+        // appropriately-typed copy. We're copying, so we only care
         // about the element size.
         if (type().bytes() == 1) {
-            using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_typed<uint8_t>(dst, src, parallel, user_context);
         } else if (type().bytes() == 2) {
-            using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_typed<uint16_t>(dst, src, parallel, user_context);
         } else if (type().bytes() == 4) {
-            using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_typed<uint32_t>(dst, src, parallel, user_context);
         } else if (type().bytes() == 8) {
-            using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, D> &)dst;
-            auto &typed_src = (Buffer<const MemType, D> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) {dst = src;}, typed_src);
+            copy_typed<uint64_t>(dst, src, parallel, user_context);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
         set_host_dirty();
     }
+    // @}
 
+public:
     /** Make an image that refers to a sub-range of this image along
      * the given dimension. Asserts that the crop region is within
      * the existing bounds: you cannot "crop outwards", even if you know there
@@ -2274,6 +2473,467 @@ public:
 
 };
 
+/** A lightweight, non-owning view of the host memory of a Buffer or
+ * halide_buffer_t, for hot paths that make many short-lived crops and
+ * slices. A BufferView never allocates and does no reference
+ * counting: its shape always lives inside the object, so the source
+ * may have at most D dimensions, and it does not keep the memory it
+ * refers to alive. It refers to host memory only. The device fields
+ * of the source are dropped, so the source must not be device dirty,
+ * and dirty bits set on the view (e.g. by a pipeline writing to it)
+ * are not propagated back to the source. */
+template<typename T = void, int D = HALIDE_RUNTIME_BUFFER_DEFAULT_DIMENSIONS>
+class BufferView {
+    /** The underlying buffer_t */
+    halide_buffer_t buf = {0};
+
+    /** The in-class storage for the shape of the dimensions. */
+    halide_dimension_t shape[D];
+
+    static const bool T_is_void = std::is_same<typename std::remove_const<T>::type, void>::value;
+
+    template<typename T2>
+    using add_const_if_T_is_const = typename std::conditional<std::is_const<T>::value, const T2, T2>::type;
+
+    using not_void_T = typename std::conditional<T_is_void,
+                                                 add_const_if_T_is_const<uint8_t>,
+                                                 T>::type;
+
+    using storage_T = typename std::conditional<std::is_pointer<T>::value, uint64_t, not_void_T>::type;
+
+    void init_from(const halide_buffer_t &other) {
+        assert(other.dimensions <= D && "BufferView has too few dimensions for its source");
+        assert(!other.device_dirty() && "Cannot make a BufferView of a device-dirty buffer");
+        buf.host = other.host;
+        buf.type = other.type;
+        buf.dimensions = other.dimensions;
+        buf.dim = shape;
+        for (int i = 0; i < other.dimensions; i++) {
+            shape[i] = other.dim[i];
+        }
+        buf.set_host_dirty(other.host_dirty());
+    }
+
+    template<typename ...Args>
+    HALIDE_ALWAYS_INLINE
+    ptrdiff_t offset_of(int d, int first, Args... rest) const {
+        return offset_of(d+1, rest...) + shape[d].stride * (first - shape[d].min);
+    }
+
+    HALIDE_ALWAYS_INLINE
+    ptrdiff_t offset_of(int d) const {
+        return 0;
+    }
+
+    template<typename ...Args>
+    HALIDE_ALWAYS_INLINE
+    storage_T *address_of(Args... args) const {
+        if (T_is_void) {
+            return (storage_T *)(buf.host) + offset_of(0, args...) * buf.type.bytes();
+        } else {
+            return (storage_T *)(buf.host) + offset_of(0, args...);
+        }
+    }
+
+    template<typename T2, int D2> friend class BufferView;
+
+public:
+    typedef T ElemType;
+    typedef typename Buffer<T, D>::Dimension Dimension;
+
+    BufferView() {
+        buf.type = Buffer<T, D>::static_halide_type();
+        buf.dim = shape;
+    }
+
+    /** Make a view of a halide_buffer_t */
+    explicit BufferView(const halide_buffer_t &b) {
+        assert(T_is_void || b.type == (Buffer<T, D>::static_halide_type()));
+        init_from(b);
+    }
+
+    /** Make a view of a Buffer. The Buffer must outlive the view. */
+    template<typename T2, int D2>
+    BufferView(const Buffer<T2, D2> &b) {
+        Buffer<T, D>::assert_can_convert_from(b);
+        init_from(*b.raw_buffer());
+    }
+
+    /** Make a view of another view, possibly of a different type and
+     * dimensionality. */
+    template<typename T2, int D2>
+    BufferView(const BufferView<T2, D2> &other) {
+        static_assert((!std::is_const<T2>::value || std::is_const<T>::value),
+                      "Can't convert from a BufferView<const T> to a BufferView<T>");
+        assert(T_is_void || other.type() == (Buffer<T, D>::static_halide_type()));
+        init_from(other.buf);
+    }
+
+    BufferView(const BufferView<T, D> &other) {
+        init_from(other.buf);
+    }
+
+    BufferView<T, D> &operator=(const BufferView<T, D> &other) {
+        init_from(other.buf);
+        return *this;
+    }
+
+    /** Get a pointer to the raw halide_buffer_t this wraps, or cast
+     * to one to pass the view directly to a Halide filter. */
+    // @{
+    halide_buffer_t *raw_buffer() {
+        return &buf;
+    }
+
+    const halide_buffer_t *raw_buffer() const {
+        return &buf;
+    }
+
+    operator halide_buffer_t *() {
+        return &buf;
+    }
+    // @}
+
+    /** Access the shape of the view */
+    HALIDE_ALWAYS_INLINE Dimension dim(int i) const {
+        assert(i >= 0 && i < dimensions());
+        return Dimension(shape[i]);
+    }
+
+    int dimensions() const {
+        return buf.dimensions;
+    }
+
+    halide_type_t type() const {
+        return buf.type;
+    }
+
+    int width() const {
+        return (dimensions() > 0) ? dim(0).extent() : 1;
+    }
+
+    int height() const {
+        return (dimensions() > 1) ? dim(1).extent() : 1;
+    }
+
+    int channels() const {
+        return (dimensions() > 2) ? dim(2).extent() : 1;
+    }
+
+    /** The total number of elements this view covers. */
+    size_t number_of_elements() const {
+        size_t s = 1;
+        for (int i = 0; i < dimensions(); i++) {
+            s *= dim(i).extent();
+        }
+        return s;
+    }
+
+    /** A pointer to the element at the min coordinate. */
+    T *data() const {
+        return (T *)(buf.host);
+    }
+
+    /** Crop the view in-place along the given dimension. Asserts
+     * that the crop region is within the existing bounds. */
+    void crop(int d, int min, int extent) {
+        assert(d >= 0 && d < dimensions());
+        assert(dim(d).min() <= min);
+        assert(dim(d).max() >= min + extent - 1);
+        if (buf.host != nullptr) {
+            buf.host += (ptrdiff_t)(min - shape[d].min) * shape[d].stride * buf.type.bytes();
+        }
+        shape[d].min = min;
+        shape[d].extent = extent;
+    }
+
+    BufferView<T, D> cropped(int d, int min, int extent) const {
+        BufferView<T, D> v = *this;
+        v.crop(d, min, extent);
+        return v;
+    }
+
+    /** Slice the view in-place, removing dimension d. */
+    void slice(int d, int pos) {
+        assert(d >= 0 && d < dimensions());
+        assert(pos >= dim(d).min() && pos <= dim(d).max());
+        if (buf.host != nullptr) {
+            buf.host += (ptrdiff_t)(pos - shape[d].min) * shape[d].stride * buf.type.bytes();
+        }
+        buf.dimensions--;
+        for (int i = d; i < buf.dimensions; i++) {
+            shape[i] = shape[i+1];
+        }
+    }
+
+    BufferView<T, D> sliced(int d, int pos) const {
+        BufferView<T, D> v = *this;
+        v.slice(d, pos);
+        return v;
+    }
+
+    /** Shift the coordinate system of the view along one dimension. */
+    void translate(int d, int delta) {
+        assert(d >= 0 && d < dimensions());
+        shape[d].min += delta;
+    }
+
+    BufferView<T, D> translated(int d, int delta) const {
+        BufferView<T, D> v = *this;
+        v.translate(d, delta);
+        return v;
+    }
+
+    /** Swap two dimensions of the view. */
+    void transpose(int d1, int d2) {
+        assert(d1 >= 0 && d1 < dimensions());
+        assert(d2 >= 0 && d2 < dimensions());
+        std::swap(shape[d1], shape[d2]);
+    }
+
+    BufferView<T, D> transposed(int d1, int d2) const {
+        BufferView<T, D> v = *this;
+        v.transpose(d1, d2);
+        return v;
+    }
+
+    /** Access elements. If you pass fewer arguments than the view has
+     * dimensions, the rest are treated as their min coordinate. Unlike
+     * Buffer, writing through a view does not set the host dirty
+     * bit. */
+    // @{
+    template<typename ...Args,
+             typename = typename std::enable_if<AllInts<Args...>::value>::type>
+    HALIDE_ALWAYS_INLINE
+    const not_void_T &operator()(int first, Args... rest) const {
+        static_assert(!T_is_void,
+                      "Cannot use operator() on BufferView<void> types");
+        return *((const not_void_T *)(address_of(first, rest...)));
+    }
+
+    template<typename ...Args,
+             typename = typename std::enable_if<AllInts<Args...>::value>::type>
+    HALIDE_ALWAYS_INLINE
+    not_void_T &operator()(int first, Args... rest) {
+        static_assert(!T_is_void,
+                      "Cannot use operator() on BufferView<void> types");
+        return *((not_void_T *)(address_of(first, rest...)));
+    }
+    // @}
+};
+
+/** A compile-time shape: the extents of each dimension, innermost
+ * first, with a min of zero and dense strides. */
+// @{
+template<int ...Extents>
+struct StaticShape;
+
+template<>
+struct StaticShape<> {
+    static constexpr int dimensions = 0;
+    static constexpr int elements = 1;
+    static constexpr int extent(int) { return 1; }
+    static constexpr int stride(int) { return 1; }
+};
+
+template<int E, int ...Rest>
+struct StaticShape<E, Rest...> {
+    static_assert(E > 0, "StaticShape extents must be positive");
+    static constexpr int dimensions = 1 + StaticShape<Rest...>::dimensions;
+    static constexpr int elements = E * StaticShape<Rest...>::elements;
+    static constexpr int extent(int d) {
+        return d == 0 ? E : StaticShape<Rest...>::extent(d - 1);
+    }
+    static constexpr int stride(int d) {
+        return d == 0 ? 1 : E * StaticShape<Rest...>::stride(d - 1);
+    }
+};
+// @}
+
+/** A small dense buffer whose extents are fixed at compile time, and
+ * whose storage lives inside the object. Element access and
+ * for_each_element/for_each_value compile down to constant index
+ * math with fully known loop bounds, which suits tiny fixed-size
+ * tensors such as 3x3 filter kernels and color matrices. It never
+ * allocates. It can be passed directly to a Halide filter; pair it
+ * with ImageParam::set_static_shape (or the same method on a
+ * Generator Input) with the same extents to let the pipeline
+ * constant-fold its side too. */
+template<typename T, int ...Extents>
+class StaticShapeBuffer {
+    static_assert(!std::is_void<typename std::remove_const<T>::type>::value,
+                  "StaticShapeBuffer requires a static element type");
+    static_assert(!std::is_pointer<T>::value,
+                  "StaticShapeBuffer does not support pointer element types");
+
+    using Shape = StaticShape<Extents...>;
+    using not_const_T = typename std::remove_const<T>::type;
+
+    static constexpr int D = Shape::dimensions;
+
+    not_const_T storage[Shape::elements];
+    halide_buffer_t buf = {0};
+    halide_dimension_t shape[D > 0 ? D : 1];
+
+    void init() {
+        buf.host = (uint8_t *)storage;
+        buf.type = halide_type_of<not_const_T>();
+        buf.dimensions = D;
+        buf.dim = shape;
+        for (int i = 0; i < D; i++) {
+            shape[i].min = 0;
+            shape[i].extent = Shape::extent(i);
+            shape[i].stride = Shape::stride(i);
+            shape[i].flags = 0;
+        }
+    }
+
+    template<int d, typename ...Args>
+    HALIDE_ALWAYS_INLINE
+    static ptrdiff_t offset_of(int first, Args... rest) {
+        return (ptrdiff_t)first * Shape::stride(d) + offset_of<d + 1>(rest...);
+    }
+
+    template<int d>
+    HALIDE_ALWAYS_INLINE
+    static ptrdiff_t offset_of() {
+        return 0;
+    }
+
+    /** Loop over dimension d, outermost first, prepending each
+     * coordinate to the ones already chosen. */
+    template<typename Fn, int d, typename ...Args>
+    HALIDE_ALWAYS_INLINE
+    static void for_each_element_impl(Fn &f, std::integral_constant<int, d>, Args... args) {
+        for (int i = 0; i < Shape::extent(d); i++) {
+            for_each_element_impl(f, std::integral_constant<int, d - 1>(), i, args...);
+        }
+    }
+
+    template<typename Fn, typename ...Args>
+    HALIDE_ALWAYS_INLINE
+    static void for_each_element_impl(Fn &f, std::integral_constant<int, -1>, Args... args) {
+        f(args...);
+    }
+
+public:
+    typedef T ElemType;
+
+    /** Make a buffer with uninitialized contents. */
+    StaticShapeBuffer() {
+        init();
+    }
+
+    /** Make a buffer with every element set to val. */
+    explicit StaticShapeBuffer(not_const_T val) {
+        init();
+        for (int i = 0; i < Shape::elements; i++) {
+            storage[i] = val;
+        }
+    }
+
+    StaticShapeBuffer(const StaticShapeBuffer<T, Extents...> &other) {
+        init();
+        memcpy(storage, other.storage, sizeof(storage));
+    }
+
+    StaticShapeBuffer<T, Extents...> &operator=(const StaticShapeBuffer<T, Extents...> &other) {
+        memmove(storage, other.storage, sizeof(storage));
+        return *this;
+    }
+
+    static constexpr int dimensions() {
+        return D;
+    }
+
+    static constexpr int extent(int d) {
+        return Shape::extent(d);
+    }
+
+    static constexpr int stride(int d) {
+        return Shape::stride(d);
+    }
+
+    static constexpr int number_of_elements() {
+        return Shape::elements;
+    }
+
+    T *data() {
+        return storage;
+    }
+
+    const T *data() const {
+        return storage;
+    }
+
+    /** Get a pointer to the halide_buffer_t describing this buffer,
+     * or cast to one to pass it directly to a Halide filter. */
+    // @{
+    halide_buffer_t *raw_buffer() {
+        return &buf;
+    }
+
+    const halide_buffer_t *raw_buffer() const {
+        return &buf;
+    }
+
+    operator halide_buffer_t *() {
+        return &buf;
+    }
+    // @}
+
+    /** Access elements. Exactly one coordinate per dimension is
+     * required. */
+    // @{
+    template<typename ...Args,
+             typename = typename std::enable_if<AllInts<Args...>::value>::type>
+    HALIDE_ALWAYS_INLINE
+    const T &operator()(Args... args) const {
+        static_assert(sizeof...(Args) == D, "Wrong number of coordinates for StaticShapeBuffer");
+        return storage[offset_of<0>(args...)];
+    }
+
+    template<typename ...Args,
+             typename = typename std::enable_if<AllInts<Args...>::value>::type>
+    HALIDE_ALWAYS_INLINE
+    T &operator()(Args... args) {
+        static_assert(sizeof...(Args) == D, "Wrong number of coordinates for StaticShapeBuffer");
+        return storage[offset_of<0>(args...)];
+    }
+    // @}
+
+    /** Call f with the coordinates of every element, one int per
+     * dimension, with dimension 0 varying fastest. */
+    template<typename Fn>
+    StaticShapeBuffer<T, Extents...> &for_each_element(Fn &&f) {
+        for_each_element_impl(f, std::integral_constant<int, D - 1>());
+        return *this;
+    }
+
+    template<typename Fn>
+    const StaticShapeBuffer<T, Extents...> &for_each_element(Fn &&f) const {
+        for_each_element_impl(f, std::integral_constant<int, D - 1>());
+        return *this;
+    }
+
+    /** Call f with a reference to every element in memory order. */
+    template<typename Fn>
+    StaticShapeBuffer<T, Extents...> &for_each_value(Fn &&f) {
+        for (int i = 0; i < Shape::elements; i++) {
+            f(storage[i]);
+        }
+        return *this;
+    }
+
+    template<typename Fn>
+    const StaticShapeBuffer<T, Extents...> &for_each_value(Fn &&f) const {
+        for (int i = 0; i < Shape::elements; i++) {
+            f((const T &)storage[i]);
+        }
+        return *this;
+    }
+};
+
 }  // namespace Runtime
 }  // namespace Halide
 
@@ -149,6 +149,33 @@ extern int halide_default_do_task(void *user_context, halide_task_t f, int idx,
                                   uint8_t *closure);
 // @}
 
+/** A semaphore. Used by async producers to synchronize with their
+ * consumers (see Func::async). Must be initialized with
+ * halide_semaphore_init before use. */
+struct halide_semaphore_t {
+    uint64_t _private[2];
+};
+
+/** Initialize, release, and acquire a semaphore. halide_semaphore_init
+ * and halide_semaphore_release return zero on success.
+ * halide_semaphore_try_acquire never blocks, and returns whether or
+ * not it succeeded. halide_semaphore_acquire blocks until the count
+ * can be decremented by n, and returns zero on success. */
+//@{
+extern int halide_semaphore_init(struct halide_semaphore_t *, int n);
+extern int halide_semaphore_release(struct halide_semaphore_t *, int n);
+extern bool halide_semaphore_try_acquire(struct halide_semaphore_t *, int n);
+extern int halide_semaphore_acquire(struct halide_semaphore_t *, int n);
+//@}
+
+/** Like halide_do_par_for, except that all of the tasks are
+ * guaranteed to be running at the same time, so they may block on
+ * semaphores released by each other. The last task runs on the
+ * calling thread, and every other task gets a dedicated helper
+ * thread. Used to implement async producers. */
+extern int halide_do_parallel_tasks(void *user_context, halide_task_t task,
+                                    int min, int size, uint8_t *closure);
+
 struct halide_thread;
 
 /** Spawn a thread. Returns a handle to the thread for the purposes of
@@ -177,6 +204,44 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Enable or disable work-stealing mode in the default thread
+ * pool. Returns the old setting. In work-stealing mode the tasks of
+ * each parallel for loop are divided between per-thread ranges, and
+ * threads that run out of work steal from their peers, so claiming a
+ * task does not contend on the thread pool's lock. This helps
+ * fine-grained parallel loops on machines with many cores. The
+ * initial setting is taken from the environment variable
+ * HL_WORK_STEALING (off if unset). Jobs already in flight are
+ * unaffected by a change. (As with halide_set_num_threads, custom
+ * implementations of halide_do_par_for may ignore this.)
+ */
+extern int halide_set_work_stealing(int enable);
+
+/** Enable or disable NUMA-aware mode in the default thread
+ * pool. Returns the old setting. In NUMA-aware mode each worker
+ * thread pins itself to a core, with the workers numbered so that
+ * the cores of each node are consecutive, and parallel for loops run
+ * in work-stealing mode. Each worker so gets a contiguous range of
+ * every loop, on the same node each time the loop runs with the same
+ * size, and thieves prefer ranges on their own node. Memory that a
+ * parallel loop touches first is then allocated on the node that
+ * goes on to use it. The initial setting is taken from the
+ * environment variable HL_NUMA (off if unset). Turning it off again
+ * does not unpin threads that have already pinned themselves.
+ */
+extern int halide_set_numa_aware(int enable);
+
+/** Set how long idle worker threads in the default thread pool spin
+ * before going to sleep, as a number of calls to yield the CPU, with
+ * a check for new work after each. Returns the old setting. Spinning
+ * saves the cost of waking a sleeping thread when pipelines run back
+ * to back, at the expense of keeping the cores busy. A negative count
+ * keeps idle workers spinning until the setting is changed, which
+ * keeps them hot between pipeline invocations. The initial setting is
+ * taken from the environment variable HL_SPIN_COUNT (zero if unset).
+ */
+extern int halide_set_worker_spin_count(int spin_count);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -205,6 +270,38 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** An optional pooling allocator, built on halide_default_malloc and
+ * halide_default_free. Freed blocks are kept in per-size-class free
+ * lists, striped across threads, and reused by later allocations of
+ * a similar size, including across pipeline invocations. To use it,
+ * pass halide_pool_malloc and halide_pool_free to
+ * halide_set_custom_malloc and halide_set_custom_free before anything
+ * is allocated; memory from one allocator must not be freed with the
+ * other. halide_pool_trim releases all cached free blocks back to
+ * halide_default_free.
+ */
+//@{
+extern void *halide_pool_malloc(void *user_context, size_t x);
+extern void halide_pool_free(void *user_context, void *ptr);
+extern void halide_pool_trim(void *user_context);
+//@}
+
+/** An optional allocator for large buffers on Linux and Android.
+ * Allocations of at least a threshold size (32MB by default) are made
+ * of whole, aligned 2MB pages and marked with madvise(MADV_HUGEPAGE),
+ * so that the kernel backs them with transparent huge pages. This
+ * cuts down on TLB misses when walking a large buffer with a big
+ * stride, e.g. down the columns of an image. Smaller allocations go to
+ * halide_default_malloc. To use it, pass halide_huge_page_malloc to
+ * halide_set_custom_malloc; its allocations are freed with
+ * halide_default_free. halide_set_huge_page_threshold changes the
+ * threshold and returns the old one.
+ */
+//@{
+extern void *halide_huge_page_malloc(void *user_context, size_t x);
+extern size_t halide_set_huge_page_threshold(size_t bytes);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -252,7 +349,8 @@ typedef enum halide_type_code_t
     halide_type_int = 0,   //!< signed integers
     halide_type_uint = 1,  //!< unsigned integers
     halide_type_float = 2, //!< floating point numbers
-    halide_type_handle = 3 //!< opaque pointer type (void *)
+    halide_type_handle = 3, //!< opaque pointer type (void *)
+    halide_type_bfloat = 4  //!< brain floating point numbers: the top 16 bits of an IEEE float
 } halide_type_code_t;
 
 // Note that while __attribute__ can go before or after the declaration,
@@ -507,7 +605,9 @@ struct halide_trace_packet_t {
  * Halide checks the for existence of an environment variable called
  * HL_TRACE_FILE and opens that file. If HL_TRACE_FILE is not defined,
  * it outputs trace information to stdout in a human-readable
- * format. */
+ * format. If HL_TRACE_COMPRESS is also set to a nonzero value, the
+ * file is replaced with a trace in the compressed, indexed format
+ * described in tools/halide_trace_stream.h. */
 extern void halide_set_trace_file(int fd);
 
 /** Halide calls this to retrieve the file descriptor to write binary
@@ -699,6 +799,24 @@ extern void halide_set_gpu_device(int n);
  * HL_GPU_DEVICE. */
 extern int halide_get_gpu_device(void *user_context);
 
+/** Selects which gpu device the calling thread uses, overriding
+ * halide_set_gpu_device for that thread only. Pass -1 to remove the
+ * override. Returns the previous override, or -1 if there was
+ * none. Loops scheduled with Func::distribute_gpus use this to run
+ * each iteration on its own device. Only the CUDA runtime keeps a
+ * separate context per device; other runtimes only use the override
+ * when they first create their context. */
+extern int halide_set_thread_gpu_device(void *user_context, int n);
+
+/** Returns the gpu device set for the calling thread by
+ * halide_set_thread_gpu_device, or -1 if there is none. */
+extern int halide_get_thread_gpu_device(void *user_context);
+
+/** The destructor form of halide_set_thread_gpu_device, used to
+ * restore the previous override when a distributed loop iteration
+ * ends. obj holds the device to restore plus two. */
+extern void halide_set_thread_gpu_device_as_destructor(void *user_context, void *obj);
+
 /** Set the soft maximum amount of memory, in bytes, that the LRU
  *  cache will use to memoize Func results.  This is not a strict
  *  maximum in that concurrency and simultaneous use of memoized
@@ -707,6 +825,26 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Set the soft maximum amount of device memory, in bytes, that the
+ *  memoization cache will hold on to. Memoized Funcs computed on a
+ *  device keep their results in device memory, so that a later hit
+ *  can be used there without a copy. Those results count against
+ *  this limit as well as the one set by
+ *  halide_memoization_cache_set_size. Passing zero restores the
+ *  default.
+ */
+extern void halide_memoization_cache_set_device_size(int64_t size);
+
+/** Set the number of independently locked shards the memoization
+ *  cache is split into, and the initial number of hash buckets in
+ *  each shard. Both are rounded up to a power of two, and passing
+ *  zero for either restores its default. Each shard's table grows as
+ *  entries are added. This flushes the cache, so it must be called at
+ *  a time when no other threads are accessing the cache, and fails
+ *  if any cached results are still in use. Returns zero on success.
+ */
+extern int halide_memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -747,6 +885,22 @@ extern int halide_memoization_cache_store(void *user_context, const uint8_t *cac
                                           int32_t tuple_count,
                                           struct halide_buffer_t **tuple_buffers);
 
+/** Like halide_memoization_cache_store, with a byte budget for the
+ * entries of one memoized Func, and the time it took to compute this
+ * result. Funcs scheduled with Func::memoize store their results
+ * this way. If budget_size is positive, entries stored with the same
+ * budget_id (the address of a string naming the Func, which is not
+ * dereferenced) are evicted, least recently used first, once they
+ * take up more than budget_size bytes. The compute time makes
+ * results that are slow to recompute, per byte, less likely to be
+ * evicted when the cache is full. */
+extern int halide_memoization_cache_store_with_budget(void *user_context, const uint8_t *cache_key, int32_t size,
+                                                      struct halide_buffer_t *realized_bounds,
+                                                      int32_t tuple_count,
+                                                      struct halide_buffer_t **tuple_buffers,
+                                                      const void *budget_id, int64_t budget_size,
+                                                      int64_t compute_time_ns);
+
 /** If halide_memoization_cache_lookup succeeds,
  * halide_memoization_cache_release must be called to signal the
  * storage is no longer being used by the caller. It will be passed
@@ -764,11 +918,93 @@ extern int halide_memoization_cache_store(void *user_context, const uint8_t *cac
   */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Called after the last use of a memoized buffer that may have a
+ * device allocation, and before halide_memoization_cache_release. If
+ * the device allocation is held by the cache, the buffer is detached
+ * from it; otherwise it is freed. Returns zero on success.
+ */
+extern int halide_memoization_cache_release_device(void *user_context, struct halide_buffer_t *buf);
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Statistics about the memoization cache, from
+ * halide_memoization_cache_get_stats. */
+struct halide_memoization_cache_stats_t {
+    /** The number of lookups that found a result, and that didn't,
+     * since the program started. */
+    uint64_t hits, misses;
+
+    /** The number of results evicted to stay within the cache size
+     * or a per-Func budget, since the program started. Entries freed
+     * by halide_memoization_cache_cleanup are not counted. */
+    uint64_t evictions;
+
+    /** The number of results currently in the cache, and the bytes
+     * they take up. */
+    uint64_t entries;
+    int64_t current_size;
+
+    /** The bytes of those results that are held in device memory. */
+    int64_t current_device_size;
+};
+
+/** Fill in stats with the current statistics of the memoization
+ * cache. */
+extern void halide_memoization_cache_get_stats(struct halide_memoization_cache_stats_t *stats);
+
+/** Pipelines compiled with Target::CacheShapeChecks call
+ * halide_shape_cache_lookup before checking their buffer arguments,
+ * with a signature made of the scalar arguments and buffer fields
+ * (mins, extents, strides, types) that the checks read. If it returns
+ * nonzero, the checks are skipped. Otherwise they are run, and
+ * halide_shape_cache_store is called with the same signature once
+ * they pass. The id identifies the pipeline and its checks.
+ *
+ * The default implementation remembers the last signature validated
+ * for each pipeline in a small process-wide table. These may be
+ * replaced to keep the state somewhere else, such as in an object
+ * reached through the user context. A lookup may only succeed for a
+ * signature previously stored with the same id. */
+// @{
+extern int halide_shape_cache_lookup(void *user_context, uint64_t id,
+                                     const int64_t *signature, int32_t size);
+extern int halide_shape_cache_store(void *user_context, uint64_t id,
+                                    const int64_t *signature, int32_t size);
+// @}
+
+/** Forget all signatures stored by the default implementation of
+ * halide_shape_cache_store. */
+extern void halide_shape_cache_cleanup();
+
+/** A callback that fills in one page of a paged input (see
+ * Halide::paged_input). page has the input's type, its min and
+ * extent describe the page, and its dense host allocation is to be
+ * filled with the values of the input over that region. Returns zero
+ * on success; a nonzero result is returned by the pipeline. */
+typedef int (*halide_page_provider_t)(void *user_context, const char *name,
+                                      struct halide_buffer_t *page);
+
+/** Set the callback used to fill in the pages of paged inputs, and
+ * return the previous one. Pages are kept in the memoization cache,
+ * so halide_memoization_cache_set_size bounds how many stay
+ * resident, and the least recently used are evicted first. Changing
+ * the provider does not flush pages already in the cache; call
+ * halide_memoization_cache_cleanup to do that. */
+extern halide_page_provider_t halide_set_page_provider(halide_page_provider_t provider);
+
+/** The extern stage behind Halide::paged_input. Fills out with the
+ * values of the named input, one page at a time, fetching any pages
+ * not in the cache from the page provider. Pages are page_extent_i
+ * in dimension i, aligned to multiples of that, for inputs of up to
+ * four dimensions. */
+extern int halide_paged_input(void *user_context, const char *name,
+                              int32_t page_extent_0, int32_t page_extent_1,
+                              int32_t page_extent_2, int32_t page_extent_3,
+                              struct halide_buffer_t *out);
+
 /** Create a unique file with a name of the form prefixXXXXXsuffix in an arbitrary
  * (but writable) directory; this is typically $TMP or /tmp, but the specific
  * location is not guaranteed. (Note that the exact form of the file name
@@ -1144,7 +1380,24 @@ typedef enum halide_target_feature_t {
     halide_target_feature_asan = 53, ///< Enable hooks for ASAN support.
     halide_target_feature_d3d12compute = 54, ///< Enable Direct3D 12 Compute runtime.
     halide_target_feature_check_unsafe_promises = 55, ///< Insert assertions for promises.
-    halide_target_feature_end = 56 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
+    halide_target_feature_batch = 56, ///< Generate a batched entry point that runs many inputs at once in a single call.
+    halide_target_feature_unchecked_entry = 57, ///< Also export <name>_unchecked, with no assertions, and <name>_validate, which only checks the arguments.
+    halide_target_feature_zero_copy = 58, ///< Let OpenCL and Metal device allocations use the host allocation directly, for GPUs that share memory with the host.
+    halide_target_feature_avx512_vnni = 59, ///< Enable the AVX512-VNNI dot product instructions of Cascade Lake and newer Xeon processors, in addition to all of the Skylake features.
+    halide_target_feature_arm_dot_prod = 60, ///< Enable the ARMv8.2 udot/sdot dot product instructions.
+    halide_target_feature_arm_fp16 = 61, ///< Enable the ARMv8.2 half precision floating point arithmetic instructions.
+    halide_target_feature_cuda_capability70 = 62, ///< Enable CUDA compute capability 7.0 (Volta), which has tensor cores.
+    halide_target_feature_arm_sve = 63, ///< Enable the ARM Scalable Vector Extension, using predicated vector tails.
+    halide_target_feature_minimize_memory = 64, ///< Reorder independent stages and share heap allocations with disjoint lifetimes to reduce peak memory use.
+    halide_target_feature_vulkan = 65, ///< Enable the Vulkan compute runtime.
+    halide_target_feature_cache_shape_checks = 66, ///< Skip the checks on buffer arguments when their shapes match the last call that passed them.
+    halide_target_feature_fast_float16_conversions = 67, ///< On targets without native float16 conversions, convert floats to float16 by truncation, flushing denormals to zero.
+    halide_target_feature_gpu_persistent_threads = 68, ///< Launch GPU kernels with a bounded number of blocks that each loop over many work items.
+    halide_target_feature_concurrent_stages = 69, ///< Run the productions of independent Funcs computed at root concurrently.
+    halide_target_feature_avx512_256 = 70, ///< Use AVX-512 instructions, but with vectors of at most 256 bits, which don't lower the clock speed of Skylake-SP.
+    halide_target_feature_power_arch_3_00 = 71, ///< Use POWER ISA 3.00 (POWER9) instructions, including VSX 3.0. Implies POWER_ARCH_2_07 and VSX.
+    halide_target_feature_deterministic_reductions = 72, ///< Reject parallel reductions whose floating-point result depends on thread scheduling.
+    halide_target_feature_end = 73 ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
 /** This function is called internally by Halide in some situations to determine
@@ -1518,6 +1771,30 @@ struct halide_profiler_func_stats {
 
     /** The total number of memory allocation of this Func. */
     int num_allocs;
+
+    /** Time spent running parallel tasks of this Func, summed over
+     * all the threads running them (in nanoseconds). */
+    uint64_t task_time;
+
+    /** Time threads spent idle while this Func had a parallel loop
+     * in flight, summed over the idle threads (in nanoseconds). Large
+     * values relative to task_time mean the loop is starving its
+     * workers, e.g. due to load imbalance. */
+    uint64_t idle_time;
+
+    /** The most tasks of this Func seen running at once. */
+    int max_tasks;
+
+    /** Hardware performance counter totals while computing this
+     * Func, summed over all threads. Only gathered on x86 Linux when
+     * the environment variable HL_PROFILER_COUNTERS is set; zero
+     * otherwise. */
+    uint64_t cycles, instructions, llc_misses;
+
+    /** Time spent running this Func's GPU kernels, and copying its
+     * buffers between the host and the device, as measured by the
+     * device (in nanoseconds). */
+    uint64_t gpu_time, gpu_copy_time;
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
@@ -1563,6 +1840,20 @@ struct halide_profiler_pipeline_stats {
 
     /** The total number of memory allocation of funcs in this pipeline. */
     int num_allocs;
+
+    /** Hardware performance counter totals for this pipeline. See
+     * halide_profiler_func_stats. */
+    uint64_t cycles, instructions, llc_misses;
+
+    /** GPU kernel and copy time for this pipeline. See
+     * halide_profiler_func_stats. */
+    uint64_t gpu_time, gpu_copy_time;
+};
+
+/** The number of parallel tasks that the profiler can track
+ * individually at once. */
+enum {
+    halide_profiler_task_slots = 64
 };
 
 /** The global state of the profiler. */
@@ -1597,6 +1888,28 @@ struct halide_profiler_state {
 
     /** Sampling thread reference to be joined at shutdown. */
     struct halide_thread *sampling_thread;
+
+    /** If positive, the time the profiler thread sleeps between
+     * samples in microseconds, overriding sleep_time. Use this for
+     * sampling at intervals below a millisecond. */
+    int sleep_time_us;
+
+    /** The number of parallel loops currently running. */
+    int running_parallel_loops;
+
+    /** The most parallel tasks seen running at once, used as an
+     * estimate of the number of threads available to do work. */
+    int max_running_tasks;
+
+    /** One plus the id of the Func computed by each running parallel
+     * task, or zero for slots not in use. Tasks claim a slot on entry
+     * and release it on exit. */
+    int task_funcs[halide_profiler_task_slots];
+
+    /** The begin and end times of parallel tasks recorded since
+     * halide_profiler_start_timeline was called, or NULL if no
+     * timeline is being recorded. */
+    void *timeline;
 };
 
 /** Profiler func ids with special meanings. */
@@ -1636,6 +1949,31 @@ void halide_profiler_shutdown();
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** Print out the same statistics as halide_profiler_report, as a JSON
+ * document, through halide_print. */
+extern void halide_profiler_report_json(void *user_context);
+
+/** Start recording the begin and end time of every parallel task run
+ * by profiled pipelines, for up to max_events tasks; later tasks are
+ * dropped. Setting the environment variable HL_PROFILER_TIMELINE to a
+ * filename does this automatically when the first profiled pipeline
+ * starts, and writes the timeline to that file at exit. Do not call
+ * this while any pipeline is running. */
+extern int halide_profiler_start_timeline(void *user_context, int max_events);
+
+/** Write the tasks recorded since halide_profiler_start_timeline to a
+ * file in the Chrome trace event format, for viewing in
+ * chrome://tracing or Perfetto. Each task slot (roughly, each thread)
+ * is shown as its own track. */
+extern int halide_profiler_write_timeline(void *user_context, const char *filename);
+
+/** Add time spent on a GPU to the stats of a Func. The GPU runtimes
+ * call this with the duration of each kernel launch and each copy
+ * between the host and the device, billed to the Func in
+ * halide_profiler_state::current_func when they were issued. Ids that
+ * don't belong to a profiled pipeline are ignored. */
+extern void halide_profiler_record_gpu_time(int func_id, uint64_t kernel_ns, uint64_t copy_ns);
+
 /// \name "Float16" functions
 /// These functions operate of bits (``uint16_t``) representing a half
 /// precision floating point number (IEEE-754 2008 binary16).
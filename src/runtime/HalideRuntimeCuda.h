@@ -16,7 +16,9 @@ extern "C" {
 extern const struct halide_device_interface_t *halide_cuda_device_interface();
 
 /** These are forward declared here to allow clients to override the
- *  Halide Cuda runtime. Do not call them. */
+ *  Halide Cuda runtime. Do not call them. arg_is_buffer is 0 for
+ *  scalar arguments, 1 for buffers the kernel only reads, and 2 for
+ *  buffers it writes. */
 // @{
 extern int halide_cuda_initialize_kernels(void *user_context, void **state_ptr,
                                           const char *src, int size);
@@ -59,6 +61,54 @@ extern int halide_cuda_detach_device_ptr(void *user_context, struct halide_buffe
  */
 extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_buffer_t *buf);
 
+/** Make the default halide_cuda_get_stream use CUDA's per-thread
+ * default stream instead of the legacy default stream, so pipelines
+ * run from different threads can overlap their copies and kernels.
+ * All GPU work of a pipeline must then be launched from the thread
+ * that called it; don't use this when GPU loops are nested inside
+ * parallel CPU loops. Returns the previous setting. */
+extern bool halide_cuda_set_use_per_thread_stream(bool use);
+
+/** Set the high-water mark, in bytes, for device allocations that
+ * have been freed by Halide but are kept around to be reused by
+ * later allocations of a similar size on the same context. Sizes
+ * are rounded up to one of four buckets per power of two. The
+ * default is zero, which frees device allocations immediately. If
+ * the new mark is lower than what is currently held, unused
+ * allocations on the current context are freed to get under it. */
+extern int halide_cuda_set_max_cached_device_bytes(void *user_context, size_t max_bytes);
+
+/** Free all unused device allocations being held for reuse on the
+ * current context. halide_device_release also does this. */
+extern int halide_cuda_release_unused_device_allocations(void *user_context);
+
+/** Start capturing the GPU work of pipelines run on the current
+ * context into a CUDA graph, instead of running it. Call a pipeline
+ * once between this and halide_cuda_end_graph_capture, and then use
+ * halide_cuda_launch_graph to replay its kernel launches and copies
+ * with much less CPU overhead than calling the pipeline again. The
+ * replay uses the same buffers and scalar arguments as the captured
+ * call, so keep a graph per set of shapes and arguments, and update
+ * inputs in place. Intermediate device allocations freed during the
+ * capture are kept alive by the graph. Pipelines copying to the host
+ * or synchronizing with it can't be captured, and copies from the
+ * host should use pinned memory, e.g. from
+ * halide_cuda_device_and_host_malloc. No other thread should run
+ * CUDA pipelines on the context during the capture. Requires a driver
+ * supporting CUDA 10.1. */
+extern int halide_cuda_begin_graph_capture(void *user_context);
+
+/** Stop capturing and store the captured graph in *graph. */
+extern int halide_cuda_end_graph_capture(void *user_context, void **graph);
+
+/** Replay a captured graph on the stream returned by
+ * halide_cuda_get_stream. This is asynchronous; use
+ * halide_device_sync or a copy to the host to wait for it. */
+extern int halide_cuda_launch_graph(void *user_context, void *graph);
+
+/** Free a captured graph and the device allocations it kept alive. */
+extern int halide_cuda_release_graph(void *user_context, void *graph);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
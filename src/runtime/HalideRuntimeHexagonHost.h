@@ -57,6 +57,21 @@ extern int halide_hexagon_power_hvx_off(void *user_context);
 extern void halide_hexagon_power_hvx_off_as_destructor(void *user_context, void * /* obj */);
 // @}
 
+/** Each pipeline run on Hexagon is normally a FastRPC call, which
+ * maps and unmaps its buffers and can take hundreds of microseconds
+ * even for small pipelines. A session instead keeps a thread running
+ * on the DSP, and pipelines are run by posting them to it via shared
+ * memory. Buffers allocated by the Hexagon device interface are
+ * mapped to the DSP once, the first time they are used in the
+ * session, until they are freed. Pipelines with other buffers still
+ * use a FastRPC call. Ending the session stops the thread on the
+ * DSP. The session is also ended by
+ * halide_hexagon_device_release. */
+// @{
+extern int halide_hexagon_start_session(void *user_context);
+extern int halide_hexagon_end_session(void *user_context);
+// @}
+
 /** Power modes for Hexagon. */
 typedef enum halide_hexagon_power_mode_t {
     halide_hexagon_power_low          = 0,
@@ -113,6 +128,15 @@ extern int halide_hexagon_set_performance_mode(void *user_context, halide_hexago
 extern int halide_hexagon_set_performance(void *user_context, halide_hexagon_power_t *perf);
 // @}
 
+/** By default, the runtime turns HVX on and votes for
+ * halide_hexagon_power_turbo while pipelines run on Hexagon. It drops
+ * the vote once no pipeline has run for 100 ms. Calling any of the
+ * power management functions above turns this off, leaving power
+ * management to the application. This function turns it back on or
+ * off, or changes the mode voted for and the idle timeout. */
+extern int halide_hexagon_set_auto_power(void *user_context, bool enabled,
+                                         halide_hexagon_power_mode_t mode, int idle_timeout_ms);
+
 /** These are forward declared here to allow clients to override the
  *  Halide Hexagon runtime. Do not call them. */
 // @{
@@ -81,6 +81,11 @@ struct halide_metal_command_queue;
  *     halide_metal_detach_buffer.
  * - halide_device_release has been called on the interface returned from
  *     halide_metal_device_interface(). (This releases the programs on the context.)
+ *
+ * Halide encodes the kernels it runs into a command buffer that is only
+ * committed to the queue when the results are needed, such as by a copy to
+ * the host. Applications that use the results of a filter directly in their
+ * own command buffers should call halide_device_sync first.
  */
 extern int halide_metal_acquire_context(void *user_context, struct halide_metal_device **device_ret,
                                         struct halide_metal_command_queue **queue_ret, bool create);
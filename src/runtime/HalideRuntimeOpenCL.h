@@ -91,6 +91,28 @@ extern uintptr_t halide_opencl_get_cl_mem(void *user_context, struct halide_buff
 /** Returns the offset associated with the OpenCL memory allocation via device_crop or device_slice. */
 extern uint64_t halide_opencl_get_crop_offset(void *user_context, halide_buffer_t *buf);
 
+/** Set the high-water mark, in bytes, for device allocations that
+ * have been freed by Halide but are kept around to be reused by
+ * later allocations of a similar size on the same context. Sizes
+ * are rounded up to one of four buckets per power of two. The
+ * default is zero, which releases device allocations immediately. If
+ * the new mark is lower than what is currently held, unused
+ * allocations on the current context are released to get under it. */
+extern int halide_opencl_set_max_cached_device_bytes(void *user_context, size_t max_bytes);
+
+/** Release all unused device allocations being held for reuse on the
+ * current context. halide_device_release also does this. */
+extern int halide_opencl_release_unused_device_allocations(void *user_context);
+
+/** Make device allocations with CL_MEM_ALLOC_HOST_PTR, so that the
+ * driver backs them with pinned host memory. Buffers allocated with
+ * halide_device_and_host_malloc while this is set use a mapping of
+ * the device allocation as their host memory, which makes copies
+ * between the host and the device free on GPUs that share memory
+ * with the host. Such buffers must be freed with
+ * halide_device_and_host_free. Returns the previous setting. */
+extern bool halide_opencl_set_alloc_host_ptr(bool use);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -20,6 +20,33 @@ extern int halide_qurt_hvx_unlock(void *user_context);
 extern void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*/);
 // @}
 
+/** Return the number of HVX contexts of the specified width (64 or
+ * 128 bytes) that can be locked at the same time. Parallel loops that
+ * use HVX are run with at most this many tasks in flight, so that
+ * their threads don't queue up on hvx_lock. */
+extern int halide_qurt_hvx_get_units(void *user_context, int size);
+
+/** Allocate and free Vector Tightly Coupled Memory (VTCM), which is
+ * available on Hexagon v65 and later. halide_vtcm_malloc returns NULL
+ * if there isn't enough VTCM left, while halide_vtcm_malloc_or_heap
+ * falls back to halide_malloc. Memory from each must be freed with the
+ * matching free function. */
+// @{
+extern void *halide_vtcm_malloc(void *user_context, int size);
+extern void halide_vtcm_free(void *user_context, void *ptr);
+extern void *halide_vtcm_malloc_or_heap(void *user_context, int size);
+extern void halide_vtcm_free_or_heap(void *user_context, void *ptr);
+// @}
+
+/** Copy a 2D region of bytes with the user DMA engine, which is
+ * available on Hexagon v66 and later, and wait for it to finish. The
+ * offsets, width, and strides are in bytes. */
+extern int halide_hexagon_user_dma_copy_2d(void *user_context,
+                                           uint8_t *dst, int dst_offset,
+                                           const uint8_t *src, int src_offset,
+                                           int width, int height,
+                                           int dst_stride, int src_stride);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -0,0 +1,103 @@
+#ifndef HALIDE_HALIDERUNTIMEVULKAN_H
+#define HALIDE_HALIDERUNTIMEVULKAN_H
+
+#include "HalideRuntime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file
+ *  Routines specific to the Halide Vulkan runtime.
+ */
+
+extern const struct halide_device_interface_t *halide_vulkan_device_interface();
+
+/** These are forward declared here to allow clients to override the
+ *  Halide Vulkan runtime. Do not call them. */
+// @{
+extern int halide_vulkan_initialize_kernels(void *user_context, void **state_ptr,
+                                            const char *src, int size);
+
+extern int halide_vulkan_run(void *user_context,
+                             void *state_ptr,
+                             const char *entry_name,
+                             int blocksX, int blocksY, int blocksZ,
+                             int threadsX, int threadsY, int threadsZ,
+                             int shared_mem_bytes,
+                             size_t arg_sizes[],
+                             void *args[],
+                             int8_t arg_is_buffer[],
+                             int num_attributes,
+                             float *vertex_buffer,
+                             int num_coords_dim0,
+                             int num_coords_dim1);
+// @}
+
+/** Set the underlying VkBuffer for a halide_buffer_t. The buffer must
+ * have been created with the storage buffer and transfer source and
+ * destination usages, must be bound to memory by the caller, and must
+ * be large enough to cover the extent of the halide_buffer_t rounded
+ * up to a multiple of four bytes. The device field of the
+ * halide_buffer_t must be NULL when this routine is called. The device
+ * and host dirty bits are left unmodified. */
+extern int halide_vulkan_wrap_buffer(void *user_context, struct halide_buffer_t *buf, uint64_t vk_buffer);
+
+/** Disconnect a halide_buffer_t from the VkBuffer it was previously
+ * wrapped around. Should only be called for a halide_buffer_t that
+ * halide_vulkan_wrap_buffer was previously called on. Frees any
+ * storage associated with the binding of the halide_buffer_t, but does
+ * not destroy the VkBuffer. The dev field of the halide_buffer_t will
+ * be NULL on return.
+ */
+extern int halide_vulkan_detach_buffer(void *user_context, struct halide_buffer_t *buf);
+
+/** Return the underlying VkBuffer for a halide_buffer_t, or 0 if there
+ * is no device memory (device field is NULL). */
+extern uint64_t halide_vulkan_get_buffer(void *user_context, struct halide_buffer_t *buf);
+
+/** Return the byte offset of a halide_buffer_t within its VkBuffer,
+ * which is non-zero for crops and slices. */
+extern uint64_t halide_vulkan_get_crop_offset(void *user_context, struct halide_buffer_t *buf);
+
+struct halide_vulkan_instance;
+struct halide_vulkan_physical_device;
+struct halide_vulkan_device;
+struct halide_vulkan_queue;
+
+/** This prototype is exported as applications will typically need to
+ * replace it to get Halide filters to execute on the same device and
+ * queue used for other purposes. The types are VkInstance,
+ * VkPhysicalDevice, VkDevice and VkQueue, and queue_family_index is
+ * the family the queue was created from, which must support compute.
+ * No reference counting is done by Halide on these objects. They must
+ * remain valid until all of the following are true:
+ * - A balancing halide_vulkan_release_context has occurred for each
+ *     halide_vulkan_acquire_context which returned the device/queue
+ * - All Halide filters using the context information have completed
+ * - All halide_buffer_t objects on the device have had
+ *     halide_device_free called or have been detached via
+ *     halide_vulkan_detach_buffer.
+ * - halide_device_release has been called on the interface returned from
+ *     halide_vulkan_device_interface(). (This releases the pipelines
+ *     and pools created for the device.)
+ */
+extern int halide_vulkan_acquire_context(void *user_context,
+                                         struct halide_vulkan_instance **instance_ret,
+                                         struct halide_vulkan_physical_device **physical_device_ret,
+                                         struct halide_vulkan_device **device_ret,
+                                         struct halide_vulkan_queue **queue_ret,
+                                         uint32_t *queue_family_index_ret,
+                                         bool create);
+
+/** This call balances each successful halide_vulkan_acquire_context call.
+ * If halide_vulkan_acquire_context is replaced, this routine must be replaced
+ * as well.
+ */
+extern int halide_vulkan_release_context(void *user_context);
+
+#ifdef __cplusplus
+} // End extern "C"
+#endif
+
+#endif // HALIDE_HALIDERUNTIMEVULKAN_H
@@ -0,0 +1,94 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Batch {
+
+struct BatchClosure {
+    const halide_filter_metadata_t *metadata;
+    int (*checked)(void **);
+    int (*unchecked)(void **);
+    void ***argvs;
+};
+
+// Whether a buffer has the same type, shape and strides as the
+// one the checked call ran on, so that the unchecked pipeline,
+// compiled without assertions, can safely run on it.
+WEAK bool same_layout(const halide_buffer_t *a, const halide_buffer_t *b) {
+    if (a == NULL || b == NULL ||
+        a->host == NULL || b->host == NULL ||
+        a->device != 0 || b->device != 0 ||
+        a->type != b->type ||
+        a->dimensions != b->dimensions) {
+        return false;
+    }
+    // Alignment is checked by the pipeline, so the host pointers
+    // must have the same alignment as well.
+    if (((uintptr_t)a->host ^ (uintptr_t)b->host) & 127) {
+        return false;
+    }
+    for (int i = 0; i < a->dimensions; i++) {
+        if (a->dim[i] != b->dim[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether argv can skip the checks that were already done for first.
+WEAK bool matches(const halide_filter_metadata_t *metadata, void **first, void **argv) {
+    for (int i = 0; i < metadata->num_arguments; i++) {
+        const halide_filter_argument_t &arg = metadata->arguments[i];
+        if (arg.kind == halide_argument_kind_input_scalar) {
+            // Handles are opaque to the pipeline, so they can differ.
+            if (arg.type.code != halide_type_handle &&
+                memcmp(first[i], argv[i], arg.type.bytes()) != 0) {
+                return false;
+            }
+        } else if (!same_layout((const halide_buffer_t *)first[i],
+                                (const halide_buffer_t *)argv[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK int batch_task(void *user_context, int idx, uint8_t *closure) {
+    const BatchClosure *c = (const BatchClosure *)closure;
+    void **argv = c->argvs[idx];
+    if (matches(c->metadata, c->argvs[0], argv)) {
+        return c->unchecked(argv);
+    } else {
+        return c->checked(argv);
+    }
+}
+
+}}}}  // namespace Halide::Runtime::Internal::Batch
+
+using namespace Halide::Runtime::Internal::Batch;
+
+extern "C" {
+
+WEAK int halide_do_batch(void *user_context,
+                         const halide_filter_metadata_t *metadata,
+                         int (*checked)(void **), int (*unchecked)(void **),
+                         int batch_size, void ***argvs) {
+    if (batch_size <= 0) {
+        return 0;
+    }
+    if (argvs == NULL) {
+        halide_error(user_context, "Batched pipeline called with a null array of arguments\n");
+        return -1;
+    }
+
+    // The first item goes through all of the usual checks. The rest
+    // can skip them when their arguments match it.
+    int result = checked(argvs[0]);
+    if (result != 0 || batch_size == 1) {
+        return result;
+    }
+
+    BatchClosure closure = {metadata, checked, unchecked, argvs};
+    return halide_do_par_for(user_context, batch_task, 1, batch_size - 1, (uint8_t *)&closure);
+}
+
+}  // extern "C"
@@ -65,6 +65,16 @@ WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t
     return true;
 }
 
+// A byte budget for the entries of one memoized Func, set with
+// Func::memoize. The Func is identified by the address of a string
+// naming it, which is never dereferenced.
+struct CacheBudget {
+    const void *id;
+    int64_t max_size;
+    // Summed over all shards, so updated atomically.
+    int64_t current_size;
+};
+
 struct CacheEntry {
     CacheEntry *next;
     CacheEntry *more_recent;
@@ -75,17 +85,28 @@ struct CacheEntry {
     uint32_t hash;
     uint32_t in_use_count; // 0 if none returned from halide_cache_lookup
     uint32_t tuple_count;
+    // How long the stored data took to compute, in nanoseconds, or
+    // zero if unknown.
+    int64_t cost;
+    // The budget the entry counts against, if any.
+    CacheBudget *budget;
+    // The bytes of the stored data that live on a device. The cache
+    // owns those device allocations along with the host ones.
+    int64_t device_size;
     // The shape of the computed data. There may be more data allocated than this.
     int32_t dimensions;
     halide_dimension_t *computed_bounds;
     // The actual stored data.
     halide_buffer_t *buf;
+    // When the entry was last stored or looked up, from use_clock.
+    uint64_t last_used;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
               uint32_t key_hash,
               const halide_buffer_t *computed_bounds_buf,
               int32_t tuples, halide_buffer_t **tuple_buffers);
     void destroy();
+    int64_t size() const;
     halide_buffer_t &buffer(int32_t i);
 
 };
@@ -93,6 +114,10 @@ struct CacheEntry {
 struct CacheBlockHeader {
     CacheEntry *entry;
     uint32_t hash;
+    // If the buffer couldn't be stored, its device allocation at the
+    // time, which halide_memoization_cache_release frees.
+    uint64_t device;
+    const halide_device_interface_t *device_interface;
 };
 
 // Each host block has extra space to store a header just before the
@@ -120,6 +145,10 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
     hash = key_hash;
     in_use_count = 0;
     tuple_count = tuples;
+    cost = 0;
+    budget = NULL;
+    last_used = 0;
+    device_size = 0;
     dimensions = computed_bounds_buf->dimensions;
 
     // Allocate all the necessary space (or die)
@@ -165,11 +194,25 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
         for (int j = 0; j < dimensions; j++) {
             buf[i].dim[j] = tuple_buffers[i]->dim[j];
         }
+        if (buf[i].device != 0) {
+            device_size += buf[i].size_in_bytes();
+        }
     }
     return true;
 }
 
+WEAK int64_t CacheEntry::size() const {
+    int64_t result = 0;
+    for (uint32_t i = 0; i < tuple_count; i++) {
+        result += buf[i].size_in_bytes();
+    }
+    return result;
+}
+
 WEAK void CacheEntry::destroy() {
+    if (budget != NULL) {
+        __sync_fetch_and_add(&budget->current_size, -size());
+    }
     for (uint32_t i = 0; i < tuple_count; i++) {
         halide_device_free(NULL, &buf[i]);
         halide_free(NULL, get_pointer_to_header(buf[i].host));
@@ -177,56 +220,187 @@ WEAK void CacheEntry::destroy() {
     halide_free(NULL, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size)  {
-    uint32_t h = 5381;
+// FNV-1a over the key, followed by the murmur3 finalizer so that the
+// low and high bits used to pick the shard and the bucket are both
+// well mixed.
+WEAK uint32_t hash_key(const uint8_t *key, size_t key_size) {
+    uint32_t h = 2166136261u;
     for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+        h = (h ^ key[i]) * 16777619u;
     }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
     return h;
 }
 
-WEAK halide_mutex memoization_lock = { { 0 } };
+// The cache is split into independent shards, each with its own lock,
+// hash table, and LRU chain. The low bits of the key hash select the
+// shard, and the remaining bits select the bucket within it. The size
+// limits apply to the cache as a whole, not to each shard, and
+// entries are evicted from whichever shard has the oldest ones.
+struct CacheShard {
+    halide_mutex lock;
+    CacheEntry **buckets;
+    uint32_t bucket_count;
+    uint32_t entry_count;
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+    int64_t current_size;
+    int64_t current_device_size;
+};
 
-const size_t kHashTableSize = 256;
+const uint32_t kDefaultShardBits = 4;
+const uint32_t kDefaultBucketsPerShard = 16;
+const uint32_t kMaxShardBits = 16;
+// Grow a shard's table when it has this many entries per bucket.
+const uint32_t kMaxLoadFactor = 2;
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+WEAK CacheShard default_shards[1 << kDefaultShardBits];
 
-WEAK CacheEntry *most_recently_used = NULL;
-WEAK CacheEntry *least_recently_used = NULL;
+WEAK CacheShard *shards = default_shards;
+WEAK uint32_t shard_bits = kDefaultShardBits;
+WEAK uint32_t initial_bucket_count = kDefaultBucketsPerShard;
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
-WEAK int64_t current_cache_size = 0;
+// Device memory held by the cache has its own limit.
+WEAK int64_t max_device_cache_size = kDefaultCacheSize;
+
+// Of the least recently used entries that aren't in use, this many
+// are considered for eviction at a time.
+const int kEvictionCandidates = 4;
+
+const int kMaxBudgets = 64;
+WEAK CacheBudget budgets[kMaxBudgets];
+WEAK halide_mutex budgets_lock;
+
+// The sizes summed over all shards, updated atomically. These are
+// what the size limits are checked against.
+WEAK int64_t total_size = 0;
+WEAK int64_t total_device_size = 0;
+
+// Advanced atomically each time an entry is used, to order entries in
+// different shards.
+WEAK uint64_t use_clock = 0;
+
+// Counted across all shards.
+WEAK uint64_t cache_hits = 0;
+WEAK uint64_t cache_misses = 0;
+WEAK uint64_t cache_evictions = 0;
+
+WEAK __attribute((always_inline)) uint32_t shard_count() {
+    return (uint32_t)1 << shard_bits;
+}
+
+WEAK __attribute((always_inline)) CacheShard &shard_for_hash(uint32_t h) {
+    return shards[h & (shard_count() - 1)];
+}
+
+WEAK __attribute((always_inline)) uint32_t bucket_for_hash(const CacheShard &shard, uint32_t h) {
+    return (h >> shard_bits) & (shard.bucket_count - 1);
+}
+
+// Change the size of a shard, and the total across all shards. Must
+// be called with the shard lock held.
+WEAK void adjust_shard_size(CacheShard &shard, int64_t size, int64_t device_size) {
+    shard.current_size += size;
+    shard.current_device_size += device_size;
+    __sync_fetch_and_add(&total_size, size);
+    __sync_fetch_and_add(&total_device_size, device_size);
+}
+
+// Find the budget for the Func identified by id, creating it if
+// needed, and update its size. Returns NULL if max_size is not
+// positive, or if there are already too many budgets.
+WEAK CacheBudget *find_budget(const void *id, int64_t max_size) {
+    if (id == NULL || max_size <= 0) {
+        return NULL;
+    }
+    ScopedMutexLock lock(&budgets_lock);
+    for (int i = 0; i < kMaxBudgets; i++) {
+        if (budgets[i].id == id || budgets[i].id == NULL) {
+            budgets[i].id = id;
+            budgets[i].max_size = max_size;
+            return &budgets[i];
+        }
+    }
+    return NULL;
+}
+
+// Make sure the shard has a table big enough for one more entry. Must
+// be called with the shard lock held. Returns false if there is no
+// table and one couldn't be allocated. Failing to grow an existing
+// table just leaves the chains longer.
+WEAK bool reserve_entry(CacheShard &shard) {
+    if (shard.buckets != NULL &&
+        shard.entry_count < shard.bucket_count * kMaxLoadFactor) {
+        return true;
+    }
+    uint32_t new_count = shard.buckets ? shard.bucket_count * 2 : initial_bucket_count;
+    CacheEntry **new_buckets = (CacheEntry **)halide_malloc(NULL, new_count * sizeof(CacheEntry *));
+    if (new_buckets == NULL) {
+        return shard.buckets != NULL;
+    }
+    memset(new_buckets, 0, new_count * sizeof(CacheEntry *));
+
+    CacheEntry **old_buckets = shard.buckets;
+    uint32_t old_count = shard.bucket_count;
+    shard.buckets = new_buckets;
+    shard.bucket_count = new_count;
+    for (uint32_t i = 0; i < old_count; i++) {
+        CacheEntry *entry = old_buckets[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            uint32_t index = bucket_for_hash(shard, entry->hash);
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    if (old_buckets != NULL) {
+        halide_free(NULL, old_buckets);
+    }
+    return true;
+}
 
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(NULL) << "validating cache, "
-                << "current size " << current_cache_size
+WEAK void validate_cache(CacheShard &shard) {
+    print(NULL) << "validating cache shard " << (int)(&shard - shards) << ", "
+                << "current size " << shard.current_size
+                << ", total size " << __sync_fetch_and_add(&total_size, 0)
                 << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+    uint32_t entries_in_hash_table = 0;
+    for (size_t i = 0; shard.buckets && i < shard.bucket_count; i++) {
+        CacheEntry *entry = shard.buckets[i];
         while (entry != NULL) {
             entries_in_hash_table++;
-            if (entry->more_recent == NULL && entry != most_recently_used) {
+            if (entry->more_recent == NULL && entry != shard.most_recently_used) {
                 halide_print(NULL, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == NULL && entry != least_recently_used) {
+            if (entry->less_recent == NULL && entry != shard.least_recently_used) {
                 halide_print(NULL, "cache invalid case 2\n");
                 __builtin_trap();
             }
+            if (&shard_for_hash(entry->hash) != &shard ||
+                bucket_for_hash(shard, entry->hash) != i) {
+                halide_print(NULL, "cache entry in wrong bucket\n");
+                __builtin_trap();
+            }
             entry = entry->next;
         }
     }
-    int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    uint32_t entries_from_mru = 0;
+    CacheEntry *mru_chain = shard.most_recently_used;
     while (mru_chain != NULL) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
-    int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    uint32_t entries_from_lru = 0;
+    CacheEntry *lru_chain = shard.least_recently_used;
     while (lru_chain != NULL) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
@@ -242,69 +416,180 @@ WEAK void validate_cache() {
         halide_print(NULL, "cache invalid case 4\n");
         __builtin_trap();
     }
-    if (current_cache_size < 0) {
+    if (entries_in_hash_table != shard.entry_count) {
+        halide_print(NULL, "cache entry count is wrong\n");
+        __builtin_trap();
+    }
+    if (shard.current_size < 0 || shard.current_device_size < 0) {
         halide_print(NULL, "cache size is negative\n");
         __builtin_trap();
     }
 }
 #endif
 
-WEAK void prune_cache() {
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != NULL) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != NULL && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_assert(NULL, prev_hash_entry != NULL);
-                prev_hash_entry->next = prune_candidate->next;
-            }
+// Remove an entry that isn't in use from the shard and free
+// it. Must be called with the shard lock held.
+WEAK void evict_entry(CacheShard &shard, CacheEntry *entry) {
+    halide_assert(NULL, entry->in_use_count == 0);
+    uint32_t index = bucket_for_hash(shard, entry->hash);
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != NULL) {
-                more_recent->less_recent = prune_candidate->less_recent;
-            }
+    // Remove from hash table
+    CacheEntry *prev_hash_entry = shard.buckets[index];
+    if (prev_hash_entry == entry) {
+        shard.buckets[index] = entry->next;
+    } else {
+        while (prev_hash_entry != NULL && prev_hash_entry->next != entry) {
+            prev_hash_entry = prev_hash_entry->next;
+        }
+        halide_assert(NULL, prev_hash_entry != NULL);
+        prev_hash_entry->next = entry->next;
+    }
+    shard.entry_count--;
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
-            }
-            if (prune_candidate->less_recent != NULL) {
-                prune_candidate->less_recent = more_recent;
-            }
+    // Remove from less recent chain.
+    if (shard.least_recently_used == entry) {
+        shard.least_recently_used = entry->more_recent;
+    }
+    if (entry->more_recent != NULL) {
+        entry->more_recent->less_recent = entry->less_recent;
+    }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
-            }
+    // Remove from more recent chain.
+    if (shard.most_recently_used == entry) {
+        shard.most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != NULL) {
+        entry->less_recent->more_recent = entry->more_recent;
+    }
+
+    // Decrease cache used amount.
+    adjust_shard_size(shard, -entry->size(), -entry->device_size);
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(NULL, prune_candidate);
+    // Deallocate the entry.
+    entry->destroy();
+    halide_free(NULL, entry);
+    __sync_fetch_and_add(&cache_evictions, 1);
+}
+
+// Pick the next entry to evict, or return NULL if there is none. Of
+// the few least recently used entries that aren't in use, the one
+// that took the least time to compute per byte goes first, so that
+// large results that are quick to recompute don't push out small,
+// expensive ones. With no costs known this is plain LRU. If budget
+// is not NULL, only entries counting against it are considered. If
+// device_only is true, only entries holding device memory are. Must
+// be called with the shard lock held.
+WEAK CacheEntry *choose_victim(CacheShard &shard, const CacheBudget *budget, bool device_only) {
+    CacheEntry *victim = NULL;
+    double victim_cost = 0;
+    int candidates = 0;
+    for (CacheEntry *entry = shard.least_recently_used;
+         entry != NULL && candidates < kEvictionCandidates;
+         entry = entry->more_recent) {
+        if (entry->in_use_count != 0 ||
+            (budget != NULL && entry->budget != budget) ||
+            (device_only && entry->device_size == 0)) {
+            continue;
+        }
+        double cost = (double)entry->cost / (double)max(entry->size(), (int64_t)1);
+        if (victim == NULL || cost < victim_cost) {
+            victim = entry;
+            victim_cost = cost;
         }
+        candidates++;
+    }
+    return victim;
+}
 
-        prune_candidate = more_recent;
+// Evict one entry chosen by choose_victim from the shard whose
+// victim was least recently used. Returns false if no shard has
+// one. Only one shard lock is held at a time, so this must be called
+// with none held.
+WEAK bool evict_oldest(const CacheBudget *budget, bool device_only) {
+    uint32_t oldest_shard = 0;
+    uint64_t oldest_use = 0;
+    bool found = false;
+    for (uint32_t i = 0; i < shard_count(); i++) {
+        ScopedMutexLock lock(&shards[i].lock);
+        CacheEntry *victim = choose_victim(shards[i], budget, device_only);
+        if (victim != NULL && (!found || victim->last_used < oldest_use)) {
+            oldest_shard = i;
+            oldest_use = victim->last_used;
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    CacheShard &shard = shards[oldest_shard];
+    ScopedMutexLock lock(&shard.lock);
+#if CACHE_DEBUGGING
+    validate_cache(shard);
+#endif
+    // Another thread may have used or evicted the victim since the
+    // lock was dropped; then this evicts the shard's next choice,
+    // or nothing.
+    CacheEntry *victim = choose_victim(shard, budget, device_only);
+    if (victim != NULL) {
+        evict_entry(shard, victim);
     }
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_cache(shard);
 #endif
+    return true;
+}
+
+// Evict entries, oldest first across all shards, until the whole
+// cache and the budget (if not NULL) are within their limits, or
+// there are none left to evict. Must be called with no shard lock
+// held.
+WEAK void prune_cache(CacheBudget *budget) {
+    while (__sync_fetch_and_add(&total_size, 0) > max_cache_size &&
+           evict_oldest(NULL, false)) {
+    }
+    while (__sync_fetch_and_add(&total_device_size, 0) > max_device_cache_size &&
+           evict_oldest(NULL, true)) {
+    }
+    while (budget != NULL &&
+           __sync_fetch_and_add(&budget->current_size, 0) > budget->max_size &&
+           evict_oldest(budget, false)) {
+    }
+}
+
+// Free every entry and table in the shard and reset it to
+// empty. Must be called with the shard lock held (or when no other
+// threads are accessing the cache).
+WEAK void clear_shard(CacheShard &shard) {
+    for (uint32_t i = 0; shard.buckets && i < shard.bucket_count; i++) {
+        CacheEntry *entry = shard.buckets[i];
+        while (entry != NULL) {
+            CacheEntry *next = entry->next;
+            entry->destroy();
+            halide_free(NULL, entry);
+            entry = next;
+        }
+    }
+    if (shard.buckets != NULL) {
+        halide_free(NULL, shard.buckets);
+    }
+    shard.buckets = NULL;
+    shard.bucket_count = 0;
+    shard.entry_count = 0;
+    adjust_shard_size(shard, -shard.current_size, -shard.current_device_size);
+    shard.most_recently_used = NULL;
+    shard.least_recently_used = NULL;
+}
+
+// Mark buffers that are still in use by the caller as having no
+// cache entry, so halide_memoization_cache_release frees them,
+// including any device allocation they have.
+WEAK void disown_buffers(int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    for (int32_t i = 0; i < tuple_count; i++) {
+        CacheBlockHeader *header = get_pointer_to_header(tuple_buffers[i]->host);
+        header->entry = NULL;
+        header->device = tuple_buffers[i]->device;
+        header->device_interface = tuple_buffers[i]->device_interface;
+    }
 }
 
 }}} // namespace Halide::Runtime::Internal
@@ -316,18 +601,77 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
-
     max_cache_size = size;
-    prune_cache();
+    prune_cache(NULL);
+}
+
+WEAK void halide_memoization_cache_set_device_size(int64_t size) {
+    if (size == 0) {
+        size = kDefaultCacheSize;
+    }
+
+    max_device_cache_size = size;
+    prune_cache(NULL);
+}
+
+WEAK int halide_memoization_cache_set_shards(int32_t num_shards, int32_t buckets_per_shard) {
+    uint32_t new_shard_bits = kDefaultShardBits;
+    if (num_shards > 0) {
+        new_shard_bits = 0;
+        while (((uint32_t)1 << new_shard_bits) < (uint32_t)num_shards &&
+               new_shard_bits < kMaxShardBits) {
+            new_shard_bits++;
+        }
+    }
+    uint32_t new_bucket_count = kDefaultBucketsPerShard;
+    if (buckets_per_shard > 0) {
+        new_bucket_count = 1;
+        while (new_bucket_count < (uint32_t)buckets_per_shard &&
+               new_bucket_count < ((uint32_t)1 << 24)) {
+            new_bucket_count *= 2;
+        }
+    }
+
+    // Entries handed out by lookup refer back to their shard when
+    // released, so we can't move them.
+    for (uint32_t i = 0; i < shard_count(); i++) {
+        ScopedMutexLock lock(&shards[i].lock);
+        for (uint32_t j = 0; shards[i].buckets && j < shards[i].bucket_count; j++) {
+            for (CacheEntry *entry = shards[i].buckets[j]; entry != NULL; entry = entry->next) {
+                if (entry->in_use_count != 0) {
+                    error(NULL) << "halide_memoization_cache_set_shards called while the cache is in use\n";
+                    return halide_error_code_generic_error;
+                }
+            }
+        }
+    }
+
+    CacheShard *new_shards = default_shards;
+    if (new_shard_bits != kDefaultShardBits) {
+        size_t bytes = sizeof(CacheShard) << new_shard_bits;
+        new_shards = (CacheShard *)halide_malloc(NULL, bytes);
+        if (new_shards == NULL) {
+            return halide_error_code_out_of_memory;
+        }
+        memset(new_shards, 0, bytes);
+    }
+
+    halide_memoization_cache_cleanup();
+    if (shards != default_shards) {
+        halide_free(NULL, shards);
+    }
+    shards = new_shards;
+    shard_bits = new_shard_bits;
+    initial_bucket_count = new_bucket_count;
+    return 0;
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = hash_key(cache_key, size);
+    CacheShard &shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    ScopedMutexLock lock(&shard.lock);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -342,7 +686,7 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
+    CacheEntry *entry = shard.buckets ? shard.buckets[bucket_for_hash(shard, h)] : NULL;
     while (entry != NULL) {
         if (entry->hash == h && entry->key_size == (size_t)size &&
             keys_equal(entry->key, cache_key, size) &&
@@ -356,24 +700,25 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
             }
 
             if (all_bounds_equal) {
-                if (entry != most_recently_used) {
+                if (entry != shard.most_recently_used) {
                     halide_assert(user_context, entry->more_recent != NULL);
                     if (entry->less_recent != NULL) {
                         entry->less_recent->more_recent = entry->more_recent;
                     } else {
-                        halide_assert(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
+                        halide_assert(user_context, shard.least_recently_used == entry);
+                        shard.least_recently_used = entry->more_recent;
                     }
                     halide_assert(user_context, entry->more_recent != NULL);
                     entry->more_recent->less_recent = entry->less_recent;
 
                     entry->more_recent = NULL;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != NULL) {
-                        most_recently_used->more_recent = entry;
+                    entry->less_recent = shard.most_recently_used;
+                    if (shard.most_recently_used != NULL) {
+                        shard.most_recently_used->more_recent = entry;
                     }
-                    most_recently_used = entry;
+                    shard.most_recently_used = entry;
                 }
+                entry->last_used = __sync_add_and_fetch(&use_clock, 1);
 
                 for (int32_t i = 0; i < tuple_count; i++) {
                     halide_buffer_t *buf = tuple_buffers[i];
@@ -381,6 +726,7 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
                 }
 
                 entry->in_use_count += tuple_count;
+                __sync_fetch_and_add(&cache_hits, 1);
 
                 return 0;
             }
@@ -388,6 +734,8 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         entry = entry->next;
     }
 
+    __sync_fetch_and_add(&cache_misses, 1);
+
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -403,10 +751,12 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         CacheBlockHeader *header = get_pointer_to_header(buf->host);
         header->hash = h;
         header->entry = NULL;
+        header->device = 0;
+        header->device_interface = NULL;
     }
 
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_cache(shard);
 #endif
 
     return 1;
@@ -415,13 +765,25 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
 WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache_key, int32_t size,
                                         halide_buffer_t *computed_bounds,
                                         int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    return halide_memoization_cache_store_with_budget(user_context, cache_key, size, computed_bounds,
+                                                      tuple_count, tuple_buffers, NULL, 0, 0);
+}
+
+WEAK int halide_memoization_cache_store_with_budget(void *user_context, const uint8_t *cache_key, int32_t size,
+                                                    halide_buffer_t *computed_bounds,
+                                                    int32_t tuple_count, halide_buffer_t **tuple_buffers,
+                                                    const void *budget_id, int64_t budget_size,
+                                                    int64_t compute_time_ns) {
     debug(user_context) << "halide_memoization_cache_store\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheBudget *budget = find_budget(budget_id, budget_size);
 
-    uint32_t index = h % kHashTableSize;
+    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheShard &shard = shard_for_hash(h);
 
-    ScopedMutexLock lock(&memoization_lock);
+    // Not a ScopedMutexLock, because pruning the cache below locks
+    // other shards, and must be done once this one is unlocked.
+    halide_mutex_lock(&shard.lock);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
@@ -436,7 +798,7 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
+    CacheEntry *entry = shard.buckets ? shard.buckets[bucket_for_hash(shard, h)] : NULL;
     while (entry != NULL) {
         if (entry->hash == h && entry->key_size == (size_t)size &&
             keys_equal(entry->key, cache_key, size) &&
@@ -456,12 +818,8 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
             }
             if (all_bounds_equal) {
                 halide_assert(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-
-                }
+                disown_buffers(tuple_count, tuple_buffers);
+                halide_mutex_unlock(&shard.lock);
                 return 0;
             }
         }
@@ -469,55 +827,73 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
     }
 
     uint64_t added_size = 0;
+    uint64_t added_device_size = 0;
     {
         for (int32_t i = 0; i < tuple_count; i++) {
             halide_buffer_t *buf = tuple_buffers[i];
             added_size += buf->size_in_bytes();
+            if (buf->device != 0) {
+                added_device_size += buf->size_in_bytes();
+            }
         }
     }
-    current_cache_size += added_size;
-    prune_cache();
+    adjust_shard_size(shard, (int64_t)added_size, (int64_t)added_device_size);
 
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+    CacheEntry *new_entry = NULL;
     bool inited = false;
+    if (reserve_entry(shard)) {
+        new_entry = (CacheEntry *)halide_malloc(NULL, sizeof(CacheEntry));
+    }
     if (new_entry) {
         inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers);
     }
     if (!inited) {
-        current_cache_size -= added_size;
+        adjust_shard_size(shard, -(int64_t)added_size, -(int64_t)added_device_size);
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = NULL;
-        }
+        disown_buffers(tuple_count, tuple_buffers);
 
         if (new_entry) {
             halide_free(user_context, new_entry);
         }
+        halide_mutex_unlock(&shard.lock);
         return 0;
     }
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != NULL) {
-        most_recently_used->more_recent = new_entry;
+    uint32_t index = bucket_for_hash(shard, h);
+    new_entry->next = shard.buckets[index];
+    new_entry->less_recent = shard.most_recently_used;
+    if (shard.most_recently_used != NULL) {
+        shard.most_recently_used->more_recent = new_entry;
     }
-    most_recently_used = new_entry;
-    if (least_recently_used == NULL) {
-        least_recently_used = new_entry;
+    shard.most_recently_used = new_entry;
+    if (shard.least_recently_used == NULL) {
+        shard.least_recently_used = new_entry;
     }
-    cache_entries[index] = new_entry;
+    shard.buckets[index] = new_entry;
+    shard.entry_count++;
 
     new_entry->in_use_count = tuple_count;
+    new_entry->cost = compute_time_ns;
+    new_entry->last_used = __sync_add_and_fetch(&use_clock, 1);
 
     for (int32_t i = 0; i < tuple_count; i++) {
         get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
     }
 
+    if (budget != NULL) {
+        new_entry->budget = budget;
+        __sync_fetch_and_add(&budget->current_size, (int64_t)added_size);
+    }
+
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_cache(shard);
 #endif
+    halide_mutex_unlock(&shard.lock);
+
+    // The new entry is in use, so this makes room for it by evicting
+    // others.
+    prune_cache(budget);
+
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
     return 0;
@@ -529,35 +905,70 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     CacheEntry *entry = header->entry;
 
     if (entry == NULL) {
+        if (header->device != 0) {
+            halide_buffer_t device_buf = {0};
+            device_buf.device = header->device;
+            device_buf.device_interface = header->device_interface;
+            halide_device_free(user_context, &device_buf);
+        }
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard &shard = shard_for_hash(entry->hash);
+        ScopedMutexLock lock(&shard.lock);
 
         halide_assert(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_cache(shard);
 #endif
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
 }
 
+WEAK int halide_memoization_cache_release_device(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+
+    // If the device allocation belongs to a cache entry, or to the
+    // header of a buffer that couldn't be stored, it is freed with
+    // that. Otherwise it was made after the buffer was stored, so
+    // free it here.
+    CacheBlockHeader *header = get_pointer_to_header(buf->host);
+    bool owned_by_cache = header->device == buf->device;
+    CacheEntry *entry = header->entry;
+    for (uint32_t i = 0; entry != NULL && !owned_by_cache && i < entry->tuple_count; i++) {
+        owned_by_cache = entry->buf[i].device == buf->device;
+    }
+    if (!owned_by_cache) {
+        return halide_device_free(user_context, buf);
+    }
+    buf->device = 0;
+    buf->device_interface = NULL;
+    return 0;
+}
+
+WEAK void halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    stats->hits = __sync_fetch_and_add(&cache_hits, 0);
+    stats->misses = __sync_fetch_and_add(&cache_misses, 0);
+    stats->evictions = __sync_fetch_and_add(&cache_evictions, 0);
+    stats->entries = 0;
+    stats->current_size = 0;
+    stats->current_device_size = 0;
+    for (uint32_t i = 0; i < shard_count(); i++) {
+        ScopedMutexLock lock(&shards[i].lock);
+        stats->entries += shards[i].entry_count;
+        stats->current_size += shards[i].current_size;
+        stats->current_device_size += shards[i].current_device_size;
+    }
+}
+
 WEAK void halide_memoization_cache_cleanup() {
     debug(NULL) << "halide_memoization_cache_cleanup\n";
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
-        cache_entries[i] = NULL;
-        while (entry != NULL) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(NULL, entry);
-            entry = next;
-        }
+    for (uint32_t i = 0; i < shard_count(); i++) {
+        clear_shard(shards[i]);
     }
-    current_cache_size = 0;
-    most_recently_used = NULL;
-    least_recently_used = NULL;
 }
 
 namespace {
@@ -1,6 +1,7 @@
 #include "HalideRuntimeCuda.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "gpu_kernel_cache.h"
 #include "printer.h"
 #include "mini_cuda.h"
 #include "scoped_spin_lock.h"
@@ -73,13 +74,25 @@ WEAK void load_libcuda(void *user_context) {
 extern WEAK halide_device_interface_t cuda_device_interface;
 
 WEAK const char *get_error_name(CUresult error);
-WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx);
+WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx, int device);
+
+// Whether the default halide_cuda_get_stream returns the per-thread
+// default stream instead of the legacy default stream.
+WEAK bool use_per_thread_stream = false;
 
 // A cuda context defined in this module with weak linkage
 CUcontext WEAK context = 0;
 // This spinlock protexts the above context variable.
 volatile int WEAK context_lock = 0;
 
+// The contexts created so far for each device, including the one
+// above. Iterations of loops distributed across several GPUs use the
+// context for the device set for their thread. Protected by
+// context_lock.
+#define MAX_CUDA_DEVICES 16
+WEAK CUcontext device_contexts[MAX_CUDA_DEVICES];
+WEAK bool using_multiple_devices = false;
+
 }}}} // namespace Halide::Runtime::Internal::Cuda
 
 using namespace Halide::Runtime::Internal;
@@ -104,6 +117,25 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
     // If the context has not been initialized, initialize it now.
     halide_assert(user_context, &context != NULL);
 
+    int device = halide_get_thread_gpu_device(user_context);
+    if (device >= 0) {
+        if (device >= MAX_CUDA_DEVICES) {
+            error(user_context) << "CUDA: Cannot use device " << device
+                                << ", at most " << MAX_CUDA_DEVICES << " are supported\n";
+            return CUDA_ERROR_INVALID_DEVICE;
+        }
+        CUcontext local_val = device_contexts[device];
+        if (local_val == NULL && create) {
+            ScopedSpinLock spinlock(&context_lock);
+            CUresult error = create_cuda_context(user_context, &local_val, device);
+            if (error != CUDA_SUCCESS) {
+                return error;
+            }
+        }
+        *ctx = local_val;
+        return 0;
+    }
+
     // Note that this null-check of the context is *not* locked with
     // respect to device_release, so we may get a non-null context
     // that's in the process of being destroyed. Things will go badly
@@ -120,7 +152,8 @@ WEAK int halide_cuda_acquire_context(void *user_context, CUcontext *ctx, bool cr
             ScopedSpinLock spinlock(&context_lock);
             local_val = context;
             if (local_val == NULL) {
-                CUresult error = create_cuda_context(user_context, &local_val);
+                CUresult error = create_cuda_context(user_context, &local_val,
+                                                     halide_get_gpu_device(user_context));
                 if (error != CUDA_SUCCESS) {
                     return error;
                 }
@@ -148,14 +181,35 @@ WEAK int halide_cuda_release_context(void *user_context) {
 // for the context (NULL stream). The context is passed in for convenience, but
 // any sort of scoping must be handled by that of the
 // halide_cuda_acquire_context/halide_cuda_release_context pair, not this call.
+//
+// Kernel launches and device-to-device copies are issued
+// asynchronously on this stream. Copies between the host and the
+// device go on a separate copy stream per context, ordered against
+// the kernels with events that track which buffers each kernel used
+// and wrote, so a copy back to the host only waits for the kernels
+// producing the data it reads, and host stages run with Func::async
+// can keep uploading while earlier kernels run.
+// halide_cuda_device_sync waits for this stream and the copy stream,
+// so pipelines using different streams can overlap copies and kernels
+// with each other. Copies from the host
+// are asynchronous with respect to the host when the host memory is
+// pinned (e.g. allocated by halide_cuda_device_and_host_malloc), so
+// the host side of such a buffer must not be modified until the
+// stream has been synchronized.
 WEAK int halide_cuda_get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
     // There are two default streams we could use. stream 0 is fully
     // synchronous. stream 2 gives a separate non-blocking stream per
     // thread.
-    *stream = 0;
+    *stream = Halide::Runtime::Internal::Cuda::use_per_thread_stream ? CU_STREAM_PER_THREAD : 0;
     return 0;
 }
 
+WEAK bool halide_cuda_set_use_per_thread_stream(bool use) {
+    bool old = Halide::Runtime::Internal::Cuda::use_per_thread_stream;
+    Halide::Runtime::Internal::Cuda::use_per_thread_stream = use;
+    return old;
+}
+
 } // extern "C"
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Cuda {
@@ -224,6 +278,10 @@ struct module_state {
 struct registered_filters {
     module_state *modules;
     registered_filters *next;
+    // Kept so that the module can be loaded on the other contexts
+    // used by loops distributed across several GPUs.
+    const char *ptx_src;
+    int ptx_size;
 };
 WEAK registered_filters *filters_list = NULL;
 // This spinlock protects the above filters_list.
@@ -240,7 +298,10 @@ WEAK module_state *find_module_for_context(const registered_filters *filters, CU
     return NULL;
 }
 
-WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
+// Returns the context for the given device, or the best device if it
+// is -1, creating it if necessary. Must be called with context_lock
+// held.
+WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx, int device) {
     // Initialize CUDA
     if (!cuInit) {
         load_libcuda(user_context);
@@ -271,7 +332,6 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
         return CUDA_ERROR_NO_DEVICE;
     }
 
-    int device = halide_get_gpu_device(user_context);
     if (device == -1 && deviceCount == 1) {
         device = 0;
     } else if (device == -1) {
@@ -307,6 +367,11 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
 
     debug(user_context) <<  "    Got device " << dev << "\n";
 
+    if (device < MAX_CUDA_DEVICES && device_contexts[device] != NULL) {
+        *ctx = device_contexts[device];
+        return CUDA_SUCCESS;
+    }
+
     // Dump device attributes
     #ifdef DEBUG_RUNTIME
     {
@@ -409,6 +474,29 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
       return err;
     }
 
+    if (device < MAX_CUDA_DEVICES) {
+        // Work distributed across devices may read buffers that were
+        // allocated on another one, so let the contexts access each
+        // other's memory where the hardware supports it.
+        for (int i = 0; i < MAX_CUDA_DEVICES && cuCtxEnablePeerAccess; i++) {
+            CUcontext other = device_contexts[i];
+            if (other == NULL) {
+                continue;
+            }
+            using_multiple_devices = true;
+            if (cuCtxPushCurrent(*ctx) == CUDA_SUCCESS) {
+                err = cuCtxEnablePeerAccess(other, 0);
+                debug(user_context) << "    cuCtxEnablePeerAccess " << other << ": " << get_error_name(err) << "\n";
+                cuCtxPopCurrent(&dummy);
+            }
+            if (cuCtxPushCurrent(other) == CUDA_SUCCESS) {
+                err = cuCtxEnablePeerAccess(*ctx, 0);
+                cuCtxPopCurrent(&dummy);
+            }
+        }
+        device_contexts[device] = *ctx;
+    }
+
     return CUDA_SUCCESS;
 }
 
@@ -446,6 +534,689 @@ WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size
 #endif
 }
 
+// Device allocations freed by Halide can be kept around and reused by
+// later allocations of the same size on the same context, instead of
+// paying for a synchronizing cuMemFree and cuMemAlloc every time. Sizes
+// are rounded up to one of four buckets per power of two so that
+// similar sizes share allocations. max_cached_device_bytes is the
+// high-water mark for the total size of the unused allocations kept;
+// it is zero (no caching) by default.
+struct cached_allocation {
+    CUcontext context;
+    CUdeviceptr ptr;
+    size_t size;
+    cached_allocation *next;
+};
+
+WEAK cached_allocation *unused_allocations = NULL;
+WEAK size_t cached_device_bytes = 0;
+WEAK size_t max_cached_device_bytes = 0;
+// This spinlock protects the above unused allocation list and sizes.
+volatile int WEAK unused_allocations_lock = 0;
+
+WEAK size_t quantize_allocation_size(size_t size) {
+    if (size <= 256) {
+        return 256;
+    }
+    int log2 = 63 - __builtin_clzll((uint64_t)(size - 1));
+    size_t step = ((size_t)1 << log2) >> 2;
+    return (size + step - 1) & ~(step - 1);
+}
+
+// Take an unused allocation of exactly the given (quantized) size on
+// the given context out of the cache. Returns 0 if there is none.
+WEAK CUdeviceptr take_unused_allocation(CUcontext ctx, size_t size) {
+    cached_allocation *found = NULL;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        cached_allocation **prev_ptr = &unused_allocations;
+        for (cached_allocation *a = unused_allocations; a != NULL; a = a->next) {
+            if (a->context == ctx && a->size == size) {
+                *prev_ptr = a->next;
+                cached_device_bytes -= a->size;
+                found = a;
+                break;
+            }
+            prev_ptr = &a->next;
+        }
+    }
+    if (found == NULL) {
+        return 0;
+    }
+    CUdeviceptr p = found->ptr;
+    free(found);
+    return p;
+}
+
+// Put an allocation in the cache if there is room for it under the
+// high-water mark. Returns false if the caller should free it instead.
+WEAK bool cache_unused_allocation(CUcontext ctx, CUdeviceptr ptr, size_t size) {
+    cached_allocation *a = NULL;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        if (cached_device_bytes + size > max_cached_device_bytes) {
+            return false;
+        }
+        cached_device_bytes += size;
+    }
+    a = (cached_allocation *)malloc(sizeof(cached_allocation));
+    if (a == NULL) {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        cached_device_bytes -= size;
+        return false;
+    }
+    a->context = ctx;
+    a->ptr = ptr;
+    a->size = size;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        a->next = unused_allocations;
+        unused_allocations = a;
+    }
+    return true;
+}
+
+// Free unused allocations on the given context until the cache is no
+// larger than target_bytes. The context must be current.
+WEAK int release_unused_allocations(void *user_context, CUcontext ctx, size_t target_bytes) {
+    int result = CUDA_SUCCESS;
+    while (true) {
+        cached_allocation *victim = NULL;
+        {
+            ScopedSpinLock spinlock(&unused_allocations_lock);
+            if (cached_device_bytes <= target_bytes) {
+                break;
+            }
+            cached_allocation **prev_ptr = &unused_allocations;
+            for (cached_allocation *a = unused_allocations; a != NULL; a = a->next) {
+                if (a->context == ctx) {
+                    *prev_ptr = a->next;
+                    cached_device_bytes -= a->size;
+                    victim = a;
+                    break;
+                }
+                prev_ptr = &a->next;
+            }
+        }
+        if (victim == NULL) {
+            // Whatever is left is on other contexts.
+            break;
+        }
+        debug(user_context) <<  "    cuMemFree " << (void *)(victim->ptr) << "\n";
+        CUresult err = cuMemFree(victim->ptr);
+        if (err != CUDA_SUCCESS) {
+            result = err;
+        }
+        free(victim);
+    }
+    return result;
+}
+
+// While a graph is being captured, the kernel launches and copies of
+// pipelines on its context are recorded into a stream in capture mode
+// instead of being run. Device allocations freed during the capture
+// are kept alive for as long as the graph is, since replaying it uses
+// them again.
+struct graph_state {
+    CUcontext context;
+    CUstream stream;
+    CUgraph graph;
+    CUgraphExec exec;
+    cached_allocation *retained;
+};
+
+WEAK graph_state *capturing_graph = NULL;
+// This spinlock protects capturing_graph.
+volatile int WEAK capturing_graph_lock = 0;
+
+// The stream that a capture on the given context is recording into,
+// or NULL if there is none.
+WEAK CUstream capture_stream(CUcontext ctx) {
+    ScopedSpinLock spinlock(&capturing_graph_lock);
+    if (capturing_graph != NULL && capturing_graph->context == ctx) {
+        return capturing_graph->stream;
+    }
+    return NULL;
+}
+
+// Hand an allocation being freed over to the graph being captured on
+// the given context. Returns false if there is no such capture.
+WEAK bool retain_for_graph(CUcontext ctx, CUdeviceptr ptr, size_t size) {
+    cached_allocation *a = (cached_allocation *)malloc(sizeof(cached_allocation));
+    ScopedSpinLock spinlock(&capturing_graph_lock);
+    if (capturing_graph == NULL || capturing_graph->context != ctx) {
+        free(a);
+        return false;
+    }
+    // If we can't keep track of it, leaking it is better than letting
+    // the graph write to memory that has been reused.
+    if (a != NULL) {
+        a->context = ctx;
+        a->ptr = ptr;
+        a->size = size;
+        a->next = capturing_graph->retained;
+        capturing_graph->retained = a;
+    }
+    return true;
+}
+
+// Free a graph and the allocations it kept. The context must be current.
+WEAK void destroy_graph(void *user_context, graph_state *g) {
+    if (g->exec) {
+        cuGraphExecDestroy(g->exec);
+    }
+    if (g->graph) {
+        cuGraphDestroy(g->graph);
+    }
+    while (g->retained) {
+        cached_allocation *a = g->retained;
+        g->retained = a->next;
+        if (!cache_unused_allocation(a->context, a->ptr, a->size)) {
+            debug(user_context) <<  "    cuMemFree " << (void *)(a->ptr) << "\n";
+            cuMemFree(a->ptr);
+        }
+        free(a);
+    }
+    free(g);
+}
+
+// The stream to run work on: the capturing stream while a graph is
+// being captured, and halide_cuda_get_stream's otherwise.
+WEAK int get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    CUstream s = capture_stream(ctx);
+    if (s != NULL) {
+        *stream = s;
+        return 0;
+    }
+    return halide_cuda_get_stream(user_context, ctx, stream);
+}
+
+// Times the work issued to a stream between construction and finish()
+// with a pair of events, and bills it to the Func being profiled. Does
+// nothing unless a profiled pipeline is running and the stream isn't
+// being captured into a graph. The context must be current.
+class DeviceTimer {
+    CUevent start, stop;
+    int func;
+
+public:
+    DeviceTimer(CUcontext ctx, CUstream stream) : start(NULL), stop(NULL), func(profiled_device_func()) {
+        if (func < 0 || cuEventCreate == NULL || capture_stream(ctx) != NULL) {
+            func = -1;
+            return;
+        }
+        if (cuEventCreate(&start, 0) != CUDA_SUCCESS ||
+            cuEventCreate(&stop, 0) != CUDA_SUCCESS ||
+            cuEventRecord(start, stream) != CUDA_SUCCESS) {
+            func = -1;
+        }
+    }
+
+    // Wait for the work to finish, and bill its time as kernel or
+    // copy time.
+    void finish(CUstream stream, bool is_copy) {
+        float ms = 0;
+        if (func >= 0 &&
+            cuEventRecord(stop, stream) == CUDA_SUCCESS &&
+            cuEventSynchronize(stop) == CUDA_SUCCESS &&
+            cuEventElapsedTime(&ms, start, stop) == CUDA_SUCCESS) {
+            uint64_t ns = (uint64_t)(ms * 1000000.0f);
+            halide_profiler_record_gpu_time(func, is_copy ? 0 : ns, is_copy ? ns : 0);
+        }
+        func = -1;
+    }
+
+    ~DeviceTimer() {
+        if (start) {
+            cuEventDestroy_v2(start);
+        }
+        if (stop) {
+            cuEventDestroy_v2(stop);
+        }
+    }
+};
+
+// Copies between the host and the device run on a second,
+// non-blocking stream per context, and are ordered against the
+// kernels on the compute stream with events instead of by sharing a
+// stream. Each range of device memory used by a kernel or uploaded to
+// has an entry holding the events to wait on before touching it
+// again, so a copy back to the host only waits for the kernels that
+// wrote the buffer it reads, and uploads for the next part of a
+// pipeline can overlap kernels that don't use their destination.
+struct copy_stream_state {
+    CUcontext context;
+    CUstream stream;
+    copy_stream_state *next;
+};
+
+struct range_events {
+    CUcontext context;
+    uint64_t begin, end;
+    // Recorded on a compute stream after the last kernel or
+    // device-to-device copy that used or wrote the range.
+    CUevent used, written;
+    // Recorded on the copy stream after the last upload to the range.
+    CUevent uploaded;
+    bool has_used, has_written, has_uploaded;
+    range_events *next;
+};
+
+WEAK copy_stream_state *copy_streams = NULL;
+WEAK range_events *tracked_ranges = NULL;
+WEAK int num_tracked_ranges = 0;
+// This spinlock protects the three variables above.
+volatile int WEAK tracked_ranges_lock = 0;
+
+// Past this many ranges, the streams are synchronized and the ranges
+// dropped rather than searching an ever longer list.
+#define MAX_TRACKED_RANGES 256
+
+enum range_wait {
+    wait_for_uploads,
+    wait_for_uses,
+    wait_for_writes
+};
+
+// tracked_ranges_lock must be held.
+WEAK CUstream find_copy_stream(CUcontext ctx) {
+    for (copy_stream_state *s = copy_streams; s != NULL; s = s->next) {
+        if (s->context == ctx) {
+            return s->stream;
+        }
+    }
+    return NULL;
+}
+
+WEAK bool has_copy_stream(CUcontext ctx) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    return find_copy_stream(ctx) != NULL;
+}
+
+// The copy stream for a context, created the first time it's
+// needed. Returns NULL if copies must be issued to the compute stream
+// instead, because the driver is too old or a graph is being
+// captured. The context must be current.
+WEAK CUstream get_copy_stream(void *user_context, CUcontext ctx, CUstream compute_stream) {
+    if (cuStreamCreate == NULL || cuStreamDestroy_v2 == NULL ||
+        cuStreamWaitEvent == NULL || cuStreamSynchronize == NULL ||
+        cuEventCreate == NULL || cuEventRecord == NULL ||
+        cuEventSynchronize == NULL || cuEventDestroy_v2 == NULL ||
+        capture_stream(ctx) != NULL) {
+        return NULL;
+    }
+
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    CUstream stream = find_copy_stream(ctx);
+    if (stream != NULL) {
+        return stream;
+    }
+
+    copy_stream_state *state = (copy_stream_state *)malloc(sizeof(copy_stream_state));
+    if (state == NULL) {
+        return NULL;
+    }
+    CUevent ready;
+    if (cuEventCreate(&ready, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS) {
+        free(state);
+        return NULL;
+    }
+    if (cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING) != CUDA_SUCCESS) {
+        cuEventDestroy_v2(ready);
+        free(state);
+        return NULL;
+    }
+    // Kernels launched before the copy stream existed weren't
+    // tracked, so wait for all of them once.
+    cuEventRecord(ready, compute_stream);
+    cuStreamWaitEvent(stream, ready, 0);
+    cuEventDestroy_v2(ready);
+
+    debug(user_context) << "    created copy stream " << (void *)stream << " for context " << ctx << "\n";
+    state->context = ctx;
+    state->stream = stream;
+    state->next = copy_streams;
+    copy_streams = state;
+    return stream;
+}
+
+// tracked_ranges_lock must be held.
+WEAK void destroy_range_events(range_events *r) {
+    cuEventDestroy_v2(r->used);
+    cuEventDestroy_v2(r->written);
+    cuEventDestroy_v2(r->uploaded);
+    free(r);
+}
+
+// Drop the ranges tracked for a context, or for all contexts if ctx is
+// NULL. tracked_ranges_lock must be held.
+WEAK void drop_tracked_ranges(CUcontext ctx) {
+    range_events **prev_ptr = &tracked_ranges;
+    while (*prev_ptr != NULL) {
+        range_events *r = *prev_ptr;
+        if (ctx == NULL || r->context == ctx) {
+            *prev_ptr = r->next;
+            destroy_range_events(r);
+            num_tracked_ranges--;
+        } else {
+            prev_ptr = &r->next;
+        }
+    }
+}
+
+// The entry to record work on [begin, end) in. Overlapping entries are
+// merged, since waiting for their last recorded work also waits for
+// everything before it. Returns NULL if the events can't be
+// created. tracked_ranges_lock must be held.
+WEAK range_events *find_or_add_range(CUcontext ctx, CUstream compute_stream, uint64_t begin, uint64_t end) {
+    for (range_events *r = tracked_ranges; r != NULL; r = r->next) {
+        if (r->context == ctx && r->begin < end && begin < r->end) {
+            r->begin = min(r->begin, begin);
+            r->end = max(r->end, end);
+            return r;
+        }
+    }
+
+    if (num_tracked_ranges >= MAX_TRACKED_RANGES) {
+        CUstream copy_stream = find_copy_stream(ctx);
+        if (cuStreamSynchronize(compute_stream) != CUDA_SUCCESS ||
+            (copy_stream != NULL && cuStreamSynchronize(copy_stream) != CUDA_SUCCESS)) {
+            return NULL;
+        }
+        drop_tracked_ranges(ctx);
+    }
+
+    range_events *r = (range_events *)malloc(sizeof(range_events));
+    if (r == NULL) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(range_events));
+    if (cuEventCreate(&r->used, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS ||
+        cuEventCreate(&r->written, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS ||
+        cuEventCreate(&r->uploaded, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS) {
+        if (r->used) cuEventDestroy_v2(r->used);
+        if (r->written) cuEventDestroy_v2(r->written);
+        free(r);
+        return NULL;
+    }
+    r->context = ctx;
+    r->begin = begin;
+    r->end = end;
+    r->next = tracked_ranges;
+    tracked_ranges = r;
+    num_tracked_ranges++;
+    return r;
+}
+
+// Make a stream wait for the tracked work on the ranges overlapping
+// [begin, end).
+WEAK void wait_for_range(CUcontext ctx, CUstream stream, uint64_t begin, uint64_t end, range_wait what) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    for (range_events *r = tracked_ranges; r != NULL; r = r->next) {
+        if (r->context != ctx || r->end <= begin || end <= r->begin) {
+            continue;
+        }
+        if (what == wait_for_uploads && r->has_uploaded) {
+            cuStreamWaitEvent(stream, r->uploaded, 0);
+        } else if (what == wait_for_uses && r->has_used) {
+            cuStreamWaitEvent(stream, r->used, 0);
+        } else if (what == wait_for_writes && r->has_written) {
+            cuStreamWaitEvent(stream, r->written, 0);
+        }
+    }
+}
+
+// Note that the work just issued to a compute stream used, and maybe
+// wrote, [begin, end). If it can't be tracked, wait for it instead.
+WEAK int record_use(CUcontext ctx, CUstream compute_stream, uint64_t begin, uint64_t end, bool write) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    range_events *r = find_or_add_range(ctx, compute_stream, begin, end);
+    if (r == NULL) {
+        return cuStreamSynchronize(compute_stream);
+    }
+    cuEventRecord(r->used, compute_stream);
+    r->has_used = true;
+    if (write) {
+        cuEventRecord(r->written, compute_stream);
+        r->has_written = true;
+    }
+    return CUDA_SUCCESS;
+}
+
+// Note that the upload just issued to the copy stream wrote [begin, end).
+WEAK int record_upload(CUcontext ctx, CUstream compute_stream, CUstream copy_stream, uint64_t begin, uint64_t end) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    range_events *r = find_or_add_range(ctx, compute_stream, begin, end);
+    if (r == NULL) {
+        return cuStreamSynchronize(copy_stream);
+    }
+    cuEventRecord(r->uploaded, copy_stream);
+    r->has_uploaded = true;
+    return CUDA_SUCCESS;
+}
+
+// Stop tracking the ranges within a device allocation that is being
+// freed. Whatever reuses the memory must still wait for the work
+// already issued to it, so the compute stream waits for the pending
+// uploads and the copy stream for the pending kernels.
+WEAK void forget_range(CUcontext ctx, CUstream compute_stream, uint64_t begin, uint64_t end) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    CUstream copy_stream = find_copy_stream(ctx);
+    if (copy_stream == NULL) {
+        return;
+    }
+    range_events **prev_ptr = &tracked_ranges;
+    while (*prev_ptr != NULL) {
+        range_events *r = *prev_ptr;
+        if (r->context == ctx && r->begin < end && begin < r->end) {
+            if (r->has_uploaded) {
+                cuStreamWaitEvent(compute_stream, r->uploaded, 0);
+            }
+            if (r->has_used) {
+                cuStreamWaitEvent(copy_stream, r->used, 0);
+            }
+            *prev_ptr = r->next;
+            destroy_range_events(r);
+            num_tracked_ranges--;
+        } else {
+            prev_ptr = &r->next;
+        }
+    }
+}
+
+// Wait for everything issued to a context's copy stream.
+WEAK CUresult sync_copy_stream(CUcontext ctx) {
+    CUstream copy_stream;
+    {
+        ScopedSpinLock spinlock(&tracked_ranges_lock);
+        copy_stream = find_copy_stream(ctx);
+    }
+    return copy_stream != NULL ? cuStreamSynchronize(copy_stream) : CUDA_SUCCESS;
+}
+
+// Destroy a context's copy stream and tracked ranges. The context must
+// be current.
+WEAK void release_copy_stream(CUcontext ctx) {
+    ScopedSpinLock spinlock(&tracked_ranges_lock);
+    drop_tracked_ranges(ctx);
+    copy_stream_state **prev_ptr = &copy_streams;
+    while (*prev_ptr != NULL) {
+        copy_stream_state *s = *prev_ptr;
+        if (s->context == ctx) {
+            *prev_ptr = s->next;
+            cuStreamDestroy_v2(s->stream);
+            free(s);
+        } else {
+            prev_ptr = &s->next;
+        }
+    }
+}
+
+// Compile PTX to a cubin with the driver's linker, so that the cubin
+// can be stored in the kernel cache. Returns false if the linker isn't
+// available or fails; the caller should fall back to loading the PTX
+// directly.
+WEAK bool compile_and_cache_ptx(void *user_context, const char *ptx_src, int size,
+                                CUjit_option *options, void **option_values, int num_options,
+                                const KernelCacheKey &key, CUmodule *module) {
+    if (cuLinkCreate_v2 == NULL || cuLinkAddData_v2 == NULL ||
+        cuLinkComplete == NULL || cuLinkDestroy == NULL) {
+        return false;
+    }
+    CUlinkState state;
+    CUresult err = cuLinkCreate_v2(num_options, options, option_values, &state);
+    if (err != CUDA_SUCCESS) {
+        return false;
+    }
+    void *cubin = NULL;
+    size_t cubin_size = 0;
+    err = cuLinkAddData_v2(state, CU_JIT_INPUT_PTX, (void *)ptx_src, size, "halide", 0, NULL, NULL);
+    if (err == CUDA_SUCCESS) {
+        err = cuLinkComplete(state, &cubin, &cubin_size);
+    }
+    if (err == CUDA_SUCCESS) {
+        // The cubin is owned by the link state, so load it before
+        // destroying that.
+        err = cuModuleLoadData(module, cubin);
+        if (err == CUDA_SUCCESS) {
+            kernel_cache_store(user_context, "cuda", key, cubin, cubin_size);
+        }
+    }
+    cuLinkDestroy(state);
+    return err == CUDA_SUCCESS;
+}
+
+WEAK KernelCacheKey make_kernel_cache_key(const char *ptx_src, int size, unsigned int max_regs_per_thread) {
+    KernelCacheKey key;
+    key.add(ptx_src, size);
+    key.add(&max_regs_per_thread, sizeof(max_regs_per_thread));
+
+    CUdevice dev;
+    if (cuCtxGetDevice(&dev) == CUDA_SUCCESS) {
+        char name[256] = {0};
+        cuDeviceGetName(name, sizeof(name) - 1, dev);
+        key.add(name);
+        int cc[2] = {0, 0};
+        cuDeviceGetAttribute(&cc[0], CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, dev);
+        cuDeviceGetAttribute(&cc[1], CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, dev);
+        key.add(cc, sizeof(cc));
+    }
+    int driver_version = 0;
+    if (cuDriverGetVersion != NULL) {
+        cuDriverGetVersion(&driver_version);
+    }
+    key.add(&driver_version, sizeof(driver_version));
+    return key;
+}
+
+// Load the module for a pipeline's kernels on the given context and add
+// it to the pipeline's list. Must be called with filters_list_lock held.
+WEAK CUresult load_module(void *user_context, registered_filters *filters, CUcontext ctx,
+                          module_state **result) {
+    const char *ptx_src = filters->ptx_src;
+    int size = filters->ptx_size;
+    module_state *loaded_module = (module_state *)malloc(sizeof(module_state));
+    debug(user_context) <<  "    cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
+
+    CUjit_option options[] = { CU_JIT_MAX_REGISTERS };
+    unsigned int max_regs_per_thread = 64;
+
+    // A hack to enable control over max register count for
+    // testing. This should be surfaced in the schedule somehow
+    // instead.
+    char *regs = getenv("HL_CUDA_JIT_MAX_REGISTERS");
+    if (regs) {
+        max_regs_per_thread = atoi(regs);
+    }
+    void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
+
+    CUresult err = CUDA_ERROR_NOT_INITIALIZED;
+    bool loaded = false;
+    if (kernel_cache_dir()) {
+        KernelCacheKey key = make_kernel_cache_key(ptx_src, size, max_regs_per_thread);
+        size_t cubin_size = 0;
+        uint8_t *cubin = kernel_cache_load(user_context, "cuda", key, &cubin_size);
+        if (cubin) {
+            loaded = (cuModuleLoadData(&loaded_module->module, cubin) == CUDA_SUCCESS);
+            free(cubin);
+        }
+        if (!loaded) {
+            loaded = compile_and_cache_ptx(user_context, ptx_src, size, options, optionValues, 1,
+                                           key, &loaded_module->module);
+        }
+    }
+    if (loaded) {
+        err = CUDA_SUCCESS;
+    } else {
+        err = cuModuleLoadDataEx(&loaded_module->module, ptx_src, 1, options, optionValues);
+    }
+
+    if (err != CUDA_SUCCESS) {
+        free(loaded_module);
+        error(user_context) << "CUDA: cuModuleLoadData failed: "
+                            << get_error_name(err);
+        return err;
+    } else {
+        debug(user_context) << (void *)(loaded_module->module) << "\n";
+    }
+    loaded_module->context = ctx;
+    loaded_module->next = filters->modules;
+    filters->modules = loaded_module;
+    *result = loaded_module;
+    return CUDA_SUCCESS;
+}
+
+// Free the cached allocations and unload the modules on a context, in
+// preparation for destroying it.
+WEAK void release_context_resources(void *user_context, CUcontext ctx) {
+    int err;
+    // It's possible that this is being called from the destructor of
+    // a static variable, in which case the driver may already be
+    // shutting down.
+    err = cuCtxPushCurrent(ctx);
+    if (err != CUDA_SUCCESS) {
+        err = cuCtxSynchronize();
+    }
+    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+
+    // Free all the unused allocations on this context.
+    release_unused_allocations(user_context, ctx, 0);
+
+    release_copy_stream(ctx);
+
+    {
+        ScopedSpinLock spinlock(&filters_list_lock);
+
+        // Unload the modules attached to this context. Note that the list
+        // nodes themselves are not freed, only the module objects are
+        // released. Subsequent calls to halide_init_kernels might re-create
+        // the program object using the same list node to store the module
+        // object.
+        registered_filters *filters = filters_list;
+        while (filters) {
+            module_state **prev_ptr = &filters->modules;
+            module_state *loaded_module = filters->modules;
+            while (loaded_module != NULL) {
+                if (loaded_module->context == ctx) {
+                    debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
+                    err = cuModuleUnload(loaded_module->module);
+                    halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+                    *prev_ptr = loaded_module->next;
+                    free(loaded_module);
+                    loaded_module = *prev_ptr;
+                } else {
+                    loaded_module = loaded_module->next;
+                    prev_ptr = &loaded_module->next;
+                }
+            }
+            filters = filters->next;
+        }
+    }  // spinlock
+
+    CUcontext old_ctx;
+    cuCtxPopCurrent(&old_ctx);
+}
+
 }}}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -455,16 +1226,6 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
                         << ", ptx_src: " << (void *)ptx_src
                         << ", size: " << size << "\n";
 
-    Context ctx(user_context);
-    if (ctx.error != 0) {
-        return ctx.error;
-    }
-
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
-
-
     halide_assert(user_context, &filters_list_lock != NULL);
     {
         ScopedSpinLock spinlock(&filters_list_lock);
@@ -478,46 +1239,15 @@ WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, co
             *filters = (registered_filters*)malloc(sizeof(registered_filters));
             (*filters)->modules = NULL;
             (*filters)->next = filters_list;
+            (*filters)->ptx_src = ptx_src;
+            (*filters)->ptx_size = size;
             filters_list = *filters;
         }
-
-        // Create the module itself if necessary.
-        module_state *loaded_module = find_module_for_context(*filters, ctx.context);
-        if (loaded_module == NULL) {
-            loaded_module = (module_state *)malloc(sizeof(module_state));
-            debug(user_context) <<  "    cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
-
-            CUjit_option options[] = { CU_JIT_MAX_REGISTERS };
-            unsigned int max_regs_per_thread = 64;
-
-            // A hack to enable control over max register count for
-            // testing. This should be surfaced in the schedule somehow
-            // instead.
-            char *regs = getenv("HL_CUDA_JIT_MAX_REGISTERS");
-            if (regs) {
-                max_regs_per_thread = atoi(regs);
-            }
-            void *optionValues[] = { (void*)(uintptr_t) max_regs_per_thread };
-            CUresult err = cuModuleLoadDataEx(&loaded_module->module, ptx_src, 1, options, optionValues);
-
-            if (err != CUDA_SUCCESS) {
-                free(loaded_module);
-                error(user_context) << "CUDA: cuModuleLoadData failed: "
-                                    << get_error_name(err);
-                return err;
-            } else {
-                debug(user_context) << (void *)(loaded_module->module) << "\n";
-            }
-            loaded_module->context = ctx.context;
-            loaded_module->next = (*filters)->modules;
-            (*filters)->modules = loaded_module;
-        }
     }  // spinlock
 
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_after = halide_current_time_ns(user_context);
-    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-    #endif
+    // The module is compiled for a context by the first
+    // halide_cuda_run that needs it, so pipelines pay for neither the
+    // context nor the PTX compilation until they launch a kernel.
 
     return 0;
 }
@@ -546,8 +1276,31 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t* buf) {
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
 
-    debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
-    CUresult err = cuMemFree(dev_ptr);
+    CUresult err = CUDA_SUCCESS;
+    size_t size = quantize_allocation_size(buf->size_in_bytes());
+    if (has_copy_stream(ctx.context)) {
+        CUstream stream;
+        if (get_stream(user_context, ctx.context, &stream) == 0) {
+            forget_range(ctx.context, stream, dev_ptr, dev_ptr + size);
+        }
+    }
+    CUcontext owner = ctx.context;
+    if (using_multiple_devices) {
+        // The buffer may have been allocated by an iteration of a loop
+        // distributed across several GPUs, so return it to the pool
+        // of the context that owns it.
+        if (cuPointerGetAttribute(&owner, CU_POINTER_ATTRIBUTE_CONTEXT, dev_ptr) != CUDA_SUCCESS) {
+            owner = ctx.context;
+        }
+    }
+    if (retain_for_graph(ctx.context, dev_ptr, size)) {
+        debug(user_context) <<  "    keeping allocation " << (void *)(dev_ptr) << " for the graph being captured\n";
+    } else if (!cache_unused_allocation(owner, dev_ptr, size)) {
+        debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
+        err = cuMemFree(dev_ptr);
+    } else {
+        debug(user_context) <<  "    caching unused allocation " << (void *)(dev_ptr) << "\n";
+    }
     // If cuMemFree fails, it isn't likely to succeed later, so just drop
     // the reference.
     buf->device_interface->impl->release_module();
@@ -583,46 +1336,7 @@ WEAK int halide_cuda_device_release(void *user_context) {
     }
 
     if (ctx) {
-        // It's possible that this is being called from the destructor of
-        // a static variable, in which case the driver may already be
-        // shutting down.
-        err = cuCtxPushCurrent(ctx);
-        if (err != CUDA_SUCCESS) {
-            err = cuCtxSynchronize();
-        }
-        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-
-        {
-            ScopedSpinLock spinlock(&filters_list_lock);
-
-            // Unload the modules attached to this context. Note that the list
-            // nodes themselves are not freed, only the module objects are
-            // released. Subsequent calls to halide_init_kernels might re-create
-            // the program object using the same list node to store the module
-            // object.
-            registered_filters *filters = filters_list;
-            while (filters) {
-                module_state **prev_ptr = &filters->modules;
-                module_state *loaded_module = filters->modules;
-                while (loaded_module != NULL) {
-                    if (loaded_module->context == ctx) {
-                        debug(user_context) << "    cuModuleUnload " << loaded_module->module << "\n";
-                        err = cuModuleUnload(loaded_module->module);
-                        halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
-                        *prev_ptr = loaded_module->next;
-                        free(loaded_module);
-                        loaded_module = *prev_ptr;
-                    } else {
-                        loaded_module = loaded_module->next;
-                        prev_ptr = &loaded_module->next;
-                    }
-                }
-                filters = filters->next;
-            }
-        }  // spinlock
-
-        CUcontext old_ctx;
-        cuCtxPopCurrent(&old_ctx);
+        release_context_resources(user_context, ctx);
 
         // Only destroy the context if we own it
 
@@ -639,11 +1353,221 @@ WEAK int halide_cuda_device_release(void *user_context) {
         }  // spinlock
     }
 
+    // Also destroy the contexts made for the other devices.
+    for (int i = 0; i < MAX_CUDA_DEVICES; i++) {
+        CUcontext device_ctx = device_contexts[i];
+        if (device_ctx == NULL) {
+            continue;
+        }
+        if (device_ctx != ctx) {
+            release_context_resources(user_context, device_ctx);
+            debug(user_context) << "    cuCtxDestroy " << device_ctx << "\n";
+            err = cuCtxDestroy(device_ctx);
+            halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
+        }
+        ScopedSpinLock spinlock(&context_lock);
+        device_contexts[i] = NULL;
+    }
+
     halide_cuda_release_context(user_context);
 
     return 0;
 }
 
+WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_release_unused_device_allocations (user_context: " <<  user_context << ")\n";
+
+    // If we haven't even loaded libcuda, there can't be anything to free.
+    if (!lib_cuda) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    return release_unused_allocations(user_context, ctx.context, 0);
+}
+
+WEAK int halide_cuda_set_max_cached_device_bytes(void *user_context, size_t max_bytes) {
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        max_cached_device_bytes = max_bytes;
+        if (cached_device_bytes <= max_bytes) {
+            return 0;
+        }
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    return release_unused_allocations(user_context, ctx.context, max_bytes);
+}
+
+WEAK int halide_cuda_begin_graph_capture(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_begin_graph_capture (user_context: " <<  user_context << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    if (cuStreamBeginCapture_v2 == NULL || cuStreamEndCapture == NULL ||
+        cuGraphInstantiate == NULL || cuGraphLaunch == NULL ||
+        cuStreamCreate == NULL || cuStreamDestroy_v2 == NULL ||
+        cuGraphExecDestroy == NULL || cuGraphDestroy == NULL ||
+        cuStreamSynchronize == NULL) {
+        error(user_context) << "CUDA: Capturing graphs requires a driver that supports CUDA 10.1.\n";
+        return CUDA_ERROR_NOT_SUPPORTED;
+    }
+
+    // Captured kernels aren't ordered against uploads already issued
+    // to the copy stream, so let those finish first.
+    CUresult sync_err = sync_copy_stream(ctx.context);
+    if (sync_err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuStreamSynchronize failed: "
+                            << get_error_name(sync_err);
+        return sync_err;
+    }
+
+    graph_state *g = (graph_state *)malloc(sizeof(graph_state));
+    if (g == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+    memset(g, 0, sizeof(graph_state));
+    g->context = ctx.context;
+
+    CUresult err = cuStreamCreate(&g->stream, CU_STREAM_NON_BLOCKING);
+    if (err == CUDA_SUCCESS) {
+        err = cuStreamBeginCapture_v2(g->stream, CU_STREAM_CAPTURE_MODE_RELAXED);
+        if (err != CUDA_SUCCESS) {
+            cuStreamDestroy_v2(g->stream);
+        }
+    }
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuStreamBeginCapture failed: "
+                            << get_error_name(err);
+        free(g);
+        return err;
+    }
+
+    {
+        ScopedSpinLock spinlock(&capturing_graph_lock);
+        if (capturing_graph == NULL) {
+            capturing_graph = g;
+            g = NULL;
+        }
+    }
+    if (g != NULL) {
+        CUgraph graph;
+        cuStreamEndCapture(g->stream, &graph);
+        if (graph) {
+            cuGraphDestroy(graph);
+        }
+        cuStreamDestroy_v2(g->stream);
+        free(g);
+        error(user_context) << "CUDA: A graph is already being captured.\n";
+        return CUDA_ERROR_NOT_PERMITTED;
+    }
+    return 0;
+}
+
+WEAK int halide_cuda_end_graph_capture(void *user_context, void **graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_end_graph_capture (user_context: " <<  user_context << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    graph_state *g = NULL;
+    {
+        ScopedSpinLock spinlock(&capturing_graph_lock);
+        if (capturing_graph != NULL && capturing_graph->context == ctx.context) {
+            g = capturing_graph;
+            capturing_graph = NULL;
+        }
+    }
+    if (g == NULL) {
+        error(user_context) << "CUDA: halide_cuda_end_graph_capture called without a graph being captured.\n";
+        return CUDA_ERROR_NOT_PERMITTED;
+    }
+
+    CUresult err = cuStreamEndCapture(g->stream, &g->graph);
+    cuStreamDestroy_v2(g->stream);
+    g->stream = NULL;
+    if (err == CUDA_SUCCESS) {
+        err = cuGraphInstantiate(&g->exec, g->graph, NULL, NULL, 0);
+    }
+    if (err != CUDA_SUCCESS) {
+        // This is where a pipeline doing something that can't be
+        // captured, such as synchronizing with the host, shows up.
+        error(user_context) << "CUDA: Capturing the graph failed: "
+                            << get_error_name(err);
+        destroy_graph(user_context, g);
+        return err;
+    }
+
+    debug(user_context) << "    captured graph " << g << "\n";
+    *graph = g;
+    return 0;
+}
+
+WEAK int halide_cuda_launch_graph(void *user_context, void *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_launch_graph (user_context: " <<  user_context
+        << ", graph: " << graph << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    graph_state *g = (graph_state *)graph;
+    halide_assert(user_context, g != NULL && g->context == ctx.context);
+
+    CUstream stream = NULL;
+    int result = get_stream(user_context, ctx.context, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: In halide_cuda_launch_graph, halide_cuda_get_stream returned " << result << "\n";
+        return result;
+    }
+
+    CUresult err = cuGraphLaunch(g->exec, stream);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuGraphLaunch failed: "
+                            << get_error_name(err);
+        return err;
+    }
+    return 0;
+}
+
+WEAK int halide_cuda_release_graph(void *user_context, void *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_release_graph (user_context: " <<  user_context
+        << ", graph: " << graph << ")\n";
+
+    if (graph == NULL) {
+        return 0;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    // A launch of the graph may still be running.
+    CUresult err = cuCtxSynchronize();
+    destroy_graph(user_context, (graph_state *)graph);
+    return err;
+}
+
 WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     debug(user_context)
         << "CUDA: halide_cuda_device_malloc (user_context: " << user_context
@@ -673,16 +1597,26 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUdeviceptr p;
-    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
-    CUresult err = cuMemAlloc(&p, size);
-    if (err != CUDA_SUCCESS) {
-        debug(user_context) << get_error_name(err) << "\n";
-        error(user_context) << "CUDA: cuMemAlloc failed: "
-                            << get_error_name(err);
-        return err;
+    size = quantize_allocation_size(size);
+    CUdeviceptr p = take_unused_allocation(ctx.context, size);
+    if (p) {
+        debug(user_context) << "    reusing unused allocation " << (void *)p << "\n";
     } else {
-        debug(user_context) << (void *)p << "\n";
+        debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
+        CUresult err = cuMemAlloc(&p, size);
+        if (err == CUDA_ERROR_OUT_OF_MEMORY) {
+            // Free up the allocations we're holding on to and retry.
+            release_unused_allocations(user_context, ctx.context, 0);
+            err = cuMemAlloc(&p, size);
+        }
+        if (err != CUDA_SUCCESS) {
+            debug(user_context) << get_error_name(err) << "\n";
+            error(user_context) << "CUDA: cuMemAlloc failed: "
+                                << get_error_name(err);
+            return err;
+        } else {
+            debug(user_context) << (void *)p << "\n";
+        }
     }
     halide_assert(user_context, p);
     buf->device = p;
@@ -699,7 +1633,8 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 
 namespace {
 WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
-                                       uint64_t src, uint64_t dst, int d, bool from_host, bool to_host) {
+                                       uint64_t src, uint64_t dst, int d, bool from_host, bool to_host,
+                                       CUstream stream) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
@@ -710,14 +1645,17 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
                             << " to " << (to_host ? "host" : "device") << ", "
                             << (void *)src << " -> " << (void *)dst << ", " << c.chunk_size << " bytes\n";
         if (!from_host && to_host) {
-            debug(user_context) << "cuMemcpyDtoH(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
-            err = cuMemcpyDtoH((void *)dst, (CUdeviceptr)src, c.chunk_size);
+            debug(user_context) << "cuMemcpyDtoHAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+            copy_name = "cuMemcpyDtoHAsync";
+            err = cuMemcpyDtoHAsync((void *)dst, (CUdeviceptr)src, c.chunk_size, stream);
         } else if (from_host && !to_host) {
-            debug(user_context) << "cuMemcpyHtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
-            err = cuMemcpyHtoD((CUdeviceptr)dst, (void *)src, c.chunk_size);
+            debug(user_context) << "cuMemcpyHtoDAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+            copy_name = "cuMemcpyHtoDAsync";
+            err = cuMemcpyHtoDAsync((CUdeviceptr)dst, (void *)src, c.chunk_size, stream);
         } else if (!from_host && !to_host) {
-            debug(user_context) << "cuMemcpyDtoD(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
-            err = cuMemcpyDtoD((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size);
+            debug(user_context) << "cuMemcpyDtoDAsync(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
+            copy_name = "cuMemcpyDtoDAsync";
+            err = cuMemcpyDtoDAsync((CUdeviceptr)dst, (CUdeviceptr)src, c.chunk_size, stream);
         } else if (dst != src) {
             debug(user_context) << "memcpy(" << (void *)dst << ", " << (void *)src << ", " << c.chunk_size <<")\n";
             // Could reach here if a user called directly into the
@@ -732,7 +1670,7 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d-1]; i++) {
-            int err = cuda_do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host);
+            int err = cuda_do_multidimensional_copy(user_context, c, src + src_off, dst + dst_off, d - 1, from_host, to_host, stream);
             dst_off += c.dst_stride_bytes[d-1];
             src_off += c.src_stride_bytes[d-1];
             if (err) {
@@ -789,7 +1727,76 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         }
         #endif
 
-        err = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host);
+        if (to_host && capture_stream(ctx.context) != NULL) {
+            error(user_context) << "CUDA: Can't copy to the host while capturing a graph.\n";
+            return halide_error_code_device_buffer_copy_failed;
+        }
+
+        CUstream stream = NULL;
+        if (cuStreamSynchronize != NULL) {
+            int result = get_stream(user_context, ctx.context, &stream);
+            if (result != 0) {
+                error(user_context) << "CUDA: In halide_cuda_buffer_copy, halide_cuda_get_stream returned " << result << "\n";
+                return result;
+            }
+        }
+
+        // Copies to and from the host go on the copy stream, after
+        // just the work they depend on. Device-to-device copies are
+        // ordered like kernels.
+        uint64_t src_begin = src->device, src_end = src->device + src->size_in_bytes();
+        uint64_t dst_begin = dst->device, dst_end = dst->device + dst->size_in_bytes();
+        CUstream copy_stream = NULL;
+        if (from_host != to_host) {
+            copy_stream = get_copy_stream(user_context, ctx.context, stream);
+        }
+        if (copy_stream != NULL) {
+            if (from_host) {
+                wait_for_range(ctx.context, copy_stream, dst_begin, dst_end, wait_for_uses);
+            } else {
+                wait_for_range(ctx.context, copy_stream, src_begin, src_end, wait_for_writes);
+            }
+        } else if (!from_host && !to_host && has_copy_stream(ctx.context)) {
+            wait_for_range(ctx.context, stream, src_begin, src_end, wait_for_uploads);
+            wait_for_range(ctx.context, stream, dst_begin, dst_end, wait_for_uploads);
+        }
+        CUstream issue_stream = copy_stream != NULL ? copy_stream : stream;
+
+        DeviceTimer timer(ctx.context, issue_stream);
+        err = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, issue_stream);
+        if (err == 0) {
+            timer.finish(issue_stream, true);
+        }
+
+        if (err == 0 && copy_stream != NULL && from_host) {
+            err = record_upload(ctx.context, stream, copy_stream, dst_begin, dst_end);
+        } else if (err == 0 && !from_host && !to_host && has_copy_stream(ctx.context)) {
+            err = record_use(ctx.context, stream, src_begin, src_end, false);
+            if (err == 0) {
+                err = record_use(ctx.context, stream, dst_begin, dst_end, true);
+            }
+        }
+
+        if (err == 0 && to_host) {
+            // The host data must be ready when we return, but there's
+            // no need to wait for anything other than this copy.
+            CUresult sync_err;
+            CUevent done = NULL;
+            if (copy_stream == NULL) {
+                sync_err = (cuStreamSynchronize != NULL) ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+            } else if ((sync_err = cuEventCreate(&done, CU_EVENT_DISABLE_TIMING)) == CUDA_SUCCESS) {
+                sync_err = cuEventRecord(done, copy_stream);
+                if (sync_err == CUDA_SUCCESS) {
+                    sync_err = cuEventSynchronize(done);
+                }
+                cuEventDestroy_v2(done);
+            }
+            if (sync_err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: Synchronizing with a copy to the host failed: "
+                                    << get_error_name(sync_err);
+                err = (int)sync_err;
+            }
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -866,14 +1873,23 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
+    // Nothing runs while a graph is being captured, so there is
+    // nothing to wait for.
+    if (capture_stream(ctx.context) != NULL) {
+        return 0;
+    }
+
     CUresult err;
     if (cuStreamSynchronize != NULL) {
         CUstream stream;
-        int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+        int result = get_stream(user_context, ctx.context, &stream);
         if (result != 0) {
             error(user_context) << "CUDA: In halide_cuda_device_sync, halide_cuda_get_stream returned " << result << "\n";
         }
         err = cuStreamSynchronize(stream);
+        if (err == CUDA_SUCCESS) {
+            err = sync_copy_stream(ctx.context);
+        }
     } else {
        err = cuCtxSynchronize();
     }
@@ -926,6 +1942,18 @@ WEAK int halide_cuda_run(void *user_context,
 
     halide_assert(user_context, state_ptr);
     module_state *loaded_module = find_module_for_context((registered_filters *)state_ptr, ctx.context);
+    if (loaded_module == NULL) {
+        // Modules are compiled lazily, on the first launch of one of
+        // their kernels on each context.
+        ScopedSpinLock spinlock(&filters_list_lock);
+        loaded_module = find_module_for_context((registered_filters *)state_ptr, ctx.context);
+        if (loaded_module == NULL) {
+            err = load_module(user_context, (registered_filters *)state_ptr, ctx.context, &loaded_module);
+            if (err != CUDA_SUCCESS) {
+                return err;
+            }
+        }
+    }
     halide_assert(user_context, loaded_module != NULL);
     CUmodule mod = loaded_module->module;
     debug(user_context) << "Got module " << mod << "\n";
@@ -968,12 +1996,25 @@ WEAK int halide_cuda_run(void *user_context,
     // We use whether this routine was defined in the cuda driver library
     // as a test for streams support in the cuda implementation.
     if (cuStreamSynchronize != NULL) {
-        int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+        int result = get_stream(user_context, ctx.context, &stream);
         if (result != 0) {
             error(user_context) << "CUDA: In halide_cuda_run, halide_cuda_get_stream returned " << result << "\n";
         }
     }
 
+    // Kernels wait for the uploads to their buffers, and are recorded
+    // as using (or writing, if arg_is_buffer is 2) them.
+    bool track_buffers = capture_stream(ctx.context) == NULL && has_copy_stream(ctx.context);
+    if (track_buffers) {
+        for (size_t i = 0; i < num_args; i++) {
+            if (arg_is_buffer[i]) {
+                halide_buffer_t *b = (halide_buffer_t *)args[i];
+                wait_for_range(ctx.context, stream, b->device, b->device + b->size_in_bytes(), wait_for_uploads);
+            }
+        }
+    }
+
+    DeviceTimer timer(ctx.context, stream);
     err = cuLaunchKernel(f,
                          blocksX,  blocksY,  blocksZ,
                          threadsX, threadsY, threadsZ,
@@ -988,9 +2029,25 @@ WEAK int halide_cuda_run(void *user_context,
                             << get_error_name(err);
         return err;
     }
+    timer.finish(stream, false);
+
+    if (track_buffers) {
+        for (size_t i = 0; i < num_args; i++) {
+            if (arg_is_buffer[i]) {
+                halide_buffer_t *b = (halide_buffer_t *)args[i];
+                err = (CUresult)record_use(ctx.context, stream, b->device, b->device + b->size_in_bytes(),
+                                           arg_is_buffer[i] == 2);
+                if (err != CUDA_SUCCESS) {
+                    error(user_context) << "CUDA: Synchronizing after a kernel failed: "
+                                        << get_error_name(err);
+                    return err;
+                }
+            }
+        }
+    }
 
     #ifdef DEBUG_RUNTIME
-    err = cuCtxSynchronize();
+    err = (capture_stream(ctx.context) != NULL) ? CUDA_SUCCESS : cuCtxSynchronize();
     if (err != CUDA_SUCCESS) {
         error(user_context) << "CUDA: cuCtxSynchronize failed: "
                             << get_error_name(err);
@@ -1002,12 +2059,59 @@ WEAK int halide_cuda_run(void *user_context,
     return 0;
 }
 
+// Allocate the host side in pinned memory, so that copies to and
+// from the device can be asynchronous.
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    int result = halide_cuda_device_malloc(user_context, buf);
+    if (result != 0) {
+        return result;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        halide_cuda_device_free(user_context, buf);
+        return ctx.error;
+    }
+
+    void *host = NULL;
+    CUresult err = cuMemHostAlloc(&host, buf->size_in_bytes(), 0);
+    if (err != CUDA_SUCCESS) {
+        // Fall back to pageable memory.
+        debug(user_context) << "    cuMemHostAlloc failed: " << get_error_name(err) << "\n";
+        host = halide_malloc(user_context, buf->size_in_bytes());
+        if (host == NULL) {
+            halide_cuda_device_free(user_context, buf);
+            return halide_error_code_out_of_memory;
+        }
+    }
+    buf->host = (uint8_t *)host;
+    return 0;
 }
 
 WEAK int halide_cuda_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    int result = halide_cuda_device_free(user_context, buf);
+    if (buf->host) {
+        Context ctx(user_context);
+        unsigned int flags;
+        if (ctx.error == CUDA_SUCCESS &&
+            cuMemHostGetFlags(&flags, buf->host) == CUDA_SUCCESS) {
+            cuMemFreeHost(buf->host);
+        } else {
+            halide_free(user_context, buf->host);
+        }
+        buf->host = NULL;
+    }
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_cuda_wrap_device_ptr(void *user_context, struct halide_buffer_t *buf, uint64_t device_ptr) {
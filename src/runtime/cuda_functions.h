@@ -37,6 +37,12 @@ CUDA_FN_3020(CUresult, cuMemcpyHtoD, cuMemcpyHtoD_v2, (CUdeviceptr dstDevice, co
 CUDA_FN_3020(CUresult, cuMemcpyDtoH, cuMemcpyDtoH_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpyDtoD, cuMemcpyDtoD_v2, (CUdeviceptr dstHost, CUdeviceptr srcDevice, size_t ByteCount));
 CUDA_FN_3020(CUresult, cuMemcpy3D, cuMemcpy3D_v2, (const CUDA_MEMCPY3D *pCopy));
+CUDA_FN_3020(CUresult, cuMemcpyHtoDAsync, cuMemcpyHtoDAsync_v2, (CUdeviceptr dstDevice, const void *srcHost, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoHAsync, cuMemcpyDtoHAsync_v2, (void *dstHost, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
+CUDA_FN_3020(CUresult, cuMemcpyDtoDAsync, cuMemcpyDtoDAsync_v2, (CUdeviceptr dstDevice, CUdeviceptr srcDevice, size_t ByteCount, CUstream hStream));
+CUDA_FN(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN(CUresult, cuMemFreeHost, (void *p));
+CUDA_FN(CUresult, cuMemHostGetFlags, (unsigned int *pFlags, void *p));
 CUDA_FN(CUresult, cuLaunchKernel, (CUfunction f,
                                    unsigned int gridDimX,
                                    unsigned int gridDimY,
@@ -57,6 +63,36 @@ CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr p
 
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
 
+// Needed for timing kernels and copies in the profiler, and for
+// ordering copies on the copy stream against kernels.
+CUDA_FN_OPTIONAL(CUresult, cuEventCreate, (CUevent *phEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuEventRecord, (CUevent hEvent, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamWaitEvent, (CUstream hStream, CUevent hEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuEventSynchronize, (CUevent hEvent));
+CUDA_FN_OPTIONAL(CUresult, cuEventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
+CUDA_FN_OPTIONAL(CUresult, cuEventDestroy_v2, (CUevent hEvent));
+
+CUDA_FN_OPTIONAL(CUresult, cuDriverGetVersion, (int *driverVersion));
+CUDA_FN_OPTIONAL(CUresult, cuLinkCreate_v2, (unsigned int numOptions, CUjit_option *options, void **optionValues, CUlinkState *stateOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkAddData_v2, (CUlinkState state, CUjitInputType type, void *data, size_t size, const char *name,
+                                              unsigned int numOptions, CUjit_option *options, void **optionValues));
+CUDA_FN_OPTIONAL(CUresult, cuLinkComplete, (CUlinkState state, void **cubinOut, size_t *sizeOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkDestroy, (CUlinkState state));
+
+// Only needed for capturing pipelines into CUDA graphs (CUDA 10.1 and up).
+CUDA_FN_OPTIONAL(CUresult, cuStreamCreate, (CUstream *phStream, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuStreamDestroy_v2, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamBeginCapture_v2, (CUstream hStream, int mode));
+CUDA_FN_OPTIONAL(CUresult, cuStreamEndCapture, (CUstream hStream, CUgraph *phGraph));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiate, (CUgraphExec *phGraphExec, CUgraph hGraph, CUgraphNode *phErrorNode, char *logBuffer, size_t bufferSize));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
+
+// Lets the contexts of loops distributed across several GPUs read each
+// other's allocations.
+CUDA_FN_OPTIONAL(CUresult, cuCtxEnablePeerAccess, (CUcontext peerContext, unsigned int Flags));
+
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
 #undef CUDA_FN_3020
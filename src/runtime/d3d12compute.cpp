@@ -496,6 +496,7 @@ struct d3d12_library {
 struct d3d12_function {
     ID3DBlob *shaderBlob;
     ID3D12RootSignature *rootSignature;
+    ID3D12PipelineState *pipelineState;     // created on first dispatch
 };
 
 enum ResourceBindingSlots {
@@ -510,9 +511,8 @@ static const uint32_t ResourceBindingLimits [NumSlots] = {
     16, // UAV
     14, // CBV
     25, // SRV (the actual tier-1 limit is 128, but will allow only 25 for now)
-    // TODO(marcos): we may consider increasing it to the limit once we have a
-    // pool of d3d12_binder objects that are recycled whenever kernels are run
-    // (at the moment, a new binder is created/destroyed with every kernel run)
+    // TODO(marcos): we may consider increasing it to the limit now that
+    // d3d12_binder objects are recycled through 'binder_pool'
 };
 
 struct d3d12_binder {
@@ -647,6 +647,7 @@ void release_d3d12_object<d3d12_function>(d3d12_function *function) {
     TRACELOG;
     Release_ID3D12Object(function->shaderBlob);
     Release_ID3D12Object(function->rootSignature);
+    Release_ID3D12Object(function->pipelineState);
     d3d12_free(function);
 }
 
@@ -1735,6 +1736,7 @@ static d3d12_function *new_function_with_name(d3d12_device *device, d3d12_librar
     function->shaderBlob = shaderBlob;
     function->rootSignature = rootSignature;
     rootSignature->AddRef();
+    function->pipelineState = NULL;
 
     // cache the compiled function for future use:
     library->cache.store(user_context, (const uint8_t*)key.str(), key.size(), &function);
@@ -1870,6 +1872,96 @@ static void wait_until_completed(d3d12_compute_command_list *cmdList) {
     }
 }
 
+// Kernel dispatches are recorded into a single command list that is only
+// submitted once their results are needed: on a device sync, a copy, or the
+// release of a buffer; this avoids waiting on the queue fence after every
+// dispatch. The kernel argument buffers and descriptor heaps used by the
+// recorded dispatches must stay alive until the batch completes.
+static const int MaxBatchDispatches = 64;
+
+struct d3d12_batch {
+    d3d12_command_allocator *allocator;
+    d3d12_compute_command_list *cmdList;
+    bool submitted;
+    int num_dispatches;
+    d3d12_buffer args_buffers [MaxBatchDispatches];
+    d3d12_binder *binders [MaxBatchDispatches];
+};
+WEAK d3d12_batch batch = { };
+
+// descriptor heaps of completed dispatches, ready to be reused:
+WEAK d3d12_binder *binder_pool [MaxBatchDispatches] = { };
+WEAK int binder_pool_size = 0;
+
+static d3d12_binder *acquire_descriptor_binder(d3d12_device *device) {
+    TRACELOG;
+    if (binder_pool_size == 0) {
+        return new_descriptor_binder(device);
+    }
+    // rewind the descriptor tables to the start of the heap; any stale
+    // descriptors past the ones bound next are never accessed by the kernel
+    d3d12_binder *binder = binder_pool[--binder_pool_size];
+    UINT descriptorSize = binder->descriptorSize;
+    D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = Call_ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(binder->descriptorHeap);
+    binder->CPU[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
+    binder->CPU[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
+    binder->CPU[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+    return binder;
+}
+
+static d3d12_compute_command_list *batch_command_list(d3d12_device *device) {
+    TRACELOG;
+    if (batch.cmdList == NULL) {
+        batch.allocator = new_command_allocator<HALIDE_D3D12_COMMAND_LIST_TYPE>(device);
+        if (batch.allocator == NULL) {
+            return NULL;
+        }
+        batch.cmdList = new_compute_command_list(device, batch.allocator);
+        if (batch.cmdList == NULL) {
+            release_object(batch.allocator);
+            batch.allocator = NULL;
+            return NULL;
+        }
+    }
+    halide_assert(user_context, !batch.submitted);
+    return batch.cmdList;
+}
+
+static void submit_batch() {
+    TRACELOG;
+    if ((batch.cmdList != NULL) && !batch.submitted) {
+        TRACEPRINT("submitting " << batch.num_dispatches << " batched dispatches\n");
+        commit_command_list(batch.cmdList);
+        batch.submitted = true;
+    }
+}
+
+// must only be called once the submitted batch is known to have completed
+static void recycle_batch() {
+    TRACELOG;
+    if (batch.cmdList == NULL) {
+        return;
+    }
+    halide_assert(user_context, batch.submitted);
+    for (int i = 0; i < batch.num_dispatches; ++i) {
+        release_object(&batch.args_buffers[i]);
+        binder_pool[binder_pool_size++] = batch.binders[i];
+    }
+    release_object(batch.cmdList);
+    release_object(batch.allocator);
+    batch = zero_struct<d3d12_batch>();
+}
+
+static void flush_batch() {
+    TRACELOG;
+    if (batch.cmdList == NULL) {
+        return;
+    }
+    submit_batch();
+    wait_until_completed(batch.cmdList);
+    recycle_batch();
+}
+
 static void *buffer_contents(d3d12_buffer *buffer) {
     TRACELOG;
 
@@ -2201,6 +2293,11 @@ inline void halide_d3d12compute_device_sync_internal(d3d12_device *device, struc
     // use the main compute queue and issue copies via compute command lists.
     //static const D3D12_COMMAND_LIST_TYPE Type = D3D12_COMMAND_LIST_TYPE_COPY;
 
+    // the batched dispatches go first, so that any copies see their results;
+    // the queue executes in order, so waiting on the copies below also means
+    // waiting on the batch
+    submit_batch();
+
     static const D3D12_COMMAND_LIST_TYPE Type = HALIDE_D3D12_COMMAND_LIST_TYPE;
     d3d12_command_allocator *sync_command_allocator = new_command_allocator<Type>(device);
     d3d12_compute_command_list *blitCmdList = new_command_list<Type>(device, sync_command_allocator);
@@ -2213,6 +2310,7 @@ inline void halide_d3d12compute_device_sync_internal(d3d12_device *device, struc
     }
     commit_command_list(blitCmdList);
     wait_until_completed(blitCmdList);
+    recycle_batch();
 
     if (dev_buffer != NULL) {
         if (dev_buffer->xfer != NULL) {
@@ -2268,6 +2366,10 @@ WEAK int halide_d3d12compute_device_release(void *user_context) {
     if (device) {
         halide_d3d12compute_device_sync_internal(device, NULL);
 
+        while (binder_pool_size > 0) {
+            release_object(binder_pool[--binder_pool_size]);
+        }
+
         // Unload the modules attached to this device. Note that the list
         // nodes themselves are not freed, only the program objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -2438,13 +2540,11 @@ WEAK int halide_d3d12compute_run(void *user_context,
     StartCapturingGPUActivity();
     #endif
 
-    d3d12_command_allocator *command_allocator = new_command_allocator<HALIDE_D3D12_COMMAND_LIST_TYPE>(device);
-    if (command_allocator == 0) {
-        d3d12_halt("D3D12Compute: Could not create compute command allocator.");
-        return -1;
+    if (batch.num_dispatches == MaxBatchDispatches) {
+        flush_batch();
     }
 
-    d3d12_compute_command_list *cmdList = new_compute_command_list(device, command_allocator);
+    d3d12_compute_command_list *cmdList = batch_command_list(device);
     if (cmdList == 0) {
         d3d12_halt("D3D12Compute: Could not create compute command list.");
         return -1;
@@ -2458,13 +2558,17 @@ WEAK int halide_d3d12compute_run(void *user_context,
     halide_assert(user_context, function);
 
     // prepare buffer resource binding:
-    d3d12_binder *binder = new_descriptor_binder(device);
-    d3d12_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(d3d12_context.device, function);
-    if (pipeline_state == 0) {
-        d3d12_halt("D3D12Compute: Could not allocate pipeline state.");
-        release_object(function);
-        return -1;
+    d3d12_binder *binder = acquire_descriptor_binder(device);
+    if (function->pipelineState == NULL) {
+        d3d12_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(d3d12_context.device, function);
+        if (pipeline_state == 0) {
+            d3d12_halt("D3D12Compute: Could not allocate pipeline state.");
+            release_object(binder);
+            return -1;
+        }
+        function->pipelineState = (*pipeline_state);
     }
+    d3d12_compute_pipeline_state *pipeline_state = reinterpret_cast<d3d12_compute_pipeline_state*>(function->pipelineState);
     set_compute_pipeline_state(cmdList, pipeline_state, function, binder);
 
     // pack all non-buffer arguments into a single "constant" allocation block:
@@ -2493,7 +2597,7 @@ WEAK int halide_d3d12compute_run(void *user_context,
         args_buffer = new_constant_buffer(d3d12_context.device, constant_buffer_size);
         if (!args_buffer) {
             d3d12_halt("D3D12Compute: Could not allocate arguments buffer.");
-            release_object(function);
+            binder_pool[binder_pool_size++] = binder;
             return -1;
         }
         uint8_t *args_ptr = (uint8_t*)buffer_contents(&args_buffer);
@@ -2583,9 +2687,15 @@ WEAK int halide_d3d12compute_run(void *user_context,
         compute_barrier(cmdList, buffer);
     }
 
-    commit_command_list(cmdList);
+    // keep the dispatch resources alive until the batch completes:
+    batch.args_buffers[batch.num_dispatches] = args_buffer;
+    batch.binders[batch.num_dispatches] = binder;
+    batch.num_dispatches++;
 
-    wait_until_completed(cmdList);
+    #if HALIDE_D3D12_PROFILING
+    // the timestamps are only available once the dispatch completes:
+    flush_batch();
+    #endif
 
     #if HALIDE_D3D12_RENDERDOC
     FinishCapturingGPUActivity();
@@ -2600,12 +2710,6 @@ WEAK int halide_d3d12compute_run(void *user_context,
     release_object(profiler);
     #endif
 
-    release_object(cmdList);
-    release_object(command_allocator);
-    release_object(&args_buffer);
-    release_object(pipeline_state);
-    release_object(binder);
-
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
     debug(user_context) << TRACEINDENT << "Time for halide_d3d12compute_device_run: " << (t_after - t_before) / 1.0e6 << " ms\n";
@@ -2766,6 +2870,15 @@ WEAK int halide_d3d12compute_detach_buffer(void *user_context, struct halide_buf
         return 0;
     }
 
+    // the resource may still be in use by batched dispatches:
+    if (batch.cmdList != NULL) {
+        D3D12ContextHolder d3d12_context(user_context, true);
+        if (d3d12_context.error != 0) {
+            return d3d12_context.error;
+        }
+        flush_batch();
+    }
+
     d3d12_buffer *dbuffer = reinterpret_cast<d3d12_buffer*>(buf->device);
     unwrap_buffer(buf);
 
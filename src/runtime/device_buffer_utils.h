@@ -4,6 +4,7 @@
 #include "HalideRuntime.h"
 #include "device_interface.h"
 #include "printer.h"
+#include "scoped_mutex_lock.h"
 
 namespace Halide { namespace Runtime { namespace Internal {
 
@@ -44,6 +45,72 @@ struct device_copy {
 };
 
 
+// Copy a 2D array of elements of type T, where the innermost
+// dimension of the copy may have any stride in the source. When the
+// source is transposed relative to the destination, walk it in tiles
+// so that both sides stay in cache.
+template<typename T>
+WEAK void copy_elements_2d(uint8_t *dst, const uint8_t *src,
+                           uint64_t extent0, int64_t src_stride0, int64_t dst_stride0,
+                           uint64_t extent1, int64_t src_stride1, int64_t dst_stride1) {
+    const uint64_t tile = (src_stride0 > src_stride1) ? 16 : extent0;
+    for (uint64_t x0 = 0; x0 < extent0; x0 += tile) {
+        uint64_t x1 = min(x0 + tile, extent0);
+        for (uint64_t y = 0; y < extent1; y++) {
+            const uint8_t *s = src + y * src_stride1 + x0 * src_stride0;
+            uint8_t *d = dst + y * dst_stride1 + x0 * dst_stride0;
+            for (uint64_t x = x0; x < x1; x++) {
+                *(T *)d = *(const T *)s;
+                s += src_stride0;
+                d += dst_stride0;
+            }
+        }
+    }
+}
+
+// Try to do the innermost one or two dimensions of a copy of small
+// chunks with typed loads and stores instead of one memcpy per chunk.
+WEAK bool copy_small_chunks(const device_copy &copy, int d, int64_t src_off, int64_t dst_off) {
+    if (d > 1 || copy.chunk_size > 8 || (copy.chunk_size & (copy.chunk_size - 1))) {
+        return false;
+    }
+    uint64_t extent1 = 1;
+    int64_t src_stride1 = 0, dst_stride1 = 0;
+    if (d == 1) {
+        extent1 = copy.extent[1];
+        src_stride1 = copy.src_stride_bytes[1];
+        dst_stride1 = copy.dst_stride_bytes[1];
+    }
+    // The typed accesses must be aligned.
+    uint64_t bits = (copy.src + src_off) | (copy.dst + dst_off) |
+                    copy.src_stride_bytes[0] | copy.dst_stride_bytes[0] |
+                    src_stride1 | dst_stride1;
+    if (bits & (copy.chunk_size - 1)) {
+        return false;
+    }
+    uint8_t *to = (uint8_t *)(copy.dst + dst_off);
+    const uint8_t *from = (const uint8_t *)(copy.src + src_off);
+    switch (copy.chunk_size) {
+    case 1:
+        copy_elements_2d<uint8_t>(to, from, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0],
+                                  extent1, src_stride1, dst_stride1);
+        break;
+    case 2:
+        copy_elements_2d<uint16_t>(to, from, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0],
+                                   extent1, src_stride1, dst_stride1);
+        break;
+    case 4:
+        copy_elements_2d<uint32_t>(to, from, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0],
+                                   extent1, src_stride1, dst_stride1);
+        break;
+    case 8:
+        copy_elements_2d<uint64_t>(to, from, copy.extent[0], copy.src_stride_bytes[0], copy.dst_stride_bytes[0],
+                                   extent1, src_stride1, dst_stride1);
+        break;
+    }
+    return true;
+}
+
 WEAK void copy_memory_helper(const device_copy &copy, int d, int64_t src_off, int64_t dst_off) {
     // Skip size-1 dimensions
     while (d >= 0 && copy.extent[d] == 1) d--;
@@ -52,6 +119,8 @@ WEAK void copy_memory_helper(const device_copy &copy, int d, int64_t src_off, in
         const void *from = (void *)(copy.src + src_off);
         void *to = (void *)(copy.dst + dst_off);
         memcpy(to, from, copy.chunk_size);
+    } else if (copy_small_chunks(copy, d, src_off, dst_off)) {
+        // Done
     } else {
         for (uint64_t i = 0; i < copy.extent[d]; i++) {
             copy_memory_helper(copy, d - 1, src_off, dst_off);
@@ -70,6 +139,38 @@ WEAK void copy_memory(const device_copy &copy, void *user_context) {
     }
 }
 
+struct parallel_copy_closure {
+    const device_copy *copy;
+    int d;
+};
+
+WEAK int parallel_copy_task(void *user_context, int i, uint8_t *closure) {
+    const parallel_copy_closure *c = (const parallel_copy_closure *)closure;
+    const device_copy &copy = *c->copy;
+    copy_memory_helper(copy, c->d - 1,
+                       copy.src_begin + i * copy.src_stride_bytes[c->d],
+                       i * copy.dst_stride_bytes[c->d]);
+    return 0;
+}
+
+// Like copy_memory, but splits large copies across the thread pool
+// along their outermost dimension. Only valid when both sides are in
+// host memory.
+WEAK void copy_memory_parallel(const device_copy &copy, void *user_context) {
+    int d = MAX_COPY_DIMS - 1;
+    while (d >= 0 && copy.extent[d] == 1) d--;
+    uint64_t bytes = copy.chunk_size;
+    for (int i = 0; i <= d; i++) {
+        bytes *= copy.extent[i];
+    }
+    if (copy.src == copy.dst || d < 1 || bytes < (1 << 20)) {
+        copy_memory(copy, user_context);
+        return;
+    }
+    parallel_copy_closure closure = {&copy, d};
+    halide_do_par_for(user_context, parallel_copy_task, 0, (int)copy.extent[d], (uint8_t *)&closure);
+}
+
 // Fills the entire dst buffer, which must be contained within src
 WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
                                   const halide_buffer_t *dst, bool dst_host) {
@@ -186,6 +287,63 @@ int64_t calc_device_slice_byte_offset(const struct halide_buffer_t *src, int sli
     return offset;
 }
 
+// Crops and slices of device buffers usually only need a small
+// backend handle naming the parent allocation plus an offset. Code
+// that crops per tile makes and releases these constantly, so rather
+// than going to malloc each time, the backends recycle them through a
+// crop_handle_pool. Handles beyond the pool size go back to free.
+#define MAX_POOLED_CROP_HANDLES 64
+template<typename T>
+struct crop_handle_pool {
+    halide_mutex lock;
+    int count;
+    T *handles[MAX_POOLED_CROP_HANDLES];
+};
+
+// Returns an uninitialized handle, or NULL if we're out of memory.
+template<typename T>
+WEAK T *get_crop_handle(crop_handle_pool<T> &pool) {
+    {
+        ScopedMutexLock lock(&pool.lock);
+        if (pool.count > 0) {
+            return pool.handles[--pool.count];
+        }
+    }
+    return (T *)malloc(sizeof(T));
+}
+
+template<typename T>
+WEAK void put_crop_handle(crop_handle_pool<T> &pool, T *handle) {
+    {
+        ScopedMutexLock lock(&pool.lock);
+        if (pool.count < MAX_POOLED_CROP_HANDLES) {
+            pool.handles[pool.count++] = handle;
+            return;
+        }
+    }
+    free(handle);
+}
+
+// Frees the pooled handles. Handles still in use by crops are
+// unaffected.
+template<typename T>
+WEAK void release_crop_handles(crop_handle_pool<T> &pool) {
+    ScopedMutexLock lock(&pool.lock);
+    while (pool.count > 0) {
+        free(pool.handles[--pool.count]);
+    }
+}
+
+// The profiler func id to bill device work issued now to, or -1 if
+// no profiled pipeline is running. Device runtimes only time their
+// kernels and copies, which means waiting for them to finish, if this
+// is non-negative.
+inline __attribute__((always_inline))
+int profiled_device_func() {
+    halide_profiler_state *s = halide_profiler_get_state();
+    return s->pipelines != NULL ? s->current_func : -1;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 #endif // HALIDE_DEVICE_BUFFER_UTILS_H
@@ -587,6 +587,33 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
                         << " interface " << dst_device_interface << "\n"
                         << " dst " << *dst << "\n";
 
+    // A copy between two host buffers only needs the lock while it
+    // inspects the buffers. The copy itself may be split across the
+    // thread pool, and this thread may run other tasks while it waits,
+    // some of which may call halide_buffer_copy themselves, so it is
+    // done after the lock is released.
+    if (dst_device_interface == NULL) {
+        bool host_to_host = false;
+        device_copy c;
+        {
+            ScopedMutexLock lock(&device_copy_mutex);
+            host_to_host = dst->device_interface == NULL &&
+                           dst->host != NULL && src->host != NULL &&
+                           (!src->device_dirty() || src->device_interface == NULL);
+            if (host_to_host) {
+                c = make_buffer_copy(src, true, dst, true);
+                if (dst != src) {
+                    dst->set_host_dirty(true);
+                    dst->set_device_dirty(false);
+                }
+            }
+        }
+        if (host_to_host) {
+            copy_memory_parallel(c, user_context);
+            return 0;
+        }
+    }
+
     ScopedMutexLock lock(&device_copy_mutex);
 
     if (dst_device_interface) {
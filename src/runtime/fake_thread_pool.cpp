@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 
 extern "C" {
 
@@ -25,6 +26,11 @@ namespace Halide { namespace Runtime { namespace Internal {
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
 
+// Without a thread pool, everything runs on the calling thread.
+WEAK uintptr_t halide_current_thread_id() {
+    return 0;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -51,6 +57,58 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK int halide_set_work_stealing(int enable) {
+    return 0;
+}
+
+WEAK int halide_set_numa_aware(int enable) {
+    return 0;
+}
+
+WEAK int halide_set_worker_spin_count(int spin_count) {
+    return 0;
+}
+
+WEAK int halide_do_parallel_tasks(void *user_context, halide_task_t f,
+                                  int min, int size, uint8_t *closure) {
+    // We can't run the tasks concurrently, so run them in order and
+    // hope that none of them block on a later one. If they do,
+    // halide_semaphore_acquire will report an error rather than hang.
+    for (int x = min; x < min + size; x++) {
+        int result = halide_do_task(user_context, f, x, closure);
+        if (result) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+WEAK int halide_semaphore_init(halide_semaphore_t *s, int n) {
+    s->_private[0] = n;
+    return 0;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *s, int n) {
+    s->_private[0] += n;
+    return 0;
+}
+
+WEAK bool halide_semaphore_try_acquire(halide_semaphore_t *s, int n) {
+    if ((int64_t)s->_private[0] >= n) {
+        s->_private[0] -= n;
+        return true;
+    }
+    return false;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *s, int n) {
+    if (!halide_semaphore_try_acquire(s, n)) {
+        halide_error(NULL, "halide_semaphore_acquire would deadlock without a thread pool.\n");
+        return -1;
+    }
+    return 0;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
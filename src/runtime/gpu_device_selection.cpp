@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 #include "scoped_spin_lock.h"
 
 // Runtime settings for opencl and cuda device selection
@@ -8,6 +9,20 @@ WEAK int halide_gpu_device = 0;
 WEAK int halide_gpu_device_lock = 0;
 WEAK bool halide_gpu_device_initialized = false;
 
+// Per-thread device overrides, used by loops distributed across
+// several GPUs. There are at most as many entries in use as there are
+// threads running such loops at once.
+#define MAX_THREAD_GPU_DEVICES 256
+
+struct thread_gpu_device {
+    uintptr_t thread;
+    int device;
+};
+
+WEAK thread_gpu_device thread_gpu_devices[MAX_THREAD_GPU_DEVICES];
+WEAK int thread_gpu_devices_used = 0;
+WEAK int thread_gpu_devices_lock = 0;
+
 }}} // namespace Halide::Runtime::Internal
 
 extern int atoi(const char *);
@@ -19,7 +34,58 @@ WEAK void halide_set_gpu_device(int d) {
     halide_gpu_device = d;
     halide_gpu_device_initialized = true;
 }
+
+WEAK int halide_get_thread_gpu_device(void *user_context) {
+    // Most programs never set an override, so skip the lock.
+    if (thread_gpu_devices_used == 0) {
+        return -1;
+    }
+    uintptr_t thread = halide_current_thread_id();
+    ScopedSpinLock lock(&thread_gpu_devices_lock);
+    for (int i = 0; i < thread_gpu_devices_used; i++) {
+        if (thread_gpu_devices[i].thread == thread) {
+            return thread_gpu_devices[i].device;
+        }
+    }
+    return -1;
+}
+
+WEAK int halide_set_thread_gpu_device(void *user_context, int d) {
+    uintptr_t thread = halide_current_thread_id();
+    ScopedSpinLock lock(&thread_gpu_devices_lock);
+    int i = 0;
+    while (i < thread_gpu_devices_used && thread_gpu_devices[i].thread != thread) {
+        i++;
+    }
+    int old = (i < thread_gpu_devices_used) ? thread_gpu_devices[i].device : -1;
+    if (d < 0) {
+        // Clearing the override frees the entry.
+        if (i < thread_gpu_devices_used) {
+            thread_gpu_devices[i] = thread_gpu_devices[--thread_gpu_devices_used];
+        }
+    } else if (i < thread_gpu_devices_used) {
+        thread_gpu_devices[i].device = d;
+    } else if (i < MAX_THREAD_GPU_DEVICES) {
+        thread_gpu_devices[i].thread = thread;
+        thread_gpu_devices[i].device = d;
+        thread_gpu_devices_used++;
+    } else {
+        halide_error(user_context, "Too many threads have a gpu device set\n");
+    }
+    return old;
+}
+
+WEAK void halide_set_thread_gpu_device_as_destructor(void *user_context, void *obj) {
+    // The device to go back to is stored in the object, offset by two
+    // so that -1 still makes a non-null object.
+    halide_set_thread_gpu_device(user_context, (int)((intptr_t)obj) - 2);
+}
+
 WEAK int halide_get_gpu_device(void *user_context) {
+    int d = halide_get_thread_gpu_device(user_context);
+    if (d >= 0) {
+        return d;
+    }
     ScopedSpinLock lock(&halide_gpu_device_lock);
     if (!halide_gpu_device_initialized) {
         const char *var = getenv("HL_GPU_DEVICE");
@@ -0,0 +1,136 @@
+#ifndef HALIDE_RUNTIME_GPU_KERNEL_CACHE_H
+#define HALIDE_RUNTIME_GPU_KERNEL_CACHE_H
+
+#include "runtime_internal.h"
+#include "printer.h"
+
+// An optional on-disk cache of driver-compiled GPU kernels, shared by
+// the GPU runtimes. It is enabled by setting the environment variable
+// HL_GPU_KERNEL_CACHE_DIR to an existing directory. Entries are keyed
+// by a hash of everything that affects the compiled binary: the
+// kernel source, the compile options, and the device and driver. The
+// contents are checksummed, so a truncated or partially written file
+// is treated as a miss.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+struct KernelCacheKey {
+    uint64_t hash;
+
+    KernelCacheKey() : hash(14695981039346656037ULL) {}
+
+    void add(const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        // Separate consecutive fields.
+        hash = (hash ^ 0xff) * 1099511628211ULL;
+    }
+
+    void add(const char *str) {
+        add(str, strlen(str));
+    }
+};
+
+struct KernelCacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+WEAK const char *kernel_cache_dir() {
+    const char *dir = getenv("HL_GPU_KERNEL_CACHE_DIR");
+    return (dir && dir[0]) ? dir : NULL;
+}
+
+WEAK uint64_t kernel_cache_checksum(const void *data, size_t size) {
+    KernelCacheKey k;
+    k.add(data, size);
+    return k.hash;
+}
+
+WEAK void kernel_cache_init_header(KernelCacheHeader *header, uint64_t key,
+                                   const void *data, size_t size) {
+    memcpy(header->magic, "HLKCACHE", 8);
+    header->key = key;
+    header->size = size;
+    header->checksum = kernel_cache_checksum(data, size);
+}
+
+// Look up a cached binary. Returns a buffer allocated with malloc
+// that the caller must free, or NULL on a miss.
+WEAK uint8_t *kernel_cache_load(void *user_context, const char *api,
+                                const KernelCacheKey &key, size_t *size) {
+    const char *dir = kernel_cache_dir();
+    if (!dir) {
+        return NULL;
+    }
+    stringstream path(user_context);
+    path << dir << "/" << api << "_" << key.hash << ".bin";
+
+    void *f = fopen(path.str(), "rb");
+    if (!f) {
+        debug(user_context) << "    Kernel cache miss: " << path.str() << "\n";
+        return NULL;
+    }
+
+    KernelCacheHeader header;
+    uint8_t *data = NULL;
+    bool ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+               memcmp(header.magic, "HLKCACHE", 8) == 0 &&
+               header.key == key.hash &&
+               header.size > 0);
+    if (ok) {
+        data = (uint8_t *)malloc(header.size);
+        ok = (data &&
+              fread(data, header.size, 1, f) == 1 &&
+              kernel_cache_checksum(data, header.size) == header.checksum);
+    }
+    fclose(f);
+
+    if (!ok) {
+        debug(user_context) << "    Ignoring invalid kernel cache entry: " << path.str() << "\n";
+        free(data);
+        return NULL;
+    }
+
+    debug(user_context) << "    Kernel cache hit: " << path.str() << "\n";
+    *size = header.size;
+    return data;
+}
+
+// Store a binary in the cache. Failures are silently ignored.
+WEAK void kernel_cache_store(void *user_context, const char *api,
+                             const KernelCacheKey &key, const void *data, size_t size) {
+    const char *dir = kernel_cache_dir();
+    if (!dir || size == 0) {
+        return;
+    }
+    stringstream path(user_context), tmp_path(user_context);
+    path << dir << "/" << api << "_" << key.hash << ".bin";
+    // Write to a temporary file and move it into place, so that
+    // concurrent readers never see a partial entry.
+    tmp_path << path.str() << "." << (uint64_t)(uintptr_t)&size << ".tmp";
+
+    void *f = fopen(tmp_path.str(), "wb");
+    if (!f) {
+        debug(user_context) << "    Could not write kernel cache entry: " << tmp_path.str() << "\n";
+        return;
+    }
+    KernelCacheHeader header;
+    kernel_cache_init_header(&header, key.hash, data, size);
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+               fwrite(data, size, 1, f) == 1);
+    fclose(f);
+    if (!ok || rename(tmp_path.str(), path.str()) != 0) {
+        remove(tmp_path.str());
+        return;
+    }
+    debug(user_context) << "    Stored kernel cache entry: " << path.str() << "\n";
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+#endif
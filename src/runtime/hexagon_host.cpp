@@ -12,6 +12,9 @@ struct ion_device_handle {
     size_t size;
 };
 
+// Recycled ion_device_handles for crops and slices.
+WEAK crop_handle_pool<ion_device_handle> crop_handles;
+
 WEAK halide_mutex thread_lock = { { 0 } };
 
 extern WEAK halide_device_interface_t hexagon_device_interface;
@@ -39,6 +42,7 @@ typedef int (*remote_power_perf_fn)(int, unsigned int, unsigned int, int, unsign
 typedef void (*host_malloc_init_fn)();
 typedef void *(*host_malloc_fn)(size_t);
 typedef void (*host_free_fn)(void *);
+typedef int (*host_session_fn)();
 
 WEAK remote_load_library_fn remote_load_library = NULL;
 WEAK remote_get_symbol_fn remote_get_symbol = NULL;
@@ -55,6 +59,8 @@ WEAK host_malloc_init_fn host_malloc_init = NULL;
 WEAK host_malloc_init_fn host_malloc_deinit = NULL;
 WEAK host_malloc_fn host_malloc = NULL;
 WEAK host_free_fn host_free = NULL;
+WEAK host_session_fn host_start_session = NULL;
+WEAK host_session_fn host_end_session = NULL;
 
 // This checks if there are any log messages available on the remote
 // side. It should be called after every remote call.
@@ -149,6 +155,10 @@ WEAK int init_hexagon_runtime(void *user_context) {
     get_symbol(user_context, host_lib, "halide_hexagon_remote_set_performance", remote_set_performance, /* required */ false);
     get_symbol(user_context, host_lib, "halide_hexagon_remote_set_performance_mode", remote_set_performance_mode, /* required */ false);
 
+    // Sessions are only supported by newer versions of the host library.
+    get_symbol(user_context, host_lib, "halide_hexagon_host_start_session", host_start_session, /* required */ false);
+    get_symbol(user_context, host_lib, "halide_hexagon_host_end_session", host_end_session, /* required */ false);
+
     host_malloc_init();
 
     return 0;
@@ -165,6 +175,102 @@ struct module_state {
 WEAK module_state *state_list = NULL;
 WEAK halide_hexagon_handle_t shared_runtime = 0;
 
+// Unless the application manages Hexagon power itself, we vote for
+// HVX power and a high performance mode while pipelines run, so that
+// pipelines don't run at whatever clocks the DSP happens to be
+// idling at. The vote is kept until no pipeline has run for
+// auto_power_idle_ms, so that a stream of calls (e.g. one per video
+// frame) doesn't pay to change the clocks every time. A watcher
+// thread drops the vote once the DSP has been idle long enough.
+// All of this state is protected by auto_power_lock.
+WEAK halide_mutex auto_power_lock = { { 0 } };
+// Cleared the first time the application calls one of the power
+// management functions.
+WEAK bool auto_power_enabled = true;
+WEAK halide_hexagon_power_mode_t auto_power_mode = halide_hexagon_power_turbo;
+WEAK int auto_power_idle_ms = 100;
+WEAK int auto_power_active_runs = 0;
+WEAK bool auto_power_voted = false;
+WEAK int64_t auto_power_last_use_ns = 0;
+WEAK halide_thread *auto_power_watcher = NULL;
+WEAK bool auto_power_watcher_running = false;
+
+// Must be called with auto_power_lock held.
+WEAK void auto_power_drop_vote(void *user_context, bool reset_mode) {
+    if (!auto_power_voted) {
+        return;
+    }
+    debug(user_context) << "Hexagon: dropping automatic power vote\n";
+    if (reset_mode && remote_set_performance_mode) {
+        remote_set_performance_mode(halide_hexagon_power_default);
+    }
+    if (remote_power_hvx_off) {
+        remote_power_hvx_off();
+    }
+    auto_power_voted = false;
+}
+
+WEAK void auto_power_watch(void *) {
+    while (true) {
+        halide_sleep_ms(NULL, auto_power_idle_ms);
+        ScopedMutexLock lock(&auto_power_lock);
+        if (!auto_power_voted) {
+            auto_power_watcher_running = false;
+            return;
+        }
+        int64_t idle_ns = halide_current_time_ns(NULL) - auto_power_last_use_ns;
+        if (auto_power_active_runs == 0 && idle_ns >= (int64_t)auto_power_idle_ms * 1000000) {
+            auto_power_drop_vote(NULL, true);
+            auto_power_watcher_running = false;
+            return;
+        }
+    }
+}
+
+// Called at the start of every pipeline run on Hexagon. Returns true
+// if the run was counted, in which case auto_power_end_run must be
+// called when it is done.
+WEAK bool auto_power_begin_run(void *user_context) {
+    ScopedMutexLock lock(&auto_power_lock);
+    if (!auto_power_enabled) {
+        return false;
+    }
+    auto_power_active_runs++;
+    if (!auto_power_voted) {
+        debug(user_context) << "Hexagon: voting for power mode " << auto_power_mode << "\n";
+        if (remote_power_hvx_on) {
+            remote_power_hvx_on();
+        }
+        if (remote_set_performance_mode) {
+            remote_set_performance_mode(auto_power_mode);
+        }
+        auto_power_voted = true;
+    }
+    if (!auto_power_watcher_running) {
+        // A previous watcher has finished with the state, and is at
+        // most about to return, so this doesn't wait on the lock.
+        if (auto_power_watcher) {
+            halide_join_thread(auto_power_watcher);
+        }
+        auto_power_watcher_running = true;
+        auto_power_watcher = halide_spawn_thread(auto_power_watch, NULL);
+    }
+    return true;
+}
+
+WEAK void auto_power_end_run(void *user_context) {
+    ScopedMutexLock lock(&auto_power_lock);
+    auto_power_active_runs--;
+    auto_power_last_use_ns = halide_current_time_ns(user_context);
+}
+
+// Called when the application takes over power management.
+WEAK void auto_power_disable(void *user_context, bool reset_mode) {
+    ScopedMutexLock lock(&auto_power_lock);
+    auto_power_enabled = false;
+    auto_power_drop_vote(user_context, reset_mode);
+}
+
 }}}}  // namespace Halide::Runtime::Internal::Hexagon
 
 using namespace Halide::Runtime::Internal;
@@ -367,11 +473,15 @@ WEAK int halide_hexagon_run(void *user_context,
     }
 
     // Call the pipeline on the device side.
+    bool counted_run = auto_power_begin_run(user_context);
     debug(user_context) << "    halide_hexagon_remote_run -> ";
     result = remote_run(module, *function,
                         input_buffers, input_buffer_count,
                         output_buffers, output_buffer_count,
                         input_scalars, input_scalar_count);
+    if (counted_run) {
+        auto_power_end_run(user_context);
+    }
     poll_log(user_context);
     debug(user_context) << "        " << result << "\n";
     if (result != 0) {
@@ -393,8 +503,28 @@ WEAK int halide_hexagon_device_release(void *user_context) {
     debug(user_context)
         << "Hexagon: halide_hexagon_device_release (user_context: " <<  user_context << ")\n";
 
+    // Drop any automatic power vote, and wait for the watcher to
+    // notice. It must not be holding the lock while we join it.
+    {
+        ScopedMutexLock lock(&auto_power_lock);
+        auto_power_drop_vote(user_context, true);
+    }
+    if (auto_power_watcher) {
+        halide_join_thread(auto_power_watcher);
+        auto_power_watcher = NULL;
+    }
+
     ScopedMutexLock lock(&thread_lock);
 
+    // The session runs pipelines from these modules, so it can't
+    // outlive them.
+    if (host_end_session) {
+        debug(user_context) << "    halide_hexagon_host_end_session -> ";
+        int result = host_end_session();
+        poll_log(user_context);
+        debug(user_context) << "        " << result << "\n";
+    }
+
     // Release all of the remote side modules.
     module_state *state = state_list;
     while (state) {
@@ -419,6 +549,8 @@ WEAK int halide_hexagon_device_release(void *user_context) {
         shared_runtime = 0;
     }
 
+    release_crop_handles(crop_handles);
+
     return 0;
 }
 
@@ -720,7 +852,7 @@ namespace {
 
 WEAK int hexagon_device_crop_from_offset(const struct halide_buffer_t *src, int64_t offset, struct halide_buffer_t *dst) {
     ion_device_handle *src_handle = (ion_device_handle *)src->device;
-    ion_device_handle *dst_handle = (ion_device_handle *)malloc(sizeof(ion_device_handle));
+    ion_device_handle *dst_handle = get_crop_handle(crop_handles);
     if (!dst_handle) {
         return halide_error_code_out_of_memory;
     }
@@ -753,7 +885,7 @@ WEAK int halide_hexagon_device_slice(void *user_context, const struct halide_buf
 
 WEAK int halide_hexagon_device_release_crop(void *user_context, struct halide_buffer_t *dst) {
     debug(user_context) << "halide_hexagon_release_crop called\n";
-    free((ion_device_handle *)dst->device);
+    put_crop_handle(crop_handles, (ion_device_handle *)dst->device);
     return 0;
 }
 
@@ -762,6 +894,7 @@ WEAK int halide_hexagon_power_hvx_on(void *user_context) {
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_power_hvx_on\n";
+    auto_power_disable(user_context, true);
     if (!remote_power_hvx_on) {
         // The function is not available in this version of the
         // runtime, this runtime always powers HVX on.
@@ -793,6 +926,7 @@ WEAK int halide_hexagon_power_hvx_off(void *user_context) {
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_power_hvx_off\n";
+    auto_power_disable(user_context, true);
     if (!remote_power_hvx_off) {
         // The function is not available in this version of the
         // runtime, this runtime always powers HVX on.
@@ -823,11 +957,55 @@ WEAK void halide_hexagon_power_hvx_off_as_destructor(void *user_context, void *
     halide_hexagon_power_hvx_off(user_context);
 }
 
+WEAK int halide_hexagon_start_session(void *user_context) {
+    int result = init_hexagon_runtime(user_context);
+    if (result != 0) return result;
+
+    debug(user_context) << "halide_hexagon_start_session\n";
+    if (!host_start_session) {
+        // Sessions are not available in this version of the runtime,
+        // pipelines will be run with an RPC call each.
+        return 0;
+    }
+
+    debug(user_context) << "    host_start_session -> ";
+    result = host_start_session();
+    debug(user_context) << "        " << result << "\n";
+    if (result != 0) {
+        error(user_context) << "host_start_session failed.\n";
+        return result;
+    }
+
+    return 0;
+}
+
+WEAK int halide_hexagon_end_session(void *user_context) {
+    int result = init_hexagon_runtime(user_context);
+    if (result != 0) return result;
+
+    debug(user_context) << "halide_hexagon_end_session\n";
+    if (!host_end_session) {
+        return 0;
+    }
+
+    debug(user_context) << "    host_end_session -> ";
+    result = host_end_session();
+    poll_log(user_context);
+    debug(user_context) << "        " << result << "\n";
+    if (result != 0) {
+        error(user_context) << "host_end_session failed.\n";
+        return result;
+    }
+
+    return 0;
+}
+
 WEAK int halide_hexagon_set_performance_mode(void *user_context, halide_hexagon_power_mode_t mode) {
     int result = init_hexagon_runtime(user_context);
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_set_performance_mode\n";
+    auto_power_disable(user_context, false);
     if (!remote_set_performance_mode) {
         // This runtime doesn't support changing the performance target.
         return 0;
@@ -849,6 +1027,7 @@ WEAK int halide_hexagon_set_performance(void *user_context, halide_hexagon_power
     if (result != 0) return result;
 
     debug(user_context) << "halide_hexagon_set_performance\n";
+    auto_power_disable(user_context, false);
     if (!remote_set_performance) {
         // This runtime doesn't support changing the performance target.
         return 0;
@@ -873,6 +1052,25 @@ WEAK int halide_hexagon_set_performance(void *user_context, halide_hexagon_power
     return 0;
 }
 
+WEAK int halide_hexagon_set_auto_power(void *user_context, bool enabled,
+                                       halide_hexagon_power_mode_t mode, int idle_timeout_ms) {
+    debug(user_context) << "halide_hexagon_set_auto_power(" << enabled << ", "
+                        << mode << ", " << idle_timeout_ms << ")\n";
+    if (idle_timeout_ms < 1) {
+        error(user_context) << "halide_hexagon_set_auto_power: idle_timeout_ms must be positive.\n";
+        return -1;
+    }
+    ScopedMutexLock lock(&auto_power_lock);
+    if (auto_power_voted && (!enabled || mode != auto_power_mode)) {
+        // Vote again with the new mode on the next run.
+        auto_power_drop_vote(user_context, true);
+    }
+    auto_power_enabled = enabled;
+    auto_power_mode = mode;
+    auto_power_idle_ms = idle_timeout_ms;
+    return 0;
+}
+
 WEAK const halide_device_interface_t *halide_hexagon_device_interface() {
     return &hexagon_device_interface;
 }
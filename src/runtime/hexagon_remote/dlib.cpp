@@ -69,12 +69,21 @@ struct Sym {
     uint8_t st_info;
     uint8_t st_other;
     uint16_t st_shndx;
+
+    uint8_t st_bind() const { return st_info >> 4; }
 };
 
 enum {
     STN_UNDEF = 0,
 };
 
+// Symbol bindings.
+enum {
+    STB_LOCAL = 0,
+    STB_GLOBAL = 1,
+    STB_WEAK = 2,
+};
+
 // Hexagon shared object relocation types.
 enum {
     R_HEX_COPY = 32,
@@ -203,7 +212,12 @@ struct dlib_t {
         return assert_in_bounds(x, x + count);
     }
 
-    bool do_relocations(const Rela *relocs, int count) {
+    // Resolving an external symbol means asking the system dlsym
+    // (twice) and then walking the other loaded libraries. Most
+    // external symbols are referenced by several relocations, so we
+    // remember each one we resolve, indexed by symbol. resolved may be
+    // NULL, in which case nothing is remembered.
+    bool do_relocations(const Rela *relocs, int count, const char **resolved, uint32_t symbol_count) {
         for (int i = 0; i < count; i++) {
             const Rela &r = relocs[i];
             uint32_t *fixup_addr = (uint32_t *)(base_vaddr + r.r_offset);
@@ -222,16 +236,25 @@ struct dlib_t {
                         log_printf("Symbol name not defined");
                         return false;
                     }
-                    S = (const char *)halide_get_symbol(sym_name);
-                    for (dlib_t *i = loaded_libs; i && !S; i = i->next) {
-                        // TODO: We really should only look in
-                        // libraries with an soname that is marked
-                        // DT_NEEDED in this library.
-                        S = (const char *)mmap_dlsym(i, sym_name);
+                    const bool remember = resolved && r.r_sym() < symbol_count;
+                    if (remember) {
+                        S = resolved[r.r_sym()];
                     }
                     if (!S) {
-                        log_printf("Unresolved external symbol %s\n", sym_name);
-                        return false;
+                        S = (const char *)halide_get_symbol(sym_name);
+                        for (dlib_t *i = loaded_libs; i && !S; i = i->next) {
+                            // TODO: We really should only look in
+                            // libraries with an soname that is marked
+                            // DT_NEEDED in this library.
+                            S = (const char *)mmap_dlsym(i, sym_name);
+                        }
+                        if (!S && sym->st_bind() != STB_WEAK) {
+                            log_printf("Unresolved external symbol %s\n", sym_name);
+                            return false;
+                        }
+                        if (remember) {
+                            resolved[r.r_sym()] = S;
+                        }
                     }
                 } else {
                     S = base_vaddr + sym->st_value;
@@ -332,17 +355,23 @@ struct dlib_t {
             return false;
         }
 
+        // The hash table's chain count is the number of entries in
+        // the symbol table. If we can't get memory to remember the
+        // resolved symbols in, we just resolve them every time.
+        uint32_t symbol_count = hash.chain_count();
+        const char **resolved = (const char **)malloc(symbol_count * sizeof(const char *));
+        if (resolved) {
+            memset(resolved, 0, symbol_count * sizeof(const char *));
+        }
+        bool success = true;
         if (jmprel && jmprel_count > 0) {
-            if (!do_relocations(jmprel, jmprel_count)) {
-                return false;
-            }
+            success = do_relocations(jmprel, jmprel_count, resolved, symbol_count);
         }
-        if (rel && rel_count > 0) {
-            if (!do_relocations(rel, rel_count)) {
-                return false;
-            }
+        if (success && rel && rel_count > 0) {
+            success = do_relocations(rel, rel_count, resolved, symbol_count);
         }
-        return true;
+        free(resolved);
+        return success;
     }
 
     bool parse(const char *data, size_t size) {
@@ -16,6 +16,7 @@ extern "C" {
 #include "pipeline_context.h"
 #include "log.h"
 #include "known_symbols.h"
+#include "session.h"
 
 const int stack_alignment = 128;
 const int stack_size = 1024 * 1024;
@@ -79,9 +80,45 @@ static bool use_dlopenbuf() {
     return dlopenbuf != NULL;
 }
 
+// Libraries we have loaded, by the contents of their code. Apps with
+// many Halide modules often load the same code more than once (e.g. the
+// same pipeline compiled into several modules, or a module released
+// and initialized again), and each load costs a copy of the code and a
+// full pass of relocations. Instead we share the loaded library, and
+// only unload it when every module using it has been released. This is
+// only touched from the host's halide_hexagon_initialize_kernels and
+// halide_hexagon_device_release, which hold a lock around their calls
+// to us.
+struct loaded_library {
+    uint32_t hash;
+    int size;
+    int ref_count;
+    void *lib;
+    loaded_library *next;
+};
+loaded_library *loaded_libraries = NULL;
+
+static uint32_t code_hash(const unsigned char *code, int size) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        h = (h ^ code[i]) * 16777619u;
+    }
+    return h;
+}
+
 int halide_hexagon_remote_load_library(const char *soname, int sonameLen,
                                        const unsigned char *code, int codeLen,
                                        handle_t *module_ptr) {
+    uint32_t hash = code_hash(code, codeLen);
+    for (loaded_library *l = loaded_libraries; l; l = l->next) {
+        if (l->hash == hash && l->size == codeLen) {
+            l->ref_count++;
+            *module_ptr = reinterpret_cast<handle_t>(l->lib);
+            return 0;
+        }
+    }
+
     void *lib = NULL;
     if (use_dlopenbuf()) {
         // We need to use RTLD_NOW, the libraries we build for Hexagon
@@ -99,6 +136,16 @@ int halide_hexagon_remote_load_library(const char *soname, int sonameLen,
         }
     }
 
+    loaded_library *l = (loaded_library *)malloc(sizeof(loaded_library));
+    if (l) {
+        l->hash = hash;
+        l->size = codeLen;
+        l->ref_count = 1;
+        l->lib = lib;
+        l->next = loaded_libraries;
+        loaded_libraries = l;
+    }
+
     *module_ptr = reinterpret_cast<handle_t>(lib);
 
     return 0;
@@ -320,13 +367,11 @@ int halide_hexagon_remote_get_symbol_v4(handle_t module_ptr, const char* name, i
     return *sym_ptr != 0 ? 0 : -1;
 }
 
-int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
-                                 const buffer *input_buffersPtrs, int input_buffersLen,
-                                 buffer *output_buffersPtrs, int output_buffersLen,
-                                 const scalar_t *scalars, int scalarsLen) {
-    // Get a pointer to the argv version of the pipeline.
-    pipeline_argv_t pipeline = reinterpret_cast<pipeline_argv_t>(function);
-
+// Run a pipeline with the given host pointers to the input buffers,
+// followed by the output buffers, and the given scalars.
+static int run_pipeline(pipeline_argv_t pipeline,
+                        uint8_t **buffer_hosts, int buffer_count,
+                        const scalar_t *scalars, int scalarsLen) {
     // Construct a list of arguments. This is only part of a
     // buffer_t. We know that the only field of buffer_t that the
     // generated code should access is the host field (any other
@@ -336,19 +381,14 @@ int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
         uint64_t dev;
         uint8_t* host;
     };
-    void **args = (void **)__builtin_alloca((input_buffersLen + scalarsLen + output_buffersLen) * sizeof(void *));
-    buffer_t *buffers = (buffer_t *)__builtin_alloca((input_buffersLen + output_buffersLen) * sizeof(buffer_t));
+    void **args = (void **)__builtin_alloca((buffer_count + scalarsLen) * sizeof(void *));
+    buffer_t *buffers = (buffer_t *)__builtin_alloca(buffer_count * sizeof(buffer_t));
 
     void **next_arg = &args[0];
     buffer_t *next_buffer_t = &buffers[0];
-    // Input buffers come first.
-    for (int i = 0; i < input_buffersLen; i++, next_arg++, next_buffer_t++) {
-        next_buffer_t->host = input_buffersPtrs[i].data;
-        *next_arg = next_buffer_t;
-    }
-    // Output buffers are next.
-    for (int i = 0; i < output_buffersLen; i++, next_arg++, next_buffer_t++) {
-        next_buffer_t->host = output_buffersPtrs[i].data;
+    // Buffers come first.
+    for (int i = 0; i < buffer_count; i++, next_arg++, next_buffer_t++) {
+        next_buffer_t->host = buffer_hosts[i];
         *next_arg = next_buffer_t;
     }
     // Input scalars are last.
@@ -371,7 +411,109 @@ int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
     return result;
 }
 
+int halide_hexagon_remote_run_v2(handle_t module_ptr, handle_t function,
+                                 const buffer *input_buffersPtrs, int input_buffersLen,
+                                 buffer *output_buffersPtrs, int output_buffersLen,
+                                 const scalar_t *scalars, int scalarsLen) {
+    // Get a pointer to the argv version of the pipeline.
+    pipeline_argv_t pipeline = reinterpret_cast<pipeline_argv_t>(function);
+
+    int buffer_count = input_buffersLen + output_buffersLen;
+    uint8_t **buffer_hosts = (uint8_t **)__builtin_alloca(buffer_count * sizeof(uint8_t *));
+    // Input buffers come first.
+    for (int i = 0; i < input_buffersLen; i++) {
+        buffer_hosts[i] = input_buffersPtrs[i].data;
+    }
+    // Output buffers are next.
+    for (int i = 0; i < output_buffersLen; i++) {
+        buffer_hosts[input_buffersLen + i] = output_buffersPtrs[i].data;
+    }
+
+    return run_pipeline(pipeline, buffer_hosts, buffer_count, scalars, scalarsLen);
+}
+
+int halide_hexagon_remote_run_session(handle_t mailbox_ptr) {
+    session_mailbox *mailbox = reinterpret_cast<session_mailbox *>(mailbox_ptr);
+
+    // Keep HVX powered on for the whole session, so each request
+    // doesn't pay for powering it on and off.
+    int result = halide_hexagon_remote_power_hvx_on();
+    if (result != 0) {
+        return result;
+    }
+
+    uint32_t last_id = mailbox->request_id;
+    int idle_polls = 0;
+    while (true) {
+        // The host writes the mailbox through an uncached mapping,
+        // make sure we don't read a stale copy of it.
+        qurt_mem_cache_clean((qurt_addr_t)mailbox, sizeof(session_mailbox),
+                             QURT_MEM_CACHE_INVALIDATE, QURT_MEM_DCACHE);
+        uint32_t id = mailbox->request_id;
+        if (id == last_id) {
+            // Spin for a while to keep the latency of back to back
+            // requests low, then back off so an idle session doesn't
+            // keep a hardware thread busy.
+            if (++idle_polls > 1000) {
+                qurt_timer_sleep(100);
+            }
+            continue;
+        }
+        idle_polls = 0;
+        last_id = id;
+
+        if (mailbox->command == Session::Stop) {
+            mailbox->result = 0;
+            mailbox->response_id = id;
+            qurt_mem_cache_clean((qurt_addr_t)mailbox, sizeof(session_mailbox),
+                                 QURT_MEM_CACHE_FLUSH, QURT_MEM_DCACHE);
+            break;
+        }
+
+        int buffer_count = mailbox->input_buffer_count + mailbox->output_buffer_count;
+        uint8_t *buffer_hosts[session_max_args];
+        for (int i = 0; i < buffer_count; i++) {
+            buffer_hosts[i] = reinterpret_cast<uint8_t *>(mailbox->buffers[i]);
+            // The buffers are mapped for the whole session, so FastRPC
+            // doesn't do the cache maintenance for us.
+            qurt_mem_cache_clean((qurt_addr_t)buffer_hosts[i], mailbox->buffer_sizes[i],
+                                 QURT_MEM_CACHE_INVALIDATE, QURT_MEM_DCACHE);
+        }
+
+        pipeline_argv_t pipeline = reinterpret_cast<pipeline_argv_t>(mailbox->function);
+        result = run_pipeline(pipeline, buffer_hosts, buffer_count,
+                              mailbox->scalars, mailbox->scalar_count);
+
+        for (int i = mailbox->input_buffer_count; i < buffer_count; i++) {
+            qurt_mem_cache_clean((qurt_addr_t)buffer_hosts[i], mailbox->buffer_sizes[i],
+                                 QURT_MEM_CACHE_FLUSH, QURT_MEM_DCACHE);
+        }
+
+        mailbox->result = result;
+        mailbox->response_id = id;
+        qurt_mem_cache_clean((qurt_addr_t)mailbox, sizeof(session_mailbox),
+                             QURT_MEM_CACHE_FLUSH, QURT_MEM_DCACHE);
+    }
+
+    halide_hexagon_remote_power_hvx_off();
+
+    return 0;
+}
+
 int halide_hexagon_remote_release_library(handle_t module_ptr) {
+    void *lib = reinterpret_cast<void*>(module_ptr);
+    for (loaded_library **l = &loaded_libraries; *l; l = &(*l)->next) {
+        if ((*l)->lib == lib) {
+            if (--(*l)->ref_count > 0) {
+                return 0;
+            }
+            loaded_library *dead = *l;
+            *l = dead->next;
+            free(dead);
+            break;
+        }
+    }
+
     if (use_dlopenbuf()) {
         dlclose(reinterpret_cast<void*>(module_ptr));
     } else {
@@ -1,4 +1,5 @@
 #include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
@@ -43,6 +44,20 @@ struct ion_handle_data {
 #define ION_IOC_FREE _IOWR('I', 1, ion_handle_data)
 #define ION_IOC_MAP _IOWR('I', 2, ion_fd_data)
 
+// ION buffers are dma-bufs, so we can use the dma-buf ioctl to do
+// cache maintenance on buffers that FastRPC isn't managing for us.
+struct dma_buf_sync {
+    uint64_t flags;
+};
+
+enum dma_buf_sync_flags {
+    dma_buf_sync_rw = 3,
+    dma_buf_sync_start = 0,
+    dma_buf_sync_end = 4,
+};
+
+#define DMA_BUF_IOCTL_SYNC _IOW('b', 0, dma_buf_sync)
+
 ion_user_handle_t ion_alloc(int ion_fd, size_t len, size_t align, unsigned int heap_id_mask, unsigned int flags) {
     ion_allocation_data alloc = {
         len,
@@ -84,6 +99,9 @@ struct allocation_record {
     int buf_fd;
     void *buf;
     size_t size;
+    // The address of this buffer on the DSP, if it has been mapped
+    // there with remote_mmap, or 0.
+    uint32_t remote_addr;
 };
 
 // Make a dummy allocation so we don't need a special case for the
@@ -102,6 +120,11 @@ extern "C" {
 // behavior from our buffers.
 __attribute__((weak)) void remote_register_buf(void* buf, int size, int fd);
 
+// These map buffers to the DSP beyond the duration of a single
+// FastRPC call.
+__attribute__((weak)) int remote_mmap(int fd, uint32_t flags, uint32_t vaddrin, int size, uint32_t *vaddrout);
+__attribute__((weak)) int remote_munmap(uint32_t vaddrout, int size);
+
 void halide_hexagon_host_malloc_init() {
     pthread_mutex_init(&allocations_mutex, NULL);
     ion_fd = open("/dev/ion", O_RDONLY, 0);
@@ -116,9 +139,8 @@ void halide_hexagon_host_malloc_deinit() {
     pthread_mutex_destroy(&allocations_mutex);
 }
 
-void *halide_hexagon_host_malloc(size_t size) {
+static void *host_malloc(size_t size, unsigned int ion_flags) {
     const int heap_id = system_heap_id;
-    const int ion_flags = ion_flag_cached;
 
     // Hexagon can only access a small number of mappings of these
     // sizes. We reduce the number of mappings required by aligning
@@ -182,6 +204,7 @@ void *halide_hexagon_host_malloc(size_t size) {
     rec->buf_fd = buf_fd;
     rec->buf = buf;
     rec->size = size;
+    rec->remote_addr = 0;
 
     // Insert this record into the list of allocations. Insert it at
     // the front, since it's simpler, and most likely to be freed
@@ -194,6 +217,73 @@ void *halide_hexagon_host_malloc(size_t size) {
     return buf;
 }
 
+void *halide_hexagon_host_malloc(size_t size) {
+    return host_malloc(size, ion_flag_cached);
+}
+
+// Allocations made with this can be shared with the DSP without any
+// cache maintenance on the host.
+void *halide_hexagon_host_malloc_uncached(size_t size) {
+    return host_malloc(size, 0);
+}
+
+// Get the DSP address of an allocation made by
+// halide_hexagon_host_malloc, mapping it to the DSP if it is not
+// already. The mapping lasts until the allocation is freed. Returns
+// -1 if ptr is not such an allocation, or it can't be mapped.
+int halide_hexagon_host_map_remote(void *ptr, uint32_t *remote_addr) {
+    if (!remote_mmap) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&allocations_mutex);
+    allocation_record *rec = allocations.next;
+    while (rec && rec->buf != ptr) {
+        rec = rec->next;
+    }
+    int result = -1;
+    if (rec) {
+        if (rec->remote_addr == 0) {
+            uint32_t addr = 0;
+            if (remote_mmap(rec->buf_fd, 0, (uint32_t)(uintptr_t)rec->buf, rec->size, &addr) == 0) {
+                rec->remote_addr = addr;
+            } else {
+                __android_log_print(ANDROID_LOG_ERROR, "halide", "remote_mmap(%d, 0, %p, %d) failed",
+                                    rec->buf_fd, rec->buf, rec->size);
+            }
+        }
+        if (rec->remote_addr != 0) {
+            *remote_addr = rec->remote_addr;
+            result = 0;
+        }
+    }
+    pthread_mutex_unlock(&allocations_mutex);
+    return result;
+}
+
+// Begin (or end) access to an allocation made by
+// halide_hexagon_host_malloc on the host. This invalidates (or
+// flushes) the host's cache for it.
+void halide_hexagon_host_sync(void *ptr, bool begin) {
+    pthread_mutex_lock(&allocations_mutex);
+    allocation_record *rec = allocations.next;
+    while (rec && rec->buf != ptr) {
+        rec = rec->next;
+    }
+    int buf_fd = rec ? rec->buf_fd : -1;
+    pthread_mutex_unlock(&allocations_mutex);
+    if (buf_fd < 0) {
+        return;
+    }
+
+    dma_buf_sync sync = {
+        (uint64_t)(dma_buf_sync_rw | (begin ? dma_buf_sync_start : dma_buf_sync_end))
+    };
+    if (ioctl(buf_fd, DMA_BUF_IOCTL_SYNC, &sync) < 0) {
+        __android_log_print(ANDROID_LOG_WARN, "halide", "DMA_BUF_IOCTL_SYNC(%d) failed", buf_fd);
+    }
+}
+
 void halide_hexagon_host_free(void *ptr) {
     if (!ptr) {
         return;
@@ -221,6 +311,11 @@ void halide_hexagon_host_free(void *ptr) {
         remote_register_buf(rec->buf, rec->size, -1);
     }
 
+    // Unmap it from the DSP, if it was mapped there by a session.
+    if (rec->remote_addr != 0 && remote_munmap) {
+        remote_munmap(rec->remote_addr, rec->size);
+    }
+
     // Unmap the memory
     munmap(rec->buf, rec->size);
 
@@ -1,8 +1,11 @@
 #include <memory.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
 #include <android/log.h>
 
 #include "bin/src/halide_hexagon_remote.h"
+#include "session.h"
 
 typedef halide_hexagon_remote_handle_t handle_t;
 typedef halide_hexagon_remote_buffer buffer;
@@ -10,6 +13,150 @@ typedef halide_hexagon_remote_scalar_t scalar_t;
 
 extern "C" {
 
+void *halide_hexagon_host_malloc_uncached(size_t size);
+void halide_hexagon_host_free(void *ptr);
+int halide_hexagon_host_map_remote(void *ptr, uint32_t *remote_addr);
+void halide_hexagon_host_sync(void *ptr, bool begin);
+
+}  // extern "C"
+
+namespace {
+
+// The state of the current session, if any.
+session_mailbox *mailbox = NULL;
+uint32_t mailbox_remote_addr = 0;
+pthread_t session_thread;
+volatile bool session_running = false;
+pthread_mutex_t session_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void *session_main(void *) {
+    int result = halide_hexagon_remote_run_session(mailbox_remote_addr);
+    if (result != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "halide", "halide_hexagon_remote_run_session failed (%d)", result);
+    }
+    session_running = false;
+    return NULL;
+}
+
+// Post a request to the session, and wait for the DSP to finish
+// it. Must be called with session_mutex held.
+int post_request() {
+    uint32_t id = mailbox->request_id + 1;
+    __sync_synchronize();
+    mailbox->request_id = id;
+    while (mailbox->response_id != id) {
+        if (!session_running) {
+            __android_log_print(ANDROID_LOG_ERROR, "halide", "Session ended unexpectedly");
+            return -1;
+        }
+        sched_yield();
+    }
+    __sync_synchronize();
+    return mailbox->result;
+}
+
+// Try to run a pipeline via the current session. Returns false if
+// the pipeline can't be run this way, e.g. because one of the
+// buffers was not allocated with halide_hexagon_host_malloc.
+bool run_in_session(handle_t function,
+                    buffer *input_buffersPtrs, int input_buffersLen,
+                    buffer *output_buffersPtrs, int output_buffersLen,
+                    const scalar_t *scalars, int scalarsLen,
+                    int *result) {
+    int buffer_count = input_buffersLen + output_buffersLen;
+    if (!session_running ||
+        buffer_count > session_max_args ||
+        scalarsLen > session_max_args) {
+        return false;
+    }
+
+    // Find the DSP address of each of the buffers, mapping them if
+    // this is the first time the session has seen them.
+    uint32_t remote_addrs[session_max_args];
+    for (int i = 0; i < buffer_count; i++) {
+        const buffer &b = i < input_buffersLen ? input_buffersPtrs[i] : output_buffersPtrs[i - input_buffersLen];
+        if (halide_hexagon_host_map_remote(b.data, &remote_addrs[i]) != 0) {
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&session_mutex);
+    mailbox->command = Session::Run;
+    mailbox->function = (uint32_t)function;
+    mailbox->input_buffer_count = input_buffersLen;
+    mailbox->output_buffer_count = output_buffersLen;
+    mailbox->scalar_count = scalarsLen;
+    for (int i = 0; i < buffer_count; i++) {
+        buffer &b = i < input_buffersLen ? input_buffersPtrs[i] : output_buffersPtrs[i - input_buffersLen];
+        mailbox->buffers[i] = remote_addrs[i];
+        mailbox->buffer_sizes[i] = b.dataLen;
+        halide_hexagon_host_sync(b.data, false);
+    }
+    memcpy(mailbox->scalars, scalars, scalarsLen * sizeof(scalar_t));
+
+    *result = post_request();
+
+    for (int i = 0; i < buffer_count; i++) {
+        buffer &b = i < input_buffersLen ? input_buffersPtrs[i] : output_buffersPtrs[i - input_buffersLen];
+        halide_hexagon_host_sync(b.data, true);
+    }
+    pthread_mutex_unlock(&session_mutex);
+    return true;
+}
+
+}  // namespace
+
+extern "C" {
+
+// Start a session, in which pipelines are run by posting them to a
+// thread on the DSP, instead of a FastRPC call per pipeline.
+int halide_hexagon_host_start_session() {
+    if (session_running) {
+        return 0;
+    }
+
+    mailbox = (session_mailbox *)halide_hexagon_host_malloc_uncached(sizeof(session_mailbox));
+    if (!mailbox) {
+        return -1;
+    }
+    memset(mailbox, 0, sizeof(session_mailbox));
+    if (halide_hexagon_host_map_remote(mailbox, &mailbox_remote_addr) != 0) {
+        halide_hexagon_host_free(mailbox);
+        mailbox = NULL;
+        return -1;
+    }
+
+    session_running = true;
+    if (pthread_create(&session_thread, NULL, session_main, NULL) != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "halide", "pthread_create failed");
+        session_running = false;
+        halide_hexagon_host_free(mailbox);
+        mailbox = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int halide_hexagon_host_end_session() {
+    if (!mailbox) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&session_mutex);
+    int result = 0;
+    if (session_running) {
+        mailbox->command = Session::Stop;
+        result = post_request();
+    }
+    pthread_mutex_unlock(&session_mutex);
+
+    pthread_join(session_thread, NULL);
+    halide_hexagon_host_free(mailbox);
+    mailbox = NULL;
+    mailbox_remote_addr = 0;
+    return result;
+}
+
 // In v2, we pass all scalars and small input buffers in a single buffer.
 int halide_hexagon_remote_run(handle_t module_ptr, handle_t function,
                               buffer *input_buffersPtrs, int input_buffersLen,
@@ -27,6 +174,15 @@ int halide_hexagon_remote_run(handle_t module_ptr, handle_t function,
         memcpy(&scalars[i], input_scalarsPtrs[i].data, scalar_size);
     }
 
+    // If there is a session, try running the pipeline with it.
+    int result = 0;
+    if (run_in_session(function,
+                       input_buffersPtrs, input_buffersLen,
+                       output_buffersPtrs, output_buffersLen,
+                       scalars, input_scalarsLen, &result)) {
+        return result;
+    }
+
     // Call v2 with the adapted arguments.
     return halide_hexagon_remote_run_v2(module_ptr, function,
                                         input_buffersPtrs, input_buffersLen,
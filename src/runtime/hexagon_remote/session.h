@@ -0,0 +1,46 @@
+#ifndef HALIDE_HEXAGON_REMOTE_SESSION_H
+#define HALIDE_HEXAGON_REMOTE_SESSION_H
+
+#include <stdint.h>
+
+// A session keeps one FastRPC call (run_session) outstanding on the
+// DSP for as long as the session is open. The host then runs
+// pipelines by writing a request into this mailbox, which lives in
+// shared memory, instead of making a FastRPC call for each
+// pipeline. Buffers are mapped to the DSP once, when they are first
+// used in a session, so a request only needs their DSP addresses.
+//
+// Pipelines are run synchronously, so there is only ever one request
+// in flight, and the mailbox only needs a single slot. The host
+// increments request_id to post a request, and the DSP sets
+// response_id to the same value when it is done with it.
+
+namespace Session {
+enum {
+    Run = 0,
+    Stop,
+};
+}
+
+const int session_max_args = 64;
+
+struct session_mailbox {
+    volatile uint32_t request_id;
+    volatile uint32_t response_id;
+    volatile int32_t result;
+
+    uint32_t command;
+    uint32_t function;
+    uint32_t input_buffer_count;
+    uint32_t output_buffer_count;
+    uint32_t scalar_count;
+
+    // The DSP addresses and sizes of the input buffers, followed by
+    // the output buffers.
+    uint32_t buffers[session_max_args];
+    uint32_t buffer_sizes[session_max_args];
+
+    uint64_t scalars[session_max_args];
+};
+
+#endif
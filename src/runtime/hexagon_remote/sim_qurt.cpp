@@ -19,4 +19,9 @@ int qurt_hvx_unlock() {
     return 0;
 }
 
+int qurt_hvx_get_units() {
+    // Two 128 byte units, or four 64 byte units, like a Snapdragon 820.
+    return (2 << 8) | 4;
+}
+
 }  // extern "C"
@@ -76,4 +76,8 @@ WEAK void halide_sleep_ms(void *user_context, int ms) {
         usleep(ms * 1000);
 }
 
+WEAK void halide_sleep_us(void *user_context, int us) {
+    usleep(us);
+}
+
 }
@@ -1,11 +1,72 @@
 #include "HalideRuntime.h"
+#include "runtime_internal.h"
 
 extern "C" {
 
 extern long sysconf(int);
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
 
 WEAK int halide_host_cpu_count() {
     return sysconf(84);
 }
 
+WEAK int halide_host_cpu_nodes(int *cpu_node, int num_cpus) {
+    for (int i = 0; i < num_cpus; i++) {
+        cpu_node[i] = 0;
+    }
+    // Each node lists its CPUs as ranges, e.g. "0-7,16-23".
+    int nodes = 0;
+    for (int node = 0; node < 64; node++) {
+        char path[64];
+        char *dst = halide_string_to_string(path, path + sizeof(path), "/sys/devices/system/node/node");
+        dst = halide_int64_to_string(dst, path + sizeof(path), node, 1);
+        halide_string_to_string(dst, path + sizeof(path), "/cpulist");
+        void *f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+        char list[1024];
+        size_t size = fread(list, 1, sizeof(list) - 1, f);
+        fclose(f);
+        list[size] = 0;
+        nodes++;
+
+        const char *p = list;
+        while (*p) {
+            if (*p < '0' || *p > '9') {
+                p++;
+                continue;
+            }
+            int first = 0, last;
+            while (*p >= '0' && *p <= '9') {
+                first = first * 10 + (*p++ - '0');
+            }
+            last = first;
+            if (*p == '-') {
+                p++;
+                last = 0;
+                while (*p >= '0' && *p <= '9') {
+                    last = last * 10 + (*p++ - '0');
+                }
+            }
+            for (int cpu = first; cpu <= last && cpu < num_cpus; cpu++) {
+                cpu_node[cpu] = node;
+            }
+        }
+    }
+    return nodes;
+}
+
+WEAK int halide_pin_current_thread(int cpu) {
+    // The same size as glibc's cpu_set_t.
+    uint64_t mask[16];
+    if (cpu < 0 || cpu >= (int)(sizeof(mask) * 8)) {
+        return -1;
+    }
+    memset(mask, 0, sizeof(mask));
+    mask[cpu / 64] = (uint64_t)1 << (cpu % 64);
+    // A pid of zero means the calling thread.
+    return sched_setaffinity(0, sizeof(mask), mask);
+}
+
 }
@@ -0,0 +1,58 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+extern int posix_memalign(void **, size_t, size_t);
+extern int madvise(void *, size_t, int);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal { namespace HugePages {
+
+// The size of a transparent huge page on x86-64 and on AArch64 with
+// 4k base pages.
+const size_t kHugePageSize = 2 << 20;
+const int kMadvHugePage = 14;
+
+// Allocations smaller than this go to halide_default_malloc.
+WEAK size_t threshold = 32 << 20;
+
+}}}} // namespace Halide::Runtime::Internal::HugePages
+
+using namespace Halide::Runtime::Internal::HugePages;
+
+extern "C" {
+
+WEAK size_t halide_set_huge_page_threshold(size_t bytes) {
+    size_t result = __atomic_exchange_n(&threshold, bytes, __ATOMIC_RELAXED);
+    return result;
+}
+
+WEAK void *halide_huge_page_malloc(void *user_context, size_t x) {
+    if (x < __atomic_load_n(&threshold, __ATOMIC_RELAXED)) {
+        return halide_default_malloc(user_context, x);
+    }
+
+    // Use the same layout as halide_default_malloc, with the original
+    // pointer stored just before the one we return, so that
+    // halide_default_free can free either. The block itself is made
+    // of whole, aligned huge pages, so the kernel can back all of it
+    // with them.
+    const size_t alignment = halide_malloc_alignment();
+    const size_t header = alignment > sizeof(void *) ? alignment : sizeof(void *);
+    size_t size = (x + header + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    void *orig = NULL;
+    if (posix_memalign(&orig, kHugePageSize, size) != 0 || orig == NULL) {
+        return halide_default_malloc(user_context, x);
+    }
+    // This only fails if transparent huge pages are unavailable, in
+    // which case the memory is still usable.
+    madvise(orig, size, kMadvHugePage);
+
+    void *ptr = (void *)((char *)orig + header);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+}
@@ -0,0 +1,98 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Hardware performance counters for the profiler, read with
+// perf_event_open. The counters are opened by the first thread to
+// start a profiled pipeline, and inherited by threads it spawns
+// afterwards, e.g. the thread pool's workers.
+
+extern "C" int syscall(int num, ...);
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+#ifdef BITS_64
+#define SYS_PERF_EVENT_OPEN 298
+#else
+#define SYS_PERF_EVENT_OPEN 336
+#endif
+
+#define PERF_TYPE_HARDWARE 0
+#define PERF_COUNT_HW_CPU_CYCLES 0
+#define PERF_COUNT_HW_INSTRUCTIONS 1
+#define PERF_COUNT_HW_CACHE_MISSES 3
+#define PERF_FLAG_FD_CLOEXEC 8
+
+// The first version of the kernel's struct perf_event_attr, which
+// later kernels still accept.
+struct perf_event_attr {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+    uint64_t config2;
+};
+
+// Bits of perf_event_attr::flags
+#define PERF_ATTR_INHERIT (1 << 1)
+#define PERF_ATTR_EXCLUDE_KERNEL (1 << 5)
+#define PERF_ATTR_EXCLUDE_HV (1 << 6)
+
+// In the order of the values passed to the profiler: cycles,
+// instructions, LLC misses.
+WEAK int perf_counter_fds[3] = {-1, -1, -1};
+
+WEAK bool start_perf_counters() {
+    const char *env = getenv("HL_PROFILER_COUNTERS");
+    if (!env || !*env || (env[0] == '0' && !env[1])) {
+        return false;
+    }
+
+    const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES,
+                                 PERF_COUNT_HW_INSTRUCTIONS,
+                                 PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < 3; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        // Only count user-space work, which unprivileged users are
+        // allowed to measure.
+        attr.flags = PERF_ATTR_INHERIT | PERF_ATTR_EXCLUDE_KERNEL | PERF_ATTR_EXCLUDE_HV;
+        // Count this thread and the threads it spawns, on any cpu.
+        perf_counter_fds[i] = syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (perf_counter_fds[i] < 0) {
+            halide_print(NULL, "Warning: HL_PROFILER_COUNTERS is set, but the hardware "
+                         "performance counters could not be opened. Check "
+                         "/proc/sys/kernel/perf_event_paranoid.\n");
+            for (int j = 0; j < i; j++) {
+                close(perf_counter_fds[j]);
+                perf_counter_fds[j] = -1;
+            }
+            perf_counter_fds[i] = -1;
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK bool read_perf_counters(uint64_t *values) {
+    for (int i = 0; i < 3; i++) {
+        if (perf_counter_fds[i] < 0 ||
+            read(perf_counter_fds[i], values + i, sizeof(uint64_t)) != (ssize_t)sizeof(uint64_t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}}}
+
+#define HALIDE_PROFILER_PERF_COUNTERS
+#include "profiler.cpp"
@@ -173,6 +173,42 @@ INLINE mxArray *create_numeric_matrix(size_t M, size_t N, mxClassID type, mxComp
     }
 }
 
+// The number of threads Matlab uses for its own computation, or 0 if
+// it can't be determined. These APIs are looked up separately from
+// the ones in mex_functions.h, so that they are optional.
+WEAK int get_matlab_thread_count(void *user_context) {
+    typedef int (*call_matlab_fn)(int, mxArray **, int, const mxArray **, const char *);
+    typedef void (*destroy_array_fn)(mxArray *);
+    call_matlab_fn call_matlab = get_mex_symbol<call_matlab_fn>(user_context, "mexCallMATLAB", false);
+    destroy_array_fn destroy_array = get_mex_symbol<destroy_array_fn>(user_context, "mxDestroyArray", false);
+    if (!call_matlab || !destroy_array) {
+        return 0;
+    }
+    mxArray *count = NULL;
+    if (call_matlab(1, &count, 0, NULL, "maxNumCompThreads") != 0 || count == NULL) {
+        return 0;
+    }
+    int result = (int)mxGetScalar(count);
+    destroy_array(count);
+    return result;
+}
+
+// The number of threads to run pipelines with, from HL_MATLAB_THREADS,
+// or 0 to leave Halide's thread pool alone. HL_MATLAB_THREADS=matlab
+// uses as many threads as Matlab itself is allowed
+// (maxNumCompThreads), so that pipelines called from parallel Matlab
+// code don't oversubscribe the machine.
+WEAK int get_pipeline_thread_count(void *user_context) {
+    const char *threads = getenv("HL_MATLAB_THREADS");
+    if (threads == NULL) {
+        return 0;
+    }
+    if (strcmp(threads, "matlab") == 0) {
+        return get_matlab_thread_count(user_context);
+    }
+    return atoi(threads);
+}
+
 }  // namespace mex
 }  // namespace Runtime
 }  // namespace Halide
@@ -251,6 +287,9 @@ WEAK int halide_matlab_init(void *user_context) {
 }
 
 // Convert a matlab mxArray to a Halide halide_buffer_t, with a specific number of dimensions.
+// The buffer points at the array's data, which is not copied. Matlab
+// arrays are column major, so dimension 0 of the buffer is the rows of
+// the array, and dimension 1 the columns.
 WEAK int halide_matlab_array_to_halide_buffer_t(void *user_context,
                                                 const mxArray *arr,
                                                 const halide_filter_argument_t *arg,
@@ -438,8 +477,15 @@ WEAK int halide_matlab_call_pipeline(void *user_context,
         }
     }
 
+    int num_threads = get_pipeline_thread_count(user_context);
+    int old_num_threads = num_threads > 0 ? halide_set_num_threads(num_threads) : 0;
+
     result = pipeline(args);
 
+    if (num_threads > 0) {
+        halide_set_num_threads(old_num_threads);
+    }
+
     // Copy any GPU resident output buffers back to the CPU before returning.
     for (int i = 0; i < nrhs; i++) {
         const halide_filter_argument_t *arg_metadata = &metadata->arguments[i];
@@ -11,6 +11,7 @@
 extern "C" {
 extern objc_id MTLCreateSystemDefaultDevice();
 extern struct ObjectiveCClass _NSConcreteGlobalBlock;
+extern int getpagesize();
 }
 
 namespace Halide { namespace Runtime { namespace Internal { namespace Metal {
@@ -33,6 +34,18 @@ WEAK mtl_buffer *new_buffer(mtl_device *device, size_t length) {
                      length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */);
 }
 
+#ifdef ZERO_COPY
+// Make a buffer that uses existing host memory as its storage. Metal
+// requires the memory and length to be page aligned.
+WEAK mtl_buffer *new_buffer_with_bytes_no_copy(mtl_device *device, void *bytes, size_t length) {
+    typedef mtl_buffer *(*new_buffer_method)(objc_id device, objc_sel sel, void *bytes, size_t length, size_t options, void *deallocator);
+    new_buffer_method method = (new_buffer_method)&objc_msgSend;
+    return (*method)(device, sel_getUid("newBufferWithBytesNoCopy:length:options:deallocator:"),
+                     bytes, length, 0  /* MTLResourceCPUCacheModeDefaultCache | MTLResourceStorageModeShared */,
+                     NULL);
+}
+#endif
+
 WEAK mtl_command_queue *new_command_queue(mtl_device *device) {
     return (mtl_command_queue *)objc_msgSend(device, sel_getUid("newCommandQueue"));
 }
@@ -73,6 +86,12 @@ WEAK mtl_compute_pipeline_state *new_compute_pipeline_state_with_function(mtl_de
     return result;
 }
 
+WEAK size_t max_total_threads_per_threadgroup(mtl_compute_pipeline_state *pipeline_state) {
+    typedef size_t (*max_total_threads_per_threadgroup_method)(objc_id pipeline_state, objc_sel sel);
+    max_total_threads_per_threadgroup_method method = (max_total_threads_per_threadgroup_method)&objc_msgSend;
+    return (*method)(pipeline_state, sel_getUid("maxTotalThreadsPerThreadgroup"));
+}
+
 WEAK void set_compute_pipeline_state(mtl_compute_command_encoder *encoder, mtl_compute_pipeline_state *pipeline_state) {
     typedef void (*set_compute_pipeline_state_method)(objc_id encoder, objc_sel sel, objc_id pipeline_state);
     set_compute_pipeline_state_method method = (set_compute_pipeline_state_method)&objc_msgSend;
@@ -213,12 +232,27 @@ struct device_handle {
     uint64_t offset;
 };
 
+// Recycled device_handles for crops and slices.
+WEAK crop_handle_pool<device_handle> crop_handles;
+
+// The compiled pipeline state of a kernel, made the first time the
+// kernel runs. Making a pipeline state is expensive, so we keep them
+// for the life of the library they came from.
+struct kernel_state {
+    char *entry_name;
+    mtl_function *function;
+    mtl_compute_pipeline_state *pipeline_state;
+    size_t max_threads;
+    kernel_state *next;
+};
+
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
 // when then context is released.
 struct module_state {
     mtl_library *library;
+    kernel_state *kernels;
     module_state *next;
 };
 WEAK module_state *state_list = NULL;
@@ -373,6 +407,159 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     &command_buffer_completed_handler_descriptor
 };
 
+// Kernels are encoded into a single command buffer, with a single
+// compute encoder, which is only committed when something needs the
+// results (a sync, a copy, or running out of room), rather than
+// making and committing a command buffer per kernel. Dispatches in a
+// compute encoder run in order, so this doesn't change the meaning of
+// a pipeline. Scalar arguments too large for setBytes are packed into
+// one arguments buffer per command buffer. All of this is protected
+// by the context lock.
+WEAK mtl_command_queue *pending_queue = NULL;
+WEAK mtl_command_buffer *pending_command_buffer = NULL;
+WEAK mtl_compute_command_encoder *pending_encoder = NULL;
+WEAK mtl_buffer *pending_args_buffer = NULL;
+WEAK size_t pending_args_offset = 0;
+WEAK size_t pending_args_capacity = 0;
+WEAK int pending_dispatches = 0;
+
+// Commit after this many dispatches, so that the GPU isn't left idle
+// while a long pipeline is encoded.
+const int max_pending_dispatches = 64;
+
+WEAK void commit_pending_commands(void *user_context) {
+    if (pending_command_buffer == NULL) {
+        return;
+    }
+    debug(user_context) << "Metal: committing " << pending_dispatches << " dispatches\n";
+    end_encoding(pending_encoder);
+    release_ns_object(pending_encoder);
+    if (pending_args_buffer) {
+        // The command buffer keeps the arguments alive until it completes.
+        release_ns_object(pending_args_buffer);
+    }
+    add_command_buffer_completed_handler(pending_command_buffer, &command_buffer_completed_handler_block);
+    commit_command_buffer(pending_command_buffer);
+    release_ns_object(pending_command_buffer);
+    pending_queue = NULL;
+    pending_command_buffer = NULL;
+    pending_encoder = NULL;
+    pending_args_buffer = NULL;
+    pending_args_offset = 0;
+    pending_args_capacity = 0;
+    pending_dispatches = 0;
+}
+
+WEAK mtl_compute_command_encoder *get_pending_encoder(void *user_context, mtl_command_queue *queue) {
+    if (pending_command_buffer != NULL && pending_queue != queue) {
+        commit_pending_commands(user_context);
+    }
+    if (pending_command_buffer == NULL) {
+        mtl_command_buffer *command_buffer = new_command_buffer(queue);
+        if (command_buffer == 0) {
+            return NULL;
+        }
+        mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+        if (encoder == 0) {
+            return NULL;
+        }
+        // Both are autoreleased, and must outlive the pool of this call.
+        retain_ns_object(command_buffer);
+        retain_ns_object(encoder);
+        pending_queue = queue;
+        pending_command_buffer = command_buffer;
+        pending_encoder = encoder;
+    }
+    return pending_encoder;
+}
+
+// Find room for size bytes of arguments in the arguments buffer of
+// the pending command buffer.
+WEAK mtl_buffer *allocate_pending_args(mtl_device *device, size_t size, size_t *offset) {
+    // Offsets into buffers bound as constant arguments must be
+    // multiples of 256 on some devices.
+    size_t start = (pending_args_offset + 255) & ~(size_t)255;
+    if (pending_args_buffer == NULL || start + size > pending_args_capacity) {
+        size_t capacity = pending_args_capacity * 2;
+        if (capacity < 16384) {
+            capacity = 16384;
+        }
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        mtl_buffer *args_buffer = new_buffer(device, capacity);
+        if (args_buffer == 0) {
+            return NULL;
+        }
+        if (pending_args_buffer) {
+            // Already bound by earlier dispatches, which keeps it alive.
+            release_ns_object(pending_args_buffer);
+        }
+        pending_args_buffer = args_buffer;
+        pending_args_capacity = capacity;
+        start = 0;
+    }
+    pending_args_offset = start + size;
+    *offset = start;
+    return pending_args_buffer;
+}
+
+WEAK kernel_state *get_kernel_state(void *user_context, mtl_device *device,
+                                    module_state *state, const char *entry_name) {
+    for (kernel_state *k = state->kernels; k; k = k->next) {
+        if (strcmp(k->entry_name, entry_name) == 0) {
+            return k;
+        }
+    }
+
+    mtl_function *function = new_function_with_name(state->library, entry_name, strlen(entry_name));
+    if (function == 0) {
+        error(user_context) << "Metal: Could not get function " << entry_name << "from Metal library.\n";
+        return NULL;
+    }
+
+    mtl_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(device, function);
+    if (pipeline_state == 0) {
+        error(user_context) << "Metal: Could not allocate pipeline state.\n";
+        release_ns_object(function);
+        return NULL;
+    }
+
+    size_t name_len = strlen(entry_name);
+    kernel_state *k = (kernel_state *)malloc(sizeof(kernel_state));
+    char *name = (char *)malloc(name_len + 1);
+    if (k == NULL || name == NULL) {
+        free(k);
+        free(name);
+        release_ns_object(pipeline_state);
+        release_ns_object(function);
+        error(user_context) << "Metal: Out of memory caching pipeline state.\n";
+        return NULL;
+    }
+    memcpy(name, entry_name, name_len + 1);
+    k->entry_name = name;
+    k->function = function;
+    k->pipeline_state = pipeline_state;
+    k->max_threads = max_total_threads_per_threadgroup(pipeline_state);
+    k->next = state->kernels;
+    state->kernels = k;
+    return k;
+}
+
+WEAK void release_kernel_states(void *user_context, module_state *state) {
+    kernel_state *k = state->kernels;
+    while (k) {
+        kernel_state *next = k->next;
+        debug(user_context) << "Metal - Releasing: pipeline state for " << k->entry_name << "\n";
+        release_ns_object(k->pipeline_state);
+        release_ns_object(k->function);
+        free(k->entry_name);
+        free(k);
+        k = next;
+    }
+    state->kernels = NULL;
+}
+
 }}}} // namespace Halide::Runtime::Internal::Metal
 
 using namespace Halide::Runtime::Internal::Metal;
@@ -413,7 +600,23 @@ WEAK int halide_metal_device_malloc(void *user_context, halide_buffer_t* buf) {
         return halide_error_code_out_of_memory;
     }
 
-    mtl_buffer *metal_buf = new_buffer(metal_context.device, size);
+    mtl_buffer *metal_buf = NULL;
+#ifdef ZERO_COPY
+    // Let the device use the host allocation directly, if there is one
+    // and it is page aligned. The host memory is mapped in whole pages,
+    // so rounding the length up stays within it. The copies to and from
+    // such a buffer then see the same pointer on both sides, and
+    // copy_memory skips them.
+    size_t page_size = (size_t)getpagesize();
+    if (buf->host && ((uintptr_t)buf->host & (page_size - 1)) == 0) {
+        size_t length = (size + page_size - 1) & ~(page_size - 1);
+        metal_buf = new_buffer_with_bytes_no_copy(metal_context.device, buf->host, length);
+        debug(user_context) << "    newBufferWithBytesNoCopy " << (void *)buf->host << " -> " << metal_buf << "\n";
+    }
+#endif
+    if (metal_buf == 0) {
+        metal_buf = new_buffer(metal_context.device, size);
+    }
     if (metal_buf == 0) {
         free(handle);
         error(user_context) << "Metal: Failed to allocate buffer of size " << (int64_t)size << ".\n";
@@ -472,6 +675,7 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
     if (!(*state)) {
         *state = (module_state*)malloc(sizeof(module_state));
         (*state)->library = NULL;
+        (*state)->kernels = NULL;
         (*state)->next = state_list;
         state_list = *state;
     }
@@ -514,6 +718,9 @@ WEAK int halide_metal_initialize_kernels(void *user_context, void **state_ptr, c
 namespace {
 
 inline void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
+    // Commands complete in the order they were committed, so waiting
+    // on this command buffer also waits on any pending kernels.
+    commit_pending_commands(NULL);
     mtl_command_buffer *sync_command_buffer = new_command_buffer(queue);
     if (buffer != NULL) {
         mtl_buffer *metal_buffer = ((device_handle *)buffer->device)->buf;
@@ -570,7 +777,8 @@ WEAK int halide_metal_device_release(void *user_context) {
         // object.
         module_state *state = state_list;
         while (state) {
-          if (state->library) {
+            release_kernel_states(user_context, state);
+            if (state->library) {
                 debug(user_context) << "Metal - Releasing: new_library_with_source " << state->library << "\n";
                 release_ns_object(state->library);
                 state->library = NULL;
@@ -590,6 +798,8 @@ WEAK int halide_metal_device_release(void *user_context) {
         }
     }
 
+    release_crop_handles(crop_handles);
+
     halide_metal_release_context(user_context);
 
     return 0;
@@ -689,34 +899,34 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error;
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue);
-    if (command_buffer == 0) {
-        error(user_context) << "Metal: Could not allocate command buffer.\n";
-        return -1;
-    }
-
-    mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+    mtl_compute_command_encoder *encoder = get_pending_encoder(user_context, metal_context.queue);
     if (encoder == 0) {
-        error(user_context) << "Metal: Could not allocate compute command encoder.\n";
+        error(user_context) << "Metal: Could not allocate command buffer.\n";
         return -1;
     }
 
     halide_assert(user_context, state_ptr);
     module_state *state = (module_state*)state_ptr;
 
-    mtl_function *function = new_function_with_name(state->library, entry_name, strlen(entry_name));
-    if (function == 0) {
-        error(user_context) << "Metal: Could not get function " << entry_name << "from Metal library.\n";
+    kernel_state *kernel = get_kernel_state(user_context, metal_context.device, state, entry_name);
+    if (kernel == NULL) {
         return -1;
     }
 
-    mtl_compute_pipeline_state *pipeline_state = new_compute_pipeline_state_with_function(metal_context.device, function);
-    if (pipeline_state == 0) {
-        error(user_context) << "Metal: Could not allocate pipeline state.\n";
-        release_ns_object(function);
+    // The threadgroup size a pipeline state supports depends on the
+    // device and on the register usage of the kernel, so can only be
+    // checked here. Dispatching a larger one fails silently.
+    size_t max_threads = kernel->max_threads;
+    size_t threads = (size_t)threadsX * threadsY * threadsZ;
+    debug(user_context) << "Metal: " << entry_name << " supports up to " << (uint64_t)max_threads
+                        << " threads per threadgroup\n";
+    if (threads > max_threads) {
+        error(user_context) << "Metal: Kernel " << entry_name << " was scheduled with " << (uint64_t)threads
+                            << " threads per threadgroup, but supports at most " << (uint64_t)max_threads
+                            << " on this device. Use smaller gpu thread extents.\n";
         return -1;
     }
-    set_compute_pipeline_state(encoder, pipeline_state);
+    set_compute_pipeline_state(encoder, kernel->pipeline_state);
 
     size_t total_args_size = 0;
     for (size_t i = 0; arg_sizes[i] != 0; i++) {
@@ -738,6 +948,7 @@ WEAK int halide_metal_run(void *user_context,
     int32_t buffer_index = 0;
     if (total_args_size > 0) {
         mtl_buffer *args_buffer = 0;        // used if the total arguments size large
+        size_t args_offset = 0;
         uint8_t small_args_buffer[4096];    // used if the total arguments size is small
         char *args_ptr;
 
@@ -759,14 +970,12 @@ WEAK int halide_metal_run(void *user_context,
         if (padded_args_size < 4096 && metal_api_supports_set_bytes) {
             args_ptr = (char *)small_args_buffer;
         } else {
-            args_buffer = new_buffer(metal_context.device, padded_args_size);
+            args_buffer = allocate_pending_args(metal_context.device, padded_args_size, &args_offset);
             if (args_buffer == 0) {
                 error(user_context) << "Metal: Could not allocate arguments buffer.\n";
-                release_ns_object(pipeline_state);
-                release_ns_object(function);
                 return -1;
             }
-            args_ptr = (char *)buffer_contents(args_buffer);
+            args_ptr = (char *)buffer_contents(args_buffer) + args_offset;
         }
         size_t offset = 0;
         for (size_t i = 0; arg_sizes[i] != 0; i++) {
@@ -781,8 +990,7 @@ WEAK int halide_metal_run(void *user_context,
             set_input_buffer_from_bytes(encoder, small_args_buffer,
                                         padded_args_size, buffer_index);
         } else {
-            set_input_buffer(encoder, args_buffer, 0, buffer_index);
-            release_ns_object(args_buffer);
+            set_input_buffer(encoder, args_buffer, args_offset, buffer_index);
         }
         buffer_index++;
     }
@@ -809,14 +1017,10 @@ WEAK int halide_metal_run(void *user_context,
     dispatch_threadgroups(encoder,
                           blocksX, blocksY, blocksZ,
                           threadsX, threadsY, threadsZ);
-    end_encoding(encoder);
 
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
-
-    release_ns_object(pipeline_state);
-    release_ns_object(function);
+    if (++pending_dispatches >= max_pending_dispatches) {
+        commit_pending_commands(user_context);
+    }
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -894,6 +1098,7 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
         // Device only case
         if (!from_host && !to_host) {
             debug(user_context) << "halide_metal_buffer_copy device to device case.\n";
+            commit_pending_commands(user_context);
             mtl_command_buffer *blit_command_buffer = new_command_buffer(metal_context.queue);
             mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(blit_command_buffer);
             do_device_to_device_copy(user_context, blit_encoder, c, ((device_handle *)c.src)->offset,
@@ -951,7 +1156,7 @@ WEAK int metal_device_crop_from_offset(void *user_context,
     }
 
     dst->device_interface = src->device_interface;
-    device_handle *new_handle = (device_handle *)malloc(sizeof(device_handle));
+    device_handle *new_handle = get_crop_handle(crop_handles);
     if (new_handle == NULL) {
         error(user_context) << "halide_metal_device_crop: malloc failed making device handle.\n";
         return halide_error_code_out_of_memory;
@@ -999,7 +1204,7 @@ WEAK int halide_metal_device_release_crop(void *user_context,
     device_handle *handle = (device_handle *)buf->device;
 
     release_ns_object(handle->buf);
-    free(handle);
+    put_crop_handle(crop_handles, handle);
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
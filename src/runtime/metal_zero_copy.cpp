@@ -0,0 +1,3 @@
+#define ZERO_COPY 1
+
+#include "metal.cpp"
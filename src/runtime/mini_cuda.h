@@ -20,8 +20,21 @@ typedef struct CUctx_st *CUcontext;                       /**< CUDA context */
 typedef struct CUmod_st *CUmodule;                        /**< CUDA module */
 typedef struct CUfunc_st *CUfunction;                     /**< CUDA function */
 typedef struct CUstream_st *CUstream;                     /**< CUDA stream */
+#define CU_STREAM_PER_THREAD ((CUstream)0x2)              /**< Per-thread default stream */
 typedef struct CUevent_st *CUevent;                       /**< CUDA event */
 typedef struct CUarray_st* CUarray;
+typedef struct CUlinkState_st *CUlinkState;
+typedef struct CUgraph_st *CUgraph;
+typedef struct CUgraphExec_st *CUgraphExec;
+typedef struct CUgraphNode_st *CUgraphNode;
+#define CU_STREAM_NON_BLOCKING 0x1                        /**< Stream does not synchronize with stream 0 */
+#define CU_EVENT_DISABLE_TIMING 0x2                       /**< Event does not record timing data */
+#define CU_STREAM_CAPTURE_MODE_RELAXED 2                  /**< Allow any API call during stream capture */
+
+typedef enum CUjitInputType_enum {
+    CU_JIT_INPUT_CUBIN = 0,
+    CU_JIT_INPUT_PTX = 1
+} CUjitInputType;
 
 typedef enum CUjit_option_enum {
     CU_JIT_MAX_REGISTERS = 0,
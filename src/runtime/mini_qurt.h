@@ -184,6 +184,9 @@ extern int qurt_thread_create (qurt_thread_t *thread_id, qurt_thread_attr_t *att
  */
 extern int qurt_thread_join(unsigned int tid, int *status);
 
+/** Gets the identifier of the calling thread. */
+extern qurt_thread_t qurt_thread_get_id(void);
+
 /** QuRT mutex type.
 
    Both non-recursive mutex lock/unlock and recursive
@@ -233,5 +236,9 @@ typedef enum {
 extern int qurt_hvx_lock(qurt_hvx_mode_t lock_mode);
 extern int qurt_hvx_unlock(void);
 extern int qurt_hvx_get_mode(void);
+// Returns the number of 64 byte HVX units in bits 0-7, and the number
+// of 128 byte units in bits 8-15. Not present in older QuRT
+// releases, hence weak.
+extern int qurt_hvx_get_units(void) __attribute__((weak));
 
 }
@@ -2,6 +2,7 @@
 #include "scoped_spin_lock.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "gpu_kernel_cache.h"
 #include "printer.h"
 
 #include "mini_cl.h"
@@ -84,6 +85,67 @@ WEAK char device_type[256];
 WEAK int device_type_lock = 0;
 WEAK bool device_type_initialized = false;
 
+WEAK KernelCacheKey make_kernel_cache_key(cl_device_id dev, const char *src, int size, const char *options) {
+    KernelCacheKey key;
+    key.add(src, size);
+    key.add(options);
+
+    const cl_device_info params[] = {CL_DEVICE_NAME, CL_DEVICE_VENDOR, CL_DEVICE_VERSION, CL_DRIVER_VERSION};
+    for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++) {
+        char value[256] = {0};
+        clGetDeviceInfo(dev, params[i], sizeof(value) - 1, value, NULL);
+        key.add(value);
+    }
+    return key;
+}
+
+// Create and build a program from a binary in the kernel cache. Returns
+// NULL if there is no entry, or the driver rejects it.
+WEAK cl_program load_cached_program(void *user_context, cl_context context, cl_device_id dev,
+                                    const KernelCacheKey &key, const char *options) {
+    size_t binary_size = 0;
+    uint8_t *binary = kernel_cache_load(user_context, "opencl", key, &binary_size);
+    if (!binary) {
+        return NULL;
+    }
+    cl_int binary_status = CL_SUCCESS, err = CL_SUCCESS;
+    const unsigned char *binaries[] = { binary };
+    cl_program program = clCreateProgramWithBinary(context, 1, &dev, &binary_size, binaries, &binary_status, &err);
+    free(binary);
+    if (err != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        debug(user_context) << "    clCreateProgramWithBinary failed: " << get_opencl_error_name(err) << "\n";
+        if (err == CL_SUCCESS) {
+            clReleaseProgram(program);
+        }
+        return NULL;
+    }
+    err = clBuildProgram(program, 1, &dev, options, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        debug(user_context) << "    clBuildProgram of cached binary failed: " << get_opencl_error_name(err) << "\n";
+        clReleaseProgram(program);
+        return NULL;
+    }
+    return program;
+}
+
+// Store the binary of a program built for a single device in the kernel cache.
+WEAK void store_program_binary(void *user_context, cl_program program, const KernelCacheKey &key) {
+    size_t binary_size = 0;
+    cl_int err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL);
+    if (err != CL_SUCCESS || binary_size == 0) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (!binary) {
+        return;
+    }
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL);
+    if (err == CL_SUCCESS) {
+        kernel_cache_store(user_context, "opencl", key, binary, binary_size);
+    }
+    free(binary);
+}
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 using namespace Halide::Runtime::Internal::OpenCL;
@@ -216,16 +278,133 @@ struct device_handle {
     cl_mem mem;
 };
 
+// Recycled device_handles for crops and slices.
+WEAK crop_handle_pool<device_handle> crop_handles;
+
+// Structure to hold the state of a module attached to the context.
+// Also used as a linked-list to keep track of all the different
+// modules that are attached to a context in order to release them all
+// when then context is released.
+// The value last passed to clSetKernelArg for an argument of a
+// cached kernel. Values larger than this aren't remembered.
+struct kernel_arg {
+    size_t size;        // 0 if unknown
+    bool local;         // a __local allocation of size bytes
+    uint64_t mem_generation;
+    uint8_t value[16];
+};
+
+// A kernel object, made the first time the kernel runs, and the
+// arguments it was last launched with. Setting an argument isn't
+// free, and most are the same from one launch to the next.
+struct kernel_state {
+    char *entry_name;
+    cl_kernel kernel;
+    int num_args;
+    kernel_arg *args;
+    kernel_state *next;
+};
+
 // Structure to hold the state of a module attached to the context.
 // Also used as a linked-list to keep track of all the different
 // modules that are attached to a context in order to release them all
 // when then context is released.
 struct module_state {
     cl_program program;
+    const char *src;
+    int size;
+    kernel_state *kernels;
     module_state *next;
 };
 WEAK module_state *state_list = NULL;
 
+// Incremented whenever a cl_mem that a kernel may have been given is
+// released (or handed back to the application), after which a new
+// cl_mem could have the same handle. cl_mem arguments remembered from
+// an earlier generation are always set again.
+WEAK uint64_t mem_generation = 0;
+
+WEAK kernel_state *get_kernel_state(void *user_context, module_state *state,
+                                    const char *entry_name, int num_args, cl_int *err) {
+    for (kernel_state *k = state->kernels; k; k = k->next) {
+        if (strcmp(k->entry_name, entry_name) == 0) {
+            halide_assert(user_context, k->num_args == num_args);
+            *err = CL_SUCCESS;
+            return k;
+        }
+    }
+
+    debug(user_context) << "    clCreateKernel " << entry_name << " -> ";
+    cl_kernel f = clCreateKernel(state->program, entry_name, err);
+    if (*err != CL_SUCCESS) {
+        debug(user_context) << get_opencl_error_name(*err) << "\n";
+        error(user_context) << "CL: clCreateKernel " << entry_name << " failed: "
+                            << get_opencl_error_name(*err) << "\n";
+        return NULL;
+    }
+    debug(user_context) << (void *)f << "\n";
+
+    size_t name_len = strlen(entry_name);
+    kernel_state *k = (kernel_state *)malloc(sizeof(kernel_state));
+    char *name = (char *)malloc(name_len + 1);
+    kernel_arg *args = (kernel_arg *)malloc(sizeof(kernel_arg) * num_args);
+    if (k == NULL || name == NULL || args == NULL) {
+        free(k);
+        free(name);
+        free(args);
+        clReleaseKernel(f);
+        *err = halide_error_code_out_of_memory;
+        return NULL;
+    }
+    memcpy(name, entry_name, name_len + 1);
+    memset(args, 0, sizeof(kernel_arg) * num_args);
+    k->entry_name = name;
+    k->kernel = f;
+    k->num_args = num_args;
+    k->args = args;
+    k->next = state->kernels;
+    state->kernels = k;
+    return k;
+}
+
+// Set an argument of a cached kernel, unless it already has that
+// value. value is NULL for a __local allocation.
+WEAK cl_int set_kernel_arg(kernel_state *k, int i, size_t size, const void *value, bool is_mem) {
+    kernel_arg &a = k->args[i];
+    bool local = (value == NULL);
+    if (a.size == size && a.local == local && size <= sizeof(a.value) &&
+        (!is_mem || a.mem_generation == mem_generation) &&
+        (local || memcmp(a.value, value, size) == 0)) {
+        return CL_SUCCESS;
+    }
+    cl_int err = clSetKernelArg(k->kernel, i, size, value);
+    if (err == CL_SUCCESS && size <= sizeof(a.value)) {
+        a.size = size;
+        a.local = local;
+        a.mem_generation = mem_generation;
+        if (!local) {
+            memcpy(a.value, value, size);
+        }
+    } else {
+        a.size = 0;
+    }
+    return err;
+}
+
+WEAK void release_kernel_states(void *user_context, module_state *state) {
+    kernel_state *k = state->kernels;
+    while (k) {
+        kernel_state *next = k->next;
+        debug(user_context) << "    clReleaseKernel " << (void *)k->kernel << "\n";
+        clReleaseKernel(k->kernel);
+        free(k->args);
+        free(k->entry_name);
+        free(k);
+        k = next;
+    }
+    state->kernels = NULL;
+}
+
 WEAK bool validate_device_pointer(void *user_context, halide_buffer_t* buf, size_t size=0) {
     if (buf->device == 0) {
         return true;
@@ -469,6 +648,400 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     return err;
 }
 
+// Device allocations freed by Halide can be kept around and reused by
+// later allocations of the same size and flags on the same context,
+// instead of paying for clReleaseMemObject and clCreateBuffer every
+// time. Sizes are rounded up to one of four buckets per power of two
+// so that similar sizes share allocations. max_cached_device_bytes is
+// the high-water mark for the total size of the unused allocations
+// kept; it is zero (no caching) by default.
+struct cached_allocation {
+    cl_context context;
+    cl_mem mem;
+    size_t size;
+    cl_mem_flags flags;
+    cached_allocation *next;
+};
+
+WEAK cached_allocation *unused_allocations = NULL;
+WEAK size_t cached_device_bytes = 0;
+WEAK size_t max_cached_device_bytes = 0;
+// This spinlock protects the above unused allocation list and sizes.
+volatile int WEAK unused_allocations_lock = 0;
+
+WEAK size_t quantize_allocation_size(size_t size) {
+    if (size <= 256) {
+        return 256;
+    }
+    int log2 = 63 - __builtin_clzll((uint64_t)(size - 1));
+    size_t step = ((size_t)1 << log2) >> 2;
+    return (size + step - 1) & ~(step - 1);
+}
+
+// Take an unused allocation of exactly the given (quantized) size and
+// flags on the given context out of the cache. Returns NULL if there
+// is none.
+WEAK cl_mem take_unused_allocation(cl_context ctx, size_t size, cl_mem_flags flags) {
+    cached_allocation *found = NULL;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        cached_allocation **prev_ptr = &unused_allocations;
+        for (cached_allocation *a = unused_allocations; a != NULL; a = a->next) {
+            if (a->context == ctx && a->size == size && a->flags == flags) {
+                *prev_ptr = a->next;
+                cached_device_bytes -= a->size;
+                found = a;
+                break;
+            }
+            prev_ptr = &a->next;
+        }
+    }
+    if (found == NULL) {
+        return NULL;
+    }
+    cl_mem mem = found->mem;
+    free(found);
+    return mem;
+}
+
+// Put an allocation in the cache if there is room for it under the
+// high-water mark. Returns false if the caller should release it
+// instead.
+WEAK bool cache_unused_allocation(cl_context ctx, cl_mem mem, size_t size, cl_mem_flags flags) {
+    cached_allocation *a = NULL;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        if (cached_device_bytes + size > max_cached_device_bytes) {
+            return false;
+        }
+        cached_device_bytes += size;
+    }
+    a = (cached_allocation *)malloc(sizeof(cached_allocation));
+    if (a == NULL) {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        cached_device_bytes -= size;
+        return false;
+    }
+    a->context = ctx;
+    a->mem = mem;
+    a->size = size;
+    a->flags = flags;
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        a->next = unused_allocations;
+        unused_allocations = a;
+    }
+    return true;
+}
+
+// Release unused allocations on the given context until the cache is
+// no larger than target_bytes.
+WEAK int release_unused_allocations(void *user_context, cl_context ctx, size_t target_bytes) {
+    int result = CL_SUCCESS;
+    while (true) {
+        cached_allocation *victim = NULL;
+        {
+            ScopedSpinLock spinlock(&unused_allocations_lock);
+            if (cached_device_bytes <= target_bytes) {
+                break;
+            }
+            cached_allocation **prev_ptr = &unused_allocations;
+            for (cached_allocation *a = unused_allocations; a != NULL; a = a->next) {
+                if (a->context == ctx) {
+                    *prev_ptr = a->next;
+                    cached_device_bytes -= a->size;
+                    victim = a;
+                    break;
+                }
+                prev_ptr = &a->next;
+            }
+        }
+        if (victim == NULL) {
+            // Whatever is left is on other contexts.
+            break;
+        }
+        debug(user_context) << "    clReleaseMemObject " << (void *)victim->mem << "\n";
+        mem_generation++;
+        cl_int err = clReleaseMemObject(victim->mem);
+        if (err != CL_SUCCESS) {
+            result = err;
+        }
+        free(victim);
+    }
+    return result;
+}
+
+// Whether device allocations are made with CL_MEM_ALLOC_HOST_PTR, so
+// that the driver backs them with pinned host memory.
+WEAK bool alloc_host_ptr = false;
+
+// Buffers allocated by halide_opencl_device_and_host_malloc while
+// alloc_host_ptr is set use a mapping of their cl_mem as the host
+// allocation. On GPUs that share memory with the host, this makes
+// copies to and from the device free. The buffer is unmapped before
+// the device touches it, and mapped again when it is copied back to
+// the host, so that the host and device never use it at the same
+// time. This relies on the driver mapping the buffer to the same
+// address every time, which is true of the implementations that back
+// CL_MEM_ALLOC_HOST_PTR buffers with pinned memory.
+struct mapped_allocation {
+    cl_mem mem;
+    uint8_t *host;
+    size_t size;
+    bool mapped;
+    mapped_allocation *next;
+};
+
+WEAK mapped_allocation *mapped_allocations = NULL;
+// This spinlock protects the above list and the mapped flags in it.
+volatile int WEAK mapped_allocations_lock = 0;
+
+// Must be called with mapped_allocations_lock held.
+WEAK mapped_allocation *find_mapped_allocation(cl_mem mem) {
+    for (mapped_allocation *m = mapped_allocations; m != NULL; m = m->next) {
+        if (m->mem == mem) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+WEAK bool is_mapped_allocation(cl_mem mem) {
+    ScopedSpinLock spinlock(&mapped_allocations_lock);
+    return find_mapped_allocation(mem) != NULL;
+}
+
+// Whether mem is a zero-copy buffer that the host currently has mapped.
+WEAK bool is_host_mapped(cl_mem mem) {
+    ScopedSpinLock spinlock(&mapped_allocations_lock);
+    mapped_allocation *m = find_mapped_allocation(mem);
+    return m != NULL && m->mapped;
+}
+
+// Unmap a zero-copy buffer, if it is one and is mapped, so that the
+// device can use it. Commands enqueued after this one see the writes
+// made through the mapping. Does nothing for other buffers.
+WEAK int unmap_for_device(void *user_context, cl_command_queue q, cl_mem mem) {
+    uint8_t *host = NULL;
+    {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        mapped_allocation *m = find_mapped_allocation(mem);
+        if (m == NULL || !m->mapped) {
+            return CL_SUCCESS;
+        }
+        m->mapped = false;
+        host = m->host;
+    }
+    debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)mem << "\n";
+    cl_int err = clEnqueueUnmapMemObject(q, mem, host, 0, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clEnqueueUnmapMemObject failed: "
+                            << get_opencl_error_name(err);
+    }
+    return err;
+}
+
+// Map a zero-copy buffer back into host memory, if it is one and isn't
+// mapped, waiting for the device to finish with it. Does nothing for
+// other buffers.
+WEAK int map_for_host(void *user_context, cl_command_queue q, cl_mem mem) {
+    uint8_t *host = NULL;
+    size_t size = 0;
+    {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        mapped_allocation *m = find_mapped_allocation(mem);
+        if (m == NULL || m->mapped) {
+            return CL_SUCCESS;
+        }
+        m->mapped = true;
+        host = m->host;
+        size = m->size;
+    }
+    debug(user_context) << "    clEnqueueMapBuffer " << (void *)mem << "\n";
+    cl_int err;
+    void *p = clEnqueueMapBuffer(q, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                 0, size, 0, NULL, NULL, &err);
+    if (err == CL_SUCCESS && p != host) {
+        // The host pointer of the buffer can't move under the user.
+        clEnqueueUnmapMemObject(q, mem, p, 0, NULL, NULL);
+        error(user_context) << "CL: zero-copy buffer " << (void *)mem
+                            << " was mapped to " << p << " instead of " << host << "\n";
+        err = CL_MAP_FAILURE;
+    } else if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clEnqueueMapBuffer failed: "
+                            << get_opencl_error_name(err);
+    }
+    if (err != CL_SUCCESS) {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        mapped_allocation *m = find_mapped_allocation(mem);
+        if (m) {
+            m->mapped = false;
+        }
+    }
+    return err;
+}
+
+// Stop treating mem as a zero-copy buffer, unmapping it if necessary.
+WEAK int forget_mapped_allocation(void *user_context, cl_command_queue q, cl_mem mem) {
+    mapped_allocation *found = NULL;
+    {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        mapped_allocation **prev_ptr = &mapped_allocations;
+        for (mapped_allocation *m = mapped_allocations; m != NULL; m = m->next) {
+            if (m->mem == mem) {
+                *prev_ptr = m->next;
+                found = m;
+                break;
+            }
+            prev_ptr = &m->next;
+        }
+    }
+    if (found == NULL) {
+        return CL_SUCCESS;
+    }
+    cl_int err = CL_SUCCESS;
+    if (found->mapped) {
+        debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)mem << "\n";
+        err = clEnqueueUnmapMemObject(q, mem, found->host, 0, NULL, NULL);
+    }
+    free(found);
+    return err;
+}
+
+#ifdef ZERO_COPY
+// Make a buffer that uses the given host allocation as its storage,
+// tracked as a zero-copy buffer that starts out unmapped. Returns NULL
+// if the implementation can't do that, in which case the caller
+// should fall back to a separate device allocation.
+WEAK cl_mem wrap_host_allocation(void *user_context, cl_context ctx, uint8_t *host, size_t size) {
+    mapped_allocation *m = (mapped_allocation *)malloc(sizeof(mapped_allocation));
+    if (m == NULL) {
+        return NULL;
+    }
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer CL_MEM_USE_HOST_PTR " << (void *)host << " -> " << (int)size << " ";
+    cl_mem mem = clCreateBuffer(ctx, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, size, host, &err);
+    if (err != CL_SUCCESS || mem == 0) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        free(m);
+        return NULL;
+    }
+    debug(user_context) << (void *)mem << "\n";
+    m->mem = mem;
+    m->host = host;
+    m->size = size;
+    m->mapped = false;
+    {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        m->next = mapped_allocations;
+        mapped_allocations = m;
+    }
+    return mem;
+}
+#endif
+
+// Build the program for a module. This happens on the first launch of
+// one of its kernels, rather than when the pipeline starts.
+WEAK int build_program(void *user_context, cl_context context, module_state *state) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    cl_int err = 0;
+    cl_device_id dev;
+
+    err = clGetContextInfo(context, CL_CONTEXT_DEVICES, sizeof(dev), &dev, NULL);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clGetContextInfo(CL_CONTEXT_DEVICES) failed: "
+                            << get_opencl_error_name(err);
+        return err;
+    }
+
+    cl_device_id devices[] = { dev };
+
+    // Get the max constant buffer size supported by this OpenCL implementation.
+    cl_ulong max_constant_buffer_size = 0;
+    err = clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(max_constant_buffer_size), &max_constant_buffer_size, NULL);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clGetDeviceInfo (CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE) failed: "
+                            << get_opencl_error_name(err);
+        return err;
+    }
+    // Get the max number of constant arguments supported by this OpenCL implementation.
+    cl_uint max_constant_args = 0;
+    err = clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_ARGS, sizeof(max_constant_args), &max_constant_args, NULL);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clGetDeviceInfo (CL_DEVICE_MAX_CONSTANT_ARGS) failed: "
+                            << get_opencl_error_name(err);
+        return err;
+    }
+
+    // Build the compile argument options.
+    stringstream options(user_context);
+    options << "-D MAX_CONSTANT_BUFFER_SIZE=" << max_constant_buffer_size
+            << " -D MAX_CONSTANT_ARGS=" << max_constant_args;
+
+    // Try the on-disk kernel cache before building from source.
+    KernelCacheKey cache_key;
+    cl_program program = NULL;
+    if (kernel_cache_dir()) {
+        cache_key = make_kernel_cache_key(dev, state->src, state->size, options.str());
+        program = load_cached_program(user_context, context, dev, cache_key, options.str());
+    }
+
+    if (program) {
+        state->program = program;
+    } else {
+        const char * sources[] = { state->src };
+        debug(user_context) << "    clCreateProgramWithSource -> ";
+        program = clCreateProgramWithSource(context, 1, &sources[0], NULL, &err );
+        if (err != CL_SUCCESS) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateProgramWithSource failed: "
+                                << get_opencl_error_name(err);
+            return err;
+        } else {
+            debug(user_context) << (void *)program << "\n";
+        }
+        state->program = program;
+
+        debug(user_context) << "    clBuildProgram " << (void *)program
+                            << " " << options.str() << "\n";
+        err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
+        if (err != CL_SUCCESS) {
+
+            // Allocate an appropriately sized buffer for the build log.
+            char buffer[8192];
+
+            // Get build log
+            if (clGetProgramBuildInfo(program, dev,
+                                      CL_PROGRAM_BUILD_LOG,
+                                      sizeof(buffer), buffer,
+                                      NULL) == CL_SUCCESS) {
+                error(user_context) << "CL: clBuildProgram failed: "
+                                    << get_opencl_error_name(err)
+                                    << "\nBuild Log:\n"
+                                    << buffer << "\n";
+            } else {
+                error(user_context) << "clGetProgramBuildInfo failed";
+            }
+
+            return err;
+        }
+
+        if (kernel_cache_dir()) {
+            store_program_binary(user_context, program, cache_key);
+        }
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time to build program: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 extern "C" {
@@ -498,8 +1071,25 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
+    forget_mapped_allocation(user_context, ctx.cmd_queue, dev_ptr);
+
+    // Only keep allocations that were made by halide_opencl_device_malloc
+    // for this buffer; those are exactly the quantized size.
+    size_t size = quantize_allocation_size(buf->size_in_bytes());
+    size_t real_size = 0;
+    cl_mem_flags flags = 0;
+    cl_int result = CL_SUCCESS;
+    if (clGetMemObjectInfo(dev_ptr, CL_MEM_SIZE, sizeof(real_size), &real_size, NULL) == CL_SUCCESS &&
+        clGetMemObjectInfo(dev_ptr, CL_MEM_FLAGS, sizeof(flags), &flags, NULL) == CL_SUCCESS &&
+        real_size == size &&
+        !(flags & CL_MEM_USE_HOST_PTR) &&
+        cache_unused_allocation(ctx.context, dev_ptr, size, flags)) {
+        debug(user_context) << "    caching unused allocation " << (void *)dev_ptr << "\n";
+    } else {
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        mem_generation++;
+        result = clReleaseMemObject((cl_mem)dev_ptr);
+    }
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
     // we just end our reference to it regardless.
     free((device_handle *)buf->device);
@@ -528,15 +1118,6 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
         << ", program: " << (void *)src
         << ", size: " << size << "\n";
 
-    ClContext ctx(user_context);
-    if (ctx.error != CL_SUCCESS) {
-        return ctx.error;
-    }
-
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-    #endif
-
     // Create the state object if necessary. This only happens once, regardless
     // of how many times halide_init_kernels/halide_release is called.
     // halide_release traverses this list and releases the program objects, but
@@ -545,90 +1126,17 @@ WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr,
     if (!(*state)) {
         *state = (module_state*)malloc(sizeof(module_state));
         (*state)->program = NULL;
+        (*state)->src = src;
+        (*state)->size = size;
+        (*state)->kernels = NULL;
         (*state)->next = state_list;
         state_list = *state;
     }
 
-    // Create the program if necessary. TODO: The program object needs to not
-    // only already exist, but be created for the same context/device as the
-    // calling context/device.
-    if (!(*state && (*state)->program) && size > 1) {
-        cl_int err = 0;
-        cl_device_id dev;
-
-        err = clGetContextInfo(ctx.context, CL_CONTEXT_DEVICES, sizeof(dev), &dev, NULL);
-        if (err != CL_SUCCESS) {
-            error(user_context) << "CL: clGetContextInfo(CL_CONTEXT_DEVICES) failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        }
-
-        cl_device_id devices[] = { dev };
-
-        // Get the max constant buffer size supported by this OpenCL implementation.
-        cl_ulong max_constant_buffer_size = 0;
-        err = clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE, sizeof(max_constant_buffer_size), &max_constant_buffer_size, NULL);
-        if (err != CL_SUCCESS) {
-            error(user_context) << "CL: clGetDeviceInfo (CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE) failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        }
-        // Get the max number of constant arguments supported by this OpenCL implementation.
-        cl_uint max_constant_args = 0;
-        err = clGetDeviceInfo(dev, CL_DEVICE_MAX_CONSTANT_ARGS, sizeof(max_constant_args), &max_constant_args, NULL);
-        if (err != CL_SUCCESS) {
-            error(user_context) << "CL: clGetDeviceInfo (CL_DEVICE_MAX_CONSTANT_ARGS) failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        }
-
-        // Build the compile argument options.
-        stringstream options(user_context);
-        options << "-D MAX_CONSTANT_BUFFER_SIZE=" << max_constant_buffer_size
-                << " -D MAX_CONSTANT_ARGS=" << max_constant_args;
-
-        const char * sources[] = { src };
-        debug(user_context) << "    clCreateProgramWithSource -> ";
-        cl_program program = clCreateProgramWithSource(ctx.context, 1, &sources[0], NULL, &err );
-        if (err != CL_SUCCESS) {
-            debug(user_context) << get_opencl_error_name(err) << "\n";
-            error(user_context) << "CL: clCreateProgramWithSource failed: "
-                                << get_opencl_error_name(err);
-            return err;
-        } else {
-            debug(user_context) << (void *)program << "\n";
-        }
-        (*state)->program = program;
-
-        debug(user_context) << "    clBuildProgram " << (void *)program
-                            << " " << options.str() << "\n";
-        err = clBuildProgram(program, 1, devices, options.str(), NULL, NULL );
-        if (err != CL_SUCCESS) {
-
-            // Allocate an appropriately sized buffer for the build log.
-            char buffer[8192];
-
-            // Get build log
-            if (clGetProgramBuildInfo(program, dev,
-                                      CL_PROGRAM_BUILD_LOG,
-                                      sizeof(buffer), buffer,
-                                      NULL) == CL_SUCCESS) {
-                error(user_context) << "CL: clBuildProgram failed: "
-                                    << get_opencl_error_name(err)
-                                    << "\nBuild Log:\n"
-                                    << buffer << "\n";
-            } else {
-                error(user_context) << "clGetProgramBuildInfo failed";
-            }
-
-            return err;
-        }
-    }
-
-    #ifdef DEBUG_RUNTIME
-    uint64_t t_after = halide_current_time_ns(user_context);
-    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-    #endif
+    // The program is built by the first halide_opencl_run that needs
+    // it. TODO: The program object needs to not only already exist,
+    // but be created for the same context/device as the calling
+    // context/device.
 
     return 0;
 }
@@ -677,6 +1185,9 @@ WEAK int halide_opencl_device_release(void *user_context) {
         err = clFinish(q);
         halide_assert(user_context, err == CL_SUCCESS);
 
+        // Release all the unused allocations on this context.
+        release_unused_allocations(user_context, ctx, 0);
+
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the program objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -684,6 +1195,7 @@ WEAK int halide_opencl_device_release(void *user_context) {
         // object.
         module_state *state = state_list;
         while (state) {
+            release_kernel_states(user_context, state);
             if (state->program) {
                 debug(user_context) << "    clReleaseProgram " << state->program << "\n";
                 err = clReleaseProgram(state->program);
@@ -707,11 +1219,53 @@ WEAK int halide_opencl_device_release(void *user_context) {
         }
     }
 
+    release_crop_handles(crop_handles);
+
     halide_release_cl_context(user_context);
 
     return 0;
 }
 
+WEAK int halide_opencl_release_unused_device_allocations(void *user_context) {
+    debug(user_context)
+        << "CL: halide_opencl_release_unused_device_allocations (user_context: " << user_context << ")\n";
+
+    // If we haven't even loaded OpenCL, there can't be anything to release.
+    if (clCreateContext == NULL) {
+        return 0;
+    }
+
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+
+    return release_unused_allocations(user_context, ctx.context, 0);
+}
+
+WEAK int halide_opencl_set_max_cached_device_bytes(void *user_context, size_t max_bytes) {
+    {
+        ScopedSpinLock spinlock(&unused_allocations_lock);
+        max_cached_device_bytes = max_bytes;
+        if (cached_device_bytes <= max_bytes) {
+            return 0;
+        }
+    }
+
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+
+    return release_unused_allocations(user_context, ctx.context, max_bytes);
+}
+
+WEAK bool halide_opencl_set_alloc_host_ptr(bool use) {
+    bool old = alloc_host_ptr;
+    alloc_host_ptr = use;
+    return old;
+}
+
 WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
     debug(user_context)
         << "CL: halide_opencl_device_malloc (user_context: " << user_context
@@ -745,17 +1299,39 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t* buf) {
         return CL_OUT_OF_HOST_MEMORY;
     }
 
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
-    if (err != CL_SUCCESS || dev_ptr == 0) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateBuffer failed: "
-                            << get_opencl_error_name(err);
-        free(dev_handle);
-        return err;
-    } else {
-        debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+    cl_mem_flags flags = CL_MEM_READ_WRITE;
+    if (alloc_host_ptr) {
+        flags |= CL_MEM_ALLOC_HOST_PTR;
+    }
+
+    size_t alloc_size = quantize_allocation_size(size);
+    cl_mem dev_ptr = NULL;
+#ifdef ZERO_COPY
+    // Let the device use the host allocation directly, if there is one.
+    if (buf->host) {
+        dev_ptr = wrap_host_allocation(user_context, ctx.context, buf->host, size);
+    }
+#endif
+    if (dev_ptr == NULL && (dev_ptr = take_unused_allocation(ctx.context, alloc_size, flags)) != NULL) {
+        debug(user_context) << "    reusing unused allocation " << (void *)dev_ptr << "\n";
+    } else if (dev_ptr == NULL) {
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer -> " << (int)alloc_size << " ";
+        dev_ptr = clCreateBuffer(ctx.context, flags, alloc_size, NULL, &err);
+        if (err == CL_MEM_OBJECT_ALLOCATION_FAILURE || err == CL_OUT_OF_RESOURCES) {
+            // Release the allocations we're holding on to and retry.
+            release_unused_allocations(user_context, ctx.context, 0);
+            dev_ptr = clCreateBuffer(ctx.context, flags, alloc_size, NULL, &err);
+        }
+        if (err != CL_SUCCESS || dev_ptr == 0) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateBuffer failed: "
+                                << get_opencl_error_name(err);
+            free(dev_handle);
+            return err;
+        } else {
+            debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+        }
     }
 
     dev_handle->mem = dev_ptr;
@@ -879,12 +1455,57 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
         #endif
 
-        err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        int profiled_func = profiled_device_func();
+        uint64_t t_copy = profiled_func >= 0 ? halide_current_time_ns(user_context) : 0;
+
+        // Zero-copy buffers only need to be handed back and forth
+        // between the host and the device. A zero-copy buffer the host
+        // doesn't have mapped is written in full, as the host writes
+        // may not have reached the device. Otherwise, make sure each
+        // side of the copy is where the copy expects it to be.
+        cl_mem src_mem = (src->device && src->device_interface == &opencl_device_interface) ?
+            ((device_handle *)src->device)->mem : NULL;
+        cl_mem dst_mem = (dst->device && dst->device_interface == &opencl_device_interface) ?
+            ((device_handle *)dst->device)->mem : NULL;
+        bool in_place = false;
+        if (src == dst && from_host != to_host && src_mem && is_mapped_allocation(src_mem) &&
+            (to_host || is_host_mapped(src_mem))) {
+            in_place = true;
+            err = to_host ?
+                map_for_host(user_context, ctx.cmd_queue, src_mem) :
+                unmap_for_device(user_context, ctx.cmd_queue, src_mem);
+        } else {
+            // A buffer that is copied onto itself only needs to be in
+            // place for the destination.
+            if (src_mem && src_mem != dst_mem) {
+                err = from_host ?
+                    map_for_host(user_context, ctx.cmd_queue, src_mem) :
+                    unmap_for_device(user_context, ctx.cmd_queue, src_mem);
+            }
+            if (err == 0 && dst_mem) {
+                err = to_host ?
+                    map_for_host(user_context, ctx.cmd_queue, dst_mem) :
+                    unmap_for_device(user_context, ctx.cmd_queue, dst_mem);
+            }
+        }
+
+        if (err == 0 && !in_place) {
+            err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        }
 
         // The reads/writes above are all non-blocking, so empty the command
         // queue before we proceed so that other host code won't write
-        // to the buffer while the above writes are still running.
-        clFinish(ctx.cmd_queue);
+        // to the buffer while the above writes are still running. Device
+        // to device copies, and mapping or unmapping in place, don't touch
+        // host memory the caller owns, so they can stay queued behind
+        // the kernels. The profiler times copies to completion.
+        if ((!in_place && (from_host || to_host)) || profiled_func >= 0) {
+            clFinish(ctx.cmd_queue);
+        }
+
+        if (profiled_func >= 0) {
+            halide_profiler_record_gpu_time(profiled_func, 0, halide_current_time_ns(user_context) - t_copy);
+        }
 
         #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -936,22 +1557,30 @@ WEAK int halide_opencl_run(void *user_context,
 
     // Create kernel object for entry_name from the program for this module.
     halide_assert(user_context, state_ptr);
-    cl_program program = ((module_state*)state_ptr)->program;
+    module_state *state = (module_state*)state_ptr;
+    if (!state->program && state->size > 1) {
+        err = build_program(user_context, ctx.context, state);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+    }
+    halide_assert(user_context, state->program);
 
-    halide_assert(user_context, program);
-    debug(user_context) << "    clCreateKernel " << entry_name << " -> ";
-    cl_kernel f = clCreateKernel(program, entry_name, &err);
-    if (err != CL_SUCCESS) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateKernel " << entry_name << " failed: "
-                            << get_opencl_error_name(err) << "\n";
+    int num_args = 0;
+    while (arg_sizes[num_args] != 0) {
+        num_args++;
+    }
+    // One more for the shared memory.
+    kernel_state *kernel = get_kernel_state(user_context, state, entry_name, num_args + 1, &err);
+    if (kernel == NULL) {
         return err;
-    } else {
-        #ifdef DEBUG_RUNTIME
-        uint64_t t_create_kernel = halide_current_time_ns(user_context);
-        debug(user_context) << "    Time: " << (t_create_kernel - t_before) / 1.0e6 << " ms\n";
-        #endif
     }
+    cl_kernel f = kernel->kernel;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_create_kernel = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_create_kernel - t_before) / 1.0e6 << " ms\n";
+    #endif
 
     // Pack dims
     size_t global_dim[3] = {(size_t) blocksX*threadsX,  (size_t) blocksY*threadsY, (size_t) blocksZ*threadsZ};
@@ -993,7 +1622,10 @@ WEAK int halide_opencl_run(void *user_context,
             cl_mem mem = ((device_handle *)((halide_buffer_t *)this_arg)->device)->mem;
             uint64_t offset = ((device_handle *)((halide_buffer_t *)this_arg)->device)->offset;
 
-            if (offset != 0) {
+            // The kernel can't use a zero-copy buffer while the host has it mapped.
+            err = unmap_for_device(user_context, ctx.cmd_queue, mem);
+
+            if (err == CL_SUCCESS && offset != 0) {
                 cl_buffer_region region = {(size_t)offset, ((halide_buffer_t *)this_arg)->size_in_bytes()};
                 // The sub-buffer encompasses the linear range of addresses that
                 // span the crop.
@@ -1002,10 +1634,16 @@ WEAK int halide_opencl_run(void *user_context,
             }
             if (err == CL_SUCCESS) {
                 debug(user_context) << "Mapped dev handle is: " << (void *)mem << "\n";
-                err = clSetKernelArg(f, i, sizeof(mem), &mem);
+                if (offset != 0) {
+                    // Sub-buffers are made fresh for each launch.
+                    kernel->args[i].size = 0;
+                    err = clSetKernelArg(f, i, sizeof(mem), &mem);
+                } else {
+                    err = set_kernel_arg(kernel, i, sizeof(mem), &mem, true);
+                }
             }
         } else {
-            err = clSetKernelArg(f, i, arg_sizes[i], this_arg);
+            err = set_kernel_arg(kernel, i, arg_sizes[i], this_arg, false);
         }
 
         if (err != CL_SUCCESS) {
@@ -1023,13 +1661,20 @@ WEAK int halide_opencl_run(void *user_context,
     // Always set at least 1 byte of shmem, to keep the launch happy
     debug(user_context)
         << "    clSetKernelArg " << i << " " << shared_mem_bytes << " [NULL]\n";
-    err = clSetKernelArg(f, i, (shared_mem_bytes > 0) ? shared_mem_bytes : 1, NULL);
+    err = set_kernel_arg(kernel, i, (shared_mem_bytes > 0) ? shared_mem_bytes : 1, NULL, false);
     if (err != CL_SUCCESS) {
         error(user_context) << "CL: clSetKernelArg failed "
                             << get_opencl_error_name(err);
         return err;
     }
 
+    // The queue isn't created with profiling enabled, so kernels run
+    // by a profiled pipeline are timed on the host clock, from the
+    // enqueue until the queue is empty. The copies empty the queue,
+    // and so does this, so only this kernel is in flight.
+    int profiled_func = profiled_device_func();
+    uint64_t t_launch = profiled_func >= 0 ? halide_current_time_ns(user_context) : 0;
+
     // Launch kernel
     debug(user_context)
         << "    clEnqueueNDRangeKernel "
@@ -1055,9 +1700,9 @@ WEAK int halide_opencl_run(void *user_context,
         return err;
     }
 
-    debug(user_context) << "    Releasing kernel " << (void *)f << "\n";
-    clReleaseKernel(f);
-    debug(user_context) << "    clReleaseKernel finished" << (void *)f << "\n";
+    if (profiled_func >= 0 && clFinish(ctx.cmd_queue) == CL_SUCCESS) {
+        halide_profiler_record_gpu_time(profiled_func, halide_current_time_ns(user_context) - t_launch, 0);
+    }
 
     #ifdef DEBUG_RUNTIME
     err = clFinish(ctx.cmd_queue);
@@ -1072,11 +1717,73 @@ WEAK int halide_opencl_run(void *user_context,
 }
 
 WEAK int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    if (!alloc_host_ptr) {
+        return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    }
+
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    // Use a mapping of a CL_MEM_ALLOC_HOST_PTR buffer as the host
+    // allocation.
+    int result = halide_opencl_device_malloc(user_context, buf);
+    if (result != 0) {
+        return result;
+    }
+
+    mapped_allocation *m = (mapped_allocation *)malloc(sizeof(mapped_allocation));
+    if (m == NULL) {
+        halide_opencl_device_free(user_context, buf);
+        return halide_error_code_out_of_memory;
+    }
+    m->mem = ((device_handle *)buf->device)->mem;
+    m->size = buf->size_in_bytes();
+    m->mapped = true;
+
+    cl_int err = CL_SUCCESS;
+    {
+        ClContext ctx(user_context);
+        if (ctx.error != CL_SUCCESS) {
+            err = ctx.error;
+        } else {
+            debug(user_context) << "    clEnqueueMapBuffer " << (void *)m->mem << "\n";
+            m->host = (uint8_t *)clEnqueueMapBuffer(ctx.cmd_queue, m->mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                                    0, m->size, 0, NULL, NULL, &err);
+            if (err != CL_SUCCESS) {
+                error(user_context) << "CL: clEnqueueMapBuffer failed: "
+                                    << get_opencl_error_name(err);
+            }
+        }
+    }
+    if (err != CL_SUCCESS) {
+        free(m);
+        halide_opencl_device_free(user_context, buf);
+        return err;
+    }
+
+    {
+        ScopedSpinLock spinlock(&mapped_allocations_lock);
+        m->next = mapped_allocations;
+        mapped_allocations = m;
+    }
+    buf->host = m->host;
+    return 0;
 }
 
 WEAK int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    if (buf->device == 0 ||
+        buf->device_interface != &opencl_device_interface ||
+        !is_mapped_allocation(((device_handle *)buf->device)->mem)) {
+        return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    }
+
+    // The host allocation goes away with the device allocation.
+    int result = halide_opencl_device_free(user_context, buf);
+    buf->host = NULL;
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *buf, uint64_t mem) {
@@ -1110,6 +1817,8 @@ WEAK int halide_opencl_detach_cl_mem(void *user_context, halide_buffer_t *buf) {
         return 0;
     }
     halide_assert(user_context, buf->device_interface == &opencl_device_interface);
+    // The application may release the cl_mem now.
+    mem_generation++;
     free((device_handle *)buf->device);
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -1146,7 +1855,7 @@ WEAK int opencl_device_crop_from_offset(void *user_context,
 
     dst->device_interface = src->device_interface;
 
-    device_handle *new_dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    device_handle *new_dev_handle = get_crop_handle(crop_handles);
     if (new_dev_handle == NULL) {
         error(user_context) << "CL: malloc failed making device handle for crop.\n";
         return halide_error_code_out_of_memory;
@@ -1201,8 +1910,9 @@ WEAK int halide_opencl_device_release_crop(void *user_context,
     halide_assert(user_context, validate_device_pointer(user_context, buf));
     debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
     // Sub-buffers are released with clReleaseMemObject
+    mem_generation++;
     cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
-    free((device_handle *)buf->device);
+    put_crop_handle(crop_handles, (device_handle *)buf->device);
     if (result != CL_SUCCESS) {
         // We may be called as a destructor, so don't raise an error
         // here.
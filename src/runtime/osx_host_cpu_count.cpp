@@ -8,4 +8,12 @@ WEAK int halide_host_cpu_count() {
     return sysconf(58);
 }
 
+WEAK int halide_host_cpu_nodes(int *cpu_node, int num_cpus) {
+    return 0;
+}
+
+WEAK int halide_pin_current_thread(int cpu) {
+    return -1;
+}
+
 }
@@ -0,0 +1,193 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "printer.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Paging {
+
+const int kMaxPagedDimensions = 4;
+
+WEAK halide_page_provider_t custom_page_provider = NULL;
+
+WEAK int floor_div(int a, int b) {
+    int q = a / b;
+    return (q * b > a) ? q - 1 : q;
+}
+
+// Copy the box [min, min + extent) from src to dst, which must both
+// contain it.
+WEAK void copy_box(const halide_buffer_t *src, const halide_buffer_t *dst,
+                   const int *min, const int *extent) {
+    const int d = dst->dimensions;
+    const int elem_size = dst->type.bytes();
+
+    int64_t src_off = 0, dst_off = 0;
+    for (int i = 0; i < d; i++) {
+        src_off += (int64_t)(min[i] - src->dim[i].min) * src->dim[i].stride;
+        dst_off += (int64_t)(min[i] - dst->dim[i].min) * dst->dim[i].stride;
+    }
+    const uint8_t *src_row = src->host + src_off * elem_size;
+    uint8_t *dst_row = dst->host + dst_off * elem_size;
+
+    const bool dense = src->dim[0].stride == 1 && dst->dim[0].stride == 1;
+    int pos[kMaxPagedDimensions] = {0, 0, 0, 0};
+    while (true) {
+        if (dense) {
+            memcpy(dst_row, src_row, (size_t)extent[0] * elem_size);
+        } else {
+            for (int x = 0; x < extent[0]; x++) {
+                memcpy(dst_row + (int64_t)x * dst->dim[0].stride * elem_size,
+                       src_row + (int64_t)x * src->dim[0].stride * elem_size,
+                       elem_size);
+            }
+        }
+
+        // Advance to the next row, dimension 1 fastest.
+        int i = 1;
+        for (; i < d; i++) {
+            src_row += (int64_t)src->dim[i].stride * elem_size;
+            dst_row += (int64_t)dst->dim[i].stride * elem_size;
+            if (++pos[i] < extent[i]) {
+                break;
+            }
+            src_row -= (int64_t)src->dim[i].stride * extent[i] * elem_size;
+            dst_row -= (int64_t)dst->dim[i].stride * extent[i] * elem_size;
+            pos[i] = 0;
+        }
+        if (i >= d) {
+            return;
+        }
+    }
+}
+
+}}}}  // namespace Halide::Runtime::Internal::Paging
+
+using namespace Halide::Runtime::Internal::Paging;
+
+extern "C" {
+
+WEAK halide_page_provider_t halide_set_page_provider(halide_page_provider_t provider) {
+    halide_page_provider_t result = custom_page_provider;
+    custom_page_provider = provider;
+    return result;
+}
+
+WEAK int halide_paged_input(void *user_context, const char *name,
+                            int32_t page_extent_0, int32_t page_extent_1,
+                            int32_t page_extent_2, int32_t page_extent_3,
+                            halide_buffer_t *out) {
+    if (out->is_bounds_query()) {
+        // Any region can be produced.
+        return 0;
+    }
+
+    const int d = out->dimensions;
+    const int32_t page_extent[kMaxPagedDimensions] = {
+        page_extent_0, page_extent_1, page_extent_2, page_extent_3
+    };
+    if (d < 1 || d > kMaxPagedDimensions) {
+        error(user_context) << "Paged input " << name << " has " << d
+                            << " dimensions, but at most " << kMaxPagedDimensions
+                            << " are supported\n";
+        return halide_error_code_bad_dimensions;
+    }
+    for (int i = 0; i < d; i++) {
+        if (page_extent[i] <= 0) {
+            error(user_context) << "Paged input " << name << " has a page extent of "
+                                << page_extent[i] << " in dimension " << i << "\n";
+            return halide_error_code_bad_dimensions;
+        }
+    }
+    if (custom_page_provider == NULL) {
+        error(user_context) << "Paged input " << name
+                            << " was realized, but no page provider is set\n";
+        return halide_error_code_generic_error;
+    }
+
+    // The cache key is the name, then the type, then the coordinates
+    // of the page in units of pages.
+    const size_t name_size = strlen(name) + 1;
+    const size_t key_size = name_size + sizeof(halide_type_t) + d * sizeof(int32_t);
+    uint8_t *key = (uint8_t *)halide_malloc(user_context, key_size);
+    if (key == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+    memcpy(key, name, name_size);
+    memcpy(key + name_size, &out->type, sizeof(halide_type_t));
+    int32_t *key_coords = (int32_t *)(key + name_size + sizeof(halide_type_t));
+
+    int first_page[kMaxPagedDimensions], last_page[kMaxPagedDimensions];
+    int page[kMaxPagedDimensions];
+    for (int i = 0; i < d; i++) {
+        first_page[i] = floor_div(out->dim[i].min, page_extent[i]);
+        last_page[i] = floor_div(out->dim[i].min + out->dim[i].extent - 1, page_extent[i]);
+        page[i] = first_page[i];
+    }
+
+    int result = 0;
+    while (true) {
+        // Pages are dense, with dimension 0 innermost.
+        halide_dimension_t page_shape[kMaxPagedDimensions];
+        int32_t stride = 1;
+        for (int i = 0; i < d; i++) {
+            page_shape[i] = halide_dimension_t(page[i] * page_extent[i], page_extent[i], stride);
+            stride *= page_extent[i];
+        }
+        memcpy(key_coords, page, d * sizeof(int32_t));
+
+        halide_buffer_t bounds = {0};
+        bounds.dimensions = d;
+        bounds.dim = page_shape;
+
+        halide_buffer_t page_buf = {0};
+        page_buf.type = out->type;
+        page_buf.dimensions = d;
+        page_buf.dim = page_shape;
+        halide_buffer_t *page_bufs = &page_buf;
+
+        int lookup = halide_memoization_cache_lookup(user_context, key, (int32_t)key_size,
+                                                     &bounds, 1, &page_bufs);
+        if (lookup < 0) {
+            result = halide_error_code_out_of_memory;
+            break;
+        }
+        if (lookup == 1) {
+            // A miss: ask the provider for the page, and keep it
+            // for later calls.
+            result = custom_page_provider(user_context, name, &page_buf);
+            if (result != 0) {
+                halide_memoization_cache_release(user_context, page_buf.host);
+                break;
+            }
+            halide_memoization_cache_store(user_context, key, (int32_t)key_size,
+                                           &bounds, 1, &page_bufs);
+        }
+
+        int box_min[kMaxPagedDimensions], box_extent[kMaxPagedDimensions];
+        for (int i = 0; i < d; i++) {
+            int lo = max(out->dim[i].min, page_shape[i].min);
+            int hi = min(out->dim[i].min + out->dim[i].extent,
+                         page_shape[i].min + page_shape[i].extent);
+            box_min[i] = lo;
+            box_extent[i] = hi - lo;
+        }
+        copy_box(&page_buf, out, box_min, box_extent);
+        halide_memoization_cache_release(user_context, page_buf.host);
+
+        // Advance to the next page, dimension 0 fastest.
+        int i = 0;
+        for (; i < d; i++) {
+            if (++page[i] <= last_page[i]) {
+                break;
+            }
+            page[i] = first_page[i];
+        }
+        if (i == d) {
+            break;
+        }
+    }
+
+    halide_free(user_context, key);
+    return result;
+}
+
+}  // extern "C"
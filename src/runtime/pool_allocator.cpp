@@ -0,0 +1,168 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Pool {
+
+// Blocks are rounded up to one of four size classes per power of two,
+// from 64 bytes up to 16MB. Anything larger goes straight to
+// halide_default_malloc.
+const int kMinLog2 = 6;
+const int kMaxLog2 = 24;
+const int kNumClasses = 1 + (kMaxLog2 - kMinLog2) * 4;
+const size_t kLargeClass = (size_t)-1;
+
+// The free lists are striped to cut down on lock contention. Each
+// thread mostly sticks to one stripe, so blocks freed on a thread
+// tend to be handed back out to the same thread.
+const int kNumStripes = 8;
+
+// Each stripe holds on to at most this many bytes of free blocks.
+const size_t kMaxCachedBytesPerStripe = 16 << 20;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+struct Stripe {
+    halide_mutex lock;
+    FreeBlock *free_blocks[kNumClasses];
+    size_t cached_bytes;
+    // Pad to a cache line so that stripes don't share one.
+    char padding[64];
+};
+
+WEAK Stripe stripes[kNumStripes];
+
+WEAK int size_class(size_t x) {
+    if (x <= ((size_t)1 << kMinLog2)) {
+        return 0;
+    }
+    int log2 = 63 - __builtin_clzll((unsigned long long)(x - 1));
+    if (log2 >= kMaxLog2) {
+        return -1;
+    }
+    size_t base = (size_t)1 << log2;
+    size_t step = base >> 2;
+    int idx = (int)((x - 1 - base) / step);
+    return 1 + (log2 - kMinLog2) * 4 + idx;
+}
+
+WEAK size_t class_size(int c) {
+    if (c == 0) {
+        return (size_t)1 << kMinLog2;
+    }
+    int log2 = kMinLog2 + (c - 1) / 4;
+    int idx = (c - 1) % 4;
+    size_t base = (size_t)1 << log2;
+    return base + (idx + 1) * (base >> 2);
+}
+
+// Threads have distinct stacks, so the stack address picks a stripe
+// that is stable for each thread without needing thread-local
+// storage.
+WEAK Stripe &current_stripe() {
+    int local;
+    uint64_t a = (uint64_t)(uintptr_t)&local >> 20;
+    a *= 0x9E3779B97F4A7C15ULL;
+    return stripes[a >> 61];
+}
+
+// Each block has a header of one alignment unit before the pointer
+// handed out, with the size class stored in its last word.
+WEAK __attribute__((always_inline)) size_t &block_class(void *ptr) {
+    return ((size_t *)ptr)[-1];
+}
+
+WEAK void *allocate_block(void *user_context, size_t bytes, size_t c) {
+    const size_t alignment = halide_malloc_alignment();
+    uint8_t *orig = (uint8_t *)halide_default_malloc(user_context, bytes + alignment);
+    if (orig == NULL) {
+        return NULL;
+    }
+    void *ptr = orig + alignment;
+    block_class(ptr) = c;
+    return ptr;
+}
+
+WEAK void free_block(void *user_context, void *ptr) {
+    halide_default_free(user_context, (uint8_t *)ptr - halide_malloc_alignment());
+}
+
+}}}} // namespace Halide::Runtime::Internal::Pool
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::Pool;
+
+extern "C" {
+
+WEAK void *halide_pool_malloc(void *user_context, size_t x) {
+    int c = size_class(x);
+    if (c < 0) {
+        return allocate_block(user_context, x, kLargeClass);
+    }
+
+    Stripe &stripe = current_stripe();
+    {
+        ScopedMutexLock lock(&stripe.lock);
+        FreeBlock *block = stripe.free_blocks[c];
+        if (block != NULL) {
+            stripe.free_blocks[c] = block->next;
+            stripe.cached_bytes -= class_size(c);
+            return block;
+        }
+    }
+
+    return allocate_block(user_context, class_size(c), c);
+}
+
+WEAK void halide_pool_free(void *user_context, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    size_t c = block_class(ptr);
+    if (c == kLargeClass) {
+        free_block(user_context, ptr);
+        return;
+    }
+
+    size_t bytes = class_size((int)c);
+    Stripe &stripe = current_stripe();
+    {
+        ScopedMutexLock lock(&stripe.lock);
+        if (stripe.cached_bytes + bytes <= kMaxCachedBytesPerStripe) {
+            FreeBlock *block = (FreeBlock *)ptr;
+            block->next = stripe.free_blocks[c];
+            stripe.free_blocks[c] = block;
+            stripe.cached_bytes += bytes;
+            return;
+        }
+    }
+
+    free_block(user_context, ptr);
+}
+
+WEAK void halide_pool_trim(void *user_context) {
+    for (int i = 0; i < kNumStripes; i++) {
+        Stripe &stripe = stripes[i];
+        FreeBlock *to_free[kNumClasses];
+        {
+            ScopedMutexLock lock(&stripe.lock);
+            for (int c = 0; c < kNumClasses; c++) {
+                to_free[c] = stripe.free_blocks[c];
+                stripe.free_blocks[c] = NULL;
+            }
+            stripe.cached_bytes = 0;
+        }
+        for (int c = 0; c < kNumClasses; c++) {
+            FreeBlock *block = to_free[c];
+            while (block != NULL) {
+                FreeBlock *next = block->next;
+                free_block(user_context, block);
+                block = next;
+            }
+        }
+    }
+}
+
+}
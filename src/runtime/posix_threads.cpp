@@ -29,6 +29,7 @@ extern int pthread_mutex_init(pthread_mutex_t *mutex, const void *attr);
 extern int pthread_mutex_lock(pthread_mutex_t *mutex);
 extern int pthread_mutex_unlock(pthread_mutex_t *mutex);
 extern int pthread_mutex_destroy(pthread_mutex_t *mutex);
+extern pthread_t pthread_self();
 
 } // extern "C"
 
@@ -45,6 +46,10 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+WEAK uintptr_t halide_current_thread_id() {
+    return (uintptr_t)pthread_self();
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
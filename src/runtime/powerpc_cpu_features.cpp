@@ -7,6 +7,7 @@
 #define PPC_FEATURE_HAS_VSX     0x00000080
 
 #define PPC_FEATURE2_ARCH_2_07     0x80000000
+#define PPC_FEATURE2_ARCH_3_00     0x00800000
 
 extern "C" unsigned long int getauxval(unsigned long int);
 
@@ -16,6 +17,7 @@ WEAK CpuFeatures halide_get_cpu_features() {
     CpuFeatures features;
     features.set_known(halide_target_feature_vsx);
     features.set_known(halide_target_feature_power_arch_2_07);
+    features.set_known(halide_target_feature_power_arch_3_00);
 
     const unsigned long hwcap = getauxval(AT_HWCAP);
     const unsigned long hwcap2 = getauxval(AT_HWCAP2);
@@ -26,6 +28,9 @@ WEAK CpuFeatures halide_get_cpu_features() {
     if (hwcap2 & PPC_FEATURE2_ARCH_2_07) {
         features.set_available(halide_target_feature_power_arch_2_07);
     }
+    if (hwcap2 & PPC_FEATURE2_ARCH_3_00) {
+        features.set_available(halide_target_feature_power_arch_3_00);
+    }
     return features;
 }
 
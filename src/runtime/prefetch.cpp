@@ -10,4 +10,22 @@ WEAK int _halide_prefetch(const void *ptr) {
     return 0;
 }
 
+__attribute__((always_inline))
+WEAK int _halide_prefetch_l2(const void *ptr) {
+    __builtin_prefetch(ptr, 1, 2);
+    return 0;
+}
+
+__attribute__((always_inline))
+WEAK int _halide_prefetch_l3(const void *ptr) {
+    __builtin_prefetch(ptr, 1, 1);
+    return 0;
+}
+
+__attribute__((always_inline))
+WEAK int _halide_prefetch_nta(const void *ptr) {
+    __builtin_prefetch(ptr, 1, 0);
+    return 0;
+}
+
 }
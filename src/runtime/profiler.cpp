@@ -16,6 +16,83 @@ WEAK halide_profiler_state *halide_profiler_get_state() {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+#ifndef HALIDE_PROFILER_PERF_COUNTERS
+// Hardware performance counters are only read on some platforms (see
+// linux_profiler.cpp). These fill values with the cycles, instructions
+// and last-level cache misses so far.
+WEAK bool start_perf_counters() {
+    return false;
+}
+
+WEAK bool read_perf_counters(uint64_t *values) {
+    return false;
+}
+#endif
+
+WEAK bool perf_counters_started = false;
+WEAK bool perf_counters_enabled = false;
+
+// A parallel task recorded in the timeline.
+struct timeline_event {
+    uint64_t begin, end;
+    int func, slot;
+};
+
+struct profiler_timeline {
+    // The func and start time of the task in each slot.
+    uint64_t slot_begin[halide_profiler_task_slots];
+    int slot_func[halide_profiler_task_slots];
+
+    // The number of events there is room for, and the number of
+    // tasks that have finished, which may be more.
+    int capacity;
+    int count;
+
+    timeline_event *events;
+};
+
+// The file to write the timeline to at exit, if the timeline was
+// started by HL_PROFILER_TIMELINE.
+WEAK bool timeline_env_checked = false;
+WEAK const char *timeline_filename = NULL;
+
+WEAK int start_timeline_unlocked(void *user_context, halide_profiler_state *s, int max_events) {
+    halide_start_clock(user_context);
+    profiler_timeline *t = (profiler_timeline *)s->timeline;
+    if (t && t->capacity >= max_events) {
+        t->count = 0;
+        return 0;
+    }
+    if (t) {
+        s->timeline = NULL;
+        free(t->events);
+        free(t);
+    }
+    t = (profiler_timeline *)malloc(sizeof(profiler_timeline));
+    if (!t) {
+        return halide_error_out_of_memory(user_context);
+    }
+    t->events = (timeline_event *)malloc(max_events * sizeof(timeline_event));
+    if (!t->events) {
+        free(t);
+        return halide_error_out_of_memory(user_context);
+    }
+    t->capacity = max_events;
+    t->count = 0;
+    s->timeline = t;
+    return 0;
+}
+
+// Print a time in nanoseconds as a number of microseconds, which is
+// the unit of Chrome trace event timestamps.
+WEAK void print_microseconds(stringstream &sstr, uint64_t ns) {
+    uint64_t frac = ns % 1000;
+    sstr << ns / 1000 << ".";
+    if (frac < 100) sstr << "0";
+    if (frac < 10) sstr << "0";
+    sstr << frac;
+}
+
 WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipeline_name, int num_funcs, const uint64_t *func_names) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -45,6 +122,11 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->num_allocs = 0;
     p->active_threads_numerator = 0;
     p->active_threads_denominator = 0;
+    p->cycles = 0;
+    p->instructions = 0;
+    p->llc_misses = 0;
+    p->gpu_time = 0;
+    p->gpu_copy_time = 0;
     p->funcs = (halide_profiler_func_stats *)malloc(num_funcs * sizeof(halide_profiler_func_stats));
     if (!p->funcs) {
         free(p);
@@ -60,13 +142,21 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].task_time = 0;
+        p->funcs[i].idle_time = 0;
+        p->funcs[i].max_tasks = 0;
+        p->funcs[i].cycles = 0;
+        p->funcs[i].instructions = 0;
+        p->funcs[i].llc_misses = 0;
+        p->funcs[i].gpu_time = 0;
+        p->funcs[i].gpu_copy_time = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
     return p;
 }
 
-WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
+WEAK halide_profiler_pipeline_stats *find_pipeline_for_func(halide_profiler_state *s, int func_id) {
     halide_profiler_pipeline_stats *p_prev = NULL;
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
@@ -77,19 +167,146 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
                 p->next = s->pipelines;
                 s->pipelines = p;
             }
-            halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
-            f->time += time;
-            f->active_threads_numerator += active_threads;
-            f->active_threads_denominator += 1;
-            p->time += time;
-            p->samples++;
-            p->active_threads_numerator += active_threads;
-            p->active_threads_denominator += 1;
-            return;
+            return p;
         }
         p_prev = p;
     }
-    // Someone must have called reset_state while a kernel was running. Do nothing.
+    // Someone must have called reset_state while a kernel was running.
+    return NULL;
+}
+
+WEAK int write_timeline_unlocked(void *user_context, halide_profiler_state *s, const char *filename) {
+    profiler_timeline *t = (profiler_timeline *)s->timeline;
+    if (!t) {
+        error(user_context) << "Can't write the profiler timeline to " << filename
+                            << ", because halide_profiler_start_timeline hasn't been called.\n";
+        return halide_error_code_generic_error;
+    }
+
+    void *f = fopen(filename, "w");
+    if (!f) {
+        error(user_context) << "Failed to open " << filename << " for writing the profiler timeline.\n";
+        return halide_error_code_generic_error;
+    }
+
+    char line_buf[1024];
+    stringstream sstr(user_context, line_buf);
+    sstr << "{\"traceEvents\": [\n";
+    fwrite(sstr.str(), sstr.size(), 1, f);
+
+    int num_events = t->count < t->capacity ? t->count : t->capacity;
+    for (int i = 0; i < num_events; i++) {
+        const timeline_event &e = t->events[i];
+        halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, e.func);
+        sstr.clear();
+        if (i > 0) {
+            sstr << ",\n";
+        }
+        sstr << "{\"name\": \"" << (p ? p->funcs[e.func - p->first_func_id].name : "unknown")
+             << "\", \"cat\": \"" << (p ? p->name : "unknown")
+             << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << e.slot
+             << ", \"ts\": ";
+        print_microseconds(sstr, e.begin);
+        sstr << ", \"dur\": ";
+        print_microseconds(sstr, e.end - e.begin);
+        sstr << "}";
+        fwrite(sstr.str(), sstr.size(), 1, f);
+    }
+
+    sstr.clear();
+    sstr << "\n]}\n";
+    fwrite(sstr.str(), sstr.size(), 1, f);
+    fclose(f);
+
+    if (t->count > t->capacity) {
+        print(user_context) << "Warning: the profiler timeline only had room for " << t->capacity
+                            << " of " << t->count << " tasks.\n";
+    }
+    return 0;
+}
+
+WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
+    halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, func_id);
+    if (!p) return;
+    halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+    f->time += time;
+    f->active_threads_numerator += active_threads;
+    f->active_threads_denominator += 1;
+    p->time += time;
+    p->samples++;
+    p->active_threads_numerator += active_threads;
+    p->active_threads_denominator += 1;
+}
+
+// Bill the hardware counter increments since the last sample to the
+// current func, in the same way as the time.
+WEAK void bill_counters(halide_profiler_state *s, int func_id, const uint64_t *before, const uint64_t *after) {
+    halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, func_id);
+    if (!p) return;
+    halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+    f->cycles += after[0] - before[0];
+    f->instructions += after[1] - before[1];
+    f->llc_misses += after[2] - before[2];
+    p->cycles += after[0] - before[0];
+    p->instructions += after[1] - before[1];
+    p->llc_misses += after[2] - before[2];
+}
+
+WEAK void bill_gpu_time(halide_profiler_state *s, int func_id, uint64_t kernel_ns, uint64_t copy_ns) {
+    halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, func_id);
+    if (!p) return;
+    halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+    f->gpu_time += kernel_ns;
+    f->gpu_copy_time += copy_ns;
+    p->gpu_time += kernel_ns;
+    p->gpu_copy_time += copy_ns;
+}
+
+// Bill the time since the last sample to each running parallel task,
+// and the threads with no task to run to the current func if it is
+// waiting on a parallel loop.
+WEAK void bill_tasks(halide_profiler_state *s, int current_func, uint64_t time) {
+    int funcs[halide_profiler_task_slots];
+    int counts[halide_profiler_task_slots];
+    int num_funcs = 0;
+    int running_tasks = 0;
+    volatile int *slots = s->task_funcs;
+    for (int i = 0; i < halide_profiler_task_slots; i++) {
+        int func = slots[i] - 1;
+        if (func < 0) continue;
+        running_tasks++;
+        int j = 0;
+        while (j < num_funcs && funcs[j] != func) j++;
+        if (j == num_funcs) {
+            funcs[j] = func;
+            counts[j] = 0;
+            num_funcs++;
+        }
+        counts[j]++;
+    }
+
+    for (int j = 0; j < num_funcs; j++) {
+        halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, funcs[j]);
+        if (!p) continue;
+        halide_profiler_func_stats *f = p->funcs + funcs[j] - p->first_func_id;
+        f->task_time += time * counts[j];
+        if (counts[j] > f->max_tasks) {
+            f->max_tasks = counts[j];
+        }
+    }
+
+    if (running_tasks > s->max_running_tasks) {
+        s->max_running_tasks = running_tasks;
+    }
+
+    if (current_func >= 0 && s->running_parallel_loops > 0 &&
+        running_tasks < s->max_running_tasks) {
+        halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, current_func);
+        if (p) {
+            halide_profiler_func_stats *f = p->funcs + current_func - p->first_func_id;
+            f->idle_time += time * (s->max_running_tasks - running_tasks);
+        }
+    }
 }
 
 WEAK void sampling_profiler_thread(void *) {
@@ -102,6 +319,8 @@ WEAK void sampling_profiler_thread(void *) {
 
         uint64_t t1 = halide_current_time_ns(NULL);
         uint64_t t = t1;
+        uint64_t counts[3];
+        bool have_counts = perf_counters_enabled && read_perf_counters(counts);
         while (1) {
             int func, active_threads;
             if (s->get_remote_profiler_state) {
@@ -113,19 +332,37 @@ WEAK void sampling_profiler_thread(void *) {
                 active_threads = s->active_threads;
             }
             uint64_t t_now = halide_current_time_ns(NULL);
+            uint64_t counts_now[3];
+            bool have_counts_now = have_counts && read_perf_counters(counts_now);
             if (func == halide_profiler_please_stop) {
                 break;
             } else if (func >= 0) {
                 // Assume all time since I was last awake is due to
                 // the currently running func.
                 bill_func(s, func, t_now - t, active_threads);
+                if (have_counts_now) {
+                    bill_counters(s, func, counts, counts_now);
+                }
+            }
+            if (have_counts_now) {
+                for (int i = 0; i < 3; i++) {
+                    counts[i] = counts_now[i];
+                }
+            }
+            if (!s->get_remote_profiler_state) {
+                bill_tasks(s, func, t_now - t);
             }
             t = t_now;
 
             // Release the lock, sleep, reacquire.
             int sleep_ms = s->sleep_time;
+            int sleep_us = s->sleep_time_us;
             halide_mutex_unlock(&s->lock);
-            halide_sleep_ms(NULL, sleep_ms);
+            if (sleep_us > 0) {
+                halide_sleep_us(NULL, sleep_us);
+            } else {
+                halide_sleep_ms(NULL, sleep_ms);
+            }
             halide_mutex_lock(&s->lock);
         }
     }
@@ -183,6 +420,22 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
         s->sampling_thread = halide_spawn_thread(sampling_profiler_thread, NULL);
     }
 
+    if (!timeline_env_checked) {
+        timeline_env_checked = true;
+        const char *filename = getenv("HL_PROFILER_TIMELINE");
+        if (filename && *filename && !s->timeline &&
+            start_timeline_unlocked(user_context, s, 1 << 20) == 0) {
+            timeline_filename = filename;
+        }
+    }
+
+    // Open the counters after spawning the sampling thread, so that
+    // they aren't inherited by it.
+    if (!perf_counters_started) {
+        perf_counters_started = true;
+        perf_counters_enabled = start_perf_counters();
+    }
+
     halide_profiler_pipeline_stats *p =
         find_or_create_pipeline(pipeline_name, num_funcs, func_names);
     if (!p) {
@@ -306,6 +559,14 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+        if (p->cycles) {
+            sstr << " instructions per cycle: " << (float)p->instructions / p->cycles
+                 << "  LLC misses: " << p->llc_misses << "\n";
+        }
+        if (p->gpu_time || p->gpu_copy_time) {
+            sstr << " gpu time/run: " << p->gpu_time / (p->runs * 1000000.0f) << " ms"
+                 << "  copy time/run: " << p->gpu_copy_time / (p->runs * 1000000.0f) << " ms\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -374,6 +635,29 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 if (fs->stack_peak > 0) {
                     sstr << " stack: " << fs->stack_peak;
                 }
+
+                if (fs->cycles) {
+                    // The bandwidth assumes each last-level cache miss
+                    // transfers one 64-byte line.
+                    sstr << " ipc: " << (float)fs->instructions / fs->cycles
+                         << " llc misses: " << fs->llc_misses;
+                    if (fs->time) {
+                        sstr << " (" << (fs->llc_misses * 64.0f) / fs->time << " GB/s)";
+                    }
+                }
+
+                if (fs->gpu_time || fs->gpu_copy_time) {
+                    sstr << " gpu: " << fs->gpu_time / (p->runs * 1000000.0f) << "ms"
+                         << " copies: " << fs->gpu_copy_time / (p->runs * 1000000.0f) << "ms";
+                }
+
+                if (fs->task_time) {
+                    // Per-thread time spent in parallel tasks, and the
+                    // time other threads sat idle waiting for them.
+                    sstr << " tasks: " << fs->max_tasks
+                         << " task time: " << fs->task_time / (p->runs * 1000000.0f) << "ms"
+                         << " idle: " << fs->idle_time / (p->runs * 1000000.0f) << "ms";
+                }
                 sstr << "\n";
 
                 halide_print(user_context, sstr.str());
@@ -388,6 +672,100 @@ WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_report_unlocked(user_context, s);
 }
 
+WEAK void halide_profiler_report_json(void *user_context) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+
+    char line_buf[1024];
+    stringstream sstr(user_context, line_buf);
+    halide_print(user_context, "{\"pipelines\": [");
+    bool first_pipeline = true;
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->runs) continue;
+        sstr.clear();
+        sstr << (first_pipeline ? "\n" : ",\n")
+             << " {\"name\": \"" << p->name << "\""
+             << ", \"time_ns\": " << p->time
+             << ", \"samples\": " << p->samples
+             << ", \"runs\": " << p->runs
+             << ", \"active_threads\": " << p->active_threads_numerator / (p->active_threads_denominator + 1e-10)
+             << ", \"num_allocs\": " << p->num_allocs
+             << ", \"memory_peak\": " << p->memory_peak
+             << ", \"memory_total\": " << p->memory_total
+             << ", \"cycles\": " << p->cycles
+             << ", \"instructions\": " << p->instructions
+             << ", \"llc_misses\": " << p->llc_misses
+             << ", \"gpu_time_ns\": " << p->gpu_time
+             << ", \"gpu_copy_time_ns\": " << p->gpu_copy_time
+             << ",\n  \"funcs\": [";
+        halide_print(user_context, sstr.str());
+        first_pipeline = false;
+
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            sstr.clear();
+            sstr << (i == 0 ? "\n" : ",\n")
+                 << "   {\"name\": \"" << fs->name << "\""
+                 << ", \"time_ns\": " << fs->time
+                 << ", \"active_threads\": " << fs->active_threads_numerator / (fs->active_threads_denominator + 1e-10)
+                 << ", \"num_allocs\": " << fs->num_allocs
+                 << ", \"memory_peak\": " << fs->memory_peak
+                 << ", \"memory_total\": " << fs->memory_total
+                 << ", \"stack_peak\": " << fs->stack_peak
+                 << ", \"task_time_ns\": " << fs->task_time
+                 << ", \"idle_time_ns\": " << fs->idle_time
+                 << ", \"max_tasks\": " << fs->max_tasks
+                 << ", \"cycles\": " << fs->cycles
+                 << ", \"instructions\": " << fs->instructions
+                 << ", \"llc_misses\": " << fs->llc_misses
+                 << ", \"gpu_time_ns\": " << fs->gpu_time
+                 << ", \"gpu_copy_time_ns\": " << fs->gpu_copy_time
+                 << "}";
+            halide_print(user_context, sstr.str());
+        }
+        halide_print(user_context, "]}");
+    }
+    halide_print(user_context, "\n]}\n");
+}
+
+WEAK int halide_profiler_start_timeline(void *user_context, int max_events) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return start_timeline_unlocked(user_context, s, max_events);
+}
+
+WEAK int halide_profiler_write_timeline(void *user_context, const char *filename) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    return write_timeline_unlocked(user_context, s, filename);
+}
+
+WEAK void halide_profiler_record_gpu_time(int func_id, uint64_t kernel_ns, uint64_t copy_ns) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    ScopedMutexLock lock(&s->lock);
+    bill_gpu_time(s, func_id, kernel_ns, copy_ns);
+}
+
+WEAK void halide_profiler_timeline_task_begin(halide_profiler_state *state, int slot, int func) {
+    profiler_timeline *t = (profiler_timeline *)state->timeline;
+    t->slot_func[slot] = func;
+    t->slot_begin[slot] = halide_current_time_ns(NULL);
+}
+
+WEAK void halide_profiler_timeline_task_end(halide_profiler_state *state, int slot) {
+    profiler_timeline *t = (profiler_timeline *)state->timeline;
+    uint64_t end = halide_current_time_ns(NULL);
+    int i = __sync_fetch_and_add(&(t->count), 1);
+    if (i < t->capacity) {
+        timeline_event &e = t->events[i];
+        e.begin = t->slot_begin[slot];
+        e.end = end;
+        e.func = t->slot_func[slot];
+        e.slot = slot;
+    }
+}
+
 
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
     while (s->pipelines) {
@@ -397,6 +775,10 @@ WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
         free(p);
     }
     s->first_free_id = 0;
+    // The recorded tasks refer to funcs by id.
+    if (s->timeline) {
+        ((profiler_timeline *)(s->timeline))->count = 0;
+    }
 }
 
 WEAK void halide_profiler_reset() {
@@ -426,6 +808,9 @@ WEAK void halide_profiler_shutdown() {
     // Print results. No need to lock anything because we just shut
     // down the thread.
     halide_profiler_report_unlocked(NULL, s);
+    if (timeline_filename) {
+        write_timeline_unlocked(NULL, s, timeline_filename);
+    }
 
     halide_profiler_reset_unlocked(s);
 }
@@ -448,6 +833,9 @@ WEAK void halide_windows_profiler_shutdown() {
     // Print results. Avoid locking as it will cause problems and
     // nothing should be running.
     halide_profiler_report_unlocked(NULL, s);
+    if (timeline_filename) {
+        write_timeline_unlocked(NULL, s, timeline_filename);
+    }
 }
 #endif
 }
@@ -2,6 +2,9 @@
 
 extern "C" {
 
+WEAK void halide_profiler_timeline_task_begin(halide_profiler_state *state, int slot, int func);
+WEAK void halide_profiler_timeline_task_end(halide_profiler_state *state, int slot);
+
 WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_profiler_state *state, int tok, int t) {
     // Use empty volatile asm blocks to prevent code motion. Otherwise
     // llvm reorders or elides the stores.
@@ -28,4 +31,39 @@ WEAK __attribute__((always_inline)) int halide_profiler_decr_active_threads(hali
     return ret;
 }
 
+WEAK __attribute__((always_inline)) int halide_profiler_enter_parallel_loop(halide_profiler_state *state) {
+    return __sync_fetch_and_add(&(state->running_parallel_loops), 1);
+}
+
+WEAK __attribute__((always_inline)) int halide_profiler_leave_parallel_loop(halide_profiler_state *state) {
+    return __sync_fetch_and_sub(&(state->running_parallel_loops), 1);
+}
+
+// Record that a parallel task of the given func is running, so that
+// the sampling thread can attribute time to each task separately.
+// Returns the slot claimed, or -1 if they are all in use.
+WEAK int halide_profiler_enter_task(halide_profiler_state *state, int tok, int t) {
+    volatile int *slots = state->task_funcs;
+    for (int i = 0; i < halide_profiler_task_slots; i++) {
+        if (slots[i] == 0 &&
+            __sync_bool_compare_and_swap(&(state->task_funcs[i]), 0, tok + t + 1)) {
+            if (state->timeline) {
+                halide_profiler_timeline_task_begin(state, i, tok + t);
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+WEAK int halide_profiler_leave_task(halide_profiler_state *state, int slot) {
+    if (slot >= 0) {
+        if (state->timeline) {
+            halide_profiler_timeline_task_end(state, slot);
+        }
+        __sync_lock_release(&(state->task_funcs[slot]));
+    }
+    return 0;
+}
+
 }
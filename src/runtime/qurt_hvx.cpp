@@ -43,6 +43,15 @@ WEAK void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*
     halide_qurt_hvx_unlock(user_context);
 }
 
+WEAK int halide_qurt_hvx_get_units(void *user_context, int size) {
+    // Older versions of QuRT can't tell us. Assume a Snapdragon 820,
+    // which has two 128 byte contexts, or four 64 byte ones.
+    int units = qurt_hvx_get_units ? qurt_hvx_get_units() : ((2 << 8) | 4);
+    int result = size == 128 ? (units >> 8) & 0xff : units & 0xff;
+    debug(user_context) << "QuRT: halide_qurt_hvx_get_units(" << size << ") -> " << result << "\n";
+    return result > 0 ? result : 1;
+}
+
 // These need to inline, otherwise the extern call with the ptr
 // parameter breaks a lot of optimizations.
 __attribute__((always_inline))
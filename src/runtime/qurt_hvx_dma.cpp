@@ -0,0 +1,88 @@
+#include "runtime_internal.h"
+#include "HalideRuntimeQurt.h"
+#include "printer.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Qurt {
+
+// A type 1 (2D) user DMA descriptor, as consumed by dmstart.
+struct dma_descriptor_2d {
+    uint32_t next;
+    uint32_t length : 24;
+    uint32_t desc_type : 2;
+    uint32_t dst_comp : 1;
+    uint32_t src_comp : 1;
+    uint32_t dst_bypass : 1;
+    uint32_t src_bypass : 1;
+    uint32_t order : 1;
+    uint32_t done : 1;
+    uint32_t src;
+    uint32_t dst;
+    uint32_t allocation : 28;
+    uint32_t padding : 4;
+    uint16_t roi_width;
+    uint16_t roi_height;
+    uint16_t src_stride;
+    uint16_t dst_stride;
+    uint16_t src_width_offset;
+    uint16_t dst_width_offset;
+} __attribute__((aligned(64)));
+
+// The width, height and strides of a descriptor are 16 bits.
+WEAK bool fits_in_descriptor(int width, int height, int dst_stride, int src_stride) {
+    return (width < 65536 && height < 65536 &&
+            dst_stride >= 0 && dst_stride < 65536 &&
+            src_stride >= 0 && src_stride < 65536);
+}
+
+}}}} // namespace Halide::Runtime::Internal::Qurt
+
+using namespace Halide::Runtime::Internal::Qurt;
+
+extern "C" {
+
+WEAK int halide_hexagon_user_dma_copy_2d(void *user_context,
+                                         uint8_t *dst, int dst_offset,
+                                         const uint8_t *src, int src_offset,
+                                         int width, int height,
+                                         int dst_stride, int src_stride) {
+    dst += dst_offset;
+    src += src_offset;
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    if (!fits_in_descriptor(width, height, dst_stride, src_stride)) {
+        // Too big for one descriptor, copy it row by row instead.
+        debug(user_context) << "QuRT: copying " << width << "x" << height
+                            << " bytes without DMA\n";
+        for (int y = 0; y < height; y++) {
+            memcpy(dst + y * dst_stride, src + y * src_stride, width);
+        }
+        return 0;
+    }
+
+    dma_descriptor_2d desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.desc_type = 1;
+    desc.order = 1;
+    desc.src = (uint32_t)(size_t)src;
+    desc.dst = (uint32_t)(size_t)dst;
+    desc.roi_width = (uint16_t)width;
+    desc.roi_height = (uint16_t)height;
+    desc.src_stride = (uint16_t)src_stride;
+    desc.dst_stride = (uint16_t)dst_stride;
+
+    debug(user_context) << "QuRT: dmstart(" << width << "x" << height
+                        << " bytes from " << (void *)src << " to " << (void *)dst << ")\n";
+    __asm__ __volatile__ ("dmstart(%0)" : : "r"(&desc) : "memory");
+    uint32_t status;
+    __asm__ __volatile__ ("%0 = dmwait" : "=r"(status) : : "memory");
+
+    if (!((volatile dma_descriptor_2d *)&desc)->done) {
+        error(user_context) << "Hexagon user DMA copy did not complete, status " << status << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,66 @@
+#include "runtime_internal.h"
+#include "HalideRuntimeQurt.h"
+#include "printer.h"
+
+extern "C" {
+
+// These are provided by the Hexagon SDK (HAP_vtcm_mgr.h) on v65 and
+// later.
+extern void *HAP_request_VTCM(unsigned int size, unsigned int single_page_flag);
+extern int HAP_release_VTCM(void *ptr);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Qurt {
+
+// Allocations that may fall back to the heap are preceded by a header
+// saying where they came from. It is a whole HVX vector, to keep the
+// allocation aligned.
+const int vtcm_header_bytes = 128;
+const int vtcm_allocation = 1;
+const int heap_allocation = 2;
+
+}}}} // namespace Halide::Runtime::Internal::Qurt
+
+using namespace Halide::Runtime::Internal::Qurt;
+
+extern "C" {
+
+WEAK void *halide_vtcm_malloc(void *user_context, int size) {
+    // Ask for a single page, so that the whole allocation can be
+    // addressed by a vgather or vscatter.
+    void *ptr = HAP_request_VTCM(size, 1);
+    debug(user_context) << "QuRT: HAP_request_VTCM(" << size << ") -> " << ptr << "\n";
+    return ptr;
+}
+
+WEAK void halide_vtcm_free(void *user_context, void *ptr) {
+    debug(user_context) << "QuRT: HAP_release_VTCM(" << ptr << ")\n";
+    HAP_release_VTCM(ptr);
+}
+
+WEAK void *halide_vtcm_malloc_or_heap(void *user_context, int size) {
+    int kind = vtcm_allocation;
+    uint8_t *ptr = (uint8_t *)halide_vtcm_malloc(user_context, size + vtcm_header_bytes);
+    if (ptr == NULL) {
+        debug(user_context) << "QuRT: Out of VTCM, allocating " << size << " bytes on the heap instead\n";
+        kind = heap_allocation;
+        ptr = (uint8_t *)halide_malloc(user_context, size + vtcm_header_bytes);
+        if (ptr == NULL) {
+            return NULL;
+        }
+    }
+    *(int *)ptr = kind;
+    return ptr + vtcm_header_bytes;
+}
+
+WEAK void halide_vtcm_free_or_heap(void *user_context, void *ptr) {
+    uint8_t *base = (uint8_t *)ptr - vtcm_header_bytes;
+    if (*(int *)base == vtcm_allocation) {
+        halide_vtcm_free(user_context, base);
+    } else {
+        halide_free(user_context, base);
+    }
+}
+
+}
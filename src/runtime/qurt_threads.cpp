@@ -32,6 +32,14 @@ int halide_host_cpu_count() {
     return 4;
 }
 
+int halide_host_cpu_nodes(int *cpu_node, int num_cpus) {
+    return 0;
+}
+
+int halide_pin_current_thread(int cpu) {
+    return -1;
+}
+
 #define STACK_SIZE 256*1024
 
 WEAK struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closure) {
@@ -61,6 +69,10 @@ WEAK void halide_join_thread(struct halide_thread *thread_arg) {
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+WEAK uintptr_t halide_current_thread_id() {
+    return (uintptr_t)qurt_thread_get_id();
+}
+
 namespace Synchronization {
 
 struct thread_parker {
@@ -7,6 +7,7 @@
 #include "HalideRuntimeHexagonHost.h"
 #include "HalideRuntimeD3D12Compute.h"
 #include "HalideRuntimeQurt.h"
+#include "HalideRuntimeVulkan.h"
 #include "cpu_features.h"
 
 // This runtime module will contain extern declarations of the Halide
@@ -28,11 +29,18 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_copy_to_host,
     (void *)&halide_copy_to_host_legacy,
     (void *)&halide_create_temp_file,
+    (void *)&halide_cuda_begin_graph_capture,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
+    (void *)&halide_cuda_end_graph_capture,
     (void *)&halide_cuda_get_device_ptr,
     (void *)&halide_cuda_initialize_kernels,
+    (void *)&halide_cuda_launch_graph,
+    (void *)&halide_cuda_release_graph,
+    (void *)&halide_cuda_release_unused_device_allocations,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_set_max_cached_device_bytes,
+    (void *)&halide_cuda_set_use_per_thread_stream,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
     (void *)&halide_debug_to_file,
@@ -49,7 +57,9 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_device_release,
     (void *)&halide_device_sync,
     (void *)&halide_device_sync_legacy,
+    (void *)&halide_do_batch,
     (void *)&halide_do_par_for,
+    (void *)&halide_do_parallel_tasks,
     (void *)&halide_do_task,
     (void *)&halide_double_to_string,
     (void *)&halide_downgrade_buffer_t,
@@ -90,10 +100,12 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_symbol,
+    (void *)&halide_get_thread_gpu_device,
     (void *)&halide_get_trace_file,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
     (void *)&halide_hexagon_device_release,
+    (void *)&halide_hexagon_end_session,
     (void *)&halide_hexagon_get_device_handle,
     (void *)&halide_hexagon_get_device_size,
     (void *)&halide_hexagon_initialize_kernels,
@@ -103,6 +115,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_run,
     (void *)&halide_hexagon_set_performance,
     (void *)&halide_hexagon_set_performance_mode,
+    (void *)&halide_hexagon_start_session,
     (void *)&halide_hexagon_wrap_device_handle,
     (void *)&halide_int64_to_string,
     (void *)&halide_join_thread,
@@ -110,10 +123,15 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_malloc,
     (void *)&halide_matlab_call_pipeline,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_release_device,
+    (void *)&halide_memoization_cache_set_device_size,
+    (void *)&halide_memoization_cache_set_shards,
     (void *)&halide_memoization_cache_set_size,
     (void *)&halide_memoization_cache_store,
+    (void *)&halide_memoization_cache_store_with_budget,
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
@@ -135,8 +153,11 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_platform_name,
     (void *)&halide_opencl_get_crop_offset,
     (void *)&halide_opencl_initialize_kernels,
+    (void *)&halide_opencl_release_unused_device_allocations,
     (void *)&halide_opencl_run,
+    (void *)&halide_opencl_set_alloc_host_ptr,
     (void *)&halide_opencl_set_device_type,
+    (void *)&halide_opencl_set_max_cached_device_bytes,
     (void *)&halide_opencl_set_platform_name,
     (void *)&halide_opencl_wrap_cl_mem,
     (void *)&halide_opengl_context_lost,
@@ -152,7 +173,11 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_device_interface,
     (void *)&halide_openglcompute_initialize_kernels,
     (void *)&halide_openglcompute_run,
+    (void *)&halide_paged_input,
     (void *)&halide_pointer_to_string,
+    (void *)&halide_pool_free,
+    (void *)&halide_pool_malloc,
+    (void *)&halide_pool_trim,
     (void *)&halide_print,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_get_state,
@@ -162,11 +187,20 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_profiler_report,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
+    (void *)&halide_qurt_hvx_get_units,
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
     (void *)&halide_release_jit_module,
     (void *)&halide_set_custom_can_use_target_features,
+    (void *)&halide_scratch_pool_acquire,
+    (void *)&halide_scratch_pool_create,
+    (void *)&halide_scratch_pool_destroy,
+    (void *)&halide_scratch_pool_release,
+    (void *)&halide_semaphore_acquire,
+    (void *)&halide_semaphore_init,
+    (void *)&halide_semaphore_release,
+    (void *)&halide_semaphore_try_acquire,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_task,
     (void *)&halide_set_custom_free,
@@ -178,11 +212,21 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_trace,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_page_provider,
     (void *)&halide_set_num_threads,
     (void *)&halide_set_trace_file,
+    (void *)&halide_set_numa_aware,
+    (void *)&halide_set_thread_gpu_device,
+    (void *)&halide_set_thread_gpu_device_as_destructor,
+    (void *)&halide_set_work_stealing,
+    (void *)&halide_set_worker_spin_count,
+    (void *)&halide_shape_cache_cleanup,
+    (void *)&halide_shape_cache_lookup,
+    (void *)&halide_shape_cache_store,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
+    (void *)&halide_sleep_us,
     (void *)&halide_spawn_thread,
     (void *)&halide_start_clock,
     (void *)&halide_string_to_string,
@@ -196,4 +240,9 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_d3d12compute_initialize_kernels,
     (void *)&halide_d3d12compute_release_context,
     (void *)&halide_d3d12compute_run,
+    (void *)&halide_vulkan_acquire_context,
+    (void *)&halide_vulkan_device_interface,
+    (void *)&halide_vulkan_initialize_kernels,
+    (void *)&halide_vulkan_release_context,
+    (void *)&halide_vulkan_run,
 };
@@ -78,7 +78,10 @@ int fileno(void *);
 int fclose(void *);
 int close(int);
 size_t fwrite(const void *, size_t, size_t, void *);
+size_t fread(void *, size_t, size_t, void *);
+int rename(const char *oldpath, const char *newpath);
 ssize_t write(int fd, const void *buf, size_t bytes);
+ssize_t read(int fd, void *buf, size_t bytes);
 int remove(const char *pathname);
 int ioctl(int fd, unsigned long request, ...);
 void exit(int);
@@ -113,10 +116,18 @@ WEAK void *halide_get_library_symbol(void *lib, const char *name);
 WEAK int halide_start_clock(void *user_context);
 WEAK int64_t halide_current_time_ns(void *user_context);
 WEAK void halide_sleep_ms(void *user_context, int ms);
+WEAK void halide_sleep_us(void *user_context, int us);
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_and_host_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_host_nop_free(void *user_context, void *obj);
 
+// Storage for allocations hoisted out of parallel loops, reused by
+// the loop's tasks. See Func::store_per_worker.
+WEAK void *halide_scratch_pool_create(void *user_context, uint64_t slot_bytes);
+WEAK void halide_scratch_pool_destroy(void *user_context, void *pool);
+WEAK void *halide_scratch_pool_acquire(void *user_context, void *pool);
+WEAK void halide_scratch_pool_release(void *user_context, void *ptr);
+
 // The pipeline_state is declared as void* type since halide_profiler_pipeline_stats
 // is defined inside HalideRuntime.h which includes this header file.
 WEAK void halide_profiler_stack_peak_update(void *user_context,
@@ -135,6 +146,12 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         int num_funcs,
                                         const uint64_t *func_names);
 WEAK int halide_host_cpu_count();
+// Fill in the NUMA node of each of the first num_cpus CPUs. Returns
+// the number of nodes found, or zero if the topology isn't known.
+WEAK int halide_host_cpu_nodes(int *cpu_node, int num_cpus);
+// Restrict the calling thread to run only on the given CPU. Returns
+// zero on success.
+WEAK int halide_pin_current_thread(int cpu);
 
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
@@ -147,6 +164,10 @@ WEAK int halide_matlab_call_pipeline(void *user_context,
                                      int (*pipeline)(void **args), const halide_filter_metadata_t *metadata,
                                      int nlhs, mxArray **plhs, int nrhs, const mxArray **prhs);
 
+WEAK int halide_do_batch(void *user_context, const halide_filter_metadata_t *metadata,
+                         int (*checked)(void **args), int (*unchecked)(void **args),
+                         int batch_size, void ***argvs);
+
 // Condition variables. Must be initialized with 0.
 struct halide_cond {
     uintptr_t _private[1];
@@ -212,6 +233,10 @@ extern WEAK __attribute__((always_inline)) int halide_malloc_alignment();
 
 void halide_thread_yield();
 
+// An identifier for the calling thread, unique among the threads
+// currently running. Defined alongside the thread pool.
+uintptr_t halide_current_thread_id();
+
 }}}
 
 using namespace Halide::Runtime::Internal;
@@ -0,0 +1,108 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Scratch {
+
+// A scratch pool holds the storage for one allocation that has been
+// hoisted out of a parallel loop (see Func::store_per_worker). Each
+// task claims a free slot for the duration of the allocation, and a
+// slot's block is allocated the first time it is claimed, so there
+// are only ever as many blocks as tasks that ran at once.
+const int kNumSlots = 64;
+
+struct ScratchPool {
+    uint64_t slot_bytes;
+    volatile int in_use[kNumSlots];
+    void *blocks[kNumSlots];
+};
+
+// Each block has a header of one alignment unit before the pointer
+// handed out, recording where it came from. Blocks allocated because
+// every slot was busy have a NULL pool and are freed on release.
+struct BlockHeader {
+    ScratchPool *pool;
+    int slot;
+};
+
+WEAK __attribute__((always_inline)) BlockHeader *block_header(void *ptr) {
+    return (BlockHeader *)((uint8_t *)ptr - halide_malloc_alignment());
+}
+
+WEAK void *allocate_block(void *user_context, ScratchPool *pool, uint64_t bytes, int slot) {
+    const size_t alignment = halide_malloc_alignment();
+    uint8_t *orig = (uint8_t *)halide_malloc(user_context, bytes + alignment);
+    if (orig == NULL) {
+        return NULL;
+    }
+    void *ptr = orig + alignment;
+    BlockHeader *header = block_header(ptr);
+    header->pool = pool;
+    header->slot = slot;
+    return ptr;
+}
+
+WEAK void free_block(void *user_context, void *ptr) {
+    halide_free(user_context, (uint8_t *)ptr - halide_malloc_alignment());
+}
+
+}}}} // namespace Halide::Runtime::Internal::Scratch
+
+using namespace Halide::Runtime::Internal::Scratch;
+
+extern "C" {
+
+WEAK void *halide_scratch_pool_create(void *user_context, uint64_t slot_bytes) {
+    ScratchPool *pool = (ScratchPool *)halide_malloc(user_context, sizeof(ScratchPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(ScratchPool));
+    pool->slot_bytes = slot_bytes;
+    return pool;
+}
+
+WEAK void halide_scratch_pool_destroy(void *user_context, void *obj) {
+    ScratchPool *pool = (ScratchPool *)obj;
+    if (pool == NULL) {
+        return;
+    }
+    for (int i = 0; i < kNumSlots; i++) {
+        if (pool->blocks[i] != NULL) {
+            free_block(user_context, pool->blocks[i]);
+        }
+    }
+    halide_free(user_context, pool);
+}
+
+WEAK void *halide_scratch_pool_acquire(void *user_context, void *obj) {
+    ScratchPool *pool = (ScratchPool *)obj;
+    for (int i = 0; i < kNumSlots; i++) {
+        if (pool->in_use[i] == 0 &&
+            __sync_bool_compare_and_swap(&pool->in_use[i], 0, 1)) {
+            if (pool->blocks[i] == NULL) {
+                pool->blocks[i] = allocate_block(user_context, pool, pool->slot_bytes, i);
+                if (pool->blocks[i] == NULL) {
+                    __sync_lock_release(&pool->in_use[i]);
+                    return NULL;
+                }
+            }
+            return pool->blocks[i];
+        }
+    }
+    // More tasks are running than there are slots.
+    return allocate_block(user_context, NULL, pool->slot_bytes, -1);
+}
+
+WEAK void halide_scratch_pool_release(void *user_context, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    BlockHeader *header = block_header(ptr);
+    if (header->pool == NULL) {
+        free_block(user_context, ptr);
+    } else {
+        __sync_lock_release(&header->pool->in_use[header->slot]);
+    }
+}
+
+}
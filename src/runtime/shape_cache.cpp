@@ -0,0 +1,82 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace ShapeCache {
+
+// The last shape signature that passed a pipeline's checks, keyed by
+// the id compiled into the pipeline. Pipelines whose ids collide in
+// the table evict each other, which only costs a rerun of the checks.
+const int kNumEntries = 64;
+
+struct Entry {
+    uint64_t id;
+    int32_t size;
+    int64_t *signature;
+};
+
+WEAK Entry entries[kNumEntries];
+WEAK halide_mutex lock;
+
+WEAK __attribute__((always_inline)) Entry &entry_for(uint64_t id) {
+    return entries[(id ^ (id >> 32)) % kNumEntries];
+}
+
+}}}} // namespace Halide::Runtime::Internal::ShapeCache
+
+using namespace Halide::Runtime::Internal::ShapeCache;
+
+extern "C" {
+
+WEAK int halide_shape_cache_lookup(void *user_context, uint64_t id,
+                                   const int64_t *signature, int32_t size) {
+    ScopedMutexLock l(&lock);
+    const Entry &e = entry_for(id);
+    if (e.signature == NULL || e.id != id || e.size != size) {
+        return 0;
+    }
+    return memcmp(e.signature, signature, size * sizeof(int64_t)) == 0;
+}
+
+WEAK int halide_shape_cache_store(void *user_context, uint64_t id,
+                                  const int64_t *signature, int32_t size) {
+    ScopedMutexLock l(&lock);
+    Entry &e = entry_for(id);
+    if (e.signature == NULL || e.size != size) {
+        int64_t *storage = (int64_t *)halide_malloc(NULL, size * sizeof(int64_t));
+        if (storage == NULL) {
+            // Not caching the signature is always safe.
+            return 0;
+        }
+        if (e.signature != NULL) {
+            halide_free(NULL, e.signature);
+        }
+        e.signature = storage;
+        e.size = size;
+    }
+    e.id = id;
+    memcpy(e.signature, signature, size * sizeof(int64_t));
+    return 0;
+}
+
+WEAK void halide_shape_cache_cleanup() {
+    ScopedMutexLock l(&lock);
+    for (int i = 0; i < kNumEntries; i++) {
+        if (entries[i].signature != NULL) {
+            halide_free(NULL, entries[i].signature);
+        }
+        entries[i].signature = NULL;
+        entries[i].size = 0;
+    }
+}
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_shape_cache_destructor() {
+    halide_shape_cache_cleanup();
+}
+
+}
+
+}
@@ -1,4 +1,3 @@
-extern "C" void * pthread_self();
 
 namespace Halide { namespace Runtime { namespace Internal {
 
@@ -13,6 +12,84 @@ struct work {
     bool running() { return next < max || active_workers > 0; }
 };
 
+// A contiguous range of task indices [begin, end), relative to the
+// min of the owning job, packed into a single word so that it can be
+// claimed from the front by the thread that holds it and split from
+// the back by thieves using a single compare-and-swap. Each one lives
+// on its own cache line to avoid false sharing between threads.
+struct ws_range {
+    uint64_t packed;
+    // The NUMA node of the thread the range belongs to, or -1 if
+    // unknown. Thieves try ranges on their own node first.
+    int node;
+    uint8_t padding[64 - sizeof(uint64_t) - sizeof(int)];
+};
+
+// A parallel for loop being executed in work-stealing mode. The task
+// indices are divided up between one range per worker thread plus
+// one for the thread that called do_par_for. Each thread works
+// through its own range, and when that runs dry steals half of the
+// remaining tasks from a peer. Claiming a task never touches the
+// work queue mutex.
+struct ws_work {
+    ws_work *next_job;
+    int (*f)(void *, int, uint8_t *);
+    void *user_context;
+    uint8_t *closure;
+    int min;
+
+    // The ranges. The last one belongs to the owner.
+    ws_range *slots;
+    int num_slots;
+
+    // The number of tasks not yet completed. Modified atomically.
+    int remaining;
+
+    // The number of worker threads (not counting the owner) currently
+    // inside this job, and whether a worker has found it to have no
+    // more tasks to claim. Protected by the work queue mutex.
+    int active_workers;
+    bool exhausted;
+
+    // Modified atomically.
+    int exit_status;
+};
+
+// A task from a call to halide_do_parallel_tasks.
+struct parallel_tasks_job {
+    int (*f)(void *, int, uint8_t *);
+    void *user_context;
+    uint8_t *closure;
+
+    // The number of tasks handed to helper threads that have not yet
+    // completed. Protected by the work queue mutex.
+    int remaining;
+
+    int exit_status;
+};
+
+// A thread dedicated to running one task at a time from
+// halide_do_parallel_tasks. Those tasks may block waiting on each
+// other, so they must not be run by the worker threads.
+struct parallel_tasks_helper {
+    halide_thread *thread;
+    parallel_tasks_helper *next_idle;
+    halide_cond wakeup;
+
+    // The task currently assigned, if any.
+    parallel_tasks_job *job;
+    int idx;
+};
+
+// The internal representation of a halide_semaphore_t.
+struct halide_semaphore_impl_t {
+    // The count. Modified atomically.
+    int value;
+    // The number of threads blocked in
+    // halide_semaphore_acquire. Modified atomically.
+    int waiters;
+};
+
 // The work queue and thread pool is weak, so one big work queue is shared by all halide functions
 struct work_queue_t {
     // all fields are protected by this mutex.
@@ -21,6 +98,26 @@ struct work_queue_t {
     // The desired number threads doing work.
     int desired_num_threads;
 
+    // Whether new jobs should be run in work-stealing mode. Zero
+    // means not yet decided, in which case it is read from the
+    // environment when the thread pool is initialized. Otherwise 1
+    // for on, -1 for off.
+    int work_stealing;
+
+    // Whether to run in NUMA-aware mode, with the same encoding as
+    // work_stealing. NUMA-aware mode pins each worker thread to a core,
+    // numbering the workers so the cores of each node are
+    // consecutive, and runs parallel loops in work-stealing mode.
+    int numa_aware;
+
+    // The number of times an idle worker yields, checking for new
+    // work in between, before it goes to sleep. Negative means idle
+    // workers never sleep. Only valid if spin_count_set is true;
+    // otherwise it is read from the environment when the thread pool
+    // is initialized.
+    int spin_count;
+    bool spin_count_set;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -28,6 +125,9 @@ struct work_queue_t {
     // Singly linked list for job stack
     work *jobs;
 
+    // Singly linked list of jobs running in work-stealing mode.
+    ws_work *ws_jobs;
+
     // Worker threads are divided into an 'A' team and a 'B' team. The
     // B team sleeps on the wakeup_b_team condition variable. The A
     // team does work. Threads transition to the B team if they wake
@@ -49,9 +149,28 @@ struct work_queue_t {
     // Keep track of threads so they can be joined at shutdown
     halide_thread *threads[MAX_THREADS];
 
+    // Broadcast when a semaphore with waiters is released.
+    halide_cond wakeup_semaphore_waiters;
+
+    // Helper threads for halide_do_parallel_tasks, and a stack of
+    // the ones with nothing to do.
+    parallel_tasks_helper helpers[MAX_THREADS];
+    parallel_tasks_helper *idle_helpers;
+    int helpers_created;
+
     // The number threads created
     int threads_created;
 
+    // For NUMA-aware mode, the CPUs grouped by node, and the node of
+    // each. Worker i runs on numa_cpus[i % numa_num_cpus]. Filled in
+    // when first needed.
+    int numa_cpus[MAX_THREADS];
+    int numa_cpu_node[MAX_THREADS];
+    int numa_num_cpus;
+
+    // Which worker threads have pinned themselves to their CPU.
+    bool worker_pinned[MAX_THREADS];
+
     // Global flags indicating the threadpool should shut down, and
     // whether the thread pool has been initialized.
     bool shutdown, initialized;
@@ -107,22 +226,284 @@ WEAK int default_desired_num_threads() {
     return desired_num_threads;
 }
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+WEAK int default_work_stealing() {
+    char *str = getenv("HL_WORK_STEALING");
+    return (str && atoi(str) != 0) ? 1 : -1;
+}
+
+WEAK int default_numa_aware() {
+    char *str = getenv("HL_NUMA");
+    return (str && atoi(str) != 0) ? 1 : -1;
+}
+
+// Order the host's CPUs by NUMA node. Must be called while locked.
+WEAK void numa_compute_layout() {
+    int num_cpus = clamp_num_threads(halide_host_cpu_count());
+    int cpu_node[MAX_THREADS];
+    int max_node = 0;
+    if (halide_host_cpu_nodes(cpu_node, num_cpus) > 0) {
+        for (int i = 0; i < num_cpus; i++) {
+            if (cpu_node[i] > max_node) {
+                max_node = cpu_node[i];
+            }
+        }
+    } else {
+        // No topology available, so treat it as a single node.
+        for (int i = 0; i < num_cpus; i++) {
+            cpu_node[i] = 0;
+        }
+    }
+    int n = 0;
+    for (int node = 0; node <= max_node; node++) {
+        for (int i = 0; i < num_cpus; i++) {
+            if (cpu_node[i] == node) {
+                work_queue.numa_cpus[n] = i;
+                work_queue.numa_cpu_node[n] = node;
+                n++;
+            }
+        }
+    }
+    if (n == 0) {
+        work_queue.numa_cpus[0] = 0;
+        work_queue.numa_cpu_node[0] = 0;
+        n = 1;
+    }
+    work_queue.numa_num_cpus = n;
+}
+
+// The NUMA node a worker thread runs on in NUMA-aware mode, or -1 if
+// not in NUMA-aware mode. Must be called while locked.
+WEAK int numa_worker_node(int worker_id) {
+    if (work_queue.numa_aware <= 0) {
+        return -1;
+    }
+    if (!work_queue.numa_num_cpus) {
+        numa_compute_layout();
+    }
+    return work_queue.numa_cpu_node[worker_id % work_queue.numa_num_cpus];
+}
+
+// Pin a worker thread to its CPU the first time it finds itself in
+// NUMA-aware mode. Must be called while locked.
+WEAK void numa_pin_worker(int worker_id) {
+    if (work_queue.numa_aware <= 0 || work_queue.worker_pinned[worker_id]) {
+        return;
+    }
+    if (!work_queue.numa_num_cpus) {
+        numa_compute_layout();
+    }
+    work_queue.worker_pinned[worker_id] = true;
+    halide_pin_current_thread(work_queue.numa_cpus[worker_id % work_queue.numa_num_cpus]);
+}
+
+WEAK int default_spin_count() {
+    char *str = getenv("HL_SPIN_COUNT");
+    return str ? atoi(str) : 0;
+}
+
+// Spin while idle, in the hope of picking up new work without going
+// to sleep and having to be woken. Must be called while locked, and
+// returns locked once work may have arrived or the spin count is
+// used up.
+WEAK void spin_for_work_already_locked() {
+    const int spin_count = work_queue.spin_count;
+    halide_mutex_unlock(&work_queue.mutex);
+    for (int i = 0; spin_count < 0 || i < spin_count; i++) {
+        if (__atomic_load_n(&work_queue.jobs, __ATOMIC_RELAXED) != NULL ||
+            __atomic_load_n(&work_queue.ws_jobs, __ATOMIC_RELAXED) != NULL ||
+            __atomic_load_n(&work_queue.shutdown, __ATOMIC_RELAXED) ||
+            __atomic_load_n(&work_queue.spin_count, __ATOMIC_RELAXED) != spin_count) {
+            break;
+        }
+        halide_thread_yield();
+    }
+    halide_mutex_lock(&work_queue.mutex);
+}
+
+inline uint64_t ws_pack(uint32_t begin, uint32_t end) {
+    return ((uint64_t)end << 32) | begin;
+}
+
+// Claim the next task from the front of a range.
+WEAK bool ws_claim(ws_range *r, int *idx) {
+    uint64_t old = *(volatile uint64_t *)&r->packed;
+    while (true) {
+        uint32_t begin = (uint32_t)old, end = (uint32_t)(old >> 32);
+        if (begin >= end) {
+            return false;
+        }
+        uint64_t seen = __sync_val_compare_and_swap(&r->packed, old, ws_pack(begin + 1, end));
+        if (seen == old) {
+            *idx = (int)begin;
+            return true;
+        }
+        old = seen;
+    }
+}
+
+// Steal the back half of some other thread's range. The first stolen
+// task is returned to be run immediately, and the rest are placed in
+// the thief's own (empty) range, where they may in turn be stolen by
+// others. Ranges only ever shrink or get refilled with unclaimed
+// tasks while empty, so the compare-and-swap is free of ABA problems.
+// Ranges on the thief's own NUMA node are tried first.
+WEAK bool ws_steal(ws_work *job, int thief, int *idx) {
+    const int node = job->slots[thief].node;
+    for (int i = 1; i < 2 * job->num_slots; i++) {
+        int v = thief + i;
+        while (v >= job->num_slots) {
+            v -= job->num_slots;
+        }
+        // The first pass over the ranges only looks at the ones on
+        // the same node, and the second pass at the rest.
+        bool first_pass = i < job->num_slots;
+        if (v == thief || first_pass != (job->slots[v].node == node)) {
+            continue;
+        }
+        ws_range *victim = job->slots + v;
+        uint64_t old = *(volatile uint64_t *)&victim->packed;
+        while (true) {
+            uint32_t begin = (uint32_t)old, end = (uint32_t)(old >> 32);
+            if (begin >= end) {
+                break;
+            }
+            uint32_t split = end - (end - begin + 1) / 2;
+            uint64_t seen = __sync_val_compare_and_swap(&victim->packed, old, ws_pack(begin, split));
+            if (seen == old) {
+                __atomic_store_n(&job->slots[thief].packed, ws_pack(split + 1, end), __ATOMIC_RELEASE);
+                *idx = (int)split;
+                return true;
+            }
+            old = seen;
+        }
+    }
+    return false;
+}
+
+// Claim a single task from the back of any range, for a thread that
+// has no range of its own in the job. Like stealing, this only ever
+// shrinks a range, so it is free of ABA problems too.
+WEAK bool ws_claim_as_guest(ws_work *job, int *idx) {
+    for (int v = 0; v < job->num_slots; v++) {
+        ws_range *r = job->slots + v;
+        uint64_t old = *(volatile uint64_t *)&r->packed;
+        while (true) {
+            uint32_t begin = (uint32_t)old, end = (uint32_t)(old >> 32);
+            if (begin >= end) {
+                break;
+            }
+            uint64_t seen = __sync_val_compare_and_swap(&r->packed, old, ws_pack(begin, end - 1));
+            if (seen == old) {
+                *idx = (int)(end - 1);
+                return true;
+            }
+            old = seen;
+        }
+    }
+    return false;
+}
+
+// Run tasks from a work-stealing job until there are none left to
+// claim. Must be called without the work queue locked.
+WEAK void ws_run_job(ws_work *job, int slot) {
+    int idx;
+    while (ws_claim(job->slots + slot, &idx) || ws_steal(job, slot, &idx)) {
+        int result = halide_do_task(job->user_context, job->f, job->min + idx,
+                                    job->closure);
+        if (result) {
+            __atomic_store_n(&job->exit_status, result, __ATOMIC_RELAXED);
+        }
+        __sync_fetch_and_sub(&job->remaining, 1);
+    }
+}
+
+// Find a work-stealing job that may still have tasks to claim. Must
+// be called while locked.
+WEAK ws_work *ws_find_job() {
+    for (ws_work *job = work_queue.ws_jobs; job; job = job->next_job) {
+        if (!job->exhausted) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// Help out with a work-stealing job, using the given range, or as a
+// guest if slot is out of range for the job. Work-stealing jobs are
+// what inner parallel loops turn into in work-stealing mode, so this
+// is also how threads that are waiting for their own loop to finish
+// join in with loops nested inside it. Must be called while locked,
+// and returns locked.
+WEAK void ws_help_already_locked(ws_work *job, int slot) {
+    job->active_workers++;
+    halide_mutex_unlock(&work_queue.mutex);
+    if (slot >= 0 && slot < job->num_slots - 1) {
+        ws_run_job(job, slot);
+    } else {
+        // Workers spawned after the job was created, and threads that
+        // own a parallel loop of their own, have no range in it.
+        int idx;
+        while (ws_claim_as_guest(job, &idx)) {
+            int result = halide_do_task(job->user_context, job->f, job->min + idx,
+                                        job->closure);
+            if (result) {
+                __atomic_store_n(&job->exit_status, result, __ATOMIC_RELAXED);
+            }
+            __sync_fetch_and_sub(&job->remaining, 1);
+        }
+    }
+    halide_mutex_lock(&work_queue.mutex);
+
+    // We found nothing left to claim, so there's no point other
+    // threads joining in.
+    job->exhausted = true;
+    job->active_workers--;
+    if (job->active_workers == 0) {
+        halide_cond_broadcast(&work_queue.wakeup_owners);
+    }
+}
+
+WEAK void worker_thread_already_locked(work *owned_job, int worker_id) {
     // If I'm a job owner, then I was the thread that called
     // do_par_for, and I should only stay in this function until my
     // job is complete. If I'm a lowly worker thread, I should stay in
     // this function as long as the work queue is running.
+
+    // Whether I've already spun waiting for work since I last did
+    // some, and so should go to sleep if there's still none.
+    bool spun = false;
     while (owned_job != NULL ? owned_job->running()
            : work_queue.running()) {
 
-        if (work_queue.jobs == NULL) {
+        if (!owned_job) {
+            numa_pin_worker(worker_id);
+        }
+
+        ws_work *ws_job = NULL;
+        if (work_queue.jobs == NULL &&
+            (ws_job = ws_find_job()) != NULL) {
+            // Help out with a work-stealing job. If I own a job, it
+            // has no tasks left to claim, so rather than sit idle
+            // waiting for it I join in as a guest.
+            ws_help_already_locked(ws_job, owned_job ? -1 : worker_id);
+            spun = false;
+        } else if (work_queue.jobs == NULL) {
             if (owned_job) {
                 // There are no jobs pending. Wait for the last worker
-                // to signal that the job is finished.
+                // to signal that the job is finished, or for a new
+                // job to help with.
                 halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
             } else if (work_queue.a_team_size <= work_queue.target_a_team_size) {
-                // There are no jobs pending. Wait until more jobs are enqueued.
-                halide_cond_wait(&work_queue.wakeup_a_team, &work_queue.mutex);
+                if (!spun && work_queue.spin_count != 0) {
+                    // There are no jobs pending, but more may arrive
+                    // soon. Spin for a bit before sleeping.
+                    spin_for_work_already_locked();
+                    spun = true;
+                } else {
+                    // There are no jobs pending. Wait until more jobs are enqueued.
+                    halide_cond_wait(&work_queue.wakeup_a_team, &work_queue.mutex);
+                    spun = false;
+                }
             } else {
                 // There are no jobs pending, and there are too many
                 // threads in the A team. Transition to the B team
@@ -163,6 +544,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
             // We are no longer active on this job
             job->active_workers--;
+            spun = false;
 
             // If the job is done and I'm not the owner of it, wake up
             // the owner.
@@ -173,12 +555,141 @@ WEAK void worker_thread_already_locked(work *owned_job) {
     }
 }
 
-WEAK void worker_thread(void *) {
+WEAK void parallel_tasks_helper_thread(void *arg) {
+    parallel_tasks_helper *helper = (parallel_tasks_helper *)arg;
+    halide_mutex_lock(&work_queue.mutex);
+    while (work_queue.running()) {
+        parallel_tasks_job *job = helper->job;
+        if (!job) {
+            halide_cond_wait(&helper->wakeup, &work_queue.mutex);
+            continue;
+        }
+
+        halide_mutex_unlock(&work_queue.mutex);
+        int result = halide_do_task(job->user_context, job->f, helper->idx, job->closure);
+        halide_mutex_lock(&work_queue.mutex);
+
+        if (result) {
+            job->exit_status = result;
+        }
+        job->remaining--;
+        if (job->remaining == 0) {
+            halide_cond_broadcast(&work_queue.wakeup_owners);
+        }
+
+        helper->job = NULL;
+        helper->next_idle = work_queue.idle_helpers;
+        work_queue.idle_helpers = helper;
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
+WEAK void worker_thread(void *arg) {
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked(NULL);
+    worker_thread_already_locked(NULL, (int)(intptr_t)arg);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
+// The work-stealing version of do_par_for. Must be called while
+// locked, and returns with the queue unlocked.
+WEAK int ws_do_par_for_already_locked(void *user_context, halide_task_t f,
+                                      int min, int size, uint8_t *closure) {
+    ws_work job;
+    job.f = f;
+    job.user_context = user_context;
+    job.closure = closure;
+    job.min = min;
+    job.num_slots = work_queue.threads_created + 1;
+    // alloca only guarantees stack alignment, so over-allocate and
+    // round up to put each range on its own cache line.
+    const uintptr_t cache_line = sizeof(ws_range);
+    uintptr_t slot_storage = (uintptr_t)__builtin_alloca(job.num_slots * sizeof(ws_range) + cache_line - 1);
+    job.slots = (ws_range *)((slot_storage + cache_line - 1) & ~(cache_line - 1));
+    job.remaining = size;
+    job.active_workers = 0;
+    job.exhausted = false;
+    job.exit_status = 0;
+
+    // Deal out the tasks evenly. The owner takes the last range.
+    for (int i = 0; i < job.num_slots; i++) {
+        uint32_t begin = (uint32_t)(((int64_t)size * i) / job.num_slots);
+        uint32_t end = (uint32_t)(((int64_t)size * (i + 1)) / job.num_slots);
+        job.slots[i].packed = ws_pack(begin, end);
+        job.slots[i].node = (i < job.num_slots - 1) ? numa_worker_node(i) : -1;
+    }
+
+    job.next_job = work_queue.ws_jobs;
+    work_queue.ws_jobs = &job;
+    work_queue.target_a_team_size = work_queue.desired_num_threads;
+    halide_cond_broadcast(&work_queue.wakeup_a_team);
+    // Threads waiting for their own jobs to finish can help too.
+    halide_cond_broadcast(&work_queue.wakeup_owners);
+    if (work_queue.target_a_team_size > work_queue.a_team_size) {
+        halide_cond_broadcast(&work_queue.wakeup_b_team);
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+
+    ws_run_job(&job, job.num_slots - 1);
+
+    halide_mutex_lock(&work_queue.mutex);
+    // Stop any more workers from joining, then wait for the ones
+    // still inside to finish their last tasks. Once none remain
+    // active it is safe to let the job go out of scope.
+    ws_work **prev = &work_queue.ws_jobs;
+    while (*prev != &job) {
+        prev = &((*prev)->next_job);
+    }
+    *prev = job.next_job;
+    while (job.active_workers > 0 ||
+           __atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0) {
+        // Rather than sit idle while the last tasks finish, help with
+        // any other work-stealing job, such as a loop nested inside
+        // one of those tasks.
+        ws_work *other = ws_find_job();
+        if (other) {
+            ws_help_already_locked(other, -1);
+        } else {
+            halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
+        }
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+
+    return job.exit_status;
+}
+
+// Set up the work queue the first time anything uses it. Must be
+// called while locked.
+WEAK void initialize_work_queue_already_locked() {
+    if (work_queue.initialized) {
+        return;
+    }
+    work_queue.assert_zeroed();
+
+    // Compute the desired number of threads to use. Other code
+    // can also mess with this value, but only when the work queue
+    // is locked.
+    if (!work_queue.desired_num_threads) {
+        work_queue.desired_num_threads = default_desired_num_threads();
+    }
+    work_queue.desired_num_threads = clamp_num_threads(work_queue.desired_num_threads);
+    if (!work_queue.work_stealing) {
+        work_queue.work_stealing = default_work_stealing();
+    }
+    if (!work_queue.numa_aware) {
+        work_queue.numa_aware = default_numa_aware();
+    }
+    if (!work_queue.spin_count_set) {
+        work_queue.spin_count = default_spin_count();
+        work_queue.spin_count_set = true;
+    }
+    work_queue.threads_created = 0;
+
+    // Everyone starts on the a team.
+    work_queue.a_team_size = work_queue.desired_num_threads;
+
+    work_queue.initialized = true;
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
 
@@ -211,29 +722,20 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     // field will be zero-initialized because it's a static global.
     halide_mutex_lock(&work_queue.mutex);
 
-    if (!work_queue.initialized) {
-        work_queue.assert_zeroed();
-
-        // Compute the desired number of threads to use. Other code
-        // can also mess with this value, but only when the work queue
-        // is locked.
-        if (!work_queue.desired_num_threads) {
-            work_queue.desired_num_threads = default_desired_num_threads();
-        }
-        work_queue.desired_num_threads = clamp_num_threads(work_queue.desired_num_threads);
-        work_queue.threads_created = 0;
-
-        // Everyone starts on the a team.
-        work_queue.a_team_size = work_queue.desired_num_threads;
-
-        work_queue.initialized = true;
-    }
+    initialize_work_queue_already_locked();
 
     while (work_queue.threads_created < work_queue.desired_num_threads - 1) {
         // We might need to make some new threads, if work_queue.desired_num_threads has
         // increased.
-        work_queue.threads[work_queue.threads_created++] =
-            halide_spawn_thread(worker_thread, NULL);
+        work_queue.threads[work_queue.threads_created] =
+            halide_spawn_thread(worker_thread, (void *)(intptr_t)work_queue.threads_created);
+        work_queue.threads_created++;
+    }
+
+    // NUMA-aware mode relies on each worker having its own contiguous
+    // range of the loop, so it always uses work-stealing.
+    if (work_queue.work_stealing > 0 || work_queue.numa_aware > 0) {
+        return ws_do_par_for_already_locked(user_context, f, min, size, closure);
     }
 
     // Make the job.
@@ -274,7 +776,7 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     }
 
     // Do some work myself.
-    worker_thread_already_locked(&job);
+    worker_thread_already_locked(&job, -1);
 
     halide_mutex_unlock(&work_queue.mutex);
 
@@ -283,6 +785,113 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     return job.exit_status;
 }
 
+WEAK int halide_do_parallel_tasks(void *user_context, halide_task_t f,
+                                  int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    parallel_tasks_job job;
+    job.f = f;
+    job.user_context = user_context;
+    job.closure = closure;
+    job.remaining = size - 1;
+    job.exit_status = 0;
+
+    halide_mutex_lock(&work_queue.mutex);
+    // The helpers live in the part of the work queue that must be
+    // zero until it has been initialized.
+    initialize_work_queue_already_locked();
+
+    // The tasks may block waiting on each other, so they must all run
+    // at once. Fail up front if there aren't enough helpers for that.
+    int available = MAX_THREADS - work_queue.helpers_created;
+    for (parallel_tasks_helper *h = work_queue.idle_helpers;
+         h != NULL && available < size - 1; h = h->next_idle) {
+        available++;
+    }
+    if (available < size - 1) {
+        halide_mutex_unlock(&work_queue.mutex);
+        halide_error(user_context, "halide_do_parallel_tasks: too many concurrent tasks.\n");
+        return -1;
+    }
+
+    // Hand all but the last task to helper threads, making new ones
+    // if there aren't enough idle.
+    for (int i = 0; i < size - 1; i++) {
+        parallel_tasks_helper *helper = work_queue.idle_helpers;
+        if (helper) {
+            work_queue.idle_helpers = helper->next_idle;
+        } else {
+            helper = work_queue.helpers + work_queue.helpers_created++;
+            helper->thread = halide_spawn_thread(parallel_tasks_helper_thread, helper);
+        }
+        helper->job = &job;
+        helper->idx = min + i;
+        halide_cond_signal(&helper->wakeup);
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+
+    int result = halide_do_task(user_context, f, min + size - 1, closure);
+
+    halide_mutex_lock(&work_queue.mutex);
+    while (job.remaining > 0) {
+        halide_cond_wait(&work_queue.wakeup_owners, &work_queue.mutex);
+    }
+    halide_mutex_unlock(&work_queue.mutex);
+
+    return result ? result : job.exit_status;
+}
+
+WEAK int halide_semaphore_init(halide_semaphore_t *s, int n) {
+    halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    sem->value = n;
+    sem->waiters = 0;
+    return 0;
+}
+
+WEAK int halide_semaphore_release(halide_semaphore_t *s, int n) {
+    halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    __sync_fetch_and_add(&sem->value, n);
+    if (__sync_fetch_and_add(&sem->waiters, 0) > 0) {
+        // Someone may be sleeping on this semaphore. Taking the lock
+        // before broadcasting ensures they are either already asleep,
+        // or will see the new value before they go to sleep.
+        halide_mutex_lock(&work_queue.mutex);
+        halide_cond_broadcast(&work_queue.wakeup_semaphore_waiters);
+        halide_mutex_unlock(&work_queue.mutex);
+    }
+    return 0;
+}
+
+WEAK bool halide_semaphore_try_acquire(halide_semaphore_t *s, int n) {
+    halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    int old = __atomic_load_n(&sem->value, __ATOMIC_ACQUIRE);
+    while (old >= n) {
+        int seen = __sync_val_compare_and_swap(&sem->value, old, old - n);
+        if (seen == old) {
+            return true;
+        }
+        old = seen;
+    }
+    return false;
+}
+
+WEAK int halide_semaphore_acquire(halide_semaphore_t *s, int n) {
+    if (halide_semaphore_try_acquire(s, n)) {
+        return 0;
+    }
+    halide_semaphore_impl_t *sem = (halide_semaphore_impl_t *)s;
+    halide_mutex_lock(&work_queue.mutex);
+    __sync_fetch_and_add(&sem->waiters, 1);
+    while (!halide_semaphore_try_acquire(s, n)) {
+        halide_cond_wait(&work_queue.wakeup_semaphore_waiters, &work_queue.mutex);
+    }
+    __sync_fetch_and_sub(&sem->waiters, 1);
+    halide_mutex_unlock(&work_queue.mutex);
+    return 0;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(NULL, "halide_set_num_threads: must be >= 0.");
@@ -300,8 +909,42 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+WEAK int halide_set_work_stealing(int enable) {
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.work_stealing) {
+        work_queue.work_stealing = default_work_stealing();
+    }
+    int old = work_queue.work_stealing > 0;
+    work_queue.work_stealing = enable ? 1 : -1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_set_numa_aware(int enable) {
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.numa_aware) {
+        work_queue.numa_aware = default_numa_aware();
+    }
+    int old = work_queue.numa_aware > 0;
+    work_queue.numa_aware = enable ? 1 : -1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_set_worker_spin_count(int spin_count) {
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.spin_count_set) {
+        work_queue.spin_count = default_spin_count();
+    }
+    int old = work_queue.spin_count;
+    work_queue.spin_count = spin_count;
+    work_queue.spin_count_set = true;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
 WEAK void halide_shutdown_thread_pool() {
-    if (work_queue.initialized) {
+    if (work_queue.initialized || work_queue.helpers_created) {
         // Wake everyone up and tell them the party's over and it's time
         // to go home
         halide_mutex_lock(&work_queue.mutex);
@@ -309,12 +952,18 @@ WEAK void halide_shutdown_thread_pool() {
         halide_cond_broadcast(&work_queue.wakeup_owners);
         halide_cond_broadcast(&work_queue.wakeup_a_team);
         halide_cond_broadcast(&work_queue.wakeup_b_team);
+        for (int i = 0; i < work_queue.helpers_created; i++) {
+            halide_cond_signal(&work_queue.helpers[i].wakeup);
+        }
         halide_mutex_unlock(&work_queue.mutex);
 
         // Wait until they leave
         for (int i = 0; i < work_queue.threads_created; i++) {
             halide_join_thread(work_queue.threads[i]);
         }
+        for (int i = 0; i < work_queue.helpers_created; i++) {
+            halide_join_thread(work_queue.helpers[i].thread);
+        }
 
         // Tidy up
         work_queue.reset();
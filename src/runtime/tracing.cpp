@@ -70,13 +70,19 @@ public:
 
 const static int buffer_size = 1024 * 1024;
 
-class TraceBuffer {
+// The trace buffer is split into shards, and each thread writes to
+// the shard picked by its stack address, so that threads tracing in
+// parallel mostly don't touch the same cache lines or contend on the
+// same lock word.
+const static int num_shards = 16;
+
+struct TraceShard {
     SharedExclusiveSpinLock lock;
     uint32_t cursor, overage;
     uint8_t buf[buffer_size];
 
-    // Attempt to atomically acquire space in the buffer to write a
-    // packet. Returns NULL if the buffer was full.
+    // Attempt to atomically acquire space in the shard to write a
+    // packet. Returns NULL if the shard was full.
     __attribute__((always_inline)) halide_trace_packet_t *try_acquire_packet(void *user_context, uint32_t size) {
         lock.acquire_shared();
         halide_assert(user_context, size <= buffer_size);
@@ -93,21 +99,266 @@ class TraceBuffer {
             return (halide_trace_packet_t *)(buf + my_cursor);
         }
     }
+};
+
+// An entry in the index of chunks written at the end of a compressed
+// trace.
+struct TraceChunkEntry {
+    uint64_t offset;
+    int32_t first_id;
+    uint32_t num_packets;
+};
+
+const static int compression_hash_bits = 12;
+
+WEAK uint32_t load_u32(const uint8_t *p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+WEAK uint32_t put_length(uint8_t *dst, uint32_t op, uint32_t n) {
+    while (n >= 255) {
+        dst[op++] = 255;
+        n -= 255;
+    }
+    dst[op++] = (uint8_t)n;
+    return op;
+}
+
+// Append one sequence of the block compression described in
+// tools/halide_trace_stream.h: literals and then, unless length is
+// zero, a match.
+WEAK uint32_t put_sequence(uint8_t *dst, uint32_t op,
+                           const uint8_t *literals, uint32_t num_literals,
+                           uint32_t offset, uint32_t length) {
+    uint32_t lit_nibble = num_literals < 15 ? num_literals : 15;
+    uint32_t len_nibble = 0;
+    if (length) {
+        len_nibble = (length - 4) < 15 ? (length - 4) : 15;
+    }
+    dst[op++] = (uint8_t)((lit_nibble << 4) | len_nibble);
+    if (lit_nibble == 15) {
+        op = put_length(dst, op, num_literals - 15);
+    }
+    memcpy(dst + op, literals, num_literals);
+    op += num_literals;
+    if (length) {
+        dst[op++] = (uint8_t)(offset & 0xff);
+        dst[op++] = (uint8_t)(offset >> 8);
+        if (len_nibble == 15) {
+            op = put_length(dst, op, length - 4 - 15);
+        }
+    }
+    return op;
+}
+
+// Compress n bytes from src into dst, which must have room for
+// n + n / 255 + 16 bytes. Returns the compressed size.
+WEAK uint32_t compress_block(const uint8_t *src, uint32_t n, uint8_t *dst, uint32_t *table) {
+    memset(table, 0, sizeof(uint32_t) << compression_hash_bits);
+    uint32_t ip = 0, anchor = 0, op = 0;
+    while (ip + 4 <= n) {
+        uint32_t seq = load_u32(src + ip);
+        uint32_t h = (seq * 2654435761U) >> (32 - compression_hash_bits);
+        // Table entries are one more than a position, so that zero
+        // means empty.
+        uint32_t candidate = table[h];
+        table[h] = ip + 1;
+        if (candidate && ip - (candidate - 1) <= 0xffff &&
+            load_u32(src + candidate - 1) == seq) {
+            uint32_t ref = candidate - 1;
+            uint32_t length = 4;
+            while (ip + length < n && src[ref + length] == src[ip + length]) {
+                length++;
+            }
+            op = put_sequence(dst, op, src + anchor, ip - anchor, ip - ref, length);
+            ip += length;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+    return put_sequence(dst, op, src + anchor, n - anchor, 0, 0);
+}
+
+class TraceBuffer {
+    TraceShard shards[num_shards];
+
+    // Packets are gathered here in order when flushing, so that they
+    // can be written out in large chunks.
+    uint32_t out_cursor;
+    uint8_t out[buffer_size];
+
+    // State for writing the compressed format described in
+    // tools/halide_trace_stream.h. Each batch of packets gathered in
+    // out becomes one chunk.
+    bool compress;
+    uint64_t bytes_written;
+    uint32_t out_packets;
+    int32_t out_first_id;
+    const halide_trace_packet_t *out_prev;
+    TraceChunkEntry *chunks;
+    uint32_t num_chunks, chunks_capacity;
+    uint32_t hash_table[1 << compression_hash_bits];
+    uint8_t compressed[buffer_size + buffer_size / 255 + 16];
+
+    __attribute__((always_inline)) TraceShard &current_shard() {
+        int local;
+        uint64_t a = (uint64_t)(uintptr_t)&local >> 20;
+        a *= 0x9E3779B97F4A7C15ULL;
+        return shards[a >> 60];
+    }
+
+    static bool write_all(int fd, const void *data, uint32_t size) {
+        return size == (uint32_t)write(fd, data, size);
+    }
+
+    bool add_chunk_entry(const TraceChunkEntry &e) {
+        if (num_chunks == chunks_capacity) {
+            uint32_t new_capacity = chunks_capacity ? chunks_capacity * 2 : 64;
+            TraceChunkEntry *new_chunks = (TraceChunkEntry *)malloc(new_capacity * sizeof(TraceChunkEntry));
+            if (!new_chunks) {
+                return false;
+            }
+            if (chunks) {
+                memcpy(new_chunks, chunks, num_chunks * sizeof(TraceChunkEntry));
+                free(chunks);
+            }
+            chunks = new_chunks;
+            chunks_capacity = new_capacity;
+        }
+        chunks[num_chunks++] = e;
+        return true;
+    }
+
+    bool write_chunk(int fd) {
+        bool success = true;
+        if (bytes_written == 0) {
+            uint32_t version = 1;
+            success &= write_all(fd, "HLTRACEZ", 8);
+            success &= write_all(fd, &version, sizeof(version));
+            bytes_written = 8 + sizeof(version);
+        }
+        uint32_t compressed_size = compress_block(out, out_cursor, compressed, hash_table);
+        uint32_t header[5] = {0x43544c48 /* HLTC */, out_cursor, compressed_size,
+                              out_packets, (uint32_t)out_first_id};
+        TraceChunkEntry e = {bytes_written, out_first_id, out_packets};
+        success &= add_chunk_entry(e);
+        success &= write_all(fd, header, sizeof(header));
+        success &= write_all(fd, compressed, compressed_size);
+        bytes_written += sizeof(header) + compressed_size;
+        return success;
+    }
+
+    bool write_out(int fd) {
+        bool success = compress ? write_chunk(fd) : write_all(fd, out, out_cursor);
+        out_cursor = 0;
+        out_packets = 0;
+        out_prev = NULL;
+        return success;
+    }
+
+    // Copy a packet into out. In the compressed format, a packet the
+    // same size as the previous one in the chunk is stored as the
+    // difference of all its words but the first.
+    void append_packet(const halide_trace_packet_t *p) {
+        if (compress && out_prev && out_prev->size == p->size) {
+            const uint32_t *src = (const uint32_t *)p;
+            const uint32_t *prev = (const uint32_t *)out_prev;
+            uint32_t *dst = (uint32_t *)(out + out_cursor);
+            dst[0] = src[0];
+            for (uint32_t i = 1; i < p->size / 4; i++) {
+                dst[i] = src[i] - prev[i];
+            }
+        } else {
+            memcpy(out + out_cursor, p, p->size);
+        }
+        if (out_packets == 0) {
+            out_first_id = p->id;
+        }
+        out_packets++;
+        out_prev = p;
+        out_cursor += p->size;
+    }
 
 public:
 
     // Wait for all writers to finish with their packets, stall any
-    // new writers, and flush the buffer to the fd.
+    // new writers, and flush the buffer to the fd. The shards are
+    // merged in order of packet id, so the trace file is ordered as
+    // the events were issued, regardless of which threads wrote them.
     __attribute__((always_inline)) void flush(void *user_context, int fd) {
-        lock.acquire_exclusive();
+        // Always lock the shards in the same order, so that
+        // concurrent flushes can't deadlock.
+        for (int i = 0; i < num_shards; i++) {
+            shards[i].lock.acquire_exclusive();
+        }
+        uint32_t heads[num_shards];
+        for (int i = 0; i < num_shards; i++) {
+            shards[i].cursor -= shards[i].overage;
+            shards[i].overage = 0;
+            heads[i] = 0;
+        }
         bool success = true;
-        if (cursor) {
-            cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
-            cursor = 0;
-            overage = 0;
+        out_cursor = 0;
+        while (true) {
+            // Find the shard whose next packet has the lowest id.
+            int next = -1;
+            int32_t next_id = 0;
+            for (int i = 0; i < num_shards; i++) {
+                if (heads[i] < shards[i].cursor) {
+                    const halide_trace_packet_t *p =
+                        (const halide_trace_packet_t *)(shards[i].buf + heads[i]);
+                    if (next < 0 || p->id < next_id) {
+                        next = i;
+                        next_id = p->id;
+                    }
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            const halide_trace_packet_t *p =
+                (const halide_trace_packet_t *)(shards[next].buf + heads[next]);
+            if (out_cursor + p->size > sizeof(out)) {
+                success &= write_out(fd);
+            }
+            append_packet(p);
+            heads[next] += p->size;
+        }
+        if (out_cursor) {
+            success &= write_out(fd);
+        }
+        for (int i = num_shards - 1; i >= 0; i--) {
+            shards[i].cursor = 0;
+            shards[i].lock.release_exclusive();
+        }
+        halide_assert(user_context, success && "Could not write to trace file");
+    }
+
+    void set_compressed() {
+        compress = true;
+    }
+
+    // Write the chunk index and footer of a compressed trace. Must be
+    // called after the final flush.
+    void finish(void *user_context, int fd) {
+        if (!compress || bytes_written == 0) {
+            return;
+        }
+        bool success = true;
+        uint64_t index_offset = bytes_written;
+        uint32_t header[2] = {0x49544c48 /* HLTI */, num_chunks};
+        success &= write_all(fd, header, sizeof(header));
+        for (uint32_t i = 0; i < num_chunks; i++) {
+            success &= write_all(fd, &chunks[i], sizeof(TraceChunkEntry));
         }
-        lock.release_exclusive();
+        success &= write_all(fd, &index_offset, sizeof(index_offset));
+        success &= write_all(fd, "HLTRIDX", 8);
+        free(chunks);
+        chunks = NULL;
+        num_chunks = chunks_capacity = 0;
         halide_assert(user_context, success && "Could not write to trace file");
     }
 
@@ -116,9 +367,11 @@ public:
     // if necessary. The region acquired is protected from other
     // threads writing or reading to it, so it must be released before
     // a flush can occur.
-    __attribute__((always_inline)) halide_trace_packet_t *acquire_packet(void *user_context, int fd, uint32_t size) {
+    __attribute__((always_inline)) halide_trace_packet_t *acquire_packet(void *user_context, int fd, uint32_t size,
+                                                                         TraceShard **shard) {
         halide_trace_packet_t *packet = NULL;
-        while (!(packet = try_acquire_packet(user_context, size))) {
+        *shard = &current_shard();
+        while (!(packet = (*shard)->try_acquire_packet(user_context, size))) {
             // Couldn't acquire space to write a packet. Flush and try again.
             flush(user_context, fd);
         }
@@ -126,13 +379,11 @@ public:
     }
 
     // Release a packet, allowing it to be written out with flush
-    __attribute__((always_inline)) void release_packet(halide_trace_packet_t *) {
+    __attribute__((always_inline)) void release_packet(TraceShard *shard, halide_trace_packet_t *) {
         // Need a memory barrier to guarantee all the writes are done.
         __sync_synchronize();
-        lock.release_shared();
+        shard->lock.release_shared();
     }
-
-    TraceBuffer() : cursor(0), overage(0) {}
 };
 
 WEAK TraceBuffer *halide_trace_buffer = NULL;
@@ -163,7 +414,8 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         uint32_t total_size = (total_size_without_padding + 3) & ~3;
 
         // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
+        TraceShard *shard;
+        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size, &shard);
 
         if (total_size > 4096) {
             print(NULL) << total_size << "\n";
@@ -187,7 +439,7 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
 
         // Release it
-        halide_trace_buffer->release_packet(packet);
+        halide_trace_buffer->release_packet(shard, packet);
 
         // We should also flush the trace buffer if we hit an event
         // that might be the end of the trace.
@@ -331,12 +583,22 @@ WEAK int halide_get_trace_file(void *user_context) {
     if (halide_trace_file < 0) {
         const char *trace_file_name = getenv("HL_TRACE_FILE");
         if (trace_file_name) {
-            void *file = fopen(trace_file_name, "ab");
+            // A compressed trace can't be appended to an existing
+            // file, so it replaces it instead.
+            const char *compress_str = getenv("HL_TRACE_COMPRESS");
+            bool compress = compress_str && atoi(compress_str);
+            void *file = fopen(trace_file_name, compress ? "wb" : "ab");
             halide_assert(user_context, file && "Failed to open trace file\n");
             halide_set_trace_file(fileno(file));
             halide_trace_file_internally_opened = file;
             if (!halide_trace_buffer) {
+                // An all-zero TraceBuffer is empty and unlocked.
                 halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+                halide_assert(user_context, halide_trace_buffer && "Failed to allocate trace buffer\n");
+                memset(halide_trace_buffer, 0, sizeof(TraceBuffer));
+            }
+            if (compress) {
+                halide_trace_buffer->set_compressed();
             }
         } else {
             halide_set_trace_file(0);
@@ -351,12 +613,17 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 
 WEAK int halide_shutdown_trace() {
     if (halide_trace_file_internally_opened) {
+        if (halide_trace_buffer) {
+            halide_trace_buffer->flush(NULL, halide_trace_file);
+            halide_trace_buffer->finish(NULL, halide_trace_file);
+        }
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = NULL;
         if (halide_trace_buffer) {
             free(halide_trace_buffer);
+            halide_trace_buffer = NULL;
         }
         return ret;
     } else {
@@ -0,0 +1,1658 @@
+#include "HalideRuntimeVulkan.h"
+#include "device_buffer_utils.h"
+#include "device_interface.h"
+#include "gpu_kernel_cache.h"
+#include "printer.h"
+#include "mini_vulkan.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+// Define the function pointers for the Vulkan API.
+WEAK PFN_vkVoidFunction (VKAPI_CALL *vkGetInstanceProcAddr)(VkInstance, const char *);
+#define VULKAN_FN_GLOBAL(ret, fn, args) WEAK ret (VKAPI_CALL *fn)args;
+#define VULKAN_FN_INSTANCE(ret, fn, args) WEAK ret (VKAPI_CALL *fn)args;
+#define VULKAN_FN_DEVICE(ret, fn, args) WEAK ret (VKAPI_CALL *fn)args;
+#include "vulkan_functions.h"
+
+// The instance and device the function pointers above were last
+// loaded for.
+WEAK VkInstance functions_instance = NULL;
+WEAK VkDevice functions_device = NULL;
+
+WEAK void *lib_vulkan = NULL;
+
+// Load the Vulkan loader and the functions that don't need an
+// instance.
+WEAK int load_libvulkan(void *user_context) {
+    if (vkGetInstanceProcAddr != NULL) {
+        return 0;
+    }
+    debug(user_context) << "    load_libvulkan (user_context: " << user_context << ")\n";
+
+    // The loader may already be linked into the process.
+    vkGetInstanceProcAddr = (PFN_vkVoidFunction (VKAPI_CALL *)(VkInstance, const char *))
+        halide_get_library_symbol(lib_vulkan, "vkGetInstanceProcAddr");
+    if (vkGetInstanceProcAddr == NULL) {
+        const char *lib_names[] = {
+            "libvulkan.so.1",
+            "libvulkan.so",
+            "libvulkan.1.dylib",
+            "libvulkan.dylib",
+            "vulkan-1.dll",
+        };
+        for (size_t i = 0; i < sizeof(lib_names) / sizeof(lib_names[0]); i++) {
+            lib_vulkan = halide_load_library(lib_names[i]);
+            if (lib_vulkan) {
+                debug(user_context) << "    Loaded Vulkan loader library: " << lib_names[i] << "\n";
+                break;
+            }
+        }
+        vkGetInstanceProcAddr = (PFN_vkVoidFunction (VKAPI_CALL *)(VkInstance, const char *))
+            halide_get_library_symbol(lib_vulkan, "vkGetInstanceProcAddr");
+    }
+    if (vkGetInstanceProcAddr == NULL) {
+        error(user_context) << "Vulkan: Could not find the Vulkan loader.\n";
+        return -1;
+    }
+
+    #define VULKAN_FN_GLOBAL(ret, fn, args) fn = (ret (VKAPI_CALL *)args)vkGetInstanceProcAddr(NULL, #fn);
+    #include "vulkan_functions.h"
+    if (vkCreateInstance == NULL) {
+        error(user_context) << "Vulkan API not found: vkCreateInstance\n";
+        return -1;
+    }
+    return 0;
+}
+
+WEAK int load_instance_functions(void *user_context, VkInstance instance) {
+    if (functions_instance == instance) {
+        return 0;
+    }
+    int err = load_libvulkan(user_context);
+    if (err != 0) {
+        return err;
+    }
+    bool ok = true;
+    #define VULKAN_FN_INSTANCE(ret, fn, args) \
+        fn = (ret (VKAPI_CALL *)args)vkGetInstanceProcAddr(instance, #fn); \
+        if (fn == NULL) { error(user_context) << "Vulkan API not found: " #fn "\n"; ok = false; }
+    #include "vulkan_functions.h"
+    if (!ok) {
+        return -1;
+    }
+    functions_instance = instance;
+    return 0;
+}
+
+WEAK int load_device_functions(void *user_context, VkDevice device) {
+    if (functions_device == device) {
+        return 0;
+    }
+    bool ok = true;
+    #define VULKAN_FN_DEVICE(ret, fn, args) \
+        fn = (ret (VKAPI_CALL *)args)vkGetDeviceProcAddr(device, #fn); \
+        if (fn == NULL) { error(user_context) << "Vulkan API not found: " #fn "\n"; ok = false; }
+    #include "vulkan_functions.h"
+    if (!ok) {
+        return -1;
+    }
+    functions_device = device;
+    return 0;
+}
+
+WEAK const char *get_vulkan_error_name(VkResult err) {
+    switch (err) {
+    case VK_SUCCESS: return "VK_SUCCESS";
+    case VK_NOT_READY: return "VK_NOT_READY";
+    case VK_TIMEOUT: return "VK_TIMEOUT";
+    case VK_INCOMPLETE: return "VK_INCOMPLETE";
+    case VK_ERROR_OUT_OF_HOST_MEMORY: return "VK_ERROR_OUT_OF_HOST_MEMORY";
+    case VK_ERROR_OUT_OF_DEVICE_MEMORY: return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+    case VK_ERROR_INITIALIZATION_FAILED: return "VK_ERROR_INITIALIZATION_FAILED";
+    case VK_ERROR_DEVICE_LOST: return "VK_ERROR_DEVICE_LOST";
+    case VK_ERROR_MEMORY_MAP_FAILED: return "VK_ERROR_MEMORY_MAP_FAILED";
+    case VK_ERROR_LAYER_NOT_PRESENT: return "VK_ERROR_LAYER_NOT_PRESENT";
+    case VK_ERROR_EXTENSION_NOT_PRESENT: return "VK_ERROR_EXTENSION_NOT_PRESENT";
+    case VK_ERROR_FEATURE_NOT_PRESENT: return "VK_ERROR_FEATURE_NOT_PRESENT";
+    case VK_ERROR_INCOMPATIBLE_DRIVER: return "VK_ERROR_INCOMPATIBLE_DRIVER";
+    case VK_ERROR_TOO_MANY_OBJECTS: return "VK_ERROR_TOO_MANY_OBJECTS";
+    case VK_ERROR_FORMAT_NOT_SUPPORTED: return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+    case VK_ERROR_FRAGMENTED_POOL: return "VK_ERROR_FRAGMENTED_POOL";
+    case VK_ERROR_OUT_OF_POOL_MEMORY: return "VK_ERROR_OUT_OF_POOL_MEMORY";
+    default: return "<Unknown error>";
+    }
+}
+
+extern WEAK halide_device_interface_t vulkan_device_interface;
+
+// The default context, created on first use, and the spin lock that
+// serializes access to it.
+volatile int WEAK thread_lock = 0;
+WEAK VkInstance instance = NULL;
+WEAK VkPhysicalDevice physical_device = NULL;
+WEAK VkDevice device = NULL;
+WEAK VkQueue queue = NULL;
+WEAK uint32_t queue_family_index = 0;
+
+// A Vulkan buffer together with the memory bound to it.
+struct vulkan_buffer {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    // The start of the buffer in host memory, if the memory is host
+    // visible, or NULL.
+    uint8_t *mapped;
+    VkDeviceSize size;
+};
+
+struct device_handle {
+    vulkan_buffer buf;
+    // The byte offset of a crop or slice within buf.
+    uint64_t offset;
+    // Whether buf belongs to the handle, rather than to a wrapped
+    // buffer or to the buffer that was cropped.
+    bool owned;
+};
+
+// Recycled device_handles for crops and slices.
+WEAK crop_handle_pool<device_handle> crop_handles;
+
+// Dispatches are recorded into a single command buffer that is only
+// submitted once the results are needed, on a sync, a copy or the
+// release of a buffer. Each dispatch takes a descriptor set from a pool
+// and a slot in a ring of kernel argument memory; both are reset when
+// the batch completes.
+static const int MaxBatchDispatches = 64;
+static const int MaxKernelBuffers = 32;
+static const uint32_t ArgsBufferSize = 64 * 1024;
+static const uint32_t ArgsAlignment = 256;
+
+// The objects Halide creates on the device it runs on.
+struct vulkan_device_state {
+    VkDevice device;
+    VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    bool recording;
+    int num_dispatches;
+    VkDescriptorPool descriptor_pool;
+    uint32_t storage_descriptors_used;
+    vulkan_buffer args;
+    uint32_t args_used;
+    // Used to copy to and from device memory that is not host visible.
+    vulkan_buffer staging;
+    VkPipelineCache pipeline_cache;
+    bool pipeline_cache_dirty;
+};
+WEAK vulkan_device_state dev_state = { };
+
+// A compute pipeline for one entry point of a module, specialized for
+// a workgroup size.
+struct pipeline_entry {
+    char *entry_name;
+    uint32_t threads[3];
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout pipeline_layout;
+    VkPipeline pipeline;
+    pipeline_entry *next;
+};
+
+// Structure to hold the state of a module attached to the context.
+// Also used as a linked-list to keep track of all the different
+// modules that are attached to a context in order to release them all
+// when then context is released.
+struct module_state {
+    VkShaderModule shader_module;
+    pipeline_entry *pipelines;
+    module_state *next;
+};
+WEAK module_state *state_list = NULL;
+
+WEAK int create_vulkan_context(void *user_context) {
+    int err = load_libvulkan(user_context);
+    if (err != 0) {
+        return err;
+    }
+
+    VkApplicationInfo app_info = {
+        VK_STRUCTURE_TYPE_APPLICATION_INFO, NULL,
+        "Halide", 0, "Halide", 0, VK_API_VERSION_1_0
+    };
+    VkInstanceCreateInfo instance_info = {
+        VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO, NULL, 0,
+        &app_info, 0, NULL, 0, NULL
+    };
+    debug(user_context) << "    vkCreateInstance -> ";
+    VkResult result = vkCreateInstance(&instance_info, NULL, &instance);
+    debug(user_context) << get_vulkan_error_name(result) << "\n";
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateInstance failed: " << get_vulkan_error_name(result) << "\n";
+        instance = NULL;
+        return result;
+    }
+    err = load_instance_functions(user_context, instance);
+    if (err != 0) {
+        return err;
+    }
+
+    const uint32_t max_devices = 16;
+    VkPhysicalDevice devices[max_devices];
+    uint32_t num_devices = max_devices;
+    result = vkEnumeratePhysicalDevices(instance, &num_devices, devices);
+    if ((result != VK_SUCCESS && result != VK_INCOMPLETE) || num_devices == 0) {
+        error(user_context) << "Vulkan: No physical devices found.\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        return -1;
+    }
+
+    // Use the device selected with HL_GPU_DEVICE, or else the first
+    // one with a compute queue.
+    int requested = halide_get_gpu_device(user_context);
+    physical_device = NULL;
+    for (uint32_t i = 0; i < num_devices && physical_device == NULL; i++) {
+        if (requested >= 0 && (uint32_t)requested != i) {
+            continue;
+        }
+        const uint32_t max_families = 16;
+        VkQueueFamilyProperties families[max_families];
+        uint32_t num_families = max_families;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &num_families, families);
+        for (uint32_t j = 0; j < num_families; j++) {
+            if (families[j].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                physical_device = devices[i];
+                queue_family_index = j;
+                break;
+            }
+        }
+    }
+    if (physical_device == NULL) {
+        error(user_context) << "Vulkan: No physical device with a compute queue found.\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        return -1;
+    }
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {
+        VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO, NULL, 0,
+        queue_family_index, 1, &priority
+    };
+    VkDeviceCreateInfo device_info = {
+        VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO, NULL, 0,
+        1, &queue_info, 0, NULL, 0, NULL, NULL
+    };
+    debug(user_context) << "    vkCreateDevice -> ";
+    result = vkCreateDevice(physical_device, &device_info, NULL, &device);
+    debug(user_context) << get_vulkan_error_name(result) << "\n";
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateDevice failed: " << get_vulkan_error_name(result) << "\n";
+        vkDestroyInstance(instance, NULL);
+        instance = NULL;
+        device = NULL;
+        return result;
+    }
+    err = load_device_functions(user_context, device);
+    if (err != 0) {
+        return err;
+    }
+    vkGetDeviceQueue(device, queue_family_index, 0, &queue);
+    return 0;
+}
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::Vulkan;
+
+extern "C" {
+
+// The default implementation of halide_vulkan_acquire_context uses the
+// global pointers above, and serializes access with a spin lock.
+// Overriding implementations of acquire/release must implement the following
+// behavior:
+// - halide_vulkan_acquire_context should always store a valid
+//   instance/physical device/device/queue in the outputs, or return an
+//   error code.
+// - A call to halide_vulkan_acquire_context is followed by a matching call to
+//   halide_vulkan_release_context. halide_vulkan_acquire_context should block while a
+//   previous call (if any) has not yet been released via halide_vulkan_release_context.
+WEAK int halide_vulkan_acquire_context(void *user_context,
+                                       halide_vulkan_instance **instance_ret,
+                                       halide_vulkan_physical_device **physical_device_ret,
+                                       halide_vulkan_device **device_ret,
+                                       halide_vulkan_queue **queue_ret,
+                                       uint32_t *queue_family_index_ret,
+                                       bool create) {
+    halide_assert(user_context, &thread_lock != NULL);
+    while (__sync_lock_test_and_set(&thread_lock, 1)) { }
+
+    if (device == NULL && create) {
+        int err = create_vulkan_context(user_context);
+        if (err != 0) {
+            __sync_lock_release(&thread_lock);
+            return err;
+        }
+    }
+
+    *instance_ret = (halide_vulkan_instance *)instance;
+    *physical_device_ret = (halide_vulkan_physical_device *)physical_device;
+    *device_ret = (halide_vulkan_device *)device;
+    *queue_ret = (halide_vulkan_queue *)queue;
+    *queue_family_index_ret = queue_family_index;
+    return 0;
+}
+
+WEAK int halide_vulkan_release_context(void *user_context) {
+    __sync_lock_release(&thread_lock);
+    return 0;
+}
+
+} // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+// Pick a memory type allowed by type_bits, trying each of the sets of
+// property flags in order. Returns -1 if none is available.
+WEAK int find_memory_type(uint32_t type_bits, const VkFlags *candidates, int num_candidates) {
+    const VkPhysicalDeviceMemoryProperties &props = dev_state.memory_properties;
+    for (int c = 0; c < num_candidates; c++) {
+        for (uint32_t i = 0; i < props.memoryTypeCount; i++) {
+            if ((type_bits & (1u << i)) &&
+                (props.memoryTypes[i].propertyFlags & candidates[c]) == candidates[c]) {
+                return (int)i;
+            }
+        }
+    }
+    return -1;
+}
+
+WEAK void release_buffer(vulkan_buffer *buf) {
+    if (buf->buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(dev_state.device, buf->buffer, NULL);
+    }
+    if (buf->memory != VK_NULL_HANDLE) {
+        // Freeing the memory also unmaps it.
+        vkFreeMemory(dev_state.device, buf->memory, NULL);
+    }
+    memset(buf, 0, sizeof(vulkan_buffer));
+}
+
+// Create a buffer and allocate memory for it. Host visible memory is
+// mapped for the lifetime of the buffer.
+WEAK int create_buffer(void *user_context, VkDeviceSize size, VkFlags usage,
+                       const VkFlags *memory_candidates, int num_candidates,
+                       vulkan_buffer *buf) {
+    memset(buf, 0, sizeof(vulkan_buffer));
+    VkBufferCreateInfo buffer_info = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO, NULL, 0,
+        size, usage, VK_SHARING_MODE_EXCLUSIVE, 0, NULL
+    };
+    VkResult result = vkCreateBuffer(dev_state.device, &buffer_info, NULL, &buf->buffer);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateBuffer failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(dev_state.device, buf->buffer, &requirements);
+    int memory_type = find_memory_type(requirements.memoryTypeBits, memory_candidates, num_candidates);
+    if (memory_type < 0) {
+        error(user_context) << "Vulkan: No suitable memory type for a buffer of size " << (uint64_t)size << "\n";
+        release_buffer(buf);
+        return -1;
+    }
+    VkMemoryAllocateInfo alloc_info = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL,
+        requirements.size, (uint32_t)memory_type
+    };
+    result = vkAllocateMemory(dev_state.device, &alloc_info, NULL, &buf->memory);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkAllocateMemory of " << (uint64_t)requirements.size
+                            << " bytes failed: " << get_vulkan_error_name(result) << "\n";
+        release_buffer(buf);
+        return result;
+    }
+    result = vkBindBufferMemory(dev_state.device, buf->buffer, buf->memory, 0);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkBindBufferMemory failed: " << get_vulkan_error_name(result) << "\n";
+        release_buffer(buf);
+        return result;
+    }
+
+    VkFlags flags = dev_state.memory_properties.memoryTypes[memory_type].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void *mapped = NULL;
+        result = vkMapMemory(dev_state.device, buf->memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkMapMemory failed: " << get_vulkan_error_name(result) << "\n";
+            release_buffer(buf);
+            return result;
+        }
+        buf->mapped = (uint8_t *)mapped;
+    }
+    buf->size = size;
+    debug(user_context) << "    Allocated Vulkan buffer of " << (uint64_t)size << " bytes in memory type "
+                        << memory_type << (buf->mapped ? " (host visible)\n" : "\n");
+    return 0;
+}
+
+// The memory types for buffers that only the host reads and writes
+// directly.
+WEAK VkFlags host_memory_types[] = {
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+};
+
+// The memory types for Halide buffers: memory that is both device
+// local and host visible avoids the staging copies, and is common on
+// integrated and unified memory devices.
+WEAK VkFlags device_memory_types[] = {
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    0
+};
+
+WEAK KernelCacheKey make_pipeline_cache_key() {
+    const VkPhysicalDeviceProperties &props = dev_state.properties;
+    KernelCacheKey key;
+    key.add("pipeline cache");
+    key.add(&props.vendorID, sizeof(props.vendorID));
+    key.add(&props.deviceID, sizeof(props.deviceID));
+    key.add(&props.driverVersion, sizeof(props.driverVersion));
+    key.add(props.pipelineCacheUUID, sizeof(props.pipelineCacheUUID));
+    return key;
+}
+
+// Pipelines are created through a pipeline cache, which is loaded from
+// and stored to the kernel cache when one is enabled, so that drivers
+// can skip compiling the SPIR-V in later runs.
+WEAK int create_pipeline_cache(void *user_context) {
+    size_t initial_size = 0;
+    uint8_t *initial_data = NULL;
+    if (kernel_cache_dir()) {
+        initial_data = kernel_cache_load(user_context, "vulkan", make_pipeline_cache_key(), &initial_size);
+    }
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, NULL, 0,
+        initial_size, initial_data
+    };
+    VkResult result = vkCreatePipelineCache(dev_state.device, &cache_info, NULL, &dev_state.pipeline_cache);
+    if (result != VK_SUCCESS && initial_data) {
+        // The driver may reject stale data; start empty instead.
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        result = vkCreatePipelineCache(dev_state.device, &cache_info, NULL, &dev_state.pipeline_cache);
+    }
+    free(initial_data);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreatePipelineCache failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+    dev_state.pipeline_cache_dirty = false;
+    return 0;
+}
+
+WEAK void store_pipeline_cache(void *user_context) {
+    if (!dev_state.pipeline_cache_dirty || !kernel_cache_dir()) {
+        return;
+    }
+    size_t size = 0;
+    if (vkGetPipelineCacheData(dev_state.device, dev_state.pipeline_cache, &size, NULL) != VK_SUCCESS ||
+        size == 0) {
+        return;
+    }
+    void *data = malloc(size);
+    if (data == NULL) {
+        return;
+    }
+    if (vkGetPipelineCacheData(dev_state.device, dev_state.pipeline_cache, &size, data) == VK_SUCCESS) {
+        kernel_cache_store(user_context, "vulkan", make_pipeline_cache_key(), data, size);
+        dev_state.pipeline_cache_dirty = false;
+    }
+    free(data);
+}
+
+// Destroy the objects created by init_device_state. The device must be
+// idle.
+WEAK void release_device_state(void *user_context) {
+    if (dev_state.device == NULL) {
+        return;
+    }
+    if (dev_state.pipeline_cache != VK_NULL_HANDLE) {
+        store_pipeline_cache(user_context);
+        vkDestroyPipelineCache(dev_state.device, dev_state.pipeline_cache, NULL);
+    }
+    release_buffer(&dev_state.staging);
+    release_buffer(&dev_state.args);
+    if (dev_state.descriptor_pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(dev_state.device, dev_state.descriptor_pool, NULL);
+    }
+    if (dev_state.fence != VK_NULL_HANDLE) {
+        vkDestroyFence(dev_state.device, dev_state.fence, NULL);
+    }
+    if (dev_state.command_pool != VK_NULL_HANDLE) {
+        // Also frees the command buffer.
+        vkDestroyCommandPool(dev_state.device, dev_state.command_pool, NULL);
+    }
+    memset(&dev_state, 0, sizeof(dev_state));
+}
+
+WEAK int init_device_state(void *user_context, VkInstance instance, VkPhysicalDevice physical_device,
+                           VkDevice device, uint32_t queue_family_index) {
+    if (dev_state.device == device) {
+        return 0;
+    }
+    if (dev_state.device != NULL) {
+        error(user_context) << "Vulkan: The device changed without a call to halide_device_release.\n";
+        return -1;
+    }
+
+    int err = load_instance_functions(user_context, instance);
+    if (err == 0) {
+        err = load_device_functions(user_context, device);
+    }
+    if (err != 0) {
+        return err;
+    }
+
+    memset(&dev_state, 0, sizeof(dev_state));
+    dev_state.device = device;
+    vkGetPhysicalDeviceProperties(physical_device, &dev_state.properties);
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &dev_state.memory_properties);
+    debug(user_context) << "    Using Vulkan device: " << dev_state.properties.deviceName << "\n";
+
+    VkCommandPoolCreateInfo pool_info = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO, NULL,
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, queue_family_index
+    };
+    VkResult result = vkCreateCommandPool(device, &pool_info, NULL, &dev_state.command_pool);
+    if (result == VK_SUCCESS) {
+        VkCommandBufferAllocateInfo alloc_info = {
+            VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, NULL,
+            dev_state.command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1
+        };
+        result = vkAllocateCommandBuffers(device, &alloc_info, &dev_state.command_buffer);
+    }
+    if (result == VK_SUCCESS) {
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, NULL, 0};
+        result = vkCreateFence(device, &fence_info, NULL, &dev_state.fence);
+    }
+    if (result == VK_SUCCESS) {
+        VkDescriptorPoolSize pool_sizes[2] = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MaxBatchDispatches},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MaxBatchDispatches * MaxKernelBuffers / 4},
+        };
+        VkDescriptorPoolCreateInfo descriptor_pool_info = {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO, NULL, 0,
+            MaxBatchDispatches, 2, pool_sizes
+        };
+        result = vkCreateDescriptorPool(device, &descriptor_pool_info, NULL, &dev_state.descriptor_pool);
+    }
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: Could not create the command and descriptor pools: "
+                            << get_vulkan_error_name(result) << "\n";
+        release_device_state(user_context);
+        return result;
+    }
+
+    err = create_buffer(user_context, ArgsBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                        host_memory_types, 1, &dev_state.args);
+    if (err == 0) {
+        err = create_pipeline_cache(user_context);
+    }
+    if (err != 0) {
+        release_device_state(user_context);
+        return err;
+    }
+    return 0;
+}
+
+// Acquires the context and sets up the objects Halide uses on its
+// device. The context is released on destruction.
+class VulkanContext {
+    void *user_context;
+
+public:
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queue_family_index;
+    int error;
+
+    __attribute__((always_inline)) VulkanContext(void *user_context) : user_context(user_context),
+        instance(NULL), physical_device(NULL), device(NULL), queue(NULL), queue_family_index(0) {
+        error = halide_vulkan_acquire_context(user_context,
+                                              (halide_vulkan_instance **)&instance,
+                                              (halide_vulkan_physical_device **)&physical_device,
+                                              (halide_vulkan_device **)&device,
+                                              (halide_vulkan_queue **)&queue,
+                                              &queue_family_index, true);
+        if (error == 0) {
+            halide_assert(user_context, device != NULL && queue != NULL);
+            error = init_device_state(user_context, instance, physical_device, device, queue_family_index);
+        }
+    }
+
+    __attribute__((always_inline)) ~VulkanContext() {
+        halide_vulkan_release_context(user_context);
+    }
+};
+
+// Make the writes of the commands recorded so far visible to the
+// commands recorded next, in the given stages.
+WEAK void record_barrier(VkFlags dst_stages, VkFlags dst_access) {
+    VkMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL,
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, dst_access
+    };
+    vkCmdPipelineBarrier(dev_state.command_buffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         dst_stages, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+WEAK int begin_batch(void *user_context) {
+    if (dev_state.recording) {
+        return 0;
+    }
+    VkCommandBufferBeginInfo begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, NULL
+    };
+    VkResult result = vkBeginCommandBuffer(dev_state.command_buffer, &begin_info);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkBeginCommandBuffer failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+    dev_state.recording = true;
+    return 0;
+}
+
+// Submit the recorded commands and wait for them, then recycle the
+// descriptor sets and argument memory they used.
+WEAK int flush_batch(void *user_context, VkQueue queue) {
+    if (!dev_state.recording) {
+        return 0;
+    }
+    debug(user_context) << "    Submitting " << dev_state.num_dispatches << " batched dispatches\n";
+    dev_state.recording = false;
+
+    record_barrier(VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+    VkResult result = vkEndCommandBuffer(dev_state.command_buffer);
+    if (result == VK_SUCCESS) {
+        VkSubmitInfo submit_info = {
+            VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL,
+            0, NULL, NULL, 1, &dev_state.command_buffer, 0, NULL
+        };
+        result = vkQueueSubmit(queue, 1, &submit_info, dev_state.fence);
+    }
+    if (result == VK_SUCCESS) {
+        result = vkWaitForFences(dev_state.device, 1, &dev_state.fence, 1, ~0ULL);
+        vkResetFences(dev_state.device, 1, &dev_state.fence);
+    }
+    vkResetCommandBuffer(dev_state.command_buffer, 0);
+    vkResetDescriptorPool(dev_state.device, dev_state.descriptor_pool, 0);
+    dev_state.num_dispatches = 0;
+    dev_state.storage_descriptors_used = 0;
+    dev_state.args_used = 0;
+
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: Executing the command buffer failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+    return 0;
+}
+
+WEAK int record_copy(void *user_context, VkBuffer src, uint64_t src_offset,
+                     VkBuffer dst, uint64_t dst_offset, uint64_t size) {
+    int err = begin_batch(user_context);
+    if (err != 0) {
+        return err;
+    }
+    record_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkBufferCopy region = {src_offset, dst_offset, size};
+    vkCmdCopyBuffer(dev_state.command_buffer, src, dst, 1, &region);
+    return 0;
+}
+
+// Give the host access to size bytes of a device buffer, waiting for
+// any work recorded on it. Host visible memory is accessed in place;
+// anything else goes through the staging buffer, which is filled with
+// the current contents if they are to be read.
+WEAK int begin_host_access(void *user_context, const VulkanContext &ctx, device_handle *handle,
+                           uint64_t size, bool read, uint8_t **ptr) {
+    int err = flush_batch(user_context, ctx.queue);
+    if (err != 0) {
+        return err;
+    }
+    if (handle->buf.mapped) {
+        *ptr = handle->buf.mapped + handle->offset;
+        return 0;
+    }
+    if (dev_state.staging.size < size) {
+        release_buffer(&dev_state.staging);
+        err = create_buffer(user_context, size,
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            host_memory_types, 1, &dev_state.staging);
+        if (err != 0) {
+            return err;
+        }
+    }
+    if (read) {
+        err = record_copy(user_context, handle->buf.buffer, handle->offset, dev_state.staging.buffer, 0, size);
+        if (err == 0) {
+            err = flush_batch(user_context, ctx.queue);
+        }
+        if (err != 0) {
+            return err;
+        }
+    }
+    *ptr = dev_state.staging.mapped;
+    return 0;
+}
+
+WEAK int end_host_access(void *user_context, const VulkanContext &ctx, device_handle *handle,
+                         uint64_t size, bool written) {
+    if (handle->buf.mapped || !written) {
+        return 0;
+    }
+    int err = record_copy(user_context, dev_state.staging.buffer, 0, handle->buf.buffer, handle->offset, size);
+    if (err == 0) {
+        err = flush_batch(user_context, ctx.queue);
+    }
+    return err;
+}
+
+WEAK int do_device_to_device_copy(void *user_context, const device_copy &c,
+                                  uint64_t src_offset, uint64_t dst_offset, int d) {
+    if (d == 0) {
+        return record_copy(user_context, ((device_handle *)c.src)->buf.buffer, c.src_begin + src_offset,
+                           ((device_handle *)c.dst)->buf.buffer, dst_offset, c.chunk_size);
+    }
+    // TODO: deal with negative strides. Currently the code in
+    // device_buffer_utils.h does not do so either.
+    uint64_t src_off = 0, dst_off = 0;
+    for (uint64_t i = 0; i < c.extent[d-1]; i++) {
+        int err = do_device_to_device_copy(user_context, c, src_offset + src_off, dst_offset + dst_off, d - 1);
+        if (err) {
+            return err;
+        }
+        dst_off += c.dst_stride_bytes[d-1];
+        src_off += c.src_stride_bytes[d-1];
+    }
+    return 0;
+}
+
+WEAK void release_pipelines(module_state *state) {
+    while (state->pipelines) {
+        pipeline_entry *p = state->pipelines;
+        state->pipelines = p->next;
+        vkDestroyPipeline(dev_state.device, p->pipeline, NULL);
+        vkDestroyPipelineLayout(dev_state.device, p->pipeline_layout, NULL);
+        vkDestroyDescriptorSetLayout(dev_state.device, p->set_layout, NULL);
+        free(p->entry_name);
+        free(p);
+    }
+}
+
+// Find the pipeline for an entry point and workgroup size, creating it
+// on first use. The workgroup size is set through the module's
+// specialization constants.
+WEAK pipeline_entry *get_pipeline(void *user_context, module_state *state, const char *entry_name,
+                                  const uint32_t threads[3], uint32_t num_buffers) {
+    for (pipeline_entry *p = state->pipelines; p; p = p->next) {
+        if (p->threads[0] == threads[0] && p->threads[1] == threads[1] &&
+            p->threads[2] == threads[2] && strcmp(p->entry_name, entry_name) == 0) {
+            return p;
+        }
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    pipeline_entry *p = (pipeline_entry *)malloc(sizeof(pipeline_entry));
+    size_t name_len = strlen(entry_name);
+    char *name = (char *)malloc(name_len + 1);
+    if (p == NULL || name == NULL) {
+        free(p);
+        free(name);
+        error(user_context) << "Vulkan: Out of memory creating the pipeline for " << entry_name << "\n";
+        return NULL;
+    }
+    memcpy(name, entry_name, name_len + 1);
+    memset(p, 0, sizeof(pipeline_entry));
+    p->entry_name = name;
+    for (int i = 0; i < 3; i++) {
+        p->threads[i] = threads[i];
+    }
+
+    // Binding 0 is the uniform buffer of kernel arguments, and the
+    // buffers follow it.
+    VkDescriptorSetLayoutBinding bindings[MaxKernelBuffers + 1];
+    for (uint32_t i = 0; i <= num_buffers; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = NULL;
+    }
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO, NULL, 0,
+        num_buffers + 1, bindings
+    };
+    VkResult result = vkCreateDescriptorSetLayout(dev_state.device, &set_layout_info, NULL, &p->set_layout);
+    if (result == VK_SUCCESS) {
+        VkPipelineLayoutCreateInfo layout_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, NULL, 0,
+            1, &p->set_layout, 0, NULL
+        };
+        result = vkCreatePipelineLayout(dev_state.device, &layout_info, NULL, &p->pipeline_layout);
+    }
+    if (result == VK_SUCCESS) {
+        VkSpecializationMapEntry spec_entries[3] = {
+            {0, 0, sizeof(uint32_t)},
+            {1, sizeof(uint32_t), sizeof(uint32_t)},
+            {2, 2 * sizeof(uint32_t), sizeof(uint32_t)},
+        };
+        VkSpecializationInfo spec_info = {3, spec_entries, sizeof(p->threads), p->threads};
+        VkComputePipelineCreateInfo pipeline_info = {
+            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO, NULL, 0,
+            {
+                VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, NULL, 0,
+                VK_SHADER_STAGE_COMPUTE_BIT, state->shader_module, p->entry_name, &spec_info
+            },
+            p->pipeline_layout, VK_NULL_HANDLE, -1
+        };
+        result = vkCreateComputePipelines(dev_state.device, dev_state.pipeline_cache, 1, &pipeline_info, NULL, &p->pipeline);
+    }
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: Could not create the pipeline for " << entry_name << ": "
+                            << get_vulkan_error_name(result) << "\n";
+        if (p->pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(dev_state.device, p->pipeline_layout, NULL);
+        }
+        if (p->set_layout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(dev_state.device, p->set_layout, NULL);
+        }
+        free(p->entry_name);
+        free(p);
+        return NULL;
+    }
+    dev_state.pipeline_cache_dirty = true;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Created pipeline for " << entry_name << " with threads("
+                        << threads[0] << ", " << threads[1] << ", " << threads[2] << ") in "
+                        << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    p->next = state->pipelines;
+    state->pipelines = p;
+    return p;
+}
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
+
+extern "C" {
+
+WEAK int halide_vulkan_device_malloc(void *user_context, halide_buffer_t *buf) {
+    debug(user_context)
+        << "halide_vulkan_device_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    size_t size = buf->size_in_bytes();
+    halide_assert(user_context, size != 0);
+    if (buf->device) {
+        // This buffer already has a device allocation
+        return 0;
+    }
+
+    // Check all strides positive
+    for (int i = 0; i < buf->dimensions; i++) {
+        halide_assert(user_context, buf->dim[i].stride > 0);
+    }
+
+    debug(user_context) << "    allocating " << *buf << "\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    device_handle *handle = (device_handle *)malloc(sizeof(device_handle));
+    if (handle == NULL) {
+        return halide_error_code_out_of_memory;
+    }
+
+    // Kernels access buffers as 32-bit words, so round the size up.
+    VkDeviceSize alloc_size = (size + 3) & ~(VkDeviceSize)3;
+    int err = create_buffer(user_context, alloc_size,
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            device_memory_types, sizeof(device_memory_types) / sizeof(device_memory_types[0]),
+                            &handle->buf);
+    if (err != 0) {
+        free(handle);
+        return err;
+    }
+    handle->offset = 0;
+    handle->owned = true;
+
+    buf->device = (uint64_t)handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_free(void *user_context, halide_buffer_t *buf) {
+    debug(user_context) << "halide_vulkan_device_free called on buf "
+                        << buf << " device is " << buf->device << "\n";
+    if (buf->device == 0) {
+        return 0;
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    device_handle *handle = (device_handle *)buf->device;
+    halide_assert(user_context, handle->offset == 0 && "halide_vulkan_device_free on buffer obtained from halide_device_crop");
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    // The buffer may still be in use by batched dispatches.
+    int err = flush_batch(user_context, ctx.queue);
+
+    if (handle->owned) {
+        release_buffer(&handle->buf);
+    }
+    free(handle);
+    buf->device = 0;
+    buf->device_interface->impl->release_module();
+    buf->device_interface = NULL;
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_initialize_kernels(void *user_context, void **state_ptr, const char *src, int size) {
+    // Create the state object if necessary. This only happens once, regardless
+    // of how many times halide_initialize_kernels/halide_release is called.
+    // halide_release traverses this list and releases the module objects, but
+    // it does not modify the list nodes created/inserted here.
+    module_state **state = (module_state **)state_ptr;
+    if (!(*state)) {
+        *state = (module_state *)malloc(sizeof(module_state));
+        if (!(*state)) {
+            return halide_error_code_out_of_memory;
+        }
+        (*state)->shader_module = VK_NULL_HANDLE;
+        (*state)->pipelines = NULL;
+        (*state)->next = state_list;
+        state_list = *state;
+    }
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    if ((*state)->shader_module == VK_NULL_HANDLE) {
+        #ifdef DEBUG_RUNTIME
+        uint64_t t_before = halide_current_time_ns(user_context);
+        #endif
+
+        // The module is a sequence of 32-bit words, but the source
+        // holding it is only byte aligned.
+        halide_assert(user_context, size > 0 && (size % 4) == 0);
+        uint32_t *code = (uint32_t *)malloc(size);
+        if (code == NULL) {
+            return halide_error_code_out_of_memory;
+        }
+        memcpy(code, src, size);
+        VkShaderModuleCreateInfo module_info = {
+            VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, NULL, 0,
+            (size_t)size, code
+        };
+        debug(user_context) << "    vkCreateShaderModule -> ";
+        VkResult result = vkCreateShaderModule(dev_state.device, &module_info, NULL, &(*state)->shader_module);
+        debug(user_context) << get_vulkan_error_name(result) << "\n";
+        free(code);
+        if (result != VK_SUCCESS) {
+            error(user_context) << "Vulkan: vkCreateShaderModule failed: " << get_vulkan_error_name(result) << "\n";
+            (*state)->shader_module = VK_NULL_HANDLE;
+            return result;
+        }
+
+        #ifdef DEBUG_RUNTIME
+        uint64_t t_after = halide_current_time_ns(user_context);
+        debug(user_context) << "Time for halide_vulkan_initialize_kernels: " << (t_after - t_before) / 1.0e6 << " ms\n";
+        #endif
+    }
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_sync(void *user_context, struct halide_buffer_t *) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    int err = flush_batch(user_context, ctx.queue);
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_device_sync: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_device_release(void *user_context) {
+    // The VulkanContext object would create a device if there wasn't
+    // one, so we use halide_vulkan_acquire_context directly.
+    VkInstance acquired_instance;
+    VkPhysicalDevice acquired_physical_device;
+    VkDevice acquired_device;
+    VkQueue acquired_queue;
+    uint32_t acquired_family;
+    int err = halide_vulkan_acquire_context(user_context,
+                                            (halide_vulkan_instance **)&acquired_instance,
+                                            (halide_vulkan_physical_device **)&acquired_physical_device,
+                                            (halide_vulkan_device **)&acquired_device,
+                                            (halide_vulkan_queue **)&acquired_queue,
+                                            &acquired_family, false);
+    if (err != 0) {
+        return err;
+    }
+
+    if (acquired_device && dev_state.device == acquired_device) {
+        flush_batch(user_context, acquired_queue);
+        vkDeviceWaitIdle(acquired_device);
+
+        // Unload the modules attached to this device. Note that the list
+        // nodes themselves are not freed, only the shader modules and
+        // pipelines are released. Subsequent calls to
+        // halide_init_kernels might re-create them using the same list
+        // node.
+        for (module_state *state = state_list; state; state = state->next) {
+            release_pipelines(state);
+            if (state->shader_module != VK_NULL_HANDLE) {
+                debug(user_context) << "    vkDestroyShaderModule " << (uint64_t)state->shader_module << "\n";
+                vkDestroyShaderModule(acquired_device, state->shader_module, NULL);
+                state->shader_module = VK_NULL_HANDLE;
+            }
+        }
+        release_device_state(user_context);
+    }
+
+    // Release the device and instance themselves, if we created them.
+    if (device && acquired_device == device) {
+        debug(user_context) << "    vkDestroyDevice " << device << "\n";
+        vkDestroyDevice(device, NULL);
+        functions_device = NULL;
+        device = NULL;
+        queue = NULL;
+        debug(user_context) << "    vkDestroyInstance " << instance << "\n";
+        vkDestroyInstance(instance, NULL);
+        functions_instance = NULL;
+        instance = NULL;
+        physical_device = NULL;
+    }
+
+    release_crop_handles(crop_handles);
+
+    halide_vulkan_release_context(user_context);
+
+    return 0;
+}
+
+WEAK int halide_vulkan_copy_to_device(void *user_context, halide_buffer_t *buf) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, buf->host && buf->device);
+    halide_assert(user_context, buf->dimensions <= MAX_COPY_DIMS);
+    if (buf->dimensions > MAX_COPY_DIMS) {
+        return -1;
+    }
+
+    device_copy c = make_host_to_device_copy(buf);
+    device_handle *handle = (device_handle *)c.dst;
+    uint64_t size = buf->size_in_bytes();
+    // If the copy doesn't cover the whole range, the values in between
+    // must be preserved.
+    bool dense = (c.chunk_size == size);
+
+    debug(user_context) << "halide_vulkan_copy_to_device dev = " << (void *)buf->device
+                        << " host = " << buf->host << (dense ? "\n" : " (strided)\n");
+
+    int profiled_func = profiled_device_func();
+    uint64_t t_copy = profiled_func >= 0 ? halide_current_time_ns(user_context) : 0;
+
+    uint8_t *ptr = NULL;
+    int err = begin_host_access(user_context, ctx, handle, size, !dense, &ptr);
+    if (err == 0) {
+        c.dst = (uint64_t)ptr;
+        copy_memory(c, user_context);
+        err = end_host_access(user_context, ctx, handle, size, true);
+    }
+
+    if (profiled_func >= 0) {
+        halide_profiler_record_gpu_time(profiled_func, 0, halide_current_time_ns(user_context) - t_copy);
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_copy_to_device: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_copy_to_host(void *user_context, halide_buffer_t *buf) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, buf->host && buf->device);
+    halide_assert(user_context, buf->dimensions <= MAX_COPY_DIMS);
+    if (buf->dimensions > MAX_COPY_DIMS) {
+        return -1;
+    }
+
+    device_copy c = make_device_to_host_copy(buf);
+    device_handle *handle = (device_handle *)c.src;
+    uint64_t size = buf->size_in_bytes();
+
+    int profiled_func = profiled_device_func();
+    uint64_t t_copy = profiled_func >= 0 ? halide_current_time_ns(user_context) : 0;
+
+    uint8_t *ptr = NULL;
+    int err = begin_host_access(user_context, ctx, handle, size, true, &ptr);
+    if (err == 0) {
+        c.src = (uint64_t)ptr;
+        copy_memory(c, user_context);
+        err = end_host_access(user_context, ctx, handle, size, false);
+    }
+
+    if (profiled_func >= 0) {
+        halide_profiler_record_gpu_time(profiled_func, 0, halide_current_time_ns(user_context) - t_copy);
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_copy_to_host: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_run(void *user_context,
+                           void *state_ptr,
+                           const char *entry_name,
+                           int blocksX, int blocksY, int blocksZ,
+                           int threadsX, int threadsY, int threadsZ,
+                           int shared_mem_bytes,
+                           size_t arg_sizes[],
+                           void *args[],
+                           int8_t arg_is_buffer[],
+                           int num_attributes,
+                           float *vertex_buffer,
+                           int num_coords_dim0,
+                           int num_coords_dim1) {
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    halide_assert(user_context, state_ptr);
+    module_state *state = (module_state *)state_ptr;
+
+    // Shared memory is declared with a constant size in the module, so
+    // shared_mem_bytes isn't needed here.
+    debug(user_context) << "halide_vulkan_run " << entry_name
+                        << " blocks(" << blocksX << ", " << blocksY << ", " << blocksZ
+                        << ") threads(" << threadsX << ", " << threadsY << ", " << threadsZ
+                        << ") shared_mem_bytes " << shared_mem_bytes << "\n";
+
+    uint32_t num_scalars = 0, num_buffers = 0;
+    for (size_t i = 0; arg_sizes[i] != 0; i++) {
+        if (arg_is_buffer[i]) {
+            num_buffers++;
+        } else {
+            halide_assert(user_context, arg_sizes[i] <= sizeof(uint32_t));
+            num_scalars++;
+        }
+    }
+    if (num_buffers > (uint32_t)MaxKernelBuffers) {
+        error(user_context) << "Vulkan: Kernel " << entry_name << " uses " << num_buffers
+                            << " buffers, but at most " << MaxKernelBuffers << " are supported.\n";
+        return -1;
+    }
+
+    uint32_t threads[3] = {(uint32_t)threadsX, (uint32_t)threadsY, (uint32_t)threadsZ};
+    pipeline_entry *pipeline = get_pipeline(user_context, state, entry_name, threads, num_buffers);
+    if (pipeline == NULL) {
+        return -1;
+    }
+
+    // A profiled kernel is timed on its own, so the batch so far is
+    // flushed first.
+    int profiled_func = profiled_device_func();
+    uint32_t args_size = (num_scalars + num_buffers > 0 ? num_scalars + num_buffers : 1) * sizeof(uint32_t);
+    uint32_t args_slot = (args_size + ArgsAlignment - 1) & ~(ArgsAlignment - 1);
+    if (profiled_func >= 0 ||
+        dev_state.num_dispatches == MaxBatchDispatches ||
+        dev_state.args_used + args_slot > ArgsBufferSize ||
+        dev_state.storage_descriptors_used + num_buffers > (uint32_t)(MaxBatchDispatches * MaxKernelBuffers / 4)) {
+        int err = flush_batch(user_context, ctx.queue);
+        if (err != 0) {
+            return err;
+        }
+    }
+    uint64_t t_launch = profiled_func >= 0 ? halide_current_time_ns(user_context) : 0;
+
+    // The kernel arguments are one word each, in the low bytes of a
+    // zeroed word, followed by the byte offset of each buffer within
+    // the VkBuffer bound for it.
+    uint32_t *words = (uint32_t *)(dev_state.args.mapped + dev_state.args_used);
+    memset(words, 0, args_size);
+    VkDescriptorBufferInfo buffer_infos[MaxKernelBuffers + 1];
+    buffer_infos[0].buffer = dev_state.args.buffer;
+    buffer_infos[0].offset = dev_state.args_used;
+    buffer_infos[0].range = args_size;
+    uint32_t scalar_index = 0, buffer_index = 0;
+    for (size_t i = 0; arg_sizes[i] != 0; i++) {
+        if (arg_is_buffer[i]) {
+            halide_assert(user_context, arg_sizes[i] == sizeof(uint64_t));
+            device_handle *handle = (device_handle *)((halide_buffer_t *)args[i])->device;
+            halide_assert(user_context, handle != NULL);
+            words[num_scalars + buffer_index] = (uint32_t)handle->offset;
+            buffer_infos[buffer_index + 1].buffer = handle->buf.buffer;
+            buffer_infos[buffer_index + 1].offset = 0;
+            buffer_infos[buffer_index + 1].range = VK_WHOLE_SIZE;
+            buffer_index++;
+        } else {
+            memcpy(&words[scalar_index], args[i], arg_sizes[i]);
+            scalar_index++;
+        }
+    }
+
+    VkDescriptorSetAllocateInfo set_info = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO, NULL,
+        dev_state.descriptor_pool, 1, &pipeline->set_layout
+    };
+    VkDescriptorSet descriptor_set;
+    VkResult result = vkAllocateDescriptorSets(dev_state.device, &set_info, &descriptor_set);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkAllocateDescriptorSets failed: " << get_vulkan_error_name(result) << "\n";
+        return result;
+    }
+    VkWriteDescriptorSet writes[MaxKernelBuffers + 1];
+    for (uint32_t i = 0; i <= num_buffers; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = NULL;
+        writes[i].dstSet = descriptor_set;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = (i == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pImageInfo = NULL;
+        writes[i].pBufferInfo = &buffer_infos[i];
+        writes[i].pTexelBufferView = NULL;
+    }
+    vkUpdateDescriptorSets(dev_state.device, num_buffers + 1, writes, 0, NULL);
+
+    int err = begin_batch(user_context);
+    if (err != 0) {
+        return err;
+    }
+    record_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                   VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vkCmdBindPipeline(dev_state.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
+    vkCmdBindDescriptorSets(dev_state.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipeline->pipeline_layout, 0, 1, &descriptor_set, 0, NULL);
+    vkCmdDispatch(dev_state.command_buffer, blocksX, blocksY, blocksZ);
+
+    dev_state.num_dispatches++;
+    dev_state.args_used += args_slot;
+    dev_state.storage_descriptors_used += num_buffers;
+
+    if (profiled_func >= 0) {
+        err = flush_batch(user_context, ctx.queue);
+        halide_profiler_record_gpu_time(profiled_func, halide_current_time_ns(user_context) - t_launch, 0);
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "Time for halide_vulkan_run: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+WEAK int halide_vulkan_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context) << "halide_vulkan_device_and_host_malloc called.\n";
+    int result = halide_vulkan_device_malloc(user_context, buf);
+    if (result != 0) {
+        return result;
+    }
+    device_handle *handle = (device_handle *)buf->device;
+    if (handle->buf.mapped) {
+        // Share the host visible memory with the host.
+        buf->host = handle->buf.mapped;
+        return 0;
+    }
+    buf->host = (uint8_t *)halide_malloc(user_context, buf->size_in_bytes());
+    if (buf->host == NULL) {
+        halide_vulkan_device_free(user_context, buf);
+        return halide_error_code_out_of_memory;
+    }
+    return 0;
+}
+
+WEAK int halide_vulkan_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
+    debug(user_context) << "halide_vulkan_device_and_host_free called.\n";
+    device_handle *handle = (device_handle *)buf->device;
+    bool shared = handle && buf->host == handle->buf.mapped;
+    if (buf->host && !shared) {
+        halide_free(user_context, buf->host);
+    }
+    halide_vulkan_device_free(user_context, buf);
+    buf->host = NULL;
+    return 0;
+}
+
+WEAK int halide_vulkan_buffer_copy(void *user_context, struct halide_buffer_t *src,
+                                   const struct halide_device_interface_t *dst_device_interface,
+                                   struct halide_buffer_t *dst) {
+    if (dst->dimensions > MAX_COPY_DIMS) {
+        error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
+        return halide_error_code_device_buffer_copy_failed;
+    }
+
+    // We only handle copies to vulkan buffers or to host
+    halide_assert(user_context, dst_device_interface == NULL ||
+                  dst_device_interface == &vulkan_device_interface);
+
+    if ((src->device_dirty() || src->host == NULL) &&
+        src->device_interface != &vulkan_device_interface) {
+        halide_assert(user_context, dst_device_interface == &vulkan_device_interface);
+        // This is handled at the higher level.
+        return halide_error_code_incompatible_device_interface;
+    }
+
+    bool from_host = (src->device_interface != &vulkan_device_interface) ||
+                     (src->device == 0) ||
+                     (src->host_dirty() && src->host != NULL);
+    bool to_host = !dst_device_interface;
+
+    halide_assert(user_context, from_host || src->device);
+    halide_assert(user_context, to_host || dst->device);
+
+    device_copy c = make_buffer_copy(src, from_host, dst, to_host);
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != 0) {
+        return ctx.error;
+    }
+
+    debug(user_context)
+        << "halide_vulkan_buffer_copy (user_context: " << user_context
+        << ", src: " << src << ", dst: " << dst << ")\n";
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+    #endif
+
+    int err = 0;
+    if (!from_host && !to_host) {
+        // The copy is recorded into the batch, after any dispatches
+        // that write the source.
+        debug(user_context) << "halide_vulkan_buffer_copy device to device case.\n";
+        err = do_device_to_device_copy(user_context, c, ((device_handle *)c.src)->offset,
+                                       ((device_handle *)c.dst)->offset, dst->dimensions);
+    } else if (from_host && to_host) {
+        copy_memory(c, user_context);
+    } else if (to_host) {
+        device_handle *handle = (device_handle *)c.src;
+        uint64_t size = src->size_in_bytes();
+        uint8_t *ptr = NULL;
+        err = begin_host_access(user_context, ctx, handle, size, true, &ptr);
+        if (err == 0) {
+            c.src = (uint64_t)ptr;
+            copy_memory(c, user_context);
+            err = end_host_access(user_context, ctx, handle, size, false);
+        }
+    } else {
+        device_handle *handle = (device_handle *)c.dst;
+        uint64_t size = dst->size_in_bytes();
+        bool dense = (c.chunk_size == size);
+        uint8_t *ptr = NULL;
+        err = begin_host_access(user_context, ctx, handle, size, !dense, &ptr);
+        if (err == 0) {
+            c.dst = (uint64_t)ptr;
+            copy_memory(c, user_context);
+            err = end_host_access(user_context, ctx, handle, size, true);
+        }
+    }
+
+    #ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+    #endif
+
+    return err;
+}
+
+namespace {
+
+WEAK int vulkan_device_crop_from_offset(void *user_context,
+                                        const struct halide_buffer_t *src,
+                                        int64_t offset,
+                                        struct halide_buffer_t *dst) {
+    dst->device_interface = src->device_interface;
+    device_handle *new_handle = get_crop_handle(crop_handles);
+    if (new_handle == NULL) {
+        error(user_context) << "halide_vulkan_device_crop: malloc failed making device handle.\n";
+        return halide_error_code_out_of_memory;
+    }
+
+    // The crop refers to the same VkBuffer, which stays owned by src.
+    device_handle *src_handle = (device_handle *)src->device;
+    new_handle->buf = src_handle->buf;
+    new_handle->offset = src_handle->offset + offset;
+    new_handle->owned = false;
+    dst->device = (uint64_t)new_handle;
+    return 0;
+}
+
+}  // namespace
+
+WEAK int halide_vulkan_device_crop(void *user_context,
+                                   const struct halide_buffer_t *src,
+                                   struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_crop_byte_offset(src, dst);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_slice(void *user_context,
+                                    const struct halide_buffer_t *src,
+                                    int slice_dim, int slice_pos,
+                                    struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_slice_byte_offset(src, slice_dim, slice_pos);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_release_crop(void *user_context,
+                                           struct halide_buffer_t *buf) {
+    debug(user_context) << "halide_vulkan_device_release_crop called on buf "
+                        << buf << " device is " << buf->device << "\n";
+    if (buf->device == 0) {
+        return 0;
+    }
+    // The VkBuffer belongs to the buffer that was cropped, so only the
+    // handle is recycled.
+    put_crop_handle(crop_handles, (device_handle *)buf->device);
+    buf->device = 0;
+    return 0;
+}
+
+WEAK int halide_vulkan_wrap_buffer(void *user_context, struct halide_buffer_t *buf, uint64_t vk_buffer) {
+    halide_assert(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return -2;
+    }
+    device_handle *handle = (device_handle *)malloc(sizeof(device_handle));
+    if (handle == NULL) {
+        error(user_context) << "halide_vulkan_wrap_buffer: malloc failed making device handle.\n";
+        return halide_error_code_out_of_memory;
+    }
+    // The memory of a wrapped buffer is not known, so it is always
+    // accessed through the staging buffer.
+    memset(&handle->buf, 0, sizeof(vulkan_buffer));
+    handle->buf.buffer = (VkBuffer)vk_buffer;
+    handle->buf.size = buf->size_in_bytes();
+    handle->offset = 0;
+    handle->owned = false;
+
+    buf->device = (uint64_t)handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+    return 0;
+}
+
+WEAK int halide_vulkan_detach_buffer(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+
+    // The buffer may still be in use by batched dispatches.
+    int err = 0;
+    if (dev_state.recording) {
+        VulkanContext ctx(user_context);
+        if (ctx.error != 0) {
+            return ctx.error;
+        }
+        err = flush_batch(user_context, ctx.queue);
+    }
+
+    buf->device_interface->impl->release_module();
+    buf->device_interface = NULL;
+    free((device_handle *)buf->device);
+    buf->device = 0;
+    return err;
+}
+
+WEAK uint64_t halide_vulkan_get_buffer(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+    return (uint64_t)((device_handle *)buf->device)->buf.buffer;
+}
+
+WEAK uint64_t halide_vulkan_get_crop_offset(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_assert(user_context, buf->device_interface == &vulkan_device_interface);
+    return ((device_handle *)buf->device)->offset;
+}
+
+WEAK const struct halide_device_interface_t *halide_vulkan_device_interface() {
+    return &vulkan_device_interface;
+}
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_vulkan_cleanup() {
+    halide_vulkan_device_release(NULL);
+}
+}
+
+} // extern "C" linkage
+
+namespace Halide { namespace Runtime { namespace Internal { namespace Vulkan {
+
+WEAK halide_device_interface_impl_t vulkan_device_interface_impl = {
+    halide_use_jit_module,
+    halide_release_jit_module,
+    halide_vulkan_device_malloc,
+    halide_vulkan_device_free,
+    halide_vulkan_device_sync,
+    halide_vulkan_device_release,
+    halide_vulkan_copy_to_host,
+    halide_vulkan_copy_to_device,
+    halide_vulkan_device_and_host_malloc,
+    halide_vulkan_device_and_host_free,
+    halide_vulkan_buffer_copy,
+    halide_vulkan_device_crop,
+    halide_vulkan_device_slice,
+    halide_vulkan_device_release_crop,
+    halide_vulkan_wrap_buffer,
+    halide_vulkan_detach_buffer
+};
+
+WEAK halide_device_interface_t vulkan_device_interface = {
+    halide_device_malloc,
+    halide_device_free,
+    halide_device_sync,
+    halide_device_release,
+    halide_copy_to_host,
+    halide_copy_to_device,
+    halide_device_and_host_malloc,
+    halide_device_and_host_free,
+    halide_buffer_copy,
+    halide_device_crop,
+    halide_device_slice,
+    halide_device_release_crop,
+    halide_device_wrap_native,
+    halide_device_detach_native,
+    NULL,
+    &vulkan_device_interface_impl
+};
+
+}}}} // namespace Halide::Runtime::Internal::Vulkan
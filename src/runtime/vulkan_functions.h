@@ -0,0 +1,75 @@
+// Note that this header intentionally does not use include
+// guards. The intended usage of this file is to define the meaning of
+// the VULKAN_FN macros, and then include this file, sometimes
+// repeatedly within the same compilation unit.
+
+// Functions obtained from vkGetInstanceProcAddr with a NULL instance.
+#ifndef VULKAN_FN_GLOBAL
+#define VULKAN_FN_GLOBAL(ret, fn, args)
+#endif
+// Functions obtained from vkGetInstanceProcAddr for the instance.
+#ifndef VULKAN_FN_INSTANCE
+#define VULKAN_FN_INSTANCE(ret, fn, args)
+#endif
+// Functions obtained from vkGetDeviceProcAddr for the device.
+#ifndef VULKAN_FN_DEVICE
+#define VULKAN_FN_DEVICE(ret, fn, args)
+#endif
+
+VULKAN_FN_GLOBAL(VkResult, vkCreateInstance, (const VkInstanceCreateInfo *, const void *, VkInstance *));
+
+VULKAN_FN_INSTANCE(void, vkDestroyInstance, (VkInstance, const void *));
+VULKAN_FN_INSTANCE(VkResult, vkEnumeratePhysicalDevices, (VkInstance, uint32_t *, VkPhysicalDevice *));
+VULKAN_FN_INSTANCE(void, vkGetPhysicalDeviceProperties, (VkPhysicalDevice, VkPhysicalDeviceProperties *));
+VULKAN_FN_INSTANCE(void, vkGetPhysicalDeviceQueueFamilyProperties, (VkPhysicalDevice, uint32_t *, VkQueueFamilyProperties *));
+VULKAN_FN_INSTANCE(void, vkGetPhysicalDeviceMemoryProperties, (VkPhysicalDevice, VkPhysicalDeviceMemoryProperties *));
+VULKAN_FN_INSTANCE(VkResult, vkCreateDevice, (VkPhysicalDevice, const VkDeviceCreateInfo *, const void *, VkDevice *));
+VULKAN_FN_INSTANCE(PFN_vkVoidFunction, vkGetDeviceProcAddr, (VkDevice, const char *));
+
+VULKAN_FN_DEVICE(void, vkDestroyDevice, (VkDevice, const void *));
+VULKAN_FN_DEVICE(void, vkGetDeviceQueue, (VkDevice, uint32_t, uint32_t, VkQueue *));
+VULKAN_FN_DEVICE(VkResult, vkDeviceWaitIdle, (VkDevice));
+VULKAN_FN_DEVICE(VkResult, vkQueueSubmit, (VkQueue, uint32_t, const VkSubmitInfo *, VkFence));
+VULKAN_FN_DEVICE(VkResult, vkAllocateMemory, (VkDevice, const VkMemoryAllocateInfo *, const void *, VkDeviceMemory *));
+VULKAN_FN_DEVICE(void, vkFreeMemory, (VkDevice, VkDeviceMemory, const void *));
+VULKAN_FN_DEVICE(VkResult, vkMapMemory, (VkDevice, VkDeviceMemory, VkDeviceSize, VkDeviceSize, VkFlags, void **));
+VULKAN_FN_DEVICE(void, vkUnmapMemory, (VkDevice, VkDeviceMemory));
+VULKAN_FN_DEVICE(VkResult, vkCreateBuffer, (VkDevice, const VkBufferCreateInfo *, const void *, VkBuffer *));
+VULKAN_FN_DEVICE(void, vkDestroyBuffer, (VkDevice, VkBuffer, const void *));
+VULKAN_FN_DEVICE(void, vkGetBufferMemoryRequirements, (VkDevice, VkBuffer, VkMemoryRequirements *));
+VULKAN_FN_DEVICE(VkResult, vkBindBufferMemory, (VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize));
+VULKAN_FN_DEVICE(VkResult, vkCreateFence, (VkDevice, const VkFenceCreateInfo *, const void *, VkFence *));
+VULKAN_FN_DEVICE(void, vkDestroyFence, (VkDevice, VkFence, const void *));
+VULKAN_FN_DEVICE(VkResult, vkWaitForFences, (VkDevice, uint32_t, const VkFence *, VkBool32, uint64_t));
+VULKAN_FN_DEVICE(VkResult, vkResetFences, (VkDevice, uint32_t, const VkFence *));
+VULKAN_FN_DEVICE(VkResult, vkCreateShaderModule, (VkDevice, const VkShaderModuleCreateInfo *, const void *, VkShaderModule *));
+VULKAN_FN_DEVICE(void, vkDestroyShaderModule, (VkDevice, VkShaderModule, const void *));
+VULKAN_FN_DEVICE(VkResult, vkCreatePipelineCache, (VkDevice, const VkPipelineCacheCreateInfo *, const void *, VkPipelineCache *));
+VULKAN_FN_DEVICE(void, vkDestroyPipelineCache, (VkDevice, VkPipelineCache, const void *));
+VULKAN_FN_DEVICE(VkResult, vkGetPipelineCacheData, (VkDevice, VkPipelineCache, size_t *, void *));
+VULKAN_FN_DEVICE(VkResult, vkCreateComputePipelines, (VkDevice, VkPipelineCache, uint32_t, const VkComputePipelineCreateInfo *, const void *, VkPipeline *));
+VULKAN_FN_DEVICE(void, vkDestroyPipeline, (VkDevice, VkPipeline, const void *));
+VULKAN_FN_DEVICE(VkResult, vkCreatePipelineLayout, (VkDevice, const VkPipelineLayoutCreateInfo *, const void *, VkPipelineLayout *));
+VULKAN_FN_DEVICE(void, vkDestroyPipelineLayout, (VkDevice, VkPipelineLayout, const void *));
+VULKAN_FN_DEVICE(VkResult, vkCreateDescriptorSetLayout, (VkDevice, const VkDescriptorSetLayoutCreateInfo *, const void *, VkDescriptorSetLayout *));
+VULKAN_FN_DEVICE(void, vkDestroyDescriptorSetLayout, (VkDevice, VkDescriptorSetLayout, const void *));
+VULKAN_FN_DEVICE(VkResult, vkCreateDescriptorPool, (VkDevice, const VkDescriptorPoolCreateInfo *, const void *, VkDescriptorPool *));
+VULKAN_FN_DEVICE(void, vkDestroyDescriptorPool, (VkDevice, VkDescriptorPool, const void *));
+VULKAN_FN_DEVICE(VkResult, vkResetDescriptorPool, (VkDevice, VkDescriptorPool, VkFlags));
+VULKAN_FN_DEVICE(VkResult, vkAllocateDescriptorSets, (VkDevice, const VkDescriptorSetAllocateInfo *, VkDescriptorSet *));
+VULKAN_FN_DEVICE(void, vkUpdateDescriptorSets, (VkDevice, uint32_t, const VkWriteDescriptorSet *, uint32_t, const void *));
+VULKAN_FN_DEVICE(VkResult, vkCreateCommandPool, (VkDevice, const VkCommandPoolCreateInfo *, const void *, VkCommandPool *));
+VULKAN_FN_DEVICE(void, vkDestroyCommandPool, (VkDevice, VkCommandPool, const void *));
+VULKAN_FN_DEVICE(VkResult, vkAllocateCommandBuffers, (VkDevice, const VkCommandBufferAllocateInfo *, VkCommandBuffer *));
+VULKAN_FN_DEVICE(VkResult, vkBeginCommandBuffer, (VkCommandBuffer, const VkCommandBufferBeginInfo *));
+VULKAN_FN_DEVICE(VkResult, vkEndCommandBuffer, (VkCommandBuffer));
+VULKAN_FN_DEVICE(VkResult, vkResetCommandBuffer, (VkCommandBuffer, VkFlags));
+VULKAN_FN_DEVICE(void, vkCmdBindPipeline, (VkCommandBuffer, uint32_t, VkPipeline));
+VULKAN_FN_DEVICE(void, vkCmdBindDescriptorSets, (VkCommandBuffer, uint32_t, VkPipelineLayout, uint32_t, uint32_t, const VkDescriptorSet *, uint32_t, const uint32_t *));
+VULKAN_FN_DEVICE(void, vkCmdDispatch, (VkCommandBuffer, uint32_t, uint32_t, uint32_t));
+VULKAN_FN_DEVICE(void, vkCmdCopyBuffer, (VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy *));
+VULKAN_FN_DEVICE(void, vkCmdPipelineBarrier, (VkCommandBuffer, VkFlags, VkFlags, VkFlags, uint32_t, const VkMemoryBarrier *, uint32_t, const void *, uint32_t, const void *));
+
+#undef VULKAN_FN_GLOBAL
+#undef VULKAN_FN_INSTANCE
+#undef VULKAN_FN_DEVICE
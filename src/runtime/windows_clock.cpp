@@ -38,4 +38,9 @@ WEAK void halide_sleep_ms(void *user_context, int ms) {
     Sleep(ms);
 }
 
+// Sleep has millisecond granularity, so shorter sleeps are rounded up.
+WEAK void halide_sleep_us(void *user_context, int us) {
+    Sleep((us + 999) / 1000);
+}
+
 }
@@ -0,0 +1,4 @@
+#define WINDOWS
+#define ZERO_COPY 1
+
+#include "opencl.cpp"
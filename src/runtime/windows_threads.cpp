@@ -29,6 +29,7 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API int32_t GetCurrentThreadId();
 
 } // extern "C"
 
@@ -45,6 +46,10 @@ WEAK void *spawn_thread_helper(void *arg) {
     return NULL;
 }
 
+WEAK uintptr_t halide_current_thread_id() {
+    return (uintptr_t)GetCurrentThreadId();
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -59,6 +64,14 @@ WEAK int halide_host_cpu_count() {
     }
 }
 
+WEAK int halide_host_cpu_nodes(int *cpu_node, int num_cpus) {
+    return 0;
+}
+
+WEAK int halide_pin_current_thread(int cpu) {
+    return -1;
+}
+
 WEAK halide_thread *halide_spawn_thread(void(*f)(void *), void *closure) {
     spawned_thread *t = (spawned_thread *)malloc(sizeof(spawned_thread));
     t->f = f;
@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
 
 // We support three formats, tiff, mat, and tmp.
 //
@@ -18,6 +19,11 @@
 //
 // It would be nice to use a format that web browsers read and display
 // directly, but those formats don't tend to satisfy the above goals.
+//
+// If HL_DEBUG_TO_FILE_ASYNC is set to 1, the file contents are
+// gathered in memory and written on a background thread, so that the
+// pipeline only pays for a copy of the data. Pending writes are
+// finished when the process exits.
 
 namespace Halide { namespace Runtime { namespace Internal {
 
@@ -102,22 +108,162 @@ WEAK bool ends_with(const char *filename, const char *suffix) {
     return *f == *s;
 }
 
+// A file write handed off to a background thread.
+struct pending_debug_write {
+    char *filename;
+    uint8_t *data;
+    size_t size;
+    halide_thread *thread;
+};
+
+WEAK halide_mutex pending_debug_writes_lock;
+const int max_pending_debug_writes = 16;
+WEAK pending_debug_write pending_debug_writes[max_pending_debug_writes];
+WEAK int next_pending_debug_write = 0;
+
+WEAK void do_debug_write(void *arg) {
+    pending_debug_write *w = (pending_debug_write *)arg;
+    void *f = fopen(w->filename, "wb");
+    if (f) {
+        fwrite(w->data, w->size, 1, f);
+        fclose(f);
+    }
+}
+
+WEAK void finish_debug_write(pending_debug_write *w) {
+    if (w->thread) {
+        halide_join_thread(w->thread);
+        w->thread = NULL;
+    }
+    free(w->filename);
+    free(w->data);
+    w->filename = NULL;
+    w->data = NULL;
+}
+
+WEAK int debug_to_file_async_mode = -1;
+
+WEAK bool debug_to_file_async() {
+    if (debug_to_file_async_mode < 0) {
+        const char *e = getenv("HL_DEBUG_TO_FILE_ASYNC");
+        debug_to_file_async_mode = (e && atoi(e)) ? 1 : 0;
+    }
+    return debug_to_file_async_mode == 1;
+}
+
 struct ScopedFile {
     void *f;
-    ScopedFile(const char *filename, const char *mode) {
-        f = fopen(filename, mode);
+    // When writing asynchronously, the contents are gathered here and
+    // handed to a background thread on destruction.
+    char *filename;
+    uint8_t *data;
+    size_t size, capacity;
+
+    ScopedFile(const char *name, const char *mode, size_t size_hint) :
+        f(NULL), filename(NULL), data(NULL), size(0), capacity(0) {
+        if (debug_to_file_async()) {
+            size_t len = strlen(name) + 1;
+            filename = (char *)malloc(len);
+            capacity = size_hint;
+            data = (uint8_t *)malloc(capacity);
+            if (filename && data) {
+                memcpy(filename, name, len);
+                return;
+            }
+            free(filename);
+            free(data);
+            filename = NULL;
+            data = NULL;
+        }
+        f = fopen(name, mode);
     }
     ~ScopedFile() {
-        fclose(f);
+        if (f) {
+            fclose(f);
+        } else if (data) {
+            ScopedMutexLock lock(&pending_debug_writes_lock);
+            pending_debug_write *w = &pending_debug_writes[next_pending_debug_write];
+            next_pending_debug_write = (next_pending_debug_write + 1) % max_pending_debug_writes;
+            // Wait for the write that last used this slot.
+            finish_debug_write(w);
+            w->filename = filename;
+            w->data = data;
+            w->size = size;
+            w->thread = halide_spawn_thread(do_debug_write, w);
+            if (!w->thread) {
+                do_debug_write(w);
+            }
+        }
     }
     bool write(const void *ptr, size_t bytes) {
-        return fwrite(ptr, bytes, 1, f);
+        if (f) {
+            return fwrite(ptr, bytes, 1, f);
+        }
+        if (size + bytes > capacity) {
+            size_t new_capacity = capacity * 2 + bytes;
+            uint8_t *new_data = (uint8_t *)malloc(new_capacity);
+            if (!new_data) return false;
+            memcpy(new_data, data, size);
+            free(data);
+            data = new_data;
+            capacity = new_capacity;
+        }
+        memcpy(data + size, ptr, bytes);
+        size += bytes;
+        return true;
     }
     bool open() const {
-        return f;
+        return f || data;
     }
 };
 
+// Gather a strided run of elements into dst.
+template<typename T>
+WEAK void gather_elements(T *dst, const uint8_t *src, int32_t count, int32_t stride) {
+    const T *s = (const T *)src;
+    for (int32_t i = 0; i < count; i++) {
+        dst[i] = s[(int64_t)i * stride];
+    }
+}
+
+WEAK void gather_elements(uint8_t *dst, const uint8_t *src, int32_t count, int32_t stride, int32_t bytes) {
+    switch (bytes) {
+    case 1:
+        gather_elements<uint8_t>(dst, src, count, stride);
+        break;
+    case 2:
+        gather_elements<uint16_t>((uint16_t *)dst, src, count, stride);
+        break;
+    case 4:
+        gather_elements<uint32_t>((uint32_t *)dst, src, count, stride);
+        break;
+    case 8:
+        gather_elements<uint64_t>((uint64_t *)dst, src, count, stride);
+        break;
+    default:
+        for (int32_t i = 0; i < count; i++) {
+            memcpy(dst + i * bytes, src + (int64_t)i * stride * bytes, bytes);
+        }
+    }
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_debug_to_file_cleanup() {
+    using namespace Halide::Runtime::Internal;
+    ScopedMutexLock lock(&pending_debug_writes_lock);
+    for (int i = 0; i < max_pending_debug_writes; i++) {
+        finish_debug_write(&pending_debug_writes[i]);
+    }
+}
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
 }}} // namespace Halide::Runtime::Internal
 
 WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *filename,
@@ -130,7 +276,8 @@ WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *fil
 
     halide_copy_to_host(user_context, buf);
 
-    ScopedFile f(filename, "wb");
+    // Allow for the largest header, plus the .mat padding.
+    ScopedFile f(filename, "wb", buf->size_in_bytes() + 1024);
     if (!f.open()) return -2;
 
     size_t elts = 1;
@@ -310,37 +457,45 @@ WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *fil
         }
     }
 
-    // Reorder the data according to the strides.
+    // Reorder the data according to the strides. First find how many
+    // of the innermost dimensions are dense in memory, so that they
+    // can be written as a single run.
+    int dense_dims = 0;
+    int64_t run = 1;
+    while (dense_dims < 4 &&
+           (shape[dense_dims].extent == 1 || shape[dense_dims].stride == run)) {
+        run *= shape[dense_dims].extent;
+        dense_dims++;
+    }
+
     const int TEMP_SIZE = 4*1024;
     uint8_t temp[TEMP_SIZE];
     int max_elts = TEMP_SIZE/bytes_per_element;
-    int counter = 0;
-
-    for (int32_t dim3 = shape[3].min; dim3 < shape[3].extent + shape[3].min; ++dim3) {
-        for (int32_t dim2 = shape[2].min; dim2 < shape[2].extent + shape[2].min; ++dim2) {
-            for (int32_t dim1 = shape[1].min; dim1 < shape[1].extent + shape[1].min; ++dim1) {
-                for (int32_t dim0 = shape[0].min; dim0 < shape[0].extent + shape[0].min; ++dim0) {
-                    counter++;
-                    int idx[] = {dim0, dim1, dim2, dim3};
-                    uint8_t *loc = buf->address_of(idx);
-                    void *dst = temp + (counter-1)*bytes_per_element;
-                    memcpy(dst, loc, bytes_per_element);
-
-                    if (counter == max_elts) {
-                        counter = 0;
-                        if (!f.write((void *)temp, max_elts * bytes_per_element)) {
-                            return -13;
+
+    for (int32_t i3 = 0; i3 < (dense_dims > 3 ? 1 : shape[3].extent); ++i3) {
+        for (int32_t i2 = 0; i2 < (dense_dims > 2 ? 1 : shape[2].extent); ++i2) {
+            for (int32_t i1 = 0; i1 < (dense_dims > 1 ? 1 : shape[1].extent); ++i1) {
+                int idx[] = {shape[0].min, shape[1].min + i1, shape[2].min + i2, shape[3].min + i3};
+                const uint8_t *loc = buf->address_of(idx);
+                if (dense_dims > 0) {
+                    if (!f.write(loc, run * bytes_per_element)) {
+                        return -13;
+                    }
+                } else {
+                    // The innermost dimension is strided. Gather it
+                    // through the staging buffer.
+                    for (int32_t i0 = 0; i0 < shape[0].extent; i0 += max_elts) {
+                        int32_t count = min(max_elts, shape[0].extent - i0);
+                        gather_elements(temp, loc + (int64_t)i0 * shape[0].stride * bytes_per_element,
+                                        count, shape[0].stride, bytes_per_element);
+                        if (!f.write((void *)temp, count * bytes_per_element)) {
+                            return -14;
                         }
                     }
                 }
             }
         }
     }
-    if (counter > 0) {
-        if (!f.write((void *)temp, counter * bytes_per_element)) {
-            return -14;
-        }
-    }
 
     const uint64_t zero = 0;
     if (final_padding_bytes) {
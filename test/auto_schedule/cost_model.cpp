@@ -0,0 +1,77 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// A cost model that makes every load cost the same, no matter how
+// big the region being loaded from is, so the auto-scheduler has no
+// reason to fuse stages for locality.
+class FlatLoadCost : public AutoSchedulerCostModel {
+public:
+    mutable int load_queries = 0, total_queries = 0;
+
+    Expr load_cost(const MachineParams &params, const Expr &footprint) const override {
+        load_queries++;
+        return Expr(1.0f);
+    }
+
+    Expr total_cost(const MachineParams &params, const Expr &arith, const Expr &memory) const override {
+        total_queries++;
+        return arith + memory;
+    }
+};
+
+int main(int argc, char **argv) {
+    MachineParams params = MachineParams::calibrate();
+    printf("Calibrated machine params: %s\n", params.to_string().c_str());
+
+    // The calibrated parameters must survive being stored as a
+    // string.
+    MachineParams reloaded(params.to_string());
+    if (reloaded.to_string() != params.to_string()) {
+        printf("Machine params didn't round-trip: %s vs %s\n",
+               reloaded.to_string().c_str(), params.to_string().c_str());
+        return -1;
+    }
+
+    Buffer<uint16_t> input(1024, 1024);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    blur_y.estimate(x, 0, 1020).estimate(y, 0, 1020);
+
+    FlatLoadCost model;
+    Target target = get_jit_target_from_environment();
+    Pipeline p(blur_y);
+    p.auto_schedule(target, params, model);
+
+    if (model.load_queries == 0 || model.total_queries == 0) {
+        printf("The custom cost model was never consulted\n");
+        return -1;
+    }
+
+    Buffer<uint16_t> out = p.realize(1020, 1020);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 0;
+            for (int j = 0; j < 3; j++) {
+                correct += (input(x, y + j) + input(x + 1, y + j) + input(x + 2, y + j)) / 3;
+            }
+            correct /= 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    Buffer<float> input(1024, 1024);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)(rand() & 0xff);
+        }
+    }
+
+    // A separable blur, where blur_x should end up computed per block
+    // of blur_y, followed by a reduction over the rows.
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y"), row_sums("row_sums");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    RDom r(0, 1020);
+    row_sums(y) = 0.0f;
+    row_sums(y) += blur_y(r, y);
+
+    blur_y.estimate(x, 0, 1020).estimate(y, 0, 1020);
+    row_sums.estimate(y, 0, 1020);
+
+    Pipeline p({blur_y, row_sums});
+    std::cout << "\n\n******************************************\nSCHEDULE:\n"
+              << "******************************************\n"
+              << p.auto_schedule(target)
+              << "\n******************************************\n\n";
+
+    Buffer<float> out(1020, 1020), sums(1020);
+    p.realize({out, sums}, target);
+    out.copy_to_host();
+    sums.copy_to_host();
+
+    for (int y = 0; y < out.height(); y++) {
+        float sum = 0.0f;
+        for (int x = 0; x < out.width(); x++) {
+            float correct = 0.0f;
+            for (int j = 0; j < 3; j++) {
+                correct += (input(x, y + j) + input(x + 1, y + j) + input(x + 2, y + j)) / 3;
+            }
+            correct /= 3;
+            if (std::abs(out(x, y) - correct) > 0.01f) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+            sum += out(x, y);
+        }
+        if (std::abs(sums(y) - sum) > 0.01f * std::abs(sum)) {
+            printf("sums(%d) = %f instead of %f\n", y, sums(y), sum);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
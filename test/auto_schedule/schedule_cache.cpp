@@ -0,0 +1,117 @@
+#include "Halide.h"
+#include <fstream>
+#include <stdio.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+using namespace Halide;
+
+Buffer<uint16_t> input(1024, 1024);
+
+// Every call makes a fresh copy of the same algorithm, as a fresh run
+// of a Generator would.
+Func make_pipeline(int width = 1020) {
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    blur_y.estimate(x, 0, width).estimate(y, 0, 1020);
+    return blur_y;
+}
+
+int check(Func f) {
+    Buffer<uint16_t> out = f.realize(1020, 1020);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int bx[3];
+            for (int i = 0; i < 3; i++) {
+                bx[i] = (input(x, y + i) + input(x + 1, y + i) + input(x + 2, y + i)) / 3;
+            }
+            int correct = (bx[0] + bx[1] + bx[2]) / 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test on windows\n");
+    return 0;
+#else
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xfff;
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    MachineParams params = MachineParams::generic();
+    std::string dir = Internal::dir_make_temp();
+
+    Func first = make_pipeline();
+    std::string first_schedule =
+        Internal::generate_schedules_cached({first.function()}, target, params, dir);
+    if (check(first) != 0) {
+        return -1;
+    }
+
+    // Find the file the schedules were saved in, and mark it so we can
+    // tell whether the next build used it.
+    std::string cache_file;
+    DIR *d = opendir(dir.c_str());
+    while (struct dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name.size() > 13 && name.substr(name.size() - 13) == ".autoschedule") {
+            cache_file = dir + "/" + name;
+        }
+    }
+    closedir(d);
+    if (cache_file.empty()) {
+        printf("No schedule was saved in %s\n", dir.c_str());
+        return -1;
+    }
+    {
+        std::ofstream f(cache_file, std::ios::app);
+        f << "// reused\n";
+    }
+
+    Func second = make_pipeline();
+    std::string second_schedule =
+        Internal::generate_schedules_cached({second.function()}, target, params, dir);
+    if (second_schedule != first_schedule + "// reused\n") {
+        printf("The saved schedule was not reused:\n%s\n", second_schedule.c_str());
+        return -1;
+    }
+    if (check(second) != 0) {
+        return -1;
+    }
+
+    // A change to the estimates must not reuse the saved schedule.
+    Func third = make_pipeline(512);
+    std::string third_schedule =
+        Internal::generate_schedules_cached({third.function()}, target, params, dir);
+    if (third_schedule.find("// reused") != std::string::npos) {
+        printf("A schedule was reused for a pipeline with different estimates\n");
+        return -1;
+    }
+
+    d = opendir(dir.c_str());
+    while (struct dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name != "." && name != "..") {
+            Internal::file_unlink(dir + "/" + name);
+        }
+    }
+    closedir(d);
+    Internal::dir_rmdir(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
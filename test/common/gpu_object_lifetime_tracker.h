@@ -60,6 +60,26 @@ public:
         }
     }
 
+    // The number of objects created by the given call so far, and the
+    // number of those still live.
+    int total_created(const char *created) const {
+        for (const auto &o : object_types) {
+            if (strcmp(o.created, created) == 0) {
+                return o.total_created;
+            }
+        }
+        return 0;
+    }
+
+    int live_count(const char *created) const {
+        for (const auto &o : object_types) {
+            if (strcmp(o.created, created) == 0) {
+                return o.live_count;
+            }
+        }
+        return 0;
+    }
+
     // Check that there are no live objects remaining, and we created at least one object.
     int validate_gpu_object_lifetime(bool allow_globals, bool allow_none, int max_globals) {
         int total = 0;
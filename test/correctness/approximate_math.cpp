@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+// The error of got, relative to the size of the last place of correct.
+double ulps(float got, double correct) {
+    float c = (float)correct;
+    double ulp = std::nextafter(std::fabs(c), INFINITY) - std::fabs(c);
+    return std::fabs(got - correct) / ulp;
+}
+
+bool check(const char *name, Expr (*fn)(Expr), double (*reference)(double),
+           float lo, float hi, bool log_spaced) {
+    const int N = 100000;
+    Var x;
+    Expr t = x / (float)(N - 1);
+    Expr arg = log_spaced ? lo * pow(hi / lo, t) : lo + (hi - lo) * t;
+
+    for (float max_ulps : {4.0f, 128.0f}) {
+        Func in, f;
+        in(x) = arg;
+        in.compute_root();
+        f(x) = fn(in(x));
+        f.approximate_math(max_ulps).vectorize(x, 8);
+
+        Buffer<float> input = in.realize(N);
+        Buffer<float> output = f.realize(N);
+        double worst = 0;
+        float worst_x = 0;
+        for (int i = 0; i < N; i++) {
+            double e = ulps(output(i), reference(input(i)));
+            if (!(e <= worst)) {
+                worst = e;
+                worst_x = input(i);
+            }
+        }
+        printf("%s with %g ulps allowed: worst error %g ulps at %g\n", name, max_ulps, worst, worst_x);
+        if (!(worst <= max_ulps)) {
+            printf("Error too large\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+double ref_exp(double x) {
+    return std::exp(x);
+}
+double ref_log(double x) {
+    return std::log(x);
+}
+double ref_sin(double x) {
+    return std::sin(x);
+}
+double ref_cos(double x) {
+    return std::cos(x);
+}
+double ref_tanh(double x) {
+    return std::tanh(x);
+}
+
+Expr call_exp(Expr x) {
+    return exp(x);
+}
+Expr call_log(Expr x) {
+    return log(x);
+}
+Expr call_sin(Expr x) {
+    return sin(x);
+}
+Expr call_cos(Expr x) {
+    return cos(x);
+}
+Expr call_tanh(Expr x) {
+    return tanh(x);
+}
+
+int main(int argc, char **argv) {
+    if (!check("exp", call_exp, ref_exp, -87.0f, 88.0f, false) ||
+        !check("log", call_log, ref_log, 1e-30f, 1e30f, true) ||
+        !check("sin", call_sin, ref_sin, -10.0f, 10.0f, false) ||
+        !check("cos", call_cos, ref_cos, -10.0f, 10.0f, false) ||
+        !check("tanh", call_tanh, ref_tanh, -12.0f, 12.0f, false)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &out, int (*expected)(int, int)) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = expected(x, y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // Producer computed at the root, running concurrently with its
+    // consumer.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x * y;
+        g(x, y) = f(x - 1, y - 1) + f(x + 1, y + 1);
+        f.compute_root().async();
+
+        Buffer<int> out = g.realize(32, 32);
+        if (check(out, [](int x, int y) { return (x - 1) * (y - 1) + (x + 1) * (y + 1); })) {
+            return -1;
+        }
+    }
+
+    // Producer computed per scanline of its consumer. The storage
+    // gets folded, and the producer runs ahead of the consumer by
+    // at most the fold factor.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+        f.store_root().compute_at(g, y).async();
+
+        Buffer<int> out = g.realize(64, 64);
+        if (check(out, [](int x, int y) { return 3 * (x + y); })) {
+            return -1;
+        }
+    }
+
+    // Same as above, with an explicit fold factor.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - 1) + f(x, y) + f(x, y + 1);
+        f.store_root().compute_at(g, y).fold_storage(y, 4).async();
+
+        Buffer<int> out = g.realize(64, 64);
+        if (check(out, [](int x, int y) { return 3 * (x + y); })) {
+            return -1;
+        }
+    }
+
+    // Two async producers feeding a parallel consumer.
+    {
+        Func f1, f2, g;
+        Var x, y;
+        f1(x, y) = x;
+        f2(x, y) = y;
+        g(x, y) = f1(x, y) * f2(x, y);
+        f1.compute_root().async();
+        f2.compute_root().async();
+        g.parallel(y);
+
+        Buffer<int> out = g.realize(64, 64);
+        if (check(out, [](int x, int y) { return x * y; })) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// The first pipeline this process runs uses async tasks but no
+// parallel loops, so the thread pool is first touched by
+// halide_do_parallel_tasks rather than halide_do_par_for. Everything
+// run afterwards must still work.
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) * 2;
+        f.compute_root().async();
+
+        Buffer<int> out = g.realize(32, 32);
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                if (out(xx, yy) != (xx + yy) * 2) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           xx, yy, out(xx, yy), (xx + yy) * 2);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        Func f, g;
+        f(x, y) = x * y;
+        g(x, y) = f(x, y) + 1;
+        f.compute_root().parallel(y);
+        g.parallel(y);
+
+        Buffer<int> out = g.realize(64, 64);
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                if (out(xx, yy) != xx * yy + 1) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           xx, yy, out(xx, yy), xx * yy + 1);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &out) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = 2 * (x + y) + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t(get_jit_target_from_environment());
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+
+    // A host stage feeding a GPU stage feeding another host stage,
+    // like decoding, filtering and encoding video. The first host
+    // stage runs concurrently with the rest of the pipeline.
+    {
+        Func decode, filter, encode;
+        Var x, y, xi, yi, yo, yy;
+        decode(x, y) = x + y;
+        filter(x, y) = decode(x - 1, y) + decode(x + 1, y);
+        encode(x, y) = filter(x, y) + 1;
+
+        encode.split(y, yo, yy, 16);
+        decode.compute_root().async();
+        filter.compute_at(encode, yo).gpu_tile(x, y, xi, yi, 16, 16);
+
+        Buffer<int> out = encode.realize(64, 64);
+        if (check(out)) {
+            return -1;
+        }
+    }
+
+    // The same, with the first host stage computed per strip of the
+    // output, so it can decode the next strip while the GPU filters
+    // the current one.
+    {
+        Func decode, filter, encode;
+        Var x, y, xi, yi, yo, yy;
+        decode(x, y) = x + y;
+        filter(x, y) = decode(x - 1, y) + decode(x + 1, y);
+        encode(x, y) = filter(x, y) + 1;
+
+        encode.split(y, yo, yy, 16);
+        decode.store_root().compute_at(encode, yo).async();
+        filter.compute_at(encode, yo).gpu_tile(x, y, xi, yi, 16, 16);
+
+        Buffer<int> out = encode.realize(64, 64);
+        if (check(out)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+template<typename T>
+int check(const Buffer<T> &out, const Buffer<T> &correct, const char *name) {
+    for (int x = 0; x < out.width(); x++) {
+        if (out(x) != correct(x)) {
+            printf("%s: out(%d) = %f instead of %f\n",
+                   name, x, (double)out(x), (double)correct(x));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int size = 10000, buckets = 37;
+
+    Buffer<int> input(size);
+    for (int i = 0; i < size; i++) {
+        input(i) = (i * 7919 + (i >> 3)) % buckets;
+    }
+
+    // Compute the expected results serially.
+    Buffer<int> hist_correct(buckets), max_correct(buckets), prod_correct(buckets);
+    Buffer<float> sum_correct(buckets);
+    Buffer<uint8_t> count_correct(buckets);
+    hist_correct.fill(0);
+    max_correct.fill(-1);
+    prod_correct.fill(1);
+    sum_correct.fill(0.0f);
+    count_correct.fill(0);
+    for (int i = 0; i < size; i++) {
+        int b = input(i);
+        hist_correct(b)++;
+        max_correct(b) = std::max(max_correct(b), i);
+        if (i % 100 == 0) {
+            prod_correct(b) *= 3;
+        }
+        // Small integers, so that the float sums are exact in any order.
+        sum_correct(b) += (float)(i % 4);
+        count_correct(b)++;
+    }
+
+    int result = 0;
+
+    // A histogram, parallel and vectorized over the reduction domain.
+    {
+        Func hist;
+        Var x;
+        RDom r(0, size);
+        hist(x) = 0;
+        hist(clamp(input(r), 0, buckets - 1)) += 1;
+        RVar ro, ri;
+        hist.update().atomic().split(r, ro, ri, 16).parallel(ro).vectorize(ri, 8);
+
+        Buffer<int> out = hist.realize(buckets);
+        result |= check(out, hist_correct, "histogram");
+    }
+
+    // A max reduction.
+    {
+        Func m;
+        Var x;
+        RDom r(0, size);
+        m(x) = -1;
+        m(clamp(input(r), 0, buckets - 1)) = max(m(clamp(input(r), 0, buckets - 1)), r);
+        m.update().atomic().parallel(r);
+
+        Buffer<int> out = m.realize(buckets);
+        result |= check(out, max_correct, "max");
+    }
+
+    // Integer multiplication has no atomic instruction, so this uses
+    // a compare-and-swap loop.
+    {
+        Func p;
+        Var x;
+        RDom r(0, size / 100);
+        p(x) = 1;
+        p(clamp(input(r * 100), 0, buckets - 1)) *= 3;
+        p.update().atomic().parallel(r);
+
+        Buffer<int> out = p.realize(buckets);
+        result |= check(out, prod_correct, "product");
+    }
+
+    // A float sum.
+    {
+        Func s;
+        Var x;
+        RDom r(0, size);
+        s(x) = 0.0f;
+        s(clamp(input(r), 0, buckets - 1)) += cast<float>(r % 4);
+        RVar ro, ri;
+        s.update().atomic().split(r, ro, ri, 32).parallel(ro).vectorize(ri, 4);
+
+        Buffer<float> out = s.realize(buckets);
+        result |= check(out, sum_correct, "float sum");
+    }
+
+    // A narrow type.
+    {
+        Func c;
+        Var x;
+        RDom r(0, size);
+        c(x) = cast<uint8_t>(0);
+        c(clamp(input(r), 0, buckets - 1)) += cast<uint8_t>(1);
+        c.update().atomic().parallel(r);
+
+        Buffer<uint8_t> out = c.realize(buckets);
+        result |= check(out, count_correct, "uint8 count");
+    }
+
+    if (result != 0) {
+        return result;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
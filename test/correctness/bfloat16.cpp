@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Check the rounding done by bfloat16_t itself.
+    {
+        // 1 + 2^-8 is halfway between 1 and the next bfloat16, 1 +
+        // 2^-7. Ties go to even.
+        float tie = 1.0f + 1.0f / 256;
+        if ((float)bfloat16_t(tie) != 1.0f) {
+            printf("bfloat16_t(%f) = %f instead of 1\n", tie, (float)bfloat16_t(tie));
+            return -1;
+        }
+        float above = 1.0f + 3.0f / 512;
+        if ((float)bfloat16_t(above) != 1.0f + 1.0f / 128) {
+            printf("bfloat16_t(%f) = %f instead of %f\n", above, (float)bfloat16_t(above), 1.0f + 1.0f / 128);
+            return -1;
+        }
+        if (!bfloat16_t(std::numeric_limits<float>::quiet_NaN()).is_nan()) {
+            printf("bfloat16_t(nan) is not a nan\n");
+            return -1;
+        }
+    }
+
+    const int size = 1024;
+    Buffer<bfloat16_t> in(size);
+    for (int i = 0; i < size; i++) {
+        in(i) = bfloat16_t((i - size / 2) * 0.37f);
+    }
+
+    Var x;
+    Func widened, narrowed, squared;
+    widened(x) = cast<float>(in(x));
+    narrowed(x) = cast<bfloat16_t>(in(x) * 3.1f + 0.5f);
+    squared(x) = in(x) * in(x);
+    widened.vectorize(x, 8);
+    narrowed.vectorize(x, 8);
+    squared.vectorize(x, 8);
+
+    Buffer<float> widened_out = widened.realize(size);
+    Buffer<bfloat16_t> narrowed_out = narrowed.realize(size);
+    Buffer<bfloat16_t> squared_out = squared.realize(size);
+
+    for (int i = 0; i < size; i++) {
+        float v = (float)in(i);
+        if (widened_out(i) != v) {
+            printf("widened(%d) = %f instead of %f\n", i, widened_out(i), v);
+            return -1;
+        }
+        bfloat16_t correct_narrowed(v * 3.1f + 0.5f);
+        if (narrowed_out(i).to_bits() != correct_narrowed.to_bits()) {
+            printf("narrowed(%d) = %f instead of %f\n", i, (float)narrowed_out(i), (float)correct_narrowed);
+            return -1;
+        }
+        bfloat16_t correct_squared(v * v);
+        if (squared_out(i).to_bits() != correct_squared.to_bits()) {
+            printf("squared(%d) = %f instead of %f\n", i, (float)squared_out(i), (float)correct_squared);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::CacheShapeChecks);
+
+    ImageParam in(Int(32), 2);
+    Param<int> offset;
+    Func f;
+    Var x, y;
+    f(x, y) = in(x + offset, y) * 2;
+    f.set_error_handler(my_error_handler);
+    f.compile_jit(t);
+
+    Buffer<int> input(20, 10);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y * 20; });
+    in.set(input);
+
+    // The same shapes, many times over.
+    for (int i = 0; i < 10; i++) {
+        offset.set(i);
+        Buffer<int> out = f.realize(10, 10, t);
+        if (error_occurred) {
+            printf("Unexpected error on call %d\n", i);
+            return -1;
+        }
+        for (int yy = 0; yy < 10; yy++) {
+            for (int xx = 0; xx < 10; xx++) {
+                int correct = (xx + i + yy * 20) * 2;
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A call that reads past the end of the input must still fail,
+    // both when the output shape changes and when only a scalar does.
+    f.realize(20, 10, t);
+    if (!error_occurred) {
+        printf("Expected an error for a wider output\n");
+        return -1;
+    }
+    error_occurred = false;
+
+    offset.set(15);
+    f.realize(10, 10, t);
+    if (!error_occurred) {
+        printf("Expected an error for a larger offset\n");
+        return -1;
+    }
+    error_occurred = false;
+
+    // And a shape that passed before still works.
+    offset.set(0);
+    f.realize(10, 10, t);
+    if (error_occurred) {
+        printf("Unexpected error after the cache was refreshed\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
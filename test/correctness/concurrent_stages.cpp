@@ -0,0 +1,58 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountForks : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Fork *op) override {
+        forks++;
+        return IRMutator2::visit(op);
+    }
+
+public:
+    int forks = 0;
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::ConcurrentStages);
+
+    // Two independent stages computed at root, feeding a third stage
+    // that is also computed at root, and the output. The first two
+    // should be produced concurrently.
+    Func a, b, c, out;
+    Var x, y;
+    a(x, y) = x + y;
+    b(x, y) = x * y;
+    c(x, y) = a(x, y) - b(x, y);
+    out(x, y) = c(x, y) + a(x + 1, y) + b(x, y + 1);
+    a.compute_root().parallel(y);
+    b.compute_root().vectorize(x, 8);
+    c.compute_root();
+
+    CountForks counter;
+    out.add_custom_lowering_pass(&counter, []() {});
+
+    Buffer<int> result = out.realize(64, 64, t);
+
+    if (counter.forks != 1) {
+        printf("Expected one Fork node, found %d\n", counter.forks);
+        return -1;
+    }
+
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = (x + y - x * y) + (x + 1 + y) + x * (y + 1);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
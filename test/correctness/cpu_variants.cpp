@@ -0,0 +1,83 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountVariants : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (!cpu_variant_target(op->name).empty()) {
+            variants++;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->name == "halide_can_use_target_features") {
+            checks++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int variants = 0, checks = 0;
+};
+
+int main(int argc, char **argv) {
+    Target host = get_jit_target_from_environment();
+    if (host.arch != Target::X86) {
+        printf("Skipping test because the target is not x86\n");
+        return 0;
+    }
+
+    Func f, g;
+    Var x, y;
+    f(x, y) = cast<float>(x * y) * 0.5f + 3.0f;
+    g(x, y) = f(x, y) + f(x + 1, y) * 2.0f;
+    f.compute_root().vectorize(x, 8).cpu_variants({{Target::AVX512_Skylake},
+                                                   {Target::AVX2, Target::FMA},
+                                                   {Target::SSE41}});
+    g.vectorize(x, 8);
+
+    // The jitted pipeline picks whichever variant the host supports.
+    Buffer<float> out = g.realize(64, 16);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            float correct = (x * y * 0.5f + 3.0f) + ((x + 1) * y * 0.5f + 3.0f) * 2.0f;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Ahead of time, each variant the base target lacks gets its own
+    // loop behind a runtime check.
+    Target aot = Target(Target::Linux, Target::X86, 64);
+    Module m = g.compile_to_module(g.infer_arguments(), "g", aot);
+    CountVariants count;
+    for (const auto &fn : m.functions()) {
+        fn.body.accept(&count);
+    }
+    if (count.variants != 3 || count.checks != 3) {
+        printf("Expected 3 CPU variants and 3 checks, got %d and %d\n",
+               count.variants, count.checks);
+        return -1;
+    }
+
+    // Variants the base target already covers are dropped.
+    Module m2 = g.compile_to_module(g.infer_arguments(), "g", aot.with_feature(Target::SSE41));
+    CountVariants count2;
+    for (const auto &fn : m2.functions()) {
+        fn.body.accept(&count2);
+    }
+    if (count2.variants != 2) {
+        printf("Expected 2 CPU variants, got %d\n", count2.variants);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    // A chain of Funcs that all use the same subexpression, which
+    // itself calls another Func, as machine-generated pipelines often do.
+    Func in("in");
+    Var x, y;
+    in(x, y) = x + y;
+    Expr shared = in(x, y) * 3 + in(x + 1, y);
+
+    const int num_funcs = 50;
+    std::vector<Func> chain;
+    Func prev = in;
+    for (int i = 0; i < num_funcs; i++) {
+        Func f("f" + std::to_string(i));
+        f(x, y) = prev(x, y) + shared;
+        chain.push_back(f);
+        prev = f;
+    }
+
+    std::map<std::string, Function> env;
+    populate_environment(prev.function(), env);
+
+    std::vector<Function> outputs;
+    std::map<std::string, Function> copy;
+    std::tie(outputs, copy) = deep_copy({prev.function()}, env);
+
+    // The copies must call the copy of in, and still share one copy
+    // of the subexpression between them.
+    const IRNode *copied_shared = nullptr;
+    for (int i = 0; i < num_funcs; i++) {
+        const Function &f = copy.at("f" + std::to_string(i));
+        const Add *add = f.values()[0].as<Add>();
+        if (!add) {
+            printf("Unexpected definition of %s\n", f.name().c_str());
+            return -1;
+        }
+        if (add->b.same_as(shared)) {
+            printf("Deep copy of %s still calls the original Funcs\n", f.name().c_str());
+            return -1;
+        }
+        if (!copied_shared) {
+            copied_shared = add->b.get();
+        } else if (add->b.get() != copied_shared) {
+            printf("Deep copy of %s has its own copy of the shared subexpression\n", f.name().c_str());
+            return -1;
+        }
+    }
+
+    // The copied pipeline still computes the right thing.
+    Buffer<int> result = prev.realize(8, 8);
+    for (int yy = 0; yy < 8; yy++) {
+        for (int xx = 0; xx < 8; xx++) {
+            int correct = xx + yy + num_funcs * ((xx + yy) * 3 + xx + 1 + yy);
+            if (result(xx, yy) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", xx, yy, result(xx, yy), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
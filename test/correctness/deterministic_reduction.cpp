@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 1000, H = 777, buckets = 64;
+
+    Buffer<float> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            // Values that span many orders of magnitude, so the order of
+            // the additions visibly changes the rounding.
+            input(x, y) = std::ldexp((float)((x * 7919 + y * 104729) % 1000) + 0.5f, (x + y) % 20 - 10);
+        }
+    }
+
+    // A weighted histogram and a total, both parallelized over rows.
+    Func hist("hist"), total("total");
+    Var x;
+    RDom r(input);
+    Expr bucket = clamp((r.x * 31 + r.y * 17) % buckets, 0, buckets - 1);
+    hist(x) = 0.0f;
+    hist(bucket) += input(r.x, r.y);
+    hist.update().deterministic_parallel(r.y, 8);
+
+    total() = 0.0f;
+    total() += input(r.x, r.y);
+    Func intm = total.update().deterministic_parallel(r.y, 16);
+    RVar rxo, rxi;
+    Var v;
+    intm.update(0).split(r.x, rxo, rxi, 8).rfactor(rxi, v).compute_at(intm, intm.args().back()).vectorize(v);
+
+    // Deterministic mode accepts these schedules.
+    Target t = get_jit_target_from_environment().with_feature(Target::DeterministicReductions);
+    hist.compile_jit(t);
+    total.compile_jit(t);
+
+    // Compute the expected results in double precision.
+    std::vector<double> hist_correct(buckets, 0.0);
+    double total_correct = 0.0;
+    for (int y = 0; y < H; y++) {
+        for (int xx = 0; xx < W; xx++) {
+            hist_correct[(xx * 31 + y * 17) % buckets] += input(xx, y);
+            total_correct += input(xx, y);
+        }
+    }
+
+    // The results must be bitwise identical whatever the number of
+    // threads.
+    Buffer<float> first_hist;
+    float first_total = 0.0f;
+    for (int threads : {1, 2, 3, 8, 0}) {
+        halide_set_num_threads(threads);
+        for (int run = 0; run < 3; run++) {
+            Buffer<float> h = hist.realize(buckets, t);
+            Buffer<float> s = total.realize(t);
+            if (!first_hist.defined()) {
+                first_hist = h;
+                first_total = s();
+                for (int i = 0; i < buckets; i++) {
+                    if (std::abs(h(i) - hist_correct[i]) > 1e-3 * std::abs(hist_correct[i])) {
+                        printf("hist(%d) = %f instead of %f\n", i, h(i), hist_correct[i]);
+                        return -1;
+                    }
+                }
+                if (std::abs(s() - total_correct) > 1e-3 * std::abs(total_correct)) {
+                    printf("total = %f instead of %f\n", s(), total_correct);
+                    return -1;
+                }
+                continue;
+            }
+            for (int i = 0; i < buckets; i++) {
+                if (h(i) != first_hist(i)) {
+                    printf("With %d threads, hist(%d) = %a on run %d instead of %a\n",
+                           threads, i, h(i), run, first_hist(i));
+                    return -1;
+                }
+            }
+            if (s() != first_total) {
+                printf("With %d threads, total = %a on run %d instead of %a\n",
+                       threads, s(), run, first_total);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
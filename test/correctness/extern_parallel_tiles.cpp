@@ -0,0 +1,77 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+std::atomic<int> calls;
+std::atomic<int> max_rows;
+
+// out(x, y) = x + 100 * y, over whatever region it is given.
+extern "C" DLLEXPORT int fill_rows(halide_buffer_t *out) {
+    if (out->is_bounds_query()) {
+        return 0;
+    }
+    calls++;
+    int rows = out->dim[1].extent;
+    int prev = max_rows;
+    while (rows > prev && !max_rows.compare_exchange_weak(prev, rows)) {
+    }
+    Halide::Runtime::Buffer<int> b(*out);
+    b.for_each_element([&](int x, int y) {
+        b(x, y) = x + 100 * y;
+    });
+    return 0;
+}
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    for (int task_size = 1; task_size <= 8; task_size *= 8) {
+        calls = 0;
+        max_rows = 0;
+
+        Func f, g;
+        Var x, y;
+        f.define_extern("fill_rows", {}, Int(32), {x, y});
+        if (task_size == 1) {
+            f.parallel(y);
+        } else {
+            f.parallel(y, task_size);
+        }
+        f.compute_root();
+        g(x, y) = f(x, y) + 1;
+
+        // 30 rows is not a multiple of 8, so the last tile gets cropped.
+        Buffer<int> out = g.realize(50, 30);
+
+        int expected_calls = (30 + task_size - 1) / task_size;
+        if (calls != expected_calls) {
+            printf("Extern stage was called %d times instead of %d\n",
+                   (int)calls, expected_calls);
+            return -1;
+        }
+        if (max_rows != task_size) {
+            printf("Largest tile had %d rows instead of %d\n", (int)max_rows, task_size);
+            return -1;
+        }
+
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                int correct = xx + 100 * yy + 1;
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
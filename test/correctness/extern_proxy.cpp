@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int bounds_queries = 0;
+int calls = 0;
+
+// out(x) = in(x - 1) + in(x + 1)
+extern "C" DLLEXPORT int sum_neighbors(halide_buffer_t *in, halide_buffer_t *out) {
+    int min = out->dim[0].min;
+    int max = out->dim[0].min + out->dim[0].extent - 1;
+    if (in->is_bounds_query()) {
+        bounds_queries++;
+        in->dim[0].min = min - 1;
+        in->dim[0].extent = out->dim[0].extent + 2;
+    } else {
+        calls++;
+        if (in->dim[0].min > min - 1 ||
+            in->dim[0].min + in->dim[0].extent - 1 < max + 1) {
+            printf("Input region [%d, %d] does not cover [%d, %d]\n",
+                   in->dim[0].min, in->dim[0].min + in->dim[0].extent - 1,
+                   min - 1, max + 1);
+            exit(-1);
+        }
+        const int *src = (const int *)in->host - in->dim[0].min;
+        int *dst = (int *)out->host - min;
+        for (int i = min; i <= max; i++) {
+            dst[i] = src[i - 1] + src[i + 1];
+        }
+    }
+    return 0;
+}
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    for (int use_proxy = 0; use_proxy < 2; use_proxy++) {
+        bounds_queries = 0;
+        calls = 0;
+
+        Func f, g, h;
+        Var x;
+        f(x) = x * x;
+        f.compute_root();
+
+        g.define_extern("sum_neighbors", {f}, Int(32), {x});
+        if (use_proxy) {
+            g.extern_proxy(f(x - 1) + f(x + 1));
+        }
+
+        h(x) = g(x) * 2;
+        g.compute_root();
+
+        Buffer<int> out = h.realize(100);
+
+        for (int i = 0; i < out.width(); i++) {
+            int correct = ((i - 1) * (i - 1) + (i + 1) * (i + 1)) * 2;
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+
+        if (calls != 1) {
+            printf("sum_neighbors was called %d times instead of once\n", calls);
+            return -1;
+        }
+
+        int expected_queries = use_proxy ? 0 : 1;
+        if (bounds_queries != expected_queries) {
+            printf("sum_neighbors got %d bounds queries instead of %d\n",
+                   bounds_queries, expected_queries);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "Halide.h"
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+
+template<typename T>
+T reference_saturating_add(T a, T b) {
+    T result;
+    if (__builtin_add_overflow(a, b, &result)) {
+        return (std::numeric_limits<T>::is_signed && a < 0) ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+    }
+    return result;
+}
+
+template<typename T>
+T reference_saturating_sub(T a, T b) {
+    T result;
+    if (__builtin_sub_overflow(a, b, &result)) {
+        return (std::numeric_limits<T>::is_signed && a < 0) ? std::numeric_limits<T>::min() :
+            (std::numeric_limits<T>::is_signed ? std::numeric_limits<T>::max() : 0);
+    }
+    return result;
+}
+
+template<typename T>
+T reference_rounding_shift_right(T a, int b) {
+    if (b == 0) {
+        return a;
+    }
+    return (a >> b) + ((a >> (b - 1)) & 1);
+}
+
+template<typename T>
+T reference_saturating_rounding_doubling_high_multiply(T a, T b) {
+    const int bits = sizeof(T) * 8;
+    if (a == std::numeric_limits<T>::min() && b == std::numeric_limits<T>::min()) {
+        return std::numeric_limits<T>::max();
+    }
+    int64_t p = (int64_t)a * (int64_t)b;
+    return (T)((p + ((int64_t)1 << (bits - 2))) >> (bits - 1));
+}
+
+template<typename T>
+bool test_type(int vector_width) {
+    const int W = 256, H = 4;
+    Buffer<T> a(W, H), b(W, H);
+    // The interesting values are at the edges of the type's range.
+    const T values[] = {0, 1, 2, 3,
+                        std::numeric_limits<T>::max(),
+                        (T)(std::numeric_limits<T>::max() - 1),
+                        std::numeric_limits<T>::min(),
+                        (T)(std::numeric_limits<T>::min() + 1),
+                        (T)(std::numeric_limits<T>::max() / 2),
+                        (T)(std::numeric_limits<T>::min() / 2),
+                        (T)-1, (T)-2};
+    const int num_values = sizeof(values) / sizeof(values[0]);
+    uint64_t seed = 1;
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            // Edge values first, then pseudo-random ones.
+            int i = x + y * W;
+            if (i < num_values * num_values) {
+                a(x, y) = values[i % num_values];
+                b(x, y) = values[i / num_values];
+            } else {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                a(x, y) = (T)(seed >> 17);
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                b(x, y) = (T)(seed >> 23);
+            }
+        }
+    }
+
+    const int bits = sizeof(T) * 8;
+    const bool is_int = std::numeric_limits<T>::is_signed;
+
+    Var x, y;
+    Func f;
+    Expr shift = cast<uint8_t>(b(x, y)) % bits;
+    std::vector<Expr> values_out = {
+        saturating_add(a(x, y), b(x, y)),
+        saturating_sub(a(x, y), b(x, y)),
+        rounding_shift_right(a(x, y), shift),
+    };
+    if (is_int && bits <= 32) {
+        values_out.push_back(saturating_rounding_doubling_high_multiply(a(x, y), b(x, y)));
+    }
+    f(x, y) = Tuple(values_out);
+    if (vector_width > 1) {
+        f.vectorize(x, vector_width);
+    }
+    Realization r = f.realize(W, H);
+    Buffer<T> add = r[0], sub = r[1], rshr = r[2];
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            T av = a(x, y), bv = b(x, y);
+            int s = (int)((uint8_t)bv % bits);
+            T correct_add = reference_saturating_add(av, bv);
+            T correct_sub = reference_saturating_sub(av, bv);
+            T correct_rshr = reference_rounding_shift_right(av, s);
+            if (add(x, y) != correct_add) {
+                printf("saturating_add(%lld, %lld) = %lld instead of %lld (%d bits)\n",
+                       (long long)av, (long long)bv, (long long)add(x, y), (long long)correct_add, bits);
+                return false;
+            }
+            if (sub(x, y) != correct_sub) {
+                printf("saturating_sub(%lld, %lld) = %lld instead of %lld (%d bits)\n",
+                       (long long)av, (long long)bv, (long long)sub(x, y), (long long)correct_sub, bits);
+                return false;
+            }
+            if (rshr(x, y) != correct_rshr) {
+                printf("rounding_shift_right(%lld, %d) = %lld instead of %lld (%d bits)\n",
+                       (long long)av, s, (long long)rshr(x, y), (long long)correct_rshr, bits);
+                return false;
+            }
+            if (r.size() > 3) {
+                Buffer<T> mulh = r[3];
+                T correct_mulh = reference_saturating_rounding_doubling_high_multiply(av, bv);
+                if (mulh(x, y) != correct_mulh) {
+                    printf("saturating_rounding_doubling_high_multiply(%lld, %lld) = %lld instead of %lld\n",
+                           (long long)av, (long long)bv, (long long)mulh(x, y), (long long)correct_mulh);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int vector_width : {1, 4, 8, 16, 32}) {
+        if (!test_type<int8_t>(vector_width) ||
+            !test_type<uint8_t>(vector_width) ||
+            !test_type<int16_t>(vector_width) ||
+            !test_type<uint16_t>(vector_width) ||
+            !test_type<int32_t>(vector_width) ||
+            !test_type<uint32_t>(vector_width) ||
+            !test_type<int64_t>(vector_width) ||
+            !test_type<uint64_t>(vector_width)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
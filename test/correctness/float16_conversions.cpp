@@ -0,0 +1,89 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+int test(const Target &t) {
+    const int size = 1024;
+    const bool fast = t.has_feature(Target::FastFloat16Conversions);
+
+    // A mix of ordinary values, values that are denormal halfs, and
+    // values that are too large for a half.
+    Buffer<float> in(size);
+    for (int i = 0; i < size; i++) {
+        float v;
+        if (i % 3 == 0) {
+            v = (i - size / 2) * 0.37f;
+        } else if (i % 3 == 1) {
+            v = (i - size / 2) * 1.3e-7f;
+        } else {
+            v = (i - size / 2) * 171.0f;
+        }
+        in(i) = v;
+    }
+
+    Var x;
+    Func narrowed, widened, summed;
+    narrowed(x) = cast<float16_t>(in(x));
+    widened(x) = cast<float>(narrowed(x));
+    summed(x) = narrowed(x) + narrowed(x + 1);
+    narrowed.compute_root().vectorize(x, 16);
+    widened.vectorize(x, 8);
+    summed.vectorize(x, 8);
+
+    Buffer<float16_t> narrowed_out = narrowed.realize(size, t);
+    Buffer<float> widened_out = widened.realize(size, t);
+    Buffer<float16_t> summed_out = summed.realize(size - 1, t);
+
+    for (int i = 0; i < size; i++) {
+        float v = in(i);
+        float16_t correct(v);
+        float16_t actual = narrowed_out(i);
+        if (!fast && actual.to_bits() != correct.to_bits()) {
+            printf("%s: float16(%g) = %g instead of %g\n",
+                   t.to_string().c_str(), v, (float)actual, (float)correct);
+            return -1;
+        }
+        if (fast && !correct.is_infinity() &&
+            std::abs((float)actual - v) > std::max(std::abs(v) / 1024, 1.0f / (1 << 14))) {
+            printf("%s: fast float16(%g) = %g, which is too far from %g\n",
+                   t.to_string().c_str(), v, (float)actual, (float)correct);
+            return -1;
+        }
+        if (widened_out(i) != (float)actual) {
+            printf("%s: float(%g) = %g\n",
+                   t.to_string().c_str(), (float)actual, widened_out(i));
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < size - 1; i++) {
+        float16_t correct = narrowed_out(i) + narrowed_out(i + 1);
+        float16_t actual = summed_out(i);
+        float error = std::abs((float)actual - (float)correct);
+        if (actual.to_bits() != correct.to_bits() &&
+            !(fast && error <= std::max(std::abs((float)correct) / 1024, 1.0f / (1 << 14)))) {
+            printf("%s: %g + %g = %g instead of %g\n",
+                   t.to_string().c_str(), (float)narrowed_out(i), (float)narrowed_out(i + 1),
+                   (float)actual, (float)correct);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    // The native conversions if the target has them, and the
+    // software ones.
+    if (test(t) ||
+        test(t.without_feature(Target::F16C)) ||
+        test(t.without_feature(Target::F16C).with_feature(Target::FastFloat16Conversions))) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
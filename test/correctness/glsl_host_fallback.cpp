@@ -0,0 +1,46 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A GLSL schedule should still work on a target without OpenGL,
+    // by running on the CPU instead.
+    Target t = get_jit_target_from_environment().without_feature(Target::OpenGL);
+
+    Buffer<uint8_t> input(37, 19, 3);
+    input.fill([](int x, int y, int c) { return (uint8_t)(x * 3 + y * 5 + c * 7); });
+
+    Func in("in"), blur("blur");
+    Var x("x"), y("y"), c("c");
+    in(x, y, c) = cast<float>(input(clamp(x, 0, input.width() - 1),
+                                    clamp(y, 0, input.height() - 1), c));
+    blur(x, y, c) = cast<uint8_t>((in(x - 1, y, c) + in(x, y, c) + in(x + 1, y, c)) / 3);
+
+    blur.bound(c, 0, 3);
+    blur.glsl(x, y, c);
+
+    Buffer<uint8_t> out(37, 19, 3);
+    blur.realize(out, t);
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float sum = 0;
+                for (int dx = -1; dx <= 1; dx++) {
+                    int xc = std::min(std::max(x + dx, 0), input.width() - 1);
+                    sum += input(xc, y, c);
+                }
+                uint8_t correct = (uint8_t)(sum / 3);
+                if (out(x, y, c) != correct) {
+                    printf("out(%d, %d, %d) = %d instead of %d\n",
+                           x, y, c, out(x, y, c), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
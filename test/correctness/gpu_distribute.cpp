@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include <stdlib.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.has_feature(Target::CUDA)) {
+        printf("This test requires a CUDA target. Skipping it\n");
+        return 0;
+    }
+
+    // Bots usually have a single GPU, so only spread the work over
+    // more devices when asked to.
+    int devices = 1;
+    if (const char *env = getenv("HL_TEST_GPU_DEVICES")) {
+        devices = atoi(env);
+    }
+
+    ImageParam in(Int(32), 2);
+    Param<int> num_devices;
+    Func f;
+    Var x, y, xi, yi, yo;
+    // A blur, so that each device needs a halo of its neighbours' rows.
+    Func clamped = BoundaryConditions::repeat_edge(in);
+    f(x, y) = clamped(x, y - 1) + clamped(x, y) + clamped(x, y + 1);
+
+    f.split(y, yo, y, 16)
+        .distribute_gpus(yo, num_devices)
+        .gpu_tile(x, y, xi, yi, 8, 8);
+    // Copy each device's region of the input, halo included, within
+    // the distributed loop.
+    clamped.compute_at(f, yo);
+
+    Buffer<int> input(64, 64), output(64, 64);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x + y * 3;
+    });
+    in.set(input);
+    num_devices.set(devices);
+
+    f.realize(output, target);
+    output.copy_to_host();
+
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                int yy = std::min(std::max(y + dy, 0), 63);
+                correct += input(x, yy);
+            }
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n",
+                       x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
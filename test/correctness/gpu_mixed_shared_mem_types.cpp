@@ -36,7 +36,8 @@ int main(int argc, char **argv) {
 
     Type result_type;
     if (t.has_feature(Target::Metal) ||
-        t.has_feature(Target::D3D12Compute)) {
+        t.has_feature(Target::D3D12Compute) ||
+        t.has_feature(Target::Vulkan)) {
         result_type = UInt(32);
     } else {
         result_type = UInt(64);
@@ -47,9 +48,10 @@ int main(int argc, char **argv) {
         int off = 0;
         if ((types[i].is_int() || types[i].is_uint())) {
             // Metal does not support 64-bit integers.
-            // neither does D3D12 with SM 5.1.
+            // neither does D3D12 with SM 5.1, nor the Vulkan backend.
             if ((t.supports_device_api(DeviceAPI::Metal) ||
-                 t.supports_device_api(DeviceAPI::D3D12Compute)) &&
+                 t.supports_device_api(DeviceAPI::D3D12Compute) ||
+                 t.supports_device_api(DeviceAPI::Vulkan)) &&
                 types[i].bits() >= 64) {
                 continue;
             }
@@ -73,7 +75,8 @@ int main(int argc, char **argv) {
 
     int result;
     if (t.has_feature(Target::Metal) ||
-        t.has_feature(Target::D3D12Compute)) {
+        t.has_feature(Target::D3D12Compute) ||
+        t.has_feature(Target::Vulkan)) {
         result = check_result<uint32_t>(output, n_types - 2, offset);
     } else {
         result = check_result<uint64_t>(output, n_types, offset);
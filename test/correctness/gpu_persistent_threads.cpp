@@ -0,0 +1,42 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t(get_jit_target_from_environment());
+    if (!t.has_gpu_feature()) {
+        printf("Not running test because no gpu target enabled\n");
+        return 0;
+    }
+    t.set_feature(Target::GPUPersistentThreads);
+
+    // A two-stage blur with the first stage in shared memory, over
+    // many more blocks than are launched, so that each block reuses
+    // its shared memory for several work items.
+    Func f, g;
+    Var x, y, xi, yi;
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x - 1, y) + f(x + 1, y) + f(x, y + 1);
+
+    g.gpu_tile(x, y, xi, yi, 8, 8);
+    f.compute_at(g, x).gpu_threads(x, y);
+
+    Buffer<int> out(512, 512);
+    g.realize(out, t);
+    out.copy_to_host();
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x - 1) * 3 + y + (x + 1) * 3 + y + x * 3 + y + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Records the size of the shared memory allocation of a Func.
+class FindSharedSize : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (op->name == "__shared_" + name && op->extents.size() == 1) {
+            size = op->extents[0];
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    std::string name;
+    Expr size;
+    FindSharedSize(const std::string &name) : name(name) {}
+};
+
+// A transpose through shared memory, so that the reads of the
+// intermediate by the threads of a warp go down a column of it.
+void define_transpose(Func &in, Func &out) {
+    Var x, y, xi, yi;
+    in(x, y) = x + 2 * y;
+    out(x, y) = in(y, x);
+    out.gpu_tile(x, y, xi, yi, 32, 8);
+    in.compute_at(out, x).store_in(MemoryType::GPUShared).gpu_threads(x, y);
+}
+
+Expr shared_size(Func in, Func out, const Target &t) {
+    FindSharedSize *finder = new FindSharedSize(in.name());
+    out.add_custom_lowering_pass(finder);
+    out.compile_to_module({}, "transpose", t);
+    return finder->size;
+}
+
+int main(int argc, char **argv) {
+    // OpenGLCompute gives each shared allocation its own name, which
+    // makes them easy to find.
+    Target t = get_host_target().with_feature(Target::OpenGLCompute);
+
+    // The rows of in are 8 ints long, and would need to be 9 to keep
+    // the column reads free of bank conflicts.
+    {
+        Func in, out;
+        define_transpose(in, out);
+        Expr size = shared_size(in, out, t);
+        if (!size.defined() || !is_const(size, 9 * 32)) {
+            std::cout << "Expected a padded shared allocation of size " << 9 * 32
+                      << " instead of " << size << "\n";
+            return -1;
+        }
+    }
+
+    // An explicit padding of zero turns that off.
+    {
+        Func in, out;
+        define_transpose(in, out);
+        in.pad_storage(in.args()[0], 0);
+        Expr size = shared_size(in, out, t);
+        if (!size.defined() || !is_const(size, 8 * 32)) {
+            std::cout << "Expected an unpadded shared allocation of size " << 8 * 32
+                      << " instead of " << size << "\n";
+            return -1;
+        }
+    }
+
+    // Padding on the CPU.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x + 2 * y;
+        g(x, y) = f(y, x);
+        f.compute_root().pad_storage(x, 3);
+        Buffer<int> out = g.realize(17, 19);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != y + 2 * x) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), y + 2 * x);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // And the transpose itself, if there's a GPU to run it on.
+    Target jit = get_jit_target_from_environment();
+    if (jit.has_gpu_feature()) {
+        Func in, out;
+        define_transpose(in, out);
+        Buffer<int> result = out.realize(64, 64, jit);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                if (result(x, y) != y + 2 * x) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), y + 2 * x);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
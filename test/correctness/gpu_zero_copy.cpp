@@ -0,0 +1,50 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.has_feature(Target::OpenCL) && !target.has_feature(Target::Metal)) {
+        printf("This test requires an OpenCL or Metal target. Skipping it\n");
+        return 0;
+    }
+    target.set_feature(Target::ZeroCopy);
+
+    ImageParam in(Int(32), 2);
+    Func f;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2 + 1;
+    f.gpu_tile(x, y, xi, yi, 8, 8);
+    f.compile_jit(target);
+
+    Buffer<int> input(64, 64), output(64, 64);
+    in.set(input);
+
+    // With zero-copy, the host and device share the allocations, so
+    // make sure changes made on either side keep showing up on the
+    // other across several runs.
+    for (int i = 0; i < 3; i++) {
+        input.for_each_element([&](int x, int y) {
+            input(x, y) = x + y * i;
+        });
+        input.set_host_dirty();
+
+        f.realize(output, target);
+        output.copy_to_host();
+
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = (x + y * i) * 2 + 1;
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d on run %d\n",
+                           x, y, output(x, y), correct, i);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -114,6 +114,20 @@ int main(int argc, char **argv) {
         test_copy(a, b);
     }
 
+    {
+        // Check copying between planar and interleaved layouts, which
+        // is done in tiles.
+        Buffer<uint8_t> planar(130, 67, 3);
+        planar.fill([&](int x, int y, int c) {return (uint8_t)(x + 3 * y + 50 * c);});
+        Buffer<uint8_t> interleaved = Buffer<uint8_t>::make_interleaved(130, 67, 3);
+        interleaved.copy_from(planar);
+        check_equal(interleaved, planar);
+
+        Buffer<uint8_t> planar_again(130, 67, 3);
+        planar_again.copy_from(interleaved);
+        check_equal(planar_again, planar);
+    }
+
     {
         // Check make a Buffer from a Buffer of a different type
         Buffer<float, 2> a(100, 80);
@@ -355,6 +369,60 @@ int main(int argc, char **argv) {
         assert(d.all_equal(4));
     }
 
+    {
+        // Check BufferView agrees with the equivalent Buffer operations
+        Buffer<int> a(10, 8, 3);
+        a.fill([](int x, int y, int c) { return x + 10 * y + 100 * c; });
+
+        BufferView<const int> v = a;
+        assert(v.dimensions() == 3 && v.width() == 10 && v.height() == 8 && v.channels() == 3);
+        assert(&v(3, 4, 2) == &a(3, 4, 2));
+
+        BufferView<const int> c = v.cropped(0, 2, 5).cropped(1, 3, 4);
+        Buffer<int> ac = a.cropped(0, 2, 5).cropped(1, 3, 4);
+        assert(c.data() == ac.data());
+        assert(c.dim(0).min() == 2 && c.dim(0).extent() == 5);
+        assert(c(4, 5, 1) == 4 + 50 + 100);
+
+        BufferView<const int> s = v.sliced(2, 1).transposed(0, 1).translated(0, 7);
+        assert(s.dimensions() == 2);
+        assert(&s(10, 3) == &a(3, 3, 1));
+
+        // Views of views, and writing through a mutable view
+        BufferView<int> m = a;
+        BufferView<void> mv = m.cropped(2, 2, 1);
+        assert(mv.type() == halide_type_of<int>());
+        m(0, 0, 0) = -1;
+        assert(a(0, 0, 0) == -1);
+
+        // A view can be passed where a halide_buffer_t is wanted
+        halide_buffer_t *raw = c;
+        assert(raw->dim[1].min == 3 && raw->host == (uint8_t *)ac.data());
+    }
+
+    {
+        // Check StaticShapeBuffer indexing matches an equivalent Buffer
+        StaticShapeBuffer<float, 3, 4> k(0.0f);
+        static_assert(k.dimensions() == 2 && k.stride(1) == 3 && k.number_of_elements() == 12, "bad static shape");
+        int count = 0;
+        k.for_each_element([&](int x, int y) {
+            k(x, y) = x + 10 * y;
+            count++;
+        });
+        assert(count == 12);
+        Buffer<float> b(*k.raw_buffer());
+        assert(b.dimensions() == 2 && b.width() == 3 && b.height() == 4);
+        b.for_each_element([&](int x, int y) {
+            assert(b(x, y) == x + 10 * y);
+            assert(&b(x, y) == &k(x, y));
+        });
+        float sum = 0;
+        const StaticShapeBuffer<float, 3, 4> k2 = k;
+        k2.for_each_value([&](const float &v) { sum += v; });
+        assert(sum == 4 * 3 + 3 * 60);
+        assert(k2(2, 3) == 32 && k2.data() != k.data());
+    }
+
     printf("Success!\n");
     return 0;
 }
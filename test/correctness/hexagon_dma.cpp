@@ -0,0 +1,49 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.features_any_of({Target::HVX_64, Target::HVX_128}) ||
+        !target.has_feature(Target::HVX_v66)) {
+        printf("This test requires a Hexagon v66 or later target. Skipping it\n");
+        return 0;
+    }
+
+    const int W = 512, H = 128;
+    const int lanes = target.has_feature(Target::HVX_128) ? 128 : 64;
+
+    ImageParam in(UInt(8), 2);
+
+    Var x, y, yo, yi;
+    Func f("f");
+    f(x, y) = in(x, y) + in(x, y + 1) * 2;
+
+    // Copy the tiles of the input into VTCM with DMA, double
+    // buffered, so the next tile is copied while this one is used.
+    f.hexagon().split(y, yo, yi, 16).vectorize(x, lanes);
+    in.in().compute_at(f, yo).store_root().store_in(MemoryType::VTCM)
+        .ring_buffer(2).async().hexagon_dma();
+
+    Buffer<uint8_t> input(W, H + 1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint8_t)(x * 7 + y * 3);
+    });
+    in.set(input);
+
+    Buffer<uint8_t> output = f.realize(W, H, target);
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            uint8_t correct = (uint8_t)(input(x, y) + input(x, y + 1) * 2);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.features_any_of({Target::HVX_64, Target::HVX_128})) {
+        printf("This test requires a Hexagon target. Skipping it\n");
+        return 0;
+    }
+
+    const int W = 1024, H = 64;
+    const int lanes = target.has_feature(Target::HVX_128) ? 128 : 64;
+
+    ImageParam in(UInt(8), 2);
+
+    // A small stencil chain, with the intermediate tiles in VTCM. On
+    // targets without VTCM, or if it runs out, they go on the heap.
+    Var x, y, yo, yi;
+    Func bounded = BoundaryConditions::repeat_edge(in);
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = cast<uint16_t>(bounded(x - 1, y)) + bounded(x, y) + bounded(x + 1, y);
+    blur_y(x, y) = cast<uint8_t>((blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 9);
+
+    blur_y.hexagon().split(y, yo, yi, 8).vectorize(x, lanes);
+    blur_x.compute_at(blur_y, yo).store_in(MemoryType::VTCM).vectorize(x, lanes / 2);
+
+    Buffer<uint8_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint8_t)(x * 3 + y * 5);
+    });
+    in.set(input);
+
+    Buffer<uint8_t> output = blur_y.realize(W, H, target);
+
+    auto clamped = [&](int x, int y) {
+        return (int)input(std::min(std::max(x, 0), W - 1), std::min(std::max(y, 0), H - 1));
+    };
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int sum = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    sum += clamped(x + dx, y + dy);
+                }
+            }
+            uint8_t correct = (uint8_t)(sum / 9);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
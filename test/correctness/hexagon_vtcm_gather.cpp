@@ -0,0 +1,57 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.features_any_of({Target::HVX_64, Target::HVX_128}) ||
+        !target.features_any_of({Target::HVX_v65, Target::HVX_v66})) {
+        printf("This test requires a Hexagon v65 or later target. Skipping it\n");
+        return 0;
+    }
+
+    const int W = 1024, H = 16, lut_size = 4096;
+    const int lanes = target.has_feature(Target::HVX_128) ? 64 : 32;
+
+    ImageParam lut_in(UInt(16), 1), index(UInt(16), 2);
+
+    Var x, y;
+    Func lut("lut"), gathered("gathered"), out("out");
+    lut(x) = lut_in(x);
+    gathered(x, y) = lut(clamp(cast<int>(index(x, y)), 0, lut_size - 1));
+    out(x, y) = gathered(x, y);
+
+    // The lookups are from one VTCM buffer into another, so they can
+    // be done with vgather.
+    out.hexagon().vectorize(x, lanes);
+    lut.compute_at(out, y).store_in(MemoryType::VTCM).vectorize(x, lanes);
+    gathered.compute_at(out, y).store_in(MemoryType::VTCM).vectorize(x, lanes);
+
+    Buffer<uint16_t> l(lut_size), idx(W, H);
+    for (int i = 0; i < lut_size; i++) {
+        l(i) = (uint16_t)(i * 7 + 3);
+    }
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            idx(i, j) = (uint16_t)((i * 31 + j * 17) % lut_size);
+        }
+    }
+    lut_in.set(l);
+    index.set(idx);
+
+    Buffer<uint16_t> output = out.realize(W, H, target);
+
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            uint16_t correct = l(idx(i, j));
+            if (output(i, j) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", i, j, output(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -134,6 +134,89 @@ void test_convert_image_d2d(Buffer<> buf_d) {
     }
 }
 
+// Load an image straight into buffers of other layouts and types.
+template<typename T>
+void test_load_into(Buffer<T> buf, std::string format) {
+    std::cout << "Testing load_into for format: " << format << " for " << halide_type_of<T>() << "x" << buf.channels() << "\n";
+
+    const int width = buf.width(), height = buf.height(), channels = buf.channels();
+    const int xmin = buf.dim(0).min(), ymin = buf.dim(1).min();
+
+    // Save from an interleaved copy, to exercise writing from that layout too.
+    Buffer<T> interleaved = Buffer<T>::make_interleaved(width, height, channels);
+    interleaved.translate({xmin, ymin});
+    interleaved.copy_from(buf);
+    std::ostringstream o;
+    o << Internal::get_test_tmp_dir() << "test_load_into_" << halide_type_of<T>() << "x" << channels << "." << format;
+    std::string filename = o.str();
+    Tools::save_image(interleaved, filename);
+
+    Buffer<T> reloaded = Buffer<T>::make_interleaved(width, height, channels);
+    Buffer<float> reloaded_float(width, height, channels);
+    if (!Tools::load_into(filename, &reloaded) ||
+        !Tools::load_into(filename, &reloaded_float)) {
+        printf("test_load_into: Failed to load %s\n", filename.c_str());
+        abort();
+    }
+
+    const int max_diff = (format == "jpg") ? 32 : 0;
+    const float one = std::numeric_limits<T>::max();
+    for (int c = 0; c < channels; c++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int correct = buf(x + xmin, y + ymin, c);
+                int diff = std::abs(reloaded(x, y, c) - correct);
+                float diff_float = std::abs(reloaded_float(x, y, c) * one - reloaded(x, y, c));
+                if (diff > max_diff || diff_float > 0.5f) {
+                    printf("test_load_into: (%d, %d, %d) loaded as %d and %f instead of %d\n",
+                           x, y, c, (int)reloaded(x, y, c), reloaded_float(x, y, c), correct);
+                    abort();
+                }
+            }
+        }
+    }
+}
+
+// Map a raw image file instead of reading it.
+template<typename T>
+void test_map(Buffer<T> buf, std::string format) {
+    std::cout << "Testing map for format: " << format << " for " << halide_type_of<T>() << "\n";
+
+    std::ostringstream o;
+    o << Internal::get_test_tmp_dir() << "test_map_" << halide_type_of<T>() << "." << format;
+    std::string filename = o.str();
+    Tools::save_image(buf, filename);
+
+    Buffer<T> mapped = Tools::map_image(filename);
+    for (int d = 0; d < buf.dimensions(); ++d) {
+        mapped.translate(d, buf.dim(d).min() - mapped.dim(d).min());
+    }
+    // The mapping must outlive the Buffer it was made for.
+    Buffer<T> shared = mapped;
+    mapped = Buffer<T>();
+
+    RDom r(shared);
+    std::vector<Expr> args;
+    for (int i = 0; i < r.dimensions(); ++i) {
+        args.push_back(r[i]);
+    }
+    uint32_t diff = evaluate<uint32_t>(maximum(abs(cast<int>(buf(args)) - cast<int>(shared(args)))));
+    if (diff > 0) {
+        printf("test_map: Difference of %d when mapped as %s\n", diff, format.c_str());
+        abort();
+    }
+
+    // The mapping is private, so writes must not reach the file.
+    T *first = shared.begin();
+    const T original = *first;
+    *first = original + 1;
+    Buffer<T> reloaded = Tools::load_image(filename);
+    if (*reloaded.begin() != original) {
+        printf("test_map: A write to a mapped %s file reached the file\n", format.c_str());
+        abort();
+    }
+}
+
 Func make_noise(int depth) {
     Func f;
     Var x, y, c;
@@ -196,6 +279,7 @@ void do_test() {
             Buffer<T> cb4 = color_buf.embedded(color_buf.dimensions());
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x4\n";
             test_round_trip(cb4, format);
+            test_map(cb4, format);
 
             // Here we test matching strides
             Func f2;
@@ -212,6 +296,10 @@ void do_test() {
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x3\n";
             // pgm really only supports gray images.
             test_round_trip(color_buf, format);
+            test_load_into(color_buf, format);
+            if (format == "mat") {
+                test_map(color_buf, format);
+            }
         }
         if (format != "ppm") {
             std::cout << "Testing format: " << format << " for " << halide_type_of<T>() << "x1\n";
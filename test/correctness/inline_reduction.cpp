@@ -175,6 +175,54 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    // Check the parallel strategy agrees with the serial one, over one
+    // and two dimensional domains, with extents that aren't multiples
+    // of the chunk or vector sizes.
+    {
+        Func img;
+        Var x, y;
+        img(x, y) = (x * 17 + y * 31) % 101 - 50;
+
+        RDom r1(3, 5000);
+        RDom r2(0, 123, 0, 45);
+        Expr e1 = img(r1, 7);
+        Expr e2 = img(r2.x, r2.y);
+
+        for (int i = 0; i < 2; i++) {
+            Expr e = i == 0 ? e1 : e2;
+            int serial_sum = evaluate<int>(sum(e));
+            int parallel_sum = evaluate<int>(sum(e, ReductionStrategy::Parallel));
+            int serial_max = evaluate<int>(maximum(e));
+            int parallel_max = evaluate<int>(maximum(e, ReductionStrategy::Parallel));
+            int serial_min = evaluate<int>(minimum(e));
+            int parallel_min = evaluate<int>(minimum(e, ReductionStrategy::Parallel));
+            if (serial_sum != parallel_sum ||
+                serial_max != parallel_max ||
+                serial_min != parallel_min) {
+                printf("Parallel reduction %d disagrees with serial: "
+                       "sum %d vs %d, max %d vs %d, min %d vs %d\n", i,
+                       parallel_sum, serial_sum,
+                       parallel_max, serial_max,
+                       parallel_min, serial_min);
+                return -1;
+            }
+        }
+
+        // With a free variable
+        Func f, g;
+        f(y) = sum(img(r2.x, r2.y + y));
+        g(y) = sum(img(r2.x, r2.y + y), ReductionStrategy::Parallel);
+        Buffer<int> f_buf = f.realize(10);
+        Buffer<int> g_buf = g.realize(10);
+        for (int y = 0; y < 10; y++) {
+            if (f_buf(y) != g_buf(y)) {
+                printf("Parallel sum with free var: %d instead of %d at %d\n",
+                       g_buf(y), f_buf(y), y);
+                return -1;
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 
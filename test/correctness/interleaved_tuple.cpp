@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the allocations made for each Func
+class CountAllocations : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (starts_with(op->name, "complex.")) {
+            count++;
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    // A complex-valued Func stored interleaved, read at scattered
+    // locations by its consumer.
+    Func complex("complex"), out("out");
+    complex(x, y) = Tuple(cast<float>(x + y), cast<float>(x - y));
+    Expr sx = (x * 7) % 64, sy = (y * 5) % 32;
+    out(x, y) = complex(sx, sy)[0] * 2.0f + complex(sx, sy)[1];
+
+    complex.compute_root().store_interleaved().vectorize(x, 8);
+    out.vectorize(x, 8);
+
+    CountAllocations counter;
+    out.add_custom_lowering_pass(&counter, nullptr);
+
+    Buffer<float> result = out.realize(64, 32);
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 64; x++) {
+            int cx = (x * 7) % 64, cy = (y * 5) % 32;
+            float correct = (cx + cy) * 2.0f + (cx - cy);
+            if (result(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n",
+                       x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (counter.count != 1) {
+        printf("There were %d allocations for complex instead of one\n", counter.count);
+        return -1;
+    }
+
+    // An interleaved reduction with an update that reads itself.
+    {
+        Func f, g;
+        RDom r(0, 10);
+        f(x) = Tuple(x, 0);
+        f(x) = Tuple(f(x)[0] + r, f(x)[1] + f(x)[0]);
+        g(x) = f(x)[0] * 1000 + f(x)[1];
+        f.compute_root().store_interleaved();
+
+        Buffer<int> im = g.realize(16);
+        for (int x = 0; x < 16; x++) {
+            int a = x, b = 0;
+            for (int i = 0; i < 10; i++) {
+                int old_a = a;
+                a += i;
+                b += old_a;
+            }
+            if (im(x) != a * 1000 + b) {
+                printf("g(%d) = %d instead of %d\n", x, im(x), a * 1000 + b);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "Halide.h"
+#include <iostream>
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that no divisions by non-constants are left inside loops.
+class CheckNoDivisionInLoops : public IRMutator2 {
+    class Finder : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) override {
+            int old_depth = depth;
+            depth++;
+            IRVisitor::visit(op);
+            depth = old_depth;
+        }
+
+        void visit(const Div *op) override {
+            if (depth > 0 && !op->type.is_float() && !is_const(op->b)) {
+                found = true;
+            }
+            IRVisitor::visit(op);
+        }
+
+        void visit(const Mod *op) override {
+            if (depth > 0 && !op->type.is_float() && !is_const(op->b)) {
+                found = true;
+            }
+            IRVisitor::visit(op);
+        }
+
+        int depth = 0;
+
+    public:
+        bool found = false;
+    };
+
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        Finder f;
+        s.accept(&f);
+        if (f.found) {
+            printf("Found a division inside a loop:\n");
+            std::cout << s << "\n";
+            exit(-1);
+        }
+        return s;
+    }
+};
+
+template<typename T>
+T euclidean_div(T a, T b) {
+    int64_t q = (int64_t)a / (int64_t)b;
+    int64_t r = (int64_t)a - q * (int64_t)b;
+    if (r < 0) {
+        q += (b < 0) ? 1 : -1;
+    }
+    return (T)q;
+}
+
+template<typename T>
+bool test(int vector_width) {
+    Buffer<T> input(1024);
+    for (int i = 0; i < input.width(); i++) {
+        input(i) = (T)(rand() ^ (rand() << 16));
+    }
+
+    Param<T> p;
+    Var x;
+    Func f;
+    f(x) = Tuple(input(x) / p, input(x) % p);
+    if (vector_width > 1) {
+        f.vectorize(x, vector_width);
+    }
+    f.add_custom_lowering_pass(new CheckNoDivisionInLoops);
+
+    T divisors[] = {1, 2, 3, 7, 10, 100, 127, (T)-1, (T)-3, (T)-100,
+                    std::numeric_limits<T>::max(),
+                    std::numeric_limits<T>::min(),
+                    (T)(std::numeric_limits<T>::max() / 2 + 2)};
+    for (T d : divisors) {
+        if (d == 0) {
+            continue;
+        }
+        p.set(d);
+        Realization r = f.realize(input.width());
+        Buffer<T> q = r[0], m = r[1];
+        for (int i = 0; i < input.width(); i++) {
+            T correct_q = euclidean_div<T>(input(i), d);
+            T correct_m = (T)(input(i) - correct_q * d);
+            if (q(i) != correct_q || m(i) != correct_m) {
+                printf("%lld / %lld = %lld, %lld %% %lld = %lld instead of %lld and %lld\n",
+                       (long long)input(i), (long long)d, (long long)q(i),
+                       (long long)input(i), (long long)d, (long long)m(i),
+                       (long long)correct_q, (long long)correct_m);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (int vector_width : {1, 8}) {
+        if (!test<uint8_t>(vector_width) ||
+            !test<uint16_t>(vector_width) ||
+            !test<uint32_t>(vector_width) ||
+            !test<int8_t>(vector_width) ||
+            !test<int16_t>(vector_width) ||
+            !test<int32_t>(vector_width)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
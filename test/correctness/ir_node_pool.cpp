@@ -0,0 +1,47 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Built during static initialization, before anything else in this
+// file has run.
+Expr global_expr = Expr(3) + Expr(4);
+
+int main(int argc, char **argv) {
+    if (!is_const(simplify(global_expr), 7)) {
+        printf("global_expr simplified to something other than 7\n");
+        return -1;
+    }
+
+    // Build and free IR on many short-lived threads, with some of the
+    // nodes outliving the thread that made them.
+    Var x;
+    std::vector<Expr> survivors;
+    for (int i = 0; i < 20; i++) {
+        Expr made;
+        std::thread t([&]() {
+            Expr e = x;
+            for (int j = 0; j < 100; j++) {
+                e = e + j;
+            }
+            made = e;
+        });
+        t.join();
+        survivors.push_back(made);
+    }
+
+    Func f;
+    f(x) = survivors.back() - survivors.front();
+    Buffer<int> out = f.realize(4);
+    for (int i = 0; i < 4; i++) {
+        if (out(i) != 0) {
+            printf("out(%d) = %d instead of 0\n", i, out(i));
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
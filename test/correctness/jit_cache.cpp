@@ -0,0 +1,55 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Every call makes fresh Funcs and Vars, so they all get different
+// unique names.
+Func make_pipeline(int k) {
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y * k;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root();
+    return g;
+}
+
+int main(int argc, char **argv) {
+    Func a = make_pipeline(3);
+    Func b = make_pipeline(3);
+    Func c = make_pipeline(4);
+
+    void *fa = Pipeline(a).compile_jit();
+    void *fb = Pipeline(b).compile_jit();
+    void *fc = Pipeline(c).compile_jit();
+
+    if (fa != fb) {
+        printf("Identical pipelines were compiled separately\n");
+        return -1;
+    }
+
+    if (fa == fc) {
+        printf("Different pipelines shared a compiled module\n");
+        return -1;
+    }
+
+    Buffer<int> out_b = b.realize(16, 16);
+    Buffer<int> out_c = c.realize(16, 16);
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++) {
+            int correct_b = (x + y * 3) + (x + 1 + y * 3);
+            int correct_c = (x + y * 4) + (x + 1 + y * 4);
+            if (out_b(x, y) != correct_b) {
+                printf("out_b(%d, %d) = %d instead of %d\n", x, y, out_b(x, y), correct_b);
+                return -1;
+            }
+            if (out_c(x, y) != correct_c) {
+                printf("out_c(%d, %d) = %d instead of %d\n", x, y, out_c(x, y), correct_c);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
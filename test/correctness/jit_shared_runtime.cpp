@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+// Check that jit-compiled pipelines share one runtime, and that
+// JITSharedRuntime::release_unused keeps it while it is in use.
+
+const Internal::JITModuleContents *main_runtime(const Target &t) {
+    std::vector<Internal::JITModule> runtimes = Internal::JITSharedRuntime::get(nullptr, t, false);
+    return runtimes.empty() ? nullptr : runtimes[0].jit_module.get();
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment().with_feature(Target::JIT);
+
+    Internal::JITSharedRuntime::release_all();
+    if (main_runtime(t) != nullptr) {
+        printf("There should be no shared runtime after release_all\n");
+        return -1;
+    }
+
+    Var x;
+    Func f, g;
+    f(x) = x * 2;
+    g(x) = x + 3;
+
+    Buffer<int> f_out = f.realize(16);
+    const Internal::JITModuleContents *runtime = main_runtime(t);
+    if (runtime == nullptr) {
+        printf("Compiling a pipeline should have made a shared runtime\n");
+        return -1;
+    }
+
+    Buffer<int> g_out = g.realize(16);
+    if (main_runtime(t) != runtime) {
+        printf("Both pipelines should use the same shared runtime\n");
+        return -1;
+    }
+
+    // f and g still use the runtime, so it must not be released.
+    Internal::JITSharedRuntime::release_unused();
+    if (main_runtime(t) != runtime) {
+        printf("release_unused released a runtime that is still in use\n");
+        return -1;
+    }
+
+    f_out = f.realize(16);
+    g_out = g.realize(16);
+    for (int i = 0; i < 16; i++) {
+        if (f_out(i) != i * 2 || g_out(i) != i + 3) {
+            printf("f_out(%d) = %d, g_out(%d) = %d\n", i, f_out(i), i, g_out(i));
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
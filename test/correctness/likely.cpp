@@ -125,6 +125,17 @@ int main(int argc, char **argv) {
         count_partitions(h, 5);
     }
 
+    // The same goes for constant_exterior, which tests each dimension
+    // separately so that the loop over y can be partitioned too.
+    {
+        Var y;
+        Func g;
+        g(x, y) = x + y;
+        g.compute_root();
+        Func h = BoundaryConditions::constant_exterior(g, 0, 0, 10, 0, 10);
+        count_partitions(h, 5);
+    }
+
     // If you split and also have a boundary condition, or have
     // multiple boundary conditions at play (e.g. because you're
     // blurring an inlined Func that uses a boundary condition), then
@@ -0,0 +1,129 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Run loop_carry at the end of lowering, and count the scratch
+// buffers it makes.
+int carried_allocations = 0;
+
+class CountAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Allocate *op) override {
+        carried_allocations++;
+        IRVisitor::visit(op);
+    }
+};
+
+class CarryValues : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        Stmt result = loop_carry(s);
+        CountAllocations counter;
+        result.accept(&counter);
+        return result;
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 128, H = 16;
+    Buffer<int> input(W + 2, H + 2);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = x * 17 + y * 3 + (x ^ y);
+        }
+    }
+
+    Var x, y;
+
+    {
+        // A horizontal stencil, vectorized across x. Each vector load
+        // overlaps the ones on the next iteration of the loop over
+        // vectors, so they should become a sliding window.
+        Func f;
+        f(x, y) = input(x, y) + input(x + 1, y) + input(x + 2, y);
+        f.bound(x, 0, W).vectorize(x, 8);
+        f.add_custom_lowering_pass(new CarryValues);
+
+        carried_allocations = 0;
+        Buffer<int> out = f.realize(W, H);
+
+        if (carried_allocations == 0) {
+            printf("The overlapping vector loads were not carried\n");
+            return -1;
+        }
+
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                int correct = input(i, j) + input(i + 1, j) + input(i + 2, j);
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A 3x3 stencil, vectorized across x, walking down y. The
+        // loads of each row are reused on the next two iterations.
+        Func f;
+        Expr e = 0;
+        for (int dy = 0; dy < 3; dy++) {
+            for (int dx = 0; dx < 3; dx++) {
+                e += input(x + dx, y + dy) * (dx + 3 * dy + 1);
+            }
+        }
+        f(x, y) = e;
+        Var xo, xi;
+        f.bound(x, 0, W).split(x, xo, xi, 8).reorder(xi, y, xo).vectorize(xi);
+        f.add_custom_lowering_pass(new CarryValues);
+
+        Buffer<int> out = f.realize(W, H);
+
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                int correct = 0;
+                for (int dy = 0; dy < 3; dy++) {
+                    for (int dx = 0; dx < 3; dx++) {
+                        correct += input(i + dx, j + dy) * (dx + 3 * dy + 1);
+                    }
+                }
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    if (target.has_gpu_feature()) {
+        // A vertical stencil with a serial loop over y in each GPU
+        // thread, which carries the rows in registers.
+        Func f;
+        f(x, y) = input(x, y) + input(x, y + 1) + input(x, y + 2);
+        Var xo, xi;
+        f.split(x, xo, xi, 32).reorder(y, xi, xo).gpu_blocks(xo).gpu_threads(xi);
+
+        Buffer<int> out = f.realize(W, H, target);
+        out.copy_to_host();
+
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                int correct = input(i, j) + input(i, j + 1) + input(i, j + 2);
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
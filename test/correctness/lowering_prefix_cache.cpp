@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Each call makes new Funcs, as a Generator does for each target of a
+// multitarget build, but with the same names.
+Pipeline make_pipeline(bool parallel) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+    ImageParam input(UInt(8), 2, "input");
+    f(x, y) = input(x, y) + input(x + 1, y);
+    g(x, y) = f(x, y) + f(x, y + 1);
+    f.compute_at(g, y);
+    g.vectorize(x, 16);
+    if (parallel) {
+        g.parallel(y);
+    }
+    return Pipeline(g);
+}
+
+int main(int argc, char **argv) {
+    auto cache = std::make_shared<LoweringPrefixCache>();
+
+    const char *targets[] = {"x86-64-linux-sse41", "x86-64-linux-avx2", "x86-64-linux-avx512_skylake"};
+    for (const char *t : targets) {
+        Pipeline p = make_pipeline(false);
+        p.set_lowering_prefix_cache(cache);
+        p.compile_to_module(p.infer_arguments(), "g", Target(t));
+    }
+
+    // Only the instruction sets differ, so only the first target
+    // should have lowered the pipeline from scratch.
+    if (cache->hits() != 2) {
+        printf("Expected 2 hits in the lowering prefix cache, got %d\n", cache->hits());
+        return -1;
+    }
+
+    // A different OS must not share the prefix, nor may a different
+    // schedule.
+    {
+        Pipeline p = make_pipeline(false);
+        p.set_lowering_prefix_cache(cache);
+        p.compile_to_module(p.infer_arguments(), "g", Target("x86-64-windows-sse41"));
+    }
+    {
+        Pipeline p = make_pipeline(true);
+        p.set_lowering_prefix_cache(cache);
+        p.compile_to_module(p.infer_arguments(), "g", Target("x86-64-linux-sse41"));
+    }
+    if (cache->hits() != 2) {
+        printf("Expected no more hits in the lowering prefix cache, got %d\n", cache->hits() - 2);
+        return -1;
+    }
+
+    // Another target with the parallel schedule reuses the entry made
+    // for it above.
+    {
+        Pipeline p = make_pipeline(true);
+        p.set_lowering_prefix_cache(cache);
+        p.compile_to_module(p.infer_arguments(), "g", Target("x86-64-linux-avx2"));
+    }
+    if (cache->hits() != 3) {
+        printf("Expected a hit for the parallel schedule, got %d\n", cache->hits() - 2);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
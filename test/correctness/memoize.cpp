@@ -455,6 +455,62 @@ int main(int argc, char **argv) {
         Internal::JITSharedRuntime::memoization_cache_set_size(0);
     }
 
+    {
+        // Test many distinct keys in parallel with a single shard
+        // starting from a tiny table, so that the table has to grow
+        // while in use, and then again with many shards.
+        for (int shards : {1, 64}) {
+            Internal::JITSharedRuntime::memoization_cache_set_shards(shards, 1);
+            Internal::JITSharedRuntime::memoization_cache_set_size(100000000);
+
+            Param<float> val;
+
+            Func count_calls;
+            count_calls.define_extern("count_calls_with_arg_parallel", {cast<uint8_t>(val)}, UInt(8), 3);
+
+            Func f;
+            Var x, y;
+            // One cache key per scanline.
+            f(x, y) = count_calls(x, y % 4, memoize_tag(y / 16, y)) + cast<uint8_t>(x);
+            count_calls.compute_at(f, y).memoize();
+
+            Func g;
+            g(x, y) = f(x, y) + f(x - 1, y) + f(x + 1, y);
+            f.compute_at(g, y);
+            g.parallel(y, 16);
+
+            for (int i = 0; i < 8; i++) {
+                call_count_with_arg_parallel[i] = 0;
+            }
+
+            for (int v = 0; v < 2; v++) {
+                val.set(23.0f);
+                Buffer<uint8_t> out = g.realize(128, 128);
+
+                for (int32_t i = 0; i < 128; i++) {
+                    for (int32_t j = 0; j < 128; j++) {
+                        assert(out(i, j) == (uint8_t)(3 * 23 + i + (i - 1) + (i + 1)));
+                    }
+                }
+            }
+
+            // The second realization should be served entirely from
+            // the cache.
+            int total_calls = 0;
+            for (int i = 0; i < 8; i++) {
+                total_calls += call_count_with_arg_parallel[i];
+            }
+            if (total_calls != 128) {
+                printf("Call count with %d shards is %d instead of 128\n", shards, total_calls);
+                return -1;
+            }
+
+            // Return cache size and shards to default.
+            Internal::JITSharedRuntime::memoization_cache_set_size(0);
+            Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+        }
+    }
+
     {
         // Test parallel cache access
         Param<float> val;
@@ -613,6 +669,179 @@ int main(int argc, char **argv) {
 
     }
 
+    {
+        // Test a per-Func budget, and the cache statistics. Use a
+        // single shard, so that the budget is enforced exactly.
+        Param<float> val;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(val)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y);
+        // Each result is 32 * 32 bytes, so the budget holds two of them.
+        count_calls.compute_root().memoize(2 * 32 * 32);
+
+        Internal::JITSharedRuntime::memoization_cache_set_shards(1, 0);
+        Internal::JITSharedRuntime::memoization_cache_set_size(1000000);
+        halide_memoization_cache_stats_t before = Internal::JITSharedRuntime::memoization_cache_get_stats();
+
+        for (int v = 0; v < 4; v++) {
+            val.set((float)v);
+            Buffer<uint8_t> out = f.realize(32, 32);
+            assert(out(0, 0) == v && out(31, 31) == v);
+        }
+        assert(call_count_with_arg == 4);
+
+        // Only the two most recent results are still cached.
+        val.set(3.0f);
+        f.realize(32, 32);
+        val.set(2.0f);
+        f.realize(32, 32);
+        assert(call_count_with_arg == 4);
+        val.set(0.0f);
+        f.realize(32, 32);
+        assert(call_count_with_arg == 5);
+
+        halide_memoization_cache_stats_t after = Internal::JITSharedRuntime::memoization_cache_get_stats();
+        assert(after.hits - before.hits == 2);
+        assert(after.misses - before.misses == 5);
+        assert(after.evictions - before.evictions == 3);
+        assert(after.entries == 2);
+        assert(after.current_size == 2 * 32 * 32);
+
+        // Return the cache to its defaults.
+        Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
+    {
+        // A result bigger than its shard's share of the cache must
+        // stay cached while the cache as a whole has room for it.
+        Param<float> val;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(val)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y);
+        count_calls.compute_root().memoize();
+
+        // Flush the cache and use the default shards and size.
+        Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+        // 128KB, more than a sixteenth of the default 1MB cache.
+        val.set(0.0f);
+        Buffer<uint8_t> big = f.realize(512, 256);
+        assert(call_count_with_arg == 1);
+
+        // Enough small results that some land in the same shard.
+        for (int v = 1; v <= 64; v++) {
+            val.set((float)v);
+            Buffer<uint8_t> out = f.realize(32, 32);
+            assert(out(0, 0) == v);
+        }
+        assert(call_count_with_arg == 65);
+
+        val.set(0.0f);
+        big = f.realize(512, 256);
+        assert(big(0, 0) == 0 && big(511, 255) == 0);
+        assert(call_count_with_arg == 65);
+
+        Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+    }
+
+    {
+        // The size limit holds for the cache as a whole, and the
+        // entries evicted to meet it are the oldest ones whichever
+        // shard they are in.
+        Param<float> val;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(val)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y);
+        count_calls.compute_root().memoize();
+
+        Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+        // Room for 64 results of 1KB each.
+        const int64_t limit = 64 * 1024;
+        Internal::JITSharedRuntime::memoization_cache_set_size(limit);
+
+        for (int v = 1; v <= 200; v++) {
+            val.set((float)v);
+            Buffer<uint8_t> out = f.realize(32, 32);
+            assert(out(0, 0) == v);
+        }
+        assert(call_count_with_arg == 200);
+
+        halide_memoization_cache_stats_t stats = Internal::JITSharedRuntime::memoization_cache_get_stats();
+        if (stats.current_size > limit) {
+            printf("Memoization cache holds %d bytes, more than its limit of %d\n",
+                   (int)stats.current_size, (int)limit);
+            return -1;
+        }
+
+        // The most recent results are all still there.
+        for (int v = 200; v > 168; v--) {
+            val.set((float)v);
+            Buffer<uint8_t> out = f.realize(32, 32);
+            assert(out(0, 0) == v);
+        }
+        if (call_count_with_arg != 200) {
+            printf("%d of the most recent results were evicted\n", call_count_with_arg - 200);
+            return -1;
+        }
+
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+        Internal::JITSharedRuntime::memoization_cache_set_shards(0, 0);
+    }
+
+    if (get_jit_target_from_environment().has_gpu_feature()) {
+        // Test memoizing a Func computed on the GPU. Its result stays
+        // in device memory in the cache, and hits are used there.
+        Param<int> val;
+
+        Func f, g;
+        Var x, y, xi, yi;
+        f(x, y) = x + y * 32 + val;
+        g(x, y) = f(x, y) * 2;
+        f.compute_root().memoize().gpu_tile(x, y, xi, yi, 8, 8);
+        g.gpu_tile(x, y, xi, yi, 8, 8);
+
+        halide_memoization_cache_stats_t before = Internal::JITSharedRuntime::memoization_cache_get_stats();
+
+        for (int i = 0; i < 2; i++) {
+            for (int v = 0; v < 2; v++) {
+                val.set(v);
+                Buffer<int> out = g.realize(32, 32);
+                out.copy_to_host();
+                for (int yy = 0; yy < 32; yy++) {
+                    for (int xx = 0; xx < 32; xx++) {
+                        if (out(xx, yy) != (xx + yy * 32 + v) * 2) {
+                            fprintf(stderr, "out(%d, %d) = %d instead of %d\n",
+                                    xx, yy, out(xx, yy), (xx + yy * 32 + v) * 2);
+                            return -1;
+                        }
+                    }
+                }
+            }
+        }
+
+        halide_memoization_cache_stats_t after = Internal::JITSharedRuntime::memoization_cache_get_stats();
+        assert(after.hits - before.hits == 2);
+        assert(after.misses - before.misses == 2);
+        assert(after.current_device_size >= 2 * 32 * 32 * (int64_t)sizeof(int));
+    }
+
     fprintf(stderr, "Success!\n");
     return 0;
 }
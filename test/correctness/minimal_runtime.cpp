@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+bool has_entry_point(const RuntimeFootprint &footprint, const std::string &name) {
+    return std::find(footprint.entry_points.begin(), footprint.entry_points.end(), name) !=
+        footprint.entry_points.end();
+}
+
+int main(int argc, char **argv) {
+    Target t = get_host_target().with_feature(Target::NoRuntime);
+
+    ImageParam in(Float(32), 2);
+    Var x, y;
+
+    Func serial("serial");
+    serial(x, y) = in(x, y) * 2;
+
+    Func parallel("parallel");
+    parallel(x, y) = in(x, y) + 1;
+    parallel.parallel(y);
+
+    std::vector<Module> modules = {serial.compile_to_module({in}, "serial", t),
+                                   parallel.compile_to_module({in}, "parallel", t)};
+
+    std::string result_file = Internal::get_test_tmp_dir() + "minimal_runtime.o";
+    Internal::ensure_no_file_exists(result_file);
+
+    RuntimeFootprint footprint;
+    compile_minimal_runtime(Outputs().object(result_file), t, modules,
+                            {"halide_set_error_handler"}, &footprint);
+
+    Internal::assert_file_exists(result_file);
+
+    if (footprint.functions <= 0 || footprint.functions >= footprint.full_functions ||
+        footprint.instructions >= footprint.full_instructions) {
+        printf("Runtime was not stripped: %d of %d functions, %d of %d instructions\n",
+               footprint.functions, footprint.full_functions,
+               footprint.instructions, footprint.full_instructions);
+        return -1;
+    }
+
+    // The parallel pipeline needs the thread pool, and the application
+    // asked for the error handler hook.
+    for (const char *name : {"halide_do_par_for", "halide_set_error_handler"}) {
+        if (!has_entry_point(footprint, name)) {
+            printf("Missing entry point %s\n", name);
+            return -1;
+        }
+    }
+
+    // Nothing uses tracing or the memoization cache.
+    for (const char *name : {"halide_trace", "halide_memoization_cache_lookup"}) {
+        if (has_entry_point(footprint, name)) {
+            printf("Unexpected entry point %s\n", name);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Track the number of heap allocations, and the most bytes that are
+// allocated at once.
+int mallocs = 0;
+size_t live_bytes = 0, peak_bytes = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    live_bytes += x;
+    peak_bytes = std::max(peak_bytes, live_bytes);
+    void *orig = malloc(x + 64);
+    void *ptr = (void *)((((size_t)orig + 64) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = x;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    live_bytes -= ((size_t *)ptr)[-2];
+    free(((void **)ptr)[-1]);
+}
+
+int run(Target target, Buffer<int> &input, Buffer<int> &out) {
+    Var x, y;
+
+    // A chain of root stages, each one bigger than the next, feeding
+    // one side of a diamond.
+    Func f[4];
+    f[0](x, y) = input(x, y) + 1;
+    for (int i = 1; i < 4; i++) {
+        f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y + 1) * i;
+    }
+    Func g("g"), h("h"), result("result");
+    g(x, y) = input(x, y) * 2;
+    h(x, y) = g(x, y) - 3;
+    result(x, y) = f[3](x, y) + h(x, y);
+
+    for (int i = 0; i < 4; i++) {
+        f[i].compute_root();
+    }
+    g.compute_root();
+    h.compute_root();
+
+    result.set_custom_allocator(my_malloc, my_free);
+
+    mallocs = 0;
+    live_bytes = peak_bytes = 0;
+    result.realize(out, target);
+
+    if (live_bytes != 0) {
+        printf("%d bytes were not freed\n", (int)live_bytes);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int W = 200, H = 100;
+    Buffer<int> input(W + 3, H + 3);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = x * 3 + y * 5 + (x ^ y);
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+
+    Buffer<int> correct(W, H), out(W, H);
+    if (run(target, input, correct)) {
+        return -1;
+    }
+    int separate_mallocs = mallocs;
+    size_t separate_peak = peak_bytes;
+
+    if (run(target.with_feature(Target::MinimizeMemory), input, out)) {
+        return -1;
+    }
+
+    // The stages whose lifetimes don't overlap share memory.
+    if (mallocs >= separate_mallocs) {
+        printf("%d heap allocations instead of fewer than %d\n", mallocs, separate_mallocs);
+        return -1;
+    }
+
+    if (peak_bytes > separate_peak) {
+        printf("Peak memory use went up from %d to %d bytes\n",
+               (int)separate_peak, (int)peak_bytes);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (out(x, y) != correct(x, y)) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
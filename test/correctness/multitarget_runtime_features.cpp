@@ -0,0 +1,40 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // The shared runtime of a multitarget library gets the features
+    // common to all the targets, including those past the first 64.
+    static_assert(Target::AVX512_256 >= 64, "This test needs a feature in the second word");
+
+    std::vector<Target> targets = {
+        Target("x86-64-linux-sse41-avx-avx2-avx512_256"),
+        Target("x86-64-linux-sse41-avx512_256"),
+    };
+    Target runtime = Internal::get_multitarget_runtime_target(targets);
+    if (!runtime.has_feature(Target::AVX512_256) ||
+        !runtime.has_feature(Target::SSE41)) {
+        printf("Runtime target %s is missing a common feature\n", runtime.to_string().c_str());
+        return -1;
+    }
+    if (runtime.has_feature(Target::AVX) || runtime.has_feature(Target::AVX2)) {
+        printf("Runtime target %s has a feature not common to all targets\n", runtime.to_string().c_str());
+        return -1;
+    }
+
+    // A feature in the second word used by only some of the targets
+    // is left out.
+    targets = {
+        Target("x86-64-linux-sse41-avx512_256"),
+        Target("x86-64-linux-sse41"),
+    };
+    runtime = Internal::get_multitarget_runtime_target(targets);
+    if (runtime.has_feature(Target::AVX512_256)) {
+        printf("Runtime target %s has a feature not common to all targets\n", runtime.to_string().c_str());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the vector arithmetic done in 32-bit integers at the end of
+// lowering.
+int wide_vector_ops = 0;
+
+class CountWideVectorOps : public IRVisitor {
+    using IRVisitor::visit;
+
+    void count(const Expr &e) {
+        if (e.type().is_vector() && e.type().bits() == 32 &&
+            (e.type().is_int() || e.type().is_uint())) {
+            wide_vector_ops++;
+        }
+    }
+
+    void visit(const Add *op) override {
+        count(op);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Sub *op) override {
+        count(op);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Mul *op) override {
+        count(op);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Div *op) override {
+        count(op);
+        IRVisitor::visit(op);
+    }
+};
+
+class CheckForWideVectorOps : public IRMutator2 {
+public:
+    using IRMutator2::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountWideVectorOps counter;
+        s.accept(&counter);
+        return s;
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 256;
+    Buffer<uint8_t> a(W), b(W);
+    for (int i = 0; i < W; i++) {
+        a(i) = (uint8_t)(i * 37 + 11);
+        b(i) = (uint8_t)(i * 101 + 3);
+    }
+
+    Var x;
+
+    {
+        // A weighted average, which fits in 16 unsigned bits.
+        Func f;
+        f(x) = cast<uint8_t>((cast<int>(a(x)) + cast<int>(b(x)) * 3 + 2) / 4);
+        f.vectorize(x, 16);
+        f.add_custom_lowering_pass(new CheckForWideVectorOps);
+
+        wide_vector_ops = 0;
+        Buffer<uint8_t> out = f.realize(W);
+
+        if (wide_vector_ops != 0) {
+            printf("The weighted average was computed with %d 32-bit vector ops\n", wide_vector_ops);
+            return -1;
+        }
+
+        for (int i = 0; i < W; i++) {
+            uint8_t correct = (uint8_t)((a(i) + b(i) * 3 + 2) / 4);
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A clamped difference, which needs a sign bit.
+        Func f;
+        f(x) = cast<uint8_t>(clamp(cast<int>(a(x)) - cast<int>(b(x)) / 2 + 64, 0, 255));
+        f.vectorize(x, 16);
+        f.add_custom_lowering_pass(new CheckForWideVectorOps);
+
+        wide_vector_ops = 0;
+        Buffer<uint8_t> out = f.realize(W);
+
+        if (wide_vector_ops != 0) {
+            printf("The clamped difference was computed with %d 32-bit vector ops\n", wide_vector_ops);
+            return -1;
+        }
+
+        for (int i = 0; i < W; i++) {
+            int c = a(i) - b(i) / 2 + 64;
+            uint8_t correct = (uint8_t)std::min(std::max(c, 0), 255);
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // A sum of products that doesn't fit in 16 bits, so it must
+        // stay wide.
+        Func f;
+        f(x) = cast<uint8_t>((cast<int>(a(x)) * cast<int>(b(x)) * 3) >> 10);
+        f.vectorize(x, 16);
+
+        Buffer<uint8_t> out = f.realize(W);
+
+        for (int i = 0; i < W; i++) {
+            uint8_t correct = (uint8_t)((a(i) * b(i) * 3) >> 10);
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
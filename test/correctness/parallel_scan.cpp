@@ -0,0 +1,53 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func in;
+    Var x, y;
+    in(x, y) = (x * 7 + y * 13) % 23 - 11;
+
+    // A running sum of each row, with a row length that isn't a
+    // multiple of the block size.
+    {
+        const int W = 5000, H = 4;
+        RDom r(3, W);
+        Func running = prefix_sum(r, in(r, y));
+        Buffer<int> out(W, H);
+        out.set_min(3, 0);
+        running.realize(out);
+
+        for (int yy = 0; yy < H; yy++) {
+            int correct = 0;
+            for (int xx = 3; xx < 3 + W; xx++) {
+                correct += (xx * 7 + yy * 13) % 23 - 11;
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // A running maximum, using a general associative operator.
+    {
+        const int W = 3000;
+        RDom r(0, W);
+        Func running = scan(r, in(r, 0), [](Expr a, Expr b) { return max(a, b); });
+        Buffer<int> out = running.realize(W);
+
+        int correct = -100;
+        for (int xx = 0; xx < W; xx++) {
+            correct = std::max(correct, (xx * 7) % 23 - 11);
+            if (out(xx) != correct) {
+                printf("out(%d) = %d instead of %d\n", xx, out(xx), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Evaluate a bound for a 100x50 output starting at the origin.
+int64_t evaluate(Expr e, const std::string &output) {
+    std::map<std::string, Expr> values;
+    values[output + ".min.0"] = 0;
+    values[output + ".min.1"] = 0;
+    values[output + ".extent.0"] = 100;
+    values[output + ".extent.1"] = 50;
+    e = simplify(substitute(values, e));
+    const int64_t *result = as_const_int(e);
+    if (!result) {
+        std::cout << "Bound is not a constant: " << e << "\n";
+        return -1;
+    }
+    return *result;
+}
+
+PeakMemoryUsage usage_of(Func g) {
+    Module m = g.compile_to_module({}, "g");
+    return compute_peak_memory_usage(m.functions()[0].body);
+}
+
+int main(int argc, char **argv) {
+    Var x, y, xo, xi;
+
+    {
+        // A root intermediate one column wider than the output
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        f.compute_root();
+
+        PeakMemoryUsage usage = usage_of(g);
+        if (!usage.heap_bytes.defined()) {
+            printf("Failed to bound the heap usage\n");
+            return -1;
+        }
+        int64_t heap = evaluate(usage.heap_bytes, "g");
+        if (heap != 4 * 101 * 50) {
+            printf("Heap usage was %lld instead of %d\n", (long long)heap, 4 * 101 * 50);
+            return -1;
+        }
+    }
+
+    {
+        // One row per iteration of a parallel loop. All the rows may
+        // be live at once.
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        f.compute_at(g, y);
+        g.parallel(y);
+
+        PeakMemoryUsage usage = usage_of(g);
+        if (!usage.heap_bytes.defined()) {
+            printf("Failed to bound the heap usage\n");
+            return -1;
+        }
+        int64_t heap = evaluate(usage.heap_bytes, "g");
+        if (heap != 4 * 101 * 50) {
+            printf("Heap usage was %lld instead of %d\n", (long long)heap, 4 * 101 * 50);
+            return -1;
+        }
+    }
+
+    {
+        // A small constant-sized tile goes on the stack.
+        Func f, g;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        g.split(x, xo, xi, 8);
+        f.compute_at(g, xo);
+
+        PeakMemoryUsage usage = usage_of(g);
+        if (!usage.heap_bytes.defined()) {
+            printf("Failed to bound the memory usage\n");
+            return -1;
+        }
+        int64_t heap = evaluate(usage.heap_bytes, "g");
+        int64_t stack = evaluate(usage.stack_bytes, "g");
+        if (heap != 0 || stack < 4 * 9) {
+            printf("Heap and stack usage were %lld and %lld instead of 0 and at least %d\n",
+                   (long long)heap, (long long)stack, 4 * 9);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -402,6 +402,63 @@ int vectorized_predicated_load_lut_test(const Target &t) {
     return 0;
 }
 
+int vectorized_predicate_tail_test(const Target &t) {
+    int size = 73;
+    Var x("x"), y("y"), xo("xo"), xi("xi");
+    Func f ("f"), g("g"), ref("ref");
+
+    g(x, y) = x * y;
+    g.compute_root();
+
+    ref(x, y) = g(x, y) * 2 + 1;
+    Buffer<int> im_ref = ref.realize(size, size);
+
+    // There is no epilogue. The whole loop, including the last
+    // partial vector, uses predicated loads and stores.
+    f(x, y) = g(x, y) * 2 + 1;
+    f.split(x, xo, xi, 8, TailStrategy::Predicate).vectorize(xi);
+    if (t.arch == Target::X86) {
+        f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(1, 1));
+    }
+
+    Buffer<int> im = f.realize(size, size);
+    auto func = [im_ref](int x, int y) { return im_ref(x, y); };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
+int vectorized_guard_with_if_tail_test(const Target &t) {
+    if (!t.has_feature(Target::ARMSVE)) {
+        // Other targets may scalarize the tail instead.
+        return 0;
+    }
+
+    int size = 73;
+    Var x("x"), y("y"), xo("xo"), xi("xi");
+    Func f ("f"), g("g"), ref("ref");
+
+    g(x, y) = x * y;
+    g.compute_root();
+
+    ref(x, y) = g(x, y) * 2 + 1;
+    Buffer<int> im_ref = ref.realize(size, size);
+
+    // The tail of the vectorized loop uses predicated loads and
+    // stores, rather than being scalarized.
+    f(x, y) = g(x, y) * 2 + 1;
+    f.split(x, xo, xi, 16, TailStrategy::GuardWithIf).vectorize(xi);
+    f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(1, 1));
+
+    Buffer<int> im = f.realize(size, size);
+    auto func = [im_ref](int x, int y) { return im_ref(x, y); };
+    if (check_image(im, func)) {
+        return -1;
+    }
+    return 0;
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -457,6 +514,16 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running vectorized predicate tail test\n");
+    if (vectorized_predicate_tail_test(t) != 0) {
+        return -1;
+    }
+
+    printf("Running vectorized guard with if tail test\n");
+    if (vectorized_guard_with_if_tail_test(t) != 0) {
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
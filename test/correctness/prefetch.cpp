@@ -79,7 +79,7 @@ int test1(const Target &t) {
     CollectPrefetches collect;
     m.functions()[0].body.accept(&collect);
 
-    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 1, get_stride(t, 4)}};
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 3, 1, get_stride(t, 4)}};
     if (!check(expected, collect.prefetches)) {
         return -1;
     }
@@ -103,7 +103,7 @@ int test2(const Target &t) {
     CollectPrefetches collect;
     m.functions()[0].body.accept(&collect);
 
-    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 1, get_stride(t, 4)}};
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 3, 1, get_stride(t, 4)}};
     if (!check(expected, collect.prefetches)) {
         return -1;
     }
@@ -127,7 +127,7 @@ int test3(const Target &t) {
     CollectPrefetches collect;
     m.functions()[0].body.accept(&collect);
 
-    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 1, get_stride(t, 4)}};
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 3, 1, get_stride(t, 4)}};
     if (!check(expected, collect.prefetches)) {
         return -1;
     }
@@ -159,6 +159,108 @@ int test4(const Target &t) {
     return 0;
 }
 
+int test5(const Target &t) {
+    Func f("f"), g("g");
+    Var x("x");
+
+    f(x) = x;
+    g(x) = f(0);
+
+    f.compute_root();
+    g.prefetch(f, x, 8, PrefetchBoundStrategy::GuardWithIf, PrefetchHint::NonTemporal);
+
+    Module m = g.compile_to_module({});
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+
+    // The hint becomes the locality argument.
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), f.name()) , 0, 0, 1, get_stride(t, 4)}};
+    if (!check(expected, collect.prefetches)) {
+        return -1;
+    }
+    return 0;
+}
+
+class FindLoad : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        if (op->name == name) {
+            found = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::string name;
+    bool found = false;
+    FindLoad(const std::string &n) : name(n) {}
+};
+
+int test6(const Target &t) {
+    Buffer<int> idx(1000);
+    for (int i = 0; i < idx.width(); i++) {
+        idx(i) = (i * 7919) % 1000;
+    }
+
+    Func f("f"), g("g");
+    Var x("x");
+
+    f(x) = x * 2;
+    g(x) = f(idx(x));
+
+    f.compute_root();
+    g.prefetch(f, x, 16);
+
+    // The prefetch of a data-dependent access should load the index
+    // of a later iteration, rather than prefetch all of f.
+    Module m = g.compile_to_module({});
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+    if (collect.prefetches.size() != 1) {
+        std::cout << "Expect 1 prefetch instead of " << collect.prefetches.size() << "\n";
+        return -1;
+    }
+    FindLoad find(idx.name());
+    collect.prefetches[0][1].accept(&find);
+    if (!find.found) {
+        std::cout << "Expected the prefetch offset to load from " << idx.name()
+                  << ", got " << collect.prefetches[0][1] << " instead\n";
+        return -1;
+    }
+
+    // Loading the indices ahead must stay within the loop.
+    Buffer<int> out = g.realize(idx.width());
+    for (int i = 0; i < out.width(); i++) {
+        if (out(i) != idx(i) * 2) {
+            printf("g(%d) = %d instead of %d\n", i, out(i), idx(i) * 2);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int test7(const Target &t) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+
+    // Let the prefetch distance be chosen from the cost of the loop body.
+    f.compute_root();
+    g.prefetch(f, y, Expr());
+
+    Module m = g.compile_to_module({});
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+    if (collect.prefetches.empty()) {
+        std::cout << "Expected a prefetch with an automatic distance\n";
+        return -1;
+    }
+    return 0;
+}
+
 }  // anonymous namespace
 
 int main(int argc, char **argv) {
@@ -180,6 +282,18 @@ int main(int argc, char **argv) {
     if (test4(t) != 0) {
         return -1;
     }
+    printf("Running prefetch test5\n");
+    if (test5(t) != 0) {
+        return -1;
+    }
+    printf("Running prefetch test6\n");
+    if (test6(t) != 0) {
+        return -1;
+    }
+    printf("Running prefetch test7\n");
+    if (test7(t) != 0) {
+        return -1;
+    }
 
     printf("Success!\n");
     return 0;
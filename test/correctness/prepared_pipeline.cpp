@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    Param<float> scale;
+    ImageParam input(Int(32), 1);
+    Var x;
+    Func f, g;
+    f(x) = cast<int>(input(x) * scale) + offset;
+    g(x) = {f(x), f(x) * 2};
+
+    Buffer<int> in1(16), in2(16);
+    for (int i = 0; i < 16; i++) {
+        in1(i) = i;
+        in2(i) = 100 - i;
+    }
+
+    // The prepared pipeline starts out with the values bound to the
+    // Params when it is made.
+    offset.set(3);
+    scale.set(1.0f);
+    input.set(in1);
+
+    Pipeline p(f);
+    PreparedPipeline prepared = p.prepare();
+
+    Buffer<int> out(16);
+    prepared.realize(out);
+    for (int i = 0; i < 16; i++) {
+        if (out(i) != i + 3) {
+            printf("out(%d) = %d instead of %d\n", i, out(i), i + 3);
+            return -1;
+        }
+    }
+
+    // Setting the Params afterwards doesn't affect it...
+    offset.set(1000);
+    // ...but setting its own arguments does, and they stay set
+    // across calls.
+    prepared.set(scale, 2.0f).set(input, in2);
+    for (int iter = 0; iter < 3; iter++) {
+        prepared.set(offset, iter);
+        prepared.realize(out);
+        for (int i = 0; i < 16; i++) {
+            int correct = (100 - i) * 2 + iter;
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Pipelines with more than one output.
+    offset.set(5);
+    PreparedPipeline prepared_tuple = Pipeline(g).prepare();
+    prepared_tuple.set(scale, 1.0f).set(input, in1);
+    Buffer<int> out0(16), out1(16);
+    prepared_tuple.realize({out0, out1});
+    for (int i = 0; i < 16; i++) {
+        if (out0(i) != i + 5 || out1(i) != (i + 5) * 2) {
+            printf("out0(%d) = %d, out1(%d) = %d instead of %d, %d\n",
+                   i, out0(i), i, out1(i), i + 5, (i + 5) * 2);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
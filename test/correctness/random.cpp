@@ -174,6 +174,28 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Check the narrow and wide unsigned variants have the right type
+    // and about half their bits set.
+    for (int bits : {8, 16, 64}) {
+        Expr r = random_uint(bits);
+        if (r.type() != UInt(bits)) {
+            printf("random_uint(%d) has the wrong type\n", bits);
+            return -1;
+        }
+
+        Func f;
+        f(x, y) = r;
+
+        const int S = 512;
+        RDom d(0, S, 0, S);
+        int set_bits = evaluate<int>(sum(cast<int>(popcount(f(d.x, d.y)))));
+        int correct = S * S * bits / 2;
+        if (fabs(double(set_bits) / correct - 1) > tol) {
+            printf("random_uint(%d) set bits was %d instead of %d\n", bits, set_bits, correct);
+            return -1;
+        }
+    }
+
     printf("Success!\n");
 
     return 0;
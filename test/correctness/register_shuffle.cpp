@@ -6,7 +6,8 @@ int main(int argc, char **argv) {
     Target t = get_jit_target_from_environment();
 
     if (!t.features_any_of({Target::CUDACapability50,
-                            Target::CUDACapability61})) {
+                            Target::CUDACapability61,
+                            Target::CUDACapability70})) {
         printf("This test requires cuda enabled with cuda capability 5.0 or greater\n");
         return 0;
     }
@@ -377,6 +378,46 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        // Sum each row of an image. The partial sums are striped
+        // across the lanes of a warp, and the final reduction over
+        // the lanes becomes a butterfly tree of shuffles.
+        Buffer<int> in(256, 64);
+        in.for_each_value([](int &x) {
+                x = rand() % 1000;
+            });
+        in.set_host_dirty();
+
+        Func total;
+        Var y, u;
+        RDom r(0, in.width());
+        total(y) = 0;
+        total(y) += in(r, y);
+
+        RVar ro, ri;
+        total.update().split(r, ro, ri, 32);
+        Func intm = total.update().rfactor(ri, u);
+
+        total.compute_root().gpu_blocks(y);
+        total.update().gpu_blocks(y);
+        intm.compute_at(total, y).gpu_lanes(u);
+        intm.update().gpu_lanes(u);
+
+        Buffer<int> out = total.realize(in.height());
+
+        for (int y = 0; y < out.width(); y++) {
+            int correct = 0;
+            for (int x = 0; x < in.width(); x++) {
+                correct += in(x, y);
+            }
+            if (out(y) != correct) {
+                printf("out(%d) = %d instead of %d\n",
+                       y, out(y), correct);
+                return -1;
+            }
+        }
+    }
+
     {
         // Test a case that caused combinatorial explosion
         Var x;
@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int M = 32, N = 24, K = 37;
+    Buffer<float> a(M, K), b(K, N);
+    for (int y = 0; y < K; y++) {
+        for (int x = 0; x < M; x++) {
+            a(x, y) = (rand() % 17) - 8;
+        }
+    }
+    for (int y = 0; y < N; y++) {
+        for (int x = 0; x < K; x++) {
+            b(x, y) = (rand() % 17) - 8;
+        }
+    }
+
+    // A GEMM micro-kernel: each 8x4 tile of c is accumulated in
+    // registers over the whole of r.
+    Func c;
+    Var x, y;
+    RDom r(0, K);
+    c(x, y) = 0.0f;
+    c(x, y) += a(x, r) * b(r, y);
+    c.update().register_tile(x, y, 8, 4);
+
+    Buffer<float> result = c.realize(M, N);
+    for (int j = 0; j < N; j++) {
+        for (int i = 0; i < M; i++) {
+            float correct = 0.0f;
+            for (int k = 0; k < K; k++) {
+                correct += a(i, k) * b(k, j);
+            }
+            // The inputs are small integers, so the sums are exact.
+            if (result(i, j) != correct) {
+                printf("c(%d, %d) = %f instead of %f\n", i, j, result(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A max-plus product, with a tile that doesn't divide the
+    // output evenly in x.
+    {
+        Func d;
+        d(x, y) = -1000;
+        d(x, y) = max(d(x, y), cast<int>(a(x, r) + b(r, y)));
+        d.update().register_tile(x, y, 6, 2);
+
+        Buffer<int> max_result = d.realize(M, N);
+        for (int j = 0; j < N; j++) {
+            for (int i = 0; i < M; i++) {
+                int correct = -1000;
+                for (int k = 0; k < K; k++) {
+                    correct = std::max(correct, (int)(a(i, k) + b(k, j)));
+                }
+                if (max_result(i, j) != correct) {
+                    printf("d(%d, %d) = %d instead of %d\n", i, j, max_result(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &out, int (*expected)(int, int)) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = expected(x, y);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n",
+                       x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // A ring buffer of two rows.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) + f(x, y + 1);
+        f.store_root().compute_at(g, y).ring_buffer(2);
+
+        Buffer<int> out = g.realize(64, 64);
+        if (check(out, [](int x, int y) { return 2 * (x + y) + 1; })) {
+            return -1;
+        }
+    }
+
+    // The same, with the producer running ahead on its own thread.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x * y;
+        g(x, y) = f(x, y) + f(x, y + 1);
+        f.store_root().compute_at(g, y).ring_buffer(3).async();
+
+        Buffer<int> out = g.realize(64, 64);
+        if (check(out, [](int x, int y) { return x * y + x * (y + 1); })) {
+            return -1;
+        }
+    }
+
+    // An access pattern that jumps around, so storage folding
+    // couldn't be used.
+    {
+        Func f, g;
+        Var x, y;
+        f(x, y) = x - y;
+        Expr r = (y * 37) % 16;
+        g(x, y) = f(x, r) + f(x, r + 3);
+        f.store_root().compute_at(g, y).ring_buffer(2).async();
+
+        Buffer<int> out = g.realize(32, 64);
+        if (check(out, [](int x, int y) {
+                int r = (y * 37) % 16;
+                return (x - r) + (x - r - 3);
+            })) {
+            return -1;
+        }
+    }
+
+    // Ring buffered over two loops.
+    {
+        Func f, g;
+        Var x, y, xo, xi;
+        f(x, y) = x + 2 * y;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        g.split(x, xo, xi, 8);
+        f.store_root().compute_at(g, xo).ring_buffer(4);
+
+        Buffer<int> out = g.realize(64, 16);
+        if (check(out, [](int x, int y) { return (x + 2 * y) + (x + 1 + 2 * y); })) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
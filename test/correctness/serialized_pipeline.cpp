@@ -0,0 +1,68 @@
+#include "Halide.h"
+#include <stdio.h>
+
+#include "test/common/halide_test_dirs.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(UInt(8), 2, "input");
+    Param<float> gain("gain");
+    Func blur("blur"), out("out");
+    Var x, y, xi, yi;
+    blur(x, y) = (cast<float>(input(x, y)) + input(x + 1, y) + input(x + 2, y)) / 3;
+    out(x, y) = blur(x, y) * gain;
+    out.tile(x, y, xi, yi, 8, 8).vectorize(xi, 4).parallel(y);
+    blur.compute_at(out, x);
+
+    std::string filename = Internal::get_test_tmp_dir() + "serialized_pipeline.hlpipe";
+    Internal::ensure_no_file_exists(filename);
+
+    out.compile_to_serialized_pipeline(filename, {input, gain}, "serialized_blur");
+
+    Internal::assert_file_exists(filename);
+
+    // Everything from here on needs only the file.
+    SerializedPipeline p = SerializedPipeline::load(filename);
+    if (p.name() != "serialized_blur") {
+        printf("Loaded pipeline is named %s\n", p.name().c_str());
+        return -1;
+    }
+
+    const std::vector<Argument> &args = p.arguments();
+    if (args.size() != 3 ||
+        args[0].name != "input" || !args[0].is_buffer() || args[0].type != UInt(8) ||
+        args[1].name != "gain" || !args[1].is_scalar() || args[1].type != Float(32) ||
+        !args[2].is_output() || args[2].type != Float(32) || args[2].dimensions != 2) {
+        printf("Loaded pipeline has the wrong arguments\n");
+        return -1;
+    }
+
+    Buffer<uint8_t> in(34, 32);
+    in.for_each_element([&](int x, int y) { in(x, y) = (uint8_t)(x * 3 + y * 7); });
+    Buffer<float> result(32, 32);
+    if (p(in, 2.0f, result) != 0) {
+        printf("Loaded pipeline failed\n");
+        return -1;
+    }
+
+    for (int y = 0; y < 32; y++) {
+        for (int x = 0; x < 32; x++) {
+            float correct = (in(x, y) + in(x + 1, y) + (float)in(x + 2, y)) / 3 * 2.0f;
+            if (std::abs(result(x, y) - correct) > 1e-4f) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Loading the same file again gives the same pipeline.
+    SerializedPipeline again = SerializedPipeline::load(filename);
+    if (again.hash() != p.hash()) {
+        printf("Loading the same file twice gave different hashes\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
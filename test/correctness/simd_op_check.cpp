@@ -51,8 +51,10 @@ struct Test {
     bool use_avx512_cannonlake{false};
     bool use_avx512_knl{false};
     bool use_avx512_skylake{false};
+    bool use_avx512_vnni{false};
     bool use_avx{false};
     bool use_power_arch_2_07{false};
+    bool use_power_arch_3_00{false};
     bool use_sse41{false};
     bool use_sse42{false};
     bool use_ssse3{false};
@@ -85,7 +87,8 @@ struct Test {
             .with_feature(Target::NoRuntime);
         use_avx512_knl = target.has_feature(Target::AVX512_KNL);
         use_avx512_cannonlake = target.has_feature(Target::AVX512_Cannonlake);
-        use_avx512_skylake = use_avx512_cannonlake || target.has_feature(Target::AVX512_Skylake);
+        use_avx512_vnni = target.has_feature(Target::AVX512_VNNI);
+        use_avx512_skylake = use_avx512_cannonlake || use_avx512_vnni || target.has_feature(Target::AVX512_Skylake);
         use_avx512 = use_avx512_knl || use_avx512_skylake || use_avx512_cannonlake || target.has_feature(Target::AVX512);
         use_avx2 = use_avx512 || target.has_feature(Target::AVX2);
         use_avx = use_avx2 || target.has_feature(Target::AVX);
@@ -99,7 +102,8 @@ struct Test {
         use_sse42 = use_avx;
 
         use_vsx = target.has_feature(Target::VSX);
-        use_power_arch_2_07 = target.has_feature(Target::POWER_ARCH_2_07);
+        use_power_arch_3_00 = target.has_feature(Target::POWER_ARCH_3_00);
+        use_power_arch_2_07 = use_power_arch_3_00 || target.has_feature(Target::POWER_ARCH_2_07);
 
         // We are going to call realize, i.e. we are going to JIT code.
         // Not all platforms support JITting. One indirect yet quick
@@ -141,7 +145,7 @@ struct Test {
         for (Target::Feature f : {Target::SSE41, Target::AVX,
                     Target::AVX2, Target::AVX512,
                     Target::FMA, Target::FMA4, Target::F16C,
-                    Target::VSX, Target::POWER_ARCH_2_07,
+                    Target::VSX, Target::POWER_ARCH_2_07, Target::POWER_ARCH_3_00,
                     Target::ARMv7s, Target::NoNEON, Target::MinGW}) {
             if (target.has_feature(f) != host_target.has_feature(f)) {
                 can_run_the_code = false;
@@ -623,9 +627,16 @@ struct Test {
             check("vpcmpeqq*ymm", 4, select(i64_1 == i64_2, i64(1), i64(2)));
             check("vpackusdw*ymm", 16, u16(clamp(i32_1, 0, max_u16)));
             check("vpcmpgtq*ymm", 4, select(i64_1 > i64_2, i64(1), i64(2)));
+
+            // Data-dependent loads
+            check("vpgatherdd*ymm", 8, in_i32(i32(u8_1)));
+            check("vgatherdps*ymm", 8, in_f32(i32(u8_1)));
         }
 
         if (use_avx512) {
+            check("vpgatherdd*zmm", 16, in_i32(i32(u8_1)));
+            check("vpgatherdq", 8, in_i64(i32(u8_1)));
+            check("vgatherdpd", 8, in_f64(i32(u8_1)));
 #if 0
             // Not yet implemented
             check("vrangeps", 16, clamp(f32_1, 3.0f, 9.0f));
@@ -648,6 +659,16 @@ struct Test {
             check("vpmaxsq", 8, max(i64_1, i64_2));
             check("vpminsq", 8, min(i64_1, i64_2));
         }
+        if (use_avx512_vnni) {
+            // Sums of widening multiplies, e.g. from a reduction
+            // that has been split and summed by hand.
+            Expr u8_4 = in_u8(x+48), i8_4 = in_i8(x+48), i16_4 = in_i16(x+48);
+            for (int w = 4; w <= 16; w *= 2) {
+                check("vpdpbusd", w, i32_1 + i32(u8_1) * i32(i8_1) + i32(u8_2) * i32(i8_2) +
+                                     i32(u8_3) * i32(i8_3) + i32(u8_4) * i32(i8_4));
+                check("vpdpwssd", w, i32_1 + i32(i16_1) * i32(i16_2) + i32(i16_3) * i32(i16_4));
+            }
+        }
     }
 
     void check_neon_all() {
@@ -1418,6 +1439,27 @@ struct Test {
         // Interleave or deinterleave two vectors. Given that we use
         // interleaving loads and stores, it's hard to hit this op with
         // halide.
+
+        if (target.has_feature(Target::ARMDotProd)) {
+            // UDOT/SDOT I      -       Dot Product (ARMv8.2)
+            // Sums of four widening 8-bit multiplies.
+            Expr u8_4 = in_u8(x+48), i8_4 = in_i8(x+48);
+            for (int w = 1; w <= 4; w++) {
+                check(arm32 ? "vudot.u8" : "udot", 4*w, u32_1 + u32(u8_1) * u8_2 + u32(u8_2) * u8_3 +
+                                                       u32(u8_3) * u8_4 + u32(u8_4) * u8_1);
+                check(arm32 ? "vsdot.s8" : "sdot", 4*w, i32_1 + i32(i8_1) * i8_2 + i32(i8_2) * i8_3 +
+                                                       i32(i8_3) * i8_4 + i32(i8_4) * i8_1);
+            }
+        }
+
+        if (target.has_feature(Target::ARMFp16) && !arm32) {
+            // Half precision arithmetic (ARMv8.2)
+            Expr f16_1 = cast(Float(16), f32_1), f16_2 = cast(Float(16), f32_2);
+            for (int w = 1; w <= 2; w++) {
+                check("fadd*.*h", 4*w, f16_1 + f16_2);
+                check("fmul*.*h", 4*w, f16_1 * f16_2);
+            }
+        }
     }
 
     void check_hvx_all() {
@@ -2068,6 +2110,16 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
             // Vector Floating-Point Maximum and Minimum Instructions
             check("vmaxfp", 4*w, max(f32_1, f32_2));
             check("vminfp", 4*w, min(f32_1, f32_2));
+
+            // Vector Multiply-Sum Instructions, for sums of widening
+            // multiplies.
+            Expr u8_4 = in_u8(x+48), i8_4 = in_i8(x+48), i16_4 = in_i16(x+48), u16_4 = in_u16(x+48);
+            check("vmsumubm", 4*w, u32_1 + u32(u8_1) * u8_2 + u32(u8_2) * u8_3 +
+                                   u32(u8_3) * u8_4 + u32(u8_4) * u8_1);
+            check("vmsummbm", 4*w, i32_1 + i32(i8_1) * i32(u8_1) + i32(i8_2) * i32(u8_2) +
+                                   i32(i8_3) * i32(u8_3) + i32(i8_4) * i32(u8_4));
+            check("vmsumshm", 4*w, i32_1 + i32(i16_1) * i32(i16_2) + i32(i16_3) * i32(i16_4));
+            check("vmsumuhm", 4*w, u32_1 + u32(u16_1) * u16_2 + u32(u16_3) * u16_4);
         }
 
         // Check these if target supports VSX.
@@ -2098,6 +2150,18 @@ check("v*.w += vrmpy(v*.b,v*.b)", hvx_width, i32_1 + i32(i8_1)*i8_1 + i32(i8_2)*
                 check("vminud",  2*w, min(u64_1, u64_2));
             }
         }
+
+        // Check these if target supports POWER ISA 3.00 and above.
+        if (use_power_arch_3_00) {
+            for (int w = 1; w <= 4; w++) {
+                check("vabsdub", 16*w, absd(u8_1, u8_2));
+                check("vabsduh",  8*w, absd(u16_1, u16_2));
+                check("vabsduw",  4*w, absd(u32_1, u32_2));
+                check("vabsdub", 16*w, absd(i8_1, i8_2));
+                check("vabsduh",  8*w, absd(i16_1, i16_2));
+                check("vabsduw",  4*w, absd(i32_1, i32_2));
+            }
+        }
     }
 
     bool test_all() {
@@ -1446,8 +1446,8 @@ int main(int argc, char **argv) {
     {
         // Check that contiguous prefetch call get collapsed
         Expr base = Variable::make(Handle(), "buf");
-        check(Call::make(Int(32), Call::prefetch, {base, x, 4, 1, 64, 4, min(x + y, 128), 256}, Call::Intrinsic),
-              Call::make(Int(32), Call::prefetch, {base, x, min(x + y, 128) * 256, 1}, Call::Intrinsic));
+        check(Call::make(Int(32), Call::prefetch, {base, x, 3, 4, 1, 64, 4, min(x + y, 128), 256}, Call::Intrinsic),
+              Call::make(Int(32), Call::prefetch, {base, x, 3, min(x + y, 128) * 256, 1}, Call::Intrinsic));
     }
 
     // This expression is a good stress-test. It caused exponential
@@ -1508,6 +1508,27 @@ int main(int argc, char **argv) {
         check(require(x == x, result, "error"), result);
     }
 
+    // Check that simplifying the same Expr again while a cache is
+    // alive gives the same result without simplifying it again.
+    {
+        Expr e = (x + 3) * 2 - x * 2;
+        Expr first, second;
+        {
+            SimplifyCache cache;
+            first = simplify(e);
+            second = simplify(e);
+            internal_assert(cache.num_lookups() == 2 && cache.num_hits() == 1)
+                << cache.num_hits() << " of " << cache.num_lookups() << " lookups hit the cache\n";
+            // Simplifying with bounds information bypasses the cache.
+            Scope<Interval> bounds;
+            bounds.push("x", Interval(0, 10));
+            simplify(e, true, bounds);
+            internal_assert(cache.num_lookups() == 2);
+        }
+        internal_assert(second.same_as(first));
+        check(e, first);
+    }
+
     printf("Success!\n");
 
     return 0;
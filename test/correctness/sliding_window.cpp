@@ -1,3 +1,4 @@
+#include <atomic>
 #include <stdio.h>
 #include "Halide.h"
 
@@ -16,6 +17,13 @@ extern "C" DLLEXPORT int call_counter(int x, int y) {
 }
 HalideExtern_2(int, call_counter, int, int);
 
+std::atomic<int> parallel_count(0);
+extern "C" DLLEXPORT int parallel_call_counter(int x, int y) {
+    parallel_count++;
+    return x + y;
+}
+HalideExtern_2(int, parallel_call_counter, int, int);
+
 extern "C" void *my_malloc(void *, size_t x) {
     printf("Malloc wasn't supposed to be called!\n");
     exit(-1);
@@ -196,6 +204,35 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        // Sliding within tasks of a parallel loop.
+        Func f, g;
+
+        f(x, y) = parallel_call_counter(x, y);
+        g(x, y) = f(x, y) + f(x, y+1);
+
+        f.store_root().compute_at(g, y).slide_in_tasks(10);
+        g.parallel(y);
+
+        Buffer<int> im = g.realize(10, 100);
+
+        // Each of the 10 tasks computes 11 rows of f.
+        if (parallel_count != 1100) {
+            printf("f was called %d times instead of %d times\n", (int)parallel_count, 1100);
+            return -1;
+        }
+
+        for (int j = 0; j < im.height(); j++) {
+            for (int i = 0; i < im.width(); i++) {
+                int correct = 2 * (i + j) + 1;
+                if (im(i, j) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", i, j, im(i, j), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <algorithm>
+#include <stdio.h>
+
+using namespace Halide;
+
+int check_sorted(Func input, Func sorted, int size, int rows) {
+    Buffer<int> in = input.realize(size, rows);
+    Realization r = sorted.realize(size, rows);
+    Buffer<int> keys(r[0]);
+    for (int y = 0; y < rows; y++) {
+        std::vector<int> correct(&in(0, y), &in(0, y) + size);
+        std::sort(correct.begin(), correct.end());
+        for (int x = 0; x < size; x++) {
+            if (keys(x, y) != correct[x]) {
+                printf("sorted(%d, %d) = %d instead of %d\n",
+                       x, y, keys(x, y), correct[x]);
+                return -1;
+            }
+        }
+        if (r.size() > 1) {
+            // The values travel with their keys
+            Buffer<int> values(r[1]);
+            for (int x = 0; x < size; x++) {
+                if (values(x, y) != keys(x, y) * 3 + 1) {
+                    printf("value(%d, %d) = %d does not match key %d\n",
+                           x, y, values(x, y), keys(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x, y;
+    Func keys;
+    keys(x, y) = ((x * 7919 + y * 104729) ^ 0x5bd1) % 1000 - 500;
+
+    Func pairs;
+    pairs(x, y) = Tuple(keys(x, y), keys(x, y) * 3 + 1);
+
+    // Small sizes use an expression sorting network, large ones a
+    // network of Funcs. Try both, with sizes that aren't powers of
+    // two.
+    for (int size : {1, 5, 9, 16, 100, 3000}) {
+        Func sorted = sort(keys, size);
+        sorted.vectorize(y, 4);
+        if (check_sorted(keys, sorted, size, 8)) {
+            printf("Failed sorting keys of size %d\n", size);
+            return -1;
+        }
+
+        sorted = sort(pairs, size);
+        if (check_sorted(keys, sorted, size, 8)) {
+            printf("Failed sorting key-value pairs of size %d\n", size);
+            return -1;
+        }
+    }
+
+    // A one-dimensional sort large enough to be split into parallel
+    // chunks.
+    {
+        Func one_d;
+        one_d(x) = keys(x, 0);
+        const int size = 10000;
+        Func sorted = sort(one_d, size);
+        Buffer<int> out = sorted.realize(size);
+        Buffer<int> in = one_d.realize(size);
+        std::sort(&in(0), &in(0) + size);
+        for (int i = 0; i < size; i++) {
+            if (out(i) != in(i)) {
+                printf("sorted(%d) = %d instead of %d\n", i, out(i), in(i));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 48;
+
+    // Every seventh pixel is active
+    std::vector<std::pair<int, int>> active;
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if ((x + y * W) % 7 == 0) {
+                active.push_back({x, y});
+            }
+        }
+    }
+    Buffer<int> coords((int)active.size(), 2);
+    for (size_t k = 0; k < active.size(); k++) {
+        coords((int)k, 0) = active[k].first;
+        coords((int)k, 1) = active[k].second;
+    }
+
+    Var x, y;
+
+    // Update only the active pixels, in parallel and vectorized, which
+    // is allowed because they are distinct.
+    {
+        SparseRDom r(coords);
+        Expr ax = r.coordinate(0), ay = r.coordinate(1);
+        Func f;
+        f(x, y) = 0;
+        f(ax, ay) = f(ax, ay) + ax * 3 + ay;
+        RVar ro, ri;
+        f.update().split(r, ro, ri, 16).parallel(ro).vectorize(ri, 4);
+        Buffer<int> out = f.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = ((x + y * W) % 7 == 0) ? x * 3 + y : 0;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // The same through an ImageParam
+    {
+        ImageParam list(Int(32), 2);
+        SparseRDom r(list, 2);
+        Expr ax = r.coordinate(0), ay = r.coordinate(1);
+        Func f;
+        f(x, y) = -1;
+        f(ax, ay) = ax + ay;
+        f.update().parallel(r, 8);
+        list.set(coords);
+        Buffer<int> out = f.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = ((x + y * W) % 7 == 0) ? x + y : -1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    {
+        Func f;
+        f(x, y) = x * 3 + y;
+        f.vectorize(x, 8).specialize_shapes({{16, 16}, {64, 8}}, 8);
+
+        // The output's innermost stride is already required to be
+        // one, so there is one version per shape plus the one for
+        // multiples of the vector width.
+        if (f.function().definition().specializations().size() != 3) {
+            printf("Expected 3 specializations, got %d\n",
+                   (int)f.function().definition().specializations().size());
+            return -1;
+        }
+
+        int sizes[][2] = {{16, 16}, {64, 8}, {24, 5}, {13, 7}, {16, 17}};
+        for (auto &s : sizes) {
+            Buffer<int> out = f.realize(s[0], s[1]);
+            for (int j = 0; j < s[1]; j++) {
+                for (int i = 0; i < s[0]; i++) {
+                    if (out(i, j) != i * 3 + j) {
+                        printf("For a %dx%d output, out(%d, %d) = %d instead of %d\n",
+                               s[0], s[1], i, j, out(i, j), i * 3 + j);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    {
+        // With an unconstrained innermost stride, the versions also
+        // require a dense output, and there is one more for that.
+        Func f;
+        f(x, y) = x - y;
+        f.output_buffer().dim(0).set_stride(Expr());
+        f.vectorize(x, 4).specialize_shapes({{8}}, 4);
+        if (f.function().definition().specializations().size() != 3) {
+            printf("Expected 3 specializations, got %d\n",
+                   (int)f.function().definition().specializations().size());
+            return -1;
+        }
+
+        // An output with a stride of two runs the general version.
+        Buffer<int> out(2, 10, 8);
+        Buffer<int> sliced = out.sliced(0, 0);
+        f.realize(sliced);
+        for (int j = 0; j < 8; j++) {
+            for (int i = 0; i < 10; i++) {
+                if (sliced(i, j) != i - j) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, sliced(i, j), i - j);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
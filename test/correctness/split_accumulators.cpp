@@ -0,0 +1,89 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int size = 1003;
+    Buffer<int> a(size), b(size);
+    for (int i = 0; i < size; i++) {
+        a(i) = rand() % 100 - 50;
+        b(i) = rand() % 100 - 50;
+    }
+
+    // A scalar dot product with four independent accumulators. The
+    // size isn't a multiple of the number of accumulators, so this
+    // also checks the tail.
+    {
+        int correct = 0;
+        for (int i = 0; i < size; i++) {
+            correct += a(i) * b(i);
+        }
+
+        Func dot;
+        RDom r(0, size);
+        dot() = 0;
+        dot() += a(r) * b(r);
+        dot.update().split_accumulators(r, 4);
+
+        Buffer<int> result = dot.realize();
+        if (result() != correct) {
+            printf("dot product = %d instead of %d\n", result(), correct);
+            return -1;
+        }
+    }
+
+    // A vectorized matrix-vector product, so the accumulators must
+    // be placed outside of the vector loop.
+    {
+        const int rows = 37;
+        Buffer<int> m(rows, size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < rows; x++) {
+                m(x, y) = rand() % 100 - 50;
+            }
+        }
+
+        Func mv;
+        Var x, xo, xi;
+        RDom r(0, size);
+        mv(x) = 0;
+        mv(x) += m(x, r) * b(r);
+        mv.update().split(x, xo, xi, 8).vectorize(xi).reorder(xi, r, xo);
+        mv.update().split_accumulators(r, 3);
+
+        Buffer<int> result = mv.realize(rows);
+        for (int i = 0; i < rows; i++) {
+            int correct = 0;
+            for (int j = 0; j < size; j++) {
+                correct += m(i, j) * b(j);
+            }
+            if (result(i) != correct) {
+                printf("mv(%d) = %d instead of %d\n", i, result(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A max reduction, split eight ways.
+    {
+        Func f;
+        RDom r(0, size);
+        f() = std::numeric_limits<int>::min();
+        f() = max(f(), a(r) * 3 + b(r));
+        f.update().split_accumulators(r, 8);
+
+        int correct = std::numeric_limits<int>::min();
+        for (int i = 0; i < size; i++) {
+            correct = std::max(correct, a(i) * 3 + b(i));
+        }
+        Buffer<int> result = f.realize();
+        if (result() != correct) {
+            printf("max = %d instead of %d\n", result(), correct);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error_handler(void *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    // A 3x3 kernel with a static shape, applied to an image.
+    ImageParam kernel(Float(32), 2);
+    ImageParam input(Float(32), 2);
+    kernel.set_static_shape({3, 3});
+
+    Func f;
+    Var x, y;
+    RDom r(0, 3, 0, 3);
+    f(x, y) = sum(kernel(r.x, r.y) * input(x + r.x, y + r.y));
+    f.set_error_handler(my_error_handler);
+
+    Runtime::StaticShapeBuffer<float, 3, 3> k;
+    k.for_each_element([&](int i, int j) { k(i, j) = (float)(i + 3 * j); });
+
+    Buffer<float> in(18, 18);
+    in.fill([](int x, int y) { return (float)((x * 7 + y * 3) % 5); });
+
+    kernel.set(Buffer<float>(*k.raw_buffer()));
+    input.set(in);
+    Buffer<float> out = f.realize(16, 16);
+    if (error_occurred) {
+        printf("Error incorrectly raised\n");
+        return -1;
+    }
+
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++) {
+            float correct = 0;
+            for (int j = 0; j < 3; j++) {
+                for (int i = 0; i < 3; i++) {
+                    correct += k(i, j) * in(x + i, y + j);
+                }
+            }
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A kernel of the wrong shape must be rejected.
+    Buffer<float> wrong(3, 4);
+    wrong.fill(1.0f);
+    kernel.set(wrong);
+    f.realize(16, 16);
+    if (!error_occurred) {
+        printf("Error incorrectly not raised for a kernel of the wrong shape\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "Halide.h"
+#include <fstream>
+#include <sstream>
 #include <stdio.h>
 
 #include "test/common/halide_test_dirs.h"
@@ -45,6 +47,29 @@ int main() {
     tuple_func.compile_to_lowered_stmt(result_file_3, {}, Halide::HTML);
     Internal::assert_file_exists(result_file_3);
 
+    // Check overlaying a profiler report.
+    std::string profile_file = Internal::get_test_tmp_dir() + "stmt_to_html_profile.txt";
+    {
+        std::ofstream profile(profile_file.c_str());
+        profile << "gradient_fast\n"
+                << " total time: 1.5 ms  samples: 10  runs: 1  time/run: 1.5 ms\n"
+                << "  gradient_fast:         1.50ms    (100%)  \n";
+    }
+    std::string result_file_4 = Internal::get_test_tmp_dir() + "stmt_to_html_dump_4.html";
+    Internal::ensure_no_file_exists(result_file_4);
+    Module m = gradient_fast.compile_to_module({}, "gradient_fast");
+    Internal::print_to_html(result_file_4, m, profile_file);
+    Internal::assert_file_exists(result_file_4);
+    {
+        std::ifstream html(result_file_4.c_str());
+        std::stringstream contents;
+        contents << html.rdbuf();
+        if (contents.str().find("1.5ms (100%) trips: ") == std::string::npos) {
+            printf("Profile overlay missing from %s\n", result_file_4.c_str());
+            return -1;
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
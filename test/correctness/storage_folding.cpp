@@ -386,6 +386,40 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        custom_malloc_size = 0;
+        Func f, g;
+
+        f(x, y) = x + y;
+        Expr zigzag = max(y - 50, 50 - y);
+        g(x, y) = f(x, zigzag - 1) + f(x, zigzag + 1);
+
+        // The rows of f used move back and forth, but each iteration
+        // of g computes all the rows it uses, so f can be folded down
+        // to the footprint of one iteration.
+        f.store_root().compute_at(g, y);
+
+        g.set_custom_allocator(my_malloc, my_free);
+
+        Buffer<int> im = g.realize(100, 100);
+
+        size_t expected_size = 100*4*sizeof(int) + sizeof(int);
+        if (custom_malloc_size == 0 || custom_malloc_size > expected_size) {
+            printf("Scratch space allocated was %d instead of %d\n", (int)custom_malloc_size, (int)expected_size);
+            return -1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 2 * (x + std::abs(y - 50));
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
     {
         // Fold the storage of the output of an extern stage
         Func f, g, h;
@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check whether there's a dense vector load from a given buffer
+class FindDenseLoad : public IRMutator2 {
+    using IRMutator2::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == name && op->type.is_vector()) {
+            const Ramp *r = op->index.as<Ramp>();
+            if (r && is_one(r->stride)) {
+                found_dense = true;
+            } else {
+                found_strided = true;
+            }
+        }
+        return IRMutator2::visit(op);
+    }
+
+public:
+    std::string name;
+    bool found_dense = false, found_strided = false;
+    FindDenseLoad(const std::string &n) : name(n) {}
+};
+
+int main(int argc, char **argv) {
+    Var x, y;
+
+    // The consumer walks the producer along y, so the producer should
+    // be stored transposed.
+    {
+        Func producer("producer"), consumer("consumer");
+        producer(x, y) = x * 100 + y;
+        consumer(x, y) = producer(y, x) * 2;
+        producer.compute_root();
+        consumer.vectorize(x, 8);
+
+        FindDenseLoad finder("producer");
+        consumer.add_custom_lowering_pass(&finder, nullptr);
+        Buffer<int> out = consumer.realize(64, 64);
+
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = (y * 100 + x) * 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (!finder.found_dense || finder.found_strided) {
+            printf("The producer should have been stored transposed\n");
+            return -1;
+        }
+    }
+
+    // If the producer is itself vectorized along its innermost
+    // dimension, it keeps its layout.
+    {
+        Func producer("producer"), consumer("consumer");
+        producer(x, y) = x * 100 + y;
+        consumer(x, y) = producer(y, x) * 2;
+        producer.compute_root().vectorize(x, 8);
+        consumer.vectorize(x, 8);
+
+        FindDenseLoad finder("producer");
+        consumer.add_custom_lowering_pass(&finder, nullptr);
+        Buffer<int> out = consumer.realize(64, 64);
+
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = (y * 100 + x) * 2;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (finder.found_dense) {
+            printf("The producer should have kept its layout\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Count the heap allocations.
+int mallocs = 0;
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    const int W = 123, H = 45;
+    Buffer<float> input(W + 2, H);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)((x * 7 + y * 13) % 31) - 15.0f;
+        }
+    }
+
+    for (int in_place = 0; in_place < 2; in_place++) {
+        // A stencil followed by a chain of elementwise stages.
+        Func conv("conv"), relu("relu"), scale("scale"), out("out");
+        Var x("x"), y("y");
+        conv(x, y) = input(x, y) + input(x + 1, y) * 2.0f + input(x + 2, y);
+        relu(x, y) = max(conv(x, y), 0.0f);
+        scale(x, y) = relu(x, y) * 0.5f + 1.0f;
+        out(x, y) = scale(x, y) - 1.0f;
+
+        conv.compute_root().vectorize(x, 8);
+        relu.compute_root().vectorize(x, 8, TailStrategy::GuardWithIf);
+        scale.compute_root().parallel(y);
+        if (in_place) {
+            relu.store_in_place_of(conv);
+            scale.store_in_place_of(relu);
+        }
+
+        out.set_custom_allocator(my_malloc, my_free);
+        mallocs = 0;
+        Buffer<float> result = out.realize(W, H);
+
+        int expected_mallocs = in_place ? 1 : 3;
+        if (mallocs != expected_mallocs) {
+            printf("%d heap allocations instead of %d\n", mallocs, expected_mallocs);
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float c = input(x, y) + input(x + 1, y) * 2.0f + input(x + 2, y);
+                float correct = std::max(c, 0.0f) * 0.5f + 1.0f - 1.0f;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
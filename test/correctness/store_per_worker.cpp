@@ -0,0 +1,65 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> mallocs(0), frees(0);
+
+void *my_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x + 64);
+    void *ptr = (void *)((((size_t)orig + 64) >> 6) << 6);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    frees++;
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    const int rows = 256;
+
+    Func f, g;
+    Var x, y;
+    Param<int> k;
+    f(x, y) = x + y * k;
+    g(x, y) = f(x - 1, y) + f(x + 1, y);
+
+    // The width of f depends on the output, so each row of f is a
+    // heap allocation.
+    f.compute_at(g, y).store_per_worker();
+    g.parallel(y);
+
+    g.set_custom_allocator(my_malloc, my_free);
+
+    k.set(3);
+    Buffer<int> out = g.realize(1000, rows);
+
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x - 1 + y * 3) + (x + 1 + y * 3);
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // There should be at most one allocation of f per task running at
+    // once, plus the pool itself, rather than one per row.
+    printf("%d mallocs, %d frees\n", (int)mallocs, (int)frees);
+    if (mallocs >= rows / 2) {
+        printf("The storage of f was not reused across rows\n");
+        return -1;
+    }
+    if (mallocs != frees) {
+        printf("Leaked %d allocations\n", (int)(mallocs - frees));
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func input, blur_x, blur_y;
+    Var x, y, xi, yi;
+
+    input(x, y) = cast<uint16_t>(x * 17 + y * 31);
+    blur_x(x, y) = (input(x - 1, y) + input(x, y) + input(x + 1, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1)) / 3;
+
+    // Write the output with streaming stores from parallel tasks,
+    // including a tail that isn't a whole vector.
+    blur_y.split(y, y, yi, 8).parallel(y).vectorize(x, 16).store_streaming();
+    blur_x.store_at(blur_y, y).compute_at(blur_y, yi).vectorize(x, 16);
+
+    const int W = 1003, H = 300;
+    Buffer<uint16_t> out = blur_y.realize(W, H);
+    for (int j = 0; j < H; j++) {
+        for (int i = 0; i < W; i++) {
+            auto in = [](int px, int py) { return (uint16_t)(px * 17 + py * 31); };
+            auto bx = [&](int px, int py) { return (uint16_t)((in(px - 1, py) + in(px, py) + in(px + 1, py)) / 3); };
+            uint16_t correct = (bx(i, j - 1) + bx(i, j) + bx(i, j + 1)) / 3;
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    // A Tuple-valued Func with an update, scheduled serially.
+    {
+        Func f;
+        f(x) = Tuple(x, x * 2.0f);
+        f(x) = Tuple(f(x)[0] + 1, f(x)[1] * 2.0f);
+        f.vectorize(x, 8).store_streaming();
+        f.update().vectorize(x, 8);
+
+        Realization r = f.realize(100);
+        Buffer<int> a = r[0];
+        Buffer<float> b = r[1];
+        for (int i = 0; i < 100; i++) {
+            if (a(i) != i + 1 || b(i) != i * 4.0f) {
+                printf("f(%d) = {%d, %f} instead of {%d, %f}\n",
+                       i, a(i), b(i), i + 1, i * 4.0f);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -27,5 +27,30 @@ int main(int argc, char **argv) {
 
     g.realize(425);
 
+    // Larger constant strides load several dense vectors and shuffle
+    // out the lanes. The last load is pushed backwards so that it
+    // ends at the last element used, which here is the last element
+    // of the input.
+    for (int stride = 3; stride <= 8; stride++) {
+        const int lanes = 8, size = 40;
+        Buffer<uint16_t> in(stride * (size - 1) + 1);
+        for (int i = 0; i < in.width(); i++) {
+            in(i) = (uint16_t)(i * 37);
+        }
+
+        Func h;
+        h(x) = in(stride * x);
+        h.vectorize(x, lanes).bound(x, 0, size);
+        Buffer<uint16_t> out = h.realize(size);
+        for (int i = 0; i < size; i++) {
+            if (out(i) != in(stride * i)) {
+                printf("Stride %d: out(%d) = %d instead of %d\n",
+                       stride, i, out(i), in(stride * i));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
     return 0;
 }
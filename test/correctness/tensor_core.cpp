@@ -0,0 +1,61 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.has_feature(Target::CUDACapability70)) {
+        printf("This test requires cuda enabled with cuda capability 7.0 or greater\n");
+        return 0;
+    }
+
+    const int size = 64;
+    ImageParam A(Float(16), 2), B(Float(16), 2);
+
+    Var x, y, xi, yi, xo, yo;
+    RDom r(0, size);
+    RVar ro, ri;
+
+    Func prod;
+    prod(x, y) = 0.0f;
+    prod(x, y) += cast<float>(A(r, y)) * cast<float>(B(x, r));
+
+    prod.bound(x, 0, size).bound(y, 0, size)
+        .gpu_tile(x, y, xo, yo, xi, yi, 16, 16);
+    prod.update()
+        .tile(x, y, xo, yo, xi, yi, 16, 16)
+        .split(r.x, ro, ri, 16)
+        .reorder(xi, yi, ri, ro, xo, yo)
+        .gpu_blocks(xo, yo)
+        .tensor_core(xi, yi, ri);
+
+    Buffer<float16_t> a(size, size), b(size, size);
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            // Small integers, so that the products and sums are exact.
+            a(i, j) = float16_t((i + j) % 5 - 2);
+            b(i, j) = float16_t((i * 3 + j) % 7 - 3);
+        }
+    }
+    A.set(a);
+    B.set(b);
+
+    Buffer<float> out = prod.realize(size, size, target);
+
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            float correct = 0.0f;
+            for (int k = 0; k < size; k++) {
+                correct += (float)a(k, j) * (float)b(i, k);
+            }
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", i, j, out(i, j), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -31,6 +31,41 @@ int main(int argc, char **argv) {
         t.join();
     }
 
+    // Many threads realizing one Pipeline at once, each with its own
+    // parameter values. The first one to get there compiles it.
+    Param<int> p;
+    Func g;
+    Var x;
+    g(x) = x * p;
+    Pipeline pipeline(g);
+
+    std::vector<int> errors(num_threads, 0);
+    threads.clear();
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i]{
+            for (int j = 0; j < (total_iters / num_threads); j++) {
+                Buffer<int> result(100);
+                pipeline.realize(result, get_jit_target_from_environment(), {{p, i}});
+                for (int k = 0; k < 100; k++) {
+                    if (result(k) != k * i) {
+                        errors[i]++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        if (errors[i]) {
+            printf("Thread %d got %d wrong values\n", i, errors[i]);
+            return -1;
+        }
+    }
+
     printf("Success!\n");
 
     return 0;
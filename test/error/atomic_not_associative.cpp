@@ -0,0 +1,24 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+
+    Func f;
+    Var x, y;
+
+    f(x, y) = 0;
+
+    RDom r(0, 10, 0, 10);
+    f(r.x, r.y) += f(r.y, r.x);
+
+    // This update reads a different site than it writes, so doing it
+    // atomically doesn't make it safe to parallelize.
+    f.update().atomic();
+
+    // We shouldn't reach here, because there should have been a compile error.
+    printf("There should have been an error\n");
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(Float(32), 1);
+    Func hist;
+    Var x;
+
+    hist(x) = 0.0f;
+    RDom r(0, 1000);
+    hist(clamp(cast<int>(in(r) * 16), 0, 15)) += in(r);
+
+    // The order the threads add to each bin changes the rounding of
+    // the result, so this isn't allowed in deterministic mode.
+    RVar ro, ri;
+    hist.update().atomic().split(r, ro, ri, 100).parallel(ro);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::DeterministicReductions);
+    hist.compile_jit(t);
+
+    // We shouldn't reach here, because there should have been a compile error.
+    printf("There should have been an error\n");
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    h(x, y) = g(x, y);
+
+    f.compute_root();
+
+    // This makes no sense, because g reads values of f it has
+    // already overwritten.
+    g.compute_root().store_in_place_of(f);
+
+    h.realize(10, 10);
+
+    printf("I should not have reached here\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <vector>
+
+#include "batch.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int N = 100;
+
+    // Lots of small images of the same size, plus a few of a
+    // different size that have to go through the checked pipeline.
+    std::vector<Buffer<float>> inputs, outputs;
+    std::vector<float> scales(N);
+    for (int i = 0; i < N; i++) {
+        int size = (i % 10 == 9) ? 20 : 16;
+        Buffer<float> in(size, size);
+        in.for_each_element([&](int x, int y) {
+            in(x, y) = (float)(x + y * size + i);
+        });
+        inputs.push_back(in);
+        outputs.push_back(Buffer<float>(size, size));
+        scales[i] = (float)(i % 3);
+    }
+
+    std::vector<std::vector<void *>> argv_storage(N);
+    std::vector<void **> argvs(N);
+    for (int i = 0; i < N; i++) {
+        argv_storage[i] = {inputs[i].raw_buffer(), &scales[i], outputs[i].raw_buffer()};
+        argvs[i] = argv_storage[i].data();
+    }
+
+    if (batch_batch(N, argvs.data()) != 0) {
+        printf("batch_batch failed\n");
+        return -1;
+    }
+
+    for (int i = 0; i < N; i++) {
+        Buffer<float> in = inputs[i], out = outputs[i];
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                float correct = in(x, y) * scales[i] + y;
+                if (out(x, y) != correct) {
+                    printf("outputs[%d](%d, %d) = %f instead of %f\n", i, x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
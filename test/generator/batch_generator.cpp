@@ -0,0 +1,23 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+class Batch : public Halide::Generator<Batch> {
+public:
+    Input<Buffer<float>>  input{"input", 2};
+    Input<float>          scale{"scale"};
+
+    Output<Buffer<float>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = input(x, y) * scale + y;
+        output.vectorize(x, natural_vector_size<float>());
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Batch, batch)
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "buffer_copy.h"
 #include "HalideBuffer.h"
@@ -7,6 +9,25 @@
 
 using namespace Halide::Runtime;
 
+// Copy an interleaved buffer of T into a planar one with
+// halide_buffer_copy and check the result.
+template<typename T>
+void check_interleaved_to_planar(int width, int height) {
+    Buffer<T> interleaved = Buffer<T>::make_interleaved(width, height, 3);
+    interleaved.fill([&](int x, int y, int c) {return (T)(x + 7*y + 31*c);});
+    Buffer<T> planar(width, height, 3);
+
+    halide_buffer_copy(nullptr, interleaved, nullptr, planar);
+
+    planar.for_each_value([&](T a, T b) {
+        if (a != b) {
+            printf("Copying from interleaved to planar failed for %d-byte elements\n",
+                   (int)sizeof(T));
+            exit(-1);
+        }
+    }, interleaved);
+}
+
 int main(int argc, char **argv) {
     // Test simple host to host buffer copy.
 
@@ -26,6 +47,58 @@ int main(int argc, char **argv) {
             }
         }, in_crop);
     }
+
+    // Test copies from interleaved to planar for each element size that
+    // gets copied with typed loads and stores, both small and big
+    // enough to be split across the thread pool.
+    check_interleaved_to_planar<uint8_t>(64, 64);
+    check_interleaved_to_planar<uint16_t>(64, 64);
+    check_interleaved_to_planar<uint32_t>(64, 64);
+    check_interleaved_to_planar<uint64_t>(64, 64);
+    check_interleaved_to_planar<uint8_t>(1024, 1024);
+    check_interleaved_to_planar<uint64_t>(512, 512);
+
+    // Test a copy from a buffer whose host pointer is not aligned to
+    // its element size.
+    {
+        const int w = 37, h = 19;
+        uint8_t *storage = (uint8_t *)malloc(w * h * sizeof(uint32_t) + 1);
+        Buffer<uint32_t> unaligned((uint32_t *)(storage + 1), w, h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                uint32_t v = x + 100*y;
+                memcpy(&unaligned(x, y), &v, sizeof(v));
+            }
+        }
+        Buffer<uint32_t> out(w - 2, h - 2);
+        out.set_min(1, 1);
+
+        halide_buffer_copy(nullptr, unaligned, nullptr, out);
+
+        out.for_each_element([&](int x, int y) {
+            if (out(x, y) != (uint32_t)(x + 100*y)) {
+                printf("Copying from an unaligned buffer failed\n");
+                exit(-1);
+            }
+        });
+        free(storage);
+    }
+
+    // Test a parallel copy from planar to interleaved, big enough to
+    // be split into tasks.
+    {
+        Buffer<int> planar(1024, 1024, 3);
+        planar.fill([&](int x, int y, int c) {return x + 10*y + 100000*c;});
+        Buffer<int> interleaved = Buffer<int>::make_interleaved(1024, 1024, 3);
+        interleaved.parallel_copy_from(planar);
+
+        interleaved.for_each_value([&](int a, int b) {
+            if (a != b) {
+                printf("Copying from planar to interleaved in parallel failed\n");
+                exit(-1);
+            }
+        }, planar);
+    }
     
 #if (defined(TEST_CUDA) || defined(TEST_OPENCL))
     const halide_device_interface_t *dev = nullptr;
@@ -199,7 +199,54 @@ int main(int argc, char **argv) {
         }
 
 #if defined(TEST_CUDA)
+        // With a cap set, freed device allocations are kept and handed
+        // out again to later allocations of the same size, and
+        // halide_device_release frees them.
+        {
+            halide_cuda_set_max_cached_device_bytes(nullptr, 1 << 20);
+            const int allocs_before = tracker.total_created("cuMemAlloc");
+            uint64_t first_device = 0;
+            for (int i = 0; i < 4; i++) {
+                Buffer<int> output(80);
+                gpu_object_lifetime(output);
+                if (output.raw_buffer()->device_interface != halide_cuda_device_interface()) {
+                    printf("Error! (allocation reuse %d): output is not on the CUDA device\n", i);
+                    return -1;
+                }
+                if (i == 0) {
+                    first_device = output.raw_buffer()->device;
+                } else if (output.raw_buffer()->device != first_device) {
+                    printf("Error! (allocation reuse %d): freed device allocation was not reused\n", i);
+                    return -1;
+                }
+                output.copy_to_host();
+                for (int x = 0; x < output.width(); x++) {
+                    if (output(x) != x) {
+                        printf("Error! (allocation reuse %d): %d != %d\n", i, output(x), x);
+                        return -1;
+                    }
+                }
+                output.device_free();
+            }
+            if (tracker.total_created("cuMemAlloc") != allocs_before + 1) {
+                printf("Error! (allocation reuse): %d calls to cuMemAlloc instead of 1\n",
+                       tracker.total_created("cuMemAlloc") - allocs_before);
+                return -1;
+            }
+            if (tracker.live_count("cuMemAlloc") == 0) {
+                printf("Error! (allocation reuse): the freed allocation was not kept\n");
+                return -1;
+            }
+        }
+
         halide_device_release(nullptr, halide_cuda_device_interface());
+
+        if (tracker.live_count("cuMemAlloc") != 0) {
+            printf("Error! halide_device_release left %d kept device allocations\n",
+                   tracker.live_count("cuMemAlloc"));
+            return -1;
+        }
+        halide_cuda_set_max_cached_device_bytes(nullptr, 0);
 #elif defined(TEST_OPENCL)
         halide_device_release(nullptr, halide_opencl_device_interface());
 #elif defined(TEST_METAL)
@@ -0,0 +1,71 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "huge_pages.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+#ifdef __linux__
+    const int W = 1024, H = 1024;
+
+    Buffer<int32_t> input(W, H + 2);
+    input.set_min(0, -1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x + y * 3;
+    });
+
+    Buffer<int32_t> output(W, H);
+
+    // The intermediate is about 4MB, so it gets huge pages.
+    halide_set_custom_malloc(halide_huge_page_malloc);
+    size_t old_threshold = halide_set_huge_page_threshold(1 << 20);
+
+    if (huge_pages(input, output) != 0) {
+        printf("huge_pages failed\n");
+        return -1;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 2 * (input(x, y - 1) + input(x, y + 1));
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n",
+                       x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Large allocations start just past the start of a huge page, and
+    // are freed by halide_default_free like any other allocation.
+    void *p = halide_huge_page_malloc(nullptr, 8 << 20);
+    if (p == nullptr || ((uintptr_t)p & ((2 << 20) - 1)) > 256) {
+        printf("Large allocation %p is not at the start of a huge page\n", p);
+        return -1;
+    }
+    ((char *)p)[(8 << 20) - 1] = 1;
+    halide_default_free(nullptr, p);
+
+    // Small allocations fall through to halide_default_malloc.
+    void *q = halide_huge_page_malloc(nullptr, 100);
+    if (q == nullptr) {
+        printf("Small allocation failed\n");
+        return -1;
+    }
+    halide_default_free(nullptr, q);
+
+    if (halide_set_huge_page_threshold(old_threshold) != (1 << 20)) {
+        printf("halide_set_huge_page_threshold did not return the old threshold\n");
+        return -1;
+    }
+    halide_set_custom_malloc(halide_default_malloc);
+#else
+    printf("Not running test because huge pages are only supported on Linux\n");
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
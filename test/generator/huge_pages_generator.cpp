@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+class HugePages : public Halide::Generator<HugePages> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        // A large compute_root intermediate, consumed down its columns.
+        Var x, y;
+
+        Func a;
+        a(x, y) = input(x, y) * 2;
+        output(x, y) = a(x, y - 1) + a(x, y + 1);
+
+        a.compute_root();
+        output.reorder(y, x);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(HugePages, huge_pages)
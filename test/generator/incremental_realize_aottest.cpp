@@ -0,0 +1,85 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_incremental_realize.h"
+
+#include <stdio.h>
+
+#include "incremental_realize.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+int pipeline(halide_buffer_t *in, halide_buffer_t *out) {
+    return incremental_realize(in, out);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int W = 120, H = 80;
+
+    Buffer<int32_t> input(W, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x * 7 + y * 13 + ((x ^ y) & 15);
+    });
+
+    Buffer<int32_t> output(W, H);
+    if (pipeline(input, output) != 0) {
+        printf("Initial realization failed\n");
+        return -1;
+    }
+
+    // Change some regions of the input, including ones at the edges,
+    // and check that updating the previous output matches computing
+    // it from scratch.
+    struct Edit {
+        int x, w, y, h;
+    };
+    const Edit edits[] = {{50, 5, 30, 4}, {0, 3, 0, 2}, {W - 1, 1, H - 6, 6}, {10, 1, 70, 1}};
+    for (const Edit &e : edits) {
+        for (int y = e.y; y < e.y + e.h; y++) {
+            for (int x = e.x; x < e.x + e.w; x++) {
+                input(x, y) = input(x, y) * 3 + 1;
+            }
+        }
+
+        std::vector<std::pair<int, int>> updated;
+        int result = Halide::Tools::realize_incremental<int32_t, int32_t>(
+            pipeline, input, output, {{e.x, e.w}, {e.y, e.h}}, &updated);
+        if (result != 0) {
+            printf("realize_incremental failed: %d\n", result);
+            return -1;
+        }
+
+        // The output depends on the input from x - 2 to x + 1, and
+        // y - 1 to y + 3.
+        int x_min = std::max(e.x - 1, 0), x_max = std::min(e.x + e.w - 1 + 2, W - 1);
+        int y_min = std::max(e.y - 3, 0), y_max = std::min(e.y + e.h - 1 + 1, H - 1);
+        if (updated[0].first != x_min || updated[0].second != x_max - x_min + 1 ||
+            updated[1].first != y_min || updated[1].second != y_max - y_min + 1) {
+            printf("Updated [%d, %d] x [%d, %d] instead of [%d, %d] x [%d, %d]\n",
+                   updated[0].first, updated[0].second, updated[1].first, updated[1].second,
+                   x_min, x_max - x_min + 1, y_min, y_max - y_min + 1);
+            return -1;
+        }
+
+        Buffer<int32_t> correct(W, H);
+        if (pipeline(input, correct) != 0) {
+            printf("Full realization failed\n");
+            return -1;
+        }
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                if (output(x, y) != correct(x, y)) {
+                    printf("output(%d, %d) = %d instead of %d\n",
+                           x, y, output(x, y), correct(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+// An asymmetric stencil with a boundary condition, so that the region
+// of the output affected by a change to the input reaches further in
+// some directions than others, and is clamped at the edges.
+class IncrementalRealize : public Halide::Generator<IncrementalRealize> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+
+        Func blur_x;
+        blur_x(x, y) = clamped(x - 2, y) + 2 * clamped(x + 1, y);
+        output(x, y) = blur_x(x, y - 1) + 3 * blur_x(x, y + 3);
+
+        blur_x.compute_at(output, y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(IncrementalRealize, incremental_realize)
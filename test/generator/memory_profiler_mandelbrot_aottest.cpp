@@ -60,6 +60,46 @@ void validate(halide_profiler_state *s) {
 }
 
 
+std::string printed;
+
+void capture_print(void *user_context, const char *msg) {
+    printed += msg;
+}
+
+// Check the timeline of parallel tasks and the JSON report mention the
+// pipeline.
+void validate_exports() {
+    const char *filename = "memory_profiler_mandelbrot_timeline.json";
+    if (halide_profiler_write_timeline(nullptr, filename) != 0) {
+        printf("Failed to write the profiler timeline\n");
+        exit(-1);
+    }
+    FILE *f = fopen(filename, "r");
+    assert(f != NULL);
+    string timeline;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        timeline.append(buf, n);
+    }
+    fclose(f);
+    remove(filename);
+    if (timeline.compare(0, 16, "{\"traceEvents\": ") != 0 ||
+        timeline.find("\"cat\": \"memory_profiler_mandelbrot\"") == string::npos) {
+        printf("Unexpected profiler timeline:\n%.1000s\n", timeline.c_str());
+        exit(-1);
+    }
+
+    auto old_print = halide_set_custom_print(capture_print);
+    halide_profiler_report_json(nullptr);
+    halide_set_custom_print(old_print);
+    if (printed.compare(0, 14, "{\"pipelines\": ") != 0 ||
+        printed.find("{\"name\": \"memory_profiler_mandelbrot\"") == string::npos) {
+        printf("Unexpected profiler JSON report:\n%s\n", printed.c_str());
+        exit(-1);
+    }
+}
+
 int launcher_task(void *user_context, int index, uint8_t *closure) {
     Buffer<int> output(width, height);
     float fx = cos(index / 10.0f), fy = sin(index / 10.0f);
@@ -83,12 +123,15 @@ int main(int argc, char **argv) {
     printf("argmin expected value\n  stack peak: %d\n", argmin_stack_peak);
     printf("\n");
 
+    halide_profiler_start_timeline(nullptr, 1 << 16);
+
     halide_do_par_for(nullptr, launcher_task, 0, num_launcher_tasks, nullptr);
 
     halide_profiler_state *state = halide_profiler_get_state();
     assert(state != NULL);
 
     validate(state);
+    validate_exports();
 
     printf("Success!\n");
     return 0;
@@ -0,0 +1,105 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "paged_input.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+int pages_provided = 0;
+
+int source_value(int x, int y) {
+    return x * 7 + y * 13 + ((x ^ y) & 15);
+}
+
+int provide_page(void *user_context, const char *name, halide_buffer_t *page) {
+    if (strcmp(name, "source") != 0) {
+        printf("Page requested for unknown input %s\n", name);
+        return -1;
+    }
+    Buffer<int32_t> buf(*page);
+    if (buf.dim(0).extent() != 16 || buf.dim(1).extent() != 8 ||
+        buf.dim(0).min() % 16 != 0 || buf.dim(1).min() % 8 != 0) {
+        printf("Unexpected page [%d, %d] x [%d, %d]\n",
+               buf.dim(0).min(), buf.dim(0).extent(),
+               buf.dim(1).min(), buf.dim(1).extent());
+        return -1;
+    }
+    buf.for_each_element([&](int x, int y) {
+        buf(x, y) = source_value(x, y);
+    });
+    pages_provided++;
+    return 0;
+}
+
+bool check(const Buffer<int32_t> &output) {
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = (source_value(x, y) + source_value(x + 1, y) +
+                           source_value(x, y + 1) + source_value(x + 1, y + 1));
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n",
+                       x, y, output(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 50;
+    // The output reads one more column and row than it computes, so
+    // covers this many pages of the input.
+    const int pages = ((W + 16) / 16) * ((H + 8) / 8);
+
+    halide_set_page_provider(provide_page);
+    halide_memoization_cache_set_size(1 << 20);
+
+    Buffer<int32_t> output(W, H);
+    if (paged_input(output) != 0 || !check(output)) {
+        printf("First run failed\n");
+        return -1;
+    }
+    // Each page is provided once, even though the tiles of the output
+    // share pages.
+    if (pages_provided != pages) {
+        printf("%d pages provided instead of %d\n", pages_provided, pages);
+        return -1;
+    }
+
+    // All the pages are still resident, so none are provided again.
+    output.fill(0);
+    if (paged_input(output) != 0 || !check(output)) {
+        printf("Second run failed\n");
+        return -1;
+    }
+    if (pages_provided != pages) {
+        printf("%d pages provided on the second run\n", pages_provided - pages);
+        return -1;
+    }
+
+    // With room for only a page or so, pages are evicted and fetched
+    // again, but the result is the same.
+    halide_memoization_cache_cleanup();
+    halide_memoization_cache_set_size(16 * 8 * sizeof(int32_t));
+    output.fill(0);
+    if (paged_input(output) != 0 || !check(output)) {
+        printf("Third run failed\n");
+        return -1;
+    }
+    if (pages_provided <= 2 * pages) {
+        printf("Only %d pages provided with a small cache\n", pages_provided - pages);
+        return -1;
+    }
+
+    halide_memoization_cache_cleanup();
+    printf("Success!\n");
+    return 0;
+}
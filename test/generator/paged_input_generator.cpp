@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+// A 2x2 box sum over an input that is paged in on demand, computed
+// one tile of the output at a time.
+class PagedInput : public Halide::Generator<PagedInput> {
+public:
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y, xo, yo, xi, yi;
+
+        Func source = Halide::paged_input("source", Int(32), {16, 8});
+        output(x, y) = (source(x, y) + source(x + 1, y) +
+                        source(x, y + 1) + source(x + 1, y + 1));
+
+        output.tile(x, y, xo, yo, xi, yi, 32, 16);
+        source.compute_at(output, xo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(PagedInput, paged_input)
@@ -0,0 +1,67 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+
+#include "pool_allocator.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 256;
+
+    Buffer<int32_t> input(W + 2, H + 2);
+    input.set_min(-1, -1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x + y * 3;
+    });
+
+    Buffer<int32_t> output(W, H);
+
+    halide_set_custom_malloc(halide_pool_malloc);
+    halide_set_custom_free(halide_pool_free);
+
+    for (int i = 0; i < 10; i++) {
+        output.fill(0);
+        if (pool_allocator(input, output) != 0) {
+            printf("pool_allocator failed\n");
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = 2 * (input(x - 1, y - 1) + input(x + 1, y - 1) +
+                                   input(x - 1, y + 1) + input(x + 1, y + 1));
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n",
+                           x, y, output(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+
+        // Releasing the pooled blocks between some of the runs
+        // shouldn't change anything.
+        if (i % 3 == 2) {
+            halide_pool_trim(nullptr);
+        }
+    }
+
+    // A freed block should be handed back out to the next
+    // allocation of the same size class on the same thread.
+    void *p = halide_pool_malloc(nullptr, 1000);
+    halide_pool_free(nullptr, p);
+    void *q = halide_pool_malloc(nullptr, 1010);
+    if (p != q) {
+        printf("Freed block was not reused\n");
+        return -1;
+    }
+    halide_pool_free(nullptr, q);
+
+    halide_pool_trim(nullptr);
+    halide_set_custom_malloc(halide_default_malloc);
+    halide_set_custom_free(halide_default_free);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class PoolAllocator : public Halide::Generator<PoolAllocator> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        // Heap-allocated intermediates per tile of a parallel loop,
+        // of a few different sizes.
+        Var x, y, xo, yo, xi, yi;
+
+        Func a, b;
+        a(x, y) = input(x, y) * 2;
+        b(x, y) = a(x - 1, y) + a(x + 1, y);
+        output(x, y) = b(x, y - 1) + b(x, y + 1);
+
+        output.tile(x, y, xo, yo, xi, yi, 32, 16).parallel(yo);
+        a.compute_at(output, xo);
+        b.compute_at(output, xo);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(PoolAllocator, pool_allocator)
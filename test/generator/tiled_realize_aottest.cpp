@@ -0,0 +1,85 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+#include "halide_tiled_realize.h"
+
+#include <stdio.h>
+
+#include "tiled_realize.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+int input_value(int x, int y) {
+    return x * 7 + y * 13 + ((x ^ y) & 15);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // The output isn't a multiple of the tile size, to exercise the
+    // tiles at the edges.
+    const int W = 250, H = 130;
+    const int TW = 64, TH = 32;
+
+    // The whole output, which the tiles are stored into.
+    Buffer<int32_t> output(W, H);
+    output.fill(0);
+
+    // Count how many input values are fetched, to check that the
+    // halos between neighboring tiles are reused.
+    int fetched = 0;
+
+    int result = Halide::Tools::realize_tiled<int32_t, int32_t>(
+        [&](halide_buffer_t *in, halide_buffer_t *out) {
+            return tiled_realize(in, out);
+        },
+        [&](Buffer<int32_t> &region) {
+            region.for_each_element([&](int x, int y) {
+                region(x, y) = input_value(x, y);
+            });
+            fetched += (int)region.number_of_elements();
+            return 0;
+        },
+        [&](const Buffer<int32_t> &tile) {
+            output.cropped(0, tile.dim(0).min(), tile.dim(0).extent())
+                .cropped(1, tile.dim(1).min(), tile.dim(1).extent())
+                .copy_from(tile);
+            return 0;
+        },
+        {{0, W}, {0, H}},
+        {TW, TH},
+        2);
+    if (result != 0) {
+        printf("realize_tiled failed: %d\n", result);
+        return -1;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += input_value(x + dx, y + dy);
+                }
+            }
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n",
+                       x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Each row of tiles fetches its input band once, plus the halo of
+    // the first tile of the row.
+    const int rows = (H + TH - 1) / TH;
+    const int expected = (W + 2) * (H + 2 * rows);
+    if (fetched != expected) {
+        printf("Fetched %d input values instead of %d\n", fetched, expected);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
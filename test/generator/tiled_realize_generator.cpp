@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+// A separable 3x3 box sum with no boundary condition, so that each
+// output tile needs a one pixel halo of input around it.
+class TiledRealize : public Halide::Generator<TiledRealize> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+
+        Func sum_x;
+        sum_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+        output(x, y) = sum_x(x, y - 1) + sum_x(x, y) + sum_x(x, y + 1);
+
+        sum_x.compute_at(output, y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TiledRealize, tiled_realize)
@@ -0,0 +1,73 @@
+#include "HalideRuntime.h"
+#include "HalideBuffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unchecked_entry.h"
+
+using namespace Halide::Runtime;
+
+int error_count = 0;
+void my_error_handler(void *user_context, const char *msg) {
+    error_count++;
+}
+
+int main(int argc, char **argv) {
+    const int W = 32, H = 16;
+
+    Buffer<int32_t> input(W + 1, H);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = x * x + y;
+    });
+    Buffer<int32_t> output(W, H);
+
+    halide_set_error_handler(my_error_handler);
+
+    // Check the arguments once, then run the fast path repeatedly.
+    if (unchecked_entry_validate(input, 3, output) != 0) {
+        printf("unchecked_entry_validate rejected valid arguments\n");
+        return -1;
+    }
+    for (int i = 0; i < 10; i++) {
+        if (unchecked_entry_unchecked(input, 3, output) != 0) {
+            printf("unchecked_entry_unchecked failed\n");
+            return -1;
+        }
+    }
+    output.for_each_element([&](int x, int y) {
+        int correct = input(x + 1, y) - input(x, y) + 3;
+        if (output(x, y) != correct) {
+            printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+            exit(-1);
+        }
+    });
+
+    // The validation function should catch what the checked
+    // pipeline would have: an input that's too small, and a scalar
+    // out of range.
+    Buffer<int32_t> small_input(W, H);
+    if (unchecked_entry_validate(small_input, 3, output) == 0) {
+        printf("unchecked_entry_validate accepted an input that was too small\n");
+        return -1;
+    }
+    if (unchecked_entry_validate(input, 200, output) == 0) {
+        printf("unchecked_entry_validate accepted an out-of-range offset\n");
+        return -1;
+    }
+    if (error_count != 2) {
+        printf("Expected 2 errors, got %d\n", error_count);
+        return -1;
+    }
+
+    // Validating shouldn't have written anything to the output.
+    output.fill(0);
+    unchecked_entry_validate(input, 3, output);
+    if (output(0, 0) != 0) {
+        printf("unchecked_entry_validate ran the pipeline\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+namespace {
+
+class UncheckedEntry : public Halide::Generator<UncheckedEntry> {
+public:
+    Input<Buffer<int32_t>> input{"input", 2};
+    Input<int32_t>         offset{"offset", 0, 0, 100};
+
+    Output<Buffer<int32_t>> output{"output", 2};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = input(x + 1, y) - input(x, y) + offset;
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(UncheckedEntry, unchecked_entry)
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <cmath>
 #include <atomic>
 
 #include "variable_num_threads.h"
@@ -27,24 +28,42 @@ int main(int argc, char **argv) {
     // and in another we'll mess with the number of threads we want
     // running. The intent is to hunt for deadlocks.
 
-    halide_thread *t = halide_spawn_thread(&mess_with_num_threads, NULL);
+    // Do it once with the default thread pool, once in
+    // work-stealing mode, once in NUMA-aware mode, and then with idle
+    // workers spinning for a while or indefinitely.
+    for (int mode = 0; mode < 5; mode++) {
+        halide_set_work_stealing(mode == 1);
+        halide_set_numa_aware(mode == 2);
+        halide_set_worker_spin_count(mode == 3 ? 100 : mode == 4 ? -1 : 0);
+        stop = false;
 
-    Buffer<float> out(64, 64);
+        halide_thread *t = halide_spawn_thread(&mess_with_num_threads, NULL);
 
-    for (int i = 0; i < 1000; i++) {
-        // The number of threads will oscilate randomly, but the range
-        // will slowly ramp up and back down so you can watch it
-        // working in a process monitor.
-        max_threads = 1 + std::min(i, 1000-i) / 50;
-        int ret = variable_num_threads(out);
-        if (ret) {
-            printf("Non zero exit code: %d\n", ret);
-            return -1;
+        Buffer<float> out(64, 64);
+
+        for (int i = 0; i < 1000; i++) {
+            // The number of threads will oscilate randomly, but the range
+            // will slowly ramp up and back down so you can watch it
+            // working in a process monitor.
+            max_threads = 1 + std::min(i, 1000-i) / 50;
+            int ret = variable_num_threads(out);
+            if (ret) {
+                printf("Non zero exit code: %d\n", ret);
+                return -1;
+            }
         }
-    }
 
-    stop = true;
-    halide_join_thread(t);
+        stop = true;
+        halide_join_thread(t);
+
+        out.for_each_element([&](int x, int y) {
+            float correct = std::sqrt(std::sqrt((float)(x * y)));
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                exit(-1);
+            }
+        });
+    }
 
     printf("Success\n");
     return 0;
@@ -0,0 +1,56 @@
+#include "Halide.h"
+#include "halide_autotune.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+Buffer<float> input(2048, 2048);
+
+Pipeline make_pipeline() {
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+    blur_y.estimate(x, 0, 2040).estimate(y, 0, 2040);
+    return Pipeline(blur_y);
+}
+
+int main(int argc, char **argv) {
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (float)(rand() & 0xff);
+        }
+    }
+
+    Target target = get_jit_target_from_environment();
+    Buffer<float> out(2040, 2040);
+    auto run = [&](Pipeline p) { p.realize(out, target); };
+
+    // The default schedule, for comparison.
+    Pipeline p = make_pipeline();
+    p.auto_schedule(target);
+    p.compile_jit(target);
+    run(p);
+    double default_time = benchmark([&]() { run(p); });
+
+    AutotuneResult best = autotune(make_pipeline, run, target);
+    printf("Timed %d candidate schedules\n", best.candidates_timed);
+    printf("Default schedule: %fms, autotuned schedule: %fms with machine_params=%s\n",
+           default_time * 1e3, best.seconds * 1e3, best.params.to_string().c_str());
+
+    if (best.candidates_timed < 1 || best.schedule.empty()) {
+        printf("No schedule was found\n");
+        return -1;
+    }
+
+    // The default parameters are among the candidates, so the best
+    // should be no slower, up to timing noise.
+    if (best.seconds > default_time * 1.5) {
+        printf("Autotuned schedule is slower than the default\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
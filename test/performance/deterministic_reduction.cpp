@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include "halide_benchmark.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+int main(int argc, char **argv) {
+    const int W = 4096, H = 4096, buckets = 256;
+
+    Buffer<uint8_t> im(W, H);
+    Buffer<float> weight(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            im(x, y) = (uint8_t)rand();
+            weight(x, y) = (rand() % 1000) / 1000.0f;
+        }
+    }
+
+    Var x;
+    RDom r(im);
+    Expr value = weight(r.x, r.y);
+    Expr bucket = cast<int>(im(r.x, r.y));
+
+    // Parallel over rows, with atomic float adds into a shared histogram.
+    Func atomic_hist("atomic_hist");
+    atomic_hist(x) = 0.0f;
+    atomic_hist(bucket) += value;
+    RVar ro, ri;
+    atomic_hist.update().atomic().split(r.y, ro, ri, 16).parallel(ro);
+
+    // Parallel over chunks of rows, each into its own histogram, which
+    // are then combined in a fixed order.
+    Func det_hist("det_hist");
+    det_hist(x) = 0.0f;
+    det_hist(bucket) += value;
+    Func intm = det_hist.update().deterministic_parallel(r.y, 16);
+    intm.vectorize(x, 8);
+    intm.update(1).vectorize(x, 8);
+
+    Buffer<float> atomic_out(buckets), det_out(buckets);
+    atomic_hist.compile_jit();
+    det_hist.compile_jit();
+
+    double t_atomic = benchmark([&]() {
+        atomic_hist.realize(atomic_out);
+    });
+    double t_det = benchmark([&]() {
+        det_hist.realize(det_out);
+    });
+
+    printf("Atomic histogram: %f ms\n", t_atomic * 1e3);
+    printf("Deterministic histogram: %f ms\n", t_det * 1e3);
+
+    for (int i = 0; i < buckets; i++) {
+        if (std::abs(atomic_out(i) - det_out(i)) > 1e-3f * std::abs(atomic_out(i))) {
+            printf("det_hist(%d) = %f, but atomic_hist(%d) = %f\n", i, det_out(i), i, atomic_out(i));
+            return -1;
+        }
+    }
+
+    // The private histograms cost an extra pass over a few chunks'
+    // worth of bins, which shouldn't make it much slower.
+    if (t_det > 1.5 * t_atomic) {
+        printf("The deterministic histogram is too slow\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -19,7 +19,7 @@ extern "C" DLLEXPORT float pow_ref(float x, float y) {
 HalideExtern_2(float, pow_ref, float, float);
 
 int main(int argc, char **argv) {
-    Func f, g, h;
+    Func f, g, h, k;
     Var x, y;
 
     Param<int> pows_per_pixel;
@@ -28,19 +28,26 @@ int main(int argc, char **argv) {
     f(x, y) = sum(pow_ref((x+1)/512.0f, (y+1+s)/512.0f));
     g(x, y) = sum(pow((x+1)/512.0f, (y+1+s)/512.0f));
     h(x, y) = sum(fast_pow((x+1)/512.0f, (y+1+s)/512.0f));
+    // pow written in terms of exp and log, with the least precise
+    // approximations of those.
+    k(x, y) = sum(exp(log((x+1)/512.0f) * ((y+1+s)/512.0f)));
+    k.approximate_math(128);
     f.vectorize(x, 8);
     g.vectorize(x, 8);
     h.vectorize(x, 8);
+    k.vectorize(x, 8);
 
     Buffer<float> correct_result(2048, 768);
     Buffer<float> fast_result(2048, 768);
     Buffer<float> faster_result(2048, 768);
+    Buffer<float> approx_result(2048, 768);
 
     pows_per_pixel.set(1);
 
     f.realize(correct_result);
     g.realize(fast_result);
     h.realize(faster_result);
+    k.realize(approx_result);
 
     pows_per_pixel.set(20);
 
@@ -50,28 +57,35 @@ int main(int argc, char **argv) {
     double t1 = 1e3 * benchmark([&]() { f.realize(timing_scratch); });
     double t2 = 1e3 * benchmark([&]() { g.realize(timing_scratch); });
     double t3 = 1e3 * benchmark([&]() { h.realize(timing_scratch); });
+    double t4 = 1e3 * benchmark([&]() { k.realize(timing_scratch); });
 
     RDom r(correct_result);
-    Func fast_error, faster_error;
+    Func fast_error, faster_error, approx_error;
     Expr fast_delta = correct_result(r.x, r.y) - fast_result(r.x, r.y);
     Expr faster_delta = correct_result(r.x, r.y) - faster_result(r.x, r.y);
+    Expr approx_delta = correct_result(r.x, r.y) - approx_result(r.x, r.y);
     fast_error() += cast<double>(fast_delta * fast_delta);
     faster_error() += cast<double>(faster_delta * faster_delta);
+    approx_error() += cast<double>(approx_delta * approx_delta);
 
     Buffer<double> fast_err = fast_error.realize();
     Buffer<double> faster_err = faster_error.realize();
+    Buffer<double> approx_err = approx_error.realize();
 
     int timing_N = timing_scratch.width() * timing_scratch.height() * 10;
     int correctness_N = fast_result.width() * fast_result.height();
     fast_err(0) = sqrt(fast_err(0)/correctness_N);
     faster_err(0) = sqrt(faster_err(0)/correctness_N);
+    approx_err(0) = sqrt(approx_err(0)/correctness_N);
 
     printf("powf: %f ns per pixel\n"
            "Halide's pow: %f ns per pixel (rms error = %0.10f)\n"
-           "Halide's fast_pow: %f ns per pixel (rms error = %0.10f)\n",
+           "Halide's fast_pow: %f ns per pixel (rms error = %0.10f)\n"
+           "exp(log) with approximate math: %f ns per pixel (rms error = %0.10f)\n",
            1000000*t1 / timing_N,
            1000000*t2 / timing_N, fast_err(0),
-           1000000*t3 / timing_N, faster_err(0));
+           1000000*t3 / timing_N, faster_err(0),
+           1000000*t4 / timing_N, approx_err(0));
 
     if (fast_err(0) > 0.000001) {
         printf("Error for pow too large\n");
@@ -83,6 +97,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    if (approx_err(0) > 0.0001) {
+        printf("Error for exp(log) with approximate math too large\n");
+        return -1;
+    }
+
     if (t1 < t2) {
         printf("powf is faster than Halide's pow\n");
         return -1;
@@ -0,0 +1,43 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+int max_tasks = 0;
+float task_ms = 0, idle_ms = 0;
+void my_print(void *, const char *msg) {
+    const char *tasks = strstr(msg, " tasks: ");
+    if (strstr(msg, " slow:") && tasks) {
+        sscanf(tasks, " tasks: %d task time: %fms idle: %fms", &max_tasks, &task_ms, &idle_ms);
+    }
+}
+
+int main(int argc, char **argv) {
+    // A parallel loop where the last few rows are much more expensive
+    // than the rest, so most of the threads end up waiting on them.
+    Func slow("slow"), out("out");
+    Var x, y;
+    Expr e = cast<float>(x + y);
+    for (int i = 0; i < 100; i++) {
+        e = sin(e);
+    }
+    slow(x, y) = select(y > 60, e, 0.0f);
+    out(x, y) = slow(x, y) * 2.0f;
+    slow.compute_root().parallel(y);
+
+    out.set_custom_print(&my_print);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    out.realize(10000, 64, t);
+
+    printf("slow: up to %d tasks, %fms in tasks, %fms idle\n", max_tasks, task_ms, idle_ms);
+
+    if (max_tasks < 1 || task_ms <= 0) {
+        printf("No time was attributed to the parallel tasks of slow\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
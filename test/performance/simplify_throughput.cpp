@@ -0,0 +1,81 @@
+#include "Halide.h"
+#include <iostream>
+#include <stdio.h>
+
+#include "halide_benchmark.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+using namespace Halide::Tools;
+
+// Measures how fast the simplifier chews through the lowered IR of a
+// few representative pipelines.
+
+Stmt lowered_body(Pipeline p, const std::vector<Argument> &args, const std::string &name) {
+    Module m = p.compile_to_module(args, name, get_host_target().with_feature(Target::NoAsserts));
+    for (const auto &f : m.functions()) {
+        if (f.name == name) {
+            return f.body;
+        }
+    }
+    return Stmt();
+}
+
+Stmt blur() {
+    ImageParam in(UInt(16), 2);
+    Func bx("bx"), by("by");
+    Var x, y, xi, yi;
+    bx(x, y) = (in(x, y) + in(x + 1, y) + in(x + 2, y)) / 3;
+    by(x, y) = (bx(x, y) + bx(x, y + 1) + bx(x, y + 2)) / 3;
+    by.tile(x, y, xi, yi, 256, 32).vectorize(xi, 8).parallel(y);
+    bx.compute_at(by, x).vectorize(x, 8);
+    return lowered_body(Pipeline(by), {in}, "blur");
+}
+
+Stmt pyramid() {
+    const int levels = 6;
+    ImageParam in(Float(32), 2);
+    Func clamped = BoundaryConditions::repeat_edge(in);
+    Var x, y;
+
+    std::vector<Func> down(levels), up(levels);
+    down[0](x, y) = clamped(x, y);
+    for (int i = 1; i < levels; i++) {
+        Func dx;
+        dx(x, y) = (down[i - 1](2 * x - 1, y) + 2 * down[i - 1](2 * x, y) + down[i - 1](2 * x + 1, y)) / 4;
+        down[i](x, y) = (dx(x, 2 * y - 1) + 2 * dx(x, 2 * y) + dx(x, 2 * y + 1)) / 4;
+    }
+    up[levels - 1](x, y) = down[levels - 1](x, y);
+    for (int i = levels - 2; i >= 0; i--) {
+        up[i](x, y) = down[i](x, y) + (up[i + 1](x / 2, y / 2) + up[i + 1]((x + 1) / 2, (y + 1) / 2)) / 2;
+    }
+    for (int i = 0; i < levels; i++) {
+        down[i].compute_root().vectorize(x, 8).parallel(y, 8);
+        up[i].compute_root().vectorize(x, 8).parallel(y, 8);
+    }
+    return lowered_body(Pipeline(up[0]), {in}, "pyramid");
+}
+
+int main(int argc, char **argv) {
+    struct Case {
+        const char *name;
+        Stmt body;
+    } cases[] = {{"blur", blur()}, {"pyramid", pyramid()}};
+
+    for (const Case &c : cases) {
+        if (!c.body.defined()) {
+            printf("Could not find the lowered body of %s\n", c.name);
+            return -1;
+        }
+        Stmt result;
+        double t = benchmark(3, 10, [&]() { result = simplify(c.body); });
+        std::cout << "Simplifying " << c.name << ": " << t * 1e3 << "ms\n";
+        if (!result.defined()) {
+            printf("Simplifier returned an undefined Stmt\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
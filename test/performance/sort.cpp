@@ -172,6 +172,17 @@ int main(int argc, char **argv) {
         f.realize(merge_sorted);
     });
 
+    printf("Halide::sort...\n");
+    f = sort(input, N);
+    f.bound(x, 0, N);
+    f.compile_jit();
+    printf("Running...\n");
+    Buffer<int> library_sorted(N);
+    f.realize(library_sorted);
+    double t_library = benchmark([&]() {
+        f.realize(library_sorted);
+    });
+
     Buffer<int> correct(N);
     for (int i = 0; i < N; i++) {
         correct(i) = data(i);
@@ -184,13 +195,14 @@ int main(int argc, char **argv) {
     printf("Times:\n"
            "bitonic sort: %fms \n"
            "merge sort: %fms \n"
+           "Halide::sort: %fms \n"
            "std::sort %fms\n",
-           t_bitonic * 1e3, t_merge * 1e3, t_std * 1e3);
+           t_bitonic * 1e3, t_merge * 1e3, t_library * 1e3, t_std * 1e3);
 
     if (N <= 100) {
         for (int i = 0; i < N; i++) {
-            printf("%8d %8d %8d\n",
-                   correct(i), bitonic_sorted(i), merge_sorted(i));
+            printf("%8d %8d %8d %8d\n",
+                   correct(i), bitonic_sorted(i), merge_sorted(i), library_sorted(i));
         }
     }
 
@@ -203,6 +215,10 @@ int main(int argc, char **argv) {
             printf("merge sort failed: %d -> %d instead of %d\n", i, merge_sorted(i), correct(i));
             return -1;
         }
+        if (library_sorted(i) != correct(i)) {
+            printf("Halide::sort failed: %d -> %d instead of %d\n", i, library_sorted(i), correct(i));
+            return -1;
+        }
     }
 
     return 0;
@@ -90,6 +90,73 @@ bool test(int vec_width) {
     return true;
 }
 
+// Compare AVX-512 code using the full 512-bit vectors against the
+// same code capped at 256 bits with the avx512_256 feature. Which
+// one wins depends on how much of a program is vectorized, because
+// 512-bit vectors lower the clock speed of the whole core, so this
+// only reports the times.
+template<typename A>
+bool test_avx512_256() {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::AVX512) &&
+        !t.has_feature(Target::AVX512_KNL) &&
+        !t.has_feature(Target::AVX512_Skylake) &&
+        !t.has_feature(Target::AVX512_Cannonlake) &&
+        !t.has_feature(Target::AVX512_VNNI)) {
+        return true;
+    }
+    Target t512 = t.without_feature(Target::AVX512_256);
+    Target t256 = t.with_feature(Target::AVX512_256);
+
+    const int W = 1024, H = 1000;
+    Buffer<A> input(W, H + 20);
+    for (int y = 0; y < H + 20; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = Internal::safe_numeric_cast<A>((rand() & 0xffff)*0.125 + 1.0);
+        }
+    }
+
+    Var x, y;
+    auto make = [&](const Target &target) {
+        Expr e = input(x, y);
+        for (int i = 1; i < 10; i++) {
+            e = e + input(x, y + i);
+        }
+        Func f;
+        f(x, y) = e;
+        f.vectorize(x, target.natural_vector_size<A>());
+        f.compile_jit(target);
+        return f;
+    };
+    Func f512 = make(t512), f256 = make(t256);
+
+    Buffer<A> out512 = f512.realize(W, H);
+    Buffer<A> out256 = f256.realize(W, H);
+
+    double t_512 = benchmark([&]() {
+        f512.realize(out512);
+    });
+    double t_256 = benchmark([&]() {
+        f256.realize(out256);
+    });
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (out512(x, y) != out256(x, y)) {
+                printf("%s avx512_256 failed at %d %d: %d vs %d\n",
+                       string_of_type<A>(), x, y,
+                       (int)out512(x, y), (int)out256(x, y));
+                return false;
+            }
+        }
+    }
+
+    printf("512-bit vs 256-bit AVX-512 vectors (%s): %1.3gms %1.3gms\n",
+           string_of_type<A>(), t_512 * 1e3, t_256 * 1e3);
+
+    return true;
+}
+
 int main(int argc, char **argv) {
 
     bool ok = true;
@@ -105,6 +172,9 @@ int main(int argc, char **argv) {
     ok = ok && test<uint32_t>(4);
     ok = ok && test<int32_t>(4);
 
+    ok = ok && test_avx512_256<float>();
+    ok = ok && test_avx512_256<uint16_t>();
+
     if (!ok) return -1;
     printf("Success!\n");
     return 0;
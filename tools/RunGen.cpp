@@ -3,8 +3,10 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -12,6 +14,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 extern "C" int halide_rungen_redirect_argv(void **args);
@@ -48,6 +51,9 @@ std::ostream &operator<<(std::ostream &stream, const halide_type_t &type) {
         case halide_type_handle:
             stream << "handle";
             break;
+        case halide_type_bfloat:
+            stream << "bfloat";
+            break;
         default:
             stream << "#unknown";
             break;
@@ -730,6 +736,103 @@ uint64_t calc_pixels_out(const std::map<std::string, ArgData> &args) {
     return pixels_out;
 }
 
+// Call the filter and wait for all of its outputs to be finished, otherwise
+// we may just be measuring how long it takes to do a kernel launch for GPU code.
+void run_and_sync(std::vector<void*> &filter_argv, std::map<std::string, ArgData> &args) {
+    // Ignore result since our halide_error() should catch everything.
+    (void) halide_rungen_redirect_argv(&filter_argv[0]);
+    for (auto &arg_pair : args) {
+        auto &arg = arg_pair.second;
+        if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+            Buffer<> &b = arg.buffer_value;
+            b.device_sync();
+        }
+    }
+}
+
+struct ConcurrentBenchmarkResult {
+    uint64_t calls{0};
+    double wall_time{0};      // total elapsed seconds, over all threads
+    double p50{0}, p99{0}, p999{0};  // per-call latency percentiles, in seconds
+};
+
+// Run the filter in a loop on 'concurrency' threads at once, each with its own
+// copy of every buffer, until each thread has run for at least min_time and
+// made at least min_iters calls (or max_iters calls).
+ConcurrentBenchmarkResult concurrent_benchmark(const std::map<std::string, ArgData> &args,
+                                               int concurrency,
+                                               const BenchmarkConfig &config) {
+    using BenchmarkClock = Halide::Tools::SteadyClock<>::type;
+
+    std::vector<std::map<std::string, ArgData>> thread_args(concurrency, args);
+    for (auto &a : thread_args) {
+        for (auto &arg_pair : a) {
+            auto &arg = arg_pair.second;
+            if (arg.metadata->kind == halide_argument_kind_input_buffer ||
+                arg.metadata->kind == halide_argument_kind_output_buffer) {
+                Buffer<> b = allocate_buffer(arg.buffer_value.type(), get_shape(arg.buffer_value));
+                b.copy_from(arg.buffer_value);
+                arg.buffer_value = b;
+            }
+        }
+    }
+
+    std::vector<std::vector<double>> latencies(concurrency);
+    std::vector<std::thread> threads;
+    auto start = BenchmarkClock::now();
+    for (int t = 0; t < concurrency; t++) {
+        threads.emplace_back([&, t]() {
+            auto &a = thread_args[t];
+            std::vector<void*> filter_argv(a.size(), nullptr);
+            for (auto &arg_pair : a) {
+                auto &arg = arg_pair.second;
+                switch (arg.metadata->kind) {
+                    case halide_argument_kind_input_scalar:
+                        filter_argv[arg.index] = &arg.scalar_value;
+                        break;
+                    case halide_argument_kind_input_buffer:
+                    case halide_argument_kind_output_buffer:
+                        filter_argv[arg.index] = arg.buffer_value.raw_buffer();
+                        break;
+                }
+            }
+
+            auto thread_start = BenchmarkClock::now();
+            double elapsed = 0;
+            while (latencies[t].size() < config.max_iters &&
+                   (elapsed < config.min_time || latencies[t].size() < config.min_iters)) {
+                auto call_start = BenchmarkClock::now();
+                run_and_sync(filter_argv, a);
+                auto call_end = BenchmarkClock::now();
+                latencies[t].push_back(std::chrono::duration_cast<std::chrono::duration<double>>(call_end - call_start).count());
+                elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(call_end - thread_start).count();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    auto end = BenchmarkClock::now();
+
+    std::vector<double> all;
+    for (auto &l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    ConcurrentBenchmarkResult result;
+    result.calls = all.size();
+    result.wall_time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    const auto percentile = [&all](double p) {
+        size_t i = std::min(all.size() - 1, (size_t) (p * all.size()));
+        return all[i];
+    };
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    return result;
+}
+
 void usage(const char *argv0) {
 const std::string usage = R"USAGE(
 Usage: $NAME$ argument=value [argument=value... ] [flags]
@@ -808,11 +911,30 @@ Flags:
         Override the default maximum number of benchmarking iterations; ignored
         if --benchmarks is not also specified.
 
+    --concurrency=NUM [default = 1]:
+        Benchmark throughput by running the filter on NUM client threads at
+        once, each with its own copy of the inputs and outputs, rather than
+        timing one call at a time. Each thread calls the filter in a loop
+        for --benchmark_min_time seconds and --benchmark_min_iters calls; the
+        aggregate throughput and the 50th, 99th and 99.9th percentile call
+        latencies are reported. Combine with HL_NUM_THREADS to trade off
+        parallelism within a call against concurrent calls. Ignored if
+        --benchmarks is not also specified.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
         benchmarks may be inaccurate if you combine --benchmark with this.
 
+    --record_shapes=PATH:
+        Append a line to PATH giving the extents of each buffer argument and
+        the value of each scalar argument of this run, e.g.
+
+            input=[1920,1080,3] output=[1920,1080,3] sigma=1.5
+
+        Passing the file to GenGen with -p specializes each output for the
+        shapes it was most often run with.
+
 Known Issues:
 
     * Filters running on GPU (vs CPU) have not been tested.
@@ -825,6 +947,32 @@ Known Issues:
     std::cout << replace_all(usage, "$NAME$", basename);
 }
 
+// Append the shapes and values of this run's arguments to a profile
+// for GenGen's -p flag.
+void record_shapes(const std::string &path, const std::map<std::string, ArgData> &args) {
+    std::ostringstream line;
+    const char *sep = "";
+    for (const auto &arg_pair : args) {
+        const auto &arg = arg_pair.second;
+        line << sep << arg_pair.first << "=";
+        sep = " ";
+        if (arg.metadata->kind == halide_argument_kind_input_scalar) {
+            line << arg.raw_string;
+        } else {
+            line << "[";
+            for (int d = 0; d < arg.buffer_value.dimensions(); d++) {
+                line << (d > 0 ? "," : "") << arg.buffer_value.dim(d).extent();
+            }
+            line << "]";
+        }
+    }
+    std::ofstream f(path, std::ios::app);
+    if (!f.is_open()) {
+        fail() << "Unable to open shape profile: " << path;
+    }
+    f << line.str() << "\n";
+}
+
 void do_describe(const halide_filter_metadata_t *md) {
     std::cout << "Filter name: \"" << md->name << "\"\n";
     for (size_t i = 0; i < (size_t) md->num_arguments; ++i) {
@@ -909,6 +1057,8 @@ int main(int argc, char **argv) {
     double benchmark_min_time = BenchmarkConfig().min_time;
     uint64_t benchmark_min_iters = BenchmarkConfig().min_iters;
     uint64_t benchmark_max_iters = BenchmarkConfig().max_iters;
+    int concurrency = 1;
+    std::string record_shapes_path;
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] == '-') {
             const char *p = argv[i] + 1; // skip -
@@ -966,8 +1116,17 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_max_iters)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "concurrency") {
+                if (!parse_scalar(flag_value, &concurrency) || concurrency < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "output_extents") {
                 default_output_shape = parse_extents(flag_value);
+            } else if (flag_name == "record_shapes") {
+                if (flag_value.empty()) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                record_shapes_path = flag_value;
             } else {
                 usage(argv[0]);
                 fail() << "Unknown flag: " << flag_name;
@@ -1090,6 +1249,10 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (!record_shapes_path.empty()) {
+        record_shapes(record_shapes_path, args);
+    }
+
     uint64_t pixels_out = calc_pixels_out(args);
     double megapixels = (double) pixels_out / (1024.0 * 1024.0);
 
@@ -1114,19 +1277,26 @@ int main(int argc, char **argv) {
             }
         }
 
-        if (benchmark) {
+        if (benchmark && concurrency > 1) {
+            info() << "Benchmarking filter on " << concurrency << " threads...";
+
+            BenchmarkConfig config;
+            config.min_time = benchmark_min_time;
+            config.min_iters = benchmark_min_iters;
+            config.max_iters = benchmark_max_iters;
+            auto result = concurrent_benchmark(args, concurrency, config);
+
+            std::cout << "Concurrent benchmark for " << md->name << " with " << concurrency << " threads made "
+                << result.calls << " calls in " << result.wall_time << " sec.\n";
+            std::cout << "Throughput is " << (result.calls / result.wall_time) << " calls/sec, "
+                << (megapixels * result.calls / result.wall_time) << " mpix/sec.\n";
+            std::cout << "Latency is " << result.p50 << " sec (p50), "
+                << result.p99 << " sec (p99), "
+                << result.p999 << " sec (p999).\n";
+
+        } else if (benchmark) {
             const auto benchmark_inner = [&filter_argv, &args]() {
-                // Ignore result since our halide_error() should catch everything.
-                (void) halide_rungen_redirect_argv(&filter_argv[0]);
-                // Ensure that all outputs are finished, otherwise we may just be
-                // measuring how long it takes to do a kernel launch for GPU code.
-                for (auto &arg_pair : args) {
-                    auto &arg = arg_pair.second;
-                    if (arg.metadata->kind == halide_argument_kind_output_buffer) {
-                        Buffer<> &b = arg.buffer_value;
-                        b.device_sync();
-                    }
-                }
+                run_and_sync(filter_argv, args);
             };
 
             info() << "Benchmarking filter...";
@@ -1136,6 +1306,7 @@ int main(int argc, char **argv) {
             config.max_time = benchmark_min_time * 4;
             config.min_iters = benchmark_min_iters;
             config.max_iters = benchmark_max_iters;
+            config.name = md->name;
             auto result = Halide::Tools::benchmark(benchmark_inner, config);
 
             std::cout << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
@@ -1143,6 +1314,11 @@ int main(int argc, char **argv) {
                 << result.iterations << " iterations, "
                 << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n";
             std::cout << "Best output throughput is " << (megapixels / result.wall_time) << " mpix/sec.\n";
+            std::cout << "Median is " << result.median << " sec/iter, mean " << result.mean
+                << " sec/iter with stddev " << result.stddev << " (" << result.outliers << " outlier samples rejected).\n";
+            if (result.frequency_scaling) {
+                warn() << "CPU frequency scaling is enabled; benchmark results may be noisy.";
+            }
 
         } else {
             info() << "Running filter...";
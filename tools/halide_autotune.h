@@ -0,0 +1,133 @@
+#ifndef HALIDE_AUTOTUNE_H
+#define HALIDE_AUTOTUNE_H
+
+/** \file
+ * An autotuning mode for the auto-scheduler. Rather than trusting the
+ * cost model's choice of grouping and tiling, this generates a
+ * candidate schedule for each of a range of machine parameters around
+ * a base set, JIT-compiles each distinct candidate, times it with
+ * halide_benchmark.h, and keeps the fastest.
+ *
+ * The pipeline is built by a callback, because the auto-scheduler
+ * applies its schedule to the Funcs it is given: each candidate needs
+ * a fresh copy of the algorithm. For example:
+ *
+ \code
+ Halide::Tools::AutotuneResult best = Halide::Tools::autotune(
+     []() { return make_my_pipeline(); },
+     [](Halide::Pipeline p) { p.realize(output); },
+     target);
+ Halide::Tools::save_schedule("my_pipeline.schedule", best);
+ \endcode
+ *
+ * The winning schedule is the source form printed by
+ * Pipeline::auto_schedule, so it can be checked in as a hand schedule
+ * would be. The winning machine parameters can be passed to a
+ * Generator with auto_schedule=true machine_params=<params> to get the
+ * same schedule back.
+ */
+
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Halide.h"
+#include "halide_benchmark.h"
+
+namespace Halide {
+namespace Tools {
+
+struct AutotuneResult {
+    // The machine parameters that produced the fastest schedule.
+    MachineParams params{MachineParams::generic()};
+
+    // The fastest schedule, as source.
+    std::string schedule;
+
+    // The time of one run of the fastest schedule, in seconds.
+    double seconds{0};
+
+    // The number of distinct schedules that were compiled and timed.
+    int candidates_timed{0};
+};
+
+// The candidates searched by default: the last level cache size and
+// balance of 'base' each scaled by 1/4, 1/2, 1, 2 and 4. These move the
+// greedy grouping across its tile size and inlining choices.
+inline std::vector<MachineParams> autotune_candidates(const MachineParams &base) {
+    assert(Internal::as_const_int(base.last_level_cache_size) &&
+           Internal::as_const_int(base.balance) &&
+           Internal::as_const_int(base.parallelism));
+    const int64_t base_llc = *Internal::as_const_int(base.last_level_cache_size);
+    const int64_t base_balance = *Internal::as_const_int(base.balance);
+    const int64_t base_parallelism = *Internal::as_const_int(base.parallelism);
+
+    std::vector<MachineParams> candidates;
+    const double scales[] = {1.0, 0.25, 0.5, 2.0, 4.0};
+    for (double llc_scale : scales) {
+        for (double balance_scale : scales) {
+            int32_t l = (int32_t)std::max((int64_t)1024, (int64_t)(base_llc * llc_scale));
+            int32_t b = (int32_t)std::max((int64_t)1, (int64_t)(base_balance * balance_scale));
+            candidates.push_back(MachineParams((int32_t)base_parallelism, l, b));
+        }
+    }
+    return candidates;
+}
+
+// Auto-schedule a fresh pipeline from 'make_pipeline' with each of
+// 'candidates', time running it with 'run', and return the fastest.
+// Candidates that produce a schedule already timed are skipped.
+inline AutotuneResult autotune(std::function<Pipeline()> make_pipeline,
+                               std::function<void(Pipeline)> run,
+                               const Target &target,
+                               const std::vector<MachineParams> &candidates,
+                               const BenchmarkConfig &config = {}) {
+    AutotuneResult best;
+    std::set<std::string> seen;
+    for (const MachineParams &params : candidates) {
+        Pipeline p = make_pipeline();
+        std::string schedule = p.auto_schedule(target, params);
+        if (!seen.insert(schedule).second) {
+            continue;
+        }
+        p.compile_jit(target);
+        // Run once untimed, to get any allocations and device copies
+        // out of the way.
+        run(p);
+        double t = benchmark([&]() { run(p); }, config);
+        best.candidates_timed++;
+        if (best.candidates_timed == 1 || t < best.seconds) {
+            best.params = params;
+            best.schedule = schedule;
+            best.seconds = t;
+        }
+    }
+    return best;
+}
+
+inline AutotuneResult autotune(std::function<Pipeline()> make_pipeline,
+                               std::function<void(Pipeline)> run,
+                               const Target &target,
+                               const MachineParams &base = MachineParams::generic(),
+                               const BenchmarkConfig &config = {}) {
+    return autotune(make_pipeline, run, target, autotune_candidates(base), config);
+}
+
+// Write a schedule found by autotune to a file, with the machine
+// parameters that reproduce it. Returns false if the file couldn't be
+// written.
+inline bool save_schedule(const std::string &filename, const AutotuneResult &result) {
+    std::ofstream f(filename);
+    f << "// Autotuned schedule, " << result.seconds * 1e3 << "ms per run\n"
+      << "// machine_params=" << result.params.to_string() << "\n"
+      << result.schedule;
+    return f.good();
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif
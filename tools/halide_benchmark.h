@@ -4,8 +4,15 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace Halide {
 namespace Tools {
@@ -59,11 +66,16 @@ inline double benchmark(uint64_t samples, uint64_t iterations, std::function<voi
 // has elapsed, with the constraint of at least min_iters and no more than
 // max_iters times; the number of iterations is expanded as we
 // progress (based on initial runs of 'op') to minimize overhead. The time
-// reported will be that of the best single iteration.
+// reported will be that of the best single iteration; statistics over
+// all of the samples taken are reported alongside it.
 //
 // Most callers should be able to get good results without needing to specify
 // custom BenchmarkConfig values.
 //
+// If the environment variable HL_BENCHMARK_JSON is set to a filename, each
+// result is also appended to that file as one line of JSON, so that a suite
+// of benchmarks can be tracked over time.
+//
 // IMPORTANT NOTE: Using this tool for timing GPU code may be misleading,
 // as it does not account for time needed to synchronize to/from the GPU;
 // if the callback doesn't include calls to device_sync(), the reported
@@ -94,31 +106,166 @@ struct BenchmarkConfig {
     // this. Controls accuracy. The closer to zero this gets the more
     // reliable the answer, but the longer it may take to run.
     double accuracy{0.03};
+
+    // Run the operation this many times before taking any samples, so
+    // that one-time costs (JIT compilation, first-touch page faults,
+    // cold caches) aren't measured.
+    uint64_t warmup_iters{1};
+
+    // Take at least this many samples (and never fewer than three). More
+    // samples make the mean, stddev and percentiles more meaningful.
+    uint64_t min_samples{3};
+
+    // Samples further from the median than this many standard deviations
+    // (estimated robustly, from the median absolute deviation) are
+    // rejected as outliers when computing the mean and stddev.
+    double outlier_threshold{3.5};
+
+    // A name for the benchmark, used to identify it in JSON output.
+    std::string name;
 };
 
 struct BenchmarkResult {
     // Best elapsed wall-clock time per iteration (seconds).
-    double wall_time;
+    double wall_time{0};
 
     // Number of samples used for measurement.
     // (There might be additional samples taken that are not used
     // for measurement.)
-    uint64_t samples;
+    uint64_t samples{0};
 
     // Total number of iterations across all samples.
     // (There might be additional iterations taken that are not used
     // for measurement.)
-    uint64_t iterations;
+    uint64_t iterations{0};
 
     // Measured accuracy between the best and third-best result.
     // Will be <= config.accuracy unless max_iters is exceeded.
-    double accuracy;
+    double accuracy{0};
+
+    // Statistics of the time per iteration over the samples used for
+    // measurement (seconds). The mean and stddev exclude outliers; the
+    // median and percentiles include them.
+    double mean{0}, median{0}, stddev{0}, p90{0}, p99{0};
+
+    // Number of samples rejected as outliers.
+    uint64_t outliers{0};
+
+    // The relative change in the median time per iteration between the
+    // first and second halves of the samples. Large values suggest the
+    // machine changed speed (e.g. thermal throttling) while measuring.
+    double drift{0};
+
+    // Whether the OS may change the CPU clock frequency while measuring
+    // (on Linux, whether any cpufreq governor isn't "performance").
+    bool frequency_scaling{false};
 
     operator double() const { return wall_time; }
 };
 
+// Returns true if the CPU clock frequency is known to be under the
+// control of a governor that may change it. Only Linux is detected.
+inline bool cpu_frequency_scaling_enabled() {
+    for (int cpu = 0; cpu < 4096; cpu++) {
+        std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_governor");
+        if (!f) {
+            break;
+        }
+        std::string governor;
+        f >> governor;
+        if (governor != "performance") {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the value a fraction p of the way through a sorted list,
+// interpolating linearly between neighboring values.
+inline double benchmark_percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    double pos = p * (sorted.size() - 1);
+    size_t i = (size_t)pos;
+    if (i + 1 >= sorted.size()) {
+        return sorted.back();
+    }
+    return sorted[i] + (pos - i) * (sorted[i + 1] - sorted[i]);
+}
+
+// Format a result as a single-line JSON object.
+inline std::string benchmark_result_to_json(const std::string &name, const BenchmarkResult &r) {
+    std::ostringstream o;
+    o << std::setprecision(9) << "{\"name\": \"";
+    for (char c : name) {
+        if (c == '"' || c == '\\') {
+            o << '\\';
+        }
+        o << c;
+    }
+    o << "\", \"wall_time\": " << r.wall_time
+      << ", \"mean\": " << r.mean
+      << ", \"median\": " << r.median
+      << ", \"stddev\": " << r.stddev
+      << ", \"p90\": " << r.p90
+      << ", \"p99\": " << r.p99
+      << ", \"samples\": " << r.samples
+      << ", \"iterations\": " << r.iterations
+      << ", \"outliers\": " << r.outliers
+      << ", \"accuracy\": " << r.accuracy
+      << ", \"drift\": " << r.drift
+      << ", \"frequency_scaling\": " << (r.frequency_scaling ? "true" : "false")
+      << "}";
+    return o.str();
+}
+
+// Fill in the statistics of a result from its samples, in the order
+// they were taken.
+inline void compute_benchmark_statistics(const std::vector<double> &times, double outlier_threshold,
+                                         BenchmarkResult *result) {
+    std::vector<double> sorted(times);
+    std::sort(sorted.begin(), sorted.end());
+    result->median = benchmark_percentile(sorted, 0.5);
+    result->p90 = benchmark_percentile(sorted, 0.9);
+    result->p99 = benchmark_percentile(sorted, 0.99);
+
+    std::vector<double> deviations;
+    for (double t : times) {
+        deviations.push_back(std::abs(t - result->median));
+    }
+    std::sort(deviations.begin(), deviations.end());
+    // Scale the median absolute deviation to estimate the standard
+    // deviation of normally-distributed samples.
+    const double sigma = 1.4826 * benchmark_percentile(deviations, 0.5);
+
+    double sum = 0, sum_sq = 0;
+    uint64_t kept = 0;
+    for (double t : times) {
+        if (sigma > 0 && std::abs(t - result->median) > outlier_threshold * sigma) {
+            result->outliers++;
+            continue;
+        }
+        sum += t;
+        sum_sq += t * t;
+        kept++;
+    }
+    result->mean = sum / kept;
+    result->stddev = kept > 1 ? std::sqrt(std::max(0.0, (sum_sq - sum * sum / kept) / (kept - 1))) : 0;
+
+    const size_t half = times.size() / 2;
+    if (half > 0) {
+        std::vector<double> early(times.begin(), times.begin() + half);
+        std::vector<double> late(times.end() - half, times.end());
+        std::sort(early.begin(), early.end());
+        std::sort(late.begin(), late.end());
+        const double early_median = benchmark_percentile(early, 0.5);
+        result->drift = (benchmark_percentile(late, 0.5) - early_median) / early_median;
+    }
+}
+
 inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig& config = {}) {
-    BenchmarkResult result{0, 0, 0};
+    BenchmarkResult result;
 
     const double min_time = std::max(10 * 1e-6, config.min_time);
     const double max_time = std::max(config.min_time, config.max_time);
@@ -129,11 +276,19 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
             std::max(config.min_iters, config.max_iters), kBenchmarkMaxIterations);
     const double accuracy = 1.0 + std::min(std::max(0.001, config.accuracy), 0.1);
 
-    // We will do (at least) kMinSamples samples; we will do additional
-    // samples until the best the kMinSamples'th results are within the
-    // accuracy tolerance (or we run out of iterations).
+    // We will do (at least) min_samples samples; we will do additional
+    // samples until the best and the kMinSamples'th results are within
+    // the accuracy tolerance (or we run out of iterations).
     constexpr int kMinSamples = 3;
-    double times[kMinSamples + 1] = {0};
+    const uint64_t min_samples = std::max((uint64_t)kMinSamples, config.min_samples);
+
+    for (uint64_t i = 0; i < config.warmup_iters; i++) {
+        op();
+    }
+
+    // The time per iteration of each sample, in the order they were
+    // taken, and sorted.
+    std::vector<double> times, sorted;
 
     double total_time = 0;
     uint64_t iters_per_sample = min_iters;
@@ -141,18 +296,20 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
         result.samples = 0;
         result.iterations = 0;
         total_time = 0;
-        for (int i = 0; i < kMinSamples; i++) {
-            times[i] = benchmark(1, iters_per_sample, op);
+        times.clear();
+        for (uint64_t i = 0; i < min_samples; i++) {
+            times.push_back(benchmark(1, iters_per_sample, op));
             result.samples++;
             result.iterations += iters_per_sample;
-            total_time += times[i] * iters_per_sample;
+            total_time += times.back() * iters_per_sample;
         }
-        std::sort(times, times + kMinSamples);
-        if (times[0] * iters_per_sample * kMinSamples >= min_time) {
+        sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        if (sorted[0] * iters_per_sample * min_samples >= min_time) {
             break;
         }
         // Use an estimate based on initial times to converge faster.
-        double next_iters = std::max(min_time / std::max(times[0] * kMinSamples, 1e-9),
+        double next_iters = std::max(min_time / std::max(sorted[0] * min_samples, 1e-9),
                                                                  iters_per_sample * 2.0);
         iters_per_sample = (uint64_t)(next_iters + 0.5);
     }
@@ -162,17 +319,28 @@ inline BenchmarkResult benchmark(std::function<void()> op, const BenchmarkConfig
     // - No matter what, don't go over max_iters or max_time; this is important, in case
     // we happen to get faster results for the first samples, then happen to transition
     // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
+    while ((sorted[0] * accuracy < sorted[kMinSamples - 1] || total_time < min_time) &&
                  total_time < max_time &&
                  result.iterations < max_iters) {
-        times[kMinSamples] = benchmark(1, iters_per_sample, op);
+        times.push_back(benchmark(1, iters_per_sample, op));
         result.samples++;
         result.iterations += iters_per_sample;
-        total_time += times[kMinSamples] * iters_per_sample;
-        std::sort(times, times + kMinSamples + 1);
+        total_time += times.back() * iters_per_sample;
+        sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), times.back()), times.back());
+    }
+    result.wall_time = sorted[0];
+    result.accuracy = (sorted[kMinSamples - 1] / sorted[0]) - 1.0;
+
+    compute_benchmark_statistics(times, config.outlier_threshold, &result);
+    result.frequency_scaling = cpu_frequency_scaling_enabled();
+
+    if (const char *path = getenv("HL_BENCHMARK_JSON")) {
+        static int unnamed_benchmarks = 0;
+        std::string name = config.name.empty() ?
+                           "benchmark_" + std::to_string(unnamed_benchmarks++) : config.name;
+        std::ofstream f(path, std::ios::app);
+        f << benchmark_result_to_json(name, result) << "\n";
     }
-    result.wall_time = times[0];
-    result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
 
     return result;
 }
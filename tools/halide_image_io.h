@@ -8,10 +8,12 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <set>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <cctype>
 
@@ -23,6 +25,11 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -324,57 +331,201 @@ struct FileOpener {
     FILE * const f;
 };
 
-// Read a row of ElemTypes from a byte buffer and copy them into a specific image row.
-// Multibyte elements are assumed to be big-endian.
-template<typename ElemType, typename ImageType>
-void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
-    auto im_typed = im->template as<ElemType>();
+// Copy 'width' pixels of 'channels' interleaved SrcElemTypes from a byte
+// buffer into an image row with the given strides, converting to
+// DstElemType. The channel count is a template parameter so that the loops
+// step through 'src' with a constant stride, which the compiler can turn
+// into vector loads and shuffles. Multibyte elements are assumed to be
+// big-endian.
+template<typename SrcElemType, typename DstElemType, int channels>
+void read_big_endian_pixels(const uint8_t *src, DstElemType *dst, int width, int x_stride, int c_stride) {
+    constexpr int pixel_size = channels * sizeof(SrcElemType);
+    if (std::is_same<SrcElemType, DstElemType>::value && sizeof(SrcElemType) == 1 &&
+        x_stride == channels && (channels == 1 || c_stride == 1)) {
+        // The image is interleaved just like the file.
+        memcpy(dst, src, width * pixel_size);
+    } else if (x_stride == 1) {
+        // Planar: deinterleave one channel at a time.
+        for (int c = 0; c < channels; c++) {
+            DstElemType *d = dst + c * c_stride;
+            const uint8_t *s = src + c * sizeof(SrcElemType);
+            for (int x = 0; x < width; x++) {
+                d[x] = convert<DstElemType>(read_big_endian<SrcElemType>(s + x * pixel_size));
+            }
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                const uint8_t *s = src + x * pixel_size + c * sizeof(SrcElemType);
+                dst[x * x_stride + c * c_stride] = convert<DstElemType>(read_big_endian<SrcElemType>(s));
+            }
+        }
+    }
+}
+
+template<typename SrcElemType, typename DstElemType, typename ImageType>
+void read_big_endian_row_as(const uint8_t *src, int y, ImageType *im) {
+    auto im_typed = im->template as<DstElemType>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c+cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        DstElemType *dst = &im_typed(xmin, y, im_typed.dim(2).min());
+        switch (channels) {
+        case 1:
+            read_big_endian_pixels<SrcElemType, DstElemType, 1>(src, dst, width, x_stride, c_stride);
+            break;
+        case 2:
+            read_big_endian_pixels<SrcElemType, DstElemType, 2>(src, dst, width, x_stride, c_stride);
+            break;
+        case 3:
+            read_big_endian_pixels<SrcElemType, DstElemType, 3>(src, dst, width, x_stride, c_stride);
+            break;
+        case 4:
+            read_big_endian_pixels<SrcElemType, DstElemType, 4>(src, dst, width, x_stride, c_stride);
+            break;
+        default:
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < channels; c++) {
+                    dst[x * x_stride + c * c_stride] = convert<DstElemType>(read_big_endian<SrcElemType>(src));
+                    src += sizeof(SrcElemType);
+                }
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+        read_big_endian_pixels<SrcElemType, DstElemType, 1>(src, &im_typed(xmin, y), width, x_stride, 0);
+    }
+}
+
+// Read a row of ElemTypes from a byte buffer and copy them into a specific
+// image row, converting them to the element type of the image, which may
+// have any memory layout. Multibyte elements are assumed to be big-endian.
+template<typename ElemType, typename ImageType>
+void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
+    const halide_type_t t = im->type();
+    if (t.code == halide_type_uint && t.bits == sizeof(ElemType) * 8) {
+        // The common case: no conversion.
+        read_big_endian_row_as<ElemType, ElemType>(src, y, im);
+    } else if (t.code == halide_type_float && t.bits == 32) {
+        read_big_endian_row_as<ElemType, float>(src, y, im);
+    } else if (t.code == halide_type_float && t.bits == 64) {
+        read_big_endian_row_as<ElemType, double>(src, y, im);
+    } else if (t.code == halide_type_int && t.bits == 8) {
+        read_big_endian_row_as<ElemType, int8_t>(src, y, im);
+    } else if (t.code == halide_type_int && t.bits == 16) {
+        read_big_endian_row_as<ElemType, int16_t>(src, y, im);
+    } else if (t.code == halide_type_int && t.bits == 32) {
+        read_big_endian_row_as<ElemType, int32_t>(src, y, im);
+    } else if (t.code == halide_type_int && t.bits == 64) {
+        read_big_endian_row_as<ElemType, int64_t>(src, y, im);
+    } else if (t.code == halide_type_uint && t.bits == 1) {
+        read_big_endian_row_as<ElemType, bool>(src, y, im);
+    } else if (t.code == halide_type_uint && t.bits == 8) {
+        read_big_endian_row_as<ElemType, uint8_t>(src, y, im);
+    } else if (t.code == halide_type_uint && t.bits == 16) {
+        read_big_endian_row_as<ElemType, uint16_t>(src, y, im);
+    } else if (t.code == halide_type_uint && t.bits == 32) {
+        read_big_endian_row_as<ElemType, uint32_t>(src, y, im);
+    } else if (t.code == halide_type_uint && t.bits == 64) {
+        read_big_endian_row_as<ElemType, uint64_t>(src, y, im);
+    } else {
+        assert(false && "Unsupported type");
+    }
+}
+
+// Copy 'width' pixels of 'channels' channels from an image row with the given
+// strides into a byte buffer, interleaved. The inverse of
+// read_big_endian_pixels. Multibyte elements are written in big-endian layout.
+template<typename ElemType, int channels>
+void write_big_endian_pixels(const ElemType *src, uint8_t *dst, int width, int x_stride, int c_stride) {
+    constexpr int pixel_size = channels * sizeof(ElemType);
+    if (sizeof(ElemType) == 1 && x_stride == channels && (channels == 1 || c_stride == 1)) {
+        memcpy(dst, src, width * pixel_size);
+    } else if (x_stride == 1) {
+        // Planar: interleave one channel at a time.
+        for (int c = 0; c < channels; c++) {
+            const ElemType *s = src + c * c_stride;
+            uint8_t *d = dst + c * sizeof(ElemType);
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(s[x], d + x * pixel_size);
+            }
+        }
+    } else {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                uint8_t *d = dst + x * pixel_size + c * sizeof(ElemType);
+                write_big_endian<ElemType>(src[x * x_stride + c * c_stride], d);
+            }
         }
     }
 }
 
-// Copy a row from an image into a byte buffer.
+// Copy a row from an image of any memory layout into a byte buffer.
 // Multibyte elements are written in big-endian layout.
 template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<ElemType>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const int x_stride = im_typed.dim(0).stride();
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
+        const int channels = im_typed.dim(2).extent();
+        const int c_stride = im_typed.dim(2).stride();
+        const ElemType *src = &im_typed(xmin, y, im_typed.dim(2).min());
+        switch (channels) {
+        case 1:
+            write_big_endian_pixels<ElemType, 1>(src, dst, width, x_stride, c_stride);
+            break;
+        case 2:
+            write_big_endian_pixels<ElemType, 2>(src, dst, width, x_stride, c_stride);
+            break;
+        case 3:
+            write_big_endian_pixels<ElemType, 3>(src, dst, width, x_stride, c_stride);
+            break;
+        case 4:
+            write_big_endian_pixels<ElemType, 4>(src, dst, width, x_stride, c_stride);
+            break;
+        default:
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < channels; c++) {
+                    write_big_endian<ElemType>(src[x * x_stride + c * c_stride], dst);
+                    dst += sizeof(ElemType);
+                }
             }
         }
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+        write_big_endian_pixels<ElemType, 1>(&im_typed(xmin, y), dst, width, x_stride, 0);
+    }
+}
+
+// Make *im ready to receive an image of the given type and extents. If
+// 'in_place' is set, *im must already have those extents, and keeps its own
+// element type and memory layout; otherwise a new planar image of the given
+// type is allocated.
+template<typename ImageType, CheckFunc check>
+bool prepare_image(ImageType *im, const halide_type_t &type,
+                   const std::vector<int> &extents, bool in_place) {
+    if (!in_place) {
+        *im = ImageType(type, extents);
+        return true;
+    }
+    if (!check(im->data() != nullptr && im->dimensions() == (int)extents.size(),
+               "Image does not have the dimensions of the file")) {
+        return false;
+    }
+    for (size_t i = 0; i < extents.size(); i++) {
+        if (!check(im->dim(i).extent() == extents[i], "Image does not have the extents of the file")) {
+            return false;
         }
     }
+    return true;
 }
 
 #ifndef HALIDE_NO_PNG
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn, bool in_place = false>
 bool load_png(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
 
@@ -422,7 +573,10 @@ bool load_png(const std::string &filename, ImageType *im) {
         im_dimensions.push_back(channels);
     }
 
-    *im = ImageType(im_type, im_dimensions);
+    if (!Internal::prepare_image<ImageType, check>(im, im_type, im_dimensions, in_place)) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return false;
+    }
 
     png_read_update_info(png_ptr, info_ptr);
 
@@ -563,7 +717,7 @@ bool read_pnm_header(Internal::FileOpener &f, const std::string &hdr_fmt, int *w
     return true;
 }
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn, bool in_place = false>
 bool load_pnm(const std::string &filename, int channels, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
 
@@ -580,7 +734,9 @@ bool load_pnm(const std::string &filename, int channels, ImageType *im) {
     if (channels > 1) {
         im_dimensions.push_back(channels);
     }
-    *im = ImageType(im_type, im_dimensions);
+    if (!Internal::prepare_image<ImageType, check>(im, im_type, im_dimensions, in_place)) {
+        return false;
+    }
 
     auto copy_to_image = bit_depth == 8 ?
         Internal::read_big_endian_row<uint8_t, ImageType> :
@@ -638,9 +794,9 @@ bool save_pnm(ImageType &im, const int channels, const std::string &filename) {
     return true;
 }
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn, bool in_place = false>
 bool load_pgm(const std::string &filename, ImageType *im) {
-    return Internal::load_pnm<ImageType, check>(filename, 1, im);
+    return Internal::load_pnm<ImageType, check, in_place>(filename, 1, im);
 }
 
 inline const std::set<FormatInfo> &query_pgm() {
@@ -657,9 +813,9 @@ bool save_pgm(ImageType &im, const std::string &filename) {
     return Internal::save_pnm<ImageType, check>(im, 1, filename);
 }
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn, bool in_place = false>
 bool load_ppm(const std::string &filename, ImageType *im) {
-    return Internal::load_pnm<ImageType, check>(filename, 3, im);
+    return Internal::load_pnm<ImageType, check, in_place>(filename, 3, im);
 }
 
 inline const std::set<FormatInfo> &query_ppm() {
@@ -678,7 +834,7 @@ bool save_ppm(ImageType &im, const std::string &filename) {
 
 #ifndef HALIDE_NO_JPEG
 
-template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn, bool in_place = false>
 bool load_jpg(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
 
@@ -704,7 +860,10 @@ bool load_jpg(const std::string &filename, ImageType *im) {
     if (channels > 1) {
         im_dimensions.push_back(channels);
     }
-    *im = ImageType(im_type, im_dimensions);
+    if (!Internal::prepare_image<ImageType, check>(im, im_type, im_dimensions, in_place)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
 
     auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
 
@@ -825,8 +984,54 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
+#ifndef _WIN32
+struct MappedFile {
+    void *addr;
+    size_t length;
+};
+
+inline void unmap_file(void *context) {
+    MappedFile *m = (MappedFile *)context;
+    munmap(m->addr, m->length);
+    delete m;
+}
+#endif
+
+// Make *im wrap a private, copy-on-write mapping of a compact planar payload
+// of the given type and extents, starting at the current position of 'f'.
+// Returns false (leaving *im alone) if the payload can't be mapped, e.g.
+// because it isn't aligned to its element size within the file, in which
+// case the caller should read it instead.
+template<typename ImageType>
+bool map_payload(FileOpener &f, const halide_type_t &type,
+                 const std::vector<int> &extents, ImageType *im) {
+#ifdef _WIN32
+    return false;
+#else
+    const long offset = ftell(f.f);
+    size_t size = type.bytes();
+    for (int e : extents) {
+        size *= e;
+    }
+    struct stat st;
+    if (offset < 0 || size == 0 || (offset % type.bytes()) != 0 ||
+        fstat(fileno(f.f), &st) != 0 || (size_t)st.st_size < offset + size) {
+        return false;
+    }
+    // Map from the start of the file, which is page-aligned.
+    const size_t length = offset + size;
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(f.f), 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    *im = ImageType(type, (uint8_t *)addr + offset, extents);
+    im->adopt_host_memory(unmap_file, new MappedFile{addr, length});
+    return true;
+#endif
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
-template<typename ImageType, CheckFunc check = CheckReturn>
+template<typename ImageType, CheckFunc check = CheckReturn, bool map = false>
 bool load_tmp(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
 
@@ -847,6 +1052,10 @@ bool load_tmp(const std::string &filename, ImageType *im) {
 
     const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
     std::vector<int> im_dimensions = { header[0], header[1], header[2], header[3] };
+    if (map && map_payload(f, im_type, im_dimensions, im)) {
+        im->set_host_dirty();
+        return true;
+    }
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -973,7 +1182,7 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
+template<typename ImageType, CheckFunc check = CheckReturn, bool map = false>
 bool load_mat(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
 
@@ -1083,6 +1292,10 @@ bool load_mat(const std::string &filename, ImageType *im) {
         break;
     }
 
+    if (map && map_payload(f, type, extents, im)) {
+        im->set_host_dirty();
+        return true;
+    }
     *im = ImageType(type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1187,6 +1400,7 @@ bool save_mat(ImageType &im, const std::string &filename) {
         };
         break;
     case halide_type_handle:
+    case halide_type_bfloat:
         check(false, "unreachable");
     }
 
@@ -1312,6 +1526,12 @@ struct ImageIO {
     std::function<bool(const std::string &, ImageType *)> load;
     std::function<bool(ImageType &im, const std::string &)> save;
     std::function<const std::set<FormatInfo>&()> query;
+    // Loads into an existing image without reallocating it; unset for
+    // formats that don't support this.
+    std::function<bool(const std::string &, ImageType *)> load_into;
+    // Loads by mapping the file rather than reading it; unset for
+    // formats that must be decoded.
+    std::function<bool(const std::string &, ImageType *)> map;
 };
 
 template<typename ImageType, Internal::CheckFunc check>
@@ -1320,16 +1540,16 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
 
     const std::map<std::string, ImageIO<ImageType, check>> m = {
 #ifndef HALIDE_NO_JPEG
-        {"jpeg", {load_jpg<ImageType, check>, save_jpg<ImageType, check>, query_jpg}},
-        {"jpg", {load_jpg<ImageType, check>, save_jpg<ImageType, check>, query_jpg}},
+        {"jpeg", {load_jpg<ImageType, check>, save_jpg<ImageType, check>, query_jpg, load_jpg<ImageType, check, true>}},
+        {"jpg", {load_jpg<ImageType, check>, save_jpg<ImageType, check>, query_jpg, load_jpg<ImageType, check, true>}},
 #endif
-        {"pgm", {load_pgm<ImageType, check>, save_pgm<ImageType, check>, query_pgm}},
+        {"pgm", {load_pgm<ImageType, check>, save_pgm<ImageType, check>, query_pgm, load_pgm<ImageType, check, true>}},
 #ifndef HALIDE_NO_PNG
-        {"png", {load_png<ImageType, check>, save_png<ImageType, check>, query_png}},
+        {"png", {load_png<ImageType, check>, save_png<ImageType, check>, query_png, load_png<ImageType, check, true>}},
 #endif
-        {"ppm", {load_ppm<ImageType, check>, save_ppm<ImageType, check>, query_ppm}},
-        {"tmp", {load_tmp<ImageType, check>, save_tmp<ImageType, check>, query_tmp}},
-        {"mat", {load_mat<ImageType, check>, save_mat<ImageType, check>, query_mat}}
+        {"ppm", {load_ppm<ImageType, check>, save_ppm<ImageType, check>, query_ppm, load_ppm<ImageType, check, true>}},
+        {"tmp", {load_tmp<ImageType, check>, save_tmp<ImageType, check>, query_tmp, nullptr, load_tmp<ImageType, check, true>}},
+        {"mat", {load_mat<ImageType, check>, save_mat<ImageType, check>, query_mat, nullptr, load_mat<ImageType, check, true>}}
     };
     std::string ext = Internal::get_lowercase_extension(filename);
     auto it = m.find(ext);
@@ -1589,6 +1809,80 @@ bool load(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Like load(), but for the raw formats (.tmp and .mat) the returned Image
+// wraps a private, copy-on-write mapping of the file rather than a copy of
+// its contents, so loading a large file costs page faults rather than a full
+// read. The mapping is released when the last Image sharing it is
+// destroyed. Writes to the Image never reach the file. Formats that must be
+// decoded, and payloads that aren't aligned to their element size within
+// the file, are loaded as by load().
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool map(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    Internal::ImageIO<DynamicImageType, check> imageio;
+    if (!Internal::find_imageio<DynamicImageType, check>(filename, &imageio)) {
+        return false;
+    }
+    if (!imageio.map) {
+        return load<ImageType, check>(filename, im);
+    }
+    DynamicImageType im_d;
+    if (!imageio.map(filename, &im_d)) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    *im = im_d.template as<typename ImageType::ElemType>();
+    return true;
+}
+
+// Load the image in the given file straight into 'im', which must already be
+// allocated with the extents of the image in the file, but may have any
+// element type and memory layout (e.g. interleaved rather than planar).
+// Values are converted to the element type of 'im' as they are copied, as in
+// load_and_convert_image. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_into(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    Internal::ImageIO<DynamicImageType, check> imageio;
+    if (!Internal::find_imageio<DynamicImageType, check>(filename, &imageio)) {
+        return false;
+    }
+    // This shares the allocation of 'im'.
+    DynamicImageType im_d = im->template as<void>();
+    if (imageio.load_into) {
+        if (!imageio.load_into(filename, &im_d)) {
+            return false;
+        }
+    } else {
+        // Fall back to loading, converting, and copying.
+        DynamicImageType loaded;
+        if (!imageio.load(filename, &loaded)) {
+            return false;
+        }
+        std::vector<int> extents;
+        for (int i = 0; i < loaded.dimensions(); i++) {
+            extents.push_back(loaded.dim(i).extent());
+        }
+        if (!Internal::prepare_image<DynamicImageType, check>(&im_d, loaded.type(), extents, true)) {
+            return false;
+        }
+        if (!(loaded.type() == im_d.type())) {
+            loaded = ImageTypeConversion::convert_image(loaded, im_d.type());
+        }
+        for (int i = 0; i < loaded.dimensions(); i++) {
+            loaded.translate(i, im_d.dim(i).min() - loaded.dim(i).min());
+        }
+        im_d.copy_from(loaded);
+    }
+    im->set_host_dirty();
+    return true;
+}
+
 // Save the Image in the format associated with the filename's extension.
 // If the format can't represent the Image without losing data, fail.
 // Returns false upon failure.
@@ -1648,6 +1942,25 @@ private:
   const std::string filename;
 };
 
+// Fancy wrapper to call map() with CheckFail, inferring the return type, e.g.
+//
+//    Buffer<float> im = map_image("weights.mat");
+class map_image {
+public:
+    map_image(const std::string &f) : filename(f) {}
+
+    template<typename ImageType>
+    operator ImageType() {
+        using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+        DynamicImageType im_d;
+        (void) map<DynamicImageType, Internal::CheckFail>(filename, &im_d);
+        return im_d.template as<typename ImageType::ElemType>();
+    }
+
+private:
+  const std::string filename;
+};
+
 // Like load_image, but quietly convert the loaded image to the type of the LHS
 // if necessary, discarding information if necessary.
 class load_and_convert_image {
@@ -0,0 +1,119 @@
+#ifndef HALIDE_INCREMENTAL_REALIZE_H
+#define HALIDE_INCREMENTAL_REALIZE_H
+
+/** \file
+ * A driver that updates the output of a pipeline after a small part
+ * of its input has changed, e.g. after a brush stroke in an image
+ * editor, by recomputing only the part of the output that depends on
+ * the changed region and writing it into the previous output in
+ * place.
+ *
+ * The affected region of the output is found from the footprint of
+ * the pipeline, given by a bounds query. This assumes the pipeline is
+ * translation invariant: each output point depends on the input
+ * around the same coordinates, through the same stencil. That holds for pipelines of point-wise operations and
+ * stencils with constant offsets, but not for ones that resample,
+ * so for example it can't be used on a pipeline that downsamples.
+ *
+ * For example, to update the output of an AOT-compiled blur:
+ *
+ * \code
+ * // The user painted over [x, x + w) x [y, y + h) of the input.
+ * int result = Halide::Tools::realize_incremental<uint8_t, uint8_t>(
+ *     [&](halide_buffer_t *in, halide_buffer_t *out) {
+ *         return blur(in, strength, out);
+ *     },
+ *     input, output, {{x, w}, {y, h}, {0, 3}});
+ * \endcode
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+/** Recompute the part of 'output' that depends on the region
+ * 'dirty_rect' (a (min, extent) pair per dimension) of 'input', and
+ * return 0, or the first nonzero result of 'pipeline'. The rest of
+ * 'output' must already hold the pipeline's result for the current
+ * input. If 'updated_rect' is not null, it is set to the region of
+ * 'output' that was recomputed, which is empty if none was.
+ *
+ * 'pipeline' is called as pipeline(input, output) with
+ * halide_buffer_t pointers, and must behave like an AOT-compiled
+ * pipeline: when input->host is null, it only fills in the region of
+ * the input that it needs to compute output. Input and output must
+ * have the same number of dimensions. */
+template<typename TIn, typename TOut, typename PipelineFn>
+int realize_incremental(PipelineFn pipeline,
+                        Runtime::Buffer<TIn> &input,
+                        Runtime::Buffer<TOut> &output,
+                        const std::vector<std::pair<int, int>> &dirty_rect,
+                        std::vector<std::pair<int, int>> *updated_rect = nullptr) {
+    const int dims = output.dimensions();
+    if (input.dimensions() != dims || (int)dirty_rect.size() != dims) {
+        return halide_error_code_bad_dimensions;
+    }
+    if (updated_rect) {
+        updated_rect->assign(dims, {0, 0});
+    }
+    for (int i = 0; i < dims; i++) {
+        if (dirty_rect[i].second <= 0) {
+            return 0;
+        }
+    }
+
+    // Find the footprint of the pipeline from a bounds query at the
+    // center of the output, away from any boundary conditions:
+    // computing one output point needs the input from 'before' points
+    // below it to 'after' points above it in each dimension. The query
+    // starts from the shape of the real input, which boundary
+    // conditions may refer to.
+    Runtime::Buffer<TIn> query_in(nullptr, input.dimensions(), input.raw_buffer()->dim);
+    std::vector<halide_dimension_t> query_out_shape(dims);
+    std::vector<int> center(dims);
+    for (int i = 0; i < dims; i++) {
+        center[i] = output.dim(i).min() + output.dim(i).extent() / 2;
+        query_out_shape[i] = halide_dimension_t(center[i], 1, 0);
+    }
+    Runtime::Buffer<TOut> query_out(nullptr, query_out_shape);
+    if (int result = pipeline(query_in.raw_buffer(), query_out.raw_buffer())) {
+        return result;
+    }
+
+    // An output point depends on a changed input point if it is
+    // within the footprint, reflected, of the dirty region. Clamp
+    // that to the output.
+    std::vector<std::pair<int, int>> affected(dims);
+    for (int i = 0; i < dims; i++) {
+        int before = center[i] - query_in.dim(i).min();
+        int after = query_in.dim(i).max() - center[i];
+        int min = std::max(dirty_rect[i].first - after, output.dim(i).min());
+        int max = std::min(dirty_rect[i].first + dirty_rect[i].second - 1 + before,
+                           output.dim(i).max());
+        if (max < min) {
+            return 0;
+        }
+        affected[i] = {min, max - min + 1};
+    }
+
+    // The pipeline writes directly into the affected part of the
+    // previous output.
+    Runtime::Buffer<TOut> patch = output.cropped(affected);
+    if (int result = pipeline(input.raw_buffer(), patch.raw_buffer())) {
+        return result;
+    }
+    if (updated_rect) {
+        *updated_rect = affected;
+    }
+    return 0;
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_INCREMENTAL_REALIZE_H
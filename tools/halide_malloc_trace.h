@@ -15,12 +15,36 @@
 //   halide_free   => [0x9e390, 0x9e3ff], # size:112, align:16
 //   halide_free   => [0xa2820, 0xa287f], # size:96, align:32
 //
+// Printing every allocation is far too slow under real load. For that
+// there is an aggregating allocator, enabled by calling:
+//
+//   halide_enable_malloc_trace_summary();
+//
+// It keeps counts of allocations and frees, and histograms of their
+// sizes and lifetimes, for each call site of halide_malloc. A call
+// site in a Halide pipeline usually corresponds to the allocation of
+// a single Func. The statistics live in a lock-free table, so the
+// overhead is a few atomic operations per call. A summary is printed
+// at exit, or whenever halide_malloc_trace_summary() is called:
+//
+//   call site 0x4013a0 (blur+0x1a0): allocs:1200 frees:1200 live:0 peak:35840 total:43008000
+//     size:     [32K, 64K):1200
+//     lifetime: [16us, 32us):1100 [32us, 64us):100
+//
 //---------------------------------------------------------------------------
 
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <memory>
 #include <iostream>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <dlfcn.h>
+#endif
+
 namespace Halide {
 namespace Tools {
 
@@ -96,6 +120,168 @@ void halide_enable_malloc_trace(void) {
     halide_set_custom_free(halide_free_trace);
 }
 
+// Statistics for the allocations made from one call site.
+struct MallocTraceSite {
+    // The return address of the call to halide_malloc, or zero if
+    // this slot is unused.
+    std::atomic<uintptr_t> call_site;
+    std::atomic<uint64_t> allocs, frees, total_bytes, live_bytes, peak_live_bytes;
+    // Histograms with power-of-two buckets: of allocation sizes in
+    // bytes, and of lifetimes in nanoseconds.
+    std::atomic<uint64_t> sizes[64], lifetimes[64];
+};
+
+static const int malloc_trace_max_sites = 1024;
+
+// The table of call sites. The last entry takes all the call sites
+// that don't fit.
+static inline MallocTraceSite *malloc_trace_sites() {
+    static MallocTraceSite sites[malloc_trace_max_sites + 1];
+    return sites;
+}
+
+static inline int malloc_trace_log2(uint64_t x) {
+    int b = 0;
+    while (x >>= 1) {
+        b++;
+    }
+    return b;
+}
+
+static inline uint64_t malloc_trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline MallocTraceSite *malloc_trace_find_site(uintptr_t call_site) {
+    MallocTraceSite *sites = malloc_trace_sites();
+    uint64_t h = (uint64_t)call_site * 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < malloc_trace_max_sites; i++) {
+        MallocTraceSite *s = sites + (h + i) % malloc_trace_max_sites;
+        uintptr_t existing = s->call_site.load(std::memory_order_acquire);
+        if (existing == 0 &&
+            s->call_site.compare_exchange_strong(existing, call_site)) {
+            return s;
+        }
+        if (existing == call_site) {
+            return s;
+        }
+    }
+    return sites + malloc_trace_max_sites;
+}
+
+void *halide_malloc_trace_summary_alloc(void *user_context, size_t x) {
+#ifdef _MSC_VER
+    uintptr_t call_site = (uintptr_t)_ReturnAddress();
+#else
+    uintptr_t call_site = (uintptr_t)__builtin_return_address(0);
+#endif
+    MallocTraceSite *site = malloc_trace_find_site(call_site);
+
+    // Align to 128 bytes like halide_malloc_trace, leaving room
+    // before the start for the original pointer, the call site, the
+    // size, and the time of allocation.
+    const size_t header = 4 * sizeof(uint64_t);
+    void *orig = malloc(x + header + 128);
+    if (orig == NULL) {
+        return NULL;
+    }
+    void *ptr = (void *)((((size_t)orig + header + 127) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    ((MallocTraceSite **)ptr)[-2] = site;
+    ((uint64_t *)ptr)[-3] = x;
+    ((uint64_t *)ptr)[-4] = malloc_trace_now_ns();
+
+    site->allocs++;
+    site->total_bytes += x;
+    site->sizes[malloc_trace_log2(x)]++;
+    uint64_t live = (site->live_bytes += x);
+    uint64_t peak = site->peak_live_bytes.load();
+    while (live > peak && !site->peak_live_bytes.compare_exchange_weak(peak, live)) {
+    }
+    return ptr;
+}
+
+void halide_free_trace_summary(void *user_context, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    MallocTraceSite *site = ((MallocTraceSite **)ptr)[-2];
+    uint64_t size = ((uint64_t *)ptr)[-3];
+    uint64_t lifetime = malloc_trace_now_ns() - ((uint64_t *)ptr)[-4];
+    site->frees++;
+    site->live_bytes -= size;
+    site->lifetimes[malloc_trace_log2(lifetime)]++;
+    free(((void **)ptr)[-1]);
+}
+
+static inline void print_malloc_trace_histogram(std::ostream &out, const std::atomic<uint64_t> *h,
+                                                const char *const *units) {
+    for (int b = 0; b < 64; b++) {
+        uint64_t count = h[b].load();
+        if (!count) continue;
+        // Print the bucket bounds in the largest unit below them.
+        uint64_t lo = (uint64_t)1 << b, hi = lo << 1;
+        int u = 0;
+        while (units[u + 1] && lo >= 1024) {
+            lo >>= 10;
+            hi >>= 10;
+            u++;
+        }
+        out << " [" << lo << units[u] << ", " << hi << units[u] << "):" << count;
+    }
+}
+
+// Print the statistics gathered so far by the aggregating allocator.
+void halide_malloc_trace_summary(std::ostream &out = std::cerr) {
+    static const char *const size_units[] = {"", "K", "M", "G", nullptr};
+    MallocTraceSite *sites = malloc_trace_sites();
+    for (int i = 0; i <= malloc_trace_max_sites; i++) {
+        MallocTraceSite &s = sites[i];
+        if (!s.allocs.load()) continue;
+        if (i == malloc_trace_max_sites) {
+            out << "other call sites";
+        } else {
+            out << "call site 0x" << std::hex << s.call_site.load() << std::dec;
+#ifndef _MSC_VER
+            Dl_info info;
+            if (dladdr((void *)s.call_site.load(), &info) && info.dli_sname) {
+                out << " (" << info.dli_sname << "+0x" << std::hex
+                    << (s.call_site.load() - (uintptr_t)info.dli_saddr) << std::dec << ")";
+            }
+#endif
+        }
+        out << ": allocs:" << s.allocs.load()
+            << " frees:" << s.frees.load()
+            << " live:" << s.live_bytes.load()
+            << " peak:" << s.peak_live_bytes.load()
+            << " total:" << s.total_bytes.load() << "\n";
+        out << "  size:    ";
+        print_malloc_trace_histogram(out, s.sizes, size_units);
+        out << "\n";
+        // Lifetimes are measured in ns. Scale by 1024 as an
+        // approximation to 1000 so the buckets stay powers of two.
+        static const char *const time_units[] = {"ns", "us", "ms", "s", nullptr};
+        out << "  lifetime:";
+        print_malloc_trace_histogram(out, s.lifetimes, time_units);
+        out << "\n";
+    }
+}
+
+static inline void halide_malloc_trace_summary_at_exit() {
+    halide_malloc_trace_summary(std::cerr);
+}
+
+void halide_enable_malloc_trace_summary(void) {
+    static bool registered = false;
+    if (!registered) {
+        atexit(halide_malloc_trace_summary_at_exit);
+        registered = true;
+    }
+    halide_set_custom_malloc(halide_malloc_trace_summary_alloc);
+    halide_set_custom_free(halide_free_trace_summary);
+}
+
 } // namespace Tools
 } // namespace Halide
 
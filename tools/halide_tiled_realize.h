@@ -0,0 +1,201 @@
+#ifndef HALIDE_TILED_REALIZE_H
+#define HALIDE_TILED_REALIZE_H
+
+/** \file
+ * A driver that runs a pipeline over an output too large to hold in
+ * memory, one output tile at a time. For each tile, a bounds query of
+ * the pipeline finds the region of the input the tile needs, only
+ * that region is fetched from a user callback (e.g. reading a file or
+ * an mmap), and the computed tile is handed to another user callback
+ * to be written out. So only one tile of the output and its input
+ * region are ever resident.
+ *
+ * Tiles are visited with dimension 0 innermost. The input regions of
+ * neighboring tiles along dimension 0 usually overlap (by the halo of
+ * the pipeline's stencils), and the overlap is copied from the
+ * previous tile's input rather than fetched again.
+ *
+ * For example, to run an AOT-compiled blur with a scalar parameter
+ * over a huge image:
+ *
+ * \code
+ * int result = Halide::Tools::realize_tiled<uint8_t, uint8_t>(
+ *     [&](halide_buffer_t *in, halide_buffer_t *out) {
+ *         return blur(in, strength, out);
+ *     },
+ *     [&](Halide::Runtime::Buffer<uint8_t> &region) {
+ *         return read_scan_region(file, region);
+ *     },
+ *     [&](const Halide::Runtime::Buffer<uint8_t> &tile) {
+ *         return write_scan_region(out_file, tile);
+ *     },
+ *     {{0, width}, {0, height}, {0, 3}},  // The whole output.
+ *     {1024, 1024, 3},                    // The size of each tile.
+ *     3);                                 // The input's dimensions.
+ * \endcode
+ */
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+namespace Internal {
+
+// A box as a (min, extent) pair per dimension, as taken by
+// Buffer::cropped.
+typedef std::vector<std::pair<int, int>> TileRect;
+
+inline TileRect buffer_rect(const halide_buffer_t *buf) {
+    TileRect rect(buf->dimensions);
+    for (int i = 0; i < buf->dimensions; i++) {
+        rect[i] = {buf->dim[i].min, buf->dim[i].extent};
+    }
+    return rect;
+}
+
+// Fill the region of 'in' that isn't covered by 'prev', fetching
+// up to two slabs per dimension, and copy the rest from
+// 'prev'. Returns the first nonzero result of fetch.
+template<typename T, typename FetchFn>
+int fetch_missing(Runtime::Buffer<T> &in, const Runtime::Buffer<T> &prev, FetchFn &fetch) {
+    TileRect remaining = buffer_rect(in.raw_buffer());
+
+    bool overlaps = prev.data() != nullptr && prev.dimensions() == in.dimensions();
+    for (int i = 0; overlaps && i < in.dimensions(); i++) {
+        overlaps = (prev.dim(i).min() <= in.dim(i).max() &&
+                    in.dim(i).min() <= prev.dim(i).max());
+    }
+    if (!overlaps) {
+        return fetch(in);
+    }
+
+    for (int i = 0; i < in.dimensions(); i++) {
+        int min = remaining[i].first;
+        int max = min + remaining[i].second - 1;
+        if (min < prev.dim(i).min()) {
+            TileRect slab = remaining;
+            slab[i] = {min, prev.dim(i).min() - min};
+            Runtime::Buffer<T> region = in.cropped(slab);
+            if (int result = fetch(region)) {
+                return result;
+            }
+            min = prev.dim(i).min();
+        }
+        if (max > prev.dim(i).max()) {
+            TileRect slab = remaining;
+            slab[i] = {prev.dim(i).max() + 1, max - prev.dim(i).max()};
+            Runtime::Buffer<T> region = in.cropped(slab);
+            if (int result = fetch(region)) {
+                return result;
+            }
+            max = prev.dim(i).max();
+        }
+        remaining[i] = {min, max - min + 1};
+    }
+
+    // What's left is the intersection with the previous tile's input.
+    Runtime::Buffer<T> overlap = in.cropped(remaining);
+    overlap.copy_from(prev);
+    return 0;
+}
+
+}  // namespace Internal
+
+/** Compute the output region 'output_rect' (a (min, extent) pair per
+ * dimension) in tiles of at most 'tile_extents', and return 0, or the
+ * first nonzero result of any of the callbacks.
+ *
+ * 'pipeline' is called as pipeline(input, output) with
+ * halide_buffer_t pointers, and must behave like an AOT-compiled
+ * pipeline: when input->host is null, it only fills in the region of
+ * the input (of 'input_dimensions' dimensions) that it needs to
+ * compute output. 'fetch' is called as fetch(region) with a
+ * Runtime::Buffer<TIn> to fill with the input values over its
+ * region. 'store' is called as store(tile) with each computed
+ * Runtime::Buffer<TOut> tile, which is only valid during the call. */
+template<typename TIn, typename TOut, typename PipelineFn, typename FetchFn, typename StoreFn>
+int realize_tiled(PipelineFn pipeline, FetchFn fetch, StoreFn store,
+                  const std::vector<std::pair<int, int>> &output_rect,
+                  const std::vector<int> &tile_extents,
+                  int input_dimensions) {
+    const int dims = (int)output_rect.size();
+    if ((int)tile_extents.size() != dims) {
+        return halide_error_code_bad_dimensions;
+    }
+    std::vector<int> tile_sizes(dims);
+    for (int i = 0; i < dims; i++) {
+        if (output_rect[i].second <= 0) {
+            return 0;
+        }
+        tile_sizes[i] = std::min(std::max(tile_extents[i], 1), output_rect[i].second);
+    }
+
+    // One allocation is reused for every output tile; the tiles at
+    // the far edges are crops of it.
+    Runtime::Buffer<TOut> out_storage(tile_sizes);
+    Runtime::Buffer<TIn> prev_in;
+
+    std::vector<int> tile_min(dims);
+    for (int i = 0; i < dims; i++) {
+        tile_min[i] = output_rect[i].first;
+    }
+
+    while (true) {
+        Internal::TileRect tile_rect(dims);
+        for (int i = 0; i < dims; i++) {
+            int end = output_rect[i].first + output_rect[i].second;
+            tile_rect[i] = {0, std::min(tile_sizes[i], end - tile_min[i])};
+        }
+        Runtime::Buffer<TOut> out = out_storage.cropped(tile_rect);
+        out.set_min(tile_min);
+
+        // Ask the pipeline what input this tile needs.
+        std::vector<halide_dimension_t> query_shape(input_dimensions);
+        Runtime::Buffer<TIn> query(nullptr, query_shape);
+        if (int result = pipeline(query.raw_buffer(), out.raw_buffer())) {
+            return result;
+        }
+
+        std::vector<int> in_sizes(input_dimensions), in_min(input_dimensions);
+        for (int i = 0; i < input_dimensions; i++) {
+            in_min[i] = query.dim(i).min();
+            in_sizes[i] = query.dim(i).extent();
+        }
+        Runtime::Buffer<TIn> in(in_sizes);
+        in.set_min(in_min);
+
+        if (int result = Internal::fetch_missing(in, prev_in, fetch)) {
+            return result;
+        }
+        if (int result = pipeline(in.raw_buffer(), out.raw_buffer())) {
+            return result;
+        }
+        if (int result = store(static_cast<const Runtime::Buffer<TOut> &>(out))) {
+            return result;
+        }
+        prev_in = std::move(in);
+
+        // Advance to the next tile, dimension 0 fastest.
+        int i = 0;
+        for (; i < dims; i++) {
+            tile_min[i] += tile_sizes[i];
+            if (tile_min[i] < output_rect[i].first + output_rect[i].second) {
+                break;
+            }
+            tile_min[i] = output_rect[i].first;
+        }
+        if (i == dims) {
+            return 0;
+        }
+    }
+}
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_TILED_REALIZE_H
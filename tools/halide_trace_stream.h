@@ -0,0 +1,315 @@
+#ifndef HALIDE_TRACE_STREAM_H
+#define HALIDE_TRACE_STREAM_H
+
+/** \file
+ * A reader for binary Halide trace files, in either the plain format
+ * (a sequence of halide_trace_packet_t) or the compressed format
+ * written when HL_TRACE_COMPRESS is set alongside HL_TRACE_FILE.
+ *
+ * The compressed format is a file header followed by chunks:
+ *
+ *     file header:  "HLTRACEZ" uint32 version (1)
+ *     chunk:        uint32 'HLTC' uint32 raw_size uint32 compressed_size
+ *                   uint32 num_packets int32 first_id
+ *                   compressed_size bytes of data
+ *     index:        uint32 'HLTI' uint32 num_chunks
+ *                   num_chunks * { uint64 offset, int32 first_id, uint32 num_packets }
+ *     footer:       uint64 index offset, "HLTRIDX" '\0'
+ *
+ * All integers are little-endian. Each chunk decompresses
+ * independently to raw_size bytes of packets. Within a chunk, when a
+ * packet is the same size as the one before it, every 32-bit word but
+ * the first (the size) is stored as its difference from the same word
+ * of the previous packet. This turns the slowly-varying ids and
+ * coordinates of consecutive loads and stores into runs of small
+ * values, which the block compression then squeezes out.
+ *
+ * The block compression is a byte-oriented LZ77: a sequence of token
+ * bytes, each with a literal count in the high nibble and a match
+ * length minus four in the low nibble. A nibble of 15 is extended by
+ * following bytes, summed until one is not 255. The literals follow
+ * the token, then a 16-bit match offset and any match length
+ * extension. The last sequence has literals only.
+ *
+ * The index and footer are written when the trace is shut down, so a
+ * trace from a process that crashed lacks them but can still be read
+ * front to back.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Trace {
+
+class TraceReader {
+public:
+    struct Chunk {
+        uint64_t offset;
+        int32_t first_id;
+        uint32_t num_packets;
+    };
+
+    explicit TraceReader(FILE *file) : file(file) {
+        start();
+    }
+
+    // Whether the trace is in the compressed format.
+    bool compressed() const {
+        return is_compressed;
+    }
+
+    // Read the next packet into dst, which has room for capacity
+    // bytes. Returns false at the end of the trace.
+    bool next(halide_trace_packet_t *dst, size_t capacity) {
+        if (!is_compressed) {
+            return next_plain(dst, capacity);
+        }
+        while (cursor == chunk.size()) {
+            if (!read_chunk()) {
+                return false;
+            }
+        }
+        const halide_trace_packet_t *p = (const halide_trace_packet_t *)(chunk.data() + cursor);
+        if (p->size > capacity || cursor + p->size > chunk.size()) {
+            return fail("Trace packet too large");
+        }
+        memcpy(dst, p, p->size);
+        cursor += p->size;
+        return true;
+    }
+
+    // Go back to the start of the trace. Requires a seekable file.
+    bool rewind() {
+        if (fseek(file, 0, SEEK_SET) != 0) {
+            return false;
+        }
+        start();
+        return true;
+    }
+
+    // The chunks of a compressed trace, read from the index at the
+    // end of the file. Empty if the file isn't seekable or has no
+    // index.
+    const std::vector<Chunk> &index() {
+        if (!index_loaded) {
+            load_index();
+        }
+        return chunks;
+    }
+
+    // Continue reading from the start of the given chunk of the index.
+    bool seek_to_chunk(size_t i) {
+        if (i >= index().size() || fseek(file, (long)chunks[i].offset, SEEK_SET) != 0) {
+            return false;
+        }
+        chunk.clear();
+        cursor = 0;
+        at_end = false;
+        return true;
+    }
+
+private:
+    FILE *file;
+    bool is_compressed = false;
+    bool at_end = false;
+    bool index_loaded = false;
+    std::vector<Chunk> chunks;
+
+    // The decompressed current chunk, and the read position in it.
+    std::vector<uint8_t> chunk;
+    size_t cursor = 0;
+
+    // Bytes read while sniffing for the file header of a plain trace.
+    uint8_t sniffed[12];
+    size_t sniffed_size = 0, sniffed_cursor = 0;
+
+    bool fail(const char *msg) {
+        fprintf(stderr, "%s\n", msg);
+        at_end = true;
+        return false;
+    }
+
+    void start() {
+        chunk.clear();
+        cursor = 0;
+        at_end = false;
+        sniffed_cursor = 0;
+        sniffed_size = fread(sniffed, 1, sizeof(sniffed), file);
+        is_compressed = (sniffed_size == sizeof(sniffed) && memcmp(sniffed, "HLTRACEZ", 8) == 0);
+        if (is_compressed) {
+            sniffed_size = 0;
+        }
+    }
+
+    bool read_bytes(void *dst, size_t size) {
+        uint8_t *d = (uint8_t *)dst;
+        while (size && sniffed_cursor < sniffed_size) {
+            *d++ = sniffed[sniffed_cursor++];
+            size--;
+        }
+        return fread(d, 1, size, file) == size;
+    }
+
+    bool next_plain(halide_trace_packet_t *dst, size_t capacity) {
+        const size_t header_size = sizeof(halide_trace_packet_t);
+        if (at_end || !read_bytes(dst, header_size)) {
+            return false;
+        }
+        if (dst->size < header_size || dst->size > capacity) {
+            return fail("Bad trace packet size");
+        }
+        if (!read_bytes((uint8_t *)dst + header_size, dst->size - header_size)) {
+            return fail("Unexpected EOF mid-packet");
+        }
+        return true;
+    }
+
+    static uint32_t get_u32(const uint8_t *p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static uint64_t get_u64(const uint8_t *p) {
+        return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+    }
+
+    bool read_chunk() {
+        if (at_end) {
+            return false;
+        }
+        uint8_t header[20];
+        if (!read_bytes(header, 4)) {
+            at_end = true;
+            return false;
+        }
+        if (memcmp(header, "HLTI", 4) == 0) {
+            // We've reached the index.
+            at_end = true;
+            return false;
+        }
+        if (memcmp(header, "HLTC", 4) != 0 || !read_bytes(header + 4, 16)) {
+            return fail("Corrupt compressed trace");
+        }
+        uint32_t raw_size = get_u32(header + 4);
+        uint32_t compressed_size = get_u32(header + 8);
+        std::vector<uint8_t> compressed(compressed_size);
+        if (!read_bytes(compressed.data(), compressed_size)) {
+            return fail("Unexpected EOF mid-chunk");
+        }
+        chunk.resize(raw_size);
+        cursor = 0;
+        if (!decompress(compressed.data(), compressed_size, chunk.data(), raw_size)) {
+            return fail("Corrupt compressed trace chunk");
+        }
+        undo_deltas();
+        return true;
+    }
+
+    static bool decompress(const uint8_t *ip, size_t in_size, uint8_t *op, size_t out_size) {
+        const uint8_t *in_end = ip + in_size;
+        uint8_t *out_start = op, *out_end = op + out_size;
+        while (ip < in_end) {
+            uint32_t token = *ip++;
+            size_t literals = token >> 4;
+            if (literals == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= in_end) return false;
+                    b = *ip++;
+                    literals += b;
+                } while (b == 255);
+            }
+            if (literals > (size_t)(in_end - ip) || literals > (size_t)(out_end - op)) {
+                return false;
+            }
+            memcpy(op, ip, literals);
+            ip += literals;
+            op += literals;
+            if (ip == in_end) {
+                break;
+            }
+            if (in_end - ip < 2) return false;
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t length = (token & 15) + 4;
+            if ((token & 15) == 15) {
+                uint8_t b;
+                do {
+                    if (ip >= in_end) return false;
+                    b = *ip++;
+                    length += b;
+                } while (b == 255);
+            }
+            if (offset == 0 || offset > (size_t)(op - out_start) || length > (size_t)(out_end - op)) {
+                return false;
+            }
+            // Matches may overlap their own output, so copy bytewise.
+            const uint8_t *match = op - offset;
+            for (size_t i = 0; i < length; i++) {
+                op[i] = match[i];
+            }
+            op += length;
+        }
+        return op == out_end;
+    }
+
+    void undo_deltas() {
+        size_t prev = 0, pos = 0;
+        bool have_prev = false;
+        while (pos + sizeof(uint32_t) <= chunk.size()) {
+            uint32_t size = get_u32(chunk.data() + pos);
+            if (size < sizeof(uint32_t) || pos + size > chunk.size()) {
+                break;
+            }
+            if (have_prev && get_u32(chunk.data() + prev) == size) {
+                for (size_t i = sizeof(uint32_t); i < size; i += sizeof(uint32_t)) {
+                    uint32_t d, p;
+                    memcpy(&d, chunk.data() + pos + i, sizeof(d));
+                    memcpy(&p, chunk.data() + prev + i, sizeof(p));
+                    d += p;
+                    memcpy(chunk.data() + pos + i, &d, sizeof(d));
+                }
+            }
+            have_prev = true;
+            prev = pos;
+            pos += size;
+        }
+    }
+
+    void load_index() {
+        index_loaded = true;
+        long saved = ftell(file);
+        uint8_t footer[16];
+        if (!is_compressed || saved < 0 ||
+            fseek(file, -(long)sizeof(footer), SEEK_END) != 0 ||
+            fread(footer, 1, sizeof(footer), file) != sizeof(footer) ||
+            memcmp(footer + 8, "HLTRIDX", 8) != 0) {
+            fseek(file, saved, SEEK_SET);
+            return;
+        }
+        uint8_t header[8];
+        if (fseek(file, (long)get_u64(footer), SEEK_SET) == 0 &&
+            fread(header, 1, sizeof(header), file) == sizeof(header) &&
+            memcmp(header, "HLTI", 4) == 0) {
+            uint32_t n = get_u32(header + 4);
+            for (uint32_t i = 0; i < n; i++) {
+                uint8_t e[16];
+                if (fread(e, 1, sizeof(e), file) != sizeof(e)) {
+                    chunks.clear();
+                    break;
+                }
+                chunks.push_back({get_u64(e), (int32_t)get_u32(e + 8), get_u32(e + 12)});
+            }
+        }
+        fseek(file, saved, SEEK_SET);
+    }
+};
+
+}  // namespace Trace
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,418 @@
+#include "HalideTraceUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+/** \file
+ *
+ * A tool which replays the loads and stores in a binary Halide trace
+ * through a model of a multi-level cache, and reports how each Func
+ * behaves in it: hit rates at each level, how far apart reuses of the
+ * same cache line are, and how many bytes it moves to and from
+ * memory. This makes it possible to compare the locality of different
+ * schedules without running them on the target.
+ *
+ * Traces record coordinates, not addresses, so each Func is given its
+ * own dense allocation covering every coordinate it was accessed at,
+ * with dimension 0 innermost. This is the layout of a compute_root
+ * Func; Funcs stored at an inner loop level reuse a smaller
+ * allocation on a real machine, so their working set is overestimated.
+ */
+
+using namespace Halide;
+using namespace Internal;
+
+using std::map;
+using std::string;
+using std::vector;
+
+struct CacheLevelConfig {
+    uint64_t size = 0;
+    uint64_t line_size = 64;
+    uint64_t associativity = 8;
+};
+
+// A set-associative write-back, write-allocate cache with LRU
+// replacement.
+class CacheLevel {
+    struct Line {
+        uint64_t tag = 0;
+        uint64_t last_use = 0;
+        bool valid = false;
+        bool dirty = false;
+    };
+
+    CacheLevelConfig config;
+    uint64_t sets;
+    vector<Line> lines;
+
+public:
+    CacheLevel(const CacheLevelConfig &c) : config(c) {
+        sets = c.size / (c.line_size * c.associativity);
+        if (sets == 0) {
+            fprintf(stderr, "Cache level of size %llu is too small for its line size and associativity.\n",
+                    (unsigned long long)c.size);
+            exit(-1);
+        }
+        lines.resize(sets * c.associativity);
+    }
+
+    const CacheLevelConfig &get_config() const {
+        return config;
+    }
+
+    // Access the line containing addr at time now. Returns true on a
+    // hit. On a miss, the line is brought in, and *evicted_dirty is
+    // set if a dirty line had to be written back to make room.
+    bool access(uint64_t addr, bool write, uint64_t now, bool *evicted_dirty) {
+        uint64_t line_addr = addr / config.line_size;
+        uint64_t set = line_addr % sets;
+        Line *way = &lines[set * config.associativity];
+        Line *victim = way;
+        for (uint64_t i = 0; i < config.associativity; i++) {
+            if (way[i].valid && way[i].tag == line_addr) {
+                way[i].last_use = now;
+                way[i].dirty |= write;
+                return true;
+            }
+            if (!way[i].valid || (victim->valid && way[i].last_use < victim->last_use)) {
+                victim = &way[i];
+            }
+        }
+        *evicted_dirty = victim->valid && victim->dirty;
+        victim->tag = line_addr;
+        victim->last_use = now;
+        victim->valid = true;
+        victim->dirty = write;
+        return false;
+    }
+};
+
+struct FuncInfo {
+    int dimensions = 0;
+    int bytes = 0;
+    int min_coords[16];
+    int max_coords[16];
+
+    // The layout assigned to the Func after the first pass.
+    uint64_t base = 0;
+    int64_t strides[16];
+
+    // Stats from the second pass.
+    uint64_t loads = 0, stores = 0;
+    vector<uint64_t> hits;
+    uint64_t memory_bytes_read = 0, memory_bytes_written = 0;
+    // Histogram of the number of accesses (by any Func) between an
+    // access by this Func and the previous access to the same line,
+    // in powers of two. The last bucket counts first touches.
+    vector<uint64_t> reuse_histogram;
+
+    void add_bounds(const Packet &p) {
+        int lanes = p.type.lanes;
+        int real_dims = p.dimensions / lanes;
+        if (real_dims > 16) {
+            fprintf(stderr, "Error: found trace packet with dimensionality > 16. Aborting.\n");
+            exit(-1);
+        }
+        if (bytes == 0) {
+            dimensions = real_dims;
+            bytes = p.type.bytes();
+            for (int i = 0; i < real_dims; i++) {
+                min_coords[i] = INT32_MAX;
+                max_coords[i] = INT32_MIN;
+            }
+        } else if (real_dims != dimensions) {
+            fprintf(stderr, "Error: packet dimensionality doesn't match previous packets of %s. Aborting.\n", p.func());
+            exit(-1);
+        }
+        for (int lane = 0; lane < lanes; lane++) {
+            for (int i = 0; i < real_dims; i++) {
+                int c = p.coordinates()[lanes * i + lane];
+                min_coords[i] = std::min(min_coords[i], c);
+                max_coords[i] = std::max(max_coords[i], c);
+            }
+        }
+    }
+
+    // Lay the Func out densely starting at base. Returns the end of
+    // the allocation.
+    uint64_t allocate(uint64_t b, size_t num_levels) {
+        base = b;
+        int64_t size = bytes;
+        for (int i = 0; i < dimensions; i++) {
+            strides[i] = size;
+            size *= (int64_t)max_coords[i] - min_coords[i] + 1;
+        }
+        hits.resize(num_levels, 0);
+        reuse_histogram.resize(65, 0);
+        return base + size;
+    }
+
+    uint64_t address(const Packet &p, int lane) const {
+        int lanes = p.type.lanes;
+        uint64_t addr = base;
+        for (int i = 0; i < dimensions; i++) {
+            addr += (p.coordinates()[lanes * i + lane] - min_coords[i]) * strides[i];
+        }
+        return addr;
+    }
+};
+
+class CacheSimulator {
+    vector<CacheLevel> levels;
+    // The time of the last access to each line, used for reuse distances.
+    map<uint64_t, uint64_t> last_access;
+    uint64_t now = 0;
+
+public:
+    CacheSimulator(const vector<CacheLevelConfig> &configs) {
+        for (const auto &c : configs) {
+            levels.emplace_back(c);
+        }
+    }
+
+    size_t num_levels() const {
+        return levels.size();
+    }
+
+    const CacheLevelConfig &level_config(size_t i) const {
+        return levels[i].get_config();
+    }
+
+    void access(FuncInfo &f, uint64_t addr, bool write) {
+        now++;
+        if (write) {
+            f.stores++;
+        } else {
+            f.loads++;
+        }
+
+        uint64_t line = addr / levels[0].get_config().line_size;
+        auto it = last_access.find(line);
+        if (it == last_access.end()) {
+            f.reuse_histogram.back()++;
+            last_access[line] = now;
+        } else {
+            uint64_t distance = now - it->second;
+            int bucket = 0;
+            while (bucket < 63 && (distance >> (bucket + 1))) {
+                bucket++;
+            }
+            f.reuse_histogram[bucket]++;
+            it->second = now;
+        }
+
+        // Walk down the hierarchy until some level has the line. Each
+        // level that misses gets a copy.
+        size_t l = 0;
+        for (; l < levels.size(); l++) {
+            bool evicted_dirty = false;
+            bool hit = levels[l].access(addr, write, now, &evicted_dirty);
+            if (evicted_dirty && l + 1 == levels.size()) {
+                // Written back from the last level to memory. We
+                // don't track which Func owned the victim, so charge
+                // the access that caused the eviction.
+                f.memory_bytes_written += levels[l].get_config().line_size;
+            }
+            if (hit) {
+                f.hits[l]++;
+                break;
+            }
+        }
+        if (l == levels.size()) {
+            f.memory_bytes_read += levels.back().get_config().line_size;
+        }
+    }
+};
+
+bool parse_level(const char *arg, CacheLevelConfig *c) {
+    unsigned long long size, line, assoc;
+    if (sscanf(arg, "%llu,%llu,%llu", &size, &line, &assoc) != 3 ||
+        size == 0 || line == 0 || assoc == 0) {
+        return false;
+    }
+    c->size = size;
+    c->line_size = line;
+    c->associativity = assoc;
+    return true;
+}
+
+string format_bytes(uint64_t b) {
+    char buf[64];
+    if (b >= (1 << 30)) {
+        snprintf(buf, sizeof(buf), "%.2f GB", b / (double)(1 << 30));
+    } else if (b >= (1 << 20)) {
+        snprintf(buf, sizeof(buf), "%.2f MB", b / (double)(1 << 20));
+    } else if (b >= (1 << 10)) {
+        snprintf(buf, sizeof(buf), "%.2f KB", b / (double)(1 << 10));
+    } else {
+        snprintf(buf, sizeof(buf), "%llu B", (unsigned long long)b);
+    }
+    return buf;
+}
+
+void report(const CacheSimulator &sim, const map<string, FuncInfo> &func_info) {
+    printf("\nCache configuration:\n");
+    for (size_t l = 0; l < sim.num_levels(); l++) {
+        const CacheLevelConfig &c = sim.level_config(l);
+        printf("  L%d: %s, %llu byte lines, %llu-way\n", (int)l + 1, format_bytes(c.size).c_str(),
+               (unsigned long long)c.line_size, (unsigned long long)c.associativity);
+    }
+
+    uint64_t total_read = 0, total_written = 0;
+    printf("\nFuncs:\n");
+    for (const auto &pair : func_info) {
+        const FuncInfo &f = pair.second;
+        uint64_t accesses = f.loads + f.stores;
+        printf("  %s:\n", pair.first.c_str());
+        printf("    Loads: %llu, stores: %llu\n", (unsigned long long)f.loads, (unsigned long long)f.stores);
+        if (accesses == 0) {
+            continue;
+        }
+        // Hit rates are local: the fraction of accesses reaching a
+        // level that hit in it.
+        uint64_t reaching = accesses;
+        for (size_t l = 0; l < sim.num_levels(); l++) {
+            printf("    L%d hit rate: %.2f%% (%llu of %llu)\n", (int)l + 1,
+                   reaching ? 100.0 * f.hits[l] / reaching : 0.0,
+                   (unsigned long long)f.hits[l], (unsigned long long)reaching);
+            reaching -= f.hits[l];
+        }
+        printf("    Memory traffic: %s read, %s written (%.2f bytes per access)\n",
+               format_bytes(f.memory_bytes_read).c_str(),
+               format_bytes(f.memory_bytes_written).c_str(),
+               (double)(f.memory_bytes_read + f.memory_bytes_written) / accesses);
+        printf("    Reuse distance (accesses between uses of a line):\n");
+        for (int b = 0; b < 64; b++) {
+            if (f.reuse_histogram[b]) {
+                printf("      [%llu, %llu): %.2f%%\n",
+                       (unsigned long long)1 << b, (unsigned long long)1 << (b + 1),
+                       100.0 * f.reuse_histogram[b] / accesses);
+            }
+        }
+        printf("      first use: %.2f%%\n", 100.0 * f.reuse_histogram[64] / accesses);
+        total_read += f.memory_bytes_read;
+        total_written += f.memory_bytes_written;
+    }
+    printf("\nTotal memory traffic: %s read, %s written\n",
+           format_bytes(total_read).c_str(), format_bytes(total_written).c_str());
+}
+
+void usage(char * const *argv) {
+    const string usage =
+        "Usage: " + string(argv[0]) + " -i trace_file [-l size,line_size,associativity]...\n"
+        "\n"
+        "This tool reads a binary trace produced by Halide, replays its loads and\n"
+        "stores through a model of a cache hierarchy, and reports the hit rates,\n"
+        "reuse distances and memory traffic of each Func.\n"
+        "\n"
+        "Each -l adds a cache level, from the closest to the core outwards, with\n"
+        "sizes in bytes. The default is -l 32768,64,8 -l 262144,64,8 -l 8388608,64,16.\n"
+        "\n"
+        "To generate a suitable binary trace, use Func::trace_loads() and\n"
+        "Func::trace_stores(), or the target features trace_loads and trace_stores,\n"
+        "and run with HL_TRACE_FILE=<filename>.\n";
+    fprintf(stderr, "%s\n", usage.c_str());
+    exit(1);
+}
+
+int main(int argc, char * const *argv) {
+    char *trace_filename = nullptr;
+    vector<CacheLevelConfig> levels;
+    for (int i = 1; i < argc - 1; i++) {
+        string arg = argv[i];
+        if (arg == "-i") {
+            i++;
+            trace_filename = argv[i];
+        } else if (arg == "-l") {
+            i++;
+            CacheLevelConfig c;
+            if (!parse_level(argv[i], &c)) {
+                usage(argv);
+            }
+            levels.push_back(c);
+        } else {
+            usage(argv);
+        }
+    }
+
+    if (trace_filename == nullptr) {
+        usage(argv);
+    }
+    if (levels.empty()) {
+        CacheLevelConfig l1, l2, l3;
+        l1.size = 32 * 1024;
+        l2.size = 256 * 1024;
+        l3.size = 8 * 1024 * 1024;
+        l3.associativity = 16;
+        levels = {l1, l2, l3};
+    }
+
+    FILE *file_desc = fopen(trace_filename, "rb");
+    if (file_desc == nullptr) {
+        fprintf(stderr, "Error opening file: %s. Exiting.\n", trace_filename);
+        exit(1);
+    }
+
+    Halide::Trace::TraceReader reader(file_desc);
+
+    // Tuple elements of a Func are separate allocations.
+    auto key = [](const Packet &p) {
+        string k = p.func();
+        if (p.value_index > 0) {
+            k += "." + std::to_string(p.value_index);
+        }
+        return k;
+    };
+
+    // The first pass finds the bounds of each Func, to lay it out.
+    map<string, FuncInfo> func_info;
+    int packet_count = 0;
+    for (;;) {
+        Packet p;
+        if (!p.read_from_reader(reader)) {
+            break;
+        }
+        packet_count++;
+        if (p.event == halide_trace_store || p.event == halide_trace_load) {
+            func_info[key(p)].add_bounds(p);
+        }
+    }
+    printf("[INFO] Found %d Funcs with traced accesses in %d packets.\n", (int)func_info.size(), packet_count);
+
+    if (!reader.rewind()) {
+        fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
+        exit(-1);
+    }
+
+    CacheSimulator sim(levels);
+    // Start each Func on its own page, like a real allocator would.
+    uint64_t next_base = 4096;
+    for (auto &pair : func_info) {
+        uint64_t end = pair.second.allocate(next_base, sim.num_levels());
+        next_base = (end + 4095) & ~(uint64_t)4095;
+    }
+
+    for (;;) {
+        Packet p;
+        if (!p.read_from_reader(reader)) {
+            break;
+        }
+        if (p.event == halide_trace_store || p.event == halide_trace_load) {
+            FuncInfo &f = func_info[key(p)];
+            bool write = (p.event == halide_trace_store);
+            for (int lane = 0; lane < p.type.lanes; lane++) {
+                sim.access(f, f.address(p, lane), write);
+            }
+        }
+    }
+    fclose(file_desc);
+
+    report(sim, func_info);
+    return 0;
+}
@@ -318,14 +318,16 @@ int main(int argc, char * const *argv) {
         usage(argv);
     }
 
-    FILE *file_desc = fopen(buf_filename, "r");
+    FILE *file_desc = fopen(buf_filename, "rb");
     if (file_desc == nullptr) {
         fprintf(stderr, "[Error opening file: %s. Exiting.\n", argv[1]);
         exit(1);
     }
 
 
-    printf("[INFO] Starting parse of binary trace...\n");
+    Halide::Trace::TraceReader reader(file_desc);
+
+    printf("[INFO] Starting parse of %sbinary trace...\n", reader.compressed() ? "compressed " : "");
     int packet_count = 0;
 
     map<string, FuncInfo> func_info;
@@ -334,7 +336,7 @@ int main(int argc, char * const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from_reader(reader)) {
             printf("[INFO] Finished pass 1 after %d packets.\n", packet_count);
             break;
         }
@@ -356,8 +358,7 @@ int main(int argc, char * const *argv) {
     }
 
     packet_count = 0;
-    fseek(file_desc, 0, SEEK_SET);
-    if (ferror(file_desc)){
+    if (!reader.rewind()) {
         fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
         exit(-1);
     }
@@ -368,7 +369,7 @@ int main(int argc, char * const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from_reader(reader)) {
             printf("[INFO] Finished pass 2 after %d packets.\n", packet_count);
             if (file_desc != nullptr) {
                 fclose(file_desc);
@@ -2,6 +2,7 @@
 #define HALIDE_TRACE_UTILS_H
 
 #include "HalideRuntime.h"
+#include "halide_trace_stream.h"
 #include <stdio.h>
 #include <cstring>
 
@@ -89,6 +90,12 @@ struct Packet : public halide_trace_packet_t {
     // Grab a packet from a particular fctl file descriptor. Returns false when end is reached.
     bool read_from_filedesc(FILE *fdesc);
 
+    // Grab a packet from a trace in either the plain or compressed
+    // format. Returns false when end is reached.
+    bool read_from_reader(Halide::Trace::TraceReader &reader) {
+        return reader.next(this, sizeof(*this));
+    }
+
 private:
     // Do a blocking read of some number of bytes from a unistd file descriptor.
     bool read(void *d, size_t size, FILE *fdesc);
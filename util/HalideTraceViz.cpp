@@ -1,13 +1,18 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -26,6 +31,7 @@
 #include "HalideRuntime.h"
 
 #include "halide_trace_config.h"
+#include "halide_trace_stream.h"
 
 using namespace Halide;
 using namespace Halide::Trace;
@@ -36,6 +42,18 @@ namespace {
 
 bool verbose = false;
 
+// Options that control how the tool runs rather than what it draws.
+// Set from the command line before the trace is read.
+struct RunOptions {
+    // Threads used to composite frames.
+    int threads = std::max(1, (int)std::thread::hardware_concurrency());
+    // Only every frame_skip'th frame is written.
+    int frame_skip = 1;
+    // A command to pipe frames to, instead of stdout.
+    std::string output_command;
+};
+RunOptions run_options;
+
 // Log informational output to stderr, but only in verbose mode
 struct info {
     std::ostringstream msg;
@@ -145,37 +163,176 @@ T get_value_as(const halide_trace_packet_t &p, int idx) {
 struct PacketAndPayload : public halide_trace_packet_t {
     uint8_t payload[4096];
 
-    static bool read_or_die(void *buf, size_t count) {
-        char *p = (char *)buf;
-        char *p_end = p + count;
-        while (p < p_end) {
-            int64_t bytes_read = ::read(STDIN_FILENO, p, p_end - p);
-            if (bytes_read == 0) {
-                return false;  // EOF
-            } else if (bytes_read < 0) {
-                fail() << "Unable to read packet";
+    // Reads the next packet from stdin, which may hold a trace in
+    // either the plain or compressed format.
+    bool read(TraceReader &reader) {
+        return reader.next(this, sizeof(*this));
+    }
+};
+
+// Reads and decodes packets on a separate thread, so that reading
+// (and decompressing) the trace overlaps with drawing it. Packets are
+// handed over in batches to keep the locking cheap.
+class PacketReader {
+    TraceReader &reader;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::vector<uint8_t>> batches;
+    bool finished = false;
+
+    std::vector<uint8_t> current;
+    size_t cursor = 0;
+
+    static constexpr size_t batch_bytes = 1 << 20;
+    static constexpr size_t max_batches = 8;
+
+    void read_batches() {
+        PacketAndPayload p;
+        bool more = true;
+        while (more) {
+            std::vector<uint8_t> batch;
+            batch.reserve(batch_bytes + sizeof(p));
+            while (batch.size() < batch_bytes && (more = p.read(reader))) {
+                const uint8_t *bytes = (const uint8_t *)(const halide_trace_packet_t *)&p;
+                batch.insert(batch.end(), bytes, bytes + p.size);
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return batches.size() < max_batches; });
+            if (!batch.empty()) {
+                batches.push_back(std::move(batch));
+            }
+            finished = !more;
+            cond.notify_all();
+        }
+    }
+
+public:
+    PacketReader(TraceReader &r) : reader(r) {
+        thread = std::thread([this]() { read_batches(); });
+    }
+
+    ~PacketReader() {
+        thread.join();
+    }
+
+    bool read(PacketAndPayload *p) {
+        if (cursor == current.size()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return !batches.empty() || finished; });
+            if (batches.empty()) {
+                return false;
             }
-            p += bytes_read;
+            current = std::move(batches.front());
+            batches.pop_front();
+            cursor = 0;
+            cond.notify_all();
         }
-        assert(p == p_end);
+        const halide_trace_packet_t *src = (const halide_trace_packet_t *)(current.data() + cursor);
+        memcpy((halide_trace_packet_t *)p, src, src->size);
+        cursor += src->size;
         return true;
     }
+};
 
-    bool read() {
-        constexpr size_t header_size = sizeof(halide_trace_packet_t);
-        if (!read_or_die(this, header_size)) {
-            return false;  // EOF
+// Writes frames on a separate thread, so that the next frame can be
+// drawn while the last one goes to the video encoder.
+class FrameWriter {
+    FILE *file;
+    bool is_pipe;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<uint32_t> pending;
+    bool has_pending = false, done = false, failed = false;
+
+    void write_frames() {
+        std::vector<uint32_t> frame;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return has_pending || done; });
+                if (!has_pending) {
+                    return;
+                }
+                std::swap(frame, pending);
+                has_pending = false;
+                cond.notify_all();
+            }
+            if (fwrite(frame.data(), sizeof(uint32_t), frame.size(), file) != frame.size()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+            }
         }
+    }
 
-        const size_t payload_size = this->size - header_size;
-        if (payload_size > sizeof(this->payload) || !read_or_die(this->payload, payload_size)) {
-            // Shouldn't ever get EOF here
-            fail() << "Unable to read packet payload of size " << payload_size;
+public:
+    FrameWriter(const std::string &command) {
+        is_pipe = !command.empty();
+        if (is_pipe) {
+#ifdef _MSC_VER
+            file = _popen(command.c_str(), "wb");
+#else
+            file = popen(command.c_str(), "w");
+#endif
+            if (!file) {
+                fail() << "Could not run output command: " << command;
+            }
+        } else {
+            file = stdout;
         }
-        return true;
+        thread = std::thread([this]() { write_frames(); });
+    }
+
+    ~FrameWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cond.notify_all();
+        }
+        thread.join();
+        fflush(file);
+        if (is_pipe) {
+#ifdef _MSC_VER
+            _pclose(file);
+#else
+            pclose(file);
+#endif
+        }
+    }
+
+    void write(const uint32_t *data, size_t elems) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return !has_pending; });
+        if (failed) {
+            fail() << "Could not write frame.";
+        }
+        pending.assign(data, data + elems);
+        has_pending = true;
+        cond.notify_all();
     }
 };
 
+// Run body(begin, end) over [0, size) split across the compositing threads.
+template<typename Fn>
+void parallel_for(size_t size, Fn body) {
+    size_t threads = std::min((size_t)run_options.threads, std::max((size_t)1, size / 4096));
+    if (threads <= 1) {
+        body((size_t)0, size);
+        return;
+    }
+    std::vector<std::thread> workers;
+    size_t chunk = (size + threads - 1) / threads;
+    for (size_t t = 1; t < threads; t++) {
+        size_t begin = std::min(size, t * chunk), end = std::min(size, (t + 1) * chunk);
+        workers.emplace_back([=]() { body(begin, end); });
+    }
+    body((size_t)0, std::min(size, chunk));
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
 // -------------------------------------------------------------
 
 // A struct specifying how a single Func will get visualized.
@@ -295,6 +452,24 @@ To just watch the trace instead of encoding a video replace the last
 line with something like:
  mplayer -demuxer rawvideo -rawvideo w=1920:h=1080:format=rgba:fps=30 -idle -fixed-vo -
 
+Rather than piping the output, frames can be handed straight to an
+encoder with --output:
+ HalideTraceViz -s 1920 1080 <the -f args> --output \
+   "ffmpeg -f rawvideo -pix_fmt bgr32 -s 1920x1080 -i - -c:v h264 output.mp4"
+
+The following parameters control how HalideTraceViz runs:
+
+ --output command: Run command, and write the frames to its stdin
+     instead of to stdout.
+
+ --threads n: How many threads to use to composite frames. Defaults
+     to the number of cores. Reading the trace and writing frames
+     also each happen on a thread of their own.
+
+ --frame_skip n: Only write every nth frame. The others are still
+     stepped through, so highlights decay as they would at full
+     frame rate. Useful for previewing long traces. Defaults to 1.
+
 The arguments to HalideTraceViz specify how to lay out and render the
 Funcs of interest. It acts like a stateful drawing API. The following
 parameters should be set zero or one times:
@@ -792,6 +967,9 @@ void process_args(int argc, char **argv, VizState *state) {
             // Already processed, just continue
         } else if (next == "--verbose" || next == "--no-verbose") {
             // Already processed, just continue
+        } else if (next == "--output" || next == "--threads" || next == "--frame_skip") {
+            // Already processed, just skip the value
+            i++;
         } else {
             expect(false, i);
         }
@@ -830,14 +1008,16 @@ struct Surface {
     void do_decay(int decay_factor, uint32_t *dst) {
         if (decay_factor != 1) {
             const uint32_t inv_d1 = (1 << 24) / std::max(1, decay_factor);
-            for (uint32_t *dst_end = dst + frame_elems(); dst < dst_end; ++dst) {
-                uint32_t color = *dst;
-                uint32_t rgb = color & 0x00ffffff;
-                uint32_t alpha = (color >> 24);
-                alpha *= inv_d1;
-                alpha &= 0xff000000;
-                *dst = alpha | rgb;
-            }
+            parallel_for(frame_elems(), [=](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    uint32_t color = dst[i];
+                    uint32_t rgb = color & 0x00ffffff;
+                    uint32_t alpha = (color >> 24);
+                    alpha *= inv_d1;
+                    alpha &= 0xff000000;
+                    dst[i] = alpha | rgb;
+                }
+            });
         }
     }
 
@@ -983,19 +1163,28 @@ public:
         uint32_t *image_px = image.data();
         uint32_t *text_px  = text_buf.data();
         uint32_t *blend_px = blend.data();
-        for (size_t i = 0; i < image.size(); i++) {
-            // anim over anim_decay -> anim_decay
-            composite_one(anim_decay_px, anim_px, anim_decay_px);
-            // anim_decay over image -> blend
-            composite_one(image_px, anim_decay_px, blend_px);
-            // text over blend -> blend
-            composite_one(blend_px, text_px, blend_px);
-            anim_decay_px++;
-            anim_px++;
-            image_px++;
-            text_px++;
-            blend_px++;
-        }
+        parallel_for(image.size(), [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                // anim over anim_decay -> anim_decay
+                composite_one(anim_decay_px + i, anim_px + i, anim_decay_px + i);
+                // anim_decay over image -> blend
+                composite_one(image_px + i, anim_decay_px + i, blend_px + i);
+                // text over blend -> blend
+                composite_one(blend_px + i, text_px + i, blend_px + i);
+            }
+        });
+    }
+
+    // The part of composite() that carries over to the next frame,
+    // for frames that are skipped rather than written.
+    void composite_animations() {
+        uint32_t *anim_decay_px  = anim_decay.data();
+        uint32_t *anim_px  = anim.data();
+        parallel_for(anim.size(), [=](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                composite_one(anim_decay_px + i, anim_px + i, anim_decay_px + i);
+            }
+        });
     }
 
     void decay_animations(int decay_factor_after_compute, int decay_factor_during_compute) {
@@ -1090,6 +1279,10 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
     std::list<std::pair<Label, int>> labels_being_drawn;
     size_t end_counter = 0;
     size_t packet_clock = 0;
+    size_t frame_counter = 0;
+    TraceReader trace_reader(stdin);
+    PacketReader reader(trace_reader);
+    FrameWriter writer(run_options.output_command);
     for (;;) {
         // Hold for some number of frames once the trace has finished.
         if (end_counter) {
@@ -1102,8 +1295,6 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
         if (halide_clock > video_clock) {
             assert(is_state_finalized);
 
-            const int64_t frame_bytes = surface->frame_elems() * sizeof(uint32_t);
-
             while (halide_clock > video_clock) {
                 // Always render text last, since it's on top of everything
                 // and there's no need to re-render for every packet.
@@ -1124,13 +1315,14 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                     }
                 }
 
-                // Composite text over anim over image
-                surface->composite();
+                if (frame_counter++ % run_options.frame_skip == 0) {
+                    // Composite text over anim over image
+                    surface->composite();
 
-                // Dump the frame
-                int64_t bytes_written = write(STDOUT_FILENO, surface->frame_data(), frame_bytes);
-                if (bytes_written < frame_bytes) {
-                    fail() << "Could not write frame to stdout.";
+                    // Dump the frame
+                    writer.write(surface->frame_data(), surface->frame_elems());
+                } else {
+                    surface->composite_animations();
                 }
 
                 video_clock += state.globals.timestep;
@@ -1144,7 +1336,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
 
         // Read a tracing packet
         PacketAndPayload p;
-        if (!p.read()) {
+        if (!reader.read(&p)) {
             end_counter++;
             continue;
         }
@@ -1404,6 +1596,12 @@ int main(int argc, char **argv) {
             verbose = true;
         } else if (!strcmp(argv[i], "--no-verbose")) {
             verbose = false;
+        } else if (i + 1 < argc && !strcmp(argv[i], "--output")) {
+            run_options.output_command = argv[++i];
+        } else if (i + 1 < argc && !strcmp(argv[i], "--threads")) {
+            run_options.threads = std::max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && !strcmp(argv[i], "--frame_skip")) {
+            run_options.frame_skip = std::max(1, atoi(argv[++i]));
         }
     }
 